@@ -0,0 +1,498 @@
+/**
+ * @file bench_audio.c
+ * @brief File backed tdd_audio driver that measures mouth-to-ear latency
+ *
+ * Timestamps are sample exact on both ends: mic sample n entered the
+ * "ADC" at open time + n / rate, and a played sample leaves the emulated
+ * DAC once everything queued before it has played. Scheduling delays of
+ * the mic thread therefore show up as latency, exactly as a late codec
+ * interrupt would on the DevKit.
+ *
+ * The matched filter runs on the play task: per output sample, one dot
+ * product of the last chirp length of audio with each variant's template,
+ * normalized by the window energy. A detection is the correlation peak
+ * above BENCH_DETECT_THRESHOLD.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ */
+
+#include "bench_audio.h"
+#include "tdl_audio_driver.h"
+#include "tal_api.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/***********************************************************
+***********************macro define************************
+***********************************************************/
+#define FRAME_SAMPLES           (BENCH_AUDIO_RATE * BENCH_AUDIO_FRAME_MS / 1000)
+#define CHIRP_LEN               (BENCH_AUDIO_RATE * BENCH_CHIRP_MS / 1000)
+#define CHIRP_AMPLITUDE         12000.0f
+
+/* Sweeps of CHIRP_BAND_HZ, CHIRP_BAND_STEP_HZ apart, all inside G.711 and Opus wideband */
+#define CHIRP_BASE_HZ           600.0f
+#define CHIRP_BAND_HZ           700.0f
+#define CHIRP_BAND_STEP_HZ      900.0f
+
+/* Normalized correlation a played chirp reaches easily through G.711 or Opus */
+#ifndef BENCH_DETECT_THRESHOLD
+#define BENCH_DETECT_THRESHOLD  0.5f
+#endif
+
+/* Chirps before this are skipped while the speaker jitter buffer fills */
+#define BENCH_WARMUP_MS         1000
+
+/* Chirps in flight, enough for the timeout at the shortest period */
+#define PENDING_MAX             64
+
+#define US_PER_SAMPLE(n)        ((uint64_t)(n) * 1000000ULL / BENCH_AUDIO_RATE)
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef struct {
+    uint64_t t_us;              /* Chirp start entered the mic */
+    uint8_t variant;
+} bench_chirp_t;
+
+typedef struct {
+    BENCH_AUDIO_CFG_T cfg;
+    TDL_AUDIO_MIC_CB mic_cb;
+    MUTEX_HANDLE mutex;
+    THREAD_HANDLE mic_thread;
+    volatile bool running;
+    FILE *in_fp;
+    FILE *out_fp;
+
+    /* Mic side, mic thread only */
+    uint64_t mic_t0_us;         /* Sample 0 entered the mic */
+    uint64_t mic_samples;
+    uint64_t next_chirp;        /* Sample index of the next chirp start */
+    uint32_t chirp_seq;
+    uint64_t cur_chirp;         /* Start of the last chirp, the period keeps chirps apart */
+    uint8_t cur_variant;
+    bool cur_valid;
+
+    /* Pending chirps and results, under mutex */
+    bench_chirp_t pending[PENDING_MAX];
+    uint32_t pending_num;
+    uint32_t lat_us[BENCH_LATENCY_MAX];
+    uint32_t lat_num;
+    BENCH_AUDIO_STAT_T stat;
+
+    /* Speaker side, play task only */
+    uint64_t dac_t0_us;         /* Emulated DAC clock: dac_t0 + dac_samples / rate */
+    uint64_t dac_samples;
+    float hist[CHIRP_LEN * 2];  /* Played audio, duplicated so a window is contiguous */
+    uint32_t hist_pos;
+    float hist_energy;
+    uint32_t energy_age;
+    float best_corr;
+    uint8_t best_variant;
+    uint64_t best_t_us;
+    uint32_t best_age;
+    uint32_t holdoff;
+} bench_audio_ctx_t;
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static bench_audio_ctx_t g_bench;
+
+/* Unit amplitude chirps, and the same normalized to unit energy */
+static float g_chirp[BENCH_CHIRP_VARIANTS][CHIRP_LEN];
+static float g_tmpl[BENCH_CHIRP_VARIANTS][CHIRP_LEN];
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+
+uint64_t bench_audio_now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+static void bench_sleep_until_us(uint64_t t_us)
+{
+    struct timespec ts = {
+        .tv_sec = (time_t)(t_us / 1000000ULL),
+        .tv_nsec = (long)(t_us % 1000000ULL) * 1000L,
+    };
+
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0) {
+    }
+}
+
+/**
+ * @brief Build the Hann tapered linear sweeps and their templates
+ */
+static void bench_chirp_init(void)
+{
+    const double T = (double)CHIRP_LEN / BENCH_AUDIO_RATE;
+
+    for (int v = 0; v < BENCH_CHIRP_VARIANTS; v++) {
+        double f0 = CHIRP_BASE_HZ + v * CHIRP_BAND_STEP_HZ;
+        double energy = 0;
+
+        for (int i = 0; i < CHIRP_LEN; i++) {
+            double t = (double)i / BENCH_AUDIO_RATE;
+            double phase = 2.0 * M_PI * (f0 * t + CHIRP_BAND_HZ * t * t / (2.0 * T));
+            double win = 0.5 - 0.5 * cos(2.0 * M_PI * i / (CHIRP_LEN - 1));
+            g_chirp[v][i] = (float)(win * sin(phase));
+            energy += (double)g_chirp[v][i] * g_chirp[v][i];
+        }
+        for (int i = 0; i < CHIRP_LEN; i++) {
+            g_tmpl[v][i] = (float)(g_chirp[v][i] / sqrt(energy));
+        }
+    }
+}
+
+/**
+ * @brief Match a detection to the oldest pending chirp of its variant (mutex held)
+ */
+static void bench_chirp_heard(uint8_t variant, uint64_t t_us)
+{
+    bench_audio_ctx_t *ctx = &g_bench;
+
+    for (uint32_t i = 0; i < ctx->pending_num; i++) {
+        if (ctx->pending[i].variant != variant || ctx->pending[i].t_us > t_us) {
+            continue;
+        }
+        /* Chirps injected before the match were skipped by the path */
+        if (ctx->lat_num < BENCH_LATENCY_MAX) {
+            ctx->lat_us[ctx->lat_num++] = (uint32_t)(t_us - ctx->pending[i].t_us);
+        }
+        ctx->stat.detected++;
+        ctx->stat.lost += i;
+        ctx->pending_num -= i + 1;
+        memmove(&ctx->pending[0], &ctx->pending[i + 1], ctx->pending_num * sizeof(bench_chirp_t));
+        return;
+    }
+    ctx->stat.false_alarms++;
+}
+
+/**
+ * @brief Run the matched filter over played samples
+ * @param pcm Samples as handed to the DAC
+ * @param samples Count
+ * @param t_us Time the first sample leaves the speaker
+ */
+static void bench_detect(const int16_t *pcm, uint32_t samples, uint64_t t_us)
+{
+    bench_audio_ctx_t *ctx = &g_bench;
+
+    for (uint32_t n = 0; n < samples; n++) {
+        float x = pcm[n] / 32768.0f;
+        float old = ctx->hist[ctx->hist_pos];
+
+        ctx->hist[ctx->hist_pos] = x;
+        ctx->hist[ctx->hist_pos + CHIRP_LEN] = x;
+        ctx->hist_pos = (ctx->hist_pos + 1) % CHIRP_LEN;
+        ctx->hist_energy += x * x - old * old;
+
+        /* The running sum drifts, rebuild it now and then */
+        if (++ctx->energy_age >= BENCH_AUDIO_RATE) {
+            ctx->energy_age = 0;
+            ctx->hist_energy = 0;
+            for (int i = 0; i < CHIRP_LEN; i++) {
+                ctx->hist_energy += ctx->hist[i] * ctx->hist[i];
+            }
+        }
+
+        if (ctx->holdoff > 0) {
+            ctx->holdoff--;
+            continue;
+        }
+
+        /* Oldest sample of the window first */
+        const float *win = &ctx->hist[ctx->hist_pos];
+        if (ctx->hist_energy > 1e-4f) {
+            float norm = 1.0f / sqrtf(ctx->hist_energy);
+            for (int v = 0; v < BENCH_CHIRP_VARIANTS; v++) {
+                float dot = 0;
+                for (int i = 0; i < CHIRP_LEN; i++) {
+                    dot += win[i] * g_tmpl[v][i];
+                }
+                float corr = dot * norm;
+                if (corr > BENCH_DETECT_THRESHOLD && corr > ctx->best_corr) {
+                    ctx->best_corr = corr;
+                    ctx->best_variant = (uint8_t)v;
+                    ctx->best_t_us = t_us + US_PER_SAMPLE(n) - US_PER_SAMPLE(CHIRP_LEN - 1);
+                    ctx->best_age = 0;
+                }
+            }
+        }
+
+        /* Peak passed: report it and skip the rest of the chirp */
+        if (ctx->best_corr > 0 && ++ctx->best_age > CHIRP_LEN / 2) {
+            tal_mutex_lock(ctx->mutex);
+            bench_chirp_heard(ctx->best_variant, ctx->best_t_us);
+            tal_mutex_unlock(ctx->mutex);
+            ctx->best_corr = 0;
+            ctx->holdoff = CHIRP_LEN;
+        }
+    }
+}
+
+/**
+ * @brief Fill one mic frame: file audio with the chirp schedule mixed in
+ */
+static void bench_mic_frame(int16_t *pcm)
+{
+    bench_audio_ctx_t *ctx = &g_bench;
+    uint64_t first = ctx->mic_samples;
+    uint32_t period = ctx->cfg.chirp_period_ms * (BENCH_AUDIO_RATE / 1000);
+
+    memset(pcm, 0, FRAME_SAMPLES * sizeof(int16_t));
+    if (ctx->in_fp) {
+        size_t got = fread(pcm, sizeof(int16_t), FRAME_SAMPLES, ctx->in_fp);
+        if (got < FRAME_SAMPLES) {
+            rewind(ctx->in_fp);
+            fread(pcm + got, sizeof(int16_t), FRAME_SAMPLES - got, ctx->in_fp);
+        }
+    }
+
+    /* A new chirp starting in this frame becomes pending */
+    if (ctx->next_chirp < first + FRAME_SAMPLES) {
+        uint64_t t_us = ctx->mic_t0_us + US_PER_SAMPLE(ctx->next_chirp);
+
+        ctx->cur_chirp = ctx->next_chirp;
+        ctx->cur_variant = (uint8_t)(ctx->chirp_seq % BENCH_CHIRP_VARIANTS);
+        ctx->cur_valid = true;
+        ctx->next_chirp += period;
+        ctx->chirp_seq++;
+
+        tal_mutex_lock(ctx->mutex);
+        /* Expire chirps that were never heard */
+        while (ctx->pending_num > 0 &&
+               (ctx->pending_num == PENDING_MAX || t_us - ctx->pending[0].t_us > BENCH_CHIRP_TIMEOUT_MS * 1000ULL)) {
+            ctx->stat.lost++;
+            ctx->pending_num--;
+            memmove(&ctx->pending[0], &ctx->pending[1], ctx->pending_num * sizeof(bench_chirp_t));
+        }
+        ctx->pending[ctx->pending_num].t_us = t_us;
+        ctx->pending[ctx->pending_num].variant = ctx->cur_variant;
+        ctx->pending_num++;
+        ctx->stat.injected++;
+        tal_mutex_unlock(ctx->mutex);
+    }
+
+    /* The current chirp may have started in an earlier frame */
+    if (ctx->cur_valid) {
+        uint64_t s = (ctx->cur_chirp > first) ? ctx->cur_chirp : first;
+        for (; s < ctx->cur_chirp + CHIRP_LEN && s < first + FRAME_SAMPLES; s++) {
+            int32_t v = pcm[s - first] + (int32_t)(g_chirp[ctx->cur_variant][s - ctx->cur_chirp] * CHIRP_AMPLITUDE);
+            pcm[s - first] = (int16_t)((v > 32767) ? 32767 : ((v < -32768) ? -32768 : v));
+        }
+    }
+
+    ctx->mic_samples += FRAME_SAMPLES;
+}
+
+/**
+ * @brief Mic thread: one frame per BENCH_AUDIO_FRAME_MS on absolute deadlines
+ */
+static void bench_mic_task(void *arg)
+{
+    bench_audio_ctx_t *ctx = &g_bench;
+    int16_t pcm[FRAME_SAMPLES];
+
+    while (ctx->running) {
+        /* The frame is complete once its last sample was captured */
+        bench_sleep_until_us(ctx->mic_t0_us + US_PER_SAMPLE(ctx->mic_samples + FRAME_SAMPLES));
+
+        bench_mic_frame(pcm);
+        ctx->stat.mic_frames++;
+        if (ctx->mic_cb) {
+            ctx->mic_cb(TDL_AUDIO_FRAME_FORMAT_PCM, TDL_AUDIO_STATUS_RECEIVING, (uint8_t *)pcm, sizeof(pcm));
+        }
+    }
+
+    tal_thread_delete(ctx->mic_thread);
+    ctx->mic_thread = NULL;
+}
+
+static OPERATE_RET bench_audio_open(TDD_AUDIO_HANDLE_T handle, TDL_AUDIO_MIC_CB mic_cb)
+{
+    bench_audio_ctx_t *ctx = &g_bench;
+    OPERATE_RET rt = OPRT_OK;
+
+    if (ctx->running) {
+        ctx->mic_cb = mic_cb;
+        return OPRT_OK;
+    }
+
+    if (ctx->cfg.in_file) {
+        ctx->in_fp = fopen(ctx->cfg.in_file, "rb");
+        if (ctx->in_fp == NULL) {
+            PR_ERR("[BENCH] Cannot open mic input %s", ctx->cfg.in_file);
+            return OPRT_FILE_OPEN_FAILED;
+        }
+    }
+    if (ctx->cfg.out_file) {
+        ctx->out_fp = fopen(ctx->cfg.out_file, "wb");
+        if (ctx->out_fp == NULL) {
+            PR_WARN("[BENCH] Cannot create speaker output %s, not kept", ctx->cfg.out_file);
+        }
+    }
+
+    ctx->mic_cb = mic_cb;
+    ctx->mic_t0_us = bench_audio_now_us();
+    ctx->mic_samples = 0;
+    ctx->next_chirp = (uint64_t)BENCH_WARMUP_MS * (BENCH_AUDIO_RATE / 1000);
+    ctx->chirp_seq = 0;
+    ctx->dac_t0_us = ctx->mic_t0_us;
+    ctx->dac_samples = 0;
+    ctx->running = true;
+
+    THREAD_CFG_T cfg = {
+        .stackDepth = 4096,
+        .priority = THREAD_PRIO_1,
+        .thrdname = "bench_mic"
+    };
+    rt = tal_thread_create_and_start(&ctx->mic_thread, NULL, NULL, bench_mic_task, NULL, &cfg);
+    if (rt != OPRT_OK) {
+        PR_ERR("[BENCH] Failed to create mic thread: %d", rt);
+        ctx->running = false;
+    }
+
+    return rt;
+}
+
+static OPERATE_RET bench_audio_play(TDD_AUDIO_HANDLE_T handle, uint8_t *data, uint32_t len)
+{
+    bench_audio_ctx_t *ctx = &g_bench;
+    uint32_t samples = len / sizeof(int16_t);
+    uint64_t now = bench_audio_now_us();
+    uint64_t fifo_us = (uint64_t)ctx->cfg.dac_fifo_ms * 1000ULL;
+
+    /* Fifo ran dry: the next sample plays right away */
+    uint64_t dac_end = ctx->dac_t0_us + US_PER_SAMPLE(ctx->dac_samples);
+    if (dac_end < now) {
+        if (ctx->dac_samples > 0) {
+            ctx->stat.underruns++;
+        }
+        ctx->dac_t0_us = now;
+        ctx->dac_samples = 0;
+        dac_end = now;
+    }
+
+    bench_detect((const int16_t *)data, samples, dac_end);
+    if (ctx->out_fp) {
+        fwrite(data, sizeof(int16_t), samples, ctx->out_fp);
+    }
+    ctx->dac_samples += samples;
+    ctx->stat.played_samples += samples;
+
+    /* Block like a codec whose fifo is full */
+    dac_end = ctx->dac_t0_us + US_PER_SAMPLE(ctx->dac_samples);
+    if (dac_end > now + fifo_us) {
+        bench_sleep_until_us(dac_end - fifo_us);
+    }
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET bench_audio_config(TDD_AUDIO_HANDLE_T handle, TDD_AUDIO_CMD_E cmd, void *args)
+{
+    bench_audio_ctx_t *ctx = &g_bench;
+    uint64_t now = bench_audio_now_us();
+    uint64_t dac_end = ctx->dac_t0_us + US_PER_SAMPLE(ctx->dac_samples);
+
+    switch (cmd) {
+    case TDD_AUDIO_CMD_SET_VOLUME:
+        return OPRT_OK;
+
+    case TDD_AUDIO_CMD_PLAY_STOP:
+        /* The fifo is cleared, chirps still in it count as lost */
+        ctx->dac_t0_us = now;
+        ctx->dac_samples = 0;
+        return OPRT_OK;
+
+    case TDD_AUDIO_CMD_GET_PLAY_QUEUE:
+        if (args == NULL) {
+            return OPRT_INVALID_PARM;
+        }
+        *(uint32_t *)args = (dac_end > now) ? (uint32_t)((dac_end - now) * BENCH_AUDIO_RATE / 1000000ULL) : 0;
+        return OPRT_OK;
+
+    default:
+        return OPRT_INVALID_PARM;
+    }
+}
+
+static OPERATE_RET bench_audio_close(TDD_AUDIO_HANDLE_T handle)
+{
+    bench_audio_ctx_t *ctx = &g_bench;
+
+    ctx->running = false;
+    while (ctx->mic_thread != NULL) {
+        tal_system_sleep(BENCH_AUDIO_FRAME_MS);
+    }
+    if (ctx->in_fp) {
+        fclose(ctx->in_fp);
+        ctx->in_fp = NULL;
+    }
+    if (ctx->out_fp) {
+        fclose(ctx->out_fp);
+        ctx->out_fp = NULL;
+    }
+
+    return OPRT_OK;
+}
+
+OPERATE_RET bench_audio_register(char *name, const BENCH_AUDIO_CFG_T *cfg)
+{
+    OPERATE_RET rt = OPRT_OK;
+    TDD_AUDIO_INTFS_T intfs = {
+        .open = bench_audio_open,
+        .play = bench_audio_play,
+        .config = bench_audio_config,
+        .close = bench_audio_close,
+    };
+    TDD_AUDIO_INFO_T info = {
+        .sample_rate = BENCH_AUDIO_RATE,
+        .sample_ch_num = 1,
+        .sample_bits = 16,
+        .sample_tm_ms = BENCH_AUDIO_FRAME_MS,
+    };
+
+    if (cfg == NULL || cfg->chirp_period_ms < 2 * BENCH_CHIRP_MS) {
+        return OPRT_INVALID_PARM;
+    }
+
+    memset(&g_bench, 0, sizeof(g_bench));
+    g_bench.cfg = *cfg;
+    bench_chirp_init();
+
+    rt = tal_mutex_create_init(&g_bench.mutex);
+    if (rt != OPRT_OK) {
+        return rt;
+    }
+
+    return tdl_audio_driver_register(name, (TDD_AUDIO_HANDLE_T)&g_bench, &intfs, &info);
+}
+
+uint32_t bench_audio_get_latency(uint32_t *lat_us, uint32_t num)
+{
+    tal_mutex_lock(g_bench.mutex);
+    if (num > g_bench.lat_num) {
+        num = g_bench.lat_num;
+    }
+    memcpy(lat_us, g_bench.lat_us, num * sizeof(uint32_t));
+    tal_mutex_unlock(g_bench.mutex);
+
+    return num;
+}
+
+void bench_audio_get_stat(BENCH_AUDIO_STAT_T *stat)
+{
+    tal_mutex_lock(g_bench.mutex);
+    *stat = g_bench.stat;
+    tal_mutex_unlock(g_bench.mutex);
+}
@@ -0,0 +1,94 @@
+/**
+ * @file bench_audio.h
+ * @brief File backed tdd_audio driver that measures mouth-to-ear latency
+ *
+ * The mic side delivers 10ms frames on a real time clock, read in a loop
+ * from a raw PCM file (silence without one), with a short chirp mixed in
+ * every chirp period. The speaker side emulates a DAC fifo: play() blocks
+ * while more than the fifo depth is queued, like a codec would, and every
+ * played sample gets the time it would leave the speaker. A matched filter
+ * finds the chirps in the played audio; the time from a chirp entering the
+ * mic to leaving the speaker is one latency sample.
+ *
+ * Chirps come in BENCH_CHIRP_VARIANTS frequency bands used in turn, so a
+ * lost chirp is not matched to the next one.
+ *
+ * Audio format is fixed at 16 kHz mono 16-bit, like the DevKit codec.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ */
+
+#ifndef __BENCH_AUDIO_H__
+#define __BENCH_AUDIO_H__
+
+#include "tuya_cloud_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BENCH_AUDIO_RATE        16000
+#define BENCH_AUDIO_FRAME_MS    10
+
+/* Chirp: 20ms sweep, one band per variant */
+#define BENCH_CHIRP_MS          20
+#define BENCH_CHIRP_VARIANTS    4
+
+/* A chirp not heard by then is lost */
+#ifndef BENCH_CHIRP_TIMEOUT_MS
+#define BENCH_CHIRP_TIMEOUT_MS  2000
+#endif
+
+/* Latency samples kept for the percentiles */
+#ifndef BENCH_LATENCY_MAX
+#define BENCH_LATENCY_MAX       8192
+#endif
+
+typedef struct {
+    const char *in_file;        /* Raw s16le 16 kHz mono under the chirps, NULL = silence */
+    const char *out_file;       /* Everything played is written here, NULL = not kept */
+    uint32_t chirp_period_ms;   /* Time between chirps, at least 2 * BENCH_CHIRP_MS */
+    uint32_t dac_fifo_ms;       /* Emulated codec output fifo */
+} BENCH_AUDIO_CFG_T;
+
+typedef struct {
+    uint32_t injected;          /* Chirps mixed into the mic */
+    uint32_t detected;          /* Chirps found in the played audio */
+    uint32_t lost;              /* Chirps skipped or not heard within BENCH_CHIRP_TIMEOUT_MS */
+    uint32_t false_alarms;      /* Detections without a pending chirp */
+    uint32_t underruns;         /* play() found the emulated fifo empty */
+    uint32_t mic_frames;
+    uint32_t played_samples;
+} BENCH_AUDIO_STAT_T;
+
+/**
+ * @brief Register the driver with tdl_audio
+ * @param name Driver name, the DevKit modules look up AUDIO_CODEC_NAME
+ * @param cfg Configuration, strings must stay valid
+ * @return OPRT_OK on success
+ */
+OPERATE_RET bench_audio_register(char *name, const BENCH_AUDIO_CFG_T *cfg);
+
+/**
+ * @brief Copy the latencies measured so far, in microseconds, in arrival order
+ * @param lat_us Output array
+ * @param num Entries in lat_us
+ * @return Entries copied
+ */
+uint32_t bench_audio_get_latency(uint32_t *lat_us, uint32_t num);
+
+/**
+ * @brief Get the driver counters
+ */
+void bench_audio_get_stat(BENCH_AUDIO_STAT_T *stat);
+
+/**
+ * @brief Monotonic time in microseconds, the clock of every bench timestamp
+ */
+uint64_t bench_audio_now_us(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BENCH_AUDIO_H__ */
@@ -0,0 +1,272 @@
+/**
+ * @file bench_main.c
+ * @brief End-to-end audio latency benchmark for the DevKit streaming path
+ *
+ * Runs the DevKit mic_streaming and speaker_streaming modules unchanged on
+ * boards/Ubuntu: mic -> UDP -> reflector (VPS stand-in) -> UDP -> jitter
+ * buffer -> player mixer -> speaker. The bench audio driver stamps chirps
+ * into the mic and finds them in the speaker output, and the run ends with
+ * latency percentiles, jitter and loss.
+ *
+ * Usage: bench [--duration=S] [--codec=pcm|ulaw|opus] [--delay=MS] [--jitter=MS]
+ *              [--loss=PCT] [--period=MS] [--fifo=MS] [--in=FILE] [--out=FILE]
+ *
+ * Exits non-zero when no chirp came through.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ */
+
+#include "tuya_cloud_types.h"
+#include "tal_api.h"
+#include "tkl_output.h"
+#include "tdl_audio_manage.h"
+#include "ai_audio_player.h"
+#include "mic_streaming.h"
+#include "speaker_streaming.h"
+#include "audio_duplex.h"
+#include "net_resolve.h"
+#include "cmd_proto.h"
+#include "bench_audio.h"
+#include "bench_reflector.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/***********************************************************
+***********************macro define************************
+***********************************************************/
+#ifndef BENCH_HOST
+#define BENCH_HOST              "127.0.0.1"
+#endif
+
+/* Ports of the reflector: the DevKit mic uplink port and SPEAKER_VPS_PORT */
+#define BENCH_MIC_PORT          5001
+#ifndef SPEAKER_VPS_PORT
+#define SPEAKER_VPS_PORT        5012
+#endif
+
+#define BENCH_DEFAULT_DURATION_S    30
+#define BENCH_DEFAULT_PERIOD_MS     500
+#define BENCH_DEFAULT_FIFO_MS       40
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef struct {
+    uint32_t duration_s;
+    MIC_CODEC_E codec;
+    BENCH_NET_CFG_T net;
+    BENCH_AUDIO_CFG_T audio;
+} bench_cfg_t;
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static bench_cfg_t g_cfg = {
+    .duration_s = BENCH_DEFAULT_DURATION_S,
+    .codec = MIC_CODEC_PCM,
+    .net = {.mic_port = BENCH_MIC_PORT, .spk_port = SPEAKER_VPS_PORT},
+    .audio = {.chirp_period_ms = BENCH_DEFAULT_PERIOD_MS, .dac_fifo_ms = BENCH_DEFAULT_FIFO_MS},
+};
+
+static uint32_t g_lat_us[BENCH_LATENCY_MAX];
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+
+/**
+ * @brief Talk-back over the TCP mux is not part of the bench, UDP only
+ */
+OPERATE_RET cmd_proto_send_datagram(uint8_t stream, const uint8_t *data, uint32_t len)
+{
+    return OPRT_NOT_SUPPORTED;
+}
+
+static bool bench_arg(const char *arg, const char *key, const char **val)
+{
+    size_t n = strlen(key);
+
+    if (strncmp(arg, key, n) != 0 || arg[n] != '=') {
+        return false;
+    }
+    *val = arg + n + 1;
+    return true;
+}
+
+static int bench_parse_args(int argc, char *argv[])
+{
+    const char *v = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (bench_arg(argv[i], "--duration", &v)) {
+            g_cfg.duration_s = (uint32_t)atoi(v);
+        } else if (bench_arg(argv[i], "--codec", &v)) {
+            if (strcmp(v, "pcm") == 0) {
+                g_cfg.codec = MIC_CODEC_PCM;
+            } else if (strcmp(v, "ulaw") == 0) {
+                g_cfg.codec = MIC_CODEC_G711_ULAW;
+            } else if (strcmp(v, "opus") == 0) {
+                g_cfg.codec = MIC_CODEC_OPUS;
+            } else {
+                return -1;
+            }
+        } else if (bench_arg(argv[i], "--delay", &v)) {
+            g_cfg.net.delay_ms = (uint32_t)atoi(v);
+        } else if (bench_arg(argv[i], "--jitter", &v)) {
+            g_cfg.net.jitter_ms = (uint32_t)atoi(v);
+        } else if (bench_arg(argv[i], "--loss", &v)) {
+            g_cfg.net.loss_pct = (uint32_t)atoi(v);
+        } else if (bench_arg(argv[i], "--period", &v)) {
+            g_cfg.audio.chirp_period_ms = (uint32_t)atoi(v);
+        } else if (bench_arg(argv[i], "--fifo", &v)) {
+            g_cfg.audio.dac_fifo_ms = (uint32_t)atoi(v);
+        } else if (bench_arg(argv[i], "--in", &v)) {
+            g_cfg.audio.in_file = v;
+        } else if (bench_arg(argv[i], "--out", &v)) {
+            g_cfg.audio.out_file = v;
+        } else {
+            return -1;
+        }
+    }
+
+    if (g_cfg.duration_s == 0 || g_cfg.net.loss_pct > 100 || g_cfg.audio.chirp_period_ms < 2 * BENCH_CHIRP_MS) {
+        return -1;
+    }
+    return 0;
+}
+
+static int bench_cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static double bench_pct(const uint32_t *sorted, uint32_t num, uint32_t pct)
+{
+    uint32_t idx = (uint32_t)(((uint64_t)num * pct + 99) / 100);
+
+    idx = (idx == 0) ? 0 : idx - 1;
+    return sorted[idx] / 1000.0;
+}
+
+/**
+ * @brief Print latency percentiles, jitter and loss
+ * @return Chirps detected
+ */
+static uint32_t bench_report(void)
+{
+    BENCH_AUDIO_STAT_T audio;
+    BENCH_NET_STAT_T net;
+    MIC_STREAMING_STATS_T mic;
+    uint32_t packets = 0, bytes = 0, errors = 0;
+    uint32_t num = bench_audio_get_latency(g_lat_us, BENCH_LATENCY_MAX);
+
+    bench_audio_get_stat(&audio);
+    bench_reflector_get_stat(&net);
+    memset(&mic, 0, sizeof(mic));
+    mic_streaming_get_stats(&mic);
+    speaker_streaming_get_stats(&packets, &bytes, &errors);
+
+    /* RFC 3550 style: mean change between consecutive latencies */
+    double jitter = 0;
+    for (uint32_t i = 1; i < num; i++) {
+        jitter += abs((int32_t)g_lat_us[i] - (int32_t)g_lat_us[i - 1]) / 1000.0;
+    }
+    jitter = (num > 1) ? jitter / (num - 1) : 0;
+
+    double mean = 0;
+    for (uint32_t i = 0; i < num; i++) {
+        mean += g_lat_us[i] / 1000.0;
+    }
+    mean = num ? mean / num : 0;
+
+    uint32_t settled = audio.detected + audio.lost;
+    printf("\n=== mouth-to-ear latency: codec %s, delay %ums jitter %ums loss %u%%, %us ===\n",
+           mic_streaming_codec_name(g_cfg.codec), g_cfg.net.delay_ms, g_cfg.net.jitter_ms, g_cfg.net.loss_pct,
+           g_cfg.duration_s);
+    printf("chirps    injected %u detected %u lost %u (%.1f%%) false %u\n", audio.injected, audio.detected,
+           audio.lost, settled ? 100.0 * audio.lost / settled : 0.0, audio.false_alarms);
+
+    if (num > 0) {
+        qsort(g_lat_us, num, sizeof(uint32_t), bench_cmp_u32);
+        printf("latency   min %.1f p50 %.1f p90 %.1f p95 %.1f p99 %.1f max %.1f mean %.1f ms\n",
+               g_lat_us[0] / 1000.0, bench_pct(g_lat_us, num, 50), bench_pct(g_lat_us, num, 90),
+               bench_pct(g_lat_us, num, 95), bench_pct(g_lat_us, num, 99), g_lat_us[num - 1] / 1000.0, mean);
+        printf("jitter    %.2f ms\n", jitter);
+    }
+
+    printf("network   rx %u datagrams / %u frames, tx %u, dropped %u, overflow %u, before ping %u\n",
+           net.rx_datagrams, net.rx_frames, net.tx_frames, net.dropped, net.overflow, net.no_peer);
+    printf("mic       frames %u, capture-to-send avg %u max %u ms, bloat drops %u, send failures %u\n",
+           mic.frames_sent, mic.latency_avg_ms, mic.latency_max_ms, mic.bloat_dropped_frames, mic.send_failures);
+    printf("speaker   rx %u packets / %u bytes, errors %u, output %u ms, dac underruns %u\n", packets, bytes,
+           errors, ai_audio_player_get_latency_ms(), audio.underruns);
+
+    return audio.detected;
+}
+
+static int bench_run(void)
+{
+    OPERATE_RET rt = OPRT_OK;
+    TDL_AUDIO_HANDLE_T audio_hdl = NULL;
+
+    /* Stands in for board_register_hardware(), the bench driver is the codec */
+    TUYA_CALL_ERR_RETURN(bench_audio_register(AUDIO_CODEC_NAME, &g_cfg.audio));
+    TUYA_CALL_ERR_RETURN(bench_reflector_start(&g_cfg.net));
+
+    /* Same order as the DevKit boot: player, mic subscription, then open */
+    TUYA_CALL_ERR_RETURN(ai_audio_player_init());
+    TUYA_CALL_ERR_RETURN(mic_streaming_init());
+    TUYA_CALL_ERR_RETURN(tdl_audio_find(AUDIO_CODEC_NAME, &audio_hdl));
+    TUYA_CALL_ERR_RETURN(tdl_audio_open(audio_hdl, NULL));
+
+    /* Nothing may gate or attenuate the chirps */
+    mic_streaming_set_vad(false);
+    audio_duplex_set_enable(false);
+
+    TUYA_CALL_ERR_RETURN(speaker_streaming_init(BENCH_HOST));
+    TUYA_CALL_ERR_RETURN(mic_streaming_start(BENCH_HOST, BENCH_MIC_PORT, g_cfg.codec));
+
+    for (uint32_t s = 0; s < g_cfg.duration_s; s++) {
+        tal_system_sleep(1000);
+    }
+
+    mic_streaming_stop();
+    /* Let the frames in flight play out before the counters are read */
+    tal_system_sleep(BENCH_CHIRP_TIMEOUT_MS);
+    speaker_streaming_stop();
+
+    uint32_t detected = bench_report();
+
+    tdl_audio_close(audio_hdl);
+    bench_reflector_stop();
+
+    return (detected > 0) ? 0 : 1;
+}
+
+void user_main(int argc, char *argv[])
+{
+    tal_log_init(TAL_LOG_LEVEL_INFO, 1024, (TAL_LOG_OUTPUT_CB)tkl_log_output);
+    tal_sw_timer_init();
+    tal_workq_init();
+    net_resolve_init();
+
+    if (bench_parse_args(argc, argv) != 0) {
+        printf("usage: %s [--duration=S] [--codec=pcm|ulaw|opus] [--delay=MS] [--jitter=MS] [--loss=PCT]\n"
+               "          [--period=MS] [--fifo=MS] [--in=FILE] [--out=FILE]\n",
+               argv[0]);
+        exit(2);
+    }
+
+    exit(bench_run());
+}
+
+#if OPERATING_SYSTEM == SYSTEM_LINUX
+void main(int argc, char *argv[])
+{
+    user_main(argc, argv);
+}
+#else
+#error "the latency bench runs on boards/Ubuntu only"
+#endif
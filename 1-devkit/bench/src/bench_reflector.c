@@ -0,0 +1,312 @@
+/**
+ * @file bench_reflector.c
+ * @brief Loopback stand-in for the VPS audio relay, with netem style impairments
+ *
+ * One thread owns both sockets. An uplink datagram is split into its
+ * frames, each frame gets a release time (delay, jitter) or is dropped
+ * (loss), and waits in an unsorted queue; select() sleeps until the next
+ * release. Downlink packets use the speaker's headered format: MAGIC,
+ * CODEC, SEQ and a 16 kHz sample timestamp derived from SEQ, then the
+ * frame payload unchanged, so the speaker decodes PCM, G.711 or Opus
+ * itself.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ */
+
+#include "bench_reflector.h"
+#include "bench_audio.h"
+#include "udp_audio.h"
+#include "tal_api.h"
+#include "tal_network.h"
+#include <string.h>
+
+/***********************************************************
+***********************macro define************************
+***********************************************************/
+#define NET_DATAGRAM_MAX        1500
+
+/* Speaker downlink header, see speaker_streaming.c */
+#define SPK_PKT_MAGIC           0xA7
+#define SPK_PKT_HEADER_SIZE     8
+#define SPK_PING_MARKER         0xFE
+
+/* Fixed frame sizes of one 20ms frame */
+#define NET_PCM_FRAME_SIZE      640
+#define NET_ULAW_FRAME_SIZE     320
+#define NET_FRAME_SAMPLES       320
+
+#define NET_FRAME_MAX           (NET_PCM_FRAME_SIZE)
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef struct {
+    uint64_t release_us;
+    uint16_t len;
+    uint8_t pkt[SPK_PKT_HEADER_SIZE + NET_FRAME_MAX];
+} bench_net_pkt_t;
+
+typedef struct {
+    BENCH_NET_CFG_T cfg;
+    int mic_fd;
+    int spk_fd;
+    TUYA_IP_ADDR_T peer_addr;   /* Speaker, learned from its pings */
+    uint16_t peer_port;
+    THREAD_HANDLE thread;
+    volatile bool running;
+    bench_net_pkt_t queue[BENCH_NET_QUEUE_MAX];
+    uint32_t queue_num;
+    BENCH_NET_STAT_T stat;
+} bench_net_ctx_t;
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static bench_net_ctx_t g_net = {.mic_fd = -1, .spk_fd = -1};
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+
+/**
+ * @brief Queue one frame for the speaker after its impairments
+ */
+static void bench_net_queue_frame(uint8_t codec, uint16_t seq, const uint8_t *frame, uint32_t len)
+{
+    bench_net_ctx_t *ctx = &g_net;
+    int64_t delay_us = (int64_t)ctx->cfg.delay_ms * 1000;
+
+    ctx->stat.rx_frames++;
+
+    if (ctx->cfg.loss_pct > 0 && (uint32_t)tal_system_get_random(100) < ctx->cfg.loss_pct) {
+        ctx->stat.dropped++;
+        return;
+    }
+    if (len > NET_FRAME_MAX) {
+        return;
+    }
+    if (ctx->queue_num >= BENCH_NET_QUEUE_MAX) {
+        ctx->stat.overflow++;
+        return;
+    }
+
+    if (ctx->cfg.jitter_ms > 0) {
+        delay_us += ((int64_t)tal_system_get_random(2 * ctx->cfg.jitter_ms * 1000 + 1)) -
+                    (int64_t)ctx->cfg.jitter_ms * 1000;
+        if (delay_us < 0) {
+            delay_us = 0;
+        }
+    }
+
+    bench_net_pkt_t *p = &ctx->queue[ctx->queue_num++];
+    uint32_t ts = (uint32_t)seq * NET_FRAME_SAMPLES;
+
+    p->release_us = bench_audio_now_us() + (uint64_t)delay_us;
+    p->pkt[0] = SPK_PKT_MAGIC;
+    p->pkt[1] = codec;
+    p->pkt[2] = (uint8_t)(seq >> 8);
+    p->pkt[3] = (uint8_t)seq;
+    p->pkt[4] = (uint8_t)(ts >> 24);
+    p->pkt[5] = (uint8_t)(ts >> 16);
+    p->pkt[6] = (uint8_t)(ts >> 8);
+    p->pkt[7] = (uint8_t)ts;
+    memcpy(&p->pkt[SPK_PKT_HEADER_SIZE], frame, len);
+    p->len = (uint16_t)(SPK_PKT_HEADER_SIZE + len);
+}
+
+/**
+ * @brief Split one uplink datagram into frames
+ */
+static void bench_net_uplink(const uint8_t *buf, uint32_t len)
+{
+    if (len <= UDP_AUDIO_HEADER_SIZE) {
+        return;
+    }
+
+    uint16_t seq = ((uint16_t)buf[0] << 8) | buf[1];
+    uint8_t codec = buf[2];
+    uint8_t frames = buf[3];
+    const uint8_t *p = buf + UDP_AUDIO_HEADER_SIZE;
+    const uint8_t *end = buf + len;
+
+    g_net.stat.rx_datagrams++;
+
+    /* Parity and comfort noise have no downlink form, the speaker conceals */
+    if (codec == UDP_AUDIO_CODEC_FEC || codec == UDP_AUDIO_CODEC_CN) {
+        return;
+    }
+
+    for (uint8_t i = 0; i < frames && p < end; i++, seq++) {
+        uint32_t flen = 0;
+
+        if (codec == UDP_AUDIO_CODEC_OPUS) {
+            if (end - p < 2) {
+                break;
+            }
+            flen = ((uint32_t)p[0] << 8) | p[1];
+            p += 2;
+        } else {
+            flen = (codec == UDP_AUDIO_CODEC_ULAW) ? NET_ULAW_FRAME_SIZE : NET_PCM_FRAME_SIZE;
+        }
+        if (flen == 0 || (uint32_t)(end - p) < flen) {
+            break;
+        }
+        bench_net_queue_frame(codec, seq, p, flen);
+        p += flen;
+    }
+}
+
+/**
+ * @brief Send the frames that are due
+ * @return ms until the next release, or -1 with an empty queue
+ */
+static int bench_net_release(void)
+{
+    bench_net_ctx_t *ctx = &g_net;
+    uint64_t now = bench_audio_now_us();
+    uint64_t next = UINT64_MAX;
+    uint32_t i = 0;
+
+    while (i < ctx->queue_num) {
+        bench_net_pkt_t *p = &ctx->queue[i];
+        if (p->release_us > now) {
+            if (p->release_us < next) {
+                next = p->release_us;
+            }
+            i++;
+            continue;
+        }
+        if (ctx->peer_addr == 0) {
+            ctx->stat.no_peer++;
+        } else if (tal_net_send_to(ctx->spk_fd, p->pkt, p->len, ctx->peer_addr, ctx->peer_port) > 0) {
+            ctx->stat.tx_frames++;
+        }
+        /* Order does not matter, the release time does */
+        *p = ctx->queue[--ctx->queue_num];
+    }
+
+    if (next == UINT64_MAX) {
+        return -1;
+    }
+    return (int)((next - now + 999) / 1000);
+}
+
+static void bench_net_task(void *arg)
+{
+    bench_net_ctx_t *ctx = &g_net;
+    uint8_t buf[NET_DATAGRAM_MAX];
+    TUYA_FD_SET_T rfds;
+    TUYA_IP_ADDR_T addr = 0;
+    uint16_t port = 0;
+    int maxfd = (ctx->mic_fd > ctx->spk_fd) ? ctx->mic_fd : ctx->spk_fd;
+
+    PR_INFO("[BENCH] Reflector on ports %u/%u, delay %ums jitter %ums loss %u%%", ctx->cfg.mic_port,
+            ctx->cfg.spk_port, ctx->cfg.delay_ms, ctx->cfg.jitter_ms, ctx->cfg.loss_pct);
+
+    while (ctx->running) {
+        int wait_ms = bench_net_release();
+
+        tal_net_fd_zero(&rfds);
+        tal_net_fd_set(ctx->mic_fd, &rfds);
+        tal_net_fd_set(ctx->spk_fd, &rfds);
+        if (tal_net_select(maxfd + 1, &rfds, NULL, NULL, (wait_ms < 0 || wait_ms > 100) ? 100 : wait_ms) <= 0) {
+            continue;
+        }
+
+        if (tal_net_fd_isset(ctx->mic_fd, &rfds)) {
+            TUYA_ERRNO len = tal_net_recvfrom(ctx->mic_fd, buf, sizeof(buf), &addr, &port);
+            if (len > 0) {
+                bench_net_uplink(buf, (uint32_t)len);
+            }
+        }
+        if (tal_net_fd_isset(ctx->spk_fd, &rfds)) {
+            TUYA_ERRNO len = tal_net_recvfrom(ctx->spk_fd, buf, sizeof(buf), &addr, &port);
+            if (len > 0 && buf[0] == SPK_PING_MARKER) {
+                if (ctx->peer_addr != addr || ctx->peer_port != port) {
+                    PR_INFO("[BENCH] Speaker at %s:%u", tal_net_addr2str(addr), port);
+                }
+                ctx->peer_addr = addr;
+                ctx->peer_port = port;
+                /* Answer like the VPS, the speaker ignores 1 byte packets */
+                tal_net_send_to(ctx->spk_fd, buf, 1, addr, port);
+            }
+        }
+    }
+
+    tal_thread_delete(ctx->thread);
+    ctx->thread = NULL;
+}
+
+static int bench_net_bind(uint16_t port)
+{
+    int fd = tal_net_socket_create(PROTOCOL_UDP);
+
+    if (fd < 0) {
+        return -1;
+    }
+    tal_net_set_reuse(fd);
+    if (tal_net_bind(fd, TY_IPADDR_ANY, port) != OPRT_OK) {
+        PR_ERR("[BENCH] Cannot bind port %u", port);
+        tal_net_close(fd);
+        return -1;
+    }
+    tal_net_set_block(fd, FALSE);
+
+    return fd;
+}
+
+OPERATE_RET bench_reflector_start(const BENCH_NET_CFG_T *cfg)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    if (cfg == NULL || cfg->loss_pct > 100) {
+        return OPRT_INVALID_PARM;
+    }
+
+    memset(&g_net.stat, 0, sizeof(g_net.stat));
+    g_net.cfg = *cfg;
+    g_net.queue_num = 0;
+    g_net.peer_addr = 0;
+
+    g_net.mic_fd = bench_net_bind(cfg->mic_port);
+    g_net.spk_fd = bench_net_bind(cfg->spk_port);
+    if (g_net.mic_fd < 0 || g_net.spk_fd < 0) {
+        bench_reflector_stop();
+        return OPRT_SOCK_ERR;
+    }
+
+    g_net.running = true;
+    THREAD_CFG_T thrd_cfg = {
+        .stackDepth = 8192,
+        .priority = THREAD_PRIO_1,
+        .thrdname = "bench_net"
+    };
+    rt = tal_thread_create_and_start(&g_net.thread, NULL, NULL, bench_net_task, NULL, &thrd_cfg);
+    if (rt != OPRT_OK) {
+        g_net.running = false;
+        bench_reflector_stop();
+    }
+
+    return rt;
+}
+
+void bench_reflector_stop(void)
+{
+    g_net.running = false;
+    while (g_net.thread != NULL) {
+        tal_system_sleep(10);
+    }
+    if (g_net.mic_fd >= 0) {
+        tal_net_close(g_net.mic_fd);
+        g_net.mic_fd = -1;
+    }
+    if (g_net.spk_fd >= 0) {
+        tal_net_close(g_net.spk_fd);
+        g_net.spk_fd = -1;
+    }
+}
+
+void bench_reflector_get_stat(BENCH_NET_STAT_T *stat)
+{
+    *stat = g_net.stat;
+}
@@ -0,0 +1,67 @@
+/**
+ * @file bench_reflector.h
+ * @brief Loopback stand-in for the VPS audio relay, with netem style impairments
+ *
+ * Mic uplink datagrams (udp_audio.h format) are split into frames and sent
+ * back as speaker downlink packets to wherever the speaker NAT pings come
+ * from, so the DevKit mic and speaker modules run their real network code
+ * end to end on one host. Every frame can be delayed, jittered and dropped
+ * on the way, like `tc qdisc ... netem delay D J loss L` on the VPS link.
+ * A kernel netem on the loopback device works as well and adds to these.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ */
+
+#ifndef __BENCH_REFLECTOR_H__
+#define __BENCH_REFLECTOR_H__
+
+#include "tuya_cloud_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Frames held for their delay */
+#ifndef BENCH_NET_QUEUE_MAX
+#define BENCH_NET_QUEUE_MAX     256
+#endif
+
+typedef struct {
+    uint16_t mic_port;          /* Uplink port, mic_streaming_start() sends here */
+    uint16_t spk_port;          /* Downlink port, the speaker pings it (SPEAKER_VPS_PORT) */
+    uint32_t delay_ms;          /* One way delay added to every frame */
+    uint32_t jitter_ms;         /* Uniform +-jitter on top of the delay, reorders like netem */
+    uint32_t loss_pct;          /* Frames dropped, percent */
+} BENCH_NET_CFG_T;
+
+typedef struct {
+    uint32_t rx_datagrams;      /* Uplink datagrams */
+    uint32_t rx_frames;         /* Audio frames in them */
+    uint32_t tx_frames;         /* Frames sent to the speaker */
+    uint32_t dropped;           /* Frames dropped by loss_pct */
+    uint32_t overflow;          /* Frames dropped because the delay queue was full */
+    uint32_t no_peer;           /* Frames released before the first speaker ping */
+} BENCH_NET_STAT_T;
+
+/**
+ * @brief Bind both ports and start the reflector thread
+ * @param cfg Ports and impairments
+ * @return OPRT_OK on success
+ */
+OPERATE_RET bench_reflector_start(const BENCH_NET_CFG_T *cfg);
+
+/**
+ * @brief Stop the thread and close the sockets
+ */
+void bench_reflector_stop(void);
+
+/**
+ * @brief Get the reflector counters
+ */
+void bench_reflector_get_stat(BENCH_NET_STAT_T *stat);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BENCH_REFLECTOR_H__ */
@@ -0,0 +1,670 @@
+/**
+ * @file loadgen_device.c
+ * @brief Virtual DevKits speaking the DevKit TCP/UDP protocol to a relay
+ *
+ * The DevKit transport modules keep one global context each, so the wire
+ * behaviour is reproduced here per device: framing and heartbeat as in
+ * tcp_client.c, the datagram header of udp_audio.h and the NAT ping and
+ * packet header of speaker_streaming.c. Times are microseconds on the
+ * monotonic clock, so the 20ms mic deadlines do not drift with the load.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ */
+
+#include "loadgen_device.h"
+#include "udp_audio.h"
+#include "cmd_proto.h"
+#include "g711_codec.h"
+#include "net_resolve.h"
+#include "tal_api.h"
+#include "tal_network.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/***********************************************************
+***********************macro define************************
+***********************************************************/
+#define LG_RX_BUF_SIZE          2048    /* Larger control frames are skipped */
+#define LG_TX_BUF_SIZE          512
+#define LG_FRAME_HEADER_SIZE    4
+#define LG_DATAGRAM_MAX         1500
+#define LG_SEND_TIMEOUT_MS      1000
+#define LG_RECONNECT_MIN_MS     1000    /* Doubled on every failure, like tcp_client.c */
+#define LG_RECONNECT_MAX_MS     30000
+#define LG_SELECT_MAX_MS        20
+#define LG_WORKER_MAX           ((LOADGEN_DEVICES_MAX + LOADGEN_WORKER_DEVICES - 1) / LOADGEN_WORKER_DEVICES)
+
+/* One 20ms mic frame, 16kHz mono */
+#define LG_FRAME_US             20000
+#define LG_FRAME_SAMPLES        320
+#define LG_PCM_FRAME_SIZE       640
+
+/* NAT pings and the speaker header, see udp_audio.c and speaker_streaming.c */
+#define MIC_PING_MARKER         0xFF
+#define SPK_PING_MARKER         0xFE
+#define SPK_PING_SIZE           3
+#define SPK_PKT_MAGIC           0xA7
+#define SPK_PKT_HEADER_SIZE     8
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef struct {
+    uint32_t idx;
+    int tcp_fd;
+    int mic_fd;
+    int spk_fd;
+    uint8_t codec;              /* Current uplink codec */
+    bool mic_resume;            /* Streaming was on when the connection dropped */
+    uint64_t retry_us;          /* Next connect attempt */
+    uint32_t backoff_ms;
+    uint64_t connect_us;
+    uint64_t mic_next_us;
+    uint16_t mic_seq;
+    uint64_t hb_next_us;
+    uint64_t hb_sent_us;        /* 0 once acknowledged */
+    uint32_t hb_seq;
+    uint64_t ping_next_us;
+    bool spk_started;
+    uint16_t spk_max_seq;
+    uint32_t spk_cycles;        /* Sequence wraps, in units of 65536 */
+    uint16_t spk_base_seq;
+    int64_t spk_transit_us;
+    uint32_t spk_jitter_q4;     /* Jitter in 1/16 us, RFC 3550 A.8 */
+    uint32_t rx_len;
+    uint32_t rx_skip;           /* Body bytes of an oversized frame still to discard */
+    uint8_t rx_buf[LG_RX_BUF_SIZE + 1];
+    LOADGEN_STAT_T stat;
+} lg_dev_t;
+
+typedef struct {
+    THREAD_HANDLE thread;
+    uint32_t first;
+    uint32_t num;
+} lg_worker_t;
+
+typedef struct {
+    const LOADGEN_CFG_T *cfg;
+    TUYA_IP_ADDR_T addr;
+    lg_dev_t *devs;
+    uint32_t num;
+    lg_worker_t workers[LG_WORKER_MAX];
+    uint32_t worker_num;
+    volatile bool running;
+    uint8_t pcm_frame[LG_PCM_FRAME_SIZE];
+    uint8_t ulaw_frame[LG_FRAME_SAMPLES];
+} lg_ctx_t;
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static lg_ctx_t g_lg = {0};
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+
+uint64_t loadgen_now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+static const char *lg_codec_name(uint8_t codec)
+{
+    return (codec == UDP_AUDIO_CODEC_ULAW) ? "g711" : "pcm";
+}
+
+/**
+ * @brief Send one framed control message
+ * @return OPRT_OK, or OPRT_SOCK_ERR when the connection should be dropped
+ */
+static OPERATE_RET lg_dev_send(lg_dev_t *dev, const char *msg)
+{
+    uint8_t buf[LG_TX_BUF_SIZE];
+    uint32_t len = (uint32_t)strlen(msg);
+
+    if (dev->tcp_fd < 0 || len > sizeof(buf) - LG_FRAME_HEADER_SIZE) {
+        return OPRT_SOCK_ERR;
+    }
+    buf[0] = (uint8_t)len;
+    buf[1] = (uint8_t)(len >> 8);
+    buf[2] = (uint8_t)(len >> 16);
+    buf[3] = (uint8_t)(len >> 24);
+    memcpy(buf + LG_FRAME_HEADER_SIZE, msg, len);
+
+    if (tal_net_send(dev->tcp_fd, buf, len + LG_FRAME_HEADER_SIZE) != (TUYA_ERRNO)(len + LG_FRAME_HEADER_SIZE)) {
+        return OPRT_SOCK_ERR;
+    }
+    return OPRT_OK;
+}
+
+static void lg_dev_disconnect(lg_dev_t *dev, uint64_t now)
+{
+    if (dev->tcp_fd < 0) {
+        return;
+    }
+    tal_net_close(dev->tcp_fd);
+    dev->tcp_fd = -1;
+    dev->mic_resume = dev->stat.streaming;
+    dev->stat.streaming = false;
+    dev->stat.connected = false;
+    dev->stat.authenticated = false;
+    dev->stat.disconnects++;
+    dev->retry_us = now + (uint64_t)LG_RECONNECT_MIN_MS * 1000;
+    dev->backoff_ms = LG_RECONNECT_MIN_MS;
+    PR_WARN("[LOADGEN] dev %u: connection lost", dev->idx);
+}
+
+static void lg_mic_start(lg_dev_t *dev, uint64_t now)
+{
+    uint8_t ping = MIC_PING_MARKER;
+    const LOADGEN_CFG_T *cfg = g_lg.cfg;
+
+    /* Like udp_audio_send_ping(), opens the NAT mapping before the audio */
+    tal_net_send_to(dev->mic_fd, &ping, 1, g_lg.addr, cfg->mic_port);
+    dev->stat.streaming = true;
+    dev->mic_next_us = now;
+}
+
+static void lg_mic_send(lg_dev_t *dev)
+{
+    uint8_t pkt[UDP_AUDIO_HEADER_SIZE + LG_PCM_FRAME_SIZE];
+    uint32_t len = (dev->codec == UDP_AUDIO_CODEC_ULAW) ? LG_FRAME_SAMPLES : LG_PCM_FRAME_SIZE;
+
+    pkt[0] = (uint8_t)(dev->mic_seq >> 8);
+    pkt[1] = (uint8_t)dev->mic_seq;
+    pkt[2] = dev->codec;
+    pkt[3] = 1;
+    memcpy(pkt + UDP_AUDIO_HEADER_SIZE, (dev->codec == UDP_AUDIO_CODEC_ULAW) ? g_lg.ulaw_frame : g_lg.pcm_frame,
+           len);
+
+    if (tal_net_send_to(dev->mic_fd, pkt, UDP_AUDIO_HEADER_SIZE + len, g_lg.addr, g_lg.cfg->mic_port) > 0) {
+        dev->stat.mic_frames++;
+    } else {
+        dev->stat.mic_errors++;
+    }
+    dev->mic_seq++;
+}
+
+static void lg_spk_ping(lg_dev_t *dev)
+{
+    uint8_t ping[SPK_PING_SIZE];
+
+    ping[0] = SPK_PING_MARKER;
+    ping[1] = (1 << UDP_AUDIO_CODEC_PCM) | (1 << UDP_AUDIO_CODEC_ULAW);
+    ping[2] = UDP_AUDIO_CODEC_PCM;
+    tal_net_send_to(dev->spk_fd, ping, sizeof(ping), g_lg.addr, g_lg.cfg->spk_port);
+}
+
+static void lg_dev_connect(lg_dev_t *dev, uint64_t now)
+{
+    const LOADGEN_CFG_T *cfg = g_lg.cfg;
+    char auth[128];
+    int fd = tal_net_socket_create(PROTOCOL_TCP);
+
+    if (fd >= 0) {
+        tal_net_set_timeout(fd, LG_SEND_TIMEOUT_MS, TRANS_SEND);
+        if (tal_net_connect(fd, g_lg.addr, cfg->tcp_port) != OPRT_OK) {
+            tal_net_close(fd);
+            fd = -1;
+        }
+    }
+    if (fd < 0) {
+        dev->stat.connect_failures++;
+        dev->retry_us = now + (uint64_t)dev->backoff_ms * 1000;
+        dev->backoff_ms = (dev->backoff_ms * 2 > LG_RECONNECT_MAX_MS) ? LG_RECONNECT_MAX_MS : dev->backoff_ms * 2;
+        return;
+    }
+
+    dev->tcp_fd = fd;
+    dev->rx_len = 0;
+    dev->rx_skip = 0;
+    dev->connect_us = loadgen_now_us();
+    dev->hb_next_us = dev->connect_us;
+    dev->hb_sent_us = 0;
+    dev->ping_next_us = dev->connect_us;
+    dev->stat.connected = true;
+    dev->stat.connects++;
+
+    snprintf(auth, sizeof(auth), "auth:%s", cfg->token);
+    if (lg_dev_send(dev, auth) != OPRT_OK) {
+        lg_dev_disconnect(dev, now);
+    }
+}
+
+/**
+ * @brief Answer one control message the way tuya_main.c does
+ */
+static void lg_dev_command(lg_dev_t *dev, const char *data, uint32_t len, uint64_t now)
+{
+    char response[256];
+    const uint32_t hb_prefix = sizeof("hb_ack:") - 1;
+
+    if ((uint8_t)data[0] == CMD_PROTO_MAGIC) {
+        dev->stat.binary++;
+        return;
+    }
+
+    if (strncmp(data, "hb_ack:", hb_prefix) == 0) {
+        uint32_t seq = (uint32_t)strtoul(data + hb_prefix, NULL, 10);
+        dev->stat.hb_acked++;
+        if (seq == dev->hb_seq && dev->hb_sent_us) {
+            if (dev->stat.rtt_num < LOADGEN_RTT_SAMPLES_MAX) {
+                dev->stat.rtt_ms[dev->stat.rtt_num++] = (uint32_t)((now - dev->hb_sent_us + 500) / 1000);
+            }
+            dev->hb_sent_us = 0;
+        }
+        return;
+    }
+    if (strncmp(data, "auth:ok", 7) == 0) {
+        dev->stat.authenticated = true;
+        dev->stat.auth_ms = (uint32_t)((now - dev->connect_us) / 1000);
+        dev->backoff_ms = LG_RECONNECT_MIN_MS;
+        if (!g_lg.cfg->mic_on_cmd || dev->mic_resume) {
+            dev->mic_resume = false;
+            lg_mic_start(dev, now);
+        }
+        return;
+    }
+    if (strncmp(data, "auth:", 5) == 0) {
+        PR_WARN("[LOADGEN] dev %u: %.*s", dev->idx, (int)len, data);
+        return;
+    }
+    if (strncmp(data, "rr:", 3) == 0) {
+        unsigned int loss = 0, rtt = 0, jitter = 0;
+        if (sscanf(data + 3, "%u,%u,%u", &loss, &rtt, &jitter) >= 2) {
+            dev->stat.rr_reports++;
+            dev->stat.rr_loss_pct = loss;
+            dev->stat.rr_jitter_ms = jitter;
+            if (loss > dev->stat.rr_loss_max) {
+                dev->stat.rr_loss_max = loss;
+            }
+        }
+        return;
+    }
+
+    dev->stat.commands++;
+    if (strncmp(data, "ping", 4) == 0) {
+        snprintf(response, sizeof(response), "pong");
+    } else if (strncmp(data, "status", 6) == 0) {
+        snprintf(response, sizeof(response),
+                 "{\"loadgen\":%u,\"mic_streaming\":%s,\"tcp_link\":{\"hb\":%s,\"connects\":%u}}", dev->idx,
+                 dev->stat.streaming ? "true" : "false", dev->stat.hb_acked ? "true" : "false", dev->stat.connects);
+    } else if (strncmp(data, "mic on", 6) == 0) {
+        if (dev->stat.streaming) {
+            snprintf(response, sizeof(response), "ok:mic_already_on");
+        } else if (len > 7 && strncmp(data + 7, "opus", 4) == 0) {
+            /* No encoder in the generator, the bench covers Opus */
+            snprintf(response, sizeof(response), "error:mic_start_failed:%d", OPRT_NOT_SUPPORTED);
+        } else {
+            dev->codec = (len > 7 && strncmp(data + 7, "g711", 4) == 0) ? UDP_AUDIO_CODEC_ULAW : UDP_AUDIO_CODEC_PCM;
+            lg_mic_start(dev, now);
+            snprintf(response, sizeof(response), "ok:mic_on:%s", lg_codec_name(dev->codec));
+        }
+    } else if (strncmp(data, "mic off", 7) == 0) {
+        snprintf(response, sizeof(response), "%s", dev->stat.streaming ? "ok:mic_off" : "ok:mic_already_off");
+        dev->stat.streaming = false;
+    } else if (strncmp(data, "mic status", 10) == 0) {
+        snprintf(response, sizeof(response),
+                 "{\"active\":%s,\"transport\":\"udp\",\"rtp\":false,\"codec\":\"%s\",\"batch\":1,\"frames_sent\":%u}",
+                 dev->stat.streaming ? "true" : "false", lg_codec_name(dev->codec), dev->stat.mic_frames);
+    } else {
+        dev->stat.commands--;
+        snprintf(response, sizeof(response), "unknown_command:%.*s", len > 50 ? 50 : (int)len, data);
+    }
+
+    if (lg_dev_send(dev, response) != OPRT_OK) {
+        lg_dev_disconnect(dev, now);
+    }
+}
+
+/**
+ * @brief Read the control socket and handle every complete frame
+ */
+static void lg_dev_tcp_rx(lg_dev_t *dev, uint64_t now)
+{
+    uint32_t pos = 0;
+    TUYA_ERRNO n = tal_net_recv(dev->tcp_fd, dev->rx_buf + dev->rx_len, LG_RX_BUF_SIZE - dev->rx_len);
+
+    if (n <= 0) {
+        lg_dev_disconnect(dev, now);
+        return;
+    }
+    dev->rx_len += (uint32_t)n;
+
+    while (dev->tcp_fd >= 0) {
+        if (dev->rx_skip > 0) {
+            uint32_t skip = dev->rx_len - pos;
+            skip = (skip < dev->rx_skip) ? skip : dev->rx_skip;
+            pos += skip;
+            dev->rx_skip -= skip;
+            if (dev->rx_skip > 0) {
+                break;
+            }
+        }
+        if (dev->rx_len - pos < LG_FRAME_HEADER_SIZE) {
+            break;
+        }
+
+        uint8_t *p = dev->rx_buf + pos;
+        uint32_t flen = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+        if (flen > LG_RX_BUF_SIZE - LG_FRAME_HEADER_SIZE) {
+            /* Voice messages and the like, nothing a load test looks at */
+            pos += LG_FRAME_HEADER_SIZE;
+            dev->rx_skip = flen;
+            continue;
+        }
+        if (dev->rx_len - pos - LG_FRAME_HEADER_SIZE < flen) {
+            break;
+        }
+
+        uint8_t saved = p[LG_FRAME_HEADER_SIZE + flen];
+        p[LG_FRAME_HEADER_SIZE + flen] = '\0';
+        if (flen > 0) {
+            lg_dev_command(dev, (const char *)p + LG_FRAME_HEADER_SIZE, flen, now);
+        }
+        p[LG_FRAME_HEADER_SIZE + flen] = saved;
+        pos += LG_FRAME_HEADER_SIZE + flen;
+    }
+
+    if (dev->tcp_fd < 0) {
+        return;
+    }
+    if (pos > 0) {
+        memmove(dev->rx_buf, dev->rx_buf + pos, dev->rx_len - pos);
+        dev->rx_len -= pos;
+    }
+}
+
+/**
+ * @brief Account one talk-back packet: sequence span and interarrival jitter
+ */
+static void lg_dev_spk_rx(lg_dev_t *dev, uint64_t now)
+{
+    uint8_t buf[LG_DATAGRAM_MAX];
+    TUYA_IP_ADDR_T addr = 0;
+    uint16_t port = 0;
+    TUYA_ERRNO len = tal_net_recvfrom(dev->spk_fd, buf, sizeof(buf), &addr, &port);
+
+    if (len <= 1) {
+        /* Ping echo */
+        return;
+    }
+    if (len <= SPK_PKT_HEADER_SIZE || buf[0] != SPK_PKT_MAGIC) {
+        dev->stat.spk_invalid++;
+        return;
+    }
+
+    uint16_t seq = ((uint16_t)buf[2] << 8) | buf[3];
+    uint32_t ts = ((uint32_t)buf[4] << 24) | ((uint32_t)buf[5] << 16) | ((uint32_t)buf[6] << 8) | buf[7];
+    int64_t transit = (int64_t)now - (int64_t)((uint64_t)ts * 125 / 2);    /* 16kHz ticks to us */
+
+    dev->stat.spk_packets++;
+    if (!dev->spk_started) {
+        dev->spk_started = true;
+        dev->spk_base_seq = seq;
+        dev->spk_max_seq = seq;
+        dev->spk_transit_us = transit;
+    } else {
+        uint16_t delta = (uint16_t)(seq - dev->spk_max_seq);
+        if (delta == 0 || delta >= 0x8000) {
+            dev->stat.spk_reordered++;
+            return;
+        }
+        if (seq < dev->spk_max_seq) {
+            dev->spk_cycles++;
+        }
+        dev->spk_max_seq = seq;
+
+        int64_t d = transit - dev->spk_transit_us;
+        dev->spk_transit_us = transit;
+        if (d < 0) {
+            d = -d;
+        }
+        dev->spk_jitter_q4 += (uint32_t)d - ((dev->spk_jitter_q4 + 8) >> 4);
+        dev->stat.spk_jitter_us = dev->spk_jitter_q4 >> 4;
+    }
+    dev->stat.spk_expected = dev->spk_cycles * 65536u + (uint16_t)(dev->spk_max_seq - dev->spk_base_seq) + 1;
+}
+
+/**
+ * @brief Run the timers of one device
+ * @return Time of its next deadline
+ */
+static uint64_t lg_dev_poll(lg_dev_t *dev, uint64_t now)
+{
+    uint64_t next;
+    char hb[20];
+
+    if (dev->tcp_fd < 0) {
+        if (now < dev->retry_us) {
+            return dev->retry_us;
+        }
+        lg_dev_connect(dev, now);
+        if (dev->tcp_fd < 0) {
+            return dev->retry_us;
+        }
+        now = loadgen_now_us();
+    }
+
+    if (now >= dev->hb_next_us) {
+        dev->hb_next_us = now + (uint64_t)LOADGEN_HEARTBEAT_MS * 1000;
+        snprintf(hb, sizeof(hb), "hb:%u", ++dev->hb_seq);
+        if (lg_dev_send(dev, hb) != OPRT_OK) {
+            lg_dev_disconnect(dev, now);
+            return dev->retry_us;
+        }
+        dev->hb_sent_us = now;
+        dev->stat.hb_sent++;
+    }
+    next = dev->hb_next_us;
+
+    if (now >= dev->ping_next_us) {
+        dev->ping_next_us = now + (uint64_t)LOADGEN_SPK_PING_MS * 1000;
+        lg_spk_ping(dev);
+    }
+    next = (dev->ping_next_us < next) ? dev->ping_next_us : next;
+
+    if (dev->stat.streaming) {
+        if (now >= dev->mic_next_us) {
+            if (now - dev->mic_next_us >= LG_FRAME_US) {
+                /* Frames are not bunched up after a stall, the sequence stays gapless */
+                dev->stat.mic_late++;
+                dev->mic_next_us = now;
+            }
+            lg_mic_send(dev);
+            dev->mic_next_us += LG_FRAME_US;
+        }
+        next = (dev->mic_next_us < next) ? dev->mic_next_us : next;
+    }
+    return next;
+}
+
+static void lg_worker_task(void *arg)
+{
+    lg_worker_t *w = (lg_worker_t *)arg;
+    lg_dev_t *devs = g_lg.devs + w->first;
+    TUYA_FD_SET_T rfds;
+
+    while (g_lg.running) {
+        uint64_t now = loadgen_now_us();
+        uint64_t next = now + LG_SELECT_MAX_MS * 1000;
+        int maxfd = -1;
+
+        tal_net_fd_zero(&rfds);
+        for (uint32_t i = 0; i < w->num; i++) {
+            lg_dev_t *dev = &devs[i];
+            uint64_t due = lg_dev_poll(dev, now);
+
+            next = (due < next) ? due : next;
+            if (dev->tcp_fd >= 0) {
+                tal_net_fd_set(dev->tcp_fd, &rfds);
+                maxfd = (dev->tcp_fd > maxfd) ? dev->tcp_fd : maxfd;
+            }
+            tal_net_fd_set(dev->spk_fd, &rfds);
+            maxfd = (dev->spk_fd > maxfd) ? dev->spk_fd : maxfd;
+        }
+
+        now = loadgen_now_us();
+        int wait_ms = (next > now) ? (int)((next - now + 999) / 1000) : 0;
+        if (tal_net_select(maxfd + 1, &rfds, NULL, NULL, wait_ms) <= 0) {
+            continue;
+        }
+
+        now = loadgen_now_us();
+        for (uint32_t i = 0; i < w->num; i++) {
+            lg_dev_t *dev = &devs[i];
+
+            if (dev->tcp_fd >= 0 && tal_net_fd_isset(dev->tcp_fd, &rfds)) {
+                lg_dev_tcp_rx(dev, now);
+            }
+            if (tal_net_fd_isset(dev->spk_fd, &rfds)) {
+                lg_dev_spk_rx(dev, now);
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < w->num; i++) {
+        if (devs[i].tcp_fd >= 0) {
+            tal_net_close(devs[i].tcp_fd);
+            devs[i].tcp_fd = -1;
+        }
+        devs[i].stat.connected = false;
+        devs[i].stat.streaming = false;
+    }
+
+    tal_thread_delete(w->thread);
+    w->thread = NULL;
+}
+
+static int lg_udp_bind(uint16_t port)
+{
+    int fd = tal_net_socket_create(PROTOCOL_UDP);
+
+    if (fd < 0) {
+        return -1;
+    }
+    if (tal_net_bind(fd, TY_IPADDR_ANY, port) != OPRT_OK) {
+        PR_ERR("[LOADGEN] Cannot bind UDP port %u", port);
+        tal_net_close(fd);
+        return -1;
+    }
+    tal_net_set_block(fd, FALSE);
+    return fd;
+}
+
+OPERATE_RET loadgen_start(const LOADGEN_CFG_T *cfg, uint32_t num)
+{
+    OPERATE_RET rt = OPRT_OK;
+    uint64_t t0;
+
+    if (cfg == NULL || cfg->host == NULL || cfg->token == NULL || num == 0 || num > LOADGEN_DEVICES_MAX ||
+        (cfg->codec != UDP_AUDIO_CODEC_PCM && cfg->codec != UDP_AUDIO_CODEC_ULAW)) {
+        return OPRT_INVALID_PARM;
+    }
+    if (cfg->local_port && (uint32_t)cfg->local_port + 2 * num > 65536) {
+        return OPRT_INVALID_PARM;
+    }
+
+    if (net_resolve_host(cfg->host, &g_lg.addr) != OPRT_OK || g_lg.addr == 0) {
+        PR_ERR("[LOADGEN] Cannot resolve %s", cfg->host);
+        return OPRT_SOCK_ERR;
+    }
+
+    g_lg.devs = tal_malloc(num * sizeof(lg_dev_t));
+    if (g_lg.devs == NULL) {
+        return OPRT_MALLOC_FAILED;
+    }
+    memset(g_lg.devs, 0, num * sizeof(lg_dev_t));
+    g_lg.cfg = cfg;
+    g_lg.num = num;
+
+    /* Every device sends the same frame, encoded once */
+    if (cfg->mic_pcm) {
+        memcpy(g_lg.pcm_frame, cfg->mic_pcm, LG_PCM_FRAME_SIZE);
+    } else {
+        memset(g_lg.pcm_frame, 0, LG_PCM_FRAME_SIZE);
+    }
+    g711_encode_ulaw((const int16_t *)g_lg.pcm_frame, LG_FRAME_SAMPLES, g_lg.ulaw_frame);
+
+    t0 = loadgen_now_us();
+    for (uint32_t i = 0; i < num; i++) {
+        lg_dev_t *dev = &g_lg.devs[i];
+        uint16_t port = cfg->local_port ? (uint16_t)(cfg->local_port + 2 * i) : 0;
+
+        dev->idx = i;
+        dev->tcp_fd = -1;
+        dev->codec = cfg->codec;
+        dev->backoff_ms = LG_RECONNECT_MIN_MS;
+        dev->retry_us = t0 + (uint64_t)i * cfg->ramp_ms * 1000;
+        dev->mic_fd = lg_udp_bind(port);
+        dev->spk_fd = lg_udp_bind(port ? port + 1 : 0);
+        if (dev->mic_fd < 0 || dev->spk_fd < 0) {
+            g_lg.num = i + 1;
+            loadgen_stop();
+            return OPRT_SOCK_ERR;
+        }
+    }
+
+    g_lg.running = true;
+    g_lg.worker_num = 0;
+    for (uint32_t first = 0; first < num; first += LOADGEN_WORKER_DEVICES) {
+        lg_worker_t *w = &g_lg.workers[g_lg.worker_num++];
+        THREAD_CFG_T thrd_cfg = {
+            .stackDepth = 8192,
+            .priority = THREAD_PRIO_1,
+            .thrdname = "loadgen"
+        };
+
+        w->first = first;
+        w->num = (num - first < LOADGEN_WORKER_DEVICES) ? num - first : LOADGEN_WORKER_DEVICES;
+        rt = tal_thread_create_and_start(&w->thread, NULL, NULL, lg_worker_task, w, &thrd_cfg);
+        if (rt != OPRT_OK) {
+            g_lg.worker_num--;
+            loadgen_stop();
+            return rt;
+        }
+    }
+
+    PR_INFO("[LOADGEN] %u devices on %u workers against %s, tcp %u mic %u speaker %u", num, g_lg.worker_num,
+            cfg->host, cfg->tcp_port, cfg->mic_port, cfg->spk_port);
+    return OPRT_OK;
+}
+
+void loadgen_stop(void)
+{
+    g_lg.running = false;
+    for (uint32_t i = 0; i < g_lg.worker_num; i++) {
+        while (g_lg.workers[i].thread != NULL) {
+            tal_system_sleep(10);
+        }
+    }
+    g_lg.worker_num = 0;
+
+    /* The devices stay for loadgen_get_stat(), only the sockets go */
+    for (uint32_t i = 0; g_lg.devs && i < g_lg.num; i++) {
+        lg_dev_t *dev = &g_lg.devs[i];
+        if (dev->mic_fd >= 0) {
+            tal_net_close(dev->mic_fd);
+            dev->mic_fd = -1;
+        }
+        if (dev->spk_fd >= 0) {
+            tal_net_close(dev->spk_fd);
+            dev->spk_fd = -1;
+        }
+    }
+}
+
+OPERATE_RET loadgen_get_stat(uint32_t idx, LOADGEN_STAT_T *stat)
+{
+    if (stat == NULL || g_lg.devs == NULL || idx >= g_lg.num) {
+        return OPRT_INVALID_PARM;
+    }
+    *stat = g_lg.devs[idx].stat;
+    return OPRT_OK;
+}
@@ -0,0 +1,132 @@
+/**
+ * @file loadgen_device.h
+ * @brief Virtual DevKits speaking the DevKit TCP/UDP protocol to a relay
+ *
+ * Every virtual device behaves like the DevKit firmware on the wire:
+ * - TCP control: [LEN:4 LE][DATA] frames, "auth:<token>" on connect,
+ *   "hb:<seq>" every LOADGEN_HEARTBEAT_MS (RTT from "hb_ack:<seq>"), and
+ *   replies to the text commands a relay sends (ping, status, mic on/off,
+ *   mic status; anything else gets "unknown_command:" like the firmware)
+ * - Mic uplink: one 20ms frame per datagram in the udp_audio.h format to
+ *   the mic port, 50 packets per second on absolute deadlines
+ * - Talk-back: 0xFE NAT pings to the speaker port every
+ *   LOADGEN_SPK_PING_MS, headered speaker packets are checked for loss,
+ *   reordering and RFC 3550 jitter
+ *
+ * Devices are spread over worker threads of LOADGEN_WORKER_DEVICES each,
+ * every worker drives its devices from one select() loop. A device uses a
+ * TCP socket and two UDP sockets, so LOADGEN_DEVICES_MAX keeps a process
+ * under the select() limit of 1024 descriptors; run several processes for
+ * more devices.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ */
+
+#ifndef __LOADGEN_DEVICE_H__
+#define __LOADGEN_DEVICE_H__
+
+#include "tuya_cloud_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef LOADGEN_DEVICES_MAX
+#define LOADGEN_DEVICES_MAX     300
+#endif
+
+#ifndef LOADGEN_WORKER_DEVICES
+#define LOADGEN_WORKER_DEVICES  32
+#endif
+
+/* Same as TCP_HEARTBEAT_MS of tcp_client.c */
+#ifndef LOADGEN_HEARTBEAT_MS
+#define LOADGEN_HEARTBEAT_MS    500
+#endif
+
+/* Same as NAT_KEEPALIVE_MS of speaker_streaming.c */
+#ifndef LOADGEN_SPK_PING_MS
+#define LOADGEN_SPK_PING_MS     5000
+#endif
+
+/* Heartbeat round trips kept per device for the percentiles */
+#ifndef LOADGEN_RTT_SAMPLES_MAX
+#define LOADGEN_RTT_SAMPLES_MAX 1024
+#endif
+
+typedef struct {
+    const char *host;           /* Relay host name or address */
+    const char *token;          /* Sent as "auth:<token>" */
+    uint16_t tcp_port;
+    uint16_t mic_port;
+    uint16_t spk_port;
+    uint16_t local_port;        /* First local UDP port, two per device; 0 for ephemeral ports */
+    uint8_t codec;              /* Mic uplink, UDP_AUDIO_CODEC_PCM or UDP_AUDIO_CODEC_ULAW */
+    bool mic_on_cmd;            /* Stream only between "mic on" and "mic off", like the firmware */
+    uint32_t ramp_ms;           /* Delay between device starts */
+    const int16_t *mic_pcm;     /* One 20ms frame sent over and over, NULL for silence */
+} LOADGEN_CFG_T;
+
+typedef struct {
+    bool connected;
+    bool authenticated;
+    bool streaming;
+    uint32_t connects;
+    uint32_t connect_failures;
+    uint32_t disconnects;       /* Connections lost after connecting */
+    uint32_t auth_ms;           /* Connect to "auth:ok" of the last connection */
+    uint32_t commands;          /* Text commands answered */
+    uint32_t binary;            /* Binary opcode frames, counted only */
+    uint32_t hb_sent;
+    uint32_t hb_acked;
+    uint32_t mic_frames;
+    uint32_t mic_errors;        /* Failed datagram sends */
+    uint32_t mic_late;          /* Frames sent over a frame late, the generator is overloaded */
+    uint32_t rr_reports;        /* "rr:" receiver reports from the relay */
+    uint32_t rr_loss_pct;       /* Last reported mic loss */
+    uint32_t rr_loss_max;
+    uint32_t rr_jitter_ms;      /* Last reported mic jitter */
+    uint32_t spk_packets;
+    uint32_t spk_expected;      /* Sequence span seen, lost = expected - packets */
+    uint32_t spk_reordered;     /* Late or duplicate packets */
+    uint32_t spk_invalid;       /* Datagrams that are not speaker packets */
+    uint32_t spk_jitter_us;     /* RFC 3550 interarrival jitter */
+    uint32_t rtt_num;           /* Samples in rtt_ms, at most LOADGEN_RTT_SAMPLES_MAX */
+    uint32_t rtt_ms[LOADGEN_RTT_SAMPLES_MAX];
+} LOADGEN_STAT_T;
+
+/**
+ * @brief Create the devices and start the workers
+ *
+ * @param cfg Relay and traffic settings, kept by reference
+ * @param num Devices, 1..LOADGEN_DEVICES_MAX
+ * @return OPRT_OK on success
+ */
+OPERATE_RET loadgen_start(const LOADGEN_CFG_T *cfg, uint32_t num);
+
+/**
+ * @brief Stop the workers and close every connection
+ */
+void loadgen_stop(void);
+
+/**
+ * @brief Get the counters of one device
+ *
+ * Exact after loadgen_stop(), a snapshot of moving counters before.
+ *
+ * @param idx Device index
+ * @param stat Output
+ * @return OPRT_OK on success, OPRT_INVALID_PARM for an unknown device
+ */
+OPERATE_RET loadgen_get_stat(uint32_t idx, LOADGEN_STAT_T *stat);
+
+/**
+ * @brief Monotonic time in microseconds
+ */
+uint64_t loadgen_now_us(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LOADGEN_DEVICE_H__ */
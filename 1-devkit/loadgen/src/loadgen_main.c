@@ -0,0 +1,346 @@
+/**
+ * @file loadgen_main.c
+ * @brief Relay load generator: N virtual DevKits against one VPS
+ *
+ * Each virtual device authenticates on the TCP control port, streams a
+ * 20ms mic frame 50 times a second, answers the relay's control commands
+ * and pings for talk-back like the DevKit firmware (see loadgen_device.h).
+ * Progress is printed every LOADGEN_PROGRESS_S, and the run ends with one
+ * line per device and a summary:
+ * - rtt:   heartbeat round trip through the relay's control path, p50/p99/max
+ * - mic:   frames sent, frames the generator itself sent late, and the
+ *          uplink loss the relay reported in "rr:" receiver reports
+ * - talk:  talk-back packets received, lost (sequence gaps) and jitter
+ *
+ * Usage: loadgen [--host=H] [--devices=N] [--duration=S] [--ramp=MS] [--token=T]
+ *                [--tcp-port=P] [--mic-port=P] [--spk-port=P] [--local-port=P]
+ *                [--codec=pcm|g711] [--mic=auto|cmd] [--csv=FILE]
+ *
+ * Exits non-zero when a device never connected.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ */
+
+#include "tuya_cloud_types.h"
+#include "tal_api.h"
+#include "tkl_output.h"
+#include "net_resolve.h"
+#include "udp_audio.h"
+#include "loadgen_device.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/***********************************************************
+***********************macro define************************
+***********************************************************/
+#ifndef LOADGEN_HOST
+#define LOADGEN_HOST            "127.0.0.1"
+#endif
+
+#ifdef TCP_AUTH_TOKEN
+#define LOADGEN_TOKEN           TCP_AUTH_TOKEN
+#else
+#define LOADGEN_TOKEN           "devkit-secret-token"
+#endif
+
+/* DevKit defaults: TCP_SERVER_PORT, mic_streaming_start() and SPEAKER_UDP_PORT */
+#define LOADGEN_TCP_PORT        5000
+#define LOADGEN_MIC_PORT        5001
+#define LOADGEN_SPK_PORT        5002
+
+#define LOADGEN_DEFAULT_DEVICES     10
+#define LOADGEN_DEFAULT_DURATION_S  60
+#define LOADGEN_DEFAULT_RAMP_MS     50
+#define LOADGEN_PROGRESS_S          5
+
+/* Mic test tone: 500 Hz at -20 dBFS, a whole number of periods per frame */
+#define LOADGEN_TONE_HZ         500
+#define LOADGEN_TONE_AMPLITUDE  3277
+#define LOADGEN_FRAME_SAMPLES   320
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef struct {
+    uint32_t devices;
+    uint32_t duration_s;
+    const char *csv_file;
+    LOADGEN_CFG_T dev;
+} loadgen_args_t;
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static int16_t g_tone[LOADGEN_FRAME_SAMPLES];
+
+static loadgen_args_t g_args = {
+    .devices = LOADGEN_DEFAULT_DEVICES,
+    .duration_s = LOADGEN_DEFAULT_DURATION_S,
+    .dev = {
+        .host = LOADGEN_HOST,
+        .token = LOADGEN_TOKEN,
+        .tcp_port = LOADGEN_TCP_PORT,
+        .mic_port = LOADGEN_MIC_PORT,
+        .spk_port = LOADGEN_SPK_PORT,
+        .codec = UDP_AUDIO_CODEC_PCM,
+        .ramp_ms = LOADGEN_DEFAULT_RAMP_MS,
+        .mic_pcm = g_tone,
+    },
+};
+
+static LOADGEN_STAT_T g_stat;
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+
+static bool loadgen_arg(const char *arg, const char *key, const char **val)
+{
+    size_t n = strlen(key);
+
+    if (strncmp(arg, key, n) != 0 || arg[n] != '=') {
+        return false;
+    }
+    *val = arg + n + 1;
+    return true;
+}
+
+static int loadgen_parse_args(int argc, char *argv[])
+{
+    const char *v = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (loadgen_arg(argv[i], "--host", &v)) {
+            g_args.dev.host = v;
+        } else if (loadgen_arg(argv[i], "--devices", &v)) {
+            g_args.devices = (uint32_t)atoi(v);
+        } else if (loadgen_arg(argv[i], "--duration", &v)) {
+            g_args.duration_s = (uint32_t)atoi(v);
+        } else if (loadgen_arg(argv[i], "--ramp", &v)) {
+            g_args.dev.ramp_ms = (uint32_t)atoi(v);
+        } else if (loadgen_arg(argv[i], "--token", &v)) {
+            g_args.dev.token = v;
+        } else if (loadgen_arg(argv[i], "--tcp-port", &v)) {
+            g_args.dev.tcp_port = (uint16_t)atoi(v);
+        } else if (loadgen_arg(argv[i], "--mic-port", &v)) {
+            g_args.dev.mic_port = (uint16_t)atoi(v);
+        } else if (loadgen_arg(argv[i], "--spk-port", &v)) {
+            g_args.dev.spk_port = (uint16_t)atoi(v);
+        } else if (loadgen_arg(argv[i], "--local-port", &v)) {
+            g_args.dev.local_port = (uint16_t)atoi(v);
+        } else if (loadgen_arg(argv[i], "--codec", &v)) {
+            if (strcmp(v, "pcm") == 0) {
+                g_args.dev.codec = UDP_AUDIO_CODEC_PCM;
+            } else if (strcmp(v, "g711") == 0) {
+                g_args.dev.codec = UDP_AUDIO_CODEC_ULAW;
+            } else {
+                return -1;
+            }
+        } else if (loadgen_arg(argv[i], "--mic", &v)) {
+            if (strcmp(v, "auto") == 0) {
+                g_args.dev.mic_on_cmd = false;
+            } else if (strcmp(v, "cmd") == 0) {
+                g_args.dev.mic_on_cmd = true;
+            } else {
+                return -1;
+            }
+        } else if (loadgen_arg(argv[i], "--csv", &v)) {
+            g_args.csv_file = v;
+        } else {
+            return -1;
+        }
+    }
+
+    if (g_args.devices == 0 || g_args.devices > LOADGEN_DEVICES_MAX || g_args.duration_s == 0) {
+        return -1;
+    }
+    return 0;
+}
+
+static int loadgen_cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static uint32_t loadgen_pct(const uint32_t *sorted, uint32_t num, uint32_t pct)
+{
+    uint32_t idx = (uint32_t)(((uint64_t)num * pct + 99) / 100);
+
+    if (num == 0) {
+        return 0;
+    }
+    idx = (idx == 0) ? 0 : idx - 1;
+    return sorted[idx];
+}
+
+static uint32_t loadgen_spk_lost(const LOADGEN_STAT_T *st)
+{
+    /* Late packets count as received but not in the span */
+    uint32_t in_order = st->spk_packets - st->spk_reordered;
+    return (st->spk_expected > in_order) ? st->spk_expected - in_order : 0;
+}
+
+static void loadgen_progress(uint32_t elapsed_s)
+{
+    uint32_t connected = 0, authenticated = 0, streaming = 0;
+    uint64_t mic = 0, spk = 0;
+
+    for (uint32_t i = 0; i < g_args.devices; i++) {
+        if (loadgen_get_stat(i, &g_stat) != OPRT_OK) {
+            continue;
+        }
+        connected += g_stat.connected;
+        authenticated += g_stat.authenticated;
+        streaming += g_stat.streaming;
+        mic += g_stat.mic_frames;
+        spk += g_stat.spk_packets;
+    }
+    printf("[%4us] connected %u/%u auth %u streaming %u, mic %.0f pps, talk-back %.0f pps\n", elapsed_s, connected,
+           g_args.devices, authenticated, streaming, (double)mic / elapsed_s, (double)spk / elapsed_s);
+}
+
+/**
+ * @brief Print one line per device and the summary, optionally write a CSV
+ * @return Devices that never connected
+ */
+static uint32_t loadgen_report(void)
+{
+    FILE *csv = NULL;
+    uint32_t never = 0, late_devices = 0, pooled_num = 0;
+    uint64_t mic = 0, mic_late = 0, spk = 0, spk_lost = 0, spk_expected = 0, disconnects = 0;
+    uint32_t rr_loss_max = 0;
+    uint32_t *pooled = malloc((size_t)g_args.devices * LOADGEN_RTT_SAMPLES_MAX * sizeof(uint32_t));
+
+    if (g_args.csv_file) {
+        csv = fopen(g_args.csv_file, "w");
+        if (csv == NULL) {
+            PR_ERR("[LOADGEN] Cannot write %s", g_args.csv_file);
+        } else {
+            fprintf(csv, "device,connects,connect_failures,disconnects,auth_ms,rtt_p50_ms,rtt_p99_ms,rtt_max_ms,"
+                         "hb_sent,hb_acked,mic_frames,mic_late,mic_errors,rr_reports,rr_loss_pct,rr_loss_max,"
+                         "rr_jitter_ms,spk_packets,spk_lost,spk_reordered,spk_jitter_ms\n");
+        }
+    }
+
+    printf("\n=== relay load: %u devices, codec %s, mic %s, %us against %s ===\n", g_args.devices,
+           (g_args.dev.codec == UDP_AUDIO_CODEC_ULAW) ? "g711" : "pcm", g_args.dev.mic_on_cmd ? "on command" : "auto",
+           g_args.duration_s, g_args.dev.host);
+    printf("dev  conn fail drop  auth  rtt p50/p99/max ms   mic frames  late  rr loss/max  talk pkts  lost  jitter\n");
+
+    for (uint32_t i = 0; i < g_args.devices; i++) {
+        if (loadgen_get_stat(i, &g_stat) != OPRT_OK) {
+            continue;
+        }
+        LOADGEN_STAT_T *st = &g_stat;
+        uint32_t lost = loadgen_spk_lost(st);
+
+        if (pooled) {
+            memcpy(pooled + pooled_num, st->rtt_ms, st->rtt_num * sizeof(uint32_t));
+            pooled_num += st->rtt_num;
+        }
+        qsort(st->rtt_ms, st->rtt_num, sizeof(uint32_t), loadgen_cmp_u32);
+        uint32_t p50 = loadgen_pct(st->rtt_ms, st->rtt_num, 50);
+        uint32_t p99 = loadgen_pct(st->rtt_ms, st->rtt_num, 99);
+        uint32_t max = st->rtt_num ? st->rtt_ms[st->rtt_num - 1] : 0;
+
+        printf("%3u  %4u %4u %4u %5u  %5u/%5u/%5u   %10u %5u  %3u%%/%3u%%   %9u %5u %5.1fms\n", i, st->connects,
+               st->connect_failures, st->disconnects, st->auth_ms, p50, p99, max, st->mic_frames, st->mic_late,
+               st->rr_loss_pct, st->rr_loss_max, st->spk_packets, lost, st->spk_jitter_us / 1000.0);
+        if (csv) {
+            fprintf(csv, "%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%.1f\n", i, st->connects,
+                    st->connect_failures, st->disconnects, st->auth_ms, p50, p99, max, st->hb_sent, st->hb_acked,
+                    st->mic_frames, st->mic_late, st->mic_errors, st->rr_reports, st->rr_loss_pct, st->rr_loss_max,
+                    st->rr_jitter_ms, st->spk_packets, lost, st->spk_reordered, st->spk_jitter_us / 1000.0);
+        }
+
+        never += (st->connects == 0);
+        late_devices += (st->mic_late > 0);
+        disconnects += st->disconnects;
+        mic += st->mic_frames;
+        mic_late += st->mic_late;
+        spk += st->spk_packets;
+        spk_lost += lost;
+        spk_expected += st->spk_expected;
+        rr_loss_max = (st->rr_loss_max > rr_loss_max) ? st->rr_loss_max : rr_loss_max;
+    }
+
+    printf("\nsummary   %u/%u devices connected, %llu disconnects\n", g_args.devices - never, g_args.devices,
+           (unsigned long long)disconnects);
+    if (pooled && pooled_num > 0) {
+        qsort(pooled, pooled_num, sizeof(uint32_t), loadgen_cmp_u32);
+        printf("rtt       p50 %u p90 %u p99 %u max %u ms over %u heartbeats\n", loadgen_pct(pooled, pooled_num, 50),
+               loadgen_pct(pooled, pooled_num, 90), loadgen_pct(pooled, pooled_num, 99), pooled[pooled_num - 1],
+               pooled_num);
+    } else {
+        printf("rtt       no heartbeat acknowledged\n");
+    }
+    printf("mic       %llu frames (%.0f pps), %llu late on %u devices, worst reported loss %u%%\n",
+           (unsigned long long)mic, (double)mic / g_args.duration_s, (unsigned long long)mic_late, late_devices,
+           rr_loss_max);
+    printf("talk-back %llu packets, lost %llu (%.2f%%)\n", (unsigned long long)spk, (unsigned long long)spk_lost,
+           spk_expected ? 100.0 * spk_lost / spk_expected : 0.0);
+    if (mic_late) {
+        printf("warning   the generator fell behind, its own numbers are not the relay's\n");
+    }
+
+    free(pooled);
+    if (csv) {
+        fclose(csv);
+    }
+    return never;
+}
+
+static int loadgen_run(void)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    for (uint32_t i = 0; i < LOADGEN_FRAME_SAMPLES; i++) {
+        g_tone[i] = (int16_t)(LOADGEN_TONE_AMPLITUDE * sin(2 * M_PI * LOADGEN_TONE_HZ * i / 16000.0));
+    }
+
+    rt = loadgen_start(&g_args.dev, g_args.devices);
+    if (rt != OPRT_OK) {
+        PR_ERR("[LOADGEN] start failed: %d", rt);
+        return 2;
+    }
+
+    for (uint32_t s = 1; s <= g_args.duration_s; s++) {
+        tal_system_sleep(1000);
+        if (s % LOADGEN_PROGRESS_S == 0) {
+            loadgen_progress(s);
+        }
+    }
+    loadgen_stop();
+
+    return (loadgen_report() == 0) ? 0 : 1;
+}
+
+void user_main(int argc, char *argv[])
+{
+    tal_log_init(TAL_LOG_LEVEL_INFO, 1024, (TAL_LOG_OUTPUT_CB)tkl_log_output);
+    tal_sw_timer_init();
+    tal_workq_init();
+    net_resolve_init();
+
+    if (loadgen_parse_args(argc, argv) != 0) {
+        printf("usage: %s [--host=H] [--devices=1-%u] [--duration=S] [--ramp=MS] [--token=T]\n"
+               "          [--tcp-port=P] [--mic-port=P] [--spk-port=P] [--local-port=P]\n"
+               "          [--codec=pcm|g711] [--mic=auto|cmd] [--csv=FILE]\n",
+               argv[0], LOADGEN_DEVICES_MAX);
+        exit(2);
+    }
+
+    exit(loadgen_run());
+}
+
+#if OPERATING_SYSTEM == SYSTEM_LINUX
+void main(int argc, char *argv[])
+{
+    user_main(argc, argv);
+}
+#else
+#error "the load generator runs on boards/Ubuntu only"
+#endif
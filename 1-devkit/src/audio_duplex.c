@@ -0,0 +1,314 @@
+/**
+ * @file audio_duplex.c
+ * @brief Echo control between the talk-back speaker and the mic uplink
+ *
+ * Works on 20ms frame envelopes (mean absolute amplitude) stamped with the
+ * system time, so speaker and mic frames can be lined up without sharing a
+ * sample clock:
+ * - Every second the speaker envelope is correlated with the mic envelope
+ *   over 0-300ms of lag; a clear peak locks the echo delay
+ * - The echo level relative to the speaker is learned from echo-only
+ *   frames with a fast-down, slow-up follower
+ * - While the visitor talks over the speaker, the delay is held
+ * - A mic frame no louder than twice the expected echo is echo and gets
+ *   attenuated by 24 dB; louder frames are double talk and pass
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ */
+
+#include "audio_duplex.h"
+#include "tal_api.h"
+#include <string.h>
+
+/***********************************************************
+***********************macro define************************
+***********************************************************/
+#define DUPLEX_FRAME_MS         20
+
+/* Envelope history (power of two): must cover the correlation window plus the delay range */
+#define DUPLEX_HISTORY          128
+#define DUPLEX_HISTORY_MASK     (DUPLEX_HISTORY - 1)
+
+/* Echo delay search: 0..15 frames (0-300ms), window of 1s, redone every 0.5s */
+#define DUPLEX_MAX_DELAY        16
+#define DUPLEX_CORR_FRAMES      50
+#define DUPLEX_CORR_INTERVAL    25
+#define DUPLEX_CORR_MIN_ACTIVE  10      /* Speaker frames needed in the window */
+#define DUPLEX_CORR_SHIFT       4       /* Envelope scaling so the sums fit in 64 bits */
+
+/* Speaker frames quieter than this can't produce a noticeable echo */
+#define DUPLEX_REF_ACTIVE       100
+
+/* Double talk: mic above expected echo * RATIO + MARGIN */
+#define DUPLEX_DT_RATIO         2
+#define DUPLEX_DT_MARGIN        60
+
+/* Echo gain (mic echo / speaker level) in Q12, fine enough for the slow rise */
+#define DUPLEX_GAIN_ONE_Q12     4096
+#define DUPLEX_GAIN_INIT_Q12    4096    /* Before learning: as loud as the speaker */
+#define DUPLEX_GAIN_MIN_Q12     64
+#define DUPLEX_GAIN_MAX_Q12     16384
+#define DUPLEX_GAIN_DOWN_SHIFT  2       /* Follow quieter echo fast */
+#define DUPLEX_GAIN_UP_SHIFT    6       /* Rise slowly */
+
+/* Attenuation for echo frames, Q15 (-24 dB) */
+#define DUPLEX_SUPPRESS_Q15     2048
+#define DUPLEX_UNITY_Q15        32768
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+/**
+ * @brief One envelope history entry
+ */
+typedef struct {
+    volatile uint32_t slot;     /* System time / 20ms when the frame was played/captured */
+    volatile uint32_t energy;   /* Mean absolute amplitude */
+} duplex_env_t;
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+/* Written by the speaker playback task only */
+static duplex_env_t g_ref_env[DUPLEX_HISTORY];
+
+/* Everything below: mic streaming task only */
+static duplex_env_t g_mic_env[DUPLEX_HISTORY];
+static volatile bool g_duplex_enabled = true;
+static bool g_delay_locked = false;
+static uint32_t g_delay_frames = 0;
+static uint32_t g_gain_q12 = DUPLEX_GAIN_INIT_Q12;
+static uint32_t g_cur_gain_q15 = DUPLEX_UNITY_Q15;
+static uint32_t g_corr_countdown = DUPLEX_CORR_INTERVAL;
+static uint32_t g_double_talk_hold = 0;   /* Frames until the window is free of double talk */
+static uint32_t g_suppressed_frames = 0;
+static uint32_t g_double_talk_frames = 0;
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+static uint32_t duplex_frame_energy(const int16_t *pcm, uint32_t samples)
+{
+    uint32_t sum = 0;
+
+    if (samples == 0) {
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < samples; i++) {
+        int32_t s = pcm[i];
+        sum += (uint32_t)(s < 0 ? -s : s);
+    }
+
+    return sum / samples;
+}
+
+static uint32_t duplex_env_get(const duplex_env_t *hist, uint32_t slot)
+{
+    const duplex_env_t *e = &hist[slot & DUPLEX_HISTORY_MASK];
+
+    return (e->slot == slot) ? e->energy : 0;
+}
+
+/**
+ * @brief Loudest speaker frame that can echo into the mic frame at slot
+ *
+ * Spans one frame of timing slop before the delay and two frames of room
+ * reverb after it; without a locked delay the whole search range.
+ */
+static uint32_t duplex_ref_energy(uint32_t slot)
+{
+    uint32_t lo = g_delay_locked ? g_delay_frames + 2 : DUPLEX_MAX_DELAY - 1;
+    uint32_t hi = g_delay_locked && g_delay_frames > 0 ? g_delay_frames - 1 : 0;
+    uint32_t max = 0;
+
+    for (uint32_t d = hi; d <= lo; d++) {
+        uint32_t e = duplex_env_get(g_ref_env, slot - d);
+        if (e > max) {
+            max = e;
+        }
+    }
+
+    return max;
+}
+
+/**
+ * @brief Find the lag where the mic envelope follows the speaker envelope best
+ */
+static void duplex_estimate_delay(uint32_t slot)
+{
+    uint64_t best_score = 0, best_mr = 0, best_rr = 0, best_mm = 0;
+    int32_t best_d = -1;
+
+    for (uint32_t d = 0; d < DUPLEX_MAX_DELAY; d++) {
+        uint64_t mr = 0, rr = 0, mm = 0;
+        uint32_t active = 0;
+
+        for (uint32_t k = 0; k < DUPLEX_CORR_FRAMES; k++) {
+            uint32_t r = duplex_env_get(g_ref_env, slot - k - d);
+            uint64_t m = duplex_env_get(g_mic_env, slot - k) >> DUPLEX_CORR_SHIFT;
+
+            if (r >= DUPLEX_REF_ACTIVE) {
+                active++;
+            }
+            r >>= DUPLEX_CORR_SHIFT;
+            mr += m * r;
+            rr += (uint64_t)r * r;
+            mm += m * m;
+        }
+
+        if (active < DUPLEX_CORR_MIN_ACTIVE || rr == 0) {
+            continue;
+        }
+
+        /* mm is the same for every lag, mr^2/rr ranks the normalized correlation */
+        uint64_t score = mr * mr / rr;
+        if (score > best_score) {
+            best_score = score;
+            best_d = (int32_t)d;
+            best_mr = mr;
+            best_rr = rr;
+            best_mm = mm;
+        }
+    }
+
+    /* Lock only on a clear match (correlation coefficient >= 0.7) */
+    if (best_d >= 0 && 2 * best_mr * best_mr >= best_mm * best_rr) {
+        if (!g_delay_locked || g_delay_frames != (uint32_t)best_d) {
+            PR_DEBUG("Duplex: echo delay %u ms", (uint32_t)best_d * DUPLEX_FRAME_MS);
+        }
+        g_delay_frames = (uint32_t)best_d;
+        g_delay_locked = true;
+    }
+}
+
+void audio_duplex_init(void)
+{
+    for (uint32_t i = 0; i < DUPLEX_HISTORY; i++) {
+        g_ref_env[i].slot = UINT32_MAX;
+        g_mic_env[i].slot = UINT32_MAX;
+    }
+
+    g_delay_locked = false;
+    g_delay_frames = 0;
+    g_gain_q12 = DUPLEX_GAIN_INIT_Q12;
+    g_cur_gain_q15 = DUPLEX_UNITY_Q15;
+    g_corr_countdown = DUPLEX_CORR_INTERVAL;
+    g_double_talk_hold = 0;
+    g_suppressed_frames = 0;
+    g_double_talk_frames = 0;
+}
+
+void audio_duplex_feed_ref(const int16_t *pcm, uint32_t samples)
+{
+    uint32_t slot = tal_system_get_millisecond() / DUPLEX_FRAME_MS;
+    uint32_t energy = duplex_frame_energy(pcm, samples);
+    duplex_env_t *e = &g_ref_env[slot & DUPLEX_HISTORY_MASK];
+
+    /* Two frames in one slot (driver queue filling up): keep the louder */
+    if (e->slot == slot && e->energy > energy) {
+        return;
+    }
+    e->energy = energy;
+    e->slot = slot;
+}
+
+bool audio_duplex_process_mic(int16_t *pcm, uint32_t samples, uint32_t capture_ms)
+{
+    uint32_t slot = capture_ms / DUPLEX_FRAME_MS;
+    uint32_t mic_e = duplex_frame_energy(pcm, samples);
+    uint32_t target = DUPLEX_UNITY_Q15;
+    bool echo = false;
+
+    /* The learning always sees the unprocessed mic level */
+    duplex_env_t *e = &g_mic_env[slot & DUPLEX_HISTORY_MASK];
+    e->energy = mic_e;
+    e->slot = slot;
+
+    /* Near-end speech correlates with the speaker by chance, keep the
+     * learned delay until the window holds echo only */
+    if (g_double_talk_hold > 0) {
+        g_double_talk_hold--;
+    }
+    if (--g_corr_countdown == 0) {
+        g_corr_countdown = DUPLEX_CORR_INTERVAL;
+        if (!g_delay_locked || g_double_talk_hold == 0) {
+            duplex_estimate_delay(slot);
+        }
+    }
+
+    if (!g_duplex_enabled || samples == 0) {
+        g_cur_gain_q15 = DUPLEX_UNITY_Q15;
+        return false;
+    }
+
+    uint32_t ref_e = duplex_ref_energy(slot);
+    if (ref_e >= DUPLEX_REF_ACTIVE) {
+        uint32_t expected = ref_e * g_gain_q12 / DUPLEX_GAIN_ONE_Q12;
+
+        if (mic_e > expected * DUPLEX_DT_RATIO + DUPLEX_DT_MARGIN) {
+            g_double_talk_frames++;
+            g_double_talk_hold = DUPLEX_CORR_FRAMES;
+        } else {
+            echo = true;
+            target = DUPLEX_SUPPRESS_Q15;
+            g_suppressed_frames++;
+        }
+
+        /* Learn from echo frames only, against the frame at the exact delay; the
+         * widened window also sees talkspurt ends whose echo already died away */
+        uint32_t ref_at_delay = duplex_env_get(g_ref_env, slot - g_delay_frames);
+        if (echo && g_delay_locked && ref_at_delay >= DUPLEX_REF_ACTIVE) {
+            uint32_t ratio = mic_e * DUPLEX_GAIN_ONE_Q12 / ref_at_delay;
+            if (ratio < g_gain_q12) {
+                g_gain_q12 -= (g_gain_q12 - ratio) >> DUPLEX_GAIN_DOWN_SHIFT;
+            } else {
+                g_gain_q12 += (ratio - g_gain_q12) >> DUPLEX_GAIN_UP_SHIFT;
+            }
+            if (g_gain_q12 < DUPLEX_GAIN_MIN_Q12) {
+                g_gain_q12 = DUPLEX_GAIN_MIN_Q12;
+            } else if (g_gain_q12 > DUPLEX_GAIN_MAX_Q12) {
+                g_gain_q12 = DUPLEX_GAIN_MAX_Q12;
+            }
+        }
+    }
+
+    /* Ramp the gain across the frame so switching never clicks */
+    if (target != DUPLEX_UNITY_Q15 || g_cur_gain_q15 != DUPLEX_UNITY_Q15) {
+        int32_t g0 = (int32_t)g_cur_gain_q15;
+        int32_t g1 = (int32_t)target;
+
+        for (uint32_t i = 0; i < samples; i++) {
+            int32_t g = g0 + (int32_t)((int64_t)(g1 - g0) * i / samples);
+            pcm[i] = (int16_t)((pcm[i] * g) >> 15);
+        }
+        g_cur_gain_q15 = target;
+    }
+
+    return echo;
+}
+
+void audio_duplex_set_enable(bool enable)
+{
+    g_duplex_enabled = enable;
+}
+
+bool audio_duplex_get_enable(void)
+{
+    return g_duplex_enabled;
+}
+
+OPERATE_RET audio_duplex_get_stats(AUDIO_DUPLEX_STATS_T *stats)
+{
+    if (NULL == stats) {
+        return OPRT_INVALID_PARM;
+    }
+
+    stats->delay_locked = g_delay_locked;
+    stats->echo_delay_ms = g_delay_frames * DUPLEX_FRAME_MS;
+    stats->echo_gain_pct = g_gain_q12 * 100 / DUPLEX_GAIN_ONE_Q12;
+    stats->suppressed_frames = g_suppressed_frames;
+    stats->double_talk_frames = g_double_talk_frames;
+
+    return OPRT_OK;
+}
@@ -0,0 +1,88 @@
+/**
+ * @file audio_duplex.h
+ * @brief Echo control between the talk-back speaker and the mic uplink
+ *
+ * The codec's linear AEC (board cfg.aec_enable) removes most of the echo,
+ * but during talk-back the browser still hears the doorbell replaying its
+ * own voice. This module links the two streams:
+ * - The speaker playback task reports every frame it hands to the DAC
+ * - The echo delay is learned by correlating speaker and mic envelopes
+ * - Mic frames that only carry echo are attenuated, frames where the
+ *   visitor talks over the speaker (double talk) pass untouched
+ *
+ * Both sides run on their own tasks; the shared reference history is
+ * written by one task and read by the other without locking.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ */
+
+#ifndef __AUDIO_DUPLEX_H__
+#define __AUDIO_DUPLEX_H__
+
+#include "tuya_cloud_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Echo control statistics
+ */
+typedef struct {
+    bool delay_locked;            /* Echo delay learned from the signals */
+    uint32_t echo_delay_ms;       /* Speaker-to-mic delay (frame resolution) */
+    uint32_t echo_gain_pct;       /* Learned echo level, percent of the speaker level */
+    uint32_t suppressed_frames;   /* Mic frames attenuated as echo */
+    uint32_t double_talk_frames;  /* Mic frames passed while the speaker was active */
+} AUDIO_DUPLEX_STATS_T;
+
+/**
+ * @brief Reset the echo control state
+ */
+void audio_duplex_init(void);
+
+/**
+ * @brief Report one frame handed to the speaker (speaker playback task)
+ *
+ * @param pcm PCM 16-bit samples just passed to tdl_audio_play()
+ * @param samples Number of samples
+ */
+void audio_duplex_feed_ref(const int16_t *pcm, uint32_t samples);
+
+/**
+ * @brief Remove speaker echo from one mic frame in place (mic streaming task)
+ *
+ * @param pcm PCM 16-bit samples, attenuated in place when they are echo
+ * @param samples Number of samples
+ * @param capture_ms System time (ms) the frame was captured
+ * @return true if the frame was treated as echo
+ */
+bool audio_duplex_process_mic(int16_t *pcm, uint32_t samples, uint32_t capture_ms);
+
+/**
+ * @brief Enable/disable echo suppression (on by default)
+ *
+ * @param enable true to suppress echo on the mic uplink
+ */
+void audio_duplex_set_enable(bool enable);
+
+/**
+ * @brief Get the echo suppression state
+ *
+ * @return true if enabled
+ */
+bool audio_duplex_get_enable(void);
+
+/**
+ * @brief Get echo control statistics
+ *
+ * @param stats Output statistics
+ * @return OPRT_OK on success, OPRT_INVALID_PARM if stats is NULL
+ */
+OPERATE_RET audio_duplex_get_stats(AUDIO_DUPLEX_STATS_T *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __AUDIO_DUPLEX_H__ */
@@ -0,0 +1,129 @@
+/**
+ * @file audio_resample.c
+ * @brief Polyphase sample rate converter for the wideband audio streams
+ *
+ * Output sample k sits at position k * M on the L times upsampled time
+ * line. With i = pos / L and phase p = pos % L it is the dot product of
+ * phase p of the prototype with the newest taps input samples up to x[i].
+ * The prototypes sum to 1.0 in Q15, each of the L phases to about 1/L, so
+ * the result is scaled by L.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ */
+
+#include "audio_resample.h"
+#include <string.h>
+
+/***********************************************************
+***********************macro define************************
+***********************************************************/
+#define RS_RATIO_MAX    3
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+/* Kaiser (beta 7) windowed sinc, 8 zero crossings per side, cut off at
+ * 0.92 of the lower Nyquist frequency; sum 32768 */
+static const int16_t g_proto_r2[32] = {
+    -2, 12, 20, -45, -88, 93, 262, -119, -615, 28, 1240, 383, -2372, -1740, 5579, 13748,
+    13748, 5579, -1740, -2372, 383, 1240, 28, -615, -119, 262, 93, -88, -45, 20, 12, -2,
+};
+
+static const int16_t g_proto_r3[48] = {
+    -2, 2, 12, 16, -2, -43, -66, -19, 96, 181, 103, -156, -397, -321, 170, 748,
+    802, -26, -1320, -1912, -633, 2691, 6808, 9652, 9652, 6808, 2691, -633, -1912, -1320, -26, 802,
+    748, 170, -321, -397, -156, 103, 181, 96, -19, -66, -43, -2, 16, 12, 2, -2,
+};
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+
+static uint32_t rs_gcd(uint32_t a, uint32_t b)
+{
+    while (b) {
+        uint32_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+OPERATE_RET audio_resample_init(AUDIO_RESAMPLE_T *rs, uint32_t in_rate, uint32_t out_rate)
+{
+    if (rs == NULL || in_rate == 0 || out_rate == 0) {
+        return OPRT_INVALID_PARM;
+    }
+
+    uint32_t g = rs_gcd(in_rate, out_rate);
+    uint32_t up = out_rate / g;
+    uint32_t down = in_rate / g;
+    if (up > RS_RATIO_MAX || down > RS_RATIO_MAX) {
+        return OPRT_NOT_SUPPORTED;
+    }
+
+    memset(rs, 0, sizeof(*rs));
+    rs->up = (uint8_t)up;
+    rs->down = (uint8_t)down;
+    if (up == down) {
+        return OPRT_OK;
+    }
+
+    const int16_t *proto = (up == 3 || down == 3) ? g_proto_r3 : g_proto_r2;
+    uint32_t len = (up == 3 || down == 3) ? sizeof(g_proto_r3) / sizeof(int16_t) : sizeof(g_proto_r2) / sizeof(int16_t);
+
+    /* coef[p][taps - 1 - j] = h[p + j * L]: a forward dot product over the history */
+    rs->taps = (uint8_t)(len / up);
+    for (uint32_t p = 0; p < up; p++) {
+        for (uint32_t j = 0; j < rs->taps; j++) {
+            rs->coef[p * rs->taps + rs->taps - 1 - j] = proto[p + j * up];
+        }
+    }
+    return OPRT_OK;
+}
+
+void audio_resample_reset(AUDIO_RESAMPLE_T *rs)
+{
+    rs->pos = 0;
+    memset(rs->buf, 0, sizeof(rs->buf));
+}
+
+uint32_t audio_resample_process(AUDIO_RESAMPLE_T *rs, const int16_t *in, uint32_t samples, int16_t *out,
+                                uint32_t out_max)
+{
+    uint32_t produced = 0;
+
+    if (rs->up == rs->down) {
+        produced = (samples < out_max) ? samples : out_max;
+        memcpy(out, in, produced * sizeof(int16_t));
+        return produced;
+    }
+
+    const uint32_t hist = rs->taps - 1u;
+    while (samples > 0) {
+        uint32_t n = (samples < AUDIO_RESAMPLE_CHUNK) ? samples : AUDIO_RESAMPLE_CHUNK;
+        uint32_t span = n * rs->up;
+
+        memcpy(&rs->buf[hist], in, n * sizeof(int16_t));
+        while (rs->pos < span) {
+            const int16_t *c = &rs->coef[(rs->pos % rs->up) * rs->taps];
+            const int16_t *x = &rs->buf[rs->pos / rs->up];
+            int32_t acc = 0;
+
+            for (uint32_t j = 0; j < rs->taps; j++) {
+                acc += (int32_t)c[j] * x[j];
+            }
+            acc = ((acc + (1 << 14)) >> 15) * rs->up;
+            if (produced < out_max) {
+                out[produced++] = (int16_t)((acc > 32767) ? 32767 : (acc < -32768) ? -32768 : acc);
+            }
+            rs->pos += rs->down;
+        }
+        rs->pos -= span;
+        memmove(rs->buf, &rs->buf[n], hist * sizeof(int16_t));
+
+        in += n;
+        samples -= n;
+    }
+    return produced;
+}
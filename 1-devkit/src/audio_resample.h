@@ -0,0 +1,91 @@
+/**
+ * @file audio_resample.h
+ * @brief Polyphase sample rate converter for the wideband audio streams
+ *
+ * Converts 16-bit mono PCM by a rational ratio L/M (up to 3/1 .. 1/3), such
+ * as 16 <-> 24 <-> 48 kHz, so the streams can run at the rate Opus and
+ * WebRTC use while the codec keeps its native rate:
+ * - One Kaiser windowed sinc prototype per max(L, M), cut off just below the
+ *   lower Nyquist frequency, split into L phases of up to
+ *   AUDIO_RESAMPLE_TAPS_MAX taps
+ * - Only the output samples are computed (no zero stuffing), integer math
+ * - State carries over between calls, so 20ms frames convert seamlessly and
+ *   every frame gives exactly samples * L / M outputs
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ */
+
+#ifndef __AUDIO_RESAMPLE_H__
+#define __AUDIO_RESAMPLE_H__
+
+#include "tuya_cloud_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Longest phase: the 1/3 decimator */
+#define AUDIO_RESAMPLE_TAPS_MAX     48
+
+/* Input samples staged per round, bounds the state size */
+#define AUDIO_RESAMPLE_CHUNK        160
+
+/**
+ * @brief Converter state, one per stream
+ */
+typedef struct {
+    uint8_t up;                 /* L, 1 with up == down is a plain copy */
+    uint8_t down;               /* M */
+    uint8_t taps;               /* Taps per phase */
+    uint32_t pos;               /* Upsampled position of the next output in the staged chunk */
+    int16_t coef[AUDIO_RESAMPLE_TAPS_MAX];  /* Phase major, reversed, Q15 */
+    int16_t buf[AUDIO_RESAMPLE_TAPS_MAX - 1 + AUDIO_RESAMPLE_CHUNK];
+} AUDIO_RESAMPLE_T;
+
+/**
+ * @brief Set up a converter (also resets it)
+ *
+ * @param rs Converter state
+ * @param in_rate Input rate in Hz
+ * @param out_rate Output rate in Hz
+ * @return OPRT_OK on success, OPRT_NOT_SUPPORTED if L or M would exceed 3
+ */
+OPERATE_RET audio_resample_init(AUDIO_RESAMPLE_T *rs, uint32_t in_rate, uint32_t out_rate);
+
+/**
+ * @brief Clear the history, e.g. when a stream restarts
+ *
+ * @param rs Converter state
+ */
+void audio_resample_reset(AUDIO_RESAMPLE_T *rs);
+
+/**
+ * @brief Convert a block of samples
+ *
+ * @param rs Converter state
+ * @param in Input samples
+ * @param samples Number of input samples
+ * @param out Output, room for samples * L / M + 1 samples
+ * @param out_max Size of out in samples, extra output is discarded
+ * @return Number of output samples
+ */
+uint32_t audio_resample_process(AUDIO_RESAMPLE_T *rs, const int16_t *in, uint32_t samples, int16_t *out,
+                                uint32_t out_max);
+
+/**
+ * @brief Samples in one frame of the given duration
+ *
+ * @param rate Rate in Hz
+ * @param ms Frame duration
+ * @return Samples per frame
+ */
+static inline uint32_t audio_frame_samples(uint32_t rate, uint32_t ms)
+{
+    return rate * ms / 1000;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __AUDIO_RESAMPLE_H__ */
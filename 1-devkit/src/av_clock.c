@@ -0,0 +1,21 @@
+/**
+ * @file av_clock.c
+ * @brief Monotonic microsecond media clock of the DevKit
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ */
+
+#include "av_clock.h"
+#include "tal_api.h"
+#if AV_CLOCK_NATIVE_US
+#include "tkl_system.h"
+#endif
+
+uint64_t av_clock_now_us(void)
+{
+#if AV_CLOCK_NATIVE_US
+    return tkl_system_get_microsecond();
+#else
+    return (uint64_t)tal_system_get_millisecond() * 1000;
+#endif
+}
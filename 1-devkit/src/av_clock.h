@@ -0,0 +1,55 @@
+/**
+ * @file av_clock.h
+ * @brief Monotonic microsecond media clock of the DevKit
+ *
+ * The one clock the server lines streams up against: mic capture
+ * timestamps (udp_audio.h) and the "tsync" offset probes on the control
+ * connection (tcp_client.h) both read it. On the wire only its low 32
+ * bits are sent, wrapping every ~71.6 minutes like an RTP timestamp.
+ *
+ * Uses tkl_system_get_microsecond() where the port provides it
+ * (AV_CLOCK_NATIVE_US, on with ENABLE_TAL_TRACE), else the millisecond
+ * tick scaled to microseconds.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ */
+
+#ifndef __AV_CLOCK_H__
+#define __AV_CLOCK_H__
+
+#include "tuya_cloud_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef AV_CLOCK_NATIVE_US
+#if defined(ENABLE_TAL_TRACE) && (ENABLE_TAL_TRACE == 1)
+#define AV_CLOCK_NATIVE_US  1
+#else
+#define AV_CLOCK_NATIVE_US  0
+#endif
+#endif
+
+/**
+ * @brief Current media clock time
+ *
+ * @return Microseconds since boot
+ */
+uint64_t av_clock_now_us(void);
+
+/**
+ * @brief Current media clock time as sent on the wire
+ *
+ * @return Low 32 bits of av_clock_now_us()
+ */
+static inline uint32_t av_clock_now_us32(void)
+{
+    return (uint32_t)av_clock_now_us();
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __AV_CLOCK_H__ */
@@ -17,6 +17,7 @@
 #include "cJSON.h"
 #include <string.h>
 #include <stdio.h>
+#include <stddef.h>
 
 /* WiFi direct connect API */
 #include "tkl_wifi.h"
@@ -30,6 +31,139 @@
 /* TCP client for connection status */
 #include "tcp_client.h"
 
+/***********************************************************
+ * Configuration Record
+ *
+ * TCP and WiFi settings are kept in one serialized KV record, so any
+ * combination of them is committed with a single flash write. Devices
+ * provisioned before the record existed still have one key per setting;
+ * those are read as a fallback and removed on the first commit.
+ ***********************************************************/
+
+typedef struct {
+    char host[64];
+    uint16_t port;
+    char token[64];
+    char ssid[33];
+    char password[65];
+} ble_config_record_t;
+
+#define CONFIG_RECORD_FIELDS 5
+
+/* Legacy per-setting keys are still on flash */
+static bool g_legacy_keys = false;
+
+static void config_record_db(ble_config_record_t *rec, kv_db_t *db, bool store)
+{
+    /* Free-form strings are KV_RAW: a password may contain any character,
+     * and records from the older JSON format hold them base64 encoded */
+    db[0] = (kv_db_t){"host", KV_RAW, rec->host, store ? strlen(rec->host) : sizeof(rec->host) - 1};
+    db[1] = (kv_db_t){"port", KV_USHORT, &rec->port, sizeof(rec->port)};
+    db[2] = (kv_db_t){"token", KV_RAW, rec->token, store ? strlen(rec->token) : sizeof(rec->token) - 1};
+    db[3] = (kv_db_t){"ssid", KV_RAW, rec->ssid, store ? strlen(rec->ssid) : sizeof(rec->ssid) - 1};
+    db[4] = (kv_db_t){"passwd", KV_RAW, rec->password, store ? strlen(rec->password) : sizeof(rec->password) - 1};
+}
+
+static void legacy_get_string(const char *key, char *out, size_t size)
+{
+    uint8_t *value = NULL;
+    size_t len = 0;
+
+    if (tal_kv_get(key, &value, &len) == OPRT_OK && value) {
+        if (len > 0 && len < size) {
+            memcpy(out, value, len);
+            out[len] = '\0';
+        }
+        tal_kv_free(value);
+    }
+}
+
+/**
+ * @brief Load the configuration record
+ *
+ * @return OPRT_OK if any setting was found, OPRT_NOT_FOUND otherwise
+ */
+static OPERATE_RET config_record_load(ble_config_record_t *rec)
+{
+    kv_db_t db[CONFIG_RECORD_FIELDS];
+
+    memset(rec, 0, sizeof(*rec));
+    config_record_db(rec, db, false);
+    if (tal_kv_get_multi(KV_DEVICE_CONFIG, db, CONFIG_RECORD_FIELDS) == OPRT_OK) {
+        return (rec->host[0] || rec->ssid[0]) ? OPRT_OK : OPRT_NOT_FOUND;
+    }
+
+    /* Fall back to the per-setting keys */
+    memset(rec, 0, sizeof(*rec));
+    legacy_get_string(KV_TCP_SERVER_HOST, rec->host, sizeof(rec->host));
+    legacy_get_string(KV_TCP_AUTH_TOKEN, rec->token, sizeof(rec->token));
+    legacy_get_string("wifi_ssid", rec->ssid, sizeof(rec->ssid));
+    legacy_get_string("wifi_passwd", rec->password, sizeof(rec->password));
+
+    uint8_t *value = NULL;
+    size_t len = 0;
+    if (tal_kv_get(KV_TCP_SERVER_PORT, &value, &len) == OPRT_OK && value) {
+        if (len == sizeof(uint16_t)) {
+            memcpy(&rec->port, value, sizeof(uint16_t));
+        }
+        tal_kv_free(value);
+    }
+
+    if (!rec->host[0] && !rec->ssid[0]) {
+        return OPRT_NOT_FOUND;
+    }
+    g_legacy_keys = true;
+    return OPRT_OK;
+}
+
+/**
+ * @brief Commit the configuration record with one KV write
+ */
+static OPERATE_RET config_record_store(ble_config_record_t *rec)
+{
+    kv_db_t db[CONFIG_RECORD_FIELDS];
+
+    config_record_db(rec, db, true);
+    OPERATE_RET rt = tal_kv_set_multi(KV_DEVICE_CONFIG, db, CONFIG_RECORD_FIELDS);
+    if (rt != OPRT_OK) {
+        PR_ERR("Failed to save config record: %d", rt);
+        return rt;
+    }
+
+    if (g_legacy_keys) {
+        tal_kv_del(KV_TCP_SERVER_HOST);
+        tal_kv_del(KV_TCP_SERVER_PORT);
+        tal_kv_del(KV_TCP_AUTH_TOKEN);
+        tal_kv_del("wifi_ssid");
+        tal_kv_del("wifi_passwd");
+        g_legacy_keys = false;
+        PR_INFO("Migrated legacy config keys to %s", KV_DEVICE_CONFIG);
+    }
+    return OPRT_OK;
+}
+
+/* Tell the network modules to follow a new server, no reboot needed */
+static void ble_config_publish_tcp(const ble_config_record_t *rec)
+{
+    BLE_CONFIG_TCP_T cfg = {
+        .host = rec->host,
+        .port = rec->port ? rec->port : 5000,
+        .token = rec->token,
+    };
+    tal_event_publish(EVENT_TCP_CONFIG_CHG, &cfg);
+}
+
+/* Copy a setting into a record field, rejecting values that do not fit */
+static bool config_set_string(char *field, size_t size, const char *value)
+{
+    size_t len = strlen(value);
+    if (len >= size) {
+        return false;
+    }
+    memcpy(field, value, len + 1);
+    return true;
+}
+
 /***********************************************************
  * WiFi Direct Connection
  ***********************************************************/
@@ -39,13 +173,14 @@
  */
 static OPERATE_RET save_wifi_credentials(const char *ssid, const char *password)
 {
-    OPERATE_RET rt;
-    
-    rt = tal_kv_set("wifi_ssid", (const uint8_t *)ssid, strlen(ssid) + 1);
-    if (rt != OPRT_OK) return rt;
-    
-    rt = tal_kv_set("wifi_passwd", (const uint8_t *)password, strlen(password) + 1);
-    return rt;
+    ble_config_record_t rec;
+    config_record_load(&rec);
+
+    if (!config_set_string(rec.ssid, sizeof(rec.ssid), ssid) ||
+        !config_set_string(rec.password, sizeof(rec.password), password)) {
+        return OPRT_INVALID_PARM;
+    }
+    return config_record_store(&rec);
 }
 
 /**
@@ -90,13 +225,231 @@ OPERATE_RET ble_config_wifi_connect(const char *ssid, const char *password)
  * Commands are JSON formatted:
  * - {"cmd":"set_tcp","host":"...","port":5000,"token":"..."}
  * - {"cmd":"set_wifi","ssid":"...","password":"..."}
+ * - {"cmd":"set_config","seq":1,"host":"...","port":5000,"token":"...",
+ *    "ssid":"...","password":"..."}
  * - {"cmd":"get_status"}
+ * - {"cmd":"wifi_scan"}
  * - {"cmd":"reboot"}
  ***********************************************************/
 
 /* Channel type for our config handler - use 0 since BLE_CHANNEL_MAX is only 2 */
 #define BLE_CHANNEL_CONFIG 0
 
+static void ble_config_send_json(const char *json)
+{
+    size_t json_len = strlen(json);
+    uint8_t *resp = tal_malloc(4 + json_len);
+    if (resp) {
+        resp[0] = 0x00; resp[1] = 0x00; resp[2] = 0x00; resp[3] = BLE_CHANNEL_CONFIG;
+        memcpy(resp + 4, json, json_len);
+        tuya_ble_send(FRM_UPLINK_TRANSPARENT_REQ, 0, resp, 4 + json_len);
+        tal_free(resp);
+    }
+}
+
+/***********************************************************
+ * Streaming WiFi Scan
+ *
+ * Each access point goes out as its own small notification:
+ *   {"type":"wifi_ap","i":0,"ssid":"...","rssi":-42,"ch":6,"sec":3}
+ * strongest first, one entry per SSID. A final "wifi_list" message carries
+ * the total and the two strongest networks in the original format, so
+ * pages that wait for the single response keep working.
+ ***********************************************************/
+
+#define BLE_SCAN_MAX_AP     20
+
+static THREAD_HANDLE g_scan_thread = NULL;
+
+static void ble_config_scan_send_results(AP_IF_S *ap_info, uint32_t ap_count)
+{
+    /* Strongest first: indexes into ap_info, insertion sorted by RSSI */
+    uint8_t order[BLE_SCAN_MAX_AP];
+    uint32_t kept = 0;
+
+    for (uint32_t i = 0; i < ap_count; i++) {
+        AP_IF_S *ap = &ap_info[i];
+        if (ap->ssid[0] == '\0') {
+            continue;  /* Skip hidden networks */
+        }
+
+        /* Same SSID on several BSSIDs/channels: keep the strongest */
+        uint32_t dup = kept;
+        for (uint32_t k = 0; k < kept; k++) {
+            if (strcmp((char *)ap_info[order[k]].ssid, (char *)ap->ssid) == 0) {
+                dup = k;
+                break;
+            }
+        }
+        if (dup < kept) {
+            if (ap->rssi <= ap_info[order[dup]].rssi) {
+                continue;
+            }
+            memmove(&order[dup], &order[dup + 1], (kept - dup - 1) * sizeof(order[0]));
+            kept--;
+        }
+        if (kept == BLE_SCAN_MAX_AP) {
+            if (ap->rssi <= ap_info[order[kept - 1]].rssi) {
+                continue;
+            }
+            kept--;
+        }
+
+        uint32_t pos = kept;
+        while (pos > 0 && ap_info[order[pos - 1]].rssi < ap->rssi) {
+            order[pos] = order[pos - 1];
+            pos--;
+        }
+        order[pos] = (uint8_t)i;
+        kept++;
+    }
+
+    for (uint32_t k = 0; k < kept; k++) {
+        AP_IF_S *ap = &ap_info[order[k]];
+        cJSON *net = cJSON_CreateObject();
+        cJSON_AddStringToObject(net, "type", "wifi_ap");
+        cJSON_AddNumberToObject(net, "i", k);
+        cJSON_AddStringToObject(net, "ssid", (char *)ap->ssid);
+        cJSON_AddNumberToObject(net, "rssi", ap->rssi);
+        cJSON_AddNumberToObject(net, "ch", ap->channel);
+        cJSON_AddNumberToObject(net, "sec", ap->security);
+        char *json_str = cJSON_PrintUnformatted(net);
+        if (json_str) {
+            ble_config_send_json(json_str);
+            tal_free(json_str);
+        }
+        cJSON_Delete(net);
+    }
+
+    /* Completion message, compatible with the single-response format */
+    cJSON *resp_json = cJSON_CreateObject();
+    cJSON_AddStringToObject(resp_json, "type", "wifi_list");
+    cJSON_AddNumberToObject(resp_json, "count", kept);
+    cJSON *networks = cJSON_CreateArray();
+    for (uint32_t k = 0; k < kept && k < 2; k++) {
+        AP_IF_S *ap = &ap_info[order[k]];
+        cJSON *net = cJSON_CreateObject();
+        cJSON_AddStringToObject(net, "ssid", (char *)ap->ssid);
+        cJSON_AddNumberToObject(net, "rssi", ap->rssi);
+        cJSON_AddNumberToObject(net, "ch", ap->channel);
+        cJSON_AddItemToArray(networks, net);
+    }
+    cJSON_AddItemToObject(resp_json, "networks", networks);
+    char *json_str = cJSON_PrintUnformatted(resp_json);
+    if (json_str) {
+        ble_config_send_json(json_str);
+        tal_free(json_str);
+    }
+    cJSON_Delete(resp_json);
+
+    PR_NOTICE("WiFi scan: sent %u of %u networks", kept, ap_count);
+}
+
+static void ble_config_scan_task(void *arg)
+{
+    AP_IF_S *ap_info = NULL;
+    uint32_t ap_count = 0;
+
+    OPERATE_RET rt = tal_wifi_all_ap_scan(&ap_info, &ap_count);
+    if (rt == OPRT_OK && ap_info) {
+        PR_NOTICE("WiFi scan found %d networks", ap_count);
+        ble_config_scan_send_results(ap_info, ap_count);
+        tal_wifi_release_ap(ap_info);
+    } else {
+        PR_ERR("WiFi scan failed: %d", rt);
+        ble_config_send_json("{\"type\":\"error\",\"msg\":\"WiFi scan failed\"}");
+    }
+
+    THREAD_HANDLE self = g_scan_thread;
+    g_scan_thread = NULL;
+    tal_thread_delete(self);
+}
+
+/**
+ * @brief Apply a batch of settings in one transaction
+ *
+ * Every field is optional; the ones present are validated together and
+ * committed with a single KV write, so provisioning host, port, token and
+ * WiFi costs one BLE round trip instead of one per setting. Nothing is
+ * written if any field is invalid. When WiFi credentials are included the
+ * device connects after the commit. The optional "seq" is echoed in the
+ * reply so the page can send several batches without waiting for each ack.
+ */
+static void ble_config_apply_batch(cJSON *root)
+{
+    static const struct {
+        const char *key;
+        size_t offset;
+        size_t size;
+    } fields[] = {
+        {"host", offsetof(ble_config_record_t, host), sizeof(((ble_config_record_t *)0)->host)},
+        {"token", offsetof(ble_config_record_t, token), sizeof(((ble_config_record_t *)0)->token)},
+        {"ssid", offsetof(ble_config_record_t, ssid), sizeof(((ble_config_record_t *)0)->ssid)},
+        {"password", offsetof(ble_config_record_t, password), sizeof(((ble_config_record_t *)0)->password)},
+    };
+    ble_config_record_t rec;
+    OPERATE_RET rt = OPRT_OK;
+    int applied = 0;
+    bool wifi = false;
+
+    config_record_load(&rec);
+    ble_config_record_t prev = rec;
+
+    for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+        cJSON *item = cJSON_GetObjectItem(root, fields[i].key);
+        if (!item) {
+            continue;
+        }
+        if (!cJSON_IsString(item) ||
+            !config_set_string((char *)&rec + fields[i].offset, fields[i].size, item->valuestring)) {
+            PR_ERR("BLE config: invalid %s", fields[i].key);
+            rt = OPRT_INVALID_PARM;
+            break;
+        }
+        if (strcmp(fields[i].key, "ssid") == 0) {
+            wifi = true;
+        }
+        applied++;
+    }
+
+    cJSON *port = cJSON_GetObjectItem(root, "port");
+    if (rt == OPRT_OK && port) {
+        if (!cJSON_IsNumber(port) || port->valueint <= 0 || port->valueint > 0xFFFF) {
+            PR_ERR("BLE config: invalid port");
+            rt = OPRT_INVALID_PARM;
+        } else {
+            rec.port = (uint16_t)port->valueint;
+            applied++;
+        }
+    }
+
+    if (rt == OPRT_OK && wifi && rec.ssid[0] == '\0') {
+        rt = OPRT_INVALID_PARM;
+    }
+    if (rt == OPRT_OK && applied > 0) {
+        rt = config_record_store(&rec);
+    }
+    if (rt == OPRT_OK && rec.host[0] &&
+        (rec.port != prev.port || strcmp(rec.host, prev.host) != 0 || strcmp(rec.token, prev.token) != 0)) {
+        ble_config_publish_tcp(&rec);
+    }
+    PR_NOTICE("BLE config: batch of %d settings, rt=%d", applied, rt);
+
+    cJSON *seq = cJSON_GetObjectItem(root, "seq");
+    char ack[96];
+    snprintf(ack, sizeof(ack), "{\"type\":\"ack\",\"cmd\":\"set_config\",\"seq\":%d,\"rc\":%d,\"applied\":%d}",
+             (seq && cJSON_IsNumber(seq)) ? seq->valueint : 0, rt, (rt == OPRT_OK) ? applied : 0);
+    ble_config_send_json(ack);
+
+    if (rt == OPRT_OK && wifi) {
+        PR_NOTICE("BLE config: connecting to %s", rec.ssid);
+        rt = tkl_wifi_station_connect((const SCHAR_T *)rec.ssid, (const SCHAR_T *)rec.password);
+        if (rt != OPRT_OK) {
+            PR_ERR("WiFi connection failed: %d", rt);
+        }
+    }
+}
+
 static void ble_config_channel_handler(void *data, void *user_data)
 {
     if (!data) return;
@@ -160,6 +513,10 @@ static void ble_config_channel_handler(void *data, void *user_data)
             tuya_ble_send(FRM_UPLINK_TRANSPARENT_REQ, 0, resp, sizeof(resp));
         }
     }
+    /* Handle set_config command (batched settings) */
+    else if (strcmp(cmd->valuestring, "set_config") == 0) {
+        ble_config_apply_batch(root);
+    }
     /* Handle get_status command */
     else if (strcmp(cmd->valuestring, "get_status") == 0) {
         PR_NOTICE("BLE config: Status requested");
@@ -195,11 +552,9 @@ static void ble_config_channel_handler(void *data, void *user_data)
             
             /* For SSID, we'll use the saved SSID from KV storage */
             /* since there's no direct API to get current connected SSID */
-            uint8_t *ssid_value = NULL;
-            size_t ssid_len = 0;
-            if (tal_kv_get("wifi_ssid", &ssid_value, &ssid_len) == OPRT_OK && ssid_value) {
-                strncpy(wifi_ssid, (char *)ssid_value, sizeof(wifi_ssid) - 1);
-                tal_kv_free(ssid_value);
+            ble_config_record_t rec;
+            if (config_record_load(&rec) == OPRT_OK && rec.ssid[0]) {
+                strcpy(wifi_ssid, rec.ssid);
             } else {
                 strcpy(wifi_ssid, "Connected");  /* Fallback if not saved */
             }
@@ -323,84 +678,27 @@ static void ble_config_channel_handler(void *data, void *user_data)
             return;
         }
         
-        AP_IF_S *ap_info = NULL;
-        uint32_t ap_count = 0;
+        if (g_scan_thread) {
+            ble_config_send_json("{\"type\":\"error\",\"msg\":\"WiFi scan already running\"}");
+            cJSON_Delete(root);
+            return;
+        }
         
-        OPERATE_RET rt = tal_wifi_all_ap_scan(&ap_info, &ap_count);
-        if (rt == OPRT_OK && ap_info) {
-            PR_NOTICE("WiFi scan found %d networks", ap_count);
-            
-            /* Sort networks by RSSI (signal strength) - highest first
-             * Simple bubble sort since we only care about top 2 networks
-             */
-            for (uint32_t i = 0; i < ap_count - 1; i++) {
-                for (uint32_t j = 0; j < ap_count - i - 1; j++) {
-                    if (ap_info[j].rssi < ap_info[j + 1].rssi) {
-                        /* Swap */
-                        AP_IF_S temp = ap_info[j];
-                        ap_info[j] = ap_info[j + 1];
-                        ap_info[j + 1] = temp;
-                    }
-                }
-            }
-            
-            /* Build JSON response with WiFi list */
-            cJSON *resp_json = cJSON_CreateObject();
-            cJSON_AddStringToObject(resp_json, "type", "wifi_list");
-            cJSON *networks = cJSON_CreateArray();
-            
-            /* Limit to 2 networks to fit in BLE MTU (256 bytes)
-             * Each network entry is ~40-50 bytes, so 2 networks = ~80-100 bytes
-             * Plus JSON wrapper = ~120 bytes max (safe for BLE MTU)
-             * We sort by RSSI first and pick the strongest signals
-             */
-            uint32_t max_networks = 2;
-            uint32_t added = 0;
-            for (uint32_t i = 0; i < ap_count && added < max_networks; i++) {
-                if (strlen((char*)ap_info[i].ssid) > 0) {  /* Skip hidden networks */
-                    cJSON *net = cJSON_CreateObject();
-                    cJSON_AddStringToObject(net, "ssid", (char*)ap_info[i].ssid);
-                    cJSON_AddNumberToObject(net, "rssi", ap_info[i].rssi);
-                    cJSON_AddNumberToObject(net, "ch", ap_info[i].channel);
-                    cJSON_AddItemToArray(networks, net);
-                    added++;
-                    PR_DEBUG("Added network %d: %s (RSSI: %d)", added, ap_info[i].ssid, ap_info[i].rssi);
-                }
-            }
-            cJSON_AddItemToObject(resp_json, "networks", networks);
-            
-            char *json_str = cJSON_PrintUnformatted(resp_json);
-            if (json_str) {
-                size_t json_len = strlen(json_str);
-                PR_NOTICE("Sending WiFi list via BLE: %d bytes (%d strongest networks)", (int)json_len, added);
-                
-                /* Send via BLE transparent channel */
-                uint8_t *resp = tal_malloc(4 + json_len);
-                if (resp) {
-                    resp[0] = 0x00;  /* flags low */
-                    resp[1] = 0x00;  /* flags high */
-                    resp[2] = 0x00;  /* channel high */
-                    resp[3] = BLE_CHANNEL_CONFIG;  /* channel low */
-                    memcpy(resp + 4, json_str, json_len);
-                    tuya_ble_send(FRM_UPLINK_TRANSPARENT_REQ, 0, resp, 4 + json_len);
-                    tal_free(resp);
-                }
-                tal_free(json_str);
-            }
-            cJSON_Delete(resp_json);
-            tal_wifi_release_ap(ap_info);
+        /* Scan on its own thread so BLE events keep flowing; results are
+         * pushed one AP per notification from there */
+        THREAD_CFG_T cfg = {
+            .stackDepth = 4096,
+            .priority = THREAD_PRIO_3,
+            .thrdname = "ble_wifi_scan"
+        };
+        OPERATE_RET rt = tal_thread_create_and_start(&g_scan_thread, NULL, NULL,
+                                                     ble_config_scan_task, NULL, &cfg);
+        if (rt != OPRT_OK) {
+            PR_ERR("WiFi scan thread failed: %d", rt);
+            g_scan_thread = NULL;
+            ble_config_send_json("{\"type\":\"error\",\"msg\":\"WiFi scan failed\"}");
         } else {
-            PR_ERR("WiFi scan failed: %d", rt);
-            /* Send error response */
-            const char *err_json = "{\"type\":\"error\",\"msg\":\"WiFi scan failed\"}";
-            size_t err_len = strlen(err_json);
-            uint8_t *resp = tal_malloc(4 + err_len);
-            if (resp) {
-                resp[0] = 0x00; resp[1] = 0x00; resp[2] = 0x00; resp[3] = BLE_CHANNEL_CONFIG;
-                memcpy(resp + 4, err_json, err_len);
-                tuya_ble_send(FRM_UPLINK_TRANSPARENT_REQ, 0, resp, 4 + err_len);
-                tal_free(resp);
-            }
+            ble_config_send_json("{\"type\":\"ack\",\"msg\":\"WiFi scan started\"}");
         }
     }
     /* Handle wifi_disconnect command */
@@ -464,9 +762,7 @@ static void ble_config_channel_handler(void *data, void *user_data)
  ***********************************************************/
 OPERATE_RET ble_config_load_tcp_settings(char *host, uint16_t *port, char *token)
 {
-    OPERATE_RET rt;
-    uint8_t *value = NULL;
-    size_t len;
+    ble_config_record_t rec;
     
     if (!host || !port || !token) {
         return OPRT_INVALID_PARM;
@@ -477,48 +773,27 @@ OPERATE_RET ble_config_load_tcp_settings(char *host, uint16_t *port, char *token
     token[0] = '\0';
     *port = 5000;
     
-    /* Load host */
-    rt = tal_kv_get(KV_TCP_SERVER_HOST, &value, &len);
-    if (rt != OPRT_OK || !value) {
+    if (config_record_load(&rec) != OPRT_OK || !rec.host[0]) {
         PR_DEBUG("No saved TCP host found");
         return OPRT_NOT_FOUND;
     }
-    if (len > 0 && len < 64) {
-        memcpy(host, value, len);
-        host[len] = '\0';
-    }
-    tal_kv_free(value);
-    value = NULL;
     
-    /* Load port */
-    rt = tal_kv_get(KV_TCP_SERVER_PORT, &value, &len);
-    if (rt == OPRT_OK && value && len == sizeof(uint16_t)) {
-        *port = *(uint16_t *)value;
-    }
-    if (value) {
-        tal_kv_free(value);
-        value = NULL;
+    strcpy(host, rec.host);
+    if (rec.port) {
+        *port = rec.port;
     }
-    
-    /* Load token */
-    rt = tal_kv_get(KV_TCP_AUTH_TOKEN, &value, &len);
-    if (rt == OPRT_OK && value && len > 0 && len < 64) {
-        memcpy(token, value, len);
-        token[len] = '\0';
+    if (rec.token[0]) {
+        strcpy(token, rec.token);
     } else {
         strcpy(token, "devkit-secret-token");
     }
-    if (value) {
-        tal_kv_free(value);
-        value = NULL;
-    }
     
     return OPRT_OK;
 }
 
 OPERATE_RET ble_config_save_tcp_settings(const char *host, uint16_t port, const char *token)
 {
-    OPERATE_RET rt;
+    ble_config_record_t rec;
     
     if (!host || !token) {
         return OPRT_INVALID_PARM;
@@ -526,25 +801,24 @@ OPERATE_RET ble_config_save_tcp_settings(const char *host, uint16_t port, const
     
     PR_INFO("Saving TCP settings: host=%s, port=%d, token_len=%d", host, port, strlen(token));
     
-    rt = tal_kv_set(KV_TCP_SERVER_HOST, (const uint8_t *)host, strlen(host) + 1);
-    if (rt != OPRT_OK) {
-        PR_ERR("Failed to save host: %d", rt);
-        return rt;
-    }
-    
-    rt = tal_kv_set(KV_TCP_SERVER_PORT, (const uint8_t *)&port, sizeof(uint16_t));
-    if (rt != OPRT_OK) {
-        PR_ERR("Failed to save port: %d", rt);
-        return rt;
+    config_record_load(&rec);
+    bool changed = rec.port != port || strcmp(rec.host, host) != 0 || strcmp(rec.token, token) != 0;
+    rec.port = port;
+    if (!config_set_string(rec.host, sizeof(rec.host), host) ||
+        !config_set_string(rec.token, sizeof(rec.token), token)) {
+        PR_ERR("TCP settings too long");
+        return OPRT_INVALID_PARM;
     }
     
-    rt = tal_kv_set(KV_TCP_AUTH_TOKEN, (const uint8_t *)token, strlen(token) + 1);
+    OPERATE_RET rt = config_record_store(&rec);
     if (rt != OPRT_OK) {
-        PR_ERR("Failed to save token: %d", rt);
         return rt;
     }
     
     PR_INFO("TCP settings saved successfully");
+    if (changed) {
+        ble_config_publish_tcp(&rec);
+    }
     return OPRT_OK;
 }
 
@@ -17,11 +17,29 @@
 extern "C" {
 #endif
 
-/* KV Storage Keys for TCP Configuration */
+/* KV record holding all TCP and WiFi settings (tal_kv_serialize_set) */
+#define KV_DEVICE_CONFIG     "dev_config"
+
+/* Legacy per-setting KV keys, read as a fallback and migrated on save */
 #define KV_TCP_SERVER_HOST   "tcp_srv_host"
 #define KV_TCP_SERVER_PORT   "tcp_srv_port"
 #define KV_TCP_AUTH_TOKEN    "tcp_auth_token"
 
+/**
+ * @brief Published when saved TCP server settings change
+ *
+ * Data is a const BLE_CONFIG_TCP_T *, valid only during the callback.
+ * Subscribers move their connections to the new server in place, so a
+ * changed endpoint takes effect without a reboot.
+ */
+#define EVENT_TCP_CONFIG_CHG "tcp.cfg.chg"
+
+typedef struct {
+    const char *host;
+    uint16_t port;
+    const char *token;
+} BLE_CONFIG_TCP_T;
+
 /**
  * @brief Initialize BLE configuration handler
  * 
@@ -49,6 +67,9 @@ OPERATE_RET ble_config_load_tcp_settings(char *host, uint16_t *port, char *token
  * @param[in] port TCP server port
  * @param[in] token Authentication token
  * @return OPRT_OK on success
+ *
+ * @note Publishes EVENT_TCP_CONFIG_CHG when the settings differ from the
+ *       saved ones.
  */
 OPERATE_RET ble_config_save_tcp_settings(const char *host, uint16_t port, const char *token);
 
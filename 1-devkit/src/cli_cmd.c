@@ -27,6 +27,7 @@
 
 #include "tal_api.h"
 #include "tuya_iot.h"
+#include "tal_mempool.h"
 #include <stdlib.h>
 
 /* Audio includes for testing */
@@ -37,6 +38,9 @@
 /* BLE configuration for Web Bluetooth */
 #include "ble_config.h"
 
+/* Mic uplink statistics */
+#include "mic_streaming.h"
+
 extern void tal_kv_cmd(int argc, char *argv[]);
 extern void netmgr_cmd(int argc, char *argv[]);
 
@@ -108,6 +112,15 @@ static void mem(int argc, char *argv[])
     int free_heap = 0;
     free_heap = tal_system_get_free_heap_size();
     PR_NOTICE("cur free heap: %d", free_heap);
+    tal_mempool_dump();
+#if defined(ENABLE_MEM_PROFILE) && (ENABLE_MEM_PROFILE == 1)
+    tal_mem_profile_dump();
+#else
+    TAL_HEAP_INFO_T heap;
+    if (OPRT_OK == tal_system_get_heap_info(&heap)) {
+        PR_NOTICE("largest free block: %u frag: %u%%", heap.largest, heap.frag_pct);
+    }
+#endif
 }
 
 /**
@@ -267,6 +280,79 @@ static void wifi_connect(int argc, char *argv[])
     }
 }
 
+/**
+ * @brief Show mic streaming statistics
+ *
+ * @param argc
+ * @param argv
+ */
+static void mic_stats(int argc, char *argv[])
+{
+    MIC_STREAMING_STATS_T stats;
+
+    if (argc < 2 || 0 != strcmp(argv[1], "stats")) {
+        PR_INFO("usage: mic stats");
+        return;
+    }
+
+    mic_streaming_get_stats(&stats);
+
+    PR_NOTICE("Mic streaming: %s, codec %s", mic_streaming_is_active() ? "active" : "idle",
+              mic_streaming_codec_name(mic_streaming_get_codec()));
+    PR_NOTICE("  Captured:  %u bytes, sent %u frames, dtx %u frames", 
+              stats.bytes_captured, stats.frames_sent, stats.dtx_frames);
+    PR_NOTICE("  Ring:      high water %u bytes, %u overflows", stats.ring_high_water, stats.ring_overflows);
+    PR_NOTICE("  Bloat:     %u events, %u frames dropped", stats.bloat_events, stats.bloat_dropped_frames);
+    PR_NOTICE("  Send fail: %u", stats.send_failures);
+    PR_NOTICE("  Restarts:  %u (last recovered in %u ms)", stats.restarts, stats.restart_latency_ms);
+    PR_NOTICE("  Latency:   last %u ms, avg %u ms, max %u ms", 
+              stats.latency_last_ms, stats.latency_avg_ms, stats.latency_max_ms);
+    for (int i = 0; i < MIC_LATENCY_BUCKETS; i++) {
+        if (i < MIC_LATENCY_BUCKETS - 1) {
+            PR_NOTICE("    < %3u ms: %u", MIC_LATENCY_BUCKET_MS << i, stats.latency_hist[i]);
+        } else {
+            PR_NOTICE("    >=%3u ms: %u", MIC_LATENCY_BUCKET_MS << (i - 1), stats.latency_hist[i]);
+        }
+    }
+}
+
+/* Core clock used to turn decode time into cycles (0: report time only) */
+#ifndef MP3_BENCH_CPU_MHZ
+#if defined(PLATFORM_T5) && (PLATFORM_T5 == 1)
+#define MP3_BENCH_CPU_MHZ 480
+#else
+#define MP3_BENCH_CPU_MHZ 0
+#endif
+#endif
+
+/**
+ * @brief Benchmark the MP3 decoder on the built-in alert clip
+ *
+ * Usage: mp3bench [loops]
+ */
+static void mp3_bench(int argc, char *argv[])
+{
+    uint32_t loops = (argc > 1) ? (uint32_t)atoi(argv[1]) : 20;
+    uint32_t frames = 0, elapsed_ms = 0;
+
+    if (loops == 0) {
+        loops = 1;
+    }
+
+    OPERATE_RET rt = ai_audio_player_mp3_bench((const uint8_t *)alert_audio_data, sizeof(alert_audio_data),
+                                               loops, &frames, &elapsed_ms);
+    if (rt != OPRT_OK || frames == 0) {
+        PR_ERR("mp3bench failed: %d", rt);
+        return;
+    }
+
+    uint32_t us_per_frame = (uint32_t)(((uint64_t)elapsed_ms * 1000) / frames);
+    PR_NOTICE("mp3bench: %u frames in %u ms, %u us/frame", frames, elapsed_ms, us_per_frame);
+    if (MP3_BENCH_CPU_MHZ > 0) {
+        PR_NOTICE("mp3bench: ~%u cycles/frame at %u MHz", us_per_frame * MP3_BENCH_CPU_MHZ, MP3_BENCH_CPU_MHZ);
+    }
+}
+
 /**
  * @brief cli cmd list
  *
@@ -283,6 +369,8 @@ static cli_cmd_t s_cli_cmd[] = {
     {.name = "audio", .func = audio_test, .help = "audio test <play|stop|vol>"},
     {.name = "config", .func = config_show, .help = "show TCP config & BLE setup info"},
     {.name = "wifi_connect", .func = wifi_connect, .help = "wifi_connect <ssid> [password]"},
+    {.name = "mic", .func = mic_stats, .help = "mic stats"},
+    {.name = "mp3bench", .func = mp3_bench, .help = "mp3bench [loops]: mp3 decode time per frame"},
 };
 
 /**
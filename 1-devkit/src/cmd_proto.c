@@ -0,0 +1,221 @@
+/**
+ * @file cmd_proto.c
+ * @brief Binary opcode protocol for the TCP control channel
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ */
+
+#include "cmd_proto.h"
+#include "tcp_client.h"
+#include "tal_api.h"
+#include <string.h>
+
+/* Longest reply text, matches the text command response buffer */
+#define CMD_PROTO_MAX_TEXT 640
+
+/* Opcode jump table (reply opcodes are never dispatched) */
+static cmd_proto_handler_t g_handlers[CMD_OP_REPLY] = {0};
+
+static uint8_t *put_tlv_header(uint8_t *p, uint8_t type, uint16_t len)
+{
+    p[0] = type;
+    p[1] = (uint8_t)(len & 0xFF);
+    p[2] = (uint8_t)(len >> 8);
+    return p + CMD_PROTO_TLV_HEADER;
+}
+
+/* Check that the TLVs exactly fill the payload */
+static bool tlv_well_formed(const uint8_t *p, uint32_t len)
+{
+    while (len > 0) {
+        if (len < CMD_PROTO_TLV_HEADER) {
+            return false;
+        }
+        uint32_t vlen = (uint32_t)p[1] | ((uint32_t)p[2] << 8);
+        if (vlen > len - CMD_PROTO_TLV_HEADER) {
+            return false;
+        }
+        p += CMD_PROTO_TLV_HEADER + vlen;
+        len -= CMD_PROTO_TLV_HEADER + vlen;
+    }
+    return true;
+}
+
+OPERATE_RET cmd_proto_register(uint8_t opcode, cmd_proto_handler_t handler)
+{
+    if (opcode & CMD_OP_REPLY) {
+        return OPRT_INVALID_PARM;
+    }
+    g_handlers[opcode] = handler;
+    return OPRT_OK;
+}
+
+void cmd_proto_dispatch(const char *data, uint32_t len)
+{
+    const uint8_t *p = (const uint8_t *)data;
+
+    if (len < CMD_PROTO_HEADER_SIZE || p[0] != CMD_PROTO_MAGIC) {
+        PR_WARN("[CMD] Short binary frame (%u bytes)", len);
+        return;
+    }
+
+    uint8_t opcode = p[2];
+    if (p[1] != CMD_PROTO_VERSION) {
+        PR_WARN("[CMD] Unsupported protocol version %u", p[1]);
+        cmd_proto_reply(opcode & ~CMD_OP_REPLY, OPRT_NOT_SUPPORTED, "error:version");
+        return;
+    }
+
+    /* Replies are never expected from the server, drop them quietly */
+    if (opcode & CMD_OP_REPLY) {
+        return;
+    }
+
+    CMD_PROTO_MSG_T msg = {
+        .opcode = opcode,
+        .tlv = p + CMD_PROTO_HEADER_SIZE,
+        .tlv_len = len - CMD_PROTO_HEADER_SIZE,
+    };
+    if (!tlv_well_formed(msg.tlv, msg.tlv_len)) {
+        PR_WARN("[CMD] Malformed TLV in opcode 0x%02x", opcode);
+        cmd_proto_reply(opcode, OPRT_INVALID_PARM, "error:malformed");
+        return;
+    }
+
+    cmd_proto_handler_t handler = g_handlers[opcode];
+    if (handler == NULL) {
+        PR_WARN("[CMD] Unknown opcode 0x%02x", opcode);
+        cmd_proto_reply(opcode, OPRT_NOT_SUPPORTED, "unknown_command");
+        return;
+    }
+    handler(&msg);
+}
+
+bool cmd_proto_find_tlv(const CMD_PROTO_MSG_T *msg, uint8_t type,
+                        const uint8_t **value, uint16_t *value_len)
+{
+    const uint8_t *p = msg->tlv;
+    uint32_t left = msg->tlv_len;
+
+    /* Dispatch already checked the layout */
+    while (left >= CMD_PROTO_TLV_HEADER) {
+        uint16_t vlen = (uint16_t)(p[1] | (p[2] << 8));
+        if (p[0] == type) {
+            if (value) {
+                *value = p + CMD_PROTO_TLV_HEADER;
+            }
+            if (value_len) {
+                *value_len = vlen;
+            }
+            return true;
+        }
+        p += CMD_PROTO_TLV_HEADER + vlen;
+        left -= CMD_PROTO_TLV_HEADER + vlen;
+    }
+    return false;
+}
+
+uint32_t cmd_proto_get_uint(const CMD_PROTO_MSG_T *msg, uint8_t type, uint32_t def)
+{
+    const uint8_t *v = NULL;
+    uint16_t vlen = 0;
+
+    if (!cmd_proto_find_tlv(msg, type, &v, &vlen)) {
+        return def;
+    }
+    if (type == CMD_TLV_U8 && vlen == 1) {
+        return v[0];
+    }
+    if (type == CMD_TLV_U32 && vlen == 4) {
+        return (uint32_t)v[0] | ((uint32_t)v[1] << 8) | ((uint32_t)v[2] << 16) | ((uint32_t)v[3] << 24);
+    }
+    return def;
+}
+
+OPERATE_RET cmd_proto_reply(uint8_t opcode, OPERATE_RET status, const char *text)
+{
+    uint8_t buf[CMD_PROTO_HEADER_SIZE + CMD_PROTO_TLV_HEADER + 4 + CMD_PROTO_TLV_HEADER + CMD_PROTO_MAX_TEXT];
+    uint8_t *p = buf;
+    uint32_t st = (uint32_t)status;
+
+    *p++ = CMD_PROTO_MAGIC;
+    *p++ = CMD_PROTO_VERSION;
+    *p++ = opcode | CMD_OP_REPLY;
+
+    p = put_tlv_header(p, CMD_TLV_STATUS, 4);
+    *p++ = (uint8_t)(st & 0xFF);
+    *p++ = (uint8_t)((st >> 8) & 0xFF);
+    *p++ = (uint8_t)((st >> 16) & 0xFF);
+    *p++ = (uint8_t)(st >> 24);
+
+    if (text) {
+        size_t tlen = strlen(text);
+        if (tlen > CMD_PROTO_MAX_TEXT) {
+            tlen = CMD_PROTO_MAX_TEXT;
+        }
+        p = put_tlv_header(p, CMD_TLV_TEXT, (uint16_t)tlen);
+        memcpy(p, text, tlen);
+        p += tlen;
+    }
+
+    return tcp_client_send((const char *)buf, (uint32_t)(p - buf));
+}
+
+OPERATE_RET cmd_proto_send_uint(uint8_t opcode, uint8_t type, uint32_t value)
+{
+    uint8_t buf[CMD_PROTO_HEADER_SIZE + CMD_PROTO_TLV_HEADER + 4];
+    uint8_t *p = buf;
+    uint16_t vlen = (type == CMD_TLV_U8) ? 1 : 4;
+
+    *p++ = CMD_PROTO_MAGIC;
+    *p++ = CMD_PROTO_VERSION;
+    *p++ = opcode | CMD_OP_REPLY;
+
+    p = put_tlv_header(p, type, vlen);
+    for (uint16_t i = 0; i < vlen; i++) {
+        *p++ = (uint8_t)((value >> (8 * i)) & 0xFF);
+    }
+
+    return tcp_client_send((const char *)buf, (uint32_t)(p - buf));
+}
+
+OPERATE_RET cmd_proto_send_datagram(uint8_t stream, const uint8_t *data, uint32_t len)
+{
+    uint8_t head[CMD_PROTO_HEADER_SIZE + CMD_PROTO_TLV_HEADER + 1 + CMD_PROTO_TLV_HEADER];
+    uint8_t *p = head;
+
+    if (len > 0xFFFF) {
+        return OPRT_INVALID_PARM;
+    }
+
+    *p++ = CMD_PROTO_MAGIC;
+    *p++ = CMD_PROTO_VERSION;
+    *p++ = CMD_OP_DATAGRAM;
+    p = put_tlv_header(p, CMD_TLV_U8, 1);
+    *p++ = stream;
+    p = put_tlv_header(p, CMD_TLV_DATA, (uint16_t)len);
+
+    /* Payload is queued straight from the caller's buffer, no staging copy */
+    return tcp_client_send_datagram(head, (uint32_t)(p - head), data, len);
+}
+
+OPERATE_RET cmd_proto_send_chunk(uint8_t opcode, uint32_t value, uint8_t type, const uint8_t *data, uint32_t len)
+{
+    uint8_t head[CMD_PROTO_HEADER_SIZE + CMD_PROTO_TLV_HEADER + 4 + CMD_PROTO_TLV_HEADER];
+    uint8_t *p = head;
+
+    if (len > 0xFFFF) {
+        return OPRT_INVALID_PARM;
+    }
+
+    *p++ = CMD_PROTO_MAGIC;
+    *p++ = CMD_PROTO_VERSION;
+    *p++ = opcode | CMD_OP_REPLY;
+    p = put_tlv_header(p, CMD_TLV_U32, 4);
+    for (uint32_t i = 0; i < 4; i++) {
+        *p++ = (uint8_t)((value >> (8 * i)) & 0xFF);
+    }
+    p = put_tlv_header(p, type, (uint16_t)len);
+
+    return tcp_client_send_datagram(head, (uint32_t)(p - head), data, len);
+}
@@ -0,0 +1,192 @@
+/**
+ * @file cmd_proto.h
+ * @brief Binary opcode protocol for the TCP control channel
+ *
+ * Runs alongside the legacy text commands on the same framed TCP stream.
+ * A frame whose first byte is CMD_PROTO_MAGIC is binary, anything else is
+ * handed to the text command parser:
+ *
+ *   [MAGIC 0xB7][VERSION:1][OPCODE:1][TLV...]
+ *   TLV = [TYPE:1][LEN:2 LE][VALUE:LEN]
+ *
+ * Opcodes dispatch through a table indexed by the opcode byte, so the hot
+ * voice data path costs one lookup instead of a strncmp chain, and the
+ * payload is passed through without copying.
+ *
+ * Replies use the request opcode with CMD_OP_REPLY set and carry a
+ * CMD_TLV_STATUS (int32 OPERATE_RET) plus an optional CMD_TLV_TEXT holding
+ * the same string the text command would have answered. Unsolicited
+ * device messages (CMD_OP_VOICE_CREDIT) use the same reply form.
+ *
+ * CMD_OP_DATAGRAM multiplexes the real-time audio streams onto this
+ * connection (see udp_audio_set_mux()). Datagrams are never
+ * acknowledged and are dropped instead of queued when the uplink backs up,
+ * so they keep UDP's latency behaviour.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ */
+
+#ifndef __CMD_PROTO_H__
+#define __CMD_PROTO_H__
+
+#include "tuya_cloud_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CMD_PROTO_MAGIC        0xB7
+#define CMD_PROTO_VERSION      1
+#define CMD_PROTO_HEADER_SIZE  3    /* magic + version + opcode */
+#define CMD_PROTO_TLV_HEADER   3    /* type + 16-bit length */
+
+/* Opcodes */
+#define CMD_OP_PING            0x01
+#define CMD_OP_STATUS          0x02
+#define CMD_OP_VOICE_START     0x10 /* CMD_TLV_U32: total MP3 bytes */
+#define CMD_OP_VOICE_DATA      0x11 /* CMD_TLV_DATA: MP3 chunk, no reply */
+#define CMD_OP_VOICE_END       0x12
+#define CMD_OP_VOICE_CREDIT    0x13 /* Device to server: CMD_TLV_U32 cumulative credit */
+#define CMD_OP_MIC_ON          0x20 /* CMD_TLV_U8: MIC_CODEC_E (optional) */
+#define CMD_OP_MIC_OFF         0x21
+#define CMD_OP_SPEAKER_VOLUME  0x30 /* CMD_TLV_U8: 0-100 */
+#define CMD_OP_MIC_VOLUME      0x31 /* CMD_TLV_U8: 0-100 */
+#define CMD_OP_DATAGRAM        0x40 /* CMD_TLV_U8 stream + CMD_TLV_DATA datagram, no reply */
+#define CMD_OP_CLIP_START      0x50 /* Device to server: CMD_TLV_U32 bytes + CMD_TLV_TEXT name */
+#define CMD_OP_CLIP_DATA       0x51 /* Device to server: CMD_TLV_U32 offset + CMD_TLV_DATA chunk */
+#define CMD_OP_CLIP_END        0x52 /* Device to server: CMD_TLV_U32 bytes + CMD_TLV_TEXT name */
+#define CMD_OP_CLIP_ACK        0x53 /* CMD_TLV_TEXT name of a stored segment, no reply */
+#define CMD_OP_REPLY           0x80 /* Set on reply opcodes */
+
+/* Datagram streams: the audio normally carried on UDP, unchanged */
+#define CMD_STREAM_MIC         1    /* Device to server, a udp_audio.h datagram (port 5001) */
+#define CMD_STREAM_SPEAKER     2    /* Both ways, a speaker datagram or ping (port 5002) */
+
+/* TLV types */
+#define CMD_TLV_STATUS         0x01 /* int32 LE, OPERATE_RET */
+#define CMD_TLV_TEXT           0x02 /* UTF-8, not NUL terminated */
+#define CMD_TLV_DATA           0x03 /* Raw bytes */
+#define CMD_TLV_U8             0x04
+#define CMD_TLV_U32            0x05 /* uint32 LE */
+
+/**
+ * @brief Parsed binary command, valid only during the handler call
+ */
+typedef struct {
+    uint8_t opcode;
+    const uint8_t *tlv;            /* First TLV */
+    uint32_t tlv_len;              /* Bytes of TLV data */
+} CMD_PROTO_MSG_T;
+
+/**
+ * @brief Opcode handler
+ *
+ * @param msg Parsed command
+ */
+typedef void (*cmd_proto_handler_t)(const CMD_PROTO_MSG_T *msg);
+
+/**
+ * @brief Register the handler for an opcode (replaces any previous one)
+ *
+ * @param opcode Opcode, must not have CMD_OP_REPLY set
+ * @param handler Handler, NULL to unregister
+ * @return OPRT_OK on success, OPRT_INVALID_PARM for a reply opcode
+ */
+OPERATE_RET cmd_proto_register(uint8_t opcode, cmd_proto_handler_t handler);
+
+/**
+ * @brief Check whether a received frame is a binary command
+ *
+ * @param data Frame data
+ * @param len Frame length
+ * @return true if the frame starts with CMD_PROTO_MAGIC
+ */
+static inline bool cmd_proto_is_binary(const char *data, uint32_t len)
+{
+    return len > 0 && (uint8_t)data[0] == CMD_PROTO_MAGIC;
+}
+
+/**
+ * @brief Dispatch a binary frame to its opcode handler
+ *
+ * Malformed frames, unknown versions and unregistered opcodes are answered
+ * with an error reply.
+ *
+ * @param data Frame data (starts with CMD_PROTO_MAGIC)
+ * @param len Frame length
+ */
+void cmd_proto_dispatch(const char *data, uint32_t len);
+
+/**
+ * @brief Find a TLV in a command
+ *
+ * @param msg Parsed command
+ * @param type TLV type
+ * @param value Output: pointer to the value (can be NULL)
+ * @param value_len Output: value length (can be NULL)
+ * @return true if found
+ */
+bool cmd_proto_find_tlv(const CMD_PROTO_MSG_T *msg, uint8_t type,
+                        const uint8_t **value, uint16_t *value_len);
+
+/**
+ * @brief Read a CMD_TLV_U8 / CMD_TLV_U32 value
+ *
+ * @param msg Parsed command
+ * @param type CMD_TLV_U8 or CMD_TLV_U32
+ * @param def Returned when the TLV is missing or has the wrong size
+ * @return Value
+ */
+uint32_t cmd_proto_get_uint(const CMD_PROTO_MSG_T *msg, uint8_t type, uint32_t def);
+
+/**
+ * @brief Send a reply for a binary command
+ *
+ * @param opcode Request opcode (CMD_OP_REPLY is added)
+ * @param status Result code
+ * @param text Reply text, NULL for none
+ * @return OPRT_OK on success
+ */
+OPERATE_RET cmd_proto_reply(uint8_t opcode, OPERATE_RET status, const char *text);
+
+/**
+ * @brief Send an unsolicited message carrying one integer TLV
+ *
+ * @param opcode Message opcode (CMD_OP_REPLY is added)
+ * @param type CMD_TLV_U8 or CMD_TLV_U32
+ * @param value Value
+ * @return OPRT_OK on success
+ */
+OPERATE_RET cmd_proto_send_uint(uint8_t opcode, uint8_t type, uint32_t value);
+
+/**
+ * @brief Send one audio datagram over the control connection
+ *
+ * @param stream CMD_STREAM_MIC or CMD_STREAM_SPEAKER
+ * @param data Datagram as it would be sent on UDP
+ * @param len Datagram length
+ * @return OPRT_OK when queued, OPRT_EXCEED_UPPER_LIMIT when dropped for
+ *         congestion, OPRT_SOCK_ERR if not connected
+ */
+OPERATE_RET cmd_proto_send_datagram(uint8_t stream, const uint8_t *data, uint32_t len);
+
+/**
+ * @brief Send an unsolicited message carrying a CMD_TLV_U32 and one more TLV
+ *
+ * Like datagrams it is dropped rather than queued when the uplink backs up,
+ * so bulk transfers never delay control replies; the caller retries.
+ * @param opcode Message opcode (CMD_OP_REPLY is added)
+ * @param value Value of the CMD_TLV_U32
+ * @param type Type of the second TLV, e.g. CMD_TLV_DATA or CMD_TLV_TEXT
+ * @param data Value of the second TLV
+ * @param len Length of data, at most 0xFFFF
+ * @return OPRT_OK when queued, OPRT_EXCEED_UPPER_LIMIT when dropped for
+ *         congestion, OPRT_SOCK_ERR if not connected
+ */
+OPERATE_RET cmd_proto_send_chunk(uint8_t opcode, uint32_t value, uint8_t type, const uint8_t *data, uint32_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CMD_PROTO_H__ */
@@ -0,0 +1,454 @@
+/**
+ * @file event_clip.c
+ * @brief Event clip recorder: the audio around a doorbell press, kept on local storage
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ */
+
+#include "event_clip.h"
+#include "g711_codec.h"
+#include "cmd_proto.h"
+#include "tcp_client.h"
+#include "tal_api.h"
+#include "tal_fs.h"
+#include "tdl_audio_manage.h"
+#include "tuya_ringbuf.h"
+#include <stdio.h>
+#include <string.h>
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+#define CLIP_SAMPLE_RATE        16000
+#define CLIP_BYTES_PER_MS       (CLIP_SAMPLE_RATE * 2 / 1000)   /* PCM in the ring */
+#define CLIP_FRAME_SAMPLES      320                             /* 20ms */
+
+#define CLIP_PRE_BYTES          (EVENT_CLIP_PRE_MS * CLIP_BYTES_PER_MS)
+/* Slack over the pre-trigger window so a slow flash write loses no audio */
+#define CLIP_RING_SIZE          (CLIP_PRE_BYTES + 1000 * CLIP_BYTES_PER_MS)
+
+#define CLIP_TASK_STACK         4096
+#define CLIP_TASK_PRIO          THREAD_PRIO_3
+#define CLIP_RECORD_POLL_MS     40      /* Ring drain interval while recording */
+#define CLIP_IDLE_POLL_MS       1000
+
+#define CLIP_UPLOAD_CHUNK       1024
+#define CLIP_UPLOAD_RETRY_MS    30000   /* Wait after a failed upload */
+#define CLIP_ACK_TIMEOUT_MS     10000
+#define CLIP_SEND_TIMEOUT_MS    5000    /* Longest a chunk waits for room on the uplink */
+
+#define CLIP_NAME_LEN           16      /* "%08u.ulw", 8.3 for FAT cards */
+#define CLIP_PATH_LEN           (sizeof(EVENT_CLIP_DIR) + CLIP_NAME_LEN + 1)
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef struct {
+    bool initialized;
+    TDL_AUDIO_HANDLE_T audio_hdl;
+    TUYA_RINGBUFF_T ring;
+    SEM_HANDLE wake_sem;
+    SEM_HANDLE ack_sem;
+    THREAD_HANDLE thread;
+
+    /* Set by event_clip_trigger() from any task */
+    volatile bool trigger;
+    volatile uint8_t reason;
+    volatile SYS_TIME_T trigger_ms;
+
+    /* Recorder task only */
+    TUYA_FILE file;
+    uint8_t *wbuf;              /* EVENT_CLIP_WRITE_SIZE, also the upload read buffer */
+    uint32_t wlen;
+    uint32_t seq_next;
+    SYS_TIME_T first_trigger_ms;
+    SYS_TIME_T end_ms;
+    SYS_TIME_T retry_ms;
+
+    char ack_name[CLIP_NAME_LEN];
+    EVENT_CLIP_STATS_T stats;
+} event_clip_ctx_t;
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static event_clip_ctx_t g_clip = {0};
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+
+/**
+ * @brief Capture subscriber, runs in the audio driver context
+ *
+ * The ring overwrites its oldest audio, so it always holds the most recent
+ * window whether or not a clip is being recorded.
+ */
+static void clip_audio_frame_callback(TDL_AUDIO_HANDLE_T handle, const TDL_AUDIO_FRAME_T *frame, void *arg)
+{
+    if (frame->type != TDL_AUDIO_FRAME_FORMAT_PCM || !g_clip.ring) {
+        return;
+    }
+    tuya_ring_buff_write(g_clip.ring, frame->data, frame->len);
+}
+
+static void clip_path(char *path, uint32_t seq)
+{
+    snprintf(path, CLIP_PATH_LEN, EVENT_CLIP_DIR "/%08u.ulw", (unsigned int)seq);
+}
+
+/**
+ * @brief Find the oldest and newest segment numbers, returns the segment count
+ */
+static uint32_t clip_scan(uint32_t *oldest, uint32_t *newest)
+{
+    TUYA_DIR dir = NULL;
+    TUYA_FILEINFO info = NULL;
+    const char *name = NULL;
+    uint32_t count = 0;
+    unsigned int seq;
+
+    *oldest = UINT32_MAX;
+    *newest = 0;
+    if (tal_dir_open(EVENT_CLIP_DIR, &dir) != OPRT_OK) {
+        return 0;
+    }
+    while (tal_dir_read(dir, &info) == OPRT_OK && info) {
+        if (tal_dir_name(info, &name) != OPRT_OK || !name || sscanf(name, "%8u.ulw", &seq) != 1) {
+            continue;
+        }
+        count++;
+        if (seq < *oldest) {
+            *oldest = seq;
+        }
+        if (seq > *newest) {
+            *newest = seq;
+        }
+    }
+    tal_dir_close(dir);
+    return count;
+}
+
+/**
+ * @brief Delete the oldest segments until a new one fits in EVENT_CLIP_MAX_FILES
+ */
+static void clip_rotate(void)
+{
+    char path[CLIP_PATH_LEN];
+    uint32_t oldest, newest;
+
+    while (clip_scan(&oldest, &newest) >= EVENT_CLIP_MAX_FILES) {
+        clip_path(path, oldest);
+        if (tal_fs_remove(path) != OPRT_OK) {
+            PR_ERR("Clip: cannot remove %s", path);
+            return;
+        }
+        PR_WARN("Clip: %s dropped unsent to make room", path);
+        g_clip.stats.rotated++;
+        if (g_clip.stats.pending) {
+            g_clip.stats.pending--;
+        }
+    }
+}
+
+static void clip_close(void)
+{
+    if (g_clip.file == NULL) {
+        return;
+    }
+    if (g_clip.wlen > 0 && tal_fwrite(g_clip.wbuf, (int)g_clip.wlen, g_clip.file) != (int)g_clip.wlen) {
+        g_clip.stats.write_errors++;
+    }
+    g_clip.wlen = 0;
+    tal_fsync(g_clip.file);
+    tal_fclose(g_clip.file);
+    g_clip.file = NULL;
+    g_clip.stats.recording = false;
+    g_clip.stats.recorded++;
+    g_clip.stats.pending++;
+    PR_NOTICE("Clip: segment %u closed", (unsigned int)(g_clip.seq_next - 1));
+}
+
+static OPERATE_RET clip_open(uint8_t reason, SYS_TIME_T now)
+{
+    char path[CLIP_PATH_LEN];
+    BOOL_T exist = FALSE;
+    EVENT_CLIP_HEADER_T *hdr = (EVENT_CLIP_HEADER_T *)g_clip.wbuf;
+    uint32_t used;
+
+    if (tal_fs_is_exist(EVENT_CLIP_DIR, &exist) != OPRT_OK || !exist) {
+        tal_fs_mkdir(EVENT_CLIP_DIR);
+    }
+    clip_rotate();
+
+    clip_path(path, g_clip.seq_next);
+    g_clip.file = tal_fopen(path, "wb");
+    if (g_clip.file == NULL) {
+        PR_ERR("Clip: cannot create %s", path);
+        g_clip.stats.write_errors++;
+        return OPRT_FILE_OPEN_FAILED;
+    }
+
+    /* Keep only the pre-trigger window, the slack was for the drain */
+    used = tuya_ring_buff_used_size_get(g_clip.ring);
+    if (used > CLIP_PRE_BYTES) {
+        tuya_ring_buff_discard(g_clip.ring, used - CLIP_PRE_BYTES);
+        used = CLIP_PRE_BYTES;
+    }
+
+    /* The header starts the first write, so every write stays sector aligned */
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->magic = EVENT_CLIP_MAGIC;
+    hdr->version = EVENT_CLIP_VERSION;
+    hdr->codec = EVENT_CLIP_CODEC_ULAW;
+    hdr->reason = reason;
+    hdr->sample_rate = CLIP_SAMPLE_RATE;
+    hdr->pre_ms = used / CLIP_BYTES_PER_MS;
+    hdr->seq = g_clip.seq_next;
+    if (tal_time_check_time_sync() == OPRT_OK) {
+        hdr->start_utc = (uint32_t)tal_time_get_posix() - hdr->pre_ms / 1000;
+    }
+    g_clip.wlen = sizeof(*hdr);
+
+    g_clip.seq_next++;
+    g_clip.first_trigger_ms = now;
+    g_clip.end_ms = now + EVENT_CLIP_POST_MS;
+    g_clip.stats.recording = true;
+    PR_NOTICE("Clip: recording %s, %u ms before the trigger", path, (unsigned int)hdr->pre_ms);
+    return OPRT_OK;
+}
+
+/**
+ * @brief Move the captured audio from the ring to the segment file
+ */
+static void clip_drain(void)
+{
+    int16_t pcm[CLIP_FRAME_SAMPLES];
+
+    while (g_clip.file) {
+        uint32_t room = EVENT_CLIP_WRITE_SIZE - g_clip.wlen;
+        uint32_t samples = (room < CLIP_FRAME_SAMPLES) ? room : CLIP_FRAME_SAMPLES;
+        uint32_t got = tuya_ring_buff_read(g_clip.ring, pcm, samples * 2) / 2;
+
+        if (got == 0) {
+            return;
+        }
+        g_clip.wlen += g711_encode_ulaw(pcm, got, g_clip.wbuf + g_clip.wlen);
+
+        if (g_clip.wlen == EVENT_CLIP_WRITE_SIZE) {
+            if (tal_fwrite(g_clip.wbuf, EVENT_CLIP_WRITE_SIZE, g_clip.file) != EVENT_CLIP_WRITE_SIZE) {
+                PR_ERR("Clip: write failed, segment cut short");
+                g_clip.stats.write_errors++;
+                g_clip.wlen = 0;
+                clip_close();
+                return;
+            }
+            g_clip.wlen = 0;
+        }
+    }
+}
+
+static void clip_ack_handler(const CMD_PROTO_MSG_T *msg)
+{
+    const uint8_t *name = NULL;
+    uint16_t len = 0;
+
+    if (!cmd_proto_find_tlv(msg, CMD_TLV_TEXT, &name, &len) || len == 0 || len >= CLIP_NAME_LEN) {
+        return;
+    }
+    memcpy(g_clip.ack_name, name, len);
+    g_clip.ack_name[len] = '\0';
+    tal_semaphore_post(g_clip.ack_sem);
+}
+
+/**
+ * @brief Send one upload message, waiting for room on the uplink
+ */
+static OPERATE_RET clip_send(uint8_t opcode, uint32_t value, uint8_t type, const void *data, uint32_t len)
+{
+    SYS_TIME_T start = tal_system_get_millisecond();
+    OPERATE_RET rt;
+
+    for (;;) {
+        rt = cmd_proto_send_chunk(opcode, value, type, (const uint8_t *)data, len);
+        if (rt != OPRT_EXCEED_UPPER_LIMIT) {
+            return rt;
+        }
+        /* A new event goes first, the upload resumes from the start later */
+        if (g_clip.trigger || tal_system_get_millisecond() - start > CLIP_SEND_TIMEOUT_MS) {
+            return rt;
+        }
+        tal_system_sleep(20);
+    }
+}
+
+/**
+ * @brief Upload the oldest pending segment, deleting it once the server has it
+ */
+static OPERATE_RET clip_upload_oldest(void)
+{
+    char path[CLIP_PATH_LEN];
+    char name[CLIP_NAME_LEN];
+    uint32_t oldest, newest, offset = 0;
+    OPERATE_RET rt = OPRT_OK;
+    TUYA_FILE file;
+    int size, n;
+
+    g_clip.stats.pending = clip_scan(&oldest, &newest);
+    if (g_clip.stats.pending == 0) {
+        return OPRT_OK;
+    }
+
+    clip_path(path, oldest);
+    snprintf(name, sizeof(name), "%08u.ulw", (unsigned int)oldest);
+    size = tal_fgetsize(path);
+    file = tal_fopen(path, "rb");
+    if (file == NULL || size <= 0) {
+        if (file) {
+            tal_fclose(file);
+        }
+        /* An empty segment from a failed recording */
+        tal_fs_remove(path);
+        return OPRT_FILE_OPEN_FAILED;
+    }
+
+    PR_INFO("Clip: uploading %s, %d bytes", name, size);
+    rt = clip_send(CMD_OP_CLIP_START, (uint32_t)size, CMD_TLV_TEXT, name, strlen(name));
+    while (rt == OPRT_OK && (n = tal_fread(g_clip.wbuf, CLIP_UPLOAD_CHUNK, file)) > 0) {
+        rt = clip_send(CMD_OP_CLIP_DATA, offset, CMD_TLV_DATA, g_clip.wbuf, (uint32_t)n);
+        offset += (uint32_t)n;
+    }
+    tal_fclose(file);
+    if (rt == OPRT_OK) {
+        while (tal_semaphore_wait(g_clip.ack_sem, 0) == OPRT_OK) {
+            /* Stale acknowledgement from an earlier attempt */
+        }
+        g_clip.ack_name[0] = '\0';
+        rt = clip_send(CMD_OP_CLIP_END, offset, CMD_TLV_TEXT, name, strlen(name));
+    }
+    if (rt != OPRT_OK) {
+        return rt;
+    }
+
+    if (tal_semaphore_wait(g_clip.ack_sem, CLIP_ACK_TIMEOUT_MS) != OPRT_OK || strcmp(g_clip.ack_name, name) != 0) {
+        PR_WARN("Clip: %s not acknowledged", name);
+        return OPRT_TIMEOUT;
+    }
+
+    tal_fs_remove(path);
+    g_clip.stats.uploaded++;
+    g_clip.stats.pending--;
+    PR_NOTICE("Clip: %s uploaded", name);
+    return OPRT_OK;
+}
+
+static void clip_task(void *arg)
+{
+    (void)arg;
+
+    for (;;) {
+        tal_semaphore_wait(g_clip.wake_sem, g_clip.file ? CLIP_RECORD_POLL_MS : CLIP_IDLE_POLL_MS);
+        SYS_TIME_T now = tal_system_get_millisecond();
+
+        if (g_clip.trigger) {
+            g_clip.trigger = false;
+            if (g_clip.file == NULL) {
+                clip_open(g_clip.reason, g_clip.trigger_ms);
+            } else {
+                /* A press while recording extends the clip up to EVENT_CLIP_MAX_MS */
+                SYS_TIME_T cap = g_clip.first_trigger_ms + EVENT_CLIP_MAX_MS - EVENT_CLIP_PRE_MS;
+                SYS_TIME_T end = g_clip.trigger_ms + EVENT_CLIP_POST_MS;
+                g_clip.end_ms = (end < cap) ? end : cap;
+            }
+        }
+
+        if (g_clip.file) {
+            clip_drain();
+            if (g_clip.file && now >= g_clip.end_ms) {
+                clip_drain();
+                clip_close();
+            }
+            continue;
+        }
+
+        if (g_clip.stats.pending && now >= g_clip.retry_ms && tcp_client_is_connected()) {
+            OPERATE_RET rt = clip_upload_oldest();
+            g_clip.retry_ms = (rt == OPRT_OK) ? 0 : now + CLIP_UPLOAD_RETRY_MS;
+            if (rt == OPRT_OK && g_clip.stats.pending) {
+                tal_semaphore_post(g_clip.wake_sem);
+            }
+        }
+    }
+}
+
+OPERATE_RET event_clip_init(void)
+{
+    OPERATE_RET rt;
+    uint32_t oldest, newest;
+
+    if (g_clip.initialized) {
+        return OPRT_OK;
+    }
+
+    g_clip.wbuf = tal_malloc(EVENT_CLIP_WRITE_SIZE);
+    if (g_clip.wbuf == NULL) {
+        return OPRT_MALLOC_FAILED;
+    }
+    TUYA_CALL_ERR_GOTO(tal_semaphore_create_init(&g_clip.wake_sem, 0, 1), __ERR);
+    TUYA_CALL_ERR_GOTO(tal_semaphore_create_init(&g_clip.ack_sem, 0, 1), __ERR);
+    TUYA_CALL_ERR_GOTO(tuya_ring_buff_create(CLIP_RING_SIZE, OVERFLOW_PSRAM_COVERAGE_TYPE, &g_clip.ring), __ERR);
+
+    g_clip.stats.pending = clip_scan(&oldest, &newest);
+    g_clip.seq_next = g_clip.stats.pending ? newest + 1 : 0;
+
+    THREAD_CFG_T cfg = {
+        .stackDepth = CLIP_TASK_STACK,
+        .priority = CLIP_TASK_PRIO,
+        .thrdname = "event_clip"
+    };
+    TUYA_CALL_ERR_GOTO(tal_thread_create_and_start(&g_clip.thread, NULL, NULL, clip_task, NULL, &cfg), __ERR);
+
+    TUYA_CALL_ERR_LOG(cmd_proto_register(CMD_OP_CLIP_ACK, clip_ack_handler));
+    TUYA_CALL_ERR_GOTO(tdl_audio_find(AUDIO_CODEC_NAME, &g_clip.audio_hdl), __ERR);
+    TUYA_CALL_ERR_GOTO(tdl_audio_subscribe(g_clip.audio_hdl, clip_audio_frame_callback, NULL), __ERR);
+
+    g_clip.initialized = true;
+    PR_INFO("Event clip: %u ms pre-trigger, %u segments pending in %s", EVENT_CLIP_PRE_MS,
+            g_clip.stats.pending, EVENT_CLIP_DIR);
+    return OPRT_OK;
+
+__ERR:
+    /* The task, if started, idles on an empty ring */
+    PR_ERR("Event clip init failed: %d", rt);
+    return rt;
+}
+
+OPERATE_RET event_clip_trigger(uint8_t reason)
+{
+    if (!g_clip.initialized) {
+        return OPRT_RESOURCE_NOT_READY;
+    }
+    g_clip.reason = reason;
+    g_clip.trigger_ms = tal_system_get_millisecond();
+    g_clip.trigger = true;
+    tal_semaphore_post(g_clip.wake_sem);
+    return OPRT_OK;
+}
+
+void event_clip_kick_upload(void)
+{
+    if (!g_clip.initialized) {
+        return;
+    }
+    g_clip.retry_ms = 0;
+    tal_semaphore_post(g_clip.wake_sem);
+}
+
+OPERATE_RET event_clip_get_stats(EVENT_CLIP_STATS_T *stats)
+{
+    if (stats == NULL) {
+        return OPRT_INVALID_PARM;
+    }
+    *stats = g_clip.stats;
+    return OPRT_OK;
+}
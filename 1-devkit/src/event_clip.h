@@ -0,0 +1,133 @@
+/**
+ * @file event_clip.h
+ * @brief Event clip recorder: the audio around a doorbell press, kept on local storage
+ *
+ * The mic capture is kept in a pre-trigger ring of EVENT_CLIP_PRE_MS at all
+ * times. event_clip_trigger() writes the ring plus the next
+ * EVENT_CLIP_POST_MS as one G.711 u-law segment file under EVENT_CLIP_DIR,
+ * so the clip survives a network outage. A trigger while recording extends
+ * the clip up to EVENT_CLIP_MAX_MS.
+ *
+ * Writes are sequential and EVENT_CLIP_WRITE_SIZE bytes at aligned file
+ * offsets, only the last write of a segment is shorter. At most
+ * EVENT_CLIP_MAX_FILES segments are kept, a new one replaces the oldest even
+ * if it was never uploaded, which bounds the flash space and wear.
+ *
+ * Segment file: [clip header, little endian][u-law 16kHz mono...]
+ *
+ * Pending segments are uploaded, oldest first, whenever the TCP control
+ * connection is up and nothing is being recorded:
+ *   device -> server  CMD_OP_CLIP_START  U32 segment bytes + TEXT name
+ *                     CMD_OP_CLIP_DATA   U32 offset + DATA chunk
+ *                     CMD_OP_CLIP_END    U32 segment bytes + TEXT name
+ *   server -> device  CMD_OP_CLIP_ACK    TEXT name, the segment is deleted
+ * An upload that is cut off or not acknowledged is retried later.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ */
+
+#ifndef __EVENT_CLIP_H__
+#define __EVENT_CLIP_H__
+
+#include "tuya_cloud_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Segment directory, e.g. "/sdcard/clip" to record to an SD card */
+#ifndef EVENT_CLIP_DIR
+#define EVENT_CLIP_DIR          "/clip"
+#endif
+
+/* Audio before the trigger */
+#ifndef EVENT_CLIP_PRE_MS
+#define EVENT_CLIP_PRE_MS       5000
+#endif
+
+/* Audio after the (last) trigger */
+#ifndef EVENT_CLIP_POST_MS
+#define EVENT_CLIP_POST_MS      10000
+#endif
+
+/* Longest segment, pre-trigger audio included */
+#ifndef EVENT_CLIP_MAX_MS
+#define EVENT_CLIP_MAX_MS       30000
+#endif
+
+/* Segments kept on storage */
+#ifndef EVENT_CLIP_MAX_FILES
+#define EVENT_CLIP_MAX_FILES    8
+#endif
+
+/* Size of a file write, a multiple of the flash sector */
+#ifndef EVENT_CLIP_WRITE_SIZE
+#define EVENT_CLIP_WRITE_SIZE   4096
+#endif
+
+#define EVENT_CLIP_MAGIC        0x50494C43  /* "CLIP" */
+#define EVENT_CLIP_VERSION      1
+#define EVENT_CLIP_CODEC_ULAW   1
+
+typedef struct {
+    uint32_t magic;             /* EVENT_CLIP_MAGIC */
+    uint8_t version;            /* EVENT_CLIP_VERSION */
+    uint8_t codec;              /* EVENT_CLIP_CODEC_ULAW */
+    uint8_t reason;             /* Trigger reason given to event_clip_trigger() */
+    uint8_t reserved;
+    uint32_t sample_rate;
+    uint32_t start_utc;         /* Wall clock of the first sample, 0 if not synced */
+    uint32_t pre_ms;            /* Audio before the trigger */
+    uint32_t seq;               /* Segment number, also in the file name */
+} EVENT_CLIP_HEADER_T;
+
+typedef struct {
+    bool recording;
+    uint32_t pending;           /* Segments on storage waiting for upload */
+    uint32_t recorded;          /* Segments written since boot */
+    uint32_t uploaded;
+    uint32_t rotated;           /* Segments deleted unsent to make room */
+    uint32_t write_errors;
+} EVENT_CLIP_STATS_T;
+
+/* Trigger reasons */
+#define EVENT_CLIP_REASON_DOORBELL  1
+#define EVENT_CLIP_REASON_REMOTE    2
+
+/**
+ * @brief Start the pre-trigger ring and the recorder task
+ *
+ * Call before the audio device is opened, like mic_streaming_init().
+ *
+ * @return OPRT_OK on success
+ */
+OPERATE_RET event_clip_init(void);
+
+/**
+ * @brief Record the current event, or extend the clip being recorded
+ *
+ * Safe from any task, returns at once.
+ *
+ * @param reason EVENT_CLIP_REASON_*, stored in the segment header
+ * @return OPRT_OK on success, OPRT_RESOURCE_NOT_READY before event_clip_init()
+ */
+OPERATE_RET event_clip_trigger(uint8_t reason);
+
+/**
+ * @brief Wake the uploader, e.g. when the control connection comes up
+ */
+void event_clip_kick_upload(void);
+
+/**
+ * @brief Get the recorder counters
+ *
+ * @param stats Output
+ * @return OPRT_OK on success
+ */
+OPERATE_RET event_clip_get_stats(EVENT_CLIP_STATS_T *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __EVENT_CLIP_H__ */
@@ -3,7 +3,8 @@
  * @brief G.711 u-law (PCMU) codec implementation
  * 
  * This implements the ITU-T G.711 u-law standard for audio compression.
- * It converts 16-bit PCM audio to 8-bit u-law encoded audio.
+ * It converts 16-bit PCM audio to 8-bit u-law encoded audio. The encoder
+ * uses a 256-entry segment table instead of searching segment end points.
  * 
  * Benefits:
  * - 50% bandwidth reduction
@@ -20,37 +21,42 @@
 #define ULAW_CLIP     32635  /* Max magnitude before clipping */
 #define ULAW_MAX      0x7FFF /* Max positive value for 16-bit */
 
-/* u-law segment and quantization tables */
-static const int16_t seg_end[8] = {
-    0x3F, 0x7F, 0xFF, 0x1FF, 0x3FF, 0x7FF, 0xFFF, 0x1FFF
-};
-
-/**
- * @brief Search for the segment containing the linear value
+/*
+ * Segment (exponent) lookup, indexed by the top 8 bits of the biased
+ * 15-bit magnitude. Replaces the per-sample linear search over the
+ * segment end points: one table read instead of up to 8 compares.
  */
-static int search(int16_t val, const int16_t *table, int size)
-{
-    int i;
-    for (i = 0; i < size; i++) {
-        if (val <= table[i])
-            return i;
-    }
-    return size;
-}
+static const uint8_t seg_lut[256] = {
+    0, 0, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3,
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+    5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+    5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+    6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+    6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+    6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+    6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+    7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+    7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+    7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+    7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+    7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+    7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+    7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+    7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7
+};
 
 uint8_t g711_linear_to_ulaw(int16_t pcm)
 {
-    int16_t seg;
-    uint8_t uval;
-    int16_t mask;
-    int16_t pcm_val = pcm;
+    /* Work in int so that -32768 can be negated safely */
+    int pcm_val = pcm;
+    uint8_t sign = 0;
+    uint8_t seg;
+    uint8_t mantissa;
 
-    /* Get the sign bit */
+    /* Get the sign bit and magnitude */
     if (pcm_val < 0) {
         pcm_val = -pcm_val;
-        mask = 0x7F;
-    } else {
-        mask = 0xFF;
+        sign = 0x80;
     }
 
     /* Clip the magnitude */
@@ -60,19 +66,12 @@ uint8_t g711_linear_to_ulaw(int16_t pcm)
     /* Add bias for u-law */
     pcm_val += ULAW_BIAS;
 
-    /* Find the segment */
-    seg = search(pcm_val, seg_end, 8);
-
-    /* Combine sign, segment, and quantization bits */
-    if (seg >= 8) {
-        /* Out of range, return maximum value */
-        uval = 0x7F ^ mask;
-    } else {
-        uval = (seg << 4) | ((pcm_val >> (seg + 3)) & 0x0F);
-        uval ^= mask;
-    }
+    /* Segment from the table, quantization from the 4 bits below the leading one */
+    seg = seg_lut[(pcm_val >> 7) & 0xFF];
+    mantissa = (pcm_val >> (seg + 3)) & 0x0F;
 
-    return uval;
+    /* Combine sign, segment, and quantization bits (u-law is stored inverted) */
+    return (uint8_t)~(sign | (seg << 4) | mantissa);
 }
 
 int16_t g711_ulaw_to_linear(uint8_t ulaw)
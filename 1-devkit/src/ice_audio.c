@@ -0,0 +1,470 @@
+/**
+ * @file ice_audio.c
+ * @brief Peer-to-peer mic uplink negotiated with ICE
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ */
+
+#include "ice_audio.h"
+#include "tcp_client.h"
+#include "tal_api.h"
+#include <stdio.h>
+#include <string.h>
+
+#if defined(ENABLE_TUYA_P2P) && (ENABLE_TUYA_P2P == 1)
+#include "pj_ice.h"
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+/* Longest the worker blocks on its queue before running the ICE timers */
+#define ICE_AUDIO_POLL_MS       10
+
+#define ICE_AUDIO_UFRAG_LEN     8
+#define ICE_AUDIO_PWD_LEN       24
+#define ICE_AUDIO_CRED_MAX      64
+#define ICE_AUDIO_CAND_LINE_MAX 160
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef enum {
+    ICE_MSG_TX = 0,
+    ICE_MSG_REMOTE,
+    ICE_MSG_CAND,
+    ICE_MSG_END,
+    ICE_MSG_STOP,
+} ice_audio_msg_type_e;
+
+typedef struct {
+    uint8_t type;
+    uint16_t len;
+    uint8_t *data;          /* tal_malloc() copy, NUL terminated, freed by the worker */
+} ice_audio_msg_t;
+
+typedef struct {
+    THREAD_HANDLE thread;
+    QUEUE_HANDLE queue;
+    volatile bool running;
+    volatile ICE_AUDIO_STATE_E state;
+    SYS_TIME_T start_ms;
+    /* Owned by the worker */
+    pj_ice_session_t *session;
+    pj_ice_session_cfg_t cfg;
+    pj_thread_desc desc;
+    char ufrag[ICE_AUDIO_UFRAG_LEN + 1];
+    char pwd[ICE_AUDIO_PWD_LEN + 1];
+    char rem_ufrag[ICE_AUDIO_CRED_MAX];
+    char rem_pwd[ICE_AUDIO_CRED_MAX];
+} ice_audio_ctx_t;
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static ice_audio_ctx_t g_ice = {0};
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+
+/**
+ * @brief Fill buf with random ice-char characters (RFC 8445)
+ */
+static void ice_audio_random_str(char *buf, uint32_t len)
+{
+    static const char chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    for (uint32_t i = 0; i < len; i++) {
+        buf[i] = chars[tal_system_get_random(sizeof(chars) - 1)];
+    }
+    buf[len] = '\0';
+}
+
+static void ice_audio_fail(const char *reason)
+{
+    if (g_ice.state == ICE_AUDIO_FAILED) {
+        return;
+    }
+    PR_WARN("ICE audio failed: %s, staying on the relay", reason);
+    g_ice.state = ICE_AUDIO_FAILED;
+    g_ice.running = false;
+    tcp_client_send_str("ice:failed");
+}
+
+static void ice_audio_on_rx_data(pj_ice_strans *ice_st, unsigned comp_id, void *buffer, pj_size_t size,
+                                 const pj_sockaddr_t *src_addr, unsigned src_addr_len)
+{
+    /* Uplink only, the talk-back audio still comes through the relay */
+}
+
+static void ice_audio_on_new_candidate(pj_ice_strans *ice_st, const pj_ice_sess_cand *cand, pj_bool_t last)
+{
+    char line[ICE_AUDIO_CAND_LINE_MAX];
+    char msg[ICE_AUDIO_CAND_LINE_MAX + 16];
+
+    if (cand != NULL && print_cand(line, sizeof(line), cand) > 0) {
+        /* "a=candidate:...\r\n" -> "ice:cand candidate:..." */
+        line[strcspn(line, "\r\n")] = '\0';
+        snprintf(msg, sizeof(msg), "ice:cand %s", line + 2);
+        tcp_client_send_str(msg);
+    }
+    if (last) {
+        tcp_client_send_str("ice:cand_end");
+    }
+}
+
+static void ice_audio_on_ice_complete(pj_ice_strans *ice_st, pj_ice_strans_op op, pj_status_t status)
+{
+    if (op == PJ_ICE_STRANS_OP_INIT) {
+        if (status != PJ_SUCCESS) {
+            ice_audio_fail("candidate gathering");
+        }
+    } else if (op == PJ_ICE_STRANS_OP_NEGOTIATION) {
+        if (status == PJ_SUCCESS) {
+            g_ice.state = ICE_AUDIO_CONNECTED;
+            PR_NOTICE("ICE audio connected in %u ms, uplink goes peer to peer",
+                      (uint32_t)(tal_system_get_millisecond() - g_ice.start_ms));
+            tcp_client_send_str("ice:connected");
+        } else {
+            ice_audio_fail("connectivity checks");
+        }
+    }
+}
+
+static void ice_audio_add_remote(unsigned cnt, pj_ice_sess_cand *cand, pj_bool_t end)
+{
+    pj_str_t ufrag = pj_str(g_ice.rem_ufrag);
+    pj_str_t pwd = pj_str(g_ice.rem_pwd);
+
+    if (!pj_ice_session_add_remote_candidate(g_ice.session, &ufrag, &pwd, cnt, cand, end)) {
+        PR_WARN("ICE audio: peer candidates rejected");
+    }
+}
+
+static void ice_audio_handle_msg(ice_audio_msg_t *msg)
+{
+    char *text = (char *)msg->data;
+
+    switch (msg->type) {
+    case ICE_MSG_TX:
+        if (g_ice.state == ICE_AUDIO_CONNECTED) {
+            pj_ice_session_sendto(g_ice.session, msg->data, msg->len);
+        }
+        break;
+    case ICE_MSG_REMOTE:
+        if (sscanf(text, "%63s %63s", g_ice.rem_ufrag, g_ice.rem_pwd) != 2) {
+            g_ice.rem_ufrag[0] = '\0';
+            PR_WARN("ICE audio: bad peer credentials");
+            break;
+        }
+        if (g_ice.state == ICE_AUDIO_GATHERING) {
+            g_ice.state = ICE_AUDIO_CHECKING;
+        }
+        ice_audio_add_remote(0, NULL, PJ_FALSE);
+        break;
+    case ICE_MSG_CAND: {
+        pj_ice_sess_cand cand;
+        pj_str_t input;
+
+        if (g_ice.rem_ufrag[0] == '\0') {
+            PR_WARN("ICE audio: candidate before the peer credentials, ignored");
+            break;
+        }
+        if (strncmp(text, "a=", 2) == 0) {
+            text += 2;
+        }
+        if (strncmp(text, "candidate:", 10) == 0) {
+            text += 10;
+        }
+        input = pj_str(text);
+        /* TCP candidates fail to parse, RTCP ones are not needed with rtcp-mux */
+        if (parse_cand(NULL, &input, &cand) == 0 && cand.comp_id == 1) {
+            ice_audio_add_remote(1, &cand, PJ_FALSE);
+        }
+        break;
+    }
+    case ICE_MSG_END:
+        if (g_ice.rem_ufrag[0] != '\0') {
+            ice_audio_add_remote(0, NULL, PJ_TRUE);
+        }
+        break;
+    case ICE_MSG_STOP:
+        g_ice.running = false;
+        break;
+    default:
+        break;
+    }
+}
+
+static void ice_audio_drain(void)
+{
+    ice_audio_msg_t msg;
+
+    while (tal_queue_fetch(g_ice.queue, &msg, 0) == OPRT_OK) {
+        tal_free(msg.data);
+    }
+}
+
+/**
+ * @brief Worker owning the pjnath session, every pj call of this module runs here
+ */
+static void ice_audio_task(void *arg)
+{
+    ice_audio_msg_t msg;
+    pj_thread_t *pj_thread = NULL;
+    unsigned count;
+
+    (void)arg;
+
+    pj_init();
+    if (!pj_thread_is_registered()) {
+        pj_thread_register("ice_audio", g_ice.desc, &pj_thread);
+    }
+
+    g_ice.cfg.cb.ice_on_rx_data = ice_audio_on_rx_data;
+    g_ice.cfg.cb.ice_on_new_candidate = ice_audio_on_new_candidate;
+    g_ice.cfg.cb.ice_on_ice_complete = ice_audio_on_ice_complete;
+    g_ice.cfg.rolechar = 'd';
+    g_ice.cfg.local_ufrag = g_ice.ufrag;
+    g_ice.cfg.local_passwd = g_ice.pwd;
+    g_ice.cfg.user_data = NULL;
+
+    /* pj_ice_session_init() is a no-op while the P2P video session holds ICE, the timeout then fails it */
+    if (!pj_ice_session_create(&g_ice.cfg, &g_ice.session) ||
+        !pj_ice_session_init(g_ice.session, &g_ice.cfg)) {
+        ice_audio_fail("session setup");
+    }
+
+    while (g_ice.running) {
+        if (tal_queue_fetch(g_ice.queue, &msg, ICE_AUDIO_POLL_MS) == OPRT_OK) {
+            ice_audio_handle_msg(&msg);
+            tal_free(msg.data);
+        }
+
+        /* Run the due timers and the received STUN packets without blocking */
+        for (int i = 0; i < 4; i++) {
+            count = 0;
+            pj_ice_session_handle_events(g_ice.session, 0, &count);
+            if (count == 0) {
+                break;
+            }
+        }
+
+        if (g_ice.state != ICE_AUDIO_CONNECTED &&
+            tal_system_get_millisecond() - g_ice.start_ms > ICE_AUDIO_CONNECT_TIMEOUT_MS) {
+            ice_audio_fail("timeout");
+        }
+    }
+
+    if (g_ice.session) {
+        pj_ice_session_destroy(g_ice.session);
+        g_ice.session = NULL;
+    }
+    ice_audio_drain();
+    if (g_ice.state != ICE_AUDIO_FAILED) {
+        g_ice.state = ICE_AUDIO_IDLE;
+    }
+    PR_DEBUG("ICE audio worker exited");
+
+    THREAD_HANDLE thread = g_ice.thread;
+    g_ice.thread = NULL;
+    tal_thread_delete(thread);
+}
+
+/**
+ * @brief Queue a copy of data to the worker
+ */
+static OPERATE_RET ice_audio_post(uint8_t type, const void *data, uint32_t len, uint32_t timeout_ms)
+{
+    ice_audio_msg_t msg = {.type = type, .len = (uint16_t)len, .data = NULL};
+
+    if (!g_ice.running || g_ice.queue == NULL) {
+        return OPRT_RESOURCE_NOT_READY;
+    }
+    if (len > 0xFFFF) {
+        return OPRT_INVALID_PARM;
+    }
+
+    msg.data = tal_malloc(len + 1);
+    if (msg.data == NULL) {
+        return OPRT_MALLOC_FAILED;
+    }
+    if (len > 0) {
+        memcpy(msg.data, data, len);
+    }
+    msg.data[len] = '\0';
+
+    OPERATE_RET rt = tal_queue_post(g_ice.queue, &msg, timeout_ms);
+    if (rt != OPRT_OK) {
+        tal_free(msg.data);
+    }
+    return rt;
+}
+
+OPERATE_RET ice_audio_start(const char *servers_json)
+{
+    char msg[ICE_AUDIO_UFRAG_LEN + ICE_AUDIO_PWD_LEN + 16];
+    OPERATE_RET rt;
+
+    if (servers_json == NULL || servers_json[0] == '\0') {
+        servers_json = "[]";
+    }
+    if (strlen(servers_json) >= sizeof(g_ice.cfg.server_tokens)) {
+        return OPRT_INVALID_PARM;
+    }
+
+    ice_audio_stop();
+    if (g_ice.thread != NULL) {
+        PR_ERR("ICE audio worker did not exit");
+        return OPRT_COM_ERROR;
+    }
+
+    if (g_ice.queue == NULL) {
+        rt = tal_queue_create_init(&g_ice.queue, sizeof(ice_audio_msg_t), ICE_AUDIO_QUEUE_DEPTH);
+        if (rt != OPRT_OK) {
+            return rt;
+        }
+    }
+    /* Datagrams posted while the last session was closing */
+    ice_audio_drain();
+
+    memset(&g_ice.cfg, 0, sizeof(g_ice.cfg));
+    strcpy(g_ice.cfg.server_tokens, servers_json);
+    ice_audio_random_str(g_ice.ufrag, ICE_AUDIO_UFRAG_LEN);
+    ice_audio_random_str(g_ice.pwd, ICE_AUDIO_PWD_LEN);
+    g_ice.rem_ufrag[0] = '\0';
+    g_ice.rem_pwd[0] = '\0';
+    g_ice.start_ms = tal_system_get_millisecond();
+    g_ice.state = ICE_AUDIO_GATHERING;
+    g_ice.running = true;
+
+    THREAD_CFG_T cfg = {
+        .stackDepth = ICE_AUDIO_TASK_STACK,
+        .priority = ICE_AUDIO_TASK_PRIO,
+        .thrdname = "ice_audio"
+    };
+    rt = tal_thread_create_and_start(&g_ice.thread, NULL, NULL, ice_audio_task, NULL, &cfg);
+    if (rt != OPRT_OK) {
+        PR_ERR("Failed to create ICE audio thread: %d", rt);
+        g_ice.running = false;
+        g_ice.state = ICE_AUDIO_IDLE;
+        return rt;
+    }
+
+    snprintf(msg, sizeof(msg), "ice:local %s %s", g_ice.ufrag, g_ice.pwd);
+    tcp_client_send_str(msg);
+    PR_NOTICE("ICE audio started, ufrag %s", g_ice.ufrag);
+    return OPRT_OK;
+}
+
+OPERATE_RET ice_audio_set_remote(const char *ufrag, const char *pwd)
+{
+    char creds[2 * ICE_AUDIO_CRED_MAX];
+
+    if (ufrag == NULL || pwd == NULL || ufrag[0] == '\0' || pwd[0] == '\0') {
+        return OPRT_INVALID_PARM;
+    }
+    int n = snprintf(creds, sizeof(creds), "%s %s", ufrag, pwd);
+    if (n < 0 || n >= (int)sizeof(creds)) {
+        return OPRT_INVALID_PARM;
+    }
+    return ice_audio_post(ICE_MSG_REMOTE, creds, (uint32_t)n, 100);
+}
+
+OPERATE_RET ice_audio_add_candidate(const char *line)
+{
+    if (line == NULL) {
+        return OPRT_INVALID_PARM;
+    }
+    return ice_audio_post(ICE_MSG_CAND, line, strlen(line), 100);
+}
+
+OPERATE_RET ice_audio_end_candidates(void)
+{
+    return ice_audio_post(ICE_MSG_END, NULL, 0, 100);
+}
+
+void ice_audio_stop(void)
+{
+    if (g_ice.thread == NULL) {
+        g_ice.state = ICE_AUDIO_IDLE;
+        return;
+    }
+
+    ice_audio_post(ICE_MSG_STOP, NULL, 0, 100);
+    g_ice.running = false;
+    for (int i = 0; i < 100 && g_ice.thread != NULL; i++) {
+        tal_system_sleep(10);
+    }
+    g_ice.state = ICE_AUDIO_IDLE;
+}
+
+ICE_AUDIO_STATE_E ice_audio_get_state(void)
+{
+    return g_ice.state;
+}
+
+bool ice_audio_is_connected(void)
+{
+    return g_ice.running && g_ice.state == ICE_AUDIO_CONNECTED;
+}
+
+OPERATE_RET ice_audio_send(const uint8_t *pkt, uint32_t len)
+{
+    if (!ice_audio_is_connected()) {
+        return OPRT_RESOURCE_NOT_READY;
+    }
+    /* A full queue drops the datagram, sending it on the relay too would duplicate the stream */
+    ice_audio_post(ICE_MSG_TX, pkt, len, 0);
+    return OPRT_OK;
+}
+
+#else /* ENABLE_TUYA_P2P */
+
+OPERATE_RET ice_audio_start(const char *servers_json)
+{
+    return OPRT_NOT_SUPPORTED;
+}
+
+OPERATE_RET ice_audio_set_remote(const char *ufrag, const char *pwd)
+{
+    return OPRT_NOT_SUPPORTED;
+}
+
+OPERATE_RET ice_audio_add_candidate(const char *line)
+{
+    return OPRT_NOT_SUPPORTED;
+}
+
+OPERATE_RET ice_audio_end_candidates(void)
+{
+    return OPRT_NOT_SUPPORTED;
+}
+
+void ice_audio_stop(void)
+{
+}
+
+ICE_AUDIO_STATE_E ice_audio_get_state(void)
+{
+    return ICE_AUDIO_IDLE;
+}
+
+bool ice_audio_is_connected(void)
+{
+    return false;
+}
+
+OPERATE_RET ice_audio_send(const uint8_t *pkt, uint32_t len)
+{
+    return OPRT_NOT_SUPPORTED;
+}
+
+#endif /* ENABLE_TUYA_P2P */
+
+const char *ice_audio_state_name(ICE_AUDIO_STATE_E state)
+{
+    static const char *names[] = {"idle", "gathering", "checking", "connected", "failed"};
+
+    return (state <= ICE_AUDIO_FAILED) ? names[state] : "unknown";
+}
@@ -0,0 +1,138 @@
+/**
+ * @file ice_audio.h
+ * @brief Peer-to-peer mic uplink negotiated with ICE (needs base_ice from ENABLE_TUYA_P2P)
+ *
+ * The VPS relays every audio datagram by default, a full WAN round trip even
+ * when the browser sits on the same LAN. With an ICE session the device and
+ * the peer find a direct path (host, server reflexive or TURN relayed pair)
+ * and udp_audio sends its datagrams over it, falling back to the relay until
+ * the session connects, or for good when it fails.
+ *
+ * The TCP control connection carries the signalling, the VPS only forwards it:
+ *   server -> device   "ice start [<servers json>]"  STUN/TURN list, RTCIceServer style
+ *                      "ice remote <ufrag> <pwd>"     peer credentials, before any candidate
+ *                      "ice cand <candidate line>"    one trickled peer candidate
+ *                      "ice end"                      no more peer candidates
+ *                      "ice stop"
+ *   device -> server   "ice:local <ufrag> <pwd>"
+ *                      "ice:cand candidate:<...>"     one gathered local candidate
+ *                      "ice:cand_end"
+ *                      "ice:connected" / "ice:failed"
+ *
+ * The device always takes the controlled role, the peer nominates the pair.
+ * Only component 1 is used, so the peer must bundle with rtcp-mux. The
+ * datagrams are sent as udp_audio builds them, use "mic rtp on" for a
+ * standard RTP stream.
+ *
+ * All pjnath calls run on one worker thread: the control commands and the
+ * outgoing datagrams are queued to it, so any thread may call this API.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ */
+
+#ifndef __ICE_AUDIO_H__
+#define __ICE_AUDIO_H__
+
+#include "tuya_cloud_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* A session not connected by then is failed and audio stays on the relay */
+#ifndef ICE_AUDIO_CONNECT_TIMEOUT_MS
+#define ICE_AUDIO_CONNECT_TIMEOUT_MS    10000
+#endif
+
+/* Datagrams and commands queued to the worker, the excess is dropped */
+#ifndef ICE_AUDIO_QUEUE_DEPTH
+#define ICE_AUDIO_QUEUE_DEPTH           16
+#endif
+
+#ifndef ICE_AUDIO_TASK_STACK
+#define ICE_AUDIO_TASK_STACK            (8 * 1024)
+#endif
+
+#ifndef ICE_AUDIO_TASK_PRIO
+#define ICE_AUDIO_TASK_PRIO             THREAD_PRIO_2
+#endif
+
+typedef enum {
+    ICE_AUDIO_IDLE = 0,
+    ICE_AUDIO_GATHERING,    /* Session up, local candidates trickling out */
+    ICE_AUDIO_CHECKING,     /* Peer credentials known, connectivity checks running */
+    ICE_AUDIO_CONNECTED,    /* A pair is nominated, audio goes peer to peer */
+    ICE_AUDIO_FAILED,
+} ICE_AUDIO_STATE_E;
+
+/**
+ * @brief Start an ICE session, replacing a running one
+ *
+ * Sends "ice:local" at once, then the local candidates as they are gathered.
+ *
+ * @param servers_json JSON array of {"urls","username","credential"}, NULL for
+ *                     host candidates only (enough on a LAN)
+ * @return OPRT_OK on success, OPRT_NOT_SUPPORTED without ENABLE_TUYA_P2P
+ */
+OPERATE_RET ice_audio_start(const char *servers_json);
+
+/**
+ * @brief Set the peer ICE credentials and start the connectivity checks
+ *
+ * @param ufrag Peer ice-ufrag
+ * @param pwd   Peer ice-pwd
+ * @return OPRT_OK when queued, OPRT_RESOURCE_NOT_READY without a session
+ */
+OPERATE_RET ice_audio_set_remote(const char *ufrag, const char *pwd);
+
+/**
+ * @brief Add one trickled peer candidate
+ *
+ * @param line SDP candidate attribute, with or without the "a=" and
+ *             "candidate:" prefixes; TCP and RTCP candidates are ignored
+ * @return OPRT_OK when queued, OPRT_RESOURCE_NOT_READY without a session
+ */
+OPERATE_RET ice_audio_add_candidate(const char *line);
+
+/**
+ * @brief Tell the session the peer sent its last candidate
+ *
+ * @return OPRT_OK when queued, OPRT_RESOURCE_NOT_READY without a session
+ */
+OPERATE_RET ice_audio_end_candidates(void);
+
+/**
+ * @brief Stop the session, audio goes back to the relay
+ */
+void ice_audio_stop(void);
+
+/**
+ * @brief Get the session state
+ */
+ICE_AUDIO_STATE_E ice_audio_get_state(void);
+
+/**
+ * @brief Get the state as a short string for status replies
+ */
+const char *ice_audio_state_name(ICE_AUDIO_STATE_E state);
+
+/**
+ * @brief Check whether datagrams currently go peer to peer
+ */
+bool ice_audio_is_connected(void);
+
+/**
+ * @brief Send one datagram over the nominated pair
+ *
+ * @param pkt Datagram, copied before return
+ * @param len Datagram length
+ * @return OPRT_OK when queued or dropped on a full queue,
+ *         OPRT_RESOURCE_NOT_READY when not connected (send it on the relay)
+ */
+OPERATE_RET ice_audio_send(const uint8_t *pkt, uint32_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ICE_AUDIO_H__ */
@@ -2,8 +2,15 @@
  * @file mic_streaming.c
  * @brief Microphone audio streaming over UDP for WebRTC/Opus encoding
  * 
- * Captures audio from the onboard microphone, sends raw PCM via UDP
- * to the VPS for server-side Opus encoding and WebRTC streaming.
+ * Captures audio from the onboard microphone and sends it via UDP
+ * to the VPS for WebRTC streaming. The uplink codec is selectable:
+ * - Raw PCM: server does the Opus encoding (~256kbps)
+ * - G.711 u-law: half the bytes, negligible CPU (~128kbps)
+ * - Opus: encoded on device (~24kbps), no encoding load on the VPS
+ *
+ * The stream rate (16, 24 or 48kHz, mic_streaming_set_rate()) is
+ * independent of the capture rate: echo control and the VAD run on the
+ * captured frame, which is then resampled on the device (audio_resample.h).
  * 
  * WebRTC/Opus benefits:
  * - WebRTC jitter buffer handles packet loss
@@ -15,37 +22,66 @@
 
 #include "mic_streaming.h"
 #include "udp_audio.h"
+#include "ble_config.h"
+#include "mic_vad.h"
+#include "audio_duplex.h"
+#include "opus_codec.h"
+#include "audio_resample.h"
+#include "av_clock.h"
 #include "tal_api.h"
 #include "tdl_audio_manage.h"
 #include "tuya_ringbuf.h"
+#ifdef ENABLE_BLUETOOTH
+#include "tal_bluetooth.h"
+#endif
+#if defined(ENABLE_WIFI) && (ENABLE_WIFI == 1)
+#include "tal_wifi.h"
+#endif
 #include <string.h>
 
+/* Vendor VAD must stay off after the audio pipeline is re-opened (see tuya_main.c) */
+extern void tkl_ai_disable_vendor_vad(void);
+
 /***********************************************************
 ************************macro define************************
 ***********************************************************/
-/* Audio configuration - T5AI mic runs at 16kHz 16-bit */
-#define MIC_SAMPLE_RATE     16000
+/* Audio configuration - T5AI mic runs at 16kHz 16-bit, must match the board's audio config */
+#ifndef MIC_CAPTURE_RATE
+#define MIC_CAPTURE_RATE    16000
+#endif
 #define MIC_BITS            16
 #define MIC_CHANNELS        1
 #define MIC_FRAME_MS        20       /* 20ms frames */
 
+/* Default stream rate: 16000, 24000 or 48000 */
+#ifndef MIC_STREAM_RATE
+#define MIC_STREAM_RATE     16000
+#endif
+
+/* Raw PCM above this rate no longer fits one 20ms frame into a datagram */
+#define MIC_PCM_RATE_MAX    24000
+
 /* Frame size in samples (16kHz * 20ms = 320 samples) */
-#define MIC_FRAME_SAMPLES   320
+#define MIC_FRAME_SAMPLES   (MIC_CAPTURE_RATE * MIC_FRAME_MS / 1000)
 
 /* Frame size in bytes for PCM (320 samples * 2 bytes = 640 bytes) */
-#define MIC_FRAME_SIZE_PCM  (MIC_FRAME_SAMPLES * 2)
+#define MIC_FRAME_SIZE_PCM  (MIC_FRAME_SAMPLES * MIC_BITS / 8)
+
+/* Largest resampled frame, 20ms at 48kHz */
+#define MIC_STREAM_FRAME_MAX    (48000 * MIC_FRAME_MS / 1000)
 
 /* Ring buffer for audio data - 2 seconds buffer */
-#define MIC_RINGBUF_SIZE    (MIC_SAMPLE_RATE * 2 * 2)  /* 16kHz * 2 bytes * 2 sec = 64KB */
+#define MIC_RINGBUF_SIZE    (MIC_CAPTURE_RATE * MIC_BITS / 8 * 2)  /* 16kHz * 2 bytes * 2 sec = 64KB */
 
 /* Streaming task configuration */
 #define MIC_STREAM_TASK_STACK   4096
 #define MIC_STREAM_TASK_PRIO    THREAD_PRIO_2
-#define MIC_STREAM_INTERVAL_MS  10   /* Check every 10ms */
+#define MIC_STREAM_WAIT_MS      100  /* Max block time waiting for a frame (stop/watchdog checks) */
+#define MIC_HEARTBEAT_MS        5000 /* Heartbeat log interval */
 
 /* Audio watchdog configuration - restarts driver if silent for too long */
 #define MIC_WATCHDOG_TIMEOUT_MS 5000  /* 5 seconds without mic data triggers restart */
-#define MIC_WATCHDOG_EMPTY_COUNT (MIC_WATCHDOG_TIMEOUT_MS / MIC_STREAM_INTERVAL_MS)
+#define MIC_RESTART_BACKOFF_MAX_MS 60000 /* Retry interval cap while restarts don't help */
 
 /* UDP keepalive configuration */
 #define UDP_KEEPALIVE_INTERVAL_SEC  25   /* Send ping every 25 seconds */
@@ -54,9 +90,40 @@
 /* UDP port for audio streaming */
 #define UDP_AUDIO_PORT      5001
 
+/* Encoded payload buffer for one Opus frame */
+#define MIC_ENC_BUF_SIZE    OPUS_CODEC_MAX_FRAME_BYTES
+
+/* Rate controller thresholds (from server receiver reports) */
+#define MIC_RC_LOSS_HIGH_PCT    5     /* Step down above this loss */
+#define MIC_RC_LOSS_LOW_PCT     1     /* Clean report below this loss */
+#define MIC_RC_RTT_HIGH_MS      400   /* Step down above this RTT */
+#define MIC_RC_RTT_LOW_MS       200   /* Clean report below this RTT */
+#define MIC_RC_JITTER_HIGH_MS   60    /* Step down above this jitter */
+#define MIC_RC_UP_REPORTS       3     /* Consecutive clean reports before stepping up */
+#define MIC_RC_HOLD_MS          2000  /* Min time between two step downs */
+#define MIC_RC_FEC_MAX_LOSS_PCT 20    /* Cap for the loss hint given to Opus in-band FEC */
+
+/* VAD gating: silent frames are replaced by a comfort noise packet every
+ * MIC_VAD_SID_FRAMES frames (500ms), which also keeps the NAT mapping warm */
+#define MIC_VAD_DEFAULT_ENABLE  1
+#define MIC_VAD_SID_FRAMES      25
+
+/* Shared antenna: slow BLE down and keep WiFi awake while a session streams */
+#ifndef MIC_RADIO_COEX
+#define MIC_RADIO_COEX          1
+#endif
+
 /***********************************************************
 ***********************typedef define***********************
 ***********************************************************/
+/**
+ * @brief One step of the uplink quality ladder
+ */
+typedef struct {
+    uint32_t opus_bitrate;  /* Opus target bitrate (ignored for PCM/G.711) */
+    uint8_t batch_frames;   /* Frames per UDP datagram */
+} mic_rate_step_t;
+
 typedef struct {
     bool initialized;
     bool streaming;
@@ -64,11 +131,40 @@ typedef struct {
     TUYA_RINGBUFF_T ringbuf;
     THREAD_HANDLE stream_thread;
     THREAD_HANDLE keepalive_thread;  /* UDP keepalive thread */
+    SEM_HANDLE frame_sem;            /* Posted by the mic callback when a full frame is buffered */
+    MIC_CODEC_E codec;               /* Uplink codec for this session */
+    uint32_t stream_rate;            /* Uplink rate for this session */
+    volatile uint32_t rate_request;  /* Rate for the next session (set from the TCP task) */
+    AUDIO_RESAMPLE_T resampler;      /* Capture to stream rate, streaming task only */
+    OPUS_CODEC_ENC_HANDLE opus_enc;  /* Opus encoder (MIC_CODEC_OPUS only) */
     uint32_t total_bytes_captured;
+    uint32_t ring_high_water;    /* Most bytes buffered, for tuning the bloat threshold */
+    volatile uint32_t last_write_time;  /* Time of the last driver write into the ring */
+    volatile uint32_t last_write_us;    /* Same on av_clock, for capture timestamps */
+    uint32_t bloat_events;
+    uint32_t bloat_dropped_frames;
+    uint32_t send_failures;
+    uint32_t latency_last_ms;
+    uint32_t latency_avg_ms;
+    uint32_t latency_max_ms;
+    uint32_t latency_hist[MIC_LATENCY_BUCKETS];
     uint32_t total_frames_sent;
     uint32_t dropped_frames;
     uint32_t last_send_time;  /* Last time audio was sent (for keepalive logic) */
     uint32_t watchdog_restarts;  /* Count of automatic driver restarts */
+    uint32_t restart_latency_ms; /* Last restart: stall detection to first mic data */
+    volatile bool restarting;    /* Pipeline torn down, callback must not touch the ring */
+    volatile uint8_t rc_target_level;  /* Level requested by the rate controller */
+    uint8_t rc_applied_level;          /* Level the streaming task has applied */
+    uint8_t rc_clean_reports;          /* Consecutive clean receiver reports */
+    uint32_t rc_last_down_time;        /* Time of the last step down */
+    volatile uint8_t rc_loss_pct;      /* Loss from the latest receiver report */
+    uint8_t rc_applied_loss_pct;       /* Loss hint currently given to the Opus encoder */
+    volatile bool vad_enabled;         /* Gate silent frames (set from the TCP task) */
+    bool vad_applied;                  /* vad_enabled as last seen by the streaming task */
+    MIC_VAD_T vad;                     /* Detector state, streaming task only */
+    uint32_t vad_silent_frames;        /* Frames in the current silence period */
+    uint32_t vad_dtx_frames;           /* Frames not sent because of silence */
 } mic_streaming_ctx_t;
 
 /***********************************************************
@@ -76,22 +172,44 @@ typedef struct {
 ***********************************************************/
 static mic_streaming_ctx_t g_mic_ctx = {0};
 
+/* Opus output buffer, only touched by the streaming task */
+static uint8_t g_enc_buf[MIC_ENC_BUF_SIZE];
+
+/* Resampled frame, only touched by the streaming task */
+static int16_t g_rs_buf[MIC_STREAM_FRAME_MAX];
+
+static const char *const g_codec_names[MIC_CODEC_MAX] = {"pcm", "g711", "opus"};
+
+/* Quality ladder, level 0 is the best; lower levels trade quality and
+ * latency for fewer bytes and packets on congested uplinks */
+static const mic_rate_step_t g_rate_steps[] = {
+    {32000, 1},
+    {OPUS_CODEC_DEFAULT_BITRATE, 1},
+    {16000, 2},
+    {12000, 3},
+    {8000, 3},
+};
+#define MIC_RC_LEVELS       (sizeof(g_rate_steps) / sizeof(g_rate_steps[0]))
+#define MIC_RC_START_LEVEL  1   /* OPUS_CODEC_DEFAULT_BITRATE, no batching */
+
 
 /***********************************************************
 ***********************function define**********************
 ***********************************************************/
 
 /**
- * @brief Audio frame callback from audio driver
+ * @brief Capture subscriber of the audio device
  * 
- * Called by the audio driver when a new frame is available.
- * This runs in the audio driver's context, so we just copy
- * to the ring buffer.
+ * Called by tdl_audio for every captured frame, next to any other
+ * subscriber such as the AI input. This runs in the audio driver's
+ * context, so we just copy to the ring buffer.
  */
-static void mic_audio_frame_callback(TDL_AUDIO_FRAME_FORMAT_E type, 
-                                      TDL_AUDIO_STATUS_E status,
-                                      uint8_t *data, uint32_t len)
+static void mic_audio_frame_callback(TDL_AUDIO_HANDLE_T handle, const TDL_AUDIO_FRAME_T *frame, void *arg)
 {
+    TDL_AUDIO_FRAME_FORMAT_E type = frame->type;
+    const uint8_t *data = frame->data;
+    uint32_t len = frame->len;
+    
     static uint32_t callback_count = 0;
     callback_count++;
     
@@ -101,7 +219,7 @@ static void mic_audio_frame_callback(TDL_AUDIO_FRAME_FORMAT_E type,
                  callback_count, g_mic_ctx.streaming, type, len);
     }
     
-    if (!g_mic_ctx.streaming || !g_mic_ctx.ringbuf) {
+    if (!g_mic_ctx.streaming || !g_mic_ctx.ringbuf || g_mic_ctx.restarting) {
         return;
     }
     
@@ -112,12 +230,26 @@ static void mic_audio_frame_callback(TDL_AUDIO_FRAME_FORMAT_E type,
     
     g_mic_ctx.total_bytes_captured += len;
     
+    /* The newest sample of this frame was just captured */
+    g_mic_ctx.last_write_us = av_clock_now_us32();
+    
     /* Write to ring buffer (will drop oldest data if full with stop type) */
     uint32_t written = tuya_ring_buff_write(g_mic_ctx.ringbuf, data, len);
+    
+    uint32_t used = tuya_ring_buff_used_size_get(g_mic_ctx.ringbuf);
+    g_mic_ctx.last_write_time = tal_system_get_millisecond();
+    if (used > g_mic_ctx.ring_high_water) {
+        g_mic_ctx.ring_high_water = used;
+    }
+    
+    /* Wake the streaming task once a whole frame is ready */
+    if (used >= MIC_FRAME_SIZE_PCM) {
+        tal_semaphore_post(g_mic_ctx.frame_sem);
+    }
+    
     if (written < len) {
         g_mic_ctx.dropped_frames++;
         if (g_mic_ctx.dropped_frames % 50 == 1) {
-            uint32_t used = tuya_ring_buff_used_size_get(g_mic_ctx.ringbuf);
             PR_WARN("Ring buffer full! Dropped %u bytes (total drops: %u, used: %u)", 
                     len - written, g_mic_ctx.dropped_frames, used);
         }
@@ -157,33 +289,358 @@ static void udp_keepalive_task(void *arg)
 }
 
 /**
- * @brief Streaming task - reads PCM from ringbuf, sends via UDP for server-side encoding
+ * @brief Apply a rate controller level change (streaming task context only,
+ * the Opus encoder is not thread safe)
+ */
+static void mic_rate_apply(void)
+{
+    uint8_t level = g_mic_ctx.rc_target_level;
+    uint8_t loss_pct = g_mic_ctx.rc_loss_pct;
+    
+    /* Opus in-band FEC: only spend bits on redundancy when the server sees loss */
+    if (g_mic_ctx.codec == MIC_CODEC_OPUS && loss_pct != g_mic_ctx.rc_applied_loss_pct) {
+        if (opus_codec_encoder_set_fec(g_mic_ctx.opus_enc, loss_pct) == OPRT_OK) {
+            PR_DEBUG("Opus in-band FEC tuned for %u%% loss", loss_pct);
+        }
+        g_mic_ctx.rc_applied_loss_pct = loss_pct;
+    }
+    
+    if (level == g_mic_ctx.rc_applied_level) {
+        return;
+    }
+    
+    const mic_rate_step_t *step = &g_rate_steps[level];
+    if (g_mic_ctx.codec == MIC_CODEC_OPUS) {
+        opus_codec_encoder_set_bitrate(g_mic_ctx.opus_enc, step->opus_bitrate);
+    }
+    udp_audio_set_batch(step->batch_frames);
+    
+    PR_NOTICE("Mic rate level %u -> %u (opus %u bps, %u frame(s)/packet)",
+              g_mic_ctx.rc_applied_level, level, step->opus_bitrate, step->batch_frames);
+    g_mic_ctx.rc_applied_level = level;
+}
+
+/**
+ * @brief Step the uplink down one level, rate limited to one step per hold time
+ */
+static void mic_rate_step_down(const char *reason)
+{
+    uint32_t now = tal_system_get_millisecond();
+    
+    g_mic_ctx.rc_clean_reports = 0;
+    if (g_mic_ctx.rc_target_level + 1 >= MIC_RC_LEVELS ||
+        (now - g_mic_ctx.rc_last_down_time) < MIC_RC_HOLD_MS) {
+        return;
+    }
+    
+    g_mic_ctx.rc_last_down_time = now;
+    g_mic_ctx.rc_target_level++;
+    PR_INFO("Mic rate step down (%s) to level %u", reason, g_mic_ctx.rc_target_level);
+}
+
+/**
+ * @brief Apply the radio coexistence policy for a starting or ending session
+ *
+ * BLE config advertising and links compete with WiFi for the shared
+ * antenna, which shows up as mic bursts and talk-back underruns.
+ */
+static void mic_radio_coex(bool active)
+{
+#if MIC_RADIO_COEX
+    OPERATE_RET rt = OPRT_OK;
+#ifdef ENABLE_BLUETOOTH
+    TUYA_CALL_ERR_LOG(tal_ble_coex_set_mode(active ? TAL_BLE_COEX_MEDIA : TAL_BLE_COEX_IDLE));
+#endif
+#if defined(ENABLE_WIFI) && (ENABLE_WIFI == 1)
+    TUYA_CALL_ERR_LOG(tal_wifi_set_media_priority(active ? TRUE : FALSE));
+#endif
+    (void)rt;
+#endif
+    (void)active;
+}
+
+/**
+ * @brief Encode one PCM frame with the session codec and send it via UDP
+ */
+static OPERATE_RET mic_send_frame(const int16_t *pcm_samples, uint32_t num_samples)
+{
+    int enc_len = 0;
+
+    switch (g_mic_ctx.codec) {
+    case MIC_CODEC_G711_ULAW:
+        /* Table encoder writes straight into the UDP packet */
+        return udp_audio_send_ulaw(pcm_samples, num_samples);
+
+    case MIC_CODEC_OPUS:
+        enc_len = opus_codec_encode(g_mic_ctx.opus_enc, pcm_samples, num_samples, g_enc_buf, sizeof(g_enc_buf));
+        if (enc_len <= 0) {
+            PR_WARN("Opus encode failed: %d", enc_len);
+            return OPRT_COM_ERROR;
+        }
+        return udp_audio_send(g_enc_buf, (uint32_t)enc_len);
+
+    case MIC_CODEC_PCM:
+    default:
+        return udp_audio_send_pcm(pcm_samples, num_samples);
+    }
+}
+
+/**
+ * @brief VAD gate for one frame
+ *
+ * During silence only every MIC_VAD_SID_FRAMES-th frame goes out, as a
+ * single comfort noise byte; the others are skipped but keep their SEQ.
+ *
+ * @return true if the frame should be sent as audio
+ */
+static bool mic_vad_gate(const int16_t *pcm)
+{
+    bool enabled = g_mic_ctx.vad_enabled;
+    
+    /* Start from a fresh noise estimate whenever gating gets switched on */
+    if (enabled != g_mic_ctx.vad_applied) {
+        g_mic_ctx.vad_applied = enabled;
+        mic_vad_init(&g_mic_ctx.vad);
+        g_mic_ctx.vad_silent_frames = 0;
+    }
+    
+    if (!enabled || mic_vad_process(&g_mic_ctx.vad, pcm, MIC_FRAME_SAMPLES)) {
+        if (g_mic_ctx.vad_silent_frames >= MIC_VAD_SID_FRAMES) {
+            PR_DEBUG("Mic VAD: speech after %u silent frames", g_mic_ctx.vad_silent_frames);
+        }
+        g_mic_ctx.vad_silent_frames = 0;
+        return true;
+    }
+    
+    if (g_mic_ctx.vad_silent_frames % MIC_VAD_SID_FRAMES == 0) {
+        if (udp_audio_send_cn(mic_vad_noise_level(&g_mic_ctx.vad)) == OPRT_OK) {
+            g_mic_ctx.last_send_time = tal_system_get_millisecond();
+        }
+    } else {
+        udp_audio_skip_frame();
+    }
+    g_mic_ctx.vad_silent_frames++;
+    g_mic_ctx.vad_dtx_frames++;
+    
+    return false;
+}
+
+/* Run echo control on a frame about to be sent */
+static void mic_echo_control(int16_t *pcm)
+{
+    /* Capture time of this frame, from the latency just recorded for it */
+    audio_duplex_process_mic(pcm, MIC_FRAME_SAMPLES, tal_system_get_millisecond() - g_mic_ctx.latency_last_ms);
+}
+
+/**
+ * @brief Send the oldest frame at a stream rate other than the capture rate
+ *
+ * Always staged; the converter runs on silent frames too, so its history
+ * is current when speech starts.
+ */
+static OPERATE_RET mic_send_resampled_frame(uint8_t *wrap_buf, bool *dtx)
+{
+    uint32_t samples = 0;
+
+    tuya_ring_buff_read(g_mic_ctx.ringbuf, wrap_buf, MIC_FRAME_SIZE_PCM);
+    mic_echo_control((int16_t *)wrap_buf);
+    samples = audio_resample_process(&g_mic_ctx.resampler, (const int16_t *)wrap_buf, MIC_FRAME_SAMPLES, g_rs_buf,
+                                     MIC_STREAM_FRAME_MAX);
+    if (!mic_vad_gate((const int16_t *)wrap_buf)) {
+        *dtx = true;
+        return OPRT_OK;
+    }
+    return mic_send_frame(g_rs_buf, samples);
+}
+
+/**
+ * @brief Send the oldest frame in the ring buffer without reading it out first
+ *
+ * The frame is encoded/sent in place via tuya_ring_buff_peek_linear() and then
+ * discarded. Only a frame that wraps around the end of the ring is staged in
+ * wrap_buf, and raw PCM avoids even that by sending both halves as segments
+ * (unless the VAD needs to look at the contiguous frame).
+ *
+ * @param wrap_buf Staging buffer for a wrapped frame
+ * @param dtx Set to true if the VAD suppressed the frame
+ */
+static OPERATE_RET mic_send_ring_frame(uint8_t *wrap_buf, bool *dtx)
+{
+    OPERATE_RET rt = OPRT_OK;
+    uint8_t *frame = NULL;
+    uint32_t linear = 0;
+
+    *dtx = false;
+    if (g_mic_ctx.stream_rate != MIC_CAPTURE_RATE) {
+        return mic_send_resampled_frame(wrap_buf, dtx);
+    }
+
+    linear = tuya_ring_buff_peek_linear(g_mic_ctx.ringbuf, &frame);
+    if (linear >= MIC_FRAME_SIZE_PCM) {
+        /* Common case: whole frame is contiguous in the ring */
+        mic_echo_control((int16_t *)frame);
+        if (!mic_vad_gate((const int16_t *)frame)) {
+            *dtx = true;
+        } else if (g_mic_ctx.codec == MIC_CODEC_PCM) {
+            UDP_AUDIO_IOV_T iov = {.base = frame, .len = MIC_FRAME_SIZE_PCM};
+            rt = udp_audio_sendv(UDP_AUDIO_CODEC_PCM, &iov, 1);
+        } else {
+            rt = mic_send_frame((const int16_t *)frame, MIC_FRAME_SAMPLES);
+        }
+        tuya_ring_buff_discard(g_mic_ctx.ringbuf, MIC_FRAME_SIZE_PCM);
+        return rt;
+    }
+
+    if (g_mic_ctx.codec == MIC_CODEC_PCM && !g_mic_ctx.vad_enabled && !audio_duplex_get_enable()) {
+        /* Frame wraps: send tail and head of the ring as two segments, both
+         * stay owned by the reader until the send has copied them */
+        TUYA_RINGBUFF_SPAN_T span;
+        UDP_AUDIO_IOV_T iov[2];
+        tuya_ring_buff_read_acquire(g_mic_ctx.ringbuf, MIC_FRAME_SIZE_PCM, &span);
+        iov[0].base = span.data[0];
+        iov[0].len = span.len[0];
+        iov[1].base = span.data[1];
+        iov[1].len = span.len[1];
+        rt = udp_audio_sendv(UDP_AUDIO_CODEC_PCM, iov, 2);
+        tuya_ring_buff_read_release(g_mic_ctx.ringbuf, MIC_FRAME_SIZE_PCM);
+        return rt;
+    }
+
+    /* Encoders, echo control and the VAD need contiguous samples, stage the wrapped frame */
+    tuya_ring_buff_read(g_mic_ctx.ringbuf, wrap_buf, MIC_FRAME_SIZE_PCM);
+    mic_echo_control((int16_t *)wrap_buf);
+    if (!mic_vad_gate((const int16_t *)wrap_buf)) {
+        *dtx = true;
+        return OPRT_OK;
+    }
+    if (g_mic_ctx.codec == MIC_CODEC_PCM) {
+        return udp_audio_send_pcm((const int16_t *)wrap_buf, MIC_FRAME_SAMPLES);
+    }
+    return mic_send_frame((const int16_t *)wrap_buf, MIC_FRAME_SAMPLES);
+}
+
+/**
+ * @brief Record the capture-to-send latency of the oldest buffered frame
+ *
+ * No per-frame timestamps: the newest byte in the ring arrived at
+ * last_write_time, so the end of the oldest frame was captured
+ * (buffered - one frame) worth of audio earlier.
+ */
+static void mic_latency_record(uint32_t buffered)
+{
+    uint32_t write_time = g_mic_ctx.last_write_time;
+    int32_t since_write = (int32_t)(tal_system_get_millisecond() - write_time);
+    uint32_t latency = (since_write > 0 ? (uint32_t)since_write : 0) +
+                       (buffered - MIC_FRAME_SIZE_PCM) / (MIC_CAPTURE_RATE * MIC_BITS / 8 / 1000);
+    uint32_t bucket = 0;
+    
+    while (bucket < MIC_LATENCY_BUCKETS - 1 && latency >= ((uint32_t)MIC_LATENCY_BUCKET_MS << bucket)) {
+        bucket++;
+    }
+    g_mic_ctx.latency_hist[bucket]++;
+    
+    g_mic_ctx.latency_last_ms = latency;
+    if (latency > g_mic_ctx.latency_max_ms) {
+        g_mic_ctx.latency_max_ms = latency;
+    }
+    if (g_mic_ctx.latency_avg_ms == 0) {
+        g_mic_ctx.latency_avg_ms = latency;
+    } else {
+        g_mic_ctx.latency_avg_ms = (g_mic_ctx.latency_avg_ms * 15 + latency) / 16;
+    }
+}
+
+/**
+ * @brief Capture time of the first sample of the oldest buffered frame
+ *
+ * Same reasoning as mic_latency_record(): the buffered bytes end at
+ * last_write_us. The pair is re-read if a driver write slipped in between.
+ */
+static uint32_t mic_capture_time_us(void)
+{
+    uint32_t write_us = 0;
+    uint32_t buffered = 0;
+    
+    do {
+        write_us = g_mic_ctx.last_write_us;
+        buffered = tuya_ring_buff_used_size_get(g_mic_ctx.ringbuf);
+    } while (write_us != g_mic_ctx.last_write_us);
+    
+    return write_us - (uint32_t)((uint64_t)buffered * 1000000 / (MIC_CAPTURE_RATE * MIC_BITS / 8));
+}
+
+/**
+ * @brief Restart the onboard mic capture stream
+ *
+ * Only the capture stream is restarted (tdl_audio_mic_restart()), the codec
+ * stays set up, so speaker output and the other capture subscribers are not
+ * disturbed.
+ *
+ * Streaming task context only.
+ */
+static OPERATE_RET mic_pipeline_restart(void)
+{
+    OPERATE_RET rt = OPRT_OK;
+    
+    if (!g_mic_ctx.audio_hdl) {
+        return OPRT_RESOURCE_NOT_READY;
+    }
+    
+    g_mic_ctx.restarting = true;
+    
+    /* Drop the stale partial frame left from before the stall */
+    tuya_ring_buff_reset(g_mic_ctx.ringbuf);
+    
+    rt = tdl_audio_mic_restart(g_mic_ctx.audio_hdl);
+    tkl_ai_disable_vendor_vad();
+    
+    g_mic_ctx.restarting = false;
+    
+    return rt;
+}
+
+/**
+ * @brief Streaming task - sends PCM frames from ringbuf (encoded per session codec) via UDP
  */
 static void mic_streaming_task(void *arg)
 {
-    /* Buffer for PCM data (in bytes) */
+    /* Staging buffer, only used when an encoded frame wraps around the ring */
     uint8_t pcm_buffer[MIC_FRAME_SIZE_PCM];
     uint32_t data_len;
     uint32_t send_count = 0;
     uint32_t loop_count = 0;
-    uint32_t empty_count = 0;
-    uint32_t last_heartbeat = 0;
-    uint32_t drop_count = 0;
+    uint32_t now = tal_system_get_millisecond();
+    uint32_t last_heartbeat = now;
+    uint32_t last_data_time = now;
+    uint32_t restart_time = 0;          /* When the pending restart was started */
+    uint32_t restart_backoff = MIC_WATCHDOG_TIMEOUT_MS;
+    bool restart_pending = false;       /* Restarted, waiting for the first mic data */
     
     /* Max buffer threshold: 200ms of audio = 10 frames * 640 bytes = 6400 bytes */
-    const uint32_t MAX_BUFFER_BYTES = 6400;
+    const uint32_t MAX_BUFFER_BYTES = MIC_FRAME_SIZE_PCM * 10;
     
-    PR_INFO("Mic streaming task started (raw PCM for WebRTC/Opus)");
+    PR_INFO("Mic streaming task started (codec: %s)", mic_streaming_codec_name(g_mic_ctx.codec));
     
     while (g_mic_ctx.streaming) {
+        /* Block until the mic callback signals a full frame; the timeout only
+         * exists so stop requests and the watchdog are still serviced */
+        tal_semaphore_wait(g_mic_ctx.frame_sem, MIC_STREAM_WAIT_MS);
+        if (!g_mic_ctx.streaming) {
+            break;
+        }
+        
         loop_count++;
+        now = tal_system_get_millisecond();
+        
+        /* Pick up rate controller decisions made on the TCP task */
+        mic_rate_apply();
         
         /* Heartbeat every 5 seconds to show thread is alive */
-        if ((loop_count - last_heartbeat) >= 500) {  /* 500 * 10ms = 5 seconds */
-            PR_INFO("Mic stream heartbeat: loops=%u, sends=%u, empty=%u, drops=%u, captured=%u bytes, restarts=%u", 
-                     loop_count, send_count, empty_count, drop_count, 
+        if ((now - last_heartbeat) >= MIC_HEARTBEAT_MS) {
+            PR_INFO("Mic stream heartbeat: wakeups=%u, sends=%u, dtx=%u, idle=%ums, drops=%u, captured=%u bytes, restarts=%u", 
+                     loop_count, send_count, g_mic_ctx.vad_dtx_frames, now - last_data_time, g_mic_ctx.bloat_dropped_frames, 
                      g_mic_ctx.total_bytes_captured, g_mic_ctx.watchdog_restarts);
-            last_heartbeat = loop_count;
+            last_heartbeat = now;
         }
         
         /* Check if ring buffer is valid */
@@ -200,47 +657,52 @@ static void mic_streaming_task(void *arg)
             uint32_t to_drop = data_len - MIC_FRAME_SIZE_PCM;  /* Keep only 1 frame */
             PR_WARN("Buffer bloat! Dropping %u bytes to catch up to real-time", to_drop);
             
-            /* Discard old audio by reading and throwing away */
-            while (tuya_ring_buff_used_size_get(g_mic_ctx.ringbuf) > MIC_FRAME_SIZE_PCM) {
-                tuya_ring_buff_read(g_mic_ctx.ringbuf, pcm_buffer, MIC_FRAME_SIZE_PCM);
-                drop_count++;
-            }
+            /* Sending can't keep up - degrade before the next bloat drop */
+            mic_rate_step_down("bloat");
+            
+            /* Discard old audio in whole frames, no need to copy it out */
+            to_drop -= to_drop % MIC_FRAME_SIZE_PCM;
+            tuya_ring_buff_discard(g_mic_ctx.ringbuf, to_drop);
+            g_mic_ctx.bloat_events++;
+            g_mic_ctx.bloat_dropped_frames += to_drop / MIC_FRAME_SIZE_PCM;
             data_len = tuya_ring_buff_used_size_get(g_mic_ctx.ringbuf);
         }
         
         /* Process frames while we have enough data */
         while (data_len >= MIC_FRAME_SIZE_PCM && udp_audio_is_ready()) {
-            empty_count = 0;  /* Reset empty counter */
+            last_data_time = now;  /* Reset stall timer */
+            
+            if (restart_pending) {
+                restart_pending = false;
+                restart_backoff = MIC_WATCHDOG_TIMEOUT_MS;
+                g_mic_ctx.restart_latency_ms = now - restart_time;
+                PR_NOTICE("Audio Watchdog: mic data back %u ms after restart #%u",
+                          g_mic_ctx.restart_latency_ms, g_mic_ctx.watchdog_restarts);
+            }
             
-            /* Read one frame of PCM data */
-            uint32_t read_len = tuya_ring_buff_read(g_mic_ctx.ringbuf, 
-                                                     pcm_buffer, 
-                                                     MIC_FRAME_SIZE_PCM);
+            mic_latency_record(data_len);
+            udp_audio_set_capture_time(mic_capture_time_us());
             
-            if (read_len == MIC_FRAME_SIZE_PCM) {
-                /* Send raw PCM via UDP (server encodes to Opus) */
-                /* pcm_buffer contains PCM bytes, convert to samples count */
-                int16_t *pcm_samples = (int16_t *)pcm_buffer;
-                uint32_t num_samples = read_len / 2;  /* 2 bytes per sample */
+            /* Encode/send one frame straight out of the ring buffer */
+            bool dtx = false;
+            OPERATE_RET rt = mic_send_ring_frame(pcm_buffer, &dtx);
+            if (rt == OPRT_OK && dtx) {
+                /* Silence: frame replaced by comfort noise or skipped */
+            } else if (rt == OPRT_OK) {
+                g_mic_ctx.total_frames_sent++;
+                g_mic_ctx.last_send_time = tal_system_get_millisecond();
+                send_count++;
                 
-                OPERATE_RET rt = udp_audio_send_pcm(pcm_samples, num_samples);
-                if (rt == OPRT_OK) {
-                    g_mic_ctx.total_frames_sent++;
-                    g_mic_ctx.last_send_time = tal_system_get_millisecond();
-                    send_count++;
-                    
-                    /* Log every 100 sends (~2 seconds at 50 frames/sec) */
-                    if (send_count % 100 == 0) {
-                        PR_INFO("Mic PCM sent: %u frames, seq=%u", 
-                                g_mic_ctx.total_frames_sent, udp_audio_get_seq());
-                    }
-                } else {
-                    PR_WARN("UDP PCM send failed: %d", rt);
-                    break;  /* Stop trying if UDP fails */
+                /* Log every 100 sends (~2 seconds at 50 frames/sec) */
+                if (send_count % 100 == 0) {
+                    PR_INFO("Mic %s sent: %u frames, seq=%u", 
+                            mic_streaming_codec_name(g_mic_ctx.codec),
+                            g_mic_ctx.total_frames_sent, udp_audio_get_seq());
                 }
             } else {
-                PR_WARN("Ring buffer read returned %u instead of %u", read_len, MIC_FRAME_SIZE_PCM);
-                break;
+                g_mic_ctx.send_failures++;
+                PR_WARN("UDP mic send failed: %d", rt);
+                break;  /* Stop trying if UDP fails */
             }
             
             /* Update data_len for next iteration */
@@ -248,44 +710,52 @@ static void mic_streaming_task(void *arg)
         }
         
         if (data_len < MIC_FRAME_SIZE_PCM) {
-            empty_count++;
+            uint32_t idle_ms = now - last_data_time;
             
-            /* AUDIO WATCHDOG: Detect driver stall and warn */
-            if (empty_count == MIC_WATCHDOG_EMPTY_COUNT) {
-                g_mic_ctx.watchdog_restarts++;
+            /* AUDIO WATCHDOG: Rebuild the mic pipeline when the driver stalls; retry
+             * with a doubling interval while the restarts don't bring data back */
+            if (idle_ms >= MIC_WATCHDOG_TIMEOUT_MS && 
+                (!restart_pending || (now - restart_time) >= restart_backoff)) {
+                if (restart_pending) {
+                    restart_backoff *= 2;
+                    if (restart_backoff > MIC_RESTART_BACKOFF_MAX_MS) {
+                        restart_backoff = MIC_RESTART_BACKOFF_MAX_MS;
+                    }
+                }
                 
-                PR_ERR("Audio Watchdog: Mic driver stalled (no data for %d ms)!",
-                        MIC_WATCHDOG_TIMEOUT_MS);
-                PR_ERR("  Streaming will continue with silence. Use 'mic off' then 'mic on' to restart.");
-                PR_ERR("  Stall count: %u", g_mic_ctx.watchdog_restarts);
+                g_mic_ctx.watchdog_restarts++;
+                PR_ERR("Audio Watchdog: Mic driver stalled (no data for %u ms), restart #%u",
+                        idle_ms, g_mic_ctx.watchdog_restarts);
                 
-                /* 
-                 * NOTE: We cannot restart the T5AI audio driver here because:
-                 * - The BK7258 audio ADC keeps internal state ("aud adc is init already")
-                 * - tdl_audio_close() + tdl_audio_open() causes hardware conflicts
-                 * - The underlying onboard_mic_stream requires full pipeline restart
-                 * 
-                 * The recommended fix is to use 'mic off' then 'mic on' from the web UI
-                 * which properly stops/starts the mic streaming system.
-                 */
-            }
-            
-            /* Continue logging every 30 seconds after initial stall */
-            if (empty_count > MIC_WATCHDOG_EMPTY_COUNT && 
-                (empty_count % (30000 / MIC_STREAM_INTERVAL_MS)) == 0) {
-                PR_WARN("Audio Watchdog: Still no mic data (%u ms since last data)",
-                        empty_count * MIC_STREAM_INTERVAL_MS);
+                restart_time = now;
+                restart_pending = true;
+                OPERATE_RET rt = mic_pipeline_restart();
+                if (rt != OPRT_OK) {
+                    PR_ERR("Audio Watchdog: mic pipeline restart failed: %d, retry in %u ms", 
+                           rt, restart_backoff);
+                }
+
             }
         }
-        
-        /* Wait before next check */
-        tal_system_sleep(MIC_STREAM_INTERVAL_MS);
     }
     
-    PR_NOTICE("Mic streaming task EXITING! streaming=%d, loop_count=%u", 
+    PR_NOTICE("Mic streaming task EXITING! streaming=%d, wakeups=%u", 
               g_mic_ctx.streaming, loop_count);
 }
 
+/**
+ * @brief Server settings changed: send the live stream to the new host
+ */
+static int mic_config_change_cb(void *data)
+{
+    const BLE_CONFIG_TCP_T *cfg = (const BLE_CONFIG_TCP_T *)data;
+    
+    if (cfg == NULL || cfg->host == NULL || !g_mic_ctx.streaming) {
+        return OPRT_OK;
+    }
+    return udp_audio_set_host(cfg->host);
+}
+
 OPERATE_RET mic_streaming_init(void)
 {
     OPERATE_RET rt = OPRT_OK;
@@ -296,6 +766,7 @@ OPERATE_RET mic_streaming_init(void)
     }
     
     memset(&g_mic_ctx, 0, sizeof(g_mic_ctx));
+    audio_duplex_init();
     
     /* Find audio device */
     rt = tdl_audio_find(AUDIO_CODEC_NAME, &g_mic_ctx.audio_hdl);
@@ -304,24 +775,46 @@ OPERATE_RET mic_streaming_init(void)
         return rt;
     }
     
+    /* Capture alongside the other subscribers, the device is opened by the audio stage */
+    rt = tdl_audio_subscribe(g_mic_ctx.audio_hdl, mic_audio_frame_callback, NULL);
+    if (rt != OPRT_OK) {
+        PR_ERR("Failed to subscribe to mic capture: %d", rt);
+        return rt;
+    }
+    
+    /* Frame-ready signal from the mic callback to the streaming task */
+    rt = tal_semaphore_create_init(&g_mic_ctx.frame_sem, 0, 1);
+    if (rt != OPRT_OK) {
+        PR_ERR("Failed to create mic frame semaphore: %d", rt);
+        return rt;
+    }
+    
     /* Create ring buffer for audio data - use COVERAGE type so old data is overwritten
      * instead of blocking writes. This prevents backpressure affecting the audio driver. */
     rt = tuya_ring_buff_create(MIC_RINGBUF_SIZE, OVERFLOW_PSRAM_COVERAGE_TYPE, &g_mic_ctx.ringbuf);
     if (rt != OPRT_OK) {
         PR_ERR("Failed to create audio ring buffer: %d", rt);
+        tal_semaphore_release(g_mic_ctx.frame_sem);
+        g_mic_ctx.frame_sem = NULL;
         return rt;
     }
     
+    g_mic_ctx.codec = MIC_CODEC_PCM;
+    g_mic_ctx.stream_rate = MIC_CAPTURE_RATE;
+    g_mic_ctx.rate_request = MIC_STREAM_RATE;
+    g_mic_ctx.vad_enabled = MIC_VAD_DEFAULT_ENABLE;
+    TUYA_CALL_ERR_LOG(tal_event_subscribe(EVENT_TCP_CONFIG_CHG, "mic_streaming", mic_config_change_cb,
+                                          SUBSCRIBE_TYPE_NORMAL));
     g_mic_ctx.initialized = true;
-    PR_INFO("Mic streaming initialized (raw PCM for WebRTC/Opus)");
-    PR_INFO("  Sample rate: %d Hz, Frame: %d samples (%d ms)", 
-            MIC_SAMPLE_RATE, MIC_FRAME_SAMPLES, MIC_FRAME_MS);
+    PR_INFO("Mic streaming initialized (opus %s)", opus_codec_is_supported() ? "available" : "not compiled in");
+    PR_INFO("  Sample rate: %d Hz (stream %u Hz), Frame: %d samples (%d ms)", 
+            MIC_CAPTURE_RATE, g_mic_ctx.rate_request, MIC_FRAME_SAMPLES, MIC_FRAME_MS);
     PR_INFO("  Ring buffer: %d bytes", MIC_RINGBUF_SIZE);
     
     return OPRT_OK;
 }
 
-OPERATE_RET mic_streaming_start(const char *host, uint16_t port)
+OPERATE_RET mic_streaming_start(const char *host, uint16_t port, MIC_CODEC_E codec)
 {
     OPERATE_RET rt = OPRT_OK;
     
@@ -335,13 +828,67 @@ OPERATE_RET mic_streaming_start(const char *host, uint16_t port)
         return OPRT_OK;
     }
     
+    if (codec >= MIC_CODEC_MAX) {
+        PR_ERR("Invalid mic codec: %d", codec);
+        return OPRT_INVALID_PARM;
+    }
+    
+    /* RTP maps PCM and G.711 to L16/16000 and PCMU/8000, which assume the capture rate */
+    uint32_t rate = g_mic_ctx.rate_request;
+    if (rate != MIC_CAPTURE_RATE && codec != MIC_CODEC_OPUS && udp_audio_get_rtp()) {
+        PR_WARN("Mic rate %u needs Opus in RTP mode, streaming at %u", rate, MIC_CAPTURE_RATE);
+        rate = MIC_CAPTURE_RATE;
+    }
+    if (codec == MIC_CODEC_PCM && rate > MIC_PCM_RATE_MAX) {
+        PR_ERR("Raw PCM at %u Hz exceeds one datagram per frame", rate);
+        return OPRT_NOT_SUPPORTED;
+    }
+    rt = audio_resample_init(&g_mic_ctx.resampler, MIC_CAPTURE_RATE, rate);
+    if (rt != OPRT_OK) {
+        PR_ERR("No resampler from %u to %u Hz: %d", MIC_CAPTURE_RATE, rate, rt);
+        return rt;
+    }
+    
+    /* Create the encoder before touching the socket so a failure leaves nothing to undo */
+    if (codec == MIC_CODEC_OPUS) {
+        rt = opus_codec_encoder_create(rate, MIC_CHANNELS, g_rate_steps[MIC_RC_START_LEVEL].opus_bitrate,
+                                       &g_mic_ctx.opus_enc);
+        if (rt != OPRT_OK) {
+            PR_ERR("Failed to create Opus encoder: %d", rt);
+            return rt;
+        }
+    }
+    g_mic_ctx.codec = codec;
+    g_mic_ctx.stream_rate = rate;
+    
     /* Initialize UDP audio sender */
     rt = udp_audio_init(host, port);
     if (rt != OPRT_OK) {
         PR_ERR("Failed to init UDP audio: %d", rt);
+        opus_codec_encoder_destroy(g_mic_ctx.opus_enc);
+        g_mic_ctx.opus_enc = NULL;
         return rt;
     }
     
+    /* Every session starts at the default rate level */
+    g_mic_ctx.rc_target_level = MIC_RC_START_LEVEL;
+    g_mic_ctx.rc_applied_level = MIC_RC_START_LEVEL;
+    g_mic_ctx.rc_clean_reports = 0;
+    g_mic_ctx.rc_last_down_time = 0;
+    g_mic_ctx.rc_loss_pct = 0;
+    g_mic_ctx.rc_applied_loss_pct = 0;
+    
+    /* Fresh noise estimate per session */
+    mic_vad_init(&g_mic_ctx.vad);
+    g_mic_ctx.vad_applied = g_mic_ctx.vad_enabled;
+    g_mic_ctx.vad_silent_frames = 0;
+    g_mic_ctx.vad_dtx_frames = 0;
+    udp_audio_set_batch(g_rate_steps[MIC_RC_START_LEVEL].batch_frames);
+    
+    /* Tag encoded payloads with the session codec */
+    udp_audio_set_codec(codec == MIC_CODEC_OPUS ? UDP_AUDIO_CODEC_OPUS :
+                        codec == MIC_CODEC_G711_ULAW ? UDP_AUDIO_CODEC_ULAW : UDP_AUDIO_CODEC_PCM);
+    
     /* Reset ring buffer */
     tuya_ring_buff_reset(g_mic_ctx.ringbuf);
     
@@ -349,7 +896,16 @@ OPERATE_RET mic_streaming_start(const char *host, uint16_t port)
     g_mic_ctx.total_bytes_captured = 0;
     g_mic_ctx.total_frames_sent = 0;
     g_mic_ctx.dropped_frames = 0;
+    g_mic_ctx.ring_high_water = 0;
+    g_mic_ctx.bloat_events = 0;
+    g_mic_ctx.bloat_dropped_frames = 0;
+    g_mic_ctx.send_failures = 0;
+    g_mic_ctx.latency_last_ms = 0;
+    g_mic_ctx.latency_avg_ms = 0;
+    g_mic_ctx.latency_max_ms = 0;
+    memset(g_mic_ctx.latency_hist, 0, sizeof(g_mic_ctx.latency_hist));
     g_mic_ctx.watchdog_restarts = 0;
+    g_mic_ctx.restart_latency_ms = 0;
     g_mic_ctx.last_send_time = tal_system_get_millisecond();  /* Init time for keepalive */
     
     /* Start streaming flag first */
@@ -368,6 +924,8 @@ OPERATE_RET mic_streaming_start(const char *host, uint16_t port)
         PR_ERR("Failed to create mic streaming thread: %d", rt);
         g_mic_ctx.streaming = false;
         udp_audio_close();
+        opus_codec_encoder_destroy(g_mic_ctx.opus_enc);
+        g_mic_ctx.opus_enc = NULL;
         return rt;
     }
     
@@ -385,7 +943,10 @@ OPERATE_RET mic_streaming_start(const char *host, uint16_t port)
         /* Not critical - audio will still work, just NAT may timeout */
     }
     
-    PR_NOTICE("Mic streaming started (raw PCM over UDP to %s:%d for WebRTC/Opus)", host, port);
+    mic_radio_coex(true);
+    
+    PR_NOTICE("Mic streaming started (%s at %u Hz over UDP to %s:%d)", mic_streaming_codec_name(codec), rate, host,
+              port);
     
     return OPRT_OK;
 }
@@ -396,26 +957,38 @@ OPERATE_RET mic_streaming_stop(void)
         return OPRT_OK;
     }
     
-    /* Stop streaming flag */
+    /* Stop streaming flag and wake the task so it sees it immediately */
     g_mic_ctx.streaming = false;
+    tal_semaphore_post(g_mic_ctx.frame_sem);
     
-    /* Wait for thread to exit */
-    tal_system_sleep(MIC_STREAM_INTERVAL_MS * 3);
+    /* Wait for thread to exit, a pipeline restart in progress must finish first */
+    tal_system_sleep(30);
+    for (int i = 0; g_mic_ctx.restarting && i < 50; i++) {
+        tal_system_sleep(10);
+    }
     
     if (g_mic_ctx.stream_thread) {
         tal_thread_delete(g_mic_ctx.stream_thread);
         g_mic_ctx.stream_thread = NULL;
     }
     
-    /* Close UDP connection */
+    /* Send a partially filled batch, then close UDP connection */
+    udp_audio_flush();
     udp_audio_close();
     
+    /* Release encoder (thread is gone, safe to free) */
+    opus_codec_encoder_destroy(g_mic_ctx.opus_enc);
+    g_mic_ctx.opus_enc = NULL;
+    
     /* Clear ring buffer */
     tuya_ring_buff_reset(g_mic_ctx.ringbuf);
     
+    /* Fast BLE again for config while idle */
+    mic_radio_coex(false);
+    
     PR_NOTICE("Mic streaming stopped");
-    PR_NOTICE("  Stats: captured=%u bytes, sent=%u frames, dropped=%u, watchdog_restarts=%u", 
-              g_mic_ctx.total_bytes_captured, g_mic_ctx.total_frames_sent, 
+    PR_NOTICE("  Stats: captured=%u bytes, sent=%u frames, dtx=%u frames, dropped=%u, watchdog_restarts=%u", 
+              g_mic_ctx.total_bytes_captured, g_mic_ctx.total_frames_sent, g_mic_ctx.vad_dtx_frames,
               g_mic_ctx.dropped_frames, g_mic_ctx.watchdog_restarts);
     
     return OPRT_OK;
@@ -426,17 +999,116 @@ bool mic_streaming_is_active(void)
     return g_mic_ctx.streaming;
 }
 
-void mic_streaming_get_stats(uint32_t *bytes_sent, uint32_t *frames_sent)
+void mic_streaming_set_vad(bool enable)
 {
-    if (bytes_sent) {
-        *bytes_sent = g_mic_ctx.total_bytes_captured;
+    /* Applied by the streaming task on its next frame */
+    g_mic_ctx.vad_enabled = enable;
+    PR_INFO("Mic VAD gating %s", enable ? "enabled" : "disabled");
+}
+
+OPERATE_RET mic_streaming_set_rate(uint32_t rate)
+{
+    AUDIO_RESAMPLE_T probe;
+    
+    if (rate != 16000 && rate != 24000 && rate != 48000) {
+        return OPRT_NOT_SUPPORTED;
     }
-    if (frames_sent) {
-        *frames_sent = g_mic_ctx.total_frames_sent;
+    if (audio_resample_init(&probe, MIC_CAPTURE_RATE, rate) != OPRT_OK) {
+        return OPRT_NOT_SUPPORTED;
     }
+    
+    /* Picked up by the next mic_streaming_start() */
+    g_mic_ctx.rate_request = rate;
+    PR_INFO("Mic stream rate %u Hz%s", rate, g_mic_ctx.streaming ? " (from next session)" : "");
+    return OPRT_OK;
+}
+
+uint32_t mic_streaming_get_rate(void)
+{
+    return g_mic_ctx.streaming ? g_mic_ctx.stream_rate : g_mic_ctx.rate_request;
 }
 
-void *mic_streaming_get_callback(void)
+bool mic_streaming_get_vad(uint32_t *dtx_frames)
 {
-    return (void *)mic_audio_frame_callback;
+    if (dtx_frames) {
+        *dtx_frames = g_mic_ctx.vad_dtx_frames;
+    }
+    return g_mic_ctx.vad_enabled;
+}
+
+void mic_streaming_on_receiver_report(uint32_t loss_pct, uint32_t rtt_ms, uint32_t jitter_ms)
+{
+    if (!g_mic_ctx.streaming) {
+        return;
+    }
+    
+    PR_DEBUG("Mic RR: loss=%u%%, rtt=%ums, jitter=%ums, level=%u", 
+             loss_pct, rtt_ms, jitter_ms, g_mic_ctx.rc_target_level);
+    
+    g_mic_ctx.rc_loss_pct = (uint8_t)(loss_pct > MIC_RC_FEC_MAX_LOSS_PCT ? MIC_RC_FEC_MAX_LOSS_PCT : loss_pct);
+    
+    if (loss_pct > MIC_RC_LOSS_HIGH_PCT || rtt_ms > MIC_RC_RTT_HIGH_MS || jitter_ms > MIC_RC_JITTER_HIGH_MS) {
+        mic_rate_step_down("receiver report");
+        return;
+    }
+    
+    if (loss_pct > MIC_RC_LOSS_LOW_PCT || rtt_ms > MIC_RC_RTT_LOW_MS) {
+        /* Neither congested nor clean: hold the current level */
+        g_mic_ctx.rc_clean_reports = 0;
+        return;
+    }
+    
+    /* Probe upwards slowly, one level per run of clean reports */
+    if (++g_mic_ctx.rc_clean_reports >= MIC_RC_UP_REPORTS && g_mic_ctx.rc_target_level > 0) {
+        g_mic_ctx.rc_clean_reports = 0;
+        g_mic_ctx.rc_target_level--;
+        PR_INFO("Mic rate step up to level %u", g_mic_ctx.rc_target_level);
+    }
+}
+
+uint8_t mic_streaming_get_quality_level(uint32_t *bitrate)
+{
+    uint8_t level = g_mic_ctx.rc_target_level;
+    
+    if (bitrate) {
+        *bitrate = g_rate_steps[level].opus_bitrate;
+    }
+    return level;
+}
+
+MIC_CODEC_E mic_streaming_get_codec(void)
+{
+    return g_mic_ctx.codec;
+}
+
+const char *mic_streaming_codec_name(MIC_CODEC_E codec)
+{
+    if (codec >= MIC_CODEC_MAX) {
+        return "unknown";
+    }
+    return g_codec_names[codec];
+}
+
+OPERATE_RET mic_streaming_get_stats(MIC_STREAMING_STATS_T *stats)
+{
+    if (NULL == stats) {
+        return OPRT_INVALID_PARM;
+    }
+    
+    stats->bytes_captured = g_mic_ctx.total_bytes_captured;
+    stats->frames_sent = g_mic_ctx.total_frames_sent;
+    stats->dtx_frames = g_mic_ctx.vad_dtx_frames;
+    stats->ring_overflows = g_mic_ctx.dropped_frames;
+    stats->ring_high_water = g_mic_ctx.ring_high_water;
+    stats->bloat_events = g_mic_ctx.bloat_events;
+    stats->bloat_dropped_frames = g_mic_ctx.bloat_dropped_frames;
+    stats->send_failures = g_mic_ctx.send_failures;
+    stats->restarts = g_mic_ctx.watchdog_restarts;
+    stats->restart_latency_ms = g_mic_ctx.restart_latency_ms;
+    stats->latency_last_ms = g_mic_ctx.latency_last_ms;
+    stats->latency_avg_ms = g_mic_ctx.latency_avg_ms;
+    stats->latency_max_ms = g_mic_ctx.latency_max_ms;
+    memcpy(stats->latency_hist, g_mic_ctx.latency_hist, sizeof(stats->latency_hist));
+    
+    return OPRT_OK;
 }
@@ -17,6 +17,41 @@
 extern "C" {
 #endif
 
+/**
+ * @brief Uplink codec used for mic frames
+ */
+typedef enum {
+    MIC_CODEC_PCM = 0,      /* Raw PCM 16-bit, server encodes to Opus (640 bytes / 20ms) */
+    MIC_CODEC_G711_ULAW,    /* G.711 u-law, 1 byte per sample (320 bytes / 20ms) */
+    MIC_CODEC_OPUS,         /* Opus encoded on device (~60 bytes / 20ms at 24kbps) */
+    MIC_CODEC_MAX
+} MIC_CODEC_E;
+
+/* Capture-to-send latency histogram: bucket i counts frames below
+ * MIC_LATENCY_BUCKET_MS << i ms, the last bucket everything above */
+#define MIC_LATENCY_BUCKETS     6
+#define MIC_LATENCY_BUCKET_MS   10   /* <10, <20, <40, <80, <160, >=160 ms */
+
+/**
+ * @brief Mic streaming statistics (counters reset by mic_streaming_start)
+ */
+typedef struct {
+    uint32_t bytes_captured;       /* PCM bytes delivered by the mic driver */
+    uint32_t frames_sent;          /* Audio frames sent over UDP */
+    uint32_t dtx_frames;           /* Frames suppressed by VAD gating */
+    uint32_t ring_overflows;       /* Driver writes that found the ring full */
+    uint32_t ring_high_water;      /* Most bytes ever buffered in the ring */
+    uint32_t bloat_events;         /* Times the 200ms bloat threshold was hit */
+    uint32_t bloat_dropped_frames; /* Frames discarded to catch up */
+    uint32_t send_failures;        /* UDP send errors */
+    uint32_t restarts;             /* Automatic mic pipeline restarts */
+    uint32_t restart_latency_ms;   /* Last restart: stall detection to first mic data */
+    uint32_t latency_last_ms;      /* Capture-to-send latency of the last frame */
+    uint32_t latency_avg_ms;       /* Smoothed (1/16) capture-to-send latency */
+    uint32_t latency_max_ms;       /* Worst capture-to-send latency */
+    uint32_t latency_hist[MIC_LATENCY_BUCKETS];
+} MIC_STREAMING_STATS_T;
+
 /**
  * @brief Initialize microphone streaming module
  * 
@@ -32,13 +67,16 @@ OPERATE_RET mic_streaming_init(void);
  * Enables the onboard microphone and starts sending audio
  * data over UDP to the specified server.
  * 
- * Audio format: PCM 16-bit, 8000Hz, mono
+ * Capture format: PCM 16-bit, 16000Hz, mono, 20ms frames.
+ * Each frame is encoded with the selected codec before sending.
  * 
  * @param host Server IP address for UDP audio
  * @param port UDP port (e.g., 5001)
+ * @param codec Uplink codec (MIC_CODEC_OPUS returns OPRT_NOT_SUPPORTED
+ *              when the firmware was built without Opus)
  * @return OPRT_OK on success
  */
-OPERATE_RET mic_streaming_start(const char *host, uint16_t port);
+OPERATE_RET mic_streaming_start(const char *host, uint16_t port, MIC_CODEC_E codec);
 
 /**
  * @brief Stop microphone streaming
@@ -57,22 +95,91 @@ OPERATE_RET mic_streaming_stop(void);
 bool mic_streaming_is_active(void);
 
 /**
- * @brief Get microphone streaming statistics
- * 
- * @param bytes_sent Pointer to store bytes sent (can be NULL)
- * @param frames_sent Pointer to store frames sent (can be NULL)
+ * @brief Enable/disable VAD gating of the uplink
+ *
+ * When enabled, silent frames are not sent; a one byte comfort noise packet
+ * goes out every 500ms instead (see UDP_AUDIO_CODEC_CN). On by default.
+ *
+ * @param enable true to gate silence
+ */
+void mic_streaming_set_vad(bool enable);
+
+/**
+ * @brief Set the stream sample rate
+ *
+ * Capture stays at the codec's native rate; frames are resampled on the
+ * device after echo control and the VAD. Takes effect with the next
+ * mic_streaming_start(). Opus is encoded at the stream rate; raw PCM
+ * supports up to 24kHz (a 48kHz frame does not fit one datagram), and in
+ * RTP mode only Opus leaves the capture rate. Default: MIC_STREAM_RATE.
+ *
+ * @param rate 16000, 24000 or 48000
+ * @return OPRT_OK, OPRT_NOT_SUPPORTED for other rates
+ */
+OPERATE_RET mic_streaming_set_rate(uint32_t rate);
+
+/**
+ * @brief Get the stream sample rate
+ *
+ * @return Rate of the running session, else of the next one
+ */
+uint32_t mic_streaming_get_rate(void);
+
+/**
+ * @brief Get the VAD gating state
+ *
+ * @param dtx_frames Output: frames suppressed this session (can be NULL)
+ * @return true if VAD gating is enabled
  */
-void mic_streaming_get_stats(uint32_t *bytes_sent, uint32_t *frames_sent);
+bool mic_streaming_get_vad(uint32_t *dtx_frames);
 
 /**
- * @brief Get the audio callback for mic streaming
+ * @brief Feed a receiver report from the server into the rate controller
+ *
+ * The server sends these periodically (TCP "rr:<loss_pct>,<rtt_ms>,<jitter_ms>").
+ * High loss/RTT steps the uplink down (lower Opus bitrate, more frames per
+ * datagram); a run of clean reports steps it back up. Changes are applied
+ * by the streaming task on its next frame.
+ *
+ * @param loss_pct Packet loss seen by the server in the last interval (0-100)
+ * @param rtt_ms Round trip time in milliseconds
+ * @param jitter_ms Interarrival jitter in milliseconds
+ */
+void mic_streaming_on_receiver_report(uint32_t loss_pct, uint32_t rtt_ms, uint32_t jitter_ms);
+
+/**
+ * @brief Get the current rate controller quality level
+ *
+ * @param bitrate Output: current Opus target bitrate in bps (can be NULL)
+ * @return Level, 0 = best quality
+ */
+uint8_t mic_streaming_get_quality_level(uint32_t *bitrate);
+
+/**
+ * @brief Get the codec currently used by mic streaming
+ *
+ * @return Active codec (last selected codec when not streaming)
+ */
+MIC_CODEC_E mic_streaming_get_codec(void);
+
+/**
+ * @brief Get a printable name for a codec
+ *
+ * @param codec Codec value
+ * @return "pcm", "g711" or "opus"
+ */
+const char *mic_streaming_codec_name(MIC_CODEC_E codec);
+
+/**
+ * @brief Get microphone streaming statistics
  * 
- * This callback should be passed to tdl_audio_open() during initial
- * audio device setup. It will forward mic data when streaming is active.
+ * A snapshot; counters are updated without locking, so fields may be one
+ * frame apart from each other.
  * 
- * @return Pointer to the mic audio callback function
+ * @param stats Output statistics
+ * @return OPRT_OK on success, OPRT_INVALID_PARM if stats is NULL
  */
-void *mic_streaming_get_callback(void);
+OPERATE_RET mic_streaming_get_stats(MIC_STREAMING_STATS_T *stats);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,129 @@
+/**
+ * @file mic_vad.c
+ * @brief Lightweight voice activity detector for the mic uplink
+ *
+ * Per frame we compute the mean absolute amplitude (cheaper than RMS, no
+ * multiplies) and the zero-crossing count. A frame is speech when its energy
+ * clearly exceeds the tracked noise floor; softer frames still count when
+ * their zero-crossing rate is high, which keeps fricative onsets ("s", "f")
+ * that carry little energy.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ */
+
+#include "mic_vad.h"
+
+/***********************************************************
+***********************macro define************************
+***********************************************************/
+/* Frames (20ms each) before the noise floor is trusted, all sent meanwhile */
+#define MIC_VAD_WARMUP_FRAMES   10
+
+/* Keep sending 300ms after the last speech frame */
+#define MIC_VAD_HANGOVER_FRAMES 15
+
+/* Speech when energy > floor * RATIO / 2 + MIN_LEVEL (ratios in halves) */
+#define MIC_VAD_SPEECH_RATIO    6   /* ~9.5 dB above the floor */
+#define MIC_VAD_WEAK_RATIO      3   /* ~3.5 dB above the floor, needs high ZCR */
+#define MIC_VAD_MIN_LEVEL       40  /* Absolute margin so digital silence never triggers */
+
+/* Zero crossings per frame (as a fraction of samples) that mark unvoiced speech */
+#define MIC_VAD_ZCR_DIV         4   /* >= 1/4 of the samples */
+
+/* Noise floor adaption: fast (1/16) towards quiet frames, slow creep up during speech */
+#define MIC_VAD_FLOOR_SHIFT     4
+#define MIC_VAD_FLOOR_CREEP     9
+
+/* Full scale reference for dBov, and 1 dB as a fixed point ratio (10^(1/20) * 1000) */
+#define MIC_VAD_FULL_SCALE      32767
+#define MIC_VAD_DB_STEP_X1000   1122
+#define MIC_VAD_LEVEL_MAX       127
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+
+void mic_vad_init(MIC_VAD_T *vad)
+{
+    vad->noise_floor = 0;
+    vad->last_energy = 0;
+    vad->hangover = 0;
+    vad->warmup = MIC_VAD_WARMUP_FRAMES;
+}
+
+bool mic_vad_process(MIC_VAD_T *vad, const int16_t *pcm, uint32_t samples)
+{
+    uint32_t sum = 0;
+    uint32_t zc = 0;
+    bool speech = false;
+
+    if (samples == 0) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < samples; i++) {
+        int32_t s = pcm[i];
+        sum += (uint32_t)(s < 0 ? -s : s);
+        if (i > 0 && ((pcm[i - 1] ^ pcm[i]) < 0)) {
+            zc++;
+        }
+    }
+
+    uint32_t energy = sum / samples;
+    vad->last_energy = energy;
+
+    /* Seed the noise floor from the first frames, assume someone may be talking */
+    if (vad->warmup > 0) {
+        vad->warmup--;
+        vad->noise_floor = (vad->noise_floor == 0) ? energy : (vad->noise_floor + energy) / 2;
+        vad->hangover = MIC_VAD_HANGOVER_FRAMES;
+        return true;
+    }
+
+    uint32_t floor = vad->noise_floor;
+    if (energy > floor * MIC_VAD_SPEECH_RATIO / 2 + MIC_VAD_MIN_LEVEL) {
+        speech = true;
+    } else if (energy > floor * MIC_VAD_WEAK_RATIO / 2 + MIC_VAD_MIN_LEVEL && zc >= samples / MIC_VAD_ZCR_DIV) {
+        speech = true;
+    }
+
+    if (speech) {
+        /* Creep up so a background that got permanently louder becomes the new floor */
+        vad->noise_floor = floor + (floor >> MIC_VAD_FLOOR_CREEP) + 1;
+        vad->hangover = MIC_VAD_HANGOVER_FRAMES;
+        return true;
+    }
+
+    /* Track the background in both directions, at least one step so a gap
+     * below 1 << MIC_VAD_FLOOR_SHIFT still closes */
+    if (energy > floor) {
+        uint32_t step = (energy - floor) >> MIC_VAD_FLOOR_SHIFT;
+        vad->noise_floor = floor + ((step > 0) ? step : 1);
+    } else if (energy < floor) {
+        uint32_t step = (floor - energy) >> MIC_VAD_FLOOR_SHIFT;
+        vad->noise_floor = floor - ((step > 0) ? step : 1);
+    }
+
+    if (vad->hangover > 0) {
+        vad->hangover--;
+        return true;
+    }
+
+    return false;
+}
+
+uint8_t mic_vad_noise_level(const MIC_VAD_T *vad)
+{
+    /* Q16 fixed point so the small levels keep their precision */
+    uint64_t ref = (uint64_t)MIC_VAD_FULL_SCALE << 16;
+    uint64_t target = (uint64_t)vad->noise_floor << 16;
+    uint8_t level = 0;
+
+    /* Count 1 dB steps down from full scale, only called a few times per second */
+    while (ref > target && level < MIC_VAD_LEVEL_MAX) {
+        ref = ref * 1000 / MIC_VAD_DB_STEP_X1000;
+        level++;
+    }
+
+    return level;
+}
@@ -0,0 +1,65 @@
+/**
+ * @file mic_vad.h
+ * @brief Lightweight voice activity detector for the mic uplink
+ *
+ * Energy + zero-crossing VAD cheap enough to run on every 20ms frame:
+ * - Tracks the background noise floor so it adapts to a quiet hallway
+ *   as well as a noisy street
+ * - Hangover keeps word endings and short pauses from being clipped
+ * - Reports the noise level so the server can play matching comfort noise
+ *
+ * The vendor VAD is disabled on purpose (it stalls the mic pipeline), this
+ * one only decides which frames are worth sending.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ */
+
+#ifndef __MIC_VAD_H__
+#define __MIC_VAD_H__
+
+#include "tuya_cloud_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief VAD state, one per stream
+ */
+typedef struct {
+    uint32_t noise_floor;  /* Mean absolute amplitude of the background */
+    uint32_t last_energy;  /* Mean absolute amplitude of the last frame */
+    uint16_t hangover;     /* Frames left before declaring silence */
+    uint16_t warmup;       /* Frames left while the noise floor settles */
+} MIC_VAD_T;
+
+/**
+ * @brief Reset the detector (call at stream start)
+ *
+ * @param vad VAD state
+ */
+void mic_vad_init(MIC_VAD_T *vad);
+
+/**
+ * @brief Classify one frame
+ *
+ * @param vad VAD state
+ * @param pcm PCM 16-bit samples
+ * @param samples Number of samples
+ * @return true if the frame should be sent (speech or hangover)
+ */
+bool mic_vad_process(MIC_VAD_T *vad, const int16_t *pcm, uint32_t samples);
+
+/**
+ * @brief Get the background noise level for comfort noise
+ *
+ * @param vad VAD state
+ * @return Noise level in -dBov (0 = full scale, 127 = digital silence), as in RFC 3389
+ */
+uint8_t mic_vad_noise_level(const MIC_VAD_T *vad);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MIC_VAD_H__ */
@@ -0,0 +1,138 @@
+/**
+ * @file net_resolve.c
+ * @brief Host name resolution with a small TTL cache
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ */
+
+#include "net_resolve.h"
+#include "tal_api.h"
+#include <string.h>
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+#define NET_RESOLVE_SLOTS     4
+#define NET_RESOLVE_HOST_LEN  64
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef struct {
+    char host[NET_RESOLVE_HOST_LEN];
+    TUYA_IP_ADDR_T addr;
+    SYS_TIME_T resolved_ms;
+} net_resolve_entry_t;
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static net_resolve_entry_t g_cache[NET_RESOLVE_SLOTS];
+static MUTEX_HANDLE g_cache_mutex = NULL;
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+
+static bool cache_lock(void)
+{
+    /* Without net_resolve_init() every call goes to DNS */
+    if (g_cache_mutex == NULL) {
+        return false;
+    }
+    tal_mutex_lock(g_cache_mutex);
+    return true;
+}
+
+static net_resolve_entry_t *cache_find(const char *host)
+{
+    for (int i = 0; i < NET_RESOLVE_SLOTS; i++) {
+        if (g_cache[i].host[0] && strcmp(g_cache[i].host, host) == 0) {
+            return &g_cache[i];
+        }
+    }
+    return NULL;
+}
+
+OPERATE_RET net_resolve_init(void)
+{
+    if (g_cache_mutex) {
+        return OPRT_OK;
+    }
+    memset(g_cache, 0, sizeof(g_cache));
+    return tal_mutex_create_init(&g_cache_mutex);
+}
+
+OPERATE_RET net_resolve_host(const char *host, TUYA_IP_ADDR_T *addr)
+{
+    if (host == NULL || host[0] == '\0' || addr == NULL) {
+        return OPRT_INVALID_PARM;
+    }
+
+    /* Literal addresses need no lookup */
+    TUYA_IP_ADDR_T ip = tal_net_str2addr(host);
+    if (ip != 0) {
+        *addr = ip;
+        return OPRT_OK;
+    }
+
+    if (strlen(host) >= NET_RESOLVE_HOST_LEN || !cache_lock()) {
+        return tal_net_gethostbyname(host, addr);
+    }
+
+    SYS_TIME_T now = tal_system_get_millisecond();
+    net_resolve_entry_t *entry = cache_find(host);
+    if (entry && now - entry->resolved_ms < NET_RESOLVE_TTL_MS) {
+        *addr = entry->addr;
+        tal_mutex_unlock(g_cache_mutex);
+        return OPRT_OK;
+    }
+    tal_mutex_unlock(g_cache_mutex);
+
+    /* Lookup outside the lock, it can take seconds */
+    OPERATE_RET rt = tal_net_gethostbyname(host, &ip);
+    if (rt != OPRT_OK || ip == 0) {
+        PR_WARN("DNS lookup failed for %s: %d", host, rt);
+        return rt != OPRT_OK ? rt : OPRT_COM_ERROR;
+    }
+    PR_INFO("DNS: %s -> %s", host, tal_net_addr2str(ip));
+
+    if (!cache_lock()) {
+        *addr = ip;
+        return OPRT_OK;
+    }
+    entry = cache_find(host);
+    if (entry == NULL) {
+        /* Reuse an empty slot, else the oldest answer */
+        entry = &g_cache[0];
+        for (int i = 0; i < NET_RESOLVE_SLOTS; i++) {
+            if (g_cache[i].host[0] == '\0') {
+                entry = &g_cache[i];
+                break;
+            }
+            if (g_cache[i].resolved_ms < entry->resolved_ms) {
+                entry = &g_cache[i];
+            }
+        }
+        strncpy(entry->host, host, NET_RESOLVE_HOST_LEN - 1);
+        entry->host[NET_RESOLVE_HOST_LEN - 1] = '\0';
+    }
+    entry->addr = ip;
+    entry->resolved_ms = now;
+    tal_mutex_unlock(g_cache_mutex);
+
+    *addr = ip;
+    return OPRT_OK;
+}
+
+void net_resolve_invalidate(const char *host)
+{
+    if (host == NULL || !cache_lock()) {
+        return;
+    }
+    net_resolve_entry_t *entry = cache_find(host);
+    if (entry) {
+        memset(entry, 0, sizeof(*entry));
+    }
+    tal_mutex_unlock(g_cache_mutex);
+}
@@ -0,0 +1,56 @@
+/**
+ * @file net_resolve.h
+ * @brief Host name resolution with a small TTL cache
+ *
+ * Shared by the TCP control client and the UDP mic/speaker streams so a
+ * server given by name is looked up once, not by every module on every
+ * (re)connect. Dotted IPv4 addresses are parsed directly and never cached.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ */
+
+#ifndef __NET_RESOLVE_H__
+#define __NET_RESOLVE_H__
+
+#include "tuya_cloud_types.h"
+#include "tal_network.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Cached answers are reused for this long */
+#define NET_RESOLVE_TTL_MS    (5 * 60 * 1000)
+
+/**
+ * @brief Initialize the resolver cache (call once before the network modules start)
+ *
+ * @return OPRT_OK on success
+ */
+OPERATE_RET net_resolve_init(void);
+
+/**
+ * @brief Resolve a host name or dotted IPv4 address
+ *
+ * @param host Host name or IP string
+ * @param addr Output address
+ * @return OPRT_OK on success, OPRT_INVALID_PARM on bad arguments,
+ *         or the tal_net_gethostbyname() error
+ */
+OPERATE_RET net_resolve_host(const char *host, TUYA_IP_ADDR_T *addr);
+
+/**
+ * @brief Drop the cached answer for a host
+ *
+ * Call when connecting to the cached address failed, so the next attempt
+ * asks DNS again.
+ *
+ * @param host Host name
+ */
+void net_resolve_invalidate(const char *host);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __NET_RESOLVE_H__ */
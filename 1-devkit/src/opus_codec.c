@@ -0,0 +1,209 @@
+/**
+ * @file opus_codec.c
+ * @brief Opus encoder/decoder wrapper implementation
+ *
+ * Uses the libopus shipped with the platform SDK. The encoder is configured
+ * for VoIP with a low complexity setting so a 20ms frame encodes well within
+ * the frame period on the T5AI.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ */
+
+#include "opus_codec.h"
+#include "tal_api.h"
+
+#if defined(ENABLE_OPUS_CODEC) && (ENABLE_OPUS_CODEC == 1)
+#include "opus.h"
+
+/* Complexity 0-10: keep it low, the MCU also runs MP3 decode and BLE */
+#define OPUS_ENC_COMPLEXITY 3
+
+bool opus_codec_is_supported(void)
+{
+    return true;
+}
+
+OPERATE_RET opus_codec_encoder_create(uint32_t sample_rate, uint8_t channels, uint32_t bitrate,
+                                      OPUS_CODEC_ENC_HANDLE *handle)
+{
+    int err = OPUS_OK;
+
+    if (NULL == handle) {
+        return OPRT_INVALID_PARM;
+    }
+
+    OpusEncoder *enc = opus_encoder_create((opus_int32)sample_rate, channels, OPUS_APPLICATION_VOIP, &err);
+    if (err != OPUS_OK || NULL == enc) {
+        PR_ERR("opus_encoder_create failed: %d", err);
+        return OPRT_COM_ERROR;
+    }
+
+    opus_encoder_ctl(enc, OPUS_SET_BITRATE((opus_int32)bitrate));
+    opus_encoder_ctl(enc, OPUS_SET_COMPLEXITY(OPUS_ENC_COMPLEXITY));
+    opus_encoder_ctl(enc, OPUS_SET_SIGNAL(OPUS_SIGNAL_VOICE));
+    opus_encoder_ctl(enc, OPUS_SET_VBR(1));
+
+    *handle = enc;
+    PR_INFO("Opus encoder created: %u Hz, %u ch, %u bps", sample_rate, channels, bitrate);
+
+    return OPRT_OK;
+}
+
+int opus_codec_encode(OPUS_CODEC_ENC_HANDLE handle, const int16_t *pcm_in, uint32_t pcm_samples, uint8_t *out,
+                      uint32_t out_size)
+{
+    if (NULL == handle || NULL == pcm_in || NULL == out) {
+        return OPRT_INVALID_PARM;
+    }
+
+    return opus_encode((OpusEncoder *)handle, pcm_in, (int)pcm_samples, out, (opus_int32)out_size);
+}
+
+OPERATE_RET opus_codec_encoder_set_bitrate(OPUS_CODEC_ENC_HANDLE handle, uint32_t bitrate)
+{
+    if (NULL == handle) {
+        return OPRT_INVALID_PARM;
+    }
+
+    int err = opus_encoder_ctl((OpusEncoder *)handle, OPUS_SET_BITRATE((opus_int32)bitrate));
+
+    return (err == OPUS_OK) ? OPRT_OK : OPRT_COM_ERROR;
+}
+
+OPERATE_RET opus_codec_encoder_set_fec(OPUS_CODEC_ENC_HANDLE handle, uint8_t loss_pct)
+{
+    if (NULL == handle || loss_pct > 100) {
+        return OPRT_INVALID_PARM;
+    }
+
+    int err = opus_encoder_ctl((OpusEncoder *)handle, OPUS_SET_INBAND_FEC(loss_pct ? 1 : 0));
+    if (err == OPUS_OK) {
+        err = opus_encoder_ctl((OpusEncoder *)handle, OPUS_SET_PACKET_LOSS_PERC(loss_pct));
+    }
+
+    return (err == OPUS_OK) ? OPRT_OK : OPRT_COM_ERROR;
+}
+
+void opus_codec_encoder_destroy(OPUS_CODEC_ENC_HANDLE handle)
+{
+    if (handle) {
+        opus_encoder_destroy((OpusEncoder *)handle);
+    }
+}
+
+OPERATE_RET opus_codec_decoder_create(uint32_t sample_rate, uint8_t channels, OPUS_CODEC_DEC_HANDLE *handle)
+{
+    int err = OPUS_OK;
+
+    if (NULL == handle) {
+        return OPRT_INVALID_PARM;
+    }
+
+    OpusDecoder *dec = opus_decoder_create((opus_int32)sample_rate, channels, &err);
+    if (err != OPUS_OK || NULL == dec) {
+        PR_ERR("opus_decoder_create failed: %d", err);
+        return OPRT_COM_ERROR;
+    }
+
+    *handle = dec;
+    PR_INFO("Opus decoder created: %u Hz, %u ch", sample_rate, channels);
+
+    return OPRT_OK;
+}
+
+int opus_codec_decode(OPUS_CODEC_DEC_HANDLE handle, const uint8_t *data, uint32_t len, int16_t *pcm_out,
+                      uint32_t max_samples)
+{
+    if (NULL == handle || NULL == data || NULL == pcm_out) {
+        return OPRT_INVALID_PARM;
+    }
+
+    return opus_decode((OpusDecoder *)handle, data, (opus_int32)len, pcm_out, (int)max_samples, 0);
+}
+
+void opus_codec_decoder_destroy(OPUS_CODEC_DEC_HANDLE handle)
+{
+    if (handle) {
+        opus_decoder_destroy((OpusDecoder *)handle);
+    }
+}
+
+#else /* !ENABLE_OPUS_CODEC */
+
+bool opus_codec_is_supported(void)
+{
+    return false;
+}
+
+OPERATE_RET opus_codec_encoder_create(uint32_t sample_rate, uint8_t channels, uint32_t bitrate,
+                                      OPUS_CODEC_ENC_HANDLE *handle)
+{
+    (void)sample_rate;
+    (void)channels;
+    (void)bitrate;
+
+    if (handle) {
+        *handle = NULL;
+    }
+
+    PR_WARN("Opus codec not compiled in (set ENABLE_OPUS_CODEC=1)");
+    return OPRT_NOT_SUPPORTED;
+}
+
+int opus_codec_encode(OPUS_CODEC_ENC_HANDLE handle, const int16_t *pcm_in, uint32_t pcm_samples, uint8_t *out,
+                      uint32_t out_size)
+{
+    (void)handle;
+    (void)pcm_in;
+    (void)pcm_samples;
+    (void)out;
+    (void)out_size;
+
+    return OPRT_NOT_SUPPORTED;
+}
+
+OPERATE_RET opus_codec_encoder_set_bitrate(OPUS_CODEC_ENC_HANDLE handle, uint32_t bitrate)
+{
+    (void)handle;
+    (void)bitrate;
+
+    return OPRT_NOT_SUPPORTED;
+}
+
+OPERATE_RET opus_codec_encoder_set_fec(OPUS_CODEC_ENC_HANDLE handle, uint8_t loss_pct)
+{
+    (void)handle;
+    (void)loss_pct;
+
+    return OPRT_NOT_SUPPORTED;
+}
+
+void opus_codec_encoder_destroy(OPUS_CODEC_ENC_HANDLE handle)
+{
+    (void)handle;
+}
+
+OPERATE_RET opus_codec_decoder_create(uint32_t sample_rate, uint8_t channels, OPUS_CODEC_DEC_HANDLE *handle)
+{
+    (void)sample_rate;
+    (void)channels;
+
+    if (handle) {
+        *handle = NULL;
+    }
+
+    return OPRT_NOT_SUPPORTED;
+}
+
+int opus_codec_decode(OPUS_CODEC_DEC_HANDLE handle, const uint8_t *data, uint32_t len, int16_t *pcm_out,
+                      uint32_t max_samples)
+{
+    return OPRT_NOT_SUPPORTED;
+}
+
+void opus_codec_decoder_destroy(OPUS_CODEC_DEC_HANDLE handle)
+{
+    (void)handle;
+}
+
+#endif /* ENABLE_OPUS_CODEC */
@@ -0,0 +1,131 @@
+/**
+ * @file opus_codec.h
+ * @brief Thin Opus wrapper for on-device mic compression and talk-back decode
+ *
+ * Wraps the platform libopus encoder/decoder so both UDP audio directions
+ * can carry compressed frames instead of raw PCM:
+ * - ~24 kbps instead of 256 kbps raw PCM
+ * - Encoding moves off the VPS relay onto the device
+ * - The speaker downlink decodes Opus before its jitter buffer
+ *
+ * Only available when the platform SDK provides libopus and the app is
+ * built with ENABLE_OPUS_CODEC=1; otherwise every call returns
+ * OPRT_NOT_SUPPORTED and callers should fall back to PCM or G.711.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ */
+
+#ifndef __OPUS_CODEC_H__
+#define __OPUS_CODEC_H__
+
+#include "tuya_cloud_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Default uplink bitrate (bits per second) */
+#define OPUS_CODEC_DEFAULT_BITRATE  24000
+
+/* Worst-case encoded size for one 20ms frame at the bitrates we use */
+#define OPUS_CODEC_MAX_FRAME_BYTES  256
+
+typedef void *OPUS_CODEC_ENC_HANDLE;
+typedef void *OPUS_CODEC_DEC_HANDLE;
+
+/**
+ * @brief Check if the Opus codec was compiled in
+ *
+ * @return true if libopus is available
+ */
+bool opus_codec_is_supported(void);
+
+/**
+ * @brief Create an Opus encoder tuned for voice
+ *
+ * @param sample_rate Input sample rate (8000/12000/16000/24000/48000)
+ * @param channels Number of channels (1 or 2)
+ * @param bitrate Target bitrate in bits per second
+ * @param handle Output encoder handle
+ * @return OPRT_OK on success, OPRT_NOT_SUPPORTED if built without Opus
+ */
+OPERATE_RET opus_codec_encoder_create(uint32_t sample_rate, uint8_t channels, uint32_t bitrate,
+                                      OPUS_CODEC_ENC_HANDLE *handle);
+
+/**
+ * @brief Encode one frame of PCM
+ *
+ * @param handle Encoder handle
+ * @param pcm_in Input PCM 16-bit samples
+ * @param pcm_samples Samples per channel (must be a valid Opus frame size, e.g. 320 @ 16kHz)
+ * @param out Output buffer for the Opus packet
+ * @param out_size Size of the output buffer in bytes
+ * @return Encoded length in bytes, or negative on error
+ */
+int opus_codec_encode(OPUS_CODEC_ENC_HANDLE handle, const int16_t *pcm_in, uint32_t pcm_samples, uint8_t *out,
+                      uint32_t out_size);
+
+/**
+ * @brief Change the encoder target bitrate
+ *
+ * @param handle Encoder handle
+ * @param bitrate New bitrate in bits per second
+ * @return OPRT_OK on success
+ */
+OPERATE_RET opus_codec_encoder_set_bitrate(OPUS_CODEC_ENC_HANDLE handle, uint32_t bitrate);
+
+/**
+ * @brief Configure Opus in-band FEC for the expected packet loss
+ *
+ * With loss_pct > 0 the encoder embeds a low bitrate copy of the previous
+ * frame (LBRR) so the decoder can conceal a single lost packet from the next
+ * one. 0 turns in-band FEC off.
+ *
+ * @param handle Encoder handle
+ * @param loss_pct Expected packet loss in percent (0-100)
+ * @return OPRT_OK on success
+ */
+OPERATE_RET opus_codec_encoder_set_fec(OPUS_CODEC_ENC_HANDLE handle, uint8_t loss_pct);
+
+/**
+ * @brief Destroy an encoder created by opus_codec_encoder_create()
+ *
+ * @param handle Encoder handle (NULL is ignored)
+ */
+void opus_codec_encoder_destroy(OPUS_CODEC_ENC_HANDLE handle);
+
+/**
+ * @brief Create an Opus decoder
+ *
+ * @param sample_rate Output sample rate (8000/12000/16000/24000/48000)
+ * @param channels Number of channels (1 or 2)
+ * @param handle Output decoder handle
+ * @return OPRT_OK on success, OPRT_NOT_SUPPORTED if built without Opus
+ */
+OPERATE_RET opus_codec_decoder_create(uint32_t sample_rate, uint8_t channels, OPUS_CODEC_DEC_HANDLE *handle);
+
+/**
+ * @brief Decode one Opus packet to PCM
+ *
+ * @param handle Decoder handle
+ * @param data Opus packet
+ * @param len Packet length in bytes
+ * @param pcm_out Output PCM 16-bit samples
+ * @param max_samples Capacity of pcm_out in samples per channel
+ * @return Decoded samples per channel, or negative on error
+ */
+int opus_codec_decode(OPUS_CODEC_DEC_HANDLE handle, const uint8_t *data, uint32_t len, int16_t *pcm_out,
+                      uint32_t max_samples);
+
+/**
+ * @brief Destroy a decoder created by opus_codec_decoder_create()
+ *
+ * @param handle Decoder handle (NULL is ignored)
+ */
+void opus_codec_decoder_destroy(OPUS_CODEC_DEC_HANDLE handle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __OPUS_CODEC_H__ */
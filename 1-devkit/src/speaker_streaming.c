@@ -2,14 +2,24 @@
  * @file speaker_streaming.c
  * @brief UDP Speaker Streaming Module for T5AI DevKit with Jitter Buffer
  *
- * Receives PCM audio data via UDP from the web server and plays it
+ * Receives audio (PCM, G.711 or Opus) via UDP from the web server and plays it
  * through the DevKit speaker. This enables two-way audio communication
  * where the browser user can talk to the DevKit.
  *
  * Features:
  * - NAT Hole Punching: Periodic UDP pings to VPS maintain NAT mapping
- * - Jitter Buffer: Ring buffer absorbs network timing variations
- * - Prefill: 100ms buffer fill before playback starts
+ * - Jitter Buffer: Lock-free SPSC ring absorbs network timing variations
+ * - Adaptive playout delay: prefill/target follow the measured network
+ *   jitter (60ms on a clean LAN up to 500ms), corrected by dropping or
+ *   repeating quiet chunks so speech is never cut
+ * - Echo control: every played frame is reported to audio_duplex, which
+ *   suppresses its echo on the mic uplink
+ * - Threads: rx, playback and NAT keepalive tasks, or with
+ *   SPEAKER_SINGLE_THREAD=1 one select() driven task doing all three
+ * - Drift compensation: a linear resampler (up to +/-0.5%) holds the
+ *   smoothed buffer level on target when sender and DAC clocks differ
+ * - Transport: UDP port 5002, or CMD_STREAM_SPEAKER datagrams on the TCP
+ *   control connection when udp_audio_set_mux() is on
  *
  * Audio Format (Hardware Contract):
  * - Sample Rate: 16kHz
@@ -17,20 +27,44 @@
  * - Bit Depth: 16-bit signed, Little Endian
  * - Packet Size: 640 bytes (20ms of audio)
  *
+ * Packet Format: [MAGIC:1=0xA7][CODEC:1][SEQ:2 BE][TS:4 BE][PAYLOAD]
+ * - CODEC: UDP_AUDIO_CODEC_PCM/ULAW/OPUS, decoded to PCM before reordering
+ * - SEQ: +1 per packet, one full 20ms frame per packet
+ * - TS:  sample clock of the first sample (RTP style), 16kHz or the
+ *        payload's rate for wideband PCM/G.711
+ * Wideband PCM/G.711 frames (24kHz: 960/480 bytes, 48kHz u-law: 960 bytes)
+ * are recognised by their length and resampled to 16kHz for playback.
+ * Packets are reordered in a small window; a missing frame is concealed by
+ * repeating the last one with a fade. Headerless packets whose length is a
+ * multiple of 640 bytes are still played as legacy raw PCM, in arrival order.
+ *
  * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
  */
 
 #include "tal_api.h"
 #include "tal_network.h"
-#include "tdl_audio_manage.h"
 #include "tuya_config.h"
 #include "ai_audio_player.h"
 #include "ai_audio.h"
+#include "speaker_streaming.h"
+#include "udp_audio.h"
+#include "g711_codec.h"
+#include "opus_codec.h"
+#include "audio_duplex.h"
+#include "audio_resample.h"
+#include "net_resolve.h"
+#include "cmd_proto.h"
+#include "ble_config.h"
 #include <string.h>
 
 /* UDP port for speaker audio (same on both DevKit and VPS) */
 #define SPEAKER_UDP_PORT    5002
 
+/* VPS port the NAT pings go to; differs only when the VPS shares the host, as in the latency bench */
+#ifndef SPEAKER_VPS_PORT
+#define SPEAKER_VPS_PORT    SPEAKER_UDP_PORT
+#endif
+
 /* PCM buffer size (max UDP payload) */
 #define PCM_BUF_SIZE        1400
 
@@ -40,16 +74,78 @@
 /* NAT keepalive interval in milliseconds (send ping every 5 seconds) */
 #define NAT_KEEPALIVE_MS    5000
 
+/* Run rx, keepalive and playback on one task instead of three (saves ~6KB of
+ * stacks on SRAM-tight builds; set from CMake) */
+#ifndef SPEAKER_SINGLE_THREAD
+#define SPEAKER_SINGLE_THREAD 0
+#endif
+
+/* Single task mode: select() timeout while waiting for the prefill, and
+ * datagrams handled per round before the next chunk is played */
+#define SPEAKER_LOOP_IDLE_MS 10
+#define SPEAKER_LOOP_MAX_RX  8
+
 /* Ping packet marker (0xFE = speaker ping, different from mic ping 0xFF) */
 #define SPEAKER_PING_MARKER 0xFE
 
+/* Ping: [MARKER][CAPS][PREFERRED][RATE_KHZ], CAPS bit n set = codec n decodable */
+#define SPEAKER_PING_SIZE   4
+
+/* Playback rate; PCM/G.711 at other rates is converted on arrival */
+#define SPEAKER_PLAY_RATE   16000
+
+/* Largest wideband frame that fits a datagram: 20ms of 48kHz u-law */
+#define SPEAKER_WB_SAMPLES_MAX  960
+
 /* ========== Jitter Buffer Configuration ========== */
-/* 3 seconds of 16kHz/16-bit mono audio = 96000 bytes (uses PSRAM) */
-#define JITTER_BUFFER_SIZE  96000
+/* ~2 seconds of 16kHz/16-bit mono audio = 65536 bytes (uses PSRAM).
+ * Must be a power of two: positions wrap with a mask instead of a modulo */
+#define JITTER_BUFFER_SIZE  65536
+#define JITTER_BUFFER_MASK  (JITTER_BUFFER_SIZE - 1)
+
+#if (JITTER_BUFFER_SIZE & JITTER_BUFFER_MASK) != 0
+#error "JITTER_BUFFER_SIZE must be a power of two"
+#endif
+
+/* ========== Packet header / reordering ========== */
+#define SPK_PKT_MAGIC       0xA7
+#define SPK_PKT_HEADER_SIZE 8
+
+/* Reorder window (power of two slots of one frame each) */
+#define SPK_REORDER_SLOTS   8
+#define SPK_REORDER_MASK    (SPK_REORDER_SLOTS - 1)
+#define SPK_REORDER_DEPTH   3     /* Conceal a gap once 3 newer frames wait (60ms) */
+#define SPK_REORDER_WAIT_MS 60    /* ...or when nothing arrived for this long */
+
+/* Packet loss concealment: repeat the last frame, fading out over this many frames */
+#define SPK_PLC_FADE_FRAMES 3
+
+/* Bytes of audio per millisecond (16kHz * 2 bytes) */
+#define JB_BYTES_PER_MS     32
+
+/* Adaptive playout delay: target = BASE + MULT * smoothed jitter, clamped.
+ * Grows at once when jitter rises, shrinks by DECAY_MS every DECAY_PKTS packets */
+#define JB_TARGET_MIN_MS    60
+#define JB_TARGET_MAX_MS    500
+#define JB_TARGET_BASE_MS   40
+#define JB_JITTER_MULT      4
+#define JB_TARGET_DECAY_MS  2
+#define JB_TARGET_DECAY_PKTS 25          /* ~0.5s at 20ms packets */
 
-/* Prefill threshold: 500ms = 16000 bytes before playback starts */
-/* Larger prefill = more latency but much better stability */
-#define PREFILL_THRESHOLD   16000
+/* A gap this long starts a new talkspurt instead of counting as jitter */
+#define JB_TALKSPURT_GAP_MS 1000
+
+/* Level control around the target */
+#define JB_HYSTERESIS_MS    20           /* One chunk of slack before correcting */
+#define JB_CATCHUP_MS       300          /* Further above target: drop audio even if loud */
+#define JB_QUIET_LEVEL      400          /* Mean abs amplitude of a chunk safe to drop/repeat */
+
+/* Clock drift compensation: resampling ratio follows the smoothed level error.
+ * Crystal drift is ~100ppm, so the level settles within about a millisecond */
+#define JB_DRIFT_MAX_PPM    5000         /* +/-0.5% */
+#define JB_DRIFT_GAIN_PPM   100          /* ppm per ms of level error */
+#define JB_DRIFT_AVG_SHIFT  6            /* Level smoothing 1/64 per chunk (~1.3s) */
+#define JB_DRIFT_SLACK      8            /* Extra input samples a chunk may need */
 
 /* Playback chunk size: 20ms = 640 bytes (matches server packet size) */
 #define PLAYBACK_CHUNK_SIZE 640
@@ -57,27 +153,50 @@
 /* Playback interval: 20ms per chunk */
 #define PLAYBACK_INTERVAL_MS 20
 
+/* Samples per 20ms frame */
+#define PLAYBACK_CHUNK_SAMPLES (PLAYBACK_CHUNK_SIZE / 2)
+
+/* Talk-back is live speech: it ducks voice messages and alerts */
+#define SPEAKER_MIX_PRIORITY   2
+#define SPEAKER_MIX_TIMEOUT_MS (PLAYBACK_INTERVAL_MS * 5)
+
 /* Global state */
 static bool g_speaker_active = false;
 static int g_udp_socket = -1;
-static TDL_AUDIO_HANDLE_T g_audio_hdl = NULL;
+static AI_AUDIO_MIX_STREAM_T g_mix_stream = 0;
+static bool g_mix_open = false;
 static THREAD_HANDLE g_rx_thread = NULL;
 static THREAD_HANDLE g_playback_thread = NULL;
 static THREAD_HANDLE g_keepalive_thread = NULL;
+static THREAD_HANDLE g_loop_thread = NULL;      /* SPEAKER_SINGLE_THREAD only */
+static MUTEX_HANDLE g_rx_mutex = NULL;           /* Reorder state: UDP rx vs. TCP mux feed */
 
 /* VPS server address for NAT hole punching */
 static TUYA_IP_ADDR_T g_vps_addr = 0;
-static uint16_t g_vps_port = SPEAKER_UDP_PORT;
+static uint16_t g_vps_port = SPEAKER_VPS_PORT;
 
-/* Jitter buffer (ring buffer) */
+/* Jitter buffer: single producer (speaker_rx_task), single consumer
+ * (speaker_playback_task), no lock. head/tail are free-running byte counters
+ * (level = head - tail, wraps correctly), each written by one side only. */
 static uint8_t g_jitter_buffer[JITTER_BUFFER_SIZE];
-static volatile uint32_t g_buf_head = 0;      /* Write position */
-static volatile uint32_t g_buf_tail = 0;      /* Read position */
-static volatile uint32_t g_buf_count = 0;     /* Bytes in buffer */
+static uint32_t g_buf_head = 0;      /* Write counter, owned by the producer */
+static uint32_t g_buf_tail = 0;      /* Read counter, owned by the consumer */
 static volatile bool g_playback_started = false;
 
-/* Mutex for buffer access */
-static MUTEX_HANDLE g_buf_mutex = NULL;
+/* Adaptive delay state: written by speaker_rx_task, read by the playback task */
+static volatile uint32_t g_target_ms = JB_TARGET_MIN_MS;  /* Current playout delay target */
+static volatile uint32_t g_last_arrival_ms = 0;            /* Arrival time of the latest packet */
+static uint32_t g_jitter_q4 = 0;                           /* Interarrival jitter in ms, Q4 */
+static uint32_t g_last_duration_ms = 0;                    /* Audio duration of the latest packet */
+static uint32_t g_decay_count = 0;
+
+/* Drift compensation state, speaker_playback_task only */
+static int16_t g_rs_in[PLAYBACK_CHUNK_SAMPLES + JB_DRIFT_SLACK];  /* Input staged from the ring */
+static uint32_t g_rs_count = 0;                                    /* Staged samples */
+static uint32_t g_rs_pos_q16 = 0;                                  /* Fractional read position */
+static uint32_t g_rs_step_q16 = 1 << 16;                           /* Input samples per output sample */
+static uint32_t g_level_avg_q6 = 0;                                /* Smoothed level in bytes, Q6 */
+static int32_t g_drift_ppm = 0;
 
 /* Statistics */
 static uint32_t g_packets_received = 0;
@@ -86,96 +205,536 @@ static uint32_t g_play_errors = 0;
 static uint32_t g_pings_sent = 0;
 static uint32_t g_underruns = 0;
 static uint32_t g_overruns = 0;
+static uint32_t g_chunks_dropped = 0;   /* Quiet chunks removed to shrink the delay */
+static uint32_t g_chunks_repeated = 0;  /* Quiet chunks played twice to grow the delay */
+static uint32_t g_chunks_played = 0;
+
+/* Reorder window state, speaker_rx_task only */
+typedef struct {
+    bool valid;
+    uint16_t seq;
+    uint16_t len;
+    uint8_t pcm[PLAYBACK_CHUNK_SIZE];
+} spk_slot_t;
+
+static spk_slot_t g_slots[SPK_REORDER_SLOTS];
+static bool g_seq_started = false;
+static uint16_t g_next_seq = 0;       /* Next frame to hand to the jitter buffer */
+static uint16_t g_max_seq = 0;        /* Newest frame held in the window */
+static uint32_t g_held = 0;           /* Frames waiting in the window */
+static uint32_t g_last_ts = 0;        /* TS of the previous packet (jitter estimate) */
+
+/* Last frame played out, source for concealment */
+static uint8_t g_plc_frame[PLAYBACK_CHUNK_SIZE];
+static uint32_t g_plc_len = 0;
+static uint32_t g_plc_run = 0;        /* Consecutive concealed frames */
+
+static uint32_t g_frames_concealed = 0;
+static uint32_t g_packets_late = 0;
+static uint32_t g_packets_dup = 0;
+
+/* Downlink codec negotiation and decoding */
+static volatile SPEAKER_CODEC_E g_pref_codec = SPEAKER_CODEC_G711_ULAW;
+static uint8_t g_rx_codec = UDP_AUDIO_CODEC_PCM;     /* Codec of the latest packet */
+static OPUS_CODEC_DEC_HANDLE g_opus_dec = NULL;
+static uint32_t g_decode_errors = 0;
+
+/* Wideband downlink, rx task only */
+static volatile uint32_t g_pref_rate = SPEAKER_PLAY_RATE;   /* Advertised PCM/G.711 rate */
+static uint32_t g_rx_rate = SPEAKER_PLAY_RATE;              /* Rate of the latest PCM/G.711 frame */
+static AUDIO_RESAMPLE_T g_rx_rs;
+static int16_t g_wb_pcm[SPEAKER_WB_SAMPLES_MAX];
 
 /* VPS host storage for dynamic configuration */
 static char g_vps_host[64] = "";
 
 /**
- * @brief Write data to jitter buffer (producer)
+ * @brief Write data to jitter buffer (producer, speaker_rx_task only)
+ *
+ * A packet that does not fit is dropped whole: the producer must never move
+ * the consumer's tail, and keeping packets intact keeps samples aligned.
  */
 static void jitter_buffer_write(const uint8_t *data, uint32_t len)
 {
     if (len == 0 || data == NULL) return;
     
-    tal_mutex_lock(g_buf_mutex);
+    uint32_t head = g_buf_head;
+    uint32_t tail = __atomic_load_n(&g_buf_tail, __ATOMIC_ACQUIRE);
     
-    /* Check for buffer overflow */
-    if (g_buf_count + len > JITTER_BUFFER_SIZE) {
-        /* Buffer overflow - drop oldest data */
-        uint32_t overflow = (g_buf_count + len) - JITTER_BUFFER_SIZE;
-        g_buf_tail = (g_buf_tail + overflow) % JITTER_BUFFER_SIZE;
-        g_buf_count -= overflow;
+    if (len > JITTER_BUFFER_SIZE - (head - tail)) {
         g_overruns++;
         if (g_overruns % 50 == 1) {
-            PR_WARN("[SPEAKER] Buffer overrun #%u (dropped %u bytes)", g_overruns, overflow);
+            PR_WARN("[SPEAKER] Buffer overrun #%u (dropped %u bytes)", g_overruns, len);
         }
+        return;
     }
     
-    /* Write data to ring buffer */
-    for (uint32_t i = 0; i < len; i++) {
-        g_jitter_buffer[g_buf_head] = data[i];
-        g_buf_head = (g_buf_head + 1) % JITTER_BUFFER_SIZE;
+    /* At most two segments: up to the end of the array, then from the start */
+    uint32_t pos = head & JITTER_BUFFER_MASK;
+    uint32_t first = JITTER_BUFFER_SIZE - pos;
+    if (first > len) {
+        first = len;
     }
-    g_buf_count += len;
+    memcpy(&g_jitter_buffer[pos], data, first);
+    memcpy(g_jitter_buffer, data + first, len - first);
     
-    tal_mutex_unlock(g_buf_mutex);
+    /* Publish the data only after it is in place */
+    __atomic_store_n(&g_buf_head, head + len, __ATOMIC_RELEASE);
 }
 
 /**
- * @brief Read data from jitter buffer (consumer)
+ * @brief Read data from jitter buffer (consumer, speaker_playback_task only)
  * @return Number of bytes read (may be less than requested if buffer underrun)
  */
 static uint32_t jitter_buffer_read(uint8_t *data, uint32_t len)
 {
-    tal_mutex_lock(g_buf_mutex);
-    
-    uint32_t available = g_buf_count;
+    uint32_t tail = g_buf_tail;
+    uint32_t available = __atomic_load_n(&g_buf_head, __ATOMIC_ACQUIRE) - tail;
     uint32_t to_read = (len < available) ? len : available;
     
-    /* Read data from ring buffer */
-    for (uint32_t i = 0; i < to_read; i++) {
-        data[i] = g_jitter_buffer[g_buf_tail];
-        g_buf_tail = (g_buf_tail + 1) % JITTER_BUFFER_SIZE;
+    uint32_t pos = tail & JITTER_BUFFER_MASK;
+    uint32_t first = JITTER_BUFFER_SIZE - pos;
+    if (first > to_read) {
+        first = to_read;
     }
-    g_buf_count -= to_read;
+    memcpy(data, &g_jitter_buffer[pos], first);
+    memcpy(data + first, g_jitter_buffer, to_read - first);
     
-    tal_mutex_unlock(g_buf_mutex);
+    /* Hand the space back only after the copy is done */
+    __atomic_store_n(&g_buf_tail, tail + to_read, __ATOMIC_RELEASE);
     
     return to_read;
 }
 
 /**
- * @brief Get current buffer level
+ * @brief Get current buffer level (safe from any task)
  */
 static uint32_t jitter_buffer_level(void)
 {
-    tal_mutex_lock(g_buf_mutex);
-    uint32_t count = g_buf_count;
-    tal_mutex_unlock(g_buf_mutex);
-    return count;
+    uint32_t tail = __atomic_load_n(&g_buf_tail, __ATOMIC_ACQUIRE);
+    uint32_t head = __atomic_load_n(&g_buf_head, __ATOMIC_ACQUIRE);
+    
+    return head - tail;
+}
+
+/**
+ * @brief Drop len bytes from the read side (consumer only)
+ */
+static void jitter_buffer_skip(uint32_t len)
+{
+    uint32_t level = jitter_buffer_level();
+    
+    if (len > level) {
+        len = level;
+    }
+    __atomic_store_n(&g_buf_tail, g_buf_tail + len, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Update the jitter estimate and playout target for an arriving packet (rx task)
+ *
+ * RFC 3550 style interarrival jitter: D is how far the arrival spacing was
+ * from the send spacing, J += (|D| - J) / 16.
+ *
+ * @param spacing_ms Send spacing to the previous packet (from TS, or its audio duration)
+ * @param len Audio bytes in this packet
+ */
+static void jitter_estimate_update(int32_t spacing_ms, uint32_t len)
+{
+    uint32_t now = tal_system_get_millisecond();
+    uint32_t gap = now - g_last_arrival_ms;
+    
+    if (g_last_arrival_ms != 0 && gap < JB_TALKSPURT_GAP_MS) {
+        int32_t d = (int32_t)gap - spacing_ms;
+        uint32_t abs_d = (uint32_t)(d < 0 ? -d : d);
+        g_jitter_q4 = g_jitter_q4 + abs_d - (g_jitter_q4 >> 4);
+    }
+    g_last_arrival_ms = now;
+    g_last_duration_ms = len / JB_BYTES_PER_MS;
+    
+    uint32_t desired = JB_TARGET_BASE_MS + JB_JITTER_MULT * (g_jitter_q4 >> 4);
+    if (desired < JB_TARGET_MIN_MS) {
+        desired = JB_TARGET_MIN_MS;
+    } else if (desired > JB_TARGET_MAX_MS) {
+        desired = JB_TARGET_MAX_MS;
+    }
+    
+    /* Grow at once (avoid underruns), shrink slowly (avoid oscillating) */
+    if (desired > g_target_ms) {
+        g_target_ms = desired;
+        g_decay_count = 0;
+    } else if (desired < g_target_ms && ++g_decay_count >= JB_TARGET_DECAY_PKTS) {
+        g_decay_count = 0;
+        g_target_ms = (g_target_ms - desired > JB_TARGET_DECAY_MS) ? g_target_ms - JB_TARGET_DECAY_MS : desired;
+    }
+}
+
+/**
+ * @brief Check if a chunk is quiet enough to drop or repeat without audible artifacts
+ */
+static bool chunk_is_quiet(const uint8_t *chunk, uint32_t len)
+{
+    const int16_t *pcm = (const int16_t *)chunk;
+    uint32_t samples = len / 2;
+    uint32_t sum = 0;
+    
+    for (uint32_t i = 0; i < samples; i++) {
+        int32_t v = pcm[i];
+        sum += (uint32_t)(v < 0 ? -v : v);
+    }
+    
+    return (sum / samples) < JB_QUIET_LEVEL;
+}
+
+/**
+ * @brief Restart drift compensation with an empty staging buffer (playback task)
+ */
+static void drift_reset(uint32_t level)
+{
+    g_rs_count = 0;
+    g_rs_pos_q16 = 0;
+    g_level_avg_q6 = level << JB_DRIFT_AVG_SHIFT;
+}
+
+/**
+ * @brief Track the buffer level and set the resampling ratio (playback task)
+ *
+ * Above target the ring is read slightly faster than the DAC plays, below
+ * target slightly slower.
+ */
+static void drift_update(uint32_t level, uint32_t target)
+{
+    g_level_avg_q6 = g_level_avg_q6 + level - (g_level_avg_q6 >> JB_DRIFT_AVG_SHIFT);
+    
+    int32_t err_ms = ((int32_t)(g_level_avg_q6 >> JB_DRIFT_AVG_SHIFT) - (int32_t)target) / JB_BYTES_PER_MS;
+    int32_t ppm = err_ms * JB_DRIFT_GAIN_PPM;
+    if (ppm > JB_DRIFT_MAX_PPM) {
+        ppm = JB_DRIFT_MAX_PPM;
+    } else if (ppm < -JB_DRIFT_MAX_PPM) {
+        ppm = -JB_DRIFT_MAX_PPM;
+    }
+    
+    g_drift_ppm = ppm;
+    g_rs_step_q16 = (uint32_t)((1 << 16) + (int32_t)(((int64_t)ppm << 16) / 1000000));
+}
+
+/**
+ * @brief Produce one 20ms chunk, linearly resampled from the ring (playback task)
+ * @return false if the ring does not hold enough input yet
+ */
+static bool drift_resample_chunk(int16_t *out)
+{
+    uint32_t step = g_rs_step_q16;
+    uint32_t pos = g_rs_pos_q16;
+    
+    /* Last output interpolates between in[idx] and in[idx + 1] */
+    uint32_t need = ((pos + (PLAYBACK_CHUNK_SAMPLES - 1) * step) >> 16) + 2;
+    if (need > g_rs_count) {
+        uint32_t got = jitter_buffer_read((uint8_t *)&g_rs_in[g_rs_count], (need - g_rs_count) * 2);
+        g_rs_count += got / 2;
+        if (g_rs_count < need) {
+            return false;
+        }
+    }
+    
+    for (uint32_t i = 0; i < PLAYBACK_CHUNK_SAMPLES; i++) {
+        uint32_t idx = pos >> 16;
+        int32_t a = g_rs_in[idx];
+        int32_t b = g_rs_in[idx + 1];
+        
+        /* Q15 fraction keeps (b - a) * frac inside 32 bits */
+        out[i] = (int16_t)(a + (((b - a) * (int32_t)((pos & 0xFFFF) >> 1)) >> 15));
+        pos += step;
+    }
+    
+    /* Keep the samples not consumed yet for the next chunk */
+    uint32_t used = pos >> 16;
+    g_rs_count -= used;
+    memmove(g_rs_in, &g_rs_in[used], g_rs_count * 2);
+    g_rs_pos_q16 = pos & 0xFFFF;
+    
+    return true;
+}
+
+/**
+ * @brief Hand one in-order frame to the jitter buffer (rx task)
+ *
+ * After concealment the frame fades in from the level the concealment
+ * ended at, so the resume doesn't click.
+ */
+static void spk_frame_output(uint8_t *pcm, uint32_t len)
+{
+    if (g_plc_run > 0) {
+        int16_t *s = (int16_t *)pcm;
+        uint32_t samples = len / 2;
+        int32_t g0 = (g_plc_run >= SPK_PLC_FADE_FRAMES) ? 0 :
+                     (int32_t)((SPK_PLC_FADE_FRAMES - g_plc_run) * 32768 / SPK_PLC_FADE_FRAMES);
+        
+        for (uint32_t i = 0; i < samples; i++) {
+            int32_t g = g0 + (int32_t)((32768 - g0) * (int64_t)i / samples);
+            s[i] = (int16_t)((s[i] * g) >> 15);
+        }
+        g_plc_run = 0;
+    }
+    
+    jitter_buffer_write(pcm, len);
+    memcpy(g_plc_frame, pcm, len);
+    g_plc_len = len;
+}
+
+/**
+ * @brief Conceal one lost frame: repeat the last frame with a fade (rx task)
+ */
+static void spk_frame_conceal(void)
+{
+    static uint8_t out[PLAYBACK_CHUNK_SIZE];
+    const int16_t *src = (const int16_t *)g_plc_frame;
+    int16_t *dst = (int16_t *)out;
+    uint32_t samples = PLAYBACK_CHUNK_SIZE / 2;
+    
+    g_frames_concealed++;
+    
+    /* Linear fade from (N-run)/N to (N-run-1)/N over the frame, then silence */
+    if (g_plc_len == PLAYBACK_CHUNK_SIZE && g_plc_run < SPK_PLC_FADE_FRAMES) {
+        int32_t g0 = (int32_t)((SPK_PLC_FADE_FRAMES - g_plc_run) * 32768 / SPK_PLC_FADE_FRAMES);
+        int32_t g1 = (int32_t)((SPK_PLC_FADE_FRAMES - g_plc_run - 1) * 32768 / SPK_PLC_FADE_FRAMES);
+        
+        for (uint32_t i = 0; i < samples; i++) {
+            int32_t g = g0 + (int32_t)((g1 - g0) * (int64_t)i / samples);
+            dst[i] = (int16_t)((src[i] * g) >> 15);
+        }
+    } else {
+        memset(out, 0, sizeof(out));
+    }
+    g_plc_run++;
+    
+    jitter_buffer_write(out, PLAYBACK_CHUNK_SIZE);
+}
+
+/**
+ * @brief Release in-order frames from the reorder window (rx task)
+ *
+ * @param flush Conceal every gap up to the newest held frame (no more packets expected soon)
+ */
+static void spk_reorder_release(bool flush)
+{
+    while (g_held > 0) {
+        spk_slot_t *slot = &g_slots[g_next_seq & SPK_REORDER_MASK];
+        
+        if (slot->valid && slot->seq == g_next_seq) {
+            spk_frame_output(slot->pcm, slot->len);
+            slot->valid = false;
+            g_held--;
+        } else if (flush || (int16_t)(g_max_seq - g_next_seq) >= SPK_REORDER_DEPTH) {
+            /* Waited long enough, the frame is lost */
+            spk_frame_conceal();
+        } else {
+            break;
+        }
+        g_next_seq++;
+    }
+}
+
+/**
+ * @brief Put one sequenced PCM frame into the reorder window (rx task)
+ */
+static void spk_reorder_put(uint16_t seq, const uint8_t *pcm, uint32_t len)
+{
+    if (!g_seq_started) {
+        g_seq_started = true;
+        g_next_seq = seq;
+        g_max_seq = seq;
+    }
+    
+    int16_t diff = (int16_t)(seq - g_next_seq);
+    if (diff < 0) {
+        /* Already played or concealed */
+        g_packets_late++;
+        return;
+    }
+    
+    if (diff >= SPK_REORDER_SLOTS) {
+        /* Sender restarted or a long outage: play what we hold, then resync */
+        spk_reorder_release(true);
+        g_next_seq = seq;
+        g_max_seq = seq;
+    }
+    
+    spk_slot_t *slot = &g_slots[seq & SPK_REORDER_MASK];
+    if (slot->valid) {
+        g_packets_dup++;
+        return;
+    }
+    
+    slot->valid = true;
+    slot->seq = seq;
+    slot->len = (uint16_t)len;
+    memcpy(slot->pcm, pcm, len);
+    g_held++;
+    if ((int16_t)(seq - g_max_seq) > 0) {
+        g_max_seq = seq;
+    }
+    
+    spk_reorder_release(false);
+}
+
+/**
+ * @brief Send a NAT ping that also advertises the decodable codecs
+ * @return Bytes sent, or negative on error
+ */
+static int speaker_send_ping(void)
+{
+    uint8_t ping_pkt[SPEAKER_PING_SIZE];
+    
+    ping_pkt[0] = SPEAKER_PING_MARKER;
+    ping_pkt[1] = (1 << SPEAKER_CODEC_PCM) | (1 << SPEAKER_CODEC_G711_ULAW) |
+                  (g_opus_dec ? (1 << SPEAKER_CODEC_OPUS) : 0);
+    ping_pkt[2] = (uint8_t)g_pref_codec;
+    ping_pkt[3] = (uint8_t)(g_pref_rate / 1000);
+    
+    /* Multiplexed: no NAT hole to keep, the ping only advertises codecs */
+    if (udp_audio_get_mux()) {
+        return (cmd_proto_send_datagram(CMD_STREAM_SPEAKER, ping_pkt, sizeof(ping_pkt)) == OPRT_OK)
+                   ? (int)sizeof(ping_pkt) : -1;
+    }
+    return tal_net_send_to(g_udp_socket, ping_pkt, sizeof(ping_pkt), g_vps_addr, g_vps_port);
 }
 
+/**
+ * @brief Sample rate of a headered 20ms payload, from its codec and length
+ *
+ * Opus decodes to the playback rate whatever it was encoded at.
+ *
+ * @return Rate in Hz, 0 if the length fits no supported rate
+ */
+static uint32_t speaker_frame_rate(uint8_t codec, uint32_t len)
+{
+    uint32_t samples = 0;
+    
+    if (codec == UDP_AUDIO_CODEC_PCM) {
+        samples = len / 2;
+    } else if (codec == UDP_AUDIO_CODEC_ULAW) {
+        samples = len;
+    } else {
+        return SPEAKER_PLAY_RATE;
+    }
+    
+    switch (samples) {
+    case PLAYBACK_CHUNK_SAMPLES:
+        return SPEAKER_PLAY_RATE;
+    case 480:
+        return 24000;
+    case 960:
+        return 48000;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * @brief Convert a frame decoded at rate to the 16kHz playback frame
+ */
+static bool speaker_resample_frame(uint32_t rate, const int16_t *in, uint32_t samples, int16_t *pcm_out)
+{
+    if (rate != g_rx_rate) {
+        PR_INFO("[SPEAKER] Downlink rate changed: %u -> %u", g_rx_rate, rate);
+        g_rx_rate = rate;
+        if (audio_resample_init(&g_rx_rs, rate, SPEAKER_PLAY_RATE) != OPRT_OK) {
+            return false;
+        }
+    }
+    return audio_resample_process(&g_rx_rs, in, samples, pcm_out, PLAYBACK_CHUNK_SAMPLES) == PLAYBACK_CHUNK_SAMPLES;
+}
+
+/**
+ * @brief Decode one headered packet payload to a 20ms PCM frame (rx task)
+ * @return true if pcm_out holds PLAYBACK_CHUNK_SIZE bytes
+ */
+static bool speaker_decode_frame(uint8_t codec, const uint8_t *payload, uint32_t len, int16_t *pcm_out)
+{
+    uint32_t rate = speaker_frame_rate(codec, len);
+    
+    if (codec != g_rx_codec) {
+        PR_INFO("[SPEAKER] Downlink codec changed: %u -> %u", g_rx_codec, codec);
+        g_rx_codec = codec;
+    }
+    
+    switch (codec) {
+    case UDP_AUDIO_CODEC_PCM:
+        if (rate == SPEAKER_PLAY_RATE) {
+            memcpy(pcm_out, payload, len);
+            return true;
+        }
+        if (rate != 0) {
+            /* Copy out first, the payload need not be 2 byte aligned */
+            memcpy(g_wb_pcm, payload, len);
+            if (speaker_resample_frame(rate, g_wb_pcm, len / 2, pcm_out)) {
+                return true;
+            }
+        }
+        break;
+    
+    case UDP_AUDIO_CODEC_ULAW:
+        if (rate == SPEAKER_PLAY_RATE) {
+            g711_decode_ulaw(payload, len, pcm_out);
+            return true;
+        }
+        if (rate != 0) {
+            g711_decode_ulaw(payload, len, g_wb_pcm);
+            if (speaker_resample_frame(rate, g_wb_pcm, len, pcm_out)) {
+                return true;
+            }
+        }
+        break;
+    
+    case UDP_AUDIO_CODEC_OPUS:
+        if (g_opus_dec == NULL) {
+            break;
+        }
+        if (opus_codec_decode(g_opus_dec, payload, len, pcm_out, PLAYBACK_CHUNK_SAMPLES) == PLAYBACK_CHUNK_SAMPLES) {
+            return true;
+        }
+        break;
+    
+    default:
+        break;
+    }
+    
+    g_decode_errors++;
+    if (g_decode_errors % 50 == 1) {
+        PR_WARN("[SPEAKER] Cannot decode codec %u frame (%u bytes), errors: %u", codec, len, g_decode_errors);
+    }
+    return false;
+}
+
+/**
+ * @brief Send one NAT keepalive ping and log it
+ */
+static void speaker_keepalive_ping(void)
+{
+    /* Send ping to VPS to punch/maintain NAT hole */
+    int sent = speaker_send_ping();
+    if (sent == SPEAKER_PING_SIZE) {
+        g_pings_sent++;
+        if (g_pings_sent % 12 == 1) {  /* Log every minute */
+            PR_DEBUG("[SPEAKER] NAT ping #%u, buffer: %u bytes", g_pings_sent, jitter_buffer_level());
+        }
+    } else {
+        PR_WARN("[SPEAKER] NAT keepalive ping failed: %d", sent);
+    }
+}
+
+#if !SPEAKER_SINGLE_THREAD
 /**
  * @brief NAT keepalive task - sends periodic pings to VPS to keep NAT hole open
  */
 static void speaker_keepalive_task(void *arg)
 {
-    uint8_t ping_pkt = SPEAKER_PING_MARKER;
-    
     PR_INFO("[SPEAKER] NAT keepalive task started -> %s:%d", 
             tal_net_addr2str(g_vps_addr), g_vps_port);
     
     while (g_speaker_active) {
-        /* Send ping to VPS to punch/maintain NAT hole */
-        int sent = tal_net_send_to(g_udp_socket, &ping_pkt, 1, g_vps_addr, g_vps_port);
-        if (sent == 1) {
-            g_pings_sent++;
-            if (g_pings_sent % 12 == 1) {  /* Log every minute */
-                PR_DEBUG("[SPEAKER] NAT ping #%u, buffer: %u bytes", g_pings_sent, jitter_buffer_level());
-            }
-        } else {
-            PR_WARN("[SPEAKER] NAT keepalive ping failed: %d", sent);
-        }
+        speaker_keepalive_ping();
         
         /* Wait before next ping */
         tal_system_sleep(NAT_KEEPALIVE_MS);
@@ -183,13 +742,84 @@ static void speaker_keepalive_task(void *arg)
     
     PR_INFO("[SPEAKER] NAT keepalive task stopped (sent %u pings)", g_pings_sent);
 }
+#endif
+
+/**
+ * @brief Drop frames that won't arrive anymore once the sender went quiet (rx side)
+ */
+static void speaker_rx_idle(void)
+{
+    tal_mutex_lock(g_rx_mutex);
+    if (g_held > 0 && (tal_system_get_millisecond() - g_last_arrival_ms) >= SPK_REORDER_WAIT_MS) {
+        spk_reorder_release(true);
+    }
+    tal_mutex_unlock(g_rx_mutex);
+}
 
+/**
+ * @brief Handle one received datagram (rx side, g_rx_mutex held)
+ */
+static void speaker_rx_packet_locked(const uint8_t *buf, uint32_t len)
+{
+    int16_t pcm[PLAYBACK_CHUNK_SAMPLES];
+    
+    /* Ignore ping responses (1 byte packets) */
+    if (len == 1) {
+        return;
+    }
+
+    /* Got audio data - write to jitter buffer */
+    g_packets_received++;
+    g_bytes_received += len;
+
+    if (g_packets_received % 200 == 1) {
+        PR_DEBUG("[SPEAKER] RX packet #%u: %u bytes, buffer: %u bytes", 
+                 g_packets_received, len, jitter_buffer_level());
+    }
+
+    if ((len % PLAYBACK_CHUNK_SIZE) == 0) {
+        /* Legacy headerless PCM: arrival order, no concealment */
+        jitter_estimate_update((int32_t)g_last_duration_ms, len);
+        jitter_buffer_write(buf, len);
+        return;
+    }
+    
+    if (len <= SPK_PKT_HEADER_SIZE || buf[0] != SPK_PKT_MAGIC) {
+        PR_DEBUG("[SPEAKER] Dropping malformed packet (%u bytes)", len);
+        return;
+    }
+    
+    uint16_t seq = ((uint16_t)buf[2] << 8) | buf[3];
+    uint32_t ts = ((uint32_t)buf[4] << 24) | ((uint32_t)buf[5] << 16) | ((uint32_t)buf[6] << 8) | buf[7];
+    
+    /* Send spacing from the sample clock (16 samples per ms at 16kHz) */
+    uint32_t clock_khz = speaker_frame_rate(buf[1], len - SPK_PKT_HEADER_SIZE) / 1000;
+    jitter_estimate_update((int32_t)(ts - g_last_ts) / (int32_t)(clock_khz ? clock_khz : 16), PLAYBACK_CHUNK_SIZE);
+    g_last_ts = ts;
+    
+    /* An undecodable frame is left out and concealed like a lost one */
+    if (speaker_decode_frame(buf[1], buf + SPK_PKT_HEADER_SIZE, len - SPK_PKT_HEADER_SIZE, pcm)) {
+        spk_reorder_put(seq, (const uint8_t *)pcm, PLAYBACK_CHUNK_SIZE);
+    }
+}
+
+/**
+ * @brief Handle one received datagram from either transport
+ */
+static void speaker_rx_packet(const uint8_t *buf, uint32_t len)
+{
+    tal_mutex_lock(g_rx_mutex);
+    speaker_rx_packet_locked(buf, len);
+    tal_mutex_unlock(g_rx_mutex);
+}
+
+#if !SPEAKER_SINGLE_THREAD
 /**
  * @brief UDP receiver task - writes incoming audio to jitter buffer
  */
 static void speaker_rx_task(void *arg)
 {
-    uint8_t buf[PCM_BUF_SIZE];
+    TAL_NET_RX_BUF_T rx;
     TUYA_IP_ADDR_T addr = 0;
     uint16_t port = 0;
     TUYA_ERRNO len;
@@ -197,108 +827,284 @@ static void speaker_rx_task(void *arg)
     PR_INFO("[SPEAKER] UDP receiver task started on port %d", SPEAKER_UDP_PORT);
 
     while (g_speaker_active) {
-        /* Receive UDP packet (may timeout and return <= 0) */
-        len = tal_net_recvfrom(g_udp_socket, buf, sizeof(buf), &addr, &port);
+        /* Receive UDP packet in place of the stack buffer (may timeout and return <= 0) */
+        len = tal_net_recvfrom_buf(g_udp_socket, &rx, &addr, &port);
         
         if (len <= 0) {
-            /* Timeout or error - continue waiting */
+            /* Timeout or error - a frame missing at the end of a burst won't come anymore */
+            speaker_rx_idle();
             continue;
         }
         
-        /* Ignore ping responses (1 byte packets) */
-        if (len == 1) {
-            continue;
-        }
+        speaker_rx_packet(rx.data, rx.len);
+        tal_net_rx_buf_release(&rx);
+    }
 
-        /* Got audio data - write to jitter buffer */
-        g_packets_received++;
-        g_bytes_received += len;
+    PR_INFO("[SPEAKER] UDP receiver task stopped");
+}
+#endif
 
-        if (g_packets_received % 200 == 1) {
-            PR_DEBUG("[SPEAKER] RX packet #%u: %d bytes, buffer: %u bytes", 
-                     g_packets_received, (int)len, jitter_buffer_level());
-        }
+/**
+ * @brief Check if the buffer holds the playout target (or the talkspurt ended)
+ */
+static bool speaker_prefill_ready(void)
+{
+    uint32_t level = jitter_buffer_level();
+    uint32_t target = g_target_ms * JB_BYTES_PER_MS;
+    
+    /* A short talkspurt may never reach the target: play it once the sender went quiet */
+    bool spurt_ended = (level >= PLAYBACK_CHUNK_SIZE) &&
+                       (tal_system_get_millisecond() - g_last_arrival_ms) >= g_target_ms;
+    
+    if (level >= target || spurt_ended) {
+        PR_DEBUG("[SPEAKER] Buffer prefilled (%u bytes, target %ums, jitter %ums) - starting playback", 
+                 level, g_target_ms, g_jitter_q4 >> 4);
+        return true;
+    }
+    
+    return false;
+}
 
-        /* Write to jitter buffer */
-        jitter_buffer_write(buf, len);
+/**
+ * @brief Start playback once the prefill is done
+ */
+static void speaker_playback_begin(void)
+{
+    g_playback_started = true;
+    drift_reset(jitter_buffer_level());
+}
+
+/**
+ * @brief Play one chunk, keeping the level near the adaptive target
+ *
+ * Above the target quiet chunks are skipped, below it quiet chunks are played
+ * twice, and far above it (e.g. after a burst) audio is dropped to catch up.
+ * On underrun playback stops until the buffer is prefilled again. Blocks in
+ * ai_audio_player_mix_write() until the mixer takes the chunk, which paces
+ * the caller at the DAC rate.
+ */
+static void speaker_playback_step(int16_t *chunk)
+{
+    OPERATE_RET rt;
+    uint32_t level = jitter_buffer_level();
+    uint32_t target = g_target_ms * JB_BYTES_PER_MS;
+    const uint32_t hysteresis = JB_HYSTERESIS_MS * JB_BYTES_PER_MS;
+    
+    if (level < PLAYBACK_CHUNK_SIZE + JB_DRIFT_SLACK * 2) {
+        /* Buffer underrun - drop the partial chunk and prefill again
+         * instead of playing silence. Running dry after the sender went
+         * quiet is just the end of a talkspurt. */
+        bool spurt_ended = (tal_system_get_millisecond() - g_last_arrival_ms) >= g_target_ms;
+        if (!spurt_ended && (++g_underruns % 100 == 1)) {
+            PR_WARN("[SPEAKER] Buffer underrun #%u (only %u bytes available)", 
+                    g_underruns, level);
+        }
+        jitter_buffer_skip(level);
+        g_playback_started = false;
+        return;
     }
+    
+    /* Far behind real time (burst after a stall): jump back to the target */
+    if (level > target + JB_CATCHUP_MS * JB_BYTES_PER_MS) {
+        uint32_t excess = level - target;
+        excess -= excess % PLAYBACK_CHUNK_SIZE;
+        jitter_buffer_skip(excess);
+        g_chunks_dropped += excess / PLAYBACK_CHUNK_SIZE;
+        PR_DEBUG("[SPEAKER] Catch-up: dropped %u bytes (target %ums)", excess, g_target_ms);
+        level -= excess;
+    }
+    
+    /* Read chunk from jitter buffer, resampled to cancel clock drift */
+    drift_update(level, target);
+    if (!drift_resample_chunk(chunk)) {
+        return;
+    }
+    
+    bool quiet = chunk_is_quiet((const uint8_t *)chunk, PLAYBACK_CHUNK_SIZE);
+    
+    /* Too much delay: silence removal */
+    if (quiet && level > target + hysteresis) {
+        g_chunks_dropped++;
+        return;
+    }
+    
+    /* Too little delay: silence insertion (play the quiet chunk twice) */
+    int plays = (quiet && level + hysteresis < target) ? 2 : 1;
+    if (plays == 2) {
+        g_chunks_repeated++;
+    }
+    
+    for (int i = 0; i < plays; i++) {
+        /* Mixed with any voice message or alert playing at the same time */
+        rt = ai_audio_player_mix_write(g_mix_stream, (const uint8_t *)chunk, PLAYBACK_CHUNK_SIZE,
+                                       SPEAKER_MIX_TIMEOUT_MS);
+        if (rt != OPRT_OK) {
+            g_play_errors++;
+            if (g_play_errors % 100 == 1) {
+                PR_WARN("[SPEAKER] Play error #%u: %d", g_play_errors, rt);
+            }
+        } else {
+            /* Echo reference for the mic uplink */
+            audio_duplex_feed_ref(chunk, PLAYBACK_CHUNK_SAMPLES);
+            g_chunks_played++;
+            if (g_chunks_played % 500 == 0) {
+                PR_DEBUG("[SPEAKER] Played %u chunks, buffer: %u bytes, target %ums, jitter %ums, "
+                         "drift %dppm, dropped %u, repeated %u, output %ums", g_chunks_played,
+                         jitter_buffer_level(), g_target_ms, g_jitter_q4 >> 4, g_drift_ppm, g_chunks_dropped,
+                         g_chunks_repeated, ai_audio_player_get_latency_ms());
+            }
+        }
+    }
+}
 
-    PR_INFO("[SPEAKER] UDP receiver task stopped");
+/**
+ * @brief Open the player mixer stream used for playback (kept across restarts)
+ */
+static OPERATE_RET speaker_audio_open(void)
+{
+    if (g_mix_open) {
+        return OPRT_OK;
+    }
+    
+    AI_AUDIO_MIX_CFG_T cfg = {
+        .priority = SPEAKER_MIX_PRIORITY,
+        .gain = AI_AUDIO_MIX_GAIN_UNITY,
+        .duck_gain = AI_AUDIO_MIX_GAIN_UNITY,
+    };
+    OPERATE_RET rt = ai_audio_player_mix_open(&cfg, &g_mix_stream);
+    if (rt != OPRT_OK) {
+        PR_ERR("[SPEAKER] Failed to open mixer stream: %d", rt);
+        return rt;
+    }
+    g_mix_open = true;
+    PR_INFO("[SPEAKER] Mixer stream %u opened", g_mix_stream);
+    
+    return OPRT_OK;
 }
 
+#if !SPEAKER_SINGLE_THREAD
 /**
  * @brief Playback task - reads from jitter buffer and plays audio at steady rate
  */
 static void speaker_playback_task(void *arg)
 {
-    uint8_t chunk[PLAYBACK_CHUNK_SIZE];
-    OPERATE_RET rt;
-    uint32_t chunks_played = 0;
+    int16_t chunk[PLAYBACK_CHUNK_SAMPLES];
     
     PR_INFO("[SPEAKER] Playback task started");
-    PR_INFO("[SPEAKER] Waiting for buffer prefill (%u bytes = %ums)...", 
-            PREFILL_THRESHOLD, PREFILL_THRESHOLD / 32);
+    PR_INFO("[SPEAKER] Waiting for buffer prefill (target %ums)...", g_target_ms);
 
-    /* Find audio handle */
-    rt = tdl_audio_find(AUDIO_CODEC_NAME, &g_audio_hdl);
-    if (rt != OPRT_OK || g_audio_hdl == NULL) {
-        PR_ERR("[SPEAKER] Failed to find audio codec: %d", rt);
+    if (speaker_audio_open() != OPRT_OK) {
         return;
     }
-    PR_INFO("[SPEAKER] Audio codec found: %s", AUDIO_CODEC_NAME);
 
-    /* Wait for prefill threshold */
-    while (g_speaker_active && !g_playback_started) {
-        uint32_t level = jitter_buffer_level();
-        if (level >= PREFILL_THRESHOLD) {
-            g_playback_started = true;
-            PR_NOTICE("[SPEAKER] Buffer prefilled (%u bytes) - starting playback!", level);
-        } else {
-            tal_system_sleep(10);
+    /* Main playback loop */
+    while (g_speaker_active) {
+        if (!g_playback_started) {
+            if (!speaker_prefill_ready()) {
+                tal_system_sleep(10);
+                continue;
+            }
+            speaker_playback_begin();
         }
+        
+        speaker_playback_step(chunk);
+        /* No sleep here - let audio driver pace the playback */
     }
 
-    /* Main playback loop */
+    PR_INFO("[SPEAKER] Playback task stopped (played %u chunks)", g_chunks_played);
+}
+#else
+/**
+ * @brief Single speaker task: UDP receive, NAT keepalive and playback
+ *
+ * The socket is polled with select() in the style of the LAN socket loop,
+ * the keepalive is a deadline checked every round, and the mixer write
+ * paces the loop while playing. The driver holds several chunks, so reading
+ * the socket between two plays keeps up with the network.
+ */
+static void speaker_loop_task(void *arg)
+{
+    int16_t chunk[PLAYBACK_CHUNK_SAMPLES];
+    TAL_NET_RX_BUF_T rx;
+    TUYA_FD_SET_T rfds;
+    TUYA_IP_ADDR_T addr = 0;
+    uint16_t port = 0;
+    uint32_t next_ping = tal_system_get_millisecond();
+    
+    PR_INFO("[SPEAKER] Speaker loop started on port %d -> %s:%d", SPEAKER_UDP_PORT,
+            tal_net_addr2str(g_vps_addr), g_vps_port);
+
+    if (speaker_audio_open() != OPRT_OK) {
+        return;
+    }
+    
     while (g_speaker_active) {
-        uint32_t level = jitter_buffer_level();
+        uint32_t now = tal_system_get_millisecond();
         
-        if (level >= PLAYBACK_CHUNK_SIZE) {
-            /* Read chunk from jitter buffer */
-            uint32_t read = jitter_buffer_read(chunk, PLAYBACK_CHUNK_SIZE);
-            
-            if (read == PLAYBACK_CHUNK_SIZE) {
-                /* Play PCM data through speaker */
-                /* tdl_audio_play() should block until audio buffer has space */
-                rt = tdl_audio_play(g_audio_hdl, chunk, PLAYBACK_CHUNK_SIZE);
-                if (rt != OPRT_OK) {
-                    g_play_errors++;
-                    if (g_play_errors % 100 == 1) {
-                        PR_WARN("[SPEAKER] Play error #%u: %d", g_play_errors, rt);
-                    }
-                } else {
-                    chunks_played++;
-                    if (chunks_played % 500 == 0) {
-                        PR_DEBUG("[SPEAKER] Played %u chunks, buffer: %u bytes", 
-                                 chunks_played, jitter_buffer_level());
-                    }
+        /* Timer: NAT keepalive */
+        if ((int32_t)(now - next_ping) >= 0) {
+            speaker_keepalive_ping();
+            next_ping = now + NAT_KEEPALIVE_MS;
+        }
+        
+        /* Don't wait while playing: the driver is the clock then */
+        tal_net_fd_zero(&rfds);
+        tal_net_fd_set(g_udp_socket, &rfds);
+        int actv = tal_net_select(g_udp_socket + 1, &rfds, NULL, NULL,
+                                  g_playback_started ? 0 : SPEAKER_LOOP_IDLE_MS);
+        
+        if (actv > 0 && tal_net_fd_isset(g_udp_socket, &rfds)) {
+            /* Drain what's queued, bounded so playback isn't starved */
+            for (int i = 0; i < SPEAKER_LOOP_MAX_RX; i++) {
+                TUYA_ERRNO len = tal_net_recvfrom_buf(g_udp_socket, &rx, &addr, &port);
+                if (len <= 0) {
+                    break;
                 }
-                /* No sleep needed - tdl_audio_play should pace itself */
+                speaker_rx_packet(rx.data, rx.len);
+                tal_net_rx_buf_release(&rx);
             }
         } else {
-            /* Buffer underrun - wait for more data instead of playing silence */
-            g_underruns++;
-            if (g_underruns % 100 == 1) {
-                PR_WARN("[SPEAKER] Buffer underrun #%u (only %u bytes available)", 
-                        g_underruns, level);
-            }
-            
-            /* Wait for more data to arrive */
-            tal_system_sleep(PLAYBACK_INTERVAL_MS);
+            speaker_rx_idle();
+        }
+        
+        if (!g_playback_started && speaker_prefill_ready()) {
+            speaker_playback_begin();
+        }
+        if (g_playback_started) {
+            speaker_playback_step(chunk);
         }
-        /* No sleep here - let audio driver pace the playback */
     }
+    
+    PR_INFO("[SPEAKER] Speaker loop stopped (played %u chunks, sent %u pings)", g_chunks_played, g_pings_sent);
+}
+#endif
 
-    PR_INFO("[SPEAKER] Playback task stopped (played %u chunks)", chunks_played);
+/**
+ * @brief Server settings changed: re-point pings at the new host
+ *
+ * The socket, jitter buffer and decoder stay up; the first ping opens the
+ * NAT path to the new server, which starts sending to it.
+ */
+static int speaker_config_change_cb(void *data)
+{
+    const BLE_CONFIG_TCP_T *cfg = (const BLE_CONFIG_TCP_T *)data;
+    TUYA_IP_ADDR_T addr = 0;
+    
+    if (cfg == NULL || cfg->host == NULL || !g_speaker_active) {
+        return OPRT_OK;
+    }
+    if (net_resolve_host(cfg->host, &addr) != OPRT_OK || addr == 0) {
+        PR_ERR("[SPEAKER] Failed to resolve VPS address: %s", cfg->host);
+        return OPRT_COM_ERROR;
+    }
+    
+    strncpy(g_vps_host, cfg->host, sizeof(g_vps_host) - 1);
+    g_vps_host[sizeof(g_vps_host) - 1] = '\0';
+    g_vps_addr = addr;
+    PR_NOTICE("[SPEAKER] VPS moved to %s -> %s", g_vps_host, tal_net_addr2str(g_vps_addr));
+    
+    speaker_send_ping();
+    return OPRT_OK;
 }
 
 /**
@@ -319,54 +1125,70 @@ OPERATE_RET speaker_streaming_init(const char *host)
         return OPRT_OK;
     }
 
+    if (g_rx_mutex == NULL) {
+        rt = tal_mutex_create_init(&g_rx_mutex);
+        if (rt != OPRT_OK) {
+            PR_ERR("[SPEAKER] Failed to create rx mutex: %d", rt);
+            return rt;
+        }
+        TUYA_CALL_ERR_LOG(tal_event_subscribe(EVENT_TCP_CONFIG_CHG, "speaker_streaming", speaker_config_change_cb,
+                                              SUBSCRIBE_TYPE_NORMAL));
+    }
+
     /* Store the VPS host for later use */
     strncpy(g_vps_host, host, sizeof(g_vps_host) - 1);
     g_vps_host[sizeof(g_vps_host) - 1] = '\0';
 
-    PR_INFO("[SPEAKER] Initializing with jitter buffer (%u bytes, prefill %u bytes)...",
-            JITTER_BUFFER_SIZE, PREFILL_THRESHOLD);
-
-    /* Create buffer mutex */
-    rt = tal_mutex_create_init(&g_buf_mutex);
-    if (rt != OPRT_OK) {
-        PR_ERR("[SPEAKER] Failed to create mutex: %d", rt);
-        return rt;
-    }
+    PR_INFO("[SPEAKER] Initializing with jitter buffer (%u bytes, adaptive delay %u-%ums)...",
+            JITTER_BUFFER_SIZE, JB_TARGET_MIN_MS, JB_TARGET_MAX_MS);
 
-    /* Reset buffer state */
+    /* Reset buffer state (no task is running yet) */
     g_buf_head = 0;
     g_buf_tail = 0;
-    g_buf_count = 0;
     g_playback_started = false;
+    g_target_ms = JB_TARGET_MIN_MS;
+    g_last_arrival_ms = 0;
+    g_jitter_q4 = 0;
+    g_decay_count = 0;
+    g_seq_started = false;
+    g_held = 0;
+    g_plc_len = 0;
+    g_plc_run = 0;
+    memset(g_slots, 0, sizeof(g_slots));
     memset(g_jitter_buffer, 0, JITTER_BUFFER_SIZE);
 
     /* Use the host provided at init */
     PR_INFO("[SPEAKER] Using VPS host: %s", g_vps_host);
     
-    g_vps_addr = tal_net_str2addr(g_vps_host);
-    if (g_vps_addr == 0) {
-        rt = tal_net_gethostbyname(g_vps_host, &g_vps_addr);
-        if (rt != OPRT_OK || g_vps_addr == 0) {
-            PR_ERR("[SPEAKER] Failed to resolve VPS address: %s", g_vps_host);
-            tal_mutex_release(g_buf_mutex);
-            g_buf_mutex = NULL;
-            return OPRT_COM_ERROR;
-        }
+    g_vps_addr = 0;
+    rt = net_resolve_host(g_vps_host, &g_vps_addr);
+    if (rt != OPRT_OK || g_vps_addr == 0) {
+        PR_ERR("[SPEAKER] Failed to resolve VPS address: %s", g_vps_host);
+        return OPRT_COM_ERROR;
     }
     PR_INFO("[SPEAKER] VPS address: %s -> %s", g_vps_host, tal_net_addr2str(g_vps_addr));
 
+    /* Opus downlink is optional, PCM and G.711 always decode */
+    if (opus_codec_is_supported() && g_opus_dec == NULL) {
+        if (opus_codec_decoder_create(16000, 1, &g_opus_dec) == OPRT_OK) {
+            g_pref_codec = SPEAKER_CODEC_OPUS;
+        }
+    }
+    g_rx_codec = UDP_AUDIO_CODEC_PCM;
+    
     /* Create UDP socket */
     g_udp_socket = tal_net_socket_create(PROTOCOL_UDP);
     if (g_udp_socket < 0) {
         PR_ERR("[SPEAKER] Failed to create UDP socket");
-        tal_mutex_release(g_buf_mutex);
-        g_buf_mutex = NULL;
         return OPRT_COM_ERROR;
     }
 
     /* Set socket receive timeout */
     tal_net_set_timeout(g_udp_socket, RECV_TIMEOUT_MS, TRANS_RECV);
 
+    /* NAT pings go out in the WMM voice queue, keeping its mapping as voice */
+    tal_net_set_ac(g_udp_socket, TAL_NET_AC_VO);
+
     /* Bind to local port */
     rt = tal_net_bind(g_udp_socket, TY_IPADDR_ANY, SPEAKER_UDP_PORT);
     if (rt != OPRT_OK) {
@@ -376,9 +1198,25 @@ OPERATE_RET speaker_streaming_init(const char *host)
     /* Mark as active */
     g_speaker_active = true;
     
+#if SPEAKER_SINGLE_THREAD
+    /* Reads happen only after select() said so, never block in them */
+    tal_net_set_block(g_udp_socket, FALSE);
+    
+    THREAD_CFG_T loop_cfg = {
+        .stackDepth = 8192,         /* Opus decoding runs on this stack */
+        .priority = THREAD_PRIO_2,
+        .thrdname = "spk_loop"
+    };
+    rt = tal_thread_create_and_start(&g_loop_thread, NULL, NULL, 
+                                      speaker_loop_task, NULL, &loop_cfg);
+    if (rt != OPRT_OK) {
+        PR_ERR("[SPEAKER] Failed to create speaker loop thread: %d", rt);
+        goto cleanup;
+    }
+#else
     /* Start receiver thread */
     THREAD_CFG_T rx_cfg = {
-        .stackDepth = 4096,
+        .stackDepth = 8192,         /* Opus decoding runs on this stack */
         .priority = THREAD_PRIO_2,  /* Higher priority for receiving */
         .thrdname = "spk_rx"
     };
@@ -414,9 +1252,11 @@ OPERATE_RET speaker_streaming_init(const char *host)
         PR_WARN("[SPEAKER] Failed to create keepalive thread: %d", rt);
     }
 
+#endif
+
     PR_NOTICE("[SPEAKER] Speaker streaming initialized!");
-    PR_NOTICE("[SPEAKER] Config: %ukHz/16bit/mono, %ums chunks, %ums prefill", 
-              16, PLAYBACK_INTERVAL_MS, PREFILL_THRESHOLD / 32);
+    PR_NOTICE("[SPEAKER] Config: %ukHz/16bit/mono, %ums chunks, %u-%ums adaptive delay, preferred codec %u", 
+              16, PLAYBACK_INTERVAL_MS, JB_TARGET_MIN_MS, JB_TARGET_MAX_MS, g_pref_codec);
     
     return OPRT_OK;
 
@@ -426,10 +1266,6 @@ cleanup:
         tal_net_close(g_udp_socket);
         g_udp_socket = -1;
     }
-    if (g_buf_mutex) {
-        tal_mutex_release(g_buf_mutex);
-        g_buf_mutex = NULL;
-    }
     return rt;
 }
 
@@ -465,19 +1301,39 @@ OPERATE_RET speaker_streaming_stop(void)
         tal_thread_delete(g_keepalive_thread);
         g_keepalive_thread = NULL;
     }
-
-    /* Release mutex */
-    if (g_buf_mutex) {
-        tal_mutex_release(g_buf_mutex);
-        g_buf_mutex = NULL;
+    if (g_loop_thread) {
+        tal_thread_delete(g_loop_thread);
+        g_loop_thread = NULL;
+    }
+    
+    opus_codec_decoder_destroy(g_opus_dec);
+    g_opus_dec = NULL;
+    
+    /* Drop talk-back still queued in the mixer */
+    if (g_mix_open) {
+        ai_audio_player_mix_stop(g_mix_stream);
     }
 
-    PR_INFO("[SPEAKER] Stopped. Stats: RX %u pkts/%u bytes, underruns %u, overruns %u, errors %u",
-            g_packets_received, g_bytes_received, g_underruns, g_overruns, g_play_errors);
+    PR_INFO("[SPEAKER] Stopped. Stats: RX %u pkts/%u bytes, underruns %u, overruns %u, errors %u, "
+            "dropped %u, repeated %u, concealed %u, late %u, dup %u, decode errors %u",
+            g_packets_received, g_bytes_received, g_underruns, g_overruns, g_play_errors,
+            g_chunks_dropped, g_chunks_repeated, g_frames_concealed, g_packets_late, g_packets_dup,
+            g_decode_errors);
 
     return OPRT_OK;
 }
 
+/**
+ * @brief Feed one speaker datagram received over the TCP mux
+ */
+void speaker_streaming_feed(const uint8_t *data, uint32_t len)
+{
+    if (!g_speaker_active || data == NULL || len == 0 || len > PCM_BUF_SIZE) {
+        return;
+    }
+    speaker_rx_packet(data, len);
+}
+
 /**
  * @brief Check if speaker streaming is active
  */
@@ -495,3 +1351,61 @@ void speaker_streaming_get_stats(uint32_t *packets, uint32_t *bytes, uint32_t *e
     if (bytes) *bytes = g_bytes_received;
     if (errors) *errors = g_play_errors;
 }
+
+/**
+ * @brief Set the preferred talk-back codec
+ */
+OPERATE_RET speaker_streaming_set_codec(SPEAKER_CODEC_E codec)
+{
+    if (codec >= SPEAKER_CODEC_MAX) {
+        return OPRT_INVALID_PARM;
+    }
+    if (codec == SPEAKER_CODEC_OPUS && !opus_codec_is_supported()) {
+        return OPRT_NOT_SUPPORTED;
+    }
+    
+    g_pref_codec = codec;
+    PR_INFO("[SPEAKER] Preferred downlink codec: %u", codec);
+    
+    /* Announce now instead of waiting for the next keepalive */
+    if (g_speaker_active) {
+        speaker_send_ping();
+    }
+    
+    return OPRT_OK;
+}
+
+/**
+ * @brief Set the preferred PCM/G.711 talk-back rate
+ */
+OPERATE_RET speaker_streaming_set_rate(uint32_t rate)
+{
+    if (rate != 16000 && rate != 24000 && rate != 48000) {
+        return OPRT_NOT_SUPPORTED;
+    }
+    
+    g_pref_rate = rate;
+    PR_INFO("[SPEAKER] Preferred downlink rate: %u", rate);
+    
+    if (g_speaker_active) {
+        speaker_send_ping();
+    }
+    
+    return OPRT_OK;
+}
+
+/**
+ * @brief Get the preferred PCM/G.711 talk-back rate
+ */
+uint32_t speaker_streaming_get_rate(void)
+{
+    return g_pref_rate;
+}
+
+/**
+ * @brief Get the preferred talk-back codec
+ */
+SPEAKER_CODEC_E speaker_streaming_get_codec(void)
+{
+    return g_pref_codec;
+}
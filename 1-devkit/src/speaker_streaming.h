@@ -15,10 +15,21 @@
 extern "C" {
 #endif
 
+/**
+ * @brief Downlink codec, values match the CODEC byte of the speaker packet header
+ */
+typedef enum {
+    SPEAKER_CODEC_PCM = 0,      /* Raw PCM 16-bit (640 bytes / 20ms) */
+    SPEAKER_CODEC_G711_ULAW,    /* G.711 u-law (320 bytes / 20ms) */
+    SPEAKER_CODEC_OPUS,         /* Opus, decoded on device (only with ENABLE_OPUS_CODEC=1) */
+    SPEAKER_CODEC_MAX
+} SPEAKER_CODEC_E;
+
 /**
  * @brief Initialize speaker streaming module
  *
- * Creates UDP socket on port 5002 and starts receiver thread.
+ * Creates UDP socket on port 5002 and starts the receiver, playback and
+ * keepalive threads (a single thread with SPEAKER_SINGLE_THREAD=1).
  * Audio received will be played through the DevKit speaker.
  *
  * @param host VPS server host (IP or hostname) for NAT hole punching
@@ -40,6 +51,57 @@ OPERATE_RET speaker_streaming_stop(void);
  */
 bool speaker_streaming_is_active(void);
 
+/**
+ * @brief Set the codec the server should use for talk-back audio
+ *
+ * The NAT keepalive ping advertises the decodable codecs and this preference
+ * ([0xFE][CAPS:1][PREFERRED:1][RATE_KHZ:1], CAPS bit n = codec n); a new preference is
+ * announced at once. Whatever codec a packet carries is decoded, so the
+ * server may still fall back to PCM. Default: Opus when compiled in, else G.711.
+ *
+ * @param codec Preferred codec
+ * @return OPRT_OK, OPRT_NOT_SUPPORTED for Opus without ENABLE_OPUS_CODEC,
+ *         OPRT_INVALID_PARM for an unknown codec
+ */
+OPERATE_RET speaker_streaming_set_codec(SPEAKER_CODEC_E codec);
+
+/**
+ * @brief Get the preferred talk-back codec
+ *
+ * @return Preferred codec
+ */
+SPEAKER_CODEC_E speaker_streaming_get_codec(void);
+
+/**
+ * @brief Set the sample rate the server should use for PCM/G.711 talk-back
+ *
+ * Advertised as RATE_KHZ in the NAT ping. Frames at any supported rate are
+ * accepted regardless (the rate follows from the frame length) and
+ * resampled to the 16kHz playback rate; 48kHz works for G.711 only, since
+ * a 48kHz PCM frame does not fit one datagram. Opus is not affected.
+ *
+ * @param rate 16000, 24000 or 48000
+ * @return OPRT_OK, OPRT_NOT_SUPPORTED for other rates
+ */
+OPERATE_RET speaker_streaming_set_rate(uint32_t rate);
+
+/**
+ * @brief Get the preferred PCM/G.711 talk-back rate
+ *
+ * @return Rate in Hz
+ */
+uint32_t speaker_streaming_get_rate(void);
+
+/**
+ * @brief Feed one datagram that arrived over the TCP mux (CMD_STREAM_SPEAKER)
+ *
+ * Handled exactly like a packet received on UDP port 5002.
+ *
+ * @param data Datagram
+ * @param len Datagram length
+ */
+void speaker_streaming_feed(const uint8_t *data, uint32_t len);
+
 /**
  * @brief Get speaker streaming statistics
  *
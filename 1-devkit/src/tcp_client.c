@@ -5,20 +5,78 @@
  * Connects to a local server and exchanges messages with the web UI.
  * Protocol: [LENGTH:4 bytes LE][DATA:N bytes]
  *
+ * The receiver reads whatever the socket has into one buffer and parses
+ * frames out of it incrementally, so headers and bodies may be split across
+ * reads or several frames may arrive in one. Complete frames are handed to
+ * the callback in place (NUL-terminated, no copy); the buffer grows for
+ * frames larger than its initial size.
+ *
+ * Sending never touches the socket: tcp_client_send() frames the message
+ * into a bounded ring and a writer task drains it, handing everything
+ * queued (several messages, header and body together) to one send call.
+ * When the ring is full the message is dropped and counted instead of
+ * blocking the caller.
+ *
+ * Liveness: the socket has TCP keepalive enabled, and the device sends an
+ * application heartbeat "hb:<seq>" every TCP_HEARTBEAT_MS. A server that
+ * answers "hb_ack:<seq>" gets RTT measurement and dead-peer detection: no
+ * bytes for TCP_DEAD_PEER_MS drops the connection. Servers that never
+ * acknowledge are covered by keepalive alone.
+ *
+ * Clock sync: the server may probe the device clock NTP style with
+ * "tsync:<t1>", answered at once from the receiver with
+ * "tsync_ack:<t1>,<t2>,<t3>" (t1 echoed verbatim, t2/t3 receive and reply
+ * time on av_clock). The server reads t4 on arrival and takes
+ * offset = ((t2 - t1) + (t3 - t4)) / 2 from the probe with the smallest
+ * delay (t4 - t1) - (t3 - t2), which maps mic capture timestamps onto its
+ * own clock.
+ *
  * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
  */
 
 #include "tcp_client.h"
+#include "ble_config.h"
+#include "net_resolve.h"
+#include "av_clock.h"
+#include "netmgr.h"
 #include "tal_api.h"
 #include "tal_network.h"
+#include <stdlib.h>
 #include <string.h>
 
 /***********************************************************
 ************************macro define************************
 ***********************************************************/
-#define TCP_RECV_BUF_SIZE       2048
-#define TCP_RECONNECT_DELAY_MS  5000
-#define TCP_RECV_TIMEOUT_MS     5000   /* 5 seconds - long enough to not spam, short enough to detect disconnect */
+#define TCP_RECV_BUF_SIZE       2048            /* Initial receive buffer */
+#define TCP_MAX_FRAME_SIZE      (32 * 1024)     /* Larger frames are skipped */
+#define TCP_FRAME_HEADER_SIZE   4
+#define TCP_BUF_GROW_ALIGN      1024
+#define TCP_RECONNECT_MIN_MS    1000   /* First retry, doubled on every failure */
+#define TCP_RECONNECT_MAX_MS    60000
+#define TCP_RECV_TIMEOUT_MS     250    /* Receiver wakes up at least this often for the heartbeat */
+#ifndef TCP_KEEPALIVE_IDLE_S
+#define TCP_KEEPALIVE_IDLE_S    5      /* Idle time before the first keepalive probe */
+#endif
+#ifndef TCP_KEEPALIVE_INTVL_S
+#define TCP_KEEPALIVE_INTVL_S   2
+#endif
+#ifndef TCP_KEEPALIVE_CNT
+#define TCP_KEEPALIVE_CNT       3
+#endif
+#ifndef TCP_HEARTBEAT_MS
+#define TCP_HEARTBEAT_MS        500
+#endif
+#ifndef TCP_DEAD_PEER_MS
+#define TCP_DEAD_PEER_MS        1500   /* Silence from a heartbeat-capable server */
+#endif
+#define TCP_HB_ACK_PREFIX       "hb_ack:"
+#define TCP_TSYNC_PREFIX        "tsync:"
+#define TCP_TSYNC_T1_MAX        24     /* Longest server timestamp echoed back */
+#define TCP_SEND_TIMEOUT_MS     3000   /* Writer gives up on a stalled uplink */
+#define TCP_TX_DRAIN_POLL_MS    10     /* Disconnect polls for the writer to leave its send */
+#define TCP_TX_QUEUE_SIZE       8192   /* Send ring, power of two */
+#define TCP_TX_WAIT_MS          100
+#define TCP_TX_DGRAM_RESERVE    (TCP_TX_QUEUE_SIZE / 2)  /* Datagrams never fill the ring past this */
 
 /***********************************************************
 ***********************typedef define***********************
@@ -26,13 +84,43 @@
 typedef struct {
     char host[64];
     uint16_t port;
+    char next_host[64];      /* Endpoint from a config change, applied by the receiver */
+    uint16_t next_port;
+    bool reload;
     int socket_fd;
     bool connected;
     bool running;
+    uint32_t backoff_ms;     /* Current reconnect backoff ceiling */
+    SEM_HANDLE wake_sem;     /* Cuts a backoff wait short on link-up */
     THREAD_HANDLE thread;
     MUTEX_HANDLE mutex;
     tcp_client_recv_cb_t recv_cb;
-    uint8_t recv_buf[TCP_RECV_BUF_SIZE];
+    tcp_client_state_cb_t state_cb;
+    SYS_TIME_T last_rx_ms;   /* Last bytes from the server */
+    uint32_t last_rx_us;     /* Same on av_clock, receive time of "tsync" probes */
+    SYS_TIME_T hb_sent_ms;   /* When heartbeat hb_seq went out, 0 once acknowledged */
+    SYS_TIME_T hb_last_ms;   /* Last heartbeat attempt */
+    uint32_t hb_seq;
+    bool hb_capable;         /* Server acknowledged a heartbeat on this connection */
+    TCP_CLIENT_LINK_STATS_T link_stats;
+    uint8_t *rx_buf;         /* Receive buffer, rx_static or a grown heap copy */
+    uint32_t rx_cap;         /* Capacity, one byte always left for the NUL */
+    uint32_t rx_len;         /* Bytes buffered */
+    uint32_t rx_pos;         /* Parse position */
+    uint32_t rx_skip;        /* Body bytes of an oversized frame still to discard */
+    bool rx_in_cb;           /* rx_buf[rx_pos] is the NUL of the frame being handled */
+    uint8_t rx_saved;        /* Byte the NUL replaced */
+    uint8_t rx_static[TCP_RECV_BUF_SIZE];
+    THREAD_HANDLE tx_thread;
+    MUTEX_HANDLE tx_mutex;   /* Guards the send ring indices, never held across a send */
+    SEM_HANDLE tx_sem;
+    uint32_t tx_head;        /* Free running write index */
+    uint32_t tx_tail;        /* Free running read index */
+    uint32_t tx_epoch;       /* Bumped when the ring is flushed on disconnect */
+    bool tx_error;           /* Writer hit a send error, receiver reconnects */
+    bool tx_sending;         /* Writer is inside tal_net_send(), the socket must stay open */
+    TCP_CLIENT_TX_STATS_T tx_stats;
+    uint8_t tx_ring[TCP_TX_QUEUE_SIZE];
 } tcp_client_ctx_t;
 
 /***********************************************************
@@ -60,10 +148,17 @@ static OPERATE_RET connect_to_server(void)
     
     /* Set socket timeout */
     tal_net_set_timeout(g_ctx.socket_fd, TCP_RECV_TIMEOUT_MS, TRANS_RECV);
+    tal_net_set_timeout(g_ctx.socket_fd, TCP_SEND_TIMEOUT_MS, TRANS_SEND);
     
-    /* Resolve host to IP */
-    TUYA_IP_ADDR_T addr = tal_net_str2addr(g_ctx.host);
-    if (addr == 0) {
+    /* Let the stack notice a vanished peer even when nothing is sent */
+    if (tal_net_set_keepalive(g_ctx.socket_fd, TRUE, TCP_KEEPALIVE_IDLE_S, TCP_KEEPALIVE_INTVL_S,
+                              TCP_KEEPALIVE_CNT) != OPRT_OK) {
+        PR_WARN("Failed to enable TCP keepalive");
+    }
+    
+    /* Resolve host to IP (names are cached, shared with the UDP streams) */
+    TUYA_IP_ADDR_T addr = 0;
+    if (net_resolve_host(g_ctx.host, &addr) != OPRT_OK || addr == 0) {
         PR_ERR("Failed to resolve host: %s", g_ctx.host);
         tal_net_close(g_ctx.socket_fd);
         g_ctx.socket_fd = -1;
@@ -74,12 +169,18 @@ static OPERATE_RET connect_to_server(void)
     rt = tal_net_connect(g_ctx.socket_fd, addr, g_ctx.port);
     if (rt != OPRT_OK) {
         PR_ERR("Failed to connect to %s:%d (err: %d)", g_ctx.host, g_ctx.port, rt);
+        /* The server may have moved, look it up again next time */
+        net_resolve_invalidate(g_ctx.host);
         tal_net_close(g_ctx.socket_fd);
         g_ctx.socket_fd = -1;
         return rt;
     }
     
     g_ctx.connected = true;
+    g_ctx.last_rx_ms = tal_system_get_millisecond();
+    g_ctx.hb_sent_ms = 0;
+    g_ctx.hb_capable = false;
+    g_ctx.link_stats.connects++;
     PR_NOTICE("Connected to server %s:%d", g_ctx.host, g_ctx.port);
     
     /* Send authentication message */
@@ -93,6 +194,10 @@ static OPERATE_RET connect_to_server(void)
     PR_WARN("Using default auth token - please set TCP_AUTH_TOKEN in .env");
 #endif
     
+    if (g_ctx.state_cb) {
+        g_ctx.state_cb(true);
+    }
+    
     return OPRT_OK;
 }
 
@@ -101,37 +206,408 @@ static OPERATE_RET connect_to_server(void)
  */
 static void disconnect_from_server(void)
 {
-    if (g_ctx.socket_fd >= 0) {
-        tal_net_close(g_ctx.socket_fd);
+    bool was_connected = g_ctx.connected;
+    int fd = g_ctx.socket_fd;
+    
+    /* Queued messages belong to the old connection. A send in flight keeps
+     * the fd open until it returns (bounded by TCP_SEND_TIMEOUT_MS), the next
+     * socket may get the same number and must not see the old bytes */
+    if (g_ctx.tx_mutex) {
+        tal_mutex_lock(g_ctx.tx_mutex);
         g_ctx.socket_fd = -1;
+        g_ctx.connected = false;
+        g_ctx.tx_head = 0;
+        g_ctx.tx_tail = 0;
+        g_ctx.tx_epoch++;
+        g_ctx.tx_error = false;
+        while (g_ctx.tx_sending) {
+            tal_mutex_unlock(g_ctx.tx_mutex);
+            tal_system_sleep(TCP_TX_DRAIN_POLL_MS);
+            tal_mutex_lock(g_ctx.tx_mutex);
+        }
+        tal_mutex_unlock(g_ctx.tx_mutex);
+    }
+    
+    if (fd >= 0) {
+        tal_net_close(fd);
     }
+    g_ctx.socket_fd = -1;
     g_ctx.connected = false;
+    g_ctx.hb_capable = false;
+    
+    /* Partial frames are worthless on a new connection */
+    if (g_ctx.rx_buf && g_ctx.rx_buf != g_ctx.rx_static) {
+        tal_free(g_ctx.rx_buf);
+    }
+    g_ctx.rx_buf = g_ctx.rx_static;
+    g_ctx.rx_cap = sizeof(g_ctx.rx_static);
+    g_ctx.rx_len = 0;
+    g_ctx.rx_pos = 0;
+    g_ctx.rx_skip = 0;
+    
+    if (was_connected && g_ctx.state_cb) {
+        g_ctx.state_cb(false);
+    }
+}
+
+/**
+ * @brief Consume a heartbeat acknowledgement
+ *
+ * @return true if msg was "hb_ack:<seq>" (not passed to the app)
+ */
+static bool heartbeat_ack(const char *msg, uint32_t len)
+{
+    uint32_t prefix = sizeof(TCP_HB_ACK_PREFIX) - 1;
+    if (len <= prefix || strncmp(msg, TCP_HB_ACK_PREFIX, prefix) != 0) {
+        return false;
+    }
+    
+    uint32_t seq = (uint32_t)strtoul(msg + prefix, NULL, 10);
+    g_ctx.hb_capable = true;
+    g_ctx.link_stats.heartbeats_acked++;
+    if (seq == g_ctx.hb_seq && g_ctx.hb_sent_ms) {
+        uint32_t rtt = (uint32_t)(tal_system_get_millisecond() - g_ctx.hb_sent_ms);
+        g_ctx.link_stats.rtt_last_ms = rtt;
+        /* Smoothed 1/8 like the TCP SRTT */
+        if (g_ctx.link_stats.rtt_avg_ms == 0) {
+            g_ctx.link_stats.rtt_avg_ms = rtt;
+        } else {
+            g_ctx.link_stats.rtt_avg_ms = (g_ctx.link_stats.rtt_avg_ms * 7 + rtt) / 8;
+        }
+        if (rtt > g_ctx.link_stats.rtt_max_ms) {
+            g_ctx.link_stats.rtt_max_ms = rtt;
+        }
+        g_ctx.hb_sent_ms = 0;
+    }
+    return true;
+}
+
+/**
+ * @brief Answer a clock offset probe
+ *
+ * @return true if msg was "tsync:<t1>" (not passed to the app)
+ */
+static bool tsync_reply(const char *msg, uint32_t len)
+{
+    uint32_t prefix = sizeof(TCP_TSYNC_PREFIX) - 1;
+    if (len <= prefix || strncmp(msg, TCP_TSYNC_PREFIX, prefix) != 0) {
+        return false;
+    }
+    
+    char reply[64];
+    uint32_t t1_len = len - prefix;
+    snprintf(reply, sizeof(reply), "tsync_ack:%.*s,%u,%u", (int)(t1_len > TCP_TSYNC_T1_MAX ? TCP_TSYNC_T1_MAX : t1_len),
+             msg + prefix, g_ctx.last_rx_us, av_clock_now_us32());
+    tcp_client_send_str(reply);
+    g_ctx.link_stats.tsync_probes++;
+    return true;
+}
+
+/**
+ * @brief Send the periodic heartbeat and check the peer is still there
+ *
+ * @return OPRT_OK, or OPRT_TIMEOUT when a heartbeat-capable server went silent
+ */
+static OPERATE_RET heartbeat_poll(void)
+{
+    SYS_TIME_T now = tal_system_get_millisecond();
+    
+    if (g_ctx.hb_capable && now - g_ctx.last_rx_ms > TCP_DEAD_PEER_MS) {
+        g_ctx.link_stats.dead_peer_events++;
+        PR_WARN("No data from server for %u ms, connection is dead", (uint32_t)(now - g_ctx.last_rx_ms));
+        return OPRT_TIMEOUT;
+    }
+    
+    /* One heartbeat in flight; an unanswered one is replaced after the interval */
+    if (now - g_ctx.hb_last_ms >= TCP_HEARTBEAT_MS) {
+        char hb[20];
+        g_ctx.hb_last_ms = now;
+        snprintf(hb, sizeof(hb), "hb:%u", ++g_ctx.hb_seq);
+        if (tcp_client_send_str(hb) == OPRT_OK) {
+            g_ctx.hb_sent_ms = now;
+            g_ctx.link_stats.heartbeats_sent++;
+        }
+    }
+    return OPRT_OK;
+}
+
+/**
+ * @brief Grow the receive buffer so a frame of size bytes fits (rx_pos must be 0)
+ */
+static OPERATE_RET rx_buf_reserve(uint32_t size)
+{
+    if (size + 1 <= g_ctx.rx_cap) {
+        return OPRT_OK;
+    }
+    
+    uint32_t cap = (size + 1 + TCP_BUF_GROW_ALIGN - 1) & ~(TCP_BUF_GROW_ALIGN - 1);
+    uint8_t *buf = tal_malloc(cap);
+    if (buf == NULL) {
+        PR_ERR("No memory for a %u byte frame", size);
+        return OPRT_MALLOC_FAILED;
+    }
+    
+    memcpy(buf, g_ctx.rx_buf, g_ctx.rx_len);
+    if (g_ctx.rx_buf != g_ctx.rx_static) {
+        tal_free(g_ctx.rx_buf);
+    }
+    g_ctx.rx_buf = buf;
+    g_ctx.rx_cap = cap;
+    PR_DEBUG("TCP receive buffer grown to %u bytes", cap);
+    
+    return OPRT_OK;
+}
+
+/**
+ * @brief Dispatch every complete frame in the receive buffer
+ */
+static void rx_parse_frames(void)
+{
+    while (g_ctx.rx_pos < g_ctx.rx_len) {
+        uint32_t avail = g_ctx.rx_len - g_ctx.rx_pos;
+        
+        /* Discarding the body of an oversized frame */
+        if (g_ctx.rx_skip > 0) {
+            uint32_t n = (g_ctx.rx_skip < avail) ? g_ctx.rx_skip : avail;
+            g_ctx.rx_pos += n;
+            g_ctx.rx_skip -= n;
+            continue;
+        }
+        
+        if (avail < TCP_FRAME_HEADER_SIZE) {
+            break;
+        }
+        
+        /* Parse message length (little-endian) */
+        const uint8_t *hdr = g_ctx.rx_buf + g_ctx.rx_pos;
+        uint32_t msg_len = hdr[0] | (hdr[1] << 8) | (hdr[2] << 16) | ((uint32_t)hdr[3] << 24);
+        
+        if (msg_len == 0 || msg_len > TCP_MAX_FRAME_SIZE) {
+            PR_WARN("Invalid message length: %u", msg_len);
+            g_ctx.rx_pos += TCP_FRAME_HEADER_SIZE;
+            g_ctx.rx_skip = msg_len;
+            continue;
+        }
+        
+        if (avail - TCP_FRAME_HEADER_SIZE < msg_len) {
+            /* Body still incomplete */
+            break;
+        }
+        
+        /* Null-terminate in place for string handling; rx_cap keeps room for it */
+        char *msg = (char *)g_ctx.rx_buf + g_ctx.rx_pos + TCP_FRAME_HEADER_SIZE;
+        g_ctx.rx_pos += TCP_FRAME_HEADER_SIZE + msg_len;
+        g_ctx.rx_saved = (uint8_t)msg[msg_len];
+        msg[msg_len] = '\0';
+        
+        if (heartbeat_ack(msg, msg_len) || tsync_reply(msg, msg_len)) {
+            msg[msg_len] = (char)g_ctx.rx_saved;
+            continue;
+        }
+        
+        PR_INFO("Received from server (%u bytes): %.*s", msg_len, (int)(msg_len > 64 ? 64 : msg_len), msg);
+        
+        /* Call callback */
+        if (g_ctx.recv_cb) {
+            g_ctx.rx_in_cb = true;
+            g_ctx.recv_cb((const char *)msg, msg_len);
+            g_ctx.rx_in_cb = false;
+        }
+        msg[msg_len] = (char)g_ctx.rx_saved;
+    }
+    
+    /* Move the partial frame to the front */
+    if (g_ctx.rx_pos > 0) {
+        memmove(g_ctx.rx_buf, g_ctx.rx_buf + g_ctx.rx_pos, g_ctx.rx_len - g_ctx.rx_pos);
+        g_ctx.rx_len -= g_ctx.rx_pos;
+        g_ctx.rx_pos = 0;
+    }
+    
+    /* Make room for a large frame whose header is already here */
+    if (g_ctx.rx_skip == 0 && g_ctx.rx_len >= TCP_FRAME_HEADER_SIZE) {
+        const uint8_t *hdr = g_ctx.rx_buf;
+        uint32_t msg_len = hdr[0] | (hdr[1] << 8) | (hdr[2] << 16) | ((uint32_t)hdr[3] << 24);
+        if (rx_buf_reserve(TCP_FRAME_HEADER_SIZE + msg_len) != OPRT_OK) {
+            /* Can't hold it: drop the frame instead of stalling the stream */
+            g_ctx.rx_skip = msg_len - (g_ctx.rx_len - TCP_FRAME_HEADER_SIZE);
+            g_ctx.rx_len = 0;
+        }
+    }
+}
+
+/**
+ * @brief Writer task: drains the send ring into the socket
+ */
+static void tcp_writer_task(void *arg)
+{
+    PR_INFO("TCP writer task started");
+    
+    while (g_ctx.running) {
+        tal_semaphore_wait(g_ctx.tx_sem, TCP_TX_WAIT_MS);
+        
+        for (;;) {
+            tal_mutex_lock(g_ctx.tx_mutex);
+            uint32_t queued = g_ctx.tx_head - g_ctx.tx_tail;
+            uint32_t offset = g_ctx.tx_tail & (TCP_TX_QUEUE_SIZE - 1);
+            uint32_t epoch = g_ctx.tx_epoch;
+            int fd = g_ctx.socket_fd;
+            bool ready = g_ctx.connected && !g_ctx.tx_error && fd >= 0;
+            /* Checked under the lock disconnect takes, so fd stays this connection's */
+            g_ctx.tx_sending = (queued != 0) && ready;
+            tal_mutex_unlock(g_ctx.tx_mutex);
+            
+            if (queued == 0 || !ready) {
+                break;
+            }
+            
+            /* Everything queued up to the ring wrap goes out in one send */
+            uint32_t chunk = TCP_TX_QUEUE_SIZE - offset;
+            if (chunk > queued) {
+                chunk = queued;
+            }
+            int sent = tal_net_send(fd, g_ctx.tx_ring + offset, chunk);
+            
+            tal_mutex_lock(g_ctx.tx_mutex);
+            g_ctx.tx_sending = false;
+            if (epoch == g_ctx.tx_epoch) {
+                if (sent > 0) {
+                    g_ctx.tx_tail += (uint32_t)sent;
+                    g_ctx.tx_stats.sends++;
+                } else {
+                    g_ctx.tx_error = true;
+                }
+            }
+            tal_mutex_unlock(g_ctx.tx_mutex);
+            
+            if (sent <= 0) {
+                PR_ERR("Send failed (errno: %d), dropping connection", tal_net_get_errno());
+                break;
+            }
+        }
+    }
+    
+    PR_INFO("TCP writer task stopped");
+}
+
+/**
+ * @brief Wait before the next connect attempt
+ *
+ * Exponential backoff with equal jitter: half the ceiling plus a random
+ * share of the other half, so devices that lost the server together do
+ * not come back in lockstep. A link-up event ends the wait early.
+ */
+static void tcp_reconnect_wait(void)
+{
+    if (g_ctx.backoff_ms < TCP_RECONNECT_MIN_MS) {
+        g_ctx.backoff_ms = TCP_RECONNECT_MIN_MS;
+    }
+    uint32_t half = g_ctx.backoff_ms / 2;
+    uint32_t delay = half + (uint32_t)tal_system_get_random(half + 1);
+    
+    PR_INFO("Reconnecting in %u ms", delay);
+    tal_semaphore_wait(g_ctx.wake_sem, delay);
+    
+    g_ctx.backoff_ms = (g_ctx.backoff_ms >= TCP_RECONNECT_MAX_MS / 2) ? TCP_RECONNECT_MAX_MS : g_ctx.backoff_ms * 2;
+}
+
+/**
+ * @brief Network link change: retry at once when the link comes back
+ */
+static int tcp_link_status_cb(void *data)
+{
+    netmgr_status_e status = (netmgr_status_e)(uintptr_t)data;
+    
+    if (status != NETMGR_LINK_DOWN && g_ctx.running && !g_ctx.connected) {
+        PR_INFO("Link up, reconnecting now");
+        g_ctx.backoff_ms = 0;
+        tal_semaphore_post(g_ctx.wake_sem);
+    }
+    return OPRT_OK;
+}
+
+/**
+ * @brief Server settings changed: move to the new endpoint without a reboot
+ *
+ * Runs on the publisher's thread; the receiver task does the switch.
+ */
+static int tcp_config_change_cb(void *data)
+{
+    const BLE_CONFIG_TCP_T *cfg = (const BLE_CONFIG_TCP_T *)data;
+    
+    if (cfg == NULL || cfg->host == NULL || cfg->host[0] == '\0') {
+        return OPRT_INVALID_PARM;
+    }
+    
+    tal_mutex_lock(g_ctx.mutex);
+    strncpy(g_ctx.next_host, cfg->host, sizeof(g_ctx.next_host) - 1);
+    g_ctx.next_host[sizeof(g_ctx.next_host) - 1] = '\0';
+    g_ctx.next_port = cfg->port;
+    g_ctx.reload = true;
+    tal_mutex_unlock(g_ctx.mutex);
+    
+    PR_NOTICE("TCP server changed to %s:%d, reconnecting", cfg->host, cfg->port);
+    g_ctx.backoff_ms = 0;
+    tal_semaphore_post(g_ctx.wake_sem);
+    return OPRT_OK;
+}
+
+/**
+ * @brief Apply a pending endpoint change, dropping the old connection
+ */
+static void tcp_apply_reload(void)
+{
+    if (!g_ctx.reload) {
+        return;
+    }
+    
+    tal_mutex_lock(g_ctx.mutex);
+    memcpy(g_ctx.host, g_ctx.next_host, sizeof(g_ctx.host));
+    g_ctx.port = g_ctx.next_port;
+    g_ctx.reload = false;
+    tal_mutex_unlock(g_ctx.mutex);
+    
+    if (g_ctx.connected) {
+        disconnect_from_server();
+    }
+    g_ctx.backoff_ms = 0;
 }
 
 /**
- * @brief Receiver task
+ * @brief Receiver task: connects, reads and parses frames
  */
 static void tcp_receiver_task(void *arg)
 {
     int recv_len;
-    uint8_t header[4];
-    uint32_t msg_len;
     
     PR_INFO("TCP client task started");
     
     while (g_ctx.running) {
+        tcp_apply_reload();
+        
+        /* The writer could not send, start over on a fresh socket */
+        if (g_ctx.tx_error) {
+            PR_WARN("Send path failed, reconnecting...");
+            disconnect_from_server();
+        }
+        
         /* Reconnect if disconnected */
         if (!g_ctx.connected) {
             PR_INFO("Attempting to connect to %s:%d...", g_ctx.host, g_ctx.port);
             
             if (connect_to_server() != OPRT_OK) {
-                tal_system_sleep(TCP_RECONNECT_DELAY_MS);
+                tcp_reconnect_wait();
                 continue;
             }
+            g_ctx.backoff_ms = 0;
+        }
+        
+        if (heartbeat_poll() != OPRT_OK) {
+            disconnect_from_server();
+            continue;
         }
         
-        /* Try to read message header (4 bytes = length) */
-        recv_len = tal_net_recv(g_ctx.socket_fd, header, 4);
+        /* Read whatever is available, frames are parsed out of the buffer */
+        recv_len = tal_net_recv(g_ctx.socket_fd, g_ctx.rx_buf + g_ctx.rx_len, g_ctx.rx_cap - 1 - g_ctx.rx_len);
         
         if (recv_len < 0) {
             /* Check specific error */
@@ -168,43 +644,10 @@ static void tcp_receiver_task(void *arg)
             continue;
         }
         
-        PR_DEBUG("TCP recv header: len=%d, bytes: %02X %02X %02X %02X", 
-                 recv_len, header[0], header[1], header[2], header[3]);
-        
-        if (recv_len < 4) {
-            /* Incomplete header, wait for more data */
-            PR_WARN("Incomplete header received: %d bytes", recv_len);
-            continue;
-        }
-        
-        /* Parse message length (little-endian) */
-        msg_len = header[0] | (header[1] << 8) | (header[2] << 16) | (header[3] << 24);
-        
-        if (msg_len == 0 || msg_len > TCP_RECV_BUF_SIZE - 1) {
-            PR_WARN("Invalid message length: %u", msg_len);
-            continue;
-        }
-        
-        PR_DEBUG("TCP expecting %u bytes of message body", msg_len);
-        
-        /* Read message body */
-        recv_len = tal_net_recv(g_ctx.socket_fd, g_ctx.recv_buf, msg_len);
-        
-        if (recv_len <= 0) {
-            PR_WARN("Failed to read message body (recv_len=%d)", recv_len);
-            disconnect_from_server();
-            continue;
-        }
-        
-        /* Null-terminate for string handling */
-        g_ctx.recv_buf[recv_len] = '\0';
-        
-        PR_INFO("Received from server: %s", g_ctx.recv_buf);
-        
-        /* Call callback */
-        if (g_ctx.recv_cb) {
-            g_ctx.recv_cb((const char *)g_ctx.recv_buf, recv_len);
-        }
+        g_ctx.last_rx_ms = tal_system_get_millisecond();
+        g_ctx.last_rx_us = av_clock_now_us32();
+        g_ctx.rx_len += recv_len;
+        rx_parse_frames();
     }
     
     disconnect_from_server();
@@ -221,8 +664,18 @@ OPERATE_RET tcp_client_init(const char *host, uint16_t port, tcp_client_recv_cb_
     g_ctx.port = port;
     g_ctx.socket_fd = -1;
     g_ctx.recv_cb = recv_cb;
+    g_ctx.rx_buf = g_ctx.rx_static;
+    g_ctx.rx_cap = sizeof(g_ctx.rx_static);
     
     TUYA_CALL_ERR_RETURN(tal_mutex_create_init(&g_ctx.mutex));
+    TUYA_CALL_ERR_RETURN(tal_mutex_create_init(&g_ctx.tx_mutex));
+    TUYA_CALL_ERR_RETURN(tal_semaphore_create_init(&g_ctx.tx_sem, 0, 1));
+    TUYA_CALL_ERR_RETURN(tal_semaphore_create_init(&g_ctx.wake_sem, 0, 1));
+    TUYA_CALL_ERR_LOG(tal_event_subscribe(EVENT_LINK_STATUS_CHG, "tcp_client", tcp_link_status_cb,
+                                          SUBSCRIBE_TYPE_NORMAL));
+    TUYA_CALL_ERR_LOG(tal_event_subscribe(EVENT_TCP_CONFIG_CHG, "tcp_client", tcp_config_change_cb,
+                                          SUBSCRIBE_TYPE_NORMAL));
+    g_ctx.tx_stats.capacity = TCP_TX_QUEUE_SIZE;
     (void)rt;  /* Suppress unused variable warning from macro */
     
     PR_INFO("TCP client initialized: %s:%d", host, port);
@@ -256,6 +709,21 @@ OPERATE_RET tcp_client_start(void)
         return rt;
     }
     
+    THREAD_CFG_T tx_cfg = {
+        .stackDepth = 2048,
+        .priority = THREAD_PRIO_3,
+        .thrdname = "tcp_tx"
+    };
+    
+    rt = tal_thread_create_and_start(&g_ctx.tx_thread, NULL, NULL,
+                                      tcp_writer_task, NULL, &tx_cfg);
+    
+    if (rt != OPRT_OK) {
+        PR_ERR("Failed to create TCP writer thread: %d", rt);
+        tcp_client_stop();
+        return rt;
+    }
+    
     PR_INFO("TCP client started");
     return OPRT_OK;
 }
@@ -263,6 +731,7 @@ OPERATE_RET tcp_client_start(void)
 void tcp_client_stop(void)
 {
     g_ctx.running = false;
+    tal_semaphore_post(g_ctx.wake_sem);
     
     disconnect_from_server();
     
@@ -271,6 +740,12 @@ void tcp_client_stop(void)
         g_ctx.thread = NULL;
     }
     
+    if (g_ctx.tx_thread) {
+        tal_semaphore_post(g_ctx.tx_sem);
+        tal_thread_delete(g_ctx.tx_thread);
+        g_ctx.tx_thread = NULL;
+    }
+    
     PR_INFO("TCP client stopped");
 }
 
@@ -279,40 +754,142 @@ bool tcp_client_is_connected(void)
     return g_ctx.connected;
 }
 
-OPERATE_RET tcp_client_send(const char *data, uint32_t len)
+/**
+ * @brief Copy bytes into the send ring at a free running index
+ */
+static void tx_ring_put(uint32_t index, const uint8_t *src, uint32_t len)
 {
-    if (!g_ctx.connected || g_ctx.socket_fd < 0) {
-        PR_WARN("Cannot send - not connected");
-        return OPRT_SOCK_ERR;
+    if (len == 0) {
+        return;
+    }
+    uint32_t offset = index & (TCP_TX_QUEUE_SIZE - 1);
+    uint32_t first = TCP_TX_QUEUE_SIZE - offset;
+    if (first > len) {
+        first = len;
+    }
+    memcpy(g_ctx.tx_ring + offset, src, first);
+    memcpy(g_ctx.tx_ring, src + first, len - first);
+}
+
+/**
+ * @brief Frame head+body as one message into the send ring
+ *
+ * @param reserve Ring space that must stay free after the message
+ */
+static OPERATE_RET tx_enqueue(const uint8_t *head, uint32_t head_len,
+                              const uint8_t *body, uint32_t body_len, uint32_t reserve)
+{
+    uint32_t len = head_len + body_len;
+    uint32_t frame_len = TCP_FRAME_HEADER_SIZE + len;
+    if (frame_len > TCP_TX_QUEUE_SIZE - reserve) {
+        PR_ERR("Message too large to queue (%u bytes)", len);
+        return OPRT_INVALID_PARM;
     }
     
-    tal_mutex_lock(g_ctx.mutex);
-    
-    /* Send header (length, little-endian) */
-    uint8_t header[4];
+    /* Header (length, little-endian) */
+    uint8_t header[TCP_FRAME_HEADER_SIZE];
     header[0] = len & 0xFF;
     header[1] = (len >> 8) & 0xFF;
     header[2] = (len >> 16) & 0xFF;
     header[3] = (len >> 24) & 0xFF;
     
-    int sent = tal_net_send(g_ctx.socket_fd, header, 4);
-    if (sent != 4) {
-        PR_ERR("Failed to send header");
-        tal_mutex_unlock(g_ctx.mutex);
-        return OPRT_SOCK_ERR;
+    tal_mutex_lock(g_ctx.tx_mutex);
+    
+    uint32_t queued = g_ctx.tx_head - g_ctx.tx_tail;
+    if (reserve > 0 && frame_len + reserve > TCP_TX_QUEUE_SIZE - queued) {
+        /* Congested: a late datagram is worse than a lost one */
+        g_ctx.tx_stats.dgram_dropped++;
+        tal_mutex_unlock(g_ctx.tx_mutex);
+        return OPRT_EXCEED_UPPER_LIMIT;
+    }
+    if (frame_len > TCP_TX_QUEUE_SIZE - queued) {
+        uint32_t dropped = ++g_ctx.tx_stats.dropped;
+        tal_mutex_unlock(g_ctx.tx_mutex);
+        if (dropped == 1 || dropped % 50 == 0) {
+            PR_WARN("TCP send queue full (%u bytes queued), dropped %u messages", queued, dropped);
+        }
+        return OPRT_EXCEED_UPPER_LIMIT;
+    }
+    
+    tx_ring_put(g_ctx.tx_head, header, TCP_FRAME_HEADER_SIZE);
+    tx_ring_put(g_ctx.tx_head + TCP_FRAME_HEADER_SIZE, head, head_len);
+    tx_ring_put(g_ctx.tx_head + TCP_FRAME_HEADER_SIZE + head_len, body, body_len);
+    g_ctx.tx_head += frame_len;
+    g_ctx.tx_stats.messages++;
+    if (queued + frame_len > g_ctx.tx_stats.high_water) {
+        g_ctx.tx_stats.high_water = queued + frame_len;
     }
     
-    /* Send data */
-    sent = tal_net_send(g_ctx.socket_fd, (void *)data, len);
-    if (sent != (int)len) {
-        PR_ERR("Failed to send data");
-        tal_mutex_unlock(g_ctx.mutex);
+    tal_mutex_unlock(g_ctx.tx_mutex);
+    
+    tal_semaphore_post(g_ctx.tx_sem);
+    return OPRT_OK;
+}
+
+OPERATE_RET tcp_client_send(const char *data, uint32_t len)
+{
+    if (!g_ctx.connected || g_ctx.socket_fd < 0 || g_ctx.tx_error) {
+        PR_WARN("Cannot send - not connected");
         return OPRT_SOCK_ERR;
     }
     
-    tal_mutex_unlock(g_ctx.mutex);
+    OPERATE_RET rt = tx_enqueue((const uint8_t *)data, len, NULL, 0, 0);
+    if (rt == OPRT_OK) {
+        PR_DEBUG("Queued to server: %.*s", len > 64 ? 64 : (int)len, data);
+    }
+    return rt;
+}
+
+OPERATE_RET tcp_client_send_datagram(const uint8_t *head, uint32_t head_len,
+                                     const uint8_t *body, uint32_t body_len)
+{
+    /* Real-time callers: no log, no wait */
+    if (!g_ctx.connected || g_ctx.socket_fd < 0 || g_ctx.tx_error) {
+        return OPRT_SOCK_ERR;
+    }
+    return tx_enqueue(head, head_len, body, body_len, TCP_TX_DGRAM_RESERVE);
+}
+
+void tcp_client_set_state_cb(tcp_client_state_cb_t state_cb)
+{
+    g_ctx.state_cb = state_cb;
+}
+
+OPERATE_RET tcp_client_get_link_stats(TCP_CLIENT_LINK_STATS_T *stats)
+{
+    if (!stats) {
+        return OPRT_INVALID_PARM;
+    }
+    *stats = g_ctx.link_stats;
+    stats->heartbeat_capable = g_ctx.hb_capable;
+    return OPRT_OK;
+}
+
+uint32_t tcp_client_tx_free(void)
+{
+    if (!g_ctx.tx_mutex) {
+        return 0;
+    }
+    tal_mutex_lock(g_ctx.tx_mutex);
+    uint32_t free_bytes = TCP_TX_QUEUE_SIZE - (g_ctx.tx_head - g_ctx.tx_tail);
+    tal_mutex_unlock(g_ctx.tx_mutex);
     
-    PR_DEBUG("Sent to server: %.*s", len, data);
+    return free_bytes > TCP_FRAME_HEADER_SIZE ? free_bytes - TCP_FRAME_HEADER_SIZE : 0;
+}
+
+OPERATE_RET tcp_client_get_tx_stats(TCP_CLIENT_TX_STATS_T *stats)
+{
+    if (!stats) {
+        return OPRT_INVALID_PARM;
+    }
+    if (!g_ctx.tx_mutex) {
+        memset(stats, 0, sizeof(*stats));
+        return OPRT_OK;
+    }
+    tal_mutex_lock(g_ctx.tx_mutex);
+    *stats = g_ctx.tx_stats;
+    stats->queued = g_ctx.tx_head - g_ctx.tx_tail;
+    tal_mutex_unlock(g_ctx.tx_mutex);
     return OPRT_OK;
 }
 
@@ -345,6 +922,17 @@ int tcp_client_receive_data(uint8_t *buf, int len, int timeout_ms)
     int total_received = 0;
     int start_time = tal_system_get_millisecond();
     
+    /* Bytes the receiver already buffered past the current frame come first */
+    uint32_t buffered = g_ctx.rx_len - g_ctx.rx_pos;
+    if (buffered > 0) {
+        total_received = (buffered < (uint32_t)len) ? (int)buffered : len;
+        memcpy(buf, g_ctx.rx_buf + g_ctx.rx_pos, total_received);
+        if (g_ctx.rx_in_cb) {
+            buf[0] = g_ctx.rx_saved;
+        }
+        g_ctx.rx_pos += total_received;
+    }
+    
     /* Set longer timeout for voice data reception */
     tal_net_set_timeout(g_ctx.socket_fd, timeout_ms, TRANS_RECV);
     
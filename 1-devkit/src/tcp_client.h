@@ -15,14 +15,54 @@
 
 /**
  * @brief Callback for received messages
+ *
+ * data points into the receive buffer: it is NUL-terminated (data[len] == 0)
+ * but only valid until the callback returns.
+ *
  * @param data Message data
- * @param len Message length
+ * @param len Message length (up to 32 KB)
  */
 typedef void (*tcp_client_recv_cb_t)(const char *data, uint32_t len);
 
+/**
+ * @brief Callback for connection state changes (runs on the TCP receiver task)
+ *
+ * @param connected true after connecting (auth already sent), false after
+ *        the connection was lost or dropped as dead
+ */
+typedef void (*tcp_client_state_cb_t)(bool connected);
+
+/**
+ * @brief Connection liveness statistics
+ */
+typedef struct {
+    bool heartbeat_capable;      /* Server acknowledges heartbeats on this connection */
+    uint32_t rtt_last_ms;        /* Heartbeat round trip */
+    uint32_t rtt_avg_ms;         /* Smoothed (1/8) round trip */
+    uint32_t rtt_max_ms;
+    uint32_t heartbeats_sent;
+    uint32_t heartbeats_acked;
+    uint32_t dead_peer_events;   /* Connections dropped for silence */
+    uint32_t connects;           /* Successful connects */
+    uint32_t tsync_probes;       /* "tsync:" clock probes answered */
+} TCP_CLIENT_LINK_STATS_T;
+
+/**
+ * @brief Send queue statistics
+ */
+typedef struct {
+    uint32_t capacity;       /* Send ring size in bytes */
+    uint32_t queued;         /* Bytes waiting for the writer */
+    uint32_t high_water;     /* Most bytes ever queued */
+    uint32_t messages;       /* Messages queued */
+    uint32_t sends;          /* Socket sends, below messages when writes coalesce */
+    uint32_t dropped;        /* Messages rejected because the ring was full */
+    uint32_t dgram_dropped;  /* Datagrams dropped to keep room for control traffic */
+} TCP_CLIENT_TX_STATS_T;
+
 /**
  * @brief Initialize TCP client
- * @param host Server IP address (e.g., "192.168.1.100")
+ * @param host Server host name or IP address (e.g., "192.168.1.100")
  * @param port Server port (e.g., 5000)
  * @param recv_cb Callback for received messages
  * @return OPRT_OK on success
@@ -48,12 +88,32 @@ bool tcp_client_is_connected(void);
 
 /**
  * @brief Send message to server
- * @param data Message data
+ *
+ * Queues the framed message for the writer task and returns without
+ * waiting for the socket, so it is safe to call from real-time tasks.
+ * @param data Message data (copied)
  * @param len Message length
- * @return OPRT_OK on success
+ * @return OPRT_OK when queued, OPRT_EXCEED_UPPER_LIMIT if the send queue is
+ *         full (message dropped), OPRT_SOCK_ERR if not connected
  */
 OPERATE_RET tcp_client_send(const char *data, uint32_t len);
 
+/**
+ * @brief Send a droppable real-time message (head and body form one frame)
+ *
+ * Like tcp_client_send(), but the message is dropped rather than queued
+ * when half the send ring is already in use, so audio never delays
+ * control replies and never piles up behind a slow uplink.
+ * @param head First part of the message (copied)
+ * @param head_len Length of head
+ * @param body Second part of the message (copied), can be NULL if body_len is 0
+ * @param body_len Length of body
+ * @return OPRT_OK when queued, OPRT_EXCEED_UPPER_LIMIT when dropped,
+ *         OPRT_SOCK_ERR if not connected
+ */
+OPERATE_RET tcp_client_send_datagram(const uint8_t *head, uint32_t head_len,
+                                     const uint8_t *body, uint32_t body_len);
+
 /**
  * @brief Send string message to server
  * @param str Null-terminated string
@@ -61,8 +121,37 @@ OPERATE_RET tcp_client_send(const char *data, uint32_t len);
  */
 OPERATE_RET tcp_client_send_str(const char *str);
 
+/**
+ * @brief Set the connection state callback
+ * @param state_cb Callback, NULL to remove
+ */
+void tcp_client_set_state_cb(tcp_client_state_cb_t state_cb);
+
+/**
+ * @brief Get connection liveness statistics
+ * @param stats Output statistics
+ * @return OPRT_OK on success, OPRT_INVALID_PARM if stats is NULL
+ */
+OPERATE_RET tcp_client_get_link_stats(TCP_CLIENT_LINK_STATS_T *stats);
+
+/**
+ * @brief Get the largest message that fits in the send queue right now
+ * @return Bytes of message data
+ */
+uint32_t tcp_client_tx_free(void);
+
+/**
+ * @brief Get send queue statistics
+ * @param stats Output statistics
+ * @return OPRT_OK on success, OPRT_INVALID_PARM if stats is NULL
+ */
+OPERATE_RET tcp_client_get_tx_stats(TCP_CLIENT_TX_STATS_T *stats);
+
 /**
  * @brief Receive raw data from TCP (for voice messages)
+ *
+ * Unframed bytes following the current message: anything the receiver
+ * already buffered is returned first, the rest is read from the socket.
  * @param buf Buffer to store received data
  * @param len Expected number of bytes to receive
  * @param timeout_ms Maximum time to wait
@@ -10,6 +10,7 @@
  */
 
 #include "cJSON.h"
+#include "json_arena.h"
 #include "netmgr.h"
 #include "tal_api.h"
 #include "tkl_output.h"
@@ -41,6 +42,7 @@
 
 /* Audio player includes */
 #include "ai_audio_player.h"
+#include "ai_audio_clip.h"
 #include "ai_audio.h"
 #include "alert_audio_data.h"
 #include "tdl_audio_manage.h"
@@ -48,6 +50,11 @@
 
 /* TCP client for web app communication */
 #include "tcp_client.h"
+#include "net_resolve.h"
+#include "cmd_proto.h"
+
+/* MP3 voice messages with credit flow control */
+#include "voice_stream.h"
 
 /* BLE includes for standalone mode (SKIP_TUYA_CLOUD) */
 #ifdef ENABLE_BLUETOOTH
@@ -64,6 +71,16 @@
 
 /* Speaker streaming for two-way audio (talk-back from browser) */
 #include "speaker_streaming.h"
+#include "audio_duplex.h"
+
+/* UDP mic transport settings (batching) */
+#include "udp_audio.h"
+
+/* Peer-to-peer mic uplink negotiated with ICE */
+#include "ice_audio.h"
+
+/* Doorbell event clips kept on local storage */
+#include "event_clip.h"
 
 /* Switch DP ID - typically DP 1 for switch products */
 #define SWITCH_DP_ID         1
@@ -72,6 +89,9 @@
 /* Default volume level (0-100) */
 #define DEFAULT_VOLUME       70
 
+/* Reply buffer for control commands (status JSON is the longest) */
+#define CMD_RESPONSE_SIZE    640
+
 /* TCP Server defaults (can be overridden via .env) */
 #ifndef TCP_SERVER_HOST
 #define TCP_SERVER_HOST "192.168.18.10"
@@ -89,6 +109,16 @@ static bool g_audio_initialized = false;
 /* Current volume level (0-100) */
 static uint8_t g_current_volume = DEFAULT_VOLUME;
 
+/* Mixer priorities: talk-back (speaker_streaming) > alert chime > voice message */
+#define ALERT_MIX_PRIORITY   1
+#define VOICE_MIX_DUCK_GAIN  (AI_AUDIO_MIX_GAIN_UNITY * 2 / 5)
+#define ALERT_MIX_DUCK_GAIN  (AI_AUDIO_MIX_GAIN_UNITY / 2)
+
+/* Alert chime, a cached clip played on its own mixer stream */
+#define ALERT_CLIP_NAME      "alert"
+static AI_AUDIO_MIX_STREAM_T g_alert_stream = 0;
+static bool g_alert_mixed = false;
+
 /* Speaker enable GPIO (T5AI-CORE uses GPIO39) */
 #define SPEAKER_EN_GPIO TUYA_GPIO_NUM_39
 
@@ -96,15 +126,19 @@ static uint8_t g_current_volume = DEFAULT_VOLUME;
 #define PROJECT_VERSION "1.0.0"
 #endif
 
+/* Boot timing: user_main() entry and the audio bring-up thread */
+static SYS_TIME_T g_boot_start_ms = 0;
+static THREAD_HANDLE g_boot_audio_thread = NULL;
+static bool g_boot_link_logged = false;
+
 /* Global TCP host for mic streaming UDP */
 char g_tcp_host[64] = "";
 
-/* Voice streaming state (no buffer needed - stream directly to player) */
-static int g_voice_expected_len = 0;
-static int g_voice_received_len = 0;
-
 /* Forward declarations */
 static void update_speaker_gpio(uint8_t volume);
+static void boot_stage_done(const char *stage);
+static void play_detection_alert(void);
+static void stop_detection_alert(void);
 
 /* for cli command register */
 extern void tuya_app_cli_init(void);
@@ -123,14 +157,298 @@ tuya_iot_client_t client;
 /* Tuya license information (uuid authkey) */
 tuya_iot_license_t license;
 
+/**
+ * @brief Format the "status" JSON reply
+ */
+static void format_status(char *buf, size_t size)
+{
+    int heap = tal_system_get_free_heap_size();
+    MIC_STREAMING_STATS_T mic;
+    mic_streaming_get_stats(&mic);
+    TCP_CLIENT_TX_STATS_T tx;
+    tcp_client_get_tx_stats(&tx);
+    TCP_CLIENT_LINK_STATS_T link;
+    tcp_client_get_link_stats(&link);
+    snprintf(buf, size, 
+        "{\"detection\":%s,\"speaker_vol\":%d,\"audio_init\":%s,\"mic_streaming\":%s,\"heap\":%d,"
+        "\"mic\":{\"latency_avg_ms\":%u,\"latency_max_ms\":%u,\"ring_hwm\":%u,\"bloat\":%u,"
+        "\"send_fail\":%u,\"hist\":[%u,%u,%u,%u,%u,%u]},"
+        "\"tcp_tx\":{\"queued\":%u,\"hwm\":%u,\"msgs\":%u,\"sends\":%u,\"dropped\":%u},"
+        "\"tcp_link\":{\"hb\":%s,\"rtt_ms\":%u,\"rtt_max_ms\":%u,\"dead_peer\":%u,\"connects\":%u,\"tsync\":%u}}",
+        g_detection_active ? "true" : "false",
+        g_current_volume,
+        g_audio_initialized ? "true" : "false",
+        mic_streaming_is_active() ? "true" : "false",
+        heap,
+        mic.latency_avg_ms, mic.latency_max_ms, mic.ring_high_water, mic.bloat_events,
+        mic.send_failures, mic.latency_hist[0], mic.latency_hist[1], mic.latency_hist[2],
+        mic.latency_hist[3], mic.latency_hist[4], mic.latency_hist[5],
+        tx.queued, tx.high_water, tx.messages, tx.sends, tx.dropped,
+        link.heartbeat_capable ? "true" : "false", link.rtt_avg_ms, link.rtt_max_ms,
+        link.dead_peer_events, link.connects, link.tsync_probes);
+}
+
+/**
+ * @brief Set the speaker volume (0-100) and the amplifier GPIO
+ */
+static OPERATE_RET set_speaker_volume(int volume)
+{
+    if (volume < 0) volume = 0;
+    if (volume > 100) volume = 100;
+    
+    PR_INFO("[VOLUME] Setting speaker volume to %d", volume);
+    g_current_volume = (uint8_t)volume;
+    
+    /* Set DAC gain via ai_audio API */
+    OPERATE_RET rt = ai_audio_set_volume((uint8_t)volume);
+    if (rt != OPRT_OK) {
+        PR_ERR("[VOLUME] Failed to set speaker volume: %d", rt);
+        return rt;
+    }
+    /* Control speaker amplifier GPIO based on volume */
+    update_speaker_gpio((uint8_t)volume);
+    return OPRT_OK;
+}
+
+/**
+ * @brief Set the microphone gain (0-100)
+ */
+static OPERATE_RET set_mic_gain(int volume)
+{
+    if (volume < 0) volume = 0;
+    if (volume > 100) volume = 100;
+    
+    PR_INFO("[VOLUME] Setting mic gain to %d", volume);
+    
+    /* Set mic gain via TKL API */
+    OPERATE_RET rt = tkl_ai_set_vol(TKL_AUDIO_TYPE_BOARD, 0, volume);
+    if (rt != OPRT_OK) {
+        PR_ERR("[VOLUME] Failed to set mic gain: %d", rt);
+    }
+    return rt;
+}
+
+/* Binary protocol handlers (see cmd_proto.h), same behaviour as the text commands */
+
+static void bin_ping(const CMD_PROTO_MSG_T *msg)
+{
+    cmd_proto_reply(msg->opcode, OPRT_OK, "pong");
+}
+
+static void bin_status(const CMD_PROTO_MSG_T *msg)
+{
+    char response[CMD_RESPONSE_SIZE];
+    format_status(response, sizeof(response));
+    cmd_proto_reply(msg->opcode, OPRT_OK, response);
+}
+
+static void bin_voice_start(const CMD_PROTO_MSG_T *msg)
+{
+    char response[40];
+    uint32_t credit = voice_stream_begin(cmd_proto_get_uint(msg, CMD_TLV_U32, 0), true);
+    snprintf(response, sizeof(response), "ok:voice_streaming:%u", credit);
+    cmd_proto_reply(msg->opcode, OPRT_OK, response);
+}
+
+static void bin_voice_data(const CMD_PROTO_MSG_T *msg)
+{
+    /* Hot path: the chunk is the first TLV, no reply */
+    const uint8_t *chunk = NULL;
+    uint16_t chunk_len = 0;
+    if (cmd_proto_find_tlv(msg, CMD_TLV_DATA, &chunk, &chunk_len)) {
+        voice_stream_write(chunk, chunk_len);
+    }
+}
+
+static void bin_voice_end(const CMD_PROTO_MSG_T *msg)
+{
+    char response[32];
+    snprintf(response, sizeof(response), "ok:voice_done:%u", voice_stream_end());
+    cmd_proto_reply(msg->opcode, OPRT_OK, response);
+}
+
+/* "ok:mic_on:<codec>", plus ":<rate>" for a wideband stream so the server knows the frame layout */
+static void format_mic_on(char *buf, size_t size, MIC_CODEC_E codec)
+{
+    uint32_t rate = mic_streaming_get_rate();
+    if (rate == 16000) {
+        snprintf(buf, size, "ok:mic_on:%s", mic_streaming_codec_name(codec));
+    } else {
+        snprintf(buf, size, "ok:mic_on:%s:%u", mic_streaming_codec_name(codec), rate);
+    }
+}
+
+static void bin_mic_on(const CMD_PROTO_MSG_T *msg)
+{
+    if (mic_streaming_is_active()) {
+        cmd_proto_reply(msg->opcode, OPRT_OK, "ok:mic_already_on");
+        return;
+    }
+    MIC_CODEC_E codec = (MIC_CODEC_E)cmd_proto_get_uint(msg, CMD_TLV_U8, MIC_CODEC_PCM);
+    if (codec >= MIC_CODEC_MAX) {
+        cmd_proto_reply(msg->opcode, OPRT_INVALID_PARM, "error:mic_codec");
+        return;
+    }
+    char response[64];
+    OPERATE_RET rt = mic_streaming_start(g_tcp_host, 5001, codec);
+    if (rt == OPRT_OK) {
+        format_mic_on(response, sizeof(response), codec);
+    } else {
+        snprintf(response, sizeof(response), "error:mic_start_failed:%d", rt);
+    }
+    cmd_proto_reply(msg->opcode, rt, response);
+}
+
+static void bin_mic_off(const CMD_PROTO_MSG_T *msg)
+{
+    if (!mic_streaming_is_active()) {
+        cmd_proto_reply(msg->opcode, OPRT_OK, "ok:mic_already_off");
+        return;
+    }
+    mic_streaming_stop();
+    cmd_proto_reply(msg->opcode, OPRT_OK, "ok:mic_off");
+}
+
+static void bin_speaker_volume(const CMD_PROTO_MSG_T *msg)
+{
+    char response[32];
+    int volume = (int)cmd_proto_get_uint(msg, CMD_TLV_U8, g_current_volume);
+    OPERATE_RET rt = set_speaker_volume(volume);
+    if (rt == OPRT_OK) {
+        snprintf(response, sizeof(response), "ok:vol:speaker:%d", g_current_volume);
+    } else {
+        snprintf(response, sizeof(response), "error:vol:speaker:%d", rt);
+    }
+    cmd_proto_reply(msg->opcode, rt, response);
+}
+
+static void bin_mic_volume(const CMD_PROTO_MSG_T *msg)
+{
+    char response[32];
+    int volume = (int)cmd_proto_get_uint(msg, CMD_TLV_U8, 100);
+    if (volume > 100) volume = 100;
+    OPERATE_RET rt = set_mic_gain(volume);
+    if (rt == OPRT_OK) {
+        snprintf(response, sizeof(response), "ok:vol:mic:%d", volume);
+    } else {
+        snprintf(response, sizeof(response), "error:vol:mic:%d", rt);
+    }
+    cmd_proto_reply(msg->opcode, rt, response);
+}
+
+static void bin_datagram(const CMD_PROTO_MSG_T *msg)
+{
+    /* Multiplexed talk-back audio, no reply */
+    const uint8_t *data = NULL;
+    uint16_t data_len = 0;
+    if (cmd_proto_get_uint(msg, CMD_TLV_U8, 0) == CMD_STREAM_SPEAKER &&
+        cmd_proto_find_tlv(msg, CMD_TLV_DATA, &data, &data_len)) {
+        speaker_streaming_feed(data, data_len);
+    }
+}
+
+/**
+ * @brief Fill the binary opcode table
+ */
+static void cmd_proto_handlers_init(void)
+{
+    cmd_proto_register(CMD_OP_PING, bin_ping);
+    cmd_proto_register(CMD_OP_STATUS, bin_status);
+    cmd_proto_register(CMD_OP_VOICE_START, bin_voice_start);
+    cmd_proto_register(CMD_OP_VOICE_DATA, bin_voice_data);
+    cmd_proto_register(CMD_OP_VOICE_END, bin_voice_end);
+    cmd_proto_register(CMD_OP_MIC_ON, bin_mic_on);
+    cmd_proto_register(CMD_OP_MIC_OFF, bin_mic_off);
+    cmd_proto_register(CMD_OP_SPEAKER_VOLUME, bin_speaker_volume);
+    cmd_proto_register(CMD_OP_MIC_VOLUME, bin_mic_volume);
+    cmd_proto_register(CMD_OP_DATAGRAM, bin_datagram);
+}
+
+/* UDP streams torn down with a lost control connection, restarted on reconnect */
+static bool g_mic_resume = false;
+static MIC_CODEC_E g_mic_resume_codec = MIC_CODEC_PCM;
+static bool g_speaker_resume = false;
+
+/**
+ * @brief Control connection state: follow it with the UDP audio streams
+ *
+ * A dead control connection usually means the server restarted or the
+ * path changed, so the UDP sockets are closed with it and re-created
+ * (with a fresh address lookup) once the server is back.
+ */
+static void tcp_state_callback(bool connected)
+{
+    if (!connected) {
+        if (mic_streaming_is_active()) {
+            g_mic_resume = true;
+            g_mic_resume_codec = mic_streaming_get_codec();
+            mic_streaming_stop();
+        }
+        if (speaker_streaming_is_active()) {
+            g_speaker_resume = true;
+            speaker_streaming_stop();
+        }
+        /* The signalling is gone, the browser restarts ICE after it reconnects */
+        ice_audio_stop();
+        return;
+    }
+    
+    if (!g_boot_link_logged) {
+        g_boot_link_logged = true;
+        boot_stage_done("tcp_link");
+    }
+    
+    if (g_speaker_resume) {
+        g_speaker_resume = false;
+        OPERATE_RET rt = speaker_streaming_init(g_tcp_host);
+        if (rt != OPRT_OK) {
+            PR_WARN("Failed to restart speaker streaming: %d", rt);
+        }
+    }
+    if (g_mic_resume) {
+        char response[64];
+        g_mic_resume = false;
+        OPERATE_RET rt = mic_streaming_start(g_tcp_host, 5001, g_mic_resume_codec);
+        if (rt == OPRT_OK) {
+            /* Same announcement as "mic on", the server learns the codec again */
+            format_mic_on(response, sizeof(response), g_mic_resume_codec);
+            tcp_client_send_str(response);
+        } else {
+            PR_WARN("Failed to restart mic streaming: %d", rt);
+        }
+    }
+    /* Clips recorded while offline go up now */
+    event_clip_kick_upload();
+}
+
+/**
+ * @brief Server settings changed over BLE: later stream (re)starts use the new host
+ */
+static int tcp_config_change_callback(void *data)
+{
+    const BLE_CONFIG_TCP_T *cfg = (const BLE_CONFIG_TCP_T *)data;
+    
+    if (cfg && cfg->host) {
+        strncpy(g_tcp_host, cfg->host, sizeof(g_tcp_host) - 1);
+        g_tcp_host[sizeof(g_tcp_host) - 1] = '\0';
+    }
+    return OPRT_OK;
+}
+
 /**
  * @brief Callback for messages received from web app via TCP
  */
 static void tcp_message_callback(const char *data, uint32_t len)
 {
-    PR_INFO("Web App Command: %.*s", len, data);
+    /* Binary opcode frames skip the text command chain */
+    if (cmd_proto_is_binary(data, len)) {
+        cmd_proto_dispatch(data, len);
+        return;
+    }
+
+    PR_INFO("Web App Command: %.*s", (int)len, data);
     
-    char response[256];
+    char response[CMD_RESPONSE_SIZE];
     
     /* Handle server responses (not commands) */
     if (strncmp(data, "auth:ok", 7) == 0) {
@@ -150,93 +468,73 @@ static void tcp_message_callback(const char *data, uint32_t len)
     }
     else if (strncmp(data, "status", 6) == 0) {
         /* Simplified status response */
-        int heap = tal_system_get_free_heap_size();
-        snprintf(response, sizeof(response), 
-            "{\"detection\":%s,\"speaker_vol\":%d,\"audio_init\":%s,\"mic_streaming\":%s,\"heap\":%d}",
-            g_detection_active ? "true" : "false",
-            g_current_volume,
-            g_audio_initialized ? "true" : "false",
-            mic_streaming_is_active() ? "true" : "false",
-            heap);
+        format_status(response, sizeof(response));
         tcp_client_send_str(response);
     }
     else if (strncmp(data, "audio play", 10) == 0) {
         if (g_audio_initialized && g_current_volume > 0) {
             PR_INFO("Web App triggered audio play");
-            if (ai_audio_player_is_playing()) {
-                ai_audio_player_stop();
-            }
-            ai_audio_player_start("webapp_audio");
-            ai_audio_player_data_write("webapp_audio", 
-                                       (uint8_t *)alert_audio_data, 
-                                       sizeof(alert_audio_data), 1);
+            play_detection_alert();
             tcp_client_send_str("ok:audio_playing");
         } else {
             tcp_client_send_str("error:audio_not_ready");
         }
     }
     else if (strncmp(data, "audio stop", 10) == 0) {
+        stop_detection_alert();
         if (ai_audio_player_is_playing()) {
             ai_audio_player_stop();
         }
         tcp_client_send_str("ok:audio_stopped");
     }
     else if (strncmp(data, "voicestart:", 11) == 0) {
-        /* Start of voice message (MP3 format): "voicestart:<total_length>" */
+        /* Start of voice message (MP3 format): "voicestart:<total_length>"
+         * The reply carries the initial credit, more follows as "vc:<total>" */
         int total_len = atoi(data + 11);
-        PR_INFO("[VOICE] Starting MP3 stream playback (%d bytes expected)", total_len);
-        
-        /* Stop any playing audio first */
-        if (ai_audio_player_is_playing()) {
-            ai_audio_player_stop();
-            tal_system_sleep(50); /* Wait for audio to stop */
-        }
-        
-        /* Start audio player for streaming MP3 */
-        ai_audio_player_start("voice_stream");
-        g_voice_expected_len = total_len;
-        g_voice_received_len = 0;
-        
-        tcp_client_send_str("ok:voice_streaming");
+        uint32_t credit = voice_stream_begin(total_len > 0 ? (uint32_t)total_len : 0, false);
+        snprintf(response, sizeof(response), "ok:voice_streaming:%u", credit);
+        tcp_client_send_str(response);
     }
     else if (strncmp(data, "vd:", 3) == 0) {
         /* Voice data chunk: "vd:" + binary MP3 data - stream to audio player */
-        int chunk_len = len - 3; /* Subtract "vd:" prefix */
-        const uint8_t *chunk_data = (const uint8_t *)(data + 3);
-        
-        if (chunk_len > 0) {
-            /* Stream this MP3 chunk to audio player */
-            ai_audio_player_data_write("voice_stream", (uint8_t *)chunk_data, chunk_len, 0);
-            g_voice_received_len += chunk_len;
-            
-            /* Log progress occasionally */
-            if (g_voice_received_len % 10000 < chunk_len) {
-                PR_DEBUG("[VOICE] Streaming: %d/%d bytes", g_voice_received_len, g_voice_expected_len);
-            }
+        if (len > 3) {
+            voice_stream_write((const uint8_t *)(data + 3), len - 3);
         }
         /* No response needed for data chunks */
     }
     else if (strncmp(data, "voiceend", 8) == 0) {
         /* End of voice message - signal end of stream */
-        PR_INFO("[VOICE] Stream complete: %d bytes played", g_voice_received_len);
-        
-        /* Write empty buffer with is_end=1 to signal completion */
-        ai_audio_player_data_write("voice_stream", NULL, 0, 1);
-        
-        snprintf(response, sizeof(response), "ok:voice_done:%d", g_voice_received_len);
+        snprintf(response, sizeof(response), "ok:voice_done:%u", voice_stream_end());
+        tcp_client_send_str(response);
+    }
+    else if (strncmp(data, "voice status", 12) == 0) {
+        /* Voice message flow control state */
+        VOICE_STREAM_STATS_T voice;
+        voice_stream_get_stats(&voice);
+        snprintf(response, sizeof(response),
+            "{\"active\":%s,\"expected\":%u,\"received\":%u,\"granted\":%u,\"first_data_ms\":%u,"
+            "\"sessions\":%u,\"truncated\":%u,\"overruns\":%u}",
+            voice.active ? "true" : "false", voice.expected, voice.received, voice.granted,
+            voice.first_data_ms, voice.sessions, voice.truncated, voice.overruns);
         tcp_client_send_str(response);
-        
-        g_voice_expected_len = 0;
-        g_voice_received_len = 0;
     }
     else if (strncmp(data, "mic on", 6) == 0) {
-        /* Start microphone streaming to web app via UDP */
+        /* Start microphone streaming to web app via UDP: "mic on [pcm|g711|opus]" */
         if (mic_streaming_is_active()) {
             tcp_client_send_str("ok:mic_already_on");
         } else {
-            OPERATE_RET rt = mic_streaming_start(g_tcp_host, 5001);
+            MIC_CODEC_E codec = MIC_CODEC_PCM;
+            if (len > 7 && strncmp(data + 7, "g711", 4) == 0) {
+                codec = MIC_CODEC_G711_ULAW;
+            } else if (len > 7 && strncmp(data + 7, "opus", 4) == 0) {
+                codec = MIC_CODEC_OPUS;
+            }
+            
+            OPERATE_RET rt = mic_streaming_start(g_tcp_host, 5001, codec);
             if (rt == OPRT_OK) {
-                tcp_client_send_str("ok:mic_on");
+                /* Tell the server which codec the uplink carries */
+                format_mic_on(response, sizeof(response), codec);
+                tcp_client_send_str(response);
             } else {
                 snprintf(response, sizeof(response), "error:mic_start_failed:%d", rt);
                 tcp_client_send_str(response);
@@ -252,34 +550,202 @@ static void tcp_message_callback(const char *data, uint32_t len)
             tcp_client_send_str("ok:mic_off");
         }
     }
+    else if (strncmp(data, "mic batch ", 10) == 0) {
+        /* Frames per UDP datagram: "mic batch <1-3>" (server raises it under congestion) */
+        int frames = atoi(data + 10);
+        OPERATE_RET rt = udp_audio_set_batch((uint8_t)frames);
+        if (rt == OPRT_OK) {
+            snprintf(response, sizeof(response), "ok:mic_batch:%d", frames);
+        } else {
+            snprintf(response, sizeof(response), "error:mic_batch:%d", rt);
+        }
+        tcp_client_send_str(response);
+    }
+    else if (strncmp(data, "mic rate ", 9) == 0) {
+        /* Stream sample rate for the next "mic on": "mic rate 16000|24000|48000" */
+        int rate = atoi(data + 9);
+        OPERATE_RET rt = mic_streaming_set_rate((uint32_t)rate);
+        if (rt == OPRT_OK) {
+            snprintf(response, sizeof(response), "ok:mic_rate:%d", rate);
+        } else {
+            snprintf(response, sizeof(response), "error:mic_rate:%d", rt);
+        }
+        tcp_client_send_str(response);
+    }
+    else if (strncmp(data, "mic ts ", 7) == 0) {
+        /* Capture timestamps in the mic datagram header: "mic ts on|off" */
+        bool enable = (strncmp(data + 7, "on", 2) == 0);
+        udp_audio_set_timestamps(enable);
+        tcp_client_send_str(enable ? "ok:mic_ts:on" : "ok:mic_ts:off");
+    }
+    else if (strncmp(data, "mic vad ", 8) == 0) {
+        /* Silence gating with comfort noise: "mic vad on|off" */
+        bool enable = (strncmp(data + 8, "on", 2) == 0);
+        mic_streaming_set_vad(enable);
+        tcp_client_send_str(enable ? "ok:mic_vad:on" : "ok:mic_vad:off");
+    }
+    else if (strncmp(data, "mic aec ", 8) == 0) {
+        /* Talk-back echo suppression on the uplink: "mic aec on|off" */
+        bool enable = (strncmp(data + 8, "on", 2) == 0);
+        audio_duplex_set_enable(enable);
+        tcp_client_send_str(enable ? "ok:mic_aec:on" : "ok:mic_aec:off");
+    }
+    else if (strncmp(data, "mic fec ", 8) == 0) {
+        /* XOR parity FEC: "mic fec <0|2-8>" datagrams per parity, 0 = off */
+        int group = atoi(data + 8);
+        OPERATE_RET rt = udp_audio_set_fec((uint8_t)group);
+        if (rt == OPRT_OK) {
+            snprintf(response, sizeof(response), "ok:mic_fec:%d", group);
+        } else {
+            snprintf(response, sizeof(response), "error:mic_fec:%d", rt);
+        }
+        tcp_client_send_str(response);
+    }
+    else if (strncmp(data, "mic rtp ", 8) == 0) {
+        /* Standard RTP/RTCP packets for an SFU or WebRTC gateway: "mic rtp on|off" */
+        bool enable = (strncmp(data + 8, "on", 2) == 0);
+        OPERATE_RET rt = udp_audio_set_rtp(enable);
+        if (rt == OPRT_OK) {
+            tcp_client_send_str(enable ? "ok:mic_rtp:on" : "ok:mic_rtp:off");
+        } else {
+            snprintf(response, sizeof(response), "error:mic_rtp:%d", rt);
+            tcp_client_send_str(response);
+        }
+    }
+    else if (strncmp(data, "ice ", 4) == 0) {
+        /* ICE signalling for the peer-to-peer uplink, see ice_audio.h */
+        const char *arg = data + 4;
+        OPERATE_RET rt;
+        if (strncmp(arg, "start", 5) == 0) {
+            rt = ice_audio_start(arg[5] == ' ' ? arg + 6 : NULL);
+        } else if (strncmp(arg, "remote ", 7) == 0) {
+            char ufrag[64] = {0}, pwd[64] = {0};
+            rt = (sscanf(arg + 7, "%63s %63s", ufrag, pwd) == 2) ? ice_audio_set_remote(ufrag, pwd)
+                                                                  : OPRT_INVALID_PARM;
+        } else if (strncmp(arg, "cand ", 5) == 0) {
+            /* Trickled candidates get no reply */
+            ice_audio_add_candidate(arg + 5);
+            return;
+        } else if (strncmp(arg, "end", 3) == 0) {
+            rt = ice_audio_end_candidates();
+        } else if (strncmp(arg, "stop", 4) == 0) {
+            ice_audio_stop();
+            rt = OPRT_OK;
+        } else {
+            rt = OPRT_INVALID_PARM;
+        }
+        if (rt == OPRT_OK) {
+            snprintf(response, sizeof(response), "ok:ice:%s", ice_audio_state_name(ice_audio_get_state()));
+        } else {
+            snprintf(response, sizeof(response), "error:ice:%d", rt);
+        }
+        tcp_client_send_str(response);
+    }
+    else if (strncmp(data, "transport ", 10) == 0) {
+        /* Audio transport: "transport mux|udp", mux carries mic/speaker audio on this connection */
+        if (strncmp(data + 10, "mux", 3) == 0) {
+            udp_audio_set_mux(true);
+            tcp_client_send_str("ok:transport:mux");
+        } else if (strncmp(data + 10, "udp", 3) == 0) {
+            udp_audio_set_mux(false);
+            tcp_client_send_str("ok:transport:udp");
+        } else {
+            tcp_client_send_str("error:transport");
+        }
+    }
+    else if (strncmp(data, "rr:", 3) == 0) {
+        /* Mic uplink receiver report: "rr:<loss_pct>,<rtt_ms>,<jitter_ms>" (no reply) */
+        unsigned int loss_pct = 0, rtt_ms = 0, jitter_ms = 0;
+        if (sscanf(data + 3, "%u,%u,%u", &loss_pct, &rtt_ms, &jitter_ms) >= 2) {
+            mic_streaming_on_receiver_report(loss_pct, rtt_ms, jitter_ms);
+        } else {
+            PR_WARN("Malformed receiver report: %.*s", (int)len, data);
+        }
+    }
     else if (strncmp(data, "mic status", 10) == 0) {
         /* Get mic streaming status */
-        uint32_t bytes_sent = 0, frames_sent = 0;
-        mic_streaming_get_stats(&bytes_sent, &frames_sent);
+        uint32_t bitrate = 0, dtx_frames = 0;
+        MIC_STREAMING_STATS_T stats;
+        mic_streaming_get_stats(&stats);
+        uint8_t level = mic_streaming_get_quality_level(&bitrate);
+        bool vad = mic_streaming_get_vad(&dtx_frames);
+        AUDIO_DUPLEX_STATS_T aec;
+        audio_duplex_get_stats(&aec);
         snprintf(response, sizeof(response), 
-            "{\"active\":%s,\"bytes_sent\":%u,\"frames_sent\":%u}",
+            "{\"active\":%s,\"transport\":\"%s\",\"rtp\":%s,\"ts\":%s,\"ice\":\"%s\",\"codec\":\"%s\",\"rate\":%u,\"batch\":%u,\"fec\":%u,\"level\":%u,\"bitrate\":%u,"
+            "\"vad\":%s,\"dtx_frames\":%u,\"bytes_sent\":%u,\"frames_sent\":%u,"
+            "\"restarts\":%u,\"restart_ms\":%u,"
+            "\"aec\":%s,\"echo_ms\":%d,\"echo_pct\":%u,\"aec_frames\":%u,\"double_talk\":%u}",
             mic_streaming_is_active() ? "true" : "false",
-            bytes_sent, frames_sent);
+            udp_audio_get_mux() ? "mux" : "udp",
+            udp_audio_get_rtp() ? "true" : "false",
+            udp_audio_get_timestamps() ? "true" : "false",
+            ice_audio_state_name(ice_audio_get_state()),
+            mic_streaming_codec_name(mic_streaming_get_codec()), mic_streaming_get_rate(),
+            udp_audio_get_batch(), udp_audio_get_fec(), level, bitrate,
+            vad ? "true" : "false", dtx_frames,
+            stats.bytes_captured, stats.frames_sent, stats.restarts, stats.restart_latency_ms,
+            audio_duplex_get_enable() ? "true" : "false",
+            aec.delay_locked ? (int)aec.echo_delay_ms : -1, aec.echo_gain_pct,
+            aec.suppressed_frames, aec.double_talk_frames);
+        tcp_client_send_str(response);
+    }
+    else if (strncmp(data, "clip trigger", 12) == 0) {
+        /* Record an event clip as if the doorbell was pressed */
+        OPERATE_RET rt = event_clip_trigger(EVENT_CLIP_REASON_REMOTE);
+        if (rt == OPRT_OK) {
+            tcp_client_send_str("ok:clip_trigger");
+        } else {
+            snprintf(response, sizeof(response), "error:clip_trigger:%d", rt);
+            tcp_client_send_str(response);
+        }
+    }
+    else if (strncmp(data, "clip status", 11) == 0) {
+        EVENT_CLIP_STATS_T stats;
+        event_clip_get_stats(&stats);
+        snprintf(response, sizeof(response),
+            "{\"recording\":%s,\"pending\":%u,\"recorded\":%u,\"uploaded\":%u,\"rotated\":%u,\"write_errors\":%u}",
+            stats.recording ? "true" : "false", stats.pending, stats.recorded,
+            stats.uploaded, stats.rotated, stats.write_errors);
+        tcp_client_send_str(response);
+    }
+    else if (strncmp(data, "speaker codec ", 14) == 0) {
+        /* Preferred talk-back downlink codec: "speaker codec pcm|g711|opus" */
+        SPEAKER_CODEC_E codec = SPEAKER_CODEC_MAX;
+        if (strncmp(data + 14, "pcm", 3) == 0) {
+            codec = SPEAKER_CODEC_PCM;
+        } else if (strncmp(data + 14, "g711", 4) == 0) {
+            codec = SPEAKER_CODEC_G711_ULAW;
+        } else if (strncmp(data + 14, "opus", 4) == 0) {
+            codec = SPEAKER_CODEC_OPUS;
+        }
+        
+        OPERATE_RET rt = speaker_streaming_set_codec(codec);
+        if (rt == OPRT_OK) {
+            snprintf(response, sizeof(response), "ok:speaker_codec:%.*s", (int)(len - 14), data + 14);
+        } else {
+            snprintf(response, sizeof(response), "error:speaker_codec:%d", rt);
+        }
+        tcp_client_send_str(response);
+    }
+    else if (strncmp(data, "speaker rate ", 13) == 0) {
+        /* Preferred PCM/G.711 talk-back rate: "speaker rate 16000|24000|48000" */
+        int rate = atoi(data + 13);
+        OPERATE_RET rt = speaker_streaming_set_rate((uint32_t)rate);
+        if (rt == OPRT_OK) {
+            snprintf(response, sizeof(response), "ok:speaker_rate:%d", rate);
+        } else {
+            snprintf(response, sizeof(response), "error:speaker_rate:%d", rt);
+        }
         tcp_client_send_str(response);
     }
     else if (strncmp(data, "setvol:speaker:", 15) == 0) {
         /* Set speaker volume: "setvol:speaker:<0-100>" */
-        int volume = atoi(data + 15);
-        if (volume < 0) volume = 0;
-        if (volume > 100) volume = 100;
-        
-        PR_INFO("[VOLUME] Setting speaker volume to %d", volume);
-        g_current_volume = (uint8_t)volume;
-        
-        /* Set DAC gain via ai_audio API */
-        OPERATE_RET rt = ai_audio_set_volume((uint8_t)volume);
+        OPERATE_RET rt = set_speaker_volume(atoi(data + 15));
         if (rt != OPRT_OK) {
-            PR_ERR("[VOLUME] Failed to set speaker volume: %d", rt);
             snprintf(response, sizeof(response), "error:vol:speaker:%d", rt);
         } else {
-            /* Control speaker amplifier GPIO based on volume */
-            update_speaker_gpio((uint8_t)volume);
-            snprintf(response, sizeof(response), "ok:vol:speaker:%d", volume);
+            snprintf(response, sizeof(response), "ok:vol:speaker:%d", g_current_volume);
         }
         tcp_client_send_str(response);
     }
@@ -289,12 +755,8 @@ static void tcp_message_callback(const char *data, uint32_t len)
         if (volume < 0) volume = 0;
         if (volume > 100) volume = 100;
         
-        PR_INFO("[VOLUME] Setting mic gain to %d", volume);
-        
-        /* Set mic gain via TKL API */
-        OPERATE_RET rt = tkl_ai_set_vol(TKL_AUDIO_TYPE_BOARD, 0, volume);
+        OPERATE_RET rt = set_mic_gain(volume);
         if (rt != OPRT_OK) {
-            PR_ERR("[VOLUME] Failed to set mic gain: %d", rt);
             snprintf(response, sizeof(response), "error:vol:mic:%d", rt);
         } else {
             snprintf(response, sizeof(response), "ok:vol:mic:%d", volume);
@@ -315,7 +777,20 @@ static void tcp_message_callback(const char *data, uint32_t len)
         tcp_client_send_str("ok:switch_off");
     }
     else if (strncmp(data, "mem", 3) == 0) {
-        snprintf(response, sizeof(response), "heap:%d", tal_system_get_free_heap_size());
+#if defined(ENABLE_MEM_PROFILE) && (ENABLE_MEM_PROFILE == 1)
+        int off = snprintf(response, sizeof(response), "heap:%d mem:", tal_system_get_free_heap_size());
+        tal_mem_profile_format(response + off, sizeof(response) - off);
+#else
+        TAL_HEAP_INFO_T heap = {0};
+        tal_system_get_heap_info(&heap);
+        snprintf(response, sizeof(response), "heap:%d largest:%u frag:%u", tal_system_get_free_heap_size(),
+                 heap.largest, heap.frag_pct);
+#endif
+        tcp_client_send_str(response);
+    }
+    else if (strncmp(data, "threads", 7) == 0) {
+        /* cpu share covers the time since the previous "threads" */
+        tal_thread_profile_format(response, sizeof(response));
         tcp_client_send_str(response);
     }
     else if (strncmp(data, "reset", 5) == 0) {
@@ -360,6 +835,12 @@ static void play_detection_alert(void)
         return;
     }
     
+    /* Mixed over a voice message or talk-back, nothing is interrupted */
+    if (g_alert_mixed && ai_audio_clip_play(ALERT_CLIP_NAME, g_alert_stream) == OPRT_OK) {
+        PR_INFO("Playing detection alert");
+        return;
+    }
+    
     /* Stop any currently playing audio first */
     if (ai_audio_player_is_playing()) {
         PR_DEBUG("Stopping previous audio before playing new alert");
@@ -399,6 +880,11 @@ static void stop_detection_alert(void)
         return;
     }
     
+    if (g_alert_mixed) {
+        ai_audio_player_mix_stop(g_alert_stream);
+        return;
+    }
+    
     if (ai_audio_player_is_playing()) {
         PR_INFO("Stopping detection alert audio...");
         ai_audio_player_stop();
@@ -614,48 +1100,63 @@ bool user_network_check(void)
     return status == NETMGR_LINK_DOWN ? false : true;
 }
 
-void user_main(void)
+/**
+ * @brief Log how long after power-on a boot stage finished
+ *
+ * Stages run on more than one thread, so each line carries the absolute
+ * time since user_main() started rather than a delta.
+ */
+static void boot_stage_done(const char *stage)
 {
-    int rt = OPRT_OK;
-
-    //! open iot development kit runtim init
-    cJSON_InitHooks(&(cJSON_Hooks){.malloc_fn = tal_malloc, .free_fn = tal_free});
-    tal_log_init(TAL_LOG_LEVEL_DEBUG, 1024, (TAL_LOG_OUTPUT_CB)tkl_log_output);
-
-    PR_NOTICE("Application information:");
-    PR_NOTICE("Project name:        %s", PROJECT_NAME);
-    PR_NOTICE("App version:         %s", PROJECT_VERSION);
-    PR_NOTICE("Compile time:        %s", __DATE__);
-    PR_NOTICE("TuyaOpen version:    %s", OPEN_VERSION);
-    PR_NOTICE("TuyaOpen commit-id:  %s", OPEN_COMMIT);
-    PR_NOTICE("Platform chip:       %s", PLATFORM_CHIP);
-    PR_NOTICE("Platform board:      %s", PLATFORM_BOARD);
-    PR_NOTICE("Platform commit-id:  %s", PLATFORM_COMMIT);
-
-    tal_kv_init(&(tal_kv_cfg_t){
-        .seed = "vmlkasdh93dlvlcy",
-        .key = "dflfuap134ddlduq",
-    });
-    tal_sw_timer_init();
-    tal_workq_init();
+    PR_NOTICE("[BOOT] %-10s +%u ms", stage, (uint32_t)(tal_system_get_millisecond() - g_boot_start_ms));
+}
 
-    /* Register board hardware (audio driver, button, LED) */
-    PR_INFO("Registering board hardware...");
+/**
+ * @brief Set the mixer up and cache the alert chime ahead of the first ring
+ *
+ * Without a mixer stream the alert falls back to the MP3 player, which interrupts
+ * whatever was playing.
+ */
+static void alert_audio_prepare(void)
+{
+    AI_AUDIO_MIX_CFG_T voice_mix = {
+        .priority = 0,
+        .gain = AI_AUDIO_MIX_GAIN_UNITY,
+        .duck_gain = VOICE_MIX_DUCK_GAIN,
+    };
+    AI_AUDIO_MIX_CFG_T alert_mix = {
+        .priority = ALERT_MIX_PRIORITY,
+        .gain = AI_AUDIO_MIX_GAIN_UNITY,
+        .duck_gain = ALERT_MIX_DUCK_GAIN,
+    };
+    ai_audio_player_set_mix(&voice_mix);
     
-    /* CRITICAL FIX: Disable vendor VAD before audio init!
-     * The T5AI platform has built-in Voice Activity Detection that automatically
-     * stops sending mic data to the application layer after ~5 seconds of
-     * detecting no voice activity. This caused the "Mic driver stalled" error.
-     * We must disable this BEFORE the audio driver is initialized. */
-    PR_NOTICE("Disabling vendor VAD to prevent mic stalling...");
-    tkl_ai_disable_vendor_vad();
+    OPERATE_RET rt = ai_audio_player_mix_open(&alert_mix, &g_alert_stream);
+    if (rt != OPRT_OK) {
+        PR_WARN("Failed to open alert mixer stream: %d", rt);
+        return;
+    }
+    g_alert_mixed = true;
     
-    rt = board_register_hardware();
+    /* Decoded now so the first ring costs no decode; if PSRAM is short it
+     * is decoded on first play instead */
+    rt = ai_audio_clip_register(ALERT_CLIP_NAME, (const uint8_t *)alert_audio_data, sizeof(alert_audio_data), true);
     if (rt != OPRT_OK) {
-        PR_ERR("Failed to register board hardware: %d", rt);
-    } else {
-        PR_INFO("Board hardware registered successfully");
+        PR_WARN("Failed to preload alert audio: %d", rt);
     }
+    PR_INFO("Alert audio cached: %u bytes PCM", ai_audio_clip_cached_size());
+}
+
+/**
+ * @brief Audio stage: player, mic ring buffer, codec, amplifier and volume
+ *
+ * Depends only on board_register_hardware(). mic_streaming_init()
+ * subscribes to the mic capture and should precede tdl_audio_open() so the
+ * first frames are not missed.
+ */
+static void boot_audio_init(void)
+{
+    OPERATE_RET rt = OPRT_OK;
 
     /* Initialize the audio player */
     PR_INFO("Initializing audio player...");
@@ -666,8 +1167,7 @@ void user_main(void)
     } else {
         PR_INFO("Audio player initialized successfully");
         
-        /* Initialize microphone streaming FIRST (creates ring buffer) */
-        /* This must be done BEFORE tdl_audio_open so callback has valid buffer */
+        /* Initialize microphone streaming FIRST (creates ring buffer, subscribes to capture) */
         PR_INFO("Initializing microphone streaming...");
         rt = mic_streaming_init();
         if (rt != OPRT_OK) {
@@ -676,22 +1176,26 @@ void user_main(void)
             PR_INFO("Microphone streaming initialized (standby mode)");
         }
         
-        /* Open the audio device to enable playback */
-        /* We pass the mic streaming callback so it can capture mic data when streaming is enabled */
+        /* The clip pre-trigger ring subscribes to the same capture */
+        rt = event_clip_init();
+        if (rt != OPRT_OK) {
+            PR_WARN("Failed to initialize event clips: %d", rt);
+        }
+        
+        /* Open the audio device to enable playback and capture */
+        /* Capture is delivered to every subscriber, mic streaming ignores it while disabled */
         TDL_AUDIO_HANDLE_T audio_hdl = NULL;
         rt = tdl_audio_find(AUDIO_CODEC_NAME, &audio_hdl);
         if (rt != OPRT_OK) {
             PR_ERR("Failed to find audio codec: %d", rt);
             g_audio_initialized = false;
         } else {
-            /* Open with mic callback - callback will ignore data when streaming is disabled */
-            TDL_AUDIO_MIC_CB mic_cb = (TDL_AUDIO_MIC_CB)mic_streaming_get_callback();
-            rt = tdl_audio_open(audio_hdl, mic_cb);
+            rt = tdl_audio_open(audio_hdl, NULL);
             if (rt != OPRT_OK) {
                 PR_ERR("Failed to open audio device: %d", rt);
                 g_audio_initialized = false;
             } else {
-                PR_INFO("Audio device opened successfully (with mic callback)");
+                PR_INFO("Audio device opened successfully");
                 g_audio_initialized = true;
                 
                 /* Enable speaker amplifier GPIO (GPIO39 on T5AI-CORE) */
@@ -727,13 +1231,78 @@ void user_main(void)
         }
     }
 
-    /* Note: mic_streaming_init() was called earlier, before tdl_audio_open() */
+    if (g_audio_initialized) {
+        alert_audio_prepare();
+    }
+    boot_stage_done("audio");
+}
 
-    /* Initialize speaker streaming for two-way audio (talk-back from browser)
-     * Note: We need to pass the TCP host for NAT hole punching, but g_tcp_host
-     * is not set yet (it's configured later after BLE/WiFi). So we initialize
-     * speaker streaming later, after g_tcp_host is determined. */
-    /* speaker_streaming_init() is now called after TCP host configuration */
+static void boot_audio_thread(void *arg)
+{
+    boot_audio_init();
+
+    THREAD_HANDLE self = g_boot_audio_thread;
+    g_boot_audio_thread = NULL;
+    tal_thread_delete(self);
+}
+
+void user_main(void)
+{
+    int rt = OPRT_OK;
+
+    g_boot_start_ms = tal_system_get_millisecond();
+
+    //! open iot development kit runtim init
+    json_arena_hooks_init(&(cJSON_Hooks){.malloc_fn = tal_malloc, .free_fn = tal_free});
+    tal_log_init(TAL_LOG_LEVEL_DEBUG, 1024, (TAL_LOG_OUTPUT_CB)tkl_log_output);
+
+    PR_NOTICE("Application information:");
+    PR_NOTICE("Project name:        %s", PROJECT_NAME);
+    PR_NOTICE("App version:         %s", PROJECT_VERSION);
+    PR_NOTICE("Compile time:        %s", __DATE__);
+    PR_NOTICE("TuyaOpen version:    %s", OPEN_VERSION);
+    PR_NOTICE("TuyaOpen commit-id:  %s", OPEN_COMMIT);
+    PR_NOTICE("Platform chip:       %s", PLATFORM_CHIP);
+    PR_NOTICE("Platform board:      %s", PLATFORM_BOARD);
+    PR_NOTICE("Platform commit-id:  %s", PLATFORM_COMMIT);
+
+    tal_kv_init(&(tal_kv_cfg_t){
+        .seed = "vmlkasdh93dlvlcy",
+        .key = "dflfuap134ddlduq",
+    });
+    tal_sw_timer_init();
+    tal_workq_init();
+    net_resolve_init();
+    voice_stream_init();
+    boot_stage_done("runtime");
+
+    /* Register board hardware (audio driver, button, LED) */
+    PR_INFO("Registering board hardware...");
+    
+    /* CRITICAL FIX: Disable vendor VAD before audio init!
+     * The T5AI platform has built-in Voice Activity Detection that automatically
+     * stops sending mic data to the application layer after ~5 seconds of
+     * detecting no voice activity. This caused the "Mic driver stalled" error.
+     * We must disable this BEFORE the audio driver is initialized. */
+    PR_NOTICE("Disabling vendor VAD to prevent mic stalling...");
+    tkl_ai_disable_vendor_vad();
+    
+    rt = board_register_hardware();
+    if (rt != OPRT_OK) {
+        PR_ERR("Failed to register board hardware: %d", rt);
+    } else {
+        PR_INFO("Board hardware registered successfully");
+    }
+
+    /* Audio codec bring-up does not need the network: run it alongside
+     * WiFi association and BLE instead of in front of them */
+    boot_stage_done("board");
+    THREAD_CFG_T audio_thrd = {4096, THREAD_PRIO_2, "boot_audio"};
+    rt = tal_thread_create_and_start(&g_boot_audio_thread, NULL, NULL, boot_audio_thread, NULL, &audio_thrd);
+    if (rt != OPRT_OK) {
+        PR_WARN("Failed to start audio boot thread: %d, initializing inline", rt);
+        boot_audio_init();
+    }
 
 #if !defined(PLATFORM_UBUNTU) || (PLATFORM_UBUNTU == 0)
     tal_cli_init();
@@ -809,6 +1378,7 @@ void user_main(void)
     type |= NETCONN_CELLULAR;
 #endif
     netmgr_init(type);
+    boot_stage_done("netmgr");
 
 #if defined(ENABLE_WIFI) && (ENABLE_WIFI == 1)
     netmgr_conn_set(NETCONN_WIFI, NETCONN_CMD_NETCFG, &(netcfg_args_t){.type = NETCFG_TUYA_BLE | NETCFG_TUYA_WIFI_AP});
@@ -849,6 +1419,7 @@ void user_main(void)
 
     /* Initialize BLE configuration handler */
     ble_config_init();
+    boot_stage_done("ble_cfg");
 
     /* Initialize TCP client for web app communication */
     /* First try to load saved settings from KV storage */
@@ -877,9 +1448,13 @@ void user_main(void)
         PR_NOTICE("============================================");
     }
     
+    cmd_proto_handlers_init();
     if (tcp_client_init(g_tcp_host, tcp_port, tcp_message_callback) == OPRT_OK) {
+        tcp_client_set_state_cb(tcp_state_callback);
+        tal_event_subscribe(EVENT_TCP_CONFIG_CHG, "tuya_main", tcp_config_change_callback, SUBSCRIBE_TYPE_NORMAL);
         tcp_client_start();
         PR_INFO("TCP client started - will connect to web app server");
+        boot_stage_done("tcp");
     } else {
         PR_ERR("Failed to initialize TCP client");
     }
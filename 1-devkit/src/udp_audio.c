@@ -1,10 +1,21 @@
 /**
  * @file udp_audio.c
- * @brief UDP Audio streaming with raw PCM for WebRTC/Opus encoding on server
+ * @brief UDP Audio streaming (PCM / G.711 / Opus) for WebRTC on server
  * 
- * Sends raw PCM audio over UDP for server-side Opus encoding and WebRTC streaming.
+ * Sends mic audio over UDP for WebRTC streaming on the server.
  * 
- * Packet format: [SEQ:1byte][PCM_DATA:640bytes]
+ * Packet format: [SEQ:2bytes BE][CODEC:1byte][FRAMES:1byte][PAYLOAD:N bytes]
+ * 
+ * SEQ is the sequence number of the first frame in the datagram. With
+ * batching enabled, up to UDP_AUDIO_BATCH_MAX consecutive 20ms frames share
+ * one datagram. PCM/G.711 frames are fixed size and simply concatenated;
+ * Opus frames are each prefixed with a 2-byte big-endian length.
+ * 
+ * With FEC enabled every group of datagrams is followed by an XOR parity
+ * datagram (format in udp_audio.h).
+ * 
+ * In RTP mode each frame is packetized by lib_rtp instead, one frame per
+ * packet, with RTCP sender reports on the same port (udp_audio.h).
  * 
  * Benefits of raw PCM + server-side Opus:
  * - Best audio quality (uncompressed source for Opus encoder)
@@ -14,15 +25,37 @@
  */
 
 #include "udp_audio.h"
+#include "g711_codec.h"
+#include "net_resolve.h"
+#include "cmd_proto.h"
+#include "ice_audio.h"
 #include "tal_api.h"
 #include "tal_network.h"
+#include <stdio.h>
 #include <string.h>
 
+#if defined(ENABLE_TUYA_P2P) && (ENABLE_TUYA_P2P == 1)
+#include "rtp.h"
+#include "rtp-packet.h"
+#endif
+
 /***********************************************************
 ***********************macro define************************
 ***********************************************************/
-/* Max packet size: 1 byte seq + 640 bytes PCM (320 samples * 2 bytes = 20ms at 16kHz) */
-#define UDP_PACKET_MAX_SIZE 700
+/* Max packet size: stays below the WiFi MTU so batched datagrams never fragment
+ * (2 PCM frames or 3 G.711/Opus frames fit) */
+#define UDP_PACKET_MAX_SIZE 1400
+
+/* Length prefix in front of each variable-size (Opus) frame */
+#define UDP_FRAME_LEN_SIZE  2
+
+/* Audio per frame, also what the RTP timestamp advances per frame */
+#define UDP_AUDIO_FRAME_MS  20
+
+/* RTP clock rates of the payload formats (RFC 3551, RFC 7587) */
+#define UDP_AUDIO_RTP_CLOCK_PCMU    8000
+#define UDP_AUDIO_RTP_CLOCK_L16     16000
+#define UDP_AUDIO_RTP_CLOCK_OPUS    48000
 
 /***********************************************************
 ***********************typedef define***********************
@@ -32,22 +65,485 @@ typedef struct {
     TUYA_IP_ADDR_T server_addr;
     uint16_t server_port;
     bool ready;
-    uint8_t seq;  /* Sequence number (0-255, wraps around) */
+    uint16_t seq;            /* Sequence number of the next frame (wraps at 65535) */
+    uint16_t batch_seq;      /* Sequence number of the first pending frame */
+    uint8_t codec;           /* Codec id for udp_audio_send() payloads */
+    uint8_t batch_frames;    /* Frames per datagram (1 = no batching) */
+    uint8_t pending_frames;  /* Frames already staged in g_send_buf */
+    uint8_t pending_codec;   /* Codec of the staged frames */
+    uint32_t pending_len;    /* Payload bytes staged in g_send_buf */
+    uint32_t pending_hdr;    /* Header bytes in front of the staged payload */
+    uint32_t capture_us;     /* Capture time of the next frame */
+    uint32_t batch_capture_us;  /* Capture time of the first pending frame */
     uint32_t packets_sent;
+    uint8_t fec_group;       /* Requested datagrams per parity (0 = FEC off) */
+    uint8_t fec_count;       /* Datagrams XOR-ed into g_fec_buf so far */
+    uint8_t fec_size;        /* Group size latched at the start of the current group */
+    uint16_t fec_base_seq;   /* SEQ of the first datagram in the current group */
+    uint16_t fec_len_xor;    /* XOR of the grouped datagram lengths */
+    uint32_t fec_max_len;    /* Longest datagram in the current group */
 } udp_audio_ctx_t;
 
+typedef struct {
+    void *session;           /* lib_rtp session, keeps the sender report counters */
+    uint32_t ssrc;
+    uint16_t seq;            /* RTP sequence number of the next packet */
+    uint32_t ts;             /* RTP timestamp of the next frame */
+    uint32_t clock;          /* Clock rate of the session payload */
+    bool talkspurt;          /* Next packet starts a talkspurt, sets the marker */
+    SYS_TIME_T rtcp_next;    /* When the next sender report is due, 0 = now */
+} udp_audio_rtp_t;
+
 /***********************************************************
 ***********************variable define**********************
 ***********************************************************/
-static udp_audio_ctx_t g_udp = {0};
+/* Datagrams go over the TCP control connection instead of UDP */
+static volatile bool g_audio_mux = (AUDIO_TRANSPORT_MUX != 0);
 
-/* Send buffer for G.711 encoded packets */
+/* Header carries CAPTURE_US */
+static volatile bool g_audio_ts = (AUDIO_CAPTURE_TS != 0);
+
+
+static udp_audio_ctx_t g_udp = {.batch_frames = 1};
+
+/* Send buffer for outgoing packets (header + payload) */
 static uint8_t g_send_buf[UDP_PACKET_MAX_SIZE];
 
+/* Parity datagram under construction (parity header + XOR of the group) */
+static uint8_t g_fec_buf[UDP_AUDIO_FEC_HEADER_SIZE + UDP_PACKET_MAX_SIZE];
+
+#if defined(ENABLE_TUYA_P2P) && (ENABLE_TUYA_P2P == 1)
+/* Frames go out as RTP instead of SEQ/CODEC datagrams */
+static volatile bool g_audio_rtp = (AUDIO_TRANSPORT_RTP != 0);
+
+static udp_audio_rtp_t g_rtp;
+
+/* Nothing is received on the socket, so no RTCP is ever delivered */
+static struct rtp_event_t g_rtp_event;
+
+/* RTP payload staging, serialized behind the RTP header into g_send_buf */
+static uint8_t g_rtp_payload[UDP_PACKET_MAX_SIZE - RTP_FIXED_HEADER];
+#endif
+
 /***********************************************************
 ***********************function define**********************
 ***********************************************************/
 
+static uint32_t udp_audio_frame_overhead(uint8_t codec)
+{
+    return (codec == UDP_AUDIO_CODEC_OPUS) ? UDP_FRAME_LEN_SIZE : 0;
+}
+
+static uint32_t udp_audio_header_len(void)
+{
+    return g_audio_ts ? UDP_AUDIO_HEADER_SIZE + UDP_AUDIO_TS_SIZE : UDP_AUDIO_HEADER_SIZE;
+}
+
+/**
+ * @brief Get the write position for a frame of len bytes
+ * 
+ * Flushes the pending batch first if the frame cannot join it (different
+ * codec or not enough room), then writes the Opus length prefix if needed.
+ * 
+ * @return Where to put the frame payload, or NULL if it can never fit
+ */
+static uint8_t *udp_audio_frame_begin(uint8_t codec, uint32_t len)
+{
+    uint32_t need = len + udp_audio_frame_overhead(codec);
+    
+    if (len == 0 || need > UDP_PACKET_MAX_SIZE - udp_audio_header_len()) {
+        PR_ERR("Invalid UDP audio frame size: %u", len);
+        return NULL;
+    }
+    
+    if (g_udp.pending_frames > 0 &&
+        (codec != g_udp.pending_codec || g_udp.pending_hdr + g_udp.pending_len + need > UDP_PACKET_MAX_SIZE)) {
+        udp_audio_flush();
+    }
+    
+    if (g_udp.pending_frames == 0) {
+        /* The header layout is latched per datagram, a setting change waits for the next one */
+        g_udp.pending_codec = codec;
+        g_udp.pending_hdr = udp_audio_header_len();
+        g_udp.batch_seq = g_udp.seq;
+        g_udp.batch_capture_us = g_udp.capture_us;
+    }
+    
+    uint8_t *p = &g_send_buf[g_udp.pending_hdr + g_udp.pending_len];
+    if (codec == UDP_AUDIO_CODEC_OPUS) {
+        p[0] = (uint8_t)(len >> 8);
+        p[1] = (uint8_t)(len & 0xFF);
+        p += UDP_FRAME_LEN_SIZE;
+    }
+    
+    return p;
+}
+
+/**
+ * @brief Account for a frame written after udp_audio_frame_begin(), send when the batch is full
+ */
+static OPERATE_RET udp_audio_frame_end(uint32_t len)
+{
+    g_udp.pending_len += len + udp_audio_frame_overhead(g_udp.pending_codec);
+    g_udp.pending_frames++;
+    g_udp.seq++;
+    
+    if (g_udp.pending_frames >= g_udp.batch_frames) {
+        return udp_audio_flush();
+    }
+    
+    return OPRT_OK;
+}
+
+/**
+ * @brief Send one datagram to the server on the active transport
+ * @return Bytes sent, or negative on error
+ */
+static int udp_audio_xmit(const uint8_t *pkt, uint32_t len)
+{
+    /* A connected ICE session takes the datagrams peer to peer, the relay is the fallback */
+    if (ice_audio_send(pkt, len) == OPRT_OK) {
+        return (int)len;
+    }
+    if (g_audio_mux) {
+        return (cmd_proto_send_datagram(CMD_STREAM_MIC, pkt, len) == OPRT_OK) ? (int)len : -1;
+    }
+    return tal_net_send_to(g_udp.socket_fd, (void *)pkt, len, g_udp.server_addr, g_udp.server_port);
+}
+
+#if defined(ENABLE_TUYA_P2P) && (ENABLE_TUYA_P2P == 1)
+/**
+ * @brief Drop the RTP session, sending a BYE so the gateway frees the SSRC
+ */
+static void udp_audio_rtp_close(void)
+{
+    uint8_t rtcp[64];
+    
+    if (g_rtp.session == NULL) {
+        return;
+    }
+    
+    if (g_udp.ready && g_udp.socket_fd >= 0) {
+        int n = rtp_rtcp_bye(g_rtp.session, rtcp, sizeof(rtcp));
+        if (n > 0) {
+            udp_audio_xmit(rtcp, (uint32_t)n);
+        }
+    }
+    rtp_destroy(g_rtp.session);
+    memset(&g_rtp, 0, sizeof(g_rtp));
+}
+
+/**
+ * @brief Start an RTP session for the payload clock, a clock change starts a new SSRC
+ */
+static OPERATE_RET udp_audio_rtp_open(uint32_t clock)
+{
+    if (g_rtp.session != NULL && g_rtp.clock == clock) {
+        return OPRT_OK;
+    }
+    udp_audio_rtp_close();
+    
+    /* Random SSRC, sequence and timestamp origin as RFC 3550 asks */
+    g_rtp.ssrc = (uint32_t)tal_system_get_random(0xFFFFFFFF);
+    g_rtp.seq = (uint16_t)tal_system_get_random(0xFFFF);
+    g_rtp.ts = (uint32_t)tal_system_get_random(0xFFFFFFFF);
+    g_rtp.clock = clock;
+    g_rtp.talkspurt = true;
+    g_rtp.rtcp_next = 0;
+    
+    /* The bandwidth only scales the RTCP interval, which is fixed here */
+    g_rtp.session = rtp_create(&g_rtp_event, NULL, g_rtp.ssrc, g_rtp.ts, (int)clock, UDP_PACKET_MAX_SIZE * 50, 1);
+    if (g_rtp.session == NULL) {
+        PR_ERR("Failed to create RTP session");
+        return OPRT_MALLOC_FAILED;
+    }
+    
+    char cname[24];
+    snprintf(cname, sizeof(cname), "devkit-%08x", (unsigned int)g_rtp.ssrc);
+    rtp_set_info(g_rtp.session, cname, "devkit mic");
+    
+    PR_NOTICE("RTP audio: ssrc=%08x clock=%u", (unsigned int)g_rtp.ssrc, clock);
+    return OPRT_OK;
+}
+
+/**
+ * @brief Send the periodic sender report, the first one right after the first packet
+ */
+static void udp_audio_rtp_report(void)
+{
+    uint8_t rtcp[128];
+    SYS_TIME_T now = tal_system_get_millisecond();
+    
+    if (g_rtp.rtcp_next != 0 && now < g_rtp.rtcp_next) {
+        return;
+    }
+    g_rtp.rtcp_next = now + UDP_AUDIO_RTCP_INTERVAL_MS;
+    
+    int n = rtp_rtcp_report(g_rtp.session, rtcp, sizeof(rtcp));
+    if (n > 0 && udp_audio_xmit(rtcp, (uint32_t)n) != n) {
+        PR_DEBUG("RTCP report send failed");
+    }
+}
+
+/**
+ * @brief Packetize one frame staged in g_rtp_payload and send it
+ */
+static OPERATE_RET udp_audio_rtp_send(uint8_t pt, uint32_t clock, uint32_t len)
+{
+    OPERATE_RET rt = udp_audio_rtp_open(clock);
+    if (rt != OPRT_OK) {
+        return rt;
+    }
+    
+    struct rtp_packet_t pkt;
+    memset(&pkt, 0, sizeof(pkt));
+    pkt.rtp.v = RTP_VERSION;
+    pkt.rtp.pt = pt;
+    pkt.rtp.m = g_rtp.talkspurt ? 1 : 0;
+    pkt.rtp.seq = g_rtp.seq;
+    pkt.rtp.timestamp = g_rtp.ts;
+    pkt.rtp.ssrc = g_rtp.ssrc;
+    pkt.payload = g_rtp_payload;
+    pkt.payloadlen = (int)len;
+    
+    int packet_len = rtp_packet_serialize(&pkt, g_send_buf, sizeof(g_send_buf));
+    
+    /* The frame is consumed either way, a failed send is a lost packet */
+    g_rtp.seq++;
+    g_rtp.ts += clock * UDP_AUDIO_FRAME_MS / 1000;
+    g_rtp.talkspurt = false;
+    g_udp.seq++;
+    
+    if (packet_len <= 0) {
+        PR_ERR("RTP packetize failed: %d", packet_len);
+        return OPRT_COM_ERROR;
+    }
+    
+    int sent = udp_audio_xmit(g_send_buf, (uint32_t)packet_len);
+    rtp_onsend(g_rtp.session, g_send_buf, packet_len);
+    udp_audio_rtp_report();
+    
+    if (sent != packet_len) {
+        PR_DEBUG("RTP send incomplete: %d/%d", sent, packet_len);
+        return OPRT_SOCK_ERR;
+    }
+    
+    if (++g_udp.packets_sent % 500 == 0) {
+        PR_INFO("RTP audio: %u packets sent, seq=%u, pt=%u, last_size=%d bytes",
+                g_udp.packets_sent, pkt.rtp.seq, pt, packet_len);
+    }
+    
+    return OPRT_OK;
+}
+
+/**
+ * @brief Send one frame in RTP mode, mapping the codec id to its RTP payload format
+ */
+static OPERATE_RET udp_audio_rtp_sendv(uint8_t codec, const UDP_AUDIO_IOV_T *iov, uint32_t iov_cnt)
+{
+    uint32_t len = 0;
+    
+    for (uint32_t i = 0; i < iov_cnt; i++) {
+        if (len + iov[i].len > sizeof(g_rtp_payload)) {
+            return OPRT_INVALID_PARM;
+        }
+        memcpy(&g_rtp_payload[len], iov[i].base, iov[i].len);
+        len += iov[i].len;
+    }
+    
+    switch (codec) {
+    case UDP_AUDIO_CODEC_OPUS:
+        return udp_audio_rtp_send(UDP_AUDIO_RTP_PT_OPUS, UDP_AUDIO_RTP_CLOCK_OPUS, len);
+        
+    case UDP_AUDIO_CODEC_ULAW:
+        /* 16kHz u-law to PCMU/8000, in place since the output never overtakes the input */
+        for (uint32_t i = 0; i < len / 2; i++) {
+            int32_t s = ((int32_t)g711_ulaw_to_linear(g_rtp_payload[2 * i]) +
+                         g711_ulaw_to_linear(g_rtp_payload[2 * i + 1])) / 2;
+            g_rtp_payload[i] = g711_linear_to_ulaw((int16_t)s);
+        }
+        return udp_audio_rtp_send(UDP_AUDIO_RTP_PT_PCMU, UDP_AUDIO_RTP_CLOCK_PCMU, len / 2);
+        
+    case UDP_AUDIO_CODEC_CN:
+        /* RFC 3389 comfort noise is only defined next to the 8kHz PCMU clock */
+        if (g_rtp.session != NULL && g_rtp.clock == UDP_AUDIO_RTP_CLOCK_PCMU) {
+            OPERATE_RET rt = udp_audio_rtp_send(UDP_AUDIO_RTP_PT_CN, UDP_AUDIO_RTP_CLOCK_PCMU, len);
+            g_rtp.talkspurt = true;
+            return rt;
+        }
+        udp_audio_skip_frame();
+        return OPRT_OK;
+        
+    case UDP_AUDIO_CODEC_PCM:
+    default:
+        /* L16 is network byte order */
+        for (uint32_t i = 0; i + 1 < len; i += 2) {
+            uint8_t lo = g_rtp_payload[i];
+            g_rtp_payload[i] = g_rtp_payload[i + 1];
+            g_rtp_payload[i + 1] = lo;
+        }
+        return udp_audio_rtp_send(UDP_AUDIO_RTP_PT_L16, UDP_AUDIO_RTP_CLOCK_L16, len);
+    }
+}
+
+/**
+ * @brief Check whether this frame goes out as RTP
+ * 
+ * Runs on the sending task, so a session stopped by udp_audio_set_rtp() on
+ * another task is only closed here.
+ */
+static bool udp_audio_rtp_active(void)
+{
+    if (g_audio_rtp) {
+        /* Frames staged in the old format go out first */
+        udp_audio_flush();
+        return true;
+    }
+    udp_audio_rtp_close();
+    return false;
+}
+#endif
+
+/**
+ * @brief Fold one audio datagram into the parity group, send the parity when the group is complete
+ */
+static void udp_audio_fec_add(const uint8_t *pkt, uint32_t len)
+{
+    if (g_udp.fec_count == 0) {
+        if (g_udp.fec_group == 0) {
+            return;
+        }
+        /* Latch the size for the whole group, set_fec() may run on another task */
+        g_udp.fec_size = g_udp.fec_group;
+        g_udp.fec_base_seq = ((uint16_t)pkt[0] << 8) | pkt[1];
+        g_udp.fec_len_xor = 0;
+        g_udp.fec_max_len = 0;
+        memset(&g_fec_buf[UDP_AUDIO_FEC_HEADER_SIZE], 0, UDP_PACKET_MAX_SIZE);
+    }
+    
+    uint8_t *x = &g_fec_buf[UDP_AUDIO_FEC_HEADER_SIZE];
+    for (uint32_t i = 0; i < len; i++) {
+        x[i] ^= pkt[i];
+    }
+    g_udp.fec_len_xor ^= (uint16_t)len;
+    if (len > g_udp.fec_max_len) {
+        g_udp.fec_max_len = len;
+    }
+    
+    if (++g_udp.fec_count < g_udp.fec_size) {
+        return;
+    }
+    
+    /* Header: [BASE_SEQ:2 BE][CODEC][COUNT:1][END_SEQ:2 BE][LEN_XOR:2 BE] */
+    g_fec_buf[0] = (uint8_t)(g_udp.fec_base_seq >> 8);
+    g_fec_buf[1] = (uint8_t)(g_udp.fec_base_seq & 0xFF);
+    g_fec_buf[2] = UDP_AUDIO_CODEC_FEC;
+    g_fec_buf[3] = g_udp.fec_count;
+    g_fec_buf[4] = (uint8_t)(g_udp.seq >> 8);
+    g_fec_buf[5] = (uint8_t)(g_udp.seq & 0xFF);
+    g_fec_buf[6] = (uint8_t)(g_udp.fec_len_xor >> 8);
+    g_fec_buf[7] = (uint8_t)(g_udp.fec_len_xor & 0xFF);
+    g_udp.fec_count = 0;
+    
+    uint32_t fec_len = UDP_AUDIO_FEC_HEADER_SIZE + g_udp.fec_max_len;
+    int sent = udp_audio_xmit(g_fec_buf, fec_len);
+    if (sent != (int)fec_len) {
+        PR_DEBUG("UDP FEC send incomplete: %d/%u", sent, fec_len);
+    }
+}
+
+OPERATE_RET udp_audio_flush(void)
+{
+    if (g_udp.pending_frames == 0) {
+        return OPRT_OK;
+    }
+    
+    /* Header: [SEQ:2 BE][CODEC:1][FRAMES:1], then [CAPTURE_US:4 BE] with timestamps */
+    g_send_buf[0] = (uint8_t)(g_udp.batch_seq >> 8);
+    g_send_buf[1] = (uint8_t)(g_udp.batch_seq & 0xFF);
+    g_send_buf[2] = g_udp.pending_codec;
+    g_send_buf[3] = g_udp.pending_frames;
+    if (g_udp.pending_hdr > UDP_AUDIO_HEADER_SIZE) {
+        g_send_buf[2] |= UDP_AUDIO_CODEC_FLAG_TS;
+        g_send_buf[4] = (uint8_t)(g_udp.batch_capture_us >> 24);
+        g_send_buf[5] = (uint8_t)(g_udp.batch_capture_us >> 16);
+        g_send_buf[6] = (uint8_t)(g_udp.batch_capture_us >> 8);
+        g_send_buf[7] = (uint8_t)(g_udp.batch_capture_us & 0xFF);
+    }
+    
+    uint32_t packet_len = g_udp.pending_hdr + g_udp.pending_len;
+    uint8_t frames = g_udp.pending_frames;
+    
+    /* Staged frames are consumed either way; a failed send is a lost datagram */
+    g_udp.pending_frames = 0;
+    g_udp.pending_len = 0;
+    
+    if (!g_udp.ready || g_udp.socket_fd < 0) {
+        return OPRT_SOCK_ERR;
+    }
+    
+    int sent = udp_audio_xmit(g_send_buf, packet_len);
+    
+    /* Parity covers the datagram even if this send failed, the server can rebuild it */
+    udp_audio_fec_add(g_send_buf, packet_len);
+    
+    if (sent != (int)packet_len) {
+        PR_DEBUG("UDP send incomplete: %d/%u", sent, packet_len);
+        return OPRT_SOCK_ERR;
+    }
+    
+    g_udp.packets_sent++;
+    
+    /* Log stats every 500 packets (~10 seconds at 50 packets/sec) */
+    if (g_udp.packets_sent % 500 == 0) {
+        PR_INFO("UDP audio: %u packets sent, seq=%u, codec=%u, frames=%u, last_size=%u bytes", 
+                g_udp.packets_sent, g_udp.seq, g_send_buf[2], frames, packet_len);
+    }
+    
+    return OPRT_OK;
+}
+
+OPERATE_RET udp_audio_set_batch(uint8_t frames)
+{
+    if (frames == 0 || frames > UDP_AUDIO_BATCH_MAX) {
+        return OPRT_INVALID_PARM;
+    }
+    
+    /* Only store the new size: may be called from another task while frames
+     * are staged, the sender applies it on its next frame */
+    g_udp.batch_frames = frames;
+    PR_INFO("UDP audio batching: %u frame(s) per packet", frames);
+    
+    return OPRT_OK;
+}
+
+uint8_t udp_audio_get_batch(void)
+{
+    return g_udp.batch_frames;
+}
+
+OPERATE_RET udp_audio_set_fec(uint8_t group)
+{
+    if (group != 0 && (group < UDP_AUDIO_FEC_GROUP_MIN || group > UDP_AUDIO_FEC_GROUP_MAX)) {
+        return OPRT_INVALID_PARM;
+    }
+    
+    /* Picked up by the sender at the next group boundary */
+    g_udp.fec_group = group;
+    if (group) {
+        PR_INFO("UDP audio FEC: 1 parity per %u packets", group);
+    } else {
+        PR_INFO("UDP audio FEC disabled");
+    }
+    
+    return OPRT_OK;
+}
+
+uint8_t udp_audio_get_fec(void)
+{
+    return g_udp.fec_group;
+}
+
 OPERATE_RET udp_audio_init(const char *host, uint16_t port)
 {
     if (g_udp.ready) {
@@ -61,10 +557,15 @@ OPERATE_RET udp_audio_init(const char *host, uint16_t port)
         PR_ERR("Failed to create UDP socket");
         return OPRT_SOCK_ERR;
     }
+
+    /* Mic packets go out in the WMM voice queue, ahead of OTA and MQTT */
+    if (tal_net_set_ac(g_udp.socket_fd, TAL_NET_AC_VO) != OPRT_OK) {
+        PR_WARN("Failed to mark UDP socket as voice");
+    }
     
     /* Resolve server address */
-    g_udp.server_addr = tal_net_str2addr(host);
-    if (g_udp.server_addr == 0) {
+    g_udp.server_addr = 0;
+    if (net_resolve_host(host, &g_udp.server_addr) != OPRT_OK || g_udp.server_addr == 0) {
         PR_ERR("Failed to resolve UDP host: %s", host);
         tal_net_close(g_udp.socket_fd);
         g_udp.socket_fd = -1;
@@ -73,85 +574,139 @@ OPERATE_RET udp_audio_init(const char *host, uint16_t port)
     
     g_udp.server_port = port;
     g_udp.seq = 0;
+    g_udp.pending_frames = 0;
+    g_udp.pending_len = 0;
     g_udp.packets_sent = 0;
+    g_udp.fec_count = 0;
     g_udp.ready = true;
     
-    PR_NOTICE("UDP audio initialized with G.711 encoding: %s:%d", host, port);
+    PR_NOTICE("UDP audio initialized: %s:%d", host, port);
     return OPRT_OK;
 }
 
-OPERATE_RET udp_audio_send_pcm(const int16_t *pcm_data, uint32_t pcm_samples)
+OPERATE_RET udp_audio_set_host(const char *host)
 {
-    if (!g_udp.ready || g_udp.socket_fd < 0) {
+    TUYA_IP_ADDR_T addr = 0;
+    
+    if (!g_udp.ready) {
+        return OPRT_SOCK_ERR;
+    }
+    if (net_resolve_host(host, &addr) != OPRT_OK || addr == 0) {
+        PR_ERR("Failed to resolve UDP host: %s", host);
         return OPRT_SOCK_ERR;
     }
     
-    /* Calculate PCM byte size (2 bytes per sample) */
-    uint32_t pcm_bytes = pcm_samples * 2;
+    /* Datagrams are unconnected, the next send simply goes to the new address */
+    g_udp.server_addr = addr;
+    PR_NOTICE("UDP audio moved to %s:%d", host, g_udp.server_port);
+    return OPRT_OK;
+}
+
+OPERATE_RET udp_audio_sendv(uint8_t codec, const UDP_AUDIO_IOV_T *iov, uint32_t iov_cnt)
+{
+    if (!g_udp.ready || g_udp.socket_fd < 0) {
+        return OPRT_SOCK_ERR;
+    }
     
-    if (pcm_samples == 0 || pcm_bytes > (UDP_PACKET_MAX_SIZE - 1)) {
-        PR_ERR("Invalid PCM sample count: %u (bytes: %u)", pcm_samples, pcm_bytes);
+    if (iov == NULL || iov_cnt == 0 || iov_cnt > UDP_AUDIO_IOV_MAX) {
         return OPRT_INVALID_PARM;
     }
     
-    /* Build packet: [SEQ:1][PCM_DATA:N] - Raw PCM for server-side Opus encoding */
-    g_send_buf[0] = g_udp.seq;
-    
-    /* Copy raw PCM data (no encoding - server will encode to Opus) */
-    memcpy(&g_send_buf[1], pcm_data, pcm_bytes);
-    
-    /* Total packet size: 1 byte seq + PCM data */
-    uint32_t packet_len = 1 + pcm_bytes;
-    
-    int sent = tal_net_send_to(g_udp.socket_fd, (void *)g_send_buf, packet_len, 
-                                g_udp.server_addr, g_udp.server_port);
+    uint32_t payload_len = 0;
+    for (uint32_t i = 0; i < iov_cnt; i++) {
+        payload_len += iov[i].len;
+    }
     
-    if (sent != (int)packet_len) {
-        PR_DEBUG("UDP send incomplete: %d/%u", sent, packet_len);
-        return OPRT_SOCK_ERR;
+#if defined(ENABLE_TUYA_P2P) && (ENABLE_TUYA_P2P == 1)
+    if (udp_audio_rtp_active()) {
+        return udp_audio_rtp_sendv(codec, iov, iov_cnt);
     }
+#endif
     
-    /* Increment sequence number (wraps at 255) */
-    g_udp.seq++;
-    g_udp.packets_sent++;
+    /* tal_net_send_to() takes a single buffer, so gather once into the datagram */
+    uint8_t *p = udp_audio_frame_begin(codec, payload_len);
+    if (p == NULL) {
+        return OPRT_INVALID_PARM;
+    }
     
-    /* Log stats every 500 packets (~5 seconds at 100 packets/sec) */
-    if (g_udp.packets_sent % 500 == 0) {
-        PR_INFO("UDP PCM audio: %u packets sent, seq=%u, last_size=%u bytes", 
-                g_udp.packets_sent, g_udp.seq, packet_len);
+    for (uint32_t i = 0; i < iov_cnt; i++) {
+        memcpy(p, iov[i].base, iov[i].len);
+        p += iov[i].len;
     }
     
-    return OPRT_OK;
+    return udp_audio_frame_end(payload_len);
 }
 
-OPERATE_RET udp_audio_send(const uint8_t *data, uint32_t len)
+OPERATE_RET udp_audio_send_pcm(const int16_t *pcm_data, uint32_t pcm_samples)
+{
+    /* Raw PCM, no encoding - server will encode to Opus */
+    UDP_AUDIO_IOV_T iov = {.base = pcm_data, .len = pcm_samples * 2};
+    
+    return udp_audio_sendv(UDP_AUDIO_CODEC_PCM, &iov, 1);
+}
+
+OPERATE_RET udp_audio_send_ulaw(const int16_t *pcm_data, uint32_t pcm_samples)
 {
     if (!g_udp.ready || g_udp.socket_fd < 0) {
         return OPRT_SOCK_ERR;
     }
     
-    /* Build packet with sequence number: [SEQ:1][DATA:N] */
-    if (len > (UDP_PACKET_MAX_SIZE - 1)) {
-        len = UDP_PACKET_MAX_SIZE - 1;
+#if defined(ENABLE_TUYA_P2P) && (ENABLE_TUYA_P2P == 1)
+    if (udp_audio_rtp_active()) {
+        /* PCMU/8000: average each sample pair, then encode */
+        uint32_t len = pcm_samples / 2;
+        if (len == 0 || len > sizeof(g_rtp_payload)) {
+            return OPRT_INVALID_PARM;
+        }
+        for (uint32_t i = 0; i < len; i++) {
+            g_rtp_payload[i] = g711_linear_to_ulaw((int16_t)(((int32_t)pcm_data[2 * i] + pcm_data[2 * i + 1]) / 2));
+        }
+        return udp_audio_rtp_send(UDP_AUDIO_RTP_PT_PCMU, UDP_AUDIO_RTP_CLOCK_PCMU, len);
     }
+#endif
     
-    g_send_buf[0] = g_udp.seq;
-    memcpy(&g_send_buf[1], data, len);
+    /* Encode directly into the packet (u-law is one byte per sample), no intermediate buffer */
+    uint8_t *p = udp_audio_frame_begin(UDP_AUDIO_CODEC_ULAW, pcm_samples);
+    if (p == NULL) {
+        return OPRT_INVALID_PARM;
+    }
     
-    uint32_t packet_len = 1 + len;
+    g711_encode_ulaw(pcm_data, pcm_samples, p);
     
-    int sent = tal_net_send_to(g_udp.socket_fd, (void *)g_send_buf, packet_len, 
-                                g_udp.server_addr, g_udp.server_port);
+    return udp_audio_frame_end(pcm_samples);
+}
+
+void udp_audio_set_codec(uint8_t codec)
+{
+    g_udp.codec = codec;
+}
+
+OPERATE_RET udp_audio_send(const uint8_t *data, uint32_t len)
+{
+    /* One frame tagged with the session codec */
+    UDP_AUDIO_IOV_T iov = {.base = data, .len = len};
     
-    if (sent != (int)packet_len) {
-        PR_DEBUG("UDP send incomplete: %d/%u", sent, packet_len);
-        return OPRT_SOCK_ERR;
-    }
+    return udp_audio_sendv(g_udp.codec, &iov, 1);
+}
+
+OPERATE_RET udp_audio_send_cn(uint8_t level)
+{
+    UDP_AUDIO_IOV_T iov = {.base = &level, .len = 1};
     
+    return udp_audio_sendv(UDP_AUDIO_CODEC_CN, &iov, 1);
+}
+
+void udp_audio_skip_frame(void)
+{
+    udp_audio_flush();
     g_udp.seq++;
-    g_udp.packets_sent++;
-    
-    return OPRT_OK;
+#if defined(ENABLE_TUYA_P2P) && (ENABLE_TUYA_P2P == 1)
+    /* The timeline keeps running through silence, the next packet starts a talkspurt */
+    if (g_rtp.session != NULL) {
+        g_rtp.ts += g_rtp.clock * UDP_AUDIO_FRAME_MS / 1000;
+        g_rtp.talkspurt = true;
+    }
+#endif
 }
 
 bool udp_audio_is_ready(void)
@@ -159,20 +714,27 @@ bool udp_audio_is_ready(void)
     return g_udp.ready;
 }
 
-uint8_t udp_audio_get_seq(void)
+uint16_t udp_audio_get_seq(void)
 {
     return g_udp.seq;
 }
 
 void udp_audio_close(void)
 {
+#if defined(ENABLE_TUYA_P2P) && (ENABLE_TUYA_P2P == 1)
+    udp_audio_rtp_close();
+#endif
     if (g_udp.socket_fd >= 0) {
         tal_net_close(g_udp.socket_fd);
         g_udp.socket_fd = -1;
     }
     g_udp.ready = false;
     g_udp.seq = 0;
+    g_udp.pending_frames = 0;
+    g_udp.pending_len = 0;
+    g_udp.codec = UDP_AUDIO_CODEC_PCM;
     g_udp.packets_sent = 0;
+    g_udp.fec_count = 0;  /* An incomplete group is dropped */
     PR_NOTICE("UDP audio closed");
 }
 
@@ -185,8 +747,7 @@ OPERATE_RET udp_audio_send_ping(void)
     /* Send minimal 1-byte ping packet (0xFF = ping marker) */
     uint8_t ping_pkt = 0xFF;
     
-    int sent = tal_net_send_to(g_udp.socket_fd, (void *)&ping_pkt, 1,
-                               g_udp.server_addr, g_udp.server_port);
+    int sent = udp_audio_xmit(&ping_pkt, 1);
     
     if (sent != 1) {
         PR_DEBUG("UDP ping failed: %d", sent);
@@ -198,3 +759,57 @@ OPERATE_RET udp_audio_send_ping(void)
     return OPRT_OK;
 }
 
+
+void udp_audio_set_mux(bool enable)
+{
+    if (g_audio_mux != enable) {
+        PR_NOTICE("Audio transport: %s", enable ? "TCP mux" : "UDP");
+    }
+    g_audio_mux = enable;
+}
+
+bool udp_audio_get_mux(void)
+{
+    return g_audio_mux;
+}
+
+OPERATE_RET udp_audio_set_rtp(bool enable)
+{
+#if defined(ENABLE_TUYA_P2P) && (ENABLE_TUYA_P2P == 1)
+    /* Only store it, the sender opens or closes the session on its next frame */
+    if (g_audio_rtp != enable) {
+        PR_NOTICE("Audio packets: %s", enable ? "RTP" : "datagram");
+    }
+    g_audio_rtp = enable;
+    return OPRT_OK;
+#else
+    return enable ? OPRT_NOT_SUPPORTED : OPRT_OK;
+#endif
+}
+
+bool udp_audio_get_rtp(void)
+{
+#if defined(ENABLE_TUYA_P2P) && (ENABLE_TUYA_P2P == 1)
+    return g_audio_rtp;
+#else
+    return false;
+#endif
+}
+
+void udp_audio_set_timestamps(bool enable)
+{
+    if (g_audio_ts != enable) {
+        PR_NOTICE("Audio capture timestamps %s", enable ? "on" : "off");
+    }
+    g_audio_ts = enable;
+}
+
+bool udp_audio_get_timestamps(void)
+{
+    return g_audio_ts;
+}
+
+void udp_audio_set_capture_time(uint32_t capture_us)
+{
+    g_udp.capture_us = capture_us;
+}
@@ -1,15 +1,67 @@
 /**
  * @file udp_audio.h
- * @brief UDP Audio streaming with raw PCM for WebRTC/Opus
+ * @brief UDP Audio streaming (PCM / G.711 / Opus) for WebRTC
  * 
- * Sends raw PCM audio over UDP for server-side Opus encoding and WebRTC streaming.
- * The server handles Opus encoding and WebRTC, providing:
+ * Sends mic audio over UDP to the VPS for WebRTC streaming.
+ * The server handles WebRTC, providing:
  * - WebRTC jitter buffer for packet loss recovery
- * - Opus compression (~24kbps output)
+ * - Opus compression (~24kbps output) when the device sends PCM/G.711
  * - Native browser playback (no custom decoder needed)
  * 
- * Packet format: [SEQ:1byte][PCM_DATA:640bytes]
- * PCM is 16kHz, 16-bit, mono = 320 samples * 2 bytes = 640 bytes per 20ms frame
+ * Packet format: [SEQ:2bytes BE][CODEC:1byte][FRAMES:1byte][PAYLOAD:N bytes]
+ * - SEQ:    sequence number of the first frame in the datagram
+ * - FRAMES: number of 20ms frames in the payload (1..UDP_AUDIO_BATCH_MAX)
+ * - PCM:    16kHz, 16-bit, mono = 320 samples * 2 bytes = 640 bytes per frame
+ * - G.711:  16kHz u-law = 320 bytes per frame
+ *   At a wideband stream rate (mic_streaming_set_rate()) PCM and G.711
+ *   frames are longer (24kHz: 960 / 480 bytes), the rate follows from the
+ *   frame length and is announced with "mic on" ("ok:mic_on:<codec>:<rate>")
+ * - Opus:   per frame [LEN:2bytes BE][OPUS_PACKET:LEN bytes]
+ * - CN:     [LEVEL:1byte] comfort noise / DTX marker, noise level in -dBov
+ *           (RFC 3389 style). Sent in place of a silent frame; the frames
+ *           after it are not sent but still consume SEQ numbers, so a SEQ
+ *           gap after a CN packet is silence, not loss.
+ *
+ * The codec is negotiated over the TCP control channel ("mic on <codec>")
+ * and repeated in every packet so the server never has to guess.
+ *
+ * Optional capture timestamps (udp_audio_set_timestamps()): CODEC gets
+ * UDP_AUDIO_CODEC_FLAG_TS and the header grows by [CAPTURE_US:4 BE], the
+ * capture time of the first sample of the first frame on av_clock (low 32
+ * bits, later frames of a batch follow at 20ms steps). Together with the
+ * "tsync" offset probes (tcp_client.h) the server gets each frame's
+ * capture time on its own clock, for A/V sync and one-way delay.
+ *
+ * Optional XOR parity FEC (udp_audio_set_fec()): after every group of N
+ * audio datagrams one parity datagram is sent:
+ *   [BASE_SEQ:2 BE][CODEC=UDP_AUDIO_CODEC_FEC][COUNT:1][END_SEQ:2 BE][LEN_XOR:2 BE][XOR:M bytes]
+ * - BASE_SEQ/END_SEQ: group id, the group covers datagrams whose SEQ is in [BASE_SEQ, END_SEQ)
+ * - COUNT:   datagrams in the group
+ * - LEN_XOR: XOR of the group's datagram lengths
+ * - XOR:     XOR of the group's whole datagrams (header included), zero padded
+ *            to the longest one (M bytes)
+ * A single lost datagram is rebuilt by XOR-ing the parity with the COUNT-1
+ * received ones; its own header then gives SEQ, CODEC and FRAMES. Audio
+ * datagrams are unchanged, so servers without FEC support just ignore the
+ * parity codec.
+ *
+ * Optional multiplexing (udp_audio_set_mux()): the same datagrams travel
+ * as CMD_OP_DATAGRAM frames on the TCP control connection instead, so a
+ * single connection carries control, mic and speaker audio through one
+ * NAT mapping and one firewall hole. They are dropped, not queued, when
+ * the uplink is congested.
+ *
+ * Optional RTP mode (udp_audio_set_rtp(), needs lib_rtp from ENABLE_TUYA_P2P):
+ * every frame goes out as a standard RTP packet (RFC 3550) instead, so an SFU
+ * or WebRTC gateway ingests the stream directly:
+ * - PCMU/8000 (PT 0): the 16kHz mic is decimated to 8kHz before encoding
+ * - Opus/48000 (UDP_AUDIO_RTP_PT_OPUS), L16/16000 (UDP_AUDIO_RTP_PT_L16)
+ * - CN (PT 13) replaces silent PCMU frames, silent Opus/L16 frames are not sent
+ * - Timestamps advance 20ms per frame including skipped ones, the marker bit
+ *   starts each talkspurt
+ * - RTCP sender reports with a CNAME every UDP_AUDIO_RTCP_INTERVAL_MS on the
+ *   same port (rtcp-mux, RFC 5761), a BYE when the stream closes
+ * Batching, FEC and the SEQ/CODEC header do not apply in this mode.
  */
 
 #ifndef __UDP_AUDIO_H__
@@ -17,6 +69,74 @@
 
 #include "tuya_cloud_types.h"
 
+/* Default audio transport, 1 = multiplex onto the TCP control connection */
+#ifndef AUDIO_TRANSPORT_MUX
+#define AUDIO_TRANSPORT_MUX     0
+#endif
+
+/* Default packet format, 1 = RTP */
+#ifndef AUDIO_TRANSPORT_RTP
+#define AUDIO_TRANSPORT_RTP     0
+#endif
+
+/* Default for capture timestamps in the header, off for servers that predate them */
+#ifndef AUDIO_CAPTURE_TS
+#define AUDIO_CAPTURE_TS        0
+#endif
+
+/* Codec identifiers carried in the CODEC header byte */
+#define UDP_AUDIO_CODEC_PCM     0x00
+#define UDP_AUDIO_CODEC_ULAW    0x01
+#define UDP_AUDIO_CODEC_OPUS    0x02
+#define UDP_AUDIO_CODEC_CN      0x03    /* Comfort noise during silence */
+#define UDP_AUDIO_CODEC_FEC     0x7F    /* XOR parity datagram, see above */
+#define UDP_AUDIO_CODEC_FLAG_TS 0x80    /* Or-ed into CODEC: CAPTURE_US follows the header */
+
+/* Size of the CAPTURE_US header extension */
+#define UDP_AUDIO_TS_SIZE       4
+
+/* Header size: SEQ(2) + CODEC(1) + FRAMES(1) */
+#define UDP_AUDIO_HEADER_SIZE   4
+
+/* Max frames aggregated into one datagram */
+#define UDP_AUDIO_BATCH_MAX     3
+
+/* Parity datagram header: BASE_SEQ(2) + CODEC(1) + COUNT(1) + END_SEQ(2) + LEN_XOR(2) */
+#define UDP_AUDIO_FEC_HEADER_SIZE   8
+
+/* Group size limits for udp_audio_set_fec() */
+#define UDP_AUDIO_FEC_GROUP_MIN     2
+#define UDP_AUDIO_FEC_GROUP_MAX     8
+
+/* RTP payload types: PCMU and CN are static (RFC 3551), the dynamic ones
+ * must match what the gateway is configured with */
+#define UDP_AUDIO_RTP_PT_PCMU   0
+#define UDP_AUDIO_RTP_PT_CN     13
+
+#ifndef UDP_AUDIO_RTP_PT_OPUS
+#define UDP_AUDIO_RTP_PT_OPUS   111
+#endif
+
+#ifndef UDP_AUDIO_RTP_PT_L16
+#define UDP_AUDIO_RTP_PT_L16    96
+#endif
+
+/* RTCP sender report period in RTP mode */
+#ifndef UDP_AUDIO_RTCP_INTERVAL_MS
+#define UDP_AUDIO_RTCP_INTERVAL_MS  5000
+#endif
+
+/* Max payload segments accepted by udp_audio_sendv() */
+#define UDP_AUDIO_IOV_MAX       4
+
+/**
+ * @brief One payload segment for udp_audio_sendv()
+ */
+typedef struct {
+    const void *base;
+    uint32_t len;
+} UDP_AUDIO_IOV_T;
+
 /**
  * @brief Initialize UDP audio sender
  * @param host Server IP address
@@ -38,22 +158,122 @@ OPERATE_RET udp_audio_init(const char *host, uint16_t port);
 OPERATE_RET udp_audio_send_pcm(const int16_t *pcm_data, uint32_t pcm_samples);
 
 /**
- * @brief Send raw audio data via UDP (legacy)
- * @param data Raw audio data
+ * @brief Send one datagram gathered from several payload segments
+ * 
+ * Writes the SEQ/CODEC header and gathers the segments straight into the
+ * datagram, so callers can pass pointers into their own buffers (e.g. both
+ * halves of a wrapped ring buffer region) without staging a copy first.
+ * 
+ * @param codec Codec id for the header (UDP_AUDIO_CODEC_*)
+ * @param iov Payload segments
+ * @param iov_cnt Number of segments (max UDP_AUDIO_IOV_MAX)
+ * @return OPRT_OK on success
+ */
+OPERATE_RET udp_audio_sendv(uint8_t codec, const UDP_AUDIO_IOV_T *iov, uint32_t iov_cnt);
+
+/**
+ * @brief Encode PCM to G.711 u-law straight into the packet and send it
+ * 
+ * Sent with UDP_AUDIO_CODEC_ULAW in the header regardless of the session codec.
+ * 
+ * @param pcm_data PCM 16-bit audio samples
+ * @param pcm_samples Number of samples (not bytes!)
+ * @return OPRT_OK on success
+ */
+OPERATE_RET udp_audio_send_ulaw(const int16_t *pcm_data, uint32_t pcm_samples);
+
+/**
+ * @brief Set the codec id written into the header by udp_audio_send()
+ * @param codec One of UDP_AUDIO_CODEC_*
+ */
+void udp_audio_set_codec(uint8_t codec);
+
+/**
+ * @brief Send already-encoded audio data via UDP
+ * 
+ * The payload is tagged with the codec set by udp_audio_set_codec().
+ * 
+ * @param data Encoded audio data
  * @param len Data length
  * @return OPRT_OK on success
  */
 OPERATE_RET udp_audio_send(const uint8_t *data, uint32_t len);
 
+/**
+ * @brief Send a comfort noise (DTX) frame instead of a silent audio frame
+ * 
+ * @param level Background noise level in -dBov (0-127)
+ * @return OPRT_OK on success
+ */
+OPERATE_RET udp_audio_send_cn(uint8_t level);
+
+/**
+ * @brief Account for a silent frame that is not sent
+ * 
+ * Sends any pending batch (its frames must stay contiguous) and advances
+ * SEQ, so the server keeps its timeline during DTX.
+ */
+void udp_audio_skip_frame(void);
+
+/**
+ * @brief Set how many frames are aggregated per datagram
+ * 
+ * 1 sends every frame immediately. 2-3 trade 20-40ms extra latency for
+ * 2-3x fewer packets, useful when the server reports congestion. Frames
+ * that would not fit the datagram (e.g. a 3rd PCM frame) are sent early.
+ * 
+ * @param frames Frames per datagram (1..UDP_AUDIO_BATCH_MAX)
+ * @return OPRT_OK on success
+ */
+OPERATE_RET udp_audio_set_batch(uint8_t frames);
+
+/**
+ * @brief Get the current frames-per-datagram setting
+ */
+uint8_t udp_audio_get_batch(void);
+
+/**
+ * @brief Enable XOR parity FEC
+ * 
+ * One parity datagram is sent after every `group` audio datagrams, so the
+ * server can rebuild any single lost datagram of the group without a
+ * retransmit. Costs 1/group extra bandwidth. The new size takes effect at
+ * the next group boundary, so this is safe to call while streaming.
+ * 
+ * @param group Datagrams per parity (UDP_AUDIO_FEC_GROUP_MIN..MAX), 0 disables FEC
+ * @return OPRT_OK on success
+ */
+OPERATE_RET udp_audio_set_fec(uint8_t group);
+
+/**
+ * @brief Get the FEC group size (0 = disabled)
+ */
+uint8_t udp_audio_get_fec(void);
+
+/**
+ * @brief Send any frames still waiting for their batch to fill
+ * @return OPRT_OK on success (or nothing pending)
+ */
+OPERATE_RET udp_audio_flush(void);
+
 /**
  * @brief Check if UDP audio is ready
  */
 bool udp_audio_is_ready(void);
 
 /**
- * @brief Get current sequence number
+ * @brief Get the sequence number of the next frame
  */
-uint8_t udp_audio_get_seq(void);
+uint16_t udp_audio_get_seq(void);
+
+/**
+ * @brief Point the stream at a different server, keeping the socket and sequence
+ *
+ * @param host Server host name or IP
+ * @return OPRT_OK on success, OPRT_SOCK_ERR if not initialized or the
+ *         host does not resolve (the old server is kept)
+ */
+OPERATE_RET udp_audio_set_host(const char *host);
 
 /**
  * @brief Close UDP audio connection
@@ -70,5 +290,66 @@ void udp_audio_close(void);
  */
 OPERATE_RET udp_audio_send_ping(void);
 
+/**
+ * @brief Select the audio transport for mic and speaker datagrams
+ *
+ * Takes effect with the next datagram. The server must switch too
+ * (TCP "transport mux|udp").
+ *
+ * @param enable true to multiplex onto the TCP control connection, false for UDP
+ */
+void udp_audio_set_mux(bool enable);
+
+/**
+ * @brief Get the audio transport
+ *
+ * @return true if datagrams are multiplexed onto the TCP control connection
+ */
+bool udp_audio_get_mux(void);
+
+/**
+ * @brief Select RTP packets instead of the SEQ/CODEC datagrams
+ *
+ * Takes effect with the next frame, a new SSRC is picked each time RTP
+ * starts. The gateway must expect RTP on the server port.
+ *
+ * @param enable true for RTP
+ * @return OPRT_OK on success, OPRT_NOT_SUPPORTED if built without lib_rtp
+ */
+OPERATE_RET udp_audio_set_rtp(bool enable);
+
+/**
+ * @brief Get the packet format
+ *
+ * @return true if frames are sent as RTP
+ */
+bool udp_audio_get_rtp(void);
+
+/**
+ * @brief Add capture timestamps to the datagram header
+ *
+ * Takes effect with the next datagram; the server must accept
+ * UDP_AUDIO_CODEC_FLAG_TS. RTP packets carry their own timestamps.
+ *
+ * @param enable true to send CAPTURE_US
+ */
+void udp_audio_set_timestamps(bool enable);
+
+/**
+ * @brief Get the capture timestamp setting
+ *
+ * @return true if datagrams carry CAPTURE_US
+ */
+bool udp_audio_get_timestamps(void);
+
+/**
+ * @brief Set the capture time of the next frame to be sent
+ *
+ * Call once per frame before sending it (sending task only).
+ *
+ * @param capture_us Capture time of its first sample, av_clock_now_us32() timebase
+ */
+void udp_audio_set_capture_time(uint32_t capture_us);
+
 #endif /* __UDP_AUDIO_H__ */
 
@@ -0,0 +1,195 @@
+/**
+ * @file voice_stream.c
+ * @brief MP3 voice message streaming into the audio player with flow control
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ */
+
+#include "voice_stream.h"
+#include "ai_audio_player.h"
+#include "cmd_proto.h"
+#include "tcp_client.h"
+#include "tal_api.h"
+#include <string.h>
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+#define VOICE_PLAYER_ID          "voice_stream"
+#define VOICE_CREDIT_POLL_MS     40      /* Player drain check while a session is open */
+#define VOICE_CREDIT_STEP        4096    /* Smallest grant worth a message */
+#define VOICE_CREDIT_RESERVE     1024    /* Player buffer kept out of the credit */
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static MUTEX_HANDLE g_voice_mutex = NULL;
+static TIMER_ID g_credit_timer = NULL;
+static bool g_voice_binary = false;
+static uint32_t g_voice_start_ms = 0;
+static VOICE_STREAM_STATS_T g_voice = {0};
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+
+/**
+ * @brief Player buffer space not yet promised to the server
+ */
+static uint32_t voice_credit_available(void)
+{
+    uint32_t free_len = ai_audio_player_get_free_size();
+    uint32_t in_flight = (g_voice.granted > g_voice.received) ? g_voice.granted - g_voice.received : 0;
+
+    if (free_len <= VOICE_CREDIT_RESERVE + in_flight) {
+        return 0;
+    }
+    uint32_t credit = free_len - VOICE_CREDIT_RESERVE - in_flight;
+
+    /* Never grant past the announced size */
+    if (g_voice.expected > 0) {
+        uint32_t left = (g_voice.expected > g_voice.granted) ? g_voice.expected - g_voice.granted : 0;
+        if (credit > left) {
+            credit = left;
+        }
+    }
+    return credit;
+}
+
+static void voice_send_credit(uint32_t granted)
+{
+    if (g_voice_binary) {
+        cmd_proto_send_uint(CMD_OP_VOICE_CREDIT, CMD_TLV_U32, granted);
+    } else {
+        char msg[24];
+        snprintf(msg, sizeof(msg), "vc:%u", granted);
+        tcp_client_send_str(msg);
+    }
+}
+
+/**
+ * @brief Credit timer: grant the space the player has drained since the last grant
+ */
+static void voice_credit_timer_cb(TIMER_ID timer_id, void *arg)
+{
+    uint32_t granted = 0;
+
+    tal_mutex_lock(g_voice_mutex);
+    if (g_voice.active) {
+        uint32_t credit = voice_credit_available();
+        bool last = g_voice.expected > 0 && credit > 0 && g_voice.granted + credit >= g_voice.expected;
+        if (credit >= VOICE_CREDIT_STEP || last) {
+            g_voice.granted += credit;
+            granted = g_voice.granted;
+        }
+    }
+    tal_mutex_unlock(g_voice_mutex);
+
+    if (granted > 0) {
+        voice_send_credit(granted);
+    }
+}
+
+OPERATE_RET voice_stream_init(void)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    if (g_voice_mutex) {
+        return OPRT_OK;
+    }
+    TUYA_CALL_ERR_RETURN(tal_mutex_create_init(&g_voice_mutex));
+    TUYA_CALL_ERR_RETURN(tal_sw_timer_create(voice_credit_timer_cb, NULL, &g_credit_timer));
+    return OPRT_OK;
+}
+
+uint32_t voice_stream_begin(uint32_t total_len, bool binary)
+{
+    PR_INFO("[VOICE] Starting MP3 stream playback (%u bytes expected)", total_len);
+
+    /* Stop any playing audio first */
+    if (ai_audio_player_is_playing()) {
+        ai_audio_player_stop();
+        tal_system_sleep(50); /* Wait for audio to stop */
+    }
+
+    /* Start audio player for streaming MP3 */
+    ai_audio_player_start(VOICE_PLAYER_ID);
+
+    tal_mutex_lock(g_voice_mutex);
+    g_voice.active = true;
+    g_voice.expected = total_len;
+    g_voice.received = 0;
+    g_voice.granted = 0;
+    g_voice.first_data_ms = 0;
+    g_voice.sessions++;
+    g_voice_binary = binary;
+    g_voice_start_ms = tal_system_get_millisecond();
+    g_voice.granted = voice_credit_available();
+    uint32_t credit = g_voice.granted;
+    tal_mutex_unlock(g_voice_mutex);
+
+    tal_sw_timer_start(g_credit_timer, VOICE_CREDIT_POLL_MS, TAL_TIMER_CYCLE);
+    return credit;
+}
+
+void voice_stream_write(const uint8_t *data, uint32_t len)
+{
+    if (len == 0) {
+        return;
+    }
+
+    /* May block on a full player buffer when the server ignores credit */
+    ai_audio_player_data_write(VOICE_PLAYER_ID, (uint8_t *)data, len, 0);
+
+    tal_mutex_lock(g_voice_mutex);
+    if (g_voice.received == 0) {
+        g_voice.first_data_ms = tal_system_get_millisecond() - g_voice_start_ms;
+    }
+    g_voice.received += len;
+    if (g_voice.received > g_voice.granted) {
+        g_voice.overruns++;
+    }
+    uint32_t received = g_voice.received;
+    tal_mutex_unlock(g_voice_mutex);
+
+    /* Log progress occasionally */
+    if (received % 10000 < len) {
+        PR_DEBUG("[VOICE] Streaming: %u/%u bytes (credit %u)", received, g_voice.expected, g_voice.granted);
+    }
+}
+
+uint32_t voice_stream_end(void)
+{
+    tal_sw_timer_stop(g_credit_timer);
+
+    tal_mutex_lock(g_voice_mutex);
+    g_voice.active = false;
+    uint32_t received = g_voice.received;
+    bool truncated = g_voice.expected > 0 && received < g_voice.expected;
+    if (truncated) {
+        g_voice.truncated++;
+    }
+    tal_mutex_unlock(g_voice_mutex);
+
+    if (truncated) {
+        PR_WARN("[VOICE] Stream ended short: %u/%u bytes", received, g_voice.expected);
+    } else {
+        PR_INFO("[VOICE] Stream complete: %u bytes played (first data after %u ms)",
+                received, g_voice.first_data_ms);
+    }
+
+    /* Write empty buffer with is_end=1 to signal completion */
+    ai_audio_player_data_write(VOICE_PLAYER_ID, NULL, 0, 1);
+    return received;
+}
+
+OPERATE_RET voice_stream_get_stats(VOICE_STREAM_STATS_T *stats)
+{
+    if (!stats) {
+        return OPRT_INVALID_PARM;
+    }
+    tal_mutex_lock(g_voice_mutex);
+    *stats = g_voice;
+    tal_mutex_unlock(g_voice_mutex);
+    return OPRT_OK;
+}
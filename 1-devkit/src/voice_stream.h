@@ -0,0 +1,87 @@
+/**
+ * @file voice_stream.h
+ * @brief MP3 voice message streaming into the audio player with flow control
+ *
+ * A voice message is one session: voicestart, any number of data chunks,
+ * voiceend. The device grants the server credit in bytes of MP3 data:
+ * - The voicestart reply carries the initial credit (free player buffer)
+ * - While the player drains, further grants are sent as the cumulative
+ *   number of bytes the server may have sent so far
+ *   (text "vc:<total>", binary CMD_OP_VOICE_CREDIT)
+ *
+ * A server that keeps within its credit never makes the TCP receiver
+ * block on a full player buffer. Servers that ignore credit still work,
+ * writes then block as before and are counted as overruns.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ */
+
+#ifndef __VOICE_STREAM_H__
+#define __VOICE_STREAM_H__
+
+#include "tuya_cloud_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Voice streaming statistics
+ */
+typedef struct {
+    bool active;                  /* Session in progress */
+    uint32_t expected;            /* Announced size of the current/last message */
+    uint32_t received;            /* MP3 bytes received in the current/last message */
+    uint32_t granted;             /* Cumulative credit of the current/last message */
+    uint32_t first_data_ms;       /* voicestart to first chunk of the last message */
+    uint32_t sessions;            /* Messages started */
+    uint32_t truncated;           /* Messages that ended short of their size */
+    uint32_t overruns;            /* Chunks that arrived beyond the granted credit */
+} VOICE_STREAM_STATS_T;
+
+/**
+ * @brief Initialize voice streaming (creates the credit timer)
+ *
+ * @return OPRT_OK on success
+ */
+OPERATE_RET voice_stream_init(void);
+
+/**
+ * @brief Start a voice message session
+ *
+ * Stops any playing audio and starts the player on the "voice_stream" id.
+ *
+ * @param total_len Announced message size in bytes, 0 if unknown
+ * @param binary true to send credit grants with the binary protocol
+ * @return Initial credit in bytes
+ */
+uint32_t voice_stream_begin(uint32_t total_len, bool binary);
+
+/**
+ * @brief Stream one MP3 chunk to the player
+ *
+ * @param data MP3 data
+ * @param len Chunk length
+ */
+void voice_stream_write(const uint8_t *data, uint32_t len);
+
+/**
+ * @brief End the voice message session
+ *
+ * @return Bytes received in this session
+ */
+uint32_t voice_stream_end(void);
+
+/**
+ * @brief Get voice streaming statistics
+ *
+ * @param stats Output statistics
+ * @return OPRT_OK on success, OPRT_INVALID_PARM if stats is NULL
+ */
+OPERATE_RET voice_stream_get_stats(VOICE_STREAM_STATS_T *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __VOICE_STREAM_H__ */
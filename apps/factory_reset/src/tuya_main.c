@@ -10,6 +10,7 @@
  */
 
 #include "cJSON.h"
+#include "json_arena.h"
 #include "tal_api.h"
 #include "tkl_output.h"
 #include "tuya_config.h"
@@ -145,7 +146,7 @@ void user_main(void)
     int rt = OPRT_OK;
 
     // Initialize runtime
-    cJSON_InitHooks(&(cJSON_Hooks){.malloc_fn = tal_malloc, .free_fn = tal_free});
+    json_arena_hooks_init(&(cJSON_Hooks){.malloc_fn = tal_malloc, .free_fn = tal_free});
     tal_log_init(TAL_LOG_LEVEL_DEBUG, 1024, (TAL_LOG_OUTPUT_CB)tkl_log_output);
 
     PR_NOTICE("========================================");
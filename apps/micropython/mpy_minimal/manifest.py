@@ -0,0 +1,3 @@
+# Modules frozen as bytecode, used when app_default.config sets
+# CONFIG_MICROPYTHON_FROZEN_MANIFEST="manifest.py"
+freeze("$(APP_DIR)/modules")
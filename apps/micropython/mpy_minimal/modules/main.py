@@ -0,0 +1,2 @@
+# Boot script, frozen by manifest.py and run from flash at startup
+print("main.py -> Hello from frozen MicroPython on T5AI!")
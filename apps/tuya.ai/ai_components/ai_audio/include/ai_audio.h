@@ -9,11 +9,22 @@
 #include "ai_audio_cloud_asr.h"
 #include "ai_audio_player.h"
 #include "ai_audio_input.h"
+#include "ai_audio_tts_cache.h"
+#if defined(ENABLE_AI_MONITOR) && (ENABLE_AI_MONITOR == 1)
+#include "tuya_ai_monitor.h"
+#endif
 /***********************************************************
 ************************macro define************************
 ***********************************************************/
 #define GET_MIN_LEN(a, b) ((a) < (b) ? (a) : (b))
 
+/* Latency trace points for the AI monitor, compiled out without it */
+#if defined(ENABLE_AI_MONITOR) && (ENABLE_AI_MONITOR == 1)
+#define AI_AUDIO_TRACE(event, session_id, len) tuya_ai_monitor_trace((event), (session_id), 0, (len))
+#else
+#define AI_AUDIO_TRACE(event, session_id, len)
+#endif
+
 typedef uint8_t AI_AUDIO_WORK_MODE_E;
 #define AI_AUDIO_MODE_MANUAL_SINGLE_TALK     1
 #define AI_AUDIO_WORK_VAD_FREE_TALK          2
@@ -29,6 +40,7 @@ typedef enum {
     AI_AUDIO_EVT_AI_REPLIES_TEXT_INTERUPT,
     AI_AUDIO_EVT_AI_REPLIES_EMO,
     AI_AUDIO_EVT_ASR_WAKEUP,
+    AI_AUDIO_EVT_HUMAN_ASR_PARTIAL, // interim text while the user speaks, replaced by AI_AUDIO_EVT_HUMAN_ASR_TEXT
 } AI_AUDIO_EVENT_E;
 
 typedef enum {
@@ -39,6 +39,7 @@ typedef enum {
     AI_AGENT_MSG_TP_AUDIO_DATA,
     AI_AGENT_MSG_TP_AUDIO_STOP,
     AI_AGENT_MSG_TP_EMOTION,
+    AI_AGENT_MSG_TP_TEXT_ASR_PARTIAL, // interim ASR text, the final one follows as AI_AGENT_MSG_TP_TEXT_ASR
 } AI_AGENT_MSG_TYPE_E;
 
 typedef struct {
@@ -74,7 +75,11 @@ OPERATE_RET ai_audio_agent_upload_start(uint8_t enable_vad);
 
 /**
  * @brief Uploads audio data to the AI service.
- * @param data Pointer to the audio data buffer.
+ *
+ * Built with ENABLE_AI_AUDIO_OPUS_UPLOAD=1 (needs libopus) the pcm is encoded
+ * to 20 ms Opus packets before sending.
+ *
+ * @param data Pointer to the audio data buffer, 16 kHz mono pcm. NULL ends the stream.
  * @param len Length of the audio data in bytes.
  * @return OPERATE_RET - OPRT_OK on success, or an error code on failure.
  */
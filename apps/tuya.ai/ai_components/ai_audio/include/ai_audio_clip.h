@@ -0,0 +1,76 @@
+/**
+ * @file ai_audio_clip.h
+ * @brief Cache of built-in MP3 clips decoded to PCM, played on player mixer streams.
+ *
+ * Clips are registered once with their embedded MP3 data and decoded to PCM
+ * in PSRAM either at registration or on first play, so playing a cached clip
+ * costs no decode. Decoded PCM can be evicted under memory pressure and is
+ * decoded again the next time the clip plays.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+#ifndef __AI_AUDIO_CLIP_H__
+#define __AI_AUDIO_CLIP_H__
+
+#include "tuya_cloud_types.h"
+#include "ai_audio_player.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+#define AI_AUDIO_CLIP_MAX      8
+#define AI_AUDIO_CLIP_NAME_LEN 16
+
+/***********************************************************
+********************function declaration********************
+***********************************************************/
+/**
+ * @brief Registers a built-in clip.
+ *
+ * @param name      Clip name, at most AI_AUDIO_CLIP_NAME_LEN - 1 characters.
+ * @param mp3       MP3 data, must stay valid for the lifetime of the program.
+ * @param len       Length of the MP3 data.
+ * @param preload   Decode now instead of on first play.
+ * @return OPERATE_RET - Returns OPRT_OK on success, OPRT_EXCEED_UPPER_LIMIT if the table is full,
+ *                       or the decode error when preloading.
+ */
+OPERATE_RET ai_audio_clip_register(const char *name, const uint8_t *mp3, uint32_t len, bool preload);
+
+/**
+ * @brief Plays a clip once on a mixer stream, decoding it first if it is not cached.
+ *
+ * @param name      Clip name.
+ * @param stream    Mixer stream from ai_audio_player_mix_open().
+ * @return OPERATE_RET - Returns OPRT_OK on success, OPRT_NOT_FOUND for an unknown clip,
+ *                       or the decode error.
+ */
+OPERATE_RET ai_audio_clip_play(const char *name, AI_AUDIO_MIX_STREAM_T stream);
+
+/**
+ * @brief Releases decoded PCM, least recently played first.
+ *
+ * Clips still playing are kept.
+ *
+ * @param bytes     PCM bytes wanted back, 0 for all that can be released.
+ * @return uint32_t - Bytes released.
+ */
+uint32_t ai_audio_clip_evict(uint32_t bytes);
+
+/**
+ * @brief Gets the PSRAM held by decoded clips.
+ *
+ * @param None
+ * @return uint32_t - Bytes of cached PCM.
+ */
+uint32_t ai_audio_clip_cached_size(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __AI_AUDIO_CLIP_H__ */
@@ -83,10 +83,37 @@ OPERATE_RET ai_audio_input_restart_asr_awake_timer(void);
 
 uint32_t ai_audio_get_input_data(uint8_t *buff, uint32_t buff_len);
 
+/**
+ * @brief Gets the oldest contiguous run of buffered input without copying it.
+ *
+ * The data stays buffered until released with ai_audio_release_input_data().
+ * The mic callback only writes free space, but a reset of the input buffer
+ * (wake-up, valid data disabled) frees it, so newer input may then overwrite
+ * the run before it is released.
+ *
+ * @param data      Output: start of the unread input.
+ * @param max_len   Longest run wanted.
+ * @param gen       Output: buffer generation, passed back on release.
+ * @return uint32_t - Bytes readable at data, less than the buffered size at the
+ *                    wrap point.
+ */
+uint32_t ai_audio_peek_input_data(uint8_t **data, uint32_t max_len, uint32_t *gen);
+
 uint32_t ai_audio_get_input_data_size(void);
 
 void ai_audio_discard_input_data(uint32_t discard_size);
 
+/**
+ * @brief Releases input taken with ai_audio_peek_input_data().
+ *
+ * Nothing is discarded when the buffer was reset since the peek, so input
+ * captured after the reset is kept.
+ *
+ * @param release_size  Bytes to release, at most the peeked length.
+ * @param gen           Generation returned by the peek.
+ */
+void ai_audio_release_input_data(uint32_t release_size, uint32_t gen);
+
 #ifdef __cplusplus
 }
 #endif
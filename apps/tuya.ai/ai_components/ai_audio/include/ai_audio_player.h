@@ -23,6 +23,8 @@ extern "C" {
 /***********************************************************
 ************************macro define************************
 ***********************************************************/
+#define AI_AUDIO_MIX_STREAM_MAX 3
+#define AI_AUDIO_MIX_GAIN_UNITY 256 /* Q8 gain of 1.0 */
 
 /***********************************************************
 ***********************typedef define***********************
@@ -36,6 +38,15 @@ typedef enum {
     AI_AUDIO_PLAYER_STAT_MAX,
 } AI_AUDIO_PLAYER_STATE_E;
 
+typedef uint8_t AI_AUDIO_MIX_STREAM_T;
+
+/* How a stream is mixed into the output */
+typedef struct {
+    uint8_t priority;   // streams below the highest playing priority are ducked
+    uint16_t gain;      // Q8, AI_AUDIO_MIX_GAIN_UNITY = 1.0
+    uint16_t duck_gain; // Q8, applied on top of gain while ducked
+} AI_AUDIO_MIX_CFG_T;
+
 /***********************************************************
 ********************function declaration********************
 ***********************************************************/
@@ -71,6 +82,22 @@ OPERATE_RET ai_audio_player_start(char *id);
  */
 OPERATE_RET ai_audio_player_data_write(char *id, uint8_t *data, uint32_t len, uint8_t is_eof);
 
+/**
+ * @brief Gets the free space of the stream ring buffer.
+ *
+ * @param None
+ * @return uint32_t - Bytes that ai_audio_player_data_write() can take without waiting.
+ */
+uint32_t ai_audio_player_get_free_size(void);
+
+/**
+ * @brief Gets the output latency, mixed pcm handed to tdl_audio but not yet played.
+ *
+ * @param None
+ * @return uint32_t - Latency in ms, 0 before init.
+ */
+uint32_t ai_audio_player_get_latency_ms(void);
+
 /**
  * @brief Stops the audio player and clears the audio output buffer.
  *
@@ -87,6 +114,99 @@ OPERATE_RET ai_audio_player_stop(void);
  */
 uint8_t ai_audio_player_is_playing(void);
 
+/**
+ * @brief Sets how the mp3 stream is mixed with the mixer streams.
+ *
+ * @param cfg       Priority, gain and duck gain for the mp3 stream.
+ * @return OPERATE_RET - Returns OPRT_OK on success, OPRT_INVALID_PARM if cfg is NULL.
+ */
+OPERATE_RET ai_audio_player_set_mix(const AI_AUDIO_MIX_CFG_T *cfg);
+
+/**
+ * @brief Opens a pcm stream that is mixed with the mp3 stream.
+ *
+ * @param cfg       Priority, gain and duck gain for the stream.
+ * @param stream    Output: stream handle.
+ * @return OPERATE_RET - Returns OPRT_OK on success, OPRT_EXCEED_UPPER_LIMIT if all streams are open.
+ */
+OPERATE_RET ai_audio_player_mix_open(const AI_AUDIO_MIX_CFG_T *cfg, AI_AUDIO_MIX_STREAM_T *stream);
+
+/**
+ * @brief Queues pcm on a mixer stream, waiting while the stream is full.
+ *
+ * The stream holds 40 ms, so the output rate paces the caller the way
+ * tdl_audio_play() does.
+ *
+ * @param stream     Stream handle.
+ * @param data       16-bit mono pcm at the codec sample rate.
+ * @param len        Length of the data in bytes.
+ * @param timeout_ms Longest wait for space.
+ * @return OPERATE_RET - Returns OPRT_OK when all data was queued, OPRT_TIMEOUT if the mixer did not take it in time.
+ */
+OPERATE_RET ai_audio_player_mix_write(AI_AUDIO_MIX_STREAM_T stream, const uint8_t *data, uint32_t len,
+                                      uint32_t timeout_ms);
+
+/**
+ * @brief Plays a pcm buffer once on a mixer stream, without copying it.
+ *
+ * Replaces whatever the stream was playing. The buffer must stay valid
+ * until ai_audio_player_mix_is_active() returns false or the stream is stopped.
+ *
+ * @param stream    Stream handle.
+ * @param data      16-bit mono pcm at the codec sample rate.
+ * @param len       Length of the data in bytes.
+ * @return OPERATE_RET - Returns OPRT_OK on success.
+ */
+OPERATE_RET ai_audio_player_mix_play_buf(AI_AUDIO_MIX_STREAM_T stream, const uint8_t *data, uint32_t len);
+
+/**
+ * @brief Drops everything queued on a mixer stream.
+ *
+ * @param stream    Stream handle.
+ * @return OPERATE_RET - Returns OPRT_OK on success.
+ */
+OPERATE_RET ai_audio_player_mix_stop(AI_AUDIO_MIX_STREAM_T stream);
+
+/**
+ * @brief Checks if a mixer stream still has audio to play.
+ *
+ * @param stream    Stream handle.
+ * @return bool - Returns true while queued or one-shot pcm is left.
+ */
+bool ai_audio_player_mix_is_active(AI_AUDIO_MIX_STREAM_T stream);
+
+/**
+ * @brief Decodes a whole mp3 buffer into 16-bit pcm, e.g. a built-in prompt
+ *        to be played with ai_audio_player_mix_play_buf().
+ *
+ * Uses its own decoder, so the mp3 stream is not disturbed. The pcm is mono
+ * at the codec rate whatever the mp3 was encoded at.
+ *
+ * @param mp3       Mp3 data.
+ * @param len       Length of the mp3 data.
+ * @param pcm       Output: pcm buffer in PSRAM, release with tkl_system_psram_free().
+ * @param pcm_len   Output: length of the pcm in bytes.
+ * @return OPERATE_RET - Returns OPRT_OK on success, OPRT_MALLOC_FAILED if out of memory,
+ *                       OPRT_COM_ERROR if no frame was found.
+ */
+OPERATE_RET ai_audio_player_mp3_to_pcm(const uint8_t *mp3, uint32_t len, uint8_t **pcm, uint32_t *pcm_len);
+
+/**
+ * @brief Decodes an mp3 buffer repeatedly and measures the decoder alone.
+ *
+ * Uses its own decoder and pcm buffer, so it can run while the player is idle
+ * or playing. The result includes minimp3's per-frame scratch allocation.
+ *
+ * @param mp3       Mp3 data.
+ * @param len       Length of the mp3 data.
+ * @param loops     Number of passes over the data.
+ * @param frames    Output: frames decoded.
+ * @param elapsed_ms Output: total decode time.
+ * @return OPERATE_RET - Returns OPRT_OK on success, OPRT_MALLOC_FAILED if out of memory.
+ */
+OPERATE_RET ai_audio_player_mp3_bench(const uint8_t *mp3, uint32_t len, uint32_t loops, uint32_t *frames,
+                                      uint32_t *elapsed_ms);
+
 #ifdef __cplusplus
 }
 #endif
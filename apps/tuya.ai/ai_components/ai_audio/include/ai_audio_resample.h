@@ -0,0 +1,97 @@
+/**
+ * @file ai_audio_resample.h
+ * @brief Polyphase resampler and downmix from decoded mp3 pcm to the codec format.
+ *
+ * Converts 16-bit interleaved mono or stereo at any mp3 sample rate to 16-bit
+ * mono at the codec rate, one decoded frame at a time. The filter is a
+ * windowed sinc with AI_AUDIO_RS_TAPS taps in AI_AUDIO_RS_PHASES phases,
+ * designed for the actual ratio so downsampling is band-limited.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+#ifndef __AI_AUDIO_RESAMPLE_H__
+#define __AI_AUDIO_RESAMPLE_H__
+
+#include "tuya_cloud_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+#define AI_AUDIO_RS_TAPS   16
+#define AI_AUDIO_RS_PHASES 32
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef struct {
+    uint32_t in_hz;
+    uint32_t out_hz;
+    uint8_t in_ch;
+    uint32_t step; // Q16 input samples per output sample
+    uint32_t pos;  // Q16 read position from the first history sample
+    uint16_t hist_len;
+    int16_t hist[AI_AUDIO_RS_TAPS];
+    int16_t coef[AI_AUDIO_RS_PHASES][AI_AUDIO_RS_TAPS];
+} AI_AUDIO_RESAMPLE_T;
+
+/***********************************************************
+********************function declaration********************
+***********************************************************/
+/**
+ * @brief Sets the resampler up for an input format and clears its history.
+ *
+ * @param rs        Resampler state.
+ * @param in_hz     Input sample rate.
+ * @param in_ch     Input channels, 1 or 2.
+ * @param out_hz    Output sample rate.
+ * @return None
+ */
+void ai_audio_resample_setup(AI_AUDIO_RESAMPLE_T *rs, uint32_t in_hz, uint8_t in_ch, uint32_t out_hz);
+
+/**
+ * @brief Checks whether the input format differs from the codec format.
+ *
+ * @param rs        Resampler state.
+ * @return bool - Returns true if ai_audio_resample_process() has work to do.
+ */
+static inline bool ai_audio_resample_needed(const AI_AUDIO_RESAMPLE_T *rs)
+{
+    return rs->in_hz != rs->out_hz || rs->in_ch != 1;
+}
+
+/**
+ * @brief Converts one block of input.
+ *
+ * The input must sit at work + AI_AUDIO_RS_TAPS, the space before it is used
+ * to join the block to the previous one without copying the block. Output may
+ * not overlap the work buffer.
+ *
+ * @param rs        Resampler state.
+ * @param work      Buffer of AI_AUDIO_RS_TAPS samples followed by the input.
+ * @param frames    Input frames (samples per channel).
+ * @param out       Output mono pcm.
+ * @param out_max   Output capacity in samples.
+ * @return uint32_t - Output samples written.
+ */
+uint32_t ai_audio_resample_process(AI_AUDIO_RESAMPLE_T *rs, int16_t *work, uint32_t frames, int16_t *out,
+                                   uint32_t out_max);
+
+/**
+ * @brief Gets the output samples a block of input can produce at most.
+ *
+ * @param rs        Resampler state.
+ * @param frames    Input frames.
+ * @return uint32_t - Output samples upper bound.
+ */
+uint32_t ai_audio_resample_out_max(const AI_AUDIO_RESAMPLE_T *rs, uint32_t frames);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __AI_AUDIO_RESAMPLE_H__ */
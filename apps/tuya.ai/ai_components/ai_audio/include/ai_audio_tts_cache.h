@@ -0,0 +1,143 @@
+/**
+ * @file ai_audio_tts_cache.h
+ * @brief Cache of short TTS replies, keyed by normalized NLG text and voice.
+ *
+ * The MP3 of every short cloud reply is recorded while it streams to the
+ * player and kept in PSRAM together with its text. When the same text comes
+ * back before its audio has started, the cached MP3 plays at once and the
+ * cloud stream of that reply is dropped. Apps can also play a cached phrase
+ * directly, without a cloud round trip. Entries are evicted least recently
+ * used first.
+ *
+ * Text is normalized before hashing: ASCII is lowercased, punctuation and
+ * whitespace runs collapse to one space, and leading and trailing spaces are
+ * dropped, so "OK." and "ok" share an entry.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+#ifndef __AI_AUDIO_TTS_CACHE_H__
+#define __AI_AUDIO_TTS_CACHE_H__
+
+#include "tuya_cloud_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+#ifndef AI_AUDIO_TTS_CACHE_ENTRY_MAX
+#define AI_AUDIO_TTS_CACHE_ENTRY_MAX 16
+#endif
+
+/* PSRAM held by all cached MP3 */
+#ifndef AI_AUDIO_TTS_CACHE_SIZE
+#define AI_AUDIO_TTS_CACHE_SIZE (192 * 1024)
+#endif
+
+/* Longer replies are not cached; also keeps a cached reply within the player's stream buffer */
+#ifndef AI_AUDIO_TTS_CACHE_MP3_MAX
+#define AI_AUDIO_TTS_CACHE_MP3_MAX (32 * 1024)
+#endif
+
+/* Normalized text, longer replies are not cached */
+#ifndef AI_AUDIO_TTS_CACHE_TEXT_MAX
+#define AI_AUDIO_TTS_CACHE_TEXT_MAX 128
+#endif
+
+#define AI_AUDIO_TTS_CACHE_VOICE_LEN 32
+
+/***********************************************************
+********************function declaration********************
+***********************************************************/
+/**
+ * @brief Sets the voice the cloud synthesizes with, part of the cache key.
+ *
+ * Entries of another voice are released.
+ *
+ * @param voice     Voice id, NULL or "" for the default voice.
+ * @return OPERATE_RET - Returns OPRT_OK on success, OPRT_INVALID_PARM if the id is too long.
+ */
+OPERATE_RET ai_audio_tts_cache_set_voice(const char *voice);
+
+/**
+ * @brief Plays a cached reply on the mp3 stream of the player.
+ *
+ * Stops whatever the player was playing.
+ *
+ * @param text      Reply text, normalized before the lookup.
+ * @param len       Length of the text.
+ * @return OPERATE_RET - Returns OPRT_OK on success, OPRT_NOT_FOUND if the text is not cached.
+ */
+OPERATE_RET ai_audio_tts_cache_play(const char *text, uint32_t len);
+
+/**
+ * @brief Starts recording a cloud reply, at NLG start.
+ *
+ * @param None
+ * @return None
+ */
+void ai_audio_tts_cache_reply_start(void);
+
+/**
+ * @brief Adds NLG text to the reply being recorded.
+ *
+ * @param text      Text chunk.
+ * @param len       Length of the chunk.
+ * @param eof       The reply text is complete.
+ * @return None
+ */
+void ai_audio_tts_cache_reply_text(const uint8_t *text, uint32_t len, bool eof);
+
+/**
+ * @brief Adds TTS audio to the reply being recorded.
+ *
+ * The reply is cached once both its text and its audio are complete.
+ *
+ * @param mp3       MP3 chunk, may be NULL at the end.
+ * @param len       Length of the chunk.
+ * @param eof       The reply audio is complete.
+ * @return None
+ */
+void ai_audio_tts_cache_reply_audio(const uint8_t *mp3, uint32_t len, bool eof);
+
+/**
+ * @brief Plays the recorded reply text from the cache, at NLG end.
+ *
+ * @param None
+ * @return OPERATE_RET - Returns OPRT_OK if the reply is playing from the cache,
+ *                       OPRT_NOT_FOUND if the cloud audio is needed.
+ */
+OPERATE_RET ai_audio_tts_cache_reply_play(void);
+
+/**
+ * @brief Drops the reply being recorded, e.g. when it was interrupted.
+ *
+ * @param None
+ * @return None
+ */
+void ai_audio_tts_cache_reply_abort(void);
+
+/**
+ * @brief Releases all cached replies.
+ *
+ * @param None
+ * @return uint32_t - Bytes released.
+ */
+uint32_t ai_audio_tts_cache_clear(void);
+
+/**
+ * @brief Gets the PSRAM held by cached replies.
+ *
+ * @param None
+ * @return uint32_t - Bytes of cached MP3.
+ */
+uint32_t ai_audio_tts_cache_cached_size(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __AI_AUDIO_TTS_CACHE_H__ */
@@ -15,6 +15,8 @@
 
 #include "tuya_iot.h"
 #include "tuya_iot_dp.h"
+#include "tuya_health.h"
+#include "json_arena.h"
 
 #include "tuya_ai_biz.h"
 #include "tuya_ai_protocol.h"
@@ -26,11 +28,22 @@
 
 #include "ai_audio.h"
 
+#if defined(ENABLE_AI_AUDIO_OPUS_UPLOAD) && (ENABLE_AI_AUDIO_OPUS_UPLOAD == 1)
+#include "opus.h"
+#endif
+
 /***********************************************************
 ************************macro define************************
 ***********************************************************/
 #define AI_AGENT_NLG_TEXT_MAX_LEN (4 * 1024)
 
+#define AI_AGENT_OPUS_FRAME_BYTES AI_AUDIO_VOICE_FRAME_LEN_GET(20) // one packet, 320 samples
+#define AI_AGENT_OPUS_PKT_MAX     256
+#define AI_AGENT_OPUS_BITRATE     24000
+#define AI_AGENT_OPUS_COMPLEXITY  3
+
+#define AI_AGENT_HEALTH_QUIET_MS  (30 * 1000) // health checks wait, unless the chat ends first
+
 #define TY_BIZCODE_AI_CHAT     0x00010001 // 聊天场景可支持打断
 #define TY_AI_CHAT_ID_DS_CNT   4
 #define TY_AI_CHAT_ID_DS_AUDIO 1
@@ -53,11 +66,20 @@ typedef struct {
     AI_AGENT_CBS_T           cbs;
     AI_AGENT_CHAT_STREAM_E   stream_status;
     bool                     is_audio_upload_first_frame;
+#if defined(ENABLE_AI_AUDIO_OPUS_UPLOAD) && (ENABLE_AI_AUDIO_OPUS_UPLOAD == 1)
+    OpusEncoder             *opus_enc;
+    uint8_t                 *opus_pcm;      // pcm carried over until a whole frame is in
+    uint32_t                 opus_pcm_len;
+    uint8_t                 *opus_pkt;
+#endif
 } AI_AGENT_SESSION_T;
 // clang-format on
 /***********************************************************
 ********************function declaration********************
 ***********************************************************/
+#if defined(ENABLE_AI_AUDIO_OPUS_UPLOAD) && (ENABLE_AI_AUDIO_OPUS_UPLOAD == 1)
+static OPERATE_RET __ai_agent_opus_start(void);
+#endif
 
 /***********************************************************
 ***********************variable define**********************
@@ -84,6 +106,7 @@ static OPERATE_RET __ai_agent_audio_recv(AI_BIZ_ATTR_INFO_T *attr, AI_BIZ_HEAD_I
 
     switch (head->stream_flag) {
     case AI_STREAM_START: {
+        AI_AUDIO_TRACE(AI_TRACE_TTS_FIRST, NULL, len);
         AI_AGENT_MSG_T ai_msg = {
             .type = AI_AGENT_MSG_TP_AUDIO_START,
             .data_len = len,
@@ -104,6 +127,7 @@ static OPERATE_RET __ai_agent_audio_recv(AI_BIZ_ATTR_INFO_T *attr, AI_BIZ_HEAD_I
         }
 
         if (AI_STREAM_END == head->stream_flag) {
+            AI_AUDIO_TRACE(AI_TRACE_TTS_END, NULL, 0);
             ai_msg.type = AI_AGENT_MSG_TP_AUDIO_STOP;
             ai_msg.data_len = 0;
             ai_msg.data = NULL;
@@ -120,6 +144,29 @@ static OPERATE_RET __ai_agent_audio_recv(AI_BIZ_ATTR_INFO_T *attr, AI_BIZ_HEAD_I
     return OPRT_OK;
 }
 
+static OPERATE_RET _parse_asr_partial(cJSON *json)
+{
+    cJSON *node;
+    AI_AGENT_MSG_T ai_msg = {0};
+
+    node = cJSON_GetObjectItem(json, "data");
+    node = cJSON_GetObjectItem(node, "text");
+    const char *text = cJSON_GetStringValue(node);
+    if (text == NULL || text[0] == '\0') {
+        return OPRT_OK;
+    }
+
+    ai_msg.type = AI_AGENT_MSG_TP_TEXT_ASR_PARTIAL;
+    ai_msg.data = (uint8_t *)text;
+    ai_msg.data_len = strlen(text);
+
+    if (sg_ai.cbs.ai_agent_msg_cb) {
+        sg_ai.cbs.ai_agent_msg_cb(&ai_msg);
+    }
+
+    return OPRT_OK;
+}
+
 static OPERATE_RET _parse_asr(cJSON *json)
 {
     cJSON *node;
@@ -138,6 +185,7 @@ static OPERATE_RET _parse_asr(cJSON *json)
         ai_msg.data_len = strlen(text);
     }
     ai_msg.type = AI_AGENT_MSG_TP_TEXT_ASR;
+    AI_AUDIO_TRACE(AI_TRACE_ASR_RESULT, NULL, ai_msg.data_len);
 
     if (sg_ai.cbs.ai_agent_msg_cb) {
         sg_ai.cbs.ai_agent_msg_cb(&ai_msg);
@@ -157,6 +205,7 @@ static OPERATE_RET _parse_nlg(cJSON *json, uint8_t eof)
 
     if (AI_AGENT_CHAT_STREAM_START == sg_ai.stream_status) {
         sg_ai.stream_status = AI_AGENT_CHAT_STREAM_DATA;
+        AI_AUDIO_TRACE(AI_TRACE_NLG_START, NULL, 0);
 
         ai_msg.type = AI_AGENT_MSG_TP_TEXT_NLG_START;
         ai_msg.data_len = strlen(sg_ai.stream_event_id);
@@ -290,8 +339,11 @@ static OPERATE_RET _parse_skill(cJSON *json)
 static OPERATE_RET __ai_agent_txt_recv(AI_BIZ_ATTR_INFO_T *attr, AI_BIZ_HEAD_INFO_T *head, char *data, void *usr_data)
 {
     cJSON *json, *node;
+    JSON_ARENA_T arena;
 
-    if ((json = cJSON_Parse(data)) == NULL) {
+    // one text per streamed NLG chunk, the nodes come from one arena and go in one shot
+    if ((json = json_arena_parse(&arena, data)) == NULL) {
+        json_arena_end(&arena);
         return OPRT_OK;
     }
 
@@ -306,6 +358,9 @@ static OPERATE_RET __ai_agent_txt_recv(AI_BIZ_ATTR_INFO_T *attr, AI_BIZ_HEAD_INF
     if (eof && strcmp(bizType, "ASR") == 0) {
         // parse data.text
         _parse_asr(json);
+    } else if (strcmp(bizType, "ASR") == 0) {
+        // interim result, shown while the final one is still coming
+        _parse_asr_partial(json);
     } else if (strcmp(bizType, "NLG") == 0) {
         _parse_nlg(json, eof);
     } else if (eof && strcmp(bizType, "SKILL") == 0) {
@@ -313,6 +368,7 @@ static OPERATE_RET __ai_agent_txt_recv(AI_BIZ_ATTR_INFO_T *attr, AI_BIZ_HEAD_INF
     }
 
     cJSON_Delete(json);
+    json_arena_end(&arena);
     return OPRT_OK;
 }
 
@@ -326,10 +382,12 @@ static OPERATE_RET __ai_agent_event_recv(AI_EVENT_TYPE type, AI_SESSION_ID sessi
         // update stream event id
         strncpy(sg_ai.stream_event_id, event_id, AI_UUID_V4_LEN);
         sg_ai.stream_status = AI_AGENT_CHAT_STREAM_START;
+        tuya_health_quiet(AI_AGENT_HEALTH_QUIET_MS);
     } else if (type == AI_EVENT_PAYLOADS_END) {
         // clear stream event id
     } else if (type == AI_EVENT_END) {
         // stream end
+        tuya_health_quiet(0);
     } else if (type == AI_EVENT_CHAT_BREAK || type == AI_EVENT_SERVER_VAD) {
         if (strcmp(event_id, sg_ai.stream_event_id) != 0) {
             PR_DEBUG("recv chat break or srv vad, but current stream is empty");
@@ -337,6 +395,7 @@ static OPERATE_RET __ai_agent_event_recv(AI_EVENT_TYPE type, AI_SESSION_ID sessi
         } else {
             // clear stream event id
             memset(sg_ai.stream_event_id, 0, AI_UUID_V4_LEN);
+            tuya_health_quiet(0);
         }
     }
 
@@ -537,28 +596,27 @@ OPERATE_RET ai_audio_agent_upload_start(uint8_t enable_vad)
     }
 
     sg_ai.is_audio_upload_first_frame = true;
+    tuya_health_quiet(AI_AGENT_HEALTH_QUIET_MS);
+    AI_AUDIO_TRACE(AI_TRACE_UPLOAD_START, sg_ai.session_id, 0);
+#if defined(ENABLE_AI_AUDIO_OPUS_UPLOAD) && (ENABLE_AI_AUDIO_OPUS_UPLOAD == 1)
+    TUYA_CALL_ERR_RETURN(__ai_agent_opus_start());
+#endif
     PR_DEBUG("upload start event_id:%s", sg_ai.event_id);
 
     return rt;
 }
 
-/**
- * @brief Uploads audio data to the AI service.
- * @param data Pointer to the audio data buffer.
- * @param len Length of the audio data in bytes.
- * @return OPERATE_RET - OPRT_OK on success, or an error code on failure.
- */
-OPERATE_RET ai_audio_agent_upload_data(uint8_t *data, uint32_t len)
+static OPERATE_RET __ai_agent_audio_send(AI_AUDIO_CODEC_TYPE codec_type, uint8_t *data, uint32_t len)
 {
     OPERATE_RET rt = OPRT_OK;
 
-    // send data use tuya_ai_send_biz_pkt, pcm
+    // send data use tuya_ai_send_biz_pkt
     AI_BIZ_ATTR_INFO_T attr = {
         .flag = AI_HAS_ATTR,
         .type = AI_PT_AUDIO,
         .value.audio =
             {
-                .base.codec_type = AUDIO_CODEC_PCM,
+                .base.codec_type = codec_type,
                 .base.sample_rate = 16000,
                 .base.channels = AUDIO_CHANNELS_MONO,
                 .base.bit_depth = 16,
@@ -593,6 +651,130 @@ OPERATE_RET ai_audio_agent_upload_data(uint8_t *data, uint32_t len)
     return rt;
 }
 
+#if defined(ENABLE_AI_AUDIO_OPUS_UPLOAD) && (ENABLE_AI_AUDIO_OPUS_UPLOAD == 1)
+static OPERATE_RET __ai_agent_opus_start(void)
+{
+    int err = OPUS_OK;
+
+    if (NULL == sg_ai.opus_enc) {
+        sg_ai.opus_pcm = (uint8_t *)tkl_system_psram_malloc(AI_AGENT_OPUS_FRAME_BYTES);
+        sg_ai.opus_pkt = (uint8_t *)tkl_system_psram_malloc(AI_AGENT_OPUS_PKT_MAX);
+        if (NULL == sg_ai.opus_pcm || NULL == sg_ai.opus_pkt) {
+            goto __ERR;
+        }
+        sg_ai.opus_enc = opus_encoder_create(16000, 1, OPUS_APPLICATION_VOIP, &err);
+        if (OPUS_OK != err || NULL == sg_ai.opus_enc) {
+            PR_ERR("opus encoder create failed: %d", err);
+            goto __ERR;
+        }
+        opus_encoder_ctl(sg_ai.opus_enc, OPUS_SET_BITRATE(AI_AGENT_OPUS_BITRATE));
+        opus_encoder_ctl(sg_ai.opus_enc, OPUS_SET_COMPLEXITY(AI_AGENT_OPUS_COMPLEXITY));
+        opus_encoder_ctl(sg_ai.opus_enc, OPUS_SET_SIGNAL(OPUS_SIGNAL_VOICE));
+    } else {
+        opus_encoder_ctl(sg_ai.opus_enc, OPUS_RESET_STATE);
+    }
+    sg_ai.opus_pcm_len = 0;
+
+    return OPRT_OK;
+
+__ERR:
+    if (sg_ai.opus_pcm) {
+        tkl_system_psram_free(sg_ai.opus_pcm);
+        sg_ai.opus_pcm = NULL;
+    }
+    if (sg_ai.opus_pkt) {
+        tkl_system_psram_free(sg_ai.opus_pkt);
+        sg_ai.opus_pkt = NULL;
+    }
+    sg_ai.opus_enc = NULL;
+
+    return OPRT_MALLOC_FAILED;
+}
+
+static OPERATE_RET __ai_agent_opus_send_frame(const uint8_t *pcm)
+{
+    opus_int32 pkt_len = opus_encode(sg_ai.opus_enc, (const opus_int16 *)pcm, AI_AGENT_OPUS_FRAME_BYTES / 2,
+                                     sg_ai.opus_pkt, AI_AGENT_OPUS_PKT_MAX);
+    if (pkt_len < 0) {
+        PR_ERR("opus encode failed: %d", pkt_len);
+        return OPRT_COM_ERROR;
+    }
+
+    return __ai_agent_audio_send(AUDIO_CODEC_OPUS, sg_ai.opus_pkt, pkt_len);
+}
+
+/**
+ * @brief Encodes pcm into 20 ms Opus packets, one per audio packet.
+ *
+ * A partial frame is carried over to the next call and zero padded at the
+ * end of the stream.
+ */
+static OPERATE_RET __ai_agent_opus_upload(uint8_t *data, uint32_t len)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    if (NULL == sg_ai.opus_enc) {
+        return OPRT_COM_ERROR;
+    }
+
+    if (NULL == data) {
+        if (sg_ai.opus_pcm_len > 0) {
+            memset(sg_ai.opus_pcm + sg_ai.opus_pcm_len, 0, AI_AGENT_OPUS_FRAME_BYTES - sg_ai.opus_pcm_len);
+            sg_ai.opus_pcm_len = 0;
+            TUYA_CALL_ERR_LOG(__ai_agent_opus_send_frame(sg_ai.opus_pcm));
+        }
+        return __ai_agent_audio_send(AUDIO_CODEC_OPUS, NULL, 0);
+    }
+
+    if (sg_ai.opus_pcm_len > 0) {
+        uint32_t fill = AI_AGENT_OPUS_FRAME_BYTES - sg_ai.opus_pcm_len;
+        fill = (fill > len) ? len : fill;
+        memcpy(sg_ai.opus_pcm + sg_ai.opus_pcm_len, data, fill);
+        sg_ai.opus_pcm_len += fill;
+        data += fill;
+        len -= fill;
+        if (sg_ai.opus_pcm_len < AI_AGENT_OPUS_FRAME_BYTES) {
+            return OPRT_OK;
+        }
+        sg_ai.opus_pcm_len = 0;
+        TUYA_CALL_ERR_RETURN(__ai_agent_opus_send_frame(sg_ai.opus_pcm));
+    }
+
+    // whole frames encode straight from the caller's buffer
+    while (len >= AI_AGENT_OPUS_FRAME_BYTES) {
+        TUYA_CALL_ERR_RETURN(__ai_agent_opus_send_frame(data));
+        data += AI_AGENT_OPUS_FRAME_BYTES;
+        len -= AI_AGENT_OPUS_FRAME_BYTES;
+    }
+
+    if (len > 0) {
+        memcpy(sg_ai.opus_pcm, data, len);
+        sg_ai.opus_pcm_len = len;
+    }
+
+    return rt;
+}
+#endif
+
+/**
+ * @brief Uploads audio data to the AI service.
+ *
+ * With ENABLE_AI_AUDIO_OPUS_UPLOAD the pcm is encoded to Opus on the device
+ * and sent as AUDIO_CODEC_OPUS, about a tenth of the pcm size.
+ *
+ * @param data Pointer to the audio data buffer, 16 kHz mono pcm. NULL ends the stream.
+ * @param len Length of the audio data in bytes.
+ * @return OPERATE_RET - OPRT_OK on success, or an error code on failure.
+ */
+OPERATE_RET ai_audio_agent_upload_data(uint8_t *data, uint32_t len)
+{
+#if defined(ENABLE_AI_AUDIO_OPUS_UPLOAD) && (ENABLE_AI_AUDIO_OPUS_UPLOAD == 1)
+    return __ai_agent_opus_upload(data, len);
+#else
+    return __ai_agent_audio_send(AUDIO_CODEC_PCM, data, len);
+#endif
+}
+
 /**
  * @brief Stops the AI audio upload process.
  * @param None
@@ -623,6 +805,7 @@ OPERATE_RET ai_audio_agent_upload_stop(void)
     }
 
     TUYA_CALL_ERR_RETURN(tuya_ai_event_end(sg_ai.session_id, sg_ai.event_id, NULL, 0));
+    AI_AUDIO_TRACE(AI_TRACE_UPLOAD_END, sg_ai.session_id, 0);
 
     return rt;
 }
@@ -0,0 +1,243 @@
+/**
+ * @file ai_audio_clip.c
+ * @brief Cache of built-in MP3 clips decoded to PCM, played on player mixer streams.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+#include "tkl_memory.h"
+#include "tkl_system.h"
+
+#include "tal_api.h"
+
+#include "ai_audio_clip.h"
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef struct {
+    char name[AI_AUDIO_CLIP_NAME_LEN];
+    const uint8_t *mp3;
+    uint32_t mp3_len;
+
+    uint8_t *pcm; // NULL while not cached
+    uint32_t pcm_len;
+    SYS_TIME_T last_play;
+    AI_AUDIO_MIX_STREAM_T stream; // stream of the last play, checked before eviction
+    bool played;
+} AI_AUDIO_CLIP_T;
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static AI_AUDIO_CLIP_T sg_clips[AI_AUDIO_CLIP_MAX];
+static uint8_t sg_clip_num = 0;
+static MUTEX_HANDLE sg_clip_mutex = NULL;
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+static AI_AUDIO_CLIP_T *__ai_audio_clip_find(const char *name)
+{
+    for (uint8_t i = 0; i < sg_clip_num; i++) {
+        if (0 == strcmp(sg_clips[i].name, name)) {
+            return &sg_clips[i];
+        }
+    }
+
+    return NULL;
+}
+
+static bool __ai_audio_clip_in_use(AI_AUDIO_CLIP_T *clip)
+{
+    return clip->played && ai_audio_player_mix_is_active(clip->stream);
+}
+
+static uint32_t __ai_audio_clip_evict(uint32_t bytes, AI_AUDIO_CLIP_T *keep)
+{
+    uint32_t freed = 0;
+
+    while (0 == bytes || freed < bytes) {
+        AI_AUDIO_CLIP_T *lru = NULL;
+        for (uint8_t i = 0; i < sg_clip_num; i++) {
+            AI_AUDIO_CLIP_T *clip = &sg_clips[i];
+            if (NULL == clip->pcm || clip == keep || __ai_audio_clip_in_use(clip)) {
+                continue;
+            }
+            if (NULL == lru || clip->last_play < lru->last_play) {
+                lru = clip;
+            }
+        }
+        if (NULL == lru) {
+            break;
+        }
+
+        PR_DEBUG("clip %s evicted, %u bytes", lru->name, lru->pcm_len);
+        tkl_system_psram_free(lru->pcm);
+        freed += lru->pcm_len;
+        lru->pcm = NULL;
+        lru->pcm_len = 0;
+    }
+
+    return freed;
+}
+
+static OPERATE_RET __ai_audio_clip_decode(AI_AUDIO_CLIP_T *clip)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    if (clip->pcm) {
+        return OPRT_OK;
+    }
+
+    rt = ai_audio_player_mp3_to_pcm(clip->mp3, clip->mp3_len, &clip->pcm, &clip->pcm_len);
+    if (OPRT_MALLOC_FAILED == rt && __ai_audio_clip_evict(0, clip) > 0) {
+        // retry with the other clips released
+        rt = ai_audio_player_mp3_to_pcm(clip->mp3, clip->mp3_len, &clip->pcm, &clip->pcm_len);
+    }
+    if (OPRT_OK != rt) {
+        PR_ERR("clip %s decode failed: %d", clip->name, rt);
+        clip->pcm = NULL;
+        clip->pcm_len = 0;
+        return rt;
+    }
+
+    PR_DEBUG("clip %s cached, %u bytes mp3 -> %u bytes pcm", clip->name, clip->mp3_len, clip->pcm_len);
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief Registers a built-in clip.
+ *
+ * @param name      Clip name, at most AI_AUDIO_CLIP_NAME_LEN - 1 characters.
+ * @param mp3       MP3 data, must stay valid for the lifetime of the program.
+ * @param len       Length of the MP3 data.
+ * @param preload   Decode now instead of on first play.
+ * @return OPERATE_RET - Returns OPRT_OK on success, OPRT_EXCEED_UPPER_LIMIT if the table is full,
+ *                       or the decode error when preloading.
+ */
+OPERATE_RET ai_audio_clip_register(const char *name, const uint8_t *mp3, uint32_t len, bool preload)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    if (NULL == name || strlen(name) >= AI_AUDIO_CLIP_NAME_LEN || NULL == mp3 || 0 == len) {
+        return OPRT_INVALID_PARM;
+    }
+
+    if (NULL == sg_clip_mutex) {
+        TUYA_CALL_ERR_RETURN(tal_mutex_create_init(&sg_clip_mutex));
+    }
+
+    tal_mutex_lock(sg_clip_mutex);
+
+    AI_AUDIO_CLIP_T *clip = __ai_audio_clip_find(name);
+    if (NULL == clip) {
+        if (sg_clip_num >= AI_AUDIO_CLIP_MAX) {
+            tal_mutex_unlock(sg_clip_mutex);
+            return OPRT_EXCEED_UPPER_LIMIT;
+        }
+        clip = &sg_clips[sg_clip_num++];
+        memset(clip, 0, sizeof(AI_AUDIO_CLIP_T));
+        strcpy(clip->name, name);
+    } else if (clip->mp3 != mp3 && clip->pcm && !__ai_audio_clip_in_use(clip)) {
+        tkl_system_psram_free(clip->pcm);
+        clip->pcm = NULL;
+        clip->pcm_len = 0;
+    }
+    clip->mp3 = mp3;
+    clip->mp3_len = len;
+
+    if (preload) {
+        rt = __ai_audio_clip_decode(clip);
+    }
+
+    tal_mutex_unlock(sg_clip_mutex);
+
+    return rt;
+}
+
+/**
+ * @brief Plays a clip once on a mixer stream, decoding it first if it is not cached.
+ *
+ * @param name      Clip name.
+ * @param stream    Mixer stream from ai_audio_player_mix_open().
+ * @return OPERATE_RET - Returns OPRT_OK on success, OPRT_NOT_FOUND for an unknown clip,
+ *                       or the decode error.
+ */
+OPERATE_RET ai_audio_clip_play(const char *name, AI_AUDIO_MIX_STREAM_T stream)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    if (NULL == name || NULL == sg_clip_mutex) {
+        return OPRT_NOT_FOUND;
+    }
+
+    tal_mutex_lock(sg_clip_mutex);
+
+    AI_AUDIO_CLIP_T *clip = __ai_audio_clip_find(name);
+    if (NULL == clip) {
+        tal_mutex_unlock(sg_clip_mutex);
+        return OPRT_NOT_FOUND;
+    }
+
+    rt = __ai_audio_clip_decode(clip);
+    if (OPRT_OK == rt) {
+        rt = ai_audio_player_mix_play_buf(stream, clip->pcm, clip->pcm_len);
+    }
+    if (OPRT_OK == rt) {
+        clip->stream = stream;
+        clip->played = true;
+        clip->last_play = tal_system_get_millisecond();
+    }
+
+    tal_mutex_unlock(sg_clip_mutex);
+
+    return rt;
+}
+
+/**
+ * @brief Releases decoded PCM, least recently played first.
+ *
+ * Clips still playing are kept.
+ *
+ * @param bytes     PCM bytes wanted back, 0 for all that can be released.
+ * @return uint32_t - Bytes released.
+ */
+uint32_t ai_audio_clip_evict(uint32_t bytes)
+{
+    uint32_t freed = 0;
+
+    if (NULL == sg_clip_mutex) {
+        return 0;
+    }
+
+    tal_mutex_lock(sg_clip_mutex);
+    freed = __ai_audio_clip_evict(bytes, NULL);
+    tal_mutex_unlock(sg_clip_mutex);
+
+    return freed;
+}
+
+/**
+ * @brief Gets the PSRAM held by decoded clips.
+ *
+ * @param None
+ * @return uint32_t - Bytes of cached PCM.
+ */
+uint32_t ai_audio_clip_cached_size(void)
+{
+    uint32_t total = 0;
+
+    if (NULL == sg_clip_mutex) {
+        return 0;
+    }
+
+    tal_mutex_lock(sg_clip_mutex);
+    for (uint8_t i = 0; i < sg_clip_num; i++) {
+        total += sg_clips[i].pcm_len;
+    }
+    tal_mutex_unlock(sg_clip_mutex);
+
+    return total;
+}
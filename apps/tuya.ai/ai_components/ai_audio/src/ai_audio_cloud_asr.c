@@ -70,8 +70,7 @@ typedef struct {
 
     AI_CLOUD_ASR_UPLOAD_STATE_E upload_state;
     TIMER_ID                    upload_timer_id;
-    uint8_t                    *upload_buffer;
-    uint32_t                    upload_buffer_len;
+    uint32_t                    upload_max_len;
 
 } AI_AUDIO_CLOUD_ASR_T;
 // clang-format on
@@ -179,6 +178,8 @@ static void __ai_audio_cloud_asr_task(void *arg)
         } break;
         case AI_CLOUD_ASR_EVT_UPLOADING: {
             uint32_t upload_len = 0;
+            uint8_t *upload_data = NULL;
+            uint32_t upload_gen = 0;
             uint32_t input_data_size = ai_audio_get_input_data_size();
 
             if (false == sg_ai_cloud_asr.is_uploading) {
@@ -190,14 +191,18 @@ static void __ai_audio_cloud_asr_task(void *arg)
                 break;
             }
 
-            upload_len = ai_audio_get_input_data(sg_ai_cloud_asr.upload_buffer, sg_ai_cloud_asr.upload_buffer_len);
+            // upload straight from the input buffer, released once sent
+            upload_len = ai_audio_peek_input_data(&upload_data, sg_ai_cloud_asr.upload_max_len, &upload_gen);
             if (0 == upload_len) {
                 break;
             }
-            TUYA_CALL_ERR_LOG(ai_audio_agent_upload_data(sg_ai_cloud_asr.upload_buffer, upload_len));
+            TUYA_CALL_ERR_LOG(ai_audio_agent_upload_data(upload_data, upload_len));
+            ai_audio_release_input_data(upload_len, upload_gen);
         } break;
         case AI_CLOUD_ASR_EVT_STOP: {
             uint32_t upload_len = 0;
+            uint8_t *upload_data = NULL;
+            uint32_t upload_gen = 0;
             uint32_t input_data_size = 0;
 
             if (false == sg_ai_cloud_asr.is_uploading) {
@@ -213,12 +218,13 @@ static void __ai_audio_cloud_asr_task(void *arg)
                     break;
                 }
 
-                upload_len = ai_audio_get_input_data(sg_ai_cloud_asr.upload_buffer, sg_ai_cloud_asr.upload_buffer_len);
+                upload_len = ai_audio_peek_input_data(&upload_data, sg_ai_cloud_asr.upload_max_len, &upload_gen);
                 if (0 == upload_len) {
                     break;
                 }
 
-                TUYA_CALL_ERR_LOG(ai_audio_agent_upload_data(sg_ai_cloud_asr.upload_buffer, upload_len));
+                TUYA_CALL_ERR_LOG(ai_audio_agent_upload_data(upload_data, upload_len));
+                ai_audio_release_input_data(upload_len, upload_gen);
                 if (input_data_size <= upload_len) {
                     break;
                 }
@@ -248,10 +254,7 @@ OPERATE_RET ai_audio_cloud_asr_init(void)
 
     memset(&sg_ai_cloud_asr, 0, sizeof(AI_AUDIO_CLOUD_ASR_T));
 
-    // upload buffer init
-    sg_ai_cloud_asr.upload_buffer_len = AI_AUDIO_VOICE_FRAME_LEN_GET(AI_AUDIO_UPLOAD_BUFF_TIME_MS);
-    sg_ai_cloud_asr.upload_buffer = (uint8_t *)tkl_system_psram_malloc(sg_ai_cloud_asr.upload_buffer_len);
-    TUYA_CHECK_NULL_GOTO(sg_ai_cloud_asr.upload_buffer, __ERR);
+    sg_ai_cloud_asr.upload_max_len = AI_AUDIO_VOICE_FRAME_LEN_GET(AI_AUDIO_UPLOAD_BUFF_TIME_MS);
 
     TUYA_CALL_ERR_GOTO(tal_queue_create_init(&sg_ai_cloud_asr.queue, sizeof(AI_CLOUD_ASR_MSG_T), 16), __ERR);
 
@@ -274,11 +277,6 @@ __ERR:
         sg_ai_cloud_asr.asr_timer_id = NULL;
     }
 
-    if (sg_ai_cloud_asr.upload_buffer) {
-        tkl_system_psram_free(sg_ai_cloud_asr.upload_buffer);
-        sg_ai_cloud_asr.upload_buffer = NULL;
-    }
-
     if (sg_ai_cloud_asr.mutex) {
         tal_mutex_release(sg_ai_cloud_asr.mutex);
         sg_ai_cloud_asr.mutex = NULL;
@@ -22,6 +22,7 @@
 
 #include "tal_api.h"
 #include "tuya_ringbuf.h"
+#include "ring_queue_template.h"
 
 #include "ai_audio.h"
 /***********************************************************
@@ -32,17 +33,59 @@
 
 #define ASR_PROCE_UNIT_NUM    30
 #define ASR_WAKEUP_TIMEOUT_MS (30000)
+
+/* VAD and wake-up word inference run in their own task, fed by the capture
+ * callback through a lock-free queue of 10ms frames */
+#define AI_AUDIO_DETECT_FRAME_NUM 32 // queue depth, power of two
+#define AI_AUDIO_DETECT_STATE_NUM 8  // state transitions not yet handled, power of two
+
+// frames collected before the detect task wakes up
+#ifndef AI_AUDIO_DETECT_BATCH_NUM
+#define AI_AUDIO_DETECT_BATCH_NUM 3
+#endif
+
+#ifndef AI_AUDIO_DETECT_TASK_STACK
+#define AI_AUDIO_DETECT_TASK_STACK (1024 * 4)
+#endif
+
+#ifndef AI_AUDIO_DETECT_TASK_PRIO
+#define AI_AUDIO_DETECT_TASK_PRIO THREAD_PRIO_2
+#endif
+
+// core of the detect task with ENABLE_THREAD_AFFINITY, the second core of T5AI
+#ifndef AI_AUDIO_DETECT_TASK_CORE
+#define AI_AUDIO_DETECT_TASK_CORE 1
+#endif
 /***********************************************************
 ***********************typedef define***********************
 ***********************************************************/
 // clang-format off
+typedef struct {
+    uint32_t            len;
+    uint8_t             data[AI_AUDIO_PCM_FRAME_SIZE];
+} AI_AUDIO_DETECT_FRAME_T;
+
+RING_QUEUE_SPSC_DEFINE(detect_frame_q, AI_AUDIO_DETECT_FRAME_T *, AI_AUDIO_DETECT_FRAME_NUM)
+RING_QUEUE_SPSC_DEFINE(detect_state_q, AI_AUDIO_INPUT_STATE_E, AI_AUDIO_DETECT_STATE_NUM)
+
+typedef struct {
+    THREAD_HANDLE            thrd_hdl;
+    SEM_HANDLE               sem;
+    AI_AUDIO_DETECT_FRAME_T *frames;
+    detect_frame_q_t         free_q;   // detect task -> capture callback
+    detect_frame_q_t         ready_q;  // capture callback -> detect task
+    detect_state_q_t         state_q;  // detect task -> input task
+    AI_AUDIO_INPUT_STATE_E   state;    // last state pushed to state_q
+    uint32_t                 drop_cnt; // frames the detect task fell behind on
+} AI_AUDIO_INPUT_DETECT_T;
+
 typedef struct {
     bool                is_wakeup;
     bool                is_need_inform_wakeup_stop;
     TIMER_ID            wakeup_timer_id;
-    MUTEX_HANDLE        rb_mutex;
-    TUYA_RINGBUFF_T     feed_ringbuff;
+    TUYA_RINGBUFF_T     feed_ringbuff;  // only used by the detect task
     uint32_t            buff_len;
+    uint8_t            *unit_buff;  // one process unit, read out of the feed ring
 }AI_AUDIO_INPUT_ASR_T;
 
 typedef struct {
@@ -55,8 +98,10 @@ typedef struct {
 
     TUYA_RINGBUFF_T                ringbuff_hdl;
     MUTEX_HANDLE                   rb_mutex;
+    uint32_t                       rb_gen; // bumped on every reset, checked when a peek is released
 
     AI_AUDIO_INPUT_ASR_T           asr;  
+    AI_AUDIO_INPUT_DETECT_T        detect;
 
 } AI_AUDIO_INPUT_INFO_T;
 // clang-format on
@@ -114,7 +159,8 @@ static OPERATE_RET __ai_audio_asr_init(void)
     TUYA_CALL_ERR_GOTO(tuya_ring_buff_create(sg_audio_input.asr.buff_len + tkl_asr_get_process_uint_size(),
                                              OVERFLOW_PSRAM_STOP_TYPE, &sg_audio_input.asr.feed_ringbuff),
                        __ASR_INIT_ERR);
-    TUYA_CALL_ERR_GOTO(tal_mutex_create_init(&sg_audio_input.asr.rb_mutex), __ASR_INIT_ERR);
+    sg_audio_input.asr.unit_buff = tkl_system_psram_malloc(tkl_asr_get_process_uint_size());
+    TUYA_CHECK_NULL_GOTO(sg_audio_input.asr.unit_buff, __ASR_INIT_ERR);
 
     return OPRT_OK;
 
@@ -131,9 +177,9 @@ __ASR_INIT_ERR:
         sg_audio_input.asr.feed_ringbuff = NULL;
     }
 
-    if (sg_audio_input.asr.rb_mutex) {
-        tal_mutex_release(sg_audio_input.asr.rb_mutex);
-        sg_audio_input.asr.rb_mutex = NULL;
+    if (sg_audio_input.asr.unit_buff) {
+        tkl_system_psram_free(sg_audio_input.asr.unit_buff);
+        sg_audio_input.asr.unit_buff = NULL;
     }
 
     return rt;
@@ -147,21 +193,17 @@ static __attribute__((unused)) OPERATE_RET __ai_audio_asr_deinit(void)
 
     TUYA_CALL_ERR_LOG(tal_sw_timer_delete(sg_audio_input.asr.wakeup_timer_id));
 
-    TUYA_CALL_ERR_LOG(tal_mutex_lock(sg_audio_input.asr.rb_mutex));
     TUYA_CALL_ERR_LOG(tuya_ring_buff_free(sg_audio_input.asr.feed_ringbuff));
     sg_audio_input.asr.feed_ringbuff = NULL;
-    TUYA_CALL_ERR_LOG(tal_mutex_unlock(sg_audio_input.asr.rb_mutex));
 
-    TUYA_CALL_ERR_LOG(tal_mutex_release(sg_audio_input.asr.rb_mutex));
-    sg_audio_input.asr.rb_mutex = NULL;
+    tkl_system_psram_free(sg_audio_input.asr.unit_buff);
+    sg_audio_input.asr.unit_buff = NULL;
 
     return OPRT_OK;
 }
 
 static void __ai_audio_asr_feed(void *data, uint32_t len)
 {
-    tal_mutex_lock(sg_audio_input.asr.rb_mutex);
-
     if (TKL_VAD_STATUS_NONE == tkl_vad_get_status()) {
         uint32_t rb_used_size = tuya_ring_buff_used_size_get(sg_audio_input.asr.feed_ringbuff);
         if (rb_used_size > AI_AUDIO_VOICE_FRAME_LEN_GET(AI_AUDIO_VAD_ACITVE_TM_MS)) {
@@ -172,8 +214,6 @@ static void __ai_audio_asr_feed(void *data, uint32_t len)
 
     tuya_ring_buff_write(sg_audio_input.asr.feed_ringbuff, data, len);
 
-    tal_mutex_unlock(sg_audio_input.asr.rb_mutex);
-
     return;
 }
 
@@ -184,33 +224,21 @@ static TKL_ASR_WAKEUP_WORD_E __asr_recognize_wakeup_keyword(void)
     uint32_t uint_size = 0, feed_size = 0;
 
     uint_size = tkl_asr_get_process_uint_size();
-    tal_mutex_lock(sg_audio_input.asr.rb_mutex);
     feed_size = tuya_ring_buff_used_size_get(sg_audio_input.asr.feed_ringbuff);
-    tal_mutex_unlock(sg_audio_input.asr.rb_mutex);
     if (feed_size < uint_size) {
         return TKL_ASR_WAKEUP_WORD_UNKNOWN;
     }
 
-    uint8_t *p_buf = tkl_system_psram_malloc(uint_size);
-    if (NULL == p_buf) {
-        PR_ERR("malloc fail");
-        return TKL_ASR_WAKEUP_WORD_UNKNOWN;
-    }
-
     fc = feed_size / uint_size;
     for (i = 0; i < fc; i++) {
-        tal_mutex_lock(sg_audio_input.asr.rb_mutex);
-        tuya_ring_buff_read(sg_audio_input.asr.feed_ringbuff, p_buf, uint_size);
-        tal_mutex_unlock(sg_audio_input.asr.rb_mutex);
+        tuya_ring_buff_read(sg_audio_input.asr.feed_ringbuff, sg_audio_input.asr.unit_buff, uint_size);
 
-        wakeup_word = tkl_asr_recognize_wakeup_word(p_buf, uint_size);
+        wakeup_word = tkl_asr_recognize_wakeup_word(sg_audio_input.asr.unit_buff, uint_size);
         if (wakeup_word != TKL_ASR_WAKEUP_WORD_UNKNOWN) {
             break;
         }
     }
 
-    tkl_system_psram_free(p_buf);
-
     return wakeup_word;
 }
 
@@ -264,6 +292,7 @@ static OPERATE_RET __ai_audio_input_rb_reset(void)
 {
     tal_mutex_lock(sg_audio_input.rb_mutex);
     tuya_ring_buff_reset(sg_audio_input.ringbuff_hdl);
+    sg_audio_input.rb_gen++;
     tal_mutex_unlock(sg_audio_input.rb_mutex);
 
     return OPRT_OK;
@@ -364,6 +393,130 @@ AI_AUDIO_INPUT_EVENT_E __ai_audio_input_get_event(AI_AUDIO_INPUT_STATE_E curr_st
     return event;
 }
 
+/* capture side: copy into free 10ms frames, wake the detect task once a batch is queued */
+static void __ai_audio_detect_frame_put(uint8_t *data, uint32_t len)
+{
+    AI_AUDIO_INPUT_DETECT_T *detect = &sg_audio_input.detect;
+    AI_AUDIO_DETECT_FRAME_T *frame = NULL;
+
+    if (NULL == detect->sem) {
+        return;
+    }
+
+    while (len > 0) {
+        if (!detect_frame_q_pop(&detect->free_q, &frame)) {
+            detect->drop_cnt++;
+            break;
+        }
+
+        frame->len = (len > AI_AUDIO_PCM_FRAME_SIZE) ? AI_AUDIO_PCM_FRAME_SIZE : len;
+        memcpy(frame->data, data, frame->len);
+        data += frame->len;
+        len -= frame->len;
+
+        // never full, the frame came from free_q
+        detect_frame_q_push(&detect->ready_q, frame);
+    }
+
+    if (detect_frame_q_count(&detect->ready_q) >= AI_AUDIO_DETECT_BATCH_NUM) {
+        tal_semaphore_post(detect->sem);
+    }
+}
+
+static void __ai_audio_detect_task(void *arg)
+{
+    AI_AUDIO_INPUT_DETECT_T *detect = &sg_audio_input.detect;
+    AI_AUDIO_DETECT_FRAME_T *frame = NULL;
+    AI_AUDIO_INPUT_STATE_E state = AI_AUDIO_INPUT_STATE_DETECTING;
+    uint32_t drop_cnt = 0;
+
+#if defined(ENABLE_THREAD_AFFINITY) && (ENABLE_THREAD_AFFINITY == 1)
+    TKL_THREAD_HANDLE self = NULL;
+    tkl_thread_get_id(&self);
+    if (OPRT_OK != tkl_thread_set_affinity(self, AI_AUDIO_DETECT_TASK_CORE)) {
+        PR_ERR("audio detect affinity to core %d failed", AI_AUDIO_DETECT_TASK_CORE);
+    }
+#endif
+
+    while (1) {
+        // the timeout picks up the frames of an incomplete batch
+        tal_semaphore_wait(detect->sem, AI_AUDIO_DETECT_BATCH_NUM * AI_AUDIO_PCM_FRAME_TM_MS);
+
+        if (0 == detect_frame_q_count(&detect->ready_q)) {
+            continue;
+        }
+
+        while (detect_frame_q_pop(&detect->ready_q, &frame)) {
+            if (true == sg_audio_input.is_enable_get_valid_data) {
+                __ai_audio_detect_valid_data_feed(sg_audio_input.method, frame->data, frame->len);
+            }
+            detect_frame_q_push(&detect->free_q, frame);
+        }
+
+        if (drop_cnt != detect->drop_cnt) {
+            drop_cnt = detect->drop_cnt;
+            PR_WARN("audio detect fell behind, %d frames dropped", drop_cnt);
+        }
+
+        if (false == sg_audio_input.is_enable_get_valid_data) {
+            // the input task reports detecting while disabled
+            detect->state = AI_AUDIO_INPUT_STATE_DETECTING;
+            continue;
+        }
+
+        state = __ai_audio_input_get_new_state(sg_audio_input.method);
+        if (state == detect->state) {
+            continue;
+        }
+
+        if (AI_AUDIO_INPUT_STATE_ASR_WAKEUP_WORD == state) {
+            // restart vad detection
+            tkl_vad_stop();
+            tkl_vad_start();
+        }
+
+        // on a full queue the transition is pushed again after the next batch
+        if (detect_state_q_push(&detect->state_q, state)) {
+            detect->state = state;
+        }
+    }
+}
+
+static OPERATE_RET __ai_audio_detect_init(void)
+{
+    OPERATE_RET rt = OPRT_OK;
+    AI_AUDIO_INPUT_DETECT_T *detect = &sg_audio_input.detect;
+
+    detect->frames = tkl_system_psram_malloc(sizeof(AI_AUDIO_DETECT_FRAME_T) * AI_AUDIO_DETECT_FRAME_NUM);
+    TUYA_CHECK_NULL_RETURN(detect->frames, OPRT_MALLOC_FAILED);
+
+    detect_frame_q_init(&detect->free_q);
+    detect_frame_q_init(&detect->ready_q);
+    detect_state_q_init(&detect->state_q);
+    for (uint32_t i = 0; i < AI_AUDIO_DETECT_FRAME_NUM; i++) {
+        detect_frame_q_push(&detect->free_q, &detect->frames[i]);
+    }
+    detect->state = AI_AUDIO_INPUT_STATE_DETECTING;
+
+    TUYA_CALL_ERR_GOTO(tal_semaphore_create_init(&detect->sem, 0, 1), __DETECT_INIT_ERR);
+    TUYA_CALL_ERR_GOTO(tkl_thread_create_in_psram(&detect->thrd_hdl, "audio_detect", AI_AUDIO_DETECT_TASK_STACK,
+                                                  AI_AUDIO_DETECT_TASK_PRIO, __ai_audio_detect_task, NULL),
+                       __DETECT_INIT_ERR);
+
+    return OPRT_OK;
+
+__DETECT_INIT_ERR:
+    if (detect->sem) {
+        tal_semaphore_release(detect->sem);
+        detect->sem = NULL;
+    }
+
+    tkl_system_psram_free(detect->frames);
+    detect->frames = NULL;
+
+    return rt;
+}
+
 static void __ai_audio_get_input_frame(TDL_AUDIO_FRAME_FORMAT_E type, TDL_AUDIO_STATUS_E status, uint8_t *data,
                                        uint32_t len)
 {
@@ -379,7 +532,7 @@ static void __ai_audio_get_input_frame(TDL_AUDIO_FRAME_FORMAT_E type, TDL_AUDIO_
 #endif
 
     if (true == sg_audio_input.is_enable_get_valid_data) {
-        __ai_audio_detect_valid_data_feed(sg_audio_input.method, (uint8_t *)data, len);
+        __ai_audio_detect_frame_put(data, len);
     }
 
     tal_mutex_lock(sg_audio_input.rb_mutex);
@@ -389,11 +542,29 @@ static void __ai_audio_get_input_frame(TDL_AUDIO_FRAME_FORMAT_E type, TDL_AUDIO_
     return;
 }
 
+static AI_AUDIO_INPUT_EVENT_E __ai_audio_input_state_update(AI_AUDIO_INPUT_STATE_E state)
+{
+    AI_AUDIO_INPUT_EVENT_E event = __ai_audio_input_get_event(state, sg_audio_input.state);
+
+    sg_audio_input.state = state;
+
+    if (AI_AUDIO_INPUT_EVT_ASR_WAKEUP_WORD == event) {
+        // the detect task restarted vad, drop the audio up to the wake-up word
+        __ai_audio_input_rb_reset();
+    }
+
+    if ((event != AI_AUDIO_INPUT_EVT_NONE) && sg_audio_input_inform_cb) {
+        sg_audio_input_inform_cb(event, NULL);
+    }
+
+    return event;
+}
+
 static void __ai_audio_handle_frame_task(void *arg)
 {
     uint32_t rb_used_sz = 0;
-    AI_AUDIO_INPUT_EVENT_E event = AI_AUDIO_INPUT_EVT_NONE;
-    AI_AUDIO_INPUT_STATE_E last_state = AI_AUDIO_INPUT_STATE_IDLE;
+    AI_AUDIO_INPUT_EVENT_E event = AI_AUDIO_INPUT_EVT_NONE, trans_event = AI_AUDIO_INPUT_EVT_NONE;
+    AI_AUDIO_INPUT_STATE_E state = AI_AUDIO_INPUT_STATE_IDLE;
 
     while (1) {
         rb_used_sz = tuya_ring_buff_used_size_get(sg_audio_input.ringbuff_hdl);
@@ -402,30 +573,30 @@ static void __ai_audio_handle_frame_task(void *arg)
             continue;
         }
 
-        last_state = sg_audio_input.state;
-        if (true == sg_audio_input.is_enable_get_valid_data) {
-            sg_audio_input.state = __ai_audio_input_get_new_state(sg_audio_input.method);
+        event = AI_AUDIO_INPUT_EVT_NONE;
+        if (false == sg_audio_input.is_enable_get_valid_data) {
+            while (detect_state_q_pop(&sg_audio_input.detect.state_q, &state)) {
+                ;
+            }
+            event = __ai_audio_input_state_update(AI_AUDIO_INPUT_STATE_DETECTING);
+        } else if (AI_AUDIO_INPUT_VALID_METHOD_MANUAL == sg_audio_input.method) {
+            event = __ai_audio_input_state_update(__ai_audio_input_get_new_state(sg_audio_input.method));
         } else {
-            sg_audio_input.state = AI_AUDIO_INPUT_STATE_DETECTING;
+            // transitions posted by the detect task, in order
+            while (detect_state_q_pop(&sg_audio_input.detect.state_q, &state)) {
+                trans_event = __ai_audio_input_state_update(state);
+                if (AI_AUDIO_INPUT_EVT_NONE != trans_event) {
+                    event = trans_event;
+                }
+            }
         }
 
-        event = __ai_audio_input_get_event(sg_audio_input.state, last_state);
-
         // get asr wakeup stop event
         if (AI_AUDIO_INPUT_EVT_NONE == event && true == sg_audio_input.asr.is_need_inform_wakeup_stop) {
-            event = AI_AUDIO_INPUT_EVT_ASR_WAKEUP_STOP;
             sg_audio_input.asr.is_need_inform_wakeup_stop = false;
-        }
-
-        if (AI_AUDIO_INPUT_EVT_ASR_WAKEUP_WORD == event) {
-            // restart vad detection
-            tkl_vad_stop();
-            __ai_audio_input_rb_reset();
-            tkl_vad_start();
-        }
-
-        if ((event != AI_AUDIO_INPUT_EVT_NONE) && sg_audio_input_inform_cb) {
-            sg_audio_input_inform_cb(event, NULL);
+            if (sg_audio_input_inform_cb) {
+                sg_audio_input_inform_cb(AI_AUDIO_INPUT_EVT_ASR_WAKEUP_STOP, NULL);
+            }
         }
 
         tal_system_sleep(10);
@@ -493,6 +664,11 @@ OPERATE_RET ai_audio_input_init(AI_AUDIO_INPUT_CFG_T *cfg, AI_AUDIO_INOUT_INFORM
 
     TUYA_CALL_ERR_RETURN(__ai_audio_input_set_method(cfg->get_valid_data_method));
 
+    if (AI_AUDIO_INPUT_VALID_METHOD_VAD == sg_audio_input.method ||
+        AI_AUDIO_INPUT_VALID_METHOD_ASR == sg_audio_input.method) {
+        TUYA_CALL_ERR_RETURN(__ai_audio_detect_init());
+    }
+
     TUYA_CALL_ERR_RETURN(__ai_audio_input_open());
 
     sg_audio_input_inform_cb = cb;
@@ -611,6 +787,22 @@ uint32_t ai_audio_get_input_data(uint8_t *buff, uint32_t buff_len)
     return read_len;
 }
 
+uint32_t ai_audio_peek_input_data(uint8_t **data, uint32_t max_len, uint32_t *gen)
+{
+    uint32_t linear_len = 0;
+
+    if (NULL == data || 0 == max_len || NULL == gen) {
+        return 0;
+    }
+
+    tal_mutex_lock(sg_audio_input.rb_mutex);
+    linear_len = tuya_ring_buff_peek_linear(sg_audio_input.ringbuff_hdl, data);
+    *gen = sg_audio_input.rb_gen;
+    tal_mutex_unlock(sg_audio_input.rb_mutex);
+
+    return (linear_len > max_len) ? max_len : linear_len;
+}
+
 uint32_t ai_audio_get_input_data_size(void)
 {
     uint32_t rb_used_size = 0;
@@ -627,4 +819,14 @@ void ai_audio_discard_input_data(uint32_t discard_size)
     tal_mutex_lock(sg_audio_input.rb_mutex);
     tuya_ring_buff_discard(sg_audio_input.ringbuff_hdl, discard_size);
     tal_mutex_unlock(sg_audio_input.rb_mutex);
+}
+
+void ai_audio_release_input_data(uint32_t release_size, uint32_t gen)
+{
+    tal_mutex_lock(sg_audio_input.rb_mutex);
+    // a reset since the peek already dropped it, what is buffered now is newer input
+    if (gen == sg_audio_input.rb_gen) {
+        tuya_ring_buff_discard(sg_audio_input.ringbuff_hdl, release_size);
+    }
+    tal_mutex_unlock(sg_audio_input.rb_mutex);
 }
\ No newline at end of file
@@ -75,6 +75,7 @@ static void __ai_audio_agent_event_cb(AI_EVENT_TYPE event, AI_EVENT_ID event_id)
     case AI_EVENT_SERVER_VAD: {
         PR_DEBUG("server vad");
         #if ENABLE_AUDIO_CHAT
+        ai_audio_tts_cache_reply_abort();
         if (ai_audio_player_is_playing()) {
             ai_audio_player_stop();
         }
@@ -91,11 +92,31 @@ static void __ai_audio_agent_event_cb(AI_EVENT_TYPE event, AI_EVENT_ID event_id)
     return;
 }
 
+#if ENABLE_AUDIO_CHAT
+static void __ai_audio_tts_start(char *event_id)
+{
+    // Prepare to play mp3
+    if (ai_audio_player_is_playing()) {
+        PR_DEBUG("player is playing, stop it first");
+        ai_audio_player_stop();
+    }
+
+    memset(event_id, 0, PLAYER_ID_LEN_MAX);
+
+    snprintf(event_id, PLAYER_ID_LEN_MAX, "NLG_%u", tal_time_get_posix());
+
+    ai_audio_player_start(event_id);
+
+    sg_ai_audio.state = AI_AUDIO_STATE_AI_SPEAK;
+}
+#endif
+
 static void __ai_audio_agent_msg_cb(AI_AGENT_MSG_T *msg)
 {
     AI_AUDIO_EVENT_E event = AI_AUDIO_EVT_NONE;
 #if ENABLE_AUDIO_CHAT
     static char event_id[PLAYER_ID_LEN_MAX] = {0};
+    static bool tts_cached = false; // the reply plays from the TTS cache, its cloud audio is dropped
 #endif
     switch (msg->type) {
     case AI_AGENT_MSG_TP_TEXT_ASR: {
@@ -117,25 +138,34 @@ static void __ai_audio_agent_msg_cb(AI_AGENT_MSG_T *msg)
         }
 #endif
     } break;
+    case AI_AGENT_MSG_TP_TEXT_ASR_PARTIAL: {
+        event = AI_AUDIO_EVT_HUMAN_ASR_PARTIAL;
+    } break;
     case AI_AGENT_MSG_TP_AUDIO_START: {
 #if ENABLE_AUDIO_CHAT
-        // Prepare to play mp3
-        if (ai_audio_player_is_playing()) {
-            PR_DEBUG("player is playing, stop it first");
-            ai_audio_player_stop();
+        if (tts_cached) {
+            break;
         }
+        __ai_audio_tts_start(event_id);
 
-        memset(event_id, 0, PLAYER_ID_LEN_MAX);
-
-        snprintf(event_id, PLAYER_ID_LEN_MAX, "NLG_%u", tal_time_get_posix());
-
-        ai_audio_player_start(event_id);
-
-        sg_ai_audio.state = AI_AUDIO_STATE_AI_SPEAK;
+        // the first packet may already carry audio
+        if (msg->data_len > 0) {
+            ai_audio_tts_cache_reply_audio(msg->data, msg->data_len, false);
+            ai_audio_player_data_write(event_id, msg->data, msg->data_len, 0);
+        }
 #endif
     } break;
     case AI_AGENT_MSG_TP_AUDIO_DATA: {
 #if ENABLE_AUDIO_CHAT
+        if (tts_cached) {
+            break;
+        }
+        // start on the first audio packet even if the stream start was missed
+        if (0 == event_id[0]) {
+            __ai_audio_tts_start(event_id);
+        }
+
+        ai_audio_tts_cache_reply_audio(msg->data, msg->data_len, false);
         ai_audio_player_data_write(event_id, msg->data, msg->data_len, 0);
 
         if (AI_AUDIO_WORK_ASR_WAKEUP_FREE_TALK == sg_ai_audio.work_mode) {
@@ -145,6 +175,11 @@ static void __ai_audio_agent_msg_cb(AI_AGENT_MSG_T *msg)
     } break;
     case AI_AGENT_MSG_TP_AUDIO_STOP: {
 #if ENABLE_AUDIO_CHAT
+        if (tts_cached) {
+            tts_cached = false;
+            break;
+        }
+        ai_audio_tts_cache_reply_audio(msg->data, msg->data_len, true);
         ai_audio_player_data_write(event_id, msg->data, msg->data_len, 1);
 
         if (AI_AUDIO_WORK_ASR_WAKEUP_FREE_TALK == sg_ai_audio.work_mode) {
@@ -155,12 +190,27 @@ static void __ai_audio_agent_msg_cb(AI_AGENT_MSG_T *msg)
 #endif
     } break;
     case AI_AGENT_MSG_TP_TEXT_NLG_START: {
+#if ENABLE_AUDIO_CHAT
+        tts_cached = false;
+        ai_audio_tts_cache_reply_start();
+#endif
         event = AI_AUDIO_EVT_AI_REPLIES_TEXT_START;
     } break;
     case AI_AGENT_MSG_TP_TEXT_NLG_DATA: {
+#if ENABLE_AUDIO_CHAT
+        ai_audio_tts_cache_reply_text(msg->data, msg->data_len, false);
+#endif
         event = AI_AUDIO_EVT_AI_REPLIES_TEXT_DATA;
     } break;
     case AI_AGENT_MSG_TP_TEXT_NLG_STOP: {
+#if ENABLE_AUDIO_CHAT
+        ai_audio_tts_cache_reply_text(msg->data, msg->data_len, true);
+        // a known reply whose audio has not started yet plays right away
+        if (0 == event_id[0] && OPRT_OK == ai_audio_tts_cache_reply_play()) {
+            tts_cached = true;
+            sg_ai_audio.state = AI_AUDIO_STATE_AI_SPEAK;
+        }
+#endif
         event = AI_AUDIO_EVT_AI_REPLIES_TEXT_END;
     } break;
     case AI_AGENT_MSG_TP_EMOTION: {
@@ -176,6 +226,36 @@ static void __ai_audio_agent_msg_cb(AI_AGENT_MSG_T *msg)
 }
 
 #if ENABLE_AUDIO_CHAT
+/**
+ * @brief Cuts the reply short when the user talks over it.
+ *
+ * The player goes silent within one output chunk and drops everything
+ * buffered, so the new utterance can be uploaded right away.
+ *
+ * @param interrupt true to also tell the cloud to stop the reply.
+ */
+static void __ai_audio_barge_in(bool interrupt)
+{
+    if (AI_AUDIO_STATE_AI_SPEAK != sg_ai_audio.state && !ai_audio_player_is_playing()) {
+        return;
+    }
+
+    PR_NOTICE("barge in");
+
+    ai_audio_tts_cache_reply_abort();
+    ai_audio_player_stop();
+
+    if (interrupt) {
+        ai_audio_agent_chat_intrrupt();
+    }
+
+#if defined(ENABLE_CHAT_DISPLAY) && (ENABLE_CHAT_DISPLAY == 1)
+    if (sg_ai_audio.evt_inform_cb) {
+        sg_ai_audio.evt_inform_cb(AI_AUDIO_EVT_AI_REPLIES_TEXT_INTERUPT, NULL, 0, NULL);
+    }
+#endif
+}
+
 static void __ai_audio_input_inform_handle(AI_AUDIO_INPUT_EVENT_E event, void *arg)
 {
     OPERATE_RET rt = OPRT_OK;
@@ -187,6 +267,8 @@ static void __ai_audio_input_inform_handle(AI_AUDIO_INPUT_EVENT_E event, void *a
 
     switch (event) {
     case AI_AUDIO_INPUT_EVT_GET_VALID_VOICE_START: {
+        __ai_audio_barge_in(true);
+
         rt = ai_audio_cloud_asr_start();
         if (rt == OPRT_OK) {
             sg_ai_audio.state = AI_AUDIO_STATE_UPLOAD;
@@ -200,6 +282,9 @@ static void __ai_audio_input_inform_handle(AI_AUDIO_INPUT_EVENT_E event, void *a
         }
     } break;
     case AI_AUDIO_INPUT_EVT_ASR_WAKEUP_WORD: {
+        AI_AUDIO_TRACE(AI_TRACE_WAKE, NULL, 0);
+        // the forced idle below sends the interrupt
+        __ai_audio_barge_in(false);
 
         if (AI_AUDIO_STATE_UPLOAD == sg_ai_audio.state || AI_AUDIO_STATE_AI_SPEAK == sg_ai_audio.state) {
             ai_audio_cloud_asr_set_idle(true);
@@ -11,6 +11,21 @@
  */
 #define MINIMP3_IMPLEMENTATION
 
+/* The player feeds int16 pcm straight to the codec, the fixed-point output path */
+#ifdef MINIMP3_FLOAT_OUTPUT
+#error "ai_audio_player needs int16 output, do not define MINIMP3_FLOAT_OUTPUT"
+#endif
+
+/* Fast decode profile: layer 3 only, and no runtime SIMD probe on targets
+ * built with SSE2 (NEON and x86-64 are SIMD-only already). Cortex-M cores
+ * have no NEON and keep the scalar path with the ARMv6 saturating output. */
+#if defined(MP3_DECODE_FAST) && (MP3_DECODE_FAST == 1)
+#define MINIMP3_ONLY_MP3
+#if defined(__SSE2__) && !defined(MINIMP3_NO_SIMD)
+#define MINIMP3_ONLY_SIMD
+#endif
+#endif
+
 #include "tkl_system.h"
 #include "tkl_memory.h"
 #include "tkl_thread.h"
@@ -22,6 +37,8 @@
 
 #include "minimp3_ex.h"
 #include "ai_audio.h"
+#include "ai_audio_player.h"
+#include "ai_audio_resample.h"
 
 /***********************************************************
 ************************macro define************************
@@ -35,7 +52,15 @@
 #define MAX_NSAMP 576 /* max samples per channel, per granule */
 
 #define MP3_PCM_SIZE_MAX           (MAX_NSAMP * MAX_NCHAN * MAX_NGRAN * 2)
+#define PCM_QUEUE_FRAMES           6 /* decoded frames buffered ahead of the DAC, ~150 ms */
+#define PCM_OUT_WAIT_MS            20
+
+#define MIX_CHUNK_SAMPLES          320 /* 20 ms at 16 kHz, one output write */
+#define MIX_STREAM_RB_LEN          (MIX_CHUNK_SAMPLES * 2 * 2) /* pushed streams run at most 40 ms ahead */
+#define MIX_OUT_BUF_NUM            2 /* one chunk plays while the next is mixed */
 #define PLAYING_NO_DATA_TIMEOUT_MS (5 * 1000)
+#define PLAYER_PREBUFFER_LEN       1024 /* mp3 held back before the first decode, the pcm queue covers jitter */
+#define PLAYER_PREBUFFER_TM_MS     300
 
 #define AI_AUDIO_PLAYER_STAT_CHANGE(last_stat, new_stat)                                                               \
     do {                                                                                                               \
@@ -47,6 +72,16 @@
 /***********************************************************
 ***********************typedef define***********************
 ***********************************************************/
+typedef struct {
+    bool in_use;
+    AI_AUDIO_MIX_CFG_T cfg;
+    TUYA_RINGBUFF_T rb_hdl; // pushed pcm, ai_audio_player_mix_write()
+    SEM_HANDLE space_sem;   // posted when the output task frees ring space
+    const uint8_t *buf;     // one-shot pcm, ai_audio_player_mix_play_buf()
+    uint32_t buf_len;
+    uint32_t buf_pos;
+} MIX_STREAM_T;
+
 typedef struct {
     bool is_playing;
     bool is_writing;
@@ -65,13 +100,36 @@ typedef struct {
 
     mp3dec_t *mp3_dec;
     mp3dec_frame_info_t mp3_frame_info;
-    uint8_t *mp3_raw;
-    uint8_t *mp3_raw_head;
-    uint32_t mp3_raw_used_len;
-    uint8_t *mp3_pcm; // mp3 decode to pcm buffer
+    uint8_t *mp3_raw;         // bridges a frame that wraps around the ring buffer
+    uint32_t mp3_rb_consumed; // decoded bytes still to be discarded from the ring buffer
+    uint32_t mp3_rb_left;     // undecoded bytes seen by the last decode
+
+    // streams not at the codec rate or in stereo are converted before queueing
+    uint32_t out_hz;
+    AI_AUDIO_RESAMPLE_T rs;
+    int16_t *rs_work; // AI_AUDIO_RS_TAPS history + one decoded frame
+
+    // decoded pcm queue, filled by the player task and drained by the output task
+    uint8_t *pcm_buf; // PCM_QUEUE_FRAMES slots of MP3_PCM_SIZE_MAX
+    uint32_t pcm_len[PCM_QUEUE_FRAMES];
+    volatile uint32_t pcm_wr; // slots decoded, only the player task writes it
+    volatile uint32_t pcm_rd; // slots played, only the output task writes it
+    volatile bool pcm_flush;
+    volatile bool pcm_mute; // set by stop, decoded frames are dropped instead of played
+    uint32_t pcm_off; // bytes of slot pcm_rd already played
+    SEM_HANDLE pcm_sem;
+    THREAD_HANDLE out_thrd_hdl;
+
+    // mixer, run by the output task
+    AI_AUDIO_MIX_CFG_T mp3_mix;
+    MIX_STREAM_T mix[AI_AUDIO_MIX_STREAM_MAX];
+    MUTEX_HANDLE mix_mutex;
+    int32_t mix_acc[MIX_CHUNK_SAMPLES];
+    int16_t mix_out[MIX_OUT_BUF_NUM][MIX_CHUNK_SAMPLES];
+    uint32_t mix_out_idx;
+    SEM_HANDLE out_free_sem; // mix_out buffers not queued in tdl_audio
 
     uint8_t is_first_play;
-    uint8_t finish_delay_count; // delay counter for audio output buffer drain
 } APP_PLAYER_T;
 
 /***********************************************************
@@ -100,68 +158,322 @@ static OPERATE_RET __ai_audio_player_mp3_start(void)
         mp3dec_init(sg_player.mp3_dec);
     }
 
-    sg_player.mp3_raw_used_len = 0;
+    sg_player.mp3_rb_consumed = 0;
+    sg_player.mp3_rb_left = 0;
+
+    // assume codec format until the first frame says otherwise
+    ai_audio_resample_setup(&sg_player.rs, sg_player.out_hz, 1, sg_player.out_hz);
 
     return rt;
 }
 
+/**
+ * @brief Decode one MP3 frame straight out of the stream ring buffer.
+ *
+ * The decoder reads the contiguous unread window of the ring in place. Only
+ * when that window ends at the wrap point before a whole frame is visible
+ * are up to MAINBUF_SIZE bytes peeked into mp3_raw to bridge it, once per
+ * trip around the ring. Decoded bytes are released on the next call so each
+ * frame takes spk_rb_mutex once; the writer only touches free space and
+ * ai_audio_player_stop() resets the ring while this task is paused, so the
+ * window stays valid while decoding unlocked.
+ *
+ * Frames at the codec rate in mono decode straight into the queue slot.
+ * Anything else decodes into rs_work and is resampled/downmixed into it.
+ */
 static OPERATE_RET __ai_audio_player_mp3_playing(void)
 {
     OPERATE_RET rt = OPRT_OK;
     APP_PLAYER_T *ctx = &sg_player;
+    uint8_t *in_data = NULL;
+    uint32_t in_len = 0;
 
     if (NULL == ctx->mp3_dec) {
         PR_ERR("mp3 decoder is NULL");
         return OPRT_COM_ERROR;
     }
 
-    tal_mutex_lock(sg_player.spk_rb_mutex);
+    // far enough ahead of the DAC
+    if (ctx->pcm_wr - ctx->pcm_rd >= PCM_QUEUE_FRAMES) {
+        return OPRT_OK;
+    }
+    uint32_t slot = ctx->pcm_wr % PCM_QUEUE_FRAMES;
+    uint8_t *pcm = ctx->pcm_buf + slot * MP3_PCM_SIZE_MAX;
+
+    tal_mutex_lock(ctx->spk_rb_mutex);
+    if (ctx->mp3_rb_consumed > 0) {
+        tuya_ring_buff_discard(ctx->rb_hdl, ctx->mp3_rb_consumed);
+        ctx->mp3_rb_consumed = 0;
+    }
     uint32_t rb_used_len = tuya_ring_buff_used_size_get(ctx->rb_hdl);
-    tal_mutex_unlock(sg_player.spk_rb_mutex);
-    if (0 == rb_used_len && 0 == ctx->mp3_raw_used_len) {
+    uint32_t linear_len = tuya_ring_buff_peek_linear(ctx->rb_hdl, &in_data);
+    if (linear_len < rb_used_len && linear_len < MAINBUF_SIZE) {
+        in_len = tuya_ring_buff_peek(ctx->rb_hdl, ctx->mp3_raw, GET_MIN_LEN(rb_used_len, MAINBUF_SIZE));
+        in_data = ctx->mp3_raw;
+    } else {
+        in_len = GET_MIN_LEN(linear_len, MAINBUF_SIZE);
+    }
+    tal_mutex_unlock(ctx->spk_rb_mutex);
+
+    ctx->mp3_rb_left = rb_used_len;
+    if (0 == rb_used_len) {
         // PR_DEBUG("mp3 data is empty");
         rt = OPRT_RECV_DA_NOT_ENOUGH;
         goto __EXIT;
     }
 
-    if (NULL != ctx->mp3_raw_head && ctx->mp3_raw_used_len > 0 && ctx->mp3_raw_head != ctx->mp3_raw) {
-        // PR_DEBUG("move data, offset=%d, used_len=%d", ctx->mp3_raw_head - ctx->mp3_raw, ctx->mp3_raw_used_len);
-        memmove(ctx->mp3_raw, ctx->mp3_raw_head, ctx->mp3_raw_used_len);
+    int16_t *work = ctx->rs_work + AI_AUDIO_RS_TAPS;
+    bool to_work = ai_audio_resample_needed(&ctx->rs);
+    int samples = mp3dec_decode_frame(ctx->mp3_dec, in_data, in_len, to_work ? work : (mp3d_sample_t *)pcm,
+                                      &ctx->mp3_frame_info);
+    if (samples <= 0 && ctx->mp3_frame_info.frame_bytes == 0) {
+        // need more data
+        goto __EXIT;
     }
-    ctx->mp3_raw_head = ctx->mp3_raw;
-
-    // read new data
-    if (rb_used_len > 0 && ctx->mp3_raw_used_len < MAINBUF_SIZE) {
-        uint32_t read_len = ((MAINBUF_SIZE - ctx->mp3_raw_used_len) > rb_used_len)
-                                ? rb_used_len
-                                : (MAINBUF_SIZE - ctx->mp3_raw_used_len);
 
-        tal_mutex_lock(sg_player.spk_rb_mutex);
-        uint32_t rt_len = tuya_ring_buff_read(ctx->rb_hdl, ctx->mp3_raw + ctx->mp3_raw_used_len, read_len);
-        tal_mutex_unlock(sg_player.spk_rb_mutex);
-        //  PR_DEBUG("read_len=%d rt_len: %d", read_len, rt_len);
+    ctx->mp3_rb_consumed = ctx->mp3_frame_info.frame_bytes;
+    ctx->mp3_rb_left = rb_used_len - ctx->mp3_rb_consumed;
 
-        ctx->mp3_raw_used_len += rt_len;
+    if (samples <= 0) {
+        goto __EXIT;
     }
 
-    int samples = mp3dec_decode_frame(ctx->mp3_dec, ctx->mp3_raw_head, ctx->mp3_raw_used_len,
-                                      (mp3d_sample_t *)ctx->mp3_pcm, &ctx->mp3_frame_info);
-    if (samples <= 0 && ctx->mp3_frame_info.frame_bytes == 0) {
-        // need more data
-        goto __EXIT;
+    mp3dec_frame_info_t *info = &ctx->mp3_frame_info;
+    if ((uint32_t)info->hz != ctx->rs.in_hz || info->channels != ctx->rs.in_ch) {
+        PR_DEBUG("mp3 stream %d Hz %d ch, codec %u Hz", info->hz, info->channels, ctx->out_hz);
+        ai_audio_resample_setup(&ctx->rs, info->hz, info->channels, ctx->out_hz);
+        uint32_t bytes = samples * info->channels * sizeof(int16_t);
+        if (ai_audio_resample_needed(&ctx->rs) && !to_work) {
+            memcpy(work, pcm, bytes);
+            to_work = true;
+        } else if (!ai_audio_resample_needed(&ctx->rs) && to_work) {
+            memcpy(pcm, work, bytes);
+            to_work = false;
+        }
     }
 
-    ctx->mp3_raw_used_len -= ctx->mp3_frame_info.frame_bytes;
-    ctx->mp3_raw_head += ctx->mp3_frame_info.frame_bytes;
+    uint32_t out_n = samples;
+    if (to_work) {
+        out_n = ai_audio_resample_process(&ctx->rs, ctx->rs_work, samples, (int16_t *)pcm,
+                                          MP3_PCM_SIZE_MAX / sizeof(int16_t));
+    }
 
-    if (samples) {
-        tdl_audio_play(ctx->audio_hdl, ctx->mp3_pcm, samples * 2);
+    if (out_n) {
+        ctx->pcm_len[slot] = out_n * sizeof(int16_t);
+        ctx->pcm_wr++;
+        tal_semaphore_post(ctx->pcm_sem);
     }
 
 __EXIT:
     return rt;
 }
 
+/**
+ * @brief Check under the lock that every byte written has been decoded.
+ */
+static bool __ai_audio_player_mp3_drained(void)
+{
+    APP_PLAYER_T *ctx = &sg_player;
+
+    tal_mutex_lock(ctx->spk_rb_mutex);
+    if (ctx->mp3_rb_consumed > 0) {
+        tuya_ring_buff_discard(ctx->rb_hdl, ctx->mp3_rb_consumed);
+        ctx->mp3_rb_consumed = 0;
+    }
+    ctx->mp3_rb_left = tuya_ring_buff_used_size_get(ctx->rb_hdl);
+    tal_mutex_unlock(ctx->spk_rb_mutex);
+
+    return 0 == ctx->mp3_rb_left && ctx->pcm_wr == ctx->pcm_rd;
+}
+
+static void __ai_audio_player_mix_add(int32_t *acc, const int16_t *pcm, uint32_t samples, uint32_t gain)
+{
+    if (AI_AUDIO_MIX_GAIN_UNITY == gain) {
+        for (uint32_t i = 0; i < samples; i++) {
+            acc[i] += pcm[i];
+        }
+    } else {
+        for (uint32_t i = 0; i < samples; i++) {
+            acc[i] += (pcm[i] * (int32_t)gain) >> 8;
+        }
+    }
+}
+
+static uint32_t __ai_audio_player_mix_gain(const AI_AUDIO_MIX_CFG_T *cfg, uint8_t top_priority)
+{
+    if (cfg->priority < top_priority) {
+        return ((uint32_t)cfg->gain * cfg->duck_gain) >> 8;
+    }
+    return cfg->gain;
+}
+
+static uint32_t __ai_audio_player_mix_avail(MIX_STREAM_T *st)
+{
+    if (st->buf) {
+        return st->buf_len - st->buf_pos;
+    }
+    return st->rb_hdl ? tuya_ring_buff_used_size_get(st->rb_hdl) : 0;
+}
+
+// a mix_out buffer reached the driver or was flushed
+static void __ai_audio_player_out_done(TDL_AUDIO_HANDLE_T handle, const uint8_t *data, uint32_t len,
+                                       OPERATE_RET result, void *arg)
+{
+    tal_semaphore_post(sg_player.out_free_sem);
+}
+
+/**
+ * @brief Mix one output write and hand it to the DAC.
+ *
+ * The decoded mp3 queue sets the write size while it has data, mixer
+ * streams contribute what they have of it. Without mp3 a write is one
+ * MIX_CHUNK_SAMPLES chunk, taken once a pushed stream has a whole chunk
+ * queued or a one-shot buffer has data left. Streams below the highest
+ * priority contributor are scaled by their duck gain.
+ *
+ * @return true if something was played
+ */
+static bool __ai_audio_player_mix_round(void)
+{
+    APP_PLAYER_T *ctx = &sg_player;
+    int16_t *out = NULL;
+    uint32_t len = 0, mp3_len = 0;
+    uint32_t avail[AI_AUDIO_MIX_STREAM_MAX] = {0};
+    uint8_t top = 0;
+    bool any = false;
+    const uint8_t *mp3 = NULL;
+
+    if (ctx->pcm_flush || ctx->pcm_mute) {
+        ctx->pcm_rd = ctx->pcm_wr;
+        ctx->pcm_off = 0;
+        ctx->pcm_flush = false;
+    }
+
+    if (ctx->pcm_rd != ctx->pcm_wr) {
+        uint32_t slot = ctx->pcm_rd % PCM_QUEUE_FRAMES;
+        mp3 = ctx->pcm_buf + slot * MP3_PCM_SIZE_MAX + ctx->pcm_off;
+        mp3_len = GET_MIN_LEN(ctx->pcm_len[slot] - ctx->pcm_off, MIX_CHUNK_SAMPLES * 2);
+        len = mp3_len;
+        top = ctx->mp3_mix.priority;
+        any = true;
+    }
+
+    tal_mutex_lock(ctx->mix_mutex);
+    for (int i = 0; i < AI_AUDIO_MIX_STREAM_MAX; i++) {
+        MIX_STREAM_T *st = &ctx->mix[i];
+        if (!st->in_use) {
+            continue;
+        }
+        avail[i] = __ai_audio_player_mix_avail(st);
+        if (NULL == mp3 && NULL == st->buf && avail[i] < MIX_CHUNK_SAMPLES * 2) {
+            avail[i] = 0;
+        }
+        if (avail[i] > 0) {
+            if (!any || st->cfg.priority > top) {
+                top = st->cfg.priority;
+            }
+            any = true;
+        }
+    }
+    if (!any) {
+        tal_mutex_unlock(ctx->mix_mutex);
+        return false;
+    }
+    // the buffer queued two chunks ago, free once it reached the driver
+    tal_semaphore_wait(ctx->out_free_sem, SEM_WAIT_FOREVER);
+    out = ctx->mix_out[ctx->mix_out_idx];
+    ctx->mix_out_idx = (ctx->mix_out_idx + 1) % MIX_OUT_BUF_NUM;
+    if (NULL == mp3) {
+        for (int i = 0; i < AI_AUDIO_MIX_STREAM_MAX; i++) {
+            uint32_t take = GET_MIN_LEN(avail[i], MIX_CHUNK_SAMPLES * 2);
+            if (take > len) {
+                len = take;
+            }
+        }
+    }
+    len &= ~1u;
+
+    uint32_t samples = len / 2;
+    memset(ctx->mix_acc, 0, samples * sizeof(int32_t));
+    if (mp3) {
+        __ai_audio_player_mix_add(ctx->mix_acc, (const int16_t *)mp3, samples,
+                                  __ai_audio_player_mix_gain(&ctx->mp3_mix, top));
+    }
+    for (int i = 0; i < AI_AUDIO_MIX_STREAM_MAX; i++) {
+        MIX_STREAM_T *st = &ctx->mix[i];
+        uint32_t take = GET_MIN_LEN(avail[i], len) & ~1u;
+        if (0 == take) {
+            continue;
+        }
+        uint32_t gain = __ai_audio_player_mix_gain(&st->cfg, top);
+        if (st->buf) {
+            __ai_audio_player_mix_add(ctx->mix_acc, (const int16_t *)(st->buf + st->buf_pos), take / 2, gain);
+            st->buf_pos += take;
+            if (st->buf_pos >= st->buf_len) {
+                st->buf = NULL;
+            }
+        } else {
+            tuya_ring_buff_read(st->rb_hdl, out, take);
+            __ai_audio_player_mix_add(ctx->mix_acc, out, take / 2, gain);
+            tal_semaphore_post(st->space_sem);
+        }
+    }
+    tal_mutex_unlock(ctx->mix_mutex);
+
+    for (uint32_t i = 0; i < samples; i++) {
+        int32_t v = ctx->mix_acc[i];
+        out[i] = (int16_t)((v > 32767) ? 32767 : ((v < -32768) ? -32768 : v));
+    }
+    if (OPRT_OK != tdl_audio_play_async(ctx->audio_hdl, (const uint8_t *)out, len, __ai_audio_player_out_done, NULL)) {
+        tdl_audio_play(ctx->audio_hdl, (uint8_t *)out, len);
+        tal_semaphore_post(ctx->out_free_sem);
+    }
+
+    if (mp3) {
+        ctx->pcm_off += mp3_len;
+        if (ctx->pcm_off >= ctx->pcm_len[ctx->pcm_rd % PCM_QUEUE_FRAMES]) {
+            ctx->pcm_off = 0;
+            ctx->pcm_rd++;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Output stage: mixes decoded frames and mixer streams into the DAC.
+ *
+ * Chunks are queued with tdl_audio_play_async(), the task mixes the next
+ * one while the previous plays and is paced by waiting for a free mix_out
+ * buffer. A slot is released once its last byte was queued, so pcm_rd ==
+ * pcm_wr means the whole mp3 stream is at most MIX_OUT_BUF_NUM chunks from
+ * the codec.
+ */
+static void __ai_audio_player_out_task(void *arg)
+{
+    APP_PLAYER_T *ctx = &sg_player;
+
+    for (;;) {
+        if (!__ai_audio_player_mix_round()) {
+            tal_semaphore_wait(ctx->pcm_sem, PCM_OUT_WAIT_MS);
+        }
+    }
+}
+
+static bool __ai_audio_player_mix_busy(void)
+{
+    bool busy = false;
+
+    tal_mutex_lock(sg_player.mix_mutex);
+    for (int i = 0; i < AI_AUDIO_MIX_STREAM_MAX; i++) {
+        if (sg_player.mix[i].in_use && __ai_audio_player_mix_avail(&sg_player.mix[i]) > 0) {
+            busy = true;
+        }
+    }
+    tal_mutex_unlock(sg_player.mix_mutex);
+
+    return busy;
+}
+
 static OPERATE_RET __ai_audio_player_mp3_init(void)
 {
     OPERATE_RET rt = OPRT_OK;
@@ -171,15 +483,24 @@ static OPERATE_RET __ai_audio_player_mp3_init(void)
     sg_player.mp3_raw = (uint8_t *)tkl_system_psram_malloc(MAINBUF_SIZE);
     TUYA_CHECK_NULL_GOTO(sg_player.mp3_raw, __ERR);
 
-    sg_player.mp3_pcm = (uint8_t *)tkl_system_psram_malloc(MP3_PCM_SIZE_MAX);
-    TUYA_CHECK_NULL_GOTO(sg_player.mp3_pcm, __ERR);
+    sg_player.pcm_buf = (uint8_t *)tkl_system_psram_malloc(PCM_QUEUE_FRAMES * MP3_PCM_SIZE_MAX);
+    TUYA_CHECK_NULL_GOTO(sg_player.pcm_buf, __ERR);
+
+    sg_player.rs_work =
+        (int16_t *)tkl_system_psram_malloc((AI_AUDIO_RS_TAPS + MINIMP3_MAX_SAMPLES_PER_FRAME) * sizeof(int16_t));
+    TUYA_CHECK_NULL_GOTO(sg_player.rs_work, __ERR);
 
     return rt;
 
 __ERR:
-    if (sg_player.mp3_pcm) {
-        tkl_system_psram_free(sg_player.mp3_pcm);
-        sg_player.mp3_pcm = NULL;
+    if (sg_player.rs_work) {
+        tkl_system_psram_free(sg_player.rs_work);
+        sg_player.rs_work = NULL;
+    }
+
+    if (sg_player.pcm_buf) {
+        tkl_system_psram_free(sg_player.pcm_buf);
+        sg_player.pcm_buf = NULL;
     }
 
     if (sg_player.mp3_raw) {
@@ -216,7 +537,6 @@ static void __ai_audio_player_task(void *arg)
                 tal_sw_timer_stop(ctx->tm_id);
             }
             ctx->is_eof = 0;
-            ctx->finish_delay_count = 0;
         } break;
         case AI_AUDIO_PLAYER_STAT_START: {
             rt = __ai_audio_player_mp3_start();
@@ -226,7 +546,6 @@ static void __ai_audio_player_task(void *arg)
                 ctx->stat = AI_AUDIO_PLAYER_STAT_PLAY;
             }
             ctx->is_first_play = 1;
-            ctx->finish_delay_count = 0;
             start_time = tal_system_get_millisecond();
         } break;
         case AI_AUDIO_PLAYER_STAT_PLAY: {
@@ -236,8 +555,10 @@ static void __ai_audio_player_task(void *arg)
                 uint32_t cache_len = tuya_ring_buff_used_size_get(ctx->rb_hdl);
                 tal_mutex_unlock(ctx->spk_rb_mutex);
 
-                if (cache_len >= 3*1024 || tal_system_get_millisecond() - start_time > 1000) {
+                if (cache_len >= PLAYER_PREBUFFER_LEN ||
+                    tal_system_get_millisecond() - start_time > PLAYER_PREBUFFER_TM_MS) {
                     ctx->is_first_play = 0;
+                    AI_AUDIO_TRACE(AI_TRACE_PLAYBACK_START, NULL, cache_len);
                 }
                 break;
             }
@@ -250,23 +571,15 @@ static void __ai_audio_player_task(void *arg)
                     tal_sw_timer_stop(ctx->tm_id);
                 }
             }
-            tal_mutex_lock(ctx->spk_rb_mutex);
-            uint32_t rb_used_len = tuya_ring_buff_used_size_get(ctx->rb_hdl);
-            tal_mutex_unlock(ctx->spk_rb_mutex);
-            if (rb_used_len == 0 && 0 == ctx->mp3_raw_used_len && ctx->is_eof) {
-                /* Wait for audio output buffer to drain before finishing */
-                /* This delay allows the decoded PCM data to be played out */
-                if (ctx->finish_delay_count < 100) { /* ~500ms delay (100 * 5ms) */
-                    ctx->finish_delay_count++;
-                    break;
-                }
-                ctx->finish_delay_count = 0;
+            /* Finished once the output task has handed the last frame to the codec */
+            if (0 == ctx->mp3_rb_left && ctx->is_eof && __ai_audio_player_mp3_drained()) {
                 PR_DEBUG("app player end");
                 ctx->stat = AI_AUDIO_PLAYER_STAT_FINISH;
             }
         } break;
         case AI_AUDIO_PLAYER_STAT_FINISH: {
             tal_sw_timer_stop(ctx->tm_id);
+            AI_AUDIO_TRACE(AI_TRACE_PLAYBACK_END, NULL, 0);
 
             ctx->is_playing = false;
             ctx->stat = AI_AUDIO_PLAYER_STAT_IDLE;
@@ -324,6 +637,14 @@ OPERATE_RET ai_audio_player_init(void)
 
     TUYA_CALL_ERR_GOTO(tdl_audio_find(AUDIO_CODEC_NAME, &sg_player.audio_hdl), __ERR);
 
+    TDL_AUDIO_INFO_T audio_info = {0};
+    if (OPRT_OK == tdl_audio_get_info(sg_player.audio_hdl, &audio_info) && audio_info.sample_rate) {
+        sg_player.out_hz = audio_info.sample_rate;
+    } else {
+        sg_player.out_hz = 16000;
+    }
+    PR_DEBUG("player output %u Hz", sg_player.out_hz);
+
     // create queue
     TUYA_CALL_ERR_GOTO(tal_queue_create_init(&sg_player.state_queue, sizeof(AI_AUDIO_PLAYER_STATE_E), 16), __ERR);
 
@@ -338,6 +659,16 @@ OPERATE_RET ai_audio_player_init(void)
                        __ERR);
     // ring buffer mutex init
     TUYA_CALL_ERR_GOTO(tal_mutex_create_init(&sg_player.spk_rb_mutex), __ERR);
+    // decoded pcm queue
+    TUYA_CALL_ERR_GOTO(tal_semaphore_create_init(&sg_player.pcm_sem, 0, PCM_QUEUE_FRAMES), __ERR);
+    TUYA_CALL_ERR_GOTO(tal_mutex_create_init(&sg_player.mix_mutex), __ERR);
+    TUYA_CALL_ERR_GOTO(tal_semaphore_create_init(&sg_player.out_free_sem, MIX_OUT_BUF_NUM, MIX_OUT_BUF_NUM), __ERR);
+    sg_player.mp3_mix.priority = 0;
+    sg_player.mp3_mix.gain = AI_AUDIO_MIX_GAIN_UNITY;
+    sg_player.mp3_mix.duck_gain = AI_AUDIO_MIX_GAIN_UNITY;
+    TUYA_CALL_ERR_GOTO(tkl_thread_create(&sg_player.out_thrd_hdl, "ai_player_out", 1024 * 4, THREAD_PRIO_0,
+                                         __ai_audio_player_out_task, NULL),
+                       __ERR);
 
     // thread init
     TUYA_CALL_ERR_GOTO(
@@ -369,6 +700,21 @@ __ERR:
         sg_player.rb_hdl = NULL;
     }
 
+    if (sg_player.pcm_sem) {
+        tal_semaphore_release(sg_player.pcm_sem);
+        sg_player.pcm_sem = NULL;
+    }
+
+    if (sg_player.mix_mutex) {
+        tal_mutex_release(sg_player.mix_mutex);
+        sg_player.mix_mutex = NULL;
+    }
+
+    if (sg_player.out_free_sem) {
+        tal_semaphore_release(sg_player.out_free_sem);
+        sg_player.out_free_sem = NULL;
+    }
+
     return rt;
 }
 
@@ -491,6 +837,43 @@ OPERATE_RET ai_audio_player_data_write(char *id, uint8_t *data, uint32_t len, ui
     return OPRT_OK;
 }
 
+/**
+ * @brief Gets the free space of the stream ring buffer.
+ *
+ * @param None
+ * @return uint32_t - Bytes that ai_audio_player_data_write() can take without waiting.
+ */
+uint32_t ai_audio_player_get_free_size(void)
+{
+    if (NULL == sg_player.rb_hdl || NULL == sg_player.spk_rb_mutex) {
+        return 0;
+    }
+
+    tal_mutex_lock(sg_player.spk_rb_mutex);
+    uint32_t rb_free_len = tuya_ring_buff_free_size_get(sg_player.rb_hdl);
+    tal_mutex_unlock(sg_player.spk_rb_mutex);
+
+    return rb_free_len;
+}
+
+/**
+ * @brief Gets the output latency, mixed pcm handed to tdl_audio but not yet played.
+ *
+ * @param None
+ * @return uint32_t - Latency in ms, 0 before init.
+ */
+uint32_t ai_audio_player_get_latency_ms(void)
+{
+    uint32_t samples = 0;
+
+    if (NULL == sg_player.audio_hdl || 0 == sg_player.out_hz ||
+        OPRT_OK != tdl_audio_get_play_queue(sg_player.audio_hdl, &samples)) {
+        return 0;
+    }
+
+    return (uint32_t)((uint64_t)samples * 1000 / sg_player.out_hz);
+}
+
 /**
  * @brief Stops the audio player and clears the audio output buffer.
  *
@@ -505,6 +888,13 @@ OPERATE_RET ai_audio_player_stop(void)
         return OPRT_OK;
     }
 
+    // go silent from the next output chunk on, before waiting for the decoder
+    sg_player.pcm_mute = true;
+    tal_semaphore_post(sg_player.pcm_sem);
+    if (!__ai_audio_player_mix_busy()) {
+        tdl_audio_play_stop(sg_player.audio_hdl);
+    }
+
     // PAUSE player first
     AI_AUDIO_PLAYER_STATE_E stat = AI_AUDIO_PLAYER_STAT_PAUSE;
     TUYA_CALL_ERR_LOG(tal_queue_post(sg_player.state_queue, &stat, 0));
@@ -527,9 +917,22 @@ OPERATE_RET ai_audio_player_stop(void)
 
     tal_mutex_lock(sg_player.spk_rb_mutex);
     tuya_ring_buff_reset(sg_player.rb_hdl);
+    sg_player.mp3_rb_consumed = 0;
+    sg_player.mp3_rb_left = 0;
     tal_mutex_unlock(sg_player.spk_rb_mutex);
 
-    tdl_audio_play_stop(sg_player.audio_hdl);
+    // drop decoded frames the output task has not played yet
+    sg_player.pcm_flush = true;
+    tal_semaphore_post(sg_player.pcm_sem);
+    while (sg_player.pcm_flush) {
+        tal_system_sleep(5);
+    }
+    sg_player.pcm_mute = false;
+
+    // other mixer streams keep the codec busy
+    if (!__ai_audio_player_mix_busy()) {
+        tdl_audio_play_stop(sg_player.audio_hdl);
+    }
 
     sg_player.is_playing = false;
 
@@ -557,3 +960,336 @@ uint8_t ai_audio_player_is_playing(void)
 {
     return sg_player.is_playing;
 }
+
+/**
+ * @brief Sets how the mp3 stream is mixed with the mixer streams.
+ *
+ * @param cfg       Priority, gain and duck gain for the mp3 stream.
+ * @return OPERATE_RET - Returns OPRT_OK on success, OPRT_INVALID_PARM if cfg is NULL.
+ */
+OPERATE_RET ai_audio_player_set_mix(const AI_AUDIO_MIX_CFG_T *cfg)
+{
+    if (NULL == cfg) {
+        return OPRT_INVALID_PARM;
+    }
+
+    sg_player.mp3_mix = *cfg;
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief Opens a pcm stream that is mixed with the mp3 stream.
+ *
+ * @param cfg       Priority, gain and duck gain for the stream.
+ * @param stream    Output: stream handle.
+ * @return OPERATE_RET - Returns OPRT_OK on success, OPRT_EXCEED_UPPER_LIMIT if all streams are open.
+ */
+OPERATE_RET ai_audio_player_mix_open(const AI_AUDIO_MIX_CFG_T *cfg, AI_AUDIO_MIX_STREAM_T *stream)
+{
+    OPERATE_RET rt = OPRT_OK;
+    MIX_STREAM_T *st = NULL;
+
+    if (NULL == cfg || NULL == stream || NULL == sg_player.mix_mutex) {
+        return OPRT_INVALID_PARM;
+    }
+
+    tal_mutex_lock(sg_player.mix_mutex);
+    for (int i = 0; i < AI_AUDIO_MIX_STREAM_MAX; i++) {
+        if (!sg_player.mix[i].in_use) {
+            st = &sg_player.mix[i];
+            *stream = (AI_AUDIO_MIX_STREAM_T)i;
+            break;
+        }
+    }
+    if (NULL == st) {
+        tal_mutex_unlock(sg_player.mix_mutex);
+        return OPRT_EXCEED_UPPER_LIMIT;
+    }
+
+    memset(st, 0, sizeof(MIX_STREAM_T));
+    st->cfg = *cfg;
+    TUYA_CALL_ERR_GOTO(tuya_ring_buff_create(MIX_STREAM_RB_LEN, OVERFLOW_PSRAM_STOP_TYPE, &st->rb_hdl), __EXIT);
+    TUYA_CALL_ERR_GOTO(tal_semaphore_create_init(&st->space_sem, 0, 16), __EXIT);
+    st->in_use = true;
+
+__EXIT:
+    if (OPRT_OK != rt && st->rb_hdl) {
+        tuya_ring_buff_free(st->rb_hdl);
+        st->rb_hdl = NULL;
+    }
+    tal_mutex_unlock(sg_player.mix_mutex);
+
+    return rt;
+}
+
+/**
+ * @brief Queues pcm on a mixer stream, waiting while the stream is full.
+ *
+ * The stream holds 40 ms, so the output rate paces the caller the way
+ * tdl_audio_play() does.
+ *
+ * @param stream     Stream handle.
+ * @param data       16-bit mono pcm at the codec sample rate.
+ * @param len        Length of the data in bytes.
+ * @param timeout_ms Longest wait for space.
+ * @return OPERATE_RET - Returns OPRT_OK when all data was queued, OPRT_TIMEOUT if the mixer did not take it in time.
+ */
+OPERATE_RET ai_audio_player_mix_write(AI_AUDIO_MIX_STREAM_T stream, const uint8_t *data, uint32_t len,
+                                      uint32_t timeout_ms)
+{
+    uint32_t done = 0;
+
+    if (stream >= AI_AUDIO_MIX_STREAM_MAX || !sg_player.mix[stream].in_use || NULL == data) {
+        return OPRT_INVALID_PARM;
+    }
+
+    MIX_STREAM_T *st = &sg_player.mix[stream];
+    while (done < len) {
+        tal_mutex_lock(sg_player.mix_mutex);
+        uint32_t n = tuya_ring_buff_write(st->rb_hdl, data + done, len - done);
+        tal_mutex_unlock(sg_player.mix_mutex);
+
+        if (n > 0) {
+            done += n;
+            tal_semaphore_post(sg_player.pcm_sem);
+            continue;
+        }
+        if (OPRT_OK != tal_semaphore_wait(st->space_sem, timeout_ms)) {
+            return OPRT_TIMEOUT;
+        }
+    }
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief Plays a pcm buffer once on a mixer stream, without copying it.
+ *
+ * Replaces whatever the stream was playing. The buffer must stay valid
+ * until ai_audio_player_mix_is_active() returns false or the stream is stopped.
+ *
+ * @param stream    Stream handle.
+ * @param data      16-bit mono pcm at the codec sample rate.
+ * @param len       Length of the data in bytes.
+ * @return OPERATE_RET - Returns OPRT_OK on success.
+ */
+OPERATE_RET ai_audio_player_mix_play_buf(AI_AUDIO_MIX_STREAM_T stream, const uint8_t *data, uint32_t len)
+{
+    if (stream >= AI_AUDIO_MIX_STREAM_MAX || !sg_player.mix[stream].in_use || NULL == data || 0 == len) {
+        return OPRT_INVALID_PARM;
+    }
+
+    tal_mutex_lock(sg_player.mix_mutex);
+    MIX_STREAM_T *st = &sg_player.mix[stream];
+    tuya_ring_buff_reset(st->rb_hdl);
+    st->buf = data;
+    st->buf_len = len;
+    st->buf_pos = 0;
+    tal_mutex_unlock(sg_player.mix_mutex);
+
+    tal_semaphore_post(sg_player.pcm_sem);
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief Drops everything queued on a mixer stream.
+ *
+ * @param stream    Stream handle.
+ * @return OPERATE_RET - Returns OPRT_OK on success.
+ */
+OPERATE_RET ai_audio_player_mix_stop(AI_AUDIO_MIX_STREAM_T stream)
+{
+    if (stream >= AI_AUDIO_MIX_STREAM_MAX || !sg_player.mix[stream].in_use) {
+        return OPRT_INVALID_PARM;
+    }
+
+    tal_mutex_lock(sg_player.mix_mutex);
+    MIX_STREAM_T *st = &sg_player.mix[stream];
+    tuya_ring_buff_reset(st->rb_hdl);
+    st->buf = NULL;
+    tal_mutex_unlock(sg_player.mix_mutex);
+
+    tal_semaphore_post(sg_player.mix[stream].space_sem);
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief Checks if a mixer stream still has audio to play.
+ *
+ * @param stream    Stream handle.
+ * @return bool - Returns true while queued or one-shot pcm is left.
+ */
+bool ai_audio_player_mix_is_active(AI_AUDIO_MIX_STREAM_T stream)
+{
+    bool active = false;
+
+    if (stream >= AI_AUDIO_MIX_STREAM_MAX || !sg_player.mix[stream].in_use) {
+        return false;
+    }
+
+    tal_mutex_lock(sg_player.mix_mutex);
+    active = __ai_audio_player_mix_avail(&sg_player.mix[stream]) > 0;
+    tal_mutex_unlock(sg_player.mix_mutex);
+
+    return active;
+}
+
+/**
+ * @brief Decodes a whole mp3 buffer into 16-bit pcm, e.g. a built-in prompt
+ *        to be played with ai_audio_player_mix_play_buf().
+ *
+ * Uses its own decoder, so the mp3 stream is not disturbed.
+ *
+ * @param mp3       Mp3 data.
+ * @param len       Length of the mp3 data.
+ * @param pcm       Output: pcm buffer in PSRAM, release with tkl_system_psram_free().
+ * @param pcm_len   Output: length of the pcm in bytes.
+ * @return OPERATE_RET - Returns OPRT_OK on success, OPRT_MALLOC_FAILED if out of memory,
+ *                       OPRT_COM_ERROR if no frame was found.
+ */
+OPERATE_RET ai_audio_player_mp3_to_pcm(const uint8_t *mp3, uint32_t len, uint8_t **pcm, uint32_t *pcm_len)
+{
+    OPERATE_RET rt = OPRT_OK;
+    mp3dec_frame_info_t info;
+    uint32_t total = 0, off = 0;
+    uint32_t out_hz = sg_player.out_hz ? sg_player.out_hz : 16000;
+    uint8_t *out = NULL;
+
+    if (NULL == mp3 || 0 == len || NULL == pcm || NULL == pcm_len) {
+        return OPRT_INVALID_PARM;
+    }
+
+    mp3dec_t *dec = (mp3dec_t *)tkl_system_psram_malloc(sizeof(mp3dec_t));
+    AI_AUDIO_RESAMPLE_T *rs = (AI_AUDIO_RESAMPLE_T *)tkl_system_psram_malloc(sizeof(AI_AUDIO_RESAMPLE_T));
+    int16_t *work =
+        (int16_t *)tkl_system_psram_malloc((AI_AUDIO_RS_TAPS + MINIMP3_MAX_SAMPLES_PER_FRAME) * sizeof(int16_t));
+    if (NULL == dec || NULL == rs || NULL == work) {
+        rt = OPRT_MALLOC_FAILED;
+        goto __EXIT;
+    }
+
+    // first pass only parses headers to size the output at the codec rate
+    memset(rs, 0, sizeof(AI_AUDIO_RESAMPLE_T));
+    mp3dec_init(dec);
+    while (off < len) {
+        int samples = mp3dec_decode_frame(dec, mp3 + off, len - off, NULL, &info);
+        if (0 == info.frame_bytes) {
+            break;
+        }
+        off += info.frame_bytes;
+        if (samples <= 0) {
+            continue;
+        }
+        if ((uint32_t)info.hz != rs->in_hz || info.channels != rs->in_ch) {
+            ai_audio_resample_setup(rs, info.hz, info.channels, out_hz);
+        }
+        total += ai_audio_resample_out_max(rs, samples) * sizeof(int16_t);
+    }
+    if (0 == total) {
+        rt = OPRT_COM_ERROR;
+        goto __EXIT;
+    }
+
+    out = (uint8_t *)tkl_system_psram_malloc(total);
+    if (NULL == out) {
+        rt = OPRT_MALLOC_FAILED;
+        goto __EXIT;
+    }
+
+    uint32_t out_len = 0;
+    off = 0;
+    memset(rs, 0, sizeof(AI_AUDIO_RESAMPLE_T));
+    mp3dec_init(dec);
+    while (off < len && out_len < total) {
+        int samples = mp3dec_decode_frame(dec, mp3 + off, len - off, work + AI_AUDIO_RS_TAPS, &info);
+        if (0 == info.frame_bytes) {
+            break;
+        }
+        off += info.frame_bytes;
+        if (samples <= 0) {
+            continue;
+        }
+        if ((uint32_t)info.hz != rs->in_hz || info.channels != rs->in_ch) {
+            ai_audio_resample_setup(rs, info.hz, info.channels, out_hz);
+        }
+        out_len += ai_audio_resample_process(rs, work, samples, (int16_t *)(out + out_len),
+                                             (total - out_len) / sizeof(int16_t)) *
+                   sizeof(int16_t);
+    }
+
+    *pcm = out;
+    *pcm_len = out_len;
+
+__EXIT:
+    if (work) {
+        tkl_system_psram_free(work);
+    }
+    if (rs) {
+        tkl_system_psram_free(rs);
+    }
+    if (dec) {
+        tkl_system_psram_free(dec);
+    }
+
+    return rt;
+}
+
+/**
+ * @brief Decodes an mp3 buffer repeatedly and measures the decoder alone.
+ *
+ * Uses its own decoder and pcm buffer, so it can run while the player is idle
+ * or playing. The result includes minimp3's per-frame scratch allocation.
+ *
+ * @param mp3       Mp3 data.
+ * @param len       Length of the mp3 data.
+ * @param loops     Number of passes over the data.
+ * @param frames    Output: frames decoded.
+ * @param elapsed_ms Output: total decode time.
+ * @return OPERATE_RET - Returns OPRT_OK on success, OPRT_MALLOC_FAILED if out of memory.
+ */
+OPERATE_RET ai_audio_player_mp3_bench(const uint8_t *mp3, uint32_t len, uint32_t loops, uint32_t *frames,
+                                      uint32_t *elapsed_ms)
+{
+    mp3dec_frame_info_t info;
+    uint32_t cnt = 0;
+
+    if (NULL == mp3 || 0 == len || NULL == frames || NULL == elapsed_ms) {
+        return OPRT_INVALID_PARM;
+    }
+
+    mp3dec_t *dec = (mp3dec_t *)tkl_system_psram_malloc(sizeof(mp3dec_t));
+    uint8_t *pcm = (uint8_t *)tkl_system_psram_malloc(MINIMP3_MAX_SAMPLES_PER_FRAME * 2);
+    if (NULL == dec || NULL == pcm) {
+        if (dec) {
+            tkl_system_psram_free(dec);
+        }
+        if (pcm) {
+            tkl_system_psram_free(pcm);
+        }
+        return OPRT_MALLOC_FAILED;
+    }
+
+    SYS_TIME_T start = tal_system_get_millisecond();
+    for (uint32_t i = 0; i < loops; i++) {
+        uint32_t off = 0;
+        mp3dec_init(dec);
+        while (off < len) {
+            int samples = mp3dec_decode_frame(dec, mp3 + off, len - off, (mp3d_sample_t *)pcm, &info);
+            if (0 == info.frame_bytes) {
+                break;
+            }
+            off += info.frame_bytes;
+            cnt += (samples > 0) ? 1 : 0;
+        }
+    }
+    *elapsed_ms = (uint32_t)(tal_system_get_millisecond() - start);
+    *frames = cnt;
+
+    tkl_system_psram_free(pcm);
+    tkl_system_psram_free(dec);
+
+    return OPRT_OK;
+}
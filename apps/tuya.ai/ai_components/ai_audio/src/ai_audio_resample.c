@@ -0,0 +1,167 @@
+/**
+ * @file ai_audio_resample.c
+ * @brief Polyphase resampler and downmix from decoded mp3 pcm to the codec format.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+#include "tal_api.h"
+
+#include "ai_audio_resample.h"
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+#define RS_PI          3.14159265f
+#define RS_PHASE_SHIFT (16 - 5) /* Q16 fraction to AI_AUDIO_RS_PHASES (32) */
+#define RS_CUTOFF      0.45f    /* of the lower of the two Nyquist rates */
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+/* sin() for filter design only, no libm: range reduce, then an odd polynomial */
+static float __rs_sin(float x)
+{
+    while (x > RS_PI) {
+        x -= 2 * RS_PI;
+    }
+    while (x < -RS_PI) {
+        x += 2 * RS_PI;
+    }
+    if (x > RS_PI / 2) {
+        x = RS_PI - x;
+    } else if (x < -RS_PI / 2) {
+        x = -RS_PI - x;
+    }
+    float x2 = x * x;
+    return x * (1.0f - x2 / 6 * (1.0f - x2 / 20 * (1.0f - x2 / 42 * (1.0f - x2 / 72))));
+}
+
+static int16_t __rs_sat16(int32_t v)
+{
+    return (int16_t)((v > 32767) ? 32767 : ((v < -32768) ? -32768 : v));
+}
+
+/**
+ * @brief Sets the resampler up for an input format and clears its history.
+ *
+ * @param rs        Resampler state.
+ * @param in_hz     Input sample rate.
+ * @param in_ch     Input channels, 1 or 2.
+ * @param out_hz    Output sample rate.
+ * @return None
+ */
+void ai_audio_resample_setup(AI_AUDIO_RESAMPLE_T *rs, uint32_t in_hz, uint8_t in_ch, uint32_t out_hz)
+{
+    rs->in_hz = in_hz;
+    rs->out_hz = out_hz;
+    rs->in_ch = in_ch;
+    rs->pos = 0;
+    rs->hist_len = 0;
+    rs->step = (uint32_t)(((uint64_t)in_hz << 16) / out_hz);
+
+    if (in_hz == out_hz) {
+        return;
+    }
+
+    // cutoff in cycles per input sample
+    float fc = RS_CUTOFF * ((out_hz < in_hz) ? (float)out_hz / (float)in_hz : 1.0f);
+    for (int ph = 0; ph < AI_AUDIO_RS_PHASES; ph++) {
+        float h[AI_AUDIO_RS_TAPS];
+        float sum = 0;
+        float frac = (float)ph / AI_AUDIO_RS_PHASES;
+
+        for (int k = 0; k < AI_AUDIO_RS_TAPS; k++) {
+            float t = (float)(k - (AI_AUDIO_RS_TAPS / 2 - 1)) - frac;
+            float x = 2 * RS_PI * fc * t;
+            float sinc = (t > -1e-6f && t < 1e-6f) ? 1.0f : __rs_sin(x) / x;
+            // Hann window over +-AI_AUDIO_RS_TAPS/2
+            float w = 0.5f + 0.5f * __rs_sin(RS_PI * t / (AI_AUDIO_RS_TAPS / 2) + RS_PI / 2);
+            h[k] = sinc * w;
+            sum += h[k];
+        }
+        // unity DC gain in every phase
+        for (int k = 0; k < AI_AUDIO_RS_TAPS; k++) {
+            rs->coef[ph][k] = __rs_sat16((int32_t)(h[k] / sum * 32768.0f + 0.5f));
+        }
+    }
+}
+
+/**
+ * @brief Gets the output samples a block of input can produce at most.
+ *
+ * @param rs        Resampler state.
+ * @param frames    Input frames.
+ * @return uint32_t - Output samples upper bound.
+ */
+uint32_t ai_audio_resample_out_max(const AI_AUDIO_RESAMPLE_T *rs, uint32_t frames)
+{
+    return (uint32_t)(((uint64_t)(frames + AI_AUDIO_RS_TAPS) << 16) / rs->step) + 1;
+}
+
+/**
+ * @brief Converts one block of input.
+ *
+ * The input must sit at work + AI_AUDIO_RS_TAPS, the space before it is used
+ * to join the block to the previous one without copying the block. Output may
+ * not overlap the work buffer.
+ *
+ * @param rs        Resampler state.
+ * @param work      Buffer of AI_AUDIO_RS_TAPS samples followed by the input.
+ * @param frames    Input frames (samples per channel).
+ * @param out       Output mono pcm.
+ * @param out_max   Output capacity in samples.
+ * @return uint32_t - Output samples written.
+ */
+uint32_t ai_audio_resample_process(AI_AUDIO_RESAMPLE_T *rs, int16_t *work, uint32_t frames, int16_t *out,
+                                   uint32_t out_max)
+{
+    int16_t *in = work + AI_AUDIO_RS_TAPS;
+    uint32_t cnt = 0;
+
+    // downmix in place, each write lands at or before the samples it reads
+    if (2 == rs->in_ch) {
+        for (uint32_t i = 0; i < frames; i++) {
+            in[i] = (int16_t)(((int32_t)in[2 * i] + in[2 * i + 1]) >> 1);
+        }
+    }
+
+    if (rs->in_hz == rs->out_hz) {
+        cnt = (frames < out_max) ? frames : out_max;
+        memcpy(out, in, cnt * sizeof(int16_t));
+        return cnt;
+    }
+
+    // history goes right in front of the block
+    int16_t *x = in - rs->hist_len;
+    uint32_t len = rs->hist_len + frames;
+    memcpy(x, rs->hist, rs->hist_len * sizeof(int16_t));
+
+    while (cnt < out_max) {
+        uint32_t idx = rs->pos >> 16;
+        if (idx + AI_AUDIO_RS_TAPS > len) {
+            break;
+        }
+        const int16_t *c = rs->coef[(rs->pos & 0xFFFF) >> RS_PHASE_SHIFT];
+        const int16_t *s = x + idx;
+        int32_t acc = 0;
+        for (int k = 0; k < AI_AUDIO_RS_TAPS; k++) {
+            acc += (int32_t)s[k] * c[k];
+        }
+        out[cnt++] = __rs_sat16((acc + (1 << 14)) >> 15);
+        rs->pos += rs->step;
+    }
+
+    // keep what the next block still needs, at most one filter length
+    uint32_t consumed = ((rs->pos >> 16) < len) ? (rs->pos >> 16) : len;
+    uint32_t keep = len - consumed;
+    if (keep > AI_AUDIO_RS_TAPS) {
+        consumed += keep - AI_AUDIO_RS_TAPS;
+        keep = AI_AUDIO_RS_TAPS;
+    }
+    memmove(rs->hist, x + consumed, keep * sizeof(int16_t));
+    rs->hist_len = (uint16_t)keep;
+    rs->pos -= consumed << 16;
+
+    return cnt;
+}
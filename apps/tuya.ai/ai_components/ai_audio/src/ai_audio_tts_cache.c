@@ -0,0 +1,473 @@
+/**
+ * @file ai_audio_tts_cache.c
+ * @brief Cache of short TTS replies, keyed by normalized NLG text and voice.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+#include "tkl_memory.h"
+#include "tkl_system.h"
+
+#include "tal_api.h"
+
+#include "ai_audio_player.h"
+#include "ai_audio_tts_cache.h"
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+#define TTS_CACHE_RAW_TEXT_MAX (AI_AUDIO_TTS_CACHE_TEXT_MAX * 2) // reply text before normalizing
+#define TTS_CACHE_PLAYER_ID    "TTS_CACHE"
+
+#define FNV_OFFSET_BASIS 2166136261u
+#define FNV_PRIME        16777619u
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef struct {
+    uint32_t hash;
+    char text[AI_AUDIO_TTS_CACHE_TEXT_MAX]; // normalized
+    uint8_t *mp3;                           // NULL for a free entry
+    uint32_t mp3_len;
+    SYS_TIME_T last_use;
+} AI_AUDIO_TTS_ENTRY_T;
+
+typedef struct {
+    char text[TTS_CACHE_RAW_TEXT_MAX];
+    uint32_t text_len;
+    uint8_t *mp3; // AI_AUDIO_TTS_CACHE_MP3_MAX in PSRAM, kept between replies
+    uint32_t mp3_len;
+    bool active;
+    bool text_done;
+    bool mp3_done;
+    bool overflow; // too long to cache
+} AI_AUDIO_TTS_REC_T;
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static AI_AUDIO_TTS_ENTRY_T sg_tts_entries[AI_AUDIO_TTS_CACHE_ENTRY_MAX];
+static AI_AUDIO_TTS_REC_T sg_tts_rec;
+static char sg_tts_voice[AI_AUDIO_TTS_CACHE_VOICE_LEN];
+static uint32_t sg_tts_size = 0;
+static MUTEX_HANDLE sg_tts_mutex = NULL;
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+static OPERATE_RET __tts_cache_lock(void)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    if (NULL == sg_tts_mutex) {
+        TUYA_CALL_ERR_RETURN(tal_mutex_create_init(&sg_tts_mutex));
+    }
+    tal_mutex_lock(sg_tts_mutex);
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief Normalizes reply text into out.
+ *
+ * Fullwidth and CJK punctuation count as separators like ASCII punctuation,
+ * other UTF-8 is kept as is.
+ *
+ * @return uint32_t - Normalized length, 0 if empty or longer than out_max - 1.
+ */
+static uint32_t __tts_cache_normalize(const char *in, uint32_t len, char *out, uint32_t out_max)
+{
+    const uint8_t *p = (const uint8_t *)in;
+    uint32_t n = 0;
+    bool sep = false;
+
+    for (uint32_t i = 0; i < len; i++) {
+        uint8_t c = p[i];
+
+        if ('\'' == c) {
+            continue; // "didn't" == "didnt"
+        }
+        if (c < 0x80 && !((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'))) {
+            sep = true;
+            continue;
+        }
+        // U+3000..U+303F, and U+FF01..U+FF0F, U+FF1A..U+FF20 as EF BC 81..A0
+        if (i + 2 < len && ((0xE3 == c && 0x80 == p[i + 1]) ||
+                            (0xEF == c && 0xBC == p[i + 1] && p[i + 2] >= 0x81 && p[i + 2] <= 0xA0 &&
+                             !(p[i + 2] >= 0x90 && p[i + 2] <= 0x99)))) {
+            i += 2;
+            sep = true;
+            continue;
+        }
+
+        if (n + 2 >= out_max) {
+            return 0;
+        }
+        if (sep && n > 0) {
+            out[n++] = ' ';
+        }
+        sep = false;
+        out[n++] = (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : (char)c;
+    }
+    out[n] = '\0';
+
+    return n;
+}
+
+static uint32_t __tts_cache_hash(const char *text)
+{
+    uint32_t hash = FNV_OFFSET_BASIS;
+    const char *s = NULL;
+
+    for (s = text; *s; s++) {
+        hash = (hash ^ (uint8_t)*s) * FNV_PRIME;
+    }
+    hash *= FNV_PRIME; // separator, "ab"+"c" != "a"+"bc"
+    for (s = sg_tts_voice; *s; s++) {
+        hash = (hash ^ (uint8_t)*s) * FNV_PRIME;
+    }
+
+    return hash;
+}
+
+static AI_AUDIO_TTS_ENTRY_T *__tts_cache_find(uint32_t hash, const char *text)
+{
+    for (uint32_t i = 0; i < AI_AUDIO_TTS_CACHE_ENTRY_MAX; i++) {
+        AI_AUDIO_TTS_ENTRY_T *entry = &sg_tts_entries[i];
+        if (entry->mp3 && entry->hash == hash && 0 == strcmp(entry->text, text)) {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+static void __tts_cache_release(AI_AUDIO_TTS_ENTRY_T *entry)
+{
+    PR_DEBUG("tts cache evict \"%s\", %u bytes", entry->text, entry->mp3_len);
+    tkl_system_psram_free(entry->mp3);
+    sg_tts_size -= entry->mp3_len;
+    memset(entry, 0, sizeof(AI_AUDIO_TTS_ENTRY_T));
+}
+
+/**
+ * @brief Gets a free entry with room for len bytes, evicting the least
+ *        recently used entries.
+ */
+static AI_AUDIO_TTS_ENTRY_T *__tts_cache_alloc(uint32_t len)
+{
+    AI_AUDIO_TTS_ENTRY_T *free_entry = NULL;
+
+    for (;;) {
+        AI_AUDIO_TTS_ENTRY_T *lru = NULL;
+
+        free_entry = NULL;
+        for (uint32_t i = 0; i < AI_AUDIO_TTS_CACHE_ENTRY_MAX; i++) {
+            AI_AUDIO_TTS_ENTRY_T *entry = &sg_tts_entries[i];
+            if (NULL == entry->mp3) {
+                free_entry = (free_entry) ? free_entry : entry;
+            } else if (NULL == lru || entry->last_use < lru->last_use) {
+                lru = entry;
+            }
+        }
+        if (free_entry && sg_tts_size + len <= AI_AUDIO_TTS_CACHE_SIZE) {
+            break;
+        }
+        if (NULL == lru) {
+            return NULL;
+        }
+        __tts_cache_release(lru);
+    }
+
+    free_entry->mp3 = (uint8_t *)tkl_system_psram_malloc(len);
+    if (NULL == free_entry->mp3) {
+        return NULL;
+    }
+
+    return free_entry;
+}
+
+static void __tts_cache_rec_commit(void)
+{
+    AI_AUDIO_TTS_REC_T *rec = &sg_tts_rec;
+    char text[AI_AUDIO_TTS_CACHE_TEXT_MAX];
+
+    rec->active = false;
+    if (rec->overflow || 0 == rec->mp3_len) {
+        return;
+    }
+    if (0 == __tts_cache_normalize(rec->text, rec->text_len, text, sizeof(text))) {
+        return;
+    }
+
+    uint32_t hash = __tts_cache_hash(text);
+    if (__tts_cache_find(hash, text)) {
+        return;
+    }
+
+    AI_AUDIO_TTS_ENTRY_T *entry = __tts_cache_alloc(rec->mp3_len);
+    if (NULL == entry) {
+        PR_ERR("tts cache alloc %u failed", rec->mp3_len);
+        return;
+    }
+    memcpy(entry->mp3, rec->mp3, rec->mp3_len);
+    entry->mp3_len = rec->mp3_len;
+    entry->hash = hash;
+    strcpy(entry->text, text);
+    entry->last_use = tal_system_get_millisecond();
+    sg_tts_size += entry->mp3_len;
+
+    PR_DEBUG("tts cache add \"%s\", %u bytes, total %u", entry->text, entry->mp3_len, sg_tts_size);
+}
+
+static OPERATE_RET __tts_cache_play(const char *text, uint32_t len)
+{
+    OPERATE_RET rt = OPRT_OK;
+    char norm[AI_AUDIO_TTS_CACHE_TEXT_MAX];
+
+    if (0 == __tts_cache_normalize(text, len, norm, sizeof(norm))) {
+        return OPRT_NOT_FOUND;
+    }
+
+    AI_AUDIO_TTS_ENTRY_T *entry = __tts_cache_find(__tts_cache_hash(norm), norm);
+    if (NULL == entry) {
+        return OPRT_NOT_FOUND;
+    }
+
+    if (ai_audio_player_is_playing()) {
+        ai_audio_player_stop();
+    }
+    TUYA_CALL_ERR_RETURN(ai_audio_player_start(TTS_CACHE_PLAYER_ID));
+    // the whole reply fits the stream buffer, so this does not wait for the decoder
+    TUYA_CALL_ERR_RETURN(ai_audio_player_data_write(TTS_CACHE_PLAYER_ID, entry->mp3, entry->mp3_len, 1));
+    entry->last_use = tal_system_get_millisecond();
+
+    PR_DEBUG("tts cache hit \"%s\"", entry->text);
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief Sets the voice the cloud synthesizes with, part of the cache key.
+ *
+ * Entries of another voice are released.
+ *
+ * @param voice     Voice id, NULL or "" for the default voice.
+ * @return OPERATE_RET - Returns OPRT_OK on success, OPRT_INVALID_PARM if the id is too long.
+ */
+OPERATE_RET ai_audio_tts_cache_set_voice(const char *voice)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    voice = (voice) ? voice : "";
+    if (strlen(voice) >= AI_AUDIO_TTS_CACHE_VOICE_LEN) {
+        return OPRT_INVALID_PARM;
+    }
+
+    TUYA_CALL_ERR_RETURN(__tts_cache_lock());
+    if (0 != strcmp(sg_tts_voice, voice)) {
+        for (uint32_t i = 0; i < AI_AUDIO_TTS_CACHE_ENTRY_MAX; i++) {
+            if (sg_tts_entries[i].mp3) {
+                __tts_cache_release(&sg_tts_entries[i]);
+            }
+        }
+        strcpy(sg_tts_voice, voice);
+    }
+    tal_mutex_unlock(sg_tts_mutex);
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief Plays a cached reply on the mp3 stream of the player.
+ *
+ * Stops whatever the player was playing.
+ *
+ * @param text      Reply text, normalized before the lookup.
+ * @param len       Length of the text.
+ * @return OPERATE_RET - Returns OPRT_OK on success, OPRT_NOT_FOUND if the text is not cached.
+ */
+OPERATE_RET ai_audio_tts_cache_play(const char *text, uint32_t len)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    if (NULL == text) {
+        return OPRT_INVALID_PARM;
+    }
+
+    TUYA_CALL_ERR_RETURN(__tts_cache_lock());
+    rt = __tts_cache_play(text, len);
+    tal_mutex_unlock(sg_tts_mutex);
+
+    return rt;
+}
+
+/**
+ * @brief Starts recording a cloud reply, at NLG start.
+ *
+ * @param None
+ * @return None
+ */
+void ai_audio_tts_cache_reply_start(void)
+{
+    if (OPRT_OK != __tts_cache_lock()) {
+        return;
+    }
+
+    AI_AUDIO_TTS_REC_T *rec = &sg_tts_rec;
+    rec->text_len = 0;
+    rec->mp3_len = 0;
+    rec->text_done = false;
+    rec->mp3_done = false;
+    rec->overflow = false;
+    rec->active = true;
+
+    tal_mutex_unlock(sg_tts_mutex);
+}
+
+/**
+ * @brief Adds NLG text to the reply being recorded.
+ *
+ * @param text      Text chunk.
+ * @param len       Length of the chunk.
+ * @param eof       The reply text is complete.
+ * @return None
+ */
+void ai_audio_tts_cache_reply_text(const uint8_t *text, uint32_t len, bool eof)
+{
+    AI_AUDIO_TTS_REC_T *rec = &sg_tts_rec;
+
+    if (!rec->active || OPRT_OK != __tts_cache_lock()) {
+        return;
+    }
+
+    if (rec->text_len + len > sizeof(rec->text)) {
+        rec->overflow = true;
+    } else if (text && len > 0) {
+        memcpy(&rec->text[rec->text_len], text, len);
+        rec->text_len += len;
+    }
+
+    if (eof) {
+        rec->text_done = true;
+        if (rec->mp3_done) {
+            __tts_cache_rec_commit();
+        }
+    }
+
+    tal_mutex_unlock(sg_tts_mutex);
+}
+
+/**
+ * @brief Adds TTS audio to the reply being recorded.
+ *
+ * The reply is cached once both its text and its audio are complete.
+ *
+ * @param mp3       MP3 chunk, may be NULL at the end.
+ * @param len       Length of the chunk.
+ * @param eof       The reply audio is complete.
+ * @return None
+ */
+void ai_audio_tts_cache_reply_audio(const uint8_t *mp3, uint32_t len, bool eof)
+{
+    AI_AUDIO_TTS_REC_T *rec = &sg_tts_rec;
+
+    if (!rec->active || OPRT_OK != __tts_cache_lock()) {
+        return;
+    }
+
+    if (NULL == rec->mp3 && !rec->overflow) {
+        rec->mp3 = (uint8_t *)tkl_system_psram_malloc(AI_AUDIO_TTS_CACHE_MP3_MAX);
+        if (NULL == rec->mp3) {
+            rec->overflow = true;
+        }
+    }
+
+    if (rec->mp3_len + len > AI_AUDIO_TTS_CACHE_MP3_MAX) {
+        rec->overflow = true;
+    } else if (!rec->overflow && mp3 && len > 0) {
+        memcpy(&rec->mp3[rec->mp3_len], mp3, len);
+        rec->mp3_len += len;
+    }
+
+    if (eof) {
+        rec->mp3_done = true;
+        if (rec->text_done) {
+            __tts_cache_rec_commit();
+        }
+    }
+
+    tal_mutex_unlock(sg_tts_mutex);
+}
+
+/**
+ * @brief Plays the recorded reply text from the cache, at NLG end.
+ *
+ * @param None
+ * @return OPERATE_RET - Returns OPRT_OK if the reply is playing from the cache,
+ *                       OPRT_NOT_FOUND if the cloud audio is needed.
+ */
+OPERATE_RET ai_audio_tts_cache_reply_play(void)
+{
+    OPERATE_RET rt = OPRT_OK;
+    AI_AUDIO_TTS_REC_T *rec = &sg_tts_rec;
+
+    if (!rec->active || rec->overflow || rec->mp3_len > 0) {
+        return OPRT_NOT_FOUND;
+    }
+
+    TUYA_CALL_ERR_RETURN(__tts_cache_lock());
+    rt = __tts_cache_play(rec->text, rec->text_len);
+    if (OPRT_OK == rt) {
+        rec->active = false; // already cached, nothing to record
+    }
+    tal_mutex_unlock(sg_tts_mutex);
+
+    return rt;
+}
+
+/**
+ * @brief Drops the reply being recorded, e.g. when it was interrupted.
+ *
+ * @param None
+ * @return None
+ */
+void ai_audio_tts_cache_reply_abort(void)
+{
+    sg_tts_rec.active = false;
+}
+
+/**
+ * @brief Releases all cached replies.
+ *
+ * @param None
+ * @return uint32_t - Bytes released.
+ */
+uint32_t ai_audio_tts_cache_clear(void)
+{
+    uint32_t freed = sg_tts_size;
+
+    if (OPRT_OK != __tts_cache_lock()) {
+        return 0;
+    }
+    for (uint32_t i = 0; i < AI_AUDIO_TTS_CACHE_ENTRY_MAX; i++) {
+        if (sg_tts_entries[i].mp3) {
+            __tts_cache_release(&sg_tts_entries[i]);
+        }
+    }
+    tal_mutex_unlock(sg_tts_mutex);
+
+    return freed;
+}
+
+/**
+ * @brief Gets the PSRAM held by cached replies.
+ *
+ * @param None
+ * @return uint32_t - Bytes of cached MP3.
+ */
+uint32_t ai_audio_tts_cache_cached_size(void)
+{
+    return sg_tts_size;
+}
@@ -20,6 +20,11 @@
 
 #include "font_awesome_symbols.h"
 #include "lvgl.h"
+// the glyph cache is in the v9 port, a platform LVGL comes without it
+#if defined(LVGL_VERSION_9) && (LVGL_VERSION_9 == 1) && !(defined(ENABLE_PLATFORM_LVGL) && (ENABLE_PLATFORM_LVGL == 1))
+#define UI_GLYPH_CACHE 1
+#include "lv_port_glyph_cache.h"
+#endif
 
 #include "tuya_ringbuf.h"
 #include "tkl_mutex.h"
@@ -31,6 +36,9 @@
 #define STREAM_BUFF_MAX_LEN       1024
 #define STREAM_TEXT_SHOW_WORD_NUM 5
 #define ONE_WORD_MAX_LEN          4
+// A streamed answer goes on in a new label at the first line end past this
+// many bytes, so an append lays out only the last label, not the whole answer
+#define STREAM_LABEL_SPLIT_LEN    256
 
 /***********************************************************
 ***********************typedef define***********************
@@ -58,7 +66,9 @@ typedef struct {
 
     lv_obj_t *msg_cont;
     lv_obj_t *bubble;
+    lv_obj_t *text_cont;
     lv_obj_t *label;
+    uint32_t label_len;
 
     lv_timer_t *timer;
 } APP_UI_STREAM_T;
@@ -91,7 +101,12 @@ int __ui_font_init(UI_FONT_T *ui_font)
         return -1;
     }
 
+#if defined(UI_GLYPH_CACHE) && (UI_GLYPH_CACHE == 1)
+    // CJK glyphs are decompressed on every draw, keep the rendered ones
+    sg_ui.font.text = lv_port_glyph_cache_font(ui_font->text);
+#else
     sg_ui.font.text = ui_font->text;
+#endif
     sg_ui.font.icon = ui_font->icon;
     sg_ui.font.emoji = ui_font->emoji;
     sg_ui.font.emoji_list = ui_font->emoji_list;
@@ -381,6 +396,32 @@ static uint8_t __get_words_from_stream_ringbuff(APP_UI_STREAM_T *stream, uint8_t
 
     return get_num;
 }
+
+static void __stream_label_create(APP_UI_STREAM_T *stream)
+{
+    stream->label = lv_label_create(stream->text_cont);
+    lv_label_set_text(stream->label, "");
+    lv_obj_set_width(stream->label, LV_PCT(100));
+    lv_label_set_long_mode(stream->label, LV_LABEL_LONG_WRAP);
+    stream->label_len = 0;
+}
+
+static void __stream_label_append(APP_UI_STREAM_T *stream, char *text)
+{
+    char *line_end = strchr(text, '\n');
+
+    // the label boundary stands for the line end
+    if (line_end && stream->label_len + (line_end - text) >= STREAM_LABEL_SPLIT_LEN) {
+        *line_end = '\0';
+        lv_label_ins_text(stream->label, LV_LABEL_POS_LAST, text);
+        __stream_label_create(stream);
+        text = line_end + 1;
+    }
+
+    lv_label_ins_text(stream->label, LV_LABEL_POS_LAST, text);
+    stream->label_len += strlen(text);
+}
+
 static void __stream_timer_cb(lv_timer_t *lv_timer)
 {
     uint8_t word_num = 0;
@@ -396,7 +437,7 @@ static void __stream_timer_cb(lv_timer_t *lv_timer)
         return;
     }
 
-    lv_label_ins_text(stream->label, LV_LABEL_POS_LAST, text);
+    __stream_label_append(stream, text);
 
     lv_coord_t content_height = lv_obj_get_height(stream->msg_cont);
     lv_coord_t height = lv_obj_get_height(sg_ui.ui.content);
@@ -459,15 +500,12 @@ void ui_set_assistant_msg_stream_start(void)
     lv_obj_set_scrollbar_mode(sg_ui.stream.bubble, LV_SCROLLBAR_MODE_OFF);
     lv_obj_set_scroll_dir(sg_ui.stream.bubble, LV_DIR_VER);
 
-    lv_obj_t *text_cont = lv_obj_create(sg_ui.stream.bubble);
-    lv_obj_remove_style_all(text_cont);
-    lv_obj_set_size(text_cont, LV_PCT(100), LV_SIZE_CONTENT);
-    lv_obj_set_flex_flow(text_cont, LV_FLEX_FLOW_COLUMN);
+    sg_ui.stream.text_cont = lv_obj_create(sg_ui.stream.bubble);
+    lv_obj_remove_style_all(sg_ui.stream.text_cont);
+    lv_obj_set_size(sg_ui.stream.text_cont, LV_PCT(100), LV_SIZE_CONTENT);
+    lv_obj_set_flex_flow(sg_ui.stream.text_cont, LV_FLEX_FLOW_COLUMN);
 
-    sg_ui.stream.label = lv_label_create(text_cont);
-    lv_label_set_text(sg_ui.stream.label, "");
-    lv_obj_set_width(sg_ui.stream.label, LV_PCT(100));
-    lv_label_set_long_mode(sg_ui.stream.label, LV_LABEL_LONG_WRAP);
+    __stream_label_create(&sg_ui.stream);
 
     OPERATE_RET rt = OPRT_OK;
     if (NULL == sg_ui.stream.text_ringbuff) {
@@ -479,7 +517,7 @@ void ui_set_assistant_msg_stream_start(void)
 
     tuya_ring_buff_reset(sg_ui.stream.text_ringbuff);
 
-    if (sg_ui.stream.rb_mutex) {
+    if (NULL == sg_ui.stream.rb_mutex) {
         rt = tkl_mutex_create_init(&sg_ui.stream.rb_mutex);
         if (rt != OPRT_OK) {
             return;
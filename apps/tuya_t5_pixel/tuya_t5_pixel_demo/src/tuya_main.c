@@ -6,6 +6,7 @@
 #include "board_buzzer_api.h"
 #include "board_bmi270_api.h"
 #include "tdl_button_manage.h"
+#include "tdu_light_math.h"
 #include <string.h>
 #include <math.h>
 #include <stdlib.h>
@@ -553,7 +554,7 @@ static void __2d_wave_effect(void)
         for (uint32_t x = 0; x < 32; x++) {
             float dx = (float)x - 15.5f;
             float dy = (float)y - 15.5f;
-            float distance = sqrtf(dx * dx + dy * dy);
+            float distance = tdu_light_sqrtf(dx * dx + dy * dy);
 
             if (distance <= static_wave_radius) {
                 float distance_hue = (distance / max_radius) * 180.0f;
@@ -593,10 +594,10 @@ static void __snowflake_effect(void)
         for (uint32_t x = 0; x < 32; x++) {
             float dx = (float)x - 15.5f;
             float dy = (float)y - 15.5f;
-            float distance = sqrtf(dx * dx + dy * dy);
-            float point_angle = atan2f(dy, dx) + angle;
+            float distance = tdu_light_sqrtf(dx * dx + dy * dy);
+            float point_angle = tdu_light_atan2f(dy, dx) + angle;
 
-            float snowflake = sinf(6.0f * point_angle) * 0.3f + 0.7f;
+            float snowflake = tdu_light_sinf(6.0f * point_angle) * 0.3f + 0.7f;
             float radius = 12.0f * snowflake;
 
             if (distance <= radius) {
@@ -628,7 +629,7 @@ static void __breathing_circle_effect(void)
     }
     static float breath = 0.0f;
     breath += 0.1f;
-    float radius = 6.0f + 4.0f * sinf(breath);
+    float radius = 6.0f + 4.0f * tdu_light_sinf(breath);
 
     PIXEL_COLOR_T off_color = {0};
     tdl_pixel_set_single_color(g_pixels_handle, 0, LED_PIXELS_TOTAL_NUM, &off_color);
@@ -637,7 +638,7 @@ static void __breathing_circle_effect(void)
         for (uint32_t x = 0; x < 32; x++) {
             float dx = (float)x - 15.5f;
             float dy = (float)y - 15.5f;
-            float distance = sqrtf(dx * dx + dy * dy);
+            float distance = tdu_light_sqrtf(dx * dx + dy * dy);
 
             if (distance <= radius) {
                 float intensity = 1.0f - (distance / radius) * 0.5f;
@@ -678,9 +679,9 @@ static void __ripple_effect(void)
         for (uint32_t x = 0; x < 32; x++) {
             float dx = (float)x - ripple_center_x;
             float dy = (float)y - ripple_center_y;
-            float distance = sqrtf(dx * dx + dy * dy);
+            float distance = tdu_light_sqrtf(dx * dx + dy * dy);
 
-            float ripple = sinf(distance * 0.8f - time * 2.0f) * 0.5f + 0.5f;
+            float ripple = tdu_light_sinf(distance * 0.8f - time * 2.0f) * 0.5f + 0.5f;
 
             if (ripple > 0.3f) {
                 float intensity = (ripple - 0.3f) / 0.7f;
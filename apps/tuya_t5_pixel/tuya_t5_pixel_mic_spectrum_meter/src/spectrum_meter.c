@@ -15,15 +15,12 @@
 #include "board_pixel_api.h"
 #include "tdl_audio_manage.h"
 #include "tuya_ringbuf.h"
+#include "dsp_fft.h"
 
 #include <string.h>
 #include <math.h>
 #include <stdlib.h>
 
-#ifndef M_PI
-#define M_PI 3.14159265358979323846
-#endif
-
 /***********************************************************
 ************************macro define************************
 ***********************************************************/
@@ -47,7 +44,7 @@
 #endif
 
 // FFT configuration
-#define FFT_SIZE   128 // Number of samples for FFT (8ms at 16kHz) - reduced for performance
+#define FFT_SIZE   128 // Number of samples for FFT (8ms at 16kHz)
 #define NUM_BANDS  8
 #define BAND_WIDTH 4 // Pixels per band
 
@@ -68,8 +65,10 @@ static TUYA_RINGBUFF_T g_audio_ringbuf = NULL;
 static MUTEX_HANDLE g_audio_rb_mutex = NULL;
 
 static int16_t g_audio_buffer[FFT_SIZE];
-static float g_fft_real[FFT_SIZE];
-static float g_fft_imag[FFT_SIZE];
+static DSP_RFFT_T g_fft;
+static float g_fft_window[FFT_SIZE];
+static float g_fft_buf[FFT_SIZE];
+static float g_fft_mag[FFT_SIZE / 2 + 1];
 static float g_band_magnitude[NUM_BANDS];
 static float g_band_peak[NUM_BANDS]; // Peak hold for visual effect
 
@@ -89,7 +88,6 @@ static void audio_frame_callback(TDL_AUDIO_FRAME_FORMAT_E type, TDL_AUDIO_STATUS
 static void process_audio_fft(uint8_t *audio_data, uint32_t data_len);
 static void compute_fft(void);
 static void calculate_band_magnitudes(void);
-static float hann_window(int n, int N);
 
 /***********************************************************
 ***********************function define**********************
@@ -201,53 +199,13 @@ static void spectrum_display(void)
 }
 
 /**
- * @brief Hann window function
- */
-static float hann_window(int n, int N)
-{
-    return 0.5f * (1.0f - cosf(2.0f * M_PI * (float)n / (float)(N - 1)));
-}
-
-/**
- * @brief Compute FFT using optimized DFT - only compute bins we need
+ * @brief Window the sample buffer and compute the magnitude of bins 0 to FFT_SIZE/2
  */
 static void compute_fft(void)
 {
-    // Pre-compute window function values
-    static float window[FFT_SIZE];
-    static bool window_computed = false;
-    if (!window_computed) {
-        for (int n = 0; n < FFT_SIZE; n++) {
-            window[n] = hann_window(n, FFT_SIZE);
-        }
-        window_computed = true;
-    }
-
-    // Apply window and compute only needed frequency bins
-    // We only need bins up to ~8kHz (bin 64 for 16kHz sample rate with 128-point FFT)
-    int max_bin = FFT_SIZE / 2; // Nyquist frequency
-
-    for (int k = 0; k < max_bin; k++) {
-        float real_sum = 0.0f;
-        float imag_sum = 0.0f;
-        float k_angle_scale = -2.0f * M_PI * (float)k / (float)FFT_SIZE;
-
-        for (int n = 0; n < FFT_SIZE; n++) {
-            float windowed = (float)g_audio_buffer[n] * window[n];
-            float angle = k_angle_scale * (float)n;
-            real_sum += windowed * cosf(angle);
-            imag_sum += windowed * sinf(angle);
-        }
-
-        g_fft_real[k] = real_sum;
-        g_fft_imag[k] = imag_sum;
-    }
-
-    // Clear unused bins
-    for (int k = max_bin; k < FFT_SIZE; k++) {
-        g_fft_real[k] = 0.0f;
-        g_fft_imag[k] = 0.0f;
-    }
+    dsp_window_pcm_f32(g_audio_buffer, g_fft_window, g_fft_buf, FFT_SIZE);
+    dsp_rfft_f32(&g_fft, g_fft_buf);
+    dsp_rfft_mag_f32(g_fft_buf, g_fft_mag, FFT_SIZE);
 }
 
 /**
@@ -264,10 +222,10 @@ static void calculate_band_magnitudes(void)
         int bin_start = (int)(band_start_hz / freq_resolution);
         int bin_end = (int)(band_end_hz / freq_resolution);
 
-        if (bin_start >= FFT_SIZE)
-            bin_start = FFT_SIZE - 1;
-        if (bin_end >= FFT_SIZE)
-            bin_end = FFT_SIZE - 1;
+        if (bin_start > FFT_SIZE / 2)
+            bin_start = FFT_SIZE / 2;
+        if (bin_end > FFT_SIZE / 2)
+            bin_end = FFT_SIZE / 2;
         if (bin_start < 0)
             bin_start = 0;
         if (bin_end < bin_start)
@@ -278,8 +236,7 @@ static void calculate_band_magnitudes(void)
         int bin_count = 0;
 
         for (int bin = bin_start; bin <= bin_end; bin++) {
-            float magnitude = sqrtf(g_fft_real[bin] * g_fft_real[bin] + g_fft_imag[bin] * g_fft_imag[bin]);
-            magnitude_sum += magnitude;
+            magnitude_sum += g_fft_mag[bin];
             bin_count++;
         }
 
@@ -287,7 +244,8 @@ static void calculate_band_magnitudes(void)
 
         // Normalize and apply logarithmic scaling for better visualization
         // Scale to 0-1 range with some compression
-        float normalized = avg_magnitude / 10000.0f; // Adjust this divisor based on your audio levels
+        // Samples are in [-1, 1), the divisor is 10000 in 16 bit PCM units
+        float normalized = avg_magnitude * (32768.0f / 10000.0f); // Adjust this divisor based on your audio levels
         if (normalized > 1.0f)
             normalized = 1.0f;
         if (normalized < 0.0f)
@@ -551,6 +509,13 @@ static void user_main(void)
     memset(g_band_peak, 0, sizeof(g_band_peak));
     memset(g_audio_buffer, 0, sizeof(g_audio_buffer));
 
+    rt = dsp_rfft_init(&g_fft, FFT_SIZE, DSP_FFT_F32);
+    if (OPRT_OK != rt) {
+        PR_ERR("Failed to init FFT: %d", rt);
+        return;
+    }
+    dsp_window_hann_f32(g_fft_window, FFT_SIZE);
+
     // Start audio processing task
     THREAD_CFG_T thrd_param = {.stackDepth = 4096, .priority = THREAD_PRIO_2, .thrdname = "audio_proc"};
 
@@ -15,6 +15,7 @@
 #include "tdl_audio_manage.h"
 #include "tuya_ringbuf.h"
 #include "tdl_button_manage.h"
+#include "tdu_light_math.h"
 
 #include <string.h>
 #include <math.h>
@@ -278,7 +279,7 @@ static void update_audio_reactive_effects(float audio_power)
 
         // Hot spot intensity pulses with audio (audio power as intensity boost)
         float base_intensity = g_hot_spots[i].base_intensity + g_audio_power_smoothed * 0.8f; // Boosted
-        float pulse = 0.5f * (1.0f + sinf(g_hot_spots[i].phase + g_random_phase_x * 0.3f));   // Add randomness
+        float pulse = 0.5f * (1.0f + tdu_light_sinf(g_hot_spots[i].phase + g_random_phase_x * 0.3f));   // Add randomness
         g_hot_spots[i].intensity =
             base_intensity * (0.5f + 0.5f * pulse * (1.0f + g_audio_power_smoothed)); // Audio boosts pulse
     }
@@ -352,13 +353,13 @@ static float calculate_sphere_hue(float x, float y, float z, float audio_power)
     float dz = z - SPHERE_CENTER_Z;
 
     // Calculate spherical coordinates
-    float azimuth = atan2f(dx, dz);
+    float azimuth = tdu_light_atan2f(dx, dz);
     if (azimuth < 0.0f) {
         azimuth += 2.0f * M_PI;
     }
 
-    float dist_xz = sqrtf(dx * dx + dz * dz);
-    float elevation = atan2f(dy, dist_xz);
+    float dist_xz = tdu_light_sqrtf(dx * dx + dz * dz);
+    float elevation = tdu_light_atan2f(dy, dist_xz);
     float elevation_normalized = (elevation + M_PI / 2.0f) / M_PI;
 
     // Full color spectrum (0-360 degrees) - no limits
@@ -495,11 +496,12 @@ static void render_voxel_gradient_core(int buffer_idx, float radius, float audio
     effect2_last_time = current_time;
 
     // Pre-calculate rotation matrices - only Z axis rotation for effect 2
+    TDU_LIGHT_ROT_Q16_T rot;
+    tdu_light_rot_q16_set(&rot, 0, 0, tdu_light_rad_to_angle(effect2_rotation_z));
 
-    float cos_z = cosf(effect2_rotation_z);
-    float sin_z = sinf(effect2_rotation_z);
-
+    // Voxel offsets are whole pixels, rotated in q8 their squares sum in q16
     float radius_sq = current_radius * current_radius;
+    int32_t radius_sq_q16 = (int32_t)(radius_sq * TDU_LIGHT_Q16_ONE);
 
     // Temporary buffers
     static float temp_brightness[MATRIX_WIDTH][MATRIX_HEIGHT];
@@ -509,25 +511,23 @@ static void render_voxel_gradient_core(int buffer_idx, float radius, float audio
 
     // Iterate through Z layers (voxel approach)
     for (int z = 0; z < SPACE_SIZE; z++) {
-        float z_world = (float)z;
-        float dz = z_world - SPHERE_CENTER_Z;
+        int32_t dz = z - (int32_t)SPHERE_CENTER_Z;
 
         for (int y = 0; y < MATRIX_HEIGHT; y++) {
             for (int x = 0; x < MATRIX_WIDTH; x++) {
-                float x_world = (float)x;
-                float y_world = (float)y;
-                float dx = x_world - SPHERE_CENTER_X;
-                float dy = y_world - SPHERE_CENTER_Y;
+                int32_t d[3] = {(x - (int32_t)SPHERE_CENTER_X) * 256, (y - (int32_t)SPHERE_CENTER_Y) * 256, dz * 256};
+                int32_t r[3];
 
                 // Rotate point around Z axis only (simplified rotation for effect 2)
                 // Z-axis rotation: z stays same, x and y rotate around z
-                float rx = dx * cos_z - dy * sin_z;
-                float ry = dx * sin_z + dy * cos_z;
-                float rz = dz;
+                tdu_light_rot_q16_apply(&rot, d, r);
 
                 // Check if inside sphere
-                float dist_sq = rx * rx + ry * ry + rz * rz;
-                if (dist_sq <= radius_sq) {
+                int32_t dist_sq = r[0] * r[0] + r[1] * r[1] + r[2] * r[2];
+                if (dist_sq <= radius_sq_q16) {
+                    float rx = (float)r[0] * (1.0f / 256.0f);
+                    float ry = (float)r[1] * (1.0f / 256.0f);
+                    float rz = (float)r[2] * (1.0f / 256.0f);
                     // float dist = sqrtf(dist_sq);
                     // float nx = rx / current_radius;
                     // float ny = ry / current_radius;
@@ -751,7 +751,7 @@ static void render_idle_state(int buffer_idx)
 
     // Breathing animation - radius pulses between min and max
     uint32_t current_time = tal_time_get_posix();
-    float pulse = 0.5f + 0.5f * sinf((float)current_time * 0.001f); // Slow breathing pulse
+    float pulse = 0.5f + 0.5f * tdu_light_sinf((float)current_time * 0.001f); // Slow breathing pulse
 
     // Base radius with breathing effect (pulses between 2px and 3px radius)
     float min_radius = 2.0f;
@@ -770,7 +770,7 @@ static void render_idle_state(int buffer_idx)
 
             // Only render circle at center - no corner fading
             if (dist_sq <= radius_sq) {
-                float dist = sqrtf(dist_sq);
+                float dist = tdu_light_sqrtf(dist_sq);
                 // Smooth falloff from center to edge
                 float normalized_dist = dist / radius;
                 float edge_falloff = 1.0f - normalized_dist * 0.5f; // Smooth edge
@@ -880,7 +880,7 @@ static void render_start_state(int buffer_idx)
 
             if (dist_sq <= radius_sq) {
                 // Inside circle - render red with smooth falloff
-                float dist = sqrtf(dist_sq);
+                float dist = tdu_light_sqrtf(dist_sq);
                 float normalized_dist = dist / display_radius;
                 // Smooth falloff from center to edge
                 float edge_falloff = 1.0f - normalized_dist * 0.3f;
@@ -917,14 +917,14 @@ static void render_running_ring(int buffer_idx, float angle1, float angle2)
         for (int x = 0; x < MATRIX_WIDTH; x++) {
             float dx = (float)x - center_x;
             float dy = (float)y - center_y;
-            float dist = sqrtf(dx * dx + dy * dy);
+            float dist = tdu_light_sqrtf(dx * dx + dy * dy);
 
             float brightness = 0.0f;
 
             // Check if pixel is on the ring (1px wide)
             if (fabsf(dist - ring_radius) < 0.7f) {
                 // Calculate angle of this pixel
-                float pixel_angle = atan2f(dy, dx);
+                float pixel_angle = tdu_light_atan2f(dy, dx);
                 if (pixel_angle < 0.0f)
                     pixel_angle += 2.0f * M_PI;
 
@@ -396,6 +396,11 @@ static void update_weather_data(void)
     OPERATE_RET rt = OPRT_OK;
     bool data_ok = false;
 
+    // One cloud request for all the getters below, they read the cache
+    tuya_weather_prefetch(TW_QUERY_CURRENT_CONDITIONS | TW_QUERY_TODAY_HIGH_LOW | TW_QUERY_CURRENT_WIND |
+                              TW_QUERY_CURRENT_AQI,
+                          1);
+
     // Get current weather conditions
     rt = tuya_weather_get_current_conditions(&g_current_conditions);
     if (OPRT_OK == rt) {
@@ -412,7 +417,7 @@ static void update_weather_data(void)
     }
 
     // Get current wind (ignore errors, use defaults)
-    rt = tuya_weather_get_current_wind(g_wind_dir, g_wind_speed);
+    rt = tuya_weather_get_current_wind(g_wind_dir, sizeof(g_wind_dir), g_wind_speed, sizeof(g_wind_speed));
     if (OPRT_OK != rt) {
         strncpy(g_wind_dir, "N/A", sizeof(g_wind_dir) - 1);
         strncpy(g_wind_speed, "N/A", sizeof(g_wind_speed) - 1);
@@ -25,6 +25,15 @@
  *********************/
 #define TAG "esp32_lvgl"
 
+/* Two DMA capable draw buffers let LVGL render the next slice while the
+ * previous one is still sent by esp_lcd_panel_draw_bitmap(); esp_lvgl_port
+ * reports the flush ready from the panel io color-trans-done callback.
+ * Monochrome panels are converted into a buffer of the port first, so the
+ * second draw buffer would only cost memory there. */
+#ifndef DISPLAY_DOUBLE_BUFFER
+#define DISPLAY_DOUBLE_BUFFER (!DISPLAY_MONOCHROME)
+#endif
+
 /**********************
  *      TYPEDEFS
  **********************/
@@ -70,7 +79,7 @@ void lv_port_disp_init(char *device)
         .panel_handle = panel,
         .control_handle = NULL,
         .buffer_size = DISPLAY_BUFFER_SIZE,
-        .double_buffer = false,
+        .double_buffer = DISPLAY_DOUBLE_BUFFER,
         .trans_size = 0,
         .hres = DISPLAY_WIDTH,
         .vres = DISPLAY_HEIGHT,
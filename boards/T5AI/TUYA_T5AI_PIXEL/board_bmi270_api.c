@@ -346,6 +346,11 @@ bmi270_dev_t *board_bmi270_get_handle()
     return &g_bmi270_dev;
 }
 
+struct bmi2_dev *board_bmi270_get_bmi2_dev(void)
+{
+    return &bmi2_dev;
+}
+
 /**
  * @brief Check if BMI270 sensor is ready
  * @param dev Pointer to BMI270 device structure
@@ -360,6 +360,11 @@ bmi270_dev_t *board_bmi270_get_handle()
     return &g_bmi270_dev;
 }
 
+struct bmi2_dev *board_bmi270_get_bmi2_dev(void)
+{
+    return &bmi2_dev;
+}
+
 /*!
  * @brief This internal API is used to set configurations for accel and gyro.
  */
@@ -141,6 +141,12 @@ OPERATE_RET board_bmi270_scan_i2c(TUYA_I2C_NUM_E port);
  */
 bmi270_dev_t *board_bmi270_get_handle();
 
+/**
+ * @brief Get the Bosch driver instance of the BMI270, for tdl_imu_fifo_start()
+ * @return Pointer to bmi2_dev structure
+ */
+struct bmi2_dev *board_bmi270_get_bmi2_dev(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -96,6 +96,19 @@ static OPERATE_RET __board_register_audio(void)
             alsa_cfg.period_frames = 256;   // Default period size
         #endif
 
+        // Low latency options, period_ms overrides the frame counts
+        #if defined(ALSA_PERIOD_MS)
+            alsa_cfg.period_ms = ALSA_PERIOD_MS;
+        #endif
+
+        #if defined(ENABLE_ALSA_MMAP) && (ENABLE_ALSA_MMAP == 1)
+            alsa_cfg.mmap_enable = 1;
+        #endif
+
+        #if defined(ALSA_RT_PRIORITY)
+            alsa_cfg.rt_priority = ALSA_RT_PRIORITY;
+        #endif
+
         // AEC configuration (for future use)
         #if defined(ENABLE_AUDIO_AEC) && (ENABLE_AUDIO_AEC == 1)
             alsa_cfg.aec_enable = 1;
@@ -0,0 +1,372 @@
+/**
+ * @file dsp_fft.c
+ * @brief Real FFT and window functions, see dsp_fft.h.
+ *
+ * The n real samples are read as n/2 complex ones, z[m] = x[2m] + j x[2m+1],
+ * transformed by an iterative radix-2 FFT and split into the spectrum of x:
+ *
+ *   X[k] = (Z[k] + Z*[M-k]) / 2 - j W^k (Z[k] - Z*[M-k]) / 2,  W = e^(-j 2 pi / n)
+ *
+ * with M = n/2. X[k] and X[M-k] come out of the same pair, so the split is
+ * in place too. One table of W^k, k < n/2, serves the FFT (W^2k) and the
+ * split.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include <string.h>
+#include <math.h>
+#include "tal_memory.h"
+#include "dsp_fft.h"
+
+/***********************************************************
+*************************micro define***********************
+***********************************************************/
+#define DSP_PI 3.14159265358979323846
+
+#define DSP_Q15_MUL(a, b) ((int32_t)(((int32_t)(a) * (int32_t)(b) + 0x4000) >> 15))
+
+/***********************************************************
+*************************function define********************
+***********************************************************/
+static int16_t __dsp_sat_q15(int32_t v)
+{
+    if (v > 32767) {
+        return 32767;
+    }
+    if (v < -32768) {
+        return -32768;
+    }
+    return (int16_t)v;
+}
+
+static uint32_t __dsp_log2(uint32_t n)
+{
+    uint32_t bits = 0;
+
+    while ((1u << bits) < n) {
+        bits++;
+    }
+    return bits;
+}
+
+/**
+ * @brief build the tables of an n point real FFT
+ *
+ * @param[out] fft the transform
+ * @param[in] n points, a power of two in DSP_FFT_SIZE_MIN..DSP_FFT_SIZE_MAX
+ * @param[in] types DSP_FFT_F32 and / or DSP_FFT_Q15
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET dsp_rfft_init(DSP_RFFT_T *fft, uint16_t n, uint8_t types)
+{
+    uint32_t half = n / 2;
+    uint32_t bits = 0;
+    uint32_t k = 0;
+
+    if (NULL == fft || n < DSP_FFT_SIZE_MIN || n > DSP_FFT_SIZE_MAX || (n & (n - 1)) ||
+        0 == (types & (DSP_FFT_F32 | DSP_FFT_Q15))) {
+        return OPRT_INVALID_PARM;
+    }
+
+    memset(fft, 0, sizeof(DSP_RFFT_T));
+    fft->n = n;
+
+    fft->bitrev = tal_malloc(half * sizeof(uint16_t));
+    if (NULL == fft->bitrev) {
+        goto __ERR;
+    }
+    bits = __dsp_log2(half);
+    for (k = 0; k < half; k++) {
+        uint32_t r = 0;
+        for (uint32_t b = 0; b < bits; b++) {
+            r |= ((k >> b) & 1) << (bits - 1 - b);
+        }
+        fft->bitrev[k] = (uint16_t)r;
+    }
+
+    if (types & DSP_FFT_F32) {
+        fft->cos_f32 = tal_malloc(half * sizeof(float));
+        fft->sin_f32 = tal_malloc(half * sizeof(float));
+        if (NULL == fft->cos_f32 || NULL == fft->sin_f32) {
+            goto __ERR;
+        }
+        for (k = 0; k < half; k++) {
+            fft->cos_f32[k] = (float)cos(2.0 * DSP_PI * k / n);
+            fft->sin_f32[k] = (float)sin(2.0 * DSP_PI * k / n);
+        }
+#if defined(ENABLE_DSP_CMSIS) && (ENABLE_DSP_CMSIS == 1)
+        fft->scratch = tal_malloc(n * sizeof(float));
+        if (NULL == fft->scratch || ARM_MATH_SUCCESS != arm_rfft_fast_init_f32(&fft->cmsis, n)) {
+            goto __ERR;
+        }
+#endif
+    }
+
+    if (types & DSP_FFT_Q15) {
+        fft->cos_q15 = tal_malloc(half * sizeof(int16_t));
+        fft->sin_q15 = tal_malloc(half * sizeof(int16_t));
+        if (NULL == fft->cos_q15 || NULL == fft->sin_q15) {
+            goto __ERR;
+        }
+        for (k = 0; k < half; k++) {
+            fft->cos_q15[k] = __dsp_sat_q15((int32_t)lround(32768.0 * cos(2.0 * DSP_PI * k / n)));
+            fft->sin_q15[k] = __dsp_sat_q15((int32_t)lround(32768.0 * sin(2.0 * DSP_PI * k / n)));
+        }
+    }
+
+    return OPRT_OK;
+
+__ERR:
+    dsp_rfft_deinit(fft);
+    return OPRT_MALLOC_FAILED;
+}
+
+/**
+ * @brief free the tables
+ *
+ * @param[in] fft the transform
+ */
+void dsp_rfft_deinit(DSP_RFFT_T *fft)
+{
+    if (NULL == fft) {
+        return;
+    }
+
+    tal_free(fft->bitrev);
+    tal_free(fft->cos_f32);
+    tal_free(fft->sin_f32);
+    tal_free(fft->cos_q15);
+    tal_free(fft->sin_q15);
+#if defined(ENABLE_DSP_CMSIS) && (ENABLE_DSP_CMSIS == 1)
+    tal_free(fft->scratch);
+#endif
+    memset(fft, 0, sizeof(DSP_RFFT_T));
+}
+
+/**
+ * @brief in place float real FFT
+ *
+ * @param[in] fft the transform, built with DSP_FFT_F32
+ * @param[in,out] buf n samples in, the packed spectrum out
+ */
+void dsp_rfft_f32(const DSP_RFFT_T *fft, float *buf)
+{
+#if defined(ENABLE_DSP_CMSIS) && (ENABLE_DSP_CMSIS == 1)
+    arm_rfft_fast_f32((arm_rfft_fast_instance_f32 *)&fft->cmsis, buf, fft->scratch, 0);
+    memcpy(buf, fft->scratch, fft->n * sizeof(float));
+#else
+    uint32_t half = fft->n / 2;
+    const float *wc = fft->cos_f32;
+    const float *ws = fft->sin_f32;
+    uint32_t i, j, k;
+
+    for (i = 0; i < half; i++) {
+        j = fft->bitrev[i];
+        if (i < j) {
+            float re = buf[2 * i], im = buf[2 * i + 1];
+            buf[2 * i] = buf[2 * j];
+            buf[2 * i + 1] = buf[2 * j + 1];
+            buf[2 * j] = re;
+            buf[2 * j + 1] = im;
+        }
+    }
+
+    // W_M^k = W_n^2k, so the stride into the table is twice the stage stride
+    for (uint32_t len = 2; len <= half; len <<= 1) {
+        uint32_t span = len / 2;
+        uint32_t step = fft->n / len;
+        for (i = 0; i < half; i += len) {
+            for (k = 0; k < span; k++) {
+                float c = wc[k * step], s = ws[k * step];
+                float *a = &buf[2 * (i + k)];
+                float *b = &buf[2 * (i + k + span)];
+                float tr = b[0] * c + b[1] * s;
+                float ti = b[1] * c - b[0] * s;
+                b[0] = a[0] - tr;
+                b[1] = a[1] - ti;
+                a[0] += tr;
+                a[1] += ti;
+            }
+        }
+    }
+
+    float z0r = buf[0], z0i = buf[1];
+    buf[0] = z0r + z0i;
+    buf[1] = z0r - z0i;
+
+    for (k = 1; k <= half / 2; k++) {
+        float *p = &buf[2 * k];
+        float *q = &buf[2 * (half - k)];
+        float c = wc[k], s = ws[k];
+        // even and odd halves, Fe = (Z[k] + Z*[M-k]) / 2, Fo = -j (Z[k] - Z*[M-k]) / 2
+        float er = 0.5f * (p[0] + q[0]), ei = 0.5f * (p[1] - q[1]);
+        float odr = 0.5f * (p[1] + q[1]), odi = -0.5f * (p[0] - q[0]);
+        // W^k Fo with W^k = c - j s
+        float tr = odr * c + odi * s;
+        float ti = odi * c - odr * s;
+        p[0] = er + tr;
+        p[1] = ei + ti;
+        q[0] = er - tr;
+        q[1] = ti - ei;
+    }
+#endif
+}
+
+/**
+ * @brief in place q15 real FFT, the spectrum is X[k] / n
+ *
+ * @param[in] fft the transform, built with DSP_FFT_Q15
+ * @param[in,out] buf n samples in, the packed spectrum out
+ */
+void dsp_rfft_q15(const DSP_RFFT_T *fft, int16_t *buf)
+{
+    uint32_t half = fft->n / 2;
+    const int16_t *wc = fft->cos_q15;
+    const int16_t *ws = fft->sin_q15;
+    uint32_t i, j, k;
+
+    // halved on the way in, a pair of full scale samples must stay in the unit circle
+    for (i = 0; i < half; i++) {
+        j = fft->bitrev[i];
+        if (i < j) {
+            int16_t re = buf[2 * i], im = buf[2 * i + 1];
+            buf[2 * i] = buf[2 * j] >> 1;
+            buf[2 * i + 1] = buf[2 * j + 1] >> 1;
+            buf[2 * j] = re >> 1;
+            buf[2 * j + 1] = im >> 1;
+        } else if (i == j) {
+            buf[2 * i] >>= 1;
+            buf[2 * i + 1] >>= 1;
+        }
+    }
+
+    // every stage halves, log2(n/2) stages and the input shift make 1/n
+    for (uint32_t len = 2; len <= half; len <<= 1) {
+        uint32_t span = len / 2;
+        uint32_t step = fft->n / len;
+        for (i = 0; i < half; i += len) {
+            for (k = 0; k < span; k++) {
+                int32_t c = wc[k * step], s = ws[k * step];
+                int16_t *a = &buf[2 * (i + k)];
+                int16_t *b = &buf[2 * (i + k + span)];
+                int32_t tr = DSP_Q15_MUL(b[0], c) + DSP_Q15_MUL(b[1], s);
+                int32_t ti = DSP_Q15_MUL(b[1], c) - DSP_Q15_MUL(b[0], s);
+                int32_t ar = a[0], ai = a[1];
+                b[0] = __dsp_sat_q15((ar - tr) >> 1);
+                b[1] = __dsp_sat_q15((ai - ti) >> 1);
+                a[0] = __dsp_sat_q15((ar + tr) >> 1);
+                a[1] = __dsp_sat_q15((ai + ti) >> 1);
+            }
+        }
+    }
+
+    int32_t z0r = buf[0], z0i = buf[1];
+    buf[0] = __dsp_sat_q15(z0r + z0i);
+    buf[1] = __dsp_sat_q15(z0r - z0i);
+
+    for (k = 1; k <= half / 2; k++) {
+        int16_t *p = &buf[2 * k];
+        int16_t *q = &buf[2 * (half - k)];
+        int32_t c = wc[k], s = ws[k];
+        int32_t er = (p[0] + q[0]) >> 1, ei = (p[1] - q[1]) >> 1;
+        int32_t odr = (p[1] + q[1]) >> 1, odi = -((p[0] - q[0]) >> 1);
+        int32_t tr = DSP_Q15_MUL(odr, c) + DSP_Q15_MUL(odi, s);
+        int32_t ti = DSP_Q15_MUL(odi, c) - DSP_Q15_MUL(odr, s);
+        p[0] = __dsp_sat_q15(er + tr);
+        p[1] = __dsp_sat_q15(ei + ti);
+        q[0] = __dsp_sat_q15(er - tr);
+        q[1] = __dsp_sat_q15(ti - ei);
+    }
+}
+
+/**
+ * @brief magnitudes of a packed float spectrum
+ *
+ * @param[in] spec packed spectrum of n points
+ * @param[out] mag n/2 + 1 magnitudes, bin 0 to n/2
+ * @param[in] n points
+ */
+void dsp_rfft_mag_f32(const float *spec, float *mag, uint16_t n)
+{
+    mag[0] = fabsf(spec[0]);
+    mag[n / 2] = fabsf(spec[1]);
+    for (uint32_t k = 1; k < n / 2; k++) {
+        mag[k] = sqrtf(spec[2 * k] * spec[2 * k] + spec[2 * k + 1] * spec[2 * k + 1]);
+    }
+}
+
+/**
+ * @brief squared magnitudes of a packed q15 spectrum
+ *
+ * @param[in] spec packed spectrum of n points
+ * @param[out] power n/2 + 1 values re^2 + im^2, bin 0 to n/2
+ * @param[in] n points
+ */
+void dsp_rfft_power_q15(const int16_t *spec, uint32_t *power, uint16_t n)
+{
+    power[0] = (uint32_t)((int32_t)spec[0] * spec[0]);
+    power[n / 2] = (uint32_t)((int32_t)spec[1] * spec[1]);
+    for (uint32_t k = 1; k < n / 2; k++) {
+        power[k] = (uint32_t)((int32_t)spec[2 * k] * spec[2 * k]) + (uint32_t)((int32_t)spec[2 * k + 1] * spec[2 * k + 1]);
+    }
+}
+
+/**
+ * @brief symmetric Hann window
+ *
+ * @param[out] win n coefficients
+ * @param[in] n points
+ */
+void dsp_window_hann_f32(float *win, uint16_t n)
+{
+    for (uint32_t i = 0; i < n; i++) {
+        win[i] = (float)(0.5 * (1.0 - cos(2.0 * DSP_PI * i / (n - 1))));
+    }
+}
+
+/**
+ * @brief symmetric Hann window in q15
+ *
+ * @param[out] win n coefficients
+ * @param[in] n points
+ */
+void dsp_window_hann_q15(int16_t *win, uint16_t n)
+{
+    for (uint32_t i = 0; i < n; i++) {
+        win[i] = __dsp_sat_q15((int32_t)lround(32768.0 * 0.5 * (1.0 - cos(2.0 * DSP_PI * i / (n - 1)))));
+    }
+}
+
+/**
+ * @brief window 16 bit PCM into floats in [-1, 1)
+ *
+ * @param[in] pcm n samples
+ * @param[in] win n coefficients
+ * @param[out] out n windowed samples
+ * @param[in] n points
+ */
+void dsp_window_pcm_f32(const int16_t *pcm, const float *win, float *out, uint16_t n)
+{
+    for (uint32_t i = 0; i < n; i++) {
+        out[i] = (float)pcm[i] * (1.0f / 32768.0f) * win[i];
+    }
+}
+
+/**
+ * @brief window q15 samples, in and out may be the same
+ *
+ * @param[in] in n samples
+ * @param[in] win n coefficients
+ * @param[out] out n windowed samples
+ * @param[in] n points
+ */
+void dsp_window_q15(const int16_t *in, const int16_t *win, int16_t *out, uint16_t n)
+{
+    for (uint32_t i = 0; i < n; i++) {
+        out[i] = (int16_t)DSP_Q15_MUL(in[i], win[i]);
+    }
+}
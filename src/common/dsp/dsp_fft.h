@@ -0,0 +1,156 @@
+/**
+ * @file dsp_fft.h
+ * @brief Real FFT and window functions for audio analysis.
+ *
+ * dsp_rfft_init() builds the bit reversal and twiddle tables of one size
+ * once, the transforms then only do table lookups, multiplies and adds. An
+ * N point real signal is transformed as an N/2 point complex radix-2 FFT
+ * and a split step, in place, and the spectrum is packed like CMSIS
+ * arm_rfft_fast_f32():
+ *
+ *   buf[0] = Re X[0], buf[1] = Re X[N/2], buf[2k] = Re X[k], buf[2k+1] = Im X[k]
+ *
+ * The q15 transform scales every stage, its bin k is X[k] / N saturated to
+ * int16. With ENABLE_DSP_CMSIS the float transform runs on CMSIS-DSP.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#ifndef __DSP_FFT_H__
+#define __DSP_FFT_H__
+
+#include "tuya_cloud_types.h"
+
+#if defined(ENABLE_DSP_CMSIS) && (ENABLE_DSP_CMSIS == 1)
+#include "arm_math.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***********************************************************************
+ ********************* constant ( macro and enum ) *********************
+ **********************************************************************/
+#define DSP_FFT_SIZE_MIN 8
+#define DSP_FFT_SIZE_MAX 4096
+
+/* tables dsp_rfft_init() builds */
+#define DSP_FFT_F32 0x01
+#define DSP_FFT_Q15 0x02
+
+/***********************************************************************
+ ********************* struct ******************************************
+ **********************************************************************/
+typedef struct {
+    uint16_t n;        // real points, a power of two
+    uint16_t *bitrev;  // n/2 entries
+    float *cos_f32;    // cos(2 pi k / n), n/2 entries
+    float *sin_f32;
+    int16_t *cos_q15;
+    int16_t *sin_q15;
+#if defined(ENABLE_DSP_CMSIS) && (ENABLE_DSP_CMSIS == 1)
+    arm_rfft_fast_instance_f32 cmsis;
+    float *scratch;
+#endif
+} DSP_RFFT_T;
+
+/***********************************************************************
+ ********************* function ****************************************
+ **********************************************************************/
+
+/**
+ * @brief build the tables of an n point real FFT
+ *
+ * @param[out] fft the transform
+ * @param[in] n points, a power of two in DSP_FFT_SIZE_MIN..DSP_FFT_SIZE_MAX
+ * @param[in] types DSP_FFT_F32 and / or DSP_FFT_Q15
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET dsp_rfft_init(DSP_RFFT_T *fft, uint16_t n, uint8_t types);
+
+/**
+ * @brief free the tables
+ *
+ * @param[in] fft the transform
+ */
+void dsp_rfft_deinit(DSP_RFFT_T *fft);
+
+/**
+ * @brief in place float real FFT
+ *
+ * @param[in] fft the transform, built with DSP_FFT_F32
+ * @param[in,out] buf n samples in, the packed spectrum out
+ */
+void dsp_rfft_f32(const DSP_RFFT_T *fft, float *buf);
+
+/**
+ * @brief in place q15 real FFT, the spectrum is X[k] / n
+ *
+ * @param[in] fft the transform, built with DSP_FFT_Q15
+ * @param[in,out] buf n samples in, the packed spectrum out
+ */
+void dsp_rfft_q15(const DSP_RFFT_T *fft, int16_t *buf);
+
+/**
+ * @brief magnitudes of a packed float spectrum
+ *
+ * @param[in] spec packed spectrum of n points
+ * @param[out] mag n/2 + 1 magnitudes, bin 0 to n/2
+ * @param[in] n points
+ */
+void dsp_rfft_mag_f32(const float *spec, float *mag, uint16_t n);
+
+/**
+ * @brief squared magnitudes of a packed q15 spectrum
+ *
+ * @param[in] spec packed spectrum of n points
+ * @param[out] power n/2 + 1 values re^2 + im^2, bin 0 to n/2
+ * @param[in] n points
+ */
+void dsp_rfft_power_q15(const int16_t *spec, uint32_t *power, uint16_t n);
+
+/**
+ * @brief symmetric Hann window
+ *
+ * @param[out] win n coefficients
+ * @param[in] n points
+ */
+void dsp_window_hann_f32(float *win, uint16_t n);
+
+/**
+ * @brief symmetric Hann window in q15
+ *
+ * @param[out] win n coefficients
+ * @param[in] n points
+ */
+void dsp_window_hann_q15(int16_t *win, uint16_t n);
+
+/**
+ * @brief window 16 bit PCM into floats in [-1, 1)
+ *
+ * @param[in] pcm n samples
+ * @param[in] win n coefficients
+ * @param[out] out n windowed samples
+ * @param[in] n points
+ */
+void dsp_window_pcm_f32(const int16_t *pcm, const float *win, float *out, uint16_t n);
+
+/**
+ * @brief window q15 samples, in and out may be the same
+ *
+ * @param[in] in n samples
+ * @param[in] win n coefficients
+ * @param[out] out n windowed samples
+ * @param[in] n points
+ */
+void dsp_window_q15(const int16_t *in, const int16_t *win, int16_t *out, uint16_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DSP_FFT_H__ */
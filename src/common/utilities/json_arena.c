@@ -0,0 +1,275 @@
+/**
+ * @file json_arena.c
+ * @brief Scoped bump allocator arenas for cJSON parsing.
+ *
+ * Two small tables are shared by all threads. s_active maps a thread to the
+ * arena it allocates from; a slot is only matched by its own thread, the
+ * mutex just serializes taking and giving back slots. s_range lists the
+ * live chunks, so a free of any arena allocation, from any thread, is
+ * recognized and skipped. Both are read without the lock, and both are
+ * skipped entirely while no arena is in use, which keeps the heap path as
+ * cheap as the plain hooks.
+ *
+ * @copyright Copyright (c) 2021-2024 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include <string.h>
+#include "json_arena.h"
+#include "tal_log.h"
+#include "tal_mutex.h"
+#include "tkl_thread.h"
+
+#define JSON_ARENA_ALIGN      8
+#define JSON_ARENA_ALIGN_UP(x) (((x) + JSON_ARENA_ALIGN - 1) & ~(size_t)(JSON_ARENA_ALIGN - 1))
+
+#define JSON_ARENA_LOAD(ptr)       __atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+#define JSON_ARENA_STORE(ptr, val) __atomic_store_n(ptr, val, __ATOMIC_RELEASE)
+
+struct json_arena_chunk {
+    JSON_ARENA_CHUNK_T *next;
+    uint32_t size;
+    uint32_t used;
+    uint8_t data[] __attribute__((aligned(JSON_ARENA_ALIGN)));
+};
+
+typedef struct {
+    uintptr_t start;
+    uintptr_t end; // 0 for a free slot
+} JSON_ARENA_RANGE_T;
+
+typedef struct {
+    void *owner; // NULL for a free slot
+    JSON_ARENA_T *arena;
+} JSON_ARENA_ACTIVE_T;
+
+static cJSON_Hooks s_heap;
+static MUTEX_HANDLE s_mutex = NULL;
+static uint32_t s_active_num = 0;
+static uint32_t s_range_num = 0;
+static JSON_ARENA_ACTIVE_T s_active[JSON_ARENA_ACTIVE_MAX];
+static JSON_ARENA_RANGE_T s_range[JSON_ARENA_CHUNK_MAX];
+
+static void *__thread_self(void)
+{
+    TKL_THREAD_HANDLE self = NULL;
+
+    tkl_thread_get_id(&self);
+    return (void *)self;
+}
+
+static JSON_ARENA_ACTIVE_T *__active_find(void *owner)
+{
+    for (int i = 0; i < JSON_ARENA_ACTIVE_MAX; i++) {
+        if (JSON_ARENA_LOAD(&s_active[i].owner) == owner) {
+            return &s_active[i];
+        }
+    }
+    return NULL;
+}
+
+static bool __range_add(JSON_ARENA_CHUNK_T *chunk)
+{
+    bool added = false;
+
+    tal_mutex_lock(s_mutex);
+    for (int i = 0; i < JSON_ARENA_CHUNK_MAX; i++) {
+        if (0 == s_range[i].end) {
+            JSON_ARENA_STORE(&s_range[i].start, (uintptr_t)chunk->data);
+            JSON_ARENA_STORE(&s_range[i].end, (uintptr_t)chunk->data + chunk->size);
+            JSON_ARENA_STORE(&s_range_num, s_range_num + 1);
+            added = true;
+            break;
+        }
+    }
+    tal_mutex_unlock(s_mutex);
+
+    return added;
+}
+
+static void __range_del(JSON_ARENA_CHUNK_T *chunk)
+{
+    tal_mutex_lock(s_mutex);
+    for (int i = 0; i < JSON_ARENA_CHUNK_MAX; i++) {
+        if (s_range[i].start == (uintptr_t)chunk->data && 0 != s_range[i].end) {
+            JSON_ARENA_STORE(&s_range[i].end, 0);
+            JSON_ARENA_STORE(&s_range[i].start, 0);
+            JSON_ARENA_STORE(&s_range_num, s_range_num - 1);
+            break;
+        }
+    }
+    tal_mutex_unlock(s_mutex);
+}
+
+static void *__arena_alloc(JSON_ARENA_T *arena, size_t size)
+{
+    JSON_ARENA_CHUNK_T *chunk = arena->chunk;
+    void *ptr = NULL;
+
+    size = JSON_ARENA_ALIGN_UP(size);
+    if (NULL == chunk || chunk->size - chunk->used < size) {
+        // the first chunk is sized by the caller, later ones grow in JSON_ARENA_CHUNK_SIZE steps
+        size_t chunk_size = (NULL == chunk) ? arena->chunk_size : JSON_ARENA_CHUNK_SIZE;
+        chunk_size = JSON_ARENA_ALIGN_UP((chunk_size < size) ? size : chunk_size);
+
+        chunk = s_heap.malloc_fn(sizeof(JSON_ARENA_CHUNK_T) + chunk_size);
+        if (NULL == chunk) {
+            return NULL;
+        }
+        chunk->size = chunk_size;
+        chunk->used = 0;
+        if (!__range_add(chunk)) {
+            s_heap.free_fn(chunk);
+            return NULL;
+        }
+        chunk->next = arena->chunk;
+        arena->chunk = chunk;
+    }
+
+    ptr = &chunk->data[chunk->used];
+    chunk->used += size;
+    return ptr;
+}
+
+static void *__json_arena_malloc(size_t size)
+{
+    if (JSON_ARENA_LOAD(&s_active_num) > 0) {
+        JSON_ARENA_ACTIVE_T *active = __active_find(__thread_self());
+        if (active) {
+            void *ptr = __arena_alloc(active->arena, size);
+            if (ptr) {
+                return ptr;
+            }
+        }
+    }
+
+    return s_heap.malloc_fn(size);
+}
+
+static void __json_arena_free(void *ptr)
+{
+    if (NULL == ptr) {
+        return;
+    }
+
+    if (JSON_ARENA_LOAD(&s_range_num) > 0) {
+        uintptr_t addr = (uintptr_t)ptr;
+        for (int i = 0; i < JSON_ARENA_CHUNK_MAX; i++) {
+            uintptr_t end = JSON_ARENA_LOAD(&s_range[i].end);
+            if (addr < end && addr >= JSON_ARENA_LOAD(&s_range[i].start)) {
+                return; // released with its arena
+            }
+        }
+    }
+
+    s_heap.free_fn(ptr);
+}
+
+OPERATE_RET json_arena_hooks_init(const cJSON_Hooks *hooks)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    if (NULL == hooks || NULL == hooks->malloc_fn || NULL == hooks->free_fn) {
+        return OPRT_INVALID_PARM;
+    }
+
+    if (NULL == s_mutex) {
+        TUYA_CALL_ERR_RETURN(tal_mutex_create_init(&s_mutex));
+    }
+
+    s_heap = *hooks;
+    cJSON_InitHooks(&(cJSON_Hooks){.malloc_fn = __json_arena_malloc, .free_fn = __json_arena_free});
+
+    return OPRT_OK;
+}
+
+OPERATE_RET json_arena_begin(JSON_ARENA_T *arena, uint32_t size)
+{
+    JSON_ARENA_ACTIVE_T *active = NULL;
+    void *self = NULL;
+
+    memset(arena, 0, sizeof(JSON_ARENA_T));
+    arena->chunk_size = size;
+
+    if (NULL == s_mutex) {
+        return OPRT_RESOURCE_NOT_READY;
+    }
+
+    self = __thread_self();
+    tal_mutex_lock(s_mutex);
+    active = __active_find(self);
+    if (active) {
+        // nested scope, the outer arena comes back on close
+        arena->prev = active->arena;
+        active->arena = arena;
+    } else if (NULL != (active = __active_find(NULL))) {
+        active->arena = arena;
+        JSON_ARENA_STORE(&active->owner, self);
+        JSON_ARENA_STORE(&s_active_num, s_active_num + 1);
+    }
+    tal_mutex_unlock(s_mutex);
+
+    if (NULL == active) {
+        return OPRT_RESOURCE_NOT_READY;
+    }
+
+    arena->owner = self;
+    return OPRT_OK;
+}
+
+void json_arena_close(JSON_ARENA_T *arena)
+{
+    JSON_ARENA_ACTIVE_T *active = NULL;
+
+    if (NULL == arena->owner) {
+        return;
+    }
+
+    tal_mutex_lock(s_mutex);
+    active = __active_find(arena->owner);
+    if (active && active->arena == arena) {
+        if (arena->prev) {
+            active->arena = arena->prev;
+        } else {
+            JSON_ARENA_STORE(&active->owner, NULL);
+            active->arena = NULL;
+            JSON_ARENA_STORE(&s_active_num, s_active_num - 1);
+        }
+    }
+    tal_mutex_unlock(s_mutex);
+
+    arena->owner = NULL;
+    arena->prev = NULL;
+}
+
+void json_arena_end(JSON_ARENA_T *arena)
+{
+    JSON_ARENA_CHUNK_T *chunk = NULL;
+
+    json_arena_close(arena);
+
+    while (NULL != (chunk = arena->chunk)) {
+        arena->chunk = chunk->next;
+        __range_del(chunk);
+        s_heap.free_fn(chunk);
+    }
+}
+
+cJSON *json_arena_parse(JSON_ARENA_T *arena, const char *value)
+{
+    cJSON *root = NULL;
+
+    if (NULL == value) {
+        memset(arena, 0, sizeof(JSON_ARENA_T));
+        return NULL;
+    }
+
+    if (OPRT_OK != json_arena_begin(arena, JSON_ARENA_SIZE(strlen(value)))) {
+        return cJSON_Parse(value);
+    }
+
+    root = cJSON_Parse(value);
+    json_arena_close(arena);
+
+    return root;
+}
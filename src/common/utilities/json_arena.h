@@ -0,0 +1,121 @@
+/**
+ * @file json_arena.h
+ * @brief Scoped bump allocator arenas for cJSON parsing.
+ *
+ * cJSON allocates every node, key and string of a parse separately from the
+ * global heap, and frees them one by one again. A parse in an arena takes
+ * them from a few large chunks instead and the tree is released in one shot.
+ *
+ * json_arena_hooks_init() replaces cJSON_InitHooks() at startup. It installs
+ * hooks that serve the allocations of a thread from the arena that thread has
+ * open, and everything else from the given heap hooks. The parse switches the
+ * arena to closed when it returns, so whatever the caller allocates while it
+ * walks the tree (cJSON_Duplicate, cJSON_Print) comes from the heap as
+ * before.
+ *
+ * Rules for the tree of an arena parse:
+ * - cJSON_Delete() and cJSON_free() on its nodes are allowed and do nothing.
+ * - No node, string or detached item may be used after json_arena_end().
+ *   Duplicate what has to outlive the scope.
+ *
+ * Example:
+ *     JSON_ARENA_T arena;
+ *     cJSON *root = json_arena_parse(&arena, text);
+ *     ...
+ *     cJSON_Delete(root);
+ *     json_arena_end(&arena);
+ *
+ * Without json_arena_hooks_init() the parse falls back to cJSON_Parse() and
+ * the same calling code keeps working on the heap.
+ *
+ * @copyright Copyright (c) 2021-2024 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#ifndef _JSON_ARENA_H
+#define _JSON_ARENA_H
+
+#include "tuya_cloud_types.h"
+#include "cJSON.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* live chunks of all arenas together, allocations beyond go to the heap */
+#ifndef JSON_ARENA_CHUNK_MAX
+#define JSON_ARENA_CHUNK_MAX 16
+#endif
+
+/* threads parsing into an arena at the same time */
+#ifndef JSON_ARENA_ACTIVE_MAX
+#define JSON_ARENA_ACTIVE_MAX 4
+#endif
+
+/* smallest chunk added when the first one is full */
+#ifndef JSON_ARENA_CHUNK_SIZE
+#define JSON_ARENA_CHUNK_SIZE 1024
+#endif
+
+/* first chunk for a text of len bytes, about what cJSON takes for it */
+#define JSON_ARENA_SIZE(len) ((len) * 2 + 256)
+
+typedef struct json_arena_chunk JSON_ARENA_CHUNK_T;
+
+typedef struct json_arena {
+    JSON_ARENA_CHUNK_T *chunk;  /* newest chunk first */
+    struct json_arena *prev;    /* arena the thread had open before, restored on close */
+    void *owner;                /* thread allocating from the arena, NULL once closed */
+    uint32_t chunk_size;
+} JSON_ARENA_T;
+
+/**
+ * @brief install the cJSON hooks that serve arena scopes
+ *
+ * @param[in] hooks heap allocator for everything outside an arena
+ *
+ * @return OPRT_OK on success, OPRT_INVALID_PARM without malloc_fn and free_fn
+ */
+OPERATE_RET json_arena_hooks_init(const cJSON_Hooks *hooks);
+
+/**
+ * @brief open an arena for the cJSON allocations of the calling thread
+ *
+ * @param[out] arena the arena
+ * @param[in] size size of the first chunk, allocated on the first use
+ *
+ * @return OPRT_OK on success, OPRT_RESOURCE_NOT_READY without the arena hooks
+ * or when JSON_ARENA_ACTIVE_MAX threads have an arena open; the allocations
+ * then come from the heap and the arena may still be ended
+ */
+OPERATE_RET json_arena_begin(JSON_ARENA_T *arena, uint32_t size);
+
+/**
+ * @brief stop allocating from an arena, its allocations stay valid
+ *
+ * @param[in] arena the arena
+ */
+void json_arena_close(JSON_ARENA_T *arena);
+
+/**
+ * @brief release all allocations of an arena at once
+ *
+ * @param[in] arena the arena, closed first if still open
+ */
+void json_arena_end(JSON_ARENA_T *arena);
+
+/**
+ * @brief parse a text into a new, closed arena
+ *
+ * @param[out] arena the arena, to be ended after the tree was used
+ * @param[in] value the NUL terminated text
+ *
+ * @return the tree, NULL on a parse error
+ */
+cJSON *json_arena_parse(JSON_ARENA_T *arena, const char *value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,310 @@
+/**
+ * @file json_scan.c
+ * @brief Single pass JSON tokenizer working in a caller supplied token arena.
+ *
+ * @copyright Copyright (c) 2021-2024 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <limits.h>
+#include "json_scan.h"
+
+typedef struct {
+    int16_t tok;
+    bool key_next;
+} json_scan_level_t;
+
+static int hex4(const char *p)
+{
+    int value = 0;
+    for (int i = 0; i < 4; i++) {
+        char c = p[i];
+        value <<= 4;
+        if (c >= '0' && c <= '9') {
+            value |= c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            value |= c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            value |= c - 'A' + 10;
+        } else {
+            return -1;
+        }
+    }
+    return value;
+}
+
+/* account a new token in its parent, FALSE if it is not allowed there */
+static bool json_scan_attach(json_tok_t *toks, json_scan_level_t *stack, int depth, json_tok_type_t type)
+{
+    if (depth == 0) {
+        return TRUE;
+    }
+
+    json_scan_level_t *level = &stack[depth - 1];
+    json_tok_t *parent = &toks[level->tok];
+    if (parent->type == JSON_TOK_ARRAY) {
+        parent->size++;
+    } else if (level->key_next) {
+        if (type != JSON_TOK_STRING) {
+            return FALSE;
+        }
+        parent->size++;
+        level->key_next = FALSE;
+    } else {
+        level->key_next = TRUE;
+    }
+    return TRUE;
+}
+
+int json_scan(const char *js, size_t len, json_tok_t *toks, uint16_t num)
+{
+    json_scan_level_t stack[JSON_SCAN_MAX_DEPTH];
+    int depth = 0;
+    int count = 0;
+
+    if (NULL == js || NULL == toks || len > 0xFFFF) {
+        return OPRT_INVALID_PARM;
+    }
+
+    for (size_t pos = 0; pos < len; pos++) {
+        char c = js[pos];
+        json_tok_t *tok = NULL;
+
+        switch (c) {
+        case ' ':
+        case '\t':
+        case '\r':
+        case '\n':
+        case ',':
+        case ':':
+            continue;
+
+        case '{':
+        case '[':
+            if (depth >= JSON_SCAN_MAX_DEPTH || count >= num) {
+                return OPRT_EXCEED_UPPER_LIMIT;
+            }
+            if ((depth == 0 && count > 0) ||
+                !json_scan_attach(toks, stack, depth, c == '{' ? JSON_TOK_OBJECT : JSON_TOK_ARRAY)) {
+                return OPRT_INVALID_PARM;
+            }
+            tok = &toks[count];
+            tok->type = (c == '{') ? JSON_TOK_OBJECT : JSON_TOK_ARRAY;
+            tok->cooked = 0;
+            tok->size = 0;
+            tok->start = pos;
+            tok->end = 0;
+            stack[depth].tok = count++;
+            stack[depth].key_next = TRUE;
+            depth++;
+            continue;
+
+        case '}':
+        case ']':
+            if (depth == 0) {
+                return OPRT_INVALID_PARM;
+            }
+            tok = &toks[stack[depth - 1].tok];
+            if (tok->type != ((c == '}') ? JSON_TOK_OBJECT : JSON_TOK_ARRAY) ||
+                (tok->type == JSON_TOK_OBJECT && !stack[depth - 1].key_next)) {
+                return OPRT_INVALID_PARM;
+            }
+            tok->end = pos + 1;
+            depth--;
+            continue;
+
+        case '"': {
+            size_t end = pos + 1;
+            while (end < len && js[end] != '"') {
+                end += (js[end] == '\\') ? 2 : 1;
+            }
+            if (end >= len) {
+                return OPRT_INVALID_PARM;
+            }
+            if (count >= num) {
+                return OPRT_EXCEED_UPPER_LIMIT;
+            }
+            if ((depth == 0 && count > 0) || !json_scan_attach(toks, stack, depth, JSON_TOK_STRING)) {
+                return OPRT_INVALID_PARM;
+            }
+            tok = &toks[count++];
+            tok->type = JSON_TOK_STRING;
+            tok->cooked = 0;
+            tok->size = 0;
+            tok->start = pos + 1;
+            tok->end = end;
+            pos = end;
+            continue;
+        }
+
+        default: {
+            if (!(c == '-' || (c >= '0' && c <= '9') || c == 't' || c == 'f' || c == 'n')) {
+                return OPRT_INVALID_PARM;
+            }
+            size_t end = pos + 1;
+            while (end < len && NULL == strchr(" \t\r\n,:]}", js[end])) {
+                end++;
+            }
+            if (count >= num) {
+                return OPRT_EXCEED_UPPER_LIMIT;
+            }
+            if ((depth == 0 && count > 0) || !json_scan_attach(toks, stack, depth, JSON_TOK_PRIMITIVE)) {
+                return OPRT_INVALID_PARM;
+            }
+            tok = &toks[count++];
+            tok->type = JSON_TOK_PRIMITIVE;
+            tok->cooked = 0;
+            tok->size = 0;
+            tok->start = pos;
+            tok->end = end;
+            pos = end - 1;
+            continue;
+        }
+        }
+    }
+
+    if (depth != 0 || count == 0) {
+        return OPRT_INVALID_PARM;
+    }
+    return count;
+}
+
+int json_scan_skip(const json_tok_t *toks, int num, int index)
+{
+    int next = index + 1;
+
+    if (toks[index].type == JSON_TOK_OBJECT || toks[index].type == JSON_TOK_ARRAY) {
+        while (next < num && toks[next].start < toks[index].end) {
+            next++;
+        }
+    }
+    return next;
+}
+
+int json_scan_find(const char *js, const json_tok_t *toks, int num, int obj, const char *key)
+{
+    if (obj < 0 || obj >= num || toks[obj].type != JSON_TOK_OBJECT) {
+        return -1;
+    }
+
+    int index = obj + 1;
+    for (uint16_t i = 0; i < toks[obj].size && index + 1 < num; i++) {
+        if (json_scan_eq(js, &toks[index], key)) {
+            return index + 1;
+        }
+        index = json_scan_skip(toks, num, index + 1);
+    }
+    return -1;
+}
+
+bool json_scan_eq(const char *js, const json_tok_t *tok, const char *str)
+{
+    if (tok->type != JSON_TOK_STRING) {
+        return FALSE;
+    }
+    if (tok->cooked) {
+        return 0 == strcmp(js + tok->start, str);
+    }
+
+    size_t len = tok->end - tok->start;
+    return strlen(str) == len && 0 == memcmp(js + tok->start, str, len);
+}
+
+int json_scan_int(const char *js, const json_tok_t *tok)
+{
+    char c = js[tok->start];
+
+    if (tok->type != JSON_TOK_PRIMITIVE || !(c == '-' || (c >= '0' && c <= '9'))) {
+        return 0;
+    }
+
+    /* the number is followed by a delimiter, which stops strtod */
+    double number = strtod(js + tok->start, NULL);
+    if (number >= INT_MAX) {
+        return INT_MAX;
+    } else if (number <= (double)INT_MIN) {
+        return INT_MIN;
+    }
+    return (int)number;
+}
+
+char *json_scan_str(char *js, json_tok_t *tok)
+{
+    if (tok->type != JSON_TOK_STRING) {
+        return NULL;
+    }
+    if (tok->cooked) {
+        return js + tok->start;
+    }
+
+    char *in = js + tok->start;
+    char *end = js + tok->end;
+    char *out = in;
+    while (in < end) {
+        if (*in != '\\' || in + 1 >= end) {
+            *out++ = *in++;
+            continue;
+        }
+
+        in++;
+        switch (*in) {
+        case 'b':
+            *out++ = '\b';
+            break;
+        case 'f':
+            *out++ = '\f';
+            break;
+        case 'n':
+            *out++ = '\n';
+            break;
+        case 'r':
+            *out++ = '\r';
+            break;
+        case 't':
+            *out++ = '\t';
+            break;
+        case 'u': {
+            int code = (in + 4 < end) ? hex4(in + 1) : -1;
+            if (code < 0) {
+                *out++ = *in;
+                break;
+            }
+            in += 4;
+            /* surrogate pair */
+            if (code >= 0xD800 && code <= 0xDBFF && in + 6 < end && in[1] == '\\' && in[2] == 'u') {
+                int low = hex4(in + 3);
+                if (low >= 0xDC00 && low <= 0xDFFF) {
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    in += 6;
+                }
+            }
+            /* UTF-8 is never longer than the escape it replaces */
+            if (code < 0x80) {
+                *out++ = code;
+            } else if (code < 0x800) {
+                *out++ = 0xC0 | (code >> 6);
+                *out++ = 0x80 | (code & 0x3F);
+            } else if (code < 0x10000) {
+                *out++ = 0xE0 | (code >> 12);
+                *out++ = 0x80 | ((code >> 6) & 0x3F);
+                *out++ = 0x80 | (code & 0x3F);
+            } else {
+                *out++ = 0xF0 | (code >> 18);
+                *out++ = 0x80 | ((code >> 12) & 0x3F);
+                *out++ = 0x80 | ((code >> 6) & 0x3F);
+                *out++ = 0x80 | (code & 0x3F);
+            }
+            break;
+        }
+        default: /* '"', '\\', '/' */
+            *out++ = *in;
+            break;
+        }
+        in++;
+    }
+    *out = '\0';
+    tok->cooked = 1;
+    return js + tok->start;
+}
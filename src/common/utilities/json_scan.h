@@ -0,0 +1,116 @@
+/**
+ * @file json_scan.h
+ * @brief Single pass JSON tokenizer working in a caller supplied token arena.
+ *
+ * The scanner splits a JSON text into a flat, pre-ordered array of tokens
+ * that index into the original buffer, so reading a few members does not
+ * build a cJSON tree or allocate. Objects and arrays record their member
+ * count and cover all tokens of their subtree. Strings are not unescaped
+ * until json_scan_str() cooks them in place.
+ *
+ * @copyright Copyright (c) 2021-2024 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#ifndef _JSON_SCAN_H
+#define _JSON_SCAN_H
+
+#include "tuya_cloud_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define JSON_SCAN_MAX_DEPTH 16
+
+typedef uint8_t json_tok_type_t;
+#define JSON_TOK_OBJECT    1
+#define JSON_TOK_ARRAY     2
+#define JSON_TOK_STRING    3
+#define JSON_TOK_PRIMITIVE 4 /* number, true, false or null */
+
+typedef struct {
+    json_tok_type_t type;
+    /** string was unescaped and NUL terminated by json_scan_str() */
+    uint8_t cooked;
+    /** members of an object, elements of an array */
+    uint16_t size;
+    /** string tokens exclude the quotes, containers include the brackets */
+    uint16_t start;
+    uint16_t end;
+} json_tok_t;
+
+/**
+ * @brief tokenize a JSON text
+ *
+ * @param[in] js the JSON text, need not be NUL terminated
+ * @param[in] len the length of js, at most 65535
+ * @param[out] toks the token arena
+ * @param[in] num the number of tokens in the arena
+ *
+ * @return the number of tokens on success, OPRT_EXCEED_UPPER_LIMIT when the
+ * arena or nesting limit is too small, OPRT_INVALID_PARM on malformed input
+ */
+int json_scan(const char *js, size_t len, json_tok_t *toks, uint16_t num);
+
+/**
+ * @brief get the index of the token following a token and its subtree
+ *
+ * @param[in] toks the tokens
+ * @param[in] num the number of tokens
+ * @param[in] index the token
+ *
+ * @return the next sibling index, num at the end
+ */
+int json_scan_skip(const json_tok_t *toks, int num, int index);
+
+/**
+ * @brief find a member value in an object token
+ *
+ * @param[in] js the JSON text
+ * @param[in] toks the tokens
+ * @param[in] num the number of tokens
+ * @param[in] obj the object token index
+ * @param[in] key the member name
+ *
+ * @return the value token index, -1 if obj is no object or has no such key
+ */
+int json_scan_find(const char *js, const json_tok_t *toks, int num, int obj, const char *key);
+
+/**
+ * @brief compare a string token with a C string
+ *
+ * @param[in] js the JSON text
+ * @param[in] tok the token
+ * @param[in] str the C string
+ *
+ * @return TRUE if equal
+ */
+bool json_scan_eq(const char *js, const json_tok_t *tok, const char *str);
+
+/**
+ * @brief read a primitive token as an integer, with cJSON valueint semantics
+ *
+ * @param[in] js the JSON text
+ * @param[in] tok the token
+ *
+ * @return the value, 0 if the token is no number
+ */
+int json_scan_int(const char *js, const json_tok_t *tok);
+
+/**
+ * @brief unescape a string token in place and NUL terminate it
+ *
+ * The closing quote is overwritten, so cook tokens only after scanning.
+ *
+ * @param[in] js the JSON text, writable
+ * @param[in] tok the string token
+ *
+ * @return the C string inside js, NULL if tok is no string
+ */
+char *json_scan_str(char *js, json_tok_t *tok);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
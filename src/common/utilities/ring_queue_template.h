@@ -0,0 +1,171 @@
+/**
+ * @file ring_queue_template.h
+ * @brief Lock-free bounded ring queues of fixed size items, header only.
+ *
+ * The queues pass items, usually pointers, between threads without a lock and
+ * without the copy and the kernel round trip of an OS queue. Like the lists of
+ * queue_template.h they are macros: RING_QUEUE_SPSC_DEFINE() and
+ * RING_QUEUE_MPSC_DEFINE() declare a queue type and its static inline
+ * functions for one item type and a power of two capacity.
+ *
+ * - SPSC: one producer thread and one consumer thread.
+ * - MPSC: any number of producer threads or ISRs and one consumer thread.
+ *
+ * Neither blocks: push fails when the queue is full and pop when it is empty,
+ * so the consumer pairs the queue with its own wakeup (a semaphore posted when
+ * push finds the queue was empty, or a poll in an existing loop). The producer
+ * and consumer indexes sit on separate cache lines so the two sides do not
+ * bounce a line between cores.
+ *
+ * Example:
+ *     RING_QUEUE_SPSC_DEFINE(frame_q, FRAME_T *, 16)
+ *     static frame_q_t s_frames;
+ *     frame_q_init(&s_frames);
+ *     frame_q_push(&s_frames, frame);          // producer
+ *     while (frame_q_pop(&s_frames, &frame))  // consumer
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#ifndef __RING_QUEUE_TEMPLATE_H__
+#define __RING_QUEUE_TEMPLATE_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Alignment keeping the producer and the consumer side apart, 0 packs the
+// queue tight on cacheless MCUs where RAM matters more
+#ifndef RING_QUEUE_CACHE_LINE
+#define RING_QUEUE_CACHE_LINE 32
+#endif
+
+#if RING_QUEUE_CACHE_LINE > 0
+#define RING_QUEUE_ALIGNED __attribute__((aligned(RING_QUEUE_CACHE_LINE)))
+#else
+#define RING_QUEUE_ALIGNED
+#endif
+
+#define RING_QUEUE_LOAD(ptr)         __atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+#define RING_QUEUE_LOAD_RELAXED(ptr) __atomic_load_n(ptr, __ATOMIC_RELAXED)
+#define RING_QUEUE_STORE(ptr, val)   __atomic_store_n(ptr, val, __ATOMIC_RELEASE)
+
+#define RING_QUEUE_SIZE_CHECK(name, size)                                                                             \
+    typedef char name##_size_must_be_power_of_two[(((size) & ((size)-1)) == 0 && (size) > 0) ? 1 : -1]
+
+/*
+ * Single producer, single consumer queue.
+ *
+ * head is only stored by the consumer and tail only by the producer, each
+ * after the slot it covers is read or written. Indexes run freely and wrap
+ * at 2^32, the slot is the index modulo size.
+ */
+#define RING_QUEUE_SPSC_DEFINE(name, type, size)                                                                      \
+    RING_QUEUE_SIZE_CHECK(name, size);                                                                                 \
+    typedef struct {                                                                                                   \
+        uint32_t head RING_QUEUE_ALIGNED; /* next slot to pop */                                                       \
+        uint32_t tail RING_QUEUE_ALIGNED; /* next slot to push */                                                      \
+        type slot[size] RING_QUEUE_ALIGNED;                                                                            \
+    } name##_t;                                                                                                        \
+                                                                                                                       \
+    static inline void name##_init(name##_t *q)                                                                        \
+    {                                                                                                                  \
+        RING_QUEUE_STORE(&q->head, 0);                                                                                 \
+        RING_QUEUE_STORE(&q->tail, 0);                                                                                 \
+    }                                                                                                                  \
+                                                                                                                       \
+    static inline bool name##_push(name##_t *q, type item)                                                             \
+    {                                                                                                                  \
+        uint32_t tail = RING_QUEUE_LOAD_RELAXED(&q->tail);                                                             \
+        if (tail - RING_QUEUE_LOAD(&q->head) >= (size)) {                                                              \
+            return false;                                                                                              \
+        }                                                                                                              \
+        q->slot[tail & ((size)-1)] = item;                                                                             \
+        RING_QUEUE_STORE(&q->tail, tail + 1);                                                                          \
+        return true;                                                                                                   \
+    }                                                                                                                  \
+                                                                                                                       \
+    static inline bool name##_pop(name##_t *q, type *item)                                                             \
+    {                                                                                                                  \
+        uint32_t head = RING_QUEUE_LOAD_RELAXED(&q->head);                                                             \
+        if (head == RING_QUEUE_LOAD(&q->tail)) {                                                                       \
+            return false;                                                                                              \
+        }                                                                                                              \
+        *item = q->slot[head & ((size)-1)];                                                                            \
+        RING_QUEUE_STORE(&q->head, head + 1);                                                                          \
+        return true;                                                                                                   \
+    }                                                                                                                  \
+                                                                                                                       \
+    static inline uint32_t name##_count(name##_t *q)                                                                   \
+    {                                                                                                                  \
+        return RING_QUEUE_LOAD(&q->tail) - RING_QUEUE_LOAD(&q->head);                                                  \
+    }
+
+/*
+ * Multiple producer, single consumer queue.
+ *
+ * Producers claim a slot by a compare and swap on tail, then publish it by
+ * storing its sequence number; the consumer takes slots in order once they are
+ * published. A slot is free for index i when its sequence is i, holds the item
+ * of index i when it is i + 1, and is free again for i + size once popped.
+ */
+#define RING_QUEUE_MPSC_DEFINE(name, type, size)                                                                      \
+    RING_QUEUE_SIZE_CHECK(name, size);                                                                                 \
+    typedef struct {                                                                                                   \
+        uint32_t head RING_QUEUE_ALIGNED; /* next slot to pop */                                                       \
+        uint32_t tail RING_QUEUE_ALIGNED; /* next slot to claim */                                                     \
+        struct {                                                                                                       \
+            uint32_t seq;                                                                                              \
+            type item;                                                                                                 \
+        } slot[size] RING_QUEUE_ALIGNED;                                                                               \
+    } name##_t;                                                                                                        \
+                                                                                                                       \
+    static inline void name##_init(name##_t *q)                                                                        \
+    {                                                                                                                  \
+        for (uint32_t i = 0; i < (size); i++) {                                                                        \
+            RING_QUEUE_STORE(&q->slot[i].seq, i);                                                                      \
+        }                                                                                                              \
+        RING_QUEUE_STORE(&q->head, 0);                                                                                 \
+        RING_QUEUE_STORE(&q->tail, 0);                                                                                 \
+    }                                                                                                                  \
+                                                                                                                       \
+    static inline bool name##_push(name##_t *q, type item)                                                             \
+    {                                                                                                                  \
+        uint32_t tail = RING_QUEUE_LOAD_RELAXED(&q->tail);                                                             \
+        for (;;) {                                                                                                     \
+            uint32_t seq = RING_QUEUE_LOAD(&q->slot[tail & ((size)-1)].seq);                                           \
+            int32_t diff = (int32_t)(seq - tail);                                                                      \
+            if (diff < 0) {                                                                                            \
+                return false; /* the consumer has not freed the slot yet: full */                                      \
+            }                                                                                                          \
+            if (diff > 0) {                                                                                            \
+                tail = RING_QUEUE_LOAD_RELAXED(&q->tail); /* another producer took it */                               \
+                continue;                                                                                              \
+            }                                                                                                          \
+            if (__atomic_compare_exchange_n(&q->tail, &tail, tail + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {    \
+                break;                                                                                                 \
+            }                                                                                                          \
+        }                                                                                                              \
+        q->slot[tail & ((size)-1)].item = item;                                                                        \
+        RING_QUEUE_STORE(&q->slot[tail & ((size)-1)].seq, tail + 1);                                                   \
+        return true;                                                                                                   \
+    }                                                                                                                  \
+                                                                                                                       \
+    static inline bool name##_pop(name##_t *q, type *item)                                                             \
+    {                                                                                                                  \
+        uint32_t head = RING_QUEUE_LOAD_RELAXED(&q->head);                                                             \
+        if (RING_QUEUE_LOAD(&q->slot[head & ((size)-1)].seq) != head + 1) {                                            \
+            return false; /* empty, or the next producer is still writing */                                           \
+        }                                                                                                              \
+        *item = q->slot[head & ((size)-1)].item;                                                                       \
+        RING_QUEUE_STORE(&q->slot[head & ((size)-1)].seq, head + (size));                                              \
+        RING_QUEUE_STORE(&q->head, head + 1);                                                                          \
+        return true;                                                                                                   \
+    }                                                                                                                  \
+                                                                                                                       \
+    static inline uint32_t name##_count(name##_t *q)                                                                   \
+    {                                                                                                                  \
+        return RING_QUEUE_LOAD(&q->tail) - RING_QUEUE_LOAD(&q->head);                                                  \
+    }
+
+#endif // __RING_QUEUE_TEMPLATE_H__
@@ -60,8 +60,28 @@ typedef struct http_client_response {
     uint16_t status_code;
 } http_client_response_t;
 
+/**
+ * @brief Set up the keep-alive connection pool
+ *
+ * Call once at startup, before the first http_client_request(). Without it
+ * every request opens and closes its own connection.
+ *
+ * @return OPRT_OK on success, or an error code on failure.
+ */
+OPERATE_RET http_client_init(void);
+
 http_client_status_t http_client_request(const http_client_request_t *request, http_client_response_t *response);
 
 int http_client_free(http_client_response_t *response);
 
+/**
+ * @brief Close the idle keep-alive connections
+ *
+ * http_client_request() keeps the connection of a completed request for the
+ * next request to the same host, port and scheme. Idle connections close by
+ * themselves after HTTP_CLIENT_POOL_IDLE_MS, call this to release them now,
+ * e.g. before a memory hungry operation or when the network changes.
+ */
+void http_client_pool_flush(void);
+
 #endif /* ifndef HTTP_CLIENT_INTERFACE_H */
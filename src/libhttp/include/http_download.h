@@ -37,8 +37,23 @@ typedef struct {
     size_t file_size;
     void *user_data;
     http_download_event_cb_t event_handler;
+    /**
+     * Buffers between the network and the event handler, at most
+     * HTTP_DOWNLOAD_PIPELINE_MAX. With 2 or more, DL_EVENT_ON_FILESIZE and
+     * later events run on a writer thread while the next range is read, so
+     * a slow flash write no longer stalls the socket. 0 or 1 reads and
+     * handles each range in turn on the calling thread.
+     */
+    uint8_t pipeline_depth;
+    /**
+     * Byte to start the download at, to resume an interrupted one. Needs
+     * file_size; the first DL_EVENT_ON_DATA has this offset.
+     */
+    size_t start_offset;
 } http_download_config_t;
 
+#define HTTP_DOWNLOAD_PIPELINE_MAX (3)
+
 int http_file_download(http_download_config_t *config);
 
 #ifdef __cplusplus
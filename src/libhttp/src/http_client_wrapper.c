@@ -3,7 +3,7 @@
 #include "transport_interface.h"
 #include "core_http_client.h"
 #include "tuya_tls.h"
-#include "tal_log.h"
+#include "tal_api.h"
 
 #define log_debug PR_DEBUG
 #define log_error PR_ERR
@@ -11,6 +11,287 @@
 #define HEADER_BUFFER_LENGTH (255)
 #define DEFAULT_HTTP_PORT    (80)
 #define DEFAULT_HTTPS_PORT   (443)
+
+/* Keep-alive connections kept between requests, 0 disables the pool. Each
+ * idle TLS connection holds its mbedTLS record buffers, so keep this small. */
+#ifndef HTTP_CLIENT_POOL_NUM
+#define HTTP_CLIENT_POOL_NUM (1)
+#endif
+
+/* Idle connections are closed after this long */
+#ifndef HTTP_CLIENT_POOL_IDLE_MS
+#define HTTP_CLIENT_POOL_IDLE_MS (15 * 1000)
+#endif
+
+#define HTTP_CLIENT_POOL_HOST_LEN (64)
+
+/* mbedtls_ssl_read() results for a server that closed the connection */
+#define HTTP_TLS_ERR_PEER_CLOSE_NOTIFY (-0x7880)
+#define HTTP_TLS_ERR_CONN_EOF          (-0x7280)
+
+/* Transport of one request. network stays the first member, the coreHTTP
+ * context pointer is used as a NetworkContext_t pointer as well. */
+typedef struct {
+    NetworkContext_t network;
+    bool send_failed; /* a write failed, see http_request_retryable() */
+    bool eof;         /* the server closed the connection */
+    size_t received;  /* response bytes read */
+} http_request_transport_t;
+
+typedef struct {
+    NetworkContext_t network; /* NULL when the slot is free */
+    char host[HTTP_CLIENT_POOL_HOST_LEN];
+    uint16_t port;
+    bool tls;
+    SYS_TIME_T idle_since;
+} http_pool_conn_t;
+
+#if (HTTP_CLIENT_POOL_NUM > 0)
+static http_pool_conn_t s_pool[HTTP_CLIENT_POOL_NUM];
+static MUTEX_HANDLE s_pool_mutex = NULL;
+static DELAYED_WORK_HANDLE s_pool_evict_work = NULL;
+#endif
+
+static void http_conn_close(NetworkContext_t network)
+{
+    tuya_transporter_close(network);
+    tuya_transporter_destroy(network);
+}
+
+static NetworkContext_t http_conn_open(const http_client_request_t *request, bool tls, uint16_t port)
+{
+    int ret = OPRT_OK;
+    NetworkContext_t network = tuya_transporter_create(tls ? TRANSPORT_TYPE_TLS : TRANSPORT_TYPE_TCP, NULL);
+    if (NULL == network) {
+        return NULL;
+    }
+
+    if (tls) {
+        tuya_tls_config_t tls_config = {
+            .ca_cert = (char *)request->cacert,
+            .ca_cert_size = request->cacert_len,
+            .hostname = (char *)request->host,
+            .port = port,
+            .timeout = request->timeout_ms,
+            .mode = TUYA_TLS_SERVER_CERT_MODE,
+            .verify = true,
+        };
+
+        ret = tuya_transporter_ctrl(network, TUYA_TRANSPORTER_SET_TLS_CONFIG, &tls_config);
+        if (OPRT_OK != ret) {
+            log_error("network_tls_init fail:%d", ret);
+            tuya_transporter_destroy(network);
+            return NULL;
+        }
+    }
+
+    ret = tuya_transporter_connect(network, request->host, port, request->timeout_ms);
+    if (OPRT_OK != ret) {
+        http_conn_close(network);
+        return NULL;
+    }
+
+    if (tls) {
+        log_debug("tls connencted!");
+    }
+    return network;
+}
+
+#if (HTTP_CLIENT_POOL_NUM > 0)
+/* false before http_client_init(), the pool is then not used */
+static bool http_pool_lock(void)
+{
+    if (s_pool_mutex == NULL) {
+        return false;
+    }
+    tal_mutex_lock(s_pool_mutex);
+    return true;
+}
+
+static void http_pool_evict_cb(void *data)
+{
+    NetworkContext_t expired[HTTP_CLIENT_POOL_NUM];
+    int expired_num = 0;
+    bool idle_left = false;
+
+    (void)data;
+
+    if (!http_pool_lock()) {
+        return;
+    }
+    SYS_TIME_T now = tal_system_get_millisecond();
+    for (int i = 0; i < HTTP_CLIENT_POOL_NUM; i++) {
+        if (s_pool[i].network == NULL) {
+            continue;
+        }
+        if (now - s_pool[i].idle_since >= HTTP_CLIENT_POOL_IDLE_MS) {
+            expired[expired_num++] = s_pool[i].network;
+            s_pool[i].network = NULL;
+        } else {
+            idle_left = true;
+        }
+    }
+    if (idle_left) {
+        tal_workq_start_delayed(s_pool_evict_work, HTTP_CLIENT_POOL_IDLE_MS, LOOP_ONCE);
+    }
+    tal_mutex_unlock(s_pool_mutex);
+
+    for (int i = 0; i < expired_num; i++) {
+        log_debug("http keep-alive connection idle, closed");
+        http_conn_close(expired[i]);
+    }
+}
+
+/* Take an idle connection to the server out of the pool, NULL if none */
+static NetworkContext_t http_pool_take(const char *host, uint16_t port, bool tls)
+{
+    NetworkContext_t network = NULL;
+
+    if (!http_pool_lock()) {
+        return NULL;
+    }
+    for (int i = 0; i < HTTP_CLIENT_POOL_NUM; i++) {
+        http_pool_conn_t *conn = &s_pool[i];
+        if (conn->network && conn->port == port && conn->tls == tls && 0 == strcmp(conn->host, host)) {
+            network = conn->network;
+            conn->network = NULL;
+            break;
+        }
+    }
+    tal_mutex_unlock(s_pool_mutex);
+
+    /* an idle connection has nothing to read unless the server closed it */
+    if (network && 0 != tuya_transporter_poll_read(network, 1)) {
+        log_debug("http keep-alive connection closed by server");
+        http_conn_close(network);
+        network = NULL;
+    }
+    return network;
+}
+
+/* Keep a connection for the next request to the server */
+static void http_pool_put(NetworkContext_t network, const char *host, uint16_t port, bool tls)
+{
+    NetworkContext_t evicted = NULL;
+
+    if (strlen(host) >= HTTP_CLIENT_POOL_HOST_LEN || !http_pool_lock()) {
+        http_conn_close(network);
+        return;
+    }
+
+    /* a free slot, else the one idle the longest */
+    http_pool_conn_t *slot = &s_pool[0];
+    for (int i = 0; i < HTTP_CLIENT_POOL_NUM && slot->network; i++) {
+        if (s_pool[i].network == NULL || s_pool[i].idle_since < slot->idle_since) {
+            slot = &s_pool[i];
+        }
+    }
+    evicted = slot->network;
+
+    slot->network = network;
+    strcpy(slot->host, host);
+    slot->port = port;
+    slot->tls = tls;
+    slot->idle_since = tal_system_get_millisecond();
+
+    if (s_pool_evict_work == NULL) {
+        tal_workq_init_delayed(WORKQ_SYSTEM, http_pool_evict_cb, NULL, &s_pool_evict_work);
+    }
+    if (s_pool_evict_work) {
+        tal_workq_start_delayed(s_pool_evict_work, HTTP_CLIENT_POOL_IDLE_MS, LOOP_ONCE);
+    }
+    tal_mutex_unlock(s_pool_mutex);
+
+    if (evicted) {
+        http_conn_close(evicted);
+    }
+}
+#else
+#define http_pool_take(host, port, tls) NULL
+#define http_pool_put(network, host, port, tls) http_conn_close(network)
+#endif
+
+OPERATE_RET http_client_init(void)
+{
+#if (HTTP_CLIENT_POOL_NUM > 0)
+    if (s_pool_mutex) {
+        return OPRT_OK;
+    }
+    return tal_mutex_create_init(&s_pool_mutex);
+#else
+    return OPRT_OK;
+#endif
+}
+
+void http_client_pool_flush(void)
+{
+#if (HTTP_CLIENT_POOL_NUM > 0)
+    NetworkContext_t idle[HTTP_CLIENT_POOL_NUM];
+    int idle_num = 0;
+
+    if (!http_pool_lock()) {
+        return;
+    }
+    for (int i = 0; i < HTTP_CLIENT_POOL_NUM; i++) {
+        if (s_pool[i].network) {
+            idle[idle_num++] = s_pool[i].network;
+            s_pool[i].network = NULL;
+        }
+    }
+    tal_mutex_unlock(s_pool_mutex);
+
+    for (int i = 0; i < idle_num; i++) {
+        http_conn_close(idle[i]);
+    }
+#endif
+}
+
+static int32_t http_transport_send(NetworkContext_t *context, const void *buf, size_t len)
+{
+    http_request_transport_t *transport = (http_request_transport_t *)context;
+
+    int32_t ret = NetworkTransportSend(&transport->network, buf, len);
+    if (ret < 0) {
+        transport->send_failed = true;
+    }
+    return ret;
+}
+
+static int32_t http_transport_recv(NetworkContext_t *context, void *buf, size_t len)
+{
+    http_request_transport_t *transport = (http_request_transport_t *)context;
+    tuya_tls_config_t *tls_config = NULL;
+
+    tuya_transporter_ctrl(transport->network, TUYA_TRANSPORTER_GET_TLS_CONFIG, &tls_config);
+    int timeout = tls_config ? tls_config->timeout : 5000;
+
+    /* unlike NetworkTransportRecv() keep a close apart from a read timeout */
+    int ret = tuya_transporter_read(transport->network, (uint8_t *)buf, len, timeout);
+    if (ret == OPRT_RESOURCE_NOT_READY) {
+        return 0;
+    }
+    if (ret == 0 || ret == HTTP_TLS_ERR_PEER_CLOSE_NOTIFY || ret == HTTP_TLS_ERR_CONN_EOF) {
+        transport->eof = true;
+        return 0;
+    }
+    if (ret > 0) {
+        transport->received += ret;
+    }
+    return ret;
+}
+
+/*
+ * A request that failed on a reused connection is sent again only when the
+ * server cannot have acted on it: the write failed, or the server closed the
+ * connection without a single response byte (it dropped the idle connection).
+ * A timeout or an error after the request went out may have been processed,
+ * replaying a POST then could repeat it.
+ */
+static bool http_request_retryable(const http_request_transport_t *transport)
+{
+    return transport->received == 0 && (transport->send_failed || transport->eof);
+}
+
 static http_client_status_t core_http_request_send(const TransportInterface_t *pTransportInterface,
                                                    const HTTPRequestInfo_t *requestInfo, http_client_header_t *headers,
                                                    uint8_t headers_count, const uint8_t *pRequestBodyBuf,
@@ -77,54 +358,25 @@ static http_client_status_t core_http_request_send(const TransportInterface_t *p
 http_client_status_t http_client_request(const http_client_request_t *request, http_client_response_t *response)
 {
     http_client_status_t rt = HTTP_CLIENT_SUCCESS;
-    int ret = OPRT_OK;
 
-    /* TLS pre init */
-    NetworkContext_t network;
-    TUYA_TRANSPORT_TYPE_E transport_type = (request->cacert == NULL) ? TRANSPORT_TYPE_TCP : TRANSPORT_TYPE_TLS;
-    network = tuya_transporter_create(transport_type, NULL);
-    if (NULL == network) {
-        return HTTP_CLIENT_MALLOC_FAULT;
-    }
-
-    if (transport_type == TRANSPORT_TYPE_TLS) {
-        tuya_tls_config_t tls_config = {
-            .ca_cert = (char *)request->cacert,
-            .ca_cert_size = request->cacert_len,
-            .hostname = (char *)request->host,
-            .port = (request->port == 0) ? DEFAULT_HTTPS_PORT : request->port,
-            .timeout = request->timeout_ms,
-            .mode = TUYA_TLS_SERVER_CERT_MODE,
-            .verify = true,
-        };
-
-        ret = tuya_transporter_ctrl(network, TUYA_TRANSPORTER_SET_TLS_CONFIG, &tls_config);
-        if (OPRT_OK != ret) {
-            log_error("network_tls_init fail:%d", ret);
-            return ret;
-        }
+    bool tls = (request->cacert != NULL);
+    uint16_t port = request->port ? request->port : (tls ? DEFAULT_HTTPS_PORT : DEFAULT_HTTP_PORT);
 
-        ret = tuya_transporter_connect(network, tls_config.hostname, tls_config.port, tls_config.timeout);
-        if (OPRT_OK != ret) {
-            tuya_transporter_close(network);
-            tuya_transporter_destroy(network);
-            return HTTP_CLIENT_SEND_FAULT;
-        }
-
-        log_debug("tls connencted!");
-    } else {
-        ret = tuya_transporter_connect(network, request->host, (request->port == 0) ? DEFAULT_HTTP_PORT : request->port,
-                                       request->timeout_ms);
-        if (OPRT_OK != ret) {
-            tuya_transporter_close(network);
-            tuya_transporter_destroy(network);
+    /* reuse the keep-alive connection of the last request to this server */
+    http_request_transport_t transport = {0};
+    transport.network = http_pool_take(request->host, port, tls);
+    bool reused = (transport.network != NULL);
+    if (transport.network == NULL) {
+        transport.network = http_conn_open(request, tls, port);
+        if (NULL == transport.network) {
             return HTTP_CLIENT_SEND_FAULT;
         }
     }
+
     /* http client TransportInterface */
-    TransportInterface_t pTransportInterface = {.pNetworkContext = (NetworkContext_t *)&network,
-                                                .recv = (TransportRecv_t)NetworkTransportRecv,
-                                                .send = (TransportSend_t)NetworkTransportSend};
+    TransportInterface_t pTransportInterface = {.pNetworkContext = (NetworkContext_t *)&transport,
+                                                .recv = (TransportRecv_t)http_transport_recv,
+                                                .send = (TransportSend_t)http_transport_send};
 
     /* http client request object make */
     HTTPRequestInfo_t requestInfo = {
@@ -134,6 +386,7 @@ http_client_status_t http_client_request(const http_client_request_t *request, h
         .hostLen = strlen(request->host),
         .pPath = request->path,
         .pathLen = strlen(request->path),
+        .reqFlags = (HTTP_CLIENT_POOL_NUM > 0) ? HTTP_REQUEST_KEEP_ALIVE_FLAG : 0,
     };
 
     HTTPResponse_t http_response = {0};
@@ -144,9 +397,27 @@ http_client_status_t http_client_request(const http_client_request_t *request, h
                                 (const HTTPRequestInfo_t *)&requestInfo, request->headers, request->headers_count,
                                 (const uint8_t *)request->body, request->body_length, &http_response);
 
-    /* tls disconnect */
-    tuya_transporter_close(network);
-    tuya_transporter_destroy(network);
+    /* the server may drop an idle connection as it is reused, retry once on a new one */
+    if (HTTP_CLIENT_SUCCESS != rt && reused && http_request_retryable(&transport)) {
+        log_debug("http keep-alive connection dropped, request sent again");
+        http_conn_close(transport.network);
+        memset(&transport, 0, sizeof(transport));
+        transport.network = http_conn_open(request, tls, port);
+        if (NULL == transport.network) {
+            return HTTP_CLIENT_SEND_FAULT;
+        }
+        memset(&http_response, 0, sizeof(http_response));
+        rt = core_http_request_send((const TransportInterface_t *)&pTransportInterface,
+                                    (const HTTPRequestInfo_t *)&requestInfo, request->headers,
+                                    request->headers_count, (const uint8_t *)request->body, request->body_length,
+                                    &http_response);
+    }
+
+    if (HTTP_CLIENT_SUCCESS == rt && !(http_response.respFlags & HTTP_RESPONSE_CONNECTION_CLOSE_FLAG)) {
+        http_pool_put(transport.network, request->host, port, tls);
+    } else {
+        http_conn_close(transport.network);
+    }
 
     if (OPRT_OK != rt) {
         log_error("http_request_send error:%d", rt);
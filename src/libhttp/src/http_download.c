@@ -17,9 +17,28 @@ typedef enum {
     DL_STATE_COMPLETE,
 } http_download_state_t;
 
+/* Reader to writer message, the writer hands data slots back on free */
+typedef struct {
+    uint8_t id; /* http_download_event_id_t */
+    uint8_t slot;
+    size_t offset;
+    size_t len;
+} http_download_msg_t;
+
+typedef struct {
+    QUEUE_HANDLE full;
+    QUEUE_HANDLE free;
+    SEM_HANDLE done;
+    THREAD_HANDLE thread;
+    uint8_t *slots[HTTP_DOWNLOAD_PIPELINE_MAX];
+    size_t carry; /* remain_len the handler left, kept at the head of ctx->buffer */
+    bool failed;  /* set by the writer, the reader stops */
+} http_download_pipe_t;
+
 typedef struct {
     http_download_config_t config;
     http_download_event_t event;
+    http_download_pipe_t *pipe;
     TransportInterface_t transport;
     HTTPRequestHeaders_t requestHeaders;
     HTTPRequestInfo_t requestInfo;
@@ -69,6 +88,8 @@ typedef struct {
 //! timeout sec
 #define HTTP_DOWNLOAD_TIMEOUT 180
 
+#define HTTP_DOWNLOAD_WRITER_STACK (4096)
+
 /*-----------------------------------------------------------*/
 static int http_download_filesize_get(http_download_t *ctx)
 {
@@ -130,6 +151,150 @@ __exit:
     return rt;
 }
 
+/*-----------------------------------------------------------*/
+/* Writer side: hand one range to the event handler, stitching the bytes it
+ * left over from the previous range in front */
+static void http_download_pipe_write(http_download_t *ctx, const http_download_msg_t *msg)
+{
+    http_download_pipe_t *pipe = ctx->pipe;
+    uint8_t *data = pipe->slots[msg->slot];
+
+    if (pipe->failed) {
+        return;
+    }
+
+    if (pipe->carry) {
+        memcpy(ctx->buffer + pipe->carry, data, msg->len);
+        data = ctx->buffer;
+    }
+    ctx->event.data = data;
+    ctx->event.data_len = pipe->carry + msg->len;
+    ctx->event.offset = msg->offset - pipe->carry;
+    ctx->event.remain_len = pipe->carry;
+    ctx->config.event_handler(DL_EVENT_ON_DATA, &ctx->event);
+
+    /* the carry must still leave room for a whole range behind it */
+    if (ctx->event.remain_len > ctx->config.range_length) {
+        PR_ERR("download handler left %d bytes, more than a range", (int)ctx->event.remain_len);
+        pipe->failed = true;
+        return;
+    }
+    if (ctx->event.remain_len) {
+        memmove(ctx->buffer, data + (ctx->event.data_len - ctx->event.remain_len), ctx->event.remain_len);
+    }
+    pipe->carry = ctx->event.remain_len;
+}
+
+static void http_download_writer_task(void *arg)
+{
+    http_download_t *ctx = (http_download_t *)arg;
+    http_download_pipe_t *pipe = ctx->pipe;
+    http_download_msg_t msg;
+
+    for (;;) {
+        if (OPRT_OK != tal_queue_fetch(pipe->full, &msg, QUEUE_WAIT_FOREVER)) {
+            continue;
+        }
+        if (msg.id == DL_EVENT_ON_DATA) {
+            http_download_pipe_write(ctx, &msg);
+            tal_queue_post(pipe->free, &msg.slot, QUEUE_WAIT_FOREVER);
+            continue;
+        }
+        if (msg.id == DL_EVENT_ON_FILESIZE) {
+            ctx->event.file_size = msg.len;
+        } else if (msg.id == DL_EVENT_FINISH && pipe->failed) {
+            msg.id = DL_EVENT_FAULT;
+        }
+        ctx->config.event_handler(msg.id, &ctx->event);
+        if (msg.id == DL_EVENT_FINISH || msg.id == DL_EVENT_FAULT) {
+            break;
+        }
+    }
+    tal_semaphore_post(pipe->done);
+}
+
+static void http_download_pipe_free(http_download_t *ctx)
+{
+    http_download_pipe_t *pipe = ctx->pipe;
+
+    if (pipe == NULL) {
+        return;
+    }
+    if (pipe->full) {
+        tal_queue_free(pipe->full);
+    }
+    if (pipe->free) {
+        tal_queue_free(pipe->free);
+    }
+    if (pipe->done) {
+        tal_semaphore_release(pipe->done);
+    }
+    for (int i = 0; i < HTTP_DOWNLOAD_PIPELINE_MAX; i++) {
+        if (pipe->slots[i]) {
+            tal_free(pipe->slots[i]);
+        }
+    }
+    tal_free(pipe);
+    ctx->pipe = NULL;
+}
+
+static int http_download_pipe_init(http_download_t *ctx)
+{
+    int rt = OPRT_OK;
+    uint8_t depth = ctx->config.pipeline_depth;
+
+    if (depth > HTTP_DOWNLOAD_PIPELINE_MAX) {
+        depth = HTTP_DOWNLOAD_PIPELINE_MAX;
+    }
+
+    ctx->pipe = tal_calloc(1, sizeof(http_download_pipe_t));
+    TUYA_CHECK_NULL_RETURN(ctx->pipe, OPRT_MALLOC_FAILED);
+    http_download_pipe_t *pipe = ctx->pipe;
+
+    /* the carry plus a whole range are stitched in ctx->buffer */
+    tal_free(ctx->buffer);
+    ctx->buffer = tal_malloc(ctx->config.range_length * 2 + 1);
+    TUYA_CHECK_NULL_GOTO(ctx->buffer, __exit);
+
+    TUYA_CALL_ERR_GOTO(tal_queue_create_init(&pipe->full, sizeof(http_download_msg_t), depth + 2), __exit);
+    TUYA_CALL_ERR_GOTO(tal_queue_create_init(&pipe->free, sizeof(uint8_t), depth), __exit);
+    TUYA_CALL_ERR_GOTO(tal_semaphore_create_init(&pipe->done, 0, 1), __exit);
+    for (uint8_t i = 0; i < depth; i++) {
+        pipe->slots[i] = tal_malloc(ctx->config.range_length);
+        TUYA_CHECK_NULL_GOTO(pipe->slots[i], __exit);
+        tal_queue_post(pipe->free, &i, QUEUE_WAIT_FOREVER);
+    }
+
+    THREAD_CFG_T thrd_param = {
+        .priority = THREAD_PRIO_3,
+        .stackDepth = HTTP_DOWNLOAD_WRITER_STACK,
+        .thrdname = "http_dl_wr",
+    };
+    TUYA_CALL_ERR_GOTO(
+        tal_thread_create_and_start(&pipe->thread, NULL, NULL, http_download_writer_task, ctx, &thrd_param), __exit);
+    return OPRT_OK;
+
+__exit:
+    http_download_pipe_free(ctx);
+    return (rt == OPRT_OK) ? OPRT_MALLOC_FAILED : rt;
+}
+
+/* Pass an event to the writer thread, or to the handler directly without one */
+static void http_download_event_post(http_download_t *ctx, http_download_event_id_t id, size_t value)
+{
+    if (ctx->pipe) {
+        http_download_msg_t msg = {.id = id, .len = value};
+        tal_queue_post(ctx->pipe->full, &msg, QUEUE_WAIT_FOREVER);
+        return;
+    }
+    if (ctx->config.event_handler) {
+        if (id == DL_EVENT_ON_FILESIZE) {
+            ctx->event.file_size = value;
+        }
+        ctx->config.event_handler(id, &ctx->event);
+    }
+}
+
 /*-----------------------------------------------------------*/
 static int http_file_download_init(http_download_t *ctx, http_download_config_t *config)
 {
@@ -141,6 +306,9 @@ static int http_file_download_init(http_download_t *ctx, http_download_config_t
     memset(ctx, 0, sizeof(http_download_t));
     memcpy(&ctx->config, config, sizeof(http_download_config_t));
     ctx->file_size = ctx->config.file_size;
+    if (ctx->file_size && config->start_offset < ctx->file_size) {
+        ctx->received_size = config->start_offset;
+    }
     ctx->config.range_length = config->range_length;
     if (config->range_length == 0) {
         ctx->config.range_length = RANGE_REQUEST_LENGTH_DEFAULT;
@@ -244,6 +412,13 @@ int http_file_download(http_download_config_t *config)
         ctx->config.event_handler(DL_EVENT_START, &ctx->event);
     }
 
+    /* start the writer after DL_EVENT_START, it owns the handler from here */
+    if (ctx->config.event_handler && ctx->config.pipeline_depth > 1 && OPRT_OK != http_download_pipe_init(ctx)) {
+        PR_WARN("download pipeline init failed, reading in turn");
+        ctx->buffer = ctx->buffer ? ctx->buffer : tal_malloc(ctx->config.range_length + 1);
+        TUYA_CHECK_NULL_GOTO(ctx->buffer, __exit);
+    }
+
     do {
 
         switch (ctx->state) {
@@ -265,10 +440,7 @@ int http_file_download(http_download_config_t *config)
                 ctx->state = DL_STATE_NETWORK_RECONNECT;
                 break;
             }
-            if (ctx->config.event_handler) {
-                ctx->event.file_size = ctx->file_size;
-                ctx->config.event_handler(DL_EVENT_ON_FILESIZE, &ctx->event);
-            }
+            http_download_event_post(ctx, DL_EVENT_ON_FILESIZE, ctx->file_size);
             ctx->state = DL_STATE_RANGE_REQUEST;
             break;
 
@@ -281,6 +453,33 @@ int http_file_download(http_download_config_t *config)
             ctx->state = DL_STATE_DATE_GET;
 
         case DL_STATE_DATE_GET: {
+            if (ctx->pipe) {
+                uint8_t slot = 0;
+                if (ctx->pipe->failed) {
+                    download_time = 0;
+                    break;
+                }
+                /* waits while the writer is behind on every slot */
+                tal_queue_fetch(ctx->pipe->free, &slot, QUEUE_WAIT_FOREVER);
+                read_size = HTTPClient_Recv(&ctx->transport, &ctx->response, ctx->pipe->slots[slot],
+                                            ctx->config.range_length);
+                if (read_size <= 0) {
+                    tal_queue_post(ctx->pipe->free, &slot, QUEUE_WAIT_FOREVER);
+                    PR_WARN("file download range get error:%d, goto retry", read_size);
+                    ctx->state = DL_STATE_NETWORK_RECONNECT;
+                    break;
+                }
+                http_download_msg_t msg = {
+                    .id = DL_EVENT_ON_DATA, .slot = slot, .offset = ctx->received_size, .len = read_size};
+                tal_queue_post(ctx->pipe->full, &msg, QUEUE_WAIT_FOREVER);
+                ctx->received_size += read_size;
+                download_time = tal_time_get_posix();
+                if (ctx->received_size >= ctx->file_size) {
+                    ctx->state = DL_STATE_COMPLETE;
+                }
+                break;
+            }
+
             read_size = HTTPClient_Recv(&ctx->transport, &ctx->response, ctx->buffer + ctx->remain_len,
                                         ctx->config.range_length - ctx->remain_len);
 
@@ -320,9 +519,7 @@ int http_file_download(http_download_config_t *config)
         case DL_STATE_COMPLETE:
             PR_INFO("Download Complete!");
             is_completed = true;
-            if (ctx->config.event_handler) {
-                ctx->config.event_handler(DL_EVENT_FINISH, &ctx->event);
-            }
+            http_download_event_post(ctx, DL_EVENT_FINISH, 0);
             break;
         }
     } while (((tal_time_get_posix() - download_time) < HTTP_DOWNLOAD_TIMEOUT) && !is_completed);
@@ -331,9 +528,13 @@ int http_file_download(http_download_config_t *config)
     tuya_transporter_destroy(network);
 
     if (!is_completed) {
-        if (ctx->config.event_handler) {
-            ctx->config.event_handler(DL_EVENT_FAULT, &ctx->event);
-        }
+        http_download_event_post(ctx, DL_EVENT_FAULT, 0);
+    }
+
+    /* the writer drains the queued ranges and ends with FINISH or FAULT */
+    if (ctx->pipe) {
+        tal_semaphore_wait(ctx->pipe->done, SEM_WAIT_FOREVER);
+        http_download_pipe_free(ctx);
     }
 
 __exit:
@@ -350,6 +551,9 @@ __exit:
         if (ctx->response.pBuffer) {
             tal_free(ctx->response.pBuffer);
         }
+        if (ctx->buffer) {
+            tal_free(ctx->buffer);
+        }
 
         tal_free(ctx);
     }
@@ -129,7 +129,18 @@
      * > 1 requires an operating system enabled in `LV_USE_OS`
      * > 1 means multiply threads will render the screen in parallel */
 #if defined(ENABLE_LVGL_OS_FREERTOS) && (ENABLE_LVGL_OS_FREERTOS == 1)
-    #define LV_DRAW_SW_DRAW_UNIT_CNT    2
+    /* Draw threads rendering slices of a frame in parallel, one per core on
+     * ENABLE_SMP boards starting at LV_VENDOR_DRAW_CORE */
+    #ifndef LV_VENDOR_DRAW_UNIT_CNT
+    #define LV_VENDOR_DRAW_UNIT_CNT     2
+    #endif
+    #ifndef LV_VENDOR_DRAW_CORE
+    #define LV_VENDOR_DRAW_CORE         0
+    #endif
+    #ifndef LV_VENDOR_CORE_NUM
+    #define LV_VENDOR_CORE_NUM          2
+    #endif
+    #define LV_DRAW_SW_DRAW_UNIT_CNT    LV_VENDOR_DRAW_UNIT_CNT
 #else
     #define LV_DRAW_SW_DRAW_UNIT_CNT    1
 #endif
@@ -309,12 +320,26 @@
 /*Default cache size in bytes.
  *Used by image decoders such as `lv_lodepng` to keep the decoded image in the memory.
  *If size is not set to 0, the decoder will fail to decode when the cache is full.
- *If size is 0, the cache function is not enabled and the decoded mem will be released immediately after use.*/
-#define LV_CACHE_DEF_SIZE       0
+ *If size is 0, the cache function is not enabled and the decoded mem will be released immediately after use.
+ *With ENABLE_EXT_RAM the decoded images are kept in PSRAM, least recently used first out, the budget
+ *must hold the largest image shown at once. See lv_vendor_image_cache_stat().*/
+#ifndef LV_CACHE_DEF_SIZE
+    #if defined(ENABLE_EXT_RAM) && (ENABLE_EXT_RAM == 1)
+        #define LV_CACHE_DEF_SIZE   (1024 * 1024)
+    #else
+        #define LV_CACHE_DEF_SIZE   0
+    #endif
+#endif
 
 /*Default number of image header cache entries. The cache is used to store the headers of images
  *The main logic is like `LV_CACHE_DEF_SIZE` but for image headers.*/
-#define LV_IMAGE_HEADER_CACHE_DEF_CNT 0
+#ifndef LV_IMAGE_HEADER_CACHE_DEF_CNT
+    #if defined(ENABLE_EXT_RAM) && (ENABLE_EXT_RAM == 1)
+        #define LV_IMAGE_HEADER_CACHE_DEF_CNT 32
+    #else
+        #define LV_IMAGE_HEADER_CACHE_DEF_CNT 0
+    #endif
+#endif
 
 /*Number of stops allowed per gradient. Increase this to allow more stops.
  *This adds (sizeof(lv_color_t) + 1) bytes per additional stop*/
@@ -85,7 +85,9 @@ lv_result_t lv_thread_init(lv_thread_t * pxThread, lv_thread_prio_t xSchedPriori
     OPERATE_RET ret = OPRT_OK;
 
 #if defined(ENABLE_SMP) && (ENABLE_SMP == 1)
-        static uint32_t coreID = 0;
+        /* draw threads go round the cores from LV_VENDOR_DRAW_CORE */
+        static uint32_t threadCnt = 0;
+        uint32_t coreID = (LV_VENDOR_DRAW_CORE + threadCnt++) % LV_VENDOR_CORE_NUM;
         ret = tkl_thread_smp_create(&pxThread->xTaskHandle,
                                 coreID,
                                 pcTASK_NAME,
@@ -93,8 +95,6 @@ lv_result_t lv_thread_init(lv_thread_t * pxThread, lv_thread_prio_t xSchedPriori
                                 xSchedPriority,
                                 prvRunThread,
                                 (void *)pxThread);
-        if (coreID < (LV_DRAW_SW_DRAW_UNIT_CNT - 1))
-            coreID++;
 #else 
         ret = tkl_thread_create(&pxThread->xTaskHandle,
                                 pcTASK_NAME,
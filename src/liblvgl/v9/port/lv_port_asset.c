@@ -0,0 +1,273 @@
+/**
+ * @file lv_port_asset.c
+ *
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <string.h>
+#include "lv_port_asset.h"
+
+#include "tkl_flash.h"
+#include "tkl_memory.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef struct {
+    const LV_PORT_ASSET_ENTRY_T *entry;
+    uint32_t pos;
+} asset_file_t;
+
+typedef struct {
+    uint32_t addr; /* flash offset of the bundle */
+    uint32_t size;
+    uint16_t count;
+    const LV_PORT_ASSET_ENTRY_T *entry; /* in the XIP window, or a RAM copy without one */
+    lv_fs_drv_t drv;
+} asset_bundle_t;
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static asset_bundle_t s_bundle;
+
+/**********************
+ *      MACROS
+ **********************/
+#define ASSET_XIP(off) ((const uint8_t *)(uintptr_t)(LV_PORT_ASSET_XIP_BASE + s_bundle.addr + (off)))
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+static const LV_PORT_ASSET_ENTRY_T *asset_find(const char *name)
+{
+    if (name[0] == '/') {
+        name++;
+    }
+    for (uint16_t i = 0; i < s_bundle.count; i++) {
+        if (strncmp(s_bundle.entry[i].name, name, LV_PORT_ASSET_NAME_LEN) == 0) {
+            return &s_bundle.entry[i];
+        }
+    }
+    return NULL;
+}
+
+static OPERATE_RET asset_read(uint32_t off, void *buf, uint32_t len)
+{
+#if LV_PORT_ASSET_XIP_BASE
+    memcpy(buf, ASSET_XIP(off), len);
+    return OPRT_OK;
+#else
+    return tkl_flash_read(s_bundle.addr + off, buf, len);
+#endif
+}
+
+static void *asset_open_cb(lv_fs_drv_t *drv, const char *path, lv_fs_mode_t mode)
+{
+    LV_UNUSED(drv);
+
+    if (mode & LV_FS_MODE_WR) {
+        return NULL;
+    }
+
+    const LV_PORT_ASSET_ENTRY_T *entry = asset_find(path);
+    if (entry == NULL) {
+        return NULL;
+    }
+
+    asset_file_t *file = lv_malloc(sizeof(asset_file_t));
+    if (file == NULL) {
+        return NULL;
+    }
+    file->entry = entry;
+    file->pos = 0;
+
+    return file;
+}
+
+static lv_fs_res_t asset_close_cb(lv_fs_drv_t *drv, void *file_p)
+{
+    LV_UNUSED(drv);
+
+    lv_free(file_p);
+    return LV_FS_RES_OK;
+}
+
+static lv_fs_res_t asset_read_cb(lv_fs_drv_t *drv, void *file_p, void *buf, uint32_t btr, uint32_t *br)
+{
+    LV_UNUSED(drv);
+    asset_file_t *file = file_p;
+
+    uint32_t left = file->entry->size - file->pos;
+    if (btr > left) {
+        btr = left;
+    }
+    if (btr > 0 && asset_read(file->entry->offset + file->pos, buf, btr) != OPRT_OK) {
+        *br = 0;
+        return LV_FS_RES_HW_ERR;
+    }
+    file->pos += btr;
+    *br = btr;
+
+    return LV_FS_RES_OK;
+}
+
+static lv_fs_res_t asset_seek_cb(lv_fs_drv_t *drv, void *file_p, uint32_t pos, lv_fs_whence_t whence)
+{
+    LV_UNUSED(drv);
+    asset_file_t *file = file_p;
+
+    if (whence == LV_FS_SEEK_CUR) {
+        pos += file->pos;
+    } else if (whence == LV_FS_SEEK_END) {
+        pos += file->entry->size;
+    }
+    if (pos > file->entry->size) {
+        return LV_FS_RES_INV_PARAM;
+    }
+    file->pos = pos;
+
+    return LV_FS_RES_OK;
+}
+
+static lv_fs_res_t asset_tell_cb(lv_fs_drv_t *drv, void *file_p, uint32_t *pos_p)
+{
+    LV_UNUSED(drv);
+
+    *pos_p = ((asset_file_t *)file_p)->pos;
+    return LV_FS_RES_OK;
+}
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+OPERATE_RET lv_port_asset_init(void)
+{
+    TUYA_FLASH_BASE_INFO_T info;
+    LV_PORT_ASSET_HEAD_T head;
+
+    if (s_bundle.entry) {
+        return OPRT_OK;
+    }
+
+    memset(&info, 0, sizeof(info));
+    if (tkl_flash_get_one_type_info(LV_PORT_ASSET_FLASH_TYPE, &info) != OPRT_OK || info.partition_num == 0) {
+        LV_LOG_ERROR("%s no asset partition\n", __func__);
+        return OPRT_NOT_FOUND;
+    }
+    s_bundle.addr = info.partition[0].start_addr;
+    s_bundle.size = info.partition[0].size;
+
+    if (asset_read(0, &head, sizeof(head)) != OPRT_OK || head.magic != LV_PORT_ASSET_MAGIC ||
+        head.version != LV_PORT_ASSET_VERSION) {
+        LV_LOG_ERROR("%s no asset bundle at 0x%x\n", __func__, (unsigned)s_bundle.addr);
+        return OPRT_INVALID_PARM;
+    }
+
+    uint32_t table_len = head.count * sizeof(LV_PORT_ASSET_ENTRY_T);
+    if (sizeof(head) + table_len > s_bundle.size) {
+        LV_LOG_ERROR("%s asset table over the partition\n", __func__);
+        return OPRT_INVALID_PARM;
+    }
+
+#if LV_PORT_ASSET_XIP_BASE
+    const LV_PORT_ASSET_ENTRY_T *entry = (const LV_PORT_ASSET_ENTRY_T *)ASSET_XIP(sizeof(head));
+#else
+    LV_PORT_ASSET_ENTRY_T *entry = tkl_system_malloc(table_len);
+    if (entry == NULL) {
+        return OPRT_MALLOC_FAILED;
+    }
+    if (tkl_flash_read(s_bundle.addr + sizeof(head), (uint8_t *)entry, table_len) != OPRT_OK) {
+        tkl_system_free(entry);
+        return OPRT_COM_ERROR;
+    }
+#endif
+
+    for (uint16_t i = 0; i < head.count; i++) {
+        if (entry[i].offset > s_bundle.size || entry[i].size > s_bundle.size - entry[i].offset) {
+            LV_LOG_ERROR("%s asset %.*s over the partition\n", __func__, LV_PORT_ASSET_NAME_LEN, entry[i].name);
+#if !LV_PORT_ASSET_XIP_BASE
+            tkl_system_free(entry);
+#endif
+            return OPRT_INVALID_PARM;
+        }
+    }
+    s_bundle.count = head.count;
+    s_bundle.entry = entry;
+
+    lv_fs_drv_init(&s_bundle.drv);
+    s_bundle.drv.letter = LV_PORT_ASSET_LETTER;
+    s_bundle.drv.open_cb = asset_open_cb;
+    s_bundle.drv.close_cb = asset_close_cb;
+    s_bundle.drv.read_cb = asset_read_cb;
+    s_bundle.drv.seek_cb = asset_seek_cb;
+    s_bundle.drv.tell_cb = asset_tell_cb;
+    lv_fs_drv_register(&s_bundle.drv);
+
+    LV_LOG_INFO("%s %u assets at 0x%x\n", __func__, head.count, (unsigned)s_bundle.addr);
+    return OPRT_OK;
+}
+
+OPERATE_RET lv_port_asset_get(const char *name, const uint8_t **data, uint32_t *size)
+{
+#if LV_PORT_ASSET_XIP_BASE
+    if (name == NULL || data == NULL || size == NULL) {
+        return OPRT_INVALID_PARM;
+    }
+
+    const LV_PORT_ASSET_ENTRY_T *entry = s_bundle.entry ? asset_find(name) : NULL;
+    if (entry == NULL) {
+        return OPRT_NOT_FOUND;
+    }
+    *data = ASSET_XIP(entry->offset);
+    *size = entry->size;
+
+    return OPRT_OK;
+#else
+    LV_UNUSED(name);
+    LV_UNUSED(data);
+    LV_UNUSED(size);
+    return OPRT_NOT_SUPPORTED;
+#endif
+}
+
+OPERATE_RET lv_port_asset_image(const char *name, lv_image_dsc_t *dsc)
+{
+    const uint8_t *data = NULL;
+    uint32_t size = 0;
+
+    if (dsc == NULL) {
+        return OPRT_INVALID_PARM;
+    }
+
+    OPERATE_RET rt = lv_port_asset_get(name, &data, &size);
+    if (rt != OPRT_OK) {
+        return rt;
+    }
+
+    lv_memzero(dsc, sizeof(lv_image_dsc_t));
+    if (size >= sizeof(lv_image_header_t) && data[0] == LV_IMAGE_HEADER_MAGIC) {
+        /* LVGL binary image, the pixels follow the header */
+        memcpy(&dsc->header, data, sizeof(lv_image_header_t));
+        dsc->data = data + sizeof(lv_image_header_t);
+        dsc->data_size = size - sizeof(lv_image_header_t);
+    } else {
+        /* encoded data, such as a GIF, left to its decoder */
+        dsc->header.magic = LV_IMAGE_HEADER_MAGIC;
+        dsc->header.cf = LV_COLOR_FORMAT_RAW;
+        dsc->data = data;
+        dsc->data_size = size;
+    }
+
+    return OPRT_OK;
+}
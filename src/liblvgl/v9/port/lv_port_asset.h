@@ -0,0 +1,102 @@
+/**
+ * @file lv_port_asset.h
+ *
+ * Images, GIFs and fonts kept in a bundle in their own flash partition
+ * rather than in the firmware. Where the flash is memory mapped (XIP) an
+ * image descriptor points straight at the pixels in flash and LVGL decodes
+ * from there, no copy is made in RAM. The bundle is also a read only LVGL
+ * drive, "X:name", for the loaders that take a path such as lv_binfont_create().
+ *
+ * The bundle is made by tools/lvgl_asset/lv_asset_pack.py:
+ *
+ *     header  magic:4 ("LVAS") | version:2 | count:2
+ *     entry   name:24 | offset:4 | size:4, count times
+ *     data    each asset at a LV_PORT_ASSET_ALIGN boundary
+ *
+ * Offsets count from the start of the bundle, all fields are little endian.
+ * Images are LVGL v9 binary images (lv_image_header_t then the pixels), other
+ * assets such as GIF and font files are stored as they are.
+ */
+
+#ifndef LV_PORT_ASSET_H
+#define LV_PORT_ASSET_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "lvgl.h"
+#include "tuya_cloud_types.h"
+
+/* Flash partition holding the bundle */
+#ifndef LV_PORT_ASSET_FLASH_TYPE
+#define LV_PORT_ASSET_FLASH_TYPE TUYA_FLASH_TYPE_USER1
+#endif
+
+/* CPU address flash offset 0 is mapped at, 0 when the platform has no XIP
+ * window and assets are only read through the drive */
+#ifndef LV_PORT_ASSET_XIP_BASE
+#define LV_PORT_ASSET_XIP_BASE 0
+#endif
+
+/* Drive letter of the bundle */
+#ifndef LV_PORT_ASSET_LETTER
+#define LV_PORT_ASSET_LETTER 'X'
+#endif
+
+#define LV_PORT_ASSET_MAGIC    0x53414C56 /* "LVAS" */
+#define LV_PORT_ASSET_VERSION  1
+#define LV_PORT_ASSET_NAME_LEN 24
+#define LV_PORT_ASSET_ALIGN    4
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;
+} LV_PORT_ASSET_HEAD_T;
+
+typedef struct {
+    char name[LV_PORT_ASSET_NAME_LEN]; /* NUL terminated unless it fills the field */
+    uint32_t offset;
+    uint32_t size;
+} LV_PORT_ASSET_ENTRY_T;
+
+/**
+ * @brief Opens the bundle and registers its drive
+ *
+ * Call after lv_vendor_init().
+ *
+ * @return OPRT_OK on success, an error code if the partition holds no valid bundle
+ */
+OPERATE_RET lv_port_asset_init(void);
+
+/**
+ * @brief Finds an asset in the mapped flash
+ *
+ * @param name The asset name
+ * @param data Set to the asset in the XIP window
+ * @param size Set to the asset size
+ *
+ * @return OPRT_OK on success, OPRT_NOT_SUPPORTED without an XIP window,
+ * OPRT_NOT_FOUND if the bundle has no such asset
+ */
+OPERATE_RET lv_port_asset_get(const char *name, const uint8_t **data, uint32_t *size);
+
+/**
+ * @brief Fills an image descriptor pointing into the mapped flash
+ *
+ * The descriptor serves lv_image_set_src() for LVGL binary images and
+ * lv_gif_set_src() for GIF files. It must stay valid while it is displayed.
+ *
+ * @param name The asset name
+ * @param dsc The descriptor to fill
+ *
+ * @return OPRT_OK on success, an error code as lv_port_asset_get()
+ */
+OPERATE_RET lv_port_asset_image(const char *name, lv_image_dsc_t *dsc);
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*LV_PORT_ASSET_H*/
@@ -36,7 +36,12 @@
 #define LV_MEM_CUSTOM_REALLOC tkl_system_realloc
 #endif
 
-#define LV_DISP_FB_MAX_NUM    3
+#define LV_DISP_FB_MAX_NUM    4
+
+/* longest wait for the panel TE pulse before a frame is sent anyway */
+#ifndef LV_DISP_TE_TIMEOUT_MS
+#define LV_DISP_TE_TIMEOUT_MS 50
+#endif
 /**********************
  *      TYPEDEFS
  **********************/
@@ -55,6 +60,8 @@ static void disp_deinit(void);
 
 static void disp_flush(lv_display_t * disp, const lv_area_t * area, uint8_t * px_map);
 
+static void __disp_render_start_cb(lv_event_t *e);
+
 static uint8_t * __disp_draw_buf_align_alloc(uint32_t size_bytes);
 
 static lv_color_format_t __disp_get_lv_color_format(TUYA_DISPLAY_PIXEL_FMT_E pixel_fmt);
@@ -80,6 +87,16 @@ static TDL_DISP_FRAME_BUFF_T *sg_p_display_fb = NULL;
 
 static uint8_t *sg_rotate_buf = NULL;
 
+static TDL_DISP_RECT_T sg_disp_dirty_areas[TDL_DISP_FLUSH_AREA_MAX];
+static uint8_t sg_disp_dirty_num = 0;
+
+static bool sg_disp_te_sync = false;
+static uint32_t sg_frame_start_ms = 0;
+static uint32_t sg_frame_flush_ms = 0;
+static uint32_t sg_frame_wait_ms = 0;
+static DISP_FRAME_STAT_T sg_frame_stat;
+static uint32_t sg_frame_total_ms[3];
+
 /**********************
  *      MACROS
  **********************/
@@ -101,6 +118,7 @@ void lv_port_disp_init(char *device)
      * -----------------------------------*/
     lv_display_t * disp = lv_display_create(sg_display_info.width, sg_display_info.height);
     lv_display_set_flush_cb(disp, disp_flush);
+    lv_display_add_event_cb(disp, __disp_render_start_cb, LV_EVENT_RENDER_START, NULL);
 
     lv_color_format_t color_format = __disp_get_lv_color_format(sg_display_info.fmt);
     PR_NOTICE("lv_color_format:%d", color_format);
@@ -304,24 +322,62 @@ static void disp_frame_buff_free(TDL_DISP_FRAME_BUFF_T *frame_buff)
 
 static TDL_DISP_FRAME_BUFF_T *disp_get_free_frame_buff(void)
 {
-    for (uint8_t i = 0; i < sg_disp_fb_num; i++) {
-        if(0 == sg_disp_fb_arr[i].is_used) {
-            return sg_disp_fb_arr[i].fb;
+    OPERATE_RET rt = OPRT_OK;
+    TDL_DISP_FRAME_BUFF_T *fb = NULL;
+    uint32_t start_ms = (uint32_t)tal_system_get_millisecond();
+
+    /* the flag is raised before looking, a buffer freed in between still posts */
+    do {
+        sg_is_wait_disp_free_fb = true;
+        for (uint8_t i = 0; i < sg_disp_fb_num; i++) {
+            if(0 == sg_disp_fb_arr[i].is_used) {
+                fb = sg_disp_fb_arr[i].fb;
+                break;
+            }
+        }
+        if (fb) {
+            break;
         }
+        rt = tal_semaphore_wait(sg_disp_fb_free_sem, SEM_WAIT_FOREVER);
+    } while (OPRT_OK == rt);
+    sg_is_wait_disp_free_fb = false;
+
+    sg_frame_wait_ms += (uint32_t)tal_system_get_millisecond() - start_ms;
+
+    if (NULL == fb) {
+        PR_ERR("no free frame buffer available");
     }
 
-    sg_is_wait_disp_free_fb = true;
-    tal_semaphore_wait(sg_disp_fb_free_sem, SEM_WAIT_FOREVER);
+    return fb;
+}
 
-    for (uint8_t i = 0; i < sg_disp_fb_num; i++) {
-        if(0 == sg_disp_fb_arr[i].is_used) {
-            return sg_disp_fb_arr[i].fb;
+/* Hand the frame over at the panel TE pulse: the driver has to be done with the
+ * previous frame first, or the new one would queue behind it and miss the blanking. */
+static void disp_wait_te(TDL_DISP_FRAME_BUFF_T *fb)
+{
+    OPERATE_RET rt = OPRT_OK;
+    bool busy = false;
+    uint32_t start_ms = (uint32_t)tal_system_get_millisecond();
+
+    do {
+        sg_is_wait_disp_free_fb = true;
+        busy = false;
+        for (uint8_t i = 0; i < sg_disp_fb_num; i++) {
+            if (sg_disp_fb_arr[i].is_used && sg_disp_fb_arr[i].fb != fb) {
+                busy = true;
+                break;
+            }
         }
-    }
+        if (false == busy) {
+            break;
+        }
+        rt = tal_semaphore_wait(sg_disp_fb_free_sem, LV_DISP_TE_TIMEOUT_MS);
+    } while (OPRT_OK == rt);
+    sg_is_wait_disp_free_fb = false;
 
-    PR_ERR("no free frame buffer available");
+    tdl_disp_dev_wait_te(sg_tdl_disp_hdl, LV_DISP_TE_TIMEOUT_MS);
 
-    return NULL;
+    sg_frame_wait_ms += (uint32_t)tal_system_get_millisecond() - start_ms;
 }
 static void disp_set_frame_buff_used(TDL_DISP_FRAME_BUFF_T *fb)
 {
@@ -360,10 +416,14 @@ static void disp_frame_buff_init(TUYA_DISPLAY_PIXEL_FMT_E fmt, uint16_t width, u
         return;
     }
 
-#if defined(ENABLE_LVGL_DUAL_DISP_BUFF) && (ENABLE_LVGL_DUAL_DISP_BUFF == 1)
+    uint8_t min_fb_num = 1 + (has_vram ? 0 : 1);
+
+#if defined(ENABLE_LVGL_TRIPLE_DISP_BUFF) && (ENABLE_LVGL_TRIPLE_DISP_BUFF == 1)
+    sg_disp_fb_num = 3 + (has_vram ? 0 : 1);
+#elif defined(ENABLE_LVGL_DUAL_DISP_BUFF) && (ENABLE_LVGL_DUAL_DISP_BUFF == 1)
     sg_disp_fb_num = 2 + (has_vram ? 0 : 1);
 #else
-    sg_disp_fb_num = 1 + (has_vram ? 0 : 1);
+    sg_disp_fb_num = min_fb_num;
 #endif
 
     for (uint8_t i = 0; i < sg_disp_fb_num; i++) {
@@ -371,6 +431,12 @@ static void disp_frame_buff_init(TUYA_DISPLAY_PIXEL_FMT_E fmt, uint16_t width, u
 
         sg_disp_fb_arr[i].fb = tdl_disp_create_frame_buff(DISP_FB_TP_PSRAM, frame_len);
         if(sg_disp_fb_arr[i].fb == NULL) {
+            if (i >= min_fb_num) {
+                /* the extra buffers only smooth the frame rate, run with what fits */
+                PR_WARN("only %d of %d display frame buffs fit", i, sg_disp_fb_num);
+                sg_disp_fb_num = i;
+                break;
+            }
             PR_ERR("create display frame buff failed");
             return;
         }
@@ -433,6 +499,9 @@ static void disp_init(char *device)
     disp_frame_buff_init(sg_display_info.fmt, sg_display_info.width, \
                          sg_display_info.height, sg_display_info.has_vram);
 
+    /* without VRAM the driver swaps at its own frame interrupt */
+    sg_disp_te_sync = sg_display_info.has_te && sg_display_info.has_vram;
+
 #if defined(ENABLE_DMA2D) && (ENABLE_DMA2D == 1)
     __disp_dma2d_init();
 #endif
@@ -582,6 +651,128 @@ static void __disp_framebuffer_memcpy(TDL_DISP_DEV_INFO_T *dev_info,\
 #endif
 }
 
+static uint32_t __disp_rect_size(const TDL_DISP_RECT_T *rect)
+{
+    return (uint32_t)(rect->x1 - rect->x0 + 1) * (rect->y1 - rect->y0 + 1);
+}
+
+static TDL_DISP_RECT_T __disp_rect_union(const TDL_DISP_RECT_T *a, const TDL_DISP_RECT_T *b)
+{
+    TDL_DISP_RECT_T u;
+
+    u.x0 = LV_MIN(a->x0, b->x0);
+    u.y0 = LV_MIN(a->y0, b->y0);
+    u.x1 = LV_MAX(a->x1, b->x1);
+    u.y1 = LV_MAX(a->y1, b->y1);
+
+    return u;
+}
+
+/* Collect the flushed areas of a frame. Areas whose bounding box is no larger than
+ * the two of them (overlapping ones, or the strips of one invalidated area) are
+ * merged. When the list is full the new area joins the one it grows least. */
+static void __disp_dirty_area_add(const lv_area_t *area)
+{
+    TDL_DISP_RECT_T add;
+    uint8_t i = 0;
+
+    if (area->x2 < 0 || area->y2 < 0 || area->x1 >= sg_display_info.width || area->y1 >= sg_display_info.height) {
+        return;
+    }
+
+    add.x0 = LV_MAX(area->x1, 0);
+    add.y0 = LV_MAX(area->y1, 0);
+    add.x1 = LV_MIN(area->x2, sg_display_info.width - 1);
+    add.y1 = LV_MIN(area->y2, sg_display_info.height - 1);
+
+    while (i < sg_disp_dirty_num) {
+        TDL_DISP_RECT_T u = __disp_rect_union(&add, &sg_disp_dirty_areas[i]);
+        if (__disp_rect_size(&u) <= __disp_rect_size(&add) + __disp_rect_size(&sg_disp_dirty_areas[i])) {
+            // the merged area may now touch an earlier one, start over
+            sg_disp_dirty_areas[i] = sg_disp_dirty_areas[--sg_disp_dirty_num];
+            add = u;
+            i = 0;
+        } else {
+            i++;
+        }
+    }
+
+    if (sg_disp_dirty_num < TDL_DISP_FLUSH_AREA_MAX) {
+        sg_disp_dirty_areas[sg_disp_dirty_num++] = add;
+        return;
+    }
+
+    uint8_t best = 0;
+    uint32_t best_grow = UINT32_MAX;
+    for (i = 0; i < sg_disp_dirty_num; i++) {
+        TDL_DISP_RECT_T u = __disp_rect_union(&add, &sg_disp_dirty_areas[i]);
+        uint32_t grow = __disp_rect_size(&u) - __disp_rect_size(&sg_disp_dirty_areas[i]);
+        if (grow < best_grow) {
+            best_grow = grow;
+            best = i;
+        }
+    }
+    sg_disp_dirty_areas[best] = __disp_rect_union(&add, &sg_disp_dirty_areas[best]);
+}
+
+/* With two frame buffers the next one only lacks what was drawn into the current
+ * frame, so only the dirty areas are copied. */
+static void __disp_framebuffer_sync(TDL_DISP_FRAME_BUFF_T *dst_fb, TDL_DISP_FRAME_BUFF_T *src_fb)
+{
+    uint8_t per_pixel_byte = __disp_get_pixels_size_bytes(src_fb->fmt);
+
+#if defined(ENABLE_DMA2D) && (ENABLE_DMA2D == 1)
+    per_pixel_byte = 0; // one background DMA2D copy of the frame is cheaper
+#endif
+
+    if (2 != sg_disp_fb_num || 0 == per_pixel_byte) {
+        __disp_framebuffer_memcpy(&sg_display_info, dst_fb->frame, src_fb->frame, src_fb->len);
+        return;
+    }
+
+    uint32_t stride = src_fb->width * per_pixel_byte;
+    for (uint8_t i = 0; i < sg_disp_dirty_num; i++) {
+        TDL_DISP_RECT_T *rect = &sg_disp_dirty_areas[i];
+        uint32_t offset = rect->y0 * stride + rect->x0 * per_pixel_byte;
+        uint32_t len = (rect->x1 - rect->x0 + 1) * per_pixel_byte;
+
+        for (uint32_t y = rect->y0; y <= rect->y1; y++) {
+            memcpy(dst_fb->frame + offset, src_fb->frame + offset, len);
+            offset += stride;
+        }
+    }
+}
+
+static void __disp_frame_time_update(DISP_FRAME_TIME_T *time, uint32_t *total_ms, uint32_t ms)
+{
+    time->last_ms = ms;
+    *total_ms += ms;
+    time->avg_ms = *total_ms / sg_frame_stat.frames;
+    if (ms > time->max_ms) {
+        time->max_ms = ms;
+    }
+}
+
+static void __disp_frame_stat_update(uint32_t end_ms)
+{
+    uint32_t total_ms = end_ms - sg_frame_start_ms;
+    uint32_t busy_ms = sg_frame_flush_ms + sg_frame_wait_ms;
+
+    sg_frame_stat.frames++;
+    __disp_frame_time_update(&sg_frame_stat.render, &sg_frame_total_ms[0], (total_ms > busy_ms) ? total_ms - busy_ms : 0);
+    __disp_frame_time_update(&sg_frame_stat.flush, &sg_frame_total_ms[1], sg_frame_flush_ms);
+    __disp_frame_time_update(&sg_frame_stat.wait, &sg_frame_total_ms[2], sg_frame_wait_ms);
+}
+
+static void __disp_render_start_cb(lv_event_t *e)
+{
+    (void)e;
+
+    sg_frame_start_ms = (uint32_t)tal_system_get_millisecond();
+    sg_frame_flush_ms = 0;
+    sg_frame_wait_ms = 0;
+}
+
 static void disp_deinit(void)
 {
     tdl_disp_dev_close(sg_tdl_disp_hdl);
@@ -606,6 +797,35 @@ void disp_disable_update(void)
     disp_flush_enabled = false;
 }
 
+/**
+ * @brief Gets the frame time statistics of the display
+ *
+ * @param stat Filled with the counters since the last reset
+ */
+void disp_get_frame_stat(DISP_FRAME_STAT_T *stat)
+{
+    if (NULL == stat) {
+        return;
+    }
+
+    TAL_ENTER_CRITICAL();
+    memcpy(stat, &sg_frame_stat, sizeof(DISP_FRAME_STAT_T));
+    TAL_EXIT_CRITICAL();
+    stat->fb_num = sg_disp_fb_num;
+    stat->te_sync = sg_disp_te_sync;
+}
+
+/**
+ * @brief Clears the frame time statistics of the display
+ */
+void disp_reset_frame_stat(void)
+{
+    TAL_ENTER_CRITICAL();
+    memset(&sg_frame_stat, 0, sizeof(DISP_FRAME_STAT_T));
+    memset(sg_frame_total_ms, 0, sizeof(sg_frame_total_ms));
+    TAL_EXIT_CRITICAL();
+}
+
 /**
  * @brief Sets the display backlight brightness
  * 
@@ -624,6 +844,8 @@ static void disp_flush(lv_display_t * disp, const lv_area_t * area, uint8_t * px
 {
     uint8_t *color_ptr = px_map;
     lv_area_t *target_area = (lv_area_t *)area;
+    uint32_t flush_start_ms = (uint32_t)tal_system_get_millisecond();
+    uint32_t wait_start_ms = sg_frame_wait_ms;
 
     if (disp_flush_enabled) {
 
@@ -658,17 +880,29 @@ static void disp_flush(lv_display_t * disp, const lv_area_t * area, uint8_t * px
         }
 
         __disp_fill_display_framebuffer(target_area, color_ptr, cf, sg_p_display_fb);
+        __disp_dirty_area_add(target_area);
 
         if (lv_display_flush_is_last(disp)) {
 
+            if (sg_disp_te_sync) {
+                disp_wait_te(sg_p_display_fb);
+            }
+
             disp_set_frame_buff_used(sg_p_display_fb);
-            tdl_disp_dev_flush(sg_tdl_disp_hdl, sg_p_display_fb);
+            tdl_disp_dev_flush_area(sg_tdl_disp_hdl, sg_p_display_fb, sg_disp_dirty_areas, sg_disp_dirty_num);
 
             TDL_DISP_FRAME_BUFF_T *next_fb = disp_get_free_frame_buff();
             if(next_fb &&  next_fb != sg_p_display_fb) {
-                __disp_framebuffer_memcpy(&sg_display_info, next_fb->frame, sg_p_display_fb->frame, sg_p_display_fb->len);
+                __disp_framebuffer_sync(next_fb, sg_p_display_fb);
                 sg_p_display_fb = next_fb;
             }
+            sg_disp_dirty_num = 0;
+        }
+
+        uint32_t end_ms = (uint32_t)tal_system_get_millisecond();
+        sg_frame_flush_ms += end_ms - flush_start_ms - (sg_frame_wait_ms - wait_start_ms);
+        if (lv_display_flush_is_last(disp)) {
+            __disp_frame_stat_update(end_ms);
         }
     }
 
@@ -29,6 +29,20 @@ extern "C" {
 /**********************
  *      TYPEDEFS
  **********************/
+typedef struct {
+    uint32_t last_ms;
+    uint32_t avg_ms;
+    uint32_t max_ms;
+} DISP_FRAME_TIME_T;
+
+typedef struct {
+    uint32_t          frames;   /* frames flushed since the last reset */
+    uint8_t           fb_num;   /* frame buffers in use */
+    bool              te_sync;  /* frames are handed over at the panel TE pulse */
+    DISP_FRAME_TIME_T render;   /* LVGL drawing */
+    DISP_FRAME_TIME_T flush;    /* copying into the frame buffer and handing it to the driver */
+    DISP_FRAME_TIME_T wait;     /* waiting for a free frame buffer and the TE pulse */
+} DISP_FRAME_STAT_T;
 
 /**********************
  * GLOBAL PROTOTYPES
@@ -51,6 +65,18 @@ void disp_disable_update(void);
  */
 void disp_set_backlight(uint8_t brightness);
 
+/**
+ * @brief Gets the frame time statistics of the display
+ *
+ * @param stat Filled with the counters since the last reset
+ */
+void disp_get_frame_stat(DISP_FRAME_STAT_T *stat);
+
+/**
+ * @brief Clears the frame time statistics of the display
+ */
+void disp_reset_frame_stat(void);
+
 /**********************
  *      MACROS
  **********************/
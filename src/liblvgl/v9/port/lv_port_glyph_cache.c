@@ -0,0 +1,179 @@
+/**
+ * @file lv_port_glyph_cache.c
+ *
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "lv_port_glyph_cache.h"
+#include "src/misc/cache/lv_cache_private.h"
+#include "src/misc/cache/_lv_cache_lru_rb.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef struct {
+    lv_font_t font; /* first, the draw code passes it back as resolved_font */
+    const lv_font_t *orig;
+} glyph_font_t;
+
+typedef struct {
+    lv_cache_slot_size_t slot; /* bytes of the bitmap */
+    const lv_font_t *font;
+    uint32_t letter;
+    uint32_t stride;
+    uint8_t *bitmap;
+} glyph_cache_data_t;
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+#if LV_PORT_GLYPH_CACHE_SIZE > 0
+static lv_cache_t *s_glyph_cache;
+static lv_port_glyph_cache_stat_t s_glyph_stat;
+#endif
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+#if LV_PORT_GLYPH_CACHE_SIZE > 0
+static lv_cache_compare_res_t glyph_cache_compare_cb(const glyph_cache_data_t *a, const glyph_cache_data_t *b)
+{
+    if (a->font != b->font) {
+        return a->font > b->font ? 1 : -1;
+    }
+    if (a->letter != b->letter) {
+        return a->letter > b->letter ? 1 : -1;
+    }
+    return 0;
+}
+
+static void glyph_cache_free_cb(glyph_cache_data_t *data, void *user_data)
+{
+    LV_UNUSED(user_data);
+
+    lv_free(data->bitmap);
+    data->bitmap = NULL;
+}
+
+static bool glyph_is_bitmap(const lv_font_glyph_dsc_t *g_dsc)
+{
+    return g_dsc->format >= LV_FONT_GLYPH_FORMAT_A1 && g_dsc->format <= LV_FONT_GLYPH_FORMAT_A8;
+}
+
+static const void *glyph_cache_get_bitmap_cb(lv_font_glyph_dsc_t *g_dsc, uint32_t letter, lv_draw_buf_t *draw_buf)
+{
+    const glyph_font_t *gfont = (const glyph_font_t *)g_dsc->resolved_font;
+    const lv_font_t *orig = gfont->orig;
+
+    if (draw_buf == NULL || !glyph_is_bitmap(g_dsc)) {
+        return orig->get_glyph_bitmap(g_dsc, letter, draw_buf);
+    }
+
+    glyph_cache_data_t key = {.font = &gfont->font, .letter = letter};
+    lv_cache_entry_t *entry = lv_cache_acquire(s_glyph_cache, &key, NULL);
+    bool cached = (entry != NULL);
+    if (cached) {
+        glyph_cache_data_t *data = lv_cache_entry_get_data(entry);
+        bool fits = data->stride == draw_buf->header.stride && data->slot.size <= draw_buf->data_size;
+        if (fits) {
+            lv_memcpy(draw_buf->data, data->bitmap, data->slot.size);
+        }
+        lv_cache_release(s_glyph_cache, entry, NULL);
+        if (fits) {
+            s_glyph_stat.hits++;
+            return draw_buf;
+        }
+    }
+
+    /* the bitmap fonts render into draw_buf and return it, others are not kept */
+    const void *bitmap = orig->get_glyph_bitmap(g_dsc, letter, draw_buf);
+    s_glyph_stat.misses++;
+    if (bitmap != draw_buf || cached) {
+        return bitmap;
+    }
+
+    key.stride = draw_buf->header.stride;
+    key.slot.size = key.stride * g_dsc->box_h;
+    if (key.slot.size == 0 || key.slot.size > draw_buf->data_size) {
+        return bitmap;
+    }
+    key.bitmap = lv_malloc(key.slot.size);
+    if (key.bitmap == NULL) {
+        return bitmap;
+    }
+    lv_memcpy(key.bitmap, draw_buf->data, key.slot.size);
+
+    entry = lv_cache_add(s_glyph_cache, &key, NULL);
+    if (entry == NULL) {
+        lv_free(key.bitmap);
+        return bitmap;
+    }
+    lv_cache_release(s_glyph_cache, entry, NULL);
+
+    return bitmap;
+}
+#endif
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+lv_font_t *lv_port_glyph_cache_font(const lv_font_t *font)
+{
+#if LV_PORT_GLYPH_CACHE_SIZE > 0
+    if (font == NULL || font->get_glyph_bitmap == NULL) {
+        return (lv_font_t *)font;
+    }
+
+    if (s_glyph_cache == NULL) {
+        s_glyph_cache = lv_cache_create(&lv_cache_class_lru_rb_size, sizeof(glyph_cache_data_t),
+        LV_PORT_GLYPH_CACHE_SIZE, (lv_cache_ops_t) {
+            .compare_cb = (lv_cache_compare_cb_t)glyph_cache_compare_cb,
+            .create_cb = NULL,
+            .free_cb = (lv_cache_free_cb_t)glyph_cache_free_cb,
+        });
+        if (s_glyph_cache == NULL) {
+            LV_LOG_ERROR("%s cache create failed\n", __func__);
+            return (lv_font_t *)font;
+        }
+    }
+
+    glyph_font_t *gfont = lv_malloc(sizeof(glyph_font_t));
+    if (gfont == NULL) {
+        return (lv_font_t *)font;
+    }
+    gfont->font = *font;
+    gfont->font.get_glyph_bitmap = glyph_cache_get_bitmap_cb;
+    gfont->orig = font;
+
+    return &gfont->font;
+#else
+    return (lv_font_t *)font;
+#endif
+}
+
+void lv_port_glyph_cache_stat(lv_port_glyph_cache_stat_t *stat)
+{
+    if (stat == NULL) {
+        return;
+    }
+
+#if LV_PORT_GLYPH_CACHE_SIZE > 0
+    *stat = s_glyph_stat;
+#else
+    lv_memzero(stat, sizeof(lv_port_glyph_cache_stat_t));
+#endif
+}
@@ -0,0 +1,59 @@
+/**
+ * @file lv_port_glyph_cache.h
+ *
+ * Rendered glyph bitmaps of bitmap fonts kept for reuse. Large CJK fonts
+ * are compressed in flash and every glyph drawn is decompressed again, a
+ * cached glyph is a copy instead. The cache is shared by all wrapped fonts,
+ * keyed by font and code point, with a byte budget and least recently used
+ * glyphs out first. It is allocated through lv_malloc(), in PSRAM with
+ * ENABLE_EXT_RAM.
+ */
+
+#ifndef LV_PORT_GLYPH_CACHE_H
+#define LV_PORT_GLYPH_CACHE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "lvgl.h"
+
+/* Bytes of glyph bitmaps kept, 0 disables the cache */
+#ifndef LV_PORT_GLYPH_CACHE_SIZE
+#if defined(ENABLE_EXT_RAM) && (ENABLE_EXT_RAM == 1)
+#define LV_PORT_GLYPH_CACHE_SIZE (128 * 1024)
+#else
+#define LV_PORT_GLYPH_CACHE_SIZE 0
+#endif
+#endif
+
+typedef struct {
+    uint32_t hits;   /* glyphs copied from the cache */
+    uint32_t misses; /* glyphs rendered by the font */
+} lv_port_glyph_cache_stat_t;
+
+/**
+ * @brief Wraps a font so that its glyph bitmaps are cached
+ *
+ * Use the returned font in place of the given one. Its fallback fonts are
+ * not wrapped, wrap them too if they are large.
+ *
+ * @param font A bitmap font, for example a converted lv_font_fmt_txt font
+ *
+ * @return The wrapping font, or the font itself when the cache is disabled
+ * or out of memory
+ */
+lv_font_t *lv_port_glyph_cache_font(const lv_font_t *font);
+
+/**
+ * @brief Reads the glyph cache counters
+ *
+ * @param stat Filled in
+ */
+void lv_port_glyph_cache_stat(lv_port_glyph_cache_stat_t *stat);
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*LV_PORT_GLYPH_CACHE_H*/
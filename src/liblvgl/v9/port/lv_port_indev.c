@@ -10,6 +10,7 @@
 #include "lv_port_indev.h"
 #ifdef LVGL_ENABLE_TP
 #include "tdl_tp_manage.h"
+#include "lv_vendor.h"
 #endif
 
 /*********************
@@ -26,6 +27,7 @@
 #ifdef LVGL_ENABLE_TP
 static void touchpad_init(void *device);
 static void touchpad_read(lv_indev_t *indev, lv_indev_data_t *data);
+static void touchpad_int_start(void);
 #endif
 
 #ifdef ENABLE_LVGL_ENCODER
@@ -41,6 +43,8 @@ lv_indev_t *indev_encoder;
 
 #ifdef LVGL_ENABLE_TP
 static TDL_TP_HANDLE_T sg_tp_hdl = NULL; // Handle for tp device
+static THREAD_HANDLE sg_tp_int_thrd = NULL;
+static volatile bool sg_tp_idle = true;  // released and the read timer paused, a touch INT has to wake it
 #endif
 
 /**********************
@@ -76,6 +80,7 @@ void lv_port_indev_init(void *device)
     indev_touchpad = lv_indev_create();
     lv_indev_set_type(indev_touchpad, LV_INDEV_TYPE_POINTER);
     lv_indev_set_read_cb(indev_touchpad, touchpad_read);
+    touchpad_int_start();
 #endif
 
     /*------------------
@@ -129,6 +134,7 @@ static void touchpad_read(lv_indev_t *indev_drv, lv_indev_data_t *data)
 
     tdl_tp_dev_read(sg_tp_hdl, 1, &point, &point_num);
     /*Save the pressed coordinates and the state*/
+    sg_tp_idle = (0 == point_num);
     if (point_num > 0) {
         data->state = LV_INDEV_STATE_PRESSED;
         last_x = point.x;
@@ -142,6 +148,59 @@ static void touchpad_read(lv_indev_t *indev_drv, lv_indev_data_t *data)
     data->point.x = last_x;
     data->point.y = last_y;
 }
+
+/*Runs in the LVGL task, the first read of a touch resumes the read timer until release*/
+static void touchpad_event_cb(void *arg)
+{
+    LV_UNUSED(arg);
+
+    lv_indev_read(indev_touchpad);
+}
+
+static void touchpad_int_task(void *arg)
+{
+    LV_UNUSED(arg);
+
+    while (OPRT_NOT_SUPPORTED != tdl_tp_dev_wait(sg_tp_hdl, SEM_WAIT_FOREVER)) {
+        /*while pressed the read timer samples the latest point, the pulses in between are dropped*/
+        if (false == sg_tp_idle) {
+            continue;
+        }
+        sg_tp_idle = false;
+        if (OPRT_OK != lv_vendor_ui_post(touchpad_event_cb, NULL, 0)) {
+            sg_tp_idle = true;
+        }
+    }
+
+    /*the device was closed*/
+    THREAD_HANDLE self = sg_tp_int_thrd;
+    sg_tp_int_thrd = NULL;
+    tal_thread_delete(self);
+}
+
+/*With the controller INT pin the touchpad is read on touch only, no polling while idle*/
+static void touchpad_int_start(void)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    if (NULL == sg_tp_hdl || NULL != sg_tp_int_thrd || OPRT_NOT_SUPPORTED == tdl_tp_dev_wait(sg_tp_hdl, 0)) {
+        return;
+    }
+
+    lv_indev_set_mode(indev_touchpad, LV_INDEV_MODE_EVENT);
+
+    THREAD_CFG_T thread_cfg = {2048, THREAD_PRIO_1, "lv_tp_int"};
+    rt = tal_thread_create_and_start(&sg_tp_int_thrd, NULL, NULL, touchpad_int_task, NULL, &thread_cfg);
+    if (OPRT_OK != rt) {
+        PR_ERR("tp int task create failed, rt: %d", rt);
+        sg_tp_int_thrd = NULL;
+        lv_indev_set_mode(indev_touchpad, LV_INDEV_MODE_TIMER);
+        return;
+    }
+
+    /*a finger may be down already*/
+    lv_vendor_ui_post(touchpad_event_cb, NULL, 0);
+}
 #endif
 
 /*------------------
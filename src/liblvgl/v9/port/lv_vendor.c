@@ -4,19 +4,73 @@
 #include "lv_port_disp.h"
 #include "lv_port_indev.h"
 #include "lv_vendor.h"
+#include "src/core/lv_global.h"
+#include "src/misc/cache/lv_cache_private.h"
+#include "src/misc/cache/_lv_cache_lru_rb.h"
 
 #include "tuya_cloud_types.h"
 #include "tkl_system.h"
 #include "tkl_thread.h"
 #include "tkl_mutex.h"
 #include "tkl_semaphore.h"
+#include "tkl_queue.h"
+
+typedef struct {
+    LV_VENDOR_UI_CB cb;
+    void *arg;
+} LV_VENDOR_UI_MSG_T;
 
 static TKL_THREAD_HANDLE g_disp_thread_handle = NULL;
+static TKL_QUEUE_HANDLE g_ui_queue = NULL;
 static TKL_MUTEX_HANDLE g_disp_mutex = NULL;
 static TKL_SEM_HANDLE lvgl_sem = NULL;
 static uint8_t lvgl_task_state = STATE_INIT;
 static bool lv_vendor_initialized = false;
 
+#if LV_CACHE_DEF_SIZE > 0
+/* the decoder's LRU cache class with counters around its lookups */
+static lv_cache_class_t s_img_cache_class;
+static LV_VENDOR_IMG_CACHE_STAT_T s_img_cache_stat;
+
+static lv_cache_entry_t *img_cache_get_cb(lv_cache_t *cache, const void *key, void *user_data)
+{
+    lv_cache_entry_t *entry = lv_cache_class_lru_rb_size.get_cb(cache, key, user_data);
+    if (entry) {
+        s_img_cache_stat.hits++;
+    }
+    return entry;
+}
+
+static lv_cache_entry_t *img_cache_add_cb(lv_cache_t *cache, const void *key, void *user_data)
+{
+    s_img_cache_stat.misses++;
+    return lv_cache_class_lru_rb_size.add_cb(cache, key, user_data);
+}
+
+static lv_cache_entry_t *img_cache_get_victim_cb(lv_cache_t *cache, void *user_data)
+{
+    lv_cache_entry_t *victim = lv_cache_class_lru_rb_size.get_victim_cb(cache, user_data);
+    if (victim) {
+        s_img_cache_stat.evictions++;
+    }
+    return victim;
+}
+
+static void lv_vendor_image_cache_hook(void)
+{
+    lv_cache_t *cache = LV_GLOBAL_DEFAULT()->img_cache;
+
+    if (cache == NULL || cache->clz != &lv_cache_class_lru_rb_size) {
+        return;
+    }
+    s_img_cache_class = lv_cache_class_lru_rb_size;
+    s_img_cache_class.get_cb = img_cache_get_cb;
+    s_img_cache_class.add_cb = img_cache_add_cb;
+    s_img_cache_class.get_victim_cb = img_cache_get_victim_cb;
+    cache->clz = &s_img_cache_class;
+}
+#endif
+
 static uint32_t lv_tick_get_callback(void)
 {
     return (uint32_t)tkl_system_get_millisecond();
@@ -41,6 +95,10 @@ void lv_vendor_init(void *device)
 
     lv_init();
 
+#if LV_CACHE_DEF_SIZE > 0
+    lv_vendor_image_cache_hook();
+#endif
+
     lv_port_disp_init(device);
 
     lv_port_indev_init(device);
@@ -57,14 +115,47 @@ void lv_vendor_init(void *device)
         return;
     }
 
+    if (OPRT_OK != tkl_queue_create_init(&g_ui_queue, sizeof(LV_VENDOR_UI_MSG_T), LV_VENDOR_UI_QUEUE_LEN)) {
+        LV_LOG_ERROR("%s ui queue init failed\n", __func__);
+        return;
+    }
+
     lv_vendor_initialized = true;
 
     LV_LOG_INFO("%s complete\n", __func__);
 }
 
+/* run the queued UI updates, at most one queue length per refresh so a
+ * flood of updates cannot stall rendering */
+static void lv_vendor_ui_run(LV_VENDOR_UI_MSG_T *first)
+{
+    LV_VENDOR_UI_MSG_T msg;
+
+    if (first) {
+        first->cb(first->arg);
+    }
+
+    for (uint32_t i = 0; i < LV_VENDOR_UI_QUEUE_LEN; i++) {
+        if (OPRT_OK != tkl_queue_fetch(g_ui_queue, &msg, 0)) {
+            break;
+        }
+        msg.cb(msg.arg);
+    }
+}
+
 static void lv_tast_entry(void *arg)
 {
     uint32_t sleep_time;
+    LV_VENDOR_UI_MSG_T msg;
+    bool has_msg = false;
+
+#if !(defined(ENABLE_SMP) && (ENABLE_SMP == 1)) && defined(ENABLE_THREAD_AFFINITY) && (ENABLE_THREAD_AFFINITY == 1)
+    TKL_THREAD_HANDLE self = NULL;
+    tkl_thread_get_id(&self);
+    if (OPRT_OK != tkl_thread_set_affinity(self, LV_VENDOR_TASK_CORE)) {
+        LV_LOG_ERROR("%s affinity to core %d failed\n", __func__, LV_VENDOR_TASK_CORE);
+    }
+#endif
 
     lvgl_task_state = STATE_RUNNING;
 
@@ -72,6 +163,7 @@ static void lv_tast_entry(void *arg)
 
     while(lvgl_task_state == STATE_RUNNING) {
         lv_vendor_disp_lock();
+        lv_vendor_ui_run(has_msg ? &msg : NULL);
         sleep_time = lv_task_handler();
         lv_vendor_disp_unlock();
 
@@ -85,7 +177,8 @@ static void lv_tast_entry(void *arg)
             }
         #endif
 
-        tkl_system_sleep(sleep_time);
+        // sleep on the UI queue, a posted update is drawn without waiting out the period
+        has_msg = (OPRT_OK == tkl_queue_fetch(g_ui_queue, &msg, sleep_time));
         // Modified by TUYA Start
         extern void tuya_app_gui_feed_watchdog(void);
         tuya_app_gui_feed_watchdog();
@@ -106,7 +199,7 @@ void lv_vendor_start(uint32_t lvgl_task_pri, uint32_t lvgl_stack_size)
     }
 
 #if defined(ENABLE_SMP) && (ENABLE_SMP == 1)
-    if(OPRT_OK != tkl_thread_smp_create(&g_disp_thread_handle, 0, "lvgl", lvgl_stack_size, lvgl_task_pri, lv_tast_entry, NULL)) {
+    if(OPRT_OK != tkl_thread_smp_create(&g_disp_thread_handle, LV_VENDOR_TASK_CORE, "lvgl", lvgl_stack_size, lvgl_task_pri, lv_tast_entry, NULL)) {
         LV_LOG_ERROR("%s lvgl task create failed\n", __func__);
         return;
     }
@@ -141,6 +234,39 @@ void lv_vendor_set_backlight(uint8_t brightness)
     disp_set_backlight(brightness);
 }
 
+OPERATE_RET lv_vendor_ui_post(LV_VENDOR_UI_CB cb, void *arg, uint32_t timeout_ms)
+{
+    LV_VENDOR_UI_MSG_T msg = {cb, arg};
+
+    if (NULL == cb) {
+        return OPRT_INVALID_PARM;
+    }
+
+    if (NULL == g_ui_queue) {
+        return OPRT_RESOURCE_NOT_READY;
+    }
+
+    return tkl_queue_post(g_ui_queue, &msg, timeout_ms);
+}
+
+void lv_vendor_image_cache_stat(LV_VENDOR_IMG_CACHE_STAT_T *stat)
+{
+    if (NULL == stat) {
+        return;
+    }
+
+    memset(stat, 0, sizeof(LV_VENDOR_IMG_CACHE_STAT_T));
+#if LV_CACHE_DEF_SIZE > 0
+    lv_cache_t *cache = LV_GLOBAL_DEFAULT()->img_cache;
+    if (cache == NULL) {
+        return;
+    }
+    *stat = s_img_cache_stat;
+    stat->size = lv_cache_get_size(cache, NULL);
+    stat->max_size = lv_cache_get_max_size(cache, NULL);
+#endif
+}
+
 // Modified by TUYA Start
 void __attribute__((weak)) tuya_app_gui_feed_watchdog(void)
 {
@@ -10,6 +10,17 @@ extern "C" {
 #endif
 
 #include "lvgl.h"
+#include "tuya_cloud_types.h"
+
+/* Core of the LVGL task with ENABLE_SMP or ENABLE_THREAD_AFFINITY */
+#ifndef LV_VENDOR_TASK_CORE
+#define LV_VENDOR_TASK_CORE 0
+#endif
+
+/* UI updates lv_vendor_ui_post() can queue */
+#ifndef LV_VENDOR_UI_QUEUE_LEN
+#define LV_VENDOR_UI_QUEUE_LEN 16
+#endif
 
 typedef enum{
     STATE_INIT,
@@ -17,6 +28,17 @@ typedef enum{
     STATE_STOP
 } lvgl_task_state_t;
 
+typedef void (*LV_VENDOR_UI_CB)(void *arg);
+
+/* decoded image cache counters, see LV_CACHE_DEF_SIZE */
+typedef struct {
+    uint32_t hits;      /* lookups served from the cache */
+    uint32_t misses;    /* images decoded into the cache */
+    uint32_t evictions; /* images dropped to make room */
+    uint32_t size;      /* bytes held */
+    uint32_t max_size;  /* byte budget */
+} LV_VENDOR_IMG_CACHE_STAT_T;
+
 void lv_vendor_init(void *device);
 void lv_vendor_start(uint32_t lvgl_task_pri, uint32_t lvgl_stack_size);
 void lv_vendor_stop(void);
@@ -24,6 +46,31 @@ void lv_vendor_disp_lock(void);
 void lv_vendor_disp_unlock(void);
 void lv_vendor_set_backlight(uint8_t brightness);
 
+/**
+ * @brief Runs a UI update in the LVGL task
+ *
+ * The callback runs in the LVGL task with the display locked, before the next
+ * refresh. Other tasks, such as audio or network handlers, use it instead of
+ * lv_vendor_disp_lock() so that they never wait for a frame to render.
+ *
+ * @param cb The update, may call any LVGL API
+ * @param arg Passed to cb, it must stay valid until cb has run
+ * @param timeout_ms How long to wait when the queue is full
+ *
+ * @return OPRT_OK on success, an error code if the update was not queued
+ */
+OPERATE_RET lv_vendor_ui_post(LV_VENDOR_UI_CB cb, void *arg, uint32_t timeout_ms);
+
+/**
+ * @brief Reads the decoded image cache counters
+ *
+ * Dropping a cached image, for example on lv_gif_set_src(), looks it up and
+ * counts as a hit.
+ *
+ * @param stat Filled in, all zero when the cache is disabled
+ */
+void lv_vendor_image_cache_stat(LV_VENDOR_IMG_CACHE_STAT_T *stat);
+
 #ifdef __cplusplus
 } /*extern "C"*/
 #endif
@@ -36,7 +36,13 @@
 
 /**
  * @brief CORE_MQTT_BUFFER_SIZE
+ *
+ * Network buffer for outgoing packet headers and incoming packets. A larger
+ * PUBLISH on a topic with a sink registered by mqtt_client_stream_register()
+ * streams through it in chunks, on other topics it is dropped.
  */
-#define CORE_MQTT_BUFFER_SIZE (2048U)
+#ifndef CORE_MQTT_BUFFER_SIZE
+#define CORE_MQTT_BUFFER_SIZE (1024U)
+#endif
 
 #endif /* ifndef CORE_MQTT_CONFIG_H_ */
@@ -40,6 +40,36 @@ typedef struct mqtt_client_message {
     mqtt_client_qos_t qos;
 } mqtt_client_message_t;
 
+/**
+ * @brief One piece of a streamed PUBLISH payload.
+ *
+ * data points into the network buffer and is only valid during the sink
+ * call. The chunks of a message come in order; the last one ends at total.
+ * A message that fits the buffer arrives as a single chunk. When the
+ * connection fails mid-message, the sink is called once more with data NULL
+ * to drop what it has collected.
+ */
+typedef struct mqtt_client_chunk {
+    const char *topic;
+    const uint8_t *data;
+    size_t len;
+    size_t offset; /*!< of data within the payload */
+    size_t total;  /*!< payload length */
+    mqtt_client_qos_t qos;
+} mqtt_client_chunk_t;
+
+typedef void (*mqtt_client_sink_t)(void *client, uint16_t msgid, const mqtt_client_chunk_t *chunk, void *userdata);
+
+/* Sinks per client */
+#ifndef MQTT_CLIENT_STREAM_MAX
+#define MQTT_CLIENT_STREAM_MAX 4
+#endif
+
+/* Longest topic name that can stream, others go to on_message */
+#ifndef MQTT_CLIENT_STREAM_TOPIC_MAX
+#define MQTT_CLIENT_STREAM_TOPIC_MAX 128
+#endif
+
 typedef struct {
     const uint8_t *cacert;
     size_t cacert_len;
@@ -73,10 +103,38 @@ mqtt_client_status_t mqtt_client_disconnect(void *client);
 
 mqtt_client_status_t mqtt_client_yield(void *client);
 
+/**
+ * @brief Sleeps until the socket is readable, the keepalive is due or
+ * timeout_ms passes, then handles whichever of them is ready.
+ *
+ * Unlike mqtt_client_yield() an idle connection costs one wakeup per
+ * keepalive instead of one per receive timeout.
+ */
+mqtt_client_status_t mqtt_client_wait(void *client, uint32_t timeout_ms);
+
 uint16_t mqtt_client_subscribe(void *client, const char *topic, uint8_t qos);
 
 uint16_t mqtt_client_unsubscribe(void *client, const char *topic, uint8_t qos);
 
 uint16_t mqtt_client_publish(void *client, const char *topic, const uint8_t *payload, size_t length, uint8_t qos);
 
+/**
+ * @brief Streams the PUBLISH messages of a topic filter to a sink instead of
+ * on_message.
+ *
+ * The payload is read in chunks of the network buffer and handed to the sink
+ * as it arrives, so a message may be larger than CORE_MQTT_BUFFER_SIZE. QoS 1
+ * messages are acknowledged once the last chunk was delivered. QoS 2
+ * messages keep going to on_message. Streaming happens in mqtt_client_wait().
+ *
+ * @param client MQTT client
+ * @param filter Topic filter, wildcards allowed, must stay valid while registered
+ * @param sink Sink, NULL removes the filter
+ * @param userdata Passed to the sink
+ * @return MQTT_STATUS_SUCCESS, or MQTT_STATUS_INVALID_PARAM when all
+ * MQTT_CLIENT_STREAM_MAX sinks are taken
+ */
+mqtt_client_status_t mqtt_client_stream_register(void *client, const char *filter, mqtt_client_sink_t sink,
+                                                 void *userdata);
+
 #endif /* ifndef MQTT_CLIENT_INTERFACE_H */
@@ -13,13 +13,31 @@
 #define log_debug PR_DEBUG
 #define log_error PR_ERR
 
+/* fixed header, topic length and topic of a PUBLISH, read to pick its sink */
+#define MQTT_CLIENT_READ_AHEAD_MAX (5 + 2 + MQTT_CLIENT_STREAM_TOPIC_MAX)
+
+typedef struct {
+    const char *filter;
+    mqtt_client_sink_t sink;
+    void *userdata;
+} mqtt_client_stream_t;
+
 typedef struct {
     mqtt_client_config_t config;
     MQTTContext_t mqclient;
     tuya_transporter_t network;
+    mqtt_client_stream_t stream[MQTT_CLIENT_STREAM_MAX];
+    uint8_t stream_num;
+    /* bytes read ahead for a packet that is not streamed, served to coreMQTT first */
+    uint8_t ahead[MQTT_CLIENT_READ_AHEAD_MAX];
+    size_t ahead_len;
+    size_t ahead_off;
     uint8_t mqttbuffer[CORE_MQTT_BUFFER_SIZE];
 } mqtt_client_context_t;
 
+#define MQTT_CLIENT_OF_NETWORK(pNetwork)                                                                               \
+    ((mqtt_client_context_t *)((uint8_t *)(pNetwork)-offsetof(mqtt_client_context_t, network)))
+
 static void core_mqtt_library_callback(struct MQTTContext *pContext, struct MQTTPacketInfo *pPacketInfo,
                                        struct MQTTDeserializedInfo *pDeserializedInfo)
 {
@@ -98,7 +116,7 @@ static int network_write(NetworkContext_t *pNetwork, const unsigned char *pMsg,
     return tuya_transporter_write(transporter, (uint8_t *)pMsg, len, 0);
 }
 
-static int network_read(NetworkContext_t *pNetwork, unsigned char *pMsg, size_t len)
+static int network_read_raw(NetworkContext_t *pNetwork, unsigned char *pMsg, size_t len)
 {
     tuya_transporter_t transporter = *pNetwork;
 
@@ -116,6 +134,54 @@ static int network_read(NetworkContext_t *pNetwork, unsigned char *pMsg, size_t
 
     return result;
 }
+
+static int network_read(NetworkContext_t *pNetwork, unsigned char *pMsg, size_t len)
+{
+    mqtt_client_context_t *context = MQTT_CLIENT_OF_NETWORK(pNetwork);
+
+    if (context->ahead_off < context->ahead_len) {
+        size_t n = context->ahead_len - context->ahead_off;
+        n = (n < len) ? n : len;
+        memcpy(pMsg, &context->ahead[context->ahead_off], n);
+        context->ahead_off += n;
+        return (int)n;
+    }
+
+    return network_read_raw(pNetwork, pMsg, len);
+}
+
+/* read for MQTT_GetIncomingPacketTypeAndLength(), keeps the bytes for a replay */
+static int network_read_ahead(NetworkContext_t *pNetwork, unsigned char *pMsg, size_t len)
+{
+    mqtt_client_context_t *context = MQTT_CLIENT_OF_NETWORK(pNetwork);
+
+    int result = network_read_raw(pNetwork, pMsg, len);
+    if (result > 0) {
+        memcpy(&context->ahead[context->ahead_len], pMsg, result);
+        context->ahead_len += result;
+    }
+
+    return result;
+}
+
+static int network_read_exact(mqtt_client_context_t *context, uint8_t *buf, size_t len)
+{
+    uint32_t start = (uint32_t)tal_system_get_millisecond();
+    size_t got = 0;
+
+    while (got < len) {
+        int result = network_read_raw(&context->network, buf + got, len - got);
+        if (result < 0) {
+            return result;
+        }
+        got += result;
+        if (got < len && (uint32_t)tal_system_get_millisecond() - start >= context->config.timeout_ms) {
+            return -1;
+        }
+    }
+
+    return (int)got;
+}
 static uint32_t __mqtt_client_get_current_time(void)
 {
     return (uint32_t)tal_system_get_millisecond();
@@ -202,6 +268,7 @@ mqtt_client_status_t mqtt_client_connect(void *client)
     }
 
     bool pSessionPresent = false;
+    context->ahead_len = context->ahead_off = 0;
 
     /* Send MQTT CONNECT packet to broker. */
     mqtt_status = MQTT_Connect(&context->mqclient,
@@ -320,4 +387,215 @@ mqtt_client_status_t mqtt_client_yield(void *client)
         return MQTT_STATUS_NETWORK_TIMEOUT;
     }
     return MQTT_STATUS_SUCCESS;
+}
+
+mqtt_client_status_t mqtt_client_stream_register(void *client, const char *filter, mqtt_client_sink_t sink,
+                                                 void *userdata)
+{
+    mqtt_client_context_t *context = (mqtt_client_context_t *)client;
+    mqtt_client_stream_t *slot = NULL;
+
+    if (context == NULL || filter == NULL) {
+        return MQTT_STATUS_INVALID_PARAM;
+    }
+
+    for (int i = 0; i < MQTT_CLIENT_STREAM_MAX; i++) {
+        if (context->stream[i].filter && strcmp(context->stream[i].filter, filter) == 0) {
+            slot = &context->stream[i];
+            break;
+        }
+        if (slot == NULL && context->stream[i].filter == NULL) {
+            slot = &context->stream[i];
+        }
+    }
+
+    if (sink == NULL) {
+        if (slot && slot->filter) {
+            memset(slot, 0, sizeof(mqtt_client_stream_t));
+            context->stream_num--;
+        }
+        return MQTT_STATUS_SUCCESS;
+    }
+
+    if (slot == NULL) {
+        return MQTT_STATUS_INVALID_PARAM;
+    }
+
+    if (slot->filter == NULL) {
+        context->stream_num++;
+    }
+    slot->filter = filter;
+    slot->sink = sink;
+    slot->userdata = userdata;
+    return MQTT_STATUS_SUCCESS;
+}
+
+static mqtt_client_stream_t *mqtt_client_stream_find(mqtt_client_context_t *context, const char *topic,
+                                                     uint16_t topic_len)
+{
+    for (int i = 0; i < MQTT_CLIENT_STREAM_MAX; i++) {
+        bool match = false;
+        if (context->stream[i].filter &&
+            MQTT_MatchTopic(topic, topic_len, context->stream[i].filter, strlen(context->stream[i].filter), &match) ==
+                MQTTSuccess &&
+            match) {
+            return &context->stream[i];
+        }
+    }
+    return NULL;
+}
+
+/* Takes the next packet off the socket when it is a PUBLISH for a sink and
+ * streams its payload through the network buffer. MQTTNoDataAvailable when
+ * the packet is left to coreMQTT, with the bytes read so far in ahead. */
+static MQTTStatus_t mqtt_client_stream_receive(mqtt_client_context_t *context)
+{
+    MQTTContext_t *mqclient = &context->mqclient;
+    MQTTPacketInfo_t packet = {0};
+    char topic[MQTT_CLIENT_STREAM_TOPIC_MAX + 1];
+    uint16_t topic_len = 0, msgid = 0;
+    size_t header_len = 0, left = 0, offset = 0;
+
+    context->ahead_len = context->ahead_off = 0;
+    if (MQTT_GetIncomingPacketTypeAndLength((TransportRecv_t)network_read_ahead, &context->network, &packet) !=
+        MQTTSuccess) {
+        return MQTTNoDataAvailable;
+    }
+
+    uint8_t qos = (packet.type >> 1) & 0x03U;
+    if ((packet.type & 0xF0U) != MQTT_PACKET_TYPE_PUBLISH || qos > MQTT_QOS_1 || packet.remainingLength < 2) {
+        return MQTTNoDataAvailable;
+    }
+
+    if (network_read_exact(context, &context->ahead[context->ahead_len], 2) != 2) {
+        return MQTTRecvFailed;
+    }
+    topic_len = ((uint16_t)context->ahead[context->ahead_len] << 8) | context->ahead[context->ahead_len + 1];
+    context->ahead_len += 2;
+
+    header_len = 2 + topic_len + ((qos > 0) ? 2 : 0);
+    if (topic_len > MQTT_CLIENT_STREAM_TOPIC_MAX || header_len > packet.remainingLength) {
+        return MQTTNoDataAvailable;
+    }
+
+    if (network_read_exact(context, &context->ahead[context->ahead_len], topic_len) != topic_len) {
+        return MQTTRecvFailed;
+    }
+    memcpy(topic, &context->ahead[context->ahead_len], topic_len);
+    topic[topic_len] = '\0';
+    context->ahead_len += topic_len;
+
+    mqtt_client_stream_t *stream = mqtt_client_stream_find(context, topic, topic_len);
+    if (stream == NULL) {
+        return MQTTNoDataAvailable;
+    }
+
+    /* the packet is ours from here on */
+    context->ahead_len = 0;
+    if (qos > 0) {
+        uint8_t id[2];
+        if (network_read_exact(context, id, sizeof(id)) != sizeof(id)) {
+            return MQTTRecvFailed;
+        }
+        msgid = ((uint16_t)id[0] << 8) | id[1];
+    }
+
+    mqtt_client_chunk_t chunk = {
+        .topic = topic,
+        .total = packet.remainingLength - header_len,
+        .qos = qos,
+    };
+
+    left = chunk.total;
+    do {
+        size_t len = (left < mqclient->networkBuffer.size) ? left : mqclient->networkBuffer.size;
+        if (network_read_exact(context, mqclient->networkBuffer.pBuffer, len) != (int)len) {
+            chunk.data = NULL;
+            chunk.len = 0;
+            stream->sink(context, msgid, &chunk, stream->userdata);
+            return MQTTRecvFailed;
+        }
+
+        chunk.data = mqclient->networkBuffer.pBuffer;
+        chunk.len = len;
+        chunk.offset = offset;
+        stream->sink(context, msgid, &chunk, stream->userdata);
+
+        offset += len;
+        left -= len;
+    } while (left > 0);
+
+    if (qos > 0) {
+        uint8_t ack[MQTT_PUBLISH_ACK_PACKET_SIZE];
+        MQTTFixedBuffer_t ack_buffer = {.pBuffer = ack, .size = sizeof(ack)};
+
+        MQTT_SerializeAck(&ack_buffer, MQTT_PACKET_TYPE_PUBACK, msgid);
+        if (network_write(&context->network, ack, sizeof(ack)) != (int)sizeof(ack)) {
+            return MQTTSendFailed;
+        }
+        mqclient->lastPacketTime = mqclient->getTime();
+    }
+
+    return MQTTSuccess;
+}
+
+/* ms until coreMQTT has keepalive work: a PINGREQ to send or a PINGRESP
+ * to give up on. UINT32_MAX if keepalive is disabled. */
+static uint32_t mqtt_client_keepalive_left(MQTTContext_t *mqclient, uint32_t now)
+{
+    uint32_t keepalive_ms = 1000U * (uint32_t)mqclient->keepAliveIntervalSec;
+    uint32_t elapsed;
+    uint32_t limit;
+
+    if (keepalive_ms == 0) {
+        return UINT32_MAX;
+    }
+
+    if (mqclient->waitingForPingResp) {
+        elapsed = now - mqclient->pingReqSendTimeMs;
+        limit = MQTT_PINGRESP_TIMEOUT_MS;
+    } else {
+        elapsed = now - mqclient->lastPacketTime;
+        limit = keepalive_ms;
+    }
+    /* coreMQTT acts once the elapsed time is strictly greater */
+    return (elapsed > limit) ? 0 : limit - elapsed + 1;
+}
+
+mqtt_client_status_t mqtt_client_wait(void *client, uint32_t timeout_ms)
+{
+    mqtt_client_context_t *context = (mqtt_client_context_t *)client;
+    MQTTContext_t *mqclient = &context->mqclient;
+    MQTTStatus_t mqtt_status = MQTTSuccess;
+
+    uint32_t keepalive_left = mqtt_client_keepalive_left(mqclient, mqclient->getTime());
+    uint32_t wait_ms = (keepalive_left < timeout_ms) ? keepalive_left : timeout_ms;
+
+    /* a zero select timeout blocks on some platforms */
+    int ready = tuya_transporter_poll_read(context->network, (wait_ms > 0) ? (int)wait_ms : 1);
+    if (ready > 0) {
+        /* one packet per pass, the next wait returns at once if more is buffered */
+        mqtt_status = (context->stream_num > 0) ? mqtt_client_stream_receive(context) : MQTTNoDataAvailable;
+        if (mqtt_status == MQTTNoDataAvailable) {
+            mqtt_status = MQTT_ProcessLoop(mqclient, 0);
+        }
+    } else if (ready == 0) {
+        /* nothing to read, so do not let coreMQTT block in recv for the keepalive */
+        if (mqtt_client_keepalive_left(mqclient, mqclient->getTime()) == 0) {
+            if (mqclient->waitingForPingResp) {
+                mqtt_status = MQTTKeepAliveTimeout;
+            } else {
+                mqtt_status = MQTT_Ping(mqclient);
+            }
+        }
+    } else {
+        mqtt_status = MQTTRecvFailed;
+    }
+
+    if (mqtt_status != MQTTSuccess) {
+        log_error("MQTT wait failed with status = %s.", MQTT_Status_strerror(mqtt_status));
+        mqtt_client_disconnect(context);
+        return MQTT_STATUS_NETWORK_TIMEOUT;
+    }
+    return MQTT_STATUS_SUCCESS;
 }
\ No newline at end of file
@@ -21,6 +21,7 @@
 #include "py/nlr.h"
 #include "py/lexer.h"
 #include "py/parse.h"
+#include "py/frozenmod.h"
 #include "shared/runtime/pyexec.h"
 
 #ifdef ENABLE_MICROPYTHON
@@ -35,9 +36,17 @@ extern TUYA_UART_NUM_E sg_repl_uart_num;
 /* MicroPython heap configuration */
 #define MP_HEAP_SIZE        (32 * 1024)  /* 32KB heap for MicroPython GC */
 
+/* Frozen module run at boot when the manifest has one */
+#ifndef MP_BOOT_MODULE
+#define MP_BOOT_MODULE      "main.py"
+#endif
+
 /* MicroPython main task handle */
 static THREAD_HANDLE sg_mp_thread = NULL;
 
+/* micropython_init() time, start of the startup metric */
+static SYS_TIME_T sg_mp_init_ms = 0;
+
 /* Static heap for MicroPython GC */
 static char mp_heap[MP_HEAP_SIZE] __attribute__((aligned(4)));
 
@@ -68,11 +77,29 @@ static int do_str(const char *str) {
     }
 }
 
+/**
+ * @brief Run the boot script, the frozen MP_BOOT_MODULE when there is one
+ * @return "frozen" or "source", how the boot script was loaded
+ */
+static const char *run_boot(void) {
+#if MICROPY_MODULE_FROZEN
+    if (mp_find_frozen_module(MP_BOOT_MODULE, NULL, NULL) == MP_IMPORT_STAT_FILE) {
+        pyexec_frozen_module(MP_BOOT_MODULE, false);
+        return "frozen";
+    }
+#endif
+    /* Parsed and compiled from source on every boot */
+    do_str("print('do_str() -> Hello from MicroPython on T5AI!')");
+    return "source";
+}
+
 /**
  * @brief MicroPython main task
  */
 static void micropython_task(void *arg)
 {
+    SYS_TIME_T task_ms = tal_system_get_millisecond();
+
     PR_NOTICE("MicroPython task started");
 
     /* Initialize HAL first */
@@ -92,10 +119,19 @@ static void micropython_task(void *arg)
     mp_init();
 
     PR_NOTICE("MicroPython initialized, heap size: %d bytes", MP_HEAP_SIZE);
+    SYS_TIME_T runtime_ms = tal_system_get_millisecond();
 
     /* Test basic Python execution */
     PR_NOTICE("Testing Python execution...");
-    do_str("print('do_str() -> Hello from MicroPython on T5AI!')");
+    const char *boot = run_boot();
+
+    /* Startup metric: task start, runtime ready and boot script done, from micropython_init() */
+    SYS_TIME_T boot_ms = tal_system_get_millisecond();
+    gc_info_t gc;
+    gc_info(&gc);
+    PR_NOTICE("MicroPython startup: task %u ms, runtime %u ms, boot %u ms (%s, %u ms), heap used %u bytes",
+              (uint32_t)(task_ms - sg_mp_init_ms), (uint32_t)(runtime_ms - sg_mp_init_ms),
+              (uint32_t)(boot_ms - sg_mp_init_ms), boot, (uint32_t)(boot_ms - runtime_ms), (uint32_t)gc.used);
 
     /* Initialize REPL */
     PR_NOTICE("Starting MicroPython REPL...");
@@ -117,6 +153,7 @@ int micropython_init(void)
     OPERATE_RET rt = OPRT_OK;
 
     PR_NOTICE("Initializing MicroPython for T5AI...");
+    sg_mp_init_ms = tal_system_get_millisecond();
 
     /* Create MicroPython main thread */
     THREAD_CFG_T thread_cfg = {
@@ -0,0 +1,679 @@
+/*
+ * media module for T5AI: audio, display and LED pixel buffers shared with Python
+ *
+ * Python works on the native buffers through the buffer protocol instead of
+ * calling a function per sample or per pixel:
+ *
+ *   import media
+ *   mic = media.AudioIn()          # capture ring filled by tdl_audio
+ *   spk = media.AudioOut()
+ *   while True:
+ *       mic.wait(100)
+ *       pcm = mic.peek()           # memoryview into the ring, no copy
+ *       spk.write(pcm)
+ *       mic.consume(len(pcm))
+ *
+ *   disp = media.Display()
+ *   fb = memoryview(disp)          # the frame buffer itself, RGB565 items
+ *   fb[0:disp.width()] = line
+ *   disp.flush()
+ *
+ *   px = media.Pixels(64)
+ *   memoryview(px)[0:3] = b'\xff\x00\x00'   # RGB888, 3 bytes a pixel
+ *   px.show()
+ *
+ * The native state is allocated outside the GC heap and kept once created,
+ * the capture callback and the display driver keep using it whatever
+ * happens to the Python objects. Creating an object again returns the same
+ * state, close() releases it.
+ */
+
+#include <string.h>
+
+#include "py/runtime.h"
+#include "py/mperrno.h"
+#include "py/objarray.h"
+
+#if MICROPY_PY_TUYA_MEDIA
+
+#include "tal_api.h"
+#include "tuya_ringbuf.h"
+
+#if defined(ENABLE_AUDIO_CODECS) && (ENABLE_AUDIO_CODECS == 1)
+#include "tdl_audio_manage.h"
+#endif
+
+#if defined(ENABLE_DISPLAY) && (ENABLE_DISPLAY == 1)
+#include "tdl_display_manage.h"
+#include "tdl_display_draw.h"
+#endif
+
+#if defined(ENABLE_LEDS_PIXEL) && (ENABLE_LEDS_PIXEL == 1)
+#include "tdl_pixel_dev_manage.h"
+#include "tdl_pixel_color_manage.h"
+#endif
+
+/* Capture ring size, 200 ms of 16 kHz 16 bit mono */
+#ifndef MEDIA_AUDIO_RING_SIZE
+#define MEDIA_AUDIO_RING_SIZE       (6400)
+#endif
+
+/* Longest flush() waits for the driver to release the frame buffer */
+#ifndef MEDIA_DISP_FLUSH_TIMEOUT_MS
+#define MEDIA_DISP_FLUSH_TIMEOUT_MS (100)
+#endif
+
+#ifndef MEDIA_PIXEL_RESOLUTION
+#define MEDIA_PIXEL_RESOLUTION      (1000)
+#endif
+
+static void media_check(OPERATE_RET rt) {
+    if (OPRT_OK == rt) {
+        return;
+    }
+    PR_ERR("media: native call failed %d", rt);
+    mp_raise_OSError((OPRT_MALLOC_FAILED == rt) ? MP_ENOMEM : MP_EIO);
+}
+
+/*
+ * Audio
+ */
+#if defined(ENABLE_AUDIO_CODECS) && (ENABLE_AUDIO_CODECS == 1)
+
+typedef struct {
+    TDL_AUDIO_HANDLE_T handle;
+    TUYA_RINGBUFF_T ring;
+    SEM_HANDLE sem;
+    uint32_t ring_size;
+    uint8_t sample_bytes;
+    volatile uint32_t dropped;
+} MEDIA_AUDIO_IN_T;
+
+typedef struct {
+    mp_obj_base_t base;
+    MEDIA_AUDIO_IN_T *in;
+} media_audio_in_obj_t;
+
+typedef struct {
+    mp_obj_base_t base;
+    TDL_AUDIO_HANDLE_T handle;
+} media_audio_out_obj_t;
+
+static MEDIA_AUDIO_IN_T *sg_audio_in = NULL;
+
+static TDL_AUDIO_HANDLE_T media_audio_find(size_t n_args, const mp_obj_t *args) {
+    TDL_AUDIO_HANDLE_T handle = NULL;
+#if defined(AUDIO_CODEC_NAME)
+    const char *name = (n_args > 0) ? mp_obj_str_get_str(args[0]) : AUDIO_CODEC_NAME;
+#else
+    if (0 == n_args) {
+        mp_raise_TypeError(MP_ERROR_TEXT("device name required"));
+    }
+    const char *name = mp_obj_str_get_str(args[0]);
+#endif
+
+    if (OPRT_OK != tdl_audio_find((char *)name, &handle)) {
+        mp_raise_OSError(MP_ENODEV);
+    }
+    return handle;
+}
+
+/* Runs in the capture thread, the Python side is the only reader of the ring */
+static void media_audio_capture_cb(TDL_AUDIO_HANDLE_T handle, const TDL_AUDIO_FRAME_T *frame, void *arg) {
+    MEDIA_AUDIO_IN_T *in = (MEDIA_AUDIO_IN_T *)arg;
+    (void)handle;
+
+    if (TDL_AUDIO_FRAME_FORMAT_PCM != frame->type || 0 == frame->len) {
+        return;
+    }
+    uint32_t written = tuya_ring_buff_write(in->ring, frame->data, frame->len);
+    if (written < frame->len) {
+        in->dropped += frame->len - written;
+    }
+    tal_semaphore_post(in->sem);
+}
+
+static void media_audio_in_free(MEDIA_AUDIO_IN_T *in) {
+    if (in->ring) {
+        tuya_ring_buff_free(in->ring);
+    }
+    if (in->sem) {
+        tal_semaphore_release(in->sem);
+    }
+    tal_free(in);
+}
+
+static MEDIA_AUDIO_IN_T *media_audio_in_get(media_audio_in_obj_t *self) {
+    if (NULL == self->in || self->in != sg_audio_in) {
+        mp_raise_ValueError(MP_ERROR_TEXT("closed"));
+    }
+    return self->in;
+}
+
+/* AudioIn([name]) */
+static mp_obj_t media_audio_in_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    OPERATE_RET rt = OPRT_OK;
+    mp_arg_check_num(n_args, n_kw, 0, 1, false);
+
+    TDL_AUDIO_HANDLE_T handle = media_audio_find(n_args, args);
+    if (NULL == sg_audio_in) {
+        TDL_AUDIO_INFO_T info = {0};
+        MEDIA_AUDIO_IN_T *in = tal_malloc(sizeof(MEDIA_AUDIO_IN_T));
+        if (NULL == in) {
+            mp_raise_OSError(MP_ENOMEM);
+        }
+        memset(in, 0, sizeof(MEDIA_AUDIO_IN_T));
+        in->handle = handle;
+        in->ring_size = MEDIA_AUDIO_RING_SIZE;
+        in->sample_bytes = 1;
+        if (OPRT_OK == tdl_audio_get_info(handle, &info) && info.sample_bits == 16) {
+            in->sample_bytes = 2;
+        }
+
+        rt = tuya_ring_buff_create(in->ring_size, OVERFLOW_STOP_TYPE, &in->ring);
+        if (OPRT_OK == rt) {
+            rt = tal_semaphore_create_init(&in->sem, 0, 1);
+        }
+        if (OPRT_OK == rt) {
+            rt = tdl_audio_subscribe(handle, media_audio_capture_cb, in);
+        }
+        if (OPRT_OK == rt) {
+            rt = tdl_audio_open(handle, NULL);
+            if (OPRT_OK != rt) {
+                tdl_audio_unsubscribe(handle, media_audio_capture_cb, in);
+            }
+        }
+        if (OPRT_OK != rt) {
+            media_audio_in_free(in);
+            media_check(rt);
+        }
+        sg_audio_in = in;
+    } else if (sg_audio_in->handle != handle) {
+        mp_raise_OSError(MP_EBUSY);
+    }
+
+    media_audio_in_obj_t *self = mp_obj_malloc(media_audio_in_obj_t, type);
+    self->in = sg_audio_in;
+    return MP_OBJ_FROM_PTR(self);
+}
+
+/* The bytes of the ring that are readable without a copy, in whole samples */
+static uint32_t media_audio_in_linear(MEDIA_AUDIO_IN_T *in, uint8_t **data) {
+    uint32_t linear = tuya_ring_buff_peek_linear(in->ring, data);
+    return linear - (linear % in->sample_bytes);
+}
+
+/* peek() -> memoryview of the oldest samples, valid until consume() */
+static mp_obj_t media_audio_in_peek(mp_obj_t self_in) {
+    MEDIA_AUDIO_IN_T *in = media_audio_in_get(MP_OBJ_TO_PTR(self_in));
+    uint8_t *data = NULL;
+
+    /* Everything moves through the ring in whole samples, so none is split at its end */
+    uint32_t linear = media_audio_in_linear(in, &data);
+    return mp_obj_new_memoryview((2 == in->sample_bytes) ? 'h' : 'B', linear / in->sample_bytes, data);
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(media_audio_in_peek_obj, media_audio_in_peek);
+
+/* consume(n) releases n samples of the last peek() */
+static mp_obj_t media_audio_in_consume(mp_obj_t self_in, mp_obj_t n_in) {
+    MEDIA_AUDIO_IN_T *in = media_audio_in_get(MP_OBJ_TO_PTR(self_in));
+    mp_int_t n = mp_obj_get_int(n_in);
+
+    if (n < 0) {
+        mp_raise_ValueError(NULL);
+    }
+    uint32_t len = tuya_ring_buff_discard(in->ring, (uint32_t)n * in->sample_bytes);
+    return MP_OBJ_NEW_SMALL_INT(len / in->sample_bytes);
+}
+static MP_DEFINE_CONST_FUN_OBJ_2(media_audio_in_consume_obj, media_audio_in_consume);
+
+/* readinto(buf) copies out as many whole samples as fit, returns the sample count */
+static mp_obj_t media_audio_in_readinto(mp_obj_t self_in, mp_obj_t buf_in) {
+    MEDIA_AUDIO_IN_T *in = media_audio_in_get(MP_OBJ_TO_PTR(self_in));
+    mp_buffer_info_t bufinfo;
+
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_WRITE);
+    uint32_t len = bufinfo.len - (bufinfo.len % in->sample_bytes);
+    uint32_t used = tuya_ring_buff_used_size_get(in->ring);
+    if (len > used) {
+        len = used - (used % in->sample_bytes);
+    }
+    len = tuya_ring_buff_read(in->ring, bufinfo.buf, len);
+    return MP_OBJ_NEW_SMALL_INT(len / in->sample_bytes);
+}
+static MP_DEFINE_CONST_FUN_OBJ_2(media_audio_in_readinto_obj, media_audio_in_readinto);
+
+/* available() -> samples in the ring */
+static mp_obj_t media_audio_in_available(mp_obj_t self_in) {
+    MEDIA_AUDIO_IN_T *in = media_audio_in_get(MP_OBJ_TO_PTR(self_in));
+    return MP_OBJ_NEW_SMALL_INT(tuya_ring_buff_used_size_get(in->ring) / in->sample_bytes);
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(media_audio_in_available_obj, media_audio_in_available);
+
+/* dropped() -> bytes lost to a full ring since AudioIn() */
+static mp_obj_t media_audio_in_dropped(mp_obj_t self_in) {
+    MEDIA_AUDIO_IN_T *in = media_audio_in_get(MP_OBJ_TO_PTR(self_in));
+    return mp_obj_new_int_from_uint(in->dropped);
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(media_audio_in_dropped_obj, media_audio_in_dropped);
+
+/* wait([timeout_ms]) -> True once a frame arrived, False on timeout */
+static mp_obj_t media_audio_in_wait(size_t n_args, const mp_obj_t *args) {
+    MEDIA_AUDIO_IN_T *in = media_audio_in_get(MP_OBJ_TO_PTR(args[0]));
+    uint32_t timeout = (n_args > 1) ? (uint32_t)mp_obj_get_int(args[1]) : SEM_WAIT_FOREVER;
+
+    if (tuya_ring_buff_used_size_get(in->ring) >= in->sample_bytes) {
+        return mp_const_true;
+    }
+    return mp_obj_new_bool(OPRT_OK == tal_semaphore_wait(in->sem, timeout));
+}
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(media_audio_in_wait_obj, 1, 2, media_audio_in_wait);
+
+static mp_obj_t media_audio_in_close(mp_obj_t self_in) {
+    media_audio_in_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    if (self->in && self->in == sg_audio_in) {
+        tdl_audio_unsubscribe(sg_audio_in->handle, media_audio_capture_cb, sg_audio_in);
+        media_audio_in_free(sg_audio_in);
+        sg_audio_in = NULL;
+    }
+    self->in = NULL;
+    return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(media_audio_in_close_obj, media_audio_in_close);
+
+static const mp_rom_map_elem_t media_audio_in_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_peek), MP_ROM_PTR(&media_audio_in_peek_obj) },
+    { MP_ROM_QSTR(MP_QSTR_consume), MP_ROM_PTR(&media_audio_in_consume_obj) },
+    { MP_ROM_QSTR(MP_QSTR_readinto), MP_ROM_PTR(&media_audio_in_readinto_obj) },
+    { MP_ROM_QSTR(MP_QSTR_available), MP_ROM_PTR(&media_audio_in_available_obj) },
+    { MP_ROM_QSTR(MP_QSTR_dropped), MP_ROM_PTR(&media_audio_in_dropped_obj) },
+    { MP_ROM_QSTR(MP_QSTR_wait), MP_ROM_PTR(&media_audio_in_wait_obj) },
+    { MP_ROM_QSTR(MP_QSTR_close), MP_ROM_PTR(&media_audio_in_close_obj) },
+};
+static MP_DEFINE_CONST_DICT(media_audio_in_locals_dict, media_audio_in_locals_dict_table);
+
+static MP_DEFINE_CONST_OBJ_TYPE(
+    media_audio_in_type,
+    MP_QSTR_AudioIn,
+    MP_TYPE_FLAG_NONE,
+    make_new, media_audio_in_make_new,
+    locals_dict, &media_audio_in_locals_dict
+    );
+
+/* AudioOut([name]) */
+static mp_obj_t media_audio_out_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 0, 1, false);
+
+    TDL_AUDIO_HANDLE_T handle = media_audio_find(n_args, args);
+    media_check(tdl_audio_open(handle, NULL));
+
+    media_audio_out_obj_t *self = mp_obj_malloc(media_audio_out_obj_t, type);
+    self->handle = handle;
+    return MP_OBJ_FROM_PTR(self);
+}
+
+/* write(buf) plays any buffer, a memoryview from AudioIn.peek() included */
+static mp_obj_t media_audio_out_write(mp_obj_t self_in, mp_obj_t buf_in) {
+    media_audio_out_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_buffer_info_t bufinfo;
+
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_READ);
+    if (bufinfo.len) {
+        media_check(tdl_audio_play(self->handle, bufinfo.buf, bufinfo.len));
+    }
+    return MP_OBJ_NEW_SMALL_INT(bufinfo.len);
+}
+static MP_DEFINE_CONST_FUN_OBJ_2(media_audio_out_write_obj, media_audio_out_write);
+
+static const mp_rom_map_elem_t media_audio_out_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_write), MP_ROM_PTR(&media_audio_out_write_obj) },
+};
+static MP_DEFINE_CONST_DICT(media_audio_out_locals_dict, media_audio_out_locals_dict_table);
+
+static MP_DEFINE_CONST_OBJ_TYPE(
+    media_audio_out_type,
+    MP_QSTR_AudioOut,
+    MP_TYPE_FLAG_NONE,
+    make_new, media_audio_out_make_new,
+    locals_dict, &media_audio_out_locals_dict
+    );
+
+#endif /* ENABLE_AUDIO_CODECS */
+
+/*
+ * Display
+ */
+#if defined(ENABLE_DISPLAY) && (ENABLE_DISPLAY == 1)
+
+typedef struct {
+    TDL_DISP_HANDLE_T handle;
+    TDL_DISP_DEV_INFO_T info;
+    TDL_DISP_FRAME_BUFF_T *fb;
+    SEM_HANDLE released;
+} MEDIA_DISP_T;
+
+typedef struct {
+    mp_obj_base_t base;
+    MEDIA_DISP_T *disp;
+} media_display_obj_t;
+
+static MEDIA_DISP_T *sg_disp = NULL;
+
+/* The driver is done with the frame buffer, Python may draw into it again */
+static void media_disp_fb_release(TDL_DISP_FRAME_BUFF_T *fb) {
+    (void)fb;
+    if (sg_disp) {
+        tal_semaphore_post(sg_disp->released);
+    }
+}
+
+static MEDIA_DISP_T *media_display_get(media_display_obj_t *self) {
+    if (NULL == self->disp || self->disp != sg_disp) {
+        mp_raise_ValueError(MP_ERROR_TEXT("closed"));
+    }
+    return self->disp;
+}
+
+/* Display([name]) */
+static mp_obj_t media_display_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    OPERATE_RET rt = OPRT_OK;
+    mp_arg_check_num(n_args, n_kw, 0, 1, false);
+
+#if defined(DISPLAY_NAME)
+    const char *name = (n_args > 0) ? mp_obj_str_get_str(args[0]) : DISPLAY_NAME;
+#else
+    if (0 == n_args) {
+        mp_raise_TypeError(MP_ERROR_TEXT("device name required"));
+    }
+    const char *name = mp_obj_str_get_str(args[0]);
+#endif
+
+    if (NULL == sg_disp) {
+        TDL_DISP_HANDLE_T handle = tdl_disp_find_dev((char *)name);
+        if (NULL == handle) {
+            mp_raise_OSError(MP_ENODEV);
+        }
+        MEDIA_DISP_T *disp = tal_malloc(sizeof(MEDIA_DISP_T));
+        if (NULL == disp) {
+            mp_raise_OSError(MP_ENOMEM);
+        }
+        memset(disp, 0, sizeof(MEDIA_DISP_T));
+        disp->handle = handle;
+
+        rt = tdl_disp_dev_get_info(handle, &disp->info);
+        if (OPRT_OK == rt) {
+            rt = tal_semaphore_create_init(&disp->released, 0, 1);
+        }
+        if (OPRT_OK == rt) {
+            uint32_t bpp = tdl_disp_get_fmt_bpp(disp->info.fmt);
+            uint32_t len = ((uint32_t)disp->info.width * disp->info.height * bpp + 7) / 8;
+            disp->fb = tdl_disp_create_frame_buff(DISP_FB_TP_PSRAM, len);
+            if (NULL == disp->fb) {
+                rt = OPRT_MALLOC_FAILED;
+            }
+        }
+        if (OPRT_OK == rt) {
+            rt = tdl_disp_dev_open(handle);
+            if (OPRT_OK != rt) {
+                tdl_disp_free_frame_buff(disp->fb);
+            }
+        }
+        if (OPRT_OK != rt) {
+            if (disp->released) {
+                tal_semaphore_release(disp->released);
+            }
+            tal_free(disp);
+            media_check(rt);
+        }
+        disp->fb->fmt = disp->info.fmt;
+        disp->fb->width = disp->info.width;
+        disp->fb->height = disp->info.height;
+        disp->fb->free_cb = media_disp_fb_release;
+        memset(disp->fb->frame, 0, disp->fb->len);
+        sg_disp = disp;
+    }
+
+    media_display_obj_t *self = mp_obj_malloc(media_display_obj_t, type);
+    self->disp = sg_disp;
+    return MP_OBJ_FROM_PTR(self);
+}
+
+/* The frame buffer, 16 bit items for RGB565 and bytes otherwise */
+static mp_int_t media_display_get_buffer(mp_obj_t self_in, mp_buffer_info_t *bufinfo, mp_uint_t flags) {
+    media_display_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    (void)flags;
+
+    if (NULL == self->disp || self->disp != sg_disp) {
+        return 1;
+    }
+    bufinfo->buf = self->disp->fb->frame;
+    bufinfo->len = self->disp->fb->len;
+    bufinfo->typecode = (16 == tdl_disp_get_fmt_bpp(self->disp->info.fmt)) ? 'H' : 'B';
+    return 0;
+}
+
+/* flush() sends the frame buffer and returns when the driver released it */
+static mp_obj_t media_display_flush(mp_obj_t self_in) {
+    MEDIA_DISP_T *disp = media_display_get(MP_OBJ_TO_PTR(self_in));
+
+    media_check(tdl_disp_dev_flush(disp->handle, disp->fb));
+    /* Drivers that copy the frame synchronously never call free_cb */
+    tal_semaphore_wait(disp->released, MEDIA_DISP_FLUSH_TIMEOUT_MS);
+    return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(media_display_flush_obj, media_display_flush);
+
+static mp_obj_t media_display_width(mp_obj_t self_in) {
+    return MP_OBJ_NEW_SMALL_INT(media_display_get(MP_OBJ_TO_PTR(self_in))->info.width);
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(media_display_width_obj, media_display_width);
+
+static mp_obj_t media_display_height(mp_obj_t self_in) {
+    return MP_OBJ_NEW_SMALL_INT(media_display_get(MP_OBJ_TO_PTR(self_in))->info.height);
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(media_display_height_obj, media_display_height);
+
+static mp_obj_t media_display_close(mp_obj_t self_in) {
+    media_display_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    if (self->disp && self->disp == sg_disp) {
+        MEDIA_DISP_T *disp = sg_disp;
+        sg_disp = NULL;
+        tdl_disp_dev_close(disp->handle);
+        tdl_disp_free_frame_buff(disp->fb);
+        tal_semaphore_release(disp->released);
+        tal_free(disp);
+    }
+    self->disp = NULL;
+    return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(media_display_close_obj, media_display_close);
+
+static const mp_rom_map_elem_t media_display_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_flush), MP_ROM_PTR(&media_display_flush_obj) },
+    { MP_ROM_QSTR(MP_QSTR_width), MP_ROM_PTR(&media_display_width_obj) },
+    { MP_ROM_QSTR(MP_QSTR_height), MP_ROM_PTR(&media_display_height_obj) },
+    { MP_ROM_QSTR(MP_QSTR_close), MP_ROM_PTR(&media_display_close_obj) },
+};
+static MP_DEFINE_CONST_DICT(media_display_locals_dict, media_display_locals_dict_table);
+
+static MP_DEFINE_CONST_OBJ_TYPE(
+    media_display_type,
+    MP_QSTR_Display,
+    MP_TYPE_FLAG_NONE,
+    make_new, media_display_make_new,
+    buffer, media_display_get_buffer,
+    locals_dict, &media_display_locals_dict
+    );
+
+#endif /* ENABLE_DISPLAY */
+
+/*
+ * LED pixels
+ */
+#if defined(ENABLE_LEDS_PIXEL) && (ENABLE_LEDS_PIXEL == 1)
+
+typedef struct {
+    PIXEL_HANDLE_T handle;
+    uint32_t num;
+    uint8_t *frame;
+} MEDIA_PIXEL_T;
+
+typedef struct {
+    mp_obj_base_t base;
+    MEDIA_PIXEL_T *px;
+} media_pixels_obj_t;
+
+static MEDIA_PIXEL_T *sg_pixel = NULL;
+
+static MEDIA_PIXEL_T *media_pixels_get(media_pixels_obj_t *self) {
+    if (NULL == self->px || self->px != sg_pixel) {
+        mp_raise_ValueError(MP_ERROR_TEXT("closed"));
+    }
+    return self->px;
+}
+
+/* Pixels(num[, name]) */
+static mp_obj_t media_pixels_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    OPERATE_RET rt = OPRT_OK;
+    mp_arg_check_num(n_args, n_kw, 1, 2, false);
+
+    mp_int_t num = mp_obj_get_int(args[0]);
+    if (num <= 0) {
+        mp_raise_ValueError(NULL);
+    }
+#if defined(PIXEL_DEVICE_NAME)
+    const char *name = (n_args > 1) ? mp_obj_str_get_str(args[1]) : PIXEL_DEVICE_NAME;
+#else
+    if (n_args < 2) {
+        mp_raise_TypeError(MP_ERROR_TEXT("device name required"));
+    }
+    const char *name = mp_obj_str_get_str(args[1]);
+#endif
+
+    if (sg_pixel && sg_pixel->num != (uint32_t)num) {
+        mp_raise_OSError(MP_EBUSY);
+    }
+    if (NULL == sg_pixel) {
+        PIXEL_HANDLE_T handle = NULL;
+        if (OPRT_OK != tdl_pixel_dev_find((char *)name, &handle)) {
+            mp_raise_OSError(MP_ENODEV);
+        }
+        MEDIA_PIXEL_T *px = tal_malloc(sizeof(MEDIA_PIXEL_T) + (uint32_t)num * 3);
+        if (NULL == px) {
+            mp_raise_OSError(MP_ENOMEM);
+        }
+        px->handle = handle;
+        px->num = (uint32_t)num;
+        px->frame = (uint8_t *)(px + 1);
+        memset(px->frame, 0, px->num * 3);
+
+        PIXEL_DEV_CONFIG_T cfg = {
+            .pixel_num = px->num,
+            .pixel_resolution = MEDIA_PIXEL_RESOLUTION,
+        };
+        rt = tdl_pixel_dev_open(handle, &cfg);
+        if (OPRT_OK != rt) {
+            tal_free(px);
+            media_check(rt);
+        }
+        sg_pixel = px;
+    }
+
+    media_pixels_obj_t *self = mp_obj_malloc(media_pixels_obj_t, type);
+    self->px = sg_pixel;
+    return MP_OBJ_FROM_PTR(self);
+}
+
+/* The RGB888 frame, R G B bytes for each pixel */
+static mp_int_t media_pixels_get_buffer(mp_obj_t self_in, mp_buffer_info_t *bufinfo, mp_uint_t flags) {
+    media_pixels_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    (void)flags;
+
+    if (NULL == self->px || self->px != sg_pixel) {
+        return 1;
+    }
+    bufinfo->buf = self->px->frame;
+    bufinfo->len = self->px->num * 3;
+    bufinfo->typecode = 'B';
+    return 0;
+}
+
+/* show() converts the whole frame in one pass and refreshes the strip */
+static mp_obj_t media_pixels_show(mp_obj_t self_in) {
+    MEDIA_PIXEL_T *px = media_pixels_get(MP_OBJ_TO_PTR(self_in));
+
+    media_check(tdl_pixel_set_frame(px->handle, 0, px->num, px->frame, PIXEL_FRAME_RGB));
+    media_check(tdl_pixel_dev_refresh(px->handle));
+    return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(media_pixels_show_obj, media_pixels_show);
+
+/* gamma(gamma_x100, brightness) applies to the next show() */
+static mp_obj_t media_pixels_gamma(mp_obj_t self_in, mp_obj_t gamma_in, mp_obj_t bright_in) {
+    MEDIA_PIXEL_T *px = media_pixels_get(MP_OBJ_TO_PTR(self_in));
+
+    media_check(tdl_pixel_set_frame_gamma(px->handle, (uint16_t)mp_obj_get_int(gamma_in),
+                                          (uint8_t)mp_obj_get_int(bright_in)));
+    return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_3(media_pixels_gamma_obj, media_pixels_gamma);
+
+static mp_obj_t media_pixels_close(mp_obj_t self_in) {
+    media_pixels_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    if (self->px && self->px == sg_pixel) {
+        tdl_pixel_dev_close(sg_pixel->handle);
+        tal_free(sg_pixel);
+        sg_pixel = NULL;
+    }
+    self->px = NULL;
+    return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(media_pixels_close_obj, media_pixels_close);
+
+static const mp_rom_map_elem_t media_pixels_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_show), MP_ROM_PTR(&media_pixels_show_obj) },
+    { MP_ROM_QSTR(MP_QSTR_gamma), MP_ROM_PTR(&media_pixels_gamma_obj) },
+    { MP_ROM_QSTR(MP_QSTR_close), MP_ROM_PTR(&media_pixels_close_obj) },
+};
+static MP_DEFINE_CONST_DICT(media_pixels_locals_dict, media_pixels_locals_dict_table);
+
+static MP_DEFINE_CONST_OBJ_TYPE(
+    media_pixels_type,
+    MP_QSTR_Pixels,
+    MP_TYPE_FLAG_NONE,
+    make_new, media_pixels_make_new,
+    buffer, media_pixels_get_buffer,
+    locals_dict, &media_pixels_locals_dict
+    );
+
+#endif /* ENABLE_LEDS_PIXEL */
+
+/*
+ * Module
+ */
+static const mp_rom_map_elem_t media_module_globals_table[] = {
+    { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_media) },
+#if defined(ENABLE_AUDIO_CODECS) && (ENABLE_AUDIO_CODECS == 1)
+    { MP_ROM_QSTR(MP_QSTR_AudioIn), MP_ROM_PTR(&media_audio_in_type) },
+    { MP_ROM_QSTR(MP_QSTR_AudioOut), MP_ROM_PTR(&media_audio_out_type) },
+#endif
+#if defined(ENABLE_DISPLAY) && (ENABLE_DISPLAY == 1)
+    { MP_ROM_QSTR(MP_QSTR_Display), MP_ROM_PTR(&media_display_type) },
+#endif
+#if defined(ENABLE_LEDS_PIXEL) && (ENABLE_LEDS_PIXEL == 1)
+    { MP_ROM_QSTR(MP_QSTR_Pixels), MP_ROM_PTR(&media_pixels_type) },
+#endif
+};
+static MP_DEFINE_CONST_DICT(media_module_globals, media_module_globals_table);
+
+const mp_obj_module_t media_module = {
+    .base = { &mp_type_module },
+    .globals = (mp_obj_dict_t *)&media_module_globals,
+};
+
+MP_REGISTER_MODULE(MP_QSTR_media, media_module);
+
+#endif /* MICROPY_PY_TUYA_MEDIA */
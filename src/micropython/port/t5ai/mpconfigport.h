@@ -19,7 +19,9 @@
 #define MICROPY_ENABLE_COMPILER     (1)  /* Enable compiler for minimal functionality */
 #define MICROPY_ENABLE_GC           (1)  /* Enable GC for memory management */
 #define MICROPY_HELPER_REPL         (1)  /* Enable REPL for testing */
-#define MICROPY_MODULE_FROZEN_MPY   (0)
+#ifndef MICROPY_MODULE_FROZEN_MPY
+#define MICROPY_MODULE_FROZEN_MPY   (0)  /* Set by CONFIG_MICROPYTHON_FROZEN_MANIFEST */
+#endif
 #define MICROPY_QSTR_BYTES_IN_HASH  (2)  /* Use 2 bytes for hash to avoid overflow */
 
 /* Core Python features - disabled for minimal build */
@@ -28,8 +30,8 @@
 #define MICROPY_PY_BUILTINS_DICT    (0)
 #define MICROPY_PY_BUILTINS_SET     (0)
 #define MICROPY_PY_BUILTINS_FROZENSET (0)
-#define MICROPY_PY_BUILTINS_MEMORYVIEW (0)
-#define MICROPY_PY_BUILTINS_SLICE   (0)
+#define MICROPY_PY_BUILTINS_MEMORYVIEW (1)  /* Views over the media module buffers */
+#define MICROPY_PY_BUILTINS_SLICE   (1)  /* mv[a:b] without copying */
 #define MICROPY_PY_BUILTINS_PROPERTY (0)
 
 /* Memory allocation - will be replaced with real implementation */
@@ -44,6 +46,14 @@
 
 /* Platform specific - ARM Cortex-M33 */
 #define MICROPY_NLR_THUMB           (1)
+
+/* @micropython.native and @micropython.viper, set by CONFIG_MICROPYTHON_EMIT_NATIVE */
+#ifndef MICROPY_EMIT_THUMB
+#define MICROPY_EMIT_THUMB          (0)
+#endif
+#define MICROPY_EMIT_THUMB_ARMV7M   (1)  /* Cortex-M33 has the Thumb-2 wide encodings */
+/* Thumb code is entered with bit 0 of the address set */
+#define MICROPY_MAKE_POINTER_CALLABLE(p) ((void *)((mp_uint_t)(p) | 1))
 #define MICROPY_LONGINT_IMPL        (MICROPY_LONGINT_IMPL_MPZ)
 
 /* Use core features configuration level for basic Python functionality */
@@ -122,4 +132,9 @@ extern const struct _mp_print_t mp_plat_print;
 /* Tuya module configuration (disabled for now) */
 #define MICROPY_PY_TUYA             (0)
 
+/* media module: tdl_audio, display and LED pixel buffers through the buffer protocol */
+#ifndef MICROPY_PY_TUYA_MEDIA
+#define MICROPY_PY_TUYA_MEDIA       (1)
+#endif
+
 #endif /* MICROPYTHON_MPCONFIGPORT_H */
@@ -51,6 +51,14 @@ typedef enum {
     TDD_ALSA_DATABITS_32 = 32,
 } TDD_ALSA_DATABITS_E;
 
+// shortest period_ms accepted, below this the scheduler jitter dominates
+#define TDD_ALSA_PERIOD_MS_MIN 5
+
+// periods in the ring when the buffer is sized from period_ms
+#ifndef TDD_ALSA_PERIODS_PER_BUFFER
+#define TDD_ALSA_PERIODS_PER_BUFFER 3
+#endif
+
 // ALSA audio channels
 typedef enum {
     TDD_ALSA_CHANNEL_MONO = 1,
@@ -80,6 +88,14 @@ typedef struct {
     // Buffer settings
     uint32_t buffer_frames;               /**< ALSA buffer size in frames */
     uint32_t period_frames;               /**< ALSA period size in frames */
+    uint32_t period_ms;                   /**< Period in ms, 0 uses buffer_frames / period_frames. Otherwise
+                                               at least TDD_ALSA_PERIOD_MS_MIN, the buffer then holds
+                                               TDD_ALSA_PERIODS_PER_BUFFER periods */
+
+    // Low latency options
+    uint8_t mmap_enable;                  /**< Use mmap access, falls back to read/write when refused */
+    uint8_t rt_priority;                  /**< SCHED_FIFO priority 1..99 of the capture thread and the
+                                               thread feeding playback, 0 keeps the default policy */
 
     // Optional features
     uint8_t aec_enable;                   /**< Enable acoustic echo cancellation (future use) */
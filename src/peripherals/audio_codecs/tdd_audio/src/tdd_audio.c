@@ -173,6 +173,11 @@ static OPERATE_RET __tdd_audio_config(TDD_AUDIO_HANDLE_T handle, TDD_AUDIO_CMD_E
         // Stop play here
         TUYA_CALL_ERR_GOTO(tkl_ao_clear_buffer(TKL_AUDIO_TYPE_BOARD, 0), __EXIT);
     } break;
+    case TDD_AUDIO_CMD_MIC_RESTART: {
+        // Restart the ADC stream only, the codec setup and the speaker stay as they are
+        TUYA_CALL_ERR_GOTO(tkl_ai_stop(TKL_AUDIO_TYPE_BOARD, 0), __EXIT);
+        TUYA_CALL_ERR_GOTO(tkl_ai_start(0, 0), __EXIT);
+    } break;
     default:
         rt = OPRT_INVALID_PARM;
         break;
@@ -185,6 +190,16 @@ __EXIT:
 static OPERATE_RET __tdd_audio_close(TDD_AUDIO_HANDLE_T handle)
 {
     OPERATE_RET rt = OPRT_OK;
+    TDD_AUDIO_DATA_HANDLE_T *hdl = (TDD_AUDIO_DATA_HANDLE_T *)handle;
+
+    TUYA_CHECK_NULL_RETURN(hdl, OPRT_COM_ERROR);
+
+    // Release the ADC/DAC so a later open can init them again,
+    // otherwise tkl_ai_init fails with "aud adc is init already"
+    TUYA_CALL_ERR_LOG(tkl_ai_stop(TKL_AUDIO_TYPE_BOARD, 0));
+    TUYA_CALL_ERR_LOG(tkl_ai_uninit());
+
+    hdl->mic_cb = NULL;
 
     return rt;
 }
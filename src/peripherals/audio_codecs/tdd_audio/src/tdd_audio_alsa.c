@@ -14,6 +14,8 @@
  * - Speaker playback with ALSA PCM interface
  * - Volume control through ALSA mixer API
  * - Frame-based audio data processing
+ * - Low latency mode: mmap access, periods down to TDD_ALSA_PERIOD_MS_MIN and
+ *   SCHED_FIFO for the capture thread and the thread feeding playback
  * - Proper resource cleanup and error handling
  *
  * This implementation bridges the ALSA library APIs with the higher-level
@@ -29,6 +31,7 @@
 
 #include <alsa/asoundlib.h>
 #include <pthread.h>
+#include <sched.h>
 
 #include "tal_log.h"
 #include "tal_memory.h"
@@ -61,6 +64,13 @@ typedef struct {
     pthread_t capture_thread;
     volatile uint8_t capture_running;
 
+    // Negotiated with the device, may differ from cfg
+    snd_pcm_uframes_t capture_period;
+    snd_pcm_uframes_t playback_period;
+    uint8_t capture_mmap;
+    uint8_t playback_mmap;
+    uint8_t playback_rt_set;
+
     // Playback settings
     uint8_t play_volume;
     long mixer_min;
@@ -106,13 +116,113 @@ static snd_pcm_format_t __get_alsa_format(TDD_ALSA_DATABITS_E bits)
     }
 }
 
+/**
+ * @brief Apply the buffer layout of cfg: period_ms when set, the frame counts otherwise
+ */
+static void __alsa_period_frames(const TDD_AUDIO_ALSA_CFG_T *cfg, uint32_t rate, snd_pcm_uframes_t *period,
+                                 snd_pcm_uframes_t *buffer)
+{
+    if (cfg->period_ms) {
+        uint32_t ms = (cfg->period_ms < TDD_ALSA_PERIOD_MS_MIN) ? TDD_ALSA_PERIOD_MS_MIN : cfg->period_ms;
+        *period = rate * ms / 1000;
+        *buffer = *period * TDD_ALSA_PERIODS_PER_BUFFER;
+    } else {
+        *period = cfg->period_frames;
+        *buffer = cfg->buffer_frames;
+    }
+}
+
+/**
+ * @brief Set hardware and software parameters of an opened PCM
+ *
+ * mmap access is tried first when enabled. Playback starts as soon as one
+ * period is queued instead of when the ring is full, which is the ALSA
+ * default and would add a whole buffer of latency.
+ */
+static OPERATE_RET __alsa_set_params(TDD_AUDIO_ALSA_HANDLE_T *hdl, snd_pcm_t *pcm, unsigned int *rate,
+                                     snd_pcm_uframes_t *period, uint8_t *mmap)
+{
+    int err;
+    snd_pcm_hw_params_t *hw_params = NULL;
+    snd_pcm_sw_params_t *sw_params = NULL;
+    snd_pcm_uframes_t buffer_size = 0;
+
+    // Allocate hardware parameters object
+    snd_pcm_hw_params_alloca(&hw_params);
+    snd_pcm_hw_params_any(pcm, hw_params);
+
+    // Set parameters
+    *mmap = 0;
+    if (hdl->cfg.mmap_enable &&
+        0 == snd_pcm_hw_params_set_access(pcm, hw_params, SND_PCM_ACCESS_MMAP_INTERLEAVED)) {
+        *mmap = 1;
+    } else {
+        if (hdl->cfg.mmap_enable) {
+            PR_WARN("ALSA mmap access not supported, using read/write");
+        }
+        snd_pcm_hw_params_set_access(pcm, hw_params, SND_PCM_ACCESS_RW_INTERLEAVED);
+    }
+    snd_pcm_hw_params_set_format(pcm, hw_params, __get_alsa_format(hdl->cfg.data_bits));
+    snd_pcm_hw_params_set_channels(pcm, hw_params, hdl->cfg.channels);
+    snd_pcm_hw_params_set_rate_near(pcm, hw_params, rate, 0);
+
+    // Set buffer and period sizes
+    __alsa_period_frames(&hdl->cfg, *rate, period, &buffer_size);
+    snd_pcm_hw_params_set_buffer_size_near(pcm, hw_params, &buffer_size);
+    snd_pcm_hw_params_set_period_size_near(pcm, hw_params, period, 0);
+
+    // Write parameters to device
+    err = snd_pcm_hw_params(pcm, hw_params);
+    if (err < 0) {
+        PR_ERR("Cannot set hw parameters: %s", snd_strerror(err));
+        return OPRT_COM_ERROR;
+    }
+    snd_pcm_hw_params_get_period_size(hw_params, period, 0);
+    snd_pcm_hw_params_get_buffer_size(hw_params, &buffer_size);
+
+    snd_pcm_sw_params_alloca(&sw_params);
+    snd_pcm_sw_params_current(pcm, sw_params);
+    snd_pcm_sw_params_set_avail_min(pcm, sw_params, *period);
+    snd_pcm_sw_params_set_start_threshold(pcm, sw_params, *period);
+    err = snd_pcm_sw_params(pcm, sw_params);
+    if (err < 0) {
+        PR_WARN("Cannot set sw parameters: %s", snd_strerror(err));
+    }
+
+    PR_INFO("ALSA period %lu frames (%lu ms), buffer %lu frames, %s", (unsigned long)*period,
+            (unsigned long)(*period * 1000 / *rate), (unsigned long)buffer_size, *mmap ? "mmap" : "rw");
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief Move the calling thread to SCHED_FIFO at cfg.rt_priority
+ */
+static void __alsa_set_rt_priority(TDD_AUDIO_ALSA_HANDLE_T *hdl, const char *who)
+{
+    struct sched_param param = {0};
+    int err;
+
+    if (0 == hdl->cfg.rt_priority) {
+        return;
+    }
+
+    param.sched_priority = hdl->cfg.rt_priority;
+    err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (err != 0) {
+        // EPERM without CAP_SYS_NICE or an rtprio limit, keep running at normal priority
+        PR_WARN("ALSA %s thread SCHED_FIFO %d refused: %d", who, hdl->cfg.rt_priority, err);
+    } else {
+        PR_INFO("ALSA %s thread SCHED_FIFO %d", who, hdl->cfg.rt_priority);
+    }
+}
+
 /**
  * @brief Setup ALSA capture device
  */
 static OPERATE_RET __alsa_setup_capture(TDD_AUDIO_ALSA_HANDLE_T *hdl)
 {
     int err;
-    snd_pcm_hw_params_t *hw_params = NULL;
 
     // Open PCM device for capture (non-blocking mode to avoid hanging)
     err = snd_pcm_open(&hdl->capture_handle, hdl->cfg.capture_device, SND_PCM_STREAM_CAPTURE, SND_PCM_NONBLOCK);
@@ -125,26 +235,9 @@ static OPERATE_RET __alsa_setup_capture(TDD_AUDIO_ALSA_HANDLE_T *hdl)
     // Switch back to blocking mode for normal operation
     snd_pcm_nonblock(hdl->capture_handle, 0);
 
-    // Allocate hardware parameters object
-    snd_pcm_hw_params_alloca(&hw_params);
-    snd_pcm_hw_params_any(hdl->capture_handle, hw_params);
-
-    // Set parameters
-    snd_pcm_hw_params_set_access(hdl->capture_handle, hw_params, SND_PCM_ACCESS_RW_INTERLEAVED);
-    snd_pcm_hw_params_set_format(hdl->capture_handle, hw_params, __get_alsa_format(hdl->cfg.data_bits));
-    snd_pcm_hw_params_set_channels(hdl->capture_handle, hw_params, hdl->cfg.channels);
-    snd_pcm_hw_params_set_rate_near(hdl->capture_handle, hw_params, (unsigned int *)&hdl->cfg.sample_rate, 0);
-
-    // Set buffer and period sizes
-    snd_pcm_uframes_t buffer_size = hdl->cfg.buffer_frames;
-    snd_pcm_uframes_t period_size = hdl->cfg.period_frames;
-    snd_pcm_hw_params_set_buffer_size_near(hdl->capture_handle, hw_params, &buffer_size);
-    snd_pcm_hw_params_set_period_size_near(hdl->capture_handle, hw_params, &period_size, 0);
-
-    // Write parameters to device
-    err = snd_pcm_hw_params(hdl->capture_handle, hw_params);
-    if (err < 0) {
-        PR_ERR("Cannot set capture parameters: %s", snd_strerror(err));
+    if (OPRT_OK != __alsa_set_params(hdl, hdl->capture_handle, (unsigned int *)&hdl->cfg.sample_rate,
+                                     &hdl->capture_period, &hdl->capture_mmap)) {
+        PR_ERR("Cannot set capture parameters");
         snd_pcm_close(hdl->capture_handle);
         hdl->capture_handle = NULL;
         return OPRT_COM_ERROR;
@@ -160,7 +253,7 @@ static OPERATE_RET __alsa_setup_capture(TDD_AUDIO_ALSA_HANDLE_T *hdl)
     }
 
     // Calculate buffer size
-    hdl->capture_buffer_size = hdl->cfg.period_frames * hdl->cfg.channels * (hdl->cfg.data_bits / 8);
+    hdl->capture_buffer_size = hdl->capture_period * hdl->cfg.channels * (hdl->cfg.data_bits / 8);
     hdl->capture_buffer = (uint8_t *)tal_malloc(hdl->capture_buffer_size);
     if (NULL == hdl->capture_buffer) {
         PR_ERR("Cannot allocate capture buffer");
@@ -181,7 +274,6 @@ static OPERATE_RET __alsa_setup_capture(TDD_AUDIO_ALSA_HANDLE_T *hdl)
 static OPERATE_RET __alsa_setup_playback(TDD_AUDIO_ALSA_HANDLE_T *hdl)
 {
     int err;
-    snd_pcm_hw_params_t *hw_params = NULL;
 
     // Open PCM device for playback (non-blocking mode to avoid hanging)
     err = snd_pcm_open(&hdl->playback_handle, hdl->cfg.playback_device, SND_PCM_STREAM_PLAYBACK, SND_PCM_NONBLOCK);
@@ -194,26 +286,9 @@ static OPERATE_RET __alsa_setup_playback(TDD_AUDIO_ALSA_HANDLE_T *hdl)
     // Switch back to blocking mode for normal operation
     snd_pcm_nonblock(hdl->playback_handle, 0);
 
-    // Allocate hardware parameters object
-    snd_pcm_hw_params_alloca(&hw_params);
-    snd_pcm_hw_params_any(hdl->playback_handle, hw_params);
-
-    // Set parameters
-    snd_pcm_hw_params_set_access(hdl->playback_handle, hw_params, SND_PCM_ACCESS_RW_INTERLEAVED);
-    snd_pcm_hw_params_set_format(hdl->playback_handle, hw_params, __get_alsa_format(hdl->cfg.data_bits));
-    snd_pcm_hw_params_set_channels(hdl->playback_handle, hw_params, hdl->cfg.channels);
-    snd_pcm_hw_params_set_rate_near(hdl->playback_handle, hw_params, (unsigned int *)&hdl->cfg.spk_sample_rate, 0);
-
-    // Set buffer and period sizes
-    snd_pcm_uframes_t buffer_size = hdl->cfg.buffer_frames;
-    snd_pcm_uframes_t period_size = hdl->cfg.period_frames;
-    snd_pcm_hw_params_set_buffer_size_near(hdl->playback_handle, hw_params, &buffer_size);
-    snd_pcm_hw_params_set_period_size_near(hdl->playback_handle, hw_params, &period_size, 0);
-
-    // Write parameters to device
-    err = snd_pcm_hw_params(hdl->playback_handle, hw_params);
-    if (err < 0) {
-        PR_ERR("Cannot set playback parameters: %s", snd_strerror(err));
+    if (OPRT_OK != __alsa_set_params(hdl, hdl->playback_handle, (unsigned int *)&hdl->cfg.spk_sample_rate,
+                                     &hdl->playback_period, &hdl->playback_mmap)) {
+        PR_ERR("Cannot set playback parameters");
         snd_pcm_close(hdl->playback_handle);
         hdl->playback_handle = NULL;
         return OPRT_COM_ERROR;
@@ -304,10 +379,15 @@ static void *__alsa_capture_thread(void *arg)
     snd_pcm_sframes_t frames;
 
     PR_INFO("ALSA capture thread started");
+    __alsa_set_rt_priority(hdl, "capture");
 
     while (hdl->capture_running) {
         // Read audio frames
-        frames = snd_pcm_readi(hdl->capture_handle, hdl->capture_buffer, hdl->cfg.period_frames);
+        if (hdl->capture_mmap) {
+            frames = snd_pcm_mmap_readi(hdl->capture_handle, hdl->capture_buffer, hdl->capture_period);
+        } else {
+            frames = snd_pcm_readi(hdl->capture_handle, hdl->capture_buffer, hdl->capture_period);
+        }
 
         if (frames < 0) {
             // Handle buffer overrun
@@ -415,18 +495,26 @@ static OPERATE_RET __tdd_audio_alsa_play(TDD_AUDIO_HANDLE_T handle, uint8_t *dat
         return OPRT_COM_ERROR;
     }
 
+    // the first caller is the thread feeding playback, tdl_audio's play task
+    if (!hdl->playback_rt_set) {
+        hdl->playback_rt_set = 1;
+        __alsa_set_rt_priority(hdl, "playback");
+    }
+
     // Calculate number of frames
     uint32_t frame_size = hdl->cfg.channels * (hdl->cfg.data_bits / 8);
     snd_pcm_uframes_t frames = len / frame_size;
 
     // Write audio frames
-    snd_pcm_sframes_t written = snd_pcm_writei(hdl->playback_handle, data, frames);
+    snd_pcm_sframes_t written = hdl->playback_mmap ? snd_pcm_mmap_writei(hdl->playback_handle, data, frames)
+                                                   : snd_pcm_writei(hdl->playback_handle, data, frames);
     if (written < 0) {
         // Handle buffer underrun
         if (written == -EPIPE) {
             PR_WARN("ALSA playback underrun occurred");
             snd_pcm_prepare(hdl->playback_handle);
-            written = snd_pcm_writei(hdl->playback_handle, data, frames);
+            written = hdl->playback_mmap ? snd_pcm_mmap_writei(hdl->playback_handle, data, frames)
+                                         : snd_pcm_writei(hdl->playback_handle, data, frames);
         }
 
         if (written < 0) {
@@ -494,6 +582,17 @@ static OPERATE_RET __tdd_audio_alsa_config(TDD_AUDIO_HANDLE_T handle, TDD_AUDIO_
         }
     } break;
 
+    case TDD_AUDIO_CMD_GET_PLAY_QUEUE: {
+        TDD_AUDIO_ALSA_HANDLE_T *hdl = (TDD_AUDIO_ALSA_HANDLE_T *)handle;
+        snd_pcm_sframes_t delay = 0;
+        TUYA_CHECK_NULL_GOTO(args, __EXIT);
+        // frames written but not yet out of the DAC, 0 after an underrun
+        if (NULL == hdl->playback_handle || snd_pcm_delay(hdl->playback_handle, &delay) < 0 || delay < 0) {
+            delay = 0;
+        }
+        *(uint32_t *)args = (uint32_t)delay;
+    } break;
+
     default:
         rt = OPRT_INVALID_PARM;
         break;
@@ -571,6 +670,10 @@ OPERATE_RET tdd_audio_alsa_register(char *name, TDD_AUDIO_ALSA_CFG_T cfg)
     info.sample_ch_num = cfg.channels;
     info.sample_bits   = cfg.data_bits;
     info.sample_tm_ms   = AUDIO_PCM_FRAME_MS;
+    if (cfg.period_ms) {
+        // one capture period per mic callback
+        info.sample_tm_ms = (cfg.period_ms < TDD_ALSA_PERIOD_MS_MIN) ? TDD_ALSA_PERIOD_MS_MIN : cfg.period_ms;
+    }
 
     // Setup interface functions
     intfs.open = __tdd_audio_alsa_open;
@@ -54,8 +54,10 @@ typedef uint8_t TDL_AUDIO_STATUS_E;
 
 // Audio command
 typedef uint8_t TDD_AUDIO_CMD_E;
-#define TDD_AUDIO_CMD_SET_VOLUME 0
-#define TDD_AUDIO_CMD_PLAY_STOP  1
+#define TDD_AUDIO_CMD_SET_VOLUME     0
+#define TDD_AUDIO_CMD_PLAY_STOP      1
+#define TDD_AUDIO_CMD_GET_PLAY_QUEUE 2 // args: uint32_t *, samples accepted but not yet played
+#define TDD_AUDIO_CMD_MIC_RESTART    3 // args: NULL, restart the capture stream, playback and setup stay
 
 /***********************************************************
 ***********************typedef define***********************
@@ -11,7 +11,9 @@
  * Key functionalities:
  * - Audio device discovery by name
  * - Opening audio devices with microphone callback support
- * - Audio playback control
+ * - Capture fan-out to several subscribers, optionally batched into frames
+ *   of a chosen duration
+ * - Audio playback control, blocking or queued with a completion callback
  * - Volume adjustment
  * - Device lifecycle management
  *
@@ -39,6 +41,25 @@ extern "C" {
 ***********************************************************/
 typedef void *TDL_AUDIO_HANDLE_T;
 
+// capture callbacks per device, tdl_audio_open() callbacks included
+#ifndef TDL_AUDIO_SUBSCRIBER_MAX
+#define TDL_AUDIO_SUBSCRIBER_MAX 4
+#endif
+
+// batch and held frame buffers per device
+#ifndef TDL_AUDIO_CAPTURE_BUF_NUM
+#define TDL_AUDIO_CAPTURE_BUF_NUM 4
+#endif
+
+// tdl_audio_play_async() buffers queued per device
+#ifndef TDL_AUDIO_PLAY_QUEUE_MAX
+#define TDL_AUDIO_PLAY_QUEUE_MAX 4
+#endif
+
+#ifndef TDL_AUDIO_PLAY_TASK_STACK
+#define TDL_AUDIO_PLAY_TASK_STACK 2048
+#endif
+
 /***********************************************************
 ***********************typedef define***********************
 ***********************************************************/
@@ -50,20 +71,170 @@ typedef struct {
     uint16_t frame_size;
 }TDL_AUDIO_INFO_T;
 
+typedef struct {
+    TDL_AUDIO_FRAME_FORMAT_E type;
+    TDL_AUDIO_STATUS_E       status;
+    const uint8_t           *data;
+    uint32_t                 len;
+    uint32_t                 seq;  // capture frame counter of the device
+} TDL_AUDIO_FRAME_T;
+
+typedef struct {
+    uint32_t frames;     // frames delivered to the subscribers
+    uint32_t copies;     // driver frames copied by a hold
+    uint32_t drop_buf;   // batch or hold that found no free buffer
+} TDL_AUDIO_CAPTURE_STAT_T;
+
+/**
+ * @brief capture callback, called in the driver capture context
+ *
+ * The frame is shared by all subscribers and must not be written. Without
+ * batching data points into the driver buffer and is only valid during the
+ * call. A subscriber that keeps the frame longer calls tdl_audio_frame_hold()
+ * and passes the returned frame to tdl_audio_frame_release() when done.
+ */
+typedef void (*TDL_AUDIO_CAPTURE_CB)(TDL_AUDIO_HANDLE_T handle, const TDL_AUDIO_FRAME_T *frame, void *arg);
+
+/**
+ * @brief completion of a tdl_audio_play_async() buffer, called in the play task
+ *
+ * result is OPRT_OK once the driver took the whole buffer, the driver error,
+ * or OPRT_RESOURCE_NOT_READY when tdl_audio_play_stop() or tdl_audio_close()
+ * flushed it unplayed. The buffer may be reused from here on.
+ */
+typedef void (*TDL_AUDIO_PLAY_DONE_CB)(TDL_AUDIO_HANDLE_T handle, const uint8_t *data, uint32_t len,
+                                       OPERATE_RET result, void *arg);
+
 /***********************************************************
 ********************function declaration********************
 ***********************************************************/
 
 OPERATE_RET tdl_audio_find(char *name, TDL_AUDIO_HANDLE_T *handle);
 
+/**
+ * @brief open the device, a second open only subscribes mic_cb
+ *
+ * @param[in] handle audio handle
+ * @param[in] mic_cb capture callback, may be NULL, stays subscribed after
+ * tdl_audio_close()
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
 OPERATE_RET tdl_audio_open(TDL_AUDIO_HANDLE_T handle, TDL_AUDIO_MIC_CB mic_cb);
 
+/**
+ * @brief add a capture callback, before or after tdl_audio_open()
+ *
+ * @param[in] handle audio handle
+ * @param[in] cb capture callback
+ * @param[in] arg passed to cb
+ *
+ * @return OPRT_OK on success, OPRT_EXCEED_UPPER_LIMIT when the device already
+ * has TDL_AUDIO_SUBSCRIBER_MAX callbacks
+ */
+OPERATE_RET tdl_audio_subscribe(TDL_AUDIO_HANDLE_T handle, TDL_AUDIO_CAPTURE_CB cb, void *arg);
+
+/**
+ * @brief remove a capture callback
+ *
+ * @param[in] handle audio handle
+ * @param[in] cb capture callback
+ * @param[in] arg arg it was subscribed with
+ *
+ * @return OPRT_OK on success, OPRT_NOT_FOUND when cb is not subscribed
+ */
+OPERATE_RET tdl_audio_unsubscribe(TDL_AUDIO_HANDLE_T handle, TDL_AUDIO_CAPTURE_CB cb, void *arg);
+
+/**
+ * @brief batch PCM capture into frames of frame_tm_ms, while closed
+ *
+ * @param[in] handle audio handle
+ * @param[in] frame_tm_ms frame duration, 0 delivers the driver frames as is
+ *
+ * @return OPRT_OK on success, OPRT_RESOURCE_NOT_READY while the device is
+ * open or frames are held
+ */
+OPERATE_RET tdl_audio_set_frame_tm(TDL_AUDIO_HANDLE_T handle, uint16_t frame_tm_ms);
+
+/**
+ * @brief keep a frame after its callback returned
+ *
+ * A driver frame is copied into a device buffer once, further holders of
+ * the same frame share the copy.
+ *
+ * @param[in] frame frame passed to a TDL_AUDIO_CAPTURE_CB
+ *
+ * @return the frame to read and release, NULL when no buffer was free
+ */
+const TDL_AUDIO_FRAME_T *tdl_audio_frame_hold(const TDL_AUDIO_FRAME_T *frame);
+
+/**
+ * @brief give back a frame returned by tdl_audio_frame_hold()
+ *
+ * @param[in] frame the held frame
+ */
+void tdl_audio_frame_release(const TDL_AUDIO_FRAME_T *frame);
+
+OPERATE_RET tdl_audio_get_capture_stat(TDL_AUDIO_HANDLE_T handle, TDL_AUDIO_CAPTURE_STAT_T *stat);
+
 OPERATE_RET tdl_audio_get_info(TDL_AUDIO_HANDLE_T handle, TDL_AUDIO_INFO_T *info);
 
 OPERATE_RET tdl_audio_play(TDL_AUDIO_HANDLE_T handle, uint8_t *data, uint32_t len);
 
+/**
+ * @brief queue a buffer for playback and return at once
+ *
+ * A play task created on first use hands the buffers to the driver in order,
+ * so the caller can prepare the next buffer while this one plays. Do not mix
+ * with tdl_audio_play() on the same device, a blocking play would overtake
+ * the queue.
+ *
+ * @param[in] handle audio handle
+ * @param[in] data PCM, must stay valid until cb
+ * @param[in] len bytes
+ * @param[in] cb completion, may be NULL
+ * @param[in] arg passed to cb
+ *
+ * @return OPRT_OK when queued, OPRT_EXCEED_UPPER_LIMIT when
+ * TDL_AUDIO_PLAY_QUEUE_MAX buffers are pending
+ */
+OPERATE_RET tdl_audio_play_async(TDL_AUDIO_HANDLE_T handle, const uint8_t *data, uint32_t len,
+                                 TDL_AUDIO_PLAY_DONE_CB cb, void *arg);
+
+/**
+ * @brief samples submitted but not yet played
+ *
+ * The samples queued by tdl_audio_play_async() plus those the driver holds,
+ * when the driver reports them through TDD_AUDIO_CMD_GET_PLAY_QUEUE.
+ * Divided by the sample rate this is the output latency.
+ *
+ * @param[in] handle audio handle
+ * @param[out] samples queue depth in samples
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tdl_audio_get_play_queue(TDL_AUDIO_HANDLE_T handle, uint32_t *samples);
+
+/**
+ * @brief stop playback and flush the tdl_audio_play_async() queue
+ */
 OPERATE_RET tdl_audio_play_stop(TDL_AUDIO_HANDLE_T handle);
 
+/**
+ * @brief restart the capture stream of an open device
+ *
+ * Recovers a stalled microphone without a close and open: the device setup,
+ * playback and the capture subscribers all stay in place.
+ *
+ * @param[in] handle audio handle
+ *
+ * @return OPRT_OK on success, OPRT_RESOURCE_NOT_READY while the device is
+ * closed, an error when the driver has no TDD_AUDIO_CMD_MIC_RESTART
+ */
+OPERATE_RET tdl_audio_mic_restart(TDL_AUDIO_HANDLE_T handle);
+
 OPERATE_RET tdl_audio_volume_set(TDL_AUDIO_HANDLE_T handle, uint8_t volume);
 
 OPERATE_RET tdl_audio_close(TDL_AUDIO_HANDLE_T handle);
@@ -14,6 +14,14 @@
  * - Audio device discovery by name
  * - Unified interface for audio operations (open, play, volume control, close)
  * - Memory management for driver nodes
+ * - Capture fan-out: the driver calls one TDL dispatcher, which passes each
+ *   frame to every subscriber without copying. Only a hold copies a driver
+ *   frame, once, into a reference counted device buffer, and PCM batching
+ *   assembles its frames in those buffers directly.
+ * - Queued playback: tdl_audio_play_async() posts buffers to a per device
+ *   play task, which blocks in the driver instead of the caller. A flush
+ *   bumps a generation counter, queued buffers of an older generation are
+ *   completed without being played.
  * - Error handling and validation
  *
  * The management layer acts as a bridge between applications and the underlying
@@ -28,6 +36,9 @@
 
 // #include "tal_api.h"
 #include "tal_memory.h"
+#include "tal_system.h"
+#include "tal_queue.h"
+#include "tal_thread.h"
 #include "tal_log.h"
 
 /***********************************************************
@@ -37,6 +48,29 @@
 /***********************************************************
 ***********************typedef define***********************
 ***********************************************************/
+typedef struct {
+    TDL_AUDIO_CAPTURE_CB capture_cb;
+    TDL_AUDIO_MIC_CB     mic_cb;
+    void                *arg;
+} TDL_AUDIO_SUBSCRIBER_T;
+
+// frame must stay the first member, frames handed out are cast back
+typedef struct audio_buf {
+    TDL_AUDIO_FRAME_T  frame;
+    struct list_node  *node;
+    struct audio_buf  *copy;    // driver frame: the buffer the first hold copied it to
+    uint8_t           *mem;     // NULL: frame.data is the driver buffer
+    uint8_t            ref_cnt;
+} TDL_AUDIO_BUF_T;
+
+typedef struct {
+    const uint8_t         *data;
+    uint32_t               len;
+    uint32_t               gen;
+    TDL_AUDIO_PLAY_DONE_CB cb;
+    void                  *arg;
+} TDL_AUDIO_PLAY_REQ_T;
+
 typedef struct list_node {
     struct list_node *next;
 
@@ -45,6 +79,21 @@ typedef struct list_node {
     TDD_AUDIO_HANDLE_T tdd_hdl;
     TDD_AUDIO_INTFS_T  tdd_intfs;
     TDD_AUDIO_INFO_T   tdd_info;
+
+    bool                     is_open;
+    uint32_t                 frame_len; // batched PCM frame bytes, 0 passes driver frames through
+    uint32_t                 buf_cap;
+    uint8_t                 *buf_mem;
+    TDL_AUDIO_BUF_T          buf[TDL_AUDIO_CAPTURE_BUF_NUM];
+    TDL_AUDIO_BUF_T         *batch;     // batch being filled
+    uint32_t                 seq;
+    TDL_AUDIO_CAPTURE_STAT_T stat;
+    TDL_AUDIO_SUBSCRIBER_T   sub[TDL_AUDIO_SUBSCRIBER_MAX];
+
+    QUEUE_HANDLE             play_queue;
+    THREAD_HANDLE            play_thrd;
+    volatile uint32_t        play_gen;
+    uint32_t                 play_pending;  // bytes queued, not yet taken by the driver
 } TDL_AUDIO_NODE_T;
 
 typedef struct {
@@ -64,6 +113,9 @@ static TDL_AUDIO_LIST_T sg_audio_list = {
     .tail = NULL,
 };
 
+// TDL_AUDIO_MIC_CB carries no context, one device at a time captures through the dispatcher
+static TDL_AUDIO_NODE_T *sg_capture_node = NULL;
+
 /***********************************************************
 ***********************function define**********************
 ***********************************************************/
@@ -108,6 +160,241 @@ static OPERATE_RET __audio_node_add(TDL_AUDIO_NODE_T *node)
     return OPRT_OK;
 }
 
+static uint32_t __audio_per_ms_size(TDL_AUDIO_NODE_T *node)
+{
+    return node->tdd_info.sample_rate * node->tdd_info.sample_ch_num * (node->tdd_info.sample_bits / 8) / 1000;
+}
+
+static OPERATE_RET __audio_sub_add(TDL_AUDIO_NODE_T *node, TDL_AUDIO_CAPTURE_CB capture_cb, TDL_AUDIO_MIC_CB mic_cb,
+                                   void *arg)
+{
+    OPERATE_RET rt = OPRT_EXCEED_UPPER_LIMIT;
+    TDL_AUDIO_SUBSCRIBER_T *sub = NULL;
+    uint32_t i;
+
+    uint32_t irq_mask = tal_system_enter_critical();
+    for (i = 0; i < TDL_AUDIO_SUBSCRIBER_MAX; i++) {
+        sub = &node->sub[i];
+        if (capture_cb == sub->capture_cb && mic_cb == sub->mic_cb && arg == sub->arg) {
+            rt = OPRT_OK;
+            break;
+        }
+    }
+    for (i = 0; (OPRT_OK != rt) && (i < TDL_AUDIO_SUBSCRIBER_MAX); i++) {
+        sub = &node->sub[i];
+        if (NULL == sub->capture_cb && NULL == sub->mic_cb) {
+            sub->capture_cb = capture_cb;
+            sub->mic_cb = mic_cb;
+            sub->arg = arg;
+            rt = OPRT_OK;
+        }
+    }
+    tal_system_exit_critical(irq_mask);
+
+    return rt;
+}
+
+// a pool buffer with one reference, the caller fills it
+static TDL_AUDIO_BUF_T *__audio_buf_get(TDL_AUDIO_NODE_T *node)
+{
+    TDL_AUDIO_BUF_T *buf = NULL;
+
+    uint32_t irq_mask = tal_system_enter_critical();
+    for (uint32_t i = 0; i < TDL_AUDIO_CAPTURE_BUF_NUM; i++) {
+        if (node->buf[i].mem && 0 == node->buf[i].ref_cnt) {
+            buf = &node->buf[i];
+            buf->ref_cnt = 1;
+            break;
+        }
+    }
+    if (NULL == buf) {
+        node->stat.drop_buf++;
+    }
+    tal_system_exit_critical(irq_mask);
+
+    return buf;
+}
+
+static void __audio_buf_unref(TDL_AUDIO_BUF_T *buf)
+{
+    uint32_t irq_mask = tal_system_enter_critical();
+    if (buf->ref_cnt) {
+        buf->ref_cnt--;
+    }
+    tal_system_exit_critical(irq_mask);
+}
+
+static bool __audio_buf_is_held(TDL_AUDIO_NODE_T *node)
+{
+    bool held = false;
+
+    uint32_t irq_mask = tal_system_enter_critical();
+    for (uint32_t i = 0; i < TDL_AUDIO_CAPTURE_BUF_NUM; i++) {
+        if (node->buf[i].ref_cnt) {
+            held = true;
+            break;
+        }
+    }
+    tal_system_exit_critical(irq_mask);
+
+    return held;
+}
+
+// sized for a batch or a driver frame, whichever is larger, kept across close
+static OPERATE_RET __audio_buf_prepare(TDL_AUDIO_NODE_T *node)
+{
+    uint32_t cap = node->tdd_info.sample_tm_ms * __audio_per_ms_size(node);
+
+    if (node->frame_len > cap) {
+        cap = node->frame_len;
+    }
+    if (0 == cap || (node->buf_mem && cap <= node->buf_cap)) {
+        return OPRT_OK;
+    }
+    if (__audio_buf_is_held(node)) {
+        return OPRT_RESOURCE_NOT_READY;
+    }
+
+    tal_free(node->buf_mem);
+    node->buf_cap = 0;
+    memset(node->buf, 0, sizeof(node->buf));
+
+    node->buf_mem = (uint8_t *)tal_malloc(cap * TDL_AUDIO_CAPTURE_BUF_NUM);
+    TUYA_CHECK_NULL_RETURN(node->buf_mem, OPRT_MALLOC_FAILED);
+
+    node->buf_cap = cap;
+    for (uint32_t i = 0; i < TDL_AUDIO_CAPTURE_BUF_NUM; i++) {
+        node->buf[i].node = node;
+        node->buf[i].mem = node->buf_mem + i * cap;
+    }
+
+    return OPRT_OK;
+}
+
+static void __audio_frame_dispatch(TDL_AUDIO_NODE_T *node, TDL_AUDIO_BUF_T *buf)
+{
+    TDL_AUDIO_SUBSCRIBER_T sub[TDL_AUDIO_SUBSCRIBER_MAX];
+
+    // a snapshot, callbacks may subscribe and unsubscribe
+    uint32_t irq_mask = tal_system_enter_critical();
+    memcpy(sub, node->sub, sizeof(sub));
+    buf->frame.seq = node->seq++;
+    node->stat.frames++;
+    tal_system_exit_critical(irq_mask);
+
+    for (uint32_t i = 0; i < TDL_AUDIO_SUBSCRIBER_MAX; i++) {
+        if (sub[i].capture_cb) {
+            sub[i].capture_cb((TDL_AUDIO_HANDLE_T)node, &buf->frame, sub[i].arg);
+        } else if (sub[i].mic_cb) {
+            sub[i].mic_cb(buf->frame.type, buf->frame.status, (uint8_t *)buf->frame.data, buf->frame.len);
+        }
+    }
+}
+
+static void __audio_mic_dispatch(TDL_AUDIO_FRAME_FORMAT_E type, TDL_AUDIO_STATUS_E status, uint8_t *data,
+                                 uint32_t len)
+{
+    TDL_AUDIO_NODE_T *node = sg_capture_node;
+    TDL_AUDIO_BUF_T *buf = NULL;
+
+    if (NULL == node) {
+        return;
+    }
+
+    // encoded frames are never merged
+    if (0 == node->frame_len || TDL_AUDIO_FRAME_FORMAT_PCM != type || NULL == data) {
+        TDL_AUDIO_BUF_T drv = {
+            .frame = {.type = type, .status = status, .data = data, .len = len},
+            .node = node,
+        };
+        __audio_frame_dispatch(node, &drv);
+        if (drv.copy) {
+            __audio_buf_unref(drv.copy);
+        }
+        return;
+    }
+
+    while (len) {
+        if (NULL == node->batch) {
+            node->batch = __audio_buf_get(node);
+            if (NULL == node->batch) {
+                return;
+            }
+            buf = node->batch;
+            buf->copy = NULL;
+            buf->frame.type = type;
+            buf->frame.status = TDL_AUDIO_STATUS_RECEIVING;
+            buf->frame.data = buf->mem;
+            buf->frame.len = 0;
+        }
+        buf = node->batch;
+
+        uint32_t n = node->frame_len - buf->frame.len;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(buf->mem + buf->frame.len, data, n);
+        buf->frame.len += n;
+        data += n;
+        len -= n;
+        // a VAD edge inside the batch is reported on the batch
+        if (TDL_AUDIO_STATUS_RECEIVING != status) {
+            buf->frame.status = status;
+        }
+
+        if (buf->frame.len >= node->frame_len) {
+            node->batch = NULL;
+            __audio_frame_dispatch(node, buf);
+            __audio_buf_unref(buf);
+        }
+    }
+}
+
+static void __audio_play_task(void *args)
+{
+    TDL_AUDIO_NODE_T *node = (TDL_AUDIO_NODE_T *)args;
+    TDL_AUDIO_PLAY_REQ_T req;
+    OPERATE_RET rt = OPRT_OK;
+
+    for (;;) {
+        if (OPRT_OK != tal_queue_fetch(node->play_queue, &req, QUEUE_WAIT_FOREVER)) {
+            continue;
+        }
+
+        if (req.gen == node->play_gen) {
+            rt = node->tdd_intfs.play(node->tdd_hdl, (uint8_t *)req.data, req.len);
+        } else {
+            rt = OPRT_RESOURCE_NOT_READY;
+        }
+
+        uint32_t irq_mask = tal_system_enter_critical();
+        node->play_pending -= req.len;
+        tal_system_exit_critical(irq_mask);
+
+        if (req.cb) {
+            req.cb((TDL_AUDIO_HANDLE_T)node, req.data, req.len, rt, req.arg);
+        }
+    }
+}
+
+static OPERATE_RET __audio_play_task_start(TDL_AUDIO_NODE_T *node)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    if (NULL == node->play_queue) {
+        TUYA_CALL_ERR_RETURN(
+            tal_queue_create_init(&node->play_queue, sizeof(TDL_AUDIO_PLAY_REQ_T), TDL_AUDIO_PLAY_QUEUE_MAX));
+    }
+
+    if (NULL == node->play_thrd) {
+        THREAD_CFG_T thread_cfg = {TDL_AUDIO_PLAY_TASK_STACK, THREAD_PRIO_1, "audio_play"};
+        TUYA_CALL_ERR_RETURN(
+            tal_thread_create_and_start(&node->play_thrd, NULL, NULL, __audio_play_task, node, &thread_cfg));
+    }
+
+    return OPRT_OK;
+}
+
 OPERATE_RET tdl_audio_find(char *name, TDL_AUDIO_HANDLE_T *handle)
 {
     TDL_AUDIO_NODE_T *node = NULL;
@@ -148,6 +435,7 @@ OPERATE_RET tdl_audio_get_info(TDL_AUDIO_HANDLE_T handle, TDL_AUDIO_INFO_T *info
 
 OPERATE_RET tdl_audio_open(TDL_AUDIO_HANDLE_T handle, TDL_AUDIO_MIC_CB mic_cb)
 {
+    OPERATE_RET rt = OPRT_OK;
     TDL_AUDIO_NODE_T *node = (TDL_AUDIO_NODE_T *)handle;
 
     TUYA_CHECK_NULL_RETURN(node, OPRT_INVALID_PARM);
@@ -162,7 +450,145 @@ OPERATE_RET tdl_audio_open(TDL_AUDIO_HANDLE_T handle, TDL_AUDIO_MIC_CB mic_cb)
         return OPRT_INVALID_PARM;
     }
 
-    return node->tdd_intfs.open(node->tdd_hdl, mic_cb);
+    if (NULL != mic_cb) {
+        TUYA_CALL_ERR_RETURN(__audio_sub_add(node, NULL, mic_cb, NULL));
+    }
+    if (node->is_open) {
+        return OPRT_OK;
+    }
+
+    if (NULL != sg_capture_node && node != sg_capture_node) {
+        PR_WARN("audio %s captures already, %s only calls its open callback", sg_capture_node->name, node->name);
+        TUYA_CALL_ERR_RETURN(node->tdd_intfs.open(node->tdd_hdl, mic_cb));
+        node->is_open = true;
+        return OPRT_OK;
+    }
+
+    rt = __audio_buf_prepare(node);
+    if (OPRT_OK != rt) {
+        PR_WARN("audio %s capture buffers unavailable: %d, frames can not be held", node->name, rt);
+    }
+
+    sg_capture_node = node;
+    rt = node->tdd_intfs.open(node->tdd_hdl, __audio_mic_dispatch);
+    if (OPRT_OK != rt) {
+        sg_capture_node = NULL;
+        return rt;
+    }
+    node->is_open = true;
+
+    return OPRT_OK;
+}
+
+OPERATE_RET tdl_audio_subscribe(TDL_AUDIO_HANDLE_T handle, TDL_AUDIO_CAPTURE_CB cb, void *arg)
+{
+    TDL_AUDIO_NODE_T *node = (TDL_AUDIO_NODE_T *)handle;
+
+    TUYA_CHECK_NULL_RETURN(node, OPRT_INVALID_PARM);
+    TUYA_CHECK_NULL_RETURN(cb, OPRT_INVALID_PARM);
+
+    return __audio_sub_add(node, cb, NULL, arg);
+}
+
+OPERATE_RET tdl_audio_unsubscribe(TDL_AUDIO_HANDLE_T handle, TDL_AUDIO_CAPTURE_CB cb, void *arg)
+{
+    TDL_AUDIO_NODE_T *node = (TDL_AUDIO_NODE_T *)handle;
+    OPERATE_RET rt = OPRT_NOT_FOUND;
+
+    TUYA_CHECK_NULL_RETURN(node, OPRT_INVALID_PARM);
+    TUYA_CHECK_NULL_RETURN(cb, OPRT_INVALID_PARM);
+
+    uint32_t irq_mask = tal_system_enter_critical();
+    for (uint32_t i = 0; i < TDL_AUDIO_SUBSCRIBER_MAX; i++) {
+        if (cb == node->sub[i].capture_cb && arg == node->sub[i].arg) {
+            memset(&node->sub[i], 0, sizeof(TDL_AUDIO_SUBSCRIBER_T));
+            rt = OPRT_OK;
+            break;
+        }
+    }
+    tal_system_exit_critical(irq_mask);
+
+    return rt;
+}
+
+OPERATE_RET tdl_audio_set_frame_tm(TDL_AUDIO_HANDLE_T handle, uint16_t frame_tm_ms)
+{
+    TDL_AUDIO_NODE_T *node = (TDL_AUDIO_NODE_T *)handle;
+
+    TUYA_CHECK_NULL_RETURN(node, OPRT_INVALID_PARM);
+
+    if (node->is_open || __audio_buf_is_held(node)) {
+        return OPRT_RESOURCE_NOT_READY;
+    }
+
+    node->frame_len = frame_tm_ms * __audio_per_ms_size(node);
+
+    return OPRT_OK;
+}
+
+const TDL_AUDIO_FRAME_T *tdl_audio_frame_hold(const TDL_AUDIO_FRAME_T *frame)
+{
+    TDL_AUDIO_BUF_T *buf = (TDL_AUDIO_BUF_T *)frame;
+    TDL_AUDIO_BUF_T *copy = NULL;
+
+    if (NULL == buf || NULL == buf->node) {
+        return NULL;
+    }
+
+    if (NULL != buf->mem) {
+        uint32_t irq_mask = tal_system_enter_critical();
+        buf->ref_cnt++;
+        tal_system_exit_critical(irq_mask);
+        return &buf->frame;
+    }
+
+    // a driver frame, only valid during the dispatch, which is where holds are made
+    if (NULL == buf->copy) {
+        if (NULL == frame->data || frame->len > buf->node->buf_cap) {
+            return NULL;
+        }
+        copy = __audio_buf_get(buf->node);
+        if (NULL == copy) {
+            return NULL;
+        }
+        memcpy(copy->mem, frame->data, frame->len);
+        copy->frame = *frame;
+        copy->frame.data = copy->mem;
+        copy->copy = NULL;
+        buf->copy = copy;
+        buf->node->stat.copies++;
+    }
+
+    uint32_t irq_mask = tal_system_enter_critical();
+    buf->copy->ref_cnt++;
+    tal_system_exit_critical(irq_mask);
+
+    return &buf->copy->frame;
+}
+
+void tdl_audio_frame_release(const TDL_AUDIO_FRAME_T *frame)
+{
+    TDL_AUDIO_BUF_T *buf = (TDL_AUDIO_BUF_T *)frame;
+
+    if (NULL == buf || NULL == buf->mem) {
+        return;
+    }
+
+    __audio_buf_unref(buf);
+}
+
+OPERATE_RET tdl_audio_get_capture_stat(TDL_AUDIO_HANDLE_T handle, TDL_AUDIO_CAPTURE_STAT_T *stat)
+{
+    TDL_AUDIO_NODE_T *node = (TDL_AUDIO_NODE_T *)handle;
+
+    TUYA_CHECK_NULL_RETURN(node, OPRT_INVALID_PARM);
+    TUYA_CHECK_NULL_RETURN(stat, OPRT_INVALID_PARM);
+
+    uint32_t irq_mask = tal_system_enter_critical();
+    *stat = node->stat;
+    tal_system_exit_critical(irq_mask);
+
+    return OPRT_OK;
 }
 
 OPERATE_RET tdl_audio_play(TDL_AUDIO_HANDLE_T handle, uint8_t *data, uint32_t len)
@@ -184,6 +610,74 @@ OPERATE_RET tdl_audio_play(TDL_AUDIO_HANDLE_T handle, uint8_t *data, uint32_t le
     return node->tdd_intfs.play(node->tdd_hdl, data, len);
 }
 
+OPERATE_RET tdl_audio_play_async(TDL_AUDIO_HANDLE_T handle, const uint8_t *data, uint32_t len,
+                                 TDL_AUDIO_PLAY_DONE_CB cb, void *arg)
+{
+    OPERATE_RET rt = OPRT_OK;
+    TDL_AUDIO_NODE_T *node = (TDL_AUDIO_NODE_T *)handle;
+
+    TUYA_CHECK_NULL_RETURN(node, OPRT_INVALID_PARM);
+    TUYA_CHECK_NULL_RETURN(data, OPRT_INVALID_PARM);
+
+    if (0 == len) {
+        return OPRT_INVALID_PARM;
+    }
+
+    if (NULL == node->tdd_hdl || NULL == node->tdd_intfs.play) {
+        PR_ERR("audio driver %s not support play", node->name);
+        return OPRT_INVALID_PARM;
+    }
+
+    TUYA_CALL_ERR_RETURN(__audio_play_task_start(node));
+
+    TDL_AUDIO_PLAY_REQ_T req = {
+        .data = data,
+        .len = len,
+        .gen = node->play_gen,
+        .cb = cb,
+        .arg = arg,
+    };
+
+    // counted first, the play task may finish it before the post returns
+    uint32_t irq_mask = tal_system_enter_critical();
+    node->play_pending += len;
+    tal_system_exit_critical(irq_mask);
+
+    if (OPRT_OK != tal_queue_post(node->play_queue, &req, 0)) {
+        irq_mask = tal_system_enter_critical();
+        node->play_pending -= len;
+        tal_system_exit_critical(irq_mask);
+        return OPRT_EXCEED_UPPER_LIMIT;
+    }
+
+    return OPRT_OK;
+}
+
+OPERATE_RET tdl_audio_get_play_queue(TDL_AUDIO_HANDLE_T handle, uint32_t *samples)
+{
+    TDL_AUDIO_NODE_T *node = (TDL_AUDIO_NODE_T *)handle;
+    uint32_t sample_size = 0;
+    uint32_t drv_samples = 0;
+
+    TUYA_CHECK_NULL_RETURN(node, OPRT_INVALID_PARM);
+    TUYA_CHECK_NULL_RETURN(samples, OPRT_INVALID_PARM);
+
+    sample_size = node->tdd_info.sample_ch_num * (node->tdd_info.sample_bits / 8);
+    if (0 == sample_size) {
+        return OPRT_NOT_SUPPORTED;
+    }
+
+    // drivers without TDD_AUDIO_CMD_GET_PLAY_QUEUE count as empty
+    if (node->tdd_hdl && node->tdd_intfs.config &&
+        OPRT_OK != node->tdd_intfs.config(node->tdd_hdl, TDD_AUDIO_CMD_GET_PLAY_QUEUE, &drv_samples)) {
+        drv_samples = 0;
+    }
+
+    *samples = node->play_pending / sample_size + drv_samples;
+
+    return OPRT_OK;
+}
+
 OPERATE_RET tdl_audio_play_stop(TDL_AUDIO_HANDLE_T handle)
 {
     TDL_AUDIO_NODE_T *node = (TDL_AUDIO_NODE_T *)handle;
@@ -200,9 +694,35 @@ OPERATE_RET tdl_audio_play_stop(TDL_AUDIO_HANDLE_T handle)
         return OPRT_INVALID_PARM;
     }
 
+    // queued buffers complete unplayed
+    node->play_gen++;
+
     return node->tdd_intfs.config(node->tdd_hdl, TDD_AUDIO_CMD_PLAY_STOP, NULL);
 }
 
+OPERATE_RET tdl_audio_mic_restart(TDL_AUDIO_HANDLE_T handle)
+{
+    TDL_AUDIO_NODE_T *node = (TDL_AUDIO_NODE_T *)handle;
+
+    TUYA_CHECK_NULL_RETURN(node, OPRT_INVALID_PARM);
+
+    if (NULL == node->tdd_hdl) {
+        PR_ERR("audio driver %s not register", node->name);
+        return OPRT_INVALID_PARM;
+    }
+
+    if (NULL == node->tdd_intfs.config) {
+        PR_ERR("audio driver %s not support config", node->name);
+        return OPRT_INVALID_PARM;
+    }
+
+    if (!node->is_open) {
+        return OPRT_RESOURCE_NOT_READY;
+    }
+
+    return node->tdd_intfs.config(node->tdd_hdl, TDD_AUDIO_CMD_MIC_RESTART, NULL);
+}
+
 OPERATE_RET tdl_audio_volume_set(TDL_AUDIO_HANDLE_T handle, uint8_t volume)
 {
     TDL_AUDIO_NODE_T *node = (TDL_AUDIO_NODE_T *)handle;
@@ -224,6 +744,7 @@ OPERATE_RET tdl_audio_volume_set(TDL_AUDIO_HANDLE_T handle, uint8_t volume)
 
 OPERATE_RET tdl_audio_close(TDL_AUDIO_HANDLE_T handle)
 {
+    OPERATE_RET rt = OPRT_OK;
     TDL_AUDIO_NODE_T *node = (TDL_AUDIO_NODE_T *)handle;
 
     TUYA_CHECK_NULL_RETURN(node, OPRT_INVALID_PARM);
@@ -238,7 +759,20 @@ OPERATE_RET tdl_audio_close(TDL_AUDIO_HANDLE_T handle)
         return OPRT_INVALID_PARM;
     }
 
-    return node->tdd_intfs.close(node->tdd_hdl);
+    node->play_gen++;
+    TUYA_CALL_ERR_RETURN(node->tdd_intfs.close(node->tdd_hdl));
+
+    node->is_open = false;
+    if (node == sg_capture_node) {
+        sg_capture_node = NULL;
+        // the partial batch is dropped, the next open starts a new one
+        if (node->batch) {
+            __audio_buf_unref(node->batch);
+            node->batch = NULL;
+        }
+    }
+
+    return OPRT_OK;
 }
 
 OPERATE_RET tdl_audio_driver_register(char *name, TDD_AUDIO_HANDLE_T tdd_hdl,\
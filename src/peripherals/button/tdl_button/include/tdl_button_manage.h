@@ -162,6 +162,16 @@ OPERATE_RET tdl_button_set_level(TDL_BUTTON_HANDLE handle, TUYA_GPIO_LEVEL_E lev
  */
 OPERATE_RET tdl_button_set_scan_time(uint8_t time_ms);
 
+/**
+ * @brief set tickless interrupt mode, default is off
+ *       In BUTTON_IRQ_MODE the scan normally keeps running for 10s after the last activity.
+ *       Tickless, it stops as soon as every button is released and its events are done,
+ *       the scan thread then sleeps until the next edge interrupt.
+ * @param[in] enable 0-off  1-on
+ * @return OPRT_OK if successful
+ */
+OPERATE_RET tdl_button_set_irq_tickless(uint8_t enable);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
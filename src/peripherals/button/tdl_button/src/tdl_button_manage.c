@@ -146,6 +146,7 @@ static uint8_t g_tdl_button_list_exist = FALSE; // Single button list head initi
 static uint8_t g_tdl_button_scan_mode_exist = 0xFF;
 static uint32_t sg_bt_task_stack_size = TDL_BUTTON_TASK_STACK_SIZE;
 static uint8_t tdl_button_scan_time = TDL_BUTTON_SCAN_TIME;
+static uint8_t sg_irq_tickless = FALSE;
 
 /***********************************************************
 ***********************function define**********************
@@ -581,7 +582,8 @@ static void __tdl_button_state_handle(TDL_BUTTON_LIST_NODE_T *p_node)
 // Button interrupt callback function
 static void __tdl_button_irq_cb(void *arg)
 {
-    if (tdl_button_local.irq_scan_cnt >= TDL_BUTTON_IRQ_SCAN_CNT) {
+    // Tickless, an edge during the last scan round must start the next one
+    if (sg_irq_tickless || tdl_button_local.irq_scan_cnt >= TDL_BUTTON_IRQ_SCAN_CNT) {
         tal_semaphore_post(tdl_button_local.irq_semaphore);
     }
     return;
@@ -922,6 +924,25 @@ static void __tdl_button_scan_thread(void *arg)
     }
 }
 
+// All interrupt buttons released, debounced and without a pending click or hold event
+static uint8_t __tdl_button_irq_idle(TDL_BUTTON_LIST_HEAD_T *p_head)
+{
+    TDL_BUTTON_LIST_NODE_T *p_node = NULL;
+    LIST_HEAD *pos = NULL;
+
+    tuya_list_for_each(pos, &p_head->hdr)
+    {
+        p_node = tuya_list_entry(pos, TDL_BUTTON_LIST_NODE_T, hdr);
+        if ((p_node->device_data.dev_cfg.button_mode == BUTTON_IRQ_MODE) &&
+            (p_node->device_data.flag != 0 || p_node->device_data.status != 0 ||
+             p_node->device_data.debounce_cnt != 0)) {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
 // Button interrupt scan task
 static void __tdl_button_irq_thread(void *arg)
 {
@@ -960,7 +981,10 @@ static void __tdl_button_irq_thread(void *arg)
             }
 #endif
             // Interrupt disconnection count check
-            if (++tdl_button_local.irq_scan_cnt >= TDL_BUTTON_IRQ_SCAN_CNT) {
+            if (sg_irq_tickless && __tdl_button_irq_idle(p_head)) {
+                tdl_button_local.irq_scan_cnt = TDL_BUTTON_IRQ_SCAN_CNT;
+                break;
+            } else if (++tdl_button_local.irq_scan_cnt >= TDL_BUTTON_IRQ_SCAN_CNT) {
                 break;
             } else {
                 tal_system_sleep(tdl_button_scan_time);
@@ -1272,3 +1296,9 @@ OPERATE_RET tdl_button_set_scan_time(uint8_t time_ms)
     tdl_button_local.irq_scan_cnt = TDL_BUTTON_IRQ_SCAN_TIME / time_ms;
     return OPRT_OK;
 }
+
+OPERATE_RET tdl_button_set_irq_tickless(uint8_t enable)
+{
+    sg_irq_tickless = (enable != 0) ? TRUE : FALSE;
+    return OPRT_OK;
+}
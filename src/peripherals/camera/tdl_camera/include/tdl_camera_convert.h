@@ -0,0 +1,101 @@
+/**
+ * @file tdl_camera_convert.h
+ * @brief Raw camera frame to display pixel conversion, scaled and rotated in one pass.
+ *
+ * A YUV422 (packed) or YUV420 (I420 or NV12) frame becomes RGB565 or RGB888
+ * for a display frame buffer. The nearest neighbour scale, the rotation and
+ * the RGB565 byte swap of the panel are fused into the same pass, so a
+ * preview needs no intermediate frame. Colours are full range BT.601, as
+ * the DVP sensors deliver them, in integer math. On cores with the ARM DSP
+ * extension two pixels are converted per instruction; 90 and 270 degree
+ * rotations walk tiles like tdl_disp_draw_rotate().
+ *
+ * The column lookup of the scale is set up once by tdl_camera_convert_init()
+ * for fixed frame and output sizes.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#ifndef __TDL_CAMERA_CONVERT_H__
+#define __TDL_CAMERA_CONVERT_H__
+
+#include "tuya_cloud_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+// 90 and 270 degree outputs are written in tiles of this many pixels square
+#ifndef TDL_CAMERA_CONVERT_TILE
+#define TDL_CAMERA_CONVERT_TILE 16
+#endif
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef struct {
+    TUYA_FRAME_FMT_E          src_fmt;     // TUYA_FRAME_FMT_YUV422 or TUYA_FRAME_FMT_YUV420
+    uint16_t                  src_width;
+    uint16_t                  src_height;
+    uint8_t                   y_offset;    // YUV422 byte of the first luma, 0: YUYV, 1: UYVY
+    bool                      nv12;        // YUV420 chroma is one interleaved UV plane, else I420
+    TUYA_DISPLAY_PIXEL_FMT_E  dst_fmt;     // TUYA_PIXEL_FMT_RGB565 or TUYA_PIXEL_FMT_RGB888
+    uint16_t                  dst_width;   // scaled size before the rotation, 0: source size
+    uint16_t                  dst_height;
+    TUYA_DISPLAY_ROTATION_E   rotation;    // same direction as tdl_disp_draw_rotate()
+    bool                      is_swap;     // RGB565 in the byte order of the panel
+} TDL_CAMERA_CONVERT_CFG_T;
+
+typedef struct {
+    TDL_CAMERA_CONVERT_CFG_T  cfg;
+    uint16_t                  out_width;   // output size after the rotation
+    uint16_t                  out_height;
+    uint32_t                  out_len;     // output bytes
+    uint32_t                  src_len;     // input bytes a frame needs at least
+    uint32_t                 *yidx;        // per output column, luma byte within a source row
+    uint32_t                 *cidx;        // per output column, chroma byte within a chroma row
+} TDL_CAMERA_CONVERT_T;
+
+/***********************************************************
+********************function declaration********************
+***********************************************************/
+/**
+ * @brief sets up a conversion for frames of one size and format
+ *
+ * @param[out] cv the conversion
+ * @param[in] cfg formats, sizes and rotation
+ *
+ * @return OPRT_OK on success, OPRT_NOT_SUPPORTED on a format it does not
+ * convert, OPRT_INVALID_PARM on odd or zero source sizes
+ */
+OPERATE_RET tdl_camera_convert_init(TDL_CAMERA_CONVERT_T *cv, const TDL_CAMERA_CONVERT_CFG_T *cfg);
+
+/**
+ * @brief converts one frame
+ *
+ * @param[in] cv the conversion
+ * @param[in] src frame data
+ * @param[in] src_len bytes of frame data
+ * @param[out] dst output pixels, at least cv->out_len bytes, out_width per row
+ *
+ * @return OPRT_OK on success, OPRT_INVALID_PARM when src_len is short of cv->src_len
+ */
+OPERATE_RET tdl_camera_convert_frame(const TDL_CAMERA_CONVERT_T *cv, const uint8_t *src, uint32_t src_len,
+                                     uint8_t *dst);
+
+/**
+ * @brief releases the lookup tables of a conversion
+ *
+ * @param[in] cv the conversion
+ */
+void tdl_camera_convert_deinit(TDL_CAMERA_CONVERT_T *cv);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TDL_CAMERA_CONVERT_H__ */
@@ -19,6 +19,16 @@ extern "C" {
 #define TDL_IMG_FMT_RAW_MASK       0x00FF
 #define TDL_IMG_FMT_ENCODED_MASK   0xFF00
 #define ENCODED_SHIFT(value)      ((value) << 8)
+
+// callbacks one stream delivers every frame to, the open cfg callback included
+#ifndef TDL_CAMERA_SUBSCRIBER_MAX
+#define TDL_CAMERA_SUBSCRIBER_MAX  4
+#endif
+
+// most buffers per stream, also the depth of the stream queue
+#ifndef TDL_CAMERA_FRAME_BUFF_MAX
+#define TDL_CAMERA_FRAME_BUFF_MAX  16
+#endif
 /***********************************************************
 ***********************typedef define***********************
 ***********************************************************/
@@ -34,6 +44,38 @@ typedef enum {
     TDL_CAMERA_FMT_H264_YUV422_BOTH =  (TDL_CAMERA_FMT_H264 | TDL_CAMERA_FMT_YUV422),
 } TDL_CAMERA_FMT_E;
 
+typedef enum {
+    TDL_CAMERA_STREAM_RAW = 0,
+    TDL_CAMERA_STREAM_ENCODED,
+    TDL_CAMERA_STREAM_NUM,
+} TDL_CAMERA_STREAM_E;
+
+/**
+ * @brief what a stream gives up when its consumers fall behind
+ *
+ * With DROP_NEWEST a capture that finds no free buffer is lost and the queued
+ * frames are still delivered. With DROP_OLDEST a queued frame is skipped when
+ * a newer one waits behind it, so buffers return early and the subscribers
+ * always see the latest capture. Either way an H264 stream needs the next I
+ * frame to resync after a drop.
+ */
+typedef enum {
+    TDL_CAMERA_DROP_NEWEST = 0,
+    TDL_CAMERA_DROP_OLDEST,
+} TDL_CAMERA_POOL_POLICY_E;
+
+typedef struct {
+    uint8_t                   pool_num;     // buffers of the stream
+    uint8_t                   pool_used;    // buffers out of the pool now
+    uint8_t                   pool_peak;
+    uint8_t                   queue_depth;  // posted frames not yet dispatched
+    uint8_t                   queue_peak;
+    uint32_t                  frames;       // frames delivered to the subscribers
+    uint32_t                  drop_pool;    // captures that found no free buffer
+    uint32_t                  drop_queue;   // posted frames dropped before delivery
+    uint32_t                  drop_gate;    // frames held back while the stream was gated
+} TDL_CAMERA_STREAM_STAT_T;
+
 typedef void*  TDL_CAMERA_HANDLE_T;
 
 typedef struct {
@@ -46,6 +88,8 @@ typedef struct {
     uint16_t                  max_width;
     uint16_t                  max_height;
     TUYA_FRAME_FMT_E          sr_fmt;
+    TDL_CAMERA_POOL_POLICY_E  pool_policy;
+    TDL_CAMERA_STREAM_STAT_T  stat[TDL_CAMERA_STREAM_NUM];
 } TDL_CAMERA_DEV_INFO_T;
 
 typedef struct
@@ -61,6 +105,13 @@ typedef struct
     uint32_t            total_frame_len;
 } TDL_CAMERA_FRAME_T;
 
+/**
+ * @brief frame callback, the frame is only valid while it runs
+ *
+ * A subscriber that keeps the frame longer, e.g. to queue it for an upload,
+ * calls tdl_camera_frame_hold() in the callback and tdl_camera_frame_release()
+ * when done. The frame is shared by all subscribers and must not be written.
+ */
 typedef OPERATE_RET (*TDL_CAMERA_GET_FRAME_CB)(TDL_CAMERA_HANDLE_T hdl,  TDL_CAMERA_FRAME_T *frame);
 
 typedef struct {
@@ -70,6 +121,9 @@ typedef struct {
     TDL_CAMERA_FMT_E          out_fmt;
     TDL_CAMERA_GET_FRAME_CB   get_frame_cb;
     TDL_CAMERA_GET_FRAME_CB   get_encoded_frame_cb;
+    TDL_CAMERA_POOL_POLICY_E  pool_policy;
+    uint8_t                   raw_buf_cnt;      // 0: default, at most TDL_CAMERA_FRAME_BUFF_MAX
+    uint8_t                   encoded_buf_cnt;  // 0: default, at most TDL_CAMERA_FRAME_BUFF_MAX
 }TDL_CAMERA_CFG_T;
 
 
@@ -85,6 +139,65 @@ OPERATE_RET tdl_camera_dev_open(TDL_CAMERA_HANDLE_T camera_hdl,  TDL_CAMERA_CFG_
 
 OPERATE_RET tdl_camera_dev_close(TDL_CAMERA_HANDLE_T camera_hdl);
 
+/**
+ * @brief add a callback to a stream, the frames are not copied
+ *
+ * @param[in] camera_hdl camera handle
+ * @param[in] stream TDL_CAMERA_STREAM_RAW or TDL_CAMERA_STREAM_ENCODED
+ * @param[in] cb frame callback, called in the stream task
+ *
+ * @return OPRT_OK on success, OPRT_EXCEED_UPPER_LIMIT when the stream already
+ * has TDL_CAMERA_SUBSCRIBER_MAX callbacks
+ */
+OPERATE_RET tdl_camera_dev_subscribe(TDL_CAMERA_HANDLE_T camera_hdl, TDL_CAMERA_STREAM_E stream,
+                                     TDL_CAMERA_GET_FRAME_CB cb);
+
+/**
+ * @brief remove a callback from a stream
+ *
+ * @param[in] camera_hdl camera handle
+ * @param[in] stream TDL_CAMERA_STREAM_RAW or TDL_CAMERA_STREAM_ENCODED
+ * @param[in] cb frame callback
+ *
+ * @return OPRT_OK on success, OPRT_NOT_FOUND when cb is not subscribed
+ */
+OPERATE_RET tdl_camera_dev_unsubscribe(TDL_CAMERA_HANDLE_T camera_hdl, TDL_CAMERA_STREAM_E stream,
+                                       TDL_CAMERA_GET_FRAME_CB cb);
+
+/**
+ * @brief open or close the encoded stream to its subscribers
+ *
+ * While closed the encoded frames go back to the pool undelivered, so a gate
+ * such as tdl_camera_motion keeps streaming and uploads idle when nothing
+ * happens. After it opens an H264 stream resumes at the next I frame.
+ *
+ * @param[in] camera_hdl camera handle
+ * @param[in] open false holds the frames back, true delivers them again
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tdl_camera_dev_set_encoded_gate(TDL_CAMERA_HANDLE_T camera_hdl, bool open);
+
+/**
+ * @brief keep a frame after its callback returned
+ *
+ * @param[in] frame frame passed to a TDL_CAMERA_GET_FRAME_CB
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tdl_camera_frame_hold(TDL_CAMERA_FRAME_T *frame);
+
+/**
+ * @brief drop a reference taken by tdl_camera_frame_hold()
+ *
+ * The buffer goes back to the camera when the last reference is dropped.
+ *
+ * @param[in] frame the held frame
+ */
+void tdl_camera_frame_release(TDL_CAMERA_FRAME_T *frame);
+
 #ifdef __cplusplus
 }
 #endif
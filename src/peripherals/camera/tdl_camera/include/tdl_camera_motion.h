@@ -0,0 +1,125 @@
+/**
+ * @file tdl_camera_motion.h
+ * @brief Motion detection on the raw camera stream, gating what costs bandwidth.
+ *
+ * Every analysed frame is reduced to a grid of cells holding the mean luma of
+ * a subsampled set of its rows. Each cell is compared with a background
+ * model that slowly follows the scene, and the frame has motion when enough
+ * cells differ from their background. All of it is integer math, and the row
+ * sums use a SIMD kernel on cores with the ARM DSP extension.
+ *
+ * Motion starts after trigger_frames frames in a row with motion and ends
+ * hold_ms after the last one. Both edges are published as EVENT_CAMERA_MOTION.
+ * With gate_encoded the encoded stream is closed while there is no motion, so
+ * P2P streaming and image uploads subscribed to it stay idle. A change of
+ * most cells at once, such as the lights or the IR cut switching, makes the
+ * background relearn instead of being reported as motion.
+ *
+ * The camera must output TUYA_FRAME_FMT_YUV422 (packed) or
+ * TUYA_FRAME_FMT_YUV420 (planar) raw frames.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#ifndef __TDL_CAMERA_MOTION_H__
+#define __TDL_CAMERA_MOTION_H__
+
+#include "tuya_cloud_types.h"
+#include "tdl_camera_manage.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+// data: TDL_CAMERA_MOTION_EVENT_T
+#define EVENT_CAMERA_MOTION "camera.motion"
+
+#ifndef TDL_CAMERA_MOTION_GRID_W_MAX
+#define TDL_CAMERA_MOTION_GRID_W_MAX 32
+#endif
+
+#ifndef TDL_CAMERA_MOTION_GRID_H_MAX
+#define TDL_CAMERA_MOTION_GRID_H_MAX 24
+#endif
+
+// share of the cells changing at once taken as a lighting change
+#ifndef TDL_CAMERA_MOTION_GLOBAL_PCT
+#define TDL_CAMERA_MOTION_GLOBAL_PCT 75
+#endif
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef struct {
+    uint8_t  grid_w;          // cells across, 0: 16
+    uint8_t  grid_h;          // cells down, 0: 12
+    uint8_t  row_step;        // analyse every row_step-th row, 0: 4
+    uint8_t  y_offset;        // YUV422 byte of the first luma, 0: YUYV, 1: UYVY
+    uint8_t  cell_thresh;     // mean luma change of a moving cell, 0: 12
+    uint8_t  learn_shift;     // background follows 1/2^learn_shift of a change per frame, 0: 4
+    uint16_t min_cells;       // moving cells to count a frame as motion, 0: 2
+    uint8_t  trigger_frames;  // frames in a row with motion to start it, 0: 2
+    uint16_t interval_ms;     // least time between analysed frames, 0: every frame
+    uint16_t hold_ms;         // motion ends this long after the last moving frame, 0: 3000
+    bool     gate_encoded;    // close the encoded stream while there is no motion
+} TDL_CAMERA_MOTION_CFG_T;
+
+typedef struct {
+    bool     active;
+    uint16_t cells;           // moving cells of the frame that changed the state
+    uint16_t cells_total;
+} TDL_CAMERA_MOTION_EVENT_T;
+
+typedef struct {
+    bool     active;
+    uint16_t cells;           // moving cells of the last analysed frame
+    uint32_t frames;          // frames analysed
+    uint32_t skipped;         // frames in an unsupported format
+    uint32_t events;          // times motion started
+    uint32_t relearns;        // lighting changes that reset the background
+} TDL_CAMERA_MOTION_INFO_T;
+
+/***********************************************************
+********************function declaration********************
+***********************************************************/
+/**
+ * @brief starts motion detection on the raw stream of a camera
+ *
+ * @param[in] camera_hdl opened camera with a raw stream
+ * @param[in] cfg detection parameters, NULL for the defaults
+ *
+ * @return OPRT_OK on success, OPRT_INVALID_PARM on a grid over the maximum
+ * or larger than the frame
+ */
+OPERATE_RET tdl_camera_motion_start(TDL_CAMERA_HANDLE_T camera_hdl, TDL_CAMERA_MOTION_CFG_T *cfg);
+
+/**
+ * @brief stops motion detection and opens the encoded stream again
+ *
+ * @return OPRT_OK on success
+ */
+OPERATE_RET tdl_camera_motion_stop(void);
+
+/**
+ * @brief whether there is motion now, for consumers of the raw stream
+ */
+bool tdl_camera_motion_is_active(void);
+
+/**
+ * @brief gets the detector state and counters
+ *
+ * @param[out] info detector state
+ *
+ * @return OPRT_OK on success
+ */
+OPERATE_RET tdl_camera_motion_get_info(TDL_CAMERA_MOTION_INFO_T *info);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TDL_CAMERA_MOTION_H__ */
@@ -0,0 +1,110 @@
+/**
+ * @file tdl_camera_preview.h
+ * @brief Raw camera stream shown on a display, double buffered.
+ *
+ * The preview subscribes to the raw stream and hands the latest frame to its
+ * own task, so the stream task never waits on a conversion or a flush. A
+ * frame that arrives while the previous one is still waiting replaces it.
+ * The task converts the frame into the free one of two display frame
+ * buffers with tdl_camera_convert, scaled to the preview size and rotated
+ * as the display is mounted, and flushes it while the next frame goes into
+ * the other buffer.
+ *
+ * Up to two raw frames are held at once, one waiting and one converted. Open
+ * the camera with raw_buf_cnt 3 or more when other raw subscribers, such as
+ * tdl_camera_motion, must not lose frames to the preview.
+ *
+ * Built only with ENABLE_DISPLAY.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#ifndef __TDL_CAMERA_PREVIEW_H__
+#define __TDL_CAMERA_PREVIEW_H__
+
+#include "tuya_cloud_types.h"
+#include "tdl_camera_manage.h"
+#include "tdl_display_manage.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+#ifndef TDL_CAMERA_PREVIEW_STACK_SIZE
+#define TDL_CAMERA_PREVIEW_STACK_SIZE 4096
+#endif
+
+#ifndef TDL_CAMERA_PREVIEW_PRIO
+#define TDL_CAMERA_PREVIEW_PRIO THREAD_PRIO_2
+#endif
+
+/* Longest wait for the display to give a frame buffer back. A driver that
+ * flushes synchronously never does, its buffers are reused from then on. */
+#ifndef TDL_CAMERA_PREVIEW_FB_WAIT_MS
+#define TDL_CAMERA_PREVIEW_FB_WAIT_MS 100
+#endif
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef struct {
+    uint16_t  width;          // preview size before the rotation, 0: the display size
+    uint16_t  height;
+    uint8_t   y_offset;       // YUV422 byte of the first luma, 0: YUYV, 1: UYVY
+    bool      nv12;           // YUV420 frames carry one interleaved UV plane
+    uint16_t  interval_ms;    // least time between previewed frames, 0: every frame
+} TDL_CAMERA_PREVIEW_CFG_T;
+
+typedef struct {
+    bool      running;
+    bool      dma2d;          // frames are converted by the DMA2D
+    uint32_t  frames;         // frames flushed to the display
+    uint32_t  replaced;       // frames replaced by a newer one before conversion
+    uint32_t  skipped;        // frames in a format the preview cannot convert
+    uint32_t  fb_waits;       // frames that waited for a frame buffer
+    uint32_t  convert_ms;     // conversion time of the last frame
+} TDL_CAMERA_PREVIEW_INFO_T;
+
+/***********************************************************
+********************function declaration********************
+***********************************************************/
+/**
+ * @brief starts showing the raw stream of a camera on a display
+ *
+ * @param[in] camera_hdl opened camera with a YUV422 or YUV420 raw stream
+ * @param[in] disp_hdl opened RGB565 or RGB888 display
+ * @param[in] cfg preview parameters, NULL for the defaults
+ *
+ * @return OPRT_OK on success, OPRT_NOT_SUPPORTED on another display
+ * format, OPRT_INVALID_PARM on a preview larger than the display
+ */
+OPERATE_RET tdl_camera_preview_start(TDL_CAMERA_HANDLE_T camera_hdl, TDL_DISP_HANDLE_T disp_hdl,
+                                     TDL_CAMERA_PREVIEW_CFG_T *cfg);
+
+/**
+ * @brief stops the preview and releases its frame buffers
+ *
+ * A frame buffer the display still shows is kept until the next start.
+ *
+ * @return OPRT_OK on success
+ */
+OPERATE_RET tdl_camera_preview_stop(void);
+
+/**
+ * @brief gets the preview state and counters
+ *
+ * @param[out] info preview state
+ *
+ * @return OPRT_OK on success
+ */
+OPERATE_RET tdl_camera_preview_get_info(TDL_CAMERA_PREVIEW_INFO_T *info);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TDL_CAMERA_PREVIEW_H__ */
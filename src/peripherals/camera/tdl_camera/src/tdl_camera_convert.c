@@ -0,0 +1,355 @@
+/**
+ * @file tdl_camera_convert.c
+ * @brief Raw camera frame to display pixel conversion.
+ *
+ * Every output row is mapped to its nearest source row, and every output
+ * column to the luma and chroma byte of its nearest source column through
+ * the tables built at init. A source row is split into luma and chroma
+ * pointers, so packed YUV422, I420 and NV12 share the per pixel code:
+ *
+ *   R = Y + 1.402 (V - 128)
+ *   G = Y - 0.344 (U - 128) - 0.714 (V - 128)
+ *   B = Y + 1.772 (U - 128)
+ *
+ * with the factors in Q8. RGB565 is built for two pixels at once, one per
+ * 16 bit lane, and stored as one word where the two are adjacent.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include "tuya_cloud_types.h"
+#include "tal_api.h"
+
+#include "tdl_camera_convert.h"
+
+// the RGB565 kernel adds and saturates two pixels per instruction, see __rgb565_pair()
+#ifndef TDL_CAMERA_CONVERT_SIMD
+#if defined(__ARM_FEATURE_SIMD32) && (__ARM_FEATURE_SIMD32 == 1)
+#define TDL_CAMERA_CONVERT_SIMD 1
+#else
+#define TDL_CAMERA_CONVERT_SIMD 0
+#endif
+#endif
+
+#if (TDL_CAMERA_CONVERT_SIMD == 1)
+#include <arm_acle.h>
+#endif
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+#define CONVERT_RV  359 // 1.402 in Q8
+#define CONVERT_GU  88  // 0.344 in Q8
+#define CONVERT_GV  183 // 0.714 in Q8
+#define CONVERT_BU  454 // 1.772 in Q8
+
+#define CONVERT_IS_TRANSPOSED(rot) (TUYA_DISPLAY_ROTATION_90 == (rot) || TUYA_DISPLAY_ROTATION_270 == (rot))
+
+#define CONVERT_MIN(a, b) (((a) < (b)) ? (a) : (b))
+
+// two signed 16 bit lanes, lo in the low halfword
+#define CONVERT_PACK16(lo, hi) (((uint32_t)(lo) & 0xFFFF) | ((uint32_t)(hi) << 16))
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef struct {
+    const uint8_t *y;
+    const uint8_t *u;
+    const uint8_t *v;
+} CONVERT_ROW_T;
+
+// chroma part of R, G and B for one U V pair
+typedef struct {
+    int32_t r;
+    int32_t g;
+    int32_t b;
+} CONVERT_UV_T;
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+static inline void __convert_uv(uint8_t u, uint8_t v, CONVERT_UV_T *uv)
+{
+    int32_t d = (int32_t)u - 128;
+    int32_t e = (int32_t)v - 128;
+
+    uv->r = (CONVERT_RV * e + 128) >> 8;
+    uv->g = -((CONVERT_GU * d + CONVERT_GV * e + 128) >> 8);
+    uv->b = (CONVERT_BU * d + 128) >> 8;
+}
+
+static inline uint8_t __convert_sat8(int32_t v)
+{
+#if (TDL_CAMERA_CONVERT_SIMD == 1)
+    return (uint8_t)__usat(v, 8);
+#else
+    return (uint8_t)((v < 0) ? 0 : (v > 255) ? 255 : v);
+#endif
+}
+
+/**
+ * @brief converts two pixels to RGB565, the first in the low halfword
+ */
+static inline uint32_t __rgb565_pair(const CONVERT_ROW_T *row, uint32_t yi0, uint32_t ci0, uint32_t yi1,
+                                     uint32_t ci1, bool is_swap)
+{
+    CONVERT_UV_T uv0, uv1;
+    uint32_t r, g, b, px;
+
+    __convert_uv(row->u[ci0], row->v[ci0], &uv0);
+    if (ci1 == ci0) {
+        uv1 = uv0;
+    } else {
+        __convert_uv(row->u[ci1], row->v[ci1], &uv1);
+    }
+
+#if (TDL_CAMERA_CONVERT_SIMD == 1)
+    uint32_t yy = CONVERT_PACK16(row->y[yi0], row->y[yi1]);
+    r = (uint32_t)__usat16(__sadd16(yy, CONVERT_PACK16(uv0.r, uv1.r)), 8);
+    g = (uint32_t)__usat16(__sadd16(yy, CONVERT_PACK16(uv0.g, uv1.g)), 8);
+    b = (uint32_t)__usat16(__sadd16(yy, CONVERT_PACK16(uv0.b, uv1.b)), 8);
+#else
+    int32_t y0 = row->y[yi0], y1 = row->y[yi1];
+    r = __convert_sat8(y0 + uv0.r) | ((uint32_t)__convert_sat8(y1 + uv1.r) << 16);
+    g = __convert_sat8(y0 + uv0.g) | ((uint32_t)__convert_sat8(y1 + uv1.g) << 16);
+    b = __convert_sat8(y0 + uv0.b) | ((uint32_t)__convert_sat8(y1 + uv1.b) << 16);
+#endif
+
+    px = ((r & 0x00F800F8) << 8) | ((g & 0x00FC00FC) << 3) | ((b >> 3) & 0x001F001F);
+    if (is_swap) {
+#if (TDL_CAMERA_CONVERT_SIMD == 1)
+        px = __rev16(px);
+#else
+        px = ((px & 0x00FF00FF) << 8) | ((px >> 8) & 0x00FF00FF);
+#endif
+    }
+
+    return px;
+}
+
+/**
+ * @brief converts num pixels of a row from column x0 on, writing them step pixels apart
+ */
+static void __convert_row_rgb565(const TDL_CAMERA_CONVERT_T *cv, const CONVERT_ROW_T *row, uint32_t x0,
+                                 uint32_t num, uint16_t *d, int32_t step)
+{
+    const uint32_t *yidx = &cv->yidx[x0];
+    const uint32_t *cidx = &cv->cidx[x0];
+    bool is_swap = cv->cfg.is_swap;
+    uint32_t i = 0, px;
+
+    if (1 == step && 0 == ((uintptr_t)d & 3)) {
+        uint32_t *w = (uint32_t *)d;
+        for (; i + 1 < num; i += 2) {
+            *w++ = __rgb565_pair(row, yidx[i], cidx[i], yidx[i + 1], cidx[i + 1], is_swap);
+        }
+        d = (uint16_t *)w;
+    } else if (-1 == step && 0 == ((uintptr_t)(d - 1) & 3)) {
+        uint32_t *w = (uint32_t *)(d - 1);
+        for (; i + 1 < num; i += 2) {
+            px = __rgb565_pair(row, yidx[i], cidx[i], yidx[i + 1], cidx[i + 1], is_swap);
+            *w-- = (px >> 16) | (px << 16);
+        }
+        d = (uint16_t *)w + 1;
+    } else {
+        for (; i + 1 < num; i += 2) {
+            px = __rgb565_pair(row, yidx[i], cidx[i], yidx[i + 1], cidx[i + 1], is_swap);
+            d[0] = (uint16_t)px;
+            d[step] = (uint16_t)(px >> 16);
+            d += 2 * step;
+        }
+    }
+
+    if (i < num) {
+        px = __rgb565_pair(row, yidx[i], cidx[i], yidx[i], cidx[i], is_swap);
+        d[0] = (uint16_t)px;
+    }
+}
+
+/**
+ * @brief converts num pixels of a row from column x0 on, writing them step bytes apart
+ */
+static void __convert_row_rgb888(const TDL_CAMERA_CONVERT_T *cv, const CONVERT_ROW_T *row, uint32_t x0,
+                                 uint32_t num, uint8_t *d, int32_t step)
+{
+    const uint32_t *yidx = &cv->yidx[x0];
+    const uint32_t *cidx = &cv->cidx[x0];
+    uint32_t last = (uint32_t)-1;
+    CONVERT_UV_T uv = {0};
+
+    for (uint32_t i = 0; i < num; i++, d += step) {
+        int32_t y = row->y[yidx[i]];
+        if (cidx[i] != last) {
+            last = cidx[i];
+            __convert_uv(row->u[last], row->v[last], &uv);
+        }
+        // same byte order as tdl_disp_draw_fill()
+        d[0] = __convert_sat8(y + uv.b);
+        d[1] = __convert_sat8(y + uv.g);
+        d[2] = __convert_sat8(y + uv.r);
+    }
+}
+
+static void __convert_row_setup(const TDL_CAMERA_CONVERT_T *cv, const uint8_t *src, uint32_t oy, CONVERT_ROW_T *row)
+{
+    const TDL_CAMERA_CONVERT_CFG_T *cfg = &cv->cfg;
+    uint32_t w = cfg->src_width, h = cfg->src_height;
+    uint32_t sy = (2 * oy + 1) * h / (2 * cfg->dst_height);
+
+    if (TUYA_FRAME_FMT_YUV422 == cfg->src_fmt) {
+        const uint8_t *base = src + sy * w * 2;
+        // YUYV: Y0 U Y1 V, UYVY: U Y0 V Y1
+        row->y = base + (cfg->y_offset & 1);
+        row->u = base + ((cfg->y_offset & 1) ? 0 : 1);
+        row->v = row->u + 2;
+    } else {
+        const uint8_t *chroma = src + w * h;
+        row->y = src + sy * w;
+        if (cfg->nv12) {
+            row->u = chroma + (sy / 2) * w;
+            row->v = row->u + 1;
+        } else {
+            row->u = chroma + (sy / 2) * (w / 2);
+            row->v = row->u + (w / 2) * (h / 2);
+        }
+    }
+}
+
+/**
+ * @brief output pixel of column x, row y before the rotation, and the pixels to the next column
+ */
+static uint32_t __convert_dst_index(const TDL_CAMERA_CONVERT_T *cv, uint32_t x, uint32_t y, int32_t *step)
+{
+    uint32_t w = cv->cfg.dst_width, h = cv->cfg.dst_height;
+
+    switch (cv->cfg.rotation) {
+    case TUYA_DISPLAY_ROTATION_90:
+        *step = -(int32_t)h;
+        return (w - 1 - x) * h + y;
+    case TUYA_DISPLAY_ROTATION_180:
+        *step = -1;
+        return (h - 1 - y) * w + (w - 1 - x);
+    case TUYA_DISPLAY_ROTATION_270:
+        *step = (int32_t)h;
+        return x * h + (h - 1 - y);
+    default:
+        *step = 1;
+        return y * w + x;
+    }
+}
+
+OPERATE_RET tdl_camera_convert_init(TDL_CAMERA_CONVERT_T *cv, const TDL_CAMERA_CONVERT_CFG_T *cfg)
+{
+    bool is_422;
+    uint32_t w, h, dw, dh;
+
+    if (NULL == cv || NULL == cfg) {
+        return OPRT_INVALID_PARM;
+    }
+
+    is_422 = (TUYA_FRAME_FMT_YUV422 == cfg->src_fmt);
+    if ((!is_422 && TUYA_FRAME_FMT_YUV420 != cfg->src_fmt) ||
+        (TUYA_PIXEL_FMT_RGB565 != cfg->dst_fmt && TUYA_PIXEL_FMT_RGB888 != cfg->dst_fmt)) {
+        return OPRT_NOT_SUPPORTED;
+    }
+
+    w = cfg->src_width;
+    h = cfg->src_height;
+    if (0 == w || 0 == h || (w & 1) || (!is_422 && (h & 1))) {
+        return OPRT_INVALID_PARM;
+    }
+
+    memset(cv, 0, sizeof(TDL_CAMERA_CONVERT_T));
+    cv->cfg = *cfg;
+    dw = cv->cfg.dst_width = cfg->dst_width ? cfg->dst_width : cfg->src_width;
+    dh = cv->cfg.dst_height = cfg->dst_height ? cfg->dst_height : cfg->src_height;
+
+    cv->out_width = CONVERT_IS_TRANSPOSED(cfg->rotation) ? dh : dw;
+    cv->out_height = CONVERT_IS_TRANSPOSED(cfg->rotation) ? dw : dh;
+    cv->out_len = dw * dh * ((TUYA_PIXEL_FMT_RGB565 == cfg->dst_fmt) ? 2 : 3);
+    cv->src_len = is_422 ? w * h * 2 : w * h * 3 / 2;
+
+    cv->yidx = tal_malloc(dw * sizeof(uint32_t));
+    cv->cidx = tal_malloc(dw * sizeof(uint32_t));
+    if (NULL == cv->yidx || NULL == cv->cidx) {
+        tdl_camera_convert_deinit(cv);
+        return OPRT_MALLOC_FAILED;
+    }
+
+    // nearest source column to the centre of each output column
+    for (uint32_t ox = 0; ox < dw; ox++) {
+        uint32_t sx = (2 * ox + 1) * w / (2 * dw);
+        if (is_422) {
+            cv->yidx[ox] = sx * 2;
+            cv->cidx[ox] = (sx >> 1) * 4;
+        } else {
+            cv->yidx[ox] = sx;
+            cv->cidx[ox] = cfg->nv12 ? (sx & ~1u) : (sx >> 1);
+        }
+    }
+
+    return OPRT_OK;
+}
+
+OPERATE_RET tdl_camera_convert_frame(const TDL_CAMERA_CONVERT_T *cv, const uint8_t *src, uint32_t src_len,
+                                     uint8_t *dst)
+{
+    CONVERT_ROW_T rows[TDL_CAMERA_CONVERT_TILE];
+    bool is_565;
+    uint32_t ow, oh, band, tile;
+
+    if (NULL == cv || NULL == cv->yidx || NULL == src || NULL == dst || src_len < cv->src_len) {
+        return OPRT_INVALID_PARM;
+    }
+
+    is_565 = (TUYA_PIXEL_FMT_RGB565 == cv->cfg.dst_fmt);
+    ow = cv->cfg.dst_width;
+    oh = cv->cfg.dst_height;
+
+    // a rotated row becomes a column, keep the columns of a tile in the cache
+    if (CONVERT_IS_TRANSPOSED(cv->cfg.rotation)) {
+        band = TDL_CAMERA_CONVERT_TILE;
+        tile = TDL_CAMERA_CONVERT_TILE;
+    } else {
+        band = 1;
+        tile = ow;
+    }
+
+    for (uint32_t ty = 0; ty < oh; ty += band) {
+        uint32_t th = CONVERT_MIN(band, oh - ty);
+
+        for (uint32_t j = 0; j < th; j++) {
+            __convert_row_setup(cv, src, ty + j, &rows[j]);
+        }
+
+        for (uint32_t tx = 0; tx < ow; tx += tile) {
+            uint32_t tw = CONVERT_MIN(tile, ow - tx);
+
+            for (uint32_t j = 0; j < th; j++) {
+                int32_t step = 0;
+                uint32_t idx = __convert_dst_index(cv, tx, ty + j, &step);
+                if (is_565) {
+                    __convert_row_rgb565(cv, &rows[j], tx, tw, (uint16_t *)dst + idx, step);
+                } else {
+                    __convert_row_rgb888(cv, &rows[j], tx, tw, dst + idx * 3, step * 3);
+                }
+            }
+        }
+    }
+
+    return OPRT_OK;
+}
+
+void tdl_camera_convert_deinit(TDL_CAMERA_CONVERT_T *cv)
+{
+    if (NULL == cv) {
+        return;
+    }
+
+    tal_free(cv->yidx);
+    tal_free(cv->cidx);
+    cv->yidx = NULL;
+    cv->cidx = NULL;
+}
@@ -22,6 +22,11 @@
 #define CAMERA_RAW_PER_PIXEL_MAX_BYTE       (3)
 #define CAMERA_ENCODE_MIN_COMP_PCT          (20) // uint:ENCODE
 
+// with ENABLE_EXT_RAM, frame buffers up to this size stay in SRAM, 0 puts all in PSRAM
+#ifndef CAMERA_FRAME_SRAM_MAX_LEN
+#define CAMERA_FRAME_SRAM_MAX_LEN           (0)
+#endif
+
 #if defined(ENABLE_EXT_RAM) && (ENABLE_EXT_RAM==1)
 #define TDL_CAMERA_FRAME_MALLOC    tkl_system_psram_malloc
 #define TDL_CAMERA_FRAME_FREE      tkl_system_psram_free
@@ -40,8 +45,9 @@ typedef struct {
     MUTEX_HANDLE                mutex;
    
     TDL_CAMERA_DEV_INFO_T       info;
-    TDL_CAMERA_GET_FRAME_CB     get_raw_frame_cb;
-    TDL_CAMERA_GET_FRAME_CB     get_encoded_frame_cb;
+    TDL_CAMERA_GET_FRAME_CB     frame_cb[TDL_CAMERA_STREAM_NUM][TDL_CAMERA_SUBSCRIBER_MAX];
+    bool                        encoded_gated;
+    bool                        wait_i_frame;   // the gate opened, H264 waits for a decodable frame
 
     struct tuya_list_head       raw_frame_node_list;
     struct tuya_list_head       encoded_frame_node_list;
@@ -52,6 +58,10 @@ typedef struct {
 
 typedef struct {
     struct tuya_list_head       node;
+    CAMERA_DEVICE_T            *dev;
+    struct tuya_list_head      *free_list;
+    uint8_t                     ref_cnt;    // 0 while on free_list
+    uint8_t                     stream;
     TDD_CAMERA_FRAME_T          tdd_frame;
 } CAMERA_FRAME_NODE_T;
 
@@ -139,16 +149,35 @@ static bool __is_camera_frame_encoded(TUYA_FRAME_FMT_E fmt)
 	return is_encoded;
 }
 
-static OPERATE_RET __camera_frame_node_init(struct tuya_list_head *phead, uint32_t node_num,\
-                                            uint32_t buf_len)
+static TDL_CAMERA_STREAM_E __camera_frame_stream(TUYA_FRAME_FMT_E fmt)
+{
+    return __is_camera_frame_encoded(fmt) ? TDL_CAMERA_STREAM_ENCODED : TDL_CAMERA_STREAM_RAW;
+}
+
+static void *__camera_frame_malloc(uint32_t buf_len)
+{
+#if defined(ENABLE_EXT_RAM) && (ENABLE_EXT_RAM==1)
+    // small frames are read by the CPU, keep them out of the slower PSRAM
+    if (buf_len <= CAMERA_FRAME_SRAM_MAX_LEN) {
+        return tal_malloc(buf_len);
+    }
+#endif
+    return TDL_CAMERA_FRAME_MALLOC(buf_len);
+}
+
+static OPERATE_RET __camera_frame_node_init(CAMERA_DEVICE_T *dev, TDL_CAMERA_STREAM_E stream, \
+                                            uint32_t node_num, uint32_t buf_len)
 {
     CAMERA_FRAME_NODE_T *frame_node = NULL;
+    struct tuya_list_head *phead = NULL;
     uint32_t i;
 
-    if(NULL == phead || 0 == buf_len || 0 == node_num) {
+    if(NULL == dev || 0 == buf_len || 0 == node_num) {
         return OPRT_INVALID_PARM;
     }
 
+    phead = (TDL_CAMERA_STREAM_RAW == stream) ? &dev->raw_frame_node_list : &dev->encoded_frame_node_list;
+
     for (i = 0; i < node_num; i++) {
         NEW_LIST_NODE(CAMERA_FRAME_NODE_T, frame_node);
         if (NULL == frame_node) {
@@ -156,15 +185,19 @@ static OPERATE_RET __camera_frame_node_init(struct tuya_list_head *phead, uint32
         }
         memset(frame_node, 0, sizeof(CAMERA_FRAME_NODE_T));
 
-        frame_node->tdd_frame.frame.data = TDL_CAMERA_FRAME_MALLOC(buf_len);
+        frame_node->tdd_frame.frame.data = __camera_frame_malloc(buf_len);
         if (NULL == frame_node->tdd_frame.frame.data) {
             FreeNode(frame_node);
             return OPRT_MALLOC_FAILED;
         }
         frame_node->tdd_frame.frame.data_len = buf_len;
         frame_node->tdd_frame.sys_param = (void *)frame_node;
+        frame_node->dev       = dev;
+        frame_node->free_list = phead;
+        frame_node->stream    = (uint8_t)stream;
 
         tuya_list_add(&frame_node->node, phead);
+        dev->info.stat[stream].pool_num++;
 
         PR_NOTICE("frame node %p, frame_data %p", frame_node, frame_node->tdd_frame.frame.data);
     }
@@ -172,6 +205,74 @@ static OPERATE_RET __camera_frame_node_init(struct tuya_list_head *phead, uint32
     return OPRT_OK;
 }
 
+static void __camera_frame_unref(CAMERA_FRAME_NODE_T *pnode)
+{
+    uint32_t irq_mask = tal_system_enter_critical();
+    if (pnode->ref_cnt && 0 == --pnode->ref_cnt) {
+        tuya_list_add_tail(&pnode->node, pnode->free_list);
+        pnode->dev->info.stat[pnode->stream].pool_used--;
+    }
+    tal_system_exit_critical(irq_mask);
+}
+
+// called in the critical section of the dispatch
+static bool __camera_frame_gated(CAMERA_DEVICE_T *dev, TDL_CAMERA_FRAME_T *frame)
+{
+    if (dev->encoded_gated) {
+        return true;
+    }
+
+    if (dev->wait_i_frame) {
+        if (TUYA_FRAME_FMT_H264 == frame->fmt && !frame->is_i_frame) {
+            return true;
+        }
+        dev->wait_i_frame = false;
+    }
+
+    return false;
+}
+
+/**
+ * @brief hand one frame to every subscriber of its stream
+ *
+ * The flow task holds the reference the driver created the frame with, a
+ * subscriber that keeps the frame takes its own, so the buffer goes back to
+ * the pool after the slowest one instead of being copied for each.
+ */
+static void __camera_frame_dispatch(CAMERA_MSG_T *msg, TDL_CAMERA_STREAM_E stream)
+{
+    TDL_CAMERA_GET_FRAME_CB cbs[TDL_CAMERA_SUBSCRIBER_MAX];
+    TDL_CAMERA_STREAM_STAT_T *stat = &msg->dev->info.stat[stream];
+    bool drop = false;
+    uint32_t i;
+
+    uint32_t irq_mask = tal_system_enter_critical();
+    stat->queue_depth--;
+    // a newer frame is already queued, skip this one and free its buffer
+    if (TDL_CAMERA_DROP_OLDEST == msg->dev->info.pool_policy && stat->queue_depth) {
+        stat->drop_queue++;
+        drop = true;
+    } else if (TDL_CAMERA_STREAM_ENCODED == stream && __camera_frame_gated(msg->dev, &msg->tdd_frame->frame)) {
+        stat->drop_gate++;
+        drop = true;
+    } else if (true == msg->dev->is_open) {
+        // subscribers may change from other tasks, deliver to a snapshot
+        memcpy(cbs, msg->dev->frame_cb[stream], sizeof(cbs));
+        stat->frames++;
+    }
+    tal_system_exit_critical(irq_mask);
+
+    if (false == drop && true == msg->dev->is_open) {
+        for (i = 0; i < TDL_CAMERA_SUBSCRIBER_MAX; i++) {
+            if (cbs[i]) {
+                cbs[i]((TDL_CAMERA_HANDLE_T)msg->dev, &msg->tdd_frame->frame);
+            }
+        }
+    }
+
+    tdl_camera_release_tdd_frame(msg->dev->tdd_hdl, msg->tdd_frame);
+}
+
 static void __raw_flow_task(void *args)
 {
     CAMERA_MSG_T msg;
@@ -184,11 +285,7 @@ static void __raw_flow_task(void *args)
             continue;
         }
 
-		if((true == msg.dev->is_open) && msg.dev->get_raw_frame_cb) {
-            msg.dev->get_raw_frame_cb((TDL_CAMERA_HANDLE_T)msg.dev, &msg.tdd_frame->frame);
-        }
-
-		tdl_camera_release_tdd_frame(msg.dev->tdd_hdl, msg.tdd_frame);
+		__camera_frame_dispatch(&msg, TDL_CAMERA_STREAM_RAW);
 	}
 }
 
@@ -203,12 +300,31 @@ static void __encoded_flow_task(void *args)
             continue;
         }
 
-		if ((true == msg.dev->is_open) && msg.dev->get_encoded_frame_cb) {
-            msg.dev->get_encoded_frame_cb((TDL_CAMERA_HANDLE_T)msg.dev, &msg.tdd_frame->frame);
+		__camera_frame_dispatch(&msg, TDL_CAMERA_STREAM_ENCODED);
+	}
+}
+
+static OPERATE_RET __camera_subscribe(CAMERA_DEVICE_T *dev, TDL_CAMERA_STREAM_E stream, TDL_CAMERA_GET_FRAME_CB cb)
+{
+    OPERATE_RET rt = OPRT_EXCEED_UPPER_LIMIT;
+    uint32_t i;
+
+    uint32_t irq_mask = tal_system_enter_critical();
+    for (i = 0; i < TDL_CAMERA_SUBSCRIBER_MAX; i++) {
+        if (cb == dev->frame_cb[stream][i]) {
+            rt = OPRT_OK;
+            break;
         }
+    }
+    for (i = 0; (OPRT_OK != rt) && (i < TDL_CAMERA_SUBSCRIBER_MAX); i++) {
+        if (NULL == dev->frame_cb[stream][i]) {
+            dev->frame_cb[stream][i] = cb;
+            rt = OPRT_OK;
+        }
+    }
+    tal_system_exit_critical(irq_mask);
 
-		tdl_camera_release_tdd_frame(msg.dev->tdd_hdl, msg.tdd_frame);
-	}
+    return rt;
 }
 
 static OPERATE_RET __camera_manage_init(TDL_CAMERA_FMT_E out_fmt)
@@ -218,7 +334,7 @@ static OPERATE_RET __camera_manage_init(TDL_CAMERA_FMT_E out_fmt)
     if(out_fmt & TDL_IMG_FMT_RAW_MASK) {
         if(NULL == sg_camera_manage.raw_frame_queue) {
             TUYA_CALL_ERR_RETURN(tal_queue_create_init(&(sg_camera_manage.raw_frame_queue),\
-                                                     sizeof(CAMERA_MSG_T), CAMERA_RAW_FRAME_BUFF_CNT));
+                                                     sizeof(CAMERA_MSG_T), TDL_CAMERA_FRAME_BUFF_MAX));
         }
     
         if(NULL == sg_camera_manage.raw_thrd) {
@@ -231,7 +347,7 @@ static OPERATE_RET __camera_manage_init(TDL_CAMERA_FMT_E out_fmt)
     if(out_fmt & TDL_IMG_FMT_ENCODED_MASK) {
         if(NULL == sg_camera_manage.encoded_frame_queue) {
             TUYA_CALL_ERR_RETURN(tal_queue_create_init(&(sg_camera_manage.encoded_frame_queue),\
-                                                     sizeof(CAMERA_MSG_T), CAMERA_RAW_FRAME_BUFF_CNT));
+                                                     sizeof(CAMERA_MSG_T), TDL_CAMERA_FRAME_BUFF_MAX));
         }
     
         if(NULL == sg_camera_manage.encoded_thrd) {
@@ -257,7 +373,10 @@ OPERATE_RET tdl_camera_dev_get_info(TDL_CAMERA_HANDLE_T camera_hdl, TDL_CAMERA_D
         return OPRT_INVALID_PARM;
     }
 
+    // the counters move in the flow tasks and the capture path
+    uint32_t irq_mask = tal_system_enter_critical();
     memcpy(dev_info, &camera_dev->info, sizeof(TDL_CAMERA_DEV_INFO_T));
+    tal_system_exit_critical(irq_mask);
 
     return OPRT_OK;
 }
@@ -267,11 +386,17 @@ OPERATE_RET tdl_camera_dev_open(TDL_CAMERA_HANDLE_T camera_hdl,  TDL_CAMERA_CFG_
     OPERATE_RET rt = OPRT_OK;
     CAMERA_DEVICE_T *camera_dev = NULL;
     uint32_t raw_buf_len = 0;
+    uint32_t buf_cnt = 0;
 
     if(NULL == camera_hdl || NULL == cfg) {
         return OPRT_INVALID_PARM;
     }
 
+    if (cfg->raw_buf_cnt > TDL_CAMERA_FRAME_BUFF_MAX || cfg->encoded_buf_cnt > TDL_CAMERA_FRAME_BUFF_MAX) {
+        PR_ERR("frame buffer cnt %d/%d over %d", cfg->raw_buf_cnt, cfg->encoded_buf_cnt, TDL_CAMERA_FRAME_BUFF_MAX);
+        return OPRT_INVALID_PARM;
+    }
+
     camera_dev = (CAMERA_DEVICE_T *)camera_hdl;
 
     TUYA_CALL_ERR_RETURN(__camera_manage_init(cfg->out_fmt));
@@ -279,22 +404,30 @@ OPERATE_RET tdl_camera_dev_open(TDL_CAMERA_HANDLE_T camera_hdl,  TDL_CAMERA_CFG_
     raw_buf_len = cfg->width * cfg->height * CAMERA_RAW_PER_PIXEL_MAX_BYTE;
 
     if(cfg->out_fmt & TDL_IMG_FMT_RAW_MASK) {
-        TUYA_CALL_ERR_RETURN(__camera_frame_node_init(&camera_dev->raw_frame_node_list, \
-                                                      CAMERA_RAW_FRAME_BUFF_CNT, raw_buf_len));
-        camera_dev->get_raw_frame_cb = cfg->get_frame_cb;
+        buf_cnt = cfg->raw_buf_cnt ? cfg->raw_buf_cnt : CAMERA_RAW_FRAME_BUFF_CNT;
+        TUYA_CALL_ERR_RETURN(__camera_frame_node_init(camera_dev, TDL_CAMERA_STREAM_RAW, \
+                                                      buf_cnt, raw_buf_len));
+        if (cfg->get_frame_cb) {
+            TUYA_CALL_ERR_RETURN(__camera_subscribe(camera_dev, TDL_CAMERA_STREAM_RAW, cfg->get_frame_cb));
+        }
     }
 
     if(cfg->out_fmt & TDL_IMG_FMT_ENCODED_MASK) {
         uint32_t encoded_buf_len = (raw_buf_len * CAMERA_ENCODE_MIN_COMP_PCT + 99) / 100;
-        TUYA_CALL_ERR_RETURN(__camera_frame_node_init(&camera_dev->encoded_frame_node_list, \
-                                                      CAMERA_ENCODE_FRAME_BUFF_CNT, encoded_buf_len));
-        camera_dev->get_encoded_frame_cb = cfg->get_encoded_frame_cb;
+        buf_cnt = cfg->encoded_buf_cnt ? cfg->encoded_buf_cnt : CAMERA_ENCODE_FRAME_BUFF_CNT;
+        TUYA_CALL_ERR_RETURN(__camera_frame_node_init(camera_dev, TDL_CAMERA_STREAM_ENCODED, \
+                                                      buf_cnt, encoded_buf_len));
+        if (cfg->get_encoded_frame_cb) {
+            TUYA_CALL_ERR_RETURN(__camera_subscribe(camera_dev, TDL_CAMERA_STREAM_ENCODED, \
+                                                    cfg->get_encoded_frame_cb));
+        }
     }  
     
     camera_dev->info.fps     = cfg->fps;
     camera_dev->info.width   = cfg->width;
     camera_dev->info.height  = cfg->height;
     camera_dev->info.out_fmt = cfg->out_fmt;
+    camera_dev->info.pool_policy = cfg->pool_policy;
 
     if(camera_dev->intfs.open) {
         TDD_CAMERA_OPEN_CFG_T open_cfg;
@@ -317,6 +450,104 @@ OPERATE_RET tdl_camera_dev_close(TDL_CAMERA_HANDLE_T camera_hdl)
     return OPRT_NOT_SUPPORTED;
 }
 
+OPERATE_RET tdl_camera_dev_subscribe(TDL_CAMERA_HANDLE_T camera_hdl, TDL_CAMERA_STREAM_E stream,
+                                     TDL_CAMERA_GET_FRAME_CB cb)
+{
+    if (NULL == camera_hdl || NULL == cb || stream >= TDL_CAMERA_STREAM_NUM) {
+        return OPRT_INVALID_PARM;
+    }
+
+    return __camera_subscribe((CAMERA_DEVICE_T *)camera_hdl, stream, cb);
+}
+
+OPERATE_RET tdl_camera_dev_unsubscribe(TDL_CAMERA_HANDLE_T camera_hdl, TDL_CAMERA_STREAM_E stream,
+                                       TDL_CAMERA_GET_FRAME_CB cb)
+{
+    CAMERA_DEVICE_T *camera_dev = (CAMERA_DEVICE_T *)camera_hdl;
+    OPERATE_RET rt = OPRT_NOT_FOUND;
+    uint32_t i;
+
+    if (NULL == camera_dev || NULL == cb || stream >= TDL_CAMERA_STREAM_NUM) {
+        return OPRT_INVALID_PARM;
+    }
+
+    uint32_t irq_mask = tal_system_enter_critical();
+    for (i = 0; i < TDL_CAMERA_SUBSCRIBER_MAX; i++) {
+        if (cb == camera_dev->frame_cb[stream][i]) {
+            camera_dev->frame_cb[stream][i] = NULL;
+            rt = OPRT_OK;
+            break;
+        }
+    }
+    tal_system_exit_critical(irq_mask);
+
+    return rt;
+}
+
+OPERATE_RET tdl_camera_dev_set_encoded_gate(TDL_CAMERA_HANDLE_T camera_hdl, bool open)
+{
+    CAMERA_DEVICE_T *camera_dev = (CAMERA_DEVICE_T *)camera_hdl;
+
+    if (NULL == camera_dev) {
+        return OPRT_INVALID_PARM;
+    }
+
+    uint32_t irq_mask = tal_system_enter_critical();
+    if (open && camera_dev->encoded_gated) {
+        camera_dev->wait_i_frame = true;
+    }
+    camera_dev->encoded_gated = !open;
+    tal_system_exit_critical(irq_mask);
+
+    return OPRT_OK;
+}
+
+OPERATE_RET tdl_camera_frame_hold(TDL_CAMERA_FRAME_T *frame)
+{
+    CAMERA_FRAME_NODE_T *pnode = NULL;
+    OPERATE_RET rt = OPRT_OK;
+
+    if (NULL == frame) {
+        return OPRT_INVALID_PARM;
+    }
+
+    pnode = tuya_list_entry(frame, CAMERA_FRAME_NODE_T, tdd_frame.frame);
+    if (pnode->tdd_frame.sys_param != (void *)pnode) {
+        PR_ERR("frame %p is not a camera frame", frame);
+        return OPRT_INVALID_PARM;
+    }
+
+    uint32_t irq_mask = tal_system_enter_critical();
+    if (0 == pnode->ref_cnt) {
+        // only a frame still in use may be held, a free one may be refilled
+        rt = OPRT_RESOURCE_NOT_READY;
+    } else if (0xFF == pnode->ref_cnt) {
+        rt = OPRT_EXCEED_UPPER_LIMIT;
+    } else {
+        pnode->ref_cnt++;
+    }
+    tal_system_exit_critical(irq_mask);
+
+    return rt;
+}
+
+void tdl_camera_frame_release(TDL_CAMERA_FRAME_T *frame)
+{
+    CAMERA_FRAME_NODE_T *pnode = NULL;
+
+    if (NULL == frame) {
+        return;
+    }
+
+    pnode = tuya_list_entry(frame, CAMERA_FRAME_NODE_T, tdd_frame.frame);
+    if (pnode->tdd_frame.sys_param != (void *)pnode) {
+        PR_ERR("frame %p is not a camera frame", frame);
+        return;
+    }
+
+    __camera_frame_unref(pnode);
+}
+
 OPERATE_RET tdl_camera_device_register(char *name, TDD_CAMERA_DEV_HANDLE_T tdd_hdl, \
                                        TDD_CAMERA_INTFS_T *intfs, TDD_CAMERA_DEV_INFO_T *dev_info)
 {
@@ -360,6 +591,8 @@ TDD_CAMERA_FRAME_T *tdl_camera_create_tdd_frame(TDD_CAMERA_DEV_HANDLE_T tdd_hdl,
     CAMERA_DEVICE_T *camera_dev = NULL;
     struct tuya_list_head *pframe_list = NULL;
     CAMERA_FRAME_NODE_T *pnode = NULL;
+    TDL_CAMERA_STREAM_STAT_T *stat = NULL;
+    uint32_t irq_mask;
 
     camera_dev = __find_camera_device_from_tdd(tdd_hdl);
     if (NULL == camera_dev) {
@@ -368,14 +601,24 @@ TDD_CAMERA_FRAME_T *tdl_camera_create_tdd_frame(TDD_CAMERA_DEV_HANDLE_T tdd_hdl,
 
     pframe_list = (false == __is_camera_frame_encoded(fmt)) ? \
                   &camera_dev->raw_frame_node_list : &camera_dev->encoded_frame_node_list;
-             
+    stat = &camera_dev->info.stat[__camera_frame_stream(fmt)];
+
+    // frames held by subscribers come back from their tasks
+    irq_mask = tal_system_enter_critical();
     if(tuya_list_empty(pframe_list)) {
+        stat->drop_pool++;
+        tal_system_exit_critical(irq_mask);
         return NULL;
     }
 
     pnode = tuya_list_entry(pframe_list->next, CAMERA_FRAME_NODE_T, node);
 
     tuya_list_del(&pnode->node);
+    pnode->ref_cnt = 1;
+    if (++stat->pool_used > stat->pool_peak) {
+        stat->pool_peak = stat->pool_used;
+    }
+    tal_system_exit_critical(irq_mask);
 
     pnode->tdd_frame.frame.fmt = fmt;
 
@@ -385,7 +628,6 @@ TDD_CAMERA_FRAME_T *tdl_camera_create_tdd_frame(TDD_CAMERA_DEV_HANDLE_T tdd_hdl,
 void tdl_camera_release_tdd_frame(TDD_CAMERA_DEV_HANDLE_T tdd_hdl, TDD_CAMERA_FRAME_T *frame)
 {    
     CAMERA_DEVICE_T *camera_dev = NULL;
-    struct tuya_list_head *pframe_list = NULL;
     CAMERA_FRAME_NODE_T *pnode = NULL;
 
     if(NULL == frame || NULL == tdd_hdl) {
@@ -402,21 +644,25 @@ void tdl_camera_release_tdd_frame(TDD_CAMERA_DEV_HANDLE_T tdd_hdl, TDD_CAMERA_FR
         return;
     }
 
-    pframe_list = (false == __is_camera_frame_encoded(frame->frame.fmt)) ? \
-                  &camera_dev->raw_frame_node_list : &camera_dev->encoded_frame_node_list;
-
     pnode = (CAMERA_FRAME_NODE_T *)frame->sys_param;
+    if (pnode->dev != camera_dev) {
+        PR_ERR("frame %p is not from this camera", frame);
+        return;
+    }
 
-    tuya_list_add_tail(&pnode->node, pframe_list);
+    __camera_frame_unref(pnode);
 
     return;
 }
 
 OPERATE_RET tdl_camera_post_tdd_frame(TDD_CAMERA_DEV_HANDLE_T tdd_hdl, TDD_CAMERA_FRAME_T *frame)
 {
+    OPERATE_RET rt = OPRT_OK;
     CAMERA_MSG_T msg;
     QUEUE_HANDLE queue;
     CAMERA_DEVICE_T *camera_dev = NULL;
+    TDL_CAMERA_STREAM_STAT_T *stat = NULL;
+    uint32_t irq_mask;
 
     if(NULL == frame || NULL == tdd_hdl) {
         return OPRT_INVALID_PARM;
@@ -442,5 +688,23 @@ OPERATE_RET tdl_camera_post_tdd_frame(TDD_CAMERA_DEV_HANDLE_T tdd_hdl, TDD_CAMER
     msg.tdd_frame = frame;
     msg.dev       = camera_dev;
 
-    return tal_queue_post(queue, &msg, 0);
+    // counted before the post, the flow task may fetch it right away
+    stat = &camera_dev->info.stat[__camera_frame_stream(frame->frame.fmt)];
+    irq_mask = tal_system_enter_critical();
+    if (++stat->queue_depth > stat->queue_peak) {
+        stat->queue_peak = stat->queue_depth;
+    }
+    tal_system_exit_critical(irq_mask);
+
+    rt = tal_queue_post(queue, &msg, 0);
+    if (OPRT_OK != rt) {
+        irq_mask = tal_system_enter_critical();
+        stat->queue_depth--;
+        stat->drop_queue++;
+        tal_system_exit_critical(irq_mask);
+        // nobody else gets the frame, give its buffer back
+        tdl_camera_release_tdd_frame(tdd_hdl, frame);
+    }
+
+    return rt;
 }
\ No newline at end of file
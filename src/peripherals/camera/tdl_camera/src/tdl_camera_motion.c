@@ -0,0 +1,443 @@
+/**
+ * @file tdl_camera_motion.c
+ * @brief Motion detection on the raw camera stream.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include "tuya_cloud_types.h"
+#include "tal_api.h"
+
+#include "tdl_camera_manage.h"
+#include "tdl_camera_motion.h"
+
+// the row kernel adds two luma bytes per instruction, see __luma_sum()
+#ifndef TDL_CAMERA_MOTION_SIMD
+#if defined(__ARM_FEATURE_SIMD32) && (__ARM_FEATURE_SIMD32 == 1)
+#define TDL_CAMERA_MOTION_SIMD 1
+#else
+#define TDL_CAMERA_MOTION_SIMD 0
+#endif
+#endif
+
+#if (TDL_CAMERA_MOTION_SIMD == 1)
+#include <arm_acle.h>
+#endif
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+#define MOTION_GRID_W_DEF       16
+#define MOTION_GRID_H_DEF       12
+#define MOTION_ROW_STEP_DEF     4
+#define MOTION_CELL_THRESH_DEF  12
+#define MOTION_LEARN_SHIFT_DEF  4
+#define MOTION_MIN_CELLS_DEF    2
+#define MOTION_TRIGGER_DEF      2
+#define MOTION_HOLD_MS_DEF      3000
+
+// moving cells follow the scene this many times slower, so a visitor is not learned away
+#define MOTION_LEARN_SLOW_SHIFT 2
+
+// background is kept in Q4 luma
+#define MOTION_Q                4
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef struct {
+    MUTEX_HANDLE                mutex;
+    TDL_CAMERA_HANDLE_T         hdl;
+    TDL_CAMERA_MOTION_CFG_T     cfg;
+    bool                        running;
+    bool                        seeded;
+    uint8_t                     streak;
+    uint16_t                    cells;
+    uint16_t                    width;      // frame size the cell bounds are for
+    uint16_t                    height;
+    uint16_t                    xb[TDL_CAMERA_MOTION_GRID_W_MAX + 1];
+    uint16_t                   *bg;         // per cell background luma, Q4
+    uint32_t                   *sum;        // per cell luma sum of the frame
+    uint32_t                   *cnt;        // per cell pixels summed
+    SYS_TIME_T                  last_ms;
+    SYS_TIME_T                  motion_ms;
+    TDL_CAMERA_MOTION_INFO_T    info;
+} CAMERA_MOTION_T;
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static CAMERA_MOTION_T sg_motion;
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+/**
+ * @brief sums the luma of num pixels starting at px
+ *
+ * Two pixels of packed YUV422 (stride 2, luma at byte off of each pair) or
+ * four of the YUV420 luma plane (stride 1) are read as one little endian
+ * word, and the luma bytes are added in two 16 bit lanes. The lanes are
+ * folded every 128 words, before 510 a word could overflow them.
+ */
+static uint32_t __luma_sum(const uint8_t *px, uint32_t num, uint8_t stride, uint8_t off)
+{
+    uint32_t sum = 0, i = 0;
+
+    if (0 == ((uintptr_t)px & 3)) {
+        const uint32_t *w = (const uint32_t *)px;
+        uint32_t per_word = 4 / stride;
+        uint32_t words = num / per_word;
+        uint32_t n = 0;
+
+        while (n < words) {
+            uint32_t acc = 0, end = n + 128;
+            if (end > words) {
+                end = words;
+            }
+            for (; n < end; n++) {
+                uint32_t v = w[n] >> (off * 8);
+#if (TDL_CAMERA_MOTION_SIMD == 1)
+                acc = __uxtab16(acc, v);
+                if (1 == stride) {
+                    acc = __uxtab16(acc, v >> 8);
+                }
+#else
+                acc += v & 0x00FF00FF;
+                if (1 == stride) {
+                    acc += (v >> 8) & 0x00FF00FF;
+                }
+#endif
+            }
+            sum += (acc & 0xFFFF) + (acc >> 16);
+        }
+        i = words * per_word;
+    }
+
+    for (; i < num; i++) {
+        sum += px[i * stride + off];
+    }
+
+    return sum;
+}
+
+static void __motion_cell_bounds(CAMERA_MOTION_T *m, uint16_t width, uint16_t height)
+{
+    uint32_t cx;
+
+    // even bounds keep a YUV422 pixel pair in one cell
+    for (cx = 0; cx <= m->cfg.grid_w; cx++) {
+        m->xb[cx] = (uint16_t)((cx * width / m->cfg.grid_w) & ~1u);
+    }
+    m->xb[m->cfg.grid_w] = width;
+    m->width = width;
+    m->height = height;
+    m->seeded = false;
+}
+
+/**
+ * @brief reduces the frame to the mean luma per cell, returns false on an unsupported format
+ */
+static bool __motion_reduce(CAMERA_MOTION_T *m, TDL_CAMERA_FRAME_T *frame)
+{
+    const uint8_t *luma = frame->data;
+    uint8_t stride, off = 0;
+    uint32_t row_len, y, cx, cy;
+
+    if (TUYA_FRAME_FMT_YUV422 == frame->fmt) {
+        off = m->cfg.y_offset & 1;
+        stride = 2;
+        row_len = (uint32_t)frame->width * 2;
+    } else if (TUYA_FRAME_FMT_YUV420 == frame->fmt) {
+        stride = 1;
+        row_len = frame->width;
+    } else {
+        return false;
+    }
+
+    if (row_len * frame->height > frame->data_len || frame->width < m->cfg.grid_w * 2 ||
+        frame->height < m->cfg.grid_h) {
+        return false;
+    }
+
+    if (frame->width != m->width || frame->height != m->height) {
+        __motion_cell_bounds(m, frame->width, frame->height);
+    }
+
+    memset(m->sum, 0, m->cells * sizeof(uint32_t));
+    memset(m->cnt, 0, m->cells * sizeof(uint32_t));
+
+    for (y = 0; y < frame->height; y += m->cfg.row_step) {
+        const uint8_t *row = luma + y * row_len;
+        uint32_t base;
+
+        cy = y * m->cfg.grid_h / frame->height;
+        base = cy * m->cfg.grid_w;
+        for (cx = 0; cx < m->cfg.grid_w; cx++) {
+            uint32_t x0 = m->xb[cx], num = m->xb[cx + 1] - x0;
+            m->sum[base + cx] += __luma_sum(row + x0 * stride, num, stride, off);
+            m->cnt[base + cx] += num;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief compares the cells with the background and updates it, returns the moving cells
+ */
+static uint16_t __motion_compare(CAMERA_MOTION_T *m)
+{
+    int32_t thresh = (int32_t)m->cfg.cell_thresh << MOTION_Q;
+    uint16_t moving = 0;
+    uint32_t i;
+
+    for (i = 0; i < m->cells; i++) {
+        m->sum[i] = m->cnt[i] ? ((m->sum[i] << MOTION_Q) / m->cnt[i]) : 0;
+    }
+
+    if (!m->seeded) {
+        for (i = 0; i < m->cells; i++) {
+            m->bg[i] = (uint16_t)m->sum[i];
+        }
+        m->seeded = true;
+        return 0;
+    }
+
+    for (i = 0; i < m->cells; i++) {
+        int32_t diff = (int32_t)m->sum[i] - m->bg[i];
+        if (diff > thresh || -diff > thresh) {
+            moving++;
+        }
+    }
+
+    // the whole scene changed, start over from this frame
+    if ((uint32_t)moving * 100 >= (uint32_t)m->cells * TDL_CAMERA_MOTION_GLOBAL_PCT) {
+        for (i = 0; i < m->cells; i++) {
+            m->bg[i] = (uint16_t)m->sum[i];
+        }
+        m->info.relearns++;
+        return 0;
+    }
+
+    for (i = 0; i < m->cells; i++) {
+        int32_t diff = (int32_t)m->sum[i] - m->bg[i];
+        uint8_t shift = m->cfg.learn_shift;
+        if (diff > thresh || -diff > thresh) {
+            shift += MOTION_LEARN_SLOW_SHIFT;
+        }
+        // a change under 2^shift still moves the background by one step
+        if (diff > 0) {
+            m->bg[i] += (uint16_t)((diff >> shift) ? (diff >> shift) : 1);
+        } else if (diff < 0) {
+            m->bg[i] -= (uint16_t)((-diff >> shift) ? (-diff >> shift) : 1);
+        }
+    }
+
+    return moving;
+}
+
+static void __motion_set_active(CAMERA_MOTION_T *m, bool active, uint16_t cells, TDL_CAMERA_MOTION_EVENT_T *event)
+{
+    m->info.active = active;
+    if (active) {
+        m->info.events++;
+    }
+    if (m->cfg.gate_encoded) {
+        tdl_camera_dev_set_encoded_gate(m->hdl, active);
+    }
+
+    event->active = active;
+    event->cells = cells;
+    event->cells_total = m->cells;
+}
+
+static OPERATE_RET __motion_frame_cb(TDL_CAMERA_HANDLE_T hdl, TDL_CAMERA_FRAME_T *frame)
+{
+    CAMERA_MOTION_T *m = &sg_motion;
+    SYS_TIME_T now = tal_system_get_millisecond();
+    TDL_CAMERA_MOTION_EVENT_T event = {0};
+    bool publish = false;
+    uint16_t moving;
+
+    if (NULL == m->mutex || OPRT_OK != tal_mutex_lock(m->mutex)) {
+        return OPRT_OK;
+    }
+
+    if (!m->running || hdl != m->hdl || (m->cfg.interval_ms && now - m->last_ms < m->cfg.interval_ms)) {
+        tal_mutex_unlock(m->mutex);
+        return OPRT_OK;
+    }
+    m->last_ms = now;
+
+    if (!__motion_reduce(m, frame)) {
+        m->info.skipped++;
+        tal_mutex_unlock(m->mutex);
+        return OPRT_OK;
+    }
+
+    moving = __motion_compare(m);
+    m->info.frames++;
+    m->info.cells = moving;
+
+    if (moving >= m->cfg.min_cells) {
+        if (m->streak < 0xFF) {
+            m->streak++;
+        }
+        if (m->streak >= m->cfg.trigger_frames) {
+            m->motion_ms = now;
+            if (!m->info.active) {
+                __motion_set_active(m, true, moving, &event);
+                publish = true;
+            }
+        }
+    } else {
+        m->streak = 0;
+    }
+
+    if (m->info.active && now - m->motion_ms > m->cfg.hold_ms) {
+        __motion_set_active(m, false, moving, &event);
+        publish = true;
+    }
+
+    tal_mutex_unlock(m->mutex);
+
+    // subscribers may query the detector, publish without the lock
+    if (publish) {
+        tal_event_publish_copy(EVENT_CAMERA_MOTION, &event, sizeof(event));
+    }
+
+    return OPRT_OK;
+}
+
+static void __motion_free(CAMERA_MOTION_T *m)
+{
+    tal_free(m->bg);
+    tal_free(m->sum);
+    tal_free(m->cnt);
+    m->bg = NULL;
+    m->sum = NULL;
+    m->cnt = NULL;
+}
+
+OPERATE_RET tdl_camera_motion_start(TDL_CAMERA_HANDLE_T camera_hdl, TDL_CAMERA_MOTION_CFG_T *cfg)
+{
+    CAMERA_MOTION_T *m = &sg_motion;
+    TDL_CAMERA_MOTION_CFG_T def = {0};
+    OPERATE_RET rt = OPRT_OK;
+    uint32_t cells;
+
+    if (NULL == camera_hdl) {
+        return OPRT_INVALID_PARM;
+    }
+    if (NULL == cfg) {
+        cfg = &def;
+    }
+    if (cfg->grid_w > TDL_CAMERA_MOTION_GRID_W_MAX || cfg->grid_h > TDL_CAMERA_MOTION_GRID_H_MAX) {
+        return OPRT_INVALID_PARM;
+    }
+
+    if (NULL == m->mutex) {
+        TUYA_CALL_ERR_RETURN(tal_mutex_create_init(&m->mutex));
+    }
+
+    tdl_camera_motion_stop();
+
+    tal_mutex_lock(m->mutex);
+    m->cfg = *cfg;
+    m->cfg.grid_w = cfg->grid_w ? cfg->grid_w : MOTION_GRID_W_DEF;
+    m->cfg.grid_h = cfg->grid_h ? cfg->grid_h : MOTION_GRID_H_DEF;
+    m->cfg.row_step = cfg->row_step ? cfg->row_step : MOTION_ROW_STEP_DEF;
+    m->cfg.cell_thresh = cfg->cell_thresh ? cfg->cell_thresh : MOTION_CELL_THRESH_DEF;
+    m->cfg.learn_shift = cfg->learn_shift ? cfg->learn_shift : MOTION_LEARN_SHIFT_DEF;
+    m->cfg.min_cells = cfg->min_cells ? cfg->min_cells : MOTION_MIN_CELLS_DEF;
+    m->cfg.trigger_frames = cfg->trigger_frames ? cfg->trigger_frames : MOTION_TRIGGER_DEF;
+    m->cfg.hold_ms = cfg->hold_ms ? cfg->hold_ms : MOTION_HOLD_MS_DEF;
+
+    cells = (uint32_t)m->cfg.grid_w * m->cfg.grid_h;
+    m->bg = tal_malloc(cells * sizeof(uint16_t));
+    m->sum = tal_malloc(cells * sizeof(uint32_t));
+    m->cnt = tal_malloc(cells * sizeof(uint32_t));
+    if (NULL == m->bg || NULL == m->sum || NULL == m->cnt) {
+        __motion_free(m);
+        tal_mutex_unlock(m->mutex);
+        return OPRT_MALLOC_FAILED;
+    }
+
+    m->hdl = camera_hdl;
+    m->cells = (uint16_t)cells;
+    m->width = 0;
+    m->height = 0;
+    m->seeded = false;
+    m->streak = 0;
+    m->last_ms = 0;
+    memset(&m->info, 0, sizeof(m->info));
+    m->running = true;
+    tal_mutex_unlock(m->mutex);
+
+    // nothing moves until the first frames say otherwise
+    if (m->cfg.gate_encoded) {
+        tdl_camera_dev_set_encoded_gate(camera_hdl, false);
+    }
+
+    rt = tdl_camera_dev_subscribe(camera_hdl, TDL_CAMERA_STREAM_RAW, __motion_frame_cb);
+    if (OPRT_OK != rt) {
+        tdl_camera_motion_stop();
+        return rt;
+    }
+
+    PR_DEBUG("camera motion start, grid %ux%u, simd %d", m->cfg.grid_w, m->cfg.grid_h, TDL_CAMERA_MOTION_SIMD);
+
+    return OPRT_OK;
+}
+
+OPERATE_RET tdl_camera_motion_stop(void)
+{
+    CAMERA_MOTION_T *m = &sg_motion;
+
+    if (NULL == m->mutex) {
+        return OPRT_OK;
+    }
+
+    tal_mutex_lock(m->mutex);
+    if (!m->running) {
+        tal_mutex_unlock(m->mutex);
+        return OPRT_OK;
+    }
+    m->running = false;
+    // the flow task may still call back once from its snapshot, it now sees running false
+    tdl_camera_dev_unsubscribe(m->hdl, TDL_CAMERA_STREAM_RAW, __motion_frame_cb);
+    if (m->cfg.gate_encoded) {
+        tdl_camera_dev_set_encoded_gate(m->hdl, true);
+    }
+    m->info.active = false;
+    __motion_free(m);
+    tal_mutex_unlock(m->mutex);
+
+    return OPRT_OK;
+}
+
+bool tdl_camera_motion_is_active(void)
+{
+    return sg_motion.running && sg_motion.info.active;
+}
+
+OPERATE_RET tdl_camera_motion_get_info(TDL_CAMERA_MOTION_INFO_T *info)
+{
+    CAMERA_MOTION_T *m = &sg_motion;
+
+    if (NULL == info) {
+        return OPRT_INVALID_PARM;
+    }
+    if (NULL == m->mutex) {
+        memset(info, 0, sizeof(TDL_CAMERA_MOTION_INFO_T));
+        return OPRT_OK;
+    }
+
+    tal_mutex_lock(m->mutex);
+    *info = m->info;
+    tal_mutex_unlock(m->mutex);
+
+    return OPRT_OK;
+}
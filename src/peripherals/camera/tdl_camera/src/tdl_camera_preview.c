@@ -0,0 +1,490 @@
+/**
+ * @file tdl_camera_preview.c
+ * @brief Raw camera stream shown on a display.
+ *
+ * The frame buffers are sized for the whole display and created at the first
+ * start. The display gives a buffer back through its free_cb, possibly from
+ * an interrupt, which only clears the busy flag and wakes the task. A buffer
+ * the display still shows when the preview stops is kept, and reused by the
+ * next start, so a late free_cb never sees freed memory.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include "tuya_cloud_types.h"
+#include "tal_api.h"
+
+#if defined(ENABLE_DISPLAY) && (ENABLE_DISPLAY == 1)
+#include "tdl_camera_manage.h"
+#include "tdl_camera_convert.h"
+#include "tdl_camera_preview.h"
+
+// opt in: the DMA2D has one completion callback, which a LVGL port may own
+#if defined(TDL_CAMERA_PREVIEW_DMA2D) && (TDL_CAMERA_PREVIEW_DMA2D == 1)
+#include "tkl_dma2d.h"
+#endif
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+#define PREVIEW_FB_NUM          2
+
+// the task looks at the running flag at least this often
+#define PREVIEW_FRAME_WAIT_MS   500
+
+#define PREVIEW_DMA2D_WAIT_MS   100
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef struct {
+    MUTEX_HANDLE                mutex;
+    SEM_HANDLE                  frame_sem;  // a frame is pending
+    SEM_HANDLE                  fb_sem;     // a frame buffer came back
+    SEM_HANDLE                  exit_sem;
+    THREAD_HANDLE               thread;
+    TDL_CAMERA_HANDLE_T         camera_hdl;
+    TDL_DISP_HANDLE_T           disp_hdl;
+    TDL_DISP_DEV_INFO_T         disp_info;
+    TDL_CAMERA_PREVIEW_CFG_T    cfg;
+    TDL_CAMERA_CONVERT_T        cv;
+    bool                        running;
+    bool                        dma2d;
+    bool                        fb_sync;    // the display flushes in place and gives nothing back
+    uint8_t                     fb_last;    // buffer flushed last
+    TDL_CAMERA_FRAME_T         *pending;    // latest held frame, not converted yet
+    TDL_DISP_FRAME_BUFF_T      *fb[PREVIEW_FB_NUM];
+    volatile bool               fb_busy[PREVIEW_FB_NUM];
+    SYS_TIME_T                  last_ms;
+    TDL_CAMERA_PREVIEW_INFO_T   info;
+} CAMERA_PREVIEW_T;
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static CAMERA_PREVIEW_T sg_preview;
+
+#if defined(TDL_CAMERA_PREVIEW_DMA2D) && (TDL_CAMERA_PREVIEW_DMA2D == 1)
+static SEM_HANDLE sg_preview_dma2d_sem = NULL;
+#endif
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+#if defined(TDL_CAMERA_PREVIEW_DMA2D) && (TDL_CAMERA_PREVIEW_DMA2D == 1)
+static void __preview_dma2d_cb(TUYA_DMA2D_IRQ_E type, VOID_T *args)
+{
+    tal_semaphore_post(sg_preview_dma2d_sem);
+}
+
+static OPERATE_RET __preview_dma2d_init(void)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    if (sg_preview_dma2d_sem) {
+        return OPRT_OK;
+    }
+
+    TUYA_CALL_ERR_RETURN(tal_semaphore_create_init(&sg_preview_dma2d_sem, 0, 1));
+    TUYA_DMA2D_BASE_CFG_T cfg = {
+        .cb = __preview_dma2d_cb,
+        .arg = NULL,
+    };
+
+    return tkl_dma2d_init(&cfg);
+}
+
+static OPERATE_RET __preview_dma2d_convert(CAMERA_PREVIEW_T *p, TDL_CAMERA_FRAME_T *frame, TDL_DISP_FRAME_BUFF_T *fb)
+{
+    OPERATE_RET rt = OPRT_OK;
+    TKL_DMA2D_FRAME_INFO_T in_frame = {0};
+    TKL_DMA2D_FRAME_INFO_T out_frame = {0};
+
+    in_frame.type = TUYA_FRAME_FMT_YUV422;
+    in_frame.width = frame->width;
+    in_frame.height = frame->height;
+    in_frame.pbuf = frame->data;
+
+    out_frame.type = TUYA_FRAME_FMT_RGB565;
+    out_frame.width = p->cv.out_width;
+    out_frame.height = p->cv.out_height;
+    out_frame.pbuf = fb->frame;
+
+    TUYA_CALL_ERR_RETURN(tkl_dma2d_convert(&in_frame, &out_frame));
+    TUYA_CALL_ERR_RETURN(tal_semaphore_wait(sg_preview_dma2d_sem, PREVIEW_DMA2D_WAIT_MS));
+
+    if (p->disp_info.is_swap) {
+        tdl_disp_dev_rgb565_swap((uint16_t *)fb->frame, p->cv.out_len / 2);
+    }
+
+    return OPRT_OK;
+}
+#endif
+
+static void __preview_fb_free_cb(TDL_DISP_FRAME_BUFF_T *frame_buff)
+{
+    CAMERA_PREVIEW_T *p = &sg_preview;
+
+    for (uint8_t i = 0; i < PREVIEW_FB_NUM; i++) {
+        if (p->fb[i] == frame_buff) {
+            p->fb_busy[i] = false;
+            tal_semaphore_post(p->fb_sem);
+            return;
+        }
+    }
+}
+
+/**
+ * @brief waits for a frame buffer the display is done with, returns its index
+ */
+static uint8_t __preview_fb_get(CAMERA_PREVIEW_T *p)
+{
+    bool waited = false;
+
+    for (;;) {
+        for (uint8_t i = 0; i < PREVIEW_FB_NUM; i++) {
+            if (!p->fb_busy[i]) {
+                return i;
+            }
+        }
+
+        if (!waited) {
+            p->info.fb_waits++;
+            waited = true;
+        }
+
+        if (OPRT_OK != tal_semaphore_wait(p->fb_sem, TDL_CAMERA_PREVIEW_FB_WAIT_MS)) {
+            // both are out and neither came back, the display is done with the older one
+            PR_NOTICE("camera preview: display returns no frame buffers, reusing them after the flush");
+            p->fb_sync = true;
+            p->fb_busy[p->fb_last ^ 1] = false;
+        }
+    }
+}
+
+static OPERATE_RET __preview_setup(CAMERA_PREVIEW_T *p, TDL_CAMERA_FRAME_T *frame)
+{
+    OPERATE_RET rt = OPRT_OK;
+    TDL_CAMERA_CONVERT_CFG_T cfg = {
+        .src_fmt = frame->fmt,
+        .src_width = frame->width,
+        .src_height = frame->height,
+        .y_offset = p->cfg.y_offset,
+        .nv12 = p->cfg.nv12,
+        .dst_fmt = p->disp_info.fmt,
+        .dst_width = p->cfg.width,
+        .dst_height = p->cfg.height,
+        .rotation = p->disp_info.rotation,
+        .is_swap = p->disp_info.is_swap,
+    };
+
+    tdl_camera_convert_deinit(&p->cv);
+    TUYA_CALL_ERR_RETURN(tdl_camera_convert_init(&p->cv, &cfg));
+
+    // the DMA2D converts one to one, scaling and rotation stay on the cpu
+    p->dma2d = false;
+#if defined(TDL_CAMERA_PREVIEW_DMA2D) && (TDL_CAMERA_PREVIEW_DMA2D == 1)
+    if (TUYA_FRAME_FMT_YUV422 == cfg.src_fmt && TUYA_PIXEL_FMT_RGB565 == cfg.dst_fmt &&
+        TUYA_DISPLAY_ROTATION_0 == cfg.rotation && p->cfg.width == frame->width && p->cfg.height == frame->height) {
+        p->dma2d = (OPRT_OK == __preview_dma2d_init());
+    }
+#endif
+    p->info.dma2d = p->dma2d;
+
+    PR_DEBUG("camera preview %ux%u -> %ux%u, rotation %d, dma2d %d", frame->width, frame->height, p->cv.out_width,
+             p->cv.out_height, cfg.rotation, p->dma2d);
+
+    return OPRT_OK;
+}
+
+static void __preview_show(CAMERA_PREVIEW_T *p, TDL_CAMERA_FRAME_T *frame)
+{
+    OPERATE_RET rt = OPRT_OK;
+    TDL_DISP_FRAME_BUFF_T *fb = NULL;
+    SYS_TIME_T start_ms;
+    uint8_t idx;
+
+    if (NULL == p->cv.yidx || frame->fmt != p->cv.cfg.src_fmt || frame->width != p->cv.cfg.src_width ||
+        frame->height != p->cv.cfg.src_height) {
+        if (OPRT_OK != __preview_setup(p, frame)) {
+            p->info.skipped++;
+            return;
+        }
+    }
+
+    idx = __preview_fb_get(p);
+    fb = p->fb[idx];
+
+    start_ms = tal_system_get_millisecond();
+#if defined(TDL_CAMERA_PREVIEW_DMA2D) && (TDL_CAMERA_PREVIEW_DMA2D == 1)
+    if (p->dma2d) {
+        rt = __preview_dma2d_convert(p, frame, fb);
+    } else
+#endif
+    {
+        rt = tdl_camera_convert_frame(&p->cv, frame->data, frame->data_len, fb->frame);
+    }
+    p->info.convert_ms = (uint32_t)(tal_system_get_millisecond() - start_ms);
+    if (OPRT_OK != rt) {
+        p->info.skipped++;
+        return;
+    }
+
+    fb->fmt = p->disp_info.fmt;
+    fb->x_start = 0;
+    fb->y_start = 0;
+    fb->width = p->cv.out_width;
+    fb->height = p->cv.out_height;
+
+    p->fb_busy[idx] = !p->fb_sync;
+    p->fb_last = idx;
+    rt = tdl_disp_dev_flush(p->disp_hdl, fb);
+    if (OPRT_OK != rt) {
+        PR_ERR("camera preview flush err:%d", rt);
+        p->fb_busy[idx] = false;
+        return;
+    }
+    p->info.frames++;
+}
+
+static void __preview_task(void *arg)
+{
+    CAMERA_PREVIEW_T *p = (CAMERA_PREVIEW_T *)arg;
+    TDL_CAMERA_FRAME_T *frame = NULL;
+
+    while (p->running) {
+        if (OPRT_OK != tal_semaphore_wait(p->frame_sem, PREVIEW_FRAME_WAIT_MS)) {
+            continue;
+        }
+
+        tal_mutex_lock(p->mutex);
+        frame = p->pending;
+        p->pending = NULL;
+        tal_mutex_unlock(p->mutex);
+
+        if (frame) {
+            __preview_show(p, frame);
+            tdl_camera_frame_release(frame);
+        }
+    }
+
+    tal_semaphore_post(p->exit_sem);
+    tal_thread_delete(p->thread);
+}
+
+static OPERATE_RET __preview_frame_cb(TDL_CAMERA_HANDLE_T hdl, TDL_CAMERA_FRAME_T *frame)
+{
+    CAMERA_PREVIEW_T *p = &sg_preview;
+    SYS_TIME_T now = tal_system_get_millisecond();
+    TDL_CAMERA_FRAME_T *old = NULL;
+
+    if (NULL == p->mutex || OPRT_OK != tal_mutex_lock(p->mutex)) {
+        return OPRT_OK;
+    }
+
+    if (!p->running || hdl != p->camera_hdl || (p->cfg.interval_ms && now - p->last_ms < p->cfg.interval_ms)) {
+        tal_mutex_unlock(p->mutex);
+        return OPRT_OK;
+    }
+
+    if (OPRT_OK != tdl_camera_frame_hold(frame)) {
+        tal_mutex_unlock(p->mutex);
+        return OPRT_OK;
+    }
+    p->last_ms = now;
+
+    // latest frame wins, an older one still waiting goes back to the camera
+    old = p->pending;
+    p->pending = frame;
+    if (old) {
+        p->info.replaced++;
+    }
+    tal_mutex_unlock(p->mutex);
+
+    if (old) {
+        tdl_camera_frame_release(old);
+    } else {
+        tal_semaphore_post(p->frame_sem);
+    }
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief frees the frame buffers the display gave back, a busy one stays for the next start
+ */
+static void __preview_fb_release(CAMERA_PREVIEW_T *p)
+{
+    for (uint8_t i = 0; i < PREVIEW_FB_NUM; i++) {
+        if (p->fb[i] && (!p->fb_busy[i] || p->fb_sync)) {
+            tdl_disp_free_frame_buff(p->fb[i]);
+            p->fb[i] = NULL;
+            p->fb_busy[i] = false;
+        }
+    }
+}
+
+static OPERATE_RET __preview_fb_create(CAMERA_PREVIEW_T *p)
+{
+    uint32_t len = (uint32_t)p->disp_info.width * p->disp_info.height *
+                   ((TUYA_PIXEL_FMT_RGB565 == p->disp_info.fmt) ? 2 : 3);
+
+    for (uint8_t i = 0; i < PREVIEW_FB_NUM; i++) {
+        if (p->fb[i] && p->fb[i]->len < len) {
+            if (p->fb_busy[i]) {
+                // smaller than this display and still on screen, it cannot be freed yet
+                return OPRT_RESOURCE_NOT_READY;
+            }
+            tdl_disp_free_frame_buff(p->fb[i]);
+            p->fb[i] = NULL;
+        }
+        if (NULL == p->fb[i]) {
+            p->fb[i] = tdl_disp_create_frame_buff(DISP_FB_TP_PSRAM, len);
+            if (NULL == p->fb[i]) {
+                return OPRT_MALLOC_FAILED;
+            }
+            p->fb_busy[i] = false;
+        }
+        p->fb[i]->free_cb = __preview_fb_free_cb;
+    }
+
+    return OPRT_OK;
+}
+
+OPERATE_RET tdl_camera_preview_start(TDL_CAMERA_HANDLE_T camera_hdl, TDL_DISP_HANDLE_T disp_hdl,
+                                     TDL_CAMERA_PREVIEW_CFG_T *cfg)
+{
+    CAMERA_PREVIEW_T *p = &sg_preview;
+    TDL_CAMERA_PREVIEW_CFG_T def = {0};
+    OPERATE_RET rt = OPRT_OK;
+    uint16_t disp_w, disp_h;
+
+    if (NULL == camera_hdl || NULL == disp_hdl) {
+        return OPRT_INVALID_PARM;
+    }
+    if (NULL == cfg) {
+        cfg = &def;
+    }
+
+    if (NULL == p->mutex) {
+        TUYA_CALL_ERR_RETURN(tal_mutex_create_init(&p->mutex));
+        TUYA_CALL_ERR_RETURN(tal_semaphore_create_init(&p->frame_sem, 0, 1));
+        TUYA_CALL_ERR_RETURN(tal_semaphore_create_init(&p->fb_sem, 0, 1));
+        TUYA_CALL_ERR_RETURN(tal_semaphore_create_init(&p->exit_sem, 0, 1));
+    }
+
+    tdl_camera_preview_stop();
+
+    TUYA_CALL_ERR_RETURN(tdl_disp_dev_get_info(disp_hdl, &p->disp_info));
+    if (TUYA_PIXEL_FMT_RGB565 != p->disp_info.fmt && TUYA_PIXEL_FMT_RGB888 != p->disp_info.fmt) {
+        return OPRT_NOT_SUPPORTED;
+    }
+
+    // the preview size is taken before the rotation the display is mounted with
+    if (TUYA_DISPLAY_ROTATION_90 == p->disp_info.rotation || TUYA_DISPLAY_ROTATION_270 == p->disp_info.rotation) {
+        disp_w = p->disp_info.height;
+        disp_h = p->disp_info.width;
+    } else {
+        disp_w = p->disp_info.width;
+        disp_h = p->disp_info.height;
+    }
+
+    p->cfg = *cfg;
+    p->cfg.width = cfg->width ? cfg->width : disp_w;
+    p->cfg.height = cfg->height ? cfg->height : disp_h;
+    if (p->cfg.width > disp_w || p->cfg.height > disp_h) {
+        return OPRT_INVALID_PARM;
+    }
+
+    rt = __preview_fb_create(p);
+    if (OPRT_OK != rt) {
+        __preview_fb_release(p);
+        return rt;
+    }
+
+    tal_mutex_lock(p->mutex);
+    p->camera_hdl = camera_hdl;
+    p->disp_hdl = disp_hdl;
+    p->pending = NULL;
+    p->fb_sync = false;
+    p->dma2d = false;
+    p->last_ms = 0;
+    memset(&p->info, 0, sizeof(p->info));
+    p->running = true;
+    tal_mutex_unlock(p->mutex);
+
+    THREAD_CFG_T thread_cfg = {TDL_CAMERA_PREVIEW_STACK_SIZE, TDL_CAMERA_PREVIEW_PRIO, "camera_preview"};
+    rt = tal_thread_create_and_start(&p->thread, NULL, NULL, __preview_task, p, &thread_cfg);
+    if (OPRT_OK != rt) {
+        p->running = false;
+        __preview_fb_release(p);
+        return rt;
+    }
+
+    rt = tdl_camera_dev_subscribe(camera_hdl, TDL_CAMERA_STREAM_RAW, __preview_frame_cb);
+    if (OPRT_OK != rt) {
+        tdl_camera_preview_stop();
+        return rt;
+    }
+
+    return OPRT_OK;
+}
+
+OPERATE_RET tdl_camera_preview_stop(void)
+{
+    CAMERA_PREVIEW_T *p = &sg_preview;
+    TDL_CAMERA_FRAME_T *frame = NULL;
+
+    if (NULL == p->mutex) {
+        return OPRT_OK;
+    }
+
+    tal_mutex_lock(p->mutex);
+    if (!p->running) {
+        tal_mutex_unlock(p->mutex);
+        return OPRT_OK;
+    }
+    p->running = false;
+    // the flow task may still call back once from its snapshot, it now sees running false
+    tdl_camera_dev_unsubscribe(p->camera_hdl, TDL_CAMERA_STREAM_RAW, __preview_frame_cb);
+    frame = p->pending;
+    p->pending = NULL;
+    tal_mutex_unlock(p->mutex);
+
+    if (frame) {
+        tdl_camera_frame_release(frame);
+    }
+
+    // the task finishes the frame it is on, then leaves
+    tal_semaphore_post(p->frame_sem);
+    tal_semaphore_wait(p->exit_sem, SEM_WAIT_FOREVER);
+    p->thread = NULL;
+
+    tdl_camera_convert_deinit(&p->cv);
+    __preview_fb_release(p);
+
+    return OPRT_OK;
+}
+
+OPERATE_RET tdl_camera_preview_get_info(TDL_CAMERA_PREVIEW_INFO_T *info)
+{
+    CAMERA_PREVIEW_T *p = &sg_preview;
+
+    if (NULL == info) {
+        return OPRT_INVALID_PARM;
+    }
+    if (NULL == p->mutex) {
+        memset(info, 0, sizeof(TDL_CAMERA_PREVIEW_INFO_T));
+        return OPRT_OK;
+    }
+
+    tal_mutex_lock(p->mutex);
+    *info = p->info;
+    info->running = p->running;
+    tal_mutex_unlock(p->mutex);
+
+    return OPRT_OK;
+}
+
+#endif /* ENABLE_DISPLAY */
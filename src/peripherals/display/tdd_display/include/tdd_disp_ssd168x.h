@@ -0,0 +1,86 @@
+/**
+ * @file tdd_disp_ssd168x.h
+ * @brief SSD168x e-Paper display driver interface definitions.
+ *
+ * This header provides the command definitions and function declarations for
+ * black and white e-Paper panels on the SSD1680, SSD1681 and SSD1677 controllers
+ * (such as the 2.13", 1.54" V2 and 4.26" Waveshare panels) via SPI interface.
+ *
+ * A flush only sends the region that changed since the last one and refreshes it
+ * with the partial waveform, which takes a few hundred ms instead of the seconds
+ * of a full refresh. Partial refreshes leave some ghosting, so every full_every
+ * of them the whole panel is refreshed with the full waveform.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#ifndef __TDD_DISP_SSD168X_H__
+#define __TDD_DISP_SSD168X_H__
+
+#include "tuya_cloud_types.h"
+#include "tdd_disp_type.h"
+
+/***********************************************************
+***********************macro define***********************
+***********************************************************/
+#define SSD168X_DRIVER_OUTPUT   0x01 // Driver Output Control, gate lines
+#define SSD168X_DEEP_SLEEP      0x10
+#define SSD168X_UPDATE_ACTIVATE 0x20 // Master Activation
+#define SSD168X_UPDATE_CTRL     0x22 // Display Update Control 2
+#define SSD168X_WRITE_RAM_BW    0x24 // Write RAM, the new image
+#define SSD168X_WRITE_RAM_OLD   0x26 // Write RAM, the image a partial refresh starts from
+#define SSD168X_RAM_X_RANGE     0x44
+#define SSD168X_RAM_Y_RANGE     0x45
+#define SSD168X_RAM_X_COUNTER   0x4E
+#define SSD168X_RAM_Y_COUNTER   0x4F
+
+// Display Update Control 2 sequences
+#ifndef SSD168X_UPDATE_FULL
+#define SSD168X_UPDATE_FULL 0xF7
+#endif
+
+#ifndef SSD168X_UPDATE_PART
+#define SSD168X_UPDATE_PART 0xFF
+#endif
+
+// Longest a refresh keeps the panel busy
+#ifndef SSD168X_BUSY_TIMEOUT_MS
+#define SSD168X_BUSY_TIMEOUT_MS 10000
+#endif
+
+/***********************************************************
+***********************type define***********************
+***********************************************************/
+
+/***********************************************************
+***********************function declare**********************
+***********************************************************/
+/**
+ * @brief Sets the initialization sequence for the SSD168x panel
+ *
+ * The default sequence suits the 2.13" SSD1680 panel. It must set the data entry
+ * mode to X and Y increment (0x11, 0x03), the gate lines of the driver output
+ * control (0x01) are set from the height.
+ *
+ * @param init_seq Pointer to the initialization sequence array
+ *
+ * @return OPERATE_RET Returns OPRT_OK on success, or OPRT_INVALID_PARM if init_seq is NULL
+ */
+OPERATE_RET tdd_disp_spi_epd_ssd168x_set_init_seq(uint8_t *init_seq);
+
+/**
+ * @brief Registers an SSD168x e-Paper display device using the SPI interface with the display management system.
+ *
+ * The device takes TUYA_PIXEL_FMT_MONOCHROME frame buffers of the full panel size.
+ * tdl_disp_dev_flush() sends the rows and columns that changed since the last flush,
+ * tdl_disp_dev_flush_area() looks for changes only inside the given areas.
+ *
+ * @param name Name of the display device (used for identification).
+ * @param dev_cfg Pointer to the e-Paper device configuration structure.
+ *
+ * @return Returns OPRT_OK on success, or an appropriate error code if registration fails.
+ */
+OPERATE_RET tdd_disp_spi_epd_ssd168x_register(char *name, DISP_SPI_EPD_DEVICE_CFG_T *dev_cfg);
+
+#endif // __TDD_DISP_SSD168X_H__
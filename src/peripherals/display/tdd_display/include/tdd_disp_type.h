@@ -94,6 +94,12 @@ typedef struct {
     TUYA_DISPLAY_IO_CTRL_T   power;      // Power control configuration
 }DISP_I2C_OLED_DEVICE_CFG_T;
 
+typedef struct {
+    DISP_SPI_DEVICE_CFG_T    spi;        // SPI panel configuration, height is the gate line count
+    TUYA_GPIO_NUM_E          busy_pin;   // BUSY output of the panel, high while an update runs
+    uint8_t                  full_every; // Partial refreshes between two full ones, 0 refreshes fully each time
+}DISP_SPI_EPD_DEVICE_CFG_T;
+
 
 /***********************************************************
 ********************function declaration********************
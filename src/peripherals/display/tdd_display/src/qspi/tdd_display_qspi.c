@@ -40,6 +40,8 @@ typedef enum {
 typedef struct {
 	TDD_QSPI_FRAME_EVENT_E  event;
     TDL_DISP_FRAME_BUFF_T  *frame_buff;
+    uint8_t                 area_num; // 0 sends the whole frame buffer
+    TDL_DISP_RECT_T         areas[TDL_DISP_FLUSH_AREA_MAX];
 } TDD_DISP_QSPI_MSG_T;
 
 typedef struct {
@@ -185,19 +187,12 @@ static void __disp_qspi_set_window(DISP_QSPI_BASE_CFG_T *p_cfg, uint16_t x_start
     }
 }
 
-static OPERATE_RET __disp_qspi_send_frame(DISP_QSPI_BASE_CFG_T *p_cfg, TDL_DISP_FRAME_BUFF_T *p_fb)
+static OPERATE_RET __disp_qspi_send_pixel_cmd(DISP_QSPI_BASE_CFG_T *p_cfg)
 {
-    OPERATE_RET rt = OPRT_OK;
     TUYA_QSPI_CMD_T qspi_cmd = {0};
 
-    if (NULL == p_cfg || NULL == p_fb || p_cfg->port >= TUYA_QSPI_NUM_MAX) {
-        return OPRT_INVALID_PARM;
-    }
-
     memset(&qspi_cmd, 0x00, SIZEOF(TUYA_QSPI_CMD_T));
 
-    tkl_qspi_force_cs_pin(p_cfg->port, 0);
-
     qspi_cmd.op = TUYA_QSPI_WRITE;
 
     qspi_cmd.cmd[0]    = p_cfg->pixel_pre_cmd.cmd;
@@ -212,7 +207,21 @@ static OPERATE_RET __disp_qspi_send_frame(DISP_QSPI_BASE_CFG_T *p_cfg, TDL_DISP_
 
     qspi_cmd.data_size = 0;
     qspi_cmd.dummy_cycle = 0;
-    TUYA_CALL_ERR_RETURN(tkl_qspi_comand(p_cfg->port, &qspi_cmd));
+
+    return tkl_qspi_comand(p_cfg->port, &qspi_cmd);
+}
+
+static OPERATE_RET __disp_qspi_send_frame(DISP_QSPI_BASE_CFG_T *p_cfg, TDL_DISP_FRAME_BUFF_T *p_fb)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    if (NULL == p_cfg || NULL == p_fb || p_cfg->port >= TUYA_QSPI_NUM_MAX) {
+        return OPRT_INVALID_PARM;
+    }
+
+    tkl_qspi_force_cs_pin(p_cfg->port, 0);
+
+    TUYA_CALL_ERR_RETURN(__disp_qspi_send_pixel_cmd(p_cfg));
 
     TUYA_CALL_ERR_RETURN(tkl_qspi_send(p_cfg->port, p_fb->frame, p_fb->len));
     TUYA_CALL_ERR_RETURN(tal_semaphore_wait(sg_disp_qspi_sync[p_cfg->port].tx_sem, SEM_WAIT_FOREVER));
@@ -222,6 +231,53 @@ static OPERATE_RET __disp_qspi_send_frame(DISP_QSPI_BASE_CFG_T *p_cfg, TDL_DISP_
     return rt;
 }
 
+static uint32_t __disp_qspi_pixel_bytes(TUYA_DISPLAY_PIXEL_FMT_E pixel_fmt)
+{
+    switch (pixel_fmt) {
+    case TUYA_PIXEL_FMT_RGB565:
+        return 2;
+    case TUYA_PIXEL_FMT_RGB666:
+    case TUYA_PIXEL_FMT_RGB888:
+        return 3;
+    default:
+        return 0;
+    }
+}
+
+// rows of one area in a single CS low pixel write, the window was set before
+static OPERATE_RET __disp_qspi_send_area(DISP_QSPI_BASE_CFG_T *p_cfg, TDL_DISP_FRAME_BUFF_T *p_fb, \
+                                        TDL_DISP_RECT_T *area)
+{
+    OPERATE_RET rt = OPRT_OK;
+    uint32_t px_bytes = __disp_qspi_pixel_bytes(p_cfg->pixel_fmt);
+    uint32_t stride = p_fb->width * px_bytes;
+    uint32_t row_len = (area->x1 - area->x0 + 1) * px_bytes;
+    uint32_t rows = area->y1 - area->y0 + 1;
+    uint8_t *row = p_fb->frame + (area->y0 - p_fb->y_start) * stride + (area->x0 - p_fb->x_start) * px_bytes;
+
+    tkl_qspi_force_cs_pin(p_cfg->port, 0);
+
+    rt = __disp_qspi_send_pixel_cmd(p_cfg);
+
+    // full width rows are contiguous, send them as one burst
+    if (row_len == stride) {
+        row_len *= rows;
+        rows = 1;
+    }
+
+    for (uint32_t y = 0; y < rows && OPRT_OK == rt; y++) {
+        rt = tkl_qspi_send(p_cfg->port, row, row_len);
+        if (OPRT_OK == rt) {
+            rt = tal_semaphore_wait(sg_disp_qspi_sync[p_cfg->port].tx_sem, SEM_WAIT_FOREVER);
+        }
+        row += stride;
+    }
+
+    tkl_qspi_force_cs_pin(p_cfg->port, 1);
+
+    return rt;
+}
+
 static void __disp_qspi_display_frame(TDD_DISP_DEV_HANDLE_T device, TDL_DISP_FRAME_BUFF_T *p_fb)
 {
     DISP_QSPI_DEV_T *disp_qspi_dev = NULL;
@@ -236,6 +292,25 @@ static void __disp_qspi_display_frame(TDD_DISP_DEV_HANDLE_T device, TDL_DISP_FRA
     __disp_qspi_send_frame(&disp_qspi_dev->cfg, p_fb);
 }
 
+static void __disp_qspi_display_areas(TDD_DISP_DEV_HANDLE_T device, TDD_DISP_QSPI_MSG_T *msg)
+{
+    DISP_QSPI_DEV_T *disp_qspi_dev = (DISP_QSPI_DEV_T *)device;
+
+    if (NULL == device || NULL == msg->frame_buff) {
+        return;
+    }
+
+    for (uint8_t i = 0; i < msg->area_num; i++) {
+        TDL_DISP_RECT_T *area = &msg->areas[i];
+
+        __disp_qspi_set_window(&disp_qspi_dev->cfg, area->x0, area->y0, area->x1, area->y1);
+        if (OPRT_OK != __disp_qspi_send_area(&disp_qspi_dev->cfg, msg->frame_buff, area)) {
+            PR_ERR("qspi area %d send failed", i);
+            return;
+        }
+    }
+}
+
 static void __tdd_disp_reset(TUYA_GPIO_NUM_E rst_pin)
 {
     if(rst_pin >= TUYA_GPIO_NUM_MAX) {
@@ -339,6 +414,7 @@ static void __display_qspi_task(void *args)
             if(qspi_sync->is_period_flush) {
                 msg.event = TDD_QSPI_FRAME_REQUEST;   
                 msg.frame_buff = qspi_sync->display_fb;
+                msg.area_num = 0;
             }else {
                 continue;
             }
@@ -346,7 +422,11 @@ static void __display_qspi_task(void *args)
 
         switch(msg.event) {
             case TDD_QSPI_FRAME_REQUEST:
-                __disp_qspi_display_frame(qspi_sync->device, msg.frame_buff);
+                if (msg.area_num) {
+                    __disp_qspi_display_areas(qspi_sync->device, &msg);
+                } else {
+                    __disp_qspi_display_frame(qspi_sync->device, msg.frame_buff);
+                }
 
                 if(qspi_sync->is_period_flush) {
                     if(qspi_sync->display_fb != msg.frame_buff) {
@@ -432,6 +512,34 @@ static OPERATE_RET __tdd_display_qspi_flush(TDD_DISP_DEV_HANDLE_T device, TDL_DI
     return rt;
 }
 
+static OPERATE_RET __tdd_display_qspi_flush_area(TDD_DISP_DEV_HANDLE_T device, TDL_DISP_FRAME_BUFF_T *frame_buff, \
+                                                const TDL_DISP_RECT_T *areas, uint8_t num)
+{
+    OPERATE_RET rt = OPRT_OK;
+    DISP_QSPI_DEV_T *disp_qspi_dev = NULL;
+    TUYA_QSPI_NUM_E port = 0;
+
+    if (NULL == device || NULL == frame_buff || NULL == areas || num > TDL_DISP_FLUSH_AREA_MAX) {
+        return OPRT_INVALID_PARM;
+    }
+
+    disp_qspi_dev = (DISP_QSPI_DEV_T *)device;
+    port = disp_qspi_dev->cfg.port;
+
+    TDD_DISP_QSPI_MSG_T msg = {TDD_QSPI_FRAME_REQUEST, frame_buff};
+    // sub byte pixels cannot be windowed by column, send them whole
+    if (__disp_qspi_pixel_bytes(disp_qspi_dev->cfg.pixel_fmt)) {
+        msg.area_num = num;
+        memcpy(msg.areas, areas, num * sizeof(TDL_DISP_RECT_T));
+    }
+
+    tal_mutex_lock(disp_qspi_dev->mutex);
+    rt = tal_queue_post(sg_disp_qspi_sync[port].queue, &msg, SEM_WAIT_FOREVER);
+    tal_mutex_unlock(disp_qspi_dev->mutex);
+
+    return rt;
+}
+
 static OPERATE_RET __tdd_display_qspi_close(TDD_DISP_DEV_HANDLE_T device)
 {
     return OPRT_NOT_SUPPORTED;
@@ -479,6 +587,11 @@ OPERATE_RET tdd_disp_qspi_device_register(char *name, TDD_DISP_QSPI_CFG_T *qspi)
         .close = __tdd_display_qspi_close,
     };
 
+    // without VRAM the task refreshes the whole panel periodically, areas gain nothing
+    if (qspi->cfg.has_vram) {
+        disp_qspi_intfs.flush_area = __tdd_display_qspi_flush_area;
+    }
+
     TUYA_CALL_ERR_RETURN(tdl_disp_device_register(name, (TDD_DISP_DEV_HANDLE_T)disp_qspi_dev,\
                                                  &disp_qspi_intfs, &disp_qspi_dev_info));
 
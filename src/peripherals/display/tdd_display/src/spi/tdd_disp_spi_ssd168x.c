@@ -0,0 +1,456 @@
+/**
+ * @file tdd_disp_spi_ssd168x.c
+ * @brief SSD168x e-Paper driver implementation with SPI interface
+ *
+ * This file provides the implementation for black and white e-Paper panels on the
+ * SSD1680, SSD1681 and SSD1677 controllers. The driver keeps the image shown on the
+ * panel, so that a flush only writes the rows and columns that changed into the
+ * controller RAM and refreshes them with the partial waveform. A full refresh is
+ * made for the first flush and every full_every partial ones to clear the ghosting.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+#include "tuya_cloud_types.h"
+#include "tal_api.h"
+#include "tkl_gpio.h"
+
+#include "tdd_display_spi.h"
+#include "tdd_disp_ssd168x.h"
+
+/***********************************************************
+***********************MACRO define**********************
+***********************************************************/
+#define SSD168X_BUSY_POLL_MS 5
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef struct {
+    DISP_SPI_BASE_CFG_T    cfg;
+    TUYA_GPIO_NUM_E        busy_pin;
+    uint8_t                full_every;
+    uint8_t                part_cnt;  // partial refreshes since the last full one
+    bool                   has_base;  // the panel shows last_fb, a partial refresh can start from it
+    uint16_t               stride;    // bytes of a panel row
+    TDL_DISP_FRAME_BUFF_T *cur_fb;    // frame in the panel format, 1 is white, MSB first
+    TDL_DISP_FRAME_BUFF_T *last_fb;   // frame shown on the panel
+} DISP_SSD168X_DEV_T;
+
+// x0 and x1 count bytes of a panel row, y0 and y1 rows, all inclusive
+typedef TDL_DISP_RECT_T SSD168X_RECT_T;
+
+/***********************************************************
+***********************const define**********************
+***********************************************************/
+static uint8_t SSD168X_INIT_SEQ[] = {
+    1, 10, 0x12,                   // SWRESET
+    4, 0,  0x01, 0xF9, 0x00, 0x00, // Driver Output Control, gate lines set from the height
+    2, 0,  0x11, 0x03,             // Data Entry Mode, X and Y increment
+    2, 0,  0x3C, 0x05,             // Border Waveform
+    3, 0,  0x21, 0x00, 0x80,       // Display Update Control 1, source S8 to S167
+    2, 0,  0x18, 0x80,             // Internal temperature sensor
+    0                              // Terminate list
+};
+
+static uint8_t *sg_disp_init_seq = SSD168X_INIT_SEQ;
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+static uint8_t __ssd168x_reverse_bits(uint8_t b)
+{
+    b = (uint8_t)((b & 0xF0) >> 4 | (b & 0x0F) << 4);
+    b = (uint8_t)((b & 0xCC) >> 2 | (b & 0x33) << 2);
+    b = (uint8_t)((b & 0xAA) >> 1 | (b & 0x55) << 1);
+
+    return b;
+}
+
+// The monochrome frame buffer is LSB first with 1 for black, the panel RAM MSB first with 1 for white
+static void __ssd168x_convert(DISP_SSD168X_DEV_T *dev, TDL_DISP_FRAME_BUFF_T *fb, const SSD168X_RECT_T *rect)
+{
+    uint32_t src_stride = fb->width / 8;
+    uint8_t src = 0;
+
+    for (uint32_t y = rect->y0; y <= rect->y1; y++) {
+        uint8_t *dst = dev->cur_fb->frame + y * dev->stride;
+        for (uint32_t x = rect->x0; x <= rect->x1; x++) {
+            src = (x < src_stride) ? fb->frame[y * src_stride + x] : 0x00;
+            dst[x] = (uint8_t)~__ssd168x_reverse_bits(src);
+        }
+    }
+}
+
+// Shrinks rect to the bytes that differ from the panel, false if none does
+static bool __ssd168x_find_dirty(DISP_SSD168X_DEV_T *dev, SSD168X_RECT_T *rect)
+{
+    SSD168X_RECT_T dirty = {.x0 = UINT16_MAX, .y0 = UINT16_MAX, .x1 = 0, .y1 = 0};
+
+    for (uint32_t y = rect->y0; y <= rect->y1; y++) {
+        uint8_t *cur = dev->cur_fb->frame + y * dev->stride;
+        uint8_t *last = dev->last_fb->frame + y * dev->stride;
+        for (uint32_t x = rect->x0; x <= rect->x1; x++) {
+            if (cur[x] == last[x]) {
+                continue;
+            }
+            dirty.x0 = (x < dirty.x0) ? x : dirty.x0;
+            dirty.x1 = (x > dirty.x1) ? x : dirty.x1;
+            dirty.y0 = (y < dirty.y0) ? y : dirty.y0;
+            dirty.y1 = y;
+        }
+    }
+
+    if (dirty.x0 > dirty.x1) {
+        return false;
+    }
+
+    *rect = dirty;
+
+    return true;
+}
+
+static OPERATE_RET __ssd168x_wait_busy(DISP_SSD168X_DEV_T *dev)
+{
+    TUYA_GPIO_LEVEL_E level = TUYA_GPIO_LEVEL_HIGH;
+
+    for (uint32_t waited = 0; waited < SSD168X_BUSY_TIMEOUT_MS; waited += SSD168X_BUSY_POLL_MS) {
+        tkl_gpio_read(dev->busy_pin, &level);
+        if (TUYA_GPIO_LEVEL_LOW == level) {
+            return OPRT_OK;
+        }
+        tal_system_sleep(SSD168X_BUSY_POLL_MS);
+    }
+
+    PR_ERR("[SSD168X] panel busy over %d ms", SSD168X_BUSY_TIMEOUT_MS);
+
+    return OPRT_TIMEOUT;
+}
+
+static void __ssd168x_set_window(DISP_SPI_BASE_CFG_T *p_cfg, const SSD168X_RECT_T *rect)
+{
+    uint8_t data[4];
+
+    data[0] = (uint8_t)rect->x0;
+    data[1] = (uint8_t)rect->x1;
+    tdd_disp_spi_send_cmd(p_cfg, SSD168X_RAM_X_RANGE);
+    tdd_disp_spi_send_data(p_cfg, data, 2);
+
+    data[0] = rect->y0 & 0xFF;
+    data[1] = rect->y0 >> 8;
+    data[2] = rect->y1 & 0xFF;
+    data[3] = rect->y1 >> 8;
+    tdd_disp_spi_send_cmd(p_cfg, SSD168X_RAM_Y_RANGE);
+    tdd_disp_spi_send_data(p_cfg, data, 4);
+
+    data[0] = (uint8_t)rect->x0;
+    tdd_disp_spi_send_cmd(p_cfg, SSD168X_RAM_X_COUNTER);
+    tdd_disp_spi_send_data(p_cfg, data, 1);
+
+    data[0] = rect->y0 & 0xFF;
+    data[1] = rect->y0 >> 8;
+    tdd_disp_spi_send_cmd(p_cfg, SSD168X_RAM_Y_COUNTER);
+    tdd_disp_spi_send_data(p_cfg, data, 2);
+}
+
+static OPERATE_RET __ssd168x_write_ram(DISP_SSD168X_DEV_T *dev, uint8_t cmd, const SSD168X_RECT_T *rect)
+{
+    OPERATE_RET rt = OPRT_OK;
+    uint32_t row_len = rect->x1 - rect->x0 + 1;
+    uint8_t *row = dev->cur_fb->frame + rect->y0 * dev->stride + rect->x0;
+
+    __ssd168x_set_window(&dev->cfg, rect);
+
+    TUYA_CALL_ERR_RETURN(tdd_disp_spi_send_cmd(&dev->cfg, cmd));
+
+    // the address wraps to the window start at the end of a row, whole rows go in one burst
+    if (row_len == dev->stride) {
+        return tdd_disp_spi_send_data(&dev->cfg, row, row_len * (rect->y1 - rect->y0 + 1));
+    }
+
+    for (uint32_t y = rect->y0; y <= rect->y1; y++, row += dev->stride) {
+        TUYA_CALL_ERR_RETURN(tdd_disp_spi_send_data(&dev->cfg, row, row_len));
+    }
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET __ssd168x_update(DISP_SSD168X_DEV_T *dev, uint8_t sequence)
+{
+    tdd_disp_spi_send_cmd(&dev->cfg, SSD168X_UPDATE_CTRL);
+    tdd_disp_spi_send_data(&dev->cfg, &sequence, 1);
+    tdd_disp_spi_send_cmd(&dev->cfg, SSD168X_UPDATE_ACTIVATE);
+
+    return __ssd168x_wait_busy(dev);
+}
+
+static OPERATE_RET __ssd168x_refresh(DISP_SSD168X_DEV_T *dev, const SSD168X_RECT_T *dirty)
+{
+    OPERATE_RET rt = OPRT_OK;
+    SSD168X_RECT_T full = {.x0 = 0, .y0 = 0, .x1 = dev->stride - 1, .y1 = dev->cfg.height - 1};
+    bool is_full = (false == dev->has_base || 0 == dev->full_every || dev->part_cnt >= dev->full_every);
+    const SSD168X_RECT_T *rect = is_full ? &full : dirty;
+
+    // until the refresh completes the panel shows neither image
+    dev->has_base = false;
+
+    TUYA_CALL_ERR_RETURN(__ssd168x_write_ram(dev, SSD168X_WRITE_RAM_BW, rect));
+    if (is_full) {
+        TUYA_CALL_ERR_RETURN(__ssd168x_write_ram(dev, SSD168X_WRITE_RAM_OLD, rect));
+        TUYA_CALL_ERR_RETURN(__ssd168x_update(dev, SSD168X_UPDATE_FULL));
+        dev->part_cnt = 0;
+    } else {
+        TUYA_CALL_ERR_RETURN(__ssd168x_update(dev, SSD168X_UPDATE_PART));
+        // the next partial refresh starts from this image
+        TUYA_CALL_ERR_RETURN(__ssd168x_write_ram(dev, SSD168X_WRITE_RAM_OLD, rect));
+        dev->part_cnt++;
+    }
+
+    for (uint32_t y = rect->y0; y <= rect->y1; y++) {
+        uint32_t offset = y * dev->stride + rect->x0;
+        memcpy(dev->last_fb->frame + offset, dev->cur_fb->frame + offset, rect->x1 - rect->x0 + 1);
+    }
+    dev->has_base = true;
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET __ssd168x_flush_rect(DISP_SSD168X_DEV_T *dev, TDL_DISP_FRAME_BUFF_T *frame_buff,
+                                        SSD168X_RECT_T *rect)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    if (TUYA_PIXEL_FMT_MONOCHROME != frame_buff->fmt || frame_buff->width != dev->cfg.width ||
+        frame_buff->height != dev->cfg.height) {
+        PR_ERR("[SSD168X] not a full monochrome frame: %d %dx%d", frame_buff->fmt, frame_buff->width,
+               frame_buff->height);
+        return OPRT_INVALID_PARM;
+    }
+
+    __ssd168x_convert(dev, frame_buff, rect);
+
+    if (false == dev->has_base || __ssd168x_find_dirty(dev, rect)) {
+        rt = __ssd168x_refresh(dev, rect);
+    }
+
+    if (frame_buff->free_cb) {
+        frame_buff->free_cb(frame_buff);
+    }
+
+    return rt;
+}
+
+static OPERATE_RET __tdd_disp_spi_ssd168x_open(TDD_DISP_DEV_HANDLE_T device)
+{
+    OPERATE_RET rt = OPRT_OK;
+    DISP_SSD168X_DEV_T *disp_spi_dev = NULL;
+    TUYA_GPIO_BASE_CFG_T pin_cfg = {
+        .mode = TUYA_GPIO_PULLUP,
+        .direct = TUYA_GPIO_INPUT,
+        .level = TUYA_GPIO_LEVEL_HIGH,
+    };
+
+    if (NULL == device) {
+        return OPRT_INVALID_PARM;
+    }
+    disp_spi_dev = (DISP_SSD168X_DEV_T *)device;
+
+    TUYA_CALL_ERR_RETURN(tkl_gpio_init(disp_spi_dev->busy_pin, &pin_cfg));
+
+    // Set gate line count
+    tdd_disp_modify_init_seq_param(sg_disp_init_seq, SSD168X_DRIVER_OUTPUT, (disp_spi_dev->cfg.height - 1) & 0xFF, 0);
+    tdd_disp_modify_init_seq_param(sg_disp_init_seq, SSD168X_DRIVER_OUTPUT, (disp_spi_dev->cfg.height - 1) >> 8, 1);
+
+    TUYA_CALL_ERR_RETURN(tdd_disp_spi_init(&(disp_spi_dev->cfg)));
+
+    tdd_disp_spi_init_seq(&(disp_spi_dev->cfg), (const uint8_t *)sg_disp_init_seq);
+    TUYA_CALL_ERR_RETURN(__ssd168x_wait_busy(disp_spi_dev));
+
+    // the panel RAM was reset, the first flush refreshes it fully
+    disp_spi_dev->has_base = false;
+    disp_spi_dev->part_cnt = 0;
+
+    PR_DEBUG("[SSD168X] Initialize display device successful.");
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET __tdd_disp_spi_ssd168x_flush(TDD_DISP_DEV_HANDLE_T device, TDL_DISP_FRAME_BUFF_T *frame_buff)
+{
+    DISP_SSD168X_DEV_T *disp_spi_dev = NULL;
+
+    if (NULL == device || NULL == frame_buff) {
+        return OPRT_INVALID_PARM;
+    }
+
+    disp_spi_dev = (DISP_SSD168X_DEV_T *)device;
+
+    SSD168X_RECT_T rect = {.x0 = 0, .y0 = 0, .x1 = disp_spi_dev->stride - 1, .y1 = disp_spi_dev->cfg.height - 1};
+
+    return __ssd168x_flush_rect(disp_spi_dev, frame_buff, &rect);
+}
+
+static OPERATE_RET __tdd_disp_spi_ssd168x_flush_area(TDD_DISP_DEV_HANDLE_T device, TDL_DISP_FRAME_BUFF_T *frame_buff,
+                                                     const TDL_DISP_RECT_T *areas, uint8_t num)
+{
+    DISP_SSD168X_DEV_T *disp_spi_dev = NULL;
+
+    if (NULL == device || NULL == frame_buff || NULL == areas || 0 == num) {
+        return OPRT_INVALID_PARM;
+    }
+
+    disp_spi_dev = (DISP_SSD168X_DEV_T *)device;
+
+    // one refresh of the box around all areas, a refresh costs far more than the pixels sent
+    SSD168X_RECT_T rect = areas[0];
+    for (uint8_t i = 1; i < num; i++) {
+        rect.x0 = (areas[i].x0 < rect.x0) ? areas[i].x0 : rect.x0;
+        rect.y0 = (areas[i].y0 < rect.y0) ? areas[i].y0 : rect.y0;
+        rect.x1 = (areas[i].x1 > rect.x1) ? areas[i].x1 : rect.x1;
+        rect.y1 = (areas[i].y1 > rect.y1) ? areas[i].y1 : rect.y1;
+    }
+    rect.x0 /= 8;
+    rect.x1 /= 8;
+
+    return __ssd168x_flush_rect(disp_spi_dev, frame_buff, &rect);
+}
+
+static OPERATE_RET __tdd_disp_spi_ssd168x_close(TDD_DISP_DEV_HANDLE_T device)
+{
+    DISP_SSD168X_DEV_T *disp_spi_dev = NULL;
+    uint8_t mode = 0x01;
+
+    if (NULL == device) {
+        return OPRT_INVALID_PARM;
+    }
+
+    disp_spi_dev = (DISP_SSD168X_DEV_T *)device;
+
+    // the image stays on the panel without power, the RAM does not survive the deep sleep
+    tdd_disp_spi_send_cmd(&disp_spi_dev->cfg, SSD168X_DEEP_SLEEP);
+    tdd_disp_spi_send_data(&disp_spi_dev->cfg, &mode, 1);
+    disp_spi_dev->has_base = false;
+
+    return OPRT_OK;
+}
+
+static void __ssd168x_dev_free(DISP_SSD168X_DEV_T *disp_spi_dev)
+{
+    if (disp_spi_dev->cur_fb) {
+        tdl_disp_free_frame_buff(disp_spi_dev->cur_fb);
+    }
+
+    if (disp_spi_dev->last_fb) {
+        tdl_disp_free_frame_buff(disp_spi_dev->last_fb);
+    }
+
+    tal_free(disp_spi_dev);
+}
+
+/**
+ * @brief Sets the initialization sequence for the SSD168x panel
+ *
+ * The default sequence suits the 2.13" SSD1680 panel. It must set the data entry
+ * mode to X and Y increment (0x11, 0x03), the gate lines of the driver output
+ * control (0x01) are set from the height.
+ *
+ * @param init_seq Pointer to the initialization sequence array
+ *
+ * @return OPERATE_RET Returns OPRT_OK on success, or OPRT_INVALID_PARM if init_seq is NULL
+ */
+OPERATE_RET tdd_disp_spi_epd_ssd168x_set_init_seq(uint8_t *init_seq)
+{
+    if (NULL == init_seq) {
+        return OPRT_INVALID_PARM;
+    }
+
+    sg_disp_init_seq = init_seq;
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief Registers an SSD168x e-Paper display device using the SPI interface with the display management system.
+ *
+ * The device takes TUYA_PIXEL_FMT_MONOCHROME frame buffers of the full panel size.
+ * tdl_disp_dev_flush() sends the rows and columns that changed since the last flush,
+ * tdl_disp_dev_flush_area() looks for changes only inside the given areas.
+ *
+ * @param name Name of the display device (used for identification).
+ * @param dev_cfg Pointer to the e-Paper device configuration structure.
+ *
+ * @return Returns OPRT_OK on success, or an appropriate error code if registration fails.
+ */
+OPERATE_RET tdd_disp_spi_epd_ssd168x_register(char *name, DISP_SPI_EPD_DEVICE_CFG_T *dev_cfg)
+{
+    OPERATE_RET rt = OPRT_OK;
+    uint32_t frame_len = 0;
+    DISP_SSD168X_DEV_T *disp_spi_dev = NULL;
+    TDD_DISP_DEV_INFO_T disp_spi_dev_info;
+
+    if (NULL == name || NULL == dev_cfg || dev_cfg->busy_pin >= TUYA_GPIO_NUM_MAX ||
+        0 == dev_cfg->spi.width || 0 == dev_cfg->spi.height) {
+        return OPRT_INVALID_PARM;
+    }
+
+    disp_spi_dev = (DISP_SSD168X_DEV_T *)tal_malloc(sizeof(DISP_SSD168X_DEV_T));
+    if (NULL == disp_spi_dev) {
+        return OPRT_MALLOC_FAILED;
+    }
+    memset(disp_spi_dev, 0x00, sizeof(DISP_SSD168X_DEV_T));
+
+    disp_spi_dev->stride = (dev_cfg->spi.width + 7) / 8;
+    frame_len = disp_spi_dev->stride * dev_cfg->spi.height;
+    disp_spi_dev->cur_fb = tdl_disp_create_frame_buff(DISP_FB_TP_PSRAM, frame_len);
+    disp_spi_dev->last_fb = tdl_disp_create_frame_buff(DISP_FB_TP_PSRAM, frame_len);
+    if (NULL == disp_spi_dev->cur_fb || NULL == disp_spi_dev->last_fb) {
+        __ssd168x_dev_free(disp_spi_dev);
+        return OPRT_MALLOC_FAILED;
+    }
+    memset(disp_spi_dev->cur_fb->frame, 0xFF, frame_len);
+    memset(disp_spi_dev->last_fb->frame, 0xFF, frame_len);
+
+    disp_spi_dev->busy_pin   = dev_cfg->busy_pin;
+    disp_spi_dev->full_every = dev_cfg->full_every;
+
+    disp_spi_dev->cfg.width     = dev_cfg->spi.width;
+    disp_spi_dev->cfg.height    = dev_cfg->spi.height;
+    disp_spi_dev->cfg.pixel_fmt = TUYA_PIXEL_FMT_MONOCHROME;
+    disp_spi_dev->cfg.port      = dev_cfg->spi.port;
+    disp_spi_dev->cfg.spi_clk   = dev_cfg->spi.spi_clk;
+    disp_spi_dev->cfg.cs_pin    = dev_cfg->spi.cs_pin;
+    disp_spi_dev->cfg.dc_pin    = dev_cfg->spi.dc_pin;
+    disp_spi_dev->cfg.rst_pin   = dev_cfg->spi.rst_pin;
+    disp_spi_dev->cfg.cmd_caset = SSD168X_RAM_X_RANGE;
+    disp_spi_dev->cfg.cmd_raset = SSD168X_RAM_Y_RANGE;
+    disp_spi_dev->cfg.cmd_ramwr = SSD168X_WRITE_RAM_BW;
+
+    memset(&disp_spi_dev_info, 0x00, sizeof(disp_spi_dev_info));
+    disp_spi_dev_info.type      = TUYA_DISPLAY_SPI;
+    disp_spi_dev_info.width     = dev_cfg->spi.width;
+    disp_spi_dev_info.height    = dev_cfg->spi.height;
+    disp_spi_dev_info.fmt       = TUYA_PIXEL_FMT_MONOCHROME;
+    disp_spi_dev_info.rotation  = dev_cfg->spi.rotation;
+    disp_spi_dev_info.is_swap   = false;
+    disp_spi_dev_info.has_vram  = true;
+
+    memcpy(&disp_spi_dev_info.power, &dev_cfg->spi.power, sizeof(TUYA_DISPLAY_IO_CTRL_T));
+    memcpy(&disp_spi_dev_info.bl, &dev_cfg->spi.bl, sizeof(TUYA_DISPLAY_BL_CTRL_T));
+
+    TDD_DISP_INTFS_T disp_spi_intfs = {
+        .open = __tdd_disp_spi_ssd168x_open,
+        .flush = __tdd_disp_spi_ssd168x_flush,
+        .close = __tdd_disp_spi_ssd168x_close,
+        .flush_area = __tdd_disp_spi_ssd168x_flush_area,
+    };
+
+    rt = tdl_disp_device_register(name, (TDD_DISP_DEV_HANDLE_T)disp_spi_dev, &disp_spi_intfs, &disp_spi_dev_info);
+    if (OPRT_OK != rt) {
+        __ssd168x_dev_free(disp_spi_dev);
+        return rt;
+    }
+
+    PR_NOTICE("tdd_disp_spi_epd_ssd168x_register: %s", name);
+
+    return OPRT_OK;
+}
@@ -42,6 +42,8 @@ typedef enum {
 typedef struct {
     TDD_SPI_FRAME_EVENT_E event;
     TDL_DISP_FRAME_BUFF_T *frame_buff;
+    uint8_t               area_num; // 0 sends the whole frame buffer
+    TDL_DISP_RECT_T       areas[TDL_DISP_FLUSH_AREA_MAX];
 }TDD_DISP_SPI_MSG_T;
 
 typedef struct {
@@ -277,6 +279,61 @@ static void __disp_spi_display_frame(DISP_SPI_DEV_T *disp_spi_dev, TDL_DISP_FRAM
     tdd_disp_spi_send_data(&disp_spi_dev->cfg, frame_buff->frame, frame_buff->len);
 }
 
+static uint32_t __disp_spi_pixel_bytes(TUYA_DISPLAY_PIXEL_FMT_E pixel_fmt)
+{
+    switch (pixel_fmt) {
+    case TUYA_PIXEL_FMT_RGB565:
+        return 2;
+    case TUYA_PIXEL_FMT_RGB666:
+    case TUYA_PIXEL_FMT_RGB888:
+        return 3;
+    default:
+        return 0;
+    }
+}
+
+static void __disp_spi_display_areas(DISP_SPI_DEV_T *disp_spi_dev, TDD_DISP_SPI_MSG_T *msg)
+{
+    DISP_SPI_BASE_CFG_T *p_cfg = &disp_spi_dev->cfg;
+    TDL_DISP_FRAME_BUFF_T *fb = msg->frame_buff;
+    uint32_t px_bytes = __disp_spi_pixel_bytes(p_cfg->pixel_fmt);
+    uint32_t stride = fb->width * px_bytes;
+
+    for (uint8_t i = 0; i < msg->area_num; i++) {
+        TDL_DISP_RECT_T *area = &msg->areas[i];
+        uint32_t row_len = (area->x1 - area->x0 + 1) * px_bytes;
+        uint32_t rows = area->y1 - area->y0 + 1;
+        uint8_t *row = fb->frame + (area->y0 - fb->y_start) * stride + (area->x0 - fb->x_start) * px_bytes;
+
+        __disp_spi_set_window(p_cfg, area->x0, area->y0, area->x1, area->y1);
+        tdd_disp_spi_send_cmd(p_cfg, p_cfg->cmd_ramwr);
+
+        if (row_len == stride) {
+            tdd_disp_spi_send_data(p_cfg, row, row_len * rows);
+            continue;
+        }
+
+        // the panel keeps writing the window while CS stays low, one transfer per row
+        if (p_cfg->cs_pin < TUYA_GPIO_NUM_MAX) {
+            tkl_gpio_write(p_cfg->cs_pin, TUYA_GPIO_LEVEL_LOW);
+        }
+        if (p_cfg->dc_pin < TUYA_GPIO_NUM_MAX) {
+            tkl_gpio_write(p_cfg->dc_pin, TUYA_GPIO_LEVEL_HIGH);
+        }
+
+        for (uint32_t y = 0; y < rows; y++) {
+            if (OPRT_OK != __disp_spi_send(p_cfg->port, row, row_len)) {
+                break;
+            }
+            row += stride;
+        }
+
+        if (p_cfg->cs_pin < TUYA_GPIO_NUM_MAX) {
+            tkl_gpio_write(p_cfg->cs_pin, TUYA_GPIO_LEVEL_HIGH);
+        }
+    }
+}
+
 static void __disp_spi_task(void *args)
 {
     OPERATE_RET rt = 0;
@@ -300,7 +357,11 @@ static void __disp_spi_task(void *args)
 
         switch(msg.event) {
         case TDD_SPI_FRAME_REQUEST: {
-            __disp_spi_display_frame(disp_spi_dev, msg.frame_buff);
+            if (msg.area_num && msg.frame_buff) {
+                __disp_spi_display_areas(disp_spi_dev, &msg);
+            } else {
+                __disp_spi_display_frame(disp_spi_dev, msg.frame_buff);
+            }
             if (msg.frame_buff != NULL && msg.frame_buff->free_cb) {
                 msg.frame_buff->free_cb(msg.frame_buff);
             }
@@ -368,7 +429,40 @@ static OPERATE_RET __tdd_display_spi_flush(TDD_DISP_DEV_HANDLE_T device, TDL_DIS
     disp_spi_dev = (DISP_SPI_DEV_T *)device;
     port = disp_spi_dev->cfg.port;
 
-    TDD_DISP_SPI_MSG_T msg = {TDD_SPI_FRAME_REQUEST, frame_buff};
+    TDD_DISP_SPI_MSG_T msg;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.event = TDD_SPI_FRAME_REQUEST;
+    msg.frame_buff = frame_buff;
+    TUYA_CALL_ERR_RETURN(tal_queue_post(sg_disp_spi_sync[port].queue, &msg, SEM_WAIT_FOREVER));
+
+    return rt;
+}
+
+static OPERATE_RET __tdd_display_spi_flush_area(TDD_DISP_DEV_HANDLE_T device, TDL_DISP_FRAME_BUFF_T *frame_buff, \
+                                               const TDL_DISP_RECT_T *areas, uint8_t num)
+{
+    OPERATE_RET rt = OPRT_OK;
+    DISP_SPI_DEV_T *disp_spi_dev = NULL;
+    TUYA_SPI_NUM_E port = 0;
+
+    if (NULL == device || NULL == frame_buff || NULL == areas || num > TDL_DISP_FLUSH_AREA_MAX) {
+        return OPRT_INVALID_PARM;
+    }
+
+    disp_spi_dev = (DISP_SPI_DEV_T *)device;
+    port = disp_spi_dev->cfg.port;
+
+    TDD_DISP_SPI_MSG_T msg;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.event = TDD_SPI_FRAME_REQUEST;
+    msg.frame_buff = frame_buff;
+    // sub byte pixels cannot be windowed by column, send them whole
+    if (__disp_spi_pixel_bytes(disp_spi_dev->cfg.pixel_fmt)) {
+        msg.area_num = num;
+        memcpy(msg.areas, areas, num * sizeof(TDL_DISP_RECT_T));
+    }
     TUYA_CALL_ERR_RETURN(tal_queue_post(sg_disp_spi_sync[port].queue, &msg, SEM_WAIT_FOREVER));
 
     return rt;
@@ -617,6 +711,7 @@ OPERATE_RET tdd_disp_spi_device_register(char *name, TDD_DISP_SPI_CFG_T *spi)
         .open  = __tdd_display_spi_open,
         .flush = __tdd_display_spi_flush,
         .close = __tdd_display_spi_close,
+        .flush_area = __tdd_display_spi_flush_area,
     };
 
     TUYA_CALL_ERR_RETURN(tdl_disp_device_register(name, (TDD_DISP_DEV_HANDLE_T)disp_spi_dev,\
@@ -22,12 +22,6 @@ extern "C" {
 /***********************************************************
 ************************macro define************************
 ***********************************************************/
-typedef struct {
-    uint16_t x0;
-    uint16_t y0;
-    uint16_t x1;
-    uint16_t y1;
-} TDL_DISP_RECT_T;
 
 /***********************************************************
 ***********************typedef define***********************
@@ -70,6 +64,19 @@ OPERATE_RET tdl_disp_draw_fill(TDL_DISP_FRAME_BUFF_T *fb, TDL_DISP_RECT_T *rect,
  */
 OPERATE_RET tdl_disp_draw_fill_full(TDL_DISP_FRAME_BUFF_T *fb, uint32_t color, bool is_swap);
 
+/**
+ * @brief Copies an image of the frame buffer format into a rectangle of the frame buffer.
+ *
+ * @param fb Pointer to the frame buffer structure.
+ * @param rect Pointer to the destination rectangle.
+ * @param src Source image, top left pixel first, packed like the frame buffer.
+ * @param src_stride Bytes per source row, 0 for tightly packed rows.
+ * @param is_swap Whether to swap byte order for RGB565 format.
+ * @return OPERATE_RET Operation result code.
+ */
+OPERATE_RET tdl_disp_draw_blit(TDL_DISP_FRAME_BUFF_T *fb, TDL_DISP_RECT_T *rect, const uint8_t *src, \
+                               uint32_t src_stride, bool is_swap);
+
 /**
  * @brief Rotates a display frame buffer to the specified angle.
  *
@@ -84,6 +91,19 @@ OPERATE_RET tdl_disp_draw_rotate(TUYA_DISPLAY_ROTATION_E rot, \
                                    TDL_DISP_FRAME_BUFF_T *out_fb,\
                                    bool is_swap);
 
+#if defined(ENABLE_DISPLAY_BENCH) && (ENABLE_DISPLAY_BENCH == 1)
+/**
+ * @brief Measures the software rotation of one full frame and logs ms per frame.
+ *
+ * @param fmt Pixel format, RGB565, RGB888 or monochrome.
+ * @param width Panel width in pixels.
+ * @param height Panel height in pixels.
+ * @param is_swap Flag indicating whether to swap the frame buffers(rgb565).
+ * @return OPERATE_RET Operation result code.
+ */
+OPERATE_RET tdl_disp_draw_rotate_bench(TUYA_DISPLAY_PIXEL_FMT_E fmt, uint16_t width, uint16_t height, bool is_swap);
+#endif
+
 /**
  * @brief Gets the bits per pixel for the specified display pixel format.
  *
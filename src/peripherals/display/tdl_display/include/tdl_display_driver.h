@@ -74,6 +74,9 @@ typedef struct {
     OPERATE_RET (*open)(TDD_DISP_DEV_HANDLE_T device);
     OPERATE_RET (*flush)(TDD_DISP_DEV_HANDLE_T device, TDL_DISP_FRAME_BUFF_T *frame_buff);
     OPERATE_RET (*close)(TDD_DISP_DEV_HANDLE_T device);
+    /* optional, sends only the areas of a full frame buffer, areas are checked and at most TDL_DISP_FLUSH_AREA_MAX */
+    OPERATE_RET (*flush_area)(TDD_DISP_DEV_HANDLE_T device, TDL_DISP_FRAME_BUFF_T *frame_buff, \
+                              const TDL_DISP_RECT_T *areas, uint8_t num);
 } TDD_DISP_INTFS_T;
 
 typedef TDL_DISP_FRAME_BUFF_T *(*TDD_DISP_CONVERT_FB_CB)(TDL_DISP_FRAME_BUFF_T *frame_buff);
@@ -110,6 +113,22 @@ OPERATE_RET tdl_disp_device_register(char *name, TDD_DISP_DEV_HANDLE_T tdd_hdl,
  *                     or OPRT_COM_ERROR if the display device is not found
  */
 OPERATE_RET tdl_disp_custom_backlight_register(char *name, TDD_SET_BACKLIGHT_CB set_bl_cb, void *arg);
+
+/**
+ * @brief Registers the tearing effect (TE) output of a display panel
+ *
+ * Call it after the device is registered and before it is opened. The TE interrupt is
+ * set up when the device is opened and lets tdl_disp_dev_wait_te() track the panel's
+ * vertical blanking.
+ *
+ * @param name Name of the display device
+ * @param te_pin GPIO connected to the panel TE output
+ * @param mode Edge that starts the blanking, TUYA_GPIO_IRQ_RISE or TUYA_GPIO_IRQ_FALL
+ *
+ * @return OPERATE_RET Returns OPRT_OK on success, OPRT_INVALID_PARM if parameters are invalid,
+ *                     or OPRT_COM_ERROR if the display device is not found
+ */
+OPERATE_RET tdl_disp_te_register(char *name, TUYA_GPIO_NUM_E te_pin, TUYA_GPIO_IRQ_E mode);
                                 
 #ifdef __cplusplus
 }
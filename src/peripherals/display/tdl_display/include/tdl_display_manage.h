@@ -23,6 +23,15 @@ extern "C" {
 /***********************************************************
 ************************macro define************************
 ***********************************************************/
+// most areas one tdl_disp_dev_flush_area() call takes
+#ifndef TDL_DISP_FLUSH_AREA_MAX
+#define TDL_DISP_FLUSH_AREA_MAX 8
+#endif
+
+// areas covering more of the frame than this are sent as a full frame
+#ifndef TDL_DISP_FLUSH_AREA_FULL_PCT
+#define TDL_DISP_FLUSH_AREA_FULL_PCT 70
+#endif
 
 /***********************************************************
 ***********************typedef define***********************
@@ -37,6 +46,13 @@ typedef enum  {
 
 typedef void*  TDL_DISP_HANDLE_T;
 
+typedef struct {
+    uint16_t x0;
+    uint16_t y0;
+    uint16_t x1;
+    uint16_t y1;
+} TDL_DISP_RECT_T;
+
 typedef enum {
     DISP_FB_TP_SRAM = 0,
     DISP_FB_TP_PSRAM,
@@ -67,6 +83,8 @@ typedef struct {
     TUYA_DISPLAY_PIXEL_FMT_E fmt;
     bool                     is_swap;
     bool                     has_vram;
+    bool                     has_flush_area;
+    bool                     has_te;
 } TDL_DISP_DEV_INFO_T;
 
 /***********************************************************
@@ -158,6 +176,40 @@ void tdl_disp_free_frame_buff(TDL_DISP_FRAME_BUFF_T *frame_buff);
  */
 OPERATE_RET tdl_disp_dev_flush(TDL_DISP_HANDLE_T disp_hdl, TDL_DISP_FRAME_BUFF_T *frame_buff);
 
+/**
+ * @brief Flushes only the given areas of the frame buffer to the display device.
+ *
+ * The areas are inclusive screen coordinates inside the frame buffer. A driver with
+ * a flush_area interface sets the panel window (CASET/RASET) to each area and sends
+ * only its rows. Without one, or when the areas cover more than
+ * TDL_DISP_FLUSH_AREA_FULL_PCT of the frame, the whole frame buffer is flushed.
+ * The areas are copied, the frame buffer is released through its free_cb as with
+ * tdl_disp_dev_flush().
+ *
+ * @param disp_hdl Handle to the display device.
+ * @param frame_buff Pointer to the frame buffer containing pixel data to be displayed.
+ * @param areas Array of areas to update.
+ * @param num Number of areas, at most TDL_DISP_FLUSH_AREA_MAX.
+ *
+ * @return Returns OPRT_OK on success, or an appropriate error code if flushing fails.
+ */
+OPERATE_RET tdl_disp_dev_flush_area(TDL_DISP_HANDLE_T disp_hdl, TDL_DISP_FRAME_BUFF_T *frame_buff, \
+                                    const TDL_DISP_RECT_T *areas, uint8_t num);
+
+/**
+ * @brief Waits for the next tearing effect (TE) pulse of the display panel.
+ *
+ * The pulse marks the start of the panel's vertical blanking. A frame written into the
+ * panel RAM from then on, faster than the panel scans it out, shows no tearing.
+ *
+ * @param disp_hdl Handle to the display device.
+ * @param timeout_ms Longest time to wait, in milliseconds.
+ *
+ * @return Returns OPRT_OK at the TE pulse, OPRT_NOT_SUPPORTED if no TE pin was
+ *         registered, or the semaphore error on timeout.
+ */
+OPERATE_RET tdl_disp_dev_wait_te(TDL_DISP_HANDLE_T disp_hdl, uint32_t timeout_ms);
+
 /**
  * @brief Closes and deinitializes a display device.
  *
@@ -9,15 +9,23 @@
  *
  */
 
+#include <string.h>
 #include "tuya_cloud_types.h"
 #include "tal_api.h"
 
 #include "tdl_display_draw.h"
 
+#if defined(TDL_DISP_DRAW_DMA2D) && (TDL_DISP_DRAW_DMA2D == 1)
+#include "tkl_dma2d.h"
+#endif
+
 /***********************************************************
 ************************macro define************************
 ***********************************************************/
-
+// blits smaller than this are copied by the cpu, a dma2d set up costs more
+#ifndef TDL_DISP_DMA2D_MIN_PIXELS
+#define TDL_DISP_DMA2D_MIN_PIXELS 4096
+#endif
 
 /***********************************************************
 ***********************typedef define***********************
@@ -27,7 +35,9 @@
 /***********************************************************
 ***********************variable define**********************
 ***********************************************************/
-
+#if defined(TDL_DISP_DRAW_DMA2D) && (TDL_DISP_DRAW_DMA2D == 1)
+static SEM_HANDLE sg_draw_dma2d_sem = NULL;
+#endif
 
 /***********************************************************
 ***********************function define**********************
@@ -74,6 +84,179 @@ static void __disp_rgb888_write_point(uint32_t x, uint32_t y, uint32_t color, TD
     fb->frame[write_byte_index + 2] = (color >> 16) & 0xFF; // R
 }
 
+static uint32_t __disp_fb_stride(TDL_DISP_FRAME_BUFF_T *fb)
+{
+    switch(fb->fmt) {
+        case TUYA_PIXEL_FMT_RGB565:     return fb->width * 2;
+        case TUYA_PIXEL_FMT_RGB888:     return fb->width * 3;
+        case TUYA_PIXEL_FMT_MONOCHROME: return fb->width / 8;
+        case TUYA_PIXEL_FMT_I2:         return fb->width / 4;
+        default:                        return 0;
+    }
+}
+
+static void __disp_fill_u16(uint16_t *dst, uint16_t value, uint32_t num)
+{
+    if((value & 0xFF) == (value >> 8)) {
+        memset(dst, value & 0xFF, num * 2);
+        return;
+    }
+
+    if(((uintptr_t)dst & 0x03) && num) {
+        *dst++ = value;
+        num--;
+    }
+
+    // two pixels per word store
+    uint32_t *dst32 = (uint32_t *)dst;
+    uint32_t value32 = ((uint32_t)value << 16) | value;
+    for(uint32_t i = 0; i < num / 2; i++) {
+        dst32[i] = value32;
+    }
+    if(num & 1) {
+        dst[num - 1] = value;
+    }
+}
+
+static void __disp_fill_rgb888(uint8_t *dst, uint32_t color, uint32_t num)
+{
+    uint32_t total = num * 3, filled = 0;
+
+    if(0 == num) {
+        return;
+    }
+
+    dst[0] = color & 0xFF;
+    dst[1] = (color >> 8) & 0xFF;
+    dst[2] = (color >> 16) & 0xFF;
+    filled = 3;
+
+    // double the filled part, it always holds whole pixels
+    while(filled < total) {
+        uint32_t chunk = (filled < total - filled) ? filled : total - filled;
+        memcpy(dst + filled, dst, chunk);
+        filled += chunk;
+    }
+}
+
+// bpp is 1 or 2, pixel x of a byte is at bit x * bpp
+static void __disp_fill_bits(uint8_t *row, uint32_t x, uint32_t num, uint8_t bpp, uint8_t value)
+{
+    uint8_t ppb = 8 / bpp;
+    uint8_t mask = (1 << bpp) - 1;
+
+    while((x % ppb) && num) {
+        uint8_t shift = (x % ppb) * bpp;
+        row[x / ppb] = (row[x / ppb] & ~(mask << shift)) | ((value & mask) << shift);
+        x++;
+        num--;
+    }
+
+    if(num >= ppb) {
+        uint8_t pattern = 0;
+        for(uint8_t i = 0; i < ppb; i++) {
+            pattern |= (value & mask) << (i * bpp);
+        }
+        memset(&row[x / ppb], pattern, num / ppb);
+        x += num / ppb * ppb;
+        num %= ppb;
+    }
+
+    while(num) {
+        uint8_t shift = (x % ppb) * bpp;
+        row[x / ppb] = (row[x / ppb] & ~(mask << shift)) | ((value & mask) << shift);
+        x++;
+        num--;
+    }
+}
+
+// x, y are frame buffer relative and already checked
+static OPERATE_RET __disp_fill_rect(TDL_DISP_FRAME_BUFF_T *fb, uint32_t x, uint32_t y, uint32_t width, \
+                                    uint32_t height, uint32_t color, bool is_swap)
+{
+    uint32_t stride = __disp_fb_stride(fb);
+    uint8_t *row = fb->frame + y * stride;
+
+    switch(fb->fmt) {
+        case TUYA_PIXEL_FMT_RGB565:
+        case TUYA_PIXEL_FMT_RGB888: {
+            uint8_t bytes = (TUYA_PIXEL_FMT_RGB565 == fb->fmt) ? 2 : 3;
+            uint8_t *first = row + x * bytes;
+
+            // full rows are one contiguous span
+            if(width == fb->width) {
+                width *= height;
+                height = 1;
+            }
+            if(TUYA_PIXEL_FMT_RGB565 == fb->fmt) {
+                uint16_t color_16 = (uint16_t)(color & 0xFFFF);
+                __disp_fill_u16((uint16_t *)first, is_swap ? WORD_SWAP(color_16) : color_16, width);
+            } else {
+                __disp_fill_rgb888(first, color, width);
+            }
+            for(uint32_t j = 1; j < height; j++) {
+                memcpy(first + j * stride, first, width * bytes);
+            }
+        }
+        break;
+        case TUYA_PIXEL_FMT_MONOCHROME:
+        case TUYA_PIXEL_FMT_I2: {
+            uint8_t bpp = (TUYA_PIXEL_FMT_I2 == fb->fmt) ? 2 : 1;
+            // a set monochrome bit is a black pixel, see tdl_disp_draw_point()
+            uint8_t value = (1 == bpp) ? (color ? 0 : 1) : (uint8_t)(color & 0x03);
+
+            for(uint32_t j = 0; j < height; j++) {
+                __disp_fill_bits(row + j * stride, x, width, bpp, value);
+            }
+        }
+        break;
+        default:
+            PR_ERR("Unsupported pixel format for draw fill: %d", fb->fmt);
+            return OPRT_NOT_SUPPORTED;
+    }
+
+    return OPRT_OK;
+}
+
+#if defined(TDL_DISP_DRAW_DMA2D) && (TDL_DISP_DRAW_DMA2D == 1)
+static void __disp_draw_dma2d_cb(TUYA_DMA2D_IRQ_E type, VOID_T *args)
+{
+    tal_semaphore_post(sg_draw_dma2d_sem);
+}
+
+static OPERATE_RET __disp_blit_dma2d(TDL_DISP_FRAME_BUFF_T *fb, uint32_t x, uint32_t y, uint32_t width, \
+                                     uint32_t height, const uint8_t *src)
+{
+    OPERATE_RET rt = OPRT_OK;
+    TKL_DMA2D_FRAME_INFO_T in_frame = {0};
+    TKL_DMA2D_FRAME_INFO_T out_frame = {0};
+
+    if(NULL == sg_draw_dma2d_sem) {
+        TUYA_CALL_ERR_RETURN(tal_semaphore_create_init(&sg_draw_dma2d_sem, 0, 1));
+        TUYA_DMA2D_BASE_CFG_T cfg = {
+            .cb = __disp_draw_dma2d_cb,
+        };
+        TUYA_CALL_ERR_RETURN(tkl_dma2d_init(&cfg));
+    }
+
+    in_frame.type   = (TUYA_PIXEL_FMT_RGB565 == fb->fmt) ? TUYA_FRAME_FMT_RGB565 : TUYA_FRAME_FMT_RGB888;
+    in_frame.width  = width;
+    in_frame.height = height;
+    in_frame.pbuf   = (uint8_t *)src;
+
+    out_frame.type   = in_frame.type;
+    out_frame.width  = fb->width;
+    out_frame.height = fb->height;
+    out_frame.pbuf   = fb->frame;
+    out_frame.axis.x_axis = x;
+    out_frame.axis.y_axis = y;
+
+    TUYA_CALL_ERR_RETURN(tkl_dma2d_memcpy(&in_frame, &out_frame));
+
+    return tal_semaphore_wait(sg_draw_dma2d_sem, 1000);
+}
+#endif
+
 static bool __is_rect_valid(TDL_DISP_RECT_T *rect, TDL_DISP_FRAME_BUFF_T *fb)
 {
     uint16_t x_end = 0, y_end = 0;
@@ -186,11 +369,7 @@ OPERATE_RET tdl_disp_draw_fill(TDL_DISP_FRAME_BUFF_T *fb, TDL_DISP_RECT_T *rect,
     width = rect->x1 - rect->x0 + 1;
     height = rect->y1 - rect->y0 + 1;
 
-    for(uint32_t j = 0; j < height ; j++) {
-        for(uint32_t i = 0; i < width; i++) {
-            TUYA_CALL_ERR_RETURN(tdl_disp_draw_point(fb, rect->x0+i, rect->y0+j, color, is_swap));
-        }
-    }
+    rt = __disp_fill_rect(fb, rect->x0 - fb->x_start, rect->y0 - fb->y_start, width, height, color, is_swap);
 
     return rt;
 }
@@ -212,11 +391,102 @@ OPERATE_RET tdl_disp_draw_fill_full(TDL_DISP_FRAME_BUFF_T *fb, uint32_t color, b
         return OPRT_INVALID_PARM;
     }
 
-    for(uint32_t j = 0; j < fb->height ; j++) {
-        for(uint32_t i = 0; i < fb->width; i++) {
-            TUYA_CALL_ERR_RETURN(tdl_disp_draw_point(fb, fb->x_start+i, fb->y_start+j, color, is_swap));
+    rt = __disp_fill_rect(fb, 0, 0, fb->width, fb->height, color, is_swap);
+
+    return rt;
+}
+
+/**
+ * @brief Copies an image of the frame buffer format into a rectangle of the frame buffer.
+ *
+ * Rows are copied whole. RGB565 pixels are byte swapped on the way when
+ * is_swap is set. Monochrome and I2 images are packed like the frame buffer,
+ * pixel 0 of a row at bit 0. With TDL_DISP_DRAW_DMA2D large tightly packed
+ * RGB images are copied by the DMA2D engine.
+ *
+ * @param fb Pointer to the frame buffer structure.
+ * @param rect Pointer to the destination rectangle.
+ * @param src Source image, top left pixel first.
+ * @param src_stride Bytes per source row, 0 for tightly packed rows.
+ * @param is_swap Whether to swap byte order for RGB565 format.
+ * @return OPERATE_RET Operation result code.
+ */
+OPERATE_RET tdl_disp_draw_blit(TDL_DISP_FRAME_BUFF_T *fb, TDL_DISP_RECT_T *rect, const uint8_t *src, \
+                               uint32_t src_stride, bool is_swap)
+{
+    uint32_t width = 0, height = 0, x = 0, y = 0;
+
+    if(NULL == fb || NULL == fb->frame || NULL == rect || NULL == src ||\
+       fb->width == 0 || fb->height == 0) {
+        return OPRT_INVALID_PARM;
+    }
+
+    if(false == __is_rect_valid(rect, fb)) {
+        return OPRT_INVALID_PARM;
+    }
+
+    width  = rect->x1 - rect->x0 + 1;
+    height = rect->y1 - rect->y0 + 1;
+    x = rect->x0 - fb->x_start;
+    y = rect->y0 - fb->y_start;
+
+    uint32_t stride = __disp_fb_stride(fb);
+    uint8_t bpp = tdl_disp_get_fmt_bpp(fb->fmt);
+    uint32_t row_bytes = (width * bpp + 7) / 8;
+    if(0 == src_stride) {
+        src_stride = row_bytes;
+    }
+
+    switch(fb->fmt) {
+        case TUYA_PIXEL_FMT_RGB565:
+        case TUYA_PIXEL_FMT_RGB888: {
+            uint8_t *dst = fb->frame + y * stride + x * (bpp / 8);
+#if defined(TDL_DISP_DRAW_DMA2D) && (TDL_DISP_DRAW_DMA2D == 1)
+            if(!is_swap && src_stride == row_bytes && width * height >= TDL_DISP_DMA2D_MIN_PIXELS) {
+                return __disp_blit_dma2d(fb, x, y, width, height, src);
+            }
+#endif
+            for(uint32_t j = 0; j < height; j++) {
+                if(is_swap && TUYA_PIXEL_FMT_RGB565 == fb->fmt) {
+                    const uint8_t *s = src + j * src_stride;
+                    uint16_t *d16 = (uint16_t *)(dst + j * stride);
+                    // byte reads, the source rows need not be aligned
+                    for(uint32_t i = 0; i < width; i++) {
+                        d16[i] = ((uint16_t)s[2 * i] << 8) | s[2 * i + 1];
+                    }
+                } else {
+                    memcpy(dst + j * stride, src + j * src_stride, row_bytes);
+                }
+            }
+        }
+        break;
+        case TUYA_PIXEL_FMT_MONOCHROME:
+        case TUYA_PIXEL_FMT_I2: {
+            uint8_t ppb = 8 / bpp;
+            uint8_t mask = (1 << bpp) - 1;
+
+            for(uint32_t j = 0; j < height; j++) {
+                uint8_t *d = fb->frame + (y + j) * stride;
+                const uint8_t *s = src + j * src_stride;
+                uint32_t i = 0;
+
+                // byte aligned destinations take whole source bytes
+                if(0 == (x % ppb)) {
+                    memcpy(d + x / ppb, s, width / ppb);
+                    i = width / ppb * ppb;
+                }
+                for(; i < width; i++) {
+                    uint8_t pix = (s[i / ppb] >> ((i % ppb) * bpp)) & mask;
+                    uint8_t shift = ((x + i) % ppb) * bpp;
+                    d[(x + i) / ppb] = (d[(x + i) / ppb] & ~(mask << shift)) | (pix << shift);
+                }
+            }
         }
+        break;
+        default:
+            PR_ERR("Unsupported pixel format for draw blit: %d", fb->fmt);
+            return OPRT_NOT_SUPPORTED;
     }
 
-    return rt;
+    return OPRT_OK;
 }
\ No newline at end of file
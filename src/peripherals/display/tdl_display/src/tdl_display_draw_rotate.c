@@ -17,7 +17,17 @@
 /***********************************************************
 ************************macro define************************
 ***********************************************************/
+/* 90 and 270 degree rotations walk TILE x TILE blocks, so the strided source
+ * reads of a block stay in the cache while its destination rows are written */
+#ifndef TDL_DISP_ROTATE_TILE
+#define TDL_DISP_ROTATE_TILE 16
+#endif
 
+#define ROTATE_TILE_LEN(pos, len) (((len) - (pos) < TDL_DISP_ROTATE_TILE) ? ((len) - (pos)) : TDL_DISP_ROTATE_TILE)
+
+#ifndef TDL_DISP_ROTATE_BENCH_ROUNDS
+#define TDL_DISP_ROTATE_BENCH_ROUNDS 10
+#endif
 
 /***********************************************************
 ***********************typedef define***********************
@@ -36,15 +46,20 @@ static void __rotate90_rgb888(uint8_t * src, uint8_t * dst, uint32_t src_width,
 {
     uint32_t src_stride = src_width * 3;
     uint32_t dst_stride = src_height * 3;
-    uint32_t src_index = 0, dst_index = 0;
 
-    for(uint32_t x = 0; x < src_width; ++x) {
-        for(uint32_t y = 0; y < src_height; ++y) {
-            src_index = y * src_stride + x * 3;
-            dst_index = (src_width - x - 1) * dst_stride + y * 3;
-            dst[dst_index] = src[src_index];       /*Red*/
-            dst[dst_index + 1] = src[src_index + 1]; /*Green*/
-            dst[dst_index + 2] = src[src_index + 2]; /*Blue*/
+    for(uint32_t ty = 0; ty < src_height; ty += TDL_DISP_ROTATE_TILE) {
+        uint32_t th = ROTATE_TILE_LEN(ty, src_height);
+        for(uint32_t tx = 0; tx < src_width; tx += TDL_DISP_ROTATE_TILE) {
+            uint32_t tw = ROTATE_TILE_LEN(tx, src_width);
+            for(uint32_t x = tx; x < tx + tw; ++x) {
+                uint8_t *d = dst + (src_width - x - 1) * dst_stride + ty * 3;
+                const uint8_t *s = src + ty * src_stride + x * 3;
+                for(uint32_t y = 0; y < th; ++y, d += 3, s += src_stride) {
+                    d[0] = s[0]; /*Red*/
+                    d[1] = s[1]; /*Green*/
+                    d[2] = s[2]; /*Blue*/
+                }
+            }
         }
     }
 }
@@ -53,15 +68,14 @@ static void __rotate180_rgb888(uint8_t * src, uint8_t * dst, uint32_t src_width,
 {
     uint32_t src_stride = src_width * 3;
     uint32_t dst_stride = src_width * 3;
-    uint32_t src_index = 0, dst_index = 0;
 
     for(uint32_t y = 0; y < src_height; ++y) {
-        for(uint32_t x = 0; x < src_width; ++x) {
-            src_index = y * src_stride + x * 3;
-            dst_index = (src_height - y - 1) * dst_stride + (src_width - x - 1) * 3;
-            dst[dst_index] = src[src_index];
-            dst[dst_index + 1] = src[src_index + 1];
-            dst[dst_index + 2] = src[src_index + 2];
+        const uint8_t *s = src + y * src_stride;
+        uint8_t *d = dst + (src_height - y - 1) * dst_stride + (src_width - 1) * 3;
+        for(uint32_t x = 0; x < src_width; ++x, s += 3, d -= 3) {
+            d[0] = s[0];
+            d[1] = s[1];
+            d[2] = s[2];
         }
     }
 }
@@ -70,15 +84,20 @@ static void __rotate270_rgb888(uint8_t * src, uint8_t * dst, uint32_t src_width,
 {
     uint32_t src_stride = src_width * 3;
     uint32_t dst_stride = src_height * 3;
-    uint32_t src_index = 0, dst_index = 0;
 
-    for(uint32_t x = 0; x < src_width; ++x) {
-        for(uint32_t y = 0; y < src_height; ++y) {
-            src_index = y * src_stride + x * 3;
-            dst_index = x * dst_stride + (src_height - y - 1) * 3;
-            dst[dst_index] = src[src_index];       /*Red*/
-            dst[dst_index + 1] = src[src_index + 1]; /*Green*/
-            dst[dst_index + 2] = src[src_index + 2]; /*Blue*/
+    for(uint32_t ty = 0; ty < src_height; ty += TDL_DISP_ROTATE_TILE) {
+        uint32_t th = ROTATE_TILE_LEN(ty, src_height);
+        for(uint32_t tx = 0; tx < src_width; tx += TDL_DISP_ROTATE_TILE) {
+            uint32_t tw = ROTATE_TILE_LEN(tx, src_width);
+            for(uint32_t x = tx; x < tx + tw; ++x) {
+                uint8_t *d = dst + x * dst_stride + (src_height - ty - 1) * 3;
+                const uint8_t *s = src + ty * src_stride + x * 3;
+                for(uint32_t y = 0; y < th; ++y, d -= 3, s += src_stride) {
+                    d[0] = s[0]; /*Red*/
+                    d[1] = s[1]; /*Green*/
+                    d[2] = s[2]; /*Blue*/
+                }
+            }
         }
     }
 }
@@ -106,63 +125,88 @@ static void __tdl_disp_draw_sw_rotate_rgb888(TUYA_DISPLAY_ROTATION_E rot, \
     }
 }
 
-static void __rotate270_rgb565(uint16_t * src, uint16_t * dst, uint32_t src_width, uint32_t src_height, bool is_swap)
+/* is_swap is a constant at every call below, so each loop is built twice
+ * without a per pixel branch */
+static inline __attribute__((always_inline)) uint16_t __rgb565_px(uint16_t px, const bool is_swap)
 {
-    uint32_t src_stride = src_width;
-    uint32_t dst_stride = src_height;
-    uint32_t src_index = 0, dst_index = 0;
+    return is_swap ? WORD_SWAP(px) : px;
+}
 
-    for(uint32_t x = 0; x < src_width; ++x) {
-        dst_index = x * dst_stride;
-        src_index = x;
-        for(uint32_t y = 0; y < src_height; ++y) {
-            if(true == is_swap) {
-                dst[dst_index + (src_height - y - 1)] = WORD_SWAP(src[src_index]);
-            }else {
-                dst[dst_index + (src_height - y - 1)] = src[src_index];
+static inline __attribute__((always_inline)) void __rotate270_rgb565_tiled(const uint16_t * src, uint16_t * dst, \
+                                                                            uint32_t src_width, uint32_t src_height, \
+                                                                            const bool is_swap)
+{
+    for(uint32_t ty = 0; ty < src_height; ty += TDL_DISP_ROTATE_TILE) {
+        uint32_t th = ROTATE_TILE_LEN(ty, src_height);
+        for(uint32_t tx = 0; tx < src_width; tx += TDL_DISP_ROTATE_TILE) {
+            uint32_t tw = ROTATE_TILE_LEN(tx, src_width);
+            for(uint32_t x = tx; x < tx + tw; ++x) {
+                uint16_t *d = dst + x * src_height + (src_height - ty - 1);
+                const uint16_t *s = src + ty * src_width + x;
+                for(uint32_t y = 0; y < th; ++y, s += src_width) {
+                    *d-- = __rgb565_px(*s, is_swap);
+                }
             }
-
-            src_index += src_stride;
         }
     }
 }
 
-static void __rotate180_rgb565(uint16_t * src, uint16_t * dst, uint32_t src_width, uint32_t src_height, bool is_swap)
+static inline __attribute__((always_inline)) void __rotate90_rgb565_tiled(const uint16_t * src, uint16_t * dst, \
+                                                                           uint32_t src_width, uint32_t src_height, \
+                                                                           const bool is_swap)
 {
-    uint32_t src_stride = src_width;
-    uint32_t dst_stride = src_width;
-    uint32_t src_index = 0, dst_index = 0;
+    for(uint32_t ty = 0; ty < src_height; ty += TDL_DISP_ROTATE_TILE) {
+        uint32_t th = ROTATE_TILE_LEN(ty, src_height);
+        for(uint32_t tx = 0; tx < src_width; tx += TDL_DISP_ROTATE_TILE) {
+            uint32_t tw = ROTATE_TILE_LEN(tx, src_width);
+            for(uint32_t x = tx; x < tx + tw; ++x) {
+                uint16_t *d = dst + (src_width - x - 1) * src_height + ty;
+                const uint16_t *s = src + ty * src_width + x;
+                for(uint32_t y = 0; y < th; ++y, s += src_width) {
+                    *d++ = __rgb565_px(*s, is_swap);
+                }
+            }
+        }
+    }
+}
 
+static inline __attribute__((always_inline)) void __rotate180_rgb565_rows(const uint16_t * src, uint16_t * dst, \
+                                                                           uint32_t src_width, uint32_t src_height, \
+                                                                           const bool is_swap)
+{
     for(uint32_t y = 0; y < src_height; ++y) {
-        dst_index = (src_height - y - 1) * dst_stride;
-        src_index = y * src_stride;
+        const uint16_t *s = src + y * src_width;
+        uint16_t *d = dst + (src_height - y - 1) * src_width + src_width - 1;
         for(uint32_t x = 0; x < src_width; ++x) {
-            if(true == is_swap) {
-                dst[dst_index + src_width - x - 1] = WORD_SWAP(src[src_index + x]);
-            }else {
-                dst[dst_index + src_width - x - 1] = src[src_index + x];
-            }
+            *d-- = __rgb565_px(*s++, is_swap);
         }
     }
 }
 
-static void __rotate90_rgb565(uint16_t * src, uint16_t * dst, uint32_t src_width, uint32_t src_height, bool is_swap)
+static void __rotate270_rgb565(uint16_t * src, uint16_t * dst, uint32_t src_width, uint32_t src_height, bool is_swap)
 {
-    uint32_t src_stride = src_width;
-    uint32_t dst_stride = src_height;
-    uint32_t src_index = 0, dst_index = 0;
+    if(is_swap) {
+        __rotate270_rgb565_tiled(src, dst, src_width, src_height, true);
+    }else {
+        __rotate270_rgb565_tiled(src, dst, src_width, src_height, false);
+    }
+}
 
-    for(uint32_t x = 0; x < src_width; ++x) {
-        dst_index = (src_width - x - 1);
-        src_index = x;
-        for(uint32_t y = 0; y < src_height; ++y) {
-            if(true == is_swap) {
-                dst[dst_index * dst_stride + y] = WORD_SWAP(src[src_index]);
-            }else {
-                dst[dst_index * dst_stride + y] = src[src_index];
-            }
-            src_index += src_stride;
-        }
+static void __rotate180_rgb565(uint16_t * src, uint16_t * dst, uint32_t src_width, uint32_t src_height, bool is_swap)
+{
+    if(is_swap) {
+        __rotate180_rgb565_rows(src, dst, src_width, src_height, true);
+    }else {
+        __rotate180_rgb565_rows(src, dst, src_width, src_height, false);
+    }
+}
+
+static void __rotate90_rgb565(uint16_t * src, uint16_t * dst, uint32_t src_width, uint32_t src_height, bool is_swap)
+{
+    if(is_swap) {
+        __rotate90_rgb565_tiled(src, dst, src_width, src_height, true);
+    }else {
+        __rotate90_rgb565_tiled(src, dst, src_width, src_height, false);
     }
 }
 
@@ -338,4 +382,64 @@ OPERATE_RET tdl_disp_draw_rotate(TUYA_DISPLAY_ROTATION_E rot, \
     }
     
     return OPRT_OK;
-}
\ No newline at end of file
+}
+
+#if defined(ENABLE_DISPLAY_BENCH) && (ENABLE_DISPLAY_BENCH == 1)
+/**
+ * @brief Measures the software rotation of one full frame.
+ *
+ * Rotates a width x height frame TDL_DISP_ROTATE_BENCH_ROUNDS times for each
+ * angle and logs the ms per frame, so panels can be compared by resolution.
+ *
+ * @param fmt Pixel format, RGB565, RGB888 or monochrome.
+ * @param width Panel width in pixels.
+ * @param height Panel height in pixels.
+ * @param is_swap Flag indicating whether to swap the frame buffers(rgb565).
+ * @return OPERATE_RET Operation result code.
+ */
+OPERATE_RET tdl_disp_draw_rotate_bench(TUYA_DISPLAY_PIXEL_FMT_E fmt, uint16_t width, uint16_t height, bool is_swap)
+{
+    OPERATE_RET rt = OPRT_OK;
+    static const TUYA_DISPLAY_ROTATION_E rots[] = {TUYA_DISPLAY_ROTATION_90, TUYA_DISPLAY_ROTATION_180,
+                                                   TUYA_DISPLAY_ROTATION_270};
+    uint8_t bpp = tdl_disp_get_fmt_bpp(fmt);
+    uint32_t len = (bpp < 8) ? ((uint32_t)(width + 7) / 8 * ((height + 7) / 8 * 8)) : (uint32_t)width * height * bpp / 8;
+
+    if(0 == len) {
+        return OPRT_INVALID_PARM;
+    }
+
+    TDL_DISP_FRAME_BUFF_T *in_fb  = tdl_disp_create_frame_buff(DISP_FB_TP_PSRAM, len);
+    TDL_DISP_FRAME_BUFF_T *out_fb = tdl_disp_create_frame_buff(DISP_FB_TP_PSRAM, len);
+    if(NULL == in_fb || NULL == out_fb) {
+        rt = OPRT_MALLOC_FAILED;
+        goto __EXIT;
+    }
+    memset(in_fb->frame, 0x5A, len);
+
+    for(uint32_t i = 0; i < CNTSOF(rots); i++) {
+        SYS_TIME_T start = tal_system_get_millisecond();
+        for(uint32_t r = 0; r < TDL_DISP_ROTATE_BENCH_ROUNDS; r++) {
+            in_fb->fmt = out_fb->fmt = fmt;
+            in_fb->width  = width;
+            in_fb->height = height;
+            rt = tdl_disp_draw_rotate(rots[i], in_fb, out_fb, is_swap);
+            if(OPRT_OK != rt) {
+                goto __EXIT;
+            }
+        }
+        uint32_t cost = (uint32_t)(tal_system_get_millisecond() - start);
+        PR_NOTICE("rotate %ux%u fmt:%d rot:%d %u.%02u ms/frame", width, height, fmt, rots[i], \
+                  cost / TDL_DISP_ROTATE_BENCH_ROUNDS, cost * 100 / TDL_DISP_ROTATE_BENCH_ROUNDS % 100);
+    }
+
+__EXIT:
+    if(in_fb) {
+        tdl_disp_free_frame_buff(in_fb);
+    }
+    if(out_fb) {
+        tdl_disp_free_frame_buff(out_fb);
+    }
+    return rt;
+}
+#endif
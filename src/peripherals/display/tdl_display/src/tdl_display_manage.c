@@ -46,6 +46,10 @@ typedef struct {
     TDD_DISP_INTFS_T      intfs;
     TDD_SET_BACKLIGHT_CB  custom_set_bl_cb;
     void                 *custom_set_bl_arg;
+
+    TUYA_GPIO_NUM_E       te_pin;
+    TUYA_GPIO_IRQ_E       te_mode;
+    SEM_HANDLE            te_sem;
 } DISPLAY_DEVICE_T;
 
 /***********************************************************
@@ -106,6 +110,53 @@ static void __tdl_blacklight_init(TUYA_DISPLAY_BL_CTRL_T *bl_cfg)
     return;
 }
 
+static void __tdl_te_irq_cb(void *args)
+{
+    DISPLAY_DEVICE_T *display_dev = (DISPLAY_DEVICE_T *)args;
+
+    tal_semaphore_post(display_dev->te_sem);
+}
+
+static void __tdl_te_init(DISPLAY_DEVICE_T *display_dev)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    if (false == display_dev->info.has_te) {
+        return;
+    }
+
+    TUYA_GPIO_BASE_CFG_T pin_cfg = {
+        .mode = TUYA_GPIO_PULLUP,
+        .direct = TUYA_GPIO_INPUT,
+        .level = TUYA_GPIO_LEVEL_HIGH,
+    };
+    TUYA_GPIO_IRQ_T irq_cfg = {
+        .mode = display_dev->te_mode,
+        .cb = __tdl_te_irq_cb,
+        .arg = display_dev,
+    };
+
+    TUYA_CALL_ERR_GOTO(tkl_gpio_init(display_dev->te_pin, &pin_cfg), __ERR);
+    TUYA_CALL_ERR_GOTO(tkl_gpio_irq_init(display_dev->te_pin, &irq_cfg), __ERR);
+    TUYA_CALL_ERR_GOTO(tkl_gpio_irq_enable(display_dev->te_pin), __ERR);
+
+    return;
+
+__ERR:
+    // without the interrupt tdl_disp_dev_wait_te() would only time out
+    display_dev->info.has_te = false;
+}
+
+static void __tdl_te_deinit(DISPLAY_DEVICE_T *display_dev)
+{
+    if (false == display_dev->info.has_te) {
+        return;
+    }
+
+    tkl_gpio_irq_disable(display_dev->te_pin);
+    tkl_gpio_deinit(display_dev->te_pin);
+}
+
 static void __tdl_power_ctrl_io_init(TUYA_DISPLAY_IO_CTRL_T *power)
 {
     TUYA_GPIO_BASE_CFG_T cfg;
@@ -200,6 +251,8 @@ OPERATE_RET tdl_disp_dev_open(TDL_DISP_HANDLE_T disp_hdl)
 
     __tdl_blacklight_init(&display_dev->bl);
 
+    __tdl_te_init(display_dev);
+
     display_dev->is_open = true;
 
     return OPRT_OK;
@@ -238,6 +291,94 @@ OPERATE_RET tdl_disp_dev_flush(TDL_DISP_HANDLE_T disp_hdl, TDL_DISP_FRAME_BUFF_T
     return OPRT_OK;
 }
 
+/**
+ * @brief Flushes only the given areas of the frame buffer to the display device.
+ *
+ * The areas are inclusive screen coordinates inside the frame buffer. A driver with
+ * a flush_area interface sets the panel window (CASET/RASET) to each area and sends
+ * only its rows. Without one, or when the areas cover more than
+ * TDL_DISP_FLUSH_AREA_FULL_PCT of the frame, the whole frame buffer is flushed.
+ *
+ * @param disp_hdl Handle to the display device.
+ * @param frame_buff Pointer to the frame buffer containing pixel data to be displayed.
+ * @param areas Array of areas to update.
+ * @param num Number of areas, at most TDL_DISP_FLUSH_AREA_MAX.
+ *
+ * @return Returns OPRT_OK on success, or an appropriate error code if flushing fails.
+ */
+OPERATE_RET tdl_disp_dev_flush_area(TDL_DISP_HANDLE_T disp_hdl, TDL_DISP_FRAME_BUFF_T *frame_buff, \
+                                    const TDL_DISP_RECT_T *areas, uint8_t num)
+{
+    OPERATE_RET rt = OPRT_OK;
+    DISPLAY_DEVICE_T *display_dev = NULL;
+    uint32_t area_pixels = 0;
+
+    if (NULL == disp_hdl || NULL == frame_buff || (num && NULL == areas) || num > TDL_DISP_FLUSH_AREA_MAX) {
+        return OPRT_INVALID_PARM;
+    }
+
+    display_dev = (DISPLAY_DEVICE_T *)disp_hdl;
+
+    if (false == display_dev->is_open) {
+        return OPRT_COM_ERROR;
+    }
+
+    if (NULL == display_dev->intfs.flush_area || 0 == num) {
+        return tdl_disp_dev_flush(disp_hdl, frame_buff);
+    }
+
+    for (uint8_t i = 0; i < num; i++) {
+        if (areas[i].x0 > areas[i].x1 || areas[i].y0 > areas[i].y1 ||
+            areas[i].x0 < frame_buff->x_start || areas[i].x1 >= frame_buff->x_start + frame_buff->width ||
+            areas[i].y0 < frame_buff->y_start || areas[i].y1 >= frame_buff->y_start + frame_buff->height) {
+            PR_ERR("flush area %d out of frame: %d %d %d %d", i, areas[i].x0, areas[i].y0, areas[i].x1, areas[i].y1);
+            return OPRT_INVALID_PARM;
+        }
+        area_pixels += (uint32_t)(areas[i].x1 - areas[i].x0 + 1) * (areas[i].y1 - areas[i].y0 + 1);
+    }
+
+    // one long burst beats many windowed ones once most of the frame is dirty
+    if (area_pixels * 100 > (uint32_t)frame_buff->width * frame_buff->height * TDL_DISP_FLUSH_AREA_FULL_PCT) {
+        return tdl_disp_dev_flush(disp_hdl, frame_buff);
+    }
+
+    TUYA_CALL_ERR_RETURN(display_dev->intfs.flush_area(display_dev->tdd_hdl, frame_buff, areas, num));
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief Waits for the next tearing effect (TE) pulse of the display panel.
+ *
+ * The pulse marks the start of the panel's vertical blanking. A frame written into the
+ * panel RAM from then on, faster than the panel scans it out, shows no tearing.
+ *
+ * @param disp_hdl Handle to the display device.
+ * @param timeout_ms Longest time to wait, in milliseconds.
+ *
+ * @return Returns OPRT_OK at the TE pulse, OPRT_NOT_SUPPORTED if no TE pin was
+ *         registered, or the semaphore error on timeout.
+ */
+OPERATE_RET tdl_disp_dev_wait_te(TDL_DISP_HANDLE_T disp_hdl, uint32_t timeout_ms)
+{
+    DISPLAY_DEVICE_T *display_dev = NULL;
+
+    if (NULL == disp_hdl) {
+        return OPRT_INVALID_PARM;
+    }
+
+    display_dev = (DISPLAY_DEVICE_T *)disp_hdl;
+
+    if (false == display_dev->is_open || false == display_dev->info.has_te) {
+        return OPRT_NOT_SUPPORTED;
+    }
+
+    // drop a pulse left from an earlier frame, only the next one counts
+    tal_semaphore_wait(display_dev->te_sem, 0);
+
+    return tal_semaphore_wait(display_dev->te_sem, timeout_ms);
+}
+
 /**
  * @brief Retrieves information about a registered display device.
  *
@@ -350,6 +491,8 @@ OPERATE_RET tdl_disp_dev_close(TDL_DISP_HANDLE_T disp_hdl)
 
     __tdl_blacklight_deinit(&display_dev->bl);
 
+    __tdl_te_deinit(display_dev);
+
     __tdl_power_ctrl_io_deinit(&display_dev->power);
 
     display_dev->is_open = false;
@@ -470,6 +613,7 @@ OPERATE_RET tdl_disp_device_register(char *name, TDD_DISP_DEV_HANDLE_T tdd_hdl,
     display_dev->info.rotation = dev_info->rotation;
     display_dev->info.is_swap  = dev_info->is_swap;
     display_dev->info.has_vram = dev_info->has_vram;
+    display_dev->info.has_flush_area = (intfs->flush_area != NULL);
 
     memcpy(&display_dev->bl, &dev_info->bl, sizeof(TUYA_DISPLAY_BL_CTRL_T));
     memcpy(&display_dev->power, &dev_info->power, sizeof(TUYA_DISPLAY_IO_CTRL_T));
@@ -512,6 +656,45 @@ OPERATE_RET tdl_disp_custom_backlight_register(char *name, TDD_SET_BACKLIGHT_CB
     return OPRT_OK;
 }
 
+/**
+ * @brief Registers the tearing effect (TE) output of a display panel
+ *
+ * Call it after the device is registered and before it is opened. The TE interrupt is
+ * set up when the device is opened and lets tdl_disp_dev_wait_te() track the panel's
+ * vertical blanking.
+ *
+ * @param name Name of the display device
+ * @param te_pin GPIO connected to the panel TE output
+ * @param mode Edge that starts the blanking, TUYA_GPIO_IRQ_RISE or TUYA_GPIO_IRQ_FALL
+ *
+ * @return OPERATE_RET Returns OPRT_OK on success, OPRT_INVALID_PARM if parameters are invalid,
+ *                     or OPRT_COM_ERROR if the display device is not found
+ */
+OPERATE_RET tdl_disp_te_register(char *name, TUYA_GPIO_NUM_E te_pin, TUYA_GPIO_IRQ_E mode)
+{
+    OPERATE_RET rt = OPRT_OK;
+    DISPLAY_DEVICE_T *display_dev = NULL;
+
+    if (NULL == name || te_pin >= TUYA_GPIO_NUM_MAX) {
+        return OPRT_INVALID_PARM;
+    }
+
+    display_dev = __find_display_device(name);
+    if (NULL == display_dev) {
+        return OPRT_COM_ERROR;
+    }
+
+    if (NULL == display_dev->te_sem) {
+        TUYA_CALL_ERR_RETURN(tal_semaphore_create_init(&display_dev->te_sem, 0, 1));
+    }
+
+    display_dev->te_pin = te_pin;
+    display_dev->te_mode = mode;
+    display_dev->info.has_te = true;
+
+    return OPRT_OK;
+}
+
 /**
  * @brief Swaps the byte order of each pixel in an array of RGB565 data.
  *
@@ -0,0 +1,112 @@
+/**
+ * @file tdl_imu_fifo.h
+ * @brief Tuya Driver Layer IMU FIFO streaming interface.
+ *
+ * This file provides a streaming service on top of the BMI270 sensor FIFO.
+ * The accelerometer and gyroscope samples are queued in the sensor, the FIFO
+ * watermark interrupt wakes a task once a batch is complete, and the batch is
+ * burst-read in a single bus transaction and delivered to every subscriber
+ * with a timestamp per sample. Compared with reading one sample per data
+ * ready, bus transactions and wakeups drop by the batch size.
+ *
+ * The sensor must already be initialized with accelerometer and gyroscope
+ * enabled at the same output data rate, and advanced power save disabled.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#ifndef __TDL_IMU_FIFO_H__
+#define __TDL_IMU_FIFO_H__
+
+#include "tuya_cloud_types.h"
+#include "bmi2_defs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+// Most samples read in one batch
+#ifndef TDL_IMU_FIFO_MAX_BATCH
+#define TDL_IMU_FIFO_MAX_BATCH 64
+#endif
+
+#ifndef TDL_IMU_FIFO_SUB_MAX
+#define TDL_IMU_FIFO_SUB_MAX 4
+#endif
+
+#ifndef TDL_IMU_FIFO_TASK_STACK
+#define TDL_IMU_FIFO_TASK_STACK 4096
+#endif
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef struct {
+    uint64_t time_us; // Host time the sample was taken
+    int16_t acc[3];   // Accelerometer x, y, z in LSB of the configured range
+    int16_t gyr[3];   // Gyroscope x, y, z in LSB of the configured range
+} TDL_IMU_SAMPLE_T;
+
+/**
+ * @brief Called from the FIFO task for each batch, the samples are only valid during the call
+ */
+typedef void (*TDL_IMU_FIFO_CB)(const TDL_IMU_SAMPLE_T *samples, uint16_t num, void *arg);
+
+typedef struct {
+    TUYA_GPIO_NUM_E int_pin; // GPIO wired to the sensor INT1
+    uint16_t batch;          // Samples per watermark interrupt, 1 ~ TDL_IMU_FIFO_MAX_BATCH
+} TDL_IMU_FIFO_CFG_T;
+
+/***********************************************************
+********************function declaration********************
+***********************************************************/
+/**
+ * @brief Starts streaming the sensor FIFO
+ *
+ * Enables the headerless accelerometer and gyroscope FIFO, maps its watermark
+ * interrupt to INT1 in place of data ready, and starts the FIFO task.
+ *
+ * @param[in] dev Initialized BMI270 device
+ * @param[in] cfg Interrupt pin and batch size
+ *
+ * @return OPRT_OK on success, OPRT_COM_ERROR if the sensor rejects the FIFO setup
+ */
+OPERATE_RET tdl_imu_fifo_start(struct bmi2_dev *dev, TDL_IMU_FIFO_CFG_T *cfg);
+
+/**
+ * @brief Stops streaming, disables the FIFO and its interrupt
+ *
+ * Waits for the FIFO task to exit, so it must not be called from a subscriber.
+ *
+ * @return OPRT_OK on success
+ */
+OPERATE_RET tdl_imu_fifo_stop(void);
+
+/**
+ * @brief Adds a batch subscriber
+ *
+ * @param[in] cb Batch callback
+ * @param[in] arg Passed back to cb
+ *
+ * @return OPRT_OK on success, OPRT_EXCEED_UPPER_LIMIT if TDL_IMU_FIFO_SUB_MAX are subscribed
+ */
+OPERATE_RET tdl_imu_fifo_subscribe(TDL_IMU_FIFO_CB cb, void *arg);
+
+/**
+ * @brief Removes a batch subscriber
+ *
+ * @param[in] cb Batch callback given to tdl_imu_fifo_subscribe()
+ *
+ * @return OPRT_OK on success, OPRT_NOT_FOUND if cb is not subscribed
+ */
+OPERATE_RET tdl_imu_fifo_unsubscribe(TDL_IMU_FIFO_CB cb);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TDL_IMU_FIFO_H__ */
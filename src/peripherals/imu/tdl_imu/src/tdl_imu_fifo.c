@@ -0,0 +1,388 @@
+/**
+ * @file tdl_imu_fifo.c
+ * @brief Tuya Driver Layer IMU FIFO streaming implementation.
+ *
+ * The FIFO runs in headerless mode with an accelerometer and a gyroscope frame
+ * of 12 bytes per sample, so a burst read of whole frames needs no parsing of
+ * frame headers. The watermark is set to the batch size and its interrupt on
+ * INT1 wakes the FIFO task. The task also wakes after a few batch periods
+ * without an interrupt, so a missed edge only delays a batch.
+ *
+ * Samples carry the host time, the newest sample of a batch is taken as read
+ * at the time of the burst read and the older ones are spaced by the output
+ * data rate of the sensor.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include "tkl_gpio.h"
+
+#include "tal_api.h"
+
+#include "bmi2.h"
+#include "tdl_imu_fifo.h"
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+#define IMU_FIFO_FRAME_LEN BMI2_FIFO_ACC_GYR_LENGTH
+
+// Batch periods the task waits for the watermark before reading anyway
+#define IMU_FIFO_WAIT_PERIODS 4
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef struct {
+    TDL_IMU_FIFO_CB cb;
+    void *arg;
+} IMU_FIFO_SUB_T;
+
+typedef struct {
+    struct bmi2_dev *dev;
+    TDL_IMU_FIFO_CFG_T cfg;
+    uint32_t period_us;
+
+    volatile bool running;
+    THREAD_HANDLE thrd;
+    SEM_HANDLE sem;
+    MUTEX_HANDLE mutex;
+
+    uint8_t *raw;
+    struct bmi2_sens_axes_data *acc;
+    struct bmi2_sens_axes_data *gyr;
+    TDL_IMU_SAMPLE_T *samples;
+
+    IMU_FIFO_SUB_T subs[TDL_IMU_FIFO_SUB_MAX];
+} IMU_FIFO_T;
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static IMU_FIFO_T sg_imu_fifo;
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+static void __imu_fifo_irq_cb(void *args)
+{
+    tal_semaphore_post(sg_imu_fifo.sem);
+}
+
+// Sample period of an output data rate code, 0x08 is 100Hz and every step doubles it
+static uint32_t __imu_fifo_odr_period_us(uint8_t odr)
+{
+    if (odr >= BMI2_ACC_ODR_100HZ) {
+        return 10000 >> (odr - BMI2_ACC_ODR_100HZ);
+    }
+
+    return 10000 << (BMI2_ACC_ODR_100HZ - odr);
+}
+
+static OPERATE_RET __imu_fifo_sensor_cfg(struct bmi2_dev *dev, uint16_t batch, bool enable)
+{
+    int8_t rslt = BMI2_OK;
+    struct bmi2_int_pin_config pin_cfg = {0};
+
+    if (false == enable) {
+        bmi2_map_data_int(BMI2_FWM_INT, BMI2_INT_NONE, dev);
+        bmi2_set_fifo_config(BMI2_FIFO_ALL_EN, BMI2_DISABLE, dev);
+        return OPRT_OK;
+    }
+
+    // Headerless accel and gyro frames, flushed of whatever was queued before
+    rslt = bmi2_set_fifo_config(BMI2_FIFO_ALL_EN | BMI2_FIFO_HEADER_EN | BMI2_FIFO_TIME_EN, BMI2_DISABLE, dev);
+    if (BMI2_OK == rslt) {
+        rslt = bmi2_set_command_register(BMI2_FIFO_FLUSH_CMD, dev);
+    }
+    if (BMI2_OK == rslt) {
+        rslt = bmi2_set_fifo_config(BMI2_FIFO_ACC_EN | BMI2_FIFO_GYR_EN, BMI2_ENABLE, dev);
+    }
+    if (BMI2_OK == rslt) {
+        rslt = bmi2_set_fifo_wm(batch * IMU_FIFO_FRAME_LEN, dev);
+    }
+
+    if (BMI2_OK == rslt) {
+        rslt = bmi2_get_int_pin_config(&pin_cfg, dev);
+    }
+    if (BMI2_OK == rslt) {
+        pin_cfg.pin_type = BMI2_INT1;
+        pin_cfg.int_latch = BMI2_INT_NON_LATCH;
+        pin_cfg.pin_cfg[0].lvl = BMI2_INT_ACTIVE_HIGH;
+        pin_cfg.pin_cfg[0].od = BMI2_INT_PUSH_PULL;
+        pin_cfg.pin_cfg[0].output_en = BMI2_INT_OUTPUT_ENABLE;
+        pin_cfg.pin_cfg[0].input_en = BMI2_INT_INPUT_DISABLE;
+        rslt = bmi2_set_int_pin_config(&pin_cfg, dev);
+    }
+
+    // The watermark takes INT1 over from data ready
+    if (BMI2_OK == rslt) {
+        rslt = bmi2_map_data_int(BMI2_DRDY_INT, BMI2_INT_NONE, dev);
+    }
+    if (BMI2_OK == rslt) {
+        rslt = bmi2_map_data_int(BMI2_FWM_INT, BMI2_INT1, dev);
+    }
+
+    if (BMI2_OK != rslt) {
+        PR_ERR("imu fifo config failed: %d", rslt);
+        return OPRT_COM_ERROR;
+    }
+
+    return OPRT_OK;
+}
+
+// Reads the whole frames queued, at most a buffer full, returns the number of samples
+static uint16_t __imu_fifo_read(IMU_FIFO_T *fifo)
+{
+    int8_t rslt = BMI2_OK;
+    uint16_t fifo_len = 0, acc_num = 0, gyr_num = 0, num = 0, i = 0;
+    struct bmi2_fifo_frame frame = {0};
+    uint64_t now_us = 0;
+
+    rslt = bmi2_get_fifo_length(&fifo_len, fifo->dev);
+    if (BMI2_OK != rslt) {
+        return 0;
+    }
+
+    num = fifo_len / IMU_FIFO_FRAME_LEN;
+    if (num > TDL_IMU_FIFO_MAX_BATCH) {
+        num = TDL_IMU_FIFO_MAX_BATCH;
+    }
+    if (0 == num) {
+        return 0;
+    }
+
+    frame.data = fifo->raw;
+    frame.length = num * IMU_FIFO_FRAME_LEN + fifo->dev->dummy_byte;
+    rslt = bmi2_read_fifo_data(&frame, fifo->dev);
+    now_us = (uint64_t)tal_system_get_millisecond() * 1000;
+    if (BMI2_OK != rslt) {
+        PR_ERR("imu fifo read failed: %d", rslt);
+        return 0;
+    }
+
+    acc_num = num;
+    gyr_num = num;
+    bmi2_extract_accel(fifo->acc, &acc_num, &frame, fifo->dev);
+    bmi2_extract_gyro(fifo->gyr, &gyr_num, &frame, fifo->dev);
+    num = (acc_num < gyr_num) ? acc_num : gyr_num;
+
+    for (i = 0; i < num; i++) {
+        fifo->samples[i].time_us = now_us - (uint64_t)(num - 1 - i) * fifo->period_us;
+        fifo->samples[i].acc[0] = fifo->acc[i].x;
+        fifo->samples[i].acc[1] = fifo->acc[i].y;
+        fifo->samples[i].acc[2] = fifo->acc[i].z;
+        fifo->samples[i].gyr[0] = fifo->gyr[i].x;
+        fifo->samples[i].gyr[1] = fifo->gyr[i].y;
+        fifo->samples[i].gyr[2] = fifo->gyr[i].z;
+    }
+
+    return num;
+}
+
+static void __imu_fifo_task(void *args)
+{
+    IMU_FIFO_T *fifo = (IMU_FIFO_T *)args;
+    uint32_t wait_ms = 0;
+    uint16_t num = 0, i = 0;
+
+    wait_ms = fifo->period_us / 1000 * fifo->cfg.batch * IMU_FIFO_WAIT_PERIODS + 1;
+
+    while (fifo->running) {
+        tal_semaphore_wait(fifo->sem, wait_ms);
+        if (false == fifo->running) {
+            break;
+        }
+
+        // Drain until below the watermark, a non-latched level gives no new edge meanwhile
+        do {
+            num = __imu_fifo_read(fifo);
+            if (0 == num) {
+                break;
+            }
+
+            tal_mutex_lock(fifo->mutex);
+            for (i = 0; i < TDL_IMU_FIFO_SUB_MAX; i++) {
+                if (fifo->subs[i].cb) {
+                    fifo->subs[i].cb(fifo->samples, num, fifo->subs[i].arg);
+                }
+            }
+            tal_mutex_unlock(fifo->mutex);
+        } while (fifo->running && num >= fifo->cfg.batch);
+    }
+
+    THREAD_HANDLE tmp_task = fifo->thrd;
+    fifo->thrd = NULL;
+    tal_thread_delete(tmp_task);
+}
+
+static void __imu_fifo_free(IMU_FIFO_T *fifo)
+{
+    if (fifo->raw) {
+        tal_free(fifo->raw);
+        fifo->raw = NULL;
+    }
+    if (fifo->acc) {
+        tal_free(fifo->acc);
+        fifo->acc = NULL;
+    }
+    if (fifo->gyr) {
+        tal_free(fifo->gyr);
+        fifo->gyr = NULL;
+    }
+    if (fifo->samples) {
+        tal_free(fifo->samples);
+        fifo->samples = NULL;
+    }
+}
+
+OPERATE_RET tdl_imu_fifo_start(struct bmi2_dev *dev, TDL_IMU_FIFO_CFG_T *cfg)
+{
+    OPERATE_RET rt = OPRT_OK;
+    IMU_FIFO_T *fifo = &sg_imu_fifo;
+    struct bmi2_sens_config sens_cfg = {.type = BMI2_ACCEL};
+
+    if (NULL == dev || NULL == cfg || 0 == cfg->batch || cfg->batch > TDL_IMU_FIFO_MAX_BATCH) {
+        return OPRT_INVALID_PARM;
+    }
+
+    if (fifo->running) {
+        return OPRT_OK;
+    }
+
+    if (BMI2_OK != bmi2_get_sensor_config(&sens_cfg, 1, dev)) {
+        return OPRT_COM_ERROR;
+    }
+
+    fifo->dev = dev;
+    memcpy(&fifo->cfg, cfg, sizeof(TDL_IMU_FIFO_CFG_T));
+    fifo->period_us = __imu_fifo_odr_period_us(sens_cfg.cfg.acc.odr);
+
+    if (NULL == fifo->mutex) {
+        TUYA_CALL_ERR_RETURN(tal_mutex_create_init(&fifo->mutex));
+    }
+    if (NULL == fifo->sem) {
+        TUYA_CALL_ERR_RETURN(tal_semaphore_create_init(&fifo->sem, 0, 1));
+    }
+
+    fifo->raw = tal_malloc(TDL_IMU_FIFO_MAX_BATCH * IMU_FIFO_FRAME_LEN + 1);
+    fifo->acc = tal_malloc(TDL_IMU_FIFO_MAX_BATCH * sizeof(struct bmi2_sens_axes_data));
+    fifo->gyr = tal_malloc(TDL_IMU_FIFO_MAX_BATCH * sizeof(struct bmi2_sens_axes_data));
+    fifo->samples = tal_malloc(TDL_IMU_FIFO_MAX_BATCH * sizeof(TDL_IMU_SAMPLE_T));
+    if (NULL == fifo->raw || NULL == fifo->acc || NULL == fifo->gyr || NULL == fifo->samples) {
+        __imu_fifo_free(fifo);
+        return OPRT_MALLOC_FAILED;
+    }
+
+    TUYA_CALL_ERR_GOTO(__imu_fifo_sensor_cfg(dev, cfg->batch, true), __ERR);
+
+    TUYA_GPIO_BASE_CFG_T pin_cfg = {
+        .mode = TUYA_GPIO_PULLDOWN,
+        .direct = TUYA_GPIO_INPUT,
+        .level = TUYA_GPIO_LEVEL_LOW,
+    };
+    TUYA_GPIO_IRQ_T irq_cfg = {
+        .mode = TUYA_GPIO_IRQ_RISE,
+        .cb = __imu_fifo_irq_cb,
+        .arg = fifo,
+    };
+    TUYA_CALL_ERR_GOTO(tkl_gpio_init(cfg->int_pin, &pin_cfg), __ERR);
+    TUYA_CALL_ERR_GOTO(tkl_gpio_irq_init(cfg->int_pin, &irq_cfg), __ERR);
+    TUYA_CALL_ERR_GOTO(tkl_gpio_irq_enable(cfg->int_pin), __ERR);
+
+    fifo->running = true;
+    THREAD_CFG_T thread_cfg = {TDL_IMU_FIFO_TASK_STACK, THREAD_PRIO_1, "imu_fifo"};
+    rt = tal_thread_create_and_start(&fifo->thrd, NULL, NULL, __imu_fifo_task, fifo, &thread_cfg);
+    if (OPRT_OK != rt) {
+        fifo->running = false;
+        fifo->thrd = NULL;
+        tkl_gpio_irq_disable(cfg->int_pin);
+        tkl_gpio_deinit(cfg->int_pin);
+        goto __ERR;
+    }
+
+    PR_DEBUG("imu fifo start, batch %d, period %d us", cfg->batch, fifo->period_us);
+
+    return OPRT_OK;
+
+__ERR:
+    __imu_fifo_sensor_cfg(dev, cfg->batch, false);
+    __imu_fifo_free(fifo);
+    return rt;
+}
+
+OPERATE_RET tdl_imu_fifo_stop(void)
+{
+    IMU_FIFO_T *fifo = &sg_imu_fifo;
+
+    if (false == fifo->running) {
+        return OPRT_OK;
+    }
+
+    tkl_gpio_irq_disable(fifo->cfg.int_pin);
+    tkl_gpio_deinit(fifo->cfg.int_pin);
+
+    fifo->running = false;
+    tal_semaphore_post(fifo->sem);
+    while (fifo->thrd) {
+        tal_system_sleep(10);
+    }
+
+    __imu_fifo_sensor_cfg(fifo->dev, fifo->cfg.batch, false);
+    __imu_fifo_free(fifo);
+
+    return OPRT_OK;
+}
+
+OPERATE_RET tdl_imu_fifo_subscribe(TDL_IMU_FIFO_CB cb, void *arg)
+{
+    OPERATE_RET rt = OPRT_EXCEED_UPPER_LIMIT;
+    IMU_FIFO_T *fifo = &sg_imu_fifo;
+    uint16_t i = 0;
+
+    if (NULL == cb) {
+        return OPRT_INVALID_PARM;
+    }
+
+    if (NULL == fifo->mutex) {
+        TUYA_CALL_ERR_RETURN(tal_mutex_create_init(&fifo->mutex));
+    }
+
+    tal_mutex_lock(fifo->mutex);
+    for (i = 0; i < TDL_IMU_FIFO_SUB_MAX; i++) {
+        if (NULL == fifo->subs[i].cb) {
+            fifo->subs[i].cb = cb;
+            fifo->subs[i].arg = arg;
+            rt = OPRT_OK;
+            break;
+        }
+    }
+    tal_mutex_unlock(fifo->mutex);
+
+    return rt;
+}
+
+OPERATE_RET tdl_imu_fifo_unsubscribe(TDL_IMU_FIFO_CB cb)
+{
+    OPERATE_RET rt = OPRT_NOT_FOUND;
+    IMU_FIFO_T *fifo = &sg_imu_fifo;
+    uint16_t i = 0;
+
+    if (NULL == cb || NULL == fifo->mutex) {
+        return OPRT_NOT_FOUND;
+    }
+
+    tal_mutex_lock(fifo->mutex);
+    for (i = 0; i < TDL_IMU_FIFO_SUB_MAX; i++) {
+        if (cb == fifo->subs[i].cb) {
+            fifo->subs[i].cb = NULL;
+            fifo->subs[i].arg = NULL;
+            rt = OPRT_OK;
+            break;
+        }
+    }
+    tal_mutex_unlock(fifo->mutex);
+
+    return rt;
+}
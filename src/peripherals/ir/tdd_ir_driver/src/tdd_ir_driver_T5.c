@@ -51,6 +51,13 @@
 
 #define DEF_TIMER_OVERFLOW_MS (500 * 1000U) // 500ms
 
+/* IR_DRV_CAPTURE: the pwm capture unit latches the edge times, interrupt latency no longer adds to the pulse widths */
+#ifndef EN_TIMER_CAPTURE
+#define EN_TIMER_CAPTURE 1
+#endif
+
+#define IR_RECV_CAP_CLK_HZ (1000000U) // capture count in us
+
 /***********************************************************
 ***********************typedef define***********************
 ***********************************************************/
@@ -410,6 +417,68 @@ static void __tdd_ir_recv_irq_timer_deinit(IR_DRV_INFO_T *drv_info)
     return;
 }
 
+#if (defined(EN_TIMER_CAPTURE) && (EN_TIMER_CAPTURE == 1))
+/**
+ * @brief pwm capture callback, one call per edge
+ *
+ * @param[in] port: pwm id
+ * @param[in] data: counts since the previous edge
+ * @param[in] arg: driver handle
+ *
+ * @return none
+ */
+static void __tdd_ir_capture_recv_cb(TUYA_PWM_NUM_E port, TUYA_PWM_CAPTURE_DATA_T data, void *arg)
+{
+    IR_DRV_INFO_T *drv_info = (IR_DRV_INFO_T *)arg;
+    uint32_t out_us = 0;
+
+    if (NULL == drv_info) {
+        return;
+    }
+
+    out_us = (uint32_t)((uint64_t)data.cap_value * 1000000U / IR_RECV_CAP_CLK_HZ);
+
+    // tdd --data--> tdl
+    if (drv_info->tdl_data.recv_value_cb) {
+        drv_info->tdl_data.recv_value_cb(drv_info, out_us, drv_info->tdl_data.handle);
+    }
+
+    return;
+}
+
+static int __tdd_ir_recv_capture_init(IR_DRV_INFO_T *drv_info)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    /* the receiver idles high, a frame starts with a falling edge */
+    TUYA_PWM_CAP_IRQ_T cap_cfg = {
+        .cap_mode      = TUYA_PWM_CAPTURE_MODE_PERIOD,
+        .trigger_level = TUYA_PWM_NEGATIVE,
+        .clk           = IR_RECV_CAP_CLK_HZ,
+        .cb            = __tdd_ir_capture_recv_cb,
+        .arg           = (void *)drv_info,
+    };
+
+    rt = tkl_pwm_cap_start(drv_info->tdd_recv.recv_pwm_id, &cap_cfg);
+    if (OPRT_OK != rt) {
+        tkl_log_output("pwm capture start err\r\n");
+    }
+
+    return rt;
+}
+
+static void __tdd_ir_recv_capture_deinit(IR_DRV_INFO_T *drv_info)
+{
+    if (drv_info->hw_cfg.recv_pin == IR_INPUT_INVALID || drv_info->tdl_data.driver_mode == IR_MODE_SEND_ONLY) {
+        return;
+    }
+
+    tkl_pwm_cap_stop(drv_info->tdd_recv.recv_pwm_id);
+
+    return;
+}
+#endif
+
 /**
  * @brief ir receive hardware init
  *
@@ -430,7 +499,9 @@ static int __tdd_ir_recv_hw_init(IR_DRV_INFO_T *drv_info)
     }
 
     if (IR_DRV_CAPTURE == drv_info->driver_type) {
-        // rt = __tdd_ir_recv_capture_init(drv_info);
+#if (defined(EN_TIMER_CAPTURE) && (EN_TIMER_CAPTURE == 1))
+        rt = __tdd_ir_recv_capture_init(drv_info);
+#endif
     } else {
         rt = __tdd_ir_recv_irq_timer_init(drv_info);
     }
@@ -453,7 +524,9 @@ static void __tdd_ir_recv_hw_deinit(IR_DRV_INFO_T *drv_info)
     }
 
     if (IR_DRV_CAPTURE == drv_info->driver_type) {
-        // __tdd_ir_recv_capture_deinit(drv_info);
+#if (defined(EN_TIMER_CAPTURE) && (EN_TIMER_CAPTURE == 1))
+        __tdd_ir_recv_capture_deinit(drv_info);
+#endif
     } else {
         __tdd_ir_recv_irq_timer_deinit(drv_info);
     }
@@ -559,7 +632,7 @@ static int __tdd_ir_pre_recv_process(IR_DRV_HANDLE_T drv_hdl)
     drv_info->tdd_recv.overflow_cnt = 0;
     drv_info->tdd_recv.is_receiving = 1;
 
-    if (drv_info->tdd_recv.irq_enable_time != 0) {
+    if (drv_info->tdd_recv.irq_enable_time != 0 && IR_DRV_CAPTURE != drv_info->driver_type) {
         tkl_timer_start(drv_info->hw_cfg.recv_timer, drv_info->tdd_recv.irq_enable_time);
     }
 
@@ -587,7 +660,7 @@ static int __tdd_ir_recv_finish_process(IR_DRV_HANDLE_T drv_hdl)
     drv_info->tdd_recv.last_time    = 0;
 
     // stop timer
-    if (drv_info->tdd_recv.irq_enable_time != 0) {
+    if (drv_info->tdd_recv.irq_enable_time != 0 && IR_DRV_CAPTURE != drv_info->driver_type) {
         tkl_timer_stop(drv_info->hw_cfg.recv_timer);
         tkl_timer_deinit(drv_info->hw_cfg.recv_timer);
     }
@@ -682,10 +755,6 @@ static int __tdd_ir_drv_open(IR_DRV_HANDLE_T drv_hdl, unsigned char mode, IR_TDL
     drv_info->tdl_data.output_finish_cb = ir_tdl_cb.output_finish_cb;
     drv_info->tdl_data.recv_value_cb    = ir_tdl_cb.recv_cb;
 
-#if EN_TIMER_CAPTURE
-    // TODO
-#endif
-
     if (IR_MODE_RECV_ONLY == mode || IR_MODE_SEND_RECV == mode) {
         drv_info->tdd_recv.is_enable = 1;
         __tdd_ir_recv_hw_deinit(drv_info);
@@ -800,6 +869,19 @@ int tdd_ir_driver_register(char *dev_name, IR_DRIVER_TYPE_E driver_type, IR_DRV_
         drv_info->send_pwm_id = tmp_pwm_id;
     }
 
+    /* receive */
+#if (defined(EN_TIMER_CAPTURE) && (EN_TIMER_CAPTURE == 1))
+    if (IR_DRV_CAPTURE == driver_type && IR_INPUT_INVALID != drv_cfg.recv_pin) {
+        int32_t tmp_pwm_id = tkl_io_pin_to_func(drv_cfg.recv_pin, TUYA_IO_TYPE_PWM);
+        PR_DEBUG("tdd ir T5 recv capture pin:%d, id: %d", drv_cfg.recv_pin, tmp_pwm_id);
+        if (OPRT_NOT_SUPPORTED == tmp_pwm_id) {
+            tal_free(drv_info);
+            return OPRT_NOT_SUPPORTED;
+        }
+        drv_info->tdd_recv.recv_pwm_id = tmp_pwm_id;
+    }
+#endif
+
     /* other */
     drv_info->driver_type = driver_type;
     memcpy(&drv_info->hw_cfg, &drv_cfg, sizeof(IR_DRV_CFG_T));
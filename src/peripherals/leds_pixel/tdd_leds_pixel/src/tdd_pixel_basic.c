@@ -12,8 +12,12 @@
  *
  */
 #include <string.h>
+#include "tuya_iot_config.h"
 
+#include "tal_log.h"
 #include "tal_memory.h"
+#include "tal_semaphore.h"
+#include "tal_system.h"
 
 #include "tdd_pixel_basic.h"
 
@@ -25,10 +29,19 @@
 /***********************************************************
 ***********************typedef define***********************
 ***********************************************************/
+typedef struct {
+    SEM_HANDLE tx_sem;
+    BOOL_T busy;
+} PIXEL_SPI_ASYNC_T;
 
 /***********************************************************
 ***********************variable define**********************
 ***********************************************************/
+static PIXEL_SPI_LUT_T *sg_pixel_spi_lut[PIXEL_SPI_LUT_NUM];
+
+#if defined(ENABLE_SPI) && (ENABLE_SPI)
+static PIXEL_SPI_ASYNC_T sg_pixel_spi_async[TUYA_SPI_NUM_MAX];
+#endif
 
 /***********************************************************
 ***********************function define**********************
@@ -55,6 +68,65 @@ void tdd_rgb_transform_spi_data(unsigned char color_data, unsigned char chip_ic_
     return;
 }
 
+/**
+ * @function:tdd_pixel_spi_lut_get
+ * @brief: Get the shared encoding table of a pair of bit codes, built on first use
+ * @param[in]   chip_ic_0           0 code
+ * @param[in]   chip_ic_1           1 code
+ * @return: the table, NULL on error
+ */
+const PIXEL_SPI_LUT_T *tdd_pixel_spi_lut_get(unsigned char chip_ic_0, unsigned char chip_ic_1)
+{
+    PIXEL_SPI_LUT_T *lut = NULL;
+    unsigned int i = 0, v = 0;
+    unsigned int bits = 0;
+
+    for (i = 0; i < PIXEL_SPI_LUT_NUM; i++) {
+        lut = sg_pixel_spi_lut[i];
+        if (lut && lut->code_0 == chip_ic_0 && lut->code_1 == chip_ic_1) {
+            return lut;
+        }
+    }
+
+    lut = (PIXEL_SPI_LUT_T *)tal_malloc(sizeof(PIXEL_SPI_LUT_T));
+    if (NULL == lut) {
+        return NULL;
+    }
+    lut->code_0 = chip_ic_0;
+    lut->code_1 = chip_ic_1;
+
+    bits = sizeof(lut->pattern[0]);
+    for (v = 0; v < sizeof(lut->pattern) / bits; v++) {
+        for (i = 0; i < bits; i++) {
+            lut->pattern[v][i] = (v & (1 << (bits - 1 - i))) ? chip_ic_1 : chip_ic_0;
+        }
+    }
+
+    /* drivers open from their own tasks, recheck the slots before taking one */
+    TAL_ENTER_CRITICAL();
+    for (i = 0; i < PIXEL_SPI_LUT_NUM; i++) {
+        PIXEL_SPI_LUT_T *slot = sg_pixel_spi_lut[i];
+        if (NULL == slot) {
+            sg_pixel_spi_lut[i] = lut;
+            break;
+        }
+        if (slot->code_0 == chip_ic_0 && slot->code_1 == chip_ic_1) {
+            TAL_EXIT_CRITICAL();
+            tal_free(lut);
+            return slot;
+        }
+    }
+    TAL_EXIT_CRITICAL();
+
+    if (i >= PIXEL_SPI_LUT_NUM) {
+        PR_ERR("no spi lut slot for %02x/%02x", chip_ic_0, chip_ic_1);
+        tal_free(lut);
+        return NULL;
+    }
+
+    return lut;
+}
+
 /**
  * @brief        Adjust color line sequence
  *
@@ -159,6 +231,168 @@ OPERATE_RET tdd_pixel_tx_ctrl_release(DRV_PIXEL_TX_CTRL_T *tx_ctrl)
     return OPRT_OK;
 }
 
+/**
+ * @function:tdd_pixel_create_tx_dbuf
+ * @brief: Create two buffers of one frame and its reset gap each
+ * @param[in]   data_len            SPI data length of one frame
+ * @param[in]   reset_len           zero bytes after the frame
+ * @param[out]  p_pixel_tx          the point of DRV_PIXEL_TX_CTRL_T
+ * @return: success -> OPRT_OK
+ */
+OPERATE_RET tdd_pixel_create_tx_dbuf(unsigned int data_len, unsigned int reset_len, DRV_PIXEL_TX_CTRL_T **p_pixel_tx)
+{
+    OPERATE_RET op_ret = OPRT_OK;
+
+    if (0 == data_len || NULL == p_pixel_tx) {
+        return OPRT_INVALID_PARM;
+    }
+
+    op_ret = tdd_pixel_create_tx_ctrl(2 * (data_len + reset_len), p_pixel_tx);
+    if (op_ret != OPRT_OK) {
+        return op_ret;
+    }
+    (*p_pixel_tx)->frame_len = data_len + reset_len;
+
+    return OPRT_OK;
+}
+
+/**
+ * @function:tdd_pixel_tx_back_buffer
+ * @brief: Get the buffer the next frame is encoded into
+ * @param[in]   tx_ctrl             the point of DRV_PIXEL_TX_CTRL_T
+ * @return: the back half, or the whole buffer when single buffered
+ */
+unsigned char *tdd_pixel_tx_back_buffer(DRV_PIXEL_TX_CTRL_T *tx_ctrl)
+{
+    if (0 == tx_ctrl->frame_len) {
+        return tx_ctrl->tx_buffer;
+    }
+
+    return tx_ctrl->tx_buffer + tx_ctrl->back * tx_ctrl->frame_len;
+}
+
+#if defined(ENABLE_SPI) && (ENABLE_SPI)
+static void __pixel_spi_isr_cb(TUYA_SPI_NUM_E port, TUYA_SPI_IRQ_EVT_E event)
+{
+    if (TUYA_SPI_EVENT_TX_COMPLETE == event && sg_pixel_spi_async[port].tx_sem) {
+        tal_semaphore_post(sg_pixel_spi_async[port].tx_sem);
+    }
+}
+
+static OPERATE_RET __pixel_spi_async_wait(TUYA_SPI_NUM_E port)
+{
+    OPERATE_RET op_ret = OPRT_OK;
+
+    if (FALSE == sg_pixel_spi_async[port].busy) {
+        return OPRT_OK;
+    }
+
+    op_ret = tal_semaphore_wait(sg_pixel_spi_async[port].tx_sem, PIXEL_SPI_TX_TIMEOUT_MS);
+    sg_pixel_spi_async[port].busy = FALSE;
+    if (op_ret != OPRT_OK) {
+        PR_ERR("spi%d tx timeout", port);
+    }
+
+    return op_ret;
+}
+
+/**
+ * @function:tdd_pixel_spi_async_init
+ * @brief: Enable the completion interrupt, sends then return while the DMA runs
+ * @param[in]   port                SPI port
+ * @return: success -> OPRT_OK, else sends stay blocking
+ */
+OPERATE_RET tdd_pixel_spi_async_init(TUYA_SPI_NUM_E port)
+{
+    OPERATE_RET op_ret = OPRT_OK;
+    PIXEL_SPI_ASYNC_T *async = NULL;
+
+    if (port >= TUYA_SPI_NUM_MAX) {
+        return OPRT_INVALID_PARM;
+    }
+    async = &sg_pixel_spi_async[port];
+
+    if (NULL == async->tx_sem) {
+        op_ret = tal_semaphore_create_init(&async->tx_sem, 0, 1);
+        if (op_ret != OPRT_OK) {
+            return op_ret;
+        }
+    }
+    async->busy = FALSE;
+
+    op_ret = tkl_spi_irq_init(port, __pixel_spi_isr_cb);
+    if (op_ret == OPRT_OK) {
+        op_ret = tkl_spi_irq_enable(port);
+    }
+    if (op_ret != OPRT_OK) {
+        tal_semaphore_release(async->tx_sem);
+        async->tx_sem = NULL;
+    }
+
+    return op_ret;
+}
+
+/**
+ * @function:tdd_pixel_spi_async_send
+ * @brief: Wait for the previous frame, start the back buffer and swap the halves
+ * @param[in]   port                SPI port
+ * @param[in]   tx_ctrl             the point of DRV_PIXEL_TX_CTRL_T
+ * @return: success -> OPRT_OK
+ */
+OPERATE_RET tdd_pixel_spi_async_send(TUYA_SPI_NUM_E port, DRV_PIXEL_TX_CTRL_T *tx_ctrl)
+{
+    OPERATE_RET op_ret = OPRT_OK;
+    PIXEL_SPI_ASYNC_T *async = NULL;
+    unsigned int len = 0;
+
+    if (port >= TUYA_SPI_NUM_MAX || NULL == tx_ctrl) {
+        return OPRT_INVALID_PARM;
+    }
+    async = &sg_pixel_spi_async[port];
+    len = tx_ctrl->frame_len ? tx_ctrl->frame_len : tx_ctrl->tx_buffer_len;
+
+    if (NULL == async->tx_sem) {
+        // no completion interrupt, tkl_spi_send() blocks until the frame is out
+        op_ret = tkl_spi_send(port, tdd_pixel_tx_back_buffer(tx_ctrl), len);
+    } else {
+        // a timed out frame is given up, the next one is sent anyway
+        __pixel_spi_async_wait(port);
+        op_ret = tkl_spi_send(port, tdd_pixel_tx_back_buffer(tx_ctrl), len);
+        async->busy = (op_ret == OPRT_OK) ? TRUE : FALSE;
+    }
+
+    if (tx_ctrl->frame_len) {
+        tx_ctrl->back ^= 1;
+    }
+
+    return op_ret;
+}
+
+/**
+ * @function:tdd_pixel_spi_async_deinit
+ * @brief: Wait for the last frame and release the completion interrupt
+ * @param[in]   port                SPI port
+ * @return: none
+ */
+void tdd_pixel_spi_async_deinit(TUYA_SPI_NUM_E port)
+{
+    PIXEL_SPI_ASYNC_T *async = NULL;
+
+    if (port >= TUYA_SPI_NUM_MAX) {
+        return;
+    }
+    async = &sg_pixel_spi_async[port];
+    if (NULL == async->tx_sem) {
+        return;
+    }
+
+    __pixel_spi_async_wait(port);
+    tkl_spi_irq_disable(port);
+    tal_semaphore_release(async->tx_sem);
+    async->tx_sem = NULL;
+}
+#endif
+
 /**
  * @brief      BK platform SPI driver for colorful LED strips requires special handling, this interface is implemented
  * here for cross-platform compatibility
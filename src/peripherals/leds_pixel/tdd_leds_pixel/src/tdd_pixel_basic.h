@@ -14,6 +14,7 @@
 #ifndef __TDD_PIXEL_BASIC_H__
 #define __TDD_PIXEL_BASIC_H__
 
+#include <string.h>
 #include "tdd_pixel_type.h"
 
 #ifdef __cplusplus
@@ -25,6 +26,24 @@ extern "C" {
 ***********************************************************/
 #define ONE_BYTE_LEN 8
 
+/* Zero bytes that hold the line low for reset_us at spi_hz, rounded up */
+#define PIXEL_SPI_RESET_BYTES(spi_hz, reset_us) ((unsigned int)(((spi_hz) / 1000) * (reset_us) / 8000 + 1))
+
+/* Encode with a 16 entry nibble table (64 bytes) instead of the 256 entry byte table (2 KB) */
+#ifndef PIXEL_SPI_LUT_NIBBLE
+#define PIXEL_SPI_LUT_NIBBLE 0
+#endif
+
+/* Tables kept at once, one per pair of 0/1 codes in use */
+#ifndef PIXEL_SPI_LUT_NUM
+#define PIXEL_SPI_LUT_NUM 2
+#endif
+
+/* Longest wait for the previous frame to shift out */
+#ifndef PIXEL_SPI_TX_TIMEOUT_MS
+#define PIXEL_SPI_TX_TIMEOUT_MS 100
+#endif
+
 /***********************************************************
 ****************************typedef define****************************
 *********************************************************************/
@@ -32,8 +51,21 @@ extern "C" {
 typedef struct {
     unsigned char *tx_buffer;   // Data -> buffer after data stream is converted to SPI data
     unsigned int tx_buffer_len; // Data length -> length of buffer after data stream is converted to SPI data
+    unsigned int frame_len;     // Double buffered -> one half, the frame and its reset gap, else 0
+    unsigned char back;         // Double buffered -> the half encoded next, the other may be shifting out
 } DRV_PIXEL_TX_CTRL_T;
 
+/* SPI bytes of every color value, one byte per color bit, MSB first */
+typedef struct {
+    unsigned char code_0;
+    unsigned char code_1;
+#if PIXEL_SPI_LUT_NIBBLE
+    unsigned char pattern[16][ONE_BYTE_LEN / 2];
+#else
+    unsigned char pattern[256][ONE_BYTE_LEN];
+#endif
+} PIXEL_SPI_LUT_T;
+
 /***********************************************************
 ****************************function define***************************
 ***********************************************************/
@@ -50,6 +82,36 @@ typedef struct {
 void tdd_rgb_transform_spi_data(unsigned char color_data, unsigned char chip_ic_0, unsigned char chip_ic_1,
                                 unsigned char *spi_data_buf);
 
+/**
+ * @brief       Get the encoding table of a pair of bit codes, built on first use
+ *
+ * @param[in]   chip_ic_0           Bit 0 code
+ * @param[in]   chip_ic_1           Bit 1 code
+ *
+ * @return the shared table, NULL when out of memory or all PIXEL_SPI_LUT_NUM are taken
+ */
+const PIXEL_SPI_LUT_T *tdd_pixel_spi_lut_get(unsigned char chip_ic_0, unsigned char chip_ic_1);
+
+/**
+ * @brief       Color to SPI data with a table from tdd_pixel_spi_lut_get()
+ *
+ * @param[in]   lut                 Encoding table
+ * @param[in]   color_data          Color data
+ * @param[out]  spi_data_buf        ONE_BYTE_LEN bytes of SPI data
+ *
+ * @return none
+ */
+static inline void tdd_pixel_spi_lut_encode(const PIXEL_SPI_LUT_T *lut, unsigned char color_data,
+                                            unsigned char *spi_data_buf)
+{
+#if PIXEL_SPI_LUT_NIBBLE
+    memcpy(spi_data_buf, lut->pattern[color_data >> 4], ONE_BYTE_LEN / 2);
+    memcpy(spi_data_buf + ONE_BYTE_LEN / 2, lut->pattern[color_data & 0x0F], ONE_BYTE_LEN / 2);
+#else
+    memcpy(spi_data_buf, lut->pattern[color_data], ONE_BYTE_LEN);
+#endif
+}
+
 /**
  * @brief        Exchange color data
  *
@@ -80,6 +142,60 @@ OPERATE_RET tdd_pixel_create_tx_ctrl(unsigned int tx_buff_len, DRV_PIXEL_TX_CTRL
  */
 OPERATE_RET tdd_pixel_tx_ctrl_release(IN DRV_PIXEL_TX_CTRL_T *tx_ctrl);
 
+/**
+ * @brief      Create two transmission buffers, each a frame followed by its reset gap
+ *
+ * The gap bytes stay zero, so every frame sent ends with the line held low
+ * for the reset time and no delay is needed before the next one.
+ *
+ * @param[in]   data_len             SPI data length of one frame
+ * @param[in]   reset_len            Zero bytes after the frame, see PIXEL_SPI_RESET_BYTES()
+ * @param[out]  p_pixel_tx           Pixel transmission control parameter
+ *
+ * @return OPRT_OK on success. Others on error, please refer to tuya_error_code.h
+ */
+OPERATE_RET tdd_pixel_create_tx_dbuf(unsigned int data_len, unsigned int reset_len, DRV_PIXEL_TX_CTRL_T **p_pixel_tx);
+
+/**
+ * @brief      Get the buffer the next frame is encoded into
+ *
+ * @param[in]   tx_ctrl              Transmission control parameter
+ *
+ * @return the back half when double buffered, else the whole buffer
+ */
+unsigned char *tdd_pixel_tx_back_buffer(DRV_PIXEL_TX_CTRL_T *tx_ctrl);
+
+#if defined(ENABLE_SPI) && (ENABLE_SPI)
+/**
+ * @brief      Let tdd_pixel_spi_async_send() return while the DMA shifts out
+ *
+ * @param[in]   port                 SPI port, already initialized with DMA
+ *
+ * @return OPRT_OK on success, an error when the port has no completion
+ * interrupt and sends stay blocking
+ */
+OPERATE_RET tdd_pixel_spi_async_init(TUYA_SPI_NUM_E port);
+
+/**
+ * @brief      Wait for the previous frame, then start the back buffer and swap
+ *
+ * @param[in]   port                 SPI port
+ * @param[in]   tx_ctrl              Transmission control parameter from tdd_pixel_create_tx_dbuf()
+ *
+ * @return OPRT_OK on success. Others on error, please refer to tuya_error_code.h
+ */
+OPERATE_RET tdd_pixel_spi_async_send(TUYA_SPI_NUM_E port, DRV_PIXEL_TX_CTRL_T *tx_ctrl);
+
+/**
+ * @brief      Wait for the last frame and release the completion interrupt
+ *
+ * @param[in]   port                 SPI port
+ *
+ * @return none
+ */
+void tdd_pixel_spi_async_deinit(TUYA_SPI_NUM_E port);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -42,6 +42,7 @@
 ****************************variable define***************************
 *********************************************************************/
 static PIXEL_DRIVER_CONFIG_T driver_info;
+static const PIXEL_SPI_LUT_T *sg_spi_lut = NULL;
 /*********************************************************************
 ****************************function define***************************
 *********************************************************************/
@@ -62,6 +63,12 @@ OPERATE_RET tdd_2812_driver_open(OUT DRIVER_HANDLE_T *handle, unsigned short pix
     if (NULL == handle || (0 == pixel_num)) {
         return OPRT_INVALID_PARM;
     }
+
+    sg_spi_lut = tdd_pixel_spi_lut_get(DRVICE_DATA_0, DRVICE_DATA_1);
+    if (NULL == sg_spi_lut) {
+        return OPRT_MALLOC_FAILED;
+    }
+
     extern void tkl_spi_set_spic_flag(void);
     tkl_spi_set_spic_flag();
     spi_cfg.role = TUYA_SPI_ROLE_MASTER;
@@ -112,8 +119,7 @@ OPERATE_RET tdd_ws2812_driver_send_data(DRIVER_HANDLE_T handle, unsigned short *
         memset(swap_buf, 0, sizeof(swap_buf));
         tdd_rgb_line_seq_transform(&data_buf[j * COLOR_PRIMARY_NUM], swap_buf, driver_info.line_seq);
         for (i = 0; i < COLOR_PRIMARY_NUM; i++) {
-            tdd_rgb_transform_spi_data((unsigned char)swap_buf[i], DRVICE_DATA_0, DRVICE_DATA_1,
-                                       &tx_ctrl->tx_buffer[idx]);
+            tdd_pixel_spi_lut_encode(sg_spi_lut, (unsigned char)swap_buf[i], &tx_ctrl->tx_buffer[idx]);
             idx += ONE_BYTE_LEN;
         }
     }
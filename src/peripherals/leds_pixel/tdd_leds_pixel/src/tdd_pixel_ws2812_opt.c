@@ -36,6 +36,11 @@
 
 #define COLOR_PRIMARY_NUM 3
 #define COLOR_RESOLUTION  255
+
+/* Low time that latches a frame, 300us also covers the newer parts that need more than 280us */
+#ifndef WS2812_RESET_US
+#define WS2812_RESET_US 300
+#endif
 /*********************************************************************
 ****************************typedef define****************************
 *********************************************************************/
@@ -44,6 +49,7 @@
 ****************************variable define***************************
 *********************************************************************/
 static PIXEL_DRIVER_CONFIG_T driver_info;
+static const PIXEL_SPI_LUT_T *sg_spi_lut = NULL;
 static PIXEL_PWM_CFG_T *g_pwm_cfg = NULL;
 /*********************************************************************
 ****************************function define***************************
@@ -65,6 +71,12 @@ static OPERATE_RET __tdd_2812_driver_open(DRIVER_HANDLE_T *handle, unsigned shor
     if (NULL == handle || (0 == pixel_num)) {
         return OPRT_INVALID_PARM;
     }
+
+    sg_spi_lut = tdd_pixel_spi_lut_get(DRVICE_DATA_0, DRVICE_DATA_1);
+    if (NULL == sg_spi_lut) {
+        return OPRT_MALLOC_FAILED;
+    }
+
     extern void tkl_spi_set_spic_flag(void);
     tkl_spi_set_spic_flag();
     spi_cfg.role = TUYA_SPI_ROLE_MASTER;
@@ -80,11 +92,16 @@ static OPERATE_RET __tdd_2812_driver_open(DRIVER_HANDLE_T *handle, unsigned shor
     }
 
     tx_buf_len = ONE_BYTE_LEN * COLOR_PRIMARY_NUM * pixel_num;
-    op_ret = tdd_pixel_create_tx_ctrl(tx_buf_len, &pixels_send);
+    /* the trailing zeros are the reset gap, frames go out back to back without a delay */
+    op_ret = tdd_pixel_create_tx_dbuf(tx_buf_len, PIXEL_SPI_RESET_BYTES(DRV_SPI_SPEED, WS2812_RESET_US), &pixels_send);
     if (op_ret != OPRT_OK) {
         return op_ret;
     }
 
+    if (OPRT_OK != tdd_pixel_spi_async_init(driver_info.port)) {
+        PR_NOTICE("spi%d no tx irq, send blocking", driver_info.port);
+    }
+
     if (NULL != g_pwm_cfg) {
       op_ret = tdd_pixel_pwm_open(g_pwm_cfg);
       if (op_ret != OPRT_OK) {
@@ -112,6 +129,7 @@ static OPERATE_RET __tdd_ws2812_driver_send_data(DRIVER_HANDLE_T handle, unsigne
     unsigned short swap_buf[COLOR_PRIMARY_NUM] = {0};
     unsigned int i = 0, j = 0, idx = 0;
     unsigned char color_nums = COLOR_PRIMARY_NUM;
+    unsigned char *tx_buf = NULL;
 
     if (NULL == handle || NULL == data_buf || 0 == buf_len) {
         return OPRT_INVALID_PARM;
@@ -131,17 +149,18 @@ static OPERATE_RET __tdd_ws2812_driver_send_data(DRIVER_HANDLE_T handle, unsigne
     }
 
     tx_ctrl = (DRV_PIXEL_TX_CTRL_T *)handle;
+    tx_buf = tdd_pixel_tx_back_buffer(tx_ctrl);
     for (j = 0; j < buf_len / color_nums; j++) {
         memset(swap_buf, 0, sizeof(swap_buf));
         tdd_rgb_line_seq_transform(&data_buf[j * color_nums], swap_buf, driver_info.line_seq);
         for (i = 0; i < COLOR_PRIMARY_NUM; i++) {
-            tdd_rgb_transform_spi_data((unsigned char)swap_buf[i], DRVICE_DATA_0, DRVICE_DATA_1,
-                                       &tx_ctrl->tx_buffer[idx]);
+            tdd_pixel_spi_lut_encode(sg_spi_lut, (unsigned char)swap_buf[i], &tx_buf[idx]);
             idx += ONE_BYTE_LEN;
         }
     }
 
-    ret = tkl_spi_send(driver_info.port, tx_ctrl->tx_buffer, tx_ctrl->tx_buffer_len);
+    /* returns once the previous frame is out, this one shifts out while the caller renders the next */
+    ret = tdd_pixel_spi_async_send(driver_info.port, tx_ctrl);
 
     return ret;
 }
@@ -163,6 +182,7 @@ static OPERATE_RET __tdd_ws2812_driver_close(DRIVER_HANDLE_T *handle)
 
     tx_ctrl = (DRV_PIXEL_TX_CTRL_T *)(*handle);
 
+    tdd_pixel_spi_async_deinit(driver_info.port);
     ret = tkl_spi_deinit(driver_info.port);
     if (ret != OPRT_OK) {
         PR_ERR("spi deinit err:%d", ret);
@@ -240,6 +260,7 @@ OPERATE_RET tdd_ws2812_opt_driver_register(char *driver_name, PIXEL_DRIVER_CONFI
     arrt.color_tp = PIXEL_COLOR_TP_RGB;
     arrt.color_maximum = COLOR_RESOLUTION;
     arrt.white_color_control = FALSE;
+    arrt.reset_in_output = TRUE;
 
     if (NULL != pwm_cfg) {
         g_pwm_cfg = (PIXEL_PWM_CFG_T *)tal_malloc(SIZEOF(PIXEL_PWM_CFG_T));
@@ -36,6 +36,11 @@ typedef unsigned int PIXEL_M_SHIFT_DIR_T;
 #define PIXEL_SHIFT_CLOSE 0 // Towards each other
 #define PIXEL_SHIFT_FAR   1 // Away from each other
 
+typedef unsigned int PIXEL_FRAME_ORDER_T;
+#define PIXEL_FRAME_RGB 0 // Frame bytes R, G, B
+#define PIXEL_FRAME_GRB 1 // Frame bytes G, R, B
+#define PIXEL_FRAME_BGR 2 // Frame bytes B, G, R
+
 /*********************************************************************
 ****************************function define***************************
 *********************************************************************/
@@ -139,6 +144,34 @@ int tdl_pixel_copy_color(PIXEL_HANDLE_T handle, uint32_t dst_idx, uint32_t src_i
  */
 int tdl_pixel_set_single_color_all(PIXEL_HANDLE_T handle, PIXEL_COLOR_T *color);
 
+/**
+ * @brief    Set the gamma and brightness applied by tdl_pixel_set_frame()
+ *
+ * @param[in]    handle           Device handle
+ * @param[in]    gamma_x100       Gamma x 100, 100 is linear, 220 the usual LED curve
+ * @param[in]    brightness       Brightness, 255 is full
+ *
+ * @return OPRT_OK on success. Others on error, please refer to tuya_error_code.h
+ */
+int tdl_pixel_set_frame_gamma(PIXEL_HANDLE_T handle, uint16_t gamma_x100, uint8_t brightness);
+
+/**
+ * @brief    Set a pixel segment from an RGB888 frame in one pass
+ *
+ * Every byte goes through one table built by tdl_pixel_set_frame_gamma(),
+ * linear and full brightness by default. Cold and warm channels are kept.
+ *
+ * @param[in]    handle           Device handle
+ * @param[in]    index_start      Start index of the pixel
+ * @param[in]    pixel_num        Length of the pixel segment
+ * @param[in]    frame            pixel_num x 3 bytes
+ * @param[in]    order            Byte order of the frame
+ *
+ * @return OPRT_OK on success. Others on error, please refer to tuya_error_code.h
+ */
+int tdl_pixel_set_frame(PIXEL_HANDLE_T handle, uint32_t index_start, uint32_t pixel_num, const uint8_t *frame,
+                        PIXEL_FRAME_ORDER_T order);
+
 /**
  * @brief    Set only the white color, not the colored light
  *
@@ -53,6 +53,7 @@ typedef struct {
     PIXEL_COLOR_TP_E color_tp;
     unsigned int color_maximum;
     BOOL_T white_color_control; // Independent White Light and Color Light Control
+    BOOL_T reset_in_output;     // output() ends each frame with the reset gap, no delay between frames
 } PIXEL_ATTR_T;
 
 /***********************************************************
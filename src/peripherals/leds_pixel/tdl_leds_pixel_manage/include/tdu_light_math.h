@@ -0,0 +1,158 @@
+/**
+ * @file tdu_light_math.h
+ * @brief Fast math for per pixel and per voxel effect code.
+ *
+ * Angles are binary, 65536 per turn, so wrapping is free. Sine and cosine
+ * are table lookups returning q16, with float wrappers taking radians for
+ * existing float code. A q16 rotation matrix is built once per frame from
+ * three angles and applied with integer multiplies. tdu_light_sqrtf() and
+ * tdu_light_inv_sqrtf() are accurate to about 0.2%, plenty for brightness
+ * and distance falloffs but not for anything that accumulates.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#ifndef __TDU_LIGHT_MATH_H__
+#define __TDU_LIGHT_MATH_H__
+
+#include <string.h>
+#include "tuya_cloud_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+#define TDU_LIGHT_Q16_ONE        65536
+#define TDU_LIGHT_ANGLE_QUARTER  0x4000u
+#define TDU_LIGHT_ANGLE_HALF     0x8000u
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef struct {
+    int32_t m[3][3]; // q16
+} TDU_LIGHT_ROT_Q16_T;
+
+/***********************************************************
+********************function declaration********************
+***********************************************************/
+/**
+ * @brief sine of a binary angle
+ *
+ * @param[in] angle 65536 per turn
+ *
+ * @return sin(angle) in q16
+ */
+int32_t tdu_light_sin_q16(uint16_t angle);
+
+/**
+ * @brief cosine of a binary angle
+ *
+ * @param[in] angle 65536 per turn
+ *
+ * @return cos(angle) in q16
+ */
+int32_t tdu_light_cos_q16(uint16_t angle);
+
+/**
+ * @brief convert radians to a binary angle, any value wraps to one turn
+ *
+ * @param[in] rad angle in radians
+ *
+ * @return angle, 65536 per turn
+ */
+uint16_t tdu_light_rad_to_angle(float rad);
+
+/**
+ * @brief table based sinf()
+ *
+ * @param[in] rad angle in radians
+ *
+ * @return sin(rad)
+ */
+float tdu_light_sinf(float rad);
+
+/**
+ * @brief table based cosf()
+ *
+ * @param[in] rad angle in radians
+ *
+ * @return cos(rad)
+ */
+float tdu_light_cosf(float rad);
+
+/**
+ * @brief polynomial atan2f(), within 1e-4 rad
+ *
+ * @param[in] y y coordinate
+ * @param[in] x x coordinate
+ *
+ * @return angle of (x, y) in -pi..pi, 0 for the origin
+ */
+float tdu_light_atan2f(float y, float x);
+
+/**
+ * @brief build the q16 rotation R = Rz * Ry * Rx
+ *
+ * @param[out] rot the matrix
+ * @param[in] ax rotation about x, 65536 per turn
+ * @param[in] ay rotation about y
+ * @param[in] az rotation about z
+ */
+void tdu_light_rot_q16_set(TDU_LIGHT_ROT_Q16_T *rot, uint16_t ax, uint16_t ay, uint16_t az);
+
+/**
+ * @brief rotate a fixed point vector, out is in the format of in
+ *
+ * @param[in] rot the matrix
+ * @param[in] in x, y, z
+ * @param[out] out rotated x, y, z, must not alias in
+ */
+static inline void tdu_light_rot_q16_apply(const TDU_LIGHT_ROT_Q16_T *rot, const int32_t in[3], int32_t out[3])
+{
+    for (uint32_t i = 0; i < 3; i++) {
+        out[i] = (int32_t)(((int64_t)rot->m[i][0] * in[0] + (int64_t)rot->m[i][1] * in[1] +
+                            (int64_t)rot->m[i][2] * in[2]) >> 16);
+    }
+}
+
+/**
+ * @brief bit trick 1 / sqrt(x) with one Newton step
+ *
+ * @param[in] x a positive value
+ *
+ * @return about 1 / sqrt(x)
+ */
+static inline float tdu_light_inv_sqrtf(float x)
+{
+    uint32_t bits = 0;
+    float y = 0.0f;
+
+    memcpy(&bits, &x, sizeof(bits));
+    bits = 0x5F3759DFu - (bits >> 1);
+    memcpy(&y, &bits, sizeof(y));
+
+    return y * (1.5f - 0.5f * x * y * y);
+}
+
+/**
+ * @brief sqrt(x) as x / sqrt(x)
+ *
+ * @param[in] x the value
+ *
+ * @return about sqrt(x), 0 for x <= 0
+ */
+static inline float tdu_light_sqrtf(float x)
+{
+    return (x > 0.0f) ? x * tdu_light_inv_sqrtf(x) : 0.0f;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TDU_LIGHT_MATH_H__ */
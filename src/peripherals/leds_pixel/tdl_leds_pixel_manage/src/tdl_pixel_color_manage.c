@@ -26,6 +26,8 @@
 /***********************************************************
 *************************micro define***********************
 ***********************************************************/
+#define PIXEL_FRAME_LUT_SIZE 256
+#define PIXEL_Q16_ONE        0x10000u
 
 /***********************************************************
 ***********************function define**********************
@@ -161,6 +163,71 @@ static void __tdl_pixel_get_color(PIXEL_HANDLE_T handle, uint16_t *buff, PIXEL_C
     return;
 }
 
+static uint32_t __tdl_pixel_isqrt(uint64_t value)
+{
+    uint64_t root = 0, bit = 1ull << 62;
+
+    while (bit > value) {
+        bit >>= 2;
+    }
+    while (bit) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    return (uint32_t)root;
+}
+
+/* x^(gamma_x100 / 100) in Q16 without libm, the fraction is taken to 1/16 through square roots */
+static uint32_t __tdl_pixel_gamma_q16(uint32_t x_q16, uint16_t gamma_x100)
+{
+    uint32_t result = PIXEL_Q16_ONE, root = x_q16;
+    uint32_t frac = ((gamma_x100 % 100) * 16 + 50) / 100;
+    uint32_t i = 0;
+
+    for (i = 0; i < gamma_x100 / 100; i++) {
+        result = (uint32_t)(((uint64_t)result * x_q16) >> 16);
+    }
+    if (frac >= 16) {
+        result = (uint32_t)(((uint64_t)result * x_q16) >> 16);
+        frac = 0;
+    }
+    for (i = 0; i < 4; i++) {
+        root = __tdl_pixel_isqrt((uint64_t)root << 16);
+        if (frac & (8 >> i)) {
+            result = (uint32_t)(((uint64_t)result * root) >> 16);
+        }
+    }
+
+    return result;
+}
+
+static OPERATE_RET __tdl_pixel_frame_lut_build(PIXEL_DEV_NODE_T *device, uint16_t gamma_x100, uint8_t brightness)
+{
+    uint32_t i = 0;
+    uint64_t scale = (uint64_t)device->color_maximum * brightness;
+
+    if (NULL == device->frame_lut) {
+        device->frame_lut = (uint16_t *)tal_malloc(PIXEL_FRAME_LUT_SIZE * sizeof(uint16_t));
+        if (NULL == device->frame_lut) {
+            return OPRT_MALLOC_FAILED;
+        }
+    }
+
+    for (i = 0; i < PIXEL_FRAME_LUT_SIZE; i++) {
+        uint32_t x_q16 = (uint32_t)(((uint64_t)i * PIXEL_Q16_ONE + 127) / 255);
+        uint32_t level = __tdl_pixel_gamma_q16(x_q16, gamma_x100);
+        device->frame_lut[i] = (uint16_t)(((uint64_t)level * scale / 255 + (PIXEL_Q16_ONE >> 1)) >> 16);
+    }
+
+    return OPRT_OK;
+}
+
 static OPERATE_RET __tdl_pixel_right_shift(uint16_t *buff, uint8_t color_num, int32_t start, int32_t end, int32_t step)
 {
     int32_t i, temp_len = 0, rang_size = 0;
@@ -512,6 +579,96 @@ int tdl_pixel_set_single_color_all(PIXEL_HANDLE_T handle, PIXEL_COLOR_T *color)
     return OPRT_OK;
 }
 
+/**
+ * @brief    Set the gamma and brightness applied by tdl_pixel_set_frame()
+ *
+ * @param[in]    handle           Device handle
+ * @param[in]    gamma_x100       Gamma x 100, 100 is linear
+ * @param[in]    brightness       Brightness, 255 is full
+ *
+ * @return OPRT_OK on success. Others on error, please refer to tuya_error_code.h
+ */
+int tdl_pixel_set_frame_gamma(PIXEL_HANDLE_T handle, uint16_t gamma_x100, uint8_t brightness)
+{
+    PIXEL_DEV_NODE_T *device = (PIXEL_DEV_NODE_T *)handle;
+    OPERATE_RET op_ret = OPRT_OK;
+
+    if (NULL == handle || 0 == gamma_x100) {
+        return OPRT_INVALID_PARM;
+    }
+
+    tal_mutex_lock(device->mutex);
+    op_ret = __tdl_pixel_frame_lut_build(device, gamma_x100, brightness);
+    tal_mutex_unlock(device->mutex);
+
+    return op_ret;
+}
+
+/**
+ * @brief    Set a pixel segment from an RGB888 frame in one pass
+ *
+ * @param[in]    handle           Device handle
+ * @param[in]    index_start      Pixel start index
+ * @param[in]    pixel_num        Pixel segment length
+ * @param[in]    frame            pixel_num x 3 bytes
+ * @param[in]    order            Byte order of the frame
+ *
+ * @return OPRT_OK on success. Others on error, please refer to tuya_error_code.h
+ */
+int tdl_pixel_set_frame(PIXEL_HANDLE_T handle, uint32_t index_start, uint32_t pixel_num, const uint8_t *frame,
+                        PIXEL_FRAME_ORDER_T order)
+{
+    PIXEL_DEV_NODE_T *device = (PIXEL_DEV_NODE_T *)handle;
+    OPERATE_RET op_ret = OPRT_OK;
+    uint8_t r_off = 0, g_off = 1, b_off = 2;
+    const uint16_t *lut = NULL;
+    uint16_t *dst = NULL;
+    uint32_t i = 0;
+
+    if (NULL == handle || NULL == frame || order > PIXEL_FRAME_BGR) {
+        return OPRT_INVALID_PARM;
+    }
+
+    if (0 == device->flag.is_start) {
+        return OPRT_COM_ERROR;
+    }
+
+    if (index_start >= device->pixel_num || index_start + pixel_num > device->pixel_num) {
+        return OPRT_INVALID_PARM;
+    }
+
+    if (PIXEL_FRAME_GRB == order) {
+        r_off = 1;
+        g_off = 0;
+    } else if (PIXEL_FRAME_BGR == order) {
+        r_off = 2;
+        b_off = 0;
+    }
+
+    tal_mutex_lock(device->mutex);
+    if (NULL == device->frame_lut) {
+        op_ret = __tdl_pixel_frame_lut_build(device, 100, 255);
+        if (op_ret != OPRT_OK) {
+            tal_mutex_unlock(device->mutex);
+            return op_ret;
+        }
+    }
+
+    /* the channel order of the chip is applied by the driver, the buffer is R, G, B [, C, W] */
+    lut = device->frame_lut;
+    dst = device->pixel_buffer + device->color_num * index_start;
+    for (i = 0; i < pixel_num; i++) {
+        dst[0] = lut[frame[r_off]];
+        dst[1] = lut[frame[g_off]];
+        dst[2] = lut[frame[b_off]];
+        frame += 3;
+        dst += device->color_num;
+    }
+    tal_mutex_unlock(device->mutex);
+
+    return OPRT_OK;
+}
+
 /**
  * @brief    Set only white light color, not color light
  *
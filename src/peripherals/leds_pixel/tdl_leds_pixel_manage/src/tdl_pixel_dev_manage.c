@@ -92,6 +92,7 @@ static int __tdl_pixel_dev_register(IN char *driver_name, IN PIXEL_DRIVER_INTFS_
     device->pixel_color = arrt->color_tp;
     device->color_maximum = arrt->color_maximum;
     device->white_color_control = arrt->white_color_control;
+    device->reset_in_output = arrt->reset_in_output;
 
     device->intfs = (PIXEL_DRIVER_INTFS_T *)tal_malloc(sizeof(PIXEL_DRIVER_INTFS_T));
     if (NULL == device->intfs) {
@@ -190,9 +191,12 @@ static int __tdl_pixel_refresh(PIXEL_DEV_NODE_T *device)
         recognized by hardware as one frame, add delay processing. WS2812 requires frame interval 
         >50us. To ensure portability of delay code, system interface is called here. Due to BK 
         platform system heartbeat being 2ms, 1ms setting is invalid, so 4ms delay is set here. 
-        2ms cannot solve the problem due to task scheduling and other reasons.
+        2ms cannot solve the problem due to task scheduling and other reasons. Drivers that end
+        every frame with the reset gap need no delay.
     */
-    tal_system_sleep(4);
+    if (!device->reset_in_output) {
+        tal_system_sleep(4);
+    }
 
     return op_ret;
 }
@@ -54,6 +54,8 @@ typedef struct pixel_dev_list {
     uint32_t color_maximum;
     DRIVER_HANDLE_T drv_handle;
     BOOL_T white_color_control; // Independent White Light and Color Light Control
+    BOOL_T reset_in_output;     // Driver sends the reset gap itself
+    uint16_t *frame_lut;        // RGB888 byte -> channel value with gamma and brightness, 256 entries
     PIXEL_DRIVER_INTFS_T *intfs;
 
 } PIXEL_DEV_NODE_T, PIXEL_DEV_LIST_T;
@@ -0,0 +1,194 @@
+/**
+ * @file tdu_light_math.c
+ * @brief Fast math for pixel effects, see tdu_light_math.h.
+ *
+ * Sine comes from a quarter wave table of 257 q15 points, linearly
+ * interpolated over the 64 angle steps between two points and mirrored
+ * into the other quadrants, which keeps it within 5e-5 of sinf(). atan2 is
+ * reduced to the first octant and evaluated with a 9th order odd
+ * polynomial.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+#include "tdu_light_math.h"
+
+/***********************************************************
+*************************micro define***********************
+***********************************************************/
+#define LIGHT_SIN_TBL_BITS 8
+#define LIGHT_SIN_FRAC_BITS (14 - LIGHT_SIN_TBL_BITS)
+
+#define LIGHT_PI_F         3.14159265f
+#define LIGHT_RAD_TO_ANGLE (65536.0f / (2.0f * LIGHT_PI_F))
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+// sin(pi / 2 * i / 256) in q15
+static const uint16_t sg_sin_quarter_q15[(1 << LIGHT_SIN_TBL_BITS) + 1] = {
+        0,   201,   402,   603,   804,  1005,  1206,  1407,  1608,  1809,  2009,  2210,
+     2411,  2611,  2811,  3012,  3212,  3412,  3612,  3812,  4011,  4211,  4410,  4609,
+     4808,  5007,  5205,  5404,  5602,  5800,  5998,  6195,  6393,  6590,  6787,  6983,
+     7180,  7376,  7571,  7767,  7962,  8157,  8351,  8546,  8740,  8933,  9127,  9319,
+     9512,  9704,  9896, 10088, 10279, 10469, 10660, 10850, 11039, 11228, 11417, 11605,
+    11793, 11980, 12167, 12354, 12540, 12725, 12910, 13095, 13279, 13463, 13646, 13828,
+    14010, 14192, 14373, 14553, 14733, 14912, 15091, 15269, 15447, 15624, 15800, 15976,
+    16151, 16326, 16500, 16673, 16846, 17018, 17190, 17361, 17531, 17700, 17869, 18037,
+    18205, 18372, 18538, 18703, 18868, 19032, 19195, 19358, 19520, 19681, 19841, 20001,
+    20160, 20318, 20475, 20632, 20788, 20943, 21097, 21251, 21403, 21555, 21706, 21856,
+    22006, 22154, 22302, 22449, 22595, 22740, 22884, 23028, 23170, 23312, 23453, 23593,
+    23732, 23870, 24008, 24144, 24279, 24414, 24548, 24680, 24812, 24943, 25073, 25202,
+    25330, 25457, 25583, 25708, 25833, 25956, 26078, 26199, 26320, 26439, 26557, 26674,
+    26791, 26906, 27020, 27133, 27246, 27357, 27467, 27576, 27684, 27791, 27897, 28002,
+    28106, 28209, 28311, 28411, 28511, 28610, 28707, 28803, 28899, 28993, 29086, 29178,
+    29269, 29359, 29448, 29535, 29622, 29707, 29792, 29875, 29957, 30038, 30118, 30196,
+    30274, 30350, 30425, 30499, 30572, 30644, 30715, 30784, 30853, 30920, 30986, 31050,
+    31114, 31177, 31238, 31298, 31357, 31415, 31471, 31527, 31581, 31634, 31686, 31737,
+    31786, 31834, 31881, 31927, 31972, 32015, 32058, 32099, 32138, 32177, 32214, 32251,
+    32286, 32319, 32352, 32383, 32413, 32442, 32470, 32496, 32522, 32546, 32568, 32590,
+    32610, 32629, 32647, 32664, 32679, 32693, 32706, 32718, 32729, 32738, 32746, 32753,
+    32758, 32762, 32766, 32767, 32768,
+};
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+/**
+ * @brief sine of a binary angle
+ *
+ * @param[in] angle 65536 per turn
+ *
+ * @return sin(angle) in q16
+ */
+int32_t tdu_light_sin_q16(uint16_t angle)
+{
+    uint32_t a = angle & 0x3FFF;
+    uint32_t idx = 0, frac = 0;
+    int32_t value = 0;
+
+    // falling quadrants read the table backwards
+    if (angle & 0x4000) {
+        a = 0x4000 - a;
+    }
+    idx = a >> LIGHT_SIN_FRAC_BITS;
+    frac = a & ((1 << LIGHT_SIN_FRAC_BITS) - 1);
+
+    value = sg_sin_quarter_q15[idx];
+    if (frac) {
+        value += ((int32_t)(sg_sin_quarter_q15[idx + 1] - sg_sin_quarter_q15[idx]) * (int32_t)frac) >>
+                 LIGHT_SIN_FRAC_BITS;
+    }
+    value <<= 1;
+
+    return (angle & 0x8000) ? -value : value;
+}
+
+/**
+ * @brief cosine of a binary angle
+ *
+ * @param[in] angle 65536 per turn
+ *
+ * @return cos(angle) in q16
+ */
+int32_t tdu_light_cos_q16(uint16_t angle)
+{
+    return tdu_light_sin_q16((uint16_t)(angle + TDU_LIGHT_ANGLE_QUARTER));
+}
+
+/**
+ * @brief convert radians to a binary angle, any value wraps to one turn
+ *
+ * @param[in] rad angle in radians
+ *
+ * @return angle, 65536 per turn
+ */
+uint16_t tdu_light_rad_to_angle(float rad)
+{
+    return (uint16_t)(int64_t)(rad * LIGHT_RAD_TO_ANGLE);
+}
+
+/**
+ * @brief table based sinf()
+ *
+ * @param[in] rad angle in radians
+ *
+ * @return sin(rad)
+ */
+float tdu_light_sinf(float rad)
+{
+    return (float)tdu_light_sin_q16(tdu_light_rad_to_angle(rad)) * (1.0f / TDU_LIGHT_Q16_ONE);
+}
+
+/**
+ * @brief table based cosf()
+ *
+ * @param[in] rad angle in radians
+ *
+ * @return cos(rad)
+ */
+float tdu_light_cosf(float rad)
+{
+    return (float)tdu_light_cos_q16(tdu_light_rad_to_angle(rad)) * (1.0f / TDU_LIGHT_Q16_ONE);
+}
+
+/**
+ * @brief polynomial atan2f(), within 1e-4 rad
+ *
+ * @param[in] y y coordinate
+ * @param[in] x x coordinate
+ *
+ * @return angle of (x, y) in -pi..pi, 0 for the origin
+ */
+float tdu_light_atan2f(float y, float x)
+{
+    float ax = (x < 0.0f) ? -x : x;
+    float ay = (y < 0.0f) ? -y : y;
+    float z = 0.0f, z2 = 0.0f, angle = 0.0f;
+
+    if (ax == 0.0f && ay == 0.0f) {
+        return 0.0f;
+    }
+
+    // |z| <= 1, the steeper half is reflected about pi / 4
+    z = (ay > ax) ? (ax / ay) : (ay / ax);
+    z2 = z * z;
+    angle = z * (0.9998660f + z2 * (-0.3302995f + z2 * (0.1801410f + z2 * (-0.0851330f + z2 * 0.0208351f))));
+
+    if (ay > ax) {
+        angle = LIGHT_PI_F / 2.0f - angle;
+    }
+    if (x < 0.0f) {
+        angle = LIGHT_PI_F - angle;
+    }
+    return (y < 0.0f) ? -angle : angle;
+}
+
+/**
+ * @brief build the q16 rotation R = Rz * Ry * Rx
+ *
+ * @param[out] rot the matrix
+ * @param[in] ax rotation about x, 65536 per turn
+ * @param[in] ay rotation about y
+ * @param[in] az rotation about z
+ */
+void tdu_light_rot_q16_set(TDU_LIGHT_ROT_Q16_T *rot, uint16_t ax, uint16_t ay, uint16_t az)
+{
+    int64_t sx = tdu_light_sin_q16(ax), cx = tdu_light_cos_q16(ax);
+    int64_t sy = tdu_light_sin_q16(ay), cy = tdu_light_cos_q16(ay);
+    int64_t sz = tdu_light_sin_q16(az), cz = tdu_light_cos_q16(az);
+
+    if (NULL == rot) {
+        return;
+    }
+
+    rot->m[0][0] = (int32_t)((cz * cy) >> 16);
+    rot->m[0][1] = (int32_t)((((cz * sy) >> 16) * sx - sz * cx) >> 16);
+    rot->m[0][2] = (int32_t)((((cz * sy) >> 16) * cx + sz * sx) >> 16);
+    rot->m[1][0] = (int32_t)((sz * cy) >> 16);
+    rot->m[1][1] = (int32_t)((((sz * sy) >> 16) * sx + cz * cx) >> 16);
+    rot->m[1][2] = (int32_t)((((sz * sy) >> 16) * cx - cz * sx) >> 16);
+    rot->m[2][0] = (int32_t)(-sy);
+    rot->m[2][1] = (int32_t)((cy * sx) >> 16);
+    rot->m[2][2] = (int32_t)((cy * cx) >> 16);
+}
@@ -86,8 +86,11 @@ static OPERATE_RET __tdd_i2c_gt1151_read(TDD_TP_DEV_HANDLE_T device, uint8_t max
 
     read_num = MIN(read_num, (status & 0x0f));
     memset(sg_point_data, 0, sizeof(sg_point_data));
-    TUYA_CALL_ERR_RETURN(tdd_tp_i2c_port_read(info->i2c_cfg.port, GT1151_I2C_SLAVE_ADDR, GT1151_POINT1_REG, 2,
-                                                 sg_point_data, sizeof(sg_point_data)));
+    // one burst of the reported points only
+    if (read_num > 0) {
+        TUYA_CALL_ERR_RETURN(tdd_tp_i2c_port_read(info->i2c_cfg.port, GT1151_I2C_SLAVE_ADDR, GT1151_POINT1_REG, 2,
+                                                     sg_point_data, read_num * GT1151_POINT_INFO_SIZE));
+    }
 
     /* get point coordinates */
     for (uint8_t i = 0; i < read_num; i++) {
@@ -63,6 +63,10 @@ typedef struct {
 OPERATE_RET tdl_tp_device_register(char *name, TDD_TP_DEV_HANDLE_T tdd_hdl, TDD_TP_CONFIG_T *tp_cfg,
                                       TDD_TP_INTFS_T *intfs);
 
+// Registers the INT output of the controller, call it before the device is opened.
+// A read without a pulse since the last one and no finger down then skips the bus.
+OPERATE_RET tdl_tp_int_register(char *name, TUYA_GPIO_NUM_E int_pin, TUYA_GPIO_IRQ_E mode);
+
 #ifdef __cplusplus
 }
 #endif
@@ -45,6 +45,9 @@ OPERATE_RET tdl_tp_dev_read(TDL_TP_HANDLE_T tp_hdl, uint8_t max_num, TDL_TP_POS_
 
 OPERATE_RET tdl_tp_dev_close(TDL_TP_HANDLE_T tp_hdl);
 
+// Waits for the next INT pulse, OPRT_NOT_SUPPORTED if no INT pin was registered
+OPERATE_RET tdl_tp_dev_wait(TDL_TP_HANDLE_T tp_hdl, uint32_t timeout_ms);
+
 #ifdef __cplusplus
 }
 #endif
@@ -37,6 +37,13 @@ typedef struct {
     TDD_TP_INTFS_T intfs;
 
     TDD_TP_CONFIG_T config;
+
+    bool has_int;
+    TUYA_GPIO_NUM_E int_pin;
+    TUYA_GPIO_IRQ_E int_mode;
+    SEM_HANDLE int_sem;
+    volatile bool int_pending; // a pulse came since the last read
+    bool is_touched;           // the last read found a finger, keep reading until it lifts
 } TP_DEVICE_T;
 
 /***********************************************************
@@ -71,6 +78,62 @@ static TP_DEVICE_T *__find_tp_device(char *name)
     return NULL;
 }
 
+static void __tdl_tp_int_irq_cb(void *args)
+{
+    TP_DEVICE_T *tp_dev = (TP_DEVICE_T *)args;
+
+    tp_dev->int_pending = true;
+    tal_semaphore_post(tp_dev->int_sem);
+}
+
+static void __tdl_tp_int_init(TP_DEVICE_T *tp_dev)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    if (false == tp_dev->has_int) {
+        return;
+    }
+
+    TUYA_GPIO_BASE_CFG_T pin_cfg = {
+        .mode = TUYA_GPIO_PULLUP,
+        .direct = TUYA_GPIO_INPUT,
+        .level = TUYA_GPIO_LEVEL_HIGH,
+    };
+    TUYA_GPIO_IRQ_T irq_cfg = {
+        .mode = tp_dev->int_mode,
+        .cb = __tdl_tp_int_irq_cb,
+        .arg = tp_dev,
+    };
+
+    if (NULL == tp_dev->int_sem) {
+        TUYA_CALL_ERR_GOTO(tal_semaphore_create_init(&tp_dev->int_sem, 0, 1), __ERR);
+    }
+
+    // read once after opening, a finger may already be down
+    tp_dev->int_pending = true;
+
+    TUYA_CALL_ERR_GOTO(tkl_gpio_init(tp_dev->int_pin, &pin_cfg), __ERR);
+    TUYA_CALL_ERR_GOTO(tkl_gpio_irq_init(tp_dev->int_pin, &irq_cfg), __ERR);
+    TUYA_CALL_ERR_GOTO(tkl_gpio_irq_enable(tp_dev->int_pin), __ERR);
+
+    return;
+
+__ERR:
+    // without the interrupt every read goes to the bus again
+    PR_ERR("tp int pin %d init failed: %d", tp_dev->int_pin, rt);
+    tp_dev->has_int = false;
+}
+
+static void __tdl_tp_int_deinit(TP_DEVICE_T *tp_dev)
+{
+    if (false == tp_dev->has_int) {
+        return;
+    }
+
+    tkl_gpio_irq_disable(tp_dev->int_pin);
+    tkl_gpio_deinit(tp_dev->int_pin);
+}
+
 TDL_TP_HANDLE_T tdl_tp_find_dev(char *name)
 {
     return (TDL_TP_HANDLE_T)__find_tp_device(name);
@@ -99,6 +162,8 @@ OPERATE_RET tdl_tp_dev_open(TDL_TP_HANDLE_T tp_hdl)
         TUYA_CALL_ERR_RETURN(tp_dev->intfs.open(tp_dev->tdd_hdl));
     }
 
+    __tdl_tp_int_init(tp_dev);
+
     tp_dev->is_open = true;
 
     return OPRT_OK;
@@ -120,9 +185,17 @@ OPERATE_RET tdl_tp_dev_read(TDL_TP_HANDLE_T tp_hdl, uint8_t max_num, TDL_TP_POS_
         return OPRT_COM_ERROR;
     }
 
+    // nothing new without a pulse while no finger is down, the bus stays idle
+    if (tp_dev->has_int && false == tp_dev->int_pending && false == tp_dev->is_touched) {
+        *point_num = 0;
+        return OPRT_OK;
+    }
+
     if (tp_dev->intfs.read) {
         tal_mutex_lock(tp_dev->mutex);
+        tp_dev->int_pending = false;
         rt = tp_dev->intfs.read(tp_dev->tdd_hdl, max_num, point, point_num);
+        tp_dev->is_touched = (OPRT_OK == rt && *point_num > 0);
 
         uint32_t adj_flags = ((tp_dev->config.flags.swap_xy) || (tp_dev->config.flags.mirror_x) ||
                               (tp_dev->config.flags.mirror_y));
@@ -170,11 +243,31 @@ OPERATE_RET tdl_tp_dev_close(TDL_TP_HANDLE_T tp_hdl)
         TUYA_CALL_ERR_RETURN(tp_dev->intfs.close(tp_dev->tdd_hdl));
     }
 
+    __tdl_tp_int_deinit(tp_dev);
+
     tp_dev->is_open = false;
+    tp_dev->is_touched = false;
 
     return OPRT_OK;
 }
 
+OPERATE_RET tdl_tp_dev_wait(TDL_TP_HANDLE_T tp_hdl, uint32_t timeout_ms)
+{
+    TP_DEVICE_T *tp_dev = NULL;
+
+    if (NULL == tp_hdl) {
+        return OPRT_INVALID_PARM;
+    }
+
+    tp_dev = (TP_DEVICE_T *)tp_hdl;
+
+    if (false == tp_dev->is_open || false == tp_dev->has_int) {
+        return OPRT_NOT_SUPPORTED;
+    }
+
+    return tal_semaphore_wait(tp_dev->int_sem, timeout_ms);
+}
+
 OPERATE_RET tdl_tp_device_register(char *name, TDD_TP_DEV_HANDLE_T tdd_hdl, TDD_TP_CONFIG_T *tp_cfg,
                                       TDD_TP_INTFS_T *intfs)
 {
@@ -199,5 +292,25 @@ OPERATE_RET tdl_tp_device_register(char *name, TDD_TP_DEV_HANDLE_T tdd_hdl, TDD_
 
     tuya_list_add(&tp_dev->node, &sg_tp_list);
 
+    return OPRT_OK;
+}
+
+OPERATE_RET tdl_tp_int_register(char *name, TUYA_GPIO_NUM_E int_pin, TUYA_GPIO_IRQ_E mode)
+{
+    TP_DEVICE_T *tp_dev = NULL;
+
+    if (NULL == name || int_pin >= TUYA_GPIO_NUM_MAX) {
+        return OPRT_INVALID_PARM;
+    }
+
+    tp_dev = __find_tp_device(name);
+    if (NULL == tp_dev) {
+        return OPRT_COM_ERROR;
+    }
+
+    tp_dev->int_pin = int_pin;
+    tp_dev->int_mode = mode;
+    tp_dev->has_int = true;
+
     return OPRT_OK;
 }
\ No newline at end of file
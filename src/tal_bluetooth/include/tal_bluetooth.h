@@ -253,6 +253,26 @@ OPERATE_RET tal_ble_server_exchange_mtu_reply(const TAL_BLE_PEER_INFO_T peer, ui
  * */
 OPERATE_RET tal_ble_client_exchange_mtu_request(const TAL_BLE_PEER_INFO_T peer, uint16_t client_mtu);
 
+/**
+ * @brief   Set the WiFi/BLE coexistence mode
+ * @param   [in] mode: TAL_BLE_COEX_MEDIA while real-time audio/video runs
+ * over WiFi, TAL_BLE_COEX_IDLE afterwards
+ * @return  SUCCESS
+ *          ERROR Refer to platform error code
+ * @note    Running advertising is restarted with the stretched (or the
+ * originally requested) interval, a peripheral link gets a connection
+ * parameter update to TAL_BLE_COEX_CONN_* (or back to what its user asked
+ * for, else TUYAOS_BLE_DEFAULT_CONN_PARAM). Advertising started and links
+ * made in media mode get the relaxed parameters right away.
+ * */
+OPERATE_RET tal_ble_coex_set_mode(TAL_BLE_COEX_MODE_E mode);
+
+/**
+ * @brief   Get the WiFi/BLE coexistence mode
+ * @return  Current mode
+ * */
+TAL_BLE_COEX_MODE_E tal_ble_coex_get_mode(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -96,6 +96,30 @@
     }
 #define TUYAOS_BLE_DEFAULT_CONN_PARAM ((TAL_BLE_CONN_PARAMS_T *)(&(TAL_BLE_CONN_PARAMS_T)DEFAULT_CONN_PARAMS(30, 60)))
 
+/**< WiFi/BLE coexistence: in TAL_BLE_COEX_MEDIA advertising slows down to at
+ * least TAL_BLE_COEX_ADV_INTERVAL and the peripheral link is moved to the
+ * TAL_BLE_COEX_CONN_* parameters, so the shared radio is mostly left to WiFi */
+#ifndef TAL_BLE_COEX_ADV_INTERVAL
+#define TAL_BLE_COEX_ADV_INTERVAL (0x0640) /**< 1s, N * 0.625 msec */
+#endif
+#ifndef TAL_BLE_COEX_CONN_INTERVAL_MIN
+#define TAL_BLE_COEX_CONN_INTERVAL_MIN (80) /**< 100ms, N * 1.25 msec */
+#endif
+#ifndef TAL_BLE_COEX_CONN_INTERVAL_MAX
+#define TAL_BLE_COEX_CONN_INTERVAL_MAX (160) /**< 200ms */
+#endif
+#ifndef TAL_BLE_COEX_CONN_LATENCY
+#define TAL_BLE_COEX_CONN_LATENCY (4)
+#endif
+#ifndef TAL_BLE_COEX_CONN_SUP_TIMEOUT
+#define TAL_BLE_COEX_CONN_SUP_TIMEOUT (600) /**< 6s, N * 10 msec, must exceed (1 + latency) * interval * 2 */
+#endif
+
+typedef enum {
+    TAL_BLE_COEX_IDLE = 0, /**< BLE runs with the parameters its users asked for [Default] */
+    TAL_BLE_COEX_MEDIA,    /**< Real-time WiFi media is active, BLE backs off */
+} TAL_BLE_COEX_MODE_E;
+
 /**< Define these parameters for advertising */
 typedef enum {
     TAL_BLE_ADDR_TYPE_PUBLIC = 0x00, /**< public address  */
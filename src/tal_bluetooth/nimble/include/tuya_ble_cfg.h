@@ -49,6 +49,20 @@
 #endif
 #endif
 
+/* Request LE Data Length Extension on each peripheral connection, so an
+ * MTU-sized notification fits one link-layer packet */
+#ifndef TY_HS_BLE_CONN_DATA_LEN_EXT
+#define TY_HS_BLE_CONN_DATA_LEN_EXT (1)
+#endif
+
+#ifndef TY_HS_BLE_CONN_DATA_LEN_TX_OCTETS
+#define TY_HS_BLE_CONN_DATA_LEN_TX_OCTETS (251)
+#endif
+
+#ifndef TY_HS_BLE_CONN_DATA_LEN_TX_TIME
+#define TY_HS_BLE_CONN_DATA_LEN_TX_TIME (2120) /* 251 octets on the 1M PHY, in us */
+#endif
+
 #ifndef TY_HS_BLE_EXT_ADV
 #define TY_HS_BLE_EXT_ADV (0)
 #endif
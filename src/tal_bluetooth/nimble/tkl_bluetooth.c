@@ -142,6 +142,16 @@ static int tuya_ble_host_gap_event(struct ble_gap_event *event, void *arg)
                  tkl_ble_gap_conn_param_update(event->connect.conn_handle, &param);
              }*/
         }
+#endif
+#if TY_HS_BLE_CONN_DATA_LEN_EXT
+        if (event->connect.status == 0 && p_role->role == TKL_BLE_ROLE_SERVER) {
+            // Controllers without DLE reject this and stay at 27 octets
+            int rc = ble_gap_set_data_len(event->connect.conn_handle, TY_HS_BLE_CONN_DATA_LEN_TX_OCTETS,
+                                          TY_HS_BLE_CONN_DATA_LEN_TX_TIME);
+            if (rc != 0) {
+                BLE_HS_LOG(INFO, "set data len failed, rc=%d\n", rc);
+            }
+        }
 #endif
         BLE_HS_LOG(INFO, "BLE_GAP_EVENT_CONNECT(0x%02x), handle = 0x%02x, Role(%d)\n", event->connect.status,
                    event->connect.conn_handle, p_role->role);
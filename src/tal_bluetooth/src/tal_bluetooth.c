@@ -52,6 +52,19 @@ static TAL_BLE_EVT_FUNC_CB tal_ble_event_callback;
 static TAL_BLE_PEER_INFO_T tal_ble_peer = {0};
 #endif
 
+/**< Coexistence policy state, keeps what the users asked for so idle mode can restore it */
+typedef struct {
+    TAL_BLE_COEX_MODE_E mode;
+    BOOL_T adv_on;                    /**< Advertising started and not stopped or ended by a connection */
+    TAL_BLE_ADV_PARAMS_T adv_param;   /**< Parameters of the last tal_ble_advertising_start() */
+    BOOL_T conn_param_set;            /**< The peripheral link user asked for parameters */
+    TAL_BLE_CONN_PARAMS_T conn_param; /**< Parameters of the last tal_ble_conn_param_update() */
+} TAL_BLE_COEX_T;
+
+static TAL_BLE_COEX_T tal_ble_coex = {.mode = TAL_BLE_COEX_IDLE};
+
+static OPERATE_RET tal_ble_coex_conn_apply(void);
+
 static __attribute__((unused)) uint16_t tal_ble_uuid16_convert(TKL_BLE_UUID_T *p_uuid)
 {
     uint16_t uuid16 = 0xFFFF;
@@ -96,6 +109,12 @@ static void tkl_ble_kernel_gap_event_callback(TKL_BLE_GAP_PARAMS_EVT_T *p_event)
             tal_event.type = TAL_BLE_EVT_PERIPHERAL_CONNECT;
 
             tkl_ble_common_connect_handle = p_event->conn_handle;
+            /**< Connectable advertising ends with the connection */
+            tal_ble_coex.adv_on = FALSE;
+            tal_ble_coex.conn_param_set = FALSE;
+            if (tal_ble_coex.mode == TAL_BLE_COEX_MEDIA) {
+                tal_ble_coex_conn_apply();
+            }
             tal_event.ble_event.connect.peer.conn_handle = p_event->conn_handle;
             tal_event.ble_event.connect.peer.peer_addr.type = p_event->gap_event.connect.peer_addr.type;
             memcpy(tal_event.ble_event.connect.peer.peer_addr.addr, p_event->gap_event.connect.peer_addr.addr, 6);
@@ -136,6 +155,7 @@ static void tkl_ble_kernel_gap_event_callback(TKL_BLE_GAP_PARAMS_EVT_T *p_event)
         if (p_event->gap_event.disconnect.role == TKL_BLE_ROLE_SERVER &&
             p_event->conn_handle == tkl_ble_common_connect_handle) {
             tkl_ble_common_connect_handle = TKL_BLE_GATT_INVALID_HANDLE;
+            tal_ble_coex.conn_param_set = FALSE;
         }
 
         tal_event.type = TAL_BLE_EVT_DISCONNECT;
@@ -616,13 +636,10 @@ OPERATE_RET tal_ble_bt_link_max(uint16_t *p_maxlink)
  * @return  SUCCESS             Successfully started advertising procedure.
  *          ERR_INVALID_STATE   Not in advertising state.
  * */
-OPERATE_RET tal_ble_advertising_start(TAL_BLE_ADV_PARAMS_T const *p_adv_param)
+static OPERATE_RET tal_ble_coex_adv_start(void)
 {
     TKL_BLE_GAP_ADV_PARAMS_T tal_adv_params = {0};
-
-    if (p_adv_param == NULL) {
-        return OPRT_INVALID_PARM;
-    }
+    TAL_BLE_ADV_PARAMS_T const *p_adv_param = &tal_ble_coex.adv_param;
 
     tal_adv_params.adv_type = p_adv_param->adv_type;
     tal_adv_params.direct_addr.type = p_adv_param->direct_addr.type;
@@ -630,11 +647,36 @@ OPERATE_RET tal_ble_advertising_start(TAL_BLE_ADV_PARAMS_T const *p_adv_param)
     tal_adv_params.adv_interval_max = p_adv_param->adv_interval_max;
     tal_adv_params.adv_channel_map = 0x01 | 0x02 | 0x04;
 
+    /**< Media mode: stretch the interval, a slower request is kept as is */
+    if (tal_ble_coex.mode == TAL_BLE_COEX_MEDIA) {
+        if (tal_adv_params.adv_interval_min < TAL_BLE_COEX_ADV_INTERVAL) {
+            tal_adv_params.adv_interval_min = TAL_BLE_COEX_ADV_INTERVAL;
+        }
+        if (tal_adv_params.adv_interval_max < tal_adv_params.adv_interval_min) {
+            tal_adv_params.adv_interval_max = tal_adv_params.adv_interval_min;
+        }
+    }
+
     memcpy(tal_adv_params.direct_addr.addr, p_adv_param->direct_addr.addr, 6);
 
     return tkl_ble_gap_adv_start(&tal_adv_params);
 }
 
+OPERATE_RET tal_ble_advertising_start(TAL_BLE_ADV_PARAMS_T const *p_adv_param)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    if (p_adv_param == NULL) {
+        return OPRT_INVALID_PARM;
+    }
+
+    memcpy(&tal_ble_coex.adv_param, p_adv_param, sizeof(TAL_BLE_ADV_PARAMS_T));
+    rt = tal_ble_coex_adv_start();
+    tal_ble_coex.adv_on = (rt == OPRT_OK);
+
+    return rt;
+}
+
 /**
  * @brief   Setting advertising data
  * @param   [in] p_adv : Data to be used in advertisement packets
@@ -674,6 +716,7 @@ OPERATE_RET tal_ble_advertising_data_set(TAL_BLE_DATA_T *p_adv, TAL_BLE_DATA_T *
  * */
 OPERATE_RET tal_ble_advertising_stop(void)
 {
+    tal_ble_coex.adv_on = FALSE;
     return tkl_ble_gap_adv_stop();
 }
 
@@ -785,6 +828,15 @@ tal_ble_conn_param_update(const TAL_BLE_PEER_INFO_T peer, TAL_BLE_CONN_PARAMS_T
         return OPRT_INVALID_PARM;
     }
 
+    /**< Remembered for the peripheral link, media mode keeps it relaxed until idle */
+    if (conn_handle == tkl_ble_common_connect_handle) {
+        memcpy(&tal_ble_coex.conn_param, p_conn_params, sizeof(TAL_BLE_CONN_PARAMS_T));
+        tal_ble_coex.conn_param_set = TRUE;
+        if (tal_ble_coex.mode == TAL_BLE_COEX_MEDIA) {
+            return OPRT_OK;
+        }
+    }
+
     param.conn_interval_min = p_conn_params->min_conn_interval;
     param.conn_interval_max = p_conn_params->max_conn_interval;
     param.conn_latency = p_conn_params->latency;
@@ -1035,4 +1087,71 @@ OPERATE_RET tal_ble_client_exchange_mtu_request(const TAL_BLE_PEER_INFO_T peer,
     return tkl_ble_gattc_exchange_mtu_request(conn_handle, client_mtu);
 }
 
-#endif
\ No newline at end of file
+#endif
+/**
+ * @brief   Move the peripheral link to the parameters of the coexistence mode
+ * @return  SUCCESS, also when there is no link
+ * */
+static OPERATE_RET tal_ble_coex_conn_apply(void)
+{
+    TKL_BLE_GAP_CONN_PARAMS_T param = {0};
+    TAL_BLE_CONN_PARAMS_T const *p_conn = TUYAOS_BLE_DEFAULT_CONN_PARAM;
+
+    if (tkl_ble_common_connect_handle == TKL_BLE_GATT_INVALID_HANDLE) {
+        return OPRT_OK;
+    }
+
+    if (tal_ble_coex.mode == TAL_BLE_COEX_MEDIA) {
+        param.conn_interval_min = TAL_BLE_COEX_CONN_INTERVAL_MIN;
+        param.conn_interval_max = TAL_BLE_COEX_CONN_INTERVAL_MAX;
+        param.conn_latency = TAL_BLE_COEX_CONN_LATENCY;
+        param.conn_sup_timeout = TAL_BLE_COEX_CONN_SUP_TIMEOUT;
+    } else {
+        if (tal_ble_coex.conn_param_set) {
+            p_conn = &tal_ble_coex.conn_param;
+        }
+        param.conn_interval_min = p_conn->min_conn_interval;
+        param.conn_interval_max = p_conn->max_conn_interval;
+        param.conn_latency = p_conn->latency;
+        param.conn_sup_timeout = p_conn->conn_sup_timeout;
+        param.connection_timeout = p_conn->connection_timeout;
+    }
+
+    return tkl_ble_gap_conn_param_update(tkl_ble_common_connect_handle, &param);
+}
+
+OPERATE_RET tal_ble_coex_set_mode(TAL_BLE_COEX_MODE_E mode)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    if (mode != TAL_BLE_COEX_IDLE && mode != TAL_BLE_COEX_MEDIA) {
+        return OPRT_INVALID_PARM;
+    }
+    if (mode == tal_ble_coex.mode) {
+        return OPRT_OK;
+    }
+    tal_ble_coex.mode = mode;
+    PR_DEBUG("ble coex mode %d, adv %d, link %d", mode, tal_ble_coex.adv_on,
+             tkl_ble_common_connect_handle != TKL_BLE_GATT_INVALID_HANDLE);
+
+    /**< The interval of running advertising only changes with a restart */
+    if (tal_ble_coex.adv_on) {
+        tkl_ble_gap_adv_stop();
+        rt = tal_ble_coex_adv_start();
+        if (rt != OPRT_OK) {
+            tal_ble_coex.adv_on = FALSE;
+        }
+    }
+
+    if (tal_ble_coex_conn_apply() != OPRT_OK) {
+        /**< The central may reject the update, the link keeps working either way */
+        PR_DEBUG("ble coex conn param update rejected");
+    }
+
+    return rt;
+}
+
+TAL_BLE_COEX_MODE_E tal_ble_coex_get_mode(void)
+{
+    return tal_ble_coex.mode;
+}
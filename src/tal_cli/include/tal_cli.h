@@ -40,6 +40,15 @@ typedef struct {
     cli_cmd_func_cb_t func;
 } cli_cmd_t;
 
+/**
+ * @brief reads a module counter shown by the perf command
+ *
+ * @param[in] arg The arg given at registration
+ *
+ * @return the counter value
+ */
+typedef uint32_t (*cli_perf_metric_cb_t)(void *arg);
+
 /**
  * @brief cli init function,default uart0
  *
@@ -82,6 +91,31 @@ int tal_cli_init_with_uart(uint8_t uart_num);
  */
 void tal_cli_echo(char *string);
 
+/**
+ * @brief register a module counter shown by the perf command
+ *
+ * perf prints the value and its change per second. The callback runs on the
+ * cli thread, it must not block.
+ *
+ * @param[in] name Counter name, must stay valid while registered
+ * @param[in] cb Reads the counter
+ * @param[in] arg Passed back to cb
+ *
+ * @return OPRT_OK on success, OPRT_EXCEED_UPPER_LIMIT if the registry is full
+ *
+ */
+int tal_cli_perf_metric_register(const char *name, cli_perf_metric_cb_t cb, void *arg);
+
+/**
+ * @brief unregister a module counter
+ *
+ * @param[in] name Counter name given at registration
+ *
+ * @return OPRT_OK on success, OPRT_NOT_FOUND if it is not registered
+ *
+ */
+int tal_cli_perf_metric_unregister(const char *name);
+
 #ifdef __cplusplus
 }
 #endif
@@ -21,6 +21,7 @@
 #include "tal_log.h"
 #include "tal_cli.h"
 #include "tal_thread.h"
+#include "tal_trace.h"
 #include "tal_memory.h"
 
 /*============================ MACROS ========================================*/
@@ -95,6 +96,11 @@ typedef struct {
 
 /*============================ PROTOTYPES ====================================*/
 static void cli_hello(int argc, char *argv[]);
+static void cli_top(int argc, char *argv[]);
+extern void cli_perf(int argc, char *argv[]);
+#if defined(ENABLE_TAL_TRACE) && (ENABLE_TAL_TRACE == 1)
+static void cli_trace(int argc, char *argv[]);
+#endif
 static void cli_print_prompt(cli_t *cli);
 
 /*============================ LOCAL VARIABLES ===============================*/
@@ -102,11 +108,14 @@ static cli_t *s_cli_handle = NULL;
 static SLIST_HEAD s_cli_dynamic_table;
 static cli_cmd_table_t s_cli_static_table[CLI_CMD_TABLE_NUM];
 
-static const cli_cmd_t s_cli_cmd[] = {{
-    .name = "hello",
-    .help = "print helo world",
-    .func = cli_hello,
-}};
+static const cli_cmd_t s_cli_cmd[] = {
+    {.name = "hello", .help = "print helo world", .func = cli_hello},
+    {.name = "top", .help = "thread cpu, switches and stack since the last top", .func = cli_top},
+    {.name = "perf", .help = "perf [interval_s] [count], live threads, heap, queues and counters", .func = cli_perf},
+#if defined(ENABLE_TAL_TRACE) && (ENABLE_TAL_TRACE == 1)
+    {.name = "trace", .help = "trace [dump|clear|on|off], dump is Perfetto json", .func = cli_trace},
+#endif
+};
 
 /*============================ IMPLEMENTATION ================================*/
 static int32_t cli_out_put(TUYA_UART_NUM_E port_id, char *out_str, uint32_t len)
@@ -127,6 +136,34 @@ static void cli_hello(int argc, char *argv[])
     cli_print_string(s_cli_handle, "helo world");
 }
 
+static void cli_top(int argc, char *argv[])
+{
+    tal_thread_profile_dump();
+}
+
+#if defined(ENABLE_TAL_TRACE) && (ENABLE_TAL_TRACE == 1)
+static void cli_trace_output(const char *str, uint32_t len, void *arg)
+{
+    cli_out_put(s_cli_handle->port_id, (char *)str, len);
+}
+
+static void cli_trace(int argc, char *argv[])
+{
+    if (argc < 2 || 0 == strcmp(argv[1], "dump")) {
+        cli_out_put(s_cli_handle->port_id, "\r\n", 2);
+        tal_trace_dump(cli_trace_output, NULL);
+    } else if (0 == strcmp(argv[1], "clear")) {
+        tal_trace_clear();
+    } else if (0 == strcmp(argv[1], "on")) {
+        tal_trace_enable(TRUE);
+    } else if (0 == strcmp(argv[1], "off")) {
+        tal_trace_enable(FALSE);
+    } else {
+        cli_print_string(s_cli_handle, "usage: trace [dump|clear|on|off]");
+    }
+}
+#endif
+
 static cli_cmd_t *cli_cmd_find_with_name(char *name)
 {
     int i, j;
@@ -776,7 +813,7 @@ int tal_cli_init_with_uart(uint8_t uart_num)
         PR_ERR("uart init failed", result);
         goto __exit;
     }
-    tal_cli_cmd_register((cli_cmd_t *)&s_cli_cmd, 1);
+    tal_cli_cmd_register((cli_cmd_t *)&s_cli_cmd, sizeof(s_cli_cmd) / sizeof(s_cli_cmd[0]));
 
     THREAD_CFG_T param;
 
@@ -0,0 +1,242 @@
+/**
+ * @file tal_cli_perf.c
+ * @brief The perf cli command, a live view of where the device spends its
+ * time and memory.
+ *
+ * Each frame covers the interval since the previous one: the cpu share and
+ * context switches of every thread, the heap free, largest block and low
+ * mark, the PSRAM in use, the depth of the workqueue services, the running
+ * sw timers and how late they were dispatched, and the counters modules
+ * registered with tal_cli_perf_metric_register(). With a count the frames
+ * redraw in place on an ANSI terminal.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+/*============================ INCLUDES ======================================*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tal_cli.h"
+#include "tal_log.h"
+#include "tal_memory.h"
+#include "tal_system.h"
+#include "tal_thread.h"
+#include "tal_sw_timer.h"
+#include "tal_workq_service.h"
+
+/*============================ MACROS ========================================*/
+#ifndef CLI_PERF_METRIC_NUM
+#define CLI_PERF_METRIC_NUM 16
+#endif
+
+#ifndef CLI_PERF_THREAD_MAX
+#define CLI_PERF_THREAD_MAX 32
+#endif
+
+// frames one perf command draws at most
+#define CLI_PERF_COUNT_MAX 3600
+
+#define CLI_PERF_LINE_LEN 96
+
+#define CLI_PERF_CLEAR "\033[2J\033[H"
+
+/*============================ TYPES =========================================*/
+typedef struct {
+    const char *name;
+    cli_perf_metric_cb_t cb;
+    void *arg;
+    uint32_t last;
+} cli_perf_metric_t;
+
+typedef struct {
+    uint32_t heap_free;
+    uint32_t heap_low;
+    uint32_t psram_used;
+} cli_perf_state_t;
+
+/*============================ LOCAL VARIABLES ===============================*/
+static cli_perf_metric_t s_perf_metric[CLI_PERF_METRIC_NUM];
+
+/*============================ IMPLEMENTATION ================================*/
+int tal_cli_perf_metric_register(const char *name, cli_perf_metric_cb_t cb, void *arg)
+{
+    int i, ret = OPRT_EXCEED_UPPER_LIMIT;
+
+    if (NULL == name || NULL == cb) {
+        return OPRT_INVALID_PARM;
+    }
+
+    TAL_ENTER_CRITICAL();
+    for (i = 0; i < CLI_PERF_METRIC_NUM; i++) {
+        if (NULL == s_perf_metric[i].cb) {
+            s_perf_metric[i].name = name;
+            s_perf_metric[i].arg = arg;
+            s_perf_metric[i].last = 0;
+            s_perf_metric[i].cb = cb;
+            ret = OPRT_OK;
+            break;
+        }
+    }
+    TAL_EXIT_CRITICAL();
+
+    return ret;
+}
+
+int tal_cli_perf_metric_unregister(const char *name)
+{
+    int i, ret = OPRT_NOT_FOUND;
+
+    if (NULL == name) {
+        return OPRT_INVALID_PARM;
+    }
+
+    TAL_ENTER_CRITICAL();
+    for (i = 0; i < CLI_PERF_METRIC_NUM; i++) {
+        if (s_perf_metric[i].cb && 0 == strcmp(s_perf_metric[i].name, name)) {
+            s_perf_metric[i].cb = NULL;
+            ret = OPRT_OK;
+            break;
+        }
+    }
+    TAL_EXIT_CRITICAL();
+
+    return ret;
+}
+
+static void cli_perf_threads(THREAD_PROFILE_T *profile)
+{
+    char line[CLI_PERF_LINE_LEN];
+    uint32_t period = 0, cnt, i;
+
+    cnt = tal_thread_profile_get(profile, CLI_PERF_THREAD_MAX, &period);
+    snprintf(line, sizeof(line), "threads %u, window %u ms", cnt, period);
+    tal_cli_echo(line);
+    tal_cli_echo("  name              cpu      switches  stack free");
+    for (i = 0; i < cnt; i++) {
+        snprintf(line, sizeof(line), "  %-16s %3u.%u%%  %8u  %5u/%u", profile[i].name, profile[i].cpu_permille / 10,
+                 profile[i].cpu_permille % 10, profile[i].switches, profile[i].stack_free, profile[i].stack_size);
+        tal_cli_echo(line);
+    }
+}
+
+static void cli_perf_memory(cli_perf_state_t *state)
+{
+    char line[CLI_PERF_LINE_LEN];
+    TAL_HEAP_INFO_T heap = {0};
+
+    if (OPRT_OK == tal_system_get_heap_info(&heap)) {
+        if (0 == state->heap_low || heap.free < state->heap_low) {
+            state->heap_low = heap.free;
+        }
+        snprintf(line, sizeof(line), "heap free %u (%+d), largest %u, frag %u%%, low %u", heap.free,
+                 state->heap_free ? (int)(heap.free - state->heap_free) : 0, heap.largest, heap.frag_pct,
+                 state->heap_low);
+        tal_cli_echo(line);
+        state->heap_free = heap.free;
+    }
+
+#if defined(ENABLE_MEM_PROFILE) && (ENABLE_MEM_PROFILE == 1)
+    TAL_MEM_TAG_STAT_T *tags = tal_malloc(TAL_MEM_PROFILE_TAGS * sizeof(TAL_MEM_TAG_STAT_T));
+    if (tags) {
+        uint32_t used = 0, cnt = tal_mem_profile_get_tags(tags, TAL_MEM_PROFILE_TAGS);
+        for (uint32_t i = 0; i < cnt; i++) {
+            used += tags[i].live[TAL_MEM_RAM_PSRAM];
+        }
+        tal_free(tags);
+        snprintf(line, sizeof(line), "psram used %u (%+d)", used,
+                 state->psram_used ? (int)(used - state->psram_used) : 0);
+        tal_cli_echo(line);
+        state->psram_used = used;
+    }
+#endif
+}
+
+static void cli_perf_queues(void)
+{
+    char line[CLI_PERF_LINE_LEN];
+    TAL_TIMER_LAG_T lag = {0};
+
+    snprintf(line, sizeof(line), "workq system %u, highpri %u, pool %u", tal_workq_get_num(WORKQ_SYSTEM),
+             tal_workq_get_num(WORKQ_HIGHTPRI), tal_workq_get_num(WORKQ_POOL));
+    tal_cli_echo(line);
+
+    tal_sw_timer_lag_get(&lag);
+    snprintf(line, sizeof(line), "timers running %d, dispatched %u, lag avg %u ms max %u ms", tal_sw_timer_get_num(),
+             lag.dispatched, lag.avg_ms, lag.max_ms);
+    tal_cli_echo(line);
+}
+
+static void cli_perf_metrics(uint32_t interval_ms)
+{
+    char line[CLI_PERF_LINE_LEN];
+    uint32_t i, value;
+    BOOL_T title = FALSE;
+
+    for (i = 0; i < CLI_PERF_METRIC_NUM; i++) {
+        cli_perf_metric_t *metric = &s_perf_metric[i];
+        if (NULL == metric->cb) {
+            continue;
+        }
+        if (!title) {
+            tal_cli_echo("counters");
+            title = TRUE;
+        }
+        value = metric->cb(metric->arg);
+        snprintf(line, sizeof(line), "  %-16s %10u  %+d/s", metric->name, value,
+                 (int)((int64_t)(int32_t)(value - metric->last) * 1000 / interval_ms));
+        tal_cli_echo(line);
+        metric->last = value;
+    }
+}
+
+/**
+ * @brief perf [interval_s] [count], draws count frames interval_s apart
+ */
+void cli_perf(int argc, char *argv[])
+{
+    cli_perf_state_t state = {0};
+    TAL_TIMER_LAG_T lag;
+    uint32_t interval_ms = 1000, count = 1, i;
+    THREAD_PROFILE_T *profile;
+
+    if (argc > 1) {
+        interval_ms = (uint32_t)atoi(argv[1]) * 1000;
+    }
+    if (argc > 2) {
+        count = (uint32_t)atoi(argv[2]);
+    }
+    if (0 == interval_ms || 0 == count || count > CLI_PERF_COUNT_MAX) {
+        tal_cli_echo("usage: perf [interval_s] [count], count 1 ~ 3600");
+        return;
+    }
+
+    profile = tal_malloc(CLI_PERF_THREAD_MAX * sizeof(THREAD_PROFILE_T));
+    if (NULL == profile) {
+        tal_cli_echo("perf: no memory");
+        return;
+    }
+
+    // start the windows, the first frame then covers one interval
+    tal_thread_profile_get(profile, CLI_PERF_THREAD_MAX, NULL);
+    tal_sw_timer_lag_get(&lag);
+    for (i = 0; i < CLI_PERF_METRIC_NUM; i++) {
+        if (s_perf_metric[i].cb) {
+            s_perf_metric[i].last = s_perf_metric[i].cb(s_perf_metric[i].arg);
+        }
+    }
+
+    for (i = 0; i < count; i++) {
+        tal_system_sleep(interval_ms);
+        if (count > 1) {
+            tal_cli_echo(CLI_PERF_CLEAR);
+        }
+        cli_perf_threads(profile);
+        cli_perf_memory(&state);
+        cli_perf_queues();
+        cli_perf_metrics(interval_ms);
+    }
+
+    tal_free(profile);
+}
@@ -125,6 +125,32 @@ int tal_kv_free(uint8_t *value);
  */
 int tal_kv_del(const char *key);
 
+/**
+ * @brief Starts a write-back batch in the TAL Key-Value store.
+ *
+ * Until the matching tal_kv_commit() sets and deletes only update the RAM
+ * cache, so repeated writes of a key reach flash once. A value that does not
+ * fit in the cache is still written straight away. Batches nest, only the
+ * outermost tal_kv_commit() writes to flash.
+ *
+ * @return OPRT_OK
+ */
+int tal_kv_begin(void);
+
+/**
+ * @brief Ends a write-back batch and writes the pending changes to flash.
+ *
+ * The outermost commit flushes every pending set and delete, inner commits
+ * only close their level. Keys are written one after another, the batch is
+ * not atomic across keys: after a power loss or a failed write some keys may
+ * hold the new value and others the old one. A key that fails to write is
+ * dropped from the cache, the remaining keys are still written.
+ *
+ * @return OPRT_OK on success, or the error of the first key that failed to
+ * write.
+ */
+int tal_kv_commit(void);
+
 /**
  * @brief Serializes and sets the value of a key in the key-value database.
  *
@@ -153,6 +179,41 @@ int tal_kv_serialize_set(const char *key, kv_db_t *db, size_t dbcnt);
  */
 int tal_kv_serialize_get(const char *key, kv_db_t *db, size_t dbcnt);
 
+/**
+ * @brief Stores several key-value pairs as one binary record.
+ *
+ * This function packs the provided key-value pairs into a compact binary
+ * record and stores it under the specified key with a single write. The
+ * record is 'K' 'V' version count, then per field name_len:1 name type:1
+ * value_len:2 value, lengths little endian; integer types are stored as 4
+ * byte little endian values, booleans as one byte and strings without the
+ * terminator.
+ *
+ * @param key The key to set in the database.
+ * @param db A pointer to the key-value pairs to store.
+ * @param dbcnt The number of key-value pairs, at most 255.
+ * @return Returns 0 on success, or a negative error code on failure.
+ */
+int tal_kv_set_multi(const char *key, const kv_db_t *db, size_t dbcnt);
+
+/**
+ * @brief Reads several key-value pairs from one stored record.
+ *
+ * This function reads the record stored under the specified key and fills
+ * the key-value pairs matched by name; pairs missing from the record are
+ * zeroed and record fields not in the database are skipped. Both records
+ * written by tal_kv_set_multi() and by tal_kv_serialize_set() are accepted.
+ *
+ * @param key The key to retrieve.
+ * @param db The key-value pairs to fill.
+ * @param dbcnt The number of key-value pairs.
+ *
+ * @return Returns 0 on success, or a negative error code if the key is
+ * missing, a field does not fit or the record is malformed. It does not
+ * return the number of pairs found.
+ */
+int tal_kv_get_multi(const char *key, kv_db_t *db, size_t dbcnt);
+
 /**
  * @brief Executes the TAL KV command.
  *
@@ -167,7 +228,7 @@ void tal_kv_cmd(int argc, char *argv[]);
 /**
  * @brief Get the LFS handle, can be used for file system opeation
  *
- * @return lfs_t *
+ * @return lfs_t *, NULL with the FlashDB backend
  */
 lfs_t *tal_lfs_get();
 
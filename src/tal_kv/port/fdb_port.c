@@ -11,6 +11,9 @@
 
 #include "tkl_flash.h"
 
+// bytes handed to the flash, read by "kv bench" for the write amplification
+uint32_t fdb_port_write_bytes;
+
 static int init(void)
 {
 
@@ -41,6 +44,7 @@ static int write(long offset, const uint8_t *buf, size_t size)
     int ret;
 
     ret = tkl_flash_write(offset, buf, size);
+    fdb_port_write_bytes += size;
 
     return ret;
 }
@@ -275,3 +275,250 @@ ERR_EXIT:
 
     return op_ret;
 }
+
+/*
+ * Binary record used by tal_kv_set_multi():
+ *
+ *   'K' 'V' version count, then per field
+ *   name_len:1 name type:1 value_len:2 value
+ *
+ * Lengths are little endian. Integer types are stored as 4 byte little
+ * endian values, booleans as one byte, strings without the terminator.
+ */
+#define KV_PACK_VERSION 1
+#define KV_PACK_HEAD    4
+
+static bool kv_pack_is_int(kv_tp_t tp)
+{
+    return tp <= KV_INT;
+}
+
+static int32_t kv_pack_int_get(const kv_db_t *db)
+{
+    switch (db->tp) {
+    case KV_CHAR:
+        return *((char *)db->val);
+    case KV_BYTE:
+        return *((uint8_t *)db->val);
+    case KV_SHORT:
+        return *((int16_t *)db->val);
+    case KV_USHORT:
+        return *((uint16_t *)db->val);
+    default:
+        return *((int32_t *)db->val);
+    }
+}
+
+static int kv_pack_int_set(kv_db_t *db, int32_t value)
+{
+    switch (db->tp) {
+    case KV_CHAR:
+        if (value < -128 || value > 127) {
+            return OPRT_COM_ERROR;
+        }
+        *((char *)db->val) = value;
+        break;
+    case KV_BYTE:
+        if (value < 0 || value > 255) {
+            return OPRT_COM_ERROR;
+        }
+        *((uint8_t *)db->val) = value;
+        break;
+    case KV_SHORT:
+        if (value < -32768 || value > 32767) {
+            return OPRT_COM_ERROR;
+        }
+        *((int16_t *)db->val) = value;
+        break;
+    case KV_USHORT:
+        if (value < 0 || value > 65535) {
+            return OPRT_COM_ERROR;
+        }
+        *((uint16_t *)db->val) = value;
+        break;
+    default:
+        *((int32_t *)db->val) = value;
+        break;
+    }
+    return OPRT_OK;
+}
+
+static uint32_t kv_pack_value_len(const kv_db_t *db)
+{
+    if (kv_pack_is_int(db->tp)) {
+        return 4;
+    } else if (db->tp == KV_BOOL) {
+        return 1;
+    } else if (db->tp == KV_STRING) {
+        return strlen((char *)db->val);
+    }
+    return db->len;
+}
+
+/**
+ * @brief Packs the key-value pairs into the binary multi-key record.
+ *
+ * @param db The key-value pairs.
+ * @param dbcnt The number of key-value pairs, at most 255.
+ * @param out The record, free with tal_free().
+ * @param out_len The length of the record.
+ * @return Returns OPRT_OK on success, otherwise an error code.
+ */
+int kv_pack(const kv_db_t *db, const uint32_t dbcnt, uint8_t **out, uint32_t *out_len)
+{
+    uint32_t len = KV_PACK_HEAD;
+    uint32_t i = 0;
+
+    if (dbcnt > 0xFF) {
+        return OPRT_INVALID_PARM;
+    }
+    for (i = 0; i < dbcnt; i++) {
+        size_t name_len = strlen(db[i].key);
+        uint32_t value_len = kv_pack_value_len(&db[i]);
+        if (name_len > 0xFF || value_len > 0xFFFF || db[i].tp > KV_RAW) {
+            PR_ERR("kv pack %s invalid", db[i].key);
+            return OPRT_INVALID_PARM;
+        }
+        len += 1 + name_len + 1 + 2 + value_len;
+    }
+
+    uint8_t *buf = tal_malloc(len);
+    if (NULL == buf) {
+        PR_ERR("maloc fails %d", len);
+        return OPRT_MALLOC_FAILED;
+    }
+
+    uint8_t *p = buf;
+    *p++ = 'K';
+    *p++ = 'V';
+    *p++ = KV_PACK_VERSION;
+    *p++ = dbcnt;
+    for (i = 0; i < dbcnt; i++) {
+        size_t name_len = strlen(db[i].key);
+        uint32_t value_len = kv_pack_value_len(&db[i]);
+
+        *p++ = name_len;
+        memcpy(p, db[i].key, name_len);
+        p += name_len;
+        *p++ = db[i].tp;
+        *p++ = value_len & 0xFF;
+        *p++ = value_len >> 8;
+        if (kv_pack_is_int(db[i].tp)) {
+            uint32_t value = (uint32_t)kv_pack_int_get(&db[i]);
+            *p++ = value & 0xFF;
+            *p++ = (value >> 8) & 0xFF;
+            *p++ = (value >> 16) & 0xFF;
+            *p++ = value >> 24;
+        } else if (db[i].tp == KV_BOOL) {
+            *p++ = *((BOOL_T *)db[i].val) ? 1 : 0;
+        } else {
+            memcpy(p, db[i].val, value_len);
+            p += value_len;
+        }
+    }
+
+    *out = buf;
+    *out_len = len;
+    return OPRT_OK;
+}
+
+/**
+ * @brief Tells a binary multi-key record from a kv_serialize() one.
+ *
+ * @param in The stored value.
+ * @param len The length of the value.
+ * @return TRUE for a kv_pack() record.
+ */
+bool kv_pack_check(const uint8_t *in, uint32_t len)
+{
+    return len >= KV_PACK_HEAD && in[0] == 'K' && in[1] == 'V' && in[2] == KV_PACK_VERSION;
+}
+
+/**
+ * @brief Unpacks a binary multi-key record into the key-value pairs.
+ *
+ * Fields missing from the record are left zeroed, like kv_deserialize() does.
+ * For KV_RAW the length is updated to the stored length.
+ *
+ * @param in The record.
+ * @param len The length of the record.
+ * @param db The key-value pairs to fill.
+ * @param dbcnt The number of key-value pairs.
+ * @return Returns OPRT_OK on success, otherwise an error code.
+ */
+int kv_unpack(const uint8_t *in, uint32_t len, kv_db_t *db, const uint32_t dbcnt)
+{
+    if (!kv_pack_check(in, len)) {
+        return OPRT_INVALID_PARM;
+    }
+
+    uint32_t i = 0;
+    for (i = 0; i < dbcnt; i++) {
+        memset(db[i].val, 0, db[i].len);
+    }
+
+    const uint8_t *p = in + KV_PACK_HEAD;
+    const uint8_t *end = in + len;
+    for (uint8_t field = 0; field < in[3]; field++) {
+        if (p >= end || (uint32_t)(end - p) < 1 + p[0] + 3) {
+            PR_ERR("kv unpack truncated");
+            return OPRT_COM_ERROR;
+        }
+        uint8_t name_len = *p++;
+        const char *name = (const char *)p;
+        p += name_len;
+        kv_tp_t tp = *p++;
+        uint32_t value_len = p[0] | (p[1] << 8);
+        p += 2;
+        if ((uint32_t)(end - p) < value_len) {
+            PR_ERR("kv unpack truncated");
+            return OPRT_COM_ERROR;
+        }
+        const uint8_t *value = p;
+        p += value_len;
+
+        for (i = 0; i < dbcnt; i++) {
+            if (strlen(db[i].key) == name_len && 0 == memcmp(db[i].key, name, name_len)) {
+                break;
+            }
+        }
+        if (i == dbcnt) {
+            continue;
+        }
+        if (tp != db[i].tp && !(kv_pack_is_int(tp) && kv_pack_is_int(db[i].tp))) {
+            PR_ERR("kv unpack %s type %d-%d", db[i].key, tp, db[i].tp);
+            return OPRT_COM_ERROR;
+        }
+
+        int op_ret = OPRT_OK;
+        if (kv_pack_is_int(tp)) {
+            if (value_len != 4) {
+                return OPRT_COM_ERROR;
+            }
+            uint32_t v = value[0] | (value[1] << 8) | (value[2] << 16) | ((uint32_t)value[3] << 24);
+            op_ret = kv_pack_int_set(&db[i], (int32_t)v);
+        } else if (tp == KV_BOOL) {
+            *((BOOL_T *)db[i].val) = (value_len && value[0]) ? 1 : 0;
+        } else if (tp == KV_STRING) {
+            if (value_len >= db[i].len) {
+                op_ret = OPRT_COM_ERROR;
+            } else {
+                memcpy(db[i].val, value, value_len);
+                ((char *)db[i].val)[value_len] = 0;
+            }
+        } else {
+            if (value_len > db[i].len) {
+                op_ret = OPRT_COM_ERROR;
+            } else {
+                memcpy(db[i].val, value, value_len);
+                db[i].len = value_len;
+            }
+        }
+        if (OPRT_OK != op_ret) {
+            PR_ERR("kv unpack %s fails", db[i].key);
+            return op_ret;
+        }
+    }
+
+    return OPRT_OK;
+}
@@ -20,25 +20,83 @@
  * applications. It requires the LittleFS library and Tuya's hardware
  * abstraction libraries for proper functionality.
  *
+ * With ENABLE_KV_FLASHDB the encrypted values are stored as FlashDB KVDB
+ * blobs instead, the __kv_store_* functions are the backend boundary.
+ *
  * @copyright Copyright (c) 2021-2024 Tuya Inc. All Rights Reserved.
  *
  */
 
+#include <stdlib.h>
 #include "tal_kv.h"
-#include "lfs_config.h"
 #include "tkl_flash.h"
 #include "tal_api.h"
 #include "tal_security.h"
 
+#if defined(ENABLE_KV_FLASHDB) && (ENABLE_KV_FLASHDB == 1)
+#include "flashdb.h"
+
+#define KV_USING_FLASHDB 1
+
+// KVDB partition in fal_cfg.h
+#ifndef TAL_KV_FDB_PART
+#define TAL_KV_FDB_PART "fdb_kvdb1"
+#endif
+
+// missing key as returned by the backend read
+#define KV_ERR_NOENT OPRT_NOT_FOUND
+
+static struct fdb_kvdb kvdb;
+// bytes the FlashDB port wrote to flash, see fdb_port.c
+extern uint32_t fdb_port_write_bytes;
+#else
+#include "lfs_config.h"
+
+#define KV_ERR_NOENT LFS_ERR_NOENT
+
 // variables used by the filesystem
 static lfs_t lfs;
 static lfs_size_t lfs_flash_addr;
+static uint32_t lfs_prog_bytes;
+#endif
+
 static tal_kv_cfg_t lfs_kv_cfg;
 static MUTEX_HANDLE lfs_mutex;
 
+/*
+ * Decrypted values are kept in a small RAM cache, most recently used first.
+ * Inside tal_kv_begin()/tal_kv_commit() writes stay dirty in the cache and
+ * reach flash at commit. Files changed through tal_lfs_get() bypass it.
+ */
+#ifndef TAL_KV_CACHE_NUM
+#define TAL_KV_CACHE_NUM 8 // cached keys, 0 disables the cache and write-back
+#endif
+#ifndef TAL_KV_CACHE_VALUE_MAX
+#define TAL_KV_CACHE_VALUE_MAX 1024 // larger values always go to flash
+#endif
+#ifndef TAL_KV_BENCH_VALUE_LEN
+#define TAL_KV_BENCH_VALUE_LEN 64 // default value size of "kv bench"
+#endif
+
+typedef struct tal_kv_cache_node {
+    struct tal_kv_cache_node *next;
+    uint8_t *value; // NULL for a pending delete
+    size_t length;
+    bool dirty;
+    char key[];
+} tal_kv_cache_node_t;
+
+static tal_kv_cache_node_t *s_kv_cache;
+static uint32_t s_kv_cache_num;
+static uint32_t s_kv_write_back;
+
 extern int kv_serialize(const kv_db_t *db, const uint32_t dbcnt, char **out, uint32_t *out_len);
 extern int kv_deserialize(const char *in, kv_db_t *db, const uint32_t dbcnt);
+extern int kv_pack(const kv_db_t *db, const uint32_t dbcnt, uint8_t **out, uint32_t *out_len);
+extern bool kv_pack_check(const uint8_t *in, uint32_t len);
+extern int kv_unpack(const uint8_t *in, uint32_t len, kv_db_t *db, const uint32_t dbcnt);
 
+#if !KV_USING_FLASHDB
 /**
  * Reads data from a user-provided block device.
  *
@@ -87,6 +145,7 @@ int user_provided_block_device_prog(const struct lfs_config *c, lfs_block_t bloc
     if (OPRT_OK != ret) {
         return LFS_ERR_IO;
     }
+    lfs_prog_bytes += size;
     return LFS_ERR_OK;
 }
 
@@ -126,6 +185,8 @@ int user_provided_block_device_sync(const struct lfs_config *c)
     return LFS_ERR_OK;
 }
 
+#endif
+
 /**
  * @brief Initializes the TAL Key-Value (KV) module.
  *
@@ -148,6 +209,15 @@ int tal_kv_init(tal_kv_cfg_t *kv_cfg)
 
     tal_mutex_create_init(&lfs_mutex);
 
+#if KV_USING_FLASHDB
+    /* the calls are serialized by lfs_mutex, FlashDB needs no lock of its own */
+    fdb_err_t fdb_ret = fdb_kvdb_init(&kvdb, "kv", TAL_KV_FDB_PART, NULL, NULL);
+    if (FDB_NO_ERR != fdb_ret) {
+        PR_ERR("fdb kvdb init err %d", fdb_ret);
+        return OPRT_COM_ERROR;
+    }
+    return OPRT_OK;
+#else
     TUYA_FLASH_BASE_INFO_T info;
     tkl_flash_get_one_type_info(TUYA_FLASH_TYPE_UF, &info);
     lfs_flash_addr = info.partition[0].start_addr;
@@ -179,6 +249,296 @@ int tal_kv_init(tal_kv_cfg_t *kv_cfg)
     }
 
     return err;
+#endif
+}
+
+#if KV_USING_FLASHDB
+static int __kv_store_write(const char *key, const uint8_t *data, uint32_t len)
+{
+    struct fdb_blob blob;
+
+    fdb_err_t fdb_ret = fdb_kv_set_blob(&kvdb, key, fdb_blob_make(&blob, data, len));
+    if (FDB_NO_ERR != fdb_ret) {
+        PR_ERR("kv write fail %d", fdb_ret);
+        return OPRT_KVS_WR_FAIL;
+    }
+    return OPRT_OK;
+}
+
+static int __kv_store_read(const char *key, uint8_t **data, uint32_t *len)
+{
+    struct fdb_kv kv;
+    struct fdb_blob blob;
+
+    if (NULL == fdb_kv_get_obj(&kvdb, key, &kv)) {
+        PR_ERR("fdb get %s err", key);
+        return OPRT_NOT_FOUND;
+    }
+    uint8_t *buf = tal_malloc(kv.value_len + 1);
+    if (NULL == buf) {
+        return OPRT_MALLOC_FAILED;
+    }
+    fdb_kv_to_blob(&kv, fdb_blob_make(&blob, buf, kv.value_len));
+    if (fdb_blob_read((fdb_db_t)&kvdb, &blob) != kv.value_len || 0 == kv.value_len) {
+        tal_free(buf);
+        PR_ERR("kv read error");
+        return OPRT_KVS_RD_FAIL;
+    }
+    *data = buf;
+    *len = kv.value_len;
+    return OPRT_OK;
+}
+
+static int __kv_store_remove(const char *key)
+{
+    struct fdb_kv kv;
+
+    if (NULL == fdb_kv_get_obj(&kvdb, key, &kv)) {
+        return OPRT_NOT_FOUND;
+    }
+    return (FDB_NO_ERR == fdb_kv_del(&kvdb, key)) ? OPRT_OK : OPRT_COM_ERROR;
+}
+
+static bool __kv_store_exist(const char *key)
+{
+    struct fdb_kv kv;
+
+    return NULL != fdb_kv_get_obj(&kvdb, key, &kv);
+}
+
+static uint32_t __kv_store_written(void)
+{
+    return fdb_port_write_bytes;
+}
+#else
+static int __kv_store_write(const char *key, const uint8_t *data, uint32_t len)
+{
+    int result;
+    lfs_file_t file;
+
+    result = lfs_file_open(&lfs, &file, key, LFS_O_RDWR | LFS_O_CREAT | LFS_O_TRUNC);
+    if (LFS_ERR_OK != result) {
+        PR_ERR("lfs open %s err", key);
+        return result;
+    }
+    result = lfs_file_write(&lfs, &file, data, len);
+    lfs_file_close(&lfs, &file);
+    if (result != len) {
+        PR_ERR("kv write fail %d", result);
+        return OPRT_KVS_WR_FAIL;
+    }
+    return OPRT_OK;
+}
+
+static int __kv_store_read(const char *key, uint8_t **data, uint32_t *len)
+{
+    int result;
+    lfs_file_t file;
+
+    result = lfs_file_open(&lfs, &file, key, LFS_O_RDONLY);
+    if (LFS_ERR_OK != result) {
+        PR_ERR("lfs open %s %d err", key, result);
+        return result;
+    }
+    uint32_t size = lfs_file_size(&lfs, &file);
+    uint8_t *buf = tal_malloc(size + 1);
+    if (NULL == buf) {
+        lfs_file_close(&lfs, &file);
+        return OPRT_MALLOC_FAILED;
+    }
+    result = lfs_file_read(&lfs, &file, buf, size);
+    lfs_file_close(&lfs, &file);
+    if (result <= 0) {
+        tal_free(buf);
+        PR_ERR("kv read error %d", result);
+        return OPRT_KVS_RD_FAIL;
+    }
+    *data = buf;
+    *len = result;
+    return OPRT_OK;
+}
+
+static int __kv_store_remove(const char *key)
+{
+    int result = lfs_remove(&lfs, key);
+    if (LFS_ERR_NOENT == result) {
+        return OPRT_NOT_FOUND;
+    }
+    return (LFS_ERR_OK == result) ? OPRT_OK : OPRT_COM_ERROR;
+}
+
+static bool __kv_store_exist(const char *key)
+{
+    struct lfs_info info;
+
+    return LFS_ERR_OK == lfs_stat(&lfs, key, &info);
+}
+
+static uint32_t __kv_store_written(void)
+{
+    return lfs_prog_bytes;
+}
+#endif
+
+/* the stored value is AES-128-CBC encrypted, called with lfs_mutex held */
+static int __kv_file_write(const char *key, const uint8_t *value, size_t length)
+{
+    int result;
+    uint8_t *ec_data = NULL;
+    uint32_t ec_len = 0;
+    uint8_t iv[16];
+
+    memcpy(iv, lfs_kv_cfg.seed, 16);
+    result =
+        tal_aes128_cbc_encode((uint8_t *)value, length, (uint8_t *)lfs_kv_cfg.key, iv, &ec_data, (uint32_t *)&ec_len);
+    if (OPRT_OK != result) {
+        PR_DEBUG("key %s encrypt failed", key);
+        return result;
+    }
+    result = __kv_store_write(key, ec_data, ec_len);
+    tal_aes_free_data(ec_data);
+
+    return result;
+}
+
+/* read and decrypt a value, called with lfs_mutex held */
+static int __kv_file_read(const char *key, uint8_t **value, size_t *length)
+{
+    int result;
+    uint8_t *ec_data = NULL;
+    uint32_t ec_len = 0;
+
+    *length = 0;
+    result = __kv_store_read(key, &ec_data, &ec_len);
+    if (OPRT_OK != result) {
+        return result;
+    }
+    PR_DEBUG("key:%s, len:%d", key, ec_len);
+
+    uint8_t *dec_data = NULL;
+    uint32_t dec_len = 0;
+    uint8_t iv[16];
+
+    memcpy(iv, lfs_kv_cfg.seed, 16);
+    result = tal_aes128_cbc_decode(ec_data, ec_len, (uint8_t *)lfs_kv_cfg.key, iv, &dec_data, (uint32_t *)&dec_len);
+    dec_len = tal_aes_get_actual_length(dec_data, dec_len);
+    tal_free(ec_data);
+    if (OPRT_OK != result || dec_len > ec_len) {
+        PR_ERR("key %s decrypt failed %d, %d-%d", key, result, dec_len, ec_len);
+        if (dec_data) {
+            tal_free(dec_data);
+        }
+        return OPRT_BUFFER_NOT_ENOUGH;
+    }
+    *value = dec_data;
+    *length = (size_t)dec_len;
+    dec_data[dec_len] = 0;
+
+    return OPRT_OK;
+}
+
+/* copy of a value with the NUL terminator tal_kv_get() callers expect */
+static uint8_t *__kv_value_dup(const uint8_t *value, size_t length)
+{
+    uint8_t *copy = tal_malloc(length + 1);
+    if (copy) {
+        memcpy(copy, value, length);
+        copy[length] = 0;
+    }
+    return copy;
+}
+
+static void __kv_cache_drop(tal_kv_cache_node_t **link)
+{
+    tal_kv_cache_node_t *node = *link;
+
+    *link = node->next;
+    if (node->value) {
+        memset(node->value, 0, node->length);
+        tal_free(node->value);
+    }
+    tal_free(node);
+    s_kv_cache_num--;
+}
+
+/* find a cached key, the hit moves to the front */
+static tal_kv_cache_node_t *__kv_cache_find(const char *key)
+{
+    for (tal_kv_cache_node_t **link = &s_kv_cache; *link; link = &(*link)->next) {
+        tal_kv_cache_node_t *node = *link;
+        if (0 == strcmp(node->key, key)) {
+            *link = node->next;
+            node->next = s_kv_cache;
+            s_kv_cache = node;
+            return node;
+        }
+    }
+    return NULL;
+}
+
+static void __kv_cache_remove(const char *key)
+{
+    if (__kv_cache_find(key)) {
+        __kv_cache_drop(&s_kv_cache);
+    }
+}
+
+/**
+ * keep a value in the cache, NULL value marks a pending delete. Fails when
+ * the value is too large or every slot holds an uncommitted write.
+ */
+static int __kv_cache_put(const char *key, const uint8_t *value, size_t length, bool dirty)
+{
+    if (value && length > TAL_KV_CACHE_VALUE_MAX) {
+        __kv_cache_remove(key);
+        return OPRT_EXCEED_UPPER_LIMIT;
+    }
+
+    uint8_t *copy = NULL;
+    if (value) {
+        copy = __kv_value_dup(value, length);
+        if (NULL == copy) {
+            __kv_cache_remove(key);
+            return OPRT_MALLOC_FAILED;
+        }
+    }
+
+    tal_kv_cache_node_t *node = __kv_cache_find(key);
+    if (NULL == node) {
+        if (s_kv_cache_num >= TAL_KV_CACHE_NUM) {
+            /* evict the least recently used clean value */
+            tal_kv_cache_node_t **victim = NULL;
+            for (tal_kv_cache_node_t **link = &s_kv_cache; *link; link = &(*link)->next) {
+                if (!(*link)->dirty) {
+                    victim = link;
+                }
+            }
+            if (NULL == victim) {
+                tal_free(copy);
+                return OPRT_EXCEED_UPPER_LIMIT;
+            }
+            __kv_cache_drop(victim);
+        }
+
+        node = tal_malloc(sizeof(tal_kv_cache_node_t) + strlen(key) + 1);
+        if (NULL == node) {
+            tal_free(copy);
+            return OPRT_MALLOC_FAILED;
+        }
+        memset(node, 0, sizeof(tal_kv_cache_node_t));
+        strcpy(node->key, key);
+        node->next = s_kv_cache;
+        s_kv_cache = node;
+        s_kv_cache_num++;
+    } else if (node->value) {
+        memset(node->value, 0, node->length);
+        tal_free(node->value);
+    }
+
+    node->value = copy;
+    node->length = length;
+    node->dirty = dirty;
+    return OPRT_OK;
 }
 
 /**
@@ -186,7 +546,8 @@ int tal_kv_init(tal_kv_cfg_t *kv_cfg)
  *
  * This function sets a key-value pair in the key-value store. The key is a
  * string, the value is a byte array, and the length specifies the number of
- * bytes in the value.
+ * bytes in the value. Between tal_kv_begin() and tal_kv_commit() the value
+ * is only kept in RAM, unless the cache has no room for it.
  *
  * @param key The key to set in the key-value store.
  * @param value The value to associate with the key.
@@ -197,7 +558,6 @@ int tal_kv_init(tal_kv_cfg_t *kv_cfg)
 int tal_kv_set(const char *key, const uint8_t *value, size_t length)
 {
     int result;
-    lfs_file_t file;
 
     PR_DEBUG("key:%s, len %d", key, length);
 
@@ -206,36 +566,20 @@ int tal_kv_set(const char *key, const uint8_t *value, size_t length)
     }
 
     tal_mutex_lock(lfs_mutex);
-    result = lfs_file_open(&lfs, &file, key, LFS_O_RDWR | LFS_O_CREAT | LFS_O_TRUNC);
-    if (LFS_ERR_OK != result) {
+    if (s_kv_write_back && OPRT_OK == __kv_cache_put(key, value, length, TRUE)) {
         tal_mutex_unlock(lfs_mutex);
-        PR_ERR("lfs open %s err", key);
-        return result;
+        return OPRT_OK;
     }
-    uint8_t *ec_data = NULL;
-    uint32_t ec_len = 0;
-    uint8_t iv[16];
 
-    memcpy(iv, lfs_kv_cfg.seed, 16);
-    result =
-        tal_aes128_cbc_encode((uint8_t *)value, length, (uint8_t *)lfs_kv_cfg.key, iv, &ec_data, (uint32_t *)&ec_len);
-    if (OPRT_OK != result) {
-        lfs_file_close(&lfs, &file);
-        tal_mutex_unlock(lfs_mutex);
-        PR_DEBUG("key %s encrypt failed", key);
-        return result;
+    result = __kv_file_write(key, value, length);
+    if (OPRT_OK == result) {
+        __kv_cache_put(key, value, length, FALSE);
+    } else {
+        __kv_cache_remove(key);
     }
-    lfs_file_rewind(&lfs, &file);
-    result = lfs_file_write(&lfs, &file, ec_data, ec_len);
-    lfs_file_close(&lfs, &file);
-    tal_aes_free_data(ec_data);
     tal_mutex_unlock(lfs_mutex);
-    if (result != ec_len) {
-        PR_ERR("kv write fail %d", result);
-        return OPRT_KVS_WR_FAIL;
-    }
 
-    return OPRT_OK;
+    return result;
 }
 
 /**
@@ -244,7 +588,8 @@ int tal_kv_set(const char *key, const uint8_t *value, size_t length)
  *
  * This function retrieves the value associated with the specified key from the
  * key-value store. The retrieved value is stored in the `value` parameter, and
- * its length is stored in the `length` parameter.
+ * its length is stored in the `length` parameter. Recently used values are
+ * served from the RAM cache without touching flash.
  *
  * @param key The key to retrieve the value for.
  * @param value A pointer to a pointer that will store the retrieved value.
@@ -257,61 +602,38 @@ int tal_kv_set(const char *key, const uint8_t *value, size_t length)
 int tal_kv_get(const char *key, uint8_t **value, size_t *length)
 {
     int result;
-    lfs_file_t file;
 
     if (NULL == key || NULL == value || NULL == length) {
         return OPRT_INVALID_PARM;
     }
 
     tal_mutex_lock(lfs_mutex);
-    result = lfs_file_open(&lfs, &file, key, LFS_O_RDONLY);
-    if (LFS_ERR_OK != result) {
-        PR_ERR("lfs open %s %d err", key, result);
+    tal_kv_cache_node_t *node = __kv_cache_find(key);
+    if (node) {
+        if (NULL == node->value) {
+            tal_mutex_unlock(lfs_mutex);
+            return KV_ERR_NOENT;
+        }
+        *value = __kv_value_dup(node->value, node->length);
+        *length = node->length;
         tal_mutex_unlock(lfs_mutex);
-        return result;
+        return *value ? OPRT_OK : OPRT_MALLOC_FAILED;
     }
-    uint8_t *ec_data = NULL;
-    uint32_t ec_len = lfs_file_size(&lfs, &file);
 
-    ec_data = tal_malloc(ec_len + 1);
-    if (NULL == ec_data) {
-        result = OPRT_MALLOC_FAILED;
-        tal_mutex_unlock(lfs_mutex);
-        return result;
+    result = __kv_file_read(key, value, length);
+    if (OPRT_OK == result) {
+        __kv_cache_put(key, *value, *length, FALSE);
     }
-    PR_DEBUG("key:%s, len:%d", key, ec_len);
-    result = lfs_file_read(&lfs, &file, ec_data, ec_len);
-    lfs_file_close(&lfs, &file);
     tal_mutex_unlock(lfs_mutex);
-    if (result <= 0) {
-        *length = 0;
-        tal_free(ec_data);
-        PR_ERR("kv read error %d", result);
-        return OPRT_KVS_RD_FAIL;
-    }
-    uint8_t *dec_data = NULL;
-    uint32_t dec_len = 0;
-    uint8_t iv[16];
 
-    memcpy(iv, lfs_kv_cfg.seed, 16);
-    result = tal_aes128_cbc_decode(ec_data, ec_len, (uint8_t *)lfs_kv_cfg.key, iv, &dec_data, (uint32_t *)&dec_len);
-    dec_len = tal_aes_get_actual_length(dec_data, dec_len);
-    tal_free(ec_data);
-    if (OPRT_OK != result || dec_len > ec_len) {
-        PR_ERR("key %s decrypt failed %d, %d-%d", key, result, dec_len, ec_len);
-        return OPRT_BUFFER_NOT_ENOUGH;
-    }
-    *value = dec_data;
-    *length = (size_t)dec_len;
-    dec_data[dec_len] = 0;
-
-    return OPRT_OK;
+    return result;
 }
 
 /**
  * @brief Deletes the specified key from the TAL Key-Value store.
  *
  * This function deletes the specified key from the TAL Key-Value store.
+ * Between tal_kv_begin() and tal_kv_commit() the file is removed at commit.
  *
  * @param key The key to be deleted.
  * @return 0 if the key was successfully deleted, or a negative error code if an
@@ -319,12 +641,23 @@ int tal_kv_get(const char *key, uint8_t **value, size_t *length)
  */
 int tal_kv_del(const char *key)
 {
+    int result;
+
     PR_DEBUG("key:%s", key);
 
     tal_mutex_lock(lfs_mutex);
-    int result = lfs_remove(&lfs, key);
+    tal_kv_cache_node_t *node = __kv_cache_find(key);
+    if (s_kv_write_back && ((node && node->value) || __kv_store_exist(key))) {
+        if (OPRT_OK == __kv_cache_put(key, NULL, 0, TRUE)) {
+            tal_mutex_unlock(lfs_mutex);
+            return OPRT_OK;
+        }
+    }
+
+    __kv_cache_remove(key);
+    result = __kv_store_remove(key);
     tal_mutex_unlock(lfs_mutex);
-    if (LFS_ERR_OK == result) {
+    if (OPRT_OK == result) {
         PR_DEBUG("Deleted successfully");
         return OPRT_OK;
     }
@@ -334,6 +667,76 @@ int tal_kv_del(const char *key)
     return OPRT_COM_ERROR;
 }
 
+/**
+ * @brief Starts a write-back batch.
+ *
+ * Until the matching tal_kv_commit() sets and deletes only update the RAM
+ * cache, so repeated writes of a key reach flash once. Batches nest.
+ *
+ * @return OPRT_OK
+ */
+int tal_kv_begin(void)
+{
+    tal_mutex_lock(lfs_mutex);
+    s_kv_write_back++;
+    tal_mutex_unlock(lfs_mutex);
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief Ends a write-back batch and writes the pending changes to flash.
+ *
+ * The outermost commit flushes every pending set and delete. A failed key is
+ * dropped from the cache and the first error is returned, the other keys are
+ * still written.
+ *
+ * @return OPRT_OK on success, or the first flash error
+ */
+int tal_kv_commit(void)
+{
+    int ret = OPRT_OK;
+
+    tal_mutex_lock(lfs_mutex);
+    if (s_kv_write_back > 1) {
+        s_kv_write_back--;
+        tal_mutex_unlock(lfs_mutex);
+        return OPRT_OK;
+    }
+    s_kv_write_back = 0;
+
+    tal_kv_cache_node_t **link = &s_kv_cache;
+    while (*link) {
+        tal_kv_cache_node_t *node = *link;
+        if (!node->dirty) {
+            link = &node->next;
+            continue;
+        }
+
+        int result = OPRT_OK;
+        if (node->value) {
+            result = __kv_file_write(node->key, node->value, node->length);
+        } else {
+            result = __kv_store_remove(node->key);
+            result = (OPRT_NOT_FOUND == result) ? OPRT_OK : result;
+        }
+        if (OPRT_OK != result && OPRT_OK == ret) {
+            PR_ERR("kv commit %s fail %d", node->key, result);
+            ret = result;
+        }
+
+        if (OPRT_OK != result || NULL == node->value) {
+            __kv_cache_drop(link);
+        } else {
+            node->dirty = FALSE;
+            link = &node->next;
+        }
+    }
+    tal_mutex_unlock(lfs_mutex);
+
+    return ret;
+}
+
 /**
  * @brief Frees the memory allocated for a value in the TAL Key-Value store.
  *
@@ -354,6 +757,64 @@ int tal_kv_free(uint8_t *value)
     return OPRT_OK;
 }
 
+/* time set and get of distinct keys and count the flash bytes written per
+ * value byte, the same run on both backends compares them */
+static void __kv_bench(int count, int value_len)
+{
+    char key[16];
+    uint8_t *value = NULL;
+    size_t length = 0;
+
+    if (count <= 0 || value_len <= 0) {
+        return;
+    }
+    uint8_t *data = tal_malloc(value_len);
+    if (NULL == data) {
+        return;
+    }
+    memset(data, 0xA5, value_len);
+
+    tal_mutex_lock(lfs_mutex);
+    uint32_t written = __kv_store_written();
+    tal_mutex_unlock(lfs_mutex);
+
+    SYS_TIME_T start = tal_system_get_millisecond();
+    for (int i = 0; i < count; i++) {
+        snprintf(key, sizeof(key), "kvb%d", i);
+        tal_kv_set(key, data, value_len);
+    }
+    SYS_TIME_T set_ms = tal_system_get_millisecond() - start;
+
+    tal_mutex_lock(lfs_mutex);
+    written = __kv_store_written() - written;
+    /* drop the cached copies so get reads the flash */
+    while (s_kv_cache) {
+        __kv_cache_drop(&s_kv_cache);
+    }
+    tal_mutex_unlock(lfs_mutex);
+
+    start = tal_system_get_millisecond();
+    for (int i = 0; i < count; i++) {
+        snprintf(key, sizeof(key), "kvb%d", i);
+        if (OPRT_OK == tal_kv_get(key, &value, &length)) {
+            tal_kv_free(value);
+        }
+    }
+    SYS_TIME_T get_ms = tal_system_get_millisecond() - start;
+
+    for (int i = 0; i < count; i++) {
+        snprintf(key, sizeof(key), "kvb%d", i);
+        tal_kv_del(key);
+    }
+    tal_free(data);
+
+    uint32_t payload = (uint32_t)count * value_len;
+    PR_NOTICE("kv bench %d x %d bytes: set %u us/op, get %u us/op", count, value_len,
+              (uint32_t)(set_ms * 1000 / count), (uint32_t)(get_ms * 1000 / count));
+    PR_NOTICE("kv bench flash written %u bytes, amplification %u.%02u", written, written / payload,
+              (written % payload) * 100 / payload);
+}
+
 /**
  * @brief Executes the TAL KV command.
  *
@@ -381,6 +842,9 @@ void tal_kv_cmd(int argc, char *argv[])
     } else if (0 == strcmp("del", argv[1])) {
         tal_kv_del(argv[2]);
     } else if (0 == strcmp("list", argv[1])) {
+#if KV_USING_FLASHDB
+        fdb_kv_print(&kvdb);
+#else
         lfs_dir_t dir;
         lfs_dir_open(&lfs, &dir, argv[2]);
         struct lfs_info info;
@@ -389,6 +853,9 @@ void tal_kv_cmd(int argc, char *argv[])
         }
         PR_DEBUG_RAW("\r\n", info.name);
         lfs_dir_close(&lfs, &dir);
+#endif
+    } else if (0 == strcmp("bench", argv[1])) {
+        __kv_bench(atoi(argv[2]), (argc > 3) ? atoi(argv[3]) : TAL_KV_BENCH_VALUE_LEN);
     }
 }
 
@@ -467,6 +934,80 @@ int tal_kv_serialize_get(const char *key, kv_db_t *db, size_t dbcnt)
     return ret;
 }
 
+/**
+ * @brief Writes several fields as one binary record under one key.
+ *
+ * The fields are packed into a compact fixed-layout record and stored with a
+ * single encrypted file write, so they are updated together.
+ *
+ * @param key The key to store the record under.
+ * @param db The fields to store.
+ * @param dbcnt The number of fields, at most 255.
+ * @return Returns OPRT_OK if the operation is successful, otherwise returns an
+ * error code.
+ */
+int tal_kv_set_multi(const char *key, const kv_db_t *db, size_t dbcnt)
+{
+    if (NULL == key || NULL == db || 0 == dbcnt) {
+        return OPRT_INVALID_PARM;
+    }
+
+    uint8_t *buf = NULL;
+    uint32_t len = 0;
+    int ret = kv_pack(db, dbcnt, &buf, &len);
+    if (OPRT_OK != ret) {
+        PR_ERR("kv_pack fail. %d", ret);
+        return ret;
+    }
+    ret = tal_kv_set(key, buf, len);
+    tal_free(buf);
+    if (OPRT_OK != ret) {
+        PR_ERR("kv_set fails %s %d", key, ret);
+    }
+
+    return ret;
+}
+
+/**
+ * @brief Reads several fields from a record written by tal_kv_set_multi().
+ *
+ * Fields are matched by name, so fields may be added or reordered between
+ * firmware versions; missing ones are zeroed. A record written by
+ * tal_kv_serialize_set() is read as well, so callers can switch over without
+ * a migration step.
+ *
+ * @param key The key the record is stored under.
+ * @param db The fields to fill.
+ * @param dbcnt The number of fields.
+ * @return Returns OPRT_OK if the operation is successful, otherwise returns an
+ * error code.
+ */
+int tal_kv_get_multi(const char *key, kv_db_t *db, size_t dbcnt)
+{
+    if (NULL == key || NULL == db || 0 == dbcnt) {
+        return OPRT_INVALID_PARM;
+    }
+
+    uint8_t *buf = NULL;
+    size_t len = 0;
+    int ret = tal_kv_get(key, &buf, &len);
+    if (OPRT_OK != ret) {
+        PR_ERR("kv_get fails %s %d", key, ret);
+        return ret;
+    }
+    if (kv_pack_check(buf, len)) {
+        ret = kv_unpack(buf, len, db, dbcnt);
+    } else {
+        ret = kv_deserialize((char *)buf, db, dbcnt);
+    }
+    tal_free(buf);
+    if (OPRT_OK != ret) {
+        PR_ERR("kv record %s fail. %d", key, ret);
+    }
+
+    return ret;
+}
+
 /**
  * @brief Get the LFS handle, can be used for file system opeation
  *
@@ -474,5 +1015,9 @@ int tal_kv_serialize_get(const char *key, kv_db_t *db, size_t dbcnt)
  */
 lfs_t *tal_lfs_get()
 {
+#if KV_USING_FLASHDB
+    return NULL;
+#else
     return &lfs;
+#endif
 }
\ No newline at end of file
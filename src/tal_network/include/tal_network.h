@@ -37,6 +37,57 @@ extern "C" {
 /* tuya sdk definition of 255.255.255.255 */
 #define TY_IPADDR_BROADCAST ((uint32_t)0xffffffffUL)
 
+/* domains kept by the tal_net_gethostbyname cache, 0 disables it */
+#ifndef TAL_NET_DNS_CACHE_NUM
+#define TAL_NET_DNS_CACHE_NUM 8
+#endif
+/* lifetime of a cached address, the resolvers do not report the record TTL */
+#ifndef TAL_NET_DNS_CACHE_TTL_S
+#define TAL_NET_DNS_CACHE_TTL_S 600
+#endif
+/* a lookup this close to expiry refreshes the address in the background */
+#ifndef TAL_NET_DNS_REFRESH_S
+#define TAL_NET_DNS_REFRESH_S 60
+#endif
+
+/* buffer tal_net_recvfrom_buf takes from the heap when the stack can't lend its own */
+#ifndef TAL_NET_RX_BUF_SIZE
+#define TAL_NET_RX_BUF_SIZE 1536
+#endif
+
+/* setsockopt level and name of the IP TOS byte, lwIP and Linux agree on them */
+#ifndef TAL_NET_IPPROTO_IP
+#define TAL_NET_IPPROTO_IP 0
+#endif
+#ifndef TAL_NET_IP_TOS
+#define TAL_NET_IP_TOS 1
+#endif
+
+/* DSCP of each WMM access category, the WiFi driver picks the queue from it */
+#define TAL_NET_DSCP_BE 0  /* default forwarding */
+#define TAL_NET_DSCP_BK 8  /* CS1, lower effort */
+#define TAL_NET_DSCP_VI 34 /* AF41, interactive video */
+#define TAL_NET_DSCP_VO 46 /* EF, voice */
+
+/**
+ * @brief WMM access category of the traffic of a socket
+ */
+typedef enum {
+    TAL_NET_AC_BE = 0, /* best effort */
+    TAL_NET_AC_BK,     /* background: bulk downloads */
+    TAL_NET_AC_VI,     /* video */
+    TAL_NET_AC_VO,     /* voice: real-time audio */
+} TAL_NET_AC_E;
+
+/**
+ * @brief One received datagram, valid until tal_net_rx_buf_release
+ */
+typedef struct {
+    uint8_t *data; /* datagram payload */
+    uint32_t len;  /* payload length */
+    void *ref;     /* stack buffer holding the payload, NULL when data is a heap copy */
+} TAL_NET_RX_BUF_T;
+
 /**
  * @brief Get error code of network
  *
@@ -315,6 +366,32 @@ int tal_net_recv_nd_size(const int fd, void *buf, const uint32_t buf_size, const
  */
 TUYA_ERRNO tal_net_recvfrom(const int fd, void *buf, const uint32_t nbytes, TUYA_IP_ADDR_T *addr, uint16_t *port);
 
+/**
+ * @brief Receive one datagram in place of the network stack buffer
+ *
+ * @param[in] fd: file descriptor of a UDP socket
+ * @param[out] rx: the datagram, give it back with tal_net_rx_buf_release
+ * @param[in] addr: address information of sender
+ * @param[in] port: port information of sender
+ *
+ * @note On lwIP the payload is the pbuf the driver filled, with no copy to a
+ * caller buffer. Other stacks receive into a TAL_NET_RX_BUF_SIZE heap buffer.
+ * The buffer is only taken on success, rx needs no release otherwise.
+ *
+ * @return >0 on num of recv, <0 please refer to the error no of the target
+ * system
+ */
+TUYA_ERRNO tal_net_recvfrom_buf(const int fd, TAL_NET_RX_BUF_T *rx, TUYA_IP_ADDR_T *addr, uint16_t *port);
+
+/**
+ * @brief Give a datagram of tal_net_recvfrom_buf back
+ *
+ * @param[in] rx: the datagram, its data is invalid afterwards
+ *
+ * @return none
+ */
+void tal_net_rx_buf_release(TAL_NET_RX_BUF_T *rx);
+
 /**
  * @brief Set timeout option of socket fd
  *
@@ -379,6 +456,31 @@ OPERATE_RET tal_net_disable_nagle(const int fd);
  */
 OPERATE_RET tal_net_set_broadcast(const int fd);
 
+/**
+ * @brief Set the IP TOS byte of the packets sent on socket fd
+ *
+ * @param[in] fd: file descriptor
+ * @param[in] tos: TOS byte, DSCP << 2
+ *
+ * @note lwIP writes the TOS into the header of every packet of the socket,
+ * WiFi drivers with WMM map it to an access category.
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_net_set_tos(const int fd, const uint8_t tos);
+
+/**
+ * @brief Mark the packets sent on socket fd with the DSCP of a WMM access category
+ *
+ * @param[in] fd: file descriptor
+ * @param[in] ac: access category, TAL_NET_AC_VO for real-time audio
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_net_set_ac(const int fd, const TAL_NET_AC_E ac);
+
 /**
  * @brief Get address information by domain
  *
@@ -392,6 +494,19 @@ OPERATE_RET tal_net_set_broadcast(const int fd);
  */
 OPERATE_RET tal_net_gethostbyname(const char *domain, TUYA_IP_ADDR_T *addr);
 
+/**
+ * @brief Drop cached addresses of tal_net_gethostbyname
+ *
+ * @param[in] domain: domain to drop, NULL for all
+ *
+ * @note Call it when the cached address did not answer, the next lookup goes
+ * to the resolver.
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_net_dns_cache_flush(const char *domain);
+
 /**
  * @brief Set keepalive option of socket fd to monitor the connection
  *
@@ -44,6 +44,9 @@ typedef struct {
     TUYA_ERRNO (*recv)(const int fd, void *buf, const uint32_t nbytes);
     int (*recv_nd_size)(const int fd, void *buf, const uint32_t buf_size, const uint32_t nd_size);
     TUYA_ERRNO (*recvfrom)(const int fd, void *buf, const uint32_t nbytes, TUYA_IP_ADDR_T *addr, uint16_t *port);
+    // optional: one datagram left in the stack buffer ref, given back by rx_ref_free
+    TUYA_ERRNO (*recvfrom_ref)(const int fd, uint8_t **data, void **ref, TUYA_IP_ADDR_T *addr, uint16_t *port);
+    void (*rx_ref_free)(void *ref);
     OPERATE_RET (*set_timeout)(const int fd, const int ms_timeout, const TUYA_TRANS_TYPE_E type);
     OPERATE_RET (*set_bufsize)(const int fd, const int buf_size, const TUYA_TRANS_TYPE_E type);
     OPERATE_RET (*set_reuse)(const int fd);
@@ -87,6 +90,9 @@ TAL_NETWORK_CARD_TYPE_E tal_network_card_get_active_type(void);
 
 TAL_NETWORK_OPS_T *tal_network_get_active_ops(void);
 
+// ops of one card, whether it is active or not, NULL when not registered
+TAL_NETWORK_OPS_T *tal_network_get_card_ops(TAL_NETWORK_CARD_TYPE_E type);
+
 #ifdef __cplusplus
 }
 #endif
@@ -72,9 +72,18 @@
         }                                                                                                              \
     } while (0)
 
+#define TAL_NET_DNS_DOMAIN_LEN 64
+
 /***********************************************************
 ***********************typedef define***********************
 ***********************************************************/
+typedef struct {
+    char domain[TAL_NET_DNS_DOMAIN_LEN + 1];
+    TUYA_IP_ADDR_T addr;
+    SYS_TIME_T expire; // 0 for a free entry
+    SYS_TIME_T used;   // last lookup, the oldest entry is replaced
+    BOOL_T refreshing;
+} TAL_NET_DNS_ENTRY_T;
 
 /***********************************************************
 ********************function declaration********************
@@ -83,6 +92,10 @@
 /***********************************************************
 ***********************variable define**********************
 ***********************************************************/
+#if TAL_NET_DNS_CACHE_NUM > 0
+static TAL_NET_DNS_ENTRY_T sg_dns_cache[TAL_NET_DNS_CACHE_NUM];
+static MUTEX_HANDLE sg_dns_mutex = NULL;
+#endif
 
 /***********************************************************
 ***********************function define**********************
@@ -485,6 +498,81 @@ TUYA_ERRNO tal_net_recvfrom(const int fd, void *buf, const uint32_t nbytes, TUYA
     TAL_NET_EXEC_OP(recvfrom, -1, fd, buf, nbytes, addr, port);
 }
 
+/**
+ * @brief Receive one datagram in place of the network stack buffer
+ *
+ * @param[in] fd: file descriptor of a UDP socket
+ * @param[out] rx: the datagram, give it back with tal_net_rx_buf_release
+ * @param[in] addr: address information of sender
+ * @param[in] port: port information of sender
+ *
+ * @return >0 on num of recv, <0 please refer to the error no of the target
+ * system
+ */
+TUYA_ERRNO tal_net_recvfrom_buf(const int fd, TAL_NET_RX_BUF_T *rx, TUYA_IP_ADDR_T *addr, uint16_t *port)
+{
+    TUYA_ERRNO ret;
+    TAL_NETWORK_OPS_T *ops = tal_network_get_active_ops();
+
+    if ((fd < 0) || (rx == NULL)) {
+        return -3000 + fd;
+    }
+    if (NULL == ops) {
+        return -1;
+    }
+
+    memset(rx, 0, sizeof(TAL_NET_RX_BUF_T));
+    if (ops->recvfrom_ref && ops->rx_ref_free) {
+        ret = ops->recvfrom_ref(fd, &rx->data, &rx->ref, addr, port);
+        if (ret > 0) {
+            rx->len = (uint32_t)ret;
+        } else if (rx->ref) {
+            ops->rx_ref_free(rx->ref);
+            rx->ref = NULL;
+        }
+        return ret;
+    }
+
+    // The stack can't lend its buffer, receive into one of ours
+    rx->data = tal_malloc(TAL_NET_RX_BUF_SIZE);
+    if (NULL == rx->data) {
+        return -1;
+    }
+    ret = tal_net_recvfrom(fd, rx->data, TAL_NET_RX_BUF_SIZE, addr, port);
+    if (ret > 0) {
+        rx->len = (uint32_t)ret;
+    } else {
+        tal_free(rx->data);
+        rx->data = NULL;
+    }
+
+    return ret;
+}
+
+/**
+ * @brief Give a datagram of tal_net_recvfrom_buf back
+ *
+ * @param[in] rx: the datagram, its data is invalid afterwards
+ *
+ * @return none
+ */
+void tal_net_rx_buf_release(TAL_NET_RX_BUF_T *rx)
+{
+    if (rx == NULL || rx->data == NULL) {
+        return;
+    }
+
+    if (rx->ref) {
+        TAL_NETWORK_OPS_T *ops = tal_network_get_active_ops();
+        if (ops && ops->rx_ref_free) {
+            ops->rx_ref_free(rx->ref);
+        }
+    } else {
+        tal_free(rx->data);
+    }
+    memset(rx, 0, sizeof(TAL_NET_RX_BUF_T));
+}
+
 /**
  * @brief Set socket options
  *
@@ -624,6 +712,51 @@ OPERATE_RET tal_net_set_broadcast(const int fd)
     TAL_NET_EXEC_OP(set_broadcast, OPRT_COM_ERROR, fd);
 }
 
+/**
+ * @brief Set the IP TOS byte of the packets sent on socket fd
+ *
+ * @param[in] fd: file descriptor
+ * @param[in] tos: TOS byte, DSCP << 2
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_net_set_tos(const int fd, const uint8_t tos)
+{
+    int val = tos;
+
+    if (fd < 0) {
+        return -3000 + fd;
+    }
+
+    return tal_net_setsockopt(fd, TAL_NET_IPPROTO_IP, TAL_NET_IP_TOS, &val, sizeof(val));
+}
+
+/**
+ * @brief Mark the packets sent on socket fd with the DSCP of a WMM access category
+ *
+ * @param[in] fd: file descriptor
+ * @param[in] ac: access category
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_net_set_ac(const int fd, const TAL_NET_AC_E ac)
+{
+    static const uint8_t dscp[] = {
+        [TAL_NET_AC_BE] = TAL_NET_DSCP_BE,
+        [TAL_NET_AC_BK] = TAL_NET_DSCP_BK,
+        [TAL_NET_AC_VI] = TAL_NET_DSCP_VI,
+        [TAL_NET_AC_VO] = TAL_NET_DSCP_VO,
+    };
+
+    if ((unsigned)ac >= CNTSOF(dscp)) {
+        return OPRT_INVALID_PARM;
+    }
+
+    return tal_net_set_tos(fd, (uint8_t)(dscp[ac] << 2));
+}
+
 /**
  * @brief Get address information by domain
  *
@@ -635,13 +768,155 @@ OPERATE_RET tal_net_set_broadcast(const int fd)
  * @return OPRT_OK on success. Others on error, please refer to
  * tuya_error_code.h
  */
+static OPERATE_RET __net_dns_resolve(const char *domain, TUYA_IP_ADDR_T *addr)
+{
+    TAL_NET_EXEC_OP(gethostbyname, OPRT_COM_ERROR, domain, addr);
+}
+
+#if TAL_NET_DNS_CACHE_NUM > 0
+static TAL_NET_DNS_ENTRY_T *__net_dns_find(const char *domain)
+{
+    for (int i = 0; i < TAL_NET_DNS_CACHE_NUM; i++) {
+        if (sg_dns_cache[i].expire && 0 == strcmp(sg_dns_cache[i].domain, domain)) {
+            return &sg_dns_cache[i];
+        }
+    }
+
+    return NULL;
+}
+
+static void __net_dns_store(const char *domain, const TUYA_IP_ADDR_T *addr)
+{
+    SYS_TIME_T now = tal_system_get_millisecond();
+    TAL_NET_DNS_ENTRY_T *entry = __net_dns_find(domain);
+
+    if (NULL == entry) {
+        entry = &sg_dns_cache[0];
+        for (int i = 0; i < TAL_NET_DNS_CACHE_NUM && entry->expire; i++) {
+            if (0 == sg_dns_cache[i].expire || sg_dns_cache[i].used < entry->used) {
+                entry = &sg_dns_cache[i];
+            }
+        }
+        memset(entry, 0, sizeof(TAL_NET_DNS_ENTRY_T));
+        strncpy(entry->domain, domain, TAL_NET_DNS_DOMAIN_LEN);
+        entry->used = now;
+    }
+    entry->addr = *addr;
+    entry->expire = now + TAL_NET_DNS_CACHE_TTL_S * 1000;
+}
+
+static void __net_dns_refresh(void *data)
+{
+    char *domain = (char *)data;
+    TUYA_IP_ADDR_T addr;
+
+    OPERATE_RET rt = __net_dns_resolve(domain, &addr);
+
+    tal_mutex_lock(sg_dns_mutex);
+    TAL_NET_DNS_ENTRY_T *entry = __net_dns_find(domain);
+    if (entry) {
+        entry->refreshing = FALSE;
+        if (OPRT_OK == rt) {
+            __net_dns_store(domain, &addr);
+        }
+    }
+    tal_mutex_unlock(sg_dns_mutex);
+
+    PR_TRACE("dns refresh %s %d", domain, rt);
+    tal_free(domain);
+}
+
+/* a literal address is returned by the resolver as is, nothing to cache */
+static BOOL_T __net_dns_is_literal(const char *domain)
+{
+    for (; *domain; domain++) {
+        if ((*domain < '0' || *domain > '9') && *domain != '.' && *domain != ':') {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+#endif
+
 OPERATE_RET tal_net_gethostbyname(const char *domain, TUYA_IP_ADDR_T *addr)
 {
     if ((domain == NULL) || (addr == NULL)) {
         return -2;
     }
 
-    TAL_NET_EXEC_OP(gethostbyname, OPRT_COM_ERROR, domain, addr);
+#if TAL_NET_DNS_CACHE_NUM > 0
+    if (strlen(domain) > TAL_NET_DNS_DOMAIN_LEN || __net_dns_is_literal(domain)) {
+        return __net_dns_resolve(domain, addr);
+    }
+    if (NULL == sg_dns_mutex && OPRT_OK != tal_mutex_create_init(&sg_dns_mutex)) {
+        return __net_dns_resolve(domain, addr);
+    }
+
+    SYS_TIME_T now = tal_system_get_millisecond();
+    BOOL_T stale = FALSE;
+
+    tal_mutex_lock(sg_dns_mutex);
+    TAL_NET_DNS_ENTRY_T *entry = __net_dns_find(domain);
+    if (entry && now < entry->expire) {
+        *addr = entry->addr;
+        entry->used = now;
+        if (!entry->refreshing && now + TAL_NET_DNS_REFRESH_S * 1000 >= entry->expire) {
+            char *refresh = tal_malloc(strlen(domain) + 1);
+            if (refresh) {
+                strcpy(refresh, domain);
+                entry->refreshing = TRUE;
+                if (OPRT_OK != tal_workq_schedule(WORKQ_SYSTEM, __net_dns_refresh, refresh)) {
+                    entry->refreshing = FALSE;
+                    tal_free(refresh);
+                }
+            }
+        }
+        tal_mutex_unlock(sg_dns_mutex);
+        return OPRT_OK;
+    }
+    tal_mutex_unlock(sg_dns_mutex);
+
+    OPERATE_RET rt = __net_dns_resolve(domain, addr);
+
+    tal_mutex_lock(sg_dns_mutex);
+    if (OPRT_OK == rt) {
+        __net_dns_store(domain, addr);
+    } else if (NULL != (entry = __net_dns_find(domain))) {
+        // the resolver is unreachable, an expired address beats none
+        *addr = entry->addr;
+        stale = TRUE;
+        rt = OPRT_OK;
+    }
+    tal_mutex_unlock(sg_dns_mutex);
+
+    if (stale) {
+        PR_DEBUG("dns %s resolve failed, use the expired address", domain);
+    }
+
+    return rt;
+#else
+    return __net_dns_resolve(domain, addr);
+#endif
+}
+
+OPERATE_RET tal_net_dns_cache_flush(const char *domain)
+{
+#if TAL_NET_DNS_CACHE_NUM > 0
+    if (NULL == sg_dns_mutex) {
+        return OPRT_OK;
+    }
+
+    tal_mutex_lock(sg_dns_mutex);
+    for (int i = 0; i < TAL_NET_DNS_CACHE_NUM; i++) {
+        if (NULL == domain || 0 == strcmp(sg_dns_cache[i].domain, domain)) {
+            memset(&sg_dns_cache[i], 0, sizeof(TAL_NET_DNS_ENTRY_T));
+        }
+    }
+    tal_mutex_unlock(sg_dns_mutex);
+#endif
+
+    return OPRT_OK;
 }
 
 /**
@@ -88,6 +88,15 @@ TAL_NETWORK_CARD_TYPE_E tal_network_card_get_active_type(void)
     return tal_network_card_manager.active_card_type;
 }
 
+TAL_NETWORK_OPS_T *tal_network_get_card_ops(TAL_NETWORK_CARD_TYPE_E type)
+{
+    if (type >= TAL_NET_TYPE_MAX || NULL == tal_network_card_manager.active_card[type]) {
+        return NULL;
+    }
+
+    return &tal_network_card_manager.active_card[type]->ops;
+}
+
 TAL_NETWORK_OPS_T *tal_network_get_active_ops(void)
 {
     TAL_NETWORK_CARD_T *card = tal_network_card_manager.active_card[tal_network_card_manager.active_card_type];
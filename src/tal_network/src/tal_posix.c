@@ -62,6 +62,9 @@
 #include "lwip/netdb.h"
 #include "lwip/dns.h"
 #include "lwip/errno.h"
+#include "lwip/api.h"
+#include "lwip/pbuf.h"
+#include "lwip/priv/sockets_priv.h"
 #endif
 
 typedef struct NETWORK_ERRNO_TRANS {
@@ -723,6 +726,83 @@ TUYA_ERRNO tal_net_posix_recvfrom(const int fd, void *buf, const uint32_t nbytes
     return ret;
 }
 
+#if defined(ENABLE_LIBLWIP) && (ENABLE_LIBLWIP == 1)
+/**
+ * @brief Receive one datagram without copying it out of the stack
+ *
+ * @param[in] fd: file descriptor of a UDP socket
+ * @param[out] data: the datagram payload
+ * @param[out] ref: the netbuf holding the payload, for tal_net_posix_rx_ref_free
+ * @param[in] addr: address information of sender
+ * @param[in] port: port information of sender
+ *
+ * @note The netbuf is taken from the netconn like lwip_recvfrom does, so the
+ * receive timeout, the non-blocking flag and the select events still apply.
+ *
+ * @return >0 on num of recv, <0 on error with the errno set
+ */
+TUYA_ERRNO tal_net_posix_recvfrom_ref(const int fd, uint8_t **data, void **ref, TUYA_IP_ADDR_T *addr,
+                                      uint16_t *port)
+{
+    struct netbuf *buf = NULL;
+    struct lwip_sock *sock = lwip_socket_dbg_get_socket(fd);
+
+    if ((sock == NULL) || (sock->conn == NULL)) {
+        set_errno(EBADF);
+        return -1;
+    }
+    if (NETCONNTYPE_GROUP(netconn_type(sock->conn)) != NETCONN_UDP) {
+        set_errno(EOPNOTSUPP);
+        return -1;
+    }
+
+    // A datagram peeked or partly read by recvfrom comes first
+    buf = sock->lastdata.netbuf;
+    sock->lastdata.netbuf = NULL;
+    if (buf == NULL) {
+        err_t err = netconn_recv_udp_raw_netbuf_flags(sock->conn, &buf, 0);
+        if (err != ERR_OK) {
+            set_errno(err_to_errno(err));
+            return -1;
+        }
+    }
+
+    // Chains only come from IP reassembly, flatten them once
+    if (buf->p->next != NULL) {
+        buf->p = pbuf_coalesce(buf->p, PBUF_RAW);
+        buf->ptr = buf->p;
+        if (buf->p->next != NULL) {
+            netbuf_delete(buf);
+            set_errno(ENOMEM);
+            return -1;
+        }
+    }
+
+    if (addr) {
+        *addr = ntohl(ip4_addr_get_u32(ip_2_ip4(netbuf_fromaddr(buf))));
+    }
+    if (port) {
+        *port = netbuf_fromport(buf);
+    }
+    *data = (uint8_t *)buf->p->payload;
+    *ref = buf;
+
+    return buf->p->len;
+}
+
+/**
+ * @brief Give a datagram of tal_net_posix_recvfrom_ref back to the stack
+ *
+ * @param[in] ref: the netbuf holding the payload
+ *
+ * @return none
+ */
+void tal_net_posix_rx_ref_free(void *ref)
+{
+    netbuf_delete((struct netbuf *)ref);
+}
+#endif
+
 /**
  * @brief Set socket options
  *
@@ -1060,6 +1140,10 @@ TAL_NETWORK_CARD_T tal_network_card_posix = {
             .recv = tal_net_posix_recv,
             .recv_nd_size = tal_net_posix_recv_nd_size,
             .recvfrom = tal_net_posix_recvfrom,
+#if defined(ENABLE_LIBLWIP) && (ENABLE_LIBLWIP == 1)
+            .recvfrom_ref = tal_net_posix_recvfrom_ref,
+            .rx_ref_free = tal_net_posix_rx_ref_free,
+#endif
             .set_timeout = tal_net_posix_set_timeout,
             .set_bufsize = tal_net_posix_set_bufsize,
             .set_reuse = tal_net_posix_set_reuse,
@@ -18,6 +18,15 @@
 extern "C" {
 #endif
 
+/**
+ * @brief Measures the throughput of the AES, GCM, SHA256 and HMAC primitives
+ * and logs it in MB/s, built with ENABLE_TAL_SECURITY_SELF_TEST.
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_security_benchmark(void);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -13,6 +13,7 @@
  * Supported operations:
  * - AES encryption and decryption in ECB mode.
  * - AES encryption and decryption in CBC mode.
+ * - One-shot AES-GCM encryption and authenticated decryption.
  * - Key initialization for both encryption and decryption.
  * - Context initialization and free operations.
  * 
@@ -31,6 +32,9 @@
 #if !defined(ENABLE_PLATFORM_AES)
 #include "mbedtls/aes.h"
 #endif
+#if !defined(ENABLE_PLATFORM_AES_GCM)
+#include "mbedtls/gcm.h"
+#endif
 
 #if !defined(ENABLE_PLATFORM_AES)
 
@@ -201,4 +205,83 @@ OPERATE_RET  tkl_aes_crypt_cbc( TKL_SYMMETRY_HANDLE ctx,
     return OPRT_OK;
 }
 
-#endif
\ No newline at end of file
+#endif
+
+#if !defined(ENABLE_PLATFORM_AES_GCM)
+
+/**
+* @brief This function performs a one-shot AES-GCM encryption and produces the tag.
+*
+* @param[in] key: The AES key.
+* @param[in] keybits: The key size in bits.
+* @param[in] iv: The initialization vector.
+* @param[in] iv_len: The length of the IV.
+* @param[in] add: The additional data.
+* @param[in] add_len: The length of the additional data.
+* @param[in] length: The length of the input data.
+* @param[in] input: The plaintext.
+* @param[out] output: The ciphertext, may be input.
+* @param[out] tag: The buffer for the tag.
+* @param[in] tag_len: The length of the tag.
+*
+* @return OPRT_OK on success. Others on error, please refer to tuya_error_code.h
+*/
+OPERATE_RET  tkl_aes_gcm_encrypt_and_tag( const uint8_t *key, uint32_t keybits,
+                    const uint8_t *iv, size_t iv_len,
+                    const uint8_t *add, size_t add_len,
+                    size_t length,
+                    const uint8_t *input,
+                    uint8_t *output,
+                    uint8_t *tag, size_t tag_len )
+{
+    int ret;
+    mbedtls_gcm_context gcm;
+
+    mbedtls_gcm_init( &gcm );
+    ret = mbedtls_gcm_setkey( &gcm, MBEDTLS_CIPHER_ID_AES, key, keybits );
+    if( ret == 0 )
+        ret = mbedtls_gcm_crypt_and_tag( &gcm, MBEDTLS_GCM_ENCRYPT, length, iv, iv_len, add, add_len,
+                                         input, output, tag_len, tag );
+    mbedtls_gcm_free( &gcm );
+
+    return ( ret == 0 ) ? OPRT_OK : OPRT_COM_ERROR;
+}
+
+/**
+* @brief This function performs a one-shot AES-GCM decryption and checks the tag.
+*
+* @param[in] key: The AES key.
+* @param[in] keybits: The key size in bits.
+* @param[in] iv: The initialization vector.
+* @param[in] iv_len: The length of the IV.
+* @param[in] add: The additional data.
+* @param[in] add_len: The length of the additional data.
+* @param[in] tag: The tag to check.
+* @param[in] tag_len: The length of the tag.
+* @param[in] length: The length of the input data.
+* @param[in] input: The ciphertext.
+* @param[out] output: The plaintext, may be input.
+*
+* @return OPRT_OK on success, OPRT_COM_ERROR on a bad key or tag mismatch.
+*/
+OPERATE_RET  tkl_aes_gcm_auth_decrypt( const uint8_t *key, uint32_t keybits,
+                    const uint8_t *iv, size_t iv_len,
+                    const uint8_t *add, size_t add_len,
+                    const uint8_t *tag, size_t tag_len,
+                    size_t length,
+                    const uint8_t *input,
+                    uint8_t *output )
+{
+    int ret;
+    mbedtls_gcm_context gcm;
+
+    mbedtls_gcm_init( &gcm );
+    ret = mbedtls_gcm_setkey( &gcm, MBEDTLS_CIPHER_ID_AES, key, keybits );
+    if( ret == 0 )
+        ret = mbedtls_gcm_auth_decrypt( &gcm, length, iv, iv_len, add, add_len, tag, tag_len, input, output );
+    mbedtls_gcm_free( &gcm );
+
+    return ( ret == 0 ) ? OPRT_OK : OPRT_COM_ERROR;
+}
+
+#endif
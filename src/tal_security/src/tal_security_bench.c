@@ -0,0 +1,120 @@
+/**
+ * @file tal_security_bench.c
+ * @brief Throughput measurement of the tal_security primitives.
+ *
+ * Each primitive runs over the same buffer for a fixed number of rounds, so
+ * the same build can be compared with and without the ENABLE_PLATFORM_*
+ * accelerator switches.
+ *
+ * @copyright Copyright (c) 2021-2024 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include <string.h>
+#include "tuya_iot_config.h"
+#include "tal_security.h"
+#include "tal_system.h"
+#include "tal_memory.h"
+#include "tal_log.h"
+
+#if defined(ENABLE_TAL_SECURITY_SELF_TEST)
+
+#ifndef TAL_SECURITY_BENCH_BUF_LEN
+#define TAL_SECURITY_BENCH_BUF_LEN 1024
+#endif
+
+#ifndef TAL_SECURITY_BENCH_ROUNDS
+#define TAL_SECURITY_BENCH_ROUNDS 256
+#endif
+
+typedef enum {
+    BENCH_AES128_ECB,
+    BENCH_AES128_CBC,
+    BENCH_AES128_GCM,
+    BENCH_SHA256,
+    BENCH_HMAC_SHA256,
+    BENCH_MAX,
+} tal_security_bench_t;
+
+static const char *const s_bench_name[BENCH_MAX] = {"aes128-ecb", "aes128-cbc", "aes128-gcm", "sha256",
+                                                    "hmac-sha256"};
+
+static OPERATE_RET tal_security_bench_run(tal_security_bench_t bench, TKL_SYMMETRY_HANDLE aes, uint8_t *buf,
+                                          size_t len)
+{
+    OPERATE_RET ret = OPRT_OK;
+    uint8_t key[16] = {0};
+    uint8_t iv[16] = {0};
+    uint8_t tag[32];
+
+    for (uint32_t i = 0; i < TAL_SECURITY_BENCH_ROUNDS && ret == OPRT_OK; i++) {
+        switch (bench) {
+        case BENCH_AES128_ECB:
+            ret = tal_aes_crypt_ecb(aes, SYMMETRY_ENCRYPT, len, buf, buf);
+            break;
+        case BENCH_AES128_CBC:
+            ret = tal_aes_crypt_cbc(aes, SYMMETRY_ENCRYPT, len, iv, buf, buf);
+            break;
+        case BENCH_AES128_GCM:
+            ret = tal_aes_gcm_encrypt_and_tag(key, 128, iv, 12, NULL, 0, len, buf, buf, tag, 16);
+            break;
+        case BENCH_SHA256:
+            ret = tal_sha256_ret(buf, len, tag, 0);
+            break;
+        case BENCH_HMAC_SHA256:
+            ret = tal_sha256_mac(key, sizeof(key), buf, len, tag);
+            break;
+        default:
+            ret = OPRT_INVALID_PARM;
+            break;
+        }
+    }
+    return ret;
+}
+
+/**
+ * @brief Measures the throughput of the AES, GCM, SHA256 and HMAC primitives.
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_security_benchmark(void)
+{
+    OPERATE_RET ret = OPRT_OK;
+    TKL_SYMMETRY_HANDLE aes = NULL;
+    uint8_t key[16] = {0};
+
+    uint8_t *buf = tal_malloc(TAL_SECURITY_BENCH_BUF_LEN);
+    if (NULL == buf) {
+        return OPRT_MALLOC_FAILED;
+    }
+    memset(buf, 0x5A, TAL_SECURITY_BENCH_BUF_LEN);
+
+    ret = tal_aes_create_init(&aes);
+    if (ret == OPRT_OK) {
+        ret = tal_aes_setkey_enc(aes, key, 128);
+    }
+
+    for (int i = 0; i < BENCH_MAX && ret == OPRT_OK; i++) {
+        SYS_TIME_T start = tal_system_get_millisecond();
+        ret = tal_security_bench_run((tal_security_bench_t)i, aes, buf, TAL_SECURITY_BENCH_BUF_LEN);
+        SYS_TIME_T cost = tal_system_get_millisecond() - start;
+        if (ret != OPRT_OK) {
+            PR_ERR("%s failed %d", s_bench_name[i], ret);
+            break;
+        }
+
+        /* bytes per ms is KB/s */
+        uint32_t kbps = (uint32_t)((uint64_t)TAL_SECURITY_BENCH_BUF_LEN * TAL_SECURITY_BENCH_ROUNDS / (cost ? cost : 1));
+        PR_NOTICE("%-12s %u.%03u MB/s (%u bytes in %u ms)", s_bench_name[i], kbps / 1000, kbps % 1000,
+                  TAL_SECURITY_BENCH_BUF_LEN * TAL_SECURITY_BENCH_ROUNDS, (uint32_t)cost);
+    }
+
+    if (aes) {
+        tal_aes_free(aes);
+    }
+    tal_free(buf);
+    return ret;
+}
+
+#endif
@@ -214,6 +214,69 @@ exit:
     return (ret);
 }
 
+/**
+ * @brief Encrypts data with AES-GCM and produces the authentication tag.
+ *
+ * Runs on the platform GCM engine when ENABLE_PLATFORM_AES_GCM is set and on
+ * mbedtls otherwise. The output may be the input buffer.
+ *
+ * @param key The AES key.
+ * @param keybits The key size in bits, 128 or 256.
+ * @param iv The initialization vector.
+ * @param iv_len The length of the IV.
+ * @param add The additional data, may be NULL when add_len is 0.
+ * @param add_len The length of the additional data.
+ * @param length The length of the input data.
+ * @param input The plaintext.
+ * @param output The buffer to store the ciphertext.
+ * @param tag The buffer to store the tag.
+ * @param tag_len The length of the tag.
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_aes_gcm_encrypt_and_tag(const uint8_t *key, uint32_t keybits, const uint8_t *iv, size_t iv_len,
+                                        const uint8_t *add, size_t add_len, size_t length, const uint8_t *input,
+                                        uint8_t *output, uint8_t *tag, size_t tag_len)
+{
+    if (key == NULL || iv == NULL || tag == NULL || (length && (input == NULL || output == NULL))) {
+        return OPRT_INVALID_PARM;
+    }
+
+    return tkl_aes_gcm_encrypt_and_tag(key, keybits, iv, iv_len, add, add_len, length, input, output, tag, tag_len);
+}
+
+/**
+ * @brief Decrypts AES-GCM data and checks the authentication tag.
+ *
+ * Runs on the platform GCM engine when ENABLE_PLATFORM_AES_GCM is set and on
+ * mbedtls otherwise. The output may be the input buffer.
+ *
+ * @param key The AES key.
+ * @param keybits The key size in bits, 128 or 256.
+ * @param iv The initialization vector.
+ * @param iv_len The length of the IV.
+ * @param add The additional data, may be NULL when add_len is 0.
+ * @param add_len The length of the additional data.
+ * @param tag The tag to check.
+ * @param tag_len The length of the tag.
+ * @param length The length of the input data.
+ * @param input The ciphertext.
+ * @param output The buffer to store the plaintext.
+ *
+ * @return OPRT_OK on success, OPRT_COM_ERROR when the tag does not match.
+ */
+OPERATE_RET tal_aes_gcm_auth_decrypt(const uint8_t *key, uint32_t keybits, const uint8_t *iv, size_t iv_len,
+                                     const uint8_t *add, size_t add_len, const uint8_t *tag, size_t tag_len,
+                                     size_t length, const uint8_t *input, uint8_t *output)
+{
+    if (key == NULL || iv == NULL || tag == NULL || (length && (input == NULL || output == NULL))) {
+        return OPRT_INVALID_PARM;
+    }
+
+    return tkl_aes_gcm_auth_decrypt(key, keybits, iv, iv_len, add, add_len, tag, tag_len, length, input, output);
+}
+
 /**
  * @brief Encodes data using AES-128 ECB mode.
  *
@@ -50,6 +50,14 @@ extern "C" {
  */
 #define EVENT_DESC_MAX_LEN (32)
 
+/**
+ * @brief buckets of the event name hash, a power of 2
+ *
+ */
+#ifndef EVENT_HASH_BUCKETS
+#define EVENT_HASH_BUCKETS (16)
+#endif
+
 /**
  * @brief subscriber type
  *
@@ -60,6 +68,9 @@ typedef uint8_t SUBSCRIBE_TYPE_E;
 #define SUBSCRIBE_TYPE_ONETIME                                                                                         \
     2 // one time type, dispatch by the subscribe order, remove after first time
       // dispath
+#define SUBSCRIBE_TYPE_ASYNC                                                                                           \
+    3 // async type, queued to the WORKQ_SYSTEM workqueue in subscribe order, the
+      // publisher does not wait. Use tal_event_publish_copy for non static data
 
 /**
  * @brief the event dispatch raw data
@@ -89,6 +100,13 @@ typedef struct {
     struct tuya_list_head node;        // list node, used to attch to the event node
 } SUBSCRIBE_NODE_T;
 
+/**
+ * @brief the callbacks of an event, rebuilt on every subscriber change and
+ * shared by the publishers running it
+ *
+ */
+typedef struct EVENT_SNAPSHOT EVENT_SNAPSHOT_T;
+
 /**
  * @brief the event node
  *
@@ -97,21 +115,31 @@ typedef struct {
     MUTEX_HANDLE mutex; // mutex, protection the event publish and subscribe
 
     char name[EVENT_NAME_MAX_LEN + 1];    // name, the event name
+    uint32_t hash;                        // hash of the name
     struct tuya_list_head node;           // list node, used to attach to the event manage module
+    struct tuya_list_head hash_node;      // list node, used to attach to the name hash bucket
     struct tuya_list_head subscribe_root; // subscibe root, used to manage the subscriber
+    EVENT_SNAPSHOT_T *snapshot;           // subscriber callbacks in dispatch order
 } EVENT_NODE_T;
 
+/**
+ * @brief interned event, valid for the lifetime of the system
+ *
+ */
+typedef EVENT_NODE_T *EVENT_HANDLE;
+
 /**
  * @brief the event manage node
  *
  */
 typedef struct {
     int inited;
-    MUTEX_HANDLE mutex;                        // mutex, used to protection event manage node
-    int event_cnt;                             // current event number
-    struct tuya_list_head event_root;          // event root, used to manage the event
-    struct tuya_list_head free_subscribe_root; // free subscriber list, used to manage the
-                                               // subscribe which not found the event
+    MUTEX_HANDLE mutex;                                   // mutex, used to protection event manage node
+    int event_cnt;                                        // current event number
+    struct tuya_list_head event_root;                     // event root, used to manage the event
+    struct tuya_list_head event_hash[EVENT_HASH_BUCKETS]; // event hash, used to find the event by name
+    struct tuya_list_head free_subscribe_root;            // free subscriber list, used to manage the
+                                                          // subscribe which not found the event
 } EVENT_MANAGE_T;
 
 /**
@@ -132,6 +160,17 @@ OPERATE_RET tal_event_init(void);
  */
 OPERATE_RET tal_event_publish(const char *name, void *data);
 
+/**
+ * @brief: publish event, the async subscribers get a copy of data
+ *
+ * @param[in] name: event name
+ * @param[in] data: event data
+ * @param[in] len: length of data copied for the async subscribers
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_event_publish_copy(const char *name, void *data, uint32_t len);
+
 /**
  * @brief: subscribe event
  *
@@ -155,6 +194,39 @@ OPERATE_RET tal_event_subscribe(const char *name, const char *desc, const EVENT_
  */
 OPERATE_RET tal_event_unsubscribe(const char *name, const char *desc, EVENT_SUBSCRIBE_CB cb);
 
+/**
+ * @brief: look up an event once, creating it if needed
+ *
+ * @param[in] name: event name
+ * @param[out] handle: the event handle, never freed
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_event_get_handle(const char *name, EVENT_HANDLE *handle);
+
+/**
+ * @brief: publish event by handle, without the name lookup
+ *
+ * @param[in] handle: event handle from tal_event_get_handle
+ * @param[in] data: event data
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_event_publish_handle(EVENT_HANDLE handle, void *data);
+
+/**
+ * @brief: subscribe event by handle
+ *
+ * @param[in] handle: event handle from tal_event_get_handle
+ * @param[in] desc: subscribe description
+ * @param[in] cb: subscribe callback function
+ * @param[in] type: subscribe type
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_event_subscribe_handle(EVENT_HANDLE handle, const char *desc, const EVENT_SUBSCRIBE_CB cb,
+                                       SUBSCRIBE_TYPE_E type);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -29,6 +29,21 @@
 extern "C" {
 #endif
 
+/**
+ * @brief Stream buffer of each open file on LittleFS, fgets, fgetc and small
+ * reads and writes are served from it. 0 disables the buffer.
+ */
+#ifndef TAL_FS_BUF_SIZE
+#define TAL_FS_BUF_SIZE 256
+#endif
+
+/**
+ * @brief Stream buffers this large are taken from PSRAM when ENABLE_EXT_RAM
+ */
+#ifndef TAL_FS_BUF_PSRAM_MIN
+#define TAL_FS_BUF_PSRAM_MIN 1024
+#endif
+
 /********************************************************************************
  ********************************************************************************
  ********************************************************************************/
@@ -110,6 +110,16 @@ OPERATE_RET tal_log_print_secure(BOOL_T is_const_fmt, const TAL_LOG_LEVEL_E leve
 #define _THIS_FILE_NAME_ __FILE__
 #endif
 
+#if defined(ENABLE_LOG_TOKEN) && (ENABLE_LOG_TOKEN == 1)
+#include "tal_log_token.h"
+// formats are tokenized at build time, see tal_log_token.h
+#define PR_ERR(fmt, ...)    TAL_LOG_TOKEN(TAL_LOG_LEVEL_ERR, fmt, ##__VA_ARGS__)
+#define PR_WARN(fmt, ...)   TAL_LOG_TOKEN(TAL_LOG_LEVEL_WARN, fmt, ##__VA_ARGS__)
+#define PR_NOTICE(fmt, ...) TAL_LOG_TOKEN(TAL_LOG_LEVEL_NOTICE, fmt, ##__VA_ARGS__)
+#define PR_INFO(fmt, ...)   TAL_LOG_TOKEN(TAL_LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#define PR_DEBUG(fmt, ...)  TAL_LOG_TOKEN(TAL_LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+#define PR_TRACE(fmt, ...)  TAL_LOG_TOKEN(TAL_LOG_LEVEL_TRACE, fmt, ##__VA_ARGS__)
+#else
 #define PR_ERR(fmt, ...)                                                                                                 \
     tal_log_print_secure(LOG_FMT_IS_CONST(fmt), TAL_LOG_LEVEL_ERR, _THIS_FILE_NAME_, __LINE__, fmt, ##__VA_ARGS__)
 #define PR_WARN(fmt, ...)                                                                                                \
@@ -122,6 +132,7 @@ OPERATE_RET tal_log_print_secure(BOOL_T is_const_fmt, const TAL_LOG_LEVEL_E leve
     tal_log_print_secure(LOG_FMT_IS_CONST(fmt), TAL_LOG_LEVEL_DEBUG, _THIS_FILE_NAME_, __LINE__, fmt, ##__VA_ARGS__)
 #define PR_TRACE(fmt, ...)                                                                                               \
     tal_log_print_secure(LOG_FMT_IS_CONST(fmt), TAL_LOG_LEVEL_TRACE, _THIS_FILE_NAME_, __LINE__, fmt, ##__VA_ARGS__)
+#endif
 
 #define PR_HEXDUMP_ERR(title, buf, size)                                                                               \
     tal_log_hex_dump(TAL_LOG_LEVEL_ERR, _THIS_FILE_NAME_, __LINE__, title, 8, buf, size)
@@ -140,7 +151,7 @@ OPERATE_RET tal_log_print_secure(BOOL_T is_const_fmt, const TAL_LOG_LEVEL_E leve
 
 #define PR_DEBUG_RAW(fmt, ...) tal_log_print_raw(fmt, ##__VA_ARGS__)
 #define PR_TRACE_ENTER()       PR_TRACE("enter [%s]", (const char *)__func__)
-#define PR_TRACE_LEAVE()       PR_TRACE(("leave [%s]", (const char *)__func__))
+#define PR_TRACE_LEAVE()       PR_TRACE("leave [%s]", (const char *)__func__)
 
 /***********************************************************************
  ********************* struct ******************************************
@@ -317,6 +328,27 @@ OPERATE_RET tal_log_print_escape(const TAL_LOG_LEVEL_E level, const char *file,
  */
 void tal_log_release(void);
 
+/**
+ * @brief write out the queued log messages in the calling thread
+ *
+ * @note With ENABLE_LOG_ASYNC the PR_* macros only queue the message in a
+ * ring (TAL_LOG_RING_SIZE bytes) and a low priority thread writes it to the
+ * output terminals, so logging never waits for the UART. Call this before a
+ * reset to not lose the tail of the log. Without ENABLE_LOG_ASYNC it does
+ * nothing.
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_log_flush(void);
+
+/**
+ * @brief get the number of messages dropped on a full log ring
+ *
+ * @return the dropped count, always 0 without ENABLE_LOG_ASYNC
+ */
+uint32_t tal_log_get_dropped(void);
+
 /**
  * @brief print a buffer in hex format
  *
@@ -0,0 +1,183 @@
+/**
+ * @file tal_log_token.h
+ * @brief Tokenized (dictionary) logging for the PR_* macros.
+ *
+ * With ENABLE_LOG_TOKEN the PR_ERR ... PR_TRACE macros no longer format
+ * on the device. Each call site puts "file\x1fline\x1ffmt" into the
+ * tal_log_tok section and logs only its offset there (the token), the
+ * argument kinds, a millisecond timestamp and the raw arguments.
+ * tools/log_token/log_detokenize.py reads the section from the ELF of the
+ * same build and prints the messages.
+ *
+ * The linker script should place the section out of the image, e.g.
+ *
+ *   tal_log_tok 0 (INFO) : { __start_tal_log_tok = .; KEEP(*(tal_log_tok)) }
+ *
+ * otherwise it is linked after .rodata as an orphan section and the format
+ * strings stay in flash.
+ *
+ * A record is level:1 | token | kinds | ms | args, where token, kinds and ms
+ * are varints, integers are zigzag varints, doubles 8 bytes little endian
+ * and strings a length byte and the bytes. Records go to the output set by
+ * tal_log_token_set_output(), or base64 encoded as a "$..." line to the log
+ * terminals.
+ *
+ * @copyright Copyright (c) 2021-2024 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#ifndef __TAL_LOG_TOKEN_H__
+#define __TAL_LOG_TOKEN_H__
+
+#include "tuya_cloud_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***********************************************************************
+ ********************* constant ( macro and enum ) *********************
+ **********************************************************************/
+#define TAL_LOG_TOKEN_SECTION "tal_log_tok"
+
+// record buffer on the caller stack, arguments that do not fit are cut
+#ifndef TAL_LOG_TOKEN_BUF_LEN
+#define TAL_LOG_TOKEN_BUF_LEN 96
+#endif
+
+// longest %s argument copied into a record
+#ifndef TAL_LOG_TOKEN_STR_MAX
+#define TAL_LOG_TOKEN_STR_MAX 32
+#endif
+
+// level flag of a record whose arguments were cut
+#define TAL_LOG_TOKEN_TRUNCATED 0x80
+
+/* argument kinds, 2 bits each above a 4 bit count, at most 14 arguments */
+#define TAL_LOG_TOKEN_INT32  0
+#define TAL_LOG_TOKEN_INT64  1
+#define TAL_LOG_TOKEN_DOUBLE 2
+#define TAL_LOG_TOKEN_STRING 3
+
+#ifdef __cplusplus
+extern "C++" {
+constexpr uint32_t __tal_log_token_kind(const char *) { return TAL_LOG_TOKEN_STRING; }
+constexpr uint32_t __tal_log_token_kind(char *) { return TAL_LOG_TOKEN_STRING; }
+constexpr uint32_t __tal_log_token_kind(float) { return TAL_LOG_TOKEN_DOUBLE; }
+constexpr uint32_t __tal_log_token_kind(double) { return TAL_LOG_TOKEN_DOUBLE; }
+template <typename T> constexpr uint32_t __tal_log_token_kind(T)
+{
+    return sizeof(T) <= 4 ? TAL_LOG_TOKEN_INT32 : TAL_LOG_TOKEN_INT64;
+}
+}
+#define __TLT_K(x) __tal_log_token_kind(x)
+#else
+#define __TLT_K(x)                                                                                                     \
+    ((uint32_t)_Generic((x),                                                                                           \
+        char *: TAL_LOG_TOKEN_STRING,                                                                                  \
+        const char *: TAL_LOG_TOKEN_STRING,                                                                            \
+        float: TAL_LOG_TOKEN_DOUBLE,                                                                                   \
+        double: TAL_LOG_TOKEN_DOUBLE,                                                                                  \
+        default: (sizeof(x) <= 4 ? TAL_LOG_TOKEN_INT32 : TAL_LOG_TOKEN_INT64)))
+#endif
+
+#define __TLT_STR_(x) #x
+#define __TLT_STR(x)  __TLT_STR_(x)
+#define __TLT_CAT_(a, b) a##b
+#define __TLT_CAT(a, b)  __TLT_CAT_(a, b)
+
+#define __TLT_NARGS(...) __TLT_NARGS_(0, ##__VA_ARGS__, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define __TLT_NARGS_(_0, _1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, N, ...) N
+
+#define __TLT_KIND(i, x) (__TLT_K(x) << (4 + 2 * (i)))
+#define __TLT_KINDS_0()  0u
+#define __TLT_KINDS_1(a) (__TLT_KIND(0, a))
+#define __TLT_KINDS_2(a, b) (__TLT_KINDS_1(a) | __TLT_KIND(1, b))
+#define __TLT_KINDS_3(a, b, c) (__TLT_KINDS_2(a, b) | __TLT_KIND(2, c))
+#define __TLT_KINDS_4(a, b, c, d) (__TLT_KINDS_3(a, b, c) | __TLT_KIND(3, d))
+#define __TLT_KINDS_5(a, b, c, d, e) (__TLT_KINDS_4(a, b, c, d) | __TLT_KIND(4, e))
+#define __TLT_KINDS_6(a, b, c, d, e, f) (__TLT_KINDS_5(a, b, c, d, e) | __TLT_KIND(5, f))
+#define __TLT_KINDS_7(a, b, c, d, e, f, g) (__TLT_KINDS_6(a, b, c, d, e, f) | __TLT_KIND(6, g))
+#define __TLT_KINDS_8(a, b, c, d, e, f, g, h) (__TLT_KINDS_7(a, b, c, d, e, f, g) | __TLT_KIND(7, h))
+#define __TLT_KINDS_9(a, b, c, d, e, f, g, h, i) (__TLT_KINDS_8(a, b, c, d, e, f, g, h) | __TLT_KIND(8, i))
+#define __TLT_KINDS_10(a, b, c, d, e, f, g, h, i, j) (__TLT_KINDS_9(a, b, c, d, e, f, g, h, i) | __TLT_KIND(9, j))
+#define __TLT_KINDS_11(a, b, c, d, e, f, g, h, i, j, k)                                                                \
+    (__TLT_KINDS_10(a, b, c, d, e, f, g, h, i, j) | __TLT_KIND(10, k))
+#define __TLT_KINDS_12(a, b, c, d, e, f, g, h, i, j, k, l)                                                             \
+    (__TLT_KINDS_11(a, b, c, d, e, f, g, h, i, j, k) | __TLT_KIND(11, l))
+#define __TLT_KINDS_13(a, b, c, d, e, f, g, h, i, j, k, l, m)                                                          \
+    (__TLT_KINDS_12(a, b, c, d, e, f, g, h, i, j, k, l) | __TLT_KIND(12, m))
+#define __TLT_KINDS_14(a, b, c, d, e, f, g, h, i, j, k, l, m, n)                                                       \
+    (__TLT_KINDS_13(a, b, c, d, e, f, g, h, i, j, k, l, m) | __TLT_KIND(13, n))
+
+// argument count and kinds of a call, a compile time constant
+#define TAL_LOG_TOKEN_KINDS(...)                                                                                       \
+    ((uint32_t)__TLT_NARGS(__VA_ARGS__) | __TLT_CAT(__TLT_KINDS_, __TLT_NARGS(__VA_ARGS__))(__VA_ARGS__))
+
+/**
+ * @brief log a tokenized message, fmt must be a string literal
+ *
+ * The if (0) call is never made, it only keeps the ENABLE_PRINTF_CHECK
+ * format checks.
+ */
+#define TAL_LOG_TOKEN(level, fmt, ...)                                                                                 \
+    do {                                                                                                               \
+        static const char __tlt_entry[] __attribute__((section(TAL_LOG_TOKEN_SECTION), used, aligned(1))) =           \
+            __FILE__ "\x1f" __TLT_STR(__LINE__) "\x1f" fmt;                                                            \
+        if (0) {                                                                                                       \
+            tal_log_token_fmt_check(fmt, ##__VA_ARGS__);                                                               \
+        }                                                                                                              \
+        tal_log_token_print(level, (uint32_t)((uintptr_t)__tlt_entry - (uintptr_t)__start_tal_log_tok),                \
+                            TAL_LOG_TOKEN_KINDS(__VA_ARGS__), ##__VA_ARGS__);                                          \
+    } while (0)
+
+/***********************************************************************
+ ********************* struct ******************************************
+ **********************************************************************/
+// prototype of a binary record output, one record per call
+typedef void (*TAL_LOG_TOKEN_OUTPUT_CB)(const uint8_t *record, uint32_t len);
+
+/***********************************************************************
+ ********************* variable ****************************************
+ **********************************************************************/
+extern const char __start_tal_log_tok[];
+
+/***********************************************************************
+ ********************* function ****************************************
+ **********************************************************************/
+
+/**
+ * @brief encode and output one tokenized record, called by TAL_LOG_TOKEN()
+ *
+ * @param[in] level log level
+ * @param[in] token offset of the call site entry in the tal_log_tok section
+ * @param[in] kinds argument count and kinds from TAL_LOG_TOKEN_KINDS()
+ * @param[in] ... the arguments
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_log_token_print(uint8_t level, uint32_t token, uint32_t kinds, ...);
+
+/**
+ * @brief set where records are written
+ *
+ * @param[in] output binary record output, NULL writes base64 "$..." lines to
+ * the log terminals
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_log_token_set_output(TAL_LOG_TOKEN_OUTPUT_CB output);
+
+PRINTF_CHECK(1, 2)
+static inline void tal_log_token_fmt_check(const char *fmt, ...)
+{
+    (void)fmt;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TAL_LOG_TOKEN_H__ */
@@ -41,9 +41,57 @@ extern "C" {
 
 #define Free(ptr) tal_free(ptr)
 
+/* ENABLE_MEM_PROFILE tracks every tal_malloc / tal_psram_malloc block */
+#if defined(ENABLE_MEM_PROFILE) && (ENABLE_MEM_PROFILE == 1)
+// tracked blocks, later allocations are only counted as untracked
+#ifndef TAL_MEM_PROFILE_SLOTS
+#define TAL_MEM_PROFILE_SLOTS 512
+#endif
+
+// distinct tags, slot 0 collects untagged allocations
+#ifndef TAL_MEM_PROFILE_TAGS
+#define TAL_MEM_PROFILE_TAGS 16
+#endif
+
+// untagged call sites listed by the dump
+#ifndef TAL_MEM_PROFILE_TOP
+#define TAL_MEM_PROFILE_TOP 8
+#endif
+#else
+#define tal_malloc_tag(size, tag)         tal_malloc(size)
+#define tal_calloc_tag(nitems, size, tag) tal_calloc(nitems, size)
+#if defined(ENABLE_EXT_RAM) && (ENABLE_EXT_RAM == 1)
+#define tal_psram_malloc_tag(size, tag) tal_psram_malloc(size)
+#else
+#define tal_psram_malloc_tag(size, tag) tal_malloc(size)
+#endif
+#endif
+
+#define TAL_MEM_RAM_SRAM  0
+#define TAL_MEM_RAM_PSRAM 1
+#define TAL_MEM_RAM_NUM   2
+
 /***********************************************************************
  ********************* struct ******************************************
  **********************************************************************/
+typedef struct {
+    /** free heap bytes */
+    uint32_t free;
+    /** largest block one allocation can get */
+    uint32_t largest;
+    /** 100 - largest * 100 / free, 0 is one contiguous free block */
+    uint8_t frag_pct;
+} TAL_HEAP_INFO_T;
+
+typedef struct {
+    const char *tag;
+    /** bytes allocated now, per TAL_MEM_RAM_* */
+    uint32_t live[TAL_MEM_RAM_NUM];
+    /** most bytes allocated at once */
+    uint32_t peak[TAL_MEM_RAM_NUM];
+    /** blocks allocated now */
+    uint32_t blocks[TAL_MEM_RAM_NUM];
+} TAL_MEM_TAG_STAT_T;
 
 /***********************************************************************
  ********************* variable ****************************************
@@ -113,6 +161,93 @@ void *tal_psram_realloc(void *ptr, size_t size);
  */
 int tal_system_get_free_heap_size(void);
 
+/**
+ * @brief Get the free heap size and its largest free block
+ *
+ * @param[out] info heap info
+ *
+ * @note Without ENABLE_PLATFORM_HEAP_INFO the largest block is found by
+ * bisecting trial allocations, call it from diagnostics only.
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_system_get_heap_info(TAL_HEAP_INFO_T *info);
+
+#if defined(ENABLE_MEM_PROFILE) && (ENABLE_MEM_PROFILE == 1)
+/**
+ * @brief alloc memory accounted to a tag
+ *
+ * @param[in] size memory size
+ * @param[in] tag module name, must stay valid, NULL is untagged
+ *
+ * @return the memory address malloced
+ */
+void *tal_malloc_tag(size_t size, const char *tag);
+
+/**
+ * @brief alloc and clear memory accounted to a tag
+ *
+ * @param[in] nitems the numbers of memory block
+ * @param[in] size the size of the memory block
+ * @param[in] tag module name, must stay valid, NULL is untagged
+ *
+ * @return the memory address calloced
+ */
+void *tal_calloc_tag(size_t nitems, size_t size, const char *tag);
+
+#if defined(ENABLE_EXT_RAM) && (ENABLE_EXT_RAM == 1)
+/**
+ * @brief alloc psram accounted to a tag
+ *
+ * @param[in] size memory size
+ * @param[in] tag module name, must stay valid, NULL is untagged
+ *
+ * @return the memory address malloced
+ */
+void *tal_psram_malloc_tag(size_t size, const char *tag);
+#else
+#define tal_psram_malloc_tag(size, tag) tal_malloc_tag(size, tag)
+#endif
+
+/**
+ * @brief get the per tag counters
+ *
+ * @param[out] stat counters, one per tag
+ * @param[in] num entries in stat
+ *
+ * @return number of entries filled
+ */
+uint32_t tal_mem_profile_get_tags(TAL_MEM_TAG_STAT_T *stat, uint32_t num);
+
+/**
+ * @brief get the number of allocations that found no free slot
+ *
+ * @return untracked allocations since boot
+ */
+uint32_t tal_mem_profile_get_untracked(void);
+
+/**
+ * @brief print the heap info, the tags and the heaviest untagged call sites
+ */
+void tal_mem_profile_dump(void);
+
+/**
+ * @brief format the heap info and the tags as JSON
+ *
+ * @param[out] buf output buffer
+ * @param[in] size buffer size
+ *
+ * @return the formatted length, truncated like snprintf()
+ */
+int tal_mem_profile_format(char *buf, uint32_t size);
+
+/* called by tal_system.c for every block */
+void tal_mem_profile_add(void *ptr, size_t size, const char *tag, uint8_t ram, void *caller);
+void tal_mem_profile_del(void *ptr);
+void tal_mem_profile_move(void *old_ptr, void *new_ptr, size_t size, uint8_t ram);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
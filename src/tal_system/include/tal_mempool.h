@@ -0,0 +1,129 @@
+/**
+ * @file tal_mempool.h
+ * @brief Fixed size block pools for hot, short lived allocations.
+ *
+ * A pool is one slab of block_num blocks of block_size bytes in SRAM or
+ * PSRAM. Alloc and free pop and push a free list in a short critical
+ * section, so they are O(1) and do not fragment the heap. A request larger
+ * than the block size, or made while the pool is empty, is served by the
+ * heap of the same RAM, and tal_mempool_free() tells the two apart by
+ * address. Callers may therefore use a pool as a drop-in front of
+ * tal_malloc() / tal_psram_malloc(), and a NULL pool is simply the heap.
+ *
+ * Build with TAL_MEMPOOL_DEBUG to catch double and misaligned frees.
+ *
+ * @copyright Copyright (c) 2021-2024 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#ifndef __TAL_MEMPOOL_H__
+#define __TAL_MEMPOOL_H__
+
+#include "tuya_cloud_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***********************************************************************
+ ********************* constant ( macro and enum ) *********************
+ **********************************************************************/
+// keep peak, alloc and fallback counters per pool
+#ifndef TAL_MEMPOOL_STAT
+#define TAL_MEMPOOL_STAT 1
+#endif
+
+typedef uint8_t MEMPOOL_RAM_E;
+#define MEMPOOL_RAM_SRAM  0
+#define MEMPOOL_RAM_PSRAM 1 // SRAM without ENABLE_EXT_RAM
+
+/***********************************************************************
+ ********************* struct ******************************************
+ **********************************************************************/
+typedef void *MEMPOOL_HANDLE;
+
+typedef struct {
+    const char *name;
+    uint32_t block_size;
+    uint32_t block_num;
+    /** blocks allocated now */
+    uint32_t used;
+    /** most blocks allocated at once */
+    uint32_t peak;
+    /** allocations served by the pool */
+    uint32_t alloc_cnt;
+    /** allocations passed to the heap, too large or pool empty */
+    uint32_t fallback_cnt;
+} MEMPOOL_STAT_T;
+
+/***********************************************************************
+ ********************* variable ****************************************
+ **********************************************************************/
+
+/***********************************************************************
+ ********************* function ****************************************
+ **********************************************************************/
+
+/**
+ * @brief create a block pool
+ *
+ * @param[in] name pool name for the dump, must stay valid
+ * @param[in] block_size bytes per block, rounded up to 8
+ * @param[in] block_num number of blocks in the slab
+ * @param[in] ram MEMPOOL_RAM_SRAM or MEMPOOL_RAM_PSRAM
+ * @param[out] handle the pool
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_mempool_create(const char *name, uint32_t block_size, uint32_t block_num, MEMPOOL_RAM_E ram,
+                               MEMPOOL_HANDLE *handle);
+
+/**
+ * @brief allocate size bytes, from the pool when they fit a block
+ *
+ * @param[in] handle the pool, NULL allocates from the heap
+ * @param[in] size requested bytes
+ *
+ * @return the memory, NULL when the heap fallback failed too
+ */
+void *tal_mempool_alloc(MEMPOOL_HANDLE handle, size_t size);
+
+/**
+ * @brief free memory from tal_mempool_alloc() of the same pool
+ *
+ * @param[in] handle the pool, NULL frees to the heap
+ * @param[in] ptr the memory, may be NULL
+ */
+void tal_mempool_free(MEMPOOL_HANDLE handle, void *ptr);
+
+/**
+ * @brief get the counters of a pool
+ *
+ * @param[in] handle the pool
+ * @param[out] stat the counters
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_mempool_get_stat(MEMPOOL_HANDLE handle, MEMPOOL_STAT_T *stat);
+
+/**
+ * @brief print the counters of all pools
+ */
+void tal_mempool_dump(void);
+
+/**
+ * @brief release a pool whose blocks are all free
+ *
+ * @param[in] handle the pool
+ *
+ * @return OPRT_OK on success, OPRT_RESOURCE_NOT_READY while blocks are used
+ */
+OPERATE_RET tal_mempool_release(MEMPOOL_HANDLE handle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TAL_MEMPOOL_H__ */
@@ -32,10 +32,17 @@ extern "C" {
 /***********************************************************************
  ********************* constant ( macro and enum ) *********************
  **********************************************************************/
+#define CPU_PERF_LOCK_NAME_LEN 16
 
 /***********************************************************************
  ********************* struct ******************************************
  **********************************************************************/
+typedef void *CPU_PERF_LOCK_HANDLE;
+
+typedef struct {
+    SYS_TIME_T lp_ms;   // time with no performance lock held, low power allowed
+    SYS_TIME_T perf_ms; // time with at least one performance lock held
+} CPU_PERF_STAT_T;
 
 /***********************************************************************
  ********************* variable ****************************************
@@ -112,6 +119,59 @@ OPERATE_RET tal_cpu_lp_enable(void);
  */
 OPERATE_RET tal_cpu_lp_disable(void);
 
+/**
+ * @brief create a named performance lock
+ *
+ * While any performance lock is held low power is disabled, when the last one
+ * is released it is enabled again. Locks are taken from task context.
+ *
+ * @param[in] name: lock name, shown by tal_cpu_perf_lock_dump
+ * @param[out] handle: lock handle
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_cpu_perf_lock_create(const char *name, CPU_PERF_LOCK_HANDLE *handle);
+
+/**
+ * @brief hold a performance lock, holding it again has no effect
+ *
+ * @param[in] handle: lock handle
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_cpu_perf_lock_acquire(CPU_PERF_LOCK_HANDLE handle);
+
+/**
+ * @brief release a performance lock, releasing it again has no effect
+ *
+ * @param[in] handle: lock handle
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_cpu_perf_lock_release(CPU_PERF_LOCK_HANDLE handle);
+
+/**
+ * @brief get the time spent with and without performance locks held
+ *
+ * @param[out] stat: time statistics since the first lock was created
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_cpu_perf_stat_get(CPU_PERF_STAT_T *stat);
+
+/**
+ * @brief print the time statistics and every lock with its hold count and time
+ *
+ * @param[in] none
+ *
+ * @return none
+ */
+void tal_cpu_perf_lock_dump(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -43,6 +43,18 @@ typedef enum {
     TAL_TIMER_CYCLE,
 } TIMER_TYPE;
 
+/**
+ * @brief where the timer callback runs
+ */
+typedef enum {
+    /** on the timer thread, for short callbacks */
+    TAL_TIMER_EXEC_INLINE = 0,
+    /** queued to the WORKQ_SYSTEM service, may block */
+    TAL_TIMER_EXEC_WORKQ_SYSTEM,
+    /** queued to the WORKQ_HIGHTPRI service, must not block */
+    TAL_TIMER_EXEC_WORKQ_HIGHPRI,
+} TAL_TIMER_EXEC_E;
+
 /***********************************************************************
  ********************* struct ******************************************
  **********************************************************************/
@@ -51,6 +63,17 @@ typedef void *TIMER_ID;
 
 typedef void (*TAL_TIMER_CB)(TIMER_ID timer_id, void *arg);
 
+/**
+ * @brief how late the expired timers were picked up, see tal_sw_timer_lag_get()
+ */
+typedef struct {
+    /** timers dispatched in the period */
+    uint32_t dispatched;
+    /** average and worst ms between the expire time and the dispatch */
+    uint32_t avg_ms;
+    uint32_t max_ms;
+} TAL_TIMER_LAG_T;
+
 /***********************************************************************
  ********************* variable ****************************************
  **********************************************************************/
@@ -157,6 +180,21 @@ OPERATE_RET tal_sw_timer_start(TIMER_ID timer_id, TIME_MS time_ms, TIMER_TYPE ti
  */
 OPERATE_RET tal_sw_timer_trigger(TIMER_ID timer_id);
 
+/**
+ * @brief Select where the callback of a software timer runs
+ *
+ * @param[in] timer_id: timer id
+ * @param[in] exec: inline on the timer thread or on a workqueue service
+ *
+ * @note A workqueue timer has at most one callback queued, an expiry while
+ * it is still queued or running is skipped. When the service is not
+ * available the callback runs inline.
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_sw_timer_set_exec(TIMER_ID timer_id, TAL_TIMER_EXEC_E exec);
+
 /**
  * @brief Release all resource of the software timer
  *
@@ -180,6 +218,18 @@ OPERATE_RET tal_sw_timer_release(void);
  */
 int tal_sw_timer_get_num(void);
 
+/**
+ * @brief Get the dispatch lag since the previous call
+ *
+ * @param[out] lag dispatch count and lag, reset by the call
+ *
+ * @note tal_sw_timer_trigger() expiries are not counted.
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_sw_timer_lag_get(TAL_TIMER_LAG_T *lag);
+
 #ifdef __cplusplus
 }
 #endif
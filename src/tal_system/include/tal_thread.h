@@ -90,6 +90,19 @@ typedef struct {
     char *thrdname;      // thread name
 } THREAD_CFG_T;
 
+/**
+ * @brief thread profile, see tal_thread_profile_get()
+ *
+ */
+typedef struct {
+    char name[TAL_THREAD_MAX_NAME_LEN];
+    uint32_t stack_size;
+    uint32_t stack_free;   // least free stack so far, 0 if unknown
+    uint16_t cpu_permille; // share of the cpu in the last sample period
+    uint32_t switches;     // context switches in the last sample period
+    uint64_t run_time_us;  // cpu time since creation
+} THREAD_PROFILE_T;
+
 /**
  * @brief create and start a tuya sdk thread
  *
@@ -141,6 +154,41 @@ THREAD_STATE_E tal_thread_get_state(const THREAD_HANDLE handle);
  * tuya_error_code.h
  */
 OPERATE_RET tal_thread_diagnose(const THREAD_HANDLE handle);
+
+/**
+ * @brief print the stack size and the least free stack of every thread
+ *
+ */
+void tal_thread_dump_watermark(void);
+
+/**
+ * @brief sample the threads, the cpu share and switches cover the time since
+ * the previous sample
+ *
+ * @param[out] profile: one entry per thread
+ * @param[in] num: entries in profile
+ * @param[out] period_ms: the sample period, can be null
+ * @return number of entries filled
+ *
+ * @note cpu time and switches need ENABLE_THREAD_RUNTIME, only threads
+ * created by tal_thread_create_and_start() are listed
+ */
+uint32_t tal_thread_profile_get(THREAD_PROFILE_T *profile, uint32_t num, uint32_t *period_ms);
+
+/**
+ * @brief sample and print the threads
+ *
+ */
+void tal_thread_profile_dump(void);
+
+/**
+ * @brief sample the threads and format them as JSON
+ *
+ * @param[out] buf: output buffer
+ * @param[in] size: buffer size
+ * @return the formatted length, truncated like snprintf()
+ */
+int tal_thread_profile_format(char *buf, uint32_t size);
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -0,0 +1,105 @@
+/**
+ * @file tal_trace.h
+ * @brief Microsecond trace points for latency measurement.
+ *
+ * TAL_TRACE_BEGIN(), TAL_TRACE_END() and TAL_TRACE_INSTANT() record an event
+ * with a microsecond timestamp and the calling thread into a ring buffer in
+ * RAM, the oldest events are overwritten once it is full. Recording takes a
+ * few instructions and no lock, so trace points can stay in the audio and
+ * network paths and in isrs. tal_trace_dump() writes the ring in the Chrome
+ * trace event format, which Perfetto (ui.perfetto.dev) and chrome://tracing
+ * open directly.
+ *
+ * The trace points only compile in with ENABLE_TAL_TRACE, the port then has
+ * to provide tkl_system_get_microsecond().
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#ifndef __TAL_TRACE_H__
+#define __TAL_TRACE_H__
+
+#include "tuya_cloud_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+// Events kept in the ring, must be a power of 2
+#ifndef TAL_TRACE_RING_SIZE
+#define TAL_TRACE_RING_SIZE 256
+#endif
+
+#define TAL_TRACE_PH_BEGIN   'B'
+#define TAL_TRACE_PH_END     'E'
+#define TAL_TRACE_PH_INSTANT 'i'
+
+/**
+ * @brief trace points, name must be a string literal, only the pointer is kept
+ *
+ * BEGIN and END must be paired on the same thread, INSTANT marks a point in
+ * time, e.g. where a frame is handed to another thread.
+ */
+#if defined(ENABLE_TAL_TRACE) && (ENABLE_TAL_TRACE == 1)
+#define TAL_TRACE_BEGIN(name)   tal_trace_record(TAL_TRACE_PH_BEGIN, name)
+#define TAL_TRACE_END(name)     tal_trace_record(TAL_TRACE_PH_END, name)
+#define TAL_TRACE_INSTANT(name) tal_trace_record(TAL_TRACE_PH_INSTANT, name)
+#else
+#define TAL_TRACE_BEGIN(name)
+#define TAL_TRACE_END(name)
+#define TAL_TRACE_INSTANT(name)
+#endif
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+/**
+ * @brief receives the dump, str is not null terminated
+ */
+typedef void (*TAL_TRACE_OUTPUT_CB)(const char *str, uint32_t len, void *arg);
+
+/***********************************************************
+********************function declaration********************
+***********************************************************/
+/**
+ * @brief record an event, use the TAL_TRACE_* macros instead
+ *
+ * @param[in] ph: TAL_TRACE_PH_BEGIN, TAL_TRACE_PH_END or TAL_TRACE_PH_INSTANT
+ * @param[in] name: event name, a string literal
+ */
+void tal_trace_record(char ph, const char *name);
+
+/**
+ * @brief start or pause recording, recording is on by default
+ *
+ * @param[in] enable: TRUE to record
+ */
+void tal_trace_enable(BOOL_T enable);
+
+/**
+ * @brief drop the recorded events
+ */
+void tal_trace_clear(void);
+
+/**
+ * @brief write the recorded events as Chrome trace JSON, oldest first
+ *
+ * Recording is paused during the dump. Timestamps are in us from the oldest
+ * event, tid is the thread handle.
+ *
+ * @param[in] output: called with each piece of the JSON
+ * @param[in] arg: passed back to output
+ *
+ * @return OPRT_OK on success, OPRT_INVALID_PARM if output is NULL
+ */
+OPERATE_RET tal_trace_dump(TAL_TRACE_OUTPUT_CB output, void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TAL_TRACE_H__ */
@@ -34,7 +34,12 @@ typedef enum {
     /**
      * high priority workqueue (block operations are not allowed)
      */
-    WORKQ_HIGHTPRI
+    WORKQ_HIGHTPRI,
+    /**
+     * low priority workqueue with WORKQ_POOL_WORKERS threads, works run in
+     * parallel. Same as WORKQ_SYSTEM when the pool is not configured
+     */
+    WORKQ_POOL
 } WORKQ_SERVICE_E;
 
 /**
@@ -52,6 +52,27 @@ typedef BOOL_T (*WORKQUEUE_TRAVERSE_CB)(WORK_ITEM_T *item, void *ctx);
  */
 OPERATE_RET tal_workqueue_create(const uint16_t queue_len, THREAD_CFG_T *thread_cfg, WORKQUEUE_HANDLE *handle);
 
+/**
+ * @brief create a workqueue served by several worker threads
+ *
+ * Every worker has its own deque, new work goes to the least loaded one and an
+ * idle worker steals from the others, so one long job does not hold up the
+ * rest. Works may run in parallel, the other APIs are used as for
+ * tal_workqueue_create().
+ *
+ * @param[in] queue_len the maximum number of items of each worker deque
+ * @param[in] worker_num the number of worker threads
+ * @param[in] thread_cfg thread param, the name gets the worker index appended
+ * @param[in] cores core of each worker, -1 for any, NULL for no affinity. Needs
+ * ENABLE_THREAD_AFFINITY and tkl_thread_set_affinity() from the platform
+ * @param[out] handle the workqueue handle
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_workqueue_create_pool(const uint16_t queue_len, const uint8_t worker_num, THREAD_CFG_T *thread_cfg,
+                                      const int8_t *cores, WORKQUEUE_HANDLE *handle);
+
 /**
  * @brief put work task in workqueue
  *
@@ -128,6 +149,55 @@ OPERATE_RET tal_workqueue_release(WORKQUEUE_HANDLE handle);
  */
 THREAD_HANDLE tal_workqueue_get_thread(WORKQUEUE_HANDLE handle);
 
+typedef void *WORK_HANDLE;
+
+// coalesce with a run of the same work that is still queued
+#define WORK_SCHEDULE_ONCE (1 << 0)
+
+/**
+ * @brief create a work handle for repeated scheduling
+ *
+ * @param[in] handle the workqueue handle
+ * @param[in] cb the work callback
+ * @param[in] data the work data
+ * @param[out] work the work handle
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_workqueue_work_create(WORKQUEUE_HANDLE handle, WORKQUEUE_CB cb, void *data, WORK_HANDLE *work);
+
+/**
+ * @brief put a work handle in its workqueue
+ *
+ * @param[in] work the work handle
+ * @param[in] flags WORK_SCHEDULE_ONCE to coalesce with a run still queued
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_workqueue_work_schedule(WORK_HANDLE work, uint8_t flags);
+
+/**
+ * @brief cancel the queued runs of a work handle without searching the queue
+ *
+ * @param[in] work the work handle
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_workqueue_work_cancel(WORK_HANDLE work);
+
+/**
+ * @brief cancel and free a work handle, a run in progress is not stopped
+ *
+ * @param[in] work the work handle
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_workqueue_work_release(WORK_HANDLE work);
+
 typedef void *DELAYED_WORK_HANDLE;
 
 /**
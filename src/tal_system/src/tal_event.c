@@ -34,8 +34,123 @@
 #include "tal_event.h"
 #include "tal_api.h"
 
+struct EVENT_SNAPSHOT {
+    int ref;         // the event and every publisher running it hold one
+    int cnt;         // number of callbacks
+    BOOL_T onetime;  // the list has SUBSCRIBE_TYPE_ONETIME subscribers
+    int async_cnt;   // SUBSCRIBE_TYPE_ASYNC subscribers
+    struct {
+        EVENT_SUBSCRIBE_CB cb;
+        SUBSCRIBE_TYPE_E type;
+    } item[0];
+};
+
+// one publish to the async subscribers, the payload copy follows the slots
+typedef struct EVENT_ASYNC EVENT_ASYNC_T;
+typedef struct {
+    EVENT_ASYNC_T *async;
+    EVENT_SUBSCRIBE_CB cb;
+} EVENT_ASYNC_SLOT_T;
+
+struct EVENT_ASYNC {
+    int ref; // slots still queued, under g_event_manager.mutex
+    void *data;
+    EVENT_ASYNC_SLOT_T slot[0];
+};
+
 static EVENT_MANAGE_T g_event_manager = {0};
 
+static uint32_t _event_name_hash(const char *name)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    while (*name) {
+        hash = (hash ^ (uint8_t)*name++) * 16777619u;
+    }
+    return hash;
+}
+
+static int _event_cb_removed(void *data)
+{
+    return OPRT_OK;
+}
+
+// called with event->mutex held
+static void _event_snapshot_put(EVENT_SNAPSHOT_T *snapshot)
+{
+    if (snapshot && --snapshot->ref == 0) {
+        tal_free(snapshot);
+    }
+}
+
+// rebuild the callbacks after the subscriber list changed, called with
+// event->mutex held. The old snapshot lives on until its publishers finish.
+static OPERATE_RET _event_snapshot_update(EVENT_NODE_T *event)
+{
+    int cnt = 0;
+    struct tuya_list_head *pos = NULL;
+    tuya_list_for_each(pos, &event->subscribe_root)
+    {
+        cnt++;
+    }
+
+    EVENT_SNAPSHOT_T *snapshot = NULL;
+    if (cnt) {
+        snapshot = tal_malloc(sizeof(EVENT_SNAPSHOT_T) + cnt * sizeof(snapshot->item[0]));
+        TUYA_CHECK_NULL_RETURN(snapshot, OPRT_MALLOC_FAILED);
+        snapshot->ref = 1;
+        snapshot->cnt = 0;
+        snapshot->onetime = FALSE;
+        snapshot->async_cnt = 0;
+        tuya_list_for_each(pos, &event->subscribe_root)
+        {
+            SUBSCRIBE_NODE_T *entry = tuya_list_entry(pos, SUBSCRIBE_NODE_T, node);
+            snapshot->item[snapshot->cnt].cb = entry->cb;
+            snapshot->item[snapshot->cnt].type = entry->type;
+            snapshot->cnt++;
+            if (entry->type == SUBSCRIBE_TYPE_ONETIME) {
+                snapshot->onetime = TRUE;
+            } else if (entry->type == SUBSCRIBE_TYPE_ASYNC) {
+                snapshot->async_cnt++;
+            }
+        }
+    }
+
+    _event_snapshot_put(event->snapshot);
+    event->snapshot = snapshot;
+
+    return OPRT_OK;
+}
+
+// take the callbacks for one publish. One-time subscribers are handed to
+// this publish only, so they are removed from the list right away.
+static EVENT_SNAPSHOT_T *_event_snapshot_get(EVENT_NODE_T *event)
+{
+    tal_mutex_lock(event->mutex);
+    EVENT_SNAPSHOT_T *snapshot = event->snapshot;
+    if (snapshot) {
+        snapshot->ref++;
+        if (snapshot->onetime) {
+            struct tuya_list_head *p = NULL;
+            struct tuya_list_head *n = NULL;
+            tuya_list_for_each_safe(p, n, &event->subscribe_root)
+            {
+                SUBSCRIBE_NODE_T *entry = tuya_list_entry(p, SUBSCRIBE_NODE_T, node);
+                if (entry->type == SUBSCRIBE_TYPE_ONETIME) {
+                    tuya_list_del(&entry->node);
+                    tal_free(entry);
+                }
+            }
+            if (OPRT_OK != _event_snapshot_update(event)) {
+                PR_ERR("event %s snapshot update failed", event->name);
+            }
+        }
+    }
+    tal_mutex_unlock(event->mutex);
+
+    return snapshot;
+}
+
 BOOL_T _event_name_is_valid(const char *name)
 {
     if (!name) {
@@ -72,11 +187,10 @@ EVENT_NODE_T *_event_node_create_init(const char *name)
     // initialze the event node
     memcpy(event->name, name, strlen(name));
     event->name[strlen(name)] = '\0';
+    event->hash = _event_name_hash(name);
     INIT_LIST_HEAD(&event->subscribe_root);
     tal_mutex_create_init(&event->mutex);
 
-    tal_mutex_lock(g_event_manager.mutex);
-
     // need check if there have free subscriber which subscribe this event
     struct tuya_list_head *free_pos = NULL;
     struct tuya_list_head *free_next = NULL;
@@ -98,25 +212,30 @@ EVENT_NODE_T *_event_node_create_init(const char *name)
         }
     }
 
+    if (OPRT_OK != _event_snapshot_update(event)) {
+        PR_ERR("event %s snapshot update failed", name);
+    }
+
     // at last, need add this event to event manage root
     tuya_list_add_tail(&event->node, &g_event_manager.event_root);
+    tuya_list_add_tail(&event->hash_node, &g_event_manager.event_hash[event->hash & (EVENT_HASH_BUCKETS - 1)]);
     g_event_manager.event_cnt++;
 
-    tal_mutex_unlock(g_event_manager.mutex);
-
     return event;
 }
 
+// called with g_event_manager.mutex held
 EVENT_NODE_T *_event_node_get(const char *name)
 {
-    // try to get event from event root
+    // try to get event from the name hash bucket
+    uint32_t hash = _event_name_hash(name);
     EVENT_NODE_T *entry = NULL;
     struct tuya_list_head *pos = NULL;
-    tuya_list_for_each(pos, &g_event_manager.event_root)
+    tuya_list_for_each(pos, &g_event_manager.event_hash[hash & (EVENT_HASH_BUCKETS - 1)])
     {
         // find by name
-        entry = tuya_list_entry(pos, EVENT_NODE_T, node);
-        if (0 == strcmp(entry->name, name)) {
+        entry = tuya_list_entry(pos, EVENT_NODE_T, hash_node);
+        if (entry->hash == hash && 0 == strcmp(entry->name, name)) {
             return entry;
         }
     }
@@ -124,6 +243,18 @@ EVENT_NODE_T *_event_node_get(const char *name)
     return NULL;
 }
 
+static EVENT_NODE_T *_event_node_get_or_create(const char *name)
+{
+    tal_mutex_lock(g_event_manager.mutex);
+    EVENT_NODE_T *event = _event_node_get(name);
+    if (!event) {
+        event = _event_node_create_init(name);
+    }
+    tal_mutex_unlock(g_event_manager.mutex);
+
+    return event;
+}
+
 SUBSCRIBE_NODE_T *_event_node_get_free_subscribe(SUBSCRIBE_NODE_T *subscribe)
 {
     struct tuya_list_head *pos = NULL;
@@ -157,30 +288,79 @@ SUBSCRIBE_NODE_T *_event_node_get_subscribe(EVENT_NODE_T *event, SUBSCRIBE_NODE_
     return NULL;
 }
 
-OPERATE_RET _event_node_dispatch(EVENT_NODE_T *event, void *data)
+static void _event_async_cb(void *data)
 {
     OPERATE_RET rt = OPRT_OK;
+    EVENT_ASYNC_SLOT_T *slot = (EVENT_ASYNC_SLOT_T *)data;
+    EVENT_ASYNC_T *async = slot->async;
 
-    // dispatch in order
-    struct tuya_list_head *p = NULL;
-    struct tuya_list_head *n = NULL;
-    SUBSCRIBE_NODE_T *entry = NULL;
-    tuya_list_for_each_safe(p, n, &event->subscribe_root)
-    {
-        // find and call cb one by one
-        entry = tuya_list_entry(p, SUBSCRIBE_NODE_T, node);
-        if (entry->cb) {
-            TUYA_CALL_ERR_LOG(entry->cb(data));
+    TUYA_CALL_ERR_LOG(slot->cb(async->data));
+
+    tal_mutex_lock(g_event_manager.mutex);
+    int ref = --async->ref;
+    tal_mutex_unlock(g_event_manager.mutex);
+    if (0 == ref) {
+        tal_free(async);
+    }
+}
+
+// queue the async subscribers on WORKQ_SYSTEM. With len the data is copied
+// once and shared by them, otherwise the pointer itself is passed on.
+static OPERATE_RET _event_async_dispatch(EVENT_SNAPSHOT_T *snapshot, void *data, uint32_t len)
+{
+    OPERATE_RET rt = OPRT_OK;
+    size_t head = sizeof(EVENT_ASYNC_T) + snapshot->async_cnt * sizeof(EVENT_ASYNC_SLOT_T);
+
+    EVENT_ASYNC_T *async = tal_malloc(head + len);
+    TUYA_CHECK_NULL_RETURN(async, OPRT_MALLOC_FAILED);
+    async->ref = snapshot->async_cnt;
+    async->data = data;
+    if (len) {
+        async->data = (uint8_t *)async + head;
+        memcpy(async->data, data, len);
+    }
+
+    int n = 0;
+    for (int i = 0; i < snapshot->cnt; i++) {
+        if (snapshot->item[i].type != SUBSCRIBE_TYPE_ASYNC) {
+            continue;
+        }
+        EVENT_ASYNC_SLOT_T *slot = &async->slot[n++];
+        slot->async = async;
+        slot->cb = snapshot->item[i].cb;
+        if (OPRT_OK != tal_workq_schedule(WORKQ_SYSTEM, _event_async_cb, slot)) {
+            // no workqueue, deliver in place rather than drop
+            _event_async_cb(slot);
         }
+    }
+
+    return rt;
+}
 
-        // one-time event should be removed after dispatch
-        if (entry->type == SUBSCRIBE_TYPE_ONETIME) {
-            tuya_list_del(&entry->node);
-            tal_free(entry);
-            entry = NULL;
+OPERATE_RET _event_node_dispatch(EVENT_NODE_T *event, void *data, uint32_t len)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    // the callbacks run without the event lock, so a subscriber may publish
+    // or change subscriptions, the changes apply from the next publish
+    EVENT_SNAPSHOT_T *snapshot = _event_snapshot_get(event);
+    if (!snapshot) {
+        return OPRT_OK;
+    }
+
+    if (snapshot->async_cnt) {
+        TUYA_CALL_ERR_LOG(_event_async_dispatch(snapshot, data, len));
+    }
+    for (int i = 0; i < snapshot->cnt; i++) {
+        if (snapshot->item[i].type != SUBSCRIBE_TYPE_ASYNC) {
+            TUYA_CALL_ERR_LOG(snapshot->item[i].cb(data));
         }
     }
 
+    tal_mutex_lock(event->mutex);
+    _event_snapshot_put(snapshot);
+    tal_mutex_unlock(event->mutex);
+
     return rt;
 }
 
@@ -225,6 +405,12 @@ OPERATE_RET _event_node_add_subscribe(EVENT_NODE_T *event, SUBSCRIBE_NODE_T *sub
         tuya_list_add_tail(&new_entry->node, &event->subscribe_root);
     }
 
+    rt = _event_snapshot_update(event);
+    if (OPRT_OK != rt) {
+        tuya_list_del(&new_entry->node);
+        tal_free(new_entry);
+    }
+
     return rt;
 }
 
@@ -259,6 +445,16 @@ OPERATE_RET _event_node_del_subscribe(EVENT_NODE_T *event, SUBSCRIBE_NODE_T *sub
     tuya_list_del(&new_entry->node);
     tal_free(new_entry);
     new_entry = NULL;
+
+    // without memory for a new snapshot, silence the callback in the old one
+    if (OPRT_OK != _event_snapshot_update(event) && event->snapshot) {
+        for (int i = 0; i < event->snapshot->cnt; i++) {
+            if (event->snapshot->item[i].cb == subscribe->cb) {
+                event->snapshot->item[i].cb = _event_cb_removed;
+                break;
+            }
+        }
+    }
     return rt;
 }
 
@@ -337,6 +533,9 @@ OPERATE_RET tal_event_init(void)
 
     INIT_LIST_HEAD(&g_event_manager.event_root);
     INIT_LIST_HEAD(&g_event_manager.free_subscribe_root);
+    for (int i = 0; i < EVENT_HASH_BUCKETS; i++) {
+        INIT_LIST_HEAD(&g_event_manager.event_hash[i]);
+    }
     tal_mutex_create_init(&g_event_manager.mutex);
     g_event_manager.event_cnt = 0;
     g_event_manager.inited = TRUE;
@@ -374,24 +573,11 @@ OPERATE_RET tal_event_publish(const char *name, void *data)
         return OPRT_BASE_EVENT_INVALID_EVENT_NAME;
     }
 
-    OPERATE_RET rt = OPRT_OK;
     // try to get event, if not exist, create and init.
-    EVENT_NODE_T *event = _event_node_get(name);
-    if (!event) {
-        event = _event_node_create_init(name);
-        TUYA_CHECK_NULL_RETURN(event, OPRT_MALLOC_FAILED);
-    }
-
-    // to keep the consistency, dispatch will done in mutex lock
-    tal_mutex_lock(event->mutex);
-    // try to dispatch event to all subscribe
-    // if one of the subscribe failed, it will continue but will return failed
-    // to record the execute status
-    TUYA_CALL_ERR_LOG(_event_node_dispatch(event, data));
+    EVENT_NODE_T *event = _event_node_get_or_create(name);
+    TUYA_CHECK_NULL_RETURN(event, OPRT_MALLOC_FAILED);
 
-    tal_mutex_unlock(event->mutex);
-
-    return rt;
+    return tal_event_publish_handle(event, data);
 }
 
 /**
@@ -432,13 +618,14 @@ OPERATE_RET tal_event_subscribe(const char *name, const char *desc, const EVENT_
     memcpy(subscribe.desc, desc, strlen(desc));
     subscribe.desc[strlen(desc)] = '\0';
 
+    tal_mutex_lock(g_event_manager.mutex);
     EVENT_NODE_T *event = _event_node_get(name);
     if (!event) {
         // if not found the event, add to the free list
-        tal_mutex_lock(g_event_manager.mutex);
         TUYA_CALL_ERR_LOG(_event_node_add_free_subscribe(&subscribe));
         tal_mutex_unlock(g_event_manager.mutex);
     } else {
+        tal_mutex_unlock(g_event_manager.mutex);
         // if found the event, add to the subscribe list
         tal_mutex_lock(event->mutex);
         TUYA_CALL_ERR_LOG(_event_node_add_subscribe(event, &subscribe));
@@ -487,13 +674,14 @@ OPERATE_RET tal_event_unsubscribe(const char *name, const char *desc, EVENT_SUBS
     memcpy(subscribe.desc, desc, strlen(desc));
     subscribe.desc[strlen(desc)] = '\0';
 
+    tal_mutex_lock(g_event_manager.mutex);
     EVENT_NODE_T *event = _event_node_get(name);
     if (!event) {
         // if not found the event, del from the free list
-        tal_mutex_lock(g_event_manager.mutex);
         TUYA_CALL_ERR_LOG(_event_node_del_free_subscribe(&subscribe));
         tal_mutex_unlock(g_event_manager.mutex);
     } else {
+        tal_mutex_unlock(g_event_manager.mutex);
         // if found the event, del from the subscribe list
         tal_mutex_lock(event->mutex);
         TUYA_CALL_ERR_LOG(_event_node_del_subscribe(event, &subscribe));
@@ -502,3 +690,115 @@ OPERATE_RET tal_event_unsubscribe(const char *name, const char *desc, EVENT_SUBS
 
     return rt;
 }
+
+/**
+ * @brief Looks up an event by name once, creating it if needed.
+ *
+ * Events are never freed, so the handle can be kept and used with
+ * tal_event_publish_handle() and tal_event_subscribe_handle() to skip the
+ * name lookup on every call.
+ *
+ * @param[in] name The name of the event.
+ * @param[out] handle The event handle.
+ * @return The operation result. Returns OPRT_OK on success, or an error code on
+ * failure.
+ */
+OPERATE_RET tal_event_get_handle(const char *name, EVENT_HANDLE *handle)
+{
+    if (g_event_manager.inited != TRUE) {
+        tal_event_init();
+    }
+
+    if (!_event_name_is_valid(name)) {
+        return OPRT_BASE_EVENT_INVALID_EVENT_NAME;
+    }
+    TUYA_CHECK_NULL_RETURN(handle, OPRT_INVALID_PARM);
+
+    *handle = _event_node_get_or_create(name);
+    TUYA_CHECK_NULL_RETURN(*handle, OPRT_MALLOC_FAILED);
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief Publishes an event by handle.
+ *
+ * The subscribers run in order over the snapshot taken when the publish
+ * starts. If any of the subscribers fail, the function continues dispatching
+ * the event but returns a failed status to record the execution status.
+ *
+ * @param[in] handle The event handle from tal_event_get_handle().
+ * @param[in] data The data associated with the event.
+ * @return The operation result. Returns OPRT_OK on success, or an error code on
+ * failure.
+ */
+OPERATE_RET tal_event_publish_handle(EVENT_HANDLE handle, void *data)
+{
+    TUYA_CHECK_NULL_RETURN(handle, OPRT_INVALID_PARM);
+
+    return _event_node_dispatch(handle, data, 0);
+}
+
+/**
+ * @brief Publishes an event with a payload copy for the async subscribers.
+ *
+ * The synchronous subscribers get data itself. SUBSCRIBE_TYPE_ASYNC
+ * subscribers share one copy of len bytes, freed after the last of them ran,
+ * so data may live on the publisher's stack.
+ *
+ * @param[in] name The name of the event to publish.
+ * @param[in] data The data associated with the event.
+ * @param[in] len The length of data.
+ * @return The operation result. Returns OPRT_OK on success, or an error code on
+ * failure.
+ */
+OPERATE_RET tal_event_publish_copy(const char *name, void *data, uint32_t len)
+{
+    if (g_event_manager.inited != TRUE) {
+        tal_event_init();
+    }
+
+    if (!_event_name_is_valid(name)) {
+        return OPRT_BASE_EVENT_INVALID_EVENT_NAME;
+    }
+
+    EVENT_NODE_T *event = _event_node_get_or_create(name);
+    TUYA_CHECK_NULL_RETURN(event, OPRT_MALLOC_FAILED);
+
+    return _event_node_dispatch(event, data, data ? len : 0);
+}
+
+/**
+ * @brief Subscribes to an event by handle.
+ *
+ * @param handle The event handle from tal_event_get_handle().
+ * @param desc The description of the event.
+ * @param cb The callback function to be called when the event is triggered.
+ * @param type The type of subscription.
+ * @return The result of the operation.
+ *         - OPRT_OK: Operation successful.
+ *         - OPRT_BASE_EVENT_INVALID_EVENT_DESC: Invalid event description.
+ */
+OPERATE_RET tal_event_subscribe_handle(EVENT_HANDLE handle, const char *desc, const EVENT_SUBSCRIBE_CB cb,
+                                       SUBSCRIBE_TYPE_E type)
+{
+    TUYA_CHECK_NULL_RETURN(handle, OPRT_INVALID_PARM);
+
+    if (!_event_desc_is_valid(desc)) {
+        return OPRT_BASE_EVENT_INVALID_EVENT_DESC;
+    }
+
+    OPERATE_RET rt = OPRT_OK;
+    SUBSCRIBE_NODE_T subscribe = {0};
+    subscribe.cb = cb;
+    subscribe.type = type;
+    strcpy(subscribe.name, handle->name);
+    memcpy(subscribe.desc, desc, strlen(desc));
+    subscribe.desc[strlen(desc)] = '\0';
+
+    tal_mutex_lock(handle->mutex);
+    TUYA_CALL_ERR_LOG(_event_node_add_subscribe(handle, &subscribe));
+    tal_mutex_unlock(handle->mutex);
+
+    return rt;
+}
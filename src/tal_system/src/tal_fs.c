@@ -76,6 +76,164 @@ int __lfs_get_cfg(const char *mode)
 
     return flag;
 }
+
+#define LFS_BUF_MIN(a, b) ((a) < (b) ? (a) : (b))
+
+#define LFS_BUF_IDLE  0
+#define LFS_BUF_READ  1 // buf[pos, len) read ahead, lfs is len - pos past the caller
+#define LFS_BUF_WRITE 2 // buf[0, len) written behind, lfs is len short of the caller
+
+/*
+ * A LittleFS file with its stream buffer. The buffer is allocated on the
+ * first buffered access and serves one direction at a time, it is given back
+ * to lfs before the other direction, a seek, a sync or the close.
+ */
+typedef struct {
+    lfs_file_t lfs;
+    int oflags;
+    uint8_t *buf;
+    uint32_t pos;
+    uint32_t len;
+    uint8_t state;
+    bool psram;
+} TAL_LFS_FILE_T;
+
+static bool __lfs_buf_alloc(TAL_LFS_FILE_T *f)
+{
+    if (f->buf || TAL_FS_BUF_SIZE == 0) {
+        return f->buf != NULL;
+    }
+#if defined(ENABLE_EXT_RAM) && (ENABLE_EXT_RAM == 1)
+    if (TAL_FS_BUF_SIZE >= TAL_FS_BUF_PSRAM_MIN) {
+        f->buf = tal_psram_malloc(TAL_FS_BUF_SIZE);
+        f->psram = (f->buf != NULL);
+    }
+#endif
+    if (NULL == f->buf) {
+        f->buf = tal_malloc(TAL_FS_BUF_SIZE);
+    }
+    return f->buf != NULL;
+}
+
+static void __lfs_buf_free(TAL_LFS_FILE_T *f)
+{
+    if (NULL == f->buf) {
+        return;
+    }
+#if defined(ENABLE_EXT_RAM) && (ENABLE_EXT_RAM == 1)
+    if (f->psram) {
+        tal_psram_free(f->buf);
+        f->buf = NULL;
+        return;
+    }
+#endif
+    tal_free(f->buf);
+    f->buf = NULL;
+}
+
+// Write out the data written behind or give back the data read ahead
+static int __lfs_buf_sync(TAL_LFS_FILE_T *f)
+{
+    int rt = 0;
+
+    if (LFS_BUF_WRITE == f->state && f->len > 0) {
+        rt = lfs_file_write(tal_lfs_get(), &f->lfs, f->buf, f->len);
+    } else if (LFS_BUF_READ == f->state && f->pos < f->len) {
+        rt = lfs_file_seek(tal_lfs_get(), &f->lfs, -(lfs_soff_t)(f->len - f->pos), LFS_SEEK_CUR);
+    }
+    f->state = LFS_BUF_IDLE;
+    f->pos = 0;
+    f->len = 0;
+
+    return (rt < 0) ? rt : 0;
+}
+
+// Refill the read ahead, the buffer must be allocated and hold nothing unread
+static int __lfs_buf_fill(TAL_LFS_FILE_T *f)
+{
+    if (LFS_BUF_READ != f->state) {
+        int rt = __lfs_buf_sync(f);
+        if (rt < 0) {
+            return rt;
+        }
+    }
+
+    int rt = lfs_file_read(tal_lfs_get(), &f->lfs, f->buf, TAL_FS_BUF_SIZE);
+    f->state = LFS_BUF_READ;
+    f->pos = 0;
+    f->len = (rt < 0) ? 0 : rt;
+
+    return rt;
+}
+
+static int __lfs_buf_read(TAL_LFS_FILE_T *f, uint8_t *buf, int bytes)
+{
+    int done = 0;
+
+    if (bytes <= 0) {
+        return 0;
+    }
+    if (LFS_BUF_READ == f->state) {
+        done = LFS_BUF_MIN((int)(f->len - f->pos), bytes);
+        memcpy(buf, f->buf + f->pos, done);
+        f->pos += done;
+        if (done == bytes) {
+            return done;
+        }
+    } else {
+        int rt = __lfs_buf_sync(f);
+        if (rt < 0) {
+            return rt;
+        }
+    }
+
+    // Large reads bypass the buffer
+    int rt;
+    if (bytes - done >= TAL_FS_BUF_SIZE || !__lfs_buf_alloc(f)) {
+        rt = lfs_file_read(tal_lfs_get(), &f->lfs, buf + done, bytes - done);
+    } else {
+        rt = __lfs_buf_fill(f);
+        if (rt > 0) {
+            rt = LFS_BUF_MIN(rt, bytes - done);
+            memcpy(buf + done, f->buf, rt);
+            f->pos = rt;
+        }
+    }
+    if (rt < 0) {
+        return done ? done : rt;
+    }
+
+    return done + rt;
+}
+
+static int __lfs_buf_write(TAL_LFS_FILE_T *f, const uint8_t *buf, int bytes)
+{
+    int rt;
+
+    // Fail at the call rather than at the flush
+    if (0 == (f->oflags & LFS_O_WRONLY)) {
+        return LFS_ERR_BADF;
+    }
+    if (bytes <= 0) {
+        return 0;
+    }
+    if (LFS_BUF_WRITE != f->state || f->len + bytes > TAL_FS_BUF_SIZE) {
+        rt = __lfs_buf_sync(f);
+        if (rt < 0) {
+            return rt;
+        }
+    }
+
+    // Large writes bypass the buffer
+    if (bytes >= TAL_FS_BUF_SIZE || !__lfs_buf_alloc(f)) {
+        return lfs_file_write(tal_lfs_get(), &f->lfs, buf, bytes);
+    }
+    memcpy(f->buf + f->len, buf, bytes);
+    f->len += bytes;
+    f->state = LFS_BUF_WRITE;
+
+    return bytes;
+}
 #endif
 
 /**
@@ -351,12 +509,13 @@ TUYA_FILE tal_fopen(const char *path, const char *mode)
 #if defined(ENABLE_FILE_SYSTEM) && (ENABLE_FILE_SYSTEM == 1)
     return tkl_fopen(path, mode);
 #else
-    lfs_file_t *f = tal_malloc(sizeof(lfs_file_t));
+    TAL_LFS_FILE_T *f = tal_malloc(sizeof(TAL_LFS_FILE_T));
     if (!f)
         return NULL;
 
-    memset(f, 0, sizeof(lfs_file_t));
-    if (0 != lfs_file_open(tal_lfs_get(), f, path, __lfs_get_cfg(mode))) {
+    memset(f, 0, sizeof(TAL_LFS_FILE_T));
+    f->oflags = __lfs_get_cfg(mode);
+    if (0 != lfs_file_open(tal_lfs_get(), &f->lfs, path, f->oflags)) {
         tal_free(f);
         return NULL;
     }
@@ -382,7 +541,10 @@ int tal_fclose(TUYA_FILE file)
     if (NULL == file)
         return OPRT_OK;
 
-    lfs_file_close(tal_lfs_get(), (lfs_file_t *)file);
+    TAL_LFS_FILE_T *f = (TAL_LFS_FILE_T *)file;
+    __lfs_buf_sync(f);
+    lfs_file_close(tal_lfs_get(), &f->lfs);
+    __lfs_buf_free(f);
     tal_free(file);
     file = NULL;
     return OPRT_OK;
@@ -405,7 +567,7 @@ int tal_fread(void *buf, int bytes, TUYA_FILE file)
 #if defined(ENABLE_FILE_SYSTEM) && (ENABLE_FILE_SYSTEM == 1)
     return tkl_fread(buf, bytes, file);
 #else
-    return lfs_file_read(tal_lfs_get(), (lfs_file_t *)file, buf, bytes);
+    return __lfs_buf_read((TAL_LFS_FILE_T *)file, buf, bytes);
 #endif
 }
 
@@ -425,7 +587,7 @@ int tal_fwrite(void *buf, int bytes, TUYA_FILE file)
 #if defined(ENABLE_FILE_SYSTEM) && (ENABLE_FILE_SYSTEM == 1)
     return tkl_fwrite(buf, bytes, file);
 #else
-    return lfs_file_write(tal_lfs_get(), (lfs_file_t *)file, buf, bytes);
+    return __lfs_buf_write((TAL_LFS_FILE_T *)file, buf, bytes);
 #endif
 }
 
@@ -443,7 +605,12 @@ int tal_fsync(TUYA_FILE file)
 #if defined(ENABLE_FILE_SYSTEM) && (ENABLE_FILE_SYSTEM == 1)
     return tkl_fsync(file);
 #else
-    return lfs_file_sync(tal_lfs_get(), (lfs_file_t *)file);
+    TAL_LFS_FILE_T *f = (TAL_LFS_FILE_T *)file;
+    int rt = __lfs_buf_sync(f);
+    if (rt < 0) {
+        return rt;
+    }
+    return lfs_file_sync(tal_lfs_get(), &f->lfs);
 #endif
 }
 
@@ -464,9 +631,9 @@ char *tal_fgets(char *buf, int len, TUYA_FILE file)
     return tkl_fgets(buf, len, file);
 #else
     int i = 0;
-    char c;
+    uint8_t c;
     while (i < len - 1) {
-        int rt = lfs_file_read(tal_lfs_get(), file, &c, 1);
+        int rt = __lfs_buf_read((TAL_LFS_FILE_T *)file, &c, 1);
         if (rt < 0) {
             return NULL;
         } else if (rt == 0) {
@@ -480,7 +647,7 @@ char *tal_fgets(char *buf, int len, TUYA_FILE file)
     }
 
     buf[i] = '\0';
-    if (i == 0 && c != '\n') {
+    if (i == 0 && len > 1) {
         return NULL;
     }
 
@@ -502,12 +669,20 @@ int tal_feof(TUYA_FILE file)
 #if defined(ENABLE_FILE_SYSTEM) && (ENABLE_FILE_SYSTEM == 1)
     return tkl_feof(file);
 #else
+    TAL_LFS_FILE_T *f = (TAL_LFS_FILE_T *)file;
+    if (LFS_BUF_READ == f->state && f->pos < f->len)
+        return 0;
+
+    // the look ahead stays in the buffer for the next read
+    if (__lfs_buf_alloc(f))
+        return (__lfs_buf_fill(f) <= 0) ? 1 : 0;
+
     char ch;
-    if (0 == lfs_file_read(tal_lfs_get(), (lfs_file_t *)file, &ch, 1))
+    if (0 == lfs_file_read(tal_lfs_get(), &f->lfs, &ch, 1))
         return 1;
 
     // if not EOF, need seek back (read will change the offset)
-    lfs_file_seek(tal_lfs_get(), (lfs_file_t *)file, -1, LFS_SEEK_CUR);
+    lfs_file_seek(tal_lfs_get(), &f->lfs, -1, LFS_SEEK_CUR);
     return 0;
 #endif
 }
@@ -528,7 +703,12 @@ int tal_fseek(TUYA_FILE file, int64_t offs, int whence)
 #if defined(ENABLE_FILE_SYSTEM) && (ENABLE_FILE_SYSTEM == 1)
     return tkl_fseek(file, offs, whence);
 #else
-    return lfs_file_seek(tal_lfs_get(), (lfs_file_t *)file, offs, whence);
+    TAL_LFS_FILE_T *f = (TAL_LFS_FILE_T *)file;
+    int rt = __lfs_buf_sync(f);
+    if (rt < 0) {
+        return rt;
+    }
+    return lfs_file_seek(tal_lfs_get(), &f->lfs, offs, whence);
 #endif
 }
 
@@ -546,7 +726,17 @@ int64_t tal_ftell(TUYA_FILE file)
 #if defined(ENABLE_FILE_SYSTEM) && (ENABLE_FILE_SYSTEM == 1)
     return tkl_ftell(file);
 #else
-    return lfs_file_tell(tal_lfs_get(), (lfs_file_t *)file);
+    TAL_LFS_FILE_T *f = (TAL_LFS_FILE_T *)file;
+    int64_t pos = lfs_file_tell(tal_lfs_get(), &f->lfs);
+    if (pos < 0) {
+        return pos;
+    }
+    if (LFS_BUF_WRITE == f->state) {
+        pos += f->len;
+    } else if (LFS_BUF_READ == f->state) {
+        pos -= f->len - f->pos;
+    }
+    return pos;
 #endif
 }
 
@@ -608,9 +798,9 @@ int tal_fgetc(TUYA_FILE file)
 #if defined(ENABLE_FILE_SYSTEM) && (ENABLE_FILE_SYSTEM == 1)
     return tkl_fgetc(file);
 #else
-    char ch;
-    if (0 == lfs_file_read(tal_lfs_get(), (lfs_file_t *)file, &ch, 1))
-        ch = EOF;
+    uint8_t ch;
+    if (1 != __lfs_buf_read((TAL_LFS_FILE_T *)file, &ch, 1))
+        return EOF;
     return ch;
 #endif
 }
@@ -629,7 +819,7 @@ int tal_fflush(TUYA_FILE file)
 #if defined(ENABLE_FILE_SYSTEM) && (ENABLE_FILE_SYSTEM == 1)
     return tkl_fflush(file);
 #else
-    return lfs_file_sync(tal_lfs_get(), (lfs_file_t *)file);
+    return tal_fsync(file);
 #endif
 }
 
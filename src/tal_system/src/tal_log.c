@@ -13,6 +13,8 @@
  * - Configurable log levels ranging from debug to critical errors.
  * - Support for multiple log output destinations through callback registration.
  * - Thread-safe log message output using mutexes.
+ * - Optional asynchronous output (ENABLE_LOG_ASYNC): callers only copy the
+ *   message into a ring and a drain thread formats and writes it.
  * - Integration with Tuya's IoT SDK for memory management and system utilities.
  *
  * The logging system is implemented using a linked list to manage output
@@ -35,6 +37,8 @@
 #include "tal_log.h"
 #include "tuya_list.h"
 #include "tal_mutex.h"
+#include "tal_semaphore.h"
+#include "tal_thread.h"
 #include "tal_system.h"
 #include "tal_time_service.h"
 #include "tal_memory.h"
@@ -45,6 +49,57 @@
 #define LOG_LEVEL_MIN 0
 #define LOG_LEVEL_MAX 5
 
+#define LOG_HEX_WIDTH_MAX 64 // bytes per tal_log_hex_dump() line, larger widths are clamped
+#define LOG_HEX_ROW_SIZE  (7 + LOG_HEX_WIDTH_MAX * 4 + 2 + 2 + 1)
+
+#if defined(ENABLE_LOG_ASYNC) && (ENABLE_LOG_ASYNC == 1)
+#define LOG_RING_ENABLE 1
+
+// bytes of the log ring, a power of 2
+#ifndef TAL_LOG_RING_SIZE
+#define TAL_LOG_RING_SIZE (8 * 1024)
+#endif
+
+#if (TAL_LOG_RING_SIZE & (TAL_LOG_RING_SIZE - 1))
+#error "TAL_LOG_RING_SIZE must be a power of 2"
+#endif
+
+// messages up to this length are formatted on the caller stack and copied
+#ifndef TAL_LOG_MSG_STACK_LEN
+#define TAL_LOG_MSG_STACK_LEN 128
+#endif
+
+#ifndef STACK_SIZE_LOG_DRAIN
+#define STACK_SIZE_LOG_DRAIN 3072
+#endif
+
+#define LOG_ENTRY_ALIGN 8
+#define LOG_ENTRY_RAW   0xFE // tal_log_print_raw(), no header
+#define LOG_ENTRY_PAD   0xFF // unused end of the ring before a wrap
+
+/* an entry is this header followed by the NUL terminated message */
+typedef struct {
+    uint16_t size; // header, message and padding
+    uint8_t level;
+    volatile uint8_t ready;
+    uint32_t line;
+    SYS_TIME_T tick;
+    const char *file;
+    const char *text; // constant message, NULL when it follows the header
+} LOG_ENTRY_S;
+
+/* head and tail run free, the ring offset is taken with the mask */
+typedef struct {
+    uint32_t head;
+    uint32_t tail;
+    uint32_t dropped;
+    uint32_t reported;
+    SEM_HANDLE sem;
+    THREAD_HANDLE thread;
+    uint8_t buf[TAL_LOG_RING_SIZE];
+} LOG_RING_S;
+#endif
+
 typedef struct {
     LIST_HEAD node;
     char *name;
@@ -73,6 +128,9 @@ typedef struct {
     int log_buf_len;
     BOOL_T ms_level;
     char *log_buf;
+#ifdef LOG_RING_ENABLE
+    LOG_RING_S *ring;
+#endif
 } LOG_MANAGE, *P_LOG_MANAGE;
 
 #define DEF_OUTPUT_NAME "def_output"
@@ -94,6 +152,12 @@ const LOG_TEXT_STYLE_S sDefaultStyle[LOG_LEVEL_MAX + 1] = {
 /***********************************************************
 *************************function define********************
 ***********************************************************/
+static OPERATE_RET __log_printv(LOG_LEVEL logLevel, const char *pFile, uint32_t line, const char *text,
+                                const char *pFmt, va_list ap);
+#ifdef LOG_RING_ENABLE
+static OPERATE_RET __log_ring_start(void);
+#endif
+
 /**
  * @brief Initializes the TAL log system.
  *
@@ -146,6 +210,12 @@ OPERATE_RET tal_log_init(const TAL_LOG_LEVEL_E level, const int buf_len, const T
             tal_free(tmp_log_mng);
             return op_ret;
         }
+
+#ifdef LOG_RING_ENABLE
+        // stay synchronous when the drain thread can not be started
+        tmp_log_mng->ring = NULL;
+        __log_ring_start();
+#endif
     } else {
         pLogManage->curLogLevel = level;
     }
@@ -153,7 +223,7 @@ OPERATE_RET tal_log_init(const TAL_LOG_LEVEL_E level, const int buf_len, const T
     return OPRT_OK;
 }
 
-void __output_logManage_buf(void)
+static void __log_output_str(const char *str)
 {
     P_LIST_HEAD pPos;
     LOG_OUT_NODE_S *output_node;
@@ -161,11 +231,16 @@ void __output_logManage_buf(void)
     {
         output_node = tuya_list_entry(pPos, LOG_OUT_NODE_S, node);
         if (output_node->out_term) {
-            output_node->out_term(pLogManage->log_buf);
+            output_node->out_term(str);
         }
     }
 }
 
+void __output_logManage_buf(void)
+{
+    __log_output_str(pLogManage->log_buf);
+}
+
 OPERATE_RET __find_out_term_node(const char *name, LOG_OUT_NODE_S **node)
 {
     P_LIST_HEAD pPos;
@@ -252,6 +327,318 @@ static OPERATE_RET __log_escape_percent(const char *src, char *dst, size_t dst_l
     return OPRT_OK;
 }
 
+static int tal_log_strrchr(char *str, char ch)
+{
+    char *ta;
+
+    ta = strrchr(str, ch);
+    if (ta) {
+        return (int)(ta - str);
+    }
+
+    return -1;
+}
+
+static const char *__log_basename(const char *pFile)
+{
+    int pos = 0;
+
+    if (NULL == pFile) {
+        return "Null";
+    }
+    pos = tal_log_strrchr((char *)pFile, '/');
+    if (pos < 0) {
+        pos = tal_log_strrchr((char *)pFile, '\\');
+    }
+
+    return (pos >= 0) ? pFile + pos + 1 : pFile;
+}
+
+/* format color and "[time ty level][file:line] " into log_buf, posix_ms 0 is now */
+static int __log_fmt_head(LOG_LEVEL logLevel, const char *pFilename, uint32_t line, SYS_TICK_T posix_ms)
+{
+    int len = 0;
+    int cnt = 0;
+    const char *pTmpModuleName = "ty";
+
+    // color prefix
+    if (pLogManage->log_color.enable_color) {
+        cnt = snprintf(pLogManage->log_buf, pLogManage->log_buf_len, "\033[%d;%d;%dm",
+                       pLogManage->log_color.style[logLevel].display_mode,
+                       pLogManage->log_color.style[logLevel].font_color,
+                       pLogManage->log_color.style[logLevel].background_color);
+        if (cnt <= 0) {
+            return -1;
+        }
+        len += cnt;
+    }
+
+    POSIX_TM_S tm;
+    memset(&tm, 0, sizeof(tm));
+
+    if (pLogManage->ms_level == FALSE) {
+        tal_time_get_local_time_custom((TIME_T)(posix_ms / 1000), &tm);
+        cnt = snprintf(pLogManage->log_buf + len, pLogManage->log_buf_len - len,
+                       "[%02d-%02d %02d:%02d:%02d %s %s][%s:%" PRIu32 "] ", tm.tm_mon + 1, tm.tm_mday, tm.tm_hour,
+                       tm.tm_min, tm.tm_sec, pTmpModuleName, sLevelStr[logLevel], pFilename, line);
+    } else {
+        SYS_TICK_T time_ms = posix_ms ? posix_ms : tal_time_get_posix_ms();
+        TIME_T sec = (TIME_T)(time_ms / 1000);
+        uint32_t ms = (uint32_t)(time_ms % 1000);
+        tal_time_get_local_time_custom(sec, &tm);
+        cnt = snprintf(pLogManage->log_buf + len, pLogManage->log_buf_len - len,
+                       "[%02d-%02d %02d:%02d:%02d:%" PRIu32 " %s %s][%s:%" PRIu32 "] ", tm.tm_mon + 1, tm.tm_mday,
+                       tm.tm_hour, tm.tm_min, tm.tm_sec, ms, pTmpModuleName, sLevelStr[logLevel], pFilename, line);
+    }
+    if (cnt <= 0) {
+        return -1;
+    }
+
+    return len + cnt;
+}
+
+/* clip a message of len bytes in log_buf and append the line end */
+static int __log_fmt_tail(int len)
+{
+    int cnt = 0;
+    char *p_suffix = (pLogManage->log_color.enable_color) ? "\033[0m\r\n" : "\r\n";
+
+    if (len > (int)(pLogManage->log_buf_len - strlen(p_suffix) - 1)) { // 1 -> "\0"
+        len = pLogManage->log_buf_len - strlen(p_suffix) - 1;
+    }
+    cnt = snprintf(pLogManage->log_buf + len, pLogManage->log_buf_len - len, "%s", p_suffix);
+    if (cnt <= 0) {
+        return -1;
+    }
+    len += cnt;
+    pLogManage->log_buf[len] = '\0';
+
+    return len;
+}
+
+#ifdef LOG_RING_ENABLE
+/*
+ * Callers reserve an entry with a few index updates in a critical section,
+ * fill it without any lock and mark it ready, so a logging thread never
+ * waits for the output terminals. A full ring drops the message and counts
+ * it. The drain thread is the only consumer, it holds the log mutex while
+ * it formats the header and writes entries out in order.
+ */
+static LOG_ENTRY_S *__log_ring_reserve(LOG_RING_S *ring, uint32_t size)
+{
+    LOG_ENTRY_S *entry = NULL;
+
+    TAL_ENTER_CRITICAL();
+    uint32_t pos = ring->head & (TAL_LOG_RING_SIZE - 1);
+    uint32_t room_end = TAL_LOG_RING_SIZE - pos;
+    uint32_t need = (room_end < size) ? room_end + size : size;
+
+    if (ring->head - ring->tail + need > TAL_LOG_RING_SIZE) {
+        ring->dropped++;
+    } else {
+        if (room_end < size) {
+            // entries are contiguous, skip the end of the ring
+            entry = (LOG_ENTRY_S *)&ring->buf[pos];
+            entry->size = room_end;
+            entry->level = LOG_ENTRY_PAD;
+            entry->ready = 1;
+            ring->head += room_end;
+            pos = 0;
+        }
+        entry = (LOG_ENTRY_S *)&ring->buf[pos];
+        entry->size = size;
+        entry->ready = 0;
+        ring->head += size;
+    }
+    TAL_EXIT_CRITICAL();
+
+    return entry;
+}
+
+static void __log_ring_commit(LOG_RING_S *ring, LOG_ENTRY_S *entry)
+{
+    TAL_ENTER_CRITICAL();
+    entry->ready = 1;
+    TAL_EXIT_CRITICAL();
+
+    tal_semaphore_post(ring->sem);
+}
+
+/*
+ * text is a constant message without conversions, only its pointer is
+ * queued and it is formatted on drain. Otherwise the message is formatted
+ * here, on the stack when it is short, else straight into the entry.
+ */
+static OPERATE_RET __log_ring_put(uint8_t level, const char *file, uint32_t line, const char *text, const char *fmt,
+                                  va_list ap)
+{
+    LOG_RING_S *ring = pLogManage->ring;
+    char msg[TAL_LOG_MSG_STACK_LEN];
+    int cnt = 0;
+
+    if (NULL == text) {
+        va_list cp;
+        va_copy(cp, ap);
+        cnt = vsnprintf(msg, sizeof(msg), fmt, cp);
+        va_end(cp);
+        if (cnt < 0) {
+            return OPRT_BASE_LOG_MNG_FORMAT_STRING_FAILED;
+        }
+        int max_len = (pLogManage->log_buf_len < TAL_LOG_RING_SIZE / 4) ? pLogManage->log_buf_len
+                                                                         : TAL_LOG_RING_SIZE / 4;
+        if (cnt > max_len) {
+            cnt = max_len;
+        }
+    }
+
+    uint32_t size = (sizeof(LOG_ENTRY_S) + (text ? 0 : cnt + 1) + LOG_ENTRY_ALIGN - 1) & ~(LOG_ENTRY_ALIGN - 1);
+    LOG_ENTRY_S *entry = __log_ring_reserve(ring, size);
+    if (NULL == entry) {
+        tal_semaphore_post(ring->sem);
+        return OPRT_EXCEED_UPPER_LIMIT;
+    }
+
+    entry->level = level;
+    entry->line = line;
+    entry->tick = tal_system_get_millisecond();
+    entry->file = file;
+    entry->text = text;
+    if (NULL == text) {
+        char *body = (char *)(entry + 1);
+        if (cnt < (int)sizeof(msg)) {
+            memcpy(body, msg, cnt + 1);
+        } else {
+            vsnprintf(body, cnt + 1, fmt, ap);
+        }
+    }
+    __log_ring_commit(ring, entry);
+
+    return OPRT_OK;
+}
+
+static void __log_ring_output(LOG_ENTRY_S *entry)
+{
+    const char *msg = entry->text ? entry->text : (const char *)(entry + 1);
+
+    if (LOG_ENTRY_RAW == entry->level) {
+        __log_output_str(msg);
+        return;
+    }
+
+    // the entry keeps the system tick, turn it into the posix time it was logged at
+    SYS_TICK_T posix_ms = tal_time_get_posix_ms() - (SYS_TICK_T)(tal_system_get_millisecond() - entry->tick);
+    int len = __log_fmt_head(entry->level, __log_basename(entry->file), entry->line, posix_ms);
+    if (len < 0) {
+        return;
+    }
+    int cnt = snprintf(pLogManage->log_buf + len, pLogManage->log_buf_len - len, "%s", msg);
+    if (cnt <= 0) {
+        return;
+    }
+    if (__log_fmt_tail(len + cnt) < 0) {
+        return;
+    }
+    __output_logManage_buf();
+}
+
+/* write out all ready entries in order, the caller holds the log mutex */
+static void __log_ring_drain(LOG_RING_S *ring)
+{
+    LOG_ENTRY_S *entry = NULL;
+    uint32_t dropped = 0;
+    uint8_t ready = 0;
+    uint32_t irq_mask = 0;
+
+    for (;;) {
+        irq_mask = tal_system_enter_critical();
+        entry = (ring->tail == ring->head) ? NULL : (LOG_ENTRY_S *)&ring->buf[ring->tail & (TAL_LOG_RING_SIZE - 1)];
+        ready = entry ? entry->ready : 0;
+        dropped = ring->dropped;
+        tal_system_exit_critical(irq_mask);
+
+        if (dropped != ring->reported) {
+            snprintf(pLogManage->log_buf, pLogManage->log_buf_len, "[log] %" PRIu32 " messages dropped\r\n",
+                     dropped - ring->reported);
+            __output_logManage_buf();
+            ring->reported = dropped;
+        }
+        // an empty ring, or a writer still filling the oldest entry
+        if (!ready) {
+            break;
+        }
+
+        if (LOG_ENTRY_PAD != entry->level) {
+            __log_ring_output(entry);
+        }
+
+        irq_mask = tal_system_enter_critical();
+        ring->tail += entry->size;
+        tal_system_exit_critical(irq_mask);
+    }
+}
+
+static void __log_ring_thread_cb(void *args)
+{
+    LOG_RING_S *ring = (LOG_RING_S *)args;
+
+    while (THREAD_STATE_RUNNING == tal_thread_get_state(ring->thread)) {
+        tal_semaphore_wait(ring->sem, SEM_WAIT_FOREVER);
+        tal_mutex_lock(pLogManage->mutex);
+        __log_ring_drain(ring);
+        tal_mutex_unlock(pLogManage->mutex);
+    }
+}
+
+static OPERATE_RET __log_ring_start(void)
+{
+    OPERATE_RET op_ret = OPRT_OK;
+
+    LOG_RING_S *ring = (LOG_RING_S *)tal_malloc(sizeof(LOG_RING_S));
+    if (NULL == ring) {
+        return OPRT_MALLOC_FAILED;
+    }
+    memset(ring, 0, sizeof(LOG_RING_S));
+
+    op_ret = tal_semaphore_create_init(&ring->sem, 0, 1);
+    if (OPRT_OK != op_ret) {
+        tal_free(ring);
+        return op_ret;
+    }
+
+    THREAD_CFG_T thread_cfg = {.stackDepth = STACK_SIZE_LOG_DRAIN, .priority = THREAD_PRIO_4, .thrdname = "log_drain"};
+    op_ret = tal_thread_create_and_start(&ring->thread, NULL, NULL, __log_ring_thread_cb, ring, &thread_cfg);
+    if (OPRT_OK != op_ret) {
+        tal_semaphore_release(ring->sem);
+        tal_free(ring);
+        return op_ret;
+    }
+    pLogManage->ring = ring;
+
+    return OPRT_OK;
+}
+
+static void __log_ring_stop(void)
+{
+    LOG_RING_S *ring = pLogManage->ring;
+    if (NULL == ring) {
+        return;
+    }
+
+    tal_mutex_lock(pLogManage->mutex);
+    pLogManage->ring = NULL;
+    __log_ring_drain(ring);
+    tal_mutex_unlock(pLogManage->mutex);
+
+    tal_thread_delete(ring->thread);
+    tal_semaphore_post(ring->sem);
+    while (THREAD_STATE_DELETE != tal_thread_get_state(ring->thread)) {
+        tal_system_sleep(10);
+    }
+    tal_semaphore_release(ring->sem);
+    tal_free(ring);
+}
+#endif
+
 /**
  * @brief Adds an output terminal for logging.
  *
@@ -297,18 +684,6 @@ OPERATE_RET tal_log_add_output_term(const char *name, const TAL_LOG_OUTPUT_CB te
     return OPRT_OK;
 }
 
-static int tal_log_strrchr(char *str, char ch)
-{
-    char *ta;
-
-    ta = strrchr(str, ch);
-    if (ta) {
-        return (int)(ta - str);
-    }
-
-    return -1;
-}
-
 /**
  * @brief Deletes a log output terminal with the specified name.
  *
@@ -435,6 +810,13 @@ OPERATE_RET tal_log_get_level(TAL_LOG_LEVEL_E *level)
  * the log message.
  */
 OPERATE_RET PrintLogV(LOG_LEVEL logLevel, char *pFile, uint32_t line, const char *pFmt, va_list ap)
+{
+    return __log_printv(logLevel, pFile, line, NULL, pFmt, ap);
+}
+
+/* text is pFmt when it is a constant without conversions, else NULL */
+static OPERATE_RET __log_printv(LOG_LEVEL logLevel, const char *pFile, uint32_t line, const char *text,
+                                const char *pFmt, va_list ap)
 {
     int len = 0;
     int cnt = 0;
@@ -449,75 +831,28 @@ OPERATE_RET PrintLogV(LOG_LEVEL logLevel, char *pFile, uint32_t line, const char
     if (logLevel > tmpLogLevel) {
         return OPRT_BASE_LOG_MNG_PRINT_LOG_LEVEL_HIGHER;
     }
-    const char *pTmpModuleName = "ty";
-    const char *pTmpFilename = NULL;
-
-    if (NULL == pFile) {
-        pTmpFilename = "Null";
-    } else {
-        int pos = 0;
-        pTmpFilename = pFile;
-        pos = tal_log_strrchr((char *)pFile, '/');
-        if (pos < 0) {
-            pos = tal_log_strrchr((char *)pFile, '\\');
-            if (pos >= 0) {
-                pTmpFilename = pFile + pos + 1;
-            }
-        } else {
-            pTmpFilename = pFile + pos + 1;
-        }
+#ifdef LOG_RING_ENABLE
+    if (pLogManage->ring) {
+        return __log_ring_put(logLevel, pFile, line, text, pFmt, ap);
     }
-    tal_mutex_lock(pLogManage->mutex);
+#endif
+    const char *pTmpFilename = __log_basename(pFile);
 
-    // color prefix
-    if (pLogManage->log_color.enable_color) {
-        cnt = snprintf(pLogManage->log_buf, pLogManage->log_buf_len, "\033[%d;%d;%dm",
-                       pLogManage->log_color.style[logLevel].display_mode,
-                       pLogManage->log_color.style[logLevel].font_color,
-                       pLogManage->log_color.style[logLevel].background_color);
-        if (cnt <= 0) {
-            goto ERR_EXIT;
-        }
-        len += cnt;
-    }
-
-    POSIX_TM_S tm;
-    memset(&tm, 0, sizeof(tm));
+    tal_mutex_lock(pLogManage->mutex);
 
-    if (pLogManage->ms_level == FALSE) {
-        tal_time_get_local_time_custom(0, &tm);
-        cnt = snprintf(pLogManage->log_buf + len, pLogManage->log_buf_len - len,
-                       "[%02d-%02d %02d:%02d:%02d %s %s][%s:%" PRIu32 "] ", tm.tm_mon + 1, tm.tm_mday, tm.tm_hour,
-                       tm.tm_min, tm.tm_sec, pTmpModuleName, sLevelStr[logLevel], pTmpFilename, line);
-    } else {
-        SYS_TICK_T time_ms = tal_time_get_posix_ms();
-        TIME_T sec = (TIME_T)(time_ms / 1000);
-        uint32_t ms = (uint32_t)(time_ms % 1000);
-        tal_time_get_local_time_custom(sec, &tm);
-        cnt = snprintf(pLogManage->log_buf + len, pLogManage->log_buf_len - len,
-                       "[%02d-%02d %02d:%02d:%02d:%" PRIu32 " %s %s][%s:%" PRIu32 "] ", tm.tm_mon + 1, tm.tm_mday,
-                       tm.tm_hour, tm.tm_min, tm.tm_sec, ms, pTmpModuleName, sLevelStr[logLevel], pTmpFilename, line);
-    }
-    if (cnt <= 0) {
+    len = __log_fmt_head(logLevel, pTmpFilename, line, 0);
+    if (len < 0) {
         goto ERR_EXIT;
     }
-    len += cnt;
     cnt = vsnprintf(pLogManage->log_buf + len, pLogManage->log_buf_len - len, pFmt, ap);
     if (cnt <= 0) {
         goto ERR_EXIT;
     }
     len += cnt;
 
-    char *p_suffix = (pLogManage->log_color.enable_color) ? "\033[0m\r\n" : "\r\n";
-    if (len > (int)(pLogManage->log_buf_len - strlen(p_suffix) - 1)) { // 1 -> "\0"
-        len = pLogManage->log_buf_len - strlen(p_suffix) - 1;
-    }
-    cnt = snprintf(pLogManage->log_buf + len, pLogManage->log_buf_len - len, "%s", p_suffix);
-    if (cnt <= 0) {
+    if (__log_fmt_tail(len) < 0) {
         goto ERR_EXIT;
     }
-    len += cnt;
-    pLogManage->log_buf[len] = '\0';
 
     __output_logManage_buf();
     tal_mutex_unlock(pLogManage->mutex);
@@ -579,7 +914,7 @@ OPERATE_RET tal_log_print_secure(BOOL_T is_const_fmt, const TAL_LOG_LEVEL_E leve
         }
         va_list ap;
         va_start(ap, fmt);
-        OPERATE_RET ret = PrintLogV(level, (char *)file, line, fmt, ap);
+        OPERATE_RET ret = __log_printv(level, file, line, strchr(fmt, '%') ? NULL : fmt, fmt, ap);
         va_end(ap);
         return ret;
     }
@@ -626,6 +961,15 @@ OPERATE_RET tal_log_print_raw(const char *pFmt, ...)
     OPERATE_RET opRet = 0;
     va_list ap;
 
+#ifdef LOG_RING_ENABLE
+    if (pLogManage->ring) {
+        va_start(ap, pFmt);
+        opRet = __log_ring_put(LOG_ENTRY_RAW, NULL, 0, NULL, pFmt, ap);
+        va_end(ap);
+        return opRet;
+    }
+#endif
+
     tal_mutex_lock(pLogManage->mutex);
     va_start(ap, pFmt);
     opRet = __PrintLogVRaw(pFmt, ap);
@@ -691,6 +1035,10 @@ void tal_log_release(void)
         return;
     }
 
+#ifdef LOG_RING_ENABLE
+    __log_ring_stop();
+#endif
+
     while (!tuya_list_empty(&(pLogManage->log_list))) {
         LOG_OUT_NODE_S *log_out_nd = NULL;
         log_out_nd = tuya_list_entry(&(pLogManage->log_list.next), LOG_OUT_NODE_S, node);
@@ -704,6 +1052,27 @@ void tal_log_release(void)
     pLogManage = NULL;
 }
 
+// append to a hex dump row, the length never passes the end of the row
+static int __log_hex_row_add(char *row, int len, const char *fmt, ...)
+{
+    va_list ap;
+    int n = 0;
+
+    if (len >= LOG_HEX_ROW_SIZE - 1) {
+        return LOG_HEX_ROW_SIZE - 1;
+    }
+
+    va_start(ap, fmt);
+    n = vsnprintf(row + len, LOG_HEX_ROW_SIZE - len, fmt, ap);
+    va_end(ap);
+    if (n < 0) {
+        return len;
+    }
+
+    len += n;
+    return (len < LOG_HEX_ROW_SIZE - 1) ? len : LOG_HEX_ROW_SIZE - 1;
+}
+
 /**
  * @brief Logs a hexadecimal dump of a buffer.
  *
@@ -721,7 +1090,8 @@ void tal_log_release(void)
  * @param line The line number in the source file where the log message is
  * generated.
  * @param title Additional information about the log message.
- * @param width The number of bytes to display per line in the hexadecimal dump.
+ * @param width The number of bytes to display per line in the hexadecimal dump,
+ * clamped to LOG_HEX_WIDTH_MAX, 0 selects 16.
  * @param buf The buffer to be dumped.
  * @param size The size of the buffer in bytes.
  *
@@ -730,39 +1100,42 @@ void tal_log_release(void)
 void tal_log_hex_dump(const TAL_LOG_LEVEL_E level, const char *file, const int line, const char *title, uint8_t width,
                       uint8_t *buf, uint16_t size)
 {
-    uint16_t i = 0, j = 0;
+    uint32_t i = 0, j = 0;
+    // "0000 | " + 3 per byte + "| " + 1 per byte + "\r\n", one raw print per line
+    char row[LOG_HEX_ROW_SIZE];
+    int len = 0;
 
     if (!pLogManage || level > pLogManage->curLogLevel) {
         return;
     }
 
-    if (width >= 64) {
-        width = 64;
+    if (0 == width) {
+        width = 16;
+    } else if (width >= LOG_HEX_WIDTH_MAX) {
+        width = LOG_HEX_WIDTH_MAX;
     }
     tal_log_print(level, file, line, "%s %d <%p>", title, size, buf);
 
     for (i = 0; i < size; i += width) {
-        tal_log_print_raw("%04lX | ", i);
+        len = __log_hex_row_add(row, 0, "%04X | ", (unsigned int)i);
 
         for (j = i; j < i + width; j++) {
             if (j < size) {
-                tal_log_print_raw("%02X ", buf[j]);
+                len = __log_hex_row_add(row, len, "%02X ", buf[j]);
             } else {
-                tal_log_print_raw("   ");
+                len = __log_hex_row_add(row, len, "   ");
             }
         }
 
-        tal_log_print_raw("| ");
+        len = __log_hex_row_add(row, len, "| ");
 
-        for (j = i; j < i + width && j < size; j++) {
-            if (isprint(buf[j])) {
-                tal_log_print_raw("%c", buf[j]);
-            } else {
-                tal_log_print_raw(".");
-            }
+        // keep room for the line end and the terminator
+        for (j = i; j < i + width && j < size && len < LOG_HEX_ROW_SIZE - 3; j++) {
+            row[len++] = isprint(buf[j]) ? buf[j] : '.';
         }
 
-        tal_log_print_raw("\r\n");
+        __log_hex_row_add(row, len, "\r\n");
+        tal_log_print_raw("%s", row);
     }
     tal_log_print_raw("\r\n");
 }
@@ -881,3 +1254,45 @@ __EXIT:
 
     return opRet;
 }
+
+/**
+ * @brief Writes out the messages queued for the drain thread.
+ *
+ * This function drains the log ring in the calling thread, so messages
+ * logged right before a reset or a crash dump are not lost. Without
+ * ENABLE_LOG_ASYNC every message is already written and this does nothing.
+ *
+ * @return OPRT_OK on success, OPRT_INVALID_PARM if pLogManage is NULL.
+ */
+OPERATE_RET tal_log_flush(void)
+{
+    if (NULL == pLogManage) {
+        return OPRT_INVALID_PARM;
+    }
+
+#ifdef LOG_RING_ENABLE
+    if (pLogManage->ring) {
+        tal_mutex_lock(pLogManage->mutex);
+        __log_ring_drain(pLogManage->ring);
+        tal_mutex_unlock(pLogManage->mutex);
+    }
+#endif
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief Gets the number of messages dropped because the log ring was full.
+ *
+ * @return The dropped message count since init, 0 without ENABLE_LOG_ASYNC.
+ */
+uint32_t tal_log_get_dropped(void)
+{
+#ifdef LOG_RING_ENABLE
+    if (pLogManage && pLogManage->ring) {
+        return pLogManage->ring->dropped;
+    }
+#endif
+
+    return 0;
+}
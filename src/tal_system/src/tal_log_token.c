@@ -0,0 +1,153 @@
+/**
+ * @file tal_log_token.c
+ * @brief Encodes tokenized log records, see tal_log_token.h.
+ *
+ * The caller only copies its arguments into a small stack buffer, nothing
+ * is formatted on the device. The level filter of tal_log applies.
+ *
+ * @copyright Copyright (c) 2021-2024 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include <string.h>
+#include <stdarg.h>
+#include "tal_log.h"
+#include "tal_log_token.h"
+#include "tal_system.h"
+#include "mix_method.h"
+
+#if defined(ENABLE_LOG_TOKEN) && (ENABLE_LOG_TOKEN == 1)
+
+/***********************************************************
+*************************variable define********************
+***********************************************************/
+static TAL_LOG_TOKEN_OUTPUT_CB s_token_output = NULL;
+
+/***********************************************************
+*************************function define********************
+***********************************************************/
+static uint32_t __token_put_varint(uint8_t *buf, uint32_t pos, uint32_t size, uint64_t value)
+{
+    do {
+        if (pos >= size) {
+            return size + 1;
+        }
+        buf[pos++] = (uint8_t)(value & 0x7F) | ((value > 0x7F) ? 0x80 : 0);
+        value >>= 7;
+    } while (value);
+
+    return pos;
+}
+
+static uint32_t __token_put_arg(uint8_t *buf, uint32_t pos, uint32_t size, uint32_t kind, va_list *ap)
+{
+    switch (kind) {
+    case TAL_LOG_TOKEN_INT32: {
+        int32_t v = (int32_t)va_arg(*ap, uint32_t);
+        return __token_put_varint(buf, pos, size, ((uint32_t)v << 1) ^ (uint32_t)(v >> 31));
+    }
+    case TAL_LOG_TOKEN_INT64: {
+        int64_t v = (int64_t)va_arg(*ap, uint64_t);
+        return __token_put_varint(buf, pos, size, ((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+    }
+    case TAL_LOG_TOKEN_DOUBLE: {
+        double v = va_arg(*ap, double);
+        uint64_t bits = 0;
+        memcpy(&bits, &v, sizeof(bits));
+        if (pos + 8 > size) {
+            return size + 1;
+        }
+        for (int i = 0; i < 8; i++) {
+            buf[pos++] = (uint8_t)(bits >> (8 * i));
+        }
+        return pos;
+    }
+    default: {
+        const char *str = va_arg(*ap, const char *);
+        size_t len = 0;
+        if (NULL == str) {
+            str = "(null)";
+        }
+        while (len < TAL_LOG_TOKEN_STR_MAX && str[len]) {
+            len++;
+        }
+        if (pos + 1 + len > size) {
+            return size + 1;
+        }
+        buf[pos++] = (uint8_t)len;
+        memcpy(buf + pos, str, len);
+        return pos + len;
+    }
+    }
+}
+
+/**
+ * @brief encode and output one tokenized record, called by TAL_LOG_TOKEN()
+ *
+ * @param[in] level log level
+ * @param[in] token offset of the call site entry in the tal_log_tok section
+ * @param[in] kinds argument count and kinds from TAL_LOG_TOKEN_KINDS()
+ * @param[in] ... the arguments
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_log_token_print(uint8_t level, uint32_t token, uint32_t kinds, ...)
+{
+    TAL_LOG_LEVEL_E cur_level = TAL_LOG_LEVEL_ERR;
+    uint8_t buf[TAL_LOG_TOKEN_BUF_LEN];
+    uint32_t pos = 0;
+
+    if (OPRT_OK != tal_log_get_level(&cur_level)) {
+        return OPRT_INVALID_PARM;
+    }
+    if (level > cur_level) {
+        return OPRT_BASE_LOG_MNG_PRINT_LOG_LEVEL_HIGHER;
+    }
+
+    buf[pos++] = level;
+    pos = __token_put_varint(buf, pos, sizeof(buf), token);
+    pos = __token_put_varint(buf, pos, sizeof(buf), kinds);
+    pos = __token_put_varint(buf, pos, sizeof(buf), (uint32_t)tal_system_get_millisecond());
+
+    va_list ap;
+    va_start(ap, kinds);
+    for (uint32_t i = 0; i < (kinds & 0x0F); i++) {
+        uint32_t next = __token_put_arg(buf, pos, sizeof(buf), (kinds >> (4 + 2 * i)) & 0x03, &ap);
+        if (next > sizeof(buf)) {
+            // keep the arguments that fit, the host prints the rest as <cut>
+            buf[0] |= TAL_LOG_TOKEN_TRUNCATED;
+            break;
+        }
+        pos = next;
+    }
+    va_end(ap);
+
+    if (s_token_output) {
+        s_token_output(buf, pos);
+        return OPRT_OK;
+    }
+
+    char line[((TAL_LOG_TOKEN_BUF_LEN + 2) / 3) * 4 + 4];
+    line[0] = '$';
+    tuya_base64_encode(buf, line + 1, pos);
+    return tal_log_print_raw("%s\r\n", line);
+}
+
+/**
+ * @brief set where records are written
+ *
+ * @param[in] output binary record output, NULL writes base64 "$..." lines to
+ * the log terminals
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_log_token_set_output(TAL_LOG_TOKEN_OUTPUT_CB output)
+{
+    s_token_output = output;
+
+    return OPRT_OK;
+}
+
+#endif
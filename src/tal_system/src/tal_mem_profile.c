@@ -0,0 +1,345 @@
+/**
+ * @file tal_mem_profile.c
+ * @brief Allocation profiler behind tal_malloc(), see ENABLE_MEM_PROFILE.
+ *
+ * Every block is kept in an open addressed table keyed by its address, with
+ * its size, RAM, tag and caller. Live and peak bytes are summed per tag and
+ * RAM on the way in and out, so the dump costs nothing on the hot path. The
+ * block layout is not changed, a block freed by tkl_system_free() directly
+ * just stays in the table until its address is reused.
+ *
+ * @copyright Copyright (c) 2021-2024 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include "tal_memory.h"
+#include "tal_system.h"
+#include "tal_log.h"
+
+#if defined(ENABLE_MEM_PROFILE) && (ENABLE_MEM_PROFILE == 1)
+
+/***********************************************************
+*************************micro define***********************
+***********************************************************/
+#define MEM_SLOT_HASH(ptr) ((uint32_t)(((uintptr_t)(ptr) >> 3) * 2654435761u) % TAL_MEM_PROFILE_SLOTS)
+
+typedef struct {
+    void *ptr;
+    void *caller;
+    uint32_t size;
+    uint8_t tag;
+    uint8_t ram;
+} MEM_SLOT_T;
+
+typedef struct {
+    void *caller;
+    uint32_t bytes;
+    uint32_t blocks;
+} MEM_CALLER_T;
+
+/***********************************************************
+*************************variable define********************
+***********************************************************/
+static MEM_SLOT_T s_slots[TAL_MEM_PROFILE_SLOTS];
+static TAL_MEM_TAG_STAT_T s_tags[TAL_MEM_PROFILE_TAGS] = {{.tag = "untagged"}};
+static uint32_t s_tag_num = 1;
+static uint32_t s_untracked = 0;
+
+/***********************************************************
+*************************function define********************
+***********************************************************/
+// called in the critical section, a tag that does not fit is untagged
+static uint8_t __mem_tag_index(const char *tag)
+{
+    if (NULL == tag) {
+        return 0;
+    }
+    for (uint32_t i = 1; i < s_tag_num; i++) {
+        if (s_tags[i].tag == tag || 0 == strcmp(s_tags[i].tag, tag)) {
+            return (uint8_t)i;
+        }
+    }
+    if (s_tag_num >= TAL_MEM_PROFILE_TAGS) {
+        return 0;
+    }
+    s_tags[s_tag_num].tag = tag;
+    return (uint8_t)s_tag_num++;
+}
+
+static void __mem_account(const MEM_SLOT_T *slot, bool add)
+{
+    TAL_MEM_TAG_STAT_T *stat = &s_tags[slot->tag];
+
+    if (add) {
+        stat->live[slot->ram] += slot->size;
+        stat->blocks[slot->ram]++;
+        if (stat->live[slot->ram] > stat->peak[slot->ram]) {
+            stat->peak[slot->ram] = stat->live[slot->ram];
+        }
+    } else {
+        stat->live[slot->ram] -= slot->size;
+        stat->blocks[slot->ram]--;
+    }
+}
+
+// called in the critical section
+static MEM_SLOT_T *__mem_slot_find(void *ptr)
+{
+    uint32_t idx = MEM_SLOT_HASH(ptr);
+
+    for (uint32_t n = 0; n < TAL_MEM_PROFILE_SLOTS; n++) {
+        MEM_SLOT_T *slot = &s_slots[idx];
+        if (slot->ptr == ptr) {
+            return slot;
+        }
+        if (NULL == slot->ptr) {
+            return NULL;
+        }
+        idx = (idx + 1) % TAL_MEM_PROFILE_SLOTS;
+    }
+    return NULL;
+}
+
+// called in the critical section, shifts the probe chain back over the hole
+static void __mem_slot_remove(MEM_SLOT_T *slot)
+{
+    uint32_t hole = (uint32_t)(slot - s_slots);
+    uint32_t idx = hole;
+
+    for (uint32_t n = 1; n < TAL_MEM_PROFILE_SLOTS; n++) {
+        idx = (idx + 1) % TAL_MEM_PROFILE_SLOTS;
+        if (NULL == s_slots[idx].ptr) {
+            break;
+        }
+        uint32_t home = MEM_SLOT_HASH(s_slots[idx].ptr);
+        // move the entry when its home is not cyclically in (hole, idx]
+        if ((idx > hole) ? (home <= hole || home > idx) : (home <= hole && home > idx)) {
+            s_slots[hole] = s_slots[idx];
+            hole = idx;
+        }
+    }
+    memset(&s_slots[hole], 0, sizeof(MEM_SLOT_T));
+}
+
+/**
+ * @brief record a new block, called by tal_system.c
+ *
+ * @param[in] ptr the block
+ * @param[in] size its size
+ * @param[in] tag module name, NULL is untagged
+ * @param[in] ram TAL_MEM_RAM_SRAM or TAL_MEM_RAM_PSRAM
+ * @param[in] caller return address of the allocation
+ */
+void tal_mem_profile_add(void *ptr, size_t size, const char *tag, uint8_t ram, void *caller)
+{
+    uint32_t idx = MEM_SLOT_HASH(ptr);
+    uint32_t irq_mask = tal_system_enter_critical();
+
+    // a block the heap handed out again was freed behind our back
+    MEM_SLOT_T *slot = __mem_slot_find(ptr);
+    if (slot) {
+        __mem_account(slot, false);
+        __mem_slot_remove(slot);
+    }
+
+    for (uint32_t n = 0; n < TAL_MEM_PROFILE_SLOTS; n++) {
+        slot = &s_slots[idx];
+        if (NULL == slot->ptr) {
+            slot->ptr = ptr;
+            slot->caller = caller;
+            slot->size = (uint32_t)size;
+            slot->tag = __mem_tag_index(tag);
+            slot->ram = ram;
+            __mem_account(slot, true);
+            tal_system_exit_critical(irq_mask);
+            return;
+        }
+        idx = (idx + 1) % TAL_MEM_PROFILE_SLOTS;
+    }
+    s_untracked++;
+    tal_system_exit_critical(irq_mask);
+}
+
+/**
+ * @brief forget a block before it is freed, called by tal_system.c
+ *
+ * @param[in] ptr the block
+ */
+void tal_mem_profile_del(void *ptr)
+{
+    uint32_t irq_mask = tal_system_enter_critical();
+    MEM_SLOT_T *slot = __mem_slot_find(ptr);
+    if (slot) {
+        __mem_account(slot, false);
+        __mem_slot_remove(slot);
+    }
+    tal_system_exit_critical(irq_mask);
+}
+
+/**
+ * @brief move a block to its reallocated address, called by tal_system.c
+ *
+ * @param[in] old_ptr the block before
+ * @param[in] new_ptr the block after, NULL when realloc freed it
+ * @param[in] size its new size
+ * @param[in] ram TAL_MEM_RAM_SRAM or TAL_MEM_RAM_PSRAM
+ */
+void tal_mem_profile_move(void *old_ptr, void *new_ptr, size_t size, uint8_t ram)
+{
+    MEM_SLOT_T moved = {.ram = ram};
+
+    uint32_t irq_mask = tal_system_enter_critical();
+    MEM_SLOT_T *slot = __mem_slot_find(old_ptr);
+    if (slot) {
+        moved = *slot;
+        __mem_account(slot, false);
+        __mem_slot_remove(slot);
+    }
+    tal_system_exit_critical(irq_mask);
+
+    if (new_ptr) {
+        tal_mem_profile_add(new_ptr, size, moved.tag ? s_tags[moved.tag].tag : NULL, moved.ram, moved.caller);
+    }
+}
+
+/**
+ * @brief get the per tag counters
+ *
+ * @param[out] stat counters, one per tag
+ * @param[in] num entries in stat
+ *
+ * @return number of entries filled
+ */
+uint32_t tal_mem_profile_get_tags(TAL_MEM_TAG_STAT_T *stat, uint32_t num)
+{
+    if (NULL == stat) {
+        return 0;
+    }
+
+    uint32_t irq_mask = tal_system_enter_critical();
+    if (num > s_tag_num) {
+        num = s_tag_num;
+    }
+    memcpy(stat, s_tags, num * sizeof(TAL_MEM_TAG_STAT_T));
+    tal_system_exit_critical(irq_mask);
+
+    return num;
+}
+
+/**
+ * @brief get the number of allocations that found no free slot
+ *
+ * @return untracked allocations since boot
+ */
+uint32_t tal_mem_profile_get_untracked(void)
+{
+    return s_untracked;
+}
+
+// heaviest untagged call sites by live bytes, one slot per critical section
+static uint32_t __mem_top_callers(MEM_CALLER_T *top, uint32_t num)
+{
+    uint32_t used = 0;
+
+    memset(top, 0, num * sizeof(MEM_CALLER_T));
+    for (uint32_t i = 0; i < TAL_MEM_PROFILE_SLOTS; i++) {
+        uint32_t irq_mask = tal_system_enter_critical();
+        MEM_SLOT_T slot = s_slots[i];
+        tal_system_exit_critical(irq_mask);
+        if (NULL == slot.ptr || 0 != slot.tag) {
+            continue;
+        }
+
+        uint32_t j = 0;
+        while (j < used && top[j].caller != slot.caller) {
+            j++;
+        }
+        if (j == used) {
+            if (used < num) {
+                used++;
+            } else if (top[num - 1].bytes < slot.size) {
+                j = num - 1;
+            } else {
+                continue;
+            }
+            top[j].caller = slot.caller;
+            top[j].bytes = 0;
+            top[j].blocks = 0;
+        }
+        top[j].bytes += slot.size;
+        top[j].blocks++;
+        // keep the list sorted, heaviest first
+        while (j > 0 && top[j].bytes > top[j - 1].bytes) {
+            MEM_CALLER_T tmp = top[j];
+            top[j] = top[j - 1];
+            top[--j] = tmp;
+        }
+    }
+
+    return used;
+}
+
+/**
+ * @brief print the heap info, the tags and the heaviest untagged call sites
+ */
+void tal_mem_profile_dump(void)
+{
+    TAL_HEAP_INFO_T heap;
+    TAL_MEM_TAG_STAT_T tags[TAL_MEM_PROFILE_TAGS];
+    MEM_CALLER_T top[TAL_MEM_PROFILE_TOP];
+
+    tal_system_get_heap_info(&heap);
+    PR_NOTICE("heap free %u largest %u frag %u%% untracked %u", heap.free, heap.largest, heap.frag_pct,
+              s_untracked);
+
+    uint32_t num = tal_mem_profile_get_tags(tags, TAL_MEM_PROFILE_TAGS);
+    for (uint32_t i = 0; i < num; i++) {
+        PR_NOTICE("mem %-12s sram %u/%u (%u) psram %u/%u (%u)", tags[i].tag, tags[i].live[TAL_MEM_RAM_SRAM],
+                  tags[i].peak[TAL_MEM_RAM_SRAM], tags[i].blocks[TAL_MEM_RAM_SRAM], tags[i].live[TAL_MEM_RAM_PSRAM],
+                  tags[i].peak[TAL_MEM_RAM_PSRAM], tags[i].blocks[TAL_MEM_RAM_PSRAM]);
+    }
+
+    num = __mem_top_callers(top, TAL_MEM_PROFILE_TOP);
+    for (uint32_t i = 0; i < num; i++) {
+        PR_NOTICE("untagged %p %u bytes in %u blocks", top[i].caller, top[i].bytes, top[i].blocks);
+    }
+}
+
+/**
+ * @brief format the heap info and the tags as JSON
+ *
+ * @param[out] buf output buffer
+ * @param[in] size buffer size
+ *
+ * @return the formatted length, truncated like snprintf()
+ */
+int tal_mem_profile_format(char *buf, uint32_t size)
+{
+    TAL_HEAP_INFO_T heap;
+    TAL_MEM_TAG_STAT_T tags[TAL_MEM_PROFILE_TAGS];
+    uint32_t len = 0;
+
+    if (NULL == buf || 0 == size) {
+        return 0;
+    }
+
+    tal_system_get_heap_info(&heap);
+    len += snprintf(buf, size, "{\"free\":%u,\"largest\":%u,\"frag\":%u,\"untracked\":%u,\"tags\":[", heap.free,
+                    heap.largest, heap.frag_pct, s_untracked);
+
+    uint32_t num = tal_mem_profile_get_tags(tags, TAL_MEM_PROFILE_TAGS);
+    for (uint32_t i = 0; i < num && len < size; i++) {
+        len += snprintf(buf + len, size - len, "%s{\"tag\":\"%s\",\"sram\":[%u,%u],\"psram\":[%u,%u]}", i ? "," : "",
+                        tags[i].tag, tags[i].live[TAL_MEM_RAM_SRAM], tags[i].peak[TAL_MEM_RAM_SRAM],
+                        tags[i].live[TAL_MEM_RAM_PSRAM], tags[i].peak[TAL_MEM_RAM_PSRAM]);
+    }
+    if (len < size) {
+        len += snprintf(buf + len, size - len, "]}");
+    }
+
+    return (int)len;
+}
+
+#endif
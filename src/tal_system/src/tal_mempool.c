@@ -0,0 +1,301 @@
+/**
+ * @file tal_mempool.c
+ * @brief Fixed size block pools, see tal_mempool.h.
+ *
+ * The pool header and its slab are one allocation. Free blocks are linked
+ * through their first word. With TAL_MEMPOOL_DEBUG a free block also holds
+ * a magic word, a free of a block carrying it is checked against the free
+ * list and reported as a double free instead of corrupting the list.
+ *
+ * @copyright Copyright (c) 2021-2024 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include <string.h>
+#include "tal_mempool.h"
+#include "tal_memory.h"
+#include "tal_system.h"
+#include "tal_log.h"
+#include "tuya_list.h"
+
+/***********************************************************
+*************************micro define***********************
+***********************************************************/
+#define MEMPOOL_ALIGN      8
+#define MEMPOOL_FREE_MAGIC 0xF4EEB10C
+
+#ifndef TAL_MEMPOOL_DUMP_MAX
+#define TAL_MEMPOOL_DUMP_MAX 16
+#endif
+
+typedef struct mempool_block {
+    struct mempool_block *next;
+#ifdef TAL_MEMPOOL_DEBUG
+    uint32_t magic;
+#endif
+} MEMPOOL_BLOCK_T;
+
+typedef struct {
+    LIST_HEAD node;
+    MEMPOOL_RAM_E ram;
+    uint8_t *base;
+    uint8_t *end;
+    MEMPOOL_BLOCK_T *free_list;
+    MEMPOOL_STAT_T stat;
+} MEMPOOL_T;
+
+/***********************************************************
+*************************variable define********************
+***********************************************************/
+static LIST_HEAD(s_pool_list);
+
+/***********************************************************
+*************************function define********************
+***********************************************************/
+static void *__pool_heap_alloc(MEMPOOL_RAM_E ram, size_t size)
+{
+#if defined(ENABLE_EXT_RAM) && (ENABLE_EXT_RAM == 1)
+    if (MEMPOOL_RAM_PSRAM == ram) {
+        return tal_psram_malloc_tag(size, "mempool");
+    }
+#endif
+    return tal_malloc_tag(size, "mempool");
+}
+
+static void __pool_heap_free(MEMPOOL_RAM_E ram, void *ptr)
+{
+#if defined(ENABLE_EXT_RAM) && (ENABLE_EXT_RAM == 1)
+    if (MEMPOOL_RAM_PSRAM == ram) {
+        tal_psram_free(ptr);
+        return;
+    }
+#endif
+    tal_free(ptr);
+}
+
+/**
+ * @brief create a block pool
+ *
+ * @param[in] name pool name for the dump, must stay valid
+ * @param[in] block_size bytes per block, rounded up to 8
+ * @param[in] block_num number of blocks in the slab
+ * @param[in] ram MEMPOOL_RAM_SRAM or MEMPOOL_RAM_PSRAM
+ * @param[out] handle the pool
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_mempool_create(const char *name, uint32_t block_size, uint32_t block_num, MEMPOOL_RAM_E ram,
+                               MEMPOOL_HANDLE *handle)
+{
+    if (NULL == handle || 0 == block_size || 0 == block_num) {
+        return OPRT_INVALID_PARM;
+    }
+
+    if (block_size < sizeof(MEMPOOL_BLOCK_T)) {
+        block_size = sizeof(MEMPOOL_BLOCK_T);
+    }
+    block_size = (block_size + MEMPOOL_ALIGN - 1) & ~(MEMPOOL_ALIGN - 1);
+    size_t head_size = (sizeof(MEMPOOL_T) + MEMPOOL_ALIGN - 1) & ~(MEMPOOL_ALIGN - 1);
+
+    MEMPOOL_T *pool = __pool_heap_alloc(ram, head_size + (size_t)block_size * block_num);
+    if (NULL == pool) {
+        return OPRT_MALLOC_FAILED;
+    }
+    memset(pool, 0, sizeof(MEMPOOL_T));
+    pool->ram = ram;
+    pool->base = (uint8_t *)pool + head_size;
+    pool->end = pool->base + (size_t)block_size * block_num;
+    pool->stat.name = name ? name : "mempool";
+    pool->stat.block_size = block_size;
+    pool->stat.block_num = block_num;
+
+    // link the blocks in address order
+    for (uint32_t i = block_num; i > 0; i--) {
+        MEMPOOL_BLOCK_T *block = (MEMPOOL_BLOCK_T *)(pool->base + (size_t)(i - 1) * block_size);
+        block->next = pool->free_list;
+#ifdef TAL_MEMPOOL_DEBUG
+        block->magic = MEMPOOL_FREE_MAGIC;
+#endif
+        pool->free_list = block;
+    }
+
+    TAL_ENTER_CRITICAL();
+    tuya_list_add_tail(&pool->node, &s_pool_list);
+    TAL_EXIT_CRITICAL();
+
+    *handle = pool;
+    return OPRT_OK;
+}
+
+/**
+ * @brief allocate size bytes, from the pool when they fit a block
+ *
+ * @param[in] handle the pool, NULL allocates from the heap
+ * @param[in] size requested bytes
+ *
+ * @return the memory, NULL when the heap fallback failed too
+ */
+void *tal_mempool_alloc(MEMPOOL_HANDLE handle, size_t size)
+{
+    MEMPOOL_T *pool = (MEMPOOL_T *)handle;
+    MEMPOOL_BLOCK_T *block = NULL;
+
+    if (NULL == pool) {
+        return tal_malloc(size);
+    }
+
+    if (size <= pool->stat.block_size) {
+        TAL_ENTER_CRITICAL();
+        block = pool->free_list;
+        if (block) {
+            pool->free_list = block->next;
+            pool->stat.used++;
+#if TAL_MEMPOOL_STAT
+            pool->stat.alloc_cnt++;
+            if (pool->stat.used > pool->stat.peak) {
+                pool->stat.peak = pool->stat.used;
+            }
+#endif
+        }
+        TAL_EXIT_CRITICAL();
+    }
+
+    if (block) {
+#ifdef TAL_MEMPOOL_DEBUG
+        block->magic = 0;
+#endif
+        return block;
+    }
+
+#if TAL_MEMPOOL_STAT
+    pool->stat.fallback_cnt++;
+#endif
+    return __pool_heap_alloc(pool->ram, size);
+}
+
+/**
+ * @brief free memory from tal_mempool_alloc() of the same pool
+ *
+ * @param[in] handle the pool, NULL frees to the heap
+ * @param[in] ptr the memory, may be NULL
+ */
+void tal_mempool_free(MEMPOOL_HANDLE handle, void *ptr)
+{
+    MEMPOOL_T *pool = (MEMPOOL_T *)handle;
+
+    if (NULL == ptr) {
+        return;
+    }
+    if (NULL == pool) {
+        tal_free(ptr);
+        return;
+    }
+    if ((uint8_t *)ptr < pool->base || (uint8_t *)ptr >= pool->end) {
+        __pool_heap_free(pool->ram, ptr);
+        return;
+    }
+    if (((uint8_t *)ptr - pool->base) % pool->stat.block_size) {
+        PR_ERR("%s free %p not a block start", pool->stat.name, ptr);
+        return;
+    }
+
+    MEMPOOL_BLOCK_T *block = (MEMPOOL_BLOCK_T *)ptr;
+
+    TAL_ENTER_CRITICAL();
+#ifdef TAL_MEMPOOL_DEBUG
+    if (MEMPOOL_FREE_MAGIC == block->magic) {
+        MEMPOOL_BLOCK_T *iter = pool->free_list;
+        while (iter && iter != block) {
+            iter = iter->next;
+        }
+        if (iter) {
+            TAL_EXIT_CRITICAL();
+            PR_ERR("%s double free %p", pool->stat.name, ptr);
+            return;
+        }
+    }
+    block->magic = MEMPOOL_FREE_MAGIC;
+#endif
+    block->next = pool->free_list;
+    pool->free_list = block;
+    pool->stat.used--;
+    TAL_EXIT_CRITICAL();
+}
+
+/**
+ * @brief get the counters of a pool
+ *
+ * @param[in] handle the pool
+ * @param[out] stat the counters
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_mempool_get_stat(MEMPOOL_HANDLE handle, MEMPOOL_STAT_T *stat)
+{
+    MEMPOOL_T *pool = (MEMPOOL_T *)handle;
+
+    if (NULL == pool || NULL == stat) {
+        return OPRT_INVALID_PARM;
+    }
+
+    TAL_ENTER_CRITICAL();
+    *stat = pool->stat;
+    TAL_EXIT_CRITICAL();
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief print the counters of all pools
+ */
+void tal_mempool_dump(void)
+{
+    MEMPOOL_STAT_T stat[TAL_MEMPOOL_DUMP_MAX];
+    uint32_t num = 0;
+    P_LIST_HEAD pos = NULL;
+
+    // copy first, nothing is printed inside the critical section
+    TAL_ENTER_CRITICAL();
+    tuya_list_for_each(pos, &s_pool_list)
+    {
+        if (num >= TAL_MEMPOOL_DUMP_MAX) {
+            break;
+        }
+        stat[num++] = tuya_list_entry(pos, MEMPOOL_T, node)->stat;
+    }
+    TAL_EXIT_CRITICAL();
+
+    for (uint32_t i = 0; i < num; i++) {
+        PR_NOTICE("pool %-12s %4u x %4u used %u peak %u alloc %u fallback %u", stat[i].name, stat[i].block_num,
+                  stat[i].block_size, stat[i].used, stat[i].peak, stat[i].alloc_cnt, stat[i].fallback_cnt);
+    }
+}
+
+/**
+ * @brief release a pool whose blocks are all free
+ *
+ * @param[in] handle the pool
+ *
+ * @return OPRT_OK on success, OPRT_RESOURCE_NOT_READY while blocks are used
+ */
+OPERATE_RET tal_mempool_release(MEMPOOL_HANDLE handle)
+{
+    MEMPOOL_T *pool = (MEMPOOL_T *)handle;
+
+    if (NULL == pool) {
+        return OPRT_INVALID_PARM;
+    }
+
+    TAL_ENTER_CRITICAL();
+    if (pool->stat.used) {
+        TAL_EXIT_CRITICAL();
+        return OPRT_RESOURCE_NOT_READY;
+    }
+    tuya_list_del(&pool->node);
+    TAL_EXIT_CRITICAL();
+
+    __pool_heap_free(pool->ram, pool);
+    return OPRT_OK;
+}
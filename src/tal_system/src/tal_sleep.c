@@ -31,6 +31,8 @@
 #include "tal_sleep.h"
 #include "tal_mutex.h"
 #include "tal_log.h"
+#include "tal_memory.h"
+#include "tal_system.h"
 #include "tkl_sleep.h"
 
 typedef struct {
@@ -42,6 +44,25 @@ typedef struct {
 
 static TAL_CPU_T s_tal_cpu = {0};
 
+typedef struct tal_cpu_perf_lock {
+    struct tal_cpu_perf_lock *next;
+    char name[CPU_PERF_LOCK_NAME_LEN + 1];
+    BOOL_T is_held;
+    uint32_t hold_cnt;
+    SYS_TIME_T hold_start;
+    SYS_TIME_T hold_ms;
+} TAL_CPU_PERF_LOCK_T;
+
+typedef struct {
+    TAL_CPU_PERF_LOCK_T *locks;
+    MUTEX_HANDLE mutex;
+    uint32_t held_cnt;
+    SYS_TIME_T state_start;
+    CPU_PERF_STAT_T stat;
+} TAL_CPU_PERF_T;
+
+static TAL_CPU_PERF_T s_tal_cpu_perf = {0};
+
 /**
  * @brief Sets the CPU sleep mode.
  *
@@ -181,3 +202,182 @@ OPERATE_RET tal_cpu_lp_disable(void)
 
     return op_ret;
 }
+
+// adds the time since the last lock state change to the current state, called locked
+static void tal_cpu_perf_stat_update(SYS_TIME_T now)
+{
+    if (s_tal_cpu_perf.held_cnt) {
+        s_tal_cpu_perf.stat.perf_ms += now - s_tal_cpu_perf.state_start;
+    } else {
+        s_tal_cpu_perf.stat.lp_ms += now - s_tal_cpu_perf.state_start;
+    }
+    s_tal_cpu_perf.state_start = now;
+}
+
+/**
+ * @brief Create a named performance lock.
+ *
+ * Performance locks are a named layer over tal_cpu_lp_disable() and
+ * tal_cpu_lp_enable(): the first lock held disables low power and the last
+ * one released enables it again, so subsystems such as the microphone, the
+ * speaker or the display hold their own lock instead of sharing one counter.
+ * Locks live until reboot.
+ *
+ * @param name The lock name.
+ * @param handle The created lock.
+ *
+ * @return The result of the operation. OPRT_OK if successful, an error code
+ * otherwise.
+ */
+OPERATE_RET tal_cpu_perf_lock_create(const char *name, CPU_PERF_LOCK_HANDLE *handle)
+{
+    TAL_CPU_PERF_LOCK_T *lock = NULL;
+
+    if (NULL == name || NULL == handle) {
+        return OPRT_INVALID_PARM;
+    }
+
+    if (NULL == s_tal_cpu_perf.mutex) {
+        OPERATE_RET op_ret = tal_mutex_create_init(&s_tal_cpu_perf.mutex);
+        if (OPRT_OK != op_ret) {
+            PR_ERR("create mutex fail");
+            return op_ret;
+        }
+        s_tal_cpu_perf.state_start = tal_system_get_millisecond();
+    }
+
+    lock = tal_malloc(sizeof(TAL_CPU_PERF_LOCK_T));
+    if (NULL == lock) {
+        return OPRT_MALLOC_FAILED;
+    }
+    memset(lock, 0, sizeof(TAL_CPU_PERF_LOCK_T));
+    strncpy(lock->name, name, CPU_PERF_LOCK_NAME_LEN);
+
+    tal_mutex_lock(s_tal_cpu_perf.mutex);
+    lock->next = s_tal_cpu_perf.locks;
+    s_tal_cpu_perf.locks = lock;
+    tal_mutex_unlock(s_tal_cpu_perf.mutex);
+
+    *handle = (CPU_PERF_LOCK_HANDLE)lock;
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief Hold a performance lock.
+ *
+ * @param handle The lock.
+ *
+ * @return The result of the operation. OPRT_OK if successful, an error code
+ * otherwise.
+ */
+OPERATE_RET tal_cpu_perf_lock_acquire(CPU_PERF_LOCK_HANDLE handle)
+{
+    OPERATE_RET op_ret = OPRT_OK;
+    TAL_CPU_PERF_LOCK_T *lock = (TAL_CPU_PERF_LOCK_T *)handle;
+    SYS_TIME_T now = 0;
+
+    if (NULL == lock || NULL == s_tal_cpu_perf.mutex) {
+        return OPRT_INVALID_PARM;
+    }
+
+    tal_mutex_lock(s_tal_cpu_perf.mutex);
+    if (!lock->is_held) {
+        now = tal_system_get_millisecond();
+        tal_cpu_perf_stat_update(now);
+        if (0 == s_tal_cpu_perf.held_cnt++) {
+            op_ret = tal_cpu_lp_disable();
+        }
+        lock->is_held = TRUE;
+        lock->hold_cnt++;
+        lock->hold_start = now;
+    }
+    tal_mutex_unlock(s_tal_cpu_perf.mutex);
+
+    return op_ret;
+}
+
+/**
+ * @brief Release a performance lock.
+ *
+ * @param handle The lock.
+ *
+ * @return The result of the operation. OPRT_OK if successful, an error code
+ * otherwise.
+ */
+OPERATE_RET tal_cpu_perf_lock_release(CPU_PERF_LOCK_HANDLE handle)
+{
+    OPERATE_RET op_ret = OPRT_OK;
+    TAL_CPU_PERF_LOCK_T *lock = (TAL_CPU_PERF_LOCK_T *)handle;
+    SYS_TIME_T now = 0;
+
+    if (NULL == lock || NULL == s_tal_cpu_perf.mutex) {
+        return OPRT_INVALID_PARM;
+    }
+
+    tal_mutex_lock(s_tal_cpu_perf.mutex);
+    if (lock->is_held) {
+        now = tal_system_get_millisecond();
+        tal_cpu_perf_stat_update(now);
+        lock->is_held = FALSE;
+        lock->hold_ms += now - lock->hold_start;
+        // without lp mode set tal_cpu_lp_enable() refuses, nothing to restore then
+        if (0 == --s_tal_cpu_perf.held_cnt && tal_cpu_get_lp_mode()) {
+            op_ret = tal_cpu_lp_enable();
+        }
+    }
+    tal_mutex_unlock(s_tal_cpu_perf.mutex);
+
+    return op_ret;
+}
+
+/**
+ * @brief Get the time spent with and without performance locks held.
+ *
+ * @param stat The time statistics.
+ *
+ * @return The result of the operation. OPRT_OK if successful, an error code
+ * otherwise.
+ */
+OPERATE_RET tal_cpu_perf_stat_get(CPU_PERF_STAT_T *stat)
+{
+    if (NULL == stat) {
+        return OPRT_INVALID_PARM;
+    }
+
+    if (NULL == s_tal_cpu_perf.mutex) {
+        memset(stat, 0, sizeof(CPU_PERF_STAT_T));
+        return OPRT_OK;
+    }
+
+    tal_mutex_lock(s_tal_cpu_perf.mutex);
+    tal_cpu_perf_stat_update(tal_system_get_millisecond());
+    *stat = s_tal_cpu_perf.stat;
+    tal_mutex_unlock(s_tal_cpu_perf.mutex);
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief Print the time statistics and every performance lock.
+ */
+void tal_cpu_perf_lock_dump(void)
+{
+    TAL_CPU_PERF_LOCK_T *lock = NULL;
+    SYS_TIME_T now = 0;
+
+    if (NULL == s_tal_cpu_perf.mutex) {
+        return;
+    }
+
+    tal_mutex_lock(s_tal_cpu_perf.mutex);
+    now = tal_system_get_millisecond();
+    tal_cpu_perf_stat_update(now);
+    PR_INFO("cpu perf: lp %u ms, perf %u ms, held %u", (uint32_t)s_tal_cpu_perf.stat.lp_ms,
+            (uint32_t)s_tal_cpu_perf.stat.perf_ms, s_tal_cpu_perf.held_cnt);
+    for (lock = s_tal_cpu_perf.locks; lock; lock = lock->next) {
+        PR_INFO("  %-16s %s cnt %u, %u ms", lock->name, lock->is_held ? "held" : "free", lock->hold_cnt,
+                (uint32_t)(lock->hold_ms + (lock->is_held ? now - lock->hold_start : 0)));
+    }
+    tal_mutex_unlock(s_tal_cpu_perf.mutex);
+}
@@ -7,11 +7,32 @@
 #include "tal_semaphore.h"
 #include "tal_sw_timer.h"
 #include "tal_time_service.h"
+#include "tal_workq_service.h"
 
 #ifndef STACK_SIZE_TIMERQ
 #define STACK_SIZE_TIMERQ (4 * 1024)
 #endif
 
+#ifndef TIMER_DISPATCH_BATCH
+#define TIMER_DISPATCH_BATCH 16 // expired timers collected per lock
+#endif
+
+#ifndef TIMER_SLOW_CB_MS
+#define TIMER_SLOW_CB_MS 50 // callbacks running longer are reported
+#endif
+
+#define TIMER_HEAP_IDLE 0xFFFF
+
+/* workqueue state of a TAL_TIMER_EXEC_WORKQ_* timer */
+#define TIMER_WORK_IDLE    0
+#define TIMER_WORK_QUEUED  1
+#define TIMER_WORK_RUNNING 2
+
+/* state of a collected expiry */
+#define TIMER_EXPIRED_PENDING 0
+#define TIMER_EXPIRED_SKIP    1
+#define TIMER_EXPIRED_RAN     2
+
 typedef struct {
     LIST_HEAD node;
 
@@ -23,8 +44,29 @@ typedef struct {
     BOOL_T is_running;
     TIMER_ID timer_id;
     TIMER_TYPE type;
+    uint16_t heap_idx; // slot in the active heap, TIMER_HEAP_IDLE when stopped
+
+    TAL_TIMER_EXEC_E exec;
+    uint8_t work_state;
+    BOOL_T work_cancel; // the queued work must not run the callback
+    BOOL_T deleted;     // freed by the work callback still holding it
+
+    /* callback runtime */
+    uint32_t run_cnt;
+    uint32_t run_total_ms;
+    uint32_t run_max_ms;
+    uint32_t skip_cnt; // expiries dropped while the work was still busy
 } TIMER_T;
 
+/* an expired timer copied out under the lock, the callback runs after it */
+typedef struct {
+    TIMER_T *timer; // NULL once the timer was deleted
+    TAL_TIMER_CB cb;
+    void *data;
+    uint8_t state;
+    uint32_t cost;
+} TIMER_EXPIRED_T;
+
 typedef struct {
     LIST_HEAD list_active;
     LIST_HEAD list_standby;
@@ -32,39 +74,214 @@ typedef struct {
     uint16_t total_cnt;
     uint16_t running_cnt;
 
+    /* binary min-heap of the running timers ordered by expire_time */
+    TIMER_T **heap;
+    uint16_t heap_size;
+
+    TIMER_EXPIRED_T expired[TIMER_DISPATCH_BATCH];
+    uint8_t expired_cnt;
+
     BOOL_T inited;
     THREAD_HANDLE thread;
     SEM_HANDLE sem;
     TAL_TIMER_CB last_cb; // used to debug which cb is blocked
+
+    /* dispatch lag since the last tal_sw_timer_lag_get() */
+    uint32_t lag_cnt;
+    uint32_t lag_total_ms;
+    uint32_t lag_max_ms;
 } SW_TIMER_MGR_T;
 
 static SW_TIMER_MGR_T s_timer_mgr;
 
-static void __timer_attach(TIMER_T *timer)
+static void __heap_set(uint16_t idx, TIMER_T *timer)
 {
-    tuya_list_del(&(timer->node));
+    s_timer_mgr.heap[idx] = timer;
+    timer->heap_idx = idx;
+}
+
+static void __heap_sift_up(uint16_t idx)
+{
+    TIMER_T *timer = s_timer_mgr.heap[idx];
+
+    while (idx) {
+        uint16_t parent = (idx - 1) / 2;
+        if (s_timer_mgr.heap[parent]->expire_time <= timer->expire_time) {
+            break;
+        }
+        __heap_set(idx, s_timer_mgr.heap[parent]);
+        idx = parent;
+    }
+    __heap_set(idx, timer);
+}
+
+static void __heap_sift_down(uint16_t idx)
+{
+    TIMER_T *timer = s_timer_mgr.heap[idx];
+    uint16_t size = s_timer_mgr.heap_size;
+
+    while (2 * idx + 1 < size) {
+        uint16_t child = 2 * idx + 1;
+        if (child + 1 < size && s_timer_mgr.heap[child + 1]->expire_time < s_timer_mgr.heap[child]->expire_time) {
+            child++;
+        }
+        if (timer->expire_time <= s_timer_mgr.heap[child]->expire_time) {
+            break;
+        }
+        __heap_set(idx, s_timer_mgr.heap[child]);
+        idx = child;
+    }
+    __heap_set(idx, timer);
+}
+
+/* the expire_time of a queued timer changed, restore the heap order */
+static void __heap_update(TIMER_T *timer)
+{
+    uint16_t idx = timer->heap_idx;
+
+    if (idx && s_timer_mgr.heap[(idx - 1) / 2]->expire_time > timer->expire_time) {
+        __heap_sift_up(idx);
+    } else {
+        __heap_sift_down(idx);
+    }
+}
 
-    if (tuya_list_empty(&(s_timer_mgr.list_active))) {
+static void __heap_remove(TIMER_T *timer)
+{
+    uint16_t idx = timer->heap_idx;
+    TIMER_T *last = s_timer_mgr.heap[--s_timer_mgr.heap_size];
+
+    timer->heap_idx = TIMER_HEAP_IDLE;
+    if (last != timer) {
+        __heap_set(idx, last);
+        __heap_update(last);
+    }
+}
+
+/* the heap holds every timer, so it grows at create and start never fails */
+static OPERATE_RET __heap_reserve(uint16_t count)
+{
+    TIMER_T **heap = tal_realloc(s_timer_mgr.heap, count * sizeof(TIMER_T *));
+    if (NULL == heap) {
+        return OPRT_MALLOC_FAILED;
+    }
+    s_timer_mgr.heap = heap;
+
+    return OPRT_OK;
+}
+
+static void __timer_attach(TIMER_T *timer)
+{
+    if (TIMER_HEAP_IDLE == timer->heap_idx) {
+        tuya_list_del(&(timer->node));
         tuya_list_add_tail(&(timer->node), &(s_timer_mgr.list_active));
+        __heap_set(s_timer_mgr.heap_size++, timer);
+        __heap_sift_up(timer->heap_idx);
     } else {
-        TIMER_T *timer_tmp = NULL;
-        struct tuya_list_head *p = NULL;
-        tuya_list_for_each(p, &(s_timer_mgr.list_active))
-        {
-            timer_tmp = tuya_list_entry(p, TIMER_T, node);
-
-            if (timer_tmp->expire_time >= timer->expire_time) {
-                tuya_list_add(&(timer->node), (&(timer_tmp->node))->prev);
-                break;
-            }
+        __heap_update(timer);
+    }
+}
+
+static void __timer_detach(TIMER_T *timer)
+{
+    if (TIMER_HEAP_IDLE != timer->heap_idx) {
+        __heap_remove(timer);
+    }
+    tuya_list_del(&(timer->node));
+    tuya_list_add_tail(&(timer->node), &(s_timer_mgr.list_standby));
+}
+
+/* a timer changed after it was collected, drop its pending callback */
+static void __timer_expired_cancel(TIMER_T *timer, BOOL_T deleted)
+{
+    for (uint8_t i = 0; i < s_timer_mgr.expired_cnt; i++) {
+        TIMER_EXPIRED_T *expired = &s_timer_mgr.expired[i];
+        if (expired->timer != timer) {
+            continue;
+        }
+        if (deleted) {
+            expired->timer = NULL;
+        } else if (TIMER_EXPIRED_PENDING == expired->state) {
+            expired->state = TIMER_EXPIRED_SKIP;
         }
+    }
+    if (TIMER_WORK_QUEUED == timer->work_state) {
+        timer->work_cancel = TRUE;
+    }
+}
+
+static void __timer_account(TIMER_T *timer, uint32_t cost)
+{
+    timer->run_cnt++;
+    timer->run_total_ms += cost;
+    if (cost > timer->run_max_ms) {
+        timer->run_max_ms = cost;
+    }
+}
+
+static uint32_t __timer_run(TIMER_T *timer, TAL_TIMER_CB cb, void *data)
+{
+    SYS_TIME_T start = tal_system_get_millisecond();
+    cb((TIMER_ID)timer, data);
+    uint32_t cost = (uint32_t)(tal_system_get_millisecond() - start);
+
+    if (cost >= TIMER_SLOW_CB_MS) {
+        PR_WARN("timer %p cb %p took %d ms", timer, cb, cost);
+    }
 
-        if (p == &(s_timer_mgr.list_active)) {
-            tuya_list_add_tail(&(timer->node), &(s_timer_mgr.list_active));
+    return cost;
+}
+
+static void __timer_work_cb(void *data)
+{
+    TIMER_T *timer = (TIMER_T *)data;
+
+    tal_mutex_lock(s_timer_mgr.mutex);
+    if (timer->deleted || timer->work_cancel) {
+        BOOL_T deleted = timer->deleted;
+        timer->work_state = TIMER_WORK_IDLE;
+        timer->work_cancel = FALSE;
+        tal_mutex_unlock(s_timer_mgr.mutex);
+        if (deleted) {
+            tal_free(timer);
         }
+        return;
+    }
+    timer->work_state = TIMER_WORK_RUNNING;
+    TAL_TIMER_CB cb = timer->cb;
+    void *arg = timer->data;
+    tal_mutex_unlock(s_timer_mgr.mutex);
+
+    uint32_t cost = __timer_run(timer, cb, arg);
+
+    tal_mutex_lock(s_timer_mgr.mutex);
+    __timer_account(timer, cost);
+    timer->work_state = TIMER_WORK_IDLE;
+    BOOL_T deleted = timer->deleted;
+    tal_mutex_unlock(s_timer_mgr.mutex);
+    if (deleted) {
+        tal_free(timer);
     }
 }
 
+/* queue the callback of a workqueue timer, FALSE to run it inline */
+static BOOL_T __timer_work_schedule(TIMER_T *timer)
+{
+    if (TIMER_WORK_IDLE != timer->work_state) {
+        timer->skip_cnt++;
+        return TRUE;
+    }
+
+    WORKQ_SERVICE_E service = (TAL_TIMER_EXEC_WORKQ_HIGHPRI == timer->exec) ? WORKQ_HIGHTPRI : WORKQ_SYSTEM;
+    if (OPRT_OK != tal_workq_schedule(service, __timer_work_cb, timer)) {
+        return FALSE;
+    }
+    timer->work_state = TIMER_WORK_QUEUED;
+    timer->work_cancel = FALSE;
+
+    return TRUE;
+}
+
 static void __timer_dump(void)
 {
     struct tuya_list_head *p = NULL;
@@ -96,7 +313,9 @@ static void __timer_dump(void)
                 cb = (TAL_TIMER_CB *)((char *)timer->data + sizeof(TIMER_ID));
             }
         }
-        PR_NOTICE("%08x %d %d %p", timer->timer_id, timer->type, timer->interval, *cb);
+        PR_NOTICE("%08x %d %d %p exec %d run %d max %d avg %d skip %d", timer->timer_id, timer->type,
+                  timer->interval, *cb, timer->exec, timer->run_cnt, timer->run_max_ms,
+                  timer->run_cnt ? timer->run_total_ms / timer->run_cnt : 0, timer->skip_cnt);
     }
 
     PR_NOTICE("standby timers count:%d", s_timer_mgr.total_cnt - s_timer_mgr.running_cnt);
@@ -110,63 +329,119 @@ static void __timer_dump(void)
                 cb = (TAL_TIMER_CB *)((char *)timer->data + sizeof(TIMER_ID));
             }
         }
-        PR_NOTICE("%08x %d %d %p", timer->timer_id, timer->type, timer->interval, *cb);
+        PR_NOTICE("%08x %d %d %p exec %d run %d max %d avg %d skip %d", timer->timer_id, timer->type,
+                  timer->interval, *cb, timer->exec, timer->run_cnt, timer->run_max_ms,
+                  timer->run_cnt ? timer->run_total_ms / timer->run_cnt : 0, timer->skip_cnt);
     }
 
     tal_mutex_unlock(s_timer_mgr.mutex);
 }
 
+/* time to the earliest expiry from now, 0 when one is due, the mutex is held */
+static SYS_TIME_T __timer_next_expired_get(void)
+{
+    TIME_S nowSecTime = 0;
+    TIME_MS nowMsTime = 0;
+    uint64_t nowMS = 0;
+
+    if (0 == s_timer_mgr.heap_size) {
+        return SEM_WAIT_FOREVER;
+    }
+
+    tal_time_get_system_time(&nowSecTime, &nowMsTime);
+    nowMS = (uint64_t)nowSecTime * 1000 + (uint64_t)nowMsTime;
+    if (s_timer_mgr.heap[0]->expire_time <= nowMS) {
+        return 0;
+    }
+    return s_timer_mgr.heap[0]->expire_time - nowMS;
+}
+
 static void __timer_dispatch(SYS_TIME_T *next_expired)
 {
     TIME_S nowSecTime = 0;
     TIME_MS nowMsTime = 0;
     uint64_t nowMS = 0;
     TIMER_T *timer = NULL;
-    TAL_TIMER_CB timer_cb = NULL;
-    struct tuya_list_head *p = NULL;
-
-    *next_expired = SEM_WAIT_FOREVER;
+    uint8_t cnt = 0;
 
     do {
         tal_time_get_system_time(&nowSecTime, &nowMsTime);
         nowMS = (uint64_t)nowSecTime * 1000 + (uint64_t)nowMsTime;
 
-        tal_mutex_lock(s_timer_mgr.mutex);
-
-        timer_cb = NULL;
-        tuya_list_for_each(p, &(s_timer_mgr.list_active))
-        {
-            timer = tuya_list_entry(p, TIMER_T, node);
+        *next_expired = SEM_WAIT_FOREVER;
+        cnt = 0;
 
+        tal_mutex_lock(s_timer_mgr.mutex);
+        while (s_timer_mgr.heap_size) {
+            timer = s_timer_mgr.heap[0];
             if (timer->expire_time > nowMS) {
-                p = &(s_timer_mgr.list_active);
                 *next_expired = timer->expire_time - nowMS;
-            } else {
-                timer_cb = timer->cb;
-
-                if (TAL_TIMER_ONCE == timer->type) {
-                    timer->is_running = FALSE;
-                    s_timer_mgr.running_cnt--;
-                    tuya_list_del(&(timer->node));
-                    tuya_list_add_tail(&(timer->node), &(s_timer_mgr.list_standby));
-                } else {
-                    timer->expire_time = nowMS + timer->interval;
-                    __timer_attach(timer);
+                break;
+            }
+            if (cnt >= TIMER_DISPATCH_BATCH) {
+                *next_expired = 0;
+                break;
+            }
+
+            /* expire_time 0 is a tal_sw_timer_trigger() */
+            if (timer->expire_time) {
+                uint32_t lag = (uint32_t)(nowMS - timer->expire_time);
+                s_timer_mgr.lag_cnt++;
+                s_timer_mgr.lag_total_ms += lag;
+                if (lag > s_timer_mgr.lag_max_ms) {
+                    s_timer_mgr.lag_max_ms = lag;
                 }
             }
 
-            break;
-        }
+            if (TAL_TIMER_EXEC_INLINE == timer->exec || !__timer_work_schedule(timer)) {
+                s_timer_mgr.expired[cnt].timer = timer;
+                s_timer_mgr.expired[cnt].cb = timer->cb;
+                s_timer_mgr.expired[cnt].data = timer->data;
+                s_timer_mgr.expired[cnt].state = TIMER_EXPIRED_PENDING;
+                cnt++;
+            }
 
+            if (TAL_TIMER_ONCE == timer->type) {
+                timer->is_running = FALSE;
+                s_timer_mgr.running_cnt--;
+                __timer_detach(timer);
+            } else {
+                timer->expire_time = nowMS + timer->interval;
+                __heap_sift_down(0);
+            }
+        }
+        s_timer_mgr.expired_cnt = cnt;
         tal_mutex_unlock(s_timer_mgr.mutex);
 
-        if (timer_cb) {
-            s_timer_mgr.last_cb = timer_cb;
-            timer_cb(timer->timer_id, timer->data);
-            timer_cb = NULL;
+        /* a callback that stops, restarts or deletes a collected timer
+         * clears its slot, the copies keep a freed timer from being read */
+        for (uint8_t i = 0; i < cnt; i++) {
+            TIMER_EXPIRED_T *expired = &s_timer_mgr.expired[i];
+            timer = expired->timer;
+            if (NULL == timer || TIMER_EXPIRED_PENDING != expired->state) {
+                continue;
+            }
+            expired->state = TIMER_EXPIRED_RAN;
+            s_timer_mgr.last_cb = expired->cb;
+            expired->cost = __timer_run(timer, expired->cb, expired->data);
             s_timer_mgr.last_cb = NULL;
         }
-    } while (p != &(s_timer_mgr.list_active));
+
+        if (cnt) {
+            tal_mutex_lock(s_timer_mgr.mutex);
+            for (uint8_t i = 0; i < cnt; i++) {
+                TIMER_EXPIRED_T *expired = &s_timer_mgr.expired[i];
+                if (expired->timer && TIMER_EXPIRED_RAN == expired->state) {
+                    __timer_account(expired->timer, expired->cost);
+                }
+            }
+            s_timer_mgr.expired_cnt = 0;
+            /* the callbacks took time and may have re-armed timers, the
+             * expiry taken before them is stale */
+            *next_expired = __timer_next_expired_get();
+            tal_mutex_unlock(s_timer_mgr.mutex);
+        }
+    } while (0 == *next_expired);
 }
 
 static void __timer_thread_cb(void *data)
@@ -240,8 +515,14 @@ OPERATE_RET tal_sw_timer_create(TAL_TIMER_CB func, void *arg, TIMER_ID *timer_id
     timer->cb = func;
     timer->data = arg;
     timer->timer_id = (TIMER_ID)timer;
+    timer->heap_idx = TIMER_HEAP_IDLE;
 
     tal_mutex_lock(s_timer_mgr.mutex);
+    if (s_timer_mgr.total_cnt >= TIMER_HEAP_IDLE || OPRT_OK != __heap_reserve(s_timer_mgr.total_cnt + 1)) {
+        tal_mutex_unlock(s_timer_mgr.mutex);
+        tal_free(timer);
+        return OPRT_MALLOC_FAILED;
+    }
     s_timer_mgr.total_cnt++;
     tuya_list_add_tail(&(timer->node), &(s_timer_mgr.list_standby));
     tal_mutex_unlock(s_timer_mgr.mutex);
@@ -270,14 +551,23 @@ OPERATE_RET tal_sw_timer_delete(TIMER_ID timer_id)
     TIMER_T *timer = (TIMER_T *)timer_id;
 
     tal_mutex_lock(s_timer_mgr.mutex);
+    if (TIMER_HEAP_IDLE != timer->heap_idx) {
+        __heap_remove(timer);
+    }
+    __timer_expired_cancel(timer, TRUE);
     tuya_list_del(&(timer->node));
     s_timer_mgr.total_cnt--;
     if (timer->is_running) {
         s_timer_mgr.running_cnt--;
     }
+    /* a queued or running work still holds the timer and frees it */
+    BOOL_T work_busy = (TIMER_WORK_IDLE != timer->work_state);
+    timer->deleted = TRUE;
     tal_mutex_unlock(s_timer_mgr.mutex);
     tal_semaphore_post(s_timer_mgr.sem);
-    tal_free(timer);
+    if (!work_busy) {
+        tal_free(timer);
+    }
 
     return OPRT_OK;
 }
@@ -305,9 +595,9 @@ OPERATE_RET tal_sw_timer_stop(TIMER_ID timer_id)
         timer->is_running = FALSE;
 
         s_timer_mgr.running_cnt--;
-        tuya_list_del(&(timer->node));
-        tuya_list_add_tail(&(timer->node), &(s_timer_mgr.list_standby));
+        __timer_detach(timer);
     }
+    __timer_expired_cancel(timer, FALSE);
     tal_mutex_unlock(s_timer_mgr.mutex);
     tal_semaphore_post(s_timer_mgr.sem);
 
@@ -414,6 +704,7 @@ OPERATE_RET tal_sw_timer_start(TIMER_ID timer_id, TIME_MS time_ms, TIMER_TYPE ti
     timer->type = timer_type;
     timer->expire_time = (uint64_t)secTime * 1000 + (uint64_t)msTime + timer->interval;
     __timer_attach(timer);
+    __timer_expired_cancel(timer, FALSE);
 
     tal_mutex_unlock(s_timer_mgr.mutex);
     tal_semaphore_post(s_timer_mgr.sem);
@@ -442,8 +733,8 @@ OPERATE_RET tal_sw_timer_trigger(TIMER_ID timer_id)
     tal_mutex_lock(s_timer_mgr.mutex);
     timer->expire_time = 0;
     if (timer->is_running) {
-        tuya_list_del(&(timer->node));
-        tuya_list_add(&(timer->node), &(s_timer_mgr.list_active));
+        __timer_attach(timer);
+        __timer_expired_cancel(timer, FALSE);
     }
     tal_mutex_unlock(s_timer_mgr.mutex);
     tal_semaphore_post(s_timer_mgr.sem);
@@ -451,6 +742,30 @@ OPERATE_RET tal_sw_timer_trigger(TIMER_ID timer_id)
     return OPRT_OK;
 }
 
+/**
+ * @brief Select where the callback of a software timer runs
+ *
+ * @param[in] timer_id: timer id
+ * @param[in] exec: inline on the timer thread or on a workqueue service
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_sw_timer_set_exec(TIMER_ID timer_id, TAL_TIMER_EXEC_E exec)
+{
+    if (NULL == timer_id || exec > TAL_TIMER_EXEC_WORKQ_HIGHPRI) {
+        return OPRT_INVALID_PARM;
+    }
+
+    TIMER_T *timer = (TIMER_T *)timer_id;
+
+    tal_mutex_lock(s_timer_mgr.mutex);
+    timer->exec = exec;
+    tal_mutex_unlock(s_timer_mgr.mutex);
+
+    return OPRT_OK;
+}
+
 /**
  * @brief Release all resource of the software timer
  *
@@ -486,6 +801,35 @@ int tal_sw_timer_get_num(void)
     return s_timer_mgr.running_cnt;
 }
 
+/**
+ * @brief Get the dispatch lag since the previous call
+ *
+ * @param[out] lag dispatch count and lag, reset by the call
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_sw_timer_lag_get(TAL_TIMER_LAG_T *lag)
+{
+    if (NULL == lag) {
+        return OPRT_INVALID_PARM;
+    }
+    if (!s_timer_mgr.inited) {
+        return OPRT_COM_ERROR;
+    }
+
+    tal_mutex_lock(s_timer_mgr.mutex);
+    lag->dispatched = s_timer_mgr.lag_cnt;
+    lag->avg_ms = s_timer_mgr.lag_cnt ? s_timer_mgr.lag_total_ms / s_timer_mgr.lag_cnt : 0;
+    lag->max_ms = s_timer_mgr.lag_max_ms;
+    s_timer_mgr.lag_cnt = 0;
+    s_timer_mgr.lag_total_ms = 0;
+    s_timer_mgr.lag_max_ms = 0;
+    tal_mutex_unlock(s_timer_mgr.mutex);
+
+    return OPRT_OK;
+}
+
 // used for debug
 void tal_sw_timer_dump(void)
 {
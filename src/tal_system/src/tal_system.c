@@ -34,16 +34,20 @@
 #include "tal_log.h"
 #include "tal_memory.h"
 
-/**
- * @brief Allocates a block of memory of the specified size.
- *
- * This function is used to dynamically allocate memory of the specified size.
- *
- * @param size The size of the memory block to allocate.
- * @return A pointer to the allocated memory block, or NULL if the allocation
- * fails.
- */
-void *tal_malloc(size_t size)
+#if defined(ENABLE_MEM_PROFILE) && (ENABLE_MEM_PROFILE == 1)
+#define MEM_PROFILE_ADD(ptr, size, tag, ram, caller) tal_mem_profile_add(ptr, size, tag, ram, caller)
+#define MEM_PROFILE_DEL(ptr)                         tal_mem_profile_del(ptr)
+#define MEM_PROFILE_MOVE(old_ptr, new_ptr, size, ram) tal_mem_profile_move(old_ptr, new_ptr, size, ram)
+#else
+#define MEM_PROFILE_ADD(ptr, size, tag, ram, caller)
+#define MEM_PROFILE_DEL(ptr)
+#define MEM_PROFILE_MOVE(old_ptr, new_ptr, size, ram)
+#endif
+
+// trial allocations stop once the largest block is known to this many bytes
+#define HEAP_PROBE_GRAIN 64
+
+static void *__tal_malloc(size_t size, const char *tag, void *caller)
 {
     if (0 == size) {
         return NULL;
@@ -52,12 +56,37 @@ void *tal_malloc(size_t size)
     void *ptr = NULL;
     ptr = tkl_system_malloc(size);
     if (NULL == ptr) {
-        PR_ERR("0x%x malloc failed:0x%x free:0x%x", __builtin_return_address(0), size, tal_system_get_free_heap_size());
+        PR_ERR("0x%x malloc failed:0x%x free:0x%x", caller, size, tal_system_get_free_heap_size());
+        return NULL;
     }
+    MEM_PROFILE_ADD(ptr, size, tag, TAL_MEM_RAM_SRAM, caller);
 
     return ptr;
 }
 
+static void *__tal_calloc(size_t nitems, size_t size, const char *tag, void *caller)
+{
+    void *ptr = tkl_system_calloc(nitems, size);
+    if (ptr) {
+        MEM_PROFILE_ADD(ptr, nitems * size, tag, TAL_MEM_RAM_SRAM, caller);
+    }
+    return ptr;
+}
+
+/**
+ * @brief Allocates a block of memory of the specified size.
+ *
+ * This function is used to dynamically allocate memory of the specified size.
+ *
+ * @param size The size of the memory block to allocate.
+ * @return A pointer to the allocated memory block, or NULL if the allocation
+ * fails.
+ */
+void *tal_malloc(size_t size)
+{
+    return __tal_malloc(size, NULL, __builtin_return_address(0));
+}
+
 /**
  * @brief Frees the memory pointed to by the given pointer.
  *
@@ -73,6 +102,7 @@ void tal_free(void *ptr)
         return;
     }
 
+    MEM_PROFILE_DEL(ptr);
     tkl_system_free(ptr);
 }
 
@@ -88,7 +118,7 @@ void tal_free(void *ptr)
  */
 void *tal_calloc(size_t nitems, size_t size)
 {
-    return tkl_system_calloc(nitems, size);
+    return __tal_calloc(nitems, size, NULL, __builtin_return_address(0));
 }
 
 /**
@@ -102,11 +132,31 @@ void *tal_calloc(size_t nitems, size_t size)
  */
 void *tal_realloc(void *ptr, size_t size)
 {
-    return tkl_system_realloc(ptr, size);
+    void *new_ptr = tkl_system_realloc(ptr, size);
+    if (NULL == ptr) {
+        if (new_ptr) {
+            MEM_PROFILE_ADD(new_ptr, size, NULL, TAL_MEM_RAM_SRAM, __builtin_return_address(0));
+        }
+    } else if (new_ptr || 0 == size) {
+        MEM_PROFILE_MOVE(ptr, new_ptr, size, TAL_MEM_RAM_SRAM);
+    }
+    return new_ptr;
+}
+
+#if defined(ENABLE_MEM_PROFILE) && (ENABLE_MEM_PROFILE == 1)
+void *tal_malloc_tag(size_t size, const char *tag)
+{
+    return __tal_malloc(size, tag, __builtin_return_address(0));
 }
 
+void *tal_calloc_tag(size_t nitems, size_t size, const char *tag)
+{
+    return __tal_calloc(nitems, size, tag, __builtin_return_address(0));
+}
+#endif
+
 #if defined(ENABLE_EXT_RAM) && (ENABLE_EXT_RAM == 1)
-void *tal_psram_malloc(size_t size)
+static void *__tal_psram_malloc(size_t size, const char *tag, void *caller)
 {
     if (0 == size) {
         return NULL;
@@ -116,30 +166,56 @@ void *tal_psram_malloc(size_t size)
     ptr = tkl_system_psram_malloc(size);
 
     if (NULL == ptr) {
-        PR_ERR("0x%x psram malloc failed:0x%x free:0x%x", __builtin_return_address(0), size,
-               tal_system_get_free_heap_size());
+        PR_ERR("0x%x psram malloc failed:0x%x free:0x%x", caller, size, tal_system_get_free_heap_size());
+        return NULL;
     }
+    MEM_PROFILE_ADD(ptr, size, tag, TAL_MEM_RAM_PSRAM, caller);
 
     return ptr;
 }
 
+void *tal_psram_malloc(size_t size)
+{
+    return __tal_psram_malloc(size, NULL, __builtin_return_address(0));
+}
+
+#if defined(ENABLE_MEM_PROFILE) && (ENABLE_MEM_PROFILE == 1)
+void *tal_psram_malloc_tag(size_t size, const char *tag)
+{
+    return __tal_psram_malloc(size, tag, __builtin_return_address(0));
+}
+#endif
+
 void tal_psram_free(void *ptr)
 {
     if (NULL == ptr) {
         return;
     }
 
+    MEM_PROFILE_DEL(ptr);
     tkl_system_psram_free(ptr);
 }
 
 void *tal_psram_calloc(size_t nitems, size_t size)
 {
-    return tkl_system_psram_calloc(nitems, size);
+    void *ptr = tkl_system_psram_calloc(nitems, size);
+    if (ptr) {
+        MEM_PROFILE_ADD(ptr, nitems * size, NULL, TAL_MEM_RAM_PSRAM, __builtin_return_address(0));
+    }
+    return ptr;
 }
 
 void *tal_psram_realloc(void *ptr, size_t size)
 {
-    return tkl_system_psram_realloc(ptr, size);
+    void *new_ptr = tkl_system_psram_realloc(ptr, size);
+    if (NULL == ptr) {
+        if (new_ptr) {
+            MEM_PROFILE_ADD(new_ptr, size, NULL, TAL_MEM_RAM_PSRAM, __builtin_return_address(0));
+        }
+    } else if (new_ptr || 0 == size) {
+        MEM_PROFILE_MOVE(ptr, new_ptr, size, TAL_MEM_RAM_PSRAM);
+    }
+    return new_ptr;
 }
 #endif
 
@@ -181,6 +257,51 @@ int tal_system_get_free_heap_size(void)
     return tkl_system_get_free_heap_size();
 }
 
+/**
+ * @brief Get the free heap size and its largest free block.
+ *
+ * Without ENABLE_PLATFORM_HEAP_INFO the largest block is bisected with trial
+ * allocations that are freed at once, so it is a diagnostic, not a hot path.
+ *
+ * @param info Receives the free size, the largest block and the
+ * fragmentation in percent.
+ * @return OPRT_OK on success, OPRT_INVALID_PARM when info is NULL.
+ */
+OPERATE_RET tal_system_get_heap_info(TAL_HEAP_INFO_T *info)
+{
+    if (NULL == info) {
+        return OPRT_INVALID_PARM;
+    }
+
+    int free_size = tkl_system_get_free_heap_size();
+    info->free = free_size > 0 ? (uint32_t)free_size : 0;
+
+#if defined(ENABLE_PLATFORM_HEAP_INFO) && (ENABLE_PLATFORM_HEAP_INFO == 1)
+    int largest = tkl_system_get_largest_free_block();
+    info->largest = largest > 0 ? (uint32_t)largest : 0;
+#else
+    uint32_t lo = 0, hi = info->free + 1;
+    while (hi - lo > HEAP_PROBE_GRAIN) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        void *probe = tkl_system_malloc(mid);
+        if (probe) {
+            tkl_system_free(probe);
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    info->largest = lo;
+#endif
+
+    if (info->largest > info->free) {
+        info->largest = info->free;
+    }
+    info->frag_pct = info->free ? (uint8_t)(100 - (uint64_t)info->largest * 100 / info->free) : 0;
+
+    return OPRT_OK;
+}
+
 /**
  * @brief Retrieves the system tick count.
  *
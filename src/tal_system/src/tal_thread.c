@@ -38,6 +38,13 @@
 #include "tal_log.h"
 #include "tal_memory.h"
 #include "tal_system.h"
+#include <stdio.h>
+
+// threads listed by tal_thread_profile_dump() and tal_thread_profile_format()
+#ifndef TAL_THREAD_PROFILE_MAX
+#define TAL_THREAD_PROFILE_MAX 32
+#endif
+
 typedef struct {
     THREAD_HANDLE thrdID;
     int thrdRunSta;
@@ -48,6 +55,10 @@ typedef struct {
     THREAD_EXIT_CB exit;
     char thread_name[TAL_THREAD_MAX_NAME_LEN];
     LIST_HEAD node;
+#if defined(ENABLE_THREAD_RUNTIME) && (ENABLE_THREAD_RUNTIME == 1)
+    uint64_t run_time_last; // at the previous profile sample
+    uint32_t switches_last;
+#endif
 } THRD_MANAGE, *P_THRD_MANAGE;
 
 typedef struct {
@@ -57,6 +68,7 @@ typedef struct {
 
 static DEL_THRD_MAG_S *s_del_thrd_mag = NULL;
 static LIST_HEAD s_all_thrd_mag;
+static SYS_TIME_T s_profile_last_ms = 0;
 
 static void __WrapRunFunc(void *pArg);
 static void __inner_del_thread(THREAD_HANDLE thrdID);
@@ -399,3 +411,123 @@ void tal_thread_dump_watermark(void)
     }
     tal_mutex_unlock(s_del_thrd_mag->mutex);
 }
+
+/**
+ * @brief Samples every thread for the profiler.
+ *
+ * The stack watermark is the least free stack the port has seen. With
+ * ENABLE_THREAD_RUNTIME the cpu share and the switches are the deltas since
+ * the previous sample, so a caller polling at a fixed period gets a top like
+ * view.
+ *
+ * @param profile Receives one entry per thread.
+ * @param num Number of entries in profile.
+ * @param period_ms Receives the sample period, can be NULL.
+ * @return The number of entries filled.
+ */
+uint32_t tal_thread_profile_get(THREAD_PROFILE_T *profile, uint32_t num, uint32_t *period_ms)
+{
+    if (!s_del_thrd_mag || NULL == profile) {
+        return 0;
+    }
+
+    LIST_HEAD *pos = NULL;
+    THRD_MANAGE *tmp_node = NULL;
+    uint32_t cnt = 0;
+
+    tal_mutex_lock(s_del_thrd_mag->mutex);
+    SYS_TIME_T now = tal_system_get_millisecond();
+    uint32_t period = s_profile_last_ms ? (uint32_t)(now - s_profile_last_ms) : (uint32_t)now;
+    s_profile_last_ms = now;
+
+    tuya_list_for_each(pos, &s_all_thrd_mag)
+    {
+        if (cnt >= num) {
+            break;
+        }
+        tmp_node = tuya_list_entry(pos, THRD_MANAGE, node);
+        THREAD_PROFILE_T *entry = &profile[cnt++];
+        memset(entry, 0, sizeof(THREAD_PROFILE_T));
+        strncpy(entry->name, tmp_node->thread_name, TAL_THREAD_MAX_NAME_LEN - 1);
+        entry->stack_size = tmp_node->stackDepth;
+        if (OPRT_OK != tkl_thread_get_watermark(tmp_node->thrdID, &entry->stack_free)) {
+            entry->stack_free = 0;
+        }
+#if defined(ENABLE_THREAD_RUNTIME) && (ENABLE_THREAD_RUNTIME == 1)
+        uint64_t run_time = 0;
+        uint32_t switches = 0;
+        if (OPRT_OK == tkl_thread_get_runtime(tmp_node->thrdID, &run_time, &switches)) {
+            uint64_t delta = run_time - tmp_node->run_time_last;
+            entry->run_time_us = run_time;
+            entry->switches = switches - tmp_node->switches_last;
+            entry->cpu_permille = period ? (uint16_t)(delta / period) : 0;
+            tmp_node->run_time_last = run_time;
+            tmp_node->switches_last = switches;
+        }
+#endif
+    }
+    tal_mutex_unlock(s_del_thrd_mag->mutex);
+
+    if (period_ms) {
+        *period_ms = period;
+    }
+    return cnt;
+}
+
+/**
+ * @brief Samples and prints every thread, one line each.
+ */
+void tal_thread_profile_dump(void)
+{
+    uint32_t period = 0;
+    THREAD_PROFILE_T *profile = tal_malloc(TAL_THREAD_PROFILE_MAX * sizeof(THREAD_PROFILE_T));
+    if (NULL == profile) {
+        return;
+    }
+
+    uint32_t cnt = tal_thread_profile_get(profile, TAL_THREAD_PROFILE_MAX, &period);
+    PR_NOTICE("%u threads over %u ms", cnt, period);
+    for (uint32_t i = 0; i < cnt; i++) {
+        THREAD_PROFILE_T *entry = &profile[i];
+        PR_NOTICE("thread[%-16s] cpu[%3u.%u%%] sw[%6u] stack[%5u] free[%5u] run[%llu ms]", entry->name,
+                  entry->cpu_permille / 10, entry->cpu_permille % 10, entry->switches, entry->stack_size,
+                  entry->stack_free, (unsigned long long)(entry->run_time_us / 1000));
+    }
+    tal_free(profile);
+}
+
+/**
+ * @brief Samples every thread and formats them as JSON.
+ *
+ * Each thread is [name, cpu permille, switches, stack size, free stack].
+ *
+ * @param buf Output buffer.
+ * @param size Buffer size.
+ * @return The formatted length, truncated like snprintf().
+ */
+int tal_thread_profile_format(char *buf, uint32_t size)
+{
+    uint32_t period = 0, len = 0;
+
+    if (NULL == buf || 0 == size) {
+        return 0;
+    }
+    THREAD_PROFILE_T *profile = tal_malloc(TAL_THREAD_PROFILE_MAX * sizeof(THREAD_PROFILE_T));
+    if (NULL == profile) {
+        return snprintf(buf, size, "{}");
+    }
+
+    uint32_t cnt = tal_thread_profile_get(profile, TAL_THREAD_PROFILE_MAX, &period);
+    len += snprintf(buf, size, "{\"ms\":%u,\"threads\":[", period);
+    for (uint32_t i = 0; i < cnt && len < size; i++) {
+        THREAD_PROFILE_T *entry = &profile[i];
+        len += snprintf(buf + len, size - len, "%s[\"%s\",%u,%u,%u,%u]", i ? "," : "", entry->name,
+                        entry->cpu_permille, entry->switches, entry->stack_size, entry->stack_free);
+    }
+    if (len < size) {
+        len += snprintf(buf + len, size - len, "]}");
+    }
+    tal_free(profile);
+
+    return (int)len;
+}
@@ -0,0 +1,133 @@
+/**
+ * @file tal_trace.c
+ * @brief Microsecond trace points for latency measurement.
+ *
+ * A slot is claimed by advancing the write index inside a critical section
+ * of a few instructions, the event is then filled outside it. No mutex is
+ * taken, so the trace points work from isrs as well.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include <stdio.h>
+#include "tal_trace.h"
+#include "tal_system.h"
+#include "tkl_system.h"
+#include "tkl_thread.h"
+
+#if defined(ENABLE_TAL_TRACE) && (ENABLE_TAL_TRACE == 1)
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+#if (TAL_TRACE_RING_SIZE & (TAL_TRACE_RING_SIZE - 1)) != 0
+#error "TAL_TRACE_RING_SIZE must be a power of 2"
+#endif
+
+#define TAL_TRACE_LINE_LEN 128
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef struct {
+    uint64_t ts_us;
+    const char *name;
+    void *tid;
+    char ph;
+} TAL_TRACE_EVENT_T;
+
+typedef struct {
+    volatile BOOL_T enable;
+    uint32_t head; // events ever claimed, the next slot is head & (size - 1)
+    TAL_TRACE_EVENT_T ring[TAL_TRACE_RING_SIZE];
+} TAL_TRACE_T;
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static TAL_TRACE_T sg_trace = {.enable = TRUE};
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+void tal_trace_record(char ph, const char *name)
+{
+    TAL_TRACE_EVENT_T *evt;
+    TKL_THREAD_HANDLE tid = NULL;
+    uint64_t ts_us;
+
+    if (!sg_trace.enable) {
+        return;
+    }
+
+    ts_us = tkl_system_get_microsecond();
+    tkl_thread_get_id(&tid);
+
+    TAL_ENTER_CRITICAL();
+    evt = &sg_trace.ring[sg_trace.head & (TAL_TRACE_RING_SIZE - 1)];
+    sg_trace.head++;
+    TAL_EXIT_CRITICAL();
+
+    evt->ts_us = ts_us;
+    evt->name = name;
+    evt->tid = tid;
+    evt->ph = ph;
+}
+
+void tal_trace_enable(BOOL_T enable)
+{
+    sg_trace.enable = enable;
+}
+
+void tal_trace_clear(void)
+{
+    TAL_ENTER_CRITICAL();
+    sg_trace.head = 0;
+    TAL_EXIT_CRITICAL();
+}
+
+OPERATE_RET tal_trace_dump(TAL_TRACE_OUTPUT_CB output, void *arg)
+{
+    char line[TAL_TRACE_LINE_LEN];
+    BOOL_T enable;
+    uint32_t start, end, i;
+    uint64_t base_us;
+    int len;
+
+    if (NULL == output) {
+        return OPRT_INVALID_PARM;
+    }
+
+    enable = sg_trace.enable;
+    sg_trace.enable = FALSE;
+
+    end = sg_trace.head;
+    start = (end > TAL_TRACE_RING_SIZE) ? (end - TAL_TRACE_RING_SIZE) : 0;
+    base_us = (start < end) ? sg_trace.ring[start & (TAL_TRACE_RING_SIZE - 1)].ts_us : 0;
+
+    len = snprintf(line, sizeof(line), "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    output(line, len, arg);
+
+    for (i = start; i < end; i++) {
+        TAL_TRACE_EVENT_T *evt = &sg_trace.ring[i & (TAL_TRACE_RING_SIZE - 1)];
+
+        len = snprintf(line, sizeof(line), "%s\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%u,\"pid\":1,\"tid\":%u%s}",
+                       (i == start) ? "" : ",", evt->name ? evt->name : "", evt->ph,
+                       (uint32_t)(evt->ts_us - base_us), (uint32_t)(uintptr_t)evt->tid,
+                       (TAL_TRACE_PH_INSTANT == evt->ph) ? ",\"s\":\"t\"" : "");
+        if (len >= (int)sizeof(line)) {
+            len = sizeof(line) - 1;
+        }
+        output(line, len, arg);
+    }
+
+    len = snprintf(line, sizeof(line), "\n]}\n");
+    output(line, len, arg);
+
+    sg_trace.enable = enable;
+
+    return OPRT_OK;
+}
+
+#endif
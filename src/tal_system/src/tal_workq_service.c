@@ -49,8 +49,14 @@
 #define STACK_SIZE_MSG_QUEUE (4 * 1024)
 #endif
 
+// worker threads of WORKQ_POOL, 0 maps the service to WORKQ_SYSTEM
+#ifndef WORKQ_POOL_WORKERS
+#define WORKQ_POOL_WORKERS 0
+#endif
+
 static WORKQUEUE_HANDLE wq_system;
 static WORKQUEUE_HANDLE wq_highpri;
+static WORKQUEUE_HANDLE wq_pool;
 
 /**
  * @brief init ty work queue
@@ -83,6 +89,17 @@ OPERATE_RET tal_workq_init(void)
     thread_cfg.thrdname = "wq_highpri";
     TUYA_CALL_ERR_GOTO(tal_workqueue_create(MAX_NODE_NUM_MSG_QUEUE, &thread_cfg, &wq_highpri), ERR_EXIT);
 
+#if WORKQ_POOL_WORKERS > 0
+    thread_cfg.priority = THREAD_PRIO_2;
+    thread_cfg.stackDepth = STACK_SIZE_WORK_QUEUE;
+#if defined(TUYA_SECURITY_LEVEL) && (TUYA_SECURITY_LEVEL >= TUYA_SL_1)
+    thread_cfg.stackDepth += 1024;
+#endif
+    thread_cfg.thrdname = "wq_pool";
+    TUYA_CALL_ERR_GOTO(tal_workqueue_create_pool(MAX_NODE_NUM_WORK_QUEUE, WORKQ_POOL_WORKERS, &thread_cfg, NULL, &wq_pool),
+                       ERR_EXIT);
+#endif
+
     return OPRT_OK;
 
 ERR_EXIT:
@@ -96,6 +113,11 @@ ERR_EXIT:
         wq_highpri = NULL;
     }
 
+    if (wq_pool) {
+        tal_workqueue_release(wq_pool);
+        wq_pool = NULL;
+    }
+
     return rt;
 }
 
@@ -114,6 +136,8 @@ WORKQUEUE_HANDLE tal_workq_get_handle(WORKQ_SERVICE_E service)
         handle = wq_system;
     } else if (WORKQ_HIGHTPRI == service) {
         handle = wq_highpri;
+    } else if (WORKQ_POOL == service) {
+        handle = wq_pool ? wq_pool : wq_system;
     }
 
     return handle;
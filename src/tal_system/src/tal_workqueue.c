@@ -31,45 +31,89 @@
  *
  */
 
+#include <stdio.h>
 #include "tuya_queue.h"
 #include "tal_log.h"
 #include "tal_memory.h"
 #include "tal_thread.h"
 #include "tal_system.h"
 #include "tal_semaphore.h"
+#include "tal_mutex.h"
 #include "tal_workqueue.h"
 #include "tal_sw_timer.h"
 
+#if defined(ENABLE_THREAD_AFFINITY) && (ENABLE_THREAD_AFFINITY == 1)
+#include "tkl_thread.h"
+#endif
+
+typedef struct TAL_WORKQUEUE TAL_WORKQUEUE_T;
+
 typedef struct {
-    TUYA_QUEUE_HANDLE queue;
+    TAL_WORKQUEUE_T *workqueue;
+    TUYA_QUEUE_HANDLE queue; // own deque, the other workers steal from it when idle
     THREAD_HANDLE thread;
-    SEM_HANDLE sem;
     WORKQUEUE_CB last_cb; // used to debug which cb is blocked
-} TAL_WORKQUEUE_T;
+    int8_t core;          // -1 for any core
+    char name[16];
+} WORK_WORKER_T;
+
+struct TAL_WORKQUEUE {
+    SEM_HANDLE sem;     // posted once per queued item, shared by all workers
+    MUTEX_HANDLE mutex; // protects the WORK_T counters
+    uint8_t worker_num;
+    WORK_WORKER_T worker[0];
+};
+
+/* take one item, from the own deque first then from the others in turn */
+static OPERATE_RET __work_take(WORK_WORKER_T *worker, WORK_ITEM_T *work_item)
+{
+    TAL_WORKQUEUE_T *workqueue = worker->workqueue;
+    uint8_t self = worker - workqueue->worker;
+
+    for (uint8_t i = 0; i < workqueue->worker_num; i++) {
+        WORK_WORKER_T *victim = &workqueue->worker[(self + i) % workqueue->worker_num];
+        if (OPRT_OK == tuya_queue_output(victim->queue, work_item)) {
+            return OPRT_OK;
+        }
+    }
+
+    return OPRT_COM_ERROR;
+}
 
 static void __work_thread_cb(void *data)
 {
     OPERATE_RET op_ret = OPRT_OK;
-    TAL_WORKQUEUE_T *workqueue = (TAL_WORKQUEUE_T *)data;
+    WORK_WORKER_T *worker = (WORK_WORKER_T *)data;
+    TAL_WORKQUEUE_T *workqueue = worker->workqueue;
     WORK_ITEM_T work_item = {0};
 
-    while (THREAD_STATE_RUNNING == tal_thread_get_state(workqueue->thread)) {
+#if defined(ENABLE_THREAD_AFFINITY) && (ENABLE_THREAD_AFFINITY == 1)
+    if (worker->core >= 0) {
+        TKL_THREAD_HANDLE self = NULL;
+        tkl_thread_get_id(&self);
+        if (OPRT_OK != tkl_thread_set_affinity(self, worker->core)) {
+            PR_ERR("%s affinity to core %d failed", worker->name, worker->core);
+        }
+    }
+#endif
+
+    while (THREAD_STATE_RUNNING == tal_thread_get_state(worker->thread)) {
         op_ret = tal_semaphore_wait(workqueue->sem, SEM_WAIT_FOREVER);
         if (OPRT_OK != op_ret) {
             tal_system_sleep(10);
             continue;
         }
 
-        op_ret = tuya_queue_output(workqueue->queue, &work_item);
+        op_ret = __work_take(worker, &work_item);
         if (OPRT_OK != op_ret) {
             tal_system_sleep(10);
             continue;
         }
 
         if (work_item.cb) {
-            workqueue->last_cb = work_item.cb;
+            worker->last_cb = work_item.cb;
             work_item.cb(work_item.data);
-            workqueue->last_cb = NULL;
+            worker->last_cb = NULL;
         }
     }
 }
@@ -97,6 +141,90 @@ static BOOL_T __work_cancel_traverse(void *item, void *ctx)
     return TRUE;
 }
 
+typedef struct {
+    WORKQUEUE_TRAVERSE_CB cb;
+    void *ctx;
+    BOOL_T stop;
+} WORK_TRAVERSE_T;
+
+/* carries a stop of the caller's traverse over to the next deques */
+static BOOL_T __work_traverse(void *item, void *ctx)
+{
+    WORK_TRAVERSE_T *traverse = (WORK_TRAVERSE_T *)ctx;
+
+    if (!traverse->cb((WORK_ITEM_T *)item, traverse->ctx)) {
+        traverse->stop = TRUE;
+    }
+
+    return !traverse->stop;
+}
+
+/* the least loaded deque that has room */
+static WORK_WORKER_T *__work_pick(TAL_WORKQUEUE_T *workqueue)
+{
+    WORK_WORKER_T *pick = NULL;
+    uint32_t pick_used = 0;
+
+    for (uint8_t i = 0; i < workqueue->worker_num; i++) {
+        WORK_WORKER_T *worker = &workqueue->worker[i];
+        if (0 == tuya_queue_get_free_num(worker->queue)) {
+            continue;
+        }
+        uint32_t used = tuya_queue_get_used_num(worker->queue);
+        if (NULL == pick || used < pick_used) {
+            pick = worker;
+            pick_used = used;
+        }
+    }
+
+    return pick ? pick : &workqueue->worker[0];
+}
+
+/* stop the started workers, each wakes once to see its deleted state */
+static OPERATE_RET __work_pool_stop(TAL_WORKQUEUE_T *workqueue)
+{
+    OPERATE_RET op_ret = OPRT_OK;
+    uint32_t count = 1;
+
+    for (uint8_t i = 0; i < workqueue->worker_num; i++) {
+        if (workqueue->worker[i].thread) {
+            op_ret = tal_thread_delete(workqueue->worker[i].thread);
+            if (OPRT_OK != op_ret) {
+                return op_ret;
+            }
+            tal_semaphore_post(workqueue->sem);
+        }
+    }
+
+    for (uint8_t i = 0; i < workqueue->worker_num; i++) {
+        THREAD_HANDLE thread = workqueue->worker[i].thread;
+        while (thread && THREAD_STATE_DELETE != tal_thread_get_state(thread)) {
+            tal_system_sleep(10);
+            if ((count++) % 500 == 0) {
+                PR_NOTICE("%p still running", thread);
+            }
+        }
+    }
+
+    return OPRT_OK;
+}
+
+static void __work_pool_free(TAL_WORKQUEUE_T *workqueue)
+{
+    for (uint8_t i = 0; i < workqueue->worker_num; i++) {
+        if (workqueue->worker[i].queue) {
+            tuya_queue_release(workqueue->worker[i].queue);
+        }
+    }
+    if (workqueue->sem) {
+        tal_semaphore_release(workqueue->sem);
+    }
+    if (workqueue->mutex) {
+        tal_mutex_release(workqueue->mutex);
+    }
+    tal_free(workqueue);
+}
+
 /**
  * @brief create and initialize a workqueue which runs in thread context
  *
@@ -109,37 +237,75 @@ static BOOL_T __work_cancel_traverse(void *item, void *ctx)
  * tuya_error_code.h
  */
 OPERATE_RET tal_workqueue_create(const uint16_t queue_len, THREAD_CFG_T *thread_cfg, WORKQUEUE_HANDLE *handle)
+{
+    return tal_workqueue_create_pool(queue_len, 1, thread_cfg, NULL, handle);
+}
+
+/**
+ * @brief create a workqueue served by several worker threads
+ *
+ * @param[in] queue_len the maximum number of items of each worker deque
+ * @param[in] worker_num the number of worker threads
+ * @param[in] thread_cfg thread param, the name gets the worker index appended
+ * @param[in] cores core of each worker, -1 for any, NULL for no affinity
+ * @param[out] handle the workqueue handle
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_workqueue_create_pool(const uint16_t queue_len, const uint8_t worker_num, THREAD_CFG_T *thread_cfg,
+                                      const int8_t *cores, WORKQUEUE_HANDLE *handle)
 {
     OPERATE_RET op_ret = OPRT_OK;
     TAL_WORKQUEUE_T *workqueue = NULL;
 
-    if ((0 == queue_len) || (NULL == thread_cfg) || (NULL == handle)) {
+    if ((0 == queue_len) || (0 == worker_num) || (NULL == thread_cfg) || (NULL == handle)) {
         return OPRT_INVALID_PARM;
     }
 
-    workqueue = (TAL_WORKQUEUE_T *)tal_calloc(1, sizeof(TAL_WORKQUEUE_T));
+    workqueue = (TAL_WORKQUEUE_T *)tal_calloc(1, sizeof(TAL_WORKQUEUE_T) + worker_num * sizeof(WORK_WORKER_T));
     if (NULL == workqueue) {
         return OPRT_MALLOC_FAILED;
     }
+    workqueue->worker_num = worker_num;
 
-    op_ret = tuya_queue_create(queue_len, sizeof(WORK_ITEM_T), &workqueue->queue);
-    if (OPRT_OK != op_ret) {
-        tal_free(workqueue);
-        return op_ret;
+    for (uint8_t i = 0; i < worker_num; i++) {
+        op_ret = tuya_queue_create(queue_len, sizeof(WORK_ITEM_T), &workqueue->worker[i].queue);
+        if (OPRT_OK != op_ret) {
+            __work_pool_free(workqueue);
+            return op_ret;
+        }
     }
 
-    op_ret = tal_semaphore_create_init(&workqueue->sem, 0, queue_len);
+    op_ret = tal_semaphore_create_init(&workqueue->sem, 0, (uint32_t)queue_len * worker_num);
+    if (OPRT_OK == op_ret) {
+        op_ret = tal_mutex_create_init(&workqueue->mutex);
+    }
     if (OPRT_OK != op_ret) {
-        tuya_queue_release(workqueue->queue);
-        tal_free(workqueue);
+        __work_pool_free(workqueue);
         return op_ret;
     }
 
-    op_ret = tal_thread_create_and_start(&workqueue->thread, NULL, NULL, __work_thread_cb, workqueue, thread_cfg);
+    for (uint8_t i = 0; i < worker_num; i++) {
+        WORK_WORKER_T *worker = &workqueue->worker[i];
+        THREAD_CFG_T cfg = *thread_cfg;
+
+        worker->workqueue = workqueue;
+        worker->core = cores ? cores[i] : -1;
+        if (worker_num > 1) {
+            snprintf(worker->name, sizeof(worker->name), "%.12s_%d", thread_cfg->thrdname, i);
+            cfg.thrdname = worker->name;
+        }
+
+        op_ret = tal_thread_create_and_start(&worker->thread, NULL, NULL, __work_thread_cb, worker, &cfg);
+        if (OPRT_OK != op_ret) {
+            break;
+        }
+    }
+
     if (OPRT_OK != op_ret) {
-        tal_semaphore_release(workqueue->sem);
-        tuya_queue_release(workqueue->queue);
-        tal_free(workqueue);
+        __work_pool_stop(workqueue);
+        __work_pool_free(workqueue);
     } else {
         *handle = workqueue;
     }
@@ -168,7 +334,7 @@ OPERATE_RET tal_workqueue_schedule(WORKQUEUE_HANDLE handle, WORKQUEUE_CB cb, voi
     TAL_WORKQUEUE_T *workqueue = (TAL_WORKQUEUE_T *)handle;
     WORK_ITEM_T work_item = {.cb = cb, .data = data};
 
-    op_ret = tuya_queue_input(workqueue->queue, &work_item);
+    op_ret = tuya_queue_input(__work_pick(workqueue)->queue, &work_item);
     if (OPRT_OK == op_ret) {
         op_ret = tal_semaphore_post(workqueue->sem);
     }
@@ -197,7 +363,7 @@ OPERATE_RET tal_workqueue_schedule_instant(WORKQUEUE_HANDLE handle, WORKQUEUE_CB
     TAL_WORKQUEUE_T *workqueue = (TAL_WORKQUEUE_T *)handle;
     WORK_ITEM_T work_item = {.cb = cb, .data = data};
 
-    op_ret = tuya_queue_input_instant(workqueue->queue, &work_item);
+    op_ret = tuya_queue_input_instant(__work_pick(workqueue)->queue, &work_item);
     if (OPRT_OK == op_ret) {
         op_ret = tal_semaphore_post(workqueue->sem);
     }
@@ -224,7 +390,11 @@ OPERATE_RET tal_workqueue_cancel(WORKQUEUE_HANDLE handle, WORKQUEUE_CB cb, void
     TAL_WORKQUEUE_T *workqueue = (TAL_WORKQUEUE_T *)handle;
     WORK_ITEM_T work_item = {.cb = cb, .data = data};
 
-    return tuya_queue_traverse(workqueue->queue, __work_cancel_traverse, &work_item);
+    for (uint8_t i = 0; i < workqueue->worker_num; i++) {
+        tuya_queue_traverse(workqueue->worker[i].queue, __work_cancel_traverse, &work_item);
+    }
+
+    return OPRT_OK;
 }
 
 /**
@@ -244,7 +414,12 @@ OPERATE_RET tal_workqueue_traverse(WORKQUEUE_HANDLE handle, WORKQUEUE_TRAVERSE_C
     }
 
     TAL_WORKQUEUE_T *workqueue = (TAL_WORKQUEUE_T *)handle;
-    return tuya_queue_traverse(workqueue->queue, (TRAVERSE_CB)cb, ctx);
+    WORK_TRAVERSE_T traverse = {.cb = cb, .ctx = ctx, .stop = FALSE};
+    for (uint8_t i = 0; i < workqueue->worker_num && !traverse.stop; i++) {
+        tuya_queue_traverse(workqueue->worker[i].queue, __work_traverse, &traverse);
+    }
+
+    return OPRT_OK;
 }
 
 /**
@@ -262,11 +437,16 @@ uint16_t tal_workqueue_get_num(WORKQUEUE_HANDLE handle)
 
     TAL_WORKQUEUE_T *workqueue = (TAL_WORKQUEUE_T *)handle;
 
-    if (workqueue->last_cb) {
-        PR_NOTICE("%p:last_cb %p", workqueue->thread, workqueue->last_cb);
+    uint16_t num = 0;
+    for (uint8_t i = 0; i < workqueue->worker_num; i++) {
+        WORK_WORKER_T *worker = &workqueue->worker[i];
+        if (worker->last_cb) {
+            PR_NOTICE("%p:last_cb %p", worker->thread, worker->last_cb);
+        }
+        num += tuya_queue_get_used_num(worker->queue);
     }
 
-    return tuya_queue_get_used_num(workqueue->queue);
+    return num;
 }
 
 /**
@@ -284,26 +464,13 @@ OPERATE_RET tal_workqueue_release(WORKQUEUE_HANDLE handle)
     }
 
     OPERATE_RET op_ret = OPRT_OK;
-    uint32_t count = 1;
     TAL_WORKQUEUE_T *workqueue = (TAL_WORKQUEUE_T *)handle;
 
-    op_ret = tal_thread_delete(workqueue->thread);
+    op_ret = __work_pool_stop(workqueue);
     if (OPRT_OK != op_ret) {
         return op_ret;
     }
-
-    tal_semaphore_post(workqueue->sem);
-
-    while (THREAD_STATE_DELETE != tal_thread_get_state(workqueue->thread)) {
-        tal_system_sleep(10);
-        if ((count++) % 500 == 0) {
-            PR_NOTICE("%p still running", workqueue->thread);
-        }
-    }
-
-    tuya_queue_release(workqueue->queue);
-    tal_semaphore_release(workqueue->sem);
-    tal_free(workqueue);
+    __work_pool_free(workqueue);
 
     return OPRT_OK;
 }
@@ -322,21 +489,178 @@ THREAD_HANDLE tal_workqueue_get_thread(WORKQUEUE_HANDLE handle)
     }
 
     TAL_WORKQUEUE_T *workqueue = (TAL_WORKQUEUE_T *)handle;
-    return workqueue->thread;
+    return workqueue->worker[0].thread;
 }
 
 typedef struct {
-    TIMER_ID timer;
+    TAL_WORKQUEUE_T *workqueue;
     WORKQUEUE_CB cb;
     void *data;
-    WORKQUEUE_HANDLE handle;
+    uint16_t pending; // queued items of this work
+    uint16_t skip;    // queued items cancelled, dropped when they come out
+    BOOL_T released;  // freed by the last queued item
+} WORK_T;
+
+static void __work_handle_cb(void *arg)
+{
+    WORK_T *work = (WORK_T *)arg;
+    BOOL_T run = TRUE;
+    WORKQUEUE_CB cb = work->cb;
+    void *data = work->data;
+
+    tal_mutex_lock(work->workqueue->mutex);
+    work->pending--;
+    if (work->skip) {
+        work->skip--;
+        run = FALSE;
+    }
+    BOOL_T release = work->released && 0 == work->pending;
+    tal_mutex_unlock(work->workqueue->mutex);
+
+    // copies, the handle may be released while cb runs
+    if (run) {
+        cb(data);
+    }
+    if (release) {
+        tal_free(work);
+    }
+}
+
+/**
+ * @brief create a work handle for repeated scheduling
+ *
+ * @param[in] handle the workqueue handle
+ * @param[in] cb the work callback
+ * @param[in] data the work data
+ * @param[out] work the work handle
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_workqueue_work_create(WORKQUEUE_HANDLE handle, WORKQUEUE_CB cb, void *data, WORK_HANDLE *work)
+{
+    if (NULL == handle || NULL == cb || NULL == work) {
+        return OPRT_INVALID_PARM;
+    }
+
+    WORK_T *p_work = (WORK_T *)tal_calloc(1, sizeof(WORK_T));
+    if (NULL == p_work) {
+        return OPRT_MALLOC_FAILED;
+    }
+    p_work->workqueue = (TAL_WORKQUEUE_T *)handle;
+    p_work->cb = cb;
+    p_work->data = data;
+    *work = p_work;
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief put a work handle in its workqueue
+ *
+ * @param[in] work the work handle
+ * @param[in] flags WORK_SCHEDULE_ONCE to coalesce with a run still queued
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_workqueue_work_schedule(WORK_HANDLE work, uint8_t flags)
+{
+    if (NULL == work) {
+        return OPRT_INVALID_PARM;
+    }
+
+    OPERATE_RET op_ret = OPRT_OK;
+    WORK_T *p_work = (WORK_T *)work;
+    MUTEX_HANDLE mutex = p_work->workqueue->mutex;
+
+    tal_mutex_lock(mutex);
+    if (p_work->released) {
+        tal_mutex_unlock(mutex);
+        return OPRT_INVALID_PARM;
+    }
+    if ((flags & WORK_SCHEDULE_ONCE) && p_work->pending > p_work->skip) {
+        tal_mutex_unlock(mutex);
+        return OPRT_OK;
+    }
+    p_work->pending++;
+    tal_mutex_unlock(mutex);
+
+    op_ret = tal_workqueue_schedule(p_work->workqueue, __work_handle_cb, p_work);
+    if (OPRT_OK != op_ret) {
+        tal_mutex_lock(mutex);
+        p_work->pending--;
+        tal_mutex_unlock(mutex);
+    }
+
+    return op_ret;
+}
+
+/**
+ * @brief cancel the queued runs of a work handle, in O(1)
+ *
+ * @param[in] work the work handle
+ *
+ * @note a run already started is not affected
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_workqueue_work_cancel(WORK_HANDLE work)
+{
+    if (NULL == work) {
+        return OPRT_INVALID_PARM;
+    }
+
+    WORK_T *p_work = (WORK_T *)work;
+
+    tal_mutex_lock(p_work->workqueue->mutex);
+    p_work->skip = p_work->pending;
+    tal_mutex_unlock(p_work->workqueue->mutex);
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief cancel and free a work handle
+ *
+ * @param[in] work the work handle
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_workqueue_work_release(WORK_HANDLE work)
+{
+    if (NULL == work) {
+        return OPRT_INVALID_PARM;
+    }
+
+    WORK_T *p_work = (WORK_T *)work;
+
+    tal_mutex_lock(p_work->workqueue->mutex);
+    p_work->released = TRUE;
+    p_work->skip = p_work->pending;
+    BOOL_T release = (0 == p_work->pending);
+    tal_mutex_unlock(p_work->workqueue->mutex);
+
+    if (release) {
+        tal_free(p_work);
+    }
+
+    return OPRT_OK;
+}
+
+typedef struct {
+    TIMER_ID timer;
+    WORK_HANDLE work;
 } DELAYED_WORK_T;
 
 void __delayed_work_cb(TIMER_ID timer_id, void *arg)
 {
     DELAYED_WORK_T *p_delayed_work = (DELAYED_WORK_T *)arg;
 
-    tal_workqueue_schedule(p_delayed_work->handle, p_delayed_work->cb, p_delayed_work->data);
+    // a busy workqueue gets one run per backlog, not one per tick
+    tal_workqueue_work_schedule(p_delayed_work->work, WORK_SCHEDULE_ONCE);
 }
 
 /**
@@ -364,12 +688,15 @@ OPERATE_RET tal_workqueue_init_delayed(WORKQUEUE_HANDLE handle, WORKQUEUE_CB cb,
         return OPRT_MALLOC_FAILED;
     }
 
-    p_delayed_work->data = data;
-    p_delayed_work->cb = cb;
-    p_delayed_work->handle = handle;
+    op_ret = tal_workqueue_work_create(handle, cb, data, &p_delayed_work->work);
+    if (OPRT_OK != op_ret) {
+        tal_free(p_delayed_work);
+        return op_ret;
+    }
 
     op_ret = tal_sw_timer_create(__delayed_work_cb, p_delayed_work, &p_delayed_work->timer);
     if (OPRT_OK != op_ret) {
+        tal_workqueue_work_release(p_delayed_work->work);
         tal_free(p_delayed_work);
         return OPRT_COM_ERROR;
     }
@@ -436,7 +763,7 @@ OPERATE_RET tal_workqueue_cancel_delayed(DELAYED_WORK_HANDLE delayed_work)
     DELAYED_WORK_T *p_delayed_work = (DELAYED_WORK_T *)delayed_work;
 
     tal_sw_timer_delete(p_delayed_work->timer);
-    tal_workqueue_cancel(p_delayed_work->handle, p_delayed_work->cb, p_delayed_work->data);
+    tal_workqueue_work_release(p_delayed_work->work);
 
     tal_free(p_delayed_work);
 
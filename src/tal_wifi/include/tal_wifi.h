@@ -460,6 +460,19 @@ OPERATE_RET tal_wifi_lp_enable(void);
  */
 OPERATE_RET tal_wifi_lp_disable(void);
 
+/**
+ * @brief keep the wifi radio awake for real-time media
+ *
+ * @note takes one reference like tal_wifi_lp_disable() while enabled, so
+ * the station does not doze between DTIM beacons and downlink audio is not
+ * held back at the AP; released again when disabled
+ *
+ * @param[in]       enable  TRUE while an audio/video session runs
+ * @return  OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_wifi_set_media_priority(BOOL_T enable);
+
 /**
  * @brief set the wifi low power dtim.
  *
@@ -36,6 +36,7 @@ typedef struct {
     BOOL_T set_mode_done;
     uint32_t lp_disable_cnt;
     uint32_t lps_dtim;
+    BOOL_T media_priority;
 } TAL_WIFI_T;
 
 static TAL_WIFI_T s_tal_wifi = {0};
@@ -597,6 +598,30 @@ OPERATE_RET tal_wifi_lp_enable(void)
     return op_ret | tal_cpu_lp_enable();
 }
 
+/**
+ * @brief keep the wifi radio awake for real-time media
+ *
+ * @param[in]       enable  TRUE while an audio/video session runs
+ * @return  OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tal_wifi_set_media_priority(BOOL_T enable)
+{
+    BOOL_T change = FALSE;
+
+    TAL_WIFI_LOCK();
+    change = (s_tal_wifi.media_priority != enable);
+    s_tal_wifi.media_priority = enable;
+    TAL_WIFI_UNLOCK();
+    if (!change) {
+        return OPRT_OK;
+    }
+
+    PR_DEBUG("<tal_wifi_media> priority:%d", enable);
+    // one reference on the lowpower disable count, so other users keep theirs
+    return enable ? tal_wifi_lp_disable() : tal_wifi_lp_enable();
+}
+
 /**
  * @brief disable wifi lowpower
  *
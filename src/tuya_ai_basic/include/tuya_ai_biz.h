@@ -156,6 +156,30 @@ typedef struct {
     void *usr_data;
 } AI_BIZ_RECV_DATA_T;
 
+typedef enum {
+    /** audio, text and events, sent before any bulk data */
+    AI_BIZ_SEND_RT = 0,
+    /** video, image and file chunks, sharing what is left by bytes */
+    AI_BIZ_SEND_BULK,
+} AI_BIZ_SEND_CLASS_E;
+
+typedef struct {
+    /** send channel id */
+    uint16_t id;
+    /** AI_BIZ_SEND_CLASS_E of the channel */
+    uint8_t cls;
+    /** packets sent */
+    uint32_t pkts;
+    /** payload bytes sent */
+    uint64_t bytes;
+    /** ms from the channel being ready to its first packet sent, last time */
+    uint32_t lat_last_ms;
+    /** same, the largest seen */
+    uint32_t lat_max_ms;
+    /** same, moving average */
+    uint32_t lat_avg_ms;
+} AI_BIZ_SEND_STAT_T;
+
 typedef struct {
     /** send channel num */
     uint16_t send_num;
@@ -193,6 +217,36 @@ OPERATE_RET tuya_ai_biz_crt_session(uint32_t bizCode, AI_SESSION_CFG_T *cfg, uin
  */
 OPERATE_RET tuya_ai_biz_del_session(AI_SESSION_ID id, AI_STATUS_CODE code);
 
+/**
+ * @brief tell the biz thread a send channel has data
+ *
+ * The biz thread sleeps until a channel is marked ready, then calls its
+ * get_cb until it returns an error. Channels that are never marked are
+ * still polled every AI_BIZ_IDLE_SCAN_MS.
+ *
+ * Real-time channels are served first, AI_BIZ_SEND_BURST packets at a time,
+ * and again between any two bulk packets. Bulk channels take turns by deficit
+ * round robin, AI_BIZ_BULK_QUANTUM payload bytes per turn, so a large upload
+ * neither delays the audio nor starves another upload.
+ *
+ * @param[in] id send channel id
+ *
+ * @return OPRT_OK on success. Others on error, please refer to tuya_error_code.h
+ */
+OPERATE_RET tuya_ai_biz_send_ready(uint16_t id);
+
+/**
+ * @brief get the statistics of the send channels
+ *
+ * A channel of a closed session keeps its entry until the slot is reused.
+ *
+ * @param[out] stat channel statistics
+ * @param[in,out] num in: entries of stat, out: entries filled
+ *
+ * @return OPRT_OK on success. Others on error, please refer to tuya_error_code.h
+ */
+OPERATE_RET tuya_ai_biz_get_send_stat(AI_BIZ_SEND_STAT_T *stat, uint32_t *num);
+
 /**
  * @brief send ai biz packet
  *
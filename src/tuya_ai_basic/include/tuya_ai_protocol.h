@@ -29,6 +29,9 @@
 #include "tuya_cloud_com_defs.h"
 #include "tuya_cloud_types.h"
 #include "tuya_iot_config.h"
+#if defined(ENABLE_AI_PROTO_BENCH) && (ENABLE_AI_PROTO_BENCH == 1)
+#include "tuya_transporter.h"
+#endif
 
 #if defined ENABLE_AI_PROTO_DEBUG && (ENABLE_AI_PROTO_DEBUG == 1)
 #define AI_PROTO_D(...) PR_DEBUG(__VA_ARGS__)
@@ -298,6 +301,7 @@ typedef struct ai_send_packet_t {
     uint32_t len;
     char *data;
     AI_PACKET_WRITER_T *writer;
+    uint8_t attrs_borrowed; // attrs live in caller storage (tuya_ai_init_attribute) and are not freed
 } AI_SEND_PACKET_T;
 
 typedef struct {
@@ -484,6 +488,22 @@ OPERATE_RET tuya_ai_basic_pkt_frag_send(AI_SEND_PACKET_T *info);
  */
 AI_ATTRIBUTE_T *tuya_ai_create_attribute(AI_ATTR_TYPE type, AI_ATTR_PT payload_type, void *value, uint32_t len);
 
+/**
+ * @brief fill a caller owned attribute, without allocating
+ *
+ * ATTR_PT_STR and ATTR_PT_BYTES values are referenced, not copied, so they
+ * must stay valid until the packet is sent. A packet built from such
+ * attributes must set attrs_borrowed.
+ *
+ * @param[out] attr attribute to fill
+ * @param[in] type attribute type
+ * @param[in] payload_type attribute payload type
+ * @param[in] value attribute value
+ * @param[in] len attribute value length
+ */
+void tuya_ai_init_attribute(AI_ATTRIBUTE_T *attr, AI_ATTR_TYPE type, AI_ATTR_PT payload_type, void *value,
+                            uint32_t len);
+
 /**
  * @brief request atop info
  *
@@ -491,6 +511,18 @@ AI_ATTRIBUTE_T *tuya_ai_create_attribute(AI_ATTR_TYPE type, AI_ATTR_PT payload_t
  */
 OPERATE_RET tuya_ai_basic_atop_req(void);
 
+/**
+ * @brief reset the connection state for a reconnect, keeping the atop info
+ *
+ * Reuses the server list and credentials of the last tuya_ai_basic_atop_req
+ * while they are still valid, so a reconnect skips the atop round trip.
+ * Keys, IV and sequence numbers are regenerated as for a fresh connection.
+ *
+ * @return OPRT_OK if the cached atop info can be used, OPRT_NOT_FOUND if a
+ * new tuya_ai_basic_atop_req is needed
+ */
+OPERATE_RET tuya_ai_basic_resume(void);
+
 /**
  * @brief get atop cfg info
  *
@@ -734,4 +766,32 @@ void tuya_ai_basic_pkt_free(char *data);
  * @return
  */
 void tuya_ai_basic_set_frag_flag(bool flag);
+
+#if defined(ENABLE_AI_PROTO_BENCH) && (ENABLE_AI_PROTO_BENCH == 1)
+/**
+ * @brief build, encrypt and sign one packet without a cloud link
+ *
+ * @param[in] info packet info, writer NULL for the configured security level
+ * @param[in] frag fragment flag
+ * @note
+ * Sets up the protocol context on first use and sends nothing, for the
+ * micro-benchmark suite only. Refused while a transporter is open.
+ * @return OPRT_OK on success. Others on error, please refer to tuya_error_code.h
+ */
+OPERATE_RET tuya_ai_basic_pkt_write_bench(AI_SEND_PACKET_T *info, AI_FRAG_FLAG frag);
+
+/**
+ * @brief feed tuya_ai_basic_pkt_read() from a caller transporter
+ *
+ * @param[in] transporter source of the received stream, NULL detaches
+ * @param[in] sl security level to decrypt with
+ * @param[in] resign sign each packet as it is read, so inputs without the
+ * session key reach decryption and reassembly
+ * @note
+ * For the fuzz and replay harness only. Every call resets the sequence
+ * window and drops a half reassembled packet. Refused while connected.
+ * @return OPRT_OK on success. Others on error, please refer to tuya_error_code.h
+ */
+OPERATE_RET tuya_ai_basic_pkt_read_attach(tuya_transporter_t transporter, AI_PACKET_SL sl, bool resign);
+#endif
 #endif
\ No newline at end of file
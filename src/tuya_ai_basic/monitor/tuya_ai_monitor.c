@@ -25,6 +25,8 @@
 #define AI_MONITOR_MAX_CLIENTS_MIN 1
 #define AI_MONITOR_MAX_CLIENTS_MAX 3
 
+#define AI_MONITOR_BIZ_STAT_MAX 8 // biz send channels reported by the status dump and perf metric
+
 // Protocol magic number
 #define AI_MONITOR_MAGIC 0x54594149
 
@@ -38,6 +40,26 @@
 #define AI_MONITOR_DIR_ACK 2 // Device ack to client
 #define AI_MONITOR_DIR_MAX 3 // Maximum direction type
 
+#define TY_AI_MONITOR_US_AUDIO 1
+#define TY_AI_MONITOR_US_VIDEO 3
+#define TY_AI_MONITOR_US_TEXT  5
+#define TY_AI_MONITOR_US_IMAGE 7
+#define TY_AI_MONITOR_DS_AUDIO 2
+#define TY_AI_MONITOR_DS_TEXT  4
+#define TY_AI_MONITOR_US_LOG   0x8001
+#define TY_AI_MONITOR_US_MIC   0x8003
+#define TY_AI_MONITOR_US_REF   0x8005
+#define TY_AI_MONITOR_US_AEC   0x8007
+#define TY_AI_MONITOR_US_TRACE 0x8009 // tal_trace JSON, split over several text frames
+
+#define AI_MONITOR_TX_REC_HEAD 4   // ring record header, frame length
+#define AI_MONITOR_TX_IDLE_MS  200 // sender wakeup with nothing queued
+#define AI_MONITOR_TX_RETRY_MS 20  // sender retry while a client socket is full
+
+#define AI_MONITOR_TRACE_BATCH    16  // trace records per packet
+#define AI_MONITOR_TRACE_FLUSH_MS 100 // longest a trace record waits for its batch
+#define AI_MONITOR_TRACE_DUMP_LEN 1024 // tal_trace JSON bytes per text frame
+
 #pragma pack(1)
 typedef struct {
     uint32_t magic;              // magic number for frame synchronization
@@ -57,6 +79,14 @@ typedef struct {
     uint32_t recv_buf_size;      // receive buffer size
     uint32_t recv_len;           // received data length
     uint8_t registered_types[8]; // registered data types bitmap, max 64 types
+    uint8_t *tx_ring;            // queued frames, [len:4][frame] records
+    uint32_t tx_size;            // ring size
+    uint32_t tx_tail;            // offset of the oldest record
+    uint32_t tx_used;            // bytes of committed records
+    uint32_t tx_open;            // bytes of the record being written, 0 if none
+    uint8_t tx_open_failed;      // record being written did not fit and is dropped
+    uint32_t tx_sent;            // bytes of the oldest record already sent
+    uint32_t tx_dropped;         // frames dropped because the ring was full
 } ai_monitor_client_t;
 
 typedef struct {
@@ -74,11 +104,20 @@ typedef struct {
     THREAD_HANDLE log_thread;     // log thread handle
     uint8_t log_thread_running;   // log thread running flag
     QUEUE_HANDLE log_queue;       // log queue
+    MUTEX_HANDLE tx_mutex;        // guards the client rings and the packet writer
+    SEM_HANDLE tx_sem;            // wakes the sender thread
+    THREAD_HANDLE tx_thread;      // sender thread, the only one writing to client sockets
+    uint8_t sample_every[AI_MONITOR_STREAM_MAX];  // forward one frame out of every, 0 disables
+    uint32_t sample_count[AI_MONITOR_STREAM_MAX]; // frames seen per stream
+    uint8_t trace_buf[AI_MONITOR_TRACE_BATCH * AI_MONITOR_TRACE_REC_LEN]; // pending trace records
+    uint32_t trace_num;                           // records in trace_buf
+    SYS_TIME_T trace_first_ms;                    // when the oldest pending record was added
+    uint32_t trace_session;                       // session hash used when none is given
 } ai_monitor_server_t;
 
 typedef struct {
-    AI_PACKET_WRITER_T *writer; // packet writer
-    int fd;                     // socket fd
+    AI_PACKET_WRITER_T *writer;  // packet writer
+    ai_monitor_client_t *client; // client whose ring receives the packet
     uint8_t direction;          // direction: 0 for device upload, 1 for cloud download, 2 for device ack to client
     uint16_t sequence_out;      // sequence number for outgoing packets
     uint32_t frag_offset[AI_MONITOR_DIR_MAX]; // offset for upstream/downstream/ack packet fragments
@@ -103,7 +142,7 @@ static void __log_output(const char *str);
 
 ai_monitor_writer_cfg_t s_monitor_writer_cfg = {
     .writer = NULL, // Will be set later
-    .fd = -1,
+    .client = NULL,
     .direction = 0, // Default to device upload,
     .sequence_out = 1,
 };
@@ -114,13 +153,252 @@ AI_PACKET_WRITER_T s_default_writer = {
     .user_data = &s_monitor_writer_cfg,
 };
 
-#define AI_MONITOR_WRITER_UPDATE(_writer, _fd, _direction)                                                             \
+#define AI_MONITOR_WRITER_UPDATE(_writer, _client, _direction)                                                         \
     do {                                                                                                               \
         ((ai_monitor_writer_cfg_t *)_writer->user_data)->writer = &s_default_writer;                                   \
-        ((ai_monitor_writer_cfg_t *)_writer->user_data)->fd = (_fd);                                                   \
+        ((ai_monitor_writer_cfg_t *)_writer->user_data)->client = (_client);                                           \
         ((ai_monitor_writer_cfg_t *)_writer->user_data)->direction = (_direction);                                     \
     } while (0)
 
+static void __tx_ring_copy_in(ai_monitor_client_t *client, uint32_t pos, const uint8_t *buf, uint32_t len)
+{
+    pos %= client->tx_size;
+    uint32_t first = client->tx_size - pos;
+    if (first > len) {
+        first = len;
+    }
+    memcpy(client->tx_ring + pos, buf, first);
+    memcpy(client->tx_ring, buf + first, len - first);
+}
+
+static uint32_t __tx_ring_record_len(ai_monitor_client_t *client, uint32_t pos)
+{
+    uint8_t head[AI_MONITOR_TX_REC_HEAD];
+    for (uint32_t i = 0; i < AI_MONITOR_TX_REC_HEAD; i++) {
+        head[i] = client->tx_ring[(pos + i) % client->tx_size];
+    }
+    return (uint32_t)head[0] | ((uint32_t)head[1] << 8) | ((uint32_t)head[2] << 16) | ((uint32_t)head[3] << 24);
+}
+
+/**
+ * @brief Drop the oldest queued frame, unless it is partly sent
+ */
+static uint8_t __tx_ring_drop_oldest(ai_monitor_client_t *client)
+{
+    if (client->tx_used == 0 || client->tx_sent > 0) {
+        return FALSE;
+    }
+    uint32_t rec_len = AI_MONITOR_TX_REC_HEAD + __tx_ring_record_len(client, client->tx_tail);
+    client->tx_tail = (client->tx_tail + rec_len) % client->tx_size;
+    client->tx_used -= rec_len;
+    client->tx_dropped++;
+    return TRUE;
+}
+
+static uint8_t __tx_ring_reserve(ai_monitor_client_t *client, uint32_t len)
+{
+    while (client->tx_size - client->tx_used - client->tx_open < len) {
+        if (!__tx_ring_drop_oldest(client)) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/**
+ * @brief Close the record being written, queueing it for the sender on commit
+ */
+static void __tx_ring_end(ai_monitor_client_t *client, uint8_t commit)
+{
+    if (client->tx_open == 0) {
+        return;
+    }
+    if (commit && !client->tx_open_failed && client->tx_open > AI_MONITOR_TX_REC_HEAD) {
+        uint32_t frame_len = client->tx_open - AI_MONITOR_TX_REC_HEAD;
+        uint8_t head[AI_MONITOR_TX_REC_HEAD] = {frame_len & 0xFF, (frame_len >> 8) & 0xFF, (frame_len >> 16) & 0xFF,
+                                                frame_len >> 24};
+        __tx_ring_copy_in(client, client->tx_tail + client->tx_used, head, sizeof(head));
+        client->tx_used += client->tx_open;
+        tal_semaphore_post(g_ai_monitor_server.tx_sem);
+    }
+    client->tx_open = 0;
+    client->tx_open_failed = FALSE;
+}
+
+static void __tx_ring_begin(ai_monitor_client_t *client)
+{
+    __tx_ring_end(client, TRUE);
+    if (!client->tx_ring || !__tx_ring_reserve(client, AI_MONITOR_TX_REC_HEAD)) {
+        client->tx_open_failed = TRUE;
+        client->tx_dropped++;
+    }
+    client->tx_open = AI_MONITOR_TX_REC_HEAD;
+}
+
+static OPERATE_RET __tx_ring_append(ai_monitor_client_t *client, const uint8_t *buf, uint32_t len)
+{
+    if (client->tx_open == 0 || client->tx_open_failed) {
+        return OPRT_COM_ERROR;
+    }
+    if (!__tx_ring_reserve(client, len)) {
+        client->tx_open_failed = TRUE;
+        client->tx_dropped++;
+        return OPRT_EXCEED_UPPER_LIMIT;
+    }
+    __tx_ring_copy_in(client, client->tx_tail + client->tx_used + client->tx_open, buf, len);
+    client->tx_open += len;
+    return OPRT_OK;
+}
+
+/**
+ * @brief Send queued frames until the ring is empty or the socket is full
+ *
+ * @return TRUE if data is left for a later retry
+ */
+static uint8_t __tx_ring_flush(ai_monitor_client_t *client)
+{
+    while (client->tx_used > 0) {
+        uint32_t frame_len = __tx_ring_record_len(client, client->tx_tail);
+        uint32_t pos = (client->tx_tail + AI_MONITOR_TX_REC_HEAD + client->tx_sent) % client->tx_size;
+        uint32_t chunk = frame_len - client->tx_sent;
+        if (chunk > client->tx_size - pos) {
+            chunk = client->tx_size - pos;
+        }
+
+        int sent = tal_net_send(client->fd, client->tx_ring + pos, chunk);
+        if (sent <= 0) {
+            TUYA_ERRNO err = tal_net_get_errno();
+            // FIXME: some platforms may return different error codes
+            if (err == UNW_EAGAIN || err == UNW_EWOULDBLOCK || err == 11) {
+                return TRUE;
+            }
+            PR_ERR("send to client fd=%d failed, rt=%d, errno=%d", client->fd, sent, err);
+            // the socket error handler cleans up the client, drop what is queued
+            client->tx_tail = (client->tx_tail + client->tx_used) % client->tx_size;
+            client->tx_used = 0;
+            client->tx_sent = 0;
+            return FALSE;
+        }
+
+        client->tx_sent += sent;
+        if (client->tx_sent == frame_len) {
+            client->tx_tail = (client->tx_tail + AI_MONITOR_TX_REC_HEAD + frame_len) % client->tx_size;
+            client->tx_used -= AI_MONITOR_TX_REC_HEAD + frame_len;
+            client->tx_sent = 0;
+        }
+    }
+    return FALSE;
+}
+
+static uint8_t *__put_be(uint8_t *p, uint64_t value, uint32_t len)
+{
+    for (uint32_t i = 0; i < len; i++) {
+        p[i] = (uint8_t)(value >> (8 * (len - 1 - i)));
+    }
+    return p + len;
+}
+
+static uint32_t __trace_session_hash(const char *session_id)
+{
+    uint32_t hash = 2166136261u;
+    while (*session_id) {
+        hash = (hash ^ (uint8_t)*session_id++) * 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @brief Queue the pending trace records to subscribed clients, tx_mutex must be held
+ */
+static void __trace_flush(ai_monitor_server_t *server)
+{
+    if (server->trace_num == 0) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < server->config.max_clients; i++) {
+        ai_monitor_client_t *client = &server->clients[i];
+        if (!client->connected || client->fd < 0 || !__is_client_registered(client, AI_PT_CUSTOM_TRACE)) {
+            continue;
+        }
+
+        AI_SEND_PACKET_T pkt = {0};
+        pkt.type = AI_PT_CUSTOM_TRACE;
+        pkt.data = (char *)server->trace_buf;
+        pkt.len = server->trace_num * AI_MONITOR_TRACE_REC_LEN;
+        pkt.writer = &s_default_writer;
+        AI_MONITOR_WRITER_UPDATE(pkt.writer, client, AI_MONITOR_DIR_ACK);
+        OPERATE_RET rt = tuya_ai_basic_pkt_send(&pkt);
+        __tx_ring_end(client, rt == OPRT_OK);
+    }
+    server->trace_num = 0;
+}
+
+static void __tx_task(void *args)
+{
+    ai_monitor_server_t *server = (ai_monitor_server_t *)args;
+
+    while (tal_thread_get_state(server->tx_thread) == THREAD_STATE_RUNNING) {
+        uint8_t pending = FALSE;
+
+        tal_mutex_lock(server->tx_mutex);
+        if (server->trace_num > 0 &&
+            tal_system_get_millisecond() - server->trace_first_ms >= AI_MONITOR_TRACE_FLUSH_MS) {
+            __trace_flush(server);
+        }
+        for (uint32_t i = 0; i < server->config.max_clients; i++) {
+            ai_monitor_client_t *client = &server->clients[i];
+            if (client->connected && client->fd >= 0 && client->tx_used > 0) {
+                pending |= __tx_ring_flush(client);
+            }
+        }
+        tal_mutex_unlock(server->tx_mutex);
+
+        uint32_t wait_ms = pending ? AI_MONITOR_TX_RETRY_MS : AI_MONITOR_TX_IDLE_MS;
+        if (server->trace_num > 0 && wait_ms > AI_MONITOR_TRACE_FLUSH_MS) {
+            wait_ms = AI_MONITOR_TRACE_FLUSH_MS;
+        }
+        tal_semaphore_wait(server->tx_sem, wait_ms);
+    }
+}
+
+static ai_monitor_stream_e __stream_of(uint8_t direction, uint16_t id)
+{
+    if (direction != AI_MONITOR_DIR_ACK) {
+        return AI_MONITOR_STREAM_BIZ;
+    }
+    switch (id) {
+    case TY_AI_MONITOR_US_MIC:
+        return AI_MONITOR_STREAM_MIC;
+    case TY_AI_MONITOR_US_REF:
+        return AI_MONITOR_STREAM_REF;
+    case TY_AI_MONITOR_US_AEC:
+        return AI_MONITOR_STREAM_AEC;
+    case TY_AI_MONITOR_US_TEXT:
+        return AI_MONITOR_STREAM_TEXT;
+    case TY_AI_MONITOR_US_LOG:
+        return AI_MONITOR_STREAM_LOG;
+    default:
+        return AI_MONITOR_STREAM_BIZ;
+    }
+}
+
+/**
+ * @brief Check whether a frame of a stream passes sampling, tx_mutex must be held
+ */
+static uint8_t __stream_sampled(ai_monitor_stream_e stream, uint8_t stream_flag)
+{
+    uint8_t every = g_ai_monitor_server.sample_every[stream];
+    if (every == 0) {
+        return FALSE;
+    }
+    // keep stream boundaries so clients can split the recording
+    if (every == 1 || (stream_flag & (AI_STREAM_START | AI_STREAM_END))) {
+        return TRUE;
+    }
+    return (g_ai_monitor_server.sample_count[stream]++ % every) == 0;
+}
+
 /**
  * @brief Initialize client structure
  */
@@ -144,6 +422,15 @@ static OPERATE_RET __init_client(ai_monitor_client_t *client, int fd, TUYA_IP_AD
         return OPRT_MALLOC_FAILED;
     }
 
+    client->tx_size = g_ai_monitor_server.config.send_buf_size;
+    client->tx_ring = OS_MALLOC(client->tx_size);
+    if (!client->tx_ring) {
+        PR_ERR("malloc send ring failed");
+        OS_FREE(client->recv_buf);
+        client->recv_buf = NULL;
+        return OPRT_MALLOC_FAILED;
+    }
+
     client->recv_len = 0;
     __client_register_clear(client); // Clear registered types
 
@@ -165,6 +452,15 @@ static void __cleanup_client(ai_monitor_client_t *client)
         client->recv_buf = NULL;
     }
 
+    tal_mutex_lock(g_ai_monitor_server.tx_mutex);
+    if (client->tx_ring) {
+        OS_FREE(client->tx_ring);
+        client->tx_ring = NULL;
+    }
+    client->tx_used = 0;
+    client->tx_open = 0;
+    client->tx_sent = 0;
+
     if (client->fd >= 0) {
         tuya_unreg_lan_sock(client->fd);
         // tal_net_close(client->fd);
@@ -172,6 +468,7 @@ static void __cleanup_client(ai_monitor_client_t *client)
     }
 
     client->connected = FALSE;
+    tal_mutex_unlock(g_ai_monitor_server.tx_mutex);
     client->recv_len = 0;
     __client_register_clear(client); // Clear registered types
 }
@@ -216,7 +513,7 @@ static OPERATE_RET __client_register_clear(ai_monitor_client_t *client)
 }
 
 /**
- * @brief send message to specific client
+ * @brief queue message for specific client, tx_mutex must be held
  */
 static OPERATE_RET __pack_and_send(ai_monitor_client_t *client, uint8_t direction, uint16_t id,
                                    AI_BIZ_ATTR_INFO_T *attr, AI_BIZ_HEAD_INFO_T *head, char *data)
@@ -227,13 +524,14 @@ static OPERATE_RET __pack_and_send(ai_monitor_client_t *client, uint8_t directio
     }
 
     AI_PACKET_WRITER_T *writer = &s_default_writer;
-    AI_MONITOR_WRITER_UPDATE(writer, client->fd, direction); // Update writer with client fd and direction
+    AI_MONITOR_WRITER_UPDATE(writer, client, direction); // Update writer with client and direction
     rt = tuya_ai_send_biz_pkt_custom(id, attr, attr->type, head, data, writer);
+    __tx_ring_end(client, rt == OPRT_OK);
     if (rt != OPRT_OK) {
         PR_ERR("send biz data failed, rt:%d", rt);
         return rt;
     }
-    PR_TRACE("Sent data to client fd=%d, id=%d, type=%d, head len=%d, data len=%d", client->fd, id, attr->type,
+    PR_TRACE("Queued data to client fd=%d, id=%d, type=%d, head len=%d, data len=%d", client->fd, id, attr->type,
              head->len, head->total_len);
     return OPRT_OK;
 }
@@ -250,8 +548,9 @@ static OPERATE_RET __handle_ping(ai_monitor_client_t *client, uint64_t client_ts
     AI_SEND_PACKET_T pkt = {0};
     pkt.type = AI_PT_PONG;
     pkt.writer = &s_default_writer;
-    AI_MONITOR_WRITER_UPDATE(pkt.writer, client->fd,
-                             AI_MONITOR_DIR_ACK); // Update writer with client fd and ACK direction
+    tal_mutex_lock(g_ai_monitor_server.tx_mutex);
+    AI_MONITOR_WRITER_UPDATE(pkt.writer, client,
+                             AI_MONITOR_DIR_ACK); // Update writer with client and ACK direction
     // create pong attrs
     uint32_t attr_idx = 0;
     pkt.attrs[attr_idx++] = tuya_ai_create_attribute(AI_ATTR_CLIENT_TS, ATTR_PT_U64, &client_ts, SIZEOF(uint64_t));
@@ -262,6 +561,8 @@ static OPERATE_RET __handle_ping(ai_monitor_client_t *client, uint64_t client_ts
     //     return OPRT_MALLOC_FAILED;
     // }
     rt = tuya_ai_basic_pkt_send(&pkt);
+    __tx_ring_end(client, rt == OPRT_OK);
+    tal_mutex_unlock(g_ai_monitor_server.tx_mutex);
     if (rt != OPRT_OK) {
         PR_ERR("Failed to send pong response, rt: %d", rt);
         return rt;
@@ -300,6 +601,9 @@ static OPERATE_RET __handle_event_filter(ai_monitor_client_t *client, AI_EVENT_A
     if (user_data_bitmap & (1ULL << AI_PT_EVENT)) {
         __client_register(client, AI_PT_EVENT);
     }
+    if (user_data_bitmap & (1ULL << AI_PT_CUSTOM_TRACE)) {
+        __client_register(client, AI_PT_CUSTOM_TRACE);
+    }
     if (user_data_bitmap & (1ULL << AI_PT_CUSTOM_LOG)) {
         __client_register(client, AI_PT_CUSTOM_LOG);
         tal_log_add_output_term(AI_MONITOR_TAG, __log_output);
@@ -339,8 +643,6 @@ static OPERATE_RET __handle_event(ai_monitor_client_t *client, AI_EVENT_ATTR_T *
     AI_SEND_PACKET_T pkt = {0};
     pkt.type = AI_PT_EVENT;
     pkt.writer = &s_default_writer;
-    AI_MONITOR_WRITER_UPDATE(pkt.writer, client->fd,
-                             AI_MONITOR_DIR_ACK); // Update writer with client fd and ACK direction
     // create event attrs
     uint32_t attr_idx = 0;
     pkt.attrs[attr_idx++] =
@@ -361,7 +663,12 @@ static OPERATE_RET __handle_event(ai_monitor_client_t *client, AI_EVENT_ATTR_T *
     // Add response data
     pkt.data = resp_payload;
     pkt.len = sizeof(resp_payload);
+    tal_mutex_lock(g_ai_monitor_server.tx_mutex);
+    AI_MONITOR_WRITER_UPDATE(pkt.writer, client,
+                             AI_MONITOR_DIR_ACK); // Update writer with client and ACK direction
     rt = tuya_ai_basic_pkt_send(&pkt);
+    __tx_ring_end(client, rt == OPRT_OK);
+    tal_mutex_unlock(g_ai_monitor_server.tx_mutex);
     if (rt != OPRT_OK) {
         PR_ERR("Failed to send event response, rt: %d", rt);
         return rt;
@@ -765,7 +1072,13 @@ static OPERATE_RET __ai_biz_handler(uint8_t direction, uint16_t id, AI_BIZ_ATTR_
     OPERATE_RET ret = OPRT_OK;
     ai_monitor_server_t *server = (ai_monitor_server_t *)usr_data;
 
-    // send to specific client which registered this type
+    tal_mutex_lock(server->tx_mutex);
+    if (!__stream_sampled(__stream_of(direction, id), head->stream_flag)) {
+        tal_mutex_unlock(server->tx_mutex);
+        return OPRT_OK;
+    }
+
+    // queue to specific client which registered this type
     for (uint32_t i = 0; i < server->config.max_clients; i++) {
         ai_monitor_client_t *client = &server->clients[i];
         if (!client->connected || client->fd < 0) {
@@ -785,6 +1098,7 @@ static OPERATE_RET __ai_biz_handler(uint8_t direction, uint16_t id, AI_BIZ_ATTR_
             continue; // Try next client
         }
     }
+    tal_mutex_unlock(server->tx_mutex);
 
     return ret;
 }
@@ -792,13 +1106,17 @@ static OPERATE_RET __ai_biz_handler(uint8_t direction, uint16_t id, AI_BIZ_ATTR_
 static OPERATE_RET __ai_biz_recv_handler(uint16_t id, AI_BIZ_ATTR_INFO_T *attr, AI_BIZ_HEAD_INFO_T *head, char *data,
                                          void *usr_data)
 {
-    return __ai_biz_handler(AI_MONITOR_DIR_DS, id, attr, head, data, usr_data);
+    // monitor failures never reach the cloud path
+    __ai_biz_handler(AI_MONITOR_DIR_DS, id, attr, head, data, usr_data);
+    return OPRT_OK;
 }
 
 static OPERATE_RET __ai_biz_send_handler(uint16_t id, AI_BIZ_ATTR_INFO_T *attr, AI_BIZ_HEAD_INFO_T *head, char *data,
                                          void *usr_data)
 {
-    return __ai_biz_handler(AI_MONITOR_DIR_US, id, attr, head, data, usr_data);
+    // monitor failures never reach the cloud path
+    __ai_biz_handler(AI_MONITOR_DIR_US, id, attr, head, data, usr_data);
+    return OPRT_OK;
 }
 
 static void __monitor_tm_cb(TIMER_ID timerID, void *pTimerArg)
@@ -871,6 +1189,69 @@ static OPERATE_RET __ai_monitor_start(void)
     return OPRT_OK;
 }
 
+static OPERATE_RET __tx_start(void)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    TUYA_CALL_ERR_RETURN(tal_mutex_create_init(&g_ai_monitor_server.tx_mutex));
+    TUYA_CALL_ERR_RETURN(tal_semaphore_create_init(&g_ai_monitor_server.tx_sem, 0, 1));
+
+    THREAD_CFG_T thrd_param = {0};
+    thrd_param.priority = THREAD_PRIO_3;
+    thrd_param.thrdname = "ai_mon_tx";
+    thrd_param.stackDepth = 3072;
+#if defined(AI_STACK_IN_PSRAM) && (AI_STACK_IN_PSRAM == 1)
+    thrd_param.psram_mode = 1;
+#endif
+    return tal_thread_create_and_start(&g_ai_monitor_server.tx_thread, NULL, NULL, __tx_task, &g_ai_monitor_server,
+                                       &thrd_param);
+}
+
+static void __tx_stop(void)
+{
+    if (g_ai_monitor_server.tx_thread) {
+        tal_thread_delete(g_ai_monitor_server.tx_thread);
+        g_ai_monitor_server.tx_thread = NULL;
+    }
+    if (g_ai_monitor_server.tx_sem) {
+        tal_semaphore_post(g_ai_monitor_server.tx_sem);
+        tal_semaphore_release(g_ai_monitor_server.tx_sem);
+        g_ai_monitor_server.tx_sem = NULL;
+    }
+    if (g_ai_monitor_server.tx_mutex) {
+        tal_mutex_release(g_ai_monitor_server.tx_mutex);
+        g_ai_monitor_server.tx_mutex = NULL;
+    }
+}
+
+// bytes waiting in the client send rings, shown by the perf cli command
+static uint32_t __tx_queued_metric(void *arg)
+{
+    uint32_t queued = 0;
+
+    for (uint32_t i = 0; g_ai_monitor_server.clients && i < g_ai_monitor_server.config.max_clients; i++) {
+        queued += g_ai_monitor_server.clients[i].tx_used;
+    }
+    return queued;
+}
+
+// worst last scheduling latency of the real-time biz send channels in ms, shown by the perf cli command
+static uint32_t __biz_rt_lat_metric(void *arg)
+{
+    AI_BIZ_SEND_STAT_T stat[AI_MONITOR_BIZ_STAT_MAX];
+    uint32_t num = AI_MONITOR_BIZ_STAT_MAX, lat = 0;
+
+    if (OPRT_OK != tuya_ai_biz_get_send_stat(stat, &num)) {
+        return 0;
+    }
+    for (uint32_t i = 0; i < num; i++) {
+        if (stat[i].cls == AI_BIZ_SEND_RT && stat[i].lat_last_ms > lat) {
+            lat = stat[i].lat_last_ms;
+        }
+    }
+    return lat;
+}
+
 /**
  * @brief initialize AI monitor TCP server
  */
@@ -933,6 +1314,21 @@ OPERATE_RET tuya_ai_monitor_init(const ai_monitor_config_t *config)
         return rt;
     }
 
+    // Create sender, clients are written from its thread only
+    rt = __tx_start();
+    if (rt != OPRT_OK) {
+        PR_ERR("create sender failed: %d", rt);
+        __tx_stop();
+        tal_sw_timer_delete(g_ai_monitor_server.timer);
+        g_ai_monitor_server.timer = NULL;
+        OS_FREE(g_ai_monitor_server.clients);
+        g_ai_monitor_server.clients = NULL;
+        tal_mutex_release(g_ai_monitor_server.mutex);
+        g_ai_monitor_server.mutex = NULL;
+        return rt;
+    }
+    memset(g_ai_monitor_server.sample_every, 1, sizeof(g_ai_monitor_server.sample_every));
+
     g_ai_monitor_server.initialized = TRUE;
     g_ai_monitor_server.running = FALSE;
     g_ai_monitor_server.server_fd = -1;
@@ -943,6 +1339,9 @@ OPERATE_RET tuya_ai_monitor_init(const ai_monitor_config_t *config)
     PR_INFO("AI monitor initialized, port=%d, max_clients=%d, inital sid=%u", config->port, config->max_clients,
             g_ai_monitor_server.session_id);
 
+    tal_cli_perf_metric_register("ai_monitor_tx", __tx_queued_metric, NULL);
+    tal_cli_perf_metric_register("ai_biz_rt_lat", __biz_rt_lat_metric, NULL);
+
     return __ai_monitor_start();
 }
 
@@ -1000,6 +1399,8 @@ OPERATE_RET tuya_ai_monitor_deinit(void)
         return OPRT_INVALID_PARM;
     }
 
+    tal_cli_perf_metric_unregister("ai_monitor_tx");
+
     // Stop server first
     if (g_ai_monitor_server.running) {
         __ai_monitor_stop();
@@ -1016,6 +1417,8 @@ OPERATE_RET tuya_ai_monitor_deinit(void)
         g_ai_monitor_server.mutex = NULL;
     }
 
+    __tx_stop();
+
     memset(&g_ai_monitor_server, 0, sizeof(g_ai_monitor_server));
 
     PR_INFO("AI monitor deinitialized");
@@ -1043,17 +1446,6 @@ OPERATE_RET tuya_ai_monitor_broadcast(uint16_t id, AI_BIZ_ATTR_INFO_T *attr, AI_
     return __ai_biz_handler(AI_MONITOR_DIR_ACK, id, attr, head, data, &g_ai_monitor_server);
 }
 
-#define TY_AI_MONITOR_US_AUDIO 1
-#define TY_AI_MONITOR_US_VIDEO 3
-#define TY_AI_MONITOR_US_TEXT  5
-#define TY_AI_MONITOR_US_IMAGE 7
-#define TY_AI_MONITOR_DS_AUDIO 2
-#define TY_AI_MONITOR_DS_TEXT  4
-#define TY_AI_MONITOR_US_LOG   0x8001
-#define TY_AI_MONITOR_US_MIC   0x8003
-#define TY_AI_MONITOR_US_REF   0x8005
-#define TY_AI_MONITOR_US_AEC   0x8007
-
 /**
  * @brief broadcast text data to all connected clients
  */
@@ -1160,6 +1552,109 @@ OPERATE_RET tuya_ai_monitor_broadcast_audio_aec(AI_STREAM_TYPE stype, char *data
     return tuya_ai_monitor_broadcast_audio(TY_AI_MONITOR_US_AEC, stype, AUDIO_CODEC_PCM, data, len);
 }
 
+/**
+ * @brief record a trace event for clients subscribed to AI_PT_CUSTOM_TRACE
+ */
+OPERATE_RET tuya_ai_monitor_trace(uint16_t event, const char *session_id, uint16_t data_id, uint32_t len)
+{
+    if (!g_ai_monitor_server.initialized || !g_ai_monitor_server.running) {
+        return OPRT_INVALID_PARM;
+    }
+
+    uint64_t ts_ms = tal_time_get_posix_ms();
+
+    tal_mutex_lock(g_ai_monitor_server.tx_mutex);
+    if (session_id && session_id[0]) {
+        g_ai_monitor_server.trace_session = __trace_session_hash(session_id);
+    }
+    if (g_ai_monitor_server.trace_num == 0) {
+        g_ai_monitor_server.trace_first_ms = tal_system_get_millisecond();
+    }
+    uint8_t *p = g_ai_monitor_server.trace_buf + g_ai_monitor_server.trace_num * AI_MONITOR_TRACE_REC_LEN;
+    p = __put_be(p, ts_ms, 8);
+    p = __put_be(p, g_ai_monitor_server.trace_session, 4);
+    p = __put_be(p, event, 2);
+    p = __put_be(p, data_id, 2);
+    __put_be(p, len, 4);
+    if (++g_ai_monitor_server.trace_num == AI_MONITOR_TRACE_BATCH) {
+        __trace_flush(&g_ai_monitor_server);
+    } else if (g_ai_monitor_server.trace_num == 1) {
+        // let the sender pick up the batch deadline
+        tal_semaphore_post(g_ai_monitor_server.tx_sem);
+    }
+    tal_mutex_unlock(g_ai_monitor_server.tx_mutex);
+    return OPRT_OK;
+}
+
+#if defined(ENABLE_TAL_TRACE) && (ENABLE_TAL_TRACE == 1)
+typedef struct {
+    char *buf;
+    uint32_t len;
+} ai_monitor_trace_dump_t;
+
+static void __trace_dump_output(const char *str, uint32_t len, void *arg)
+{
+    ai_monitor_trace_dump_t *dump = (ai_monitor_trace_dump_t *)arg;
+
+    while (len > 0) {
+        uint32_t n = AI_MONITOR_TRACE_DUMP_LEN - dump->len;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(dump->buf + dump->len, str, n);
+        dump->len += n;
+        str += n;
+        len -= n;
+        if (dump->len == AI_MONITOR_TRACE_DUMP_LEN) {
+            __broadcast_text(TY_AI_MONITOR_US_TRACE, dump->buf, dump->len);
+            dump->len = 0;
+        }
+    }
+}
+
+/**
+ * @brief send the tal_trace events to all connected clients
+ */
+OPERATE_RET tuya_ai_monitor_trace_dump(void)
+{
+    ai_monitor_trace_dump_t dump = {0};
+
+    if (!g_ai_monitor_server.initialized || !g_ai_monitor_server.running) {
+        return OPRT_INVALID_PARM;
+    }
+
+    dump.buf = OS_MALLOC(AI_MONITOR_TRACE_DUMP_LEN);
+    if (!dump.buf) {
+        PR_ERR("malloc trace dump buffer failed");
+        return OPRT_MALLOC_FAILED;
+    }
+
+    tal_trace_dump(__trace_dump_output, &dump);
+    if (dump.len > 0) {
+        __broadcast_text(TY_AI_MONITOR_US_TRACE, dump.buf, dump.len);
+    }
+
+    OS_FREE(dump.buf);
+    return OPRT_OK;
+}
+#endif
+
+/**
+ * @brief set the sampling rate of a monitor stream
+ */
+OPERATE_RET tuya_ai_monitor_set_sample_rate(ai_monitor_stream_e stream, uint8_t every)
+{
+    if (!g_ai_monitor_server.initialized || stream >= AI_MONITOR_STREAM_MAX) {
+        return OPRT_INVALID_PARM;
+    }
+
+    tal_mutex_lock(g_ai_monitor_server.tx_mutex);
+    g_ai_monitor_server.sample_every[stream] = every;
+    g_ai_monitor_server.sample_count[stream] = 0;
+    tal_mutex_unlock(g_ai_monitor_server.tx_mutex);
+    return OPRT_OK;
+}
+
 /**
  * @brief dump server status information
  */
@@ -1180,8 +1675,20 @@ void tuya_ai_monitor_dump_status(void)
 
     for (uint32_t i = 0; i < g_ai_monitor_server.config.max_clients; i++) {
         if (g_ai_monitor_server.clients[i].connected) {
-            PR_INFO("Client[%d]: fd=%d, addr=%s, last_ping=%llu", i, g_ai_monitor_server.clients[i].fd,
-                    g_ai_monitor_server.clients[i].addr, g_ai_monitor_server.clients[i].last_ping_time);
+            PR_INFO("Client[%d]: fd=%d, addr=%s, last_ping=%llu, queued=%u/%u, dropped=%u", i,
+                    g_ai_monitor_server.clients[i].fd, g_ai_monitor_server.clients[i].addr,
+                    g_ai_monitor_server.clients[i].last_ping_time, g_ai_monitor_server.clients[i].tx_used,
+                    g_ai_monitor_server.clients[i].tx_size, g_ai_monitor_server.clients[i].tx_dropped);
+        }
+    }
+
+    AI_BIZ_SEND_STAT_T stat[AI_MONITOR_BIZ_STAT_MAX];
+    uint32_t num = AI_MONITOR_BIZ_STAT_MAX;
+    if (OPRT_OK == tuya_ai_biz_get_send_stat(stat, &num)) {
+        for (uint32_t i = 0; i < num; i++) {
+            PR_INFO("Send[%u]: %s, pkts=%u, bytes=%llu, lat last/avg/max=%u/%u/%u ms", stat[i].id,
+                    stat[i].cls == AI_BIZ_SEND_RT ? "rt" : "bulk", stat[i].pkts, stat[i].bytes, stat[i].lat_last_ms,
+                    stat[i].lat_avg_ms, stat[i].lat_max_ms);
         }
     }
     PR_INFO("========================");
@@ -1205,6 +1712,8 @@ static OPERATE_RET __default_update(AI_STAGE_E stage, void *data, AI_SEND_PACKET
         ai_monitor_header_t header = {0};
         header.magic = UNI_HTONL(AI_MONITOR_MAGIC);
         header.direction = cfg->direction;
+        // every packet, fragments included, is its own ring record
+        __tx_ring_begin(cfg->client);
         return cfg->writer->write(info->writer, &header, 5);
     } else {
         return OPRT_OK;
@@ -1214,32 +1723,12 @@ static OPERATE_RET __default_update(AI_STAGE_E stage, void *data, AI_SEND_PACKET
 static OPERATE_RET __default_write(AI_PACKET_WRITER_T *writer, void *buf, uint32_t buf_len)
 {
     ai_monitor_writer_cfg_t *cfg = (ai_monitor_writer_cfg_t *)writer->user_data;
-    if (cfg->fd < 0 || !buf || buf_len == 0) {
+    if (!cfg->client || !buf || buf_len == 0) {
         return OPRT_INVALID_PARM;
     }
 
-    OPERATE_RET rt = OPRT_OK;
-    uint32_t total_sent = 0;
-    uint32_t remaining = buf_len;
-
-    while (remaining > 0) {
-        rt = tal_net_send(cfg->fd, (char *)buf + total_sent, remaining);
-        if (rt <= 0) {
-            TUYA_ERRNO err = tal_net_get_errno();
-            // FIXME: some platforms may return different error codes
-            if (err == UNW_EAGAIN || err == UNW_EWOULDBLOCK || err == 11) {
-                // Non-blocking mode, retry
-                tal_system_sleep(50); // Sleep for a short time before retrying
-                continue;
-            }
-            PR_ERR("send data failed, rt=%d, errno=%d", rt, err);
-            return OPRT_COM_ERROR;
-        }
-        total_sent += rt;
-        remaining -= rt;
-    }
-
-    return OPRT_OK;
+    // only queued here, the sender thread does the socket writes
+    return __tx_ring_append(cfg->client, buf, buf_len);
 }
 
 #if 0
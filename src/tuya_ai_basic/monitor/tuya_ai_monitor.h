@@ -18,7 +18,8 @@
 extern "C" {
 #endif
 
-#define AI_PT_CUSTOM_LOG 60 // Custom pt type for log messages
+#define AI_PT_CUSTOM_LOG   60 // Custom pt type for log messages
+#define AI_PT_CUSTOM_TRACE 61 // Custom pt type for trace records
 
 #define AI_EVENT_MONITOR_FILTER   0xF000 // Filter for AI event monitor type filtering
 #define AI_EVENT_MONITOR_ALG_CTRL 0xF001 // Filter for AI event monitor algorithm control
@@ -39,6 +40,43 @@ typedef enum {
     AI_MSG_TYPE_ERROR = 0xFF       // error message
 } ai_monitor_msg_type_e;
 
+/**
+ * @brief AI monitor trace events, see tuya_ai_monitor_trace()
+ */
+typedef enum {
+    AI_TRACE_WAKE = 1,          // wake word detected
+    AI_TRACE_UPLOAD_START,      // speech upload started
+    AI_TRACE_UPLOAD_END,        // speech upload ended (VAD end)
+    AI_TRACE_ASR_RESULT,        // final ASR text received
+    AI_TRACE_NLG_START,         // first NLG text received
+    AI_TRACE_TTS_FIRST,         // first TTS audio byte received
+    AI_TRACE_TTS_END,           // TTS audio stream ended
+    AI_TRACE_PLAYBACK_START,    // player prebuffer done, audio output started
+    AI_TRACE_PLAYBACK_END,      // player drained
+    AI_TRACE_USER_BASE = 0x8000 // application defined events start here
+} ai_monitor_trace_event_e;
+
+/**
+ * @brief AI monitor trace record, AI_PT_CUSTOM_TRACE packets carry an array of them
+ *
+ * Fields are big endian on the wire: ts_ms:8 session:4 event:2 data_id:2 len:4.
+ * session is the FNV-1a hash of the session id string.
+ */
+#define AI_MONITOR_TRACE_REC_LEN 20
+
+/**
+ * @brief AI monitor streams, each sampled independently
+ */
+typedef enum {
+    AI_MONITOR_STREAM_BIZ = 0, // biz packets exchanged with the cloud
+    AI_MONITOR_STREAM_MIC,     // raw mic audio
+    AI_MONITOR_STREAM_REF,     // reference audio
+    AI_MONITOR_STREAM_AEC,     // audio after AEC
+    AI_MONITOR_STREAM_TEXT,    // text
+    AI_MONITOR_STREAM_LOG,     // log lines
+    AI_MONITOR_STREAM_MAX
+} ai_monitor_stream_e;
+
 /**
  * @brief AI monitor server configuration
  */
@@ -46,7 +84,7 @@ typedef struct {
     uint32_t port;               // TCP server port
     uint32_t max_clients;        // maximum client connections
     uint32_t recv_buf_size;      // receive buffer size
-    uint32_t send_buf_size;      // send buffer size
+    uint32_t send_buf_size;      // per client send ring size, oldest frames are dropped when full
     uint32_t heartbeat_interval; // heartbeat interval in seconds
     uint32_t heartbeat_timeout;  // heartbeat timeout in seconds
     uint8_t enable_broadcast;    // enable broadcast to all clients
@@ -59,7 +97,7 @@ typedef struct {
         .port = AI_MONITOR_PORT_DEFAULT,                                                                               \
         .max_clients = AI_MONITOR_MAX_CLIENTS_DEFAULT,                                                                 \
         .recv_buf_size = 1024,                                                                                         \
-        .send_buf_size = 1024,                                                                                         \
+        .send_buf_size = 8 * 1024,                                                                                     \
         .heartbeat_interval = 30,                                                                                      \
         .heartbeat_timeout = 60,                                                                                       \
         .enable_broadcast = TRUE,                                                                                      \
@@ -140,6 +178,45 @@ OPERATE_RET tuya_ai_monitor_broadcast_audio_ref(AI_STREAM_TYPE stype, char *data
 
 OPERATE_RET tuya_ai_monitor_broadcast_audio_aec(AI_STREAM_TYPE stype, char *data, uint32_t len);
 
+/**
+ * @brief record a trace event for clients subscribed to AI_PT_CUSTOM_TRACE
+ *
+ * Records are batched and queued like other monitor frames, the call never
+ * blocks on the network.
+ *
+ * @param[in] event ai_monitor_trace_event_e or an application event
+ * @param[in] session_id session id, NULL to reuse the last one given
+ * @param[in] data_id biz data id, 0 if none
+ * @param[in] len byte count or any event value
+ *
+ * @return OPRT_OK on success. Others on error, please refer to tuya_error_code.h
+ */
+OPERATE_RET tuya_ai_monitor_trace(uint16_t event, const char *session_id, uint16_t data_id, uint32_t len);
+
+/**
+ * @brief send the tal_trace events to all connected clients
+ *
+ * The Perfetto JSON of tal_trace_dump() goes out as text frames with data id
+ * 0x8009, concatenated they form one trace file. Needs ENABLE_TAL_TRACE.
+ *
+ * @return OPRT_OK on success. Others on error, please refer to tuya_error_code.h
+ */
+OPERATE_RET tuya_ai_monitor_trace_dump(void);
+
+/**
+ * @brief set the sampling rate of a monitor stream
+ *
+ * Broadcasting only queues frames for the monitor sender thread, so a slow
+ * client never blocks the caller. Sampling additionally thins out busy
+ * streams. Audio stream start and end frames are always sent.
+ *
+ * @param[in] stream monitor stream
+ * @param[in] every forward one frame out of every, 1 forwards all, 0 disables the stream
+ *
+ * @return OPRT_OK on success. Others on error, please refer to tuya_error_code.h
+ */
+OPERATE_RET tuya_ai_monitor_set_sample_rate(ai_monitor_stream_e stream, uint8_t every);
+
 /**
  * @brief dump server status information
  *
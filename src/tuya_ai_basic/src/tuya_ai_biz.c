@@ -40,12 +40,30 @@
 #ifndef AI_BIZ_TASK_DELAY
 #define AI_BIZ_TASK_DELAY 10
 #endif
+/* channels are also polled this often, for producers that never call tuya_ai_biz_send_ready */
+#ifndef AI_BIZ_IDLE_SCAN_MS
+#define AI_BIZ_IDLE_SCAN_MS 200
+#endif
+/* packets taken from one ready real-time channel before the others get a turn */
+#ifndef AI_BIZ_SEND_BURST
+#define AI_BIZ_SEND_BURST 8
+#endif
+/* payload bytes a bulk channel (video, image, file) sends per turn */
+#ifndef AI_BIZ_BULK_QUANTUM
+#define AI_BIZ_BULK_QUANTUM 4096
+#endif
+#define AI_BIZ_READY_MAX (AI_MAX_SESSION_ID_NUM * AI_SESSION_MAX_NUM)
 
 typedef struct {
     char id[AI_UUID_V4_LEN];
     AI_SESSION_CFG_T cfg;
 } AI_SESSION_T;
 
+typedef struct {
+    int32_t deficit; // bulk bytes left in this turn, negative after a packet larger than the quantum
+    AI_BIZ_SEND_STAT_T stat; // stat.id 0 for a free slot
+} AI_BIZ_CHAN_T;
+
 typedef struct {
     AI_BIZ_MONITOR_CB recv_cb;
     AI_BIZ_MONITOR_CB send_cb;
@@ -59,6 +77,12 @@ typedef struct {
     AI_SESSION_T session[AI_SESSION_MAX_NUM];
     AI_BIZ_RECV_CB cb;
     AI_BASIC_BIZ_MONITOR_T *monitor;
+    MUTEX_HANDLE ready_mutex;
+    SEM_HANDLE ready_sem;
+    uint16_t ready_ids[AI_BIZ_READY_MAX];
+    SYS_TIME_T ready_ms[AI_BIZ_READY_MAX];
+    uint32_t ready_num;
+    AI_BIZ_CHAN_T chan[AI_BIZ_READY_MAX];
 } AI_BASIC_BIZ_T;
 
 AI_BASIC_BIZ_MONITOR_T ai_monitor;
@@ -242,58 +266,243 @@ OPERATE_RET tuya_ai_send_biz_pkt_custom(uint16_t id, AI_BIZ_ATTR_INFO_T *attr, A
     return rt;
 }
 
+static AI_BIZ_SEND_CLASS_E __ai_biz_send_class(AI_PACKET_PT type)
+{
+    if ((type == AI_PT_VIDEO) || (type == AI_PT_IMAGE) || (type == AI_PT_FILE)) {
+        return AI_BIZ_SEND_BULK;
+    }
+    return AI_BIZ_SEND_RT;
+}
+
+/* adds id to the ready list, ready_mutex must be held; returns true if the list was empty */
+static uint8_t __ai_biz_mark_ready(uint16_t id)
+{
+    uint32_t idx = 0;
+    for (idx = 0; idx < ai_basic_biz->ready_num; idx++) {
+        if (ai_basic_biz->ready_ids[idx] == id) {
+            return false;
+        }
+    }
+    if (ai_basic_biz->ready_num >= AI_BIZ_READY_MAX) {
+        return false;
+    }
+    ai_basic_biz->ready_ms[ai_basic_biz->ready_num] = tal_system_get_millisecond();
+    ai_basic_biz->ready_ids[ai_basic_biz->ready_num++] = id;
+    return (ai_basic_biz->ready_num == 1);
+}
+
+/* polled fallback: every channel with a get cb counts as ready */
+static void __ai_biz_mark_all_ready(void)
+{
+    uint32_t idx = 0, sidx = 0;
+    tal_mutex_lock(ai_basic_biz->ready_mutex);
+    for (idx = 0; idx < AI_SESSION_MAX_NUM; idx++) {
+        if (ai_basic_biz->session[idx].id[0] != 0) {
+            AI_SESSION_T *session = &ai_basic_biz->session[idx];
+            for (sidx = 0; sidx < session->cfg.send_num; sidx++) {
+                if (session->cfg.send[sidx].get_cb) {
+                    __ai_biz_mark_ready(session->cfg.send[sidx].id);
+                }
+            }
+        }
+    }
+    tal_mutex_unlock(ai_basic_biz->ready_mutex);
+}
+
+static AI_BIZ_SEND_DATA_T *__ai_biz_find_send(uint16_t id)
+{
+    uint32_t idx = 0, sidx = 0;
+    for (idx = 0; idx < AI_SESSION_MAX_NUM; idx++) {
+        if (ai_basic_biz->session[idx].id[0] != 0) {
+            AI_SESSION_T *session = &ai_basic_biz->session[idx];
+            for (sidx = 0; sidx < session->cfg.send_num; sidx++) {
+                if ((session->cfg.send[sidx].id == id) && session->cfg.send[sidx].get_cb) {
+                    return &session->cfg.send[sidx];
+                }
+            }
+        }
+    }
+    return NULL;
+}
+
+/* moves channels out of the ready list, with rt_only just the real-time ones; returns the count */
+static uint32_t __ai_biz_take_ready(uint8_t rt_only, uint16_t *ids, SYS_TIME_T *ms)
+{
+    uint32_t idx = 0, num = 0, keep = 0;
+    tal_mutex_lock(ai_basic_biz->ready_mutex);
+    for (idx = 0; idx < ai_basic_biz->ready_num; idx++) {
+        if (rt_only) {
+            AI_BIZ_SEND_DATA_T *send = __ai_biz_find_send(ai_basic_biz->ready_ids[idx]);
+            if (send && (__ai_biz_send_class(send->type) != AI_BIZ_SEND_RT)) {
+                ai_basic_biz->ready_ids[keep] = ai_basic_biz->ready_ids[idx];
+                ai_basic_biz->ready_ms[keep++] = ai_basic_biz->ready_ms[idx];
+                continue;
+            }
+        }
+        ids[num] = ai_basic_biz->ready_ids[idx];
+        ms[num++] = ai_basic_biz->ready_ms[idx];
+    }
+    ai_basic_biz->ready_num = keep;
+    tal_mutex_unlock(ai_basic_biz->ready_mutex);
+    return num;
+}
+
+/* stats slot of a channel, the slot of a channel that is gone is reused; ready_mutex must be held */
+static AI_BIZ_CHAN_T *__ai_biz_chan_get(AI_BIZ_SEND_DATA_T *send)
+{
+    uint32_t idx = 0;
+    AI_BIZ_CHAN_T *spare = NULL;
+    for (idx = 0; idx < AI_BIZ_READY_MAX; idx++) {
+        AI_BIZ_CHAN_T *chan = &ai_basic_biz->chan[idx];
+        if (chan->stat.id == send->id) {
+            return chan;
+        }
+        if ((spare == NULL) && ((chan->stat.id == 0) || (__ai_biz_find_send(chan->stat.id) == NULL))) {
+            spare = chan;
+        }
+    }
+    if (spare) {
+        memset(spare, 0, sizeof(AI_BIZ_CHAN_T));
+        spare->stat.id = send->id;
+        spare->stat.cls = __ai_biz_send_class(send->type);
+    }
+    return spare;
+}
+
+/* sends one packet of the channel, returns its payload length or -1 if the channel had none */
+static int32_t __ai_biz_send_one(AI_BIZ_SEND_DATA_T *send, AI_BIZ_CHAN_T *chan, SYS_TIME_T *ready_ms)
+{
+    AI_BIZ_ATTR_INFO_T attr = {0};
+    AI_BIZ_HEAD_INFO_T head = {0};
+    char *payload = NULL;
+    uint32_t lat = 0;
+    if (send->get_cb(&attr, &head, &payload) != OPRT_OK) {
+        return -1;
+    }
+    tuya_ai_send_biz_pkt(send->id, &attr, send->type, &head, payload);
+    if (send->free_cb) {
+        send->free_cb(payload);
+    }
+
+    tal_mutex_lock(ai_basic_biz->ready_mutex);
+    chan->stat.pkts++;
+    chan->stat.bytes += head.len;
+    if (*ready_ms) {
+        lat = (uint32_t)(tal_system_get_millisecond() - *ready_ms);
+        chan->stat.lat_last_ms = lat;
+        chan->stat.lat_max_ms = (lat > chan->stat.lat_max_ms) ? lat : chan->stat.lat_max_ms;
+        chan->stat.lat_avg_ms = chan->stat.lat_avg_ms ? (chan->stat.lat_avg_ms * 7 + lat) / 8 : lat;
+        *ready_ms = 0;
+    }
+    tal_mutex_unlock(ai_basic_biz->ready_mutex);
+
+    return (int32_t)head.len;
+}
+
+static void __ai_biz_service_list(uint16_t *ids, SYS_TIME_T *ms, uint32_t num, AI_BIZ_SEND_CLASS_E cls);
+
+/* real-time channels that became ready meanwhile, sent before the next bulk packet */
+static void __ai_biz_service_rt_ready(void)
+{
+    uint16_t ids[AI_BIZ_READY_MAX];
+    SYS_TIME_T ms[AI_BIZ_READY_MAX];
+    uint32_t num = __ai_biz_take_ready(true, ids, ms);
+    if (num) {
+        __ai_biz_service_list(ids, ms, num, AI_BIZ_SEND_RT);
+    }
+}
+
+/* sends what the channel has, returns true if it still had data after its turn */
+static uint8_t __ai_biz_service_send(AI_BIZ_SEND_DATA_T *send, AI_BIZ_CHAN_T *chan, SYS_TIME_T ready_ms)
+{
+    uint32_t cnt = 0;
+    int32_t len = 0;
+    if (chan->stat.cls == AI_BIZ_SEND_RT) {
+        for (cnt = 0; cnt < AI_BIZ_SEND_BURST; cnt++) {
+            if (__ai_biz_send_one(send, chan, &ready_ms) < 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // deficit round robin, a packet larger than the quantum is paid back in the next turns
+    chan->deficit += AI_BIZ_BULK_QUANTUM;
+    while (chan->deficit > 0) {
+        len = __ai_biz_send_one(send, chan, &ready_ms);
+        if (len < 0) {
+            chan->deficit = 0;
+            return false;
+        }
+        chan->deficit -= len;
+        __ai_biz_service_rt_ready();
+    }
+    return true;
+}
+
+static void __ai_biz_service_list(uint16_t *ids, SYS_TIME_T *ms, uint32_t num, AI_BIZ_SEND_CLASS_E cls)
+{
+    uint32_t idx = 0;
+    for (idx = 0; idx < num; idx++) {
+        AI_BIZ_SEND_DATA_T *send = __ai_biz_find_send(ids[idx]);
+        AI_BIZ_CHAN_T *chan = NULL;
+        if ((send == NULL) || (__ai_biz_send_class(send->type) != cls)) {
+            continue;
+        }
+        tal_mutex_lock(ai_basic_biz->ready_mutex);
+        chan = __ai_biz_chan_get(send);
+        tal_mutex_unlock(ai_basic_biz->ready_mutex);
+        if (chan && __ai_biz_service_send(send, chan, ms[idx])) {
+            tuya_ai_biz_send_ready(ids[idx]);
+        }
+    }
+}
+
 static void __ai_biz_thread_cb(void *args)
 {
     OPERATE_RET rt = OPRT_OK;
-    uint32_t idx = 0, sidx = 0, kdx = 0;
+    uint16_t ready_ids[AI_BIZ_READY_MAX];
+    SYS_TIME_T ready_ms[AI_BIZ_READY_MAX];
+    uint32_t ready_num = 0;
     while (!ai_basic_biz->terminate && tal_thread_get_state(ai_basic_biz->thread) == THREAD_STATE_RUNNING) {
         if (!tuya_ai_client_is_ready()) {
             tal_system_sleep(200);
             continue;
         }
+        rt = tal_semaphore_wait(ai_basic_biz->ready_sem, AI_BIZ_IDLE_SCAN_MS);
+        if (ai_basic_biz->terminate) {
+            break;
+        }
         tal_mutex_lock(ai_basic_biz->mutex);
-        uint16_t sent_ids[AI_MAX_SESSION_ID_NUM * AI_SESSION_MAX_NUM] = {0};
-        uint32_t sent_ids_count = 0;
-        for (idx = 0; idx < AI_SESSION_MAX_NUM; idx++) {
-            if (ai_basic_biz->session[idx].id[0] != 0) {
-                AI_SESSION_T *session = &ai_basic_biz->session[idx];
-                for (sidx = 0; sidx < session->cfg.send_num; sidx++) {
-                    uint16_t send_id = session->cfg.send[sidx].id;
-                    uint8_t already_sent = false;
-                    for (kdx = 0; kdx < sent_ids_count; kdx++) {
-                        if (sent_ids[kdx] == send_id) {
-                            already_sent = true;
-                            break;
-                        }
-                    }
-                    if (!already_sent) {
-                        sent_ids[sent_ids_count++] = send_id;
-                        AI_BIZ_SEND_DATA_T *send = &session->cfg.send[sidx];
-                        if (send->get_cb) {
-                            AI_BIZ_ATTR_INFO_T attr = {0};
-                            AI_BIZ_HEAD_INFO_T head = {0};
-                            char *payload = NULL;
-                            rt = send->get_cb(&attr, &head, &payload);
-                            if (rt != OPRT_OK) {
-                                continue;
-                            }
-                            tuya_ai_send_biz_pkt(send->id, &attr, send->type, &head, payload);
-                            if (send->free_cb) {
-                                send->free_cb(payload);
-                            }
-                        }
-                    }
-                }
-            }
+        if (OPRT_OK != rt) {
+            __ai_biz_mark_all_ready();
         }
+
+        ready_num = __ai_biz_take_ready(false, ready_ids, ready_ms);
+        __ai_biz_service_list(ready_ids, ready_ms, ready_num, AI_BIZ_SEND_RT);
+        __ai_biz_service_list(ready_ids, ready_ms, ready_num, AI_BIZ_SEND_BULK);
         tal_mutex_unlock(ai_basic_biz->mutex);
-        tal_system_sleep(AI_BIZ_TASK_DELAY);
     }
 
     PR_NOTICE("ai biz thread exit");
     return;
 }
 
+OPERATE_RET tuya_ai_biz_send_ready(uint16_t id)
+{
+    uint8_t wake = false;
+    if ((ai_basic_biz == NULL) || (ai_basic_biz->ready_sem == NULL)) {
+        return OPRT_RESOURCE_NOT_READY;
+    }
+    tal_mutex_lock(ai_basic_biz->ready_mutex);
+    wake = __ai_biz_mark_ready(id);
+    tal_mutex_unlock(ai_basic_biz->ready_mutex);
+    if (wake) {
+        tal_semaphore_post(ai_basic_biz->ready_sem);
+    }
+    return OPRT_OK;
+}
+
 static uint8_t __ai_biz_need_send_task(void)
 {
     uint32_t idx = 0, sidx = 0;
@@ -343,6 +552,14 @@ static void __ai_biz_deinit(void)
             tal_mutex_release(ai_basic_biz->mutex);
             ai_basic_biz->mutex = NULL;
         }
+        if (ai_basic_biz->ready_mutex) {
+            tal_mutex_release(ai_basic_biz->ready_mutex);
+            ai_basic_biz->ready_mutex = NULL;
+        }
+        if (ai_basic_biz->ready_sem) {
+            tal_semaphore_release(ai_basic_biz->ready_sem);
+            ai_basic_biz->ready_sem = NULL;
+        }
         OS_FREE(ai_basic_biz);
         ai_basic_biz = NULL;
     }
@@ -910,6 +1127,8 @@ static OPERATE_RET __ai_clt_run_evt(void *data)
         memset(ai_basic_biz, 0, sizeof(AI_BASIC_BIZ_T));
         ai_basic_biz->monitor = &ai_monitor;
         TUYA_CALL_ERR_GOTO(tal_mutex_create_init(&ai_basic_biz->mutex), EXIT);
+        TUYA_CALL_ERR_GOTO(tal_mutex_create_init(&ai_basic_biz->ready_mutex), EXIT);
+        TUYA_CALL_ERR_GOTO(tal_semaphore_create_init(&ai_basic_biz->ready_sem, 0, 1), EXIT);
         tuya_ai_client_reg_cb(__ai_biz_recv_handle);
         PR_NOTICE("ai biz init success");
     }
@@ -934,13 +1153,9 @@ void tuya_ai_biz_deinit(void)
     if (ai_basic_biz) {
         if (ai_basic_biz->thread) {
             ai_basic_biz->terminate = TRUE;
+            tal_semaphore_post(ai_basic_biz->ready_sem);
         } else {
-            if (ai_basic_biz->mutex) {
-                tal_mutex_release(ai_basic_biz->mutex);
-                ai_basic_biz->mutex = NULL;
-            }
-            OS_FREE(ai_basic_biz);
-            ai_basic_biz = NULL;
+            __ai_biz_deinit();
         }
         tal_event_unsubscribe(EVENT_AI_CLIENT_RUN, "ai.biz", __ai_clt_run_evt);
         tal_event_unsubscribe(EVENT_AI_CLIENT_CLOSE, "ai.biz", __ai_clt_close_evt);
@@ -1053,6 +1268,27 @@ int tuya_ai_biz_get_recv_id(void)
     return id;
 }
 
+OPERATE_RET tuya_ai_biz_get_send_stat(AI_BIZ_SEND_STAT_T *stat, uint32_t *num)
+{
+    uint32_t idx = 0, cnt = 0;
+    if ((stat == NULL) || (num == NULL)) {
+        return OPRT_INVALID_PARM;
+    }
+    if ((ai_basic_biz == NULL) || (ai_basic_biz->ready_mutex == NULL)) {
+        *num = 0;
+        return OPRT_RESOURCE_NOT_READY;
+    }
+    tal_mutex_lock(ai_basic_biz->ready_mutex);
+    for (idx = 0; (idx < AI_BIZ_READY_MAX) && (cnt < *num); idx++) {
+        if (ai_basic_biz->chan[idx].stat.id != 0) {
+            stat[cnt++] = ai_basic_biz->chan[idx].stat;
+        }
+    }
+    tal_mutex_unlock(ai_basic_biz->ready_mutex);
+    *num = cnt;
+    return OPRT_OK;
+}
+
 AI_SESSION_CFG_T *tuya_ai_biz_get_session_cfg(AI_SESSION_ID id)
 {
     uint32_t idx = 0;
@@ -70,6 +70,8 @@ typedef struct {
     TIMER_ID alive_timeout_timer;
     uint8_t heartbeat_lost_cnt;
     AI_BASIC_DATA_HANDLE cb;
+    uint8_t resumed;       // current attempt reuses the cached atop info
+    uint8_t resume_failed; // that attempt failed, next setup asks atop again
 } AI_BASIC_CLIENT_T;
 
 static AI_BASIC_CLIENT_T *ai_basic_client = NULL;
@@ -131,6 +133,8 @@ static OPERATE_RET __ai_auth_resp(void)
         return rt;
     }
     ai_basic_client->heartbeat_lost_cnt = 0;
+    ai_basic_client->resumed = false;
+    ai_basic_client->resume_failed = false;
     tal_workq_start_delayed(ai_basic_client->alive_work, (ai_basic_client->heartbeat_interval * 1000), LOOP_ONCE);
     __ai_client_set_state(AI_STATE_RUNNING);
     tal_event_publish(EVENT_AI_CLIENT_RUN, NULL);
@@ -168,6 +172,9 @@ static void __ai_client_handle_err()
             ai_basic_client->reconn_cnt++;
         }
     } else if ((ai_basic_client->state == AI_STATE_CONNECT) || (ai_basic_client->state == AI_STATE_AUTH_RESP)) {
+        if (ai_basic_client->resumed) {
+            ai_basic_client->resume_failed = true;
+        }
         tal_system_sleep(1000);
         __ai_client_set_state(AI_STATE_SETUP);
     } else if (ai_basic_client->state == AI_STATE_RUNNING) {
@@ -302,9 +309,14 @@ static OPERATE_RET __ai_setup()
 {
     OPERATE_RET rt = OPRT_OK;
 
-    rt = tuya_ai_basic_atop_req();
-    if (OPRT_OK != rt) {
-        return rt;
+    // a reconnect keeps the atop info while it is valid, unless it already failed once
+    ai_basic_client->resumed = !ai_basic_client->resume_failed && (OPRT_OK == tuya_ai_basic_resume());
+    if (!ai_basic_client->resumed) {
+        ai_basic_client->resume_failed = false;
+        rt = tuya_ai_basic_atop_req();
+        if (OPRT_OK != rt) {
+            return rt;
+        }
     }
 
     __ai_start_expire_tid();
@@ -38,4 +38,9 @@
 #define OS_REALLOC(ptr, size) tal_realloc(ptr, size)
 #endif
 
+/* blocks in the attribute pool of tuya_ai_create_attribute(), 0 disables it */
+#ifndef AI_ATTR_POOL_NUM
+#define AI_ATTR_POOL_NUM 16
+#endif
+
 #endif
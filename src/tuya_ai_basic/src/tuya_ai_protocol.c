@@ -28,6 +28,7 @@
 #include "tuya_transporter.h"
 #include "mbedtls/hkdf.h"
 #include "mbedtls/chacha20.h"
+#include "mbedtls/gcm.h"
 #include "mix_method.h"
 #include "tuya_iot.h"
 #include "cJSON.h"
@@ -38,6 +39,7 @@
 #include "cipher_wrapper.h"
 #include "tal_security.h"
 #include "tal_memory.h"
+#include "tal_mempool.h"
 #include "tuya_ai_protocol.h"
 #include "tuya_ai_private.h"
 
@@ -45,6 +47,9 @@
 #define AI_ATOP_THING_CONFIG_INFO "thing.aigc.basic.server.config.info"
 #define AI_ADD_PKT_LEN            128
 #define AI_DEFAULT_BIZ_TAG        0
+#define AI_SEQUENCE_WINDOW        64
+#define AI_AUDIO_ATTR_NUM         6  // codec, rate, channels, depth, user data, session id list
+#define AI_RESUME_MIN_LEFT_S      60 // atop config must stay valid this long to be reused
 
 #ifndef AI_READ_SOCKET_BUF_SIZE
 #define AI_READ_SOCKET_BUF_SIZE 0
@@ -64,6 +69,7 @@
 typedef struct {
     AI_FRAG_FLAG frag_flag;
     uint32_t offset;
+    uint32_t size; // of data
     char *data;
 } AI_RECV_FRAG_MNG_T;
 
@@ -78,6 +84,7 @@ typedef struct {
     char crypt_key[AI_KEY_LEN + 1];
     char sign_key[AI_KEY_LEN + 1];
     uint16_t sequence_in;
+    uint64_t sequence_mask; // bit n set: sequence_in - n already received
     uint16_t sequence_out;
     char crypt_random[AI_RANDOM_LEN + 1];
     char sign_random[AI_RANDOM_LEN + 1];
@@ -90,9 +97,21 @@ typedef struct {
     AI_SEND_FRAG_MNG_T send_frag_mng[2]; // 0:image,1:file
     bool frag_flag;
     char recv_buf[AI_MAX_FRAGMENT_LENGTH + AI_ADD_PKT_LEN];
+    char send_buf[AI_MAX_FRAGMENT_LENGTH]; // packets are built and encrypted in place, under mutex
+#if (AI_PACKET_SECURITY_LEVEL == AI_PACKET_SL4)
+    // expanded crypt_key, set up on first use; send and recv run on different threads so each has its own
+    mbedtls_gcm_context gcm_enc;
+    mbedtls_gcm_context gcm_dec;
+    bool gcm_ready;
+#endif
+#if defined(ENABLE_AI_PROTO_BENCH) && (ENABLE_AI_PROTO_BENCH == 1)
+    bool bench_resign; // pkt_read signs received packets itself, see tuya_ai_basic_pkt_read_attach()
+#endif
 } AI_BASIC_PROTO_T;
 
 static AI_BASIC_PROTO_T *ai_basic_proto = NULL;
+// created once and kept, attributes may outlive a proto deinit
+static MEMPOOL_HANDLE ai_attr_pool = NULL;
 
 static void __ai_atop_cfg_free(void)
 {
@@ -126,16 +145,62 @@ AI_ATOP_CFG_INFO_T *tuya_ai_basic_get_atop_cfg(void)
     return &(ai_basic_proto->config);
 }
 
+#if (AI_PACKET_SECURITY_LEVEL == AI_PACKET_SL4)
+static void __ai_gcm_free(void)
+{
+    if (ai_basic_proto->gcm_ready) {
+        mbedtls_gcm_free(&ai_basic_proto->gcm_enc);
+        mbedtls_gcm_free(&ai_basic_proto->gcm_dec);
+        ai_basic_proto->gcm_ready = false;
+    }
+}
+
+/* expands crypt_key once per key instead of once per packet */
+static OPERATE_RET __ai_gcm_setup(void)
+{
+    OPERATE_RET rt = OPRT_OK;
+    if (ai_basic_proto->gcm_ready) {
+        return OPRT_OK;
+    }
+    mbedtls_gcm_init(&ai_basic_proto->gcm_enc);
+    mbedtls_gcm_init(&ai_basic_proto->gcm_dec);
+    rt = mbedtls_gcm_setkey(&ai_basic_proto->gcm_enc, MBEDTLS_CIPHER_ID_AES,
+                            (const unsigned char *)ai_basic_proto->crypt_key, AI_KEY_LEN * 8);
+    if (OPRT_OK == rt) {
+        rt = mbedtls_gcm_setkey(&ai_basic_proto->gcm_dec, MBEDTLS_CIPHER_ID_AES,
+                                (const unsigned char *)ai_basic_proto->crypt_key, AI_KEY_LEN * 8);
+    }
+    if (OPRT_OK != rt) {
+        PR_ERR("gcm setkey failed, rt:%x", rt);
+        mbedtls_gcm_free(&ai_basic_proto->gcm_enc);
+        mbedtls_gcm_free(&ai_basic_proto->gcm_dec);
+        return rt;
+    }
+    ai_basic_proto->gcm_ready = true;
+    return OPRT_OK;
+}
+#endif
+
+/* keys derive from the local key, empty before tuya_iot_init() as in the bench and fuzz harnesses */
+static char *__ai_local_key(void)
+{
+    tuya_iot_client_t *client = tuya_iot_client_get();
+    return client ? client->activate.localkey : "";
+}
+
 static OPERATE_RET __ai_generate_crypt_key()
 {
     OPERATE_RET rt = OPRT_OK;
 
+#if (AI_PACKET_SECURITY_LEVEL == AI_PACKET_SL4)
+    __ai_gcm_free();
+#endif
     uni_random_string(ai_basic_proto->crypt_random, AI_RANDOM_LEN);
 
     char *slat = ai_basic_proto->crypt_random;
     size_t salt_len = AI_RANDOM_LEN;
 
-    char *ikm = tuya_iot_client_get()->activate.localkey;
+    char *ikm = __ai_local_key();
     size_t ikm_len = strlen(ikm);
 
     char *info = NULL;
@@ -161,7 +226,7 @@ static OPERATE_RET __ai_generate_sign_key()
     char *slat = ai_basic_proto->sign_random;
     size_t salt_len = AI_RANDOM_LEN;
 
-    char *ikm = tuya_iot_client_get()->activate.localkey;
+    char *ikm = __ai_local_key();
     size_t ikm_len = strlen(ikm);
 
     char *info = NULL;
@@ -212,13 +277,16 @@ static void __ai_basic_proto_deinit(void)
             OS_FREE(ai_basic_proto->connection_id);
             ai_basic_proto->connection_id = NULL;
         }
+#if (AI_PACKET_SECURITY_LEVEL == AI_PACKET_SL4)
+        __ai_gcm_free();
+#endif
         OS_FREE(ai_basic_proto);
         ai_basic_proto = NULL;
     }
     return;
 }
 
-static void __ai_basic_proto_reinit(void)
+static void __ai_basic_proto_reinit(uint8_t keep_atop_cfg)
 {
     tal_mutex_lock(ai_basic_proto->mutex);
     if (ai_basic_proto->transporter) {
@@ -226,7 +294,9 @@ static void __ai_basic_proto_reinit(void)
         tuya_transporter_destroy(ai_basic_proto->transporter);
         ai_basic_proto->transporter = NULL;
     }
-    __ai_atop_cfg_free();
+    if (!keep_atop_cfg) {
+        __ai_atop_cfg_free();
+    }
     if (ai_basic_proto->connection_id) {
         OS_FREE(ai_basic_proto->connection_id);
         ai_basic_proto->connection_id = NULL;
@@ -235,23 +305,43 @@ static void __ai_basic_proto_reinit(void)
     __ai_generate_sign_key();
     ai_basic_proto->connected = FALSE;
     ai_basic_proto->sequence_in = 0;
+    ai_basic_proto->sequence_mask = 0;
     ai_basic_proto->sequence_out = 1;
     memset(ai_basic_proto->recv_buf, 0, sizeof(ai_basic_proto->recv_buf));
     memset(ai_basic_proto->encrypt_iv, 0, AI_IV_LEN);
     uni_random_string(ai_basic_proto->encrypt_iv, AI_IV_LEN);
     ai_basic_proto->sl = AI_PACKET_SECURITY_LEVEL;
     memset(ai_basic_proto->decrypt_iv, 0, AI_IV_LEN);
+    if (ai_basic_proto->recv_frag_mng.data) {
+        OS_FREE(ai_basic_proto->recv_frag_mng.data);
+    }
     memset(&ai_basic_proto->recv_frag_mng, 0, sizeof(ai_basic_proto->recv_frag_mng));
     tal_mutex_unlock(ai_basic_proto->mutex);
     PR_NOTICE("ai proto reinit success");
     return;
 }
 
+static void __ai_attr_pool_init(void)
+{
+#if AI_ATTR_POOL_NUM > 0
+    if (ai_attr_pool) {
+        return;
+    }
+#if defined(AI_HEAP_IN_PSRAM) && (AI_HEAP_IN_PSRAM == 1)
+#if defined(ENABLE_EXT_RAM) && (ENABLE_EXT_RAM == 1)
+    tal_mempool_create("ai_attr", sizeof(AI_ATTRIBUTE_T), AI_ATTR_POOL_NUM, MEMPOOL_RAM_PSRAM, &ai_attr_pool);
+#endif
+#else
+    tal_mempool_create("ai_attr", sizeof(AI_ATTRIBUTE_T), AI_ATTR_POOL_NUM, MEMPOOL_RAM_SRAM, &ai_attr_pool);
+#endif
+#endif
+}
+
 static OPERATE_RET __ai_basic_proto_init(void)
 {
     OPERATE_RET rt = OPRT_OK;
     if (ai_basic_proto) {
-        __ai_basic_proto_reinit();
+        __ai_basic_proto_reinit(false);
     } else {
         ai_basic_proto = OS_MALLOC(sizeof(AI_BASIC_PROTO_T));
         TUYA_CHECK_NULL_RETURN(ai_basic_proto, OPRT_MALLOC_FAILED);
@@ -262,6 +352,7 @@ static OPERATE_RET __ai_basic_proto_init(void)
         ai_basic_proto->sequence_out = 1;
         uni_random_string(ai_basic_proto->encrypt_iv, AI_IV_LEN);
         ai_basic_proto->sl = AI_PACKET_SECURITY_LEVEL;
+        __ai_attr_pool_init();
         PR_NOTICE("ai proto init success, sl:%d", ai_basic_proto->sl);
     }
     return rt;
@@ -272,6 +363,22 @@ EXIT:
     return OPRT_COM_ERROR;
 }
 
+OPERATE_RET tuya_ai_basic_resume(void)
+{
+    if ((NULL == ai_basic_proto) || (NULL == ai_basic_proto->config.hosts) || (0 == ai_basic_proto->config.host_num)) {
+        return OPRT_NOT_FOUND;
+    }
+    uint64_t current = tal_time_get_posix();
+    if (ai_basic_proto->config.expire <= current + AI_RESUME_MIN_LEFT_S) {
+        PR_NOTICE("ai atop config expires in %llds, request a new one",
+                  (long long)(ai_basic_proto->config.expire - current));
+        return OPRT_NOT_FOUND;
+    }
+    __ai_basic_proto_reinit(true);
+    PR_NOTICE("ai proto resumed, atop config valid for %llus", ai_basic_proto->config.expire - current);
+    return OPRT_OK;
+}
+
 OPERATE_RET tuya_ai_basic_atop_req(void)
 {
     OPERATE_RET rt = OPRT_OK;
@@ -438,14 +545,33 @@ static uint32_t __ai_get_payload_len(char *buf)
     return packet_len - AI_SIGN_LEN;
 }
 
-static OPERATE_RET __ai_packet_sign(char *buf, uint8_t *signature)
+/* copies len bytes at offset of the segments joined together */
+static void __ai_iov_copy(const tuya_transporter_iov_t *iov, int iov_cnt, uint32_t offset, uint8_t *dst, uint32_t len)
+{
+    int i = 0;
+    for (i = 0; (i < iov_cnt) && (len > 0); i++) {
+        if (offset >= (uint32_t)iov[i].len) {
+            offset -= iov[i].len;
+            continue;
+        }
+        uint32_t copy_len = iov[i].len - offset;
+        copy_len = (copy_len > len) ? len : copy_len;
+        memcpy(dst, iov[i].buf + offset, copy_len);
+        dst += copy_len;
+        len -= copy_len;
+        offset = 0;
+    }
+}
+
+/* signs a packet laid out across segments, the first one holds the whole packet head */
+static OPERATE_RET __ai_packet_sign_iov(const tuya_transporter_iov_t *iov, int iov_cnt, uint8_t *signature)
 {
     OPERATE_RET rt = OPRT_OK;
     char *sign_key = __ai_get_sign_key();
     TUYA_CHECK_NULL_RETURN(sign_key, OPRT_COM_ERROR);
 
-    uint32_t head_len = __ai_get_head_len(buf);
-    uint32_t payload_len = __ai_get_payload_len(buf);
+    uint32_t head_len = __ai_get_head_len((char *)iov[0].buf);
+    uint32_t payload_len = __ai_get_payload_len((char *)iov[0].buf);
 
     // transport first 32 byte and packet last 32 byte, if less than 64 byte,use all packet
     uint8_t sign_data[64] = {0};
@@ -453,14 +579,13 @@ static OPERATE_RET __ai_packet_sign(char *buf, uint8_t *signature)
 
     AI_PROTO_D("start sign head_len:%d, payload_len:%d", head_len, payload_len);
     if (head_len + payload_len <= sizeof(sign_data)) {
-        memcpy(sign_data, buf, head_len + payload_len);
+        __ai_iov_copy(iov, iov_cnt, 0, sign_data, head_len + payload_len);
         sign_len = head_len + payload_len;
     } else {
-        memcpy(sign_data, buf, 32);
-        char *payload = buf + head_len;
+        __ai_iov_copy(iov, iov_cnt, 0, sign_data, 32);
         uint32_t offset = (payload_len > 32) ? payload_len - 32 : 0;
         uint32_t copy_len = (payload_len > 32) ? 32 : payload_len;
-        memcpy(sign_data + 32, payload + offset, copy_len);
+        __ai_iov_copy(iov, iov_cnt, head_len + offset, sign_data + 32, copy_len);
         sign_len = sizeof(sign_data);
     }
 
@@ -471,6 +596,15 @@ static OPERATE_RET __ai_packet_sign(char *buf, uint8_t *signature)
     return rt;
 }
 
+static OPERATE_RET __ai_packet_sign(char *buf, uint8_t *signature)
+{
+    tuya_transporter_iov_t iov = {
+        .buf = (uint8_t *)buf,
+        .len = __ai_get_head_len(buf) + __ai_get_payload_len(buf),
+    };
+    return __ai_packet_sign_iov(&iov, 1, signature);
+}
+
 uint32_t __ai_get_send_attr_len(AI_SEND_PACKET_T *info)
 {
     uint32_t len = 0, idx = 0;
@@ -556,7 +690,8 @@ static int __ai_encrypt_add_pkcs(char *p, uint32_t len)
     return (len + cz);
 }
 
-static OPERATE_RET __ai_encrypt_packet(AI_SEND_PACKET_T *info, char *data, uint32_t len, char *output, uint32_t *en_len)
+/* encrypts len bytes of buf in place, buf must have AI_ADD_PKT_LEN spare for padding and tag */
+static OPERATE_RET __ai_encrypt_packet(AI_SEND_PACKET_T *info, char *buf, uint32_t len, uint32_t *en_len)
 {
     OPERATE_RET rt = OPRT_OK;
     int data_out_len = 0;
@@ -566,11 +701,10 @@ static OPERATE_RET __ai_encrypt_packet(AI_SEND_PACKET_T *info, char *data, uint3
     AI_PACKET_SL sl = __ai_get_sl(info, false);
     if (sl == AI_PACKET_SL2) {
 #if (AI_PACKET_SECURITY_LEVEL == AI_PACKET_SL2)
-        memcpy(output, data, len);
-        data_out_len = __ai_encrypt_add_pkcs(output, len);
+        data_out_len = __ai_encrypt_add_pkcs(buf, len);
         char nonce[12] = {0};
         memcpy(nonce, ai_basic_proto->encrypt_iv, sizeof(nonce));
-        rt = mbedtls_chacha20_crypt((uint8_t *)key, (uint8_t *)nonce, 0, len, (uint8_t *)data, (uint8_t *)output);
+        rt = mbedtls_chacha20_crypt((uint8_t *)key, (uint8_t *)nonce, 0, len, (uint8_t *)buf, (uint8_t *)buf);
         if (OPRT_OK != rt) {
             PR_ERR("chacha20_crypt error:%d", rt);
             return rt;
@@ -579,10 +713,9 @@ static OPERATE_RET __ai_encrypt_packet(AI_SEND_PACKET_T *info, char *data, uint3
 #endif
     } else if (sl == AI_PACKET_SL3) {
 #if (AI_PACKET_SECURITY_LEVEL == AI_PACKET_SL3)
-        memcpy(output, data, len);
-        data_out_len = tal_pkcs7padding_buffer((uint8_t *)output, len);
-        rt = tal_aes256_cbc_encode_raw((uint8_t *)output, data_out_len, (uint8_t *)key,
-                                       (uint8_t *)ai_basic_proto->encrypt_iv, (uint8_t *)output);
+        data_out_len = tal_pkcs7padding_buffer((uint8_t *)buf, len);
+        rt = tal_aes256_cbc_encode_raw((uint8_t *)buf, data_out_len, (uint8_t *)key,
+                                       (uint8_t *)ai_basic_proto->encrypt_iv, (uint8_t *)buf);
         if (OPRT_OK != rt) {
             PR_ERR("aes128_cbc_encode error:%d", rt);
             return rt;
@@ -591,32 +724,24 @@ static OPERATE_RET __ai_encrypt_packet(AI_SEND_PACKET_T *info, char *data, uint3
 #endif
     } else if (sl == AI_PACKET_SL4) {
 #if (AI_PACKET_SECURITY_LEVEL == AI_PACKET_SL4)
-        uint8_t tag[AI_GCM_TAG_LEN] = {0};
-        memcpy(output, data, len);
-        data_out_len = __ai_encrypt_add_pkcs(output, len);
-
-        const cipher_params_t en_input = {
-            .cipher_type = MBEDTLS_CIPHER_AES_256_GCM,
-            .key = (unsigned char *)key,
-            .key_len = AI_KEY_LEN,
-            .nonce = (uint8_t *)ai_basic_proto->encrypt_iv,
-            .nonce_len = AI_IV_LEN,
-            .ad = NULL,
-            .ad_len = 0,
-            .data = (uint8_t *)output,
-            .data_len = data_out_len,
-        };
-        rt = mbedtls_cipher_auth_encrypt_wrapper(&en_input, (uint8_t *)output, (size_t *)en_len, tag, sizeof(tag));
+        data_out_len = __ai_encrypt_add_pkcs(buf, len);
+        rt = __ai_gcm_setup();
+        if (OPRT_OK != rt) {
+            return rt;
+        }
+        // the tag lands right after the ciphertext
+        rt = mbedtls_gcm_crypt_and_tag(&ai_basic_proto->gcm_enc, MBEDTLS_GCM_ENCRYPT, data_out_len,
+                                       (const unsigned char *)ai_basic_proto->encrypt_iv, AI_IV_LEN, NULL, 0,
+                                       (const unsigned char *)buf, (unsigned char *)buf, AI_GCM_TAG_LEN,
+                                       (unsigned char *)buf + data_out_len);
         if (rt != OPRT_OK) {
             PR_ERR("aes128_gcm_encode error:%x", rt);
         }
-        memcpy(output + *en_len, tag, sizeof(tag));
-        *en_len += sizeof(tag);
+        *en_len = data_out_len + AI_GCM_TAG_LEN;
         // tuya_debug_hex_dump("encrypt_data", 64, (uint8_t *)output, *en_len);
 #endif
     } else if (sl == AI_PACKET_SL0) {
         AI_PROTO_D("sl:%d do not need crypt", sl);
-        memcpy(output, data, len);
         *en_len = len;
     } else {
         PR_ERR("sl:%d err", sl);
@@ -660,20 +785,19 @@ static OPERATE_RET __ai_decrypt_packet(char *data, uint32_t len, char *output, u
         // tuya_debug_hex_dump("decrypt_key", 64, (uint8_t *)key, AI_KEY_LEN);
         // tuya_debug_hex_dump("decrypt_iv", 64, (uint8_t *)ai_basic_proto->decrypt_iv, AI_IV_LEN);
         // tuya_debug_hex_dump("decrypt_tag", 64, (uint8_t *)(data + len - AI_GCM_TAG_LEN), AI_GCM_TAG_LEN);
-        const cipher_params_t de_input = {
-            .cipher_type = MBEDTLS_CIPHER_AES_256_GCM,
-            .key = (unsigned char *)key,
-            .key_len = AI_KEY_LEN,
-            .nonce = (uint8_t *)ai_basic_proto->decrypt_iv,
-            .nonce_len = AI_IV_LEN,
-            .ad = NULL,
-            .ad_len = 0,
-            .data = (uint8_t *)data,
-            .data_len = len - AI_GCM_TAG_LEN,
-        };
-
-        rt = mbedtls_cipher_auth_decrypt_wrapper(&de_input, (uint8_t *)output, (size_t *)de_len,
-                                                 (uint8_t *)(data + len - AI_GCM_TAG_LEN), AI_GCM_TAG_LEN);
+        if (len <= AI_GCM_TAG_LEN) {
+            PR_ERR("gcm packet too short:%d", len);
+            return OPRT_COM_ERROR;
+        }
+        rt = __ai_gcm_setup();
+        if (OPRT_OK != rt) {
+            return rt;
+        }
+        *de_len = len - AI_GCM_TAG_LEN;
+        rt = mbedtls_gcm_auth_decrypt(&ai_basic_proto->gcm_dec, *de_len,
+                                      (const unsigned char *)ai_basic_proto->decrypt_iv, AI_IV_LEN, NULL, 0,
+                                      (const unsigned char *)(data + *de_len), AI_GCM_TAG_LEN,
+                                      (const unsigned char *)data, (unsigned char *)output);
         if (rt != OPRT_OK) {
             PR_ERR("aes128_gcm_decode error:%x", rt);
             return rt;
@@ -682,7 +806,9 @@ static OPERATE_RET __ai_decrypt_packet(char *data, uint32_t len, char *output, u
 #endif
     } else if (sl == AI_PACKET_SL0) {
         AI_PROTO_D("sl:%d do not need crypt ", sl);
-        memcpy(output, data, len);
+        if (output != data) {
+            memmove(output, data, len);
+        }
         *de_len = len;
     } else {
         AI_PROTO_D("sl:%d err", sl);
@@ -692,8 +818,9 @@ static OPERATE_RET __ai_decrypt_packet(char *data, uint32_t len, char *output, u
     return rt;
 }
 
-static OPERATE_RET __ai_pack_payload(AI_SEND_PACKET_T *info, char *payload_buf, uint32_t *payload_len,
-                                     AI_FRAG_FLAG frag, uint32_t origin_len)
+/* serializes the payload into buf and encrypts it there, without_data leaves info->data out of buf (SL0 only) */
+static OPERATE_RET __ai_pack_payload(AI_SEND_PACKET_T *info, char *buf, uint32_t *payload_len, AI_FRAG_FLAG frag,
+                                     uint32_t origin_len, bool without_data)
 {
     OPERATE_RET rt = OPRT_OK;
     uint32_t idx = 0, attr_len = 0, packet_len = 0;
@@ -701,10 +828,6 @@ static OPERATE_RET __ai_pack_payload(AI_SEND_PACKET_T *info, char *payload_buf,
     TUYA_CHECK_NULL_RETURN(info, OPRT_INVALID_PARM);
     packet_len = __ai_get_send_payload_len(info, frag);
 
-    char *buf = OS_MALLOC(packet_len);
-    TUYA_CHECK_NULL_RETURN(buf, OPRT_MALLOC_FAILED);
-    memset(buf, 0, packet_len);
-
     if (tuya_ai_is_need_attr(frag)) {
         AI_PAYLOAD_HEAD_T payload_head = {0};
         payload_head.type = info->type;
@@ -744,7 +867,6 @@ static OPERATE_RET __ai_pack_payload(AI_SEND_PACKET_T *info, char *payload_buf,
                     memcpy(buf + offset, info->attrs[idx]->value.str, attr_idx_len);
                 } else {
                     PR_ERR("unknow payload type:%d", payload_type);
-                    OS_FREE(buf);
                     return OPRT_COM_ERROR;
                 }
                 offset += attr_idx_len;
@@ -758,17 +880,18 @@ static OPERATE_RET __ai_pack_payload(AI_SEND_PACKET_T *info, char *payload_buf,
         offset += sizeof(info->len);
     }
 
-    memcpy(buf + offset, info->data, info->len);
+    if (!without_data) {
+        memcpy(buf + offset, info->data, info->len);
+    }
     offset += info->len;
     AI_PROTO_D("payload len:%d, offset:%d", packet_len, offset);
 
     // tuya_debug_hex_dump("payload_uncrypt", 64, (uint8_t *)buf, packet_len);
-    rt = __ai_encrypt_packet(info, buf, packet_len, payload_buf, payload_len);
+    rt = __ai_encrypt_packet(info, buf, packet_len, payload_len);
     if (OPRT_OK != rt) {
         PR_ERR("encrypt packet failed, rt:%d", rt);
     }
 
-    OS_FREE(buf);
     return rt;
 }
 
@@ -904,9 +1027,7 @@ static OPERATE_RET __ai_packet_write(AI_SEND_PACKET_T *info, AI_FRAG_FLAG frag,
         PR_ERR("send packet too long, len: %d", uncrypt_len);
         return OPRT_COM_ERROR;
     }
-    char *send_pkt_buf = OS_MALLOC(uncrypt_len);
-    TUYA_CHECK_NULL_RETURN(send_pkt_buf, OPRT_MALLOC_FAILED);
-    memset(send_pkt_buf, 0, uncrypt_len);
+    char *send_pkt_buf = ai_basic_proto->send_buf;
 
     uint32_t head_len = sizeof(AI_PACKET_HEAD_T);
 
@@ -930,7 +1051,9 @@ static OPERATE_RET __ai_packet_write(AI_SEND_PACKET_T *info, AI_FRAG_FLAG frag,
 
     offset += sizeof(uint32_t);
 
-    rt = __ai_pack_payload(info, send_pkt_buf + offset, &payload_len, frag, origin_len);
+    /* nothing to encrypt at SL0, so the data goes out from the caller's buffer */
+    bool data_in_place = (sl == AI_PACKET_SL0) && (info->len > 0);
+    rt = __ai_pack_payload(info, send_pkt_buf + offset, &payload_len, frag, origin_len, data_in_place);
     if (OPRT_OK != rt) {
         goto EXIT;
     }
@@ -938,19 +1061,34 @@ static OPERATE_RET __ai_packet_write(AI_SEND_PACKET_T *info, AI_FRAG_FLAG frag,
 
     memcpy(send_pkt_buf + length_field_offset, &length, sizeof(length));
 
-    rt = __ai_packet_sign(send_pkt_buf, signature);
+    uint32_t data_len = data_in_place ? info->len : 0;
+    tuya_transporter_iov_t iov[3] = {
+        {.buf = (uint8_t *)send_pkt_buf, .len = offset + payload_len - data_len},
+        {.buf = (uint8_t *)info->data, .len = data_len},
+        {.buf = signature, .len = AI_SIGN_LEN},
+    };
+    rt = __ai_packet_sign_iov(iov, 2, signature);
     if (OPRT_OK != rt) {
         goto EXIT;
     }
-    offset += payload_len;
-    memcpy(send_pkt_buf + offset, signature, AI_SIGN_LEN);
-    offset += AI_SIGN_LEN;
+    offset += payload_len + AI_SIGN_LEN;
 
     AI_PROTO_D("send packet len:%d", payload_len + AI_SIGN_LEN);
     AI_PROTO_D("send payload len:%d", payload_len);
     AI_PROTO_D("send total len:%d, send_len:%d", offset, uncrypt_len);
-    if (ai_basic_proto->transporter) {
-        rt = tuya_transporter_write(ai_basic_proto->transporter, (uint8_t *)send_pkt_buf, offset, 0);
+    if (info->writer && info->writer->write) {
+        for (uint32_t i = 0; i < sizeof(iov) / sizeof(iov[0]); i++) {
+            if (iov[i].len == 0) {
+                continue;
+            }
+            rt = info->writer->write(info->writer, iov[i].buf, iov[i].len);
+            if (OPRT_OK != rt) {
+                PR_ERR("writer write failed, rt:%d", rt);
+                goto EXIT;
+            }
+        }
+    } else if (ai_basic_proto->transporter) {
+        rt = tuya_transporter_writev(ai_basic_proto->transporter, iov, sizeof(iov) / sizeof(iov[0]), 0);
         if (rt != offset) {
             PR_ERR("send to cloud failed, rt:%d, len:%d", rt, offset);
             goto EXIT;
@@ -960,10 +1098,57 @@ static OPERATE_RET __ai_packet_write(AI_SEND_PACKET_T *info, AI_FRAG_FLAG frag,
     }
 
 EXIT:
-    OS_FREE(send_pkt_buf);
     return rt;
 }
 
+#if defined(ENABLE_AI_PROTO_BENCH) && (ENABLE_AI_PROTO_BENCH == 1)
+OPERATE_RET tuya_ai_basic_pkt_write_bench(AI_SEND_PACKET_T *info, AI_FRAG_FLAG frag)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    TUYA_CHECK_NULL_RETURN(info, OPRT_INVALID_PARM);
+    if (!ai_basic_proto) {
+        TUYA_CALL_ERR_RETURN(__ai_basic_proto_init());
+    }
+    if (ai_basic_proto->transporter) {
+        return OPRT_RESOURCE_NOT_READY;
+    }
+
+    tal_mutex_lock(ai_basic_proto->mutex);
+    rt = __ai_packet_write(info, frag, info->total_len);
+    tal_mutex_unlock(ai_basic_proto->mutex);
+
+    return rt;
+}
+
+OPERATE_RET tuya_ai_basic_pkt_read_attach(tuya_transporter_t transporter, AI_PACKET_SL sl, bool resign)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    if (!ai_basic_proto) {
+        TUYA_CALL_ERR_RETURN(__ai_basic_proto_init());
+    }
+    if (ai_basic_proto->connected) {
+        return OPRT_RESOURCE_NOT_READY;
+    }
+
+    /* every attach starts a fresh stream, so one input never depends on the one before */
+    if (ai_basic_proto->recv_frag_mng.data) {
+        OS_FREE(ai_basic_proto->recv_frag_mng.data);
+    }
+    memset(&ai_basic_proto->recv_frag_mng, 0, sizeof(AI_RECV_FRAG_MNG_T));
+    ai_basic_proto->sequence_in = 0;
+    ai_basic_proto->sequence_mask = 0;
+    memset(ai_basic_proto->decrypt_iv, 0, sizeof(ai_basic_proto->decrypt_iv));
+
+    ai_basic_proto->transporter = transporter;
+    ai_basic_proto->sl = sl;
+    ai_basic_proto->bench_resign = transporter ? resign : false;
+
+    return rt;
+}
+#endif
+
 void tuya_ai_free_attribute(AI_ATTRIBUTE_T *attr)
 {
     if (!attr) {
@@ -983,12 +1168,19 @@ void tuya_ai_free_attribute(AI_ATTRIBUTE_T *attr)
     default:
         break;
     }
-    OS_FREE(attr);
+    if (ai_attr_pool) {
+        tal_mempool_free(ai_attr_pool, attr);
+    } else {
+        OS_FREE(attr);
+    }
 }
 
 void tuya_ai_free_attrs(AI_SEND_PACKET_T *pkt)
 {
     uint32_t attr_idx = 0;
+    if (pkt->attrs_borrowed) {
+        return;
+    }
     for (attr_idx = 0; attr_idx < pkt->count; attr_idx++) {
         if (pkt->attrs[attr_idx]) {
             tuya_ai_free_attribute(pkt->attrs[attr_idx]);
@@ -1040,9 +1232,9 @@ static void __ai_basic_get_send_frag(AI_SEND_PACKET_T *info, AI_FRAG_FLAG *frag_
 
     if (info->writer && info->writer->update) {
         info->writer->update(AI_STAGE_GET_FRAG_OFFSET, &offset, info);
+    } else {
+        offset = &(ai_basic_proto->send_frag_mng[idx].offset);
     }
-
-    offset = &(ai_basic_proto->send_frag_mng[idx].offset);
     if (*offset == 0) {
         *offset += actual_len;
         *frag_flag = AI_PACKET_FRAG_START;
@@ -1176,7 +1368,8 @@ static bool __ai_check_attr_created(AI_SEND_PACKET_T *pkt)
 
 AI_ATTRIBUTE_T *tuya_ai_create_attribute(AI_ATTR_TYPE type, AI_ATTR_PT payload_type, void *value, uint32_t len)
 {
-    AI_ATTRIBUTE_T *attr = (AI_ATTRIBUTE_T *)OS_MALLOC(sizeof(AI_ATTRIBUTE_T));
+    AI_ATTRIBUTE_T *attr = ai_attr_pool ? (AI_ATTRIBUTE_T *)tal_mempool_alloc(ai_attr_pool, sizeof(AI_ATTRIBUTE_T))
+                                        : (AI_ATTRIBUTE_T *)OS_MALLOC(sizeof(AI_ATTRIBUTE_T));
     if (!attr) {
         PR_ERR("malloc attr failed");
         return NULL;
@@ -1222,6 +1415,47 @@ AI_ATTRIBUTE_T *tuya_ai_create_attribute(AI_ATTR_TYPE type, AI_ATTR_PT payload_t
     return attr;
 }
 
+void tuya_ai_init_attribute(AI_ATTRIBUTE_T *attr, AI_ATTR_TYPE type, AI_ATTR_PT payload_type, void *value,
+                            uint32_t len)
+{
+    memset(attr, 0, sizeof(AI_ATTRIBUTE_T));
+    attr->type = type;
+    attr->payload_type = payload_type;
+    attr->length = len;
+    switch (payload_type) {
+    case ATTR_PT_U8:
+        attr->value.u8 = *(uint8_t *)value;
+        break;
+    case ATTR_PT_U16:
+        attr->value.u16 = *(uint16_t *)value;
+        break;
+    case ATTR_PT_U32:
+        attr->value.u32 = *(uint32_t *)value;
+        break;
+    case ATTR_PT_U64:
+        attr->value.u64 = *(uint64_t *)value;
+        break;
+    case ATTR_PT_BYTES:
+        attr->value.bytes = (uint8_t *)value;
+        break;
+    case ATTR_PT_STR:
+        attr->value.str = (char *)value;
+        break;
+    default:
+        PR_ERR("invalid payload type");
+        break;
+    }
+}
+
+/* points pkt->attrs at store and fills the next one, for packets with attrs_borrowed */
+static void __ai_add_borrowed_attr(AI_SEND_PACKET_T *pkt, AI_ATTRIBUTE_T *store, AI_ATTR_TYPE type,
+                                   AI_ATTR_PT payload_type, void *value, uint32_t len)
+{
+    tuya_ai_init_attribute(&store[pkt->count], type, payload_type, value, len);
+    pkt->attrs[pkt->count] = &store[pkt->count];
+    pkt->count++;
+}
+
 static OPERATE_RET __create_conn_close_attrs(AI_SEND_PACKET_T *pkt, AI_STATUS_CODE code)
 {
     uint32_t attr_idx = 0;
@@ -1290,30 +1524,21 @@ static OPERATE_RET __create_clt_hello_attrs(AI_SEND_PACKET_T *pkt)
     return OPRT_OK;
 }
 
-static OPERATE_RET __create_refresh_req_attrs(AI_SEND_PACKET_T *pkt)
+static void __create_refresh_req_attrs(AI_SEND_PACKET_T *pkt, AI_ATTRIBUTE_T *store)
 {
-    uint32_t attr_idx = 0;
     char *connection_id = ai_basic_proto->connection_id;
+    pkt->attrs_borrowed = true;
     if (connection_id) {
-        pkt->attrs[attr_idx++] =
-            tuya_ai_create_attribute(AI_ATTR_CONNECTION_ID, ATTR_PT_STR, connection_id, strlen(connection_id));
+        __ai_add_borrowed_attr(pkt, store, AI_ATTR_CONNECTION_ID, ATTR_PT_STR, connection_id, strlen(connection_id));
     }
-    pkt->count = attr_idx;
-    if (!__ai_check_attr_created(pkt)) {
-        return OPRT_MALLOC_FAILED;
-    }
-    return OPRT_OK;
 }
 
 OPERATE_RET tuya_ai_basic_refresh_req(void)
 {
-    OPERATE_RET rt = OPRT_OK;
     AI_SEND_PACKET_T pkt = {0};
+    AI_ATTRIBUTE_T attrs[1];
     pkt.type = AI_PT_CONN_REFRESH_REQ;
-    rt = __create_refresh_req_attrs(&pkt);
-    if (OPRT_OK != rt) {
-        return rt;
-    }
+    __create_refresh_req_attrs(&pkt, attrs);
     AI_PROTO_D("send connect refresh req");
     return tuya_ai_basic_pkt_send(&pkt);
 }
@@ -1489,8 +1714,34 @@ static int __ai_baisc_read_pkt_head(char *recv_buf)
     return offset;
 }
 
+/* replay window: accepts sequences up to AI_SEQUENCE_WINDOW behind the newest one, each at most once */
+static bool __ai_sequence_accept(uint16_t sequence)
+{
+    uint16_t ahead = sequence - ai_basic_proto->sequence_in;
+    if ((ahead != 0) && (ahead < 0x8000)) {
+        ai_basic_proto->sequence_mask = (ahead >= AI_SEQUENCE_WINDOW) ? 0 : (ai_basic_proto->sequence_mask << ahead);
+        ai_basic_proto->sequence_mask |= 1;
+        ai_basic_proto->sequence_in = sequence;
+        return true;
+    }
+
+    uint16_t behind = ai_basic_proto->sequence_in - sequence;
+    if ((behind == 0) || (behind >= AI_SEQUENCE_WINDOW)) {
+        return false;
+    }
+    if (ai_basic_proto->sequence_mask & ((uint64_t)1 << behind)) {
+        return false;
+    }
+    ai_basic_proto->sequence_mask |= ((uint64_t)1 << behind);
+    return true;
+}
+
 void tuya_ai_basic_pkt_free(char *data)
 {
+    /* unfragmented packets are decrypted in place in recv_buf */
+    if ((data >= ai_basic_proto->recv_buf) && (data < ai_basic_proto->recv_buf + sizeof(ai_basic_proto->recv_buf))) {
+        return;
+    }
     if (data == ai_basic_proto->recv_frag_mng.data) {
         OS_FREE(data);
         ai_basic_proto->recv_frag_mng.data = NULL;
@@ -1522,7 +1773,6 @@ OPERATE_RET tuya_ai_basic_pkt_read(char **out, uint32_t *out_len, AI_FRAG_FLAG *
     char *recv_buf = ai_basic_proto->recv_buf;
     TUYA_CHECK_NULL_RETURN(recv_buf, OPRT_COM_ERROR);
 
-    memset(recv_buf, 0, sizeof(ai_basic_proto->recv_buf));
     AI_PROTO_D("recv packet ing");
     int recv_len = __ai_baisc_read_pkt_head(recv_buf);
     if (recv_len <= 0) {
@@ -1548,17 +1798,6 @@ OPERATE_RET tuya_ai_basic_pkt_read(char **out, uint32_t *out_len, AI_FRAG_FLAG *
         goto EXIT;
     }
 
-    uint16_t sequence = UNI_NTOHS(head->sequence);
-    if (sequence <= ai_basic_proto->sequence_in) {
-        PR_ERR("sequence error, in:%d, pre:%d", sequence, ai_basic_proto->sequence_in);
-        goto EXIT;
-    }
-
-    ai_basic_proto->sequence_in = sequence;
-    if (sequence >= 0xFFFF) {
-        ai_basic_proto->sequence_in = 0;
-    }
-
     uint32_t continue_recv_len = 0;
     int offset = recv_len;
     while (packet_len + head_len > offset) {
@@ -1584,6 +1823,11 @@ OPERATE_RET tuya_ai_basic_pkt_read(char **out, uint32_t *out_len, AI_FRAG_FLAG *
     AI_PROTO_D("sign ok");
     uint32_t payload_len = __ai_get_payload_len(recv_buf);
     char *payload = recv_buf + head_len;
+#if defined(ENABLE_AI_PROTO_BENCH) && (ENABLE_AI_PROTO_BENCH == 1)
+    if (ai_basic_proto->bench_resign) {
+        memcpy(payload + payload_len, calc_sign, AI_SIGN_LEN);
+    }
+#endif
     memcpy(packet_sign, payload + payload_len, AI_SIGN_LEN);
     if (memcmp(calc_sign, packet_sign, sizeof(calc_sign))) {
         PR_ERR("packet sign error");
@@ -1593,15 +1837,23 @@ OPERATE_RET tuya_ai_basic_pkt_read(char **out, uint32_t *out_len, AI_FRAG_FLAG *
         goto EXIT;
     }
 
+    // checked once the packet is authenticated and fully read, so a rejected one leaves the stream in step
+    uint16_t sequence = UNI_NTOHS(head->sequence);
+    if (!__ai_sequence_accept(sequence)) {
+        PR_ERR("sequence error, in:%d, pre:%d", sequence, ai_basic_proto->sequence_in);
+        recv_len = OPRT_RESOURCE_NOT_READY;
+        goto EXIT;
+    }
+
+    /* decrypt over the ciphertext, the plaintext is never longer and ends before the signature */
     uint32_t decrypt_len = 0;
-    decrypt_buf = OS_MALLOC(packet_len + head_len + AI_ADD_PKT_LEN);
-    TUYA_CHECK_NULL_RETURN(decrypt_buf, OPRT_MALLOC_FAILED);
-    memset(decrypt_buf, 0, packet_len + head_len + AI_ADD_PKT_LEN);
-    rt = __ai_decrypt_packet(payload, payload_len, decrypt_buf, &decrypt_len);
+    rt = __ai_decrypt_packet(payload, payload_len, payload, &decrypt_len);
     if (OPRT_OK != rt) {
         PR_ERR("decrypt packet failed, rt:%d", rt);
         goto EXIT;
     }
+    payload[decrypt_len] = '\0';
+    decrypt_buf = payload;
     AI_PROTO_D("decrypt len:%d", decrypt_len);
     AI_PROTO_D("frag flag:%d, sdk frag flag:%d", head->frag_flag, __ai_basic_get_frag_flag());
 
@@ -1626,16 +1878,28 @@ OPERATE_RET tuya_ai_basic_pkt_read(char **out, uint32_t *out_len, AI_FRAG_FLAG *
                 memcpy(&attr_len, decrypt_buf + frag_offset, sizeof(attr_len));
                 frag_offset += sizeof(attr_len);
                 attr_len = UNI_NTOHL(attr_len);
+                if (attr_len > decrypt_len) {
+                    PR_ERR("attr len error, attr len:%d, decrypt len:%d", attr_len, decrypt_len);
+                    goto EXIT;
+                }
                 frag_offset += attr_len;
+                if (frag_offset + sizeof(origin_len) > decrypt_len) {
+                    PR_ERR("start frag packet too short:%d", decrypt_len);
+                    goto EXIT;
+                }
                 memcpy(&origin_len, decrypt_buf + frag_offset, sizeof(origin_len));
                 origin_len = UNI_NTOHL(origin_len);
                 AI_PROTO_D("recv start frag packet with attr, origin len:%d", origin_len);
             } else {
+                if (sizeof(AI_PAYLOAD_HEAD_T) + sizeof(origin_len) > decrypt_len) {
+                    PR_ERR("start frag packet too short:%d", decrypt_len);
+                    goto EXIT;
+                }
                 memcpy(&origin_len, decrypt_buf + sizeof(AI_PAYLOAD_HEAD_T), sizeof(origin_len));
                 origin_len = UNI_NTOHL(origin_len);
                 AI_PROTO_D("recv start frag packet, origin len:%d", origin_len);
             }
-            if (origin_len <= decrypt_len) {
+            if ((origin_len <= decrypt_len) || (origin_len > UINT32_MAX - frag_offset - AI_ADD_PKT_LEN)) {
                 PR_ERR("origin len error, origin len:%d, decrypt len:%d", origin_len, decrypt_len);
                 goto EXIT;
             }
@@ -1649,22 +1913,24 @@ OPERATE_RET tuya_ai_basic_pkt_read(char **out, uint32_t *out_len, AI_FRAG_FLAG *
                 goto EXIT;
             }
             AI_PROTO_D("malloc recv_frag_mng data addr %p", ai_basic_proto->recv_frag_mng.data);
+            ai_basic_proto->recv_frag_mng.size = frag_total_len;
             memset(ai_basic_proto->recv_frag_mng.data, 0, frag_total_len);
             memcpy(ai_basic_proto->recv_frag_mng.data, decrypt_buf, decrypt_len);
             ai_basic_proto->recv_frag_mng.offset = decrypt_len;
-            OS_FREE(decrypt_buf);
-            decrypt_buf = NULL;
             rt = tuya_ai_basic_pkt_read(out, out_len, out_frag);
             if (rt != OPRT_OK) {
                 PR_ERR("read continue frag packet failed, rt:%d", rt);
                 goto EXIT;
             }
+        } else if (((current_frag_flag == AI_PACKET_FRAG_ING) || (current_frag_flag == AI_PACKET_FRAG_END)) &&
+                   ((NULL == ai_basic_proto->recv_frag_mng.data) ||
+                    (decrypt_len > ai_basic_proto->recv_frag_mng.size - ai_basic_proto->recv_frag_mng.offset))) {
+            PR_ERR("frag packet out of place, flag:%d, len:%d", current_frag_flag, decrypt_len);
+            goto EXIT;
         } else if (current_frag_flag == AI_PACKET_FRAG_ING) {
             memcpy(ai_basic_proto->recv_frag_mng.data + ai_basic_proto->recv_frag_mng.offset, decrypt_buf, decrypt_len);
             ai_basic_proto->recv_frag_mng.frag_flag = current_frag_flag;
             ai_basic_proto->recv_frag_mng.offset += decrypt_len;
-            OS_FREE(decrypt_buf);
-            decrypt_buf = NULL;
             rt = tuya_ai_basic_pkt_read(out, out_len, out_frag);
             if (rt != OPRT_OK) {
                 PR_ERR("read continue ing frag packet failed, rt:%d", rt);
@@ -1674,8 +1940,6 @@ OPERATE_RET tuya_ai_basic_pkt_read(char **out, uint32_t *out_len, AI_FRAG_FLAG *
             memcpy(ai_basic_proto->recv_frag_mng.data + ai_basic_proto->recv_frag_mng.offset, decrypt_buf, decrypt_len);
             ai_basic_proto->recv_frag_mng.frag_flag = current_frag_flag;
             ai_basic_proto->recv_frag_mng.offset += decrypt_len;
-            OS_FREE(decrypt_buf);
-            decrypt_buf = NULL;
             *out = ai_basic_proto->recv_frag_mng.data;
             *out_len = ai_basic_proto->recv_frag_mng.offset;
             *out_frag = AI_PACKET_NO_FRAG;
@@ -1693,10 +1957,6 @@ OPERATE_RET tuya_ai_basic_pkt_read(char **out, uint32_t *out_len, AI_FRAG_FLAG *
     return rt;
 
 EXIT:
-    if (decrypt_buf) {
-        OS_FREE(decrypt_buf);
-        decrypt_buf = NULL;
-    }
     if (ai_basic_proto->recv_frag_mng.data) {
         OS_FREE(ai_basic_proto->recv_frag_mng.data);
     }
@@ -1823,7 +2083,7 @@ OPERATE_RET tuya_ai_auth_resp(void)
     AI_PAYLOAD_HEAD_T *packet = (AI_PAYLOAD_HEAD_T *)de_buf;
     if (packet->attribute_flag != AI_HAS_ATTR) {
         PR_ERR("auth resp packet has no attribute");
-        OS_FREE(de_buf);
+        tuya_ai_basic_pkt_free(de_buf);
         return OPRT_COM_ERROR;
     }
 
@@ -1839,31 +2099,24 @@ OPERATE_RET tuya_ai_auth_resp(void)
         PR_ERR("auth resp packet type error %d", packet->type);
         rt = OPRT_COM_ERROR;
     }
-    OS_FREE(de_buf);
+    tuya_ai_basic_pkt_free(de_buf);
     return rt;
 }
 
-static OPERATE_RET __create_ping_attrs(AI_SEND_PACKET_T *pkt)
+static void __create_ping_attrs(AI_SEND_PACKET_T *pkt, AI_ATTRIBUTE_T *store)
 {
-    uint32_t attr_idx = 0;
     uint64_t ts = tal_time_get_posix_ms();
-    pkt->attrs[attr_idx++] = tuya_ai_create_attribute(AI_ATTR_CLIENT_TS, ATTR_PT_U64, &ts, sizeof(uint64_t));
-    pkt->count = attr_idx;
-    if (!__ai_check_attr_created(pkt)) {
-        return OPRT_MALLOC_FAILED;
-    }
-    return OPRT_OK;
+    pkt->attrs_borrowed = true;
+    __ai_add_borrowed_attr(pkt, store, AI_ATTR_CLIENT_TS, ATTR_PT_U64, &ts, sizeof(uint64_t));
 }
 
 OPERATE_RET tuya_ai_basic_ping(void)
 {
     OPERATE_RET rt = OPRT_OK;
     AI_SEND_PACKET_T pkt = {0};
+    AI_ATTRIBUTE_T attrs[1];
     pkt.type = AI_PT_PING;
-    rt = __create_ping_attrs(&pkt);
-    if (OPRT_OK != rt) {
-        return rt;
-    }
+    __create_ping_attrs(&pkt, attrs);
     PR_NOTICE("ai ping");
     rt = tuya_ai_basic_pkt_send(&pkt);
     return rt;
@@ -2015,30 +2268,24 @@ static OPERATE_RET __create_video_attrs(AI_SEND_PACKET_T *pkt, AI_VIDEO_ATTR_T *
     return OPRT_OK;
 }
 
-static OPERATE_RET __create_audio_attrs(AI_SEND_PACKET_T *pkt, AI_AUDIO_ATTR_T *audio)
+/* audio attrs reference audio, which outlives the send, so nothing is allocated per frame */
+static void __create_audio_attrs(AI_SEND_PACKET_T *pkt, AI_AUDIO_ATTR_T *audio, AI_ATTRIBUTE_T *store)
 {
-    uint32_t attr_idx = 0;
-    pkt->attrs[attr_idx++] =
-        tuya_ai_create_attribute(AI_ATTR_AUDIO_CODEC_TYPE, ATTR_PT_U16, &audio->base.codec_type, sizeof(uint16_t));
-    pkt->attrs[attr_idx++] =
-        tuya_ai_create_attribute(AI_ATTR_AUDIO_SAMPLE_RATE, ATTR_PT_U32, &audio->base.sample_rate, sizeof(uint32_t));
-    pkt->attrs[attr_idx++] =
-        tuya_ai_create_attribute(AI_ATTR_AUDIO_CHANNELS, ATTR_PT_U16, &audio->base.channels, sizeof(uint16_t));
-    pkt->attrs[attr_idx++] =
-        tuya_ai_create_attribute(AI_ATTR_AUDIO_DEPTH, ATTR_PT_U16, &audio->base.bit_depth, sizeof(uint16_t));
+    pkt->attrs_borrowed = true;
+    __ai_add_borrowed_attr(pkt, store, AI_ATTR_AUDIO_CODEC_TYPE, ATTR_PT_U16, &audio->base.codec_type,
+                           sizeof(uint16_t));
+    __ai_add_borrowed_attr(pkt, store, AI_ATTR_AUDIO_SAMPLE_RATE, ATTR_PT_U32, &audio->base.sample_rate,
+                           sizeof(uint32_t));
+    __ai_add_borrowed_attr(pkt, store, AI_ATTR_AUDIO_CHANNELS, ATTR_PT_U16, &audio->base.channels, sizeof(uint16_t));
+    __ai_add_borrowed_attr(pkt, store, AI_ATTR_AUDIO_DEPTH, ATTR_PT_U16, &audio->base.bit_depth, sizeof(uint16_t));
     if (audio->option.user_data) {
-        pkt->attrs[attr_idx++] =
-            tuya_ai_create_attribute(AI_ATTR_USER_DATA, ATTR_PT_BYTES, audio->option.user_data, audio->option.user_len);
+        __ai_add_borrowed_attr(pkt, store, AI_ATTR_USER_DATA, ATTR_PT_BYTES, audio->option.user_data,
+                               audio->option.user_len);
     }
     if (audio->option.session_id_list) {
-        pkt->attrs[attr_idx++] = tuya_ai_create_attribute(
-            AI_ATTR_SESSION_ID_LIST, ATTR_PT_STR, audio->option.session_id_list, strlen(audio->option.session_id_list));
+        __ai_add_borrowed_attr(pkt, store, AI_ATTR_SESSION_ID_LIST, ATTR_PT_STR, audio->option.session_id_list,
+                               strlen(audio->option.session_id_list));
     }
-    pkt->count = attr_idx;
-    if (!__ai_check_attr_created(pkt)) {
-        return OPRT_MALLOC_FAILED;
-    }
-    return OPRT_OK;
 }
 
 static OPERATE_RET __create_image_attrs(AI_SEND_PACKET_T *pkt, AI_IMAGE_ATTR_T *image)
@@ -2160,7 +2407,7 @@ OPERATE_RET tuya_ai_basic_video(AI_VIDEO_ATTR_T *video, char *data, uint32_t len
 {
     OPERATE_RET rt = OPRT_OK;
     AI_SEND_PACKET_T pkt = {0};
-    (void)writer; // Unused parameter for now
+    pkt.writer = writer;
     pkt.type = AI_PT_VIDEO;
     if (video) {
         rt = __create_video_attrs(&pkt, video);
@@ -2180,13 +2427,11 @@ OPERATE_RET tuya_ai_basic_audio(AI_AUDIO_ATTR_T *audio, char *data, uint32_t len
 {
     OPERATE_RET rt = OPRT_OK;
     AI_SEND_PACKET_T pkt = {0};
-    (void)writer; // Unused parameter for now
+    AI_ATTRIBUTE_T attrs[AI_AUDIO_ATTR_NUM];
+    pkt.writer = writer;
     pkt.type = AI_PT_AUDIO;
     if (audio) {
-        rt = __create_audio_attrs(&pkt, audio);
-        if (OPRT_OK != rt) {
-            return rt;
-        }
+        __create_audio_attrs(&pkt, audio, attrs);
     }
     pkt.len = len;
     pkt.total_len = total_len;
@@ -2200,7 +2445,7 @@ OPERATE_RET tuya_ai_basic_image(AI_IMAGE_ATTR_T *image, char *data, uint32_t len
 {
     OPERATE_RET rt = OPRT_OK;
     AI_SEND_PACKET_T pkt = {0};
-    (void)writer; // Unused parameter for now
+    pkt.writer = writer;
     pkt.type = AI_PT_IMAGE;
     if (image) {
         rt = __create_image_attrs(&pkt, image);
@@ -2224,7 +2469,7 @@ OPERATE_RET tuya_ai_basic_file(AI_FILE_ATTR_T *file, char *data, uint32_t len, u
 {
     OPERATE_RET rt = OPRT_OK;
     AI_SEND_PACKET_T pkt = {0};
-    (void)writer; // Unused parameter for now
+    pkt.writer = writer;
     pkt.type = AI_PT_FILE;
     if (file) {
         rt = __create_file_attrs(&pkt, file);
@@ -2248,7 +2493,7 @@ OPERATE_RET tuya_ai_basic_text(AI_TEXT_ATTR_T *text, char *data, uint32_t len, u
 {
     OPERATE_RET rt = OPRT_OK;
     AI_SEND_PACKET_T pkt = {0};
-    (void)writer;    // Unused parameter for now
+    pkt.writer = writer;
     (void)total_len; // Unused parameter for now
     pkt.type = AI_PT_TEXT;
     if (text) {
@@ -2267,7 +2512,7 @@ OPERATE_RET tuya_ai_basic_event(AI_EVENT_ATTR_T *event, char *data, uint32_t len
 {
     OPERATE_RET rt = OPRT_OK;
     AI_SEND_PACKET_T pkt = {0};
-    (void)writer; // Unused parameter for now
+    pkt.writer = writer;
     pkt.type = AI_PT_EVENT;
 
     AI_EVENT_HEAD_T head = {0};
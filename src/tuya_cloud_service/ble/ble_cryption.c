@@ -17,6 +17,28 @@
 
 static uint8_t service_rand[16] = {0};
 
+/**
+ * Expanded AES contexts, one per direction, kept across frames. Every frame
+ * of a session uses the same key, so the key schedule (and on platforms
+ * whose tkl_aes_* hooks drive a hardware engine, the engine key load) is
+ * done once per key instead of once per frame.
+ */
+typedef struct {
+    TKL_SYMMETRY_HANDLE ctx;
+    uint8_t key[16];
+    bool valid;
+} ble_aes_cache_t;
+
+static MUTEX_HANDLE s_aes_mutex = NULL;
+static ble_aes_cache_t s_aes_enc;
+static ble_aes_cache_t s_aes_dec;
+
+/* Last key derivation, the inputs rarely change within a session */
+static uint8_t s_key_mode = ENCRYPTION_MODE_NONE;
+static uint16_t s_key_in_len = 0;
+static uint8_t s_key_in[KEY_IN_BUFFER_LEN_MAX];
+static uint8_t s_key_out[16];
+
 static bool ble_key_generate(ble_crypto_param_t *p, uint8_t mode, uint8_t *key_out)
 {
     uint16_t len = 0;
@@ -93,17 +115,127 @@ static bool ble_key_generate(ble_crypto_param_t *p, uint8_t mode, uint8_t *key_o
         return false;
     }
 
-    memset(key_out_hex, 0, sizeof(key_out_hex));
-    tal_md5_ret(key_in_buffer, len, key_out_hex);
-    memcpy(key_out, key_out_hex, 16);
+    // the memo is shared between the encrypt and decrypt paths
+    if (s_aes_mutex) {
+        tal_mutex_lock(s_aes_mutex);
+    }
+
+    if (s_key_mode == mode && s_key_in_len == len && 0 == memcmp(s_key_in, key_in_buffer, len)) {
+        memcpy(key_out, s_key_out, 16);
+    } else {
+        memset(key_out_hex, 0, sizeof(key_out_hex));
+        tal_md5_ret(key_in_buffer, len, key_out_hex);
+        memcpy(key_out, key_out_hex, 16);
+
+        s_key_mode = mode;
+        s_key_in_len = len;
+        memcpy(s_key_in, key_in_buffer, len);
+        memcpy(s_key_out, key_out_hex, 16);
 
-    if (ENCRYPTION_MODE_KEY_11 == mode) {
-        memcpy(key_out_key11, key_out_hex, 16);
+        if (ENCRYPTION_MODE_KEY_11 == mode) {
+            memcpy(key_out_key11, key_out_hex, 16);
+        }
+    }
+
+    if (s_aes_mutex) {
+        tal_mutex_unlock(s_aes_mutex);
     }
 
     return true;
 }
 
+static OPERATE_RET ble_aes_cache_key(ble_aes_cache_t *cache, int32_t mode, uint8_t *key)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    if (cache->valid && 0 == memcmp(cache->key, key, 16)) {
+        return OPRT_OK;
+    }
+
+    if (NULL == cache->ctx) {
+        TUYA_CALL_ERR_RETURN(tal_aes_create_init(&cache->ctx));
+    }
+
+    cache->valid = false;
+    if (SYMMETRY_ENCRYPT == mode) {
+        TUYA_CALL_ERR_RETURN(tal_aes_setkey_enc(cache->ctx, key, 128));
+    } else {
+        TUYA_CALL_ERR_RETURN(tal_aes_setkey_dec(cache->ctx, key, 128));
+    }
+    memcpy(cache->key, key, 16);
+    cache->valid = true;
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET ble_aes128_cbc(int32_t mode, uint8_t *key, uint8_t *iv, uint8_t *in, size_t len, uint8_t *out)
+{
+    OPERATE_RET rt;
+
+    // not initialized, one-shot context
+    if (NULL == s_aes_mutex) {
+        if (SYMMETRY_ENCRYPT == mode) {
+            return tal_aes128_cbc_encode_raw(in, len, key, iv, out);
+        }
+        return tal_aes128_cbc_decode_raw(in, len, key, iv, out);
+    }
+
+    ble_aes_cache_t *cache = (SYMMETRY_ENCRYPT == mode) ? &s_aes_enc : &s_aes_dec;
+
+    tal_mutex_lock(s_aes_mutex);
+    rt = ble_aes_cache_key(cache, mode, key);
+    if (OPRT_OK == rt) {
+        rt = tal_aes_crypt_cbc(cache->ctx, mode, len, iv, in, out);
+    }
+    tal_mutex_unlock(s_aes_mutex);
+
+    return rt;
+}
+
+static void ble_aes_cache_free(ble_aes_cache_t *cache)
+{
+    if (cache->ctx) {
+        tal_aes_free(cache->ctx);
+    }
+    memset(cache, 0, sizeof(ble_aes_cache_t));
+}
+
+/**
+ * @brief Initializes the AES context cache used by the frame cipher.
+ *
+ * @return OPRT_OK on success, or an error code on failure.
+ */
+int tuya_ble_cryption_init(void)
+{
+    if (s_aes_mutex) {
+        return OPRT_OK;
+    }
+    memset(&s_aes_enc, 0, sizeof(s_aes_enc));
+    memset(&s_aes_dec, 0, sizeof(s_aes_dec));
+    return tal_mutex_create_init(&s_aes_mutex);
+}
+
+/**
+ * @brief Drops the cached AES contexts and derived key.
+ *
+ * Call when the BLE connection ends so session key material does not outlive
+ * the session.
+ */
+void tuya_ble_cryption_reset(void)
+{
+    if (NULL == s_aes_mutex) {
+        return;
+    }
+    tal_mutex_lock(s_aes_mutex);
+    ble_aes_cache_free(&s_aes_enc);
+    ble_aes_cache_free(&s_aes_dec);
+    s_key_mode = ENCRYPTION_MODE_NONE;
+    s_key_in_len = 0;
+    memset(s_key_in, 0, sizeof(s_key_in));
+    memset(s_key_out, 0, sizeof(s_key_out));
+    tal_mutex_unlock(s_aes_mutex);
+}
+
 static uint16_t ble_add_pkcs(uint8_t *p, uint16_t len)
 {
     uint8_t pkcs[16];
@@ -260,7 +392,7 @@ uint8_t tuya_ble_encryption(ble_crypto_param_t *p, uint8_t encryption_mode, uint
     memset(key, 0, sizeof(key));
     if (ble_key_generate(p, encryption_mode, key)) {
         *out_len = len;
-        int rt = tal_aes128_cbc_encode_raw(in_buf, len, key, iv, out_buf);
+        int rt = ble_aes128_cbc(SYMMETRY_ENCRYPT, key, iv, in_buf, len, out_buf);
         return rt == OPRT_OK ? 0 : 3;
     }
 
@@ -322,7 +454,7 @@ uint8_t tuya_ble_decryption(ble_crypto_param_t *p, uint8_t *in_buf, uint32_t in_
     if (ble_key_generate(p, mode, key)) {
         memcpy(IV, in_buf + 1, 16);
         *out_len = len;
-        int rt = tal_aes128_cbc_decode_raw((uint8_t *)(in_buf + 17), len, key, IV, out_buf);
+        int rt = ble_aes128_cbc(SYMMETRY_DECRYPT, key, IV, (uint8_t *)(in_buf + 17), len, out_buf);
         return rt == OPRT_OK ? 0 : 3;
     }
 
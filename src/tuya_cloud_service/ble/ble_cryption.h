@@ -57,6 +57,18 @@ typedef struct {
     uint8_t *pair_rand;
 } ble_crypto_param_t;
 
+/**
+ * @brief Initializes the AES context cache used for BLE frames.
+ *
+ * @return OPRT_OK on success, or an error code on failure.
+ */
+int tuya_ble_cryption_init(void);
+
+/**
+ * @brief Drops the cached AES contexts and derived session key.
+ */
+void tuya_ble_cryption_reset(void);
+
 uint8_t tuya_ble_encryption(ble_crypto_param_t *p, uint8_t encryption_mode, uint8_t *iv, uint8_t *in_buf,
                             uint32_t in_len, uint32_t *out_len, uint8_t *out_buf);
 
@@ -43,6 +43,10 @@ typedef uint8_t dp_type;
 #define DT_RAW_MAX    255
 #define DT_INT_LEN    DT_VALUE_LEN
 
+#define KLV_HEAD_LEN      4 // id(1)+type(1)+len(2)
+#define KLV_RPT_HEAD_LEN  7 // version(1)+sn(4)+type(1)+flag(1)
+#define KLV_RPT_TIME_LEN  5 // timeType(1)+time(4)
+
 typedef struct s_klv_node {
     struct s_klv_node *next;
     uint8_t id;
@@ -51,6 +55,16 @@ typedef struct s_klv_node {
     uint8_t *data;
 } klv_node_s;
 
+// flat v4 payload, encoded in place without per-dp nodes
+typedef struct {
+    uint8_t *data;
+    uint32_t size;
+    uint32_t len;
+} klv_buf_s;
+
+// report sn, shared by the list and the flat encoder
+static uint32_t sg_klv_sn = 1;
+
 void tuya_change_bt_dp_tlv(dp_type type, void *data, uint16_t *len)
 {
     if (DT_ENUM == type) {
@@ -174,7 +188,7 @@ OPERATE_RET klvlist_2_data(klv_node_s *list, uint8_t **data, uint32_t *len, uint
         return OPRT_INVALID_PARM;
     }
 
-    static uint32_t sn = 1;
+    uint32_t sn = sg_klv_sn;
     klv_node_s *node = list;
     // type: 1: 4.x protocol dp report
     uint8_t type = 1;
@@ -247,7 +261,7 @@ OPERATE_RET klvlist_2_data(klv_node_s *list, uint8_t **data, uint32_t *len, uint
     //     ty_upd_dp_sync_sn(sn);
     // }
 
-    sn++;
+    sg_klv_sn++;
     return OPRT_OK;
 }
 
@@ -325,6 +339,136 @@ OPERATE_RET data_2_klvlist(uint8_t *data, uint32_t len, klv_node_s **list)
     return OPRT_OK;
 }
 
+static void __klv_put_be(uint8_t *p, uint32_t value, uint8_t len)
+{
+    uint8_t i;
+
+    for (i = 0; i < len; i++) {
+        p[i] = (value >> ((len - 1 - i) * 8)) & 0xff;
+    }
+}
+
+static uint32_t __klv_get_be(const uint8_t *p, uint16_t len)
+{
+    uint32_t value = 0;
+    uint16_t i;
+
+    for (i = 0; i < len && i < 4; i++) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+/**
+ * @brief Start a flat v4 dp payload: version, sn, type, flag and the
+ * optional time (already in network order).
+ */
+static void klv_buf_head(klv_buf_s *buf, uint32_t *time_stamp, BOOL_T query, uint8_t flag)
+{
+    uint8_t *p = buf->data;
+
+    p[0] = 0;
+    __klv_put_be(&p[1], sg_klv_sn++, 4);
+    p[5] = (query ? 1 : 0);
+    p[6] = flag;
+    buf->len = KLV_RPT_HEAD_LEN;
+
+    if (NULL != time_stamp) {
+        p[buf->len++] = 1;
+        memcpy(&p[buf->len], time_stamp, 4);
+        buf->len += 4;
+    }
+}
+
+/**
+ * @brief Append one KLV whose value is already in wire format.
+ */
+static OPERATE_RET klv_buf_put(klv_buf_s *buf, uint8_t id, dp_type type, const uint8_t *data, uint16_t len)
+{
+    if ((buf->size - buf->len) < (uint32_t)(KLV_HEAD_LEN + len)) {
+        PR_ERR("dp %d len %d exceeds payload, used %u", id, len, buf->len);
+        return OPRT_BUFFER_NOT_ENOUGH;
+    }
+
+    uint8_t *p = &buf->data[buf->len];
+    p[0] = id;
+    p[1] = type;
+    p[2] = 0xff & (len >> 8);
+    p[3] = 0xff & len;
+    if (len > 0) {
+        memcpy(&p[KLV_HEAD_LEN], data, len);
+    }
+    buf->len += KLV_HEAD_LEN + len;
+    return OPRT_OK;
+}
+
+/**
+ * @brief Append one object dp, converted like make_klv_list: value and
+ * bitmap as 4 bytes, enum as 1/2/4 bytes, bool as 1 byte, all big-endian.
+ */
+static OPERATE_RET klv_buf_put_prop(klv_buf_s *buf, uint8_t id, dp_prop_tp_t prop_tp, uint32_t num, const char *str)
+{
+    uint8_t value[4];
+    const uint8_t *data = value;
+    dp_type type;
+    uint16_t len;
+
+    switch (prop_tp) {
+    case PROP_BOOL:
+        type = DT_BOOL;
+        len = 1;
+        value[0] = (num ? 1 : 0);
+        break;
+    case PROP_VALUE:
+    case PROP_BITMAP:
+        type = (PROP_VALUE == prop_tp) ? DT_VALUE : DT_BITMAP;
+        len = 4;
+        __klv_put_be(value, num, len);
+        break;
+    case PROP_ENUM:
+        type = DT_ENUM;
+        len = (num <= 0xff) ? 1 : (num <= 0xffff) ? 2 : 4;
+        __klv_put_be(value, num, len);
+        break;
+    case PROP_STR:
+        type = DT_STRING;
+        data = (const uint8_t *)str;
+        len = (NULL == str) ? 0 : strlen(str);
+        break;
+    default:
+        PR_ERR("unsupport dp type:%d", prop_tp);
+        return OPRT_NOT_SUPPORTED;
+    }
+
+    return klv_buf_put(buf, id, type, data, len);
+}
+
+/**
+ * @brief Parse the next KLV of a received payload in place; node->data
+ * points into data and is not terminated.
+ */
+static OPERATE_RET klv_buf_next(uint8_t *data, uint32_t len, uint32_t *offset, klv_node_s *node)
+{
+    uint32_t pos = *offset;
+
+    if ((len - pos) < KLV_HEAD_LEN) {
+        return OPRT_COM_ERROR;
+    }
+
+    node->next = NULL;
+    node->id = data[pos++];
+    node->type = data[pos++];
+    node->len = (data[pos] << 8) + data[pos + 1];
+    pos += 2;
+
+    if ((len - pos) < node->len) { // is remain data len enougn?
+        return OPRT_COM_ERROR;
+    }
+    node->data = (node->len > 0) ? &data[pos] : NULL;
+    *offset = pos + node->len;
+    return OPRT_OK;
+}
+
 static OPERATE_RET __result_code_resp(uint16_t type, uint32_t ack_sn, uint8_t result_code)
 {
     return tuya_ble_send(type, ack_sn, &result_code, 1);
@@ -401,6 +545,42 @@ klv_node_s *__make_obj_dp_klv_list(dp_rept_in_t *dpin)
     return p_node;
 }
 
+static OPERATE_RET __make_obj_dp_data(const dp_rept_in_t *dpin, klv_buf_s *buf)
+{
+    OPERATE_RET rt = OPRT_OK;
+    int index = 0;
+
+    for (index = 0; index < dpin->dpscnt; index++) {
+        dp_obj_t *p_dp = dpin->dps + index;
+        uint32_t num = 0;
+        const char *str = NULL;
+
+        switch (p_dp->type) {
+        case PROP_BOOL:
+            num = p_dp->value.dp_bool;
+            break;
+        case PROP_VALUE:
+            num = (uint32_t)p_dp->value.dp_value;
+            break;
+        case PROP_STR:
+            str = p_dp->value.dp_str;
+            break;
+        case PROP_ENUM:
+            num = p_dp->value.dp_enum;
+            break;
+        case PROP_BITMAP:
+            num = p_dp->value.dp_bitmap;
+            break;
+        default:
+            PR_ERR("p_dp->type:%d invalid", p_dp->type);
+            continue;
+        }
+        TUYA_CALL_ERR_RETURN(klv_buf_put_prop(buf, p_dp->id, p_dp->type, num, str));
+    }
+
+    return OPRT_OK;
+}
+
 OPERATE_RET ty_bt_dp_data_report(klv_node_s *p_node, uint32_t time_stamp)
 {
     OPERATE_RET ret = OPRT_OK;
@@ -498,8 +678,10 @@ uint32_t __dp_get_time_stamp(dp_obj_t *dp_data, const uint32_t cnt)
 
 static int ble_dp_report(const dp_rept_in_t *dpin)
 {
-    klv_node_s *p_node = NULL;
+    OPERATE_RET rt = OPRT_OK;
     uint32_t time_stamp = 0;
+    uint32_t head_len = 0;
+    klv_buf_s buf;
 
     if (NULL == dpin) {
         return OPRT_INVALID_PARM;
@@ -507,23 +689,49 @@ static int ble_dp_report(const dp_rept_in_t *dpin)
 
     switch (dpin->rept_type) {
     case T_OBJ_REPT: {
+        if (NULL == dpin->dps) {
+            return OPRT_INVALID_PARM;
+        }
         time_stamp = __dp_get_time_stamp(dpin->dps, dpin->dpscnt);
-        p_node = __make_obj_dp_klv_list((dp_rept_in_t *)dpin);
-        break;
-    }
-    case T_STAT_REPT: {
-        //! TODO:
         break;
     }
     case T_RAW_REPT: {
-        p_node = make_klv_list(NULL, dpin->dp->id, DT_RAW, dpin->dp->data, dpin->dp->len);
+        if (NULL == dpin->dp) {
+            return OPRT_INVALID_PARM;
+        }
         break;
     }
+    case T_STAT_REPT: //! TODO:
     default:
         return OPRT_INVALID_PARM;
     }
 
-    return ty_bt_dp_data_report(p_node, time_stamp);
+    // one payload buffer for all dps, no per-dp nodes
+    buf.size = TUYA_BLE_TRANSMISSION_MAX_DATA_LEN;
+    buf.data = tal_malloc(buf.size);
+    if (NULL == buf.data) {
+        return OPRT_MALLOC_FAILED;
+    }
+
+    time_stamp = UNI_HTONL(time_stamp);
+    klv_buf_head(&buf, (time_stamp > 0) ? &time_stamp : NULL, FALSE, 0);
+    head_len = buf.len;
+
+    if (T_OBJ_REPT == dpin->rept_type) {
+        rt = __make_obj_dp_data(dpin, &buf);
+    } else {
+        rt = klv_buf_put(&buf, dpin->dp->id, DT_RAW, dpin->dp->data, dpin->dp->len);
+    }
+
+    if (OPRT_OK == rt && buf.len == head_len) {
+        rt = OPRT_INVALID_PARM; // no valid dp
+    }
+    if (OPRT_OK == rt) {
+        uint16_t type = (time_stamp > 0) ? FRM_DP_STAT_REPORT_WITH_TIME_V4 : FRM_DP_STAT_REPORT_V4;
+        rt = __dp_data_report_data(type, buf.data, buf.len);
+    }
+    tal_free(buf.data);
+    return rt;
 }
 
 static int ble_dp_req(ble_packet_t *req, void *priv_data)
@@ -553,16 +761,19 @@ static int ble_dp_req(ble_packet_t *req, void *priv_data)
         return OPRT_CR_CJSON_ERR;
     }
     cJSON_AddItemToObject(p_root, "dps", p_dps);
-    klv_node_s *list = NULL;
-    int ret = data_2_klvlist(data, len, &list);
-    if (OPRT_OK != ret) {
-        PR_ERR("parse err:%d", ret);
-        cJSON_Delete(p_root);
-        return OPRT_CJSON_PARSE_ERR;
-    }
 
-    klv_node_s *p_tmp = list;
-    while (p_tmp != NULL) {
+    // KLVs are parsed in place, the values stay in the request buffer
+    uint32_t offset = 0;
+    klv_node_s node;
+    klv_node_s *p_tmp = &node;
+    int ret = OPRT_OK;
+    do {
+        ret = klv_buf_next(data, len, &offset, p_tmp);
+        if (OPRT_OK != ret) {
+            PR_ERR("parse err:%d", ret);
+            ret = OPRT_CJSON_PARSE_ERR;
+            goto EXIT;
+        }
         PR_DEBUG("ble dp id:%d type:%d len:%d", p_tmp->id, p_tmp->type, p_tmp->len);
         char dp_id_str[5] = {0};
         snprintf(dp_id_str, 5, "%d", p_tmp->id);
@@ -580,48 +791,70 @@ static int ble_dp_req(ble_packet_t *req, void *priv_data)
             break;
         }
         case DT_BOOL: {
+            if (0 == p_tmp->len) {
+                PR_ERR("dp %d bool len 0", p_tmp->id);
+                break;
+            }
             cJSON_AddBoolToObject(p_dps, dp_id_str, *(p_tmp->data));
             break;
         }
         case DT_BITMAP:
         case DT_VALUE: {
-            int val = (p_tmp->data[0] << 24) + (p_tmp->data[1] << 16) + (p_tmp->data[2] << 8) + (p_tmp->data[3] << 0);
+            int val = (int)__klv_get_be(p_tmp->data, p_tmp->len);
             cJSON_AddNumberToObject(p_dps, dp_id_str, val);
             break;
         }
         case DT_ENUM: {
-            int val = p_tmp->data[0];
+            uint32_t val = __klv_get_be(p_tmp->data, p_tmp->len);
             dp_node_t *dpnode = dp_node_find(tuya_iot_client_get()->schema, p_tmp->id);
             if (NULL == dpnode) {
                 PR_ERR("invalid dp id[%d]", p_tmp->id);
                 break;
             }
+            if (val >= (uint32_t)dpnode->prop.prop_enum.cnt) {
+                PR_ERR("dp %d enum %u out of range", p_tmp->id, val);
+                break;
+            }
             cJSON_AddStringToObject(p_dps, dp_id_str, dpnode->prop.prop_enum.pp_enum[val]);
             break;
         }
 
         case DT_STRING: {
-            // In the Bluetooth protocol, empty strings do not include a
-            // terminator and require special handling.
-            char *str_val = (NULL == p_tmp->data) ? "" : (char *)(p_tmp->data);
+            // In the Bluetooth protocol, strings do not include a
+            // terminator; short ones are terminated on the stack.
+            char str_buf[DT_STR_MAX + 1];
+            char *str_val = str_buf;
+            if (p_tmp->len > DT_STR_MAX) {
+                str_val = tal_malloc(p_tmp->len + 1);
+                if (NULL == str_val) {
+                    PR_ERR("malloc str failed, len:%d", p_tmp->len);
+                    ret = OPRT_MALLOC_FAILED;
+                    goto EXIT;
+                }
+            }
+            if (p_tmp->len > 0) {
+                memcpy(str_val, p_tmp->data, p_tmp->len);
+            }
+            str_val[p_tmp->len] = 0;
             cJSON_AddStringToObject(p_dps, dp_id_str, str_val);
+            if (str_val != str_buf) {
+                tal_free(str_val);
+            }
             break;
         }
         default:
             PR_NOTICE("type not support:%d", p_tmp->type);
             break;
         }
-        p_tmp = p_tmp->next;
-    }
+    } while (offset < len);
+
     ret = tuya_iot_dp_parse(tuya_iot_client_get(), DP_CMD_BT, p_root);
-    free_klv_list(list);
     if (ret != OPRT_OK) {
         cJSON_Delete(p_root);
     }
     return ret;
 
 EXIT:
-    free_klv_list(list);
     cJSON_Delete(p_root);
     return ret;
 }
@@ -635,11 +868,21 @@ static int ble_dp_query(ble_packet_t *req, void *priv_data)
     dp_schema_t *schema = dp_schema_find(tuya_iot_client_get()->activate.devid);
 
     int i;
-    klv_node_s *p_node = NULL;
+    uint32_t head_len = 0;
+    klv_buf_s buf;
     if (schema == NULL) {
         PR_DEBUG("schema null");
         return OPRT_INVALID_PARM;
     }
+
+    buf.size = TUYA_BLE_TRANSMISSION_MAX_DATA_LEN;
+    buf.data = tal_malloc(buf.size);
+    if (NULL == buf.data) {
+        return OPRT_MALLOC_FAILED;
+    }
+    klv_buf_head(&buf, NULL, TRUE, 0);
+    head_len = buf.len;
+
     tal_mutex_lock(schema->mutex);
     for (i = 0; i < schema->num; i++) {
         dp_node_t *dpnode = &(schema->node[i]);
@@ -651,60 +894,42 @@ static int ble_dp_query(ble_packet_t *req, void *priv_data)
             // do nth for now
         }
         if (dpnode->desc.type == T_OBJ) {
-            dp_type new_type = 0;
-            void *new_data = NULL;
-            uint16_t new_len = 0;
+            uint32_t num = 0;
+            const char *str = NULL;
 
             switch (dpnode->desc.prop_tp) {
             case PROP_BOOL: {
-                new_type = DT_BOOL;
-                new_data = &(dpnode->prop.prop_bool.value);
-                new_len = DT_BOOL_LEN;
+                num = dpnode->prop.prop_bool.value;
             } break;
             case PROP_VALUE: {
-                new_type = DT_VALUE;
-                new_data = &(dpnode->prop.prop_int.value);
-                new_len = DT_VALUE_LEN;
+                num = (uint32_t)dpnode->prop.prop_int.value;
             } break;
             case PROP_STR: {
-                new_type = DT_STRING;
-                new_data = dpnode->prop.prop_str.value;
-                if(dpnode->prop.prop_str.value) {
-                    new_len = strlen(dpnode->prop.prop_str.value);
-                }else {
-                    new_len = 0;
-                }
+                str = dpnode->prop.prop_str.value;
             } break;
             case PROP_ENUM: {
-                new_type = DT_ENUM;
-                new_data = &(dpnode->prop.prop_enum.value);
-                new_len = DT_ENUM_LEN;
+                num = (uint32_t)dpnode->prop.prop_enum.value;
             } break;
             case PROP_BITMAP: {
-                new_type = DT_BITMAP;
-                new_data = &(dpnode->prop.prop_bitmap.value);
-                new_len = DT_BITMAP_MAX;
+                num = dpnode->prop.prop_bitmap.value;
             } break;
             default: {
                 PR_ERR("unsupport dp type:%d", dpnode->desc.prop_tp);
-            } break;
+                continue;
+            }
+            }
+            if (OPRT_OK != klv_buf_put_prop(&buf, dpnode->desc.id, dpnode->desc.prop_tp, num, str)) {
+                break;
             }
-            p_node = make_klv_list(p_node, dpnode->desc.id, new_type, new_data, new_len);
         }
 
     } /* end of for */
     tal_mutex_unlock(schema->mutex);
 
-    if (p_node != NULL) {
-        uint16_t type = FRM_DP_STAT_REPORT_V4;
-        uint8_t *p_new_data = NULL;
-        uint32_t new_data_len = 0;
-
-        klvlist_2_data(p_node, &p_new_data, &new_data_len, NULL, TRUE, 0);
-        free_klv_list(p_node);
-        __dp_data_report_data(type, p_new_data, new_data_len);
-        tal_free(p_new_data);
+    if (buf.len > head_len) {
+        __dp_data_report_data(FRM_DP_STAT_REPORT_V4, buf.data, buf.len);
     }
+    tal_free(buf.data);
 
     return OPRT_OK;
 }
@@ -37,6 +37,39 @@
 #define BLE_CONN_MONITOR_TIME 30000
 /* ID  (id == uuid)*/
 #define BLE_ID_LEN 16
+
+// ATT MTU until the peer negotiates a larger one, and the notify header
+#define BLE_ATT_MTU_DEFAULT 23
+#define BLE_ATT_HEADER_LEN  3
+
+/* Connection parameters, N * 1.25ms intervals and N * 10ms timeouts, kept
+ * inside the iOS accessory limits. Fast while bulk data moves, idle after
+ * BLE_CONN_IDLE_MS without traffic. */
+#ifndef BLE_CONN_FAST_INTERVAL_MIN
+#define BLE_CONN_FAST_INTERVAL_MIN 12 // 15ms
+#endif
+#ifndef BLE_CONN_FAST_INTERVAL_MAX
+#define BLE_CONN_FAST_INTERVAL_MAX 24 // 30ms
+#endif
+#ifndef BLE_CONN_FAST_SUP_TIMEOUT
+#define BLE_CONN_FAST_SUP_TIMEOUT 400 // 4s
+#endif
+#ifndef BLE_CONN_IDLE_INTERVAL_MIN
+#define BLE_CONN_IDLE_INTERVAL_MIN 320 // 400ms
+#endif
+#ifndef BLE_CONN_IDLE_INTERVAL_MAX
+#define BLE_CONN_IDLE_INTERVAL_MAX 400 // 500ms
+#endif
+#ifndef BLE_CONN_IDLE_LATENCY
+#define BLE_CONN_IDLE_LATENCY 2
+#endif
+#ifndef BLE_CONN_IDLE_SUP_TIMEOUT
+#define BLE_CONN_IDLE_SUP_TIMEOUT 600 // 6s, over 3 * (1 + latency) * max interval
+#endif
+#ifndef BLE_CONN_IDLE_MS
+#define BLE_CONN_IDLE_MS 5000
+#endif
+
 typedef struct {
     ble_session_fn_t function;
     void *priv_data;
@@ -59,6 +92,7 @@ typedef struct {
 
     TIMER_ID pair_timer; //! Illegal pairing detection
     TIMER_ID monitor_timer;
+    TIMER_ID conn_timer; //! relaxes the connection once traffic stops
 
     uint8_t pair_rand[6];
     bool is_paired;
@@ -66,6 +100,9 @@ typedef struct {
     //! tal ble
     TAL_BLE_ROLE_E role;
     TAL_BLE_PEER_INFO_T peer_info;
+    uint16_t att_mtu; //! negotiated ATT MTU of the current connection
+    ble_conn_policy_t conn_policy;
+    TAL_BLE_CONN_PARAMS_T conn_param; //! as reported by the stack
     //! adv & scan rsp
     uint8_t adv_len;
     uint8_t adv_data[BLE_ADV_DATA_LEN];
@@ -114,6 +151,83 @@ void tuya_ble_enable_debug(bool enable)
     s_ble_debug = enable;
 }
 
+static void ble_conn_policy_set(tuya_ble_mgr_t *ble, ble_conn_policy_t policy)
+{
+    int rt = OPRT_OK;
+    TAL_BLE_CONN_PARAMS_T param = {0};
+
+    if (BLE_CONN_POLICY_FAST == policy) {
+        param.min_conn_interval = BLE_CONN_FAST_INTERVAL_MIN;
+        param.max_conn_interval = BLE_CONN_FAST_INTERVAL_MAX;
+        param.latency = 0;
+        param.conn_sup_timeout = BLE_CONN_FAST_SUP_TIMEOUT;
+    } else {
+        param.min_conn_interval = BLE_CONN_IDLE_INTERVAL_MIN;
+        param.max_conn_interval = BLE_CONN_IDLE_INTERVAL_MAX;
+        param.latency = BLE_CONN_IDLE_LATENCY;
+        param.conn_sup_timeout = BLE_CONN_IDLE_SUP_TIMEOUT;
+    }
+    ble->conn_policy = policy;
+    PR_DEBUG("ble conn policy %s, interval:%d-%d latency:%d", (BLE_CONN_POLICY_FAST == policy) ? "fast" : "idle",
+             param.min_conn_interval, param.max_conn_interval, param.latency);
+    // the central may refuse, the link then keeps its parameters
+    TUYA_CALL_ERR_LOG(tal_ble_conn_param_update(ble->peer_info, &param));
+}
+
+/**
+ * @brief Tracks link traffic for the connection parameter policy.
+ *
+ * Bulk traffic moves an idle link to the fast parameters, any traffic on a
+ * fast link pushes the idle timeout back.
+ */
+static void ble_conn_activity(tuya_ble_mgr_t *ble, bool bulk)
+{
+    if (BLE_CONN_POLICY_NONE == ble->conn_policy) {
+        return;
+    }
+
+    if (BLE_CONN_POLICY_IDLE == ble->conn_policy) {
+        if (!bulk) {
+            return;
+        }
+        ble_conn_policy_set(ble, BLE_CONN_POLICY_FAST);
+    }
+    tal_sw_timer_start(ble->conn_timer, BLE_CONN_IDLE_MS, TAL_TIMER_ONCE);
+}
+
+static void ble_conn_idle_timer_cb(TIMER_ID timer_id, void *arg)
+{
+    tuya_ble_mgr_t *ble = (tuya_ble_mgr_t *)arg;
+
+    if (BLE_CONN_POLICY_FAST == ble->conn_policy) {
+        ble_conn_policy_set(ble, BLE_CONN_POLICY_IDLE);
+    }
+}
+
+/**
+ * @brief Gets the connection parameters of the current BLE link.
+ *
+ * @param info Filled with the requested policy and the parameters in use.
+ * @return OPRT_OK on success, OPRT_RESOURCE_NOT_READY if BLE is not
+ * initialized.
+ */
+int tuya_ble_conn_info_get(ble_conn_info_t *info)
+{
+    tuya_ble_mgr_t *ble = s_ble_mgr;
+
+    if (NULL == info) {
+        return OPRT_INVALID_PARM;
+    }
+    if (NULL == ble) {
+        return OPRT_RESOURCE_NOT_READY;
+    }
+
+    info->policy = ble->conn_policy;
+    memcpy(&info->conn, &ble->conn_param, sizeof(TAL_BLE_CONN_PARAMS_T));
+    info->att_mtu = ble->att_mtu;
+    return OPRT_OK;
+}
+
 static int ble_adv_set(tuya_ble_mgr_t *ble)
 {
     tuya_iot_client_t *client = ble->cfg.client;
@@ -591,6 +705,23 @@ __exit:
     return OPRT_COM_ERROR;
 }
 
+/**
+ * @brief Largest air subpackage for the current connection.
+ *
+ * The app announces its packet size in the device info query; a notification
+ * can carry no more than the negotiated ATT MTU allows, so use the smaller.
+ */
+static uint16_t ble_link_packet_len(tuya_ble_mgr_t *ble)
+{
+    uint16_t pkg_len = ble_frame_packet_len_get();
+    uint16_t mtu = ble->att_mtu ? ble->att_mtu : BLE_ATT_MTU_DEFAULT;
+
+    if (pkg_len > mtu - BLE_ATT_HEADER_LEN) {
+        pkg_len = mtu - BLE_ATT_HEADER_LEN;
+    }
+    return pkg_len;
+}
+
 static int ble_packet_resp(tuya_ble_mgr_t *ble, ble_packet_t *resp)
 {
     int rt = OPRT_OK;
@@ -600,11 +731,13 @@ static int ble_packet_resp(tuya_ble_mgr_t *ble, ble_packet_t *resp)
     uint32_t outlen;
 
     TUYA_CALL_ERR_GOTO(ble_packet_encode(ble, resp, &outbuf, &outlen), __exit);
-    uint16_t buf_len = ble_frame_packet_len_get();
+    uint16_t buf_len = ble_link_packet_len(ble);
+    ble_conn_activity(ble, outlen > buf_len);
     rt = OPRT_MALLOC_FAILED;
     TUYA_CHECK_NULL_GOTO(pbuf = (uint8_t *)tal_malloc(buf_len), __exit);
     memset(pbuf, 0, buf_len);
     TUYA_CHECK_NULL_GOTO(trsmitr = ble_frame_trsmitr_create(), __exit);
+    TUYA_CALL_ERR_GOTO(ble_frame_trsmitr_subpacket_max_set(trsmitr, buf_len), __exit);
     do {
         rt = ble_frame_trsmitr_send_pkg_encode(trsmitr, TUYA_BLE_PROTOCOL_VERSION_HIGN, outbuf, outlen);
         if (OPRT_OK != rt && OPRT_SVC_BT_API_TRSMITR_CONTINUE != rt) {
@@ -832,18 +965,12 @@ static int ble_dev_info_req(ble_packet_t *req, void *priv_data)
     // Gets the Bluetooth subcontract length from the protocol
     uint16_t pkg_len = (req->data[0] << 8 & 0xff00) + (req->data[1] & 0xff);
     ble_frame_packet_len_set(pkg_len);
-    ble_frame_trsmitr_t *trsmitr = ble->packet_recv->trsmitr;
-    if (trsmitr->subpkg) {
-        tal_free(trsmitr->subpkg);
-        trsmitr->subpkg = NULL;
-    }
-    trsmitr->subpkg = (uint8_t *)tal_malloc(pkg_len);
-    if (trsmitr->subpkg == NULL) {
-        PR_ERR("malloc err:%d", pkg_len);
-        return OPRT_MALLOC_FAILED;
+    rt = ble_frame_trsmitr_subpacket_max_set(ble->packet_recv->trsmitr, pkg_len);
+    if (OPRT_OK != rt) {
+        return rt;
     }
-    memset(trsmitr->subpkg, 0, pkg_len);
-    PR_NOTICE("ble dev info: state:%d, pkg_len:%d", *ble->is_bound, ble_frame_packet_len_get());
+    PR_NOTICE("ble dev info: state:%d, pkg_len:%d, mtu:%d, link pkg_len:%d", *ble->is_bound,
+              ble_frame_packet_len_get(), ble->att_mtu, ble_link_packet_len(ble));
 
     pbuf = (uint8_t *)tal_malloc(buf_len);
     if (NULL == pbuf) {
@@ -928,20 +1055,46 @@ static void tal_ble_event_callback(void *data)
     case TAL_BLE_EVT_PERIPHERAL_CONNECT: {
         if (msg->ble_event.connect.result == 0) {
             memcpy(&ble->peer_info, &msg->ble_event.connect.peer, sizeof(TAL_BLE_PEER_INFO_T));
+            ble->att_mtu = BLE_ATT_MTU_DEFAULT;
             ble->recv_sn = 0;
             ble->send_sn = 1;
+            memset(&ble->conn_param, 0, sizeof(TAL_BLE_CONN_PARAMS_T));
             tal_sw_timer_start(ble->pair_timer, BLE_CONN_MONITOR_TIME, TAL_TIMER_ONCE);
+            // pairing and provisioning follow right away
+            ble_conn_policy_set(ble, BLE_CONN_POLICY_FAST);
+            tal_sw_timer_start(ble->conn_timer, BLE_CONN_IDLE_MS, TAL_TIMER_ONCE);
             PR_NOTICE("Ble Connected");
         } else {
             memset(&ble->peer_info, 0, sizeof(TAL_BLE_PEER_INFO_T));
         }
     } break;
 
+    case TAL_BLE_EVT_MTU_REQUEST: {
+        // the host stack has already answered with its preferred MTU
+        if (msg->ble_event.exchange_mtu.conn_handle == ble->peer_info.conn_handle) {
+            ble->att_mtu = msg->ble_event.exchange_mtu.mtu;
+            PR_NOTICE("Ble MTU:%d, link pkg_len:%d", ble->att_mtu, ble_link_packet_len(ble));
+        }
+    } break;
+
+    case TAL_BLE_EVT_CONN_PARAM_UPDATE: {
+        if (msg->ble_event.conn_param.conn_handle == ble->peer_info.conn_handle) {
+            memcpy(&ble->conn_param, &msg->ble_event.conn_param.conn, sizeof(TAL_BLE_CONN_PARAMS_T));
+            PR_NOTICE("Ble conn param interval:%d-%d latency:%d timeout:%d", ble->conn_param.min_conn_interval,
+                      ble->conn_param.max_conn_interval, ble->conn_param.latency, ble->conn_param.conn_sup_timeout);
+        }
+    } break;
+
     case TAL_BLE_EVT_DISCONNECT: {
         memset(&ble->peer_info, 0x00, sizeof(TAL_BLE_PEER_INFO_T));
+        ble->att_mtu = 0;
+        ble->conn_policy = BLE_CONN_POLICY_NONE;
+        memset(&ble->conn_param, 0, sizeof(TAL_BLE_CONN_PARAMS_T));
+        tal_sw_timer_stop(ble->conn_timer);
         memset(ble->pair_rand, 0x00, sizeof(ble->pair_rand));
         tal_sw_timer_stop(ble->pair_timer);
         ble->is_paired = false;
+        tuya_ble_cryption_reset();
         if (!tuya_iot_is_connected()) {
             ble_adv_update(ble);
         }
@@ -958,6 +1111,8 @@ static void tal_ble_event_callback(void *data)
             report = &msg->ble_event.write_report.report;
             PR_TRACE("BLE Package len %d", report->len);
             ret = ble_packet_recv(ble, report->p_data, report->len, &packet);
+            // a frame spread over several writes is bulk traffic
+            ble_conn_activity(ble, OPRT_SVC_BT_API_TRSMITR_CONTINUE == ret);
             if (OPRT_OK != ret) {
                 if (ret != OPRT_SVC_BT_API_TRSMITR_CONTINUE) {
                     PR_ERR("tuya_ble_data_proc fail. %d", ret);
@@ -1015,6 +1170,9 @@ int tuya_ble_deinit(void)
     if (ble->monitor_timer) {
         tal_sw_timer_delete(ble->monitor_timer);
     }
+    if (ble->conn_timer) {
+        tal_sw_timer_delete(ble->conn_timer);
+    }
     if (ble->packet_recv && ble->packet_recv->trsmitr) {
         ble_frame_trsmitr_delete(ble->packet_recv->trsmitr);
     }
@@ -1025,6 +1183,7 @@ int tuya_ble_deinit(void)
     tuya_ble_session_del(BLE_SESSION_CHANNEL);
     tuya_ble_session_del(BLE_SESSION_DP);
     tal_ble_bt_deinit(ble->role);
+    tuya_ble_cryption_reset();
     tal_free(ble);
     s_ble_mgr = NULL;
 
@@ -1085,6 +1244,7 @@ int tuya_ble_init(tuya_ble_cfg_t *cfg)
         return OPRT_MALLOC_FAILED;
     }
     s_ble_mgr = ble;
+    TUYA_CALL_ERR_GOTO(tuya_ble_cryption_init(), __exit);
     memcpy(&ble->cfg, cfg, sizeof(tuya_ble_cfg_t));
     ble->is_bound = &ble->cfg.client->is_activated;
     if (strlen(ble->cfg.client->config.uuid) >= 20) {
@@ -1100,6 +1260,7 @@ int tuya_ble_init(tuya_ble_cfg_t *cfg)
     ble->crypto_param.pair_rand = (uint8_t *)ble->pair_rand;
     TUYA_CALL_ERR_GOTO(tal_sw_timer_create(ble_pair_timeout_cb, ble, &ble->pair_timer), __exit);
     TUYA_CALL_ERR_GOTO(tal_sw_timer_create(ble_mointor_timer_cb, ble, &ble->monitor_timer), __exit);
+    TUYA_CALL_ERR_GOTO(tal_sw_timer_create(ble_conn_idle_timer_cb, ble, &ble->conn_timer), __exit);
     TUYA_CALL_ERR_GOTO(tal_sw_timer_start(ble->monitor_timer, 3000, TAL_TIMER_CYCLE), __exit);
     tuya_ble_session_add(BLE_SESSION_SYSTEM, ble_session_system_process, ble);
     tuya_ble_session_add(BLE_SESSION_CHANNEL, ble_session_channel_process, ble);
@@ -20,6 +20,7 @@
 #include "tuya_cloud_types.h"
 #include "ble_protocol.h"
 #include "ble_cryption.h"
+#include "tal_bluetooth_def.h"
 #include "tuya_iot.h"
 
 #ifdef __cplusplus
@@ -50,6 +51,25 @@ typedef struct {
 
 typedef void (*ble_session_fn_t)(ble_packet_t *packet, void *priv_data);
 
+/**
+ * @brief Connection parameter policy of the current link.
+ *
+ * The link asks for a short interval while bulk data moves (provisioning,
+ * WiFi scan lists, multi-packet frames) and relaxes to a long interval with
+ * slave latency after BLE_CONN_IDLE_MS without traffic.
+ */
+typedef enum {
+    BLE_CONN_POLICY_NONE, //! no connection
+    BLE_CONN_POLICY_FAST,
+    BLE_CONN_POLICY_IDLE,
+} ble_conn_policy_t;
+
+typedef struct {
+    ble_conn_policy_t policy;   //! last requested policy
+    TAL_BLE_CONN_PARAMS_T conn; //! parameters reported by the stack, 0 until the first update
+    uint16_t att_mtu;
+} ble_conn_info_t;
+
 /**
  * @brief Initializes the Tuya BLE module.
  *
@@ -105,6 +125,15 @@ int tuya_ble_send_packet(ble_packet_t *packet);
  */
 void tuya_ble_enable_debug(bool enable);
 
+/**
+ * @brief Gets the connection parameters of the current BLE link.
+ *
+ * @param info Filled with the requested policy and the parameters in use.
+ * @return OPRT_OK on success, OPRT_RESOURCE_NOT_READY if BLE is not
+ * initialized.
+ */
+int tuya_ble_conn_info_get(ble_conn_info_t *info);
+
 /**
  * @brief Prints the raw data buffer.
  *
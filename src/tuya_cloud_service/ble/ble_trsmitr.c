@@ -47,17 +47,50 @@ ble_frame_trsmitr_t *ble_frame_trsmitr_create(void)
         return NULL;
     }
     memset(trsmitr, 0, sizeof(ble_frame_trsmitr_t));
-    trsmitr->subpkg = (uint8_t *)tal_malloc(ble_frame_packet_len_get());
-    if (trsmitr->subpkg == NULL) {
-        PR_ERR("malloc err:%d", ble_frame_packet_len_get());
+    if (OPRT_OK != ble_frame_trsmitr_subpacket_max_set(trsmitr, ble_frame_packet_len_get())) {
         tal_free(trsmitr);
         return NULL;
     }
-    memset(trsmitr->subpkg, 0, ble_frame_packet_len_get());
 
     return trsmitr;
 }
 
+/**
+ * @brief Sets the subpackage size of one BLE frame transmitter.
+ *
+ * @param trsmitr The BLE frame transmitter.
+ * @param len Subpackage size in bytes.
+ * @return OPRT_OK on success, OPRT_INVALID_PARM or OPRT_MALLOC_FAILED on error.
+ */
+int ble_frame_trsmitr_subpacket_max_set(ble_frame_trsmitr_t *trsmitr, uint16_t len)
+{
+    // room for the largest subpackage header plus at least one data byte
+    if (NULL == trsmitr || len <= BLE_FRAME_SUBPKG_HEAD_MAX) {
+        return OPRT_INVALID_PARM;
+    }
+
+    if (trsmitr->subpkg && trsmitr->subpkg_max == len) {
+        return OPRT_OK;
+    }
+
+    uint8_t *subpkg = (uint8_t *)tal_malloc(len);
+    if (NULL == subpkg) {
+        PR_ERR("malloc err:%d", len);
+        return OPRT_MALLOC_FAILED;
+    }
+    memset(subpkg, 0, len);
+
+    if (trsmitr->subpkg) {
+        tal_free(trsmitr->subpkg);
+    }
+    trsmitr->subpkg = subpkg;
+    trsmitr->subpkg_max = len;
+    trsmitr->subpkg_len = 0;
+    trsmitr->pkg_desc = BLE_FRAME_PKG_INIT;
+
+    return OPRT_OK;
+}
+
 /**
  * @brief Deletes a BLE frame transmitter.
  *
@@ -206,12 +239,12 @@ int ble_frame_trsmitr_send_pkg_encode(ble_frame_trsmitr_t *trsmitr, unsigned cha
     }
 
     // frame data transfer
-    uint16_t send_data = (ble_frame_packet_len_get() - sunpkg_offset);
+    uint16_t send_data = (trsmitr->subpkg_max - sunpkg_offset);
     if ((len - trsmitr->pkg_trsmitr_cnt) < send_data) {
         send_data = len - trsmitr->pkg_trsmitr_cnt;
     }
 
-    PR_TRACE("pkg max len:%d, sunpkg_offset:%d, send_data:%d", ble_frame_packet_len_get(), sunpkg_offset, send_data);
+    PR_TRACE("pkg max len:%d, sunpkg_offset:%d, send_data:%d", trsmitr->subpkg_max, sunpkg_offset, send_data);
 
     memcpy(&(trsmitr->subpkg[sunpkg_offset]), buf + trsmitr->pkg_trsmitr_cnt, send_data);
     trsmitr->subpkg_len = sunpkg_offset + send_data;
@@ -257,7 +290,7 @@ int ble_frame_trsmitr_send_pkg_encode(ble_frame_trsmitr_t *trsmitr, unsigned cha
  */
 int ble_frame_trsmitr_recv_pkg_decode(ble_frame_trsmitr_t *trsmitr, unsigned char *raw_data, uint16_t raw_data_len)
 {
-    if (NULL == raw_data || NULL == trsmitr) { //|| (raw_data_len > ble_frame_packet_len_get())
+    if (NULL == raw_data || NULL == trsmitr || 0 == raw_data_len || raw_data_len > trsmitr->subpkg_max) {
         return OPRT_INVALID_PARM;
     }
 
@@ -276,7 +309,7 @@ int ble_frame_trsmitr_recv_pkg_decode(ble_frame_trsmitr_t *trsmitr, unsigned cha
     unsigned char digit;
     ble_frame_subpkg_num_t subpkg_num = 0;
     // Package number
-    for (i = 0; i < 4; i++) {
+    for (i = 0; i < 4 && sunpkg_offset < raw_data_len; i++) {
         digit = raw_data[sunpkg_offset++];
         subpkg_num += (digit & 0x7f) * multiplier;
         multiplier *= 0x80;
@@ -317,7 +350,7 @@ int ble_frame_trsmitr_recv_pkg_decode(ble_frame_trsmitr_t *trsmitr, unsigned cha
     if (0 == trsmitr->subpkg_num) {
         // frame len decode
         multiplier = 1;
-        for (i = 0; i < 4; i++) {
+        for (i = 0; i < 4 && sunpkg_offset < raw_data_len; i++) {
             digit = raw_data[sunpkg_offset++];
             trsmitr->total += (digit & 0x7f) * multiplier;
             multiplier *= 0x80;
@@ -331,6 +364,11 @@ int ble_frame_trsmitr_recv_pkg_decode(ble_frame_trsmitr_t *trsmitr, unsigned cha
             return OPRT_COM_ERROR;
         }
 
+        // a head cut short by the air packet would leave a negative data length
+        if (sunpkg_offset >= raw_data_len) {
+            return OPRT_INVALID_PARM;
+        }
+
         // frame type and frame seq decode
         trsmitr->version = (raw_data[sunpkg_offset] & BLE_FRAME_VERSION_OFFSET) >> 4;
         trsmitr->seq = raw_data[sunpkg_offset++] & BLE_FRAME_SEQ_OFFSET;
@@ -35,6 +35,7 @@ extern "C" {
 #define BLE_FRAME_VERSION_OFFSET (0x0f << 4)
 #define BLE_FRAME_SEQ_OFFSET     (0x0f << 0)
 #define BLE_FRAME_SEQ_LMT        16
+#define BLE_FRAME_SUBPKG_HEAD_MAX 9 // subpackage num (4) + frame len (4) + version/seq (1)
 
 // frame total len
 typedef uint32_t ble_frame_total_t;
@@ -63,6 +64,7 @@ typedef struct {
     uint32_t pkg_trsmitr_cnt;          // package process count, number of bytes sent
     ble_frame_subpkg_len_t subpkg_len; // 1 byte, data length in the current subpackage
     uint8_t *subpkg;
+    uint16_t subpkg_max;               // size of subpkg, the largest air packet on this link
 } ble_frame_trsmitr_t;
 
 /***********************************************************
@@ -121,6 +123,21 @@ uint16_t ble_frame_packet_len_get(void);
  */
 void ble_frame_packet_len_set(uint16_t len);
 
+/**
+ * @brief Sets the subpackage size of one BLE frame transmitter.
+ *
+ * Sending fragments into subpackages of this size instead of the module-wide
+ * ble_frame_packet_len_get(), so each connection can use what its ATT MTU
+ * allows. The subpackage buffer is reallocated and any package in progress
+ * is reset.
+ *
+ * @param trsmitr The BLE frame transmitter.
+ * @param len Subpackage size in bytes.
+ * @return OPRT_OK on success, OPRT_INVALID_PARM or OPRT_MALLOC_FAILED on error.
+ */
+__BLE_TRSMITR_EXT
+int ble_frame_trsmitr_subpacket_max_set(ble_frame_trsmitr_t *trsmitr, uint16_t len);
+
 /**
  * @brief Retrieves the subpacket from the given BLE frame transmitter.
  *
@@ -22,6 +22,86 @@
 
 #define MATOP_DEFAULT_BUFFER_LEN (128)
 
+/* -------------------------------------------------------------------------- */
+/*                          Pending request min-heap                          */
+/* -------------------------------------------------------------------------- */
+static bool matop_timeout_before(const mqtt_atop_message_t *a, const mqtt_atop_message_t *b)
+{
+    return (int32_t)(a->timeout - b->timeout) < 0;
+}
+
+static void matop_heap_set(matop_context_t *matop, uint16_t idx, mqtt_atop_message_t *message)
+{
+    matop->pending[idx] = message;
+    message->heap_idx = idx;
+}
+
+static void matop_heap_sift_up(matop_context_t *matop, uint16_t idx)
+{
+    mqtt_atop_message_t *message = matop->pending[idx];
+
+    while (idx > 0) {
+        uint16_t parent = (idx - 1) / 2;
+        if (!matop_timeout_before(message, matop->pending[parent])) {
+            break;
+        }
+        matop_heap_set(matop, idx, matop->pending[parent]);
+        idx = parent;
+    }
+    matop_heap_set(matop, idx, message);
+}
+
+static void matop_heap_sift_down(matop_context_t *matop, uint16_t idx)
+{
+    mqtt_atop_message_t *message = matop->pending[idx];
+
+    for (;;) {
+        uint16_t child = idx * 2 + 1;
+        if (child >= matop->pending_cnt) {
+            break;
+        }
+        if (child + 1 < matop->pending_cnt && matop_timeout_before(matop->pending[child + 1], matop->pending[child])) {
+            child++;
+        }
+        if (!matop_timeout_before(matop->pending[child], message)) {
+            break;
+        }
+        matop_heap_set(matop, idx, matop->pending[child]);
+        idx = child;
+    }
+    matop_heap_set(matop, idx, message);
+}
+
+static void matop_heap_push(matop_context_t *matop, mqtt_atop_message_t *message)
+{
+    matop_heap_set(matop, matop->pending_cnt++, message);
+    matop_heap_sift_up(matop, message->heap_idx);
+}
+
+static void matop_heap_remove(matop_context_t *matop, mqtt_atop_message_t *message)
+{
+    uint16_t idx = message->heap_idx;
+    mqtt_atop_message_t *last = matop->pending[--matop->pending_cnt];
+
+    if (last == message) {
+        return;
+    }
+    matop_heap_set(matop, idx, last);
+    matop_heap_sift_up(matop, idx);
+    matop_heap_sift_down(matop, last->heap_idx);
+}
+
+/* Few requests are pending, a scan of the heap is cheaper than an index */
+static mqtt_atop_message_t *matop_pending_find(matop_context_t *matop, uint32_t id)
+{
+    for (uint16_t i = 0; i < matop->pending_cnt; i++) {
+        if (matop->pending[i]->id == id) {
+            return matop->pending[i];
+        }
+    }
+    return NULL;
+}
+
 /* -------------------------------------------------------------------------- */
 /*                              Internal callback                             */
 /* -------------------------------------------------------------------------- */
@@ -48,20 +128,16 @@ static int matop_service_data_receive_cb(void *context, const uint8_t *input, si
     cJSON *data = cJSON_GetObjectItem(root, "data");
 
     /* found message id */
-    mqtt_atop_message_t *target_message = matop->message_list;
-    while (target_message) {
-        if (target_message->id == id) {
-            break;
-        }
-        target_message = target_message->next;
-    }
-
+    mqtt_atop_message_t *target_message = matop_pending_find(matop, id);
     if (target_message == NULL) {
         PR_WARN("not found id.");
         cJSON_Delete(root);
         return OPRT_COM_ERROR;
     }
 
+    /* out of the heap before the callback, which may send the next request */
+    matop_heap_remove(matop, target_message);
+
     /* result parse */
     bool success = false;
     cJSON *result = NULL;
@@ -82,18 +158,7 @@ static int matop_service_data_receive_cb(void *context, const uint8_t *input, si
     }
 
     cJSON_Delete(root);
-
-    /* remove target from list  */
-    mqtt_atop_message_t **current;
-    for (current = &matop->message_list; *current;) {
-        mqtt_atop_message_t *entry = *current;
-        if (entry == target_message) {
-            *current = entry->next;
-            tal_free(entry);
-        } else {
-            current = &entry->next;
-        }
-    }
+    tal_free(target_message);
     return 0;
 }
 
@@ -110,18 +175,12 @@ static int matop_service_file_rawdata_receive_cb(void *context, const uint8_t *i
     PR_INFO("file data id:%d", id);
 
     /* found message id */
-    mqtt_atop_message_t *target_message = matop->message_list;
-    while (target_message) {
-        if (target_message->id == id) {
-            break;
-        }
-        target_message = target_message->next;
-    }
-
+    mqtt_atop_message_t *target_message = matop_pending_find(matop, id);
     if (target_message == NULL) {
         PR_WARN("not found id.");
         return OPRT_COM_ERROR;
     }
+    matop_heap_remove(matop, target_message);
 
     atop_base_response_t response = {
         .success = true,
@@ -135,18 +194,7 @@ static int matop_service_file_rawdata_receive_cb(void *context, const uint8_t *i
     if (target_message->notify_cb) {
         target_message->notify_cb(&response, target_message->user_data);
     }
-
-    /* remove target from list  */
-    mqtt_atop_message_t **current;
-    for (current = &matop->message_list; *current;) {
-        mqtt_atop_message_t *entry = *current;
-        if (entry == target_message) {
-            *current = entry->next;
-            tal_free(entry);
-        } else {
-            current = &entry->next;
-        }
-    }
+    tal_free(target_message);
     return 0;
 }
 
@@ -228,9 +276,9 @@ int matop_serice_init(matop_context_t *context, const matop_config_t *config)
 /**
  * @brief Performs a yield operation for the MATOP service.
  *
- * This function removes the target from the message list if it has timed out.
- * If a timeout occurs, the corresponding callback function is called with a
- * failure response.
+ * This function removes the requests that have timed out, earliest deadline
+ * first from the pending heap. The callback of each is called with a failure
+ * response.
  *
  * @param context The MATOP context.
  * @return Returns OPRT_INVALID_PARM if the context is NULL, OPRT_TIMEOUT if a
@@ -242,23 +290,20 @@ int matop_serice_yield(matop_context_t *context)
         return OPRT_INVALID_PARM;
     }
 
-    /* remove target from list  */
-    mqtt_atop_message_t **current;
-    for (current = &context->message_list; *current;) {
-        mqtt_atop_message_t *entry = *current;
-        if (tal_system_get_millisecond() > entry->timeout) {
-            PR_WARN("Message id %d timeout.", entry->id);
-            if (entry->notify_cb) {
-                entry->notify_cb(&(atop_base_response_t){.success = false}, entry->user_data);
-            }
-            *current = entry->next;
-            tal_free(entry);
-            return OPRT_TIMEOUT;
-        } else {
-            current = &entry->next;
+    int rt = OPRT_OK;
+    uint32_t now = tal_system_get_millisecond();
+
+    while (context->pending_cnt > 0 && (int32_t)(now - context->pending[0]->timeout) > 0) {
+        mqtt_atop_message_t *entry = context->pending[0];
+        matop_heap_remove(context, entry);
+        PR_WARN("Message id %d timeout.", entry->id);
+        if (entry->notify_cb) {
+            entry->notify_cb(&(atop_base_response_t){.success = false}, entry->user_data);
         }
+        tal_free(entry);
+        rt = OPRT_TIMEOUT;
     }
-    return OPRT_OK;
+    return rt;
 }
 
 /**
@@ -296,12 +341,9 @@ int matop_serice_destory(matop_context_t *context)
     tuya_mqtt_subscribe_message_callback_unregister(context->config.mqctx, topic_buffer);
     PR_DEBUG("MQTT unsubscribe %s result:%d", topic_buffer, ret);
 
-    /* remove target from list when destory */
-    mqtt_atop_message_t **current;
-    for (current = &context->message_list; *current;) {
-        mqtt_atop_message_t *entry = *current;
-        *current = entry->next;
-        tal_free(entry);
+    /* drop the pending requests when destory */
+    while (context->pending_cnt > 0) {
+        tal_free(context->pending[--context->pending_cnt]);
     }
 
     return OPRT_OK;
@@ -333,14 +375,21 @@ int matop_service_request_async(matop_context_t *context, const mqtt_atop_reques
     int rt = OPRT_OK;
     matop_context_t *matop = context;
 
+    if (matop->pending_cnt >= MATOP_INFLIGHT_MAX) {
+        PR_ERR("matop %s: %d requests pending", request->api, matop->pending_cnt);
+        return OPRT_EXCEED_UPPER_LIMIT;
+    }
+
     /* handle init */
     mqtt_atop_message_t *message_handle = tal_malloc(sizeof(mqtt_atop_message_t));
     if (message_handle == NULL) {
         PR_ERR("response_buffer malloc fail");
         return OPRT_MALLOC_FAILED;
     }
-    message_handle->next = NULL;
-    message_handle->id = ++matop->id_cnt;
+    /* ids are 16 bits on the wire, skip 0 and any id still pending */
+    do {
+        message_handle->id = (uint16_t)++matop->id_cnt;
+    } while (message_handle->id == 0 || matop_pending_find(matop, message_handle->id));
     message_handle->timeout =
         tal_system_get_millisecond() + (request->timeout == 0 ? MATOP_TIMEOUT_MS_DEFAULT : request->timeout);
     message_handle->notify_cb = notify_cb;
@@ -425,18 +474,7 @@ int matop_service_request_async(matop_context_t *context, const mqtt_atop_reques
         return rt;
     }
 
-    /* first head message */
-    if (matop->message_list == NULL) {
-        matop->message_list = message_handle;
-        return OPRT_OK;
-    }
-
-    /* add to message list */
-    mqtt_atop_message_t *target = matop->message_list;
-    while (target->next) {
-        target = target->next;
-    }
-    target->next = message_handle;
+    matop_heap_push(matop, message_handle);
 
     return OPRT_OK;
 }
@@ -27,6 +27,14 @@ extern "C" {
 #include "atop_service.h"
 #include "mqtt_service.h"
 
+/**
+ * @brief Requests waiting for their response at once. Responses are matched
+ * by id, so requests need not wait for each other.
+ */
+#ifndef MATOP_INFLIGHT_MAX
+#define MATOP_INFLIGHT_MAX (16)
+#endif
+
 typedef struct {
     const char *api;
     const char *version;
@@ -38,8 +46,8 @@ typedef struct {
 typedef void (*mqtt_atop_response_cb_t)(atop_base_response_t *response, void *user_data);
 
 typedef struct mqtt_atop_message {
-    struct mqtt_atop_message *next;
     uint16_t id;
+    uint16_t heap_idx; // position in matop_context_t.pending
     uint32_t timeout;
     mqtt_atop_response_cb_t notify_cb;
     void *user_data;
@@ -54,7 +62,8 @@ typedef struct matop_context {
     matop_config_t config;
     uint32_t id_cnt;
     char resquest_topic[64];
-    mqtt_atop_message_t *message_list;
+    uint16_t pending_cnt;
+    mqtt_atop_message_t *pending[MATOP_INFLIGHT_MAX]; // min-heap on timeout
 } matop_context_t;
 
 /**
@@ -95,7 +104,8 @@ int matop_serice_destory(matop_context_t *context);
  * @brief Sends an asynchronous request to the MATOP service.
  *
  * This function sends an asynchronous request to the MATOP service using the
- * provided context, request, notification callback, and user data.
+ * provided context, request, notification callback, and user data. It does
+ * not wait for earlier requests, up to MATOP_INFLIGHT_MAX can be pending.
  *
  * @param context The MATOP context.
  * @param request The MQTT ATOP request.
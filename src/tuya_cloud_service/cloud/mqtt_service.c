@@ -29,14 +29,25 @@
 #include "tuya_error_code.h"
 #include "mqtt_client_interface.h"
 #include "cJSON.h"
+#include "json_arena.h"
 #include "mqtt_service.h"
 #include "tal_security.h"
 #include "crc32i.h"
 #include "tal_api.h"
+#include "tal_mempool.h"
 #include "tuya_protocol.h"
+#include "tuya_health.h"
 
 static void on_subscribe_message_default(uint16_t msgid, const mqtt_client_message_t *msg, void *userdata);
 
+/* Most handlers one message can fan out to, matches are copied out of the
+ * lock so callbacks may register or unregister handlers themselves */
+#define MQTT_DISPATCH_MAX 8
+
+#define PROTOCOL_BUCKET(context, id) (&(context)->protocol_table[(id) & (TUYA_MQTT_PROTOCOL_BUCKETS - 1)])
+
+#define PUBLISH_BUCKET(context, msgid) (&(context)->publish_inflight[(msgid) & (TUYA_MQTT_PUBLISH_HASH_SIZE - 1)])
+
 typedef struct {
     uint32_t sequence;
     uint32_t source;
@@ -44,6 +55,228 @@ typedef struct {
     uint8_t data[0];
 } pv22_packet_object_t;
 
+/* publish handles, shared by all contexts, NULL allocates from the heap */
+static MEMPOOL_HANDLE s_publish_pool = NULL;
+
+static void handle_lock(tuya_mqtt_context_t *context)
+{
+    if (context->handle_mutex) {
+        tal_mutex_lock(context->handle_mutex);
+    }
+}
+
+static void handle_unlock(tuya_mqtt_context_t *context)
+{
+    if (context->handle_mutex) {
+        tal_mutex_unlock(context->handle_mutex);
+    }
+}
+
+static void publish_lock(tuya_mqtt_context_t *context)
+{
+    if (context->publish_mutex) {
+        tal_mutex_lock(context->publish_mutex);
+    }
+}
+
+static void publish_unlock(tuya_mqtt_context_t *context)
+{
+    if (context->publish_mutex) {
+        tal_mutex_unlock(context->publish_mutex);
+    }
+}
+
+/* Every pending publish sits in publish_heap ordered by timeout, so expiry
+ * only looks at the top. publish_num is the heap size. */
+static void publish_heap_set(tuya_mqtt_context_t *context, uint16_t index, mqtt_publish_handle_t *handle)
+{
+    context->publish_heap[index] = handle;
+    handle->heap_index = index;
+}
+
+static void publish_heap_up(tuya_mqtt_context_t *context, uint16_t index)
+{
+    mqtt_publish_handle_t *handle = context->publish_heap[index];
+    while (index > 0) {
+        uint16_t parent = (index - 1) / 2;
+        if (context->publish_heap[parent]->timeout <= handle->timeout) {
+            break;
+        }
+        publish_heap_set(context, index, context->publish_heap[parent]);
+        index = parent;
+    }
+    publish_heap_set(context, index, handle);
+}
+
+static void publish_heap_down(tuya_mqtt_context_t *context, uint16_t index)
+{
+    mqtt_publish_handle_t *handle = context->publish_heap[index];
+    for (;;) {
+        uint16_t child = index * 2 + 1;
+        if (child >= context->publish_num) {
+            break;
+        }
+        if (child + 1 < context->publish_num &&
+            context->publish_heap[child + 1]->timeout < context->publish_heap[child]->timeout) {
+            child++;
+        }
+        if (handle->timeout <= context->publish_heap[child]->timeout) {
+            break;
+        }
+        publish_heap_set(context, index, context->publish_heap[child]);
+        index = child;
+    }
+    publish_heap_set(context, index, handle);
+}
+
+/* Queued publishes have msgid 0 and live on publish_head, in-flight ones on
+ * their PUBLISH_BUCKET chain */
+static void publish_unlink(tuya_mqtt_context_t *context, mqtt_publish_handle_t *handle)
+{
+    mqtt_publish_handle_t **head = handle->msgid ? PUBLISH_BUCKET(context, handle->msgid) : &context->publish_head;
+
+    if (handle->prev) {
+        handle->prev->next = handle->next;
+    } else {
+        *head = handle->next;
+    }
+    if (handle->next) {
+        handle->next->prev = handle->prev;
+    } else if (handle->msgid == 0) {
+        context->publish_tail = handle->prev;
+    }
+    if (handle->msgid) {
+        context->inflight_num--;
+        handle->msgid = 0;
+    }
+    handle->next = NULL;
+    handle->prev = NULL;
+}
+
+static void publish_queue_insert(tuya_mqtt_context_t *context, mqtt_publish_handle_t *handle, bool front)
+{
+    if (front) {
+        handle->next = context->publish_head;
+        if (context->publish_head) {
+            context->publish_head->prev = handle;
+        } else {
+            context->publish_tail = handle;
+        }
+        context->publish_head = handle;
+    } else {
+        handle->prev = context->publish_tail;
+        if (context->publish_tail) {
+            context->publish_tail->next = handle;
+        } else {
+            context->publish_head = handle;
+        }
+        context->publish_tail = handle;
+    }
+}
+
+static void publish_inflight_add(tuya_mqtt_context_t *context, mqtt_publish_handle_t *handle, uint16_t msgid)
+{
+    mqtt_publish_handle_t **head = PUBLISH_BUCKET(context, msgid);
+
+    handle->msgid = msgid;
+    handle->prev = NULL;
+    handle->next = *head;
+    if (*head) {
+        (*head)->prev = handle;
+    }
+    *head = handle;
+    context->inflight_num++;
+}
+
+/* The in-flight publish sent last. msgids grow as publishes go out and wrap,
+ * the window is far smaller than half their range. */
+static mqtt_publish_handle_t *publish_inflight_newest(tuya_mqtt_context_t *context)
+{
+    mqtt_publish_handle_t *newest = NULL;
+
+    for (int i = 0; i < TUYA_MQTT_PUBLISH_HASH_SIZE; i++) {
+        for (mqtt_publish_handle_t *entry = context->publish_inflight[i]; entry; entry = entry->next) {
+            if (newest == NULL || (int16_t)(entry->msgid - newest->msgid) > 0) {
+                newest = entry;
+            }
+        }
+    }
+    return newest;
+}
+
+static void publish_enqueue(tuya_mqtt_context_t *context, mqtt_publish_handle_t *handle)
+{
+    publish_queue_insert(context, handle, FALSE);
+    publish_heap_set(context, context->publish_num++, handle);
+    publish_heap_up(context, handle->heap_index);
+}
+
+/* Take a publish out of its list and the heap, the caller owns it after */
+static void publish_detach(tuya_mqtt_context_t *context, mqtt_publish_handle_t *handle)
+{
+    uint16_t index = handle->heap_index;
+
+    publish_unlink(context, handle);
+    context->publish_num--;
+    if (index < context->publish_num) {
+        mqtt_publish_handle_t *last = context->publish_heap[context->publish_num];
+        publish_heap_set(context, index, last);
+        publish_heap_down(context, index);
+        publish_heap_up(context, last->heap_index);
+    }
+}
+
+/* Send queued publishes while the in-flight window has room, locked */
+static void publish_window_fill(tuya_mqtt_context_t *context)
+{
+    while (context->is_connected && context->publish_head && context->inflight_num < context->inflight_max) {
+        mqtt_publish_handle_t *handle = context->publish_head;
+        uint16_t msgid = mqtt_client_publish(context->mqtt_client, handle->topic, handle->payload,
+                                             handle->payload_length, MQTT_QOS_1);
+        if (msgid == 0) {
+            break;
+        }
+        publish_unlink(context, handle);
+        publish_inflight_add(context, handle, msgid);
+    }
+}
+
+/* Report and free a list of detached publishes, unlocked */
+static void publish_complete(mqtt_publish_handle_t *list, int result)
+{
+    while (list) {
+        mqtt_publish_handle_t *handle = list;
+        list = handle->next;
+        handle->cb(result, handle->user_data);
+        tal_mempool_free(s_publish_pool, handle);
+    }
+}
+
+/* Detach every publish whose timeout is before now into a list, locked */
+static mqtt_publish_handle_t *publish_take_expired(tuya_mqtt_context_t *context, SYS_TIME_T now)
+{
+    mqtt_publish_handle_t *list = NULL;
+    mqtt_publish_handle_t **tail = &list;
+
+    while (context->publish_num > 0 && context->publish_heap[0]->timeout <= now) {
+        mqtt_publish_handle_t *handle = context->publish_heap[0];
+        publish_detach(context, handle);
+        *tail = handle;
+        tail = &handle->next;
+    }
+    return list;
+}
+
+/* FNV-1a, computed once per registered topic and once per received message */
+static uint32_t topic_hash(const char *topic, size_t length)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ (uint8_t)topic[i]) * 16777619u;
+    }
+    return hash;
+}
+
 static int tuya_mqtt_signature_tool(const tuya_meta_info_t *input, tuya_mqtt_access_t *signout)
 {
     if (NULL == input || signout == NULL) {
@@ -120,15 +353,25 @@ int tuya_mqtt_subscribe_message_callback_register(tuya_mqtt_context_t *context,
         return OPRT_COM_ERROR;
     }
 
+    size_t topic_length = strlen(topic);
+    uint32_t hash = topic_hash(topic, topic_length);
+    if (!cb) {
+        cb = on_subscribe_message_default;
+    }
+
     /* Repetition filter */
+    handle_lock(context);
     mqtt_subscribe_handle_t *target = context->subscribe_list;
     while (target) {
-        if (!memcmp(target->topic, topic, target->topic_length) && target->cb == cb) {
+        if (target->topic_hash == hash && target->topic_length == topic_length &&
+            !memcmp(target->topic, topic, topic_length) && target->cb == cb) {
+            handle_unlock(context);
             PR_WARN("Repetition:%s", topic);
             return OPRT_OK;
         }
         target = target->next;
     }
+    handle_unlock(context);
 
     /* Intser new handle */
     mqtt_subscribe_handle_t *newtarget = tal_calloc(1, sizeof(mqtt_subscribe_handle_t));
@@ -137,7 +380,8 @@ int tuya_mqtt_subscribe_message_callback_register(tuya_mqtt_context_t *context,
         return OPRT_MALLOC_FAILED;
     }
 
-    newtarget->topic_length = strlen(topic);
+    newtarget->topic_length = topic_length;
+    newtarget->topic_hash = hash;
     newtarget->topic = tal_calloc(1, newtarget->topic_length + 1);
     if (!newtarget->topic) {
         tal_free(newtarget);
@@ -145,16 +389,12 @@ int tuya_mqtt_subscribe_message_callback_register(tuya_mqtt_context_t *context,
     }
     memcpy(newtarget->topic, topic, newtarget->topic_length);
 
-    if (cb) {
-        newtarget->cb = cb;
-    } else {
-        newtarget->cb = on_subscribe_message_default;
-    }
+    newtarget->cb = cb;
     newtarget->userdata = userdata;
-    /* LOCK */
+    handle_lock(context);
     newtarget->next = context->subscribe_list;
     context->subscribe_list = newtarget;
-    /* UNLOCK */
+    handle_unlock(context);
     return OPRT_OK;
 }
 
@@ -178,13 +418,15 @@ int tuya_mqtt_subscribe_message_callback_unregister(tuya_mqtt_context_t *context
     }
 
     size_t topic_length = strlen(topic);
+    uint32_t hash = topic_hash(topic, topic_length);
 
-    /* LOCK */
+    handle_lock(context);
     /* Remove object form list */
     mqtt_subscribe_handle_t **target = &context->subscribe_list;
     while (*target) {
         mqtt_subscribe_handle_t *entry = *target;
-        if (entry->topic_length == topic_length && !memcmp(topic, entry->topic, topic_length)) {
+        if (entry->topic_hash == hash && entry->topic_length == topic_length &&
+            !memcmp(topic, entry->topic, topic_length)) {
             *target = entry->next;
             tal_free(entry->topic);
             tal_free(entry);
@@ -192,7 +434,7 @@ int tuya_mqtt_subscribe_message_callback_unregister(tuya_mqtt_context_t *context
             target = &entry->next;
         }
     }
-    /* UNLOCK */
+    handle_unlock(context);
 
     uint16_t msgid = mqtt_client_unsubscribe(context->mqtt_client, topic, MQTT_QOS_1);
     if (msgid <= 0) {
@@ -207,20 +449,82 @@ static void mqtt_subscribe_message_distribute(tuya_mqtt_context_t *context, uint
 {
     const char *topic = msg->topic;
     size_t topic_length = strlen(msg->topic);
+    uint32_t hash = topic_hash(topic, topic_length);
+    mqtt_subscribe_message_cb_t cbs[MQTT_DISPATCH_MAX];
+    void *userdatas[MQTT_DISPATCH_MAX];
+    int num = 0;
 
-    /* LOCK */
+    handle_lock(context);
     mqtt_subscribe_handle_t *target = context->subscribe_list;
-    for (; target; target = target->next) {
-        if (target->topic_length == topic_length && !memcmp(topic, target->topic, target->topic_length)) {
-            target->cb(msgid, msg, target->userdata);
+    for (; target && num < MQTT_DISPATCH_MAX; target = target->next) {
+        if (target->topic_hash == hash && target->topic_length == topic_length &&
+            !memcmp(topic, target->topic, topic_length)) {
+            cbs[num] = target->cb;
+            userdatas[num++] = target->userdata;
         }
     }
-    /* UNLOCK */
+    handle_unlock(context);
+
+    for (int i = 0; i < num; i++) {
+        cbs[i](msgid, msg, userdatas[i]);
+    }
 }
 
 /* -------------------------------------------------------------------------- */
 /*                       Tuya internal subscribe message                      */
 /* -------------------------------------------------------------------------- */
+/* Deliver a message from its tokens when every handler of the protocol is a
+ * scan handler, OPRT_NOT_SUPPORTED means the caller must build the cJSON tree */
+static int tuya_protocol_message_scan_process(tuya_mqtt_context_t *context, char *jsonstr)
+{
+    json_tok_t *toks = context->scan_toks;
+    int tok_num = json_scan(jsonstr, strlen(jsonstr), toks, TUYA_MQTT_SCAN_TOKENS);
+    if (tok_num <= 0) {
+        return OPRT_NOT_SUPPORTED;
+    }
+
+    int protocol_tok = json_scan_find(jsonstr, toks, tok_num, 0, "protocol");
+    int data_tok = json_scan_find(jsonstr, toks, tok_num, 0, "data");
+    if (protocol_tok < 0 || data_tok < 0 || json_scan_find(jsonstr, toks, tok_num, 0, "t") < 0 ||
+        toks[protocol_tok].type != JSON_TOK_PRIMITIVE) {
+        /* let the cJSON path report it */
+        return OPRT_NOT_SUPPORTED;
+    }
+    int protocol_id = json_scan_int(jsonstr, &toks[protocol_tok]);
+
+    tuya_protocol_callback_t cbs[MQTT_DISPATCH_MAX];
+    void *user_datas[MQTT_DISPATCH_MAX];
+    int num = 0;
+
+    handle_lock(context);
+    tuya_protocol_handle_t *target = *PROTOCOL_BUCKET(context, protocol_id);
+    for (; target && num < MQTT_DISPATCH_MAX; target = target->next) {
+        if (target->id != protocol_id) {
+            continue;
+        }
+        if (!target->scan) {
+            handle_unlock(context);
+            return OPRT_NOT_SUPPORTED;
+        }
+        cbs[num] = target->cb;
+        user_datas[num++] = target->user_data;
+    }
+    handle_unlock(context);
+
+    tuya_protocol_event_t event = {0};
+    event.event_id = protocol_id;
+    event.json = jsonstr;
+    event.toks = toks;
+    event.tok_num = tok_num;
+    event.data_tok = data_tok;
+    for (int i = 0; i < num; i++) {
+        event.user_data = user_datas[i];
+        cbs[i](&event);
+    }
+
+    return OPRT_OK;
+}
+
 static int tuya_protocol_message_parse_process(tuya_mqtt_context_t *context, const uint8_t *payload, size_t payload_len)
 {
     int ret = OPRT_OK;
@@ -235,13 +539,20 @@ static int tuya_protocol_message_parse_process(tuya_mqtt_context_t *context, con
 
     PR_DEBUG("Data JSON:%s", jsonstr);
 
-    /* json parse */
+    if (OPRT_OK == tuya_protocol_message_scan_process(context, jsonstr)) {
+        tal_free(jsonstr);
+        return OPRT_OK;
+    }
+
+    /* json parse, the tree lives in an arena until the handlers returned */
     cJSON *root = NULL;
     cJSON *json = NULL;
-    root = cJSON_Parse((const char *)jsonstr);
+    JSON_ARENA_T arena;
+    root = json_arena_parse(&arena, (const char *)jsonstr);
     tal_free(jsonstr);
     if (NULL == root) {
         PR_ERR("JSON parse error");
+        json_arena_end(&arena);
         return OPRT_CJSON_PARSE_ERR;
     }
 
@@ -250,6 +561,7 @@ static int tuya_protocol_message_parse_process(tuya_mqtt_context_t *context, con
         (NULL == cJSON_GetObjectItem(root, "data"))) {
         PR_ERR("param is no correct");
         cJSON_Delete(root);
+        json_arena_end(&arena);
         return OPRT_CJSON_GET_ERR;
     }
 
@@ -259,25 +571,37 @@ static int tuya_protocol_message_parse_process(tuya_mqtt_context_t *context, con
     if (NULL == json) {
         PR_ERR("get json err");
         cJSON_Delete(root);
+        json_arena_end(&arena);
         return OPRT_CJSON_GET_ERR;
     }
 
     /* dispatch */
-    tuya_protocol_event_t event;
+    tuya_protocol_event_t event = {0};
     event.event_id = protocol_id;
     event.root_json = root;
     event.data = cJSON_GetObjectItem(root, "data");
 
-    /* LOCK */
-    tuya_protocol_handle_t *target = context->protocol_list;
-    for (; target; target = target->next) {
+    tuya_protocol_callback_t cbs[MQTT_DISPATCH_MAX];
+    void *user_datas[MQTT_DISPATCH_MAX];
+    int num = 0;
+
+    handle_lock(context);
+    tuya_protocol_handle_t *target = *PROTOCOL_BUCKET(context, protocol_id);
+    for (; target && num < MQTT_DISPATCH_MAX; target = target->next) {
         if (target->id == protocol_id) {
-            event.user_data = target->user_data, target->cb(&event);
+            cbs[num] = target->cb;
+            user_datas[num++] = target->user_data;
         }
     }
-    /* UNLOCK */
+    handle_unlock(context);
+
+    for (int i = 0; i < num; i++) {
+        event.user_data = user_datas[i];
+        cbs[i](&event);
+    }
 
     cJSON_Delete(root);
+    json_arena_end(&arena);
     return OPRT_OK;
 }
 
@@ -314,6 +638,18 @@ static void mqtt_client_disconnected_cb(void *client, void *userdata)
     tuya_mqtt_context_t *context = (tuya_mqtt_context_t *)userdata;
     PR_INFO("mqtt client disconnected!");
     context->is_connected = false;
+
+    /* in-flight publishes are sent again with a new msgid after reconnect,
+     * ahead of the queued ones and in their original order: newest first to
+     * the front leaves the oldest at the head */
+    publish_lock(context);
+    mqtt_publish_handle_t *handle = NULL;
+    while ((handle = publish_inflight_newest(context)) != NULL) {
+        publish_unlink(context, handle);
+        publish_queue_insert(context, handle, TRUE);
+    }
+    publish_unlock(context);
+
     if (context->on_disconnect) {
         context->on_disconnect(context, context->user_data);
     }
@@ -329,6 +665,62 @@ static void mqtt_client_message_cb(void *client, uint16_t msgid, const mqtt_clie
     mqtt_subscribe_message_distribute(context, msgid, msg);
 }
 
+/* Every topic streams: a message within the network buffer is passed on as
+ * is, a larger one is collected first */
+static void mqtt_client_chunk_cb(void *client, uint16_t msgid, const mqtt_client_chunk_t *chunk, void *userdata)
+{
+    tuya_mqtt_context_t *context = (tuya_mqtt_context_t *)userdata;
+
+    if (chunk->offset == 0 && chunk->len == chunk->total) {
+        mqtt_client_message_cb(client, msgid,
+                               &(const mqtt_client_message_t){
+                                   .topic = chunk->topic,
+                                   .payload = chunk->data,
+                                   .length = chunk->len,
+                                   .qos = chunk->qos,
+                               },
+                               userdata);
+        return;
+    }
+
+    if (chunk->offset == 0) {
+        tal_free(context->recv_buf);
+        context->recv_buf = NULL;
+        if (chunk->data && chunk->total <= TUYA_MQTT_RECV_MAX) {
+            context->recv_buf = tal_malloc(chunk->total);
+        }
+        if (context->recv_buf == NULL) {
+            PR_ERR("recv message dropped, TopicName:%s, payload len:%d", chunk->topic, (int)chunk->total);
+        }
+        context->recv_len = 0;
+    }
+
+    if (context->recv_buf == NULL) {
+        return;
+    }
+
+    if (chunk->data == NULL) {
+        tal_free(context->recv_buf);
+        context->recv_buf = NULL;
+        return;
+    }
+
+    memcpy(context->recv_buf + context->recv_len, chunk->data, chunk->len);
+    context->recv_len += chunk->len;
+    if (context->recv_len == chunk->total) {
+        mqtt_client_message_cb(client, msgid,
+                               &(const mqtt_client_message_t){
+                                   .topic = chunk->topic,
+                                   .payload = context->recv_buf,
+                                   .length = context->recv_len,
+                                   .qos = chunk->qos,
+                               },
+                               userdata);
+        tal_free(context->recv_buf);
+        context->recv_buf = NULL;
+    }
+}
+
 static void mqtt_client_subscribed_cb(void *client, uint16_t msgid, void *userdata)
 {
     client = client;
@@ -342,20 +734,17 @@ static void mqtt_client_puback_cb(void *client, uint16_t msgid, void *userdata)
     tuya_mqtt_context_t *context = (tuya_mqtt_context_t *)userdata;
     PR_DEBUG("PUBACK ID:%d", msgid);
 
-    /* LOCK */
-    /* publish async process */
-    mqtt_publish_handle_t **next_handle = &context->publish_list;
-    for (; *next_handle; next_handle = &(*next_handle)->next) {
-        mqtt_publish_handle_t *entry = *next_handle;
-        if (msgid == entry->msgid) {
-            entry->cb(OPRT_OK, entry->user_data);
-            *next_handle = entry->next;
-            tal_free(entry->payload);
-            tal_free(entry);
-            break;
-        }
+    publish_lock(context);
+    mqtt_publish_handle_t *entry = *PUBLISH_BUCKET(context, msgid);
+    while (entry && entry->msgid != msgid) {
+        entry = entry->next;
     }
-    /* UNLOCK */
+    if (entry) {
+        publish_detach(context, entry);
+    }
+    publish_unlock(context);
+
+    publish_complete(entry, OPRT_OK);
 }
 
 /**
@@ -382,6 +771,28 @@ int tuya_mqtt_init(tuya_mqtt_context_t *context, const tuya_mqtt_config_t *confi
     context->on_connected = config->on_connected;
     context->on_disconnect = config->on_disconnect;
 
+    rt = tal_mutex_create_init(&context->handle_mutex);
+    if (OPRT_OK != rt) {
+        PR_ERR("mqtt handle mutex create error:%d", rt);
+        return rt;
+    }
+
+    rt = tal_mutex_create_init(&context->publish_mutex);
+    if (OPRT_OK != rt) {
+        PR_ERR("mqtt publish mutex create error:%d", rt);
+        return rt;
+    }
+    context->inflight_max = TUYA_MQTT_PUBLISH_INFLIGHT;
+    context->publish_drop_oldest = true;
+
+#if TUYA_MQTT_PUBLISH_POOL_NUM > 0
+    /* without the pool publishes fall back to the heap */
+    if (NULL == s_publish_pool) {
+        tal_mempool_create("mqtt_pub", sizeof(mqtt_publish_handle_t) + TUYA_MQTT_PUBLISH_POOL_BLOCK,
+                           TUYA_MQTT_PUBLISH_POOL_NUM, MEMPOOL_RAM_SRAM, &s_publish_pool);
+    }
+#endif
+
     /* Device token signature */
     rt = tuya_mqtt_signature_tool(
         &(const tuya_meta_info_t){
@@ -425,6 +836,7 @@ int tuya_mqtt_init(tuya_mqtt_context_t *context, const tuya_mqtt_config_t *confi
         PR_ERR("MQTT init failed: Status = %d.", mqtt_status);
         return OPRT_COM_ERROR;
     }
+    mqtt_client_stream_register(context->mqtt_client, "#", mqtt_client_chunk_cb, context);
 
     BackoffAlgorithm_InitializeParams(&context->backoff_algorithm, MQTT_CONNECT_RETRY_MIN_DELAY_MS,
                                       MQTT_CONNECT_RETRY_MAX_DELAY_MS, MQTT_CONNECT_RETRY_MAX_ATTEMPTS);
@@ -516,6 +928,41 @@ int tuya_mqtt_stop(tuya_mqtt_context_t *context)
     return OPRT_OK;
 }
 
+static int mqtt_protocol_handle_add(tuya_mqtt_context_t *context, uint16_t protocol_id, tuya_protocol_callback_t cb,
+                                    void *user_data, bool scan)
+{
+    if (context == NULL || context->is_inited == false || cb == NULL) {
+        return OPRT_INVALID_PARM;
+    }
+
+    tuya_protocol_handle_t *new_handle = tal_calloc(1, sizeof(tuya_protocol_handle_t));
+    if (!new_handle) {
+        return OPRT_MALLOC_FAILED;
+    }
+    new_handle->id = protocol_id;
+    new_handle->scan = scan;
+    new_handle->cb = cb;
+    new_handle->user_data = user_data;
+
+    handle_lock(context);
+    /* Repetition filter */
+    tuya_protocol_handle_t **bucket = PROTOCOL_BUCKET(context, protocol_id);
+    tuya_protocol_handle_t *target = *bucket;
+    while (target) {
+        if (target->id == protocol_id && target->cb == cb) {
+            handle_unlock(context);
+            tal_free(new_handle);
+            return OPRT_COM_ERROR;
+        }
+        target = target->next;
+    }
+    new_handle->next = *bucket;
+    *bucket = new_handle;
+    handle_unlock(context);
+
+    return OPRT_OK;
+}
+
 /**
  * @brief Registers a MQTT protocol with the given context.
  *
@@ -534,32 +981,27 @@ int tuya_mqtt_stop(tuya_mqtt_context_t *context)
 int tuya_mqtt_protocol_register(tuya_mqtt_context_t *context, uint16_t protocol_id, tuya_protocol_callback_t cb,
                                 void *user_data)
 {
-    if (context == NULL || context->is_inited == false || cb == NULL) {
-        return OPRT_INVALID_PARM;
-    }
-
-    /* LOCK */
-    /* Repetition filter */
-    tuya_protocol_handle_t *target = context->protocol_list;
-    while (target) {
-        if (target->id == protocol_id && target->cb == cb) {
-            return OPRT_COM_ERROR;
-        }
-        target = target->next;
-    }
-
-    tuya_protocol_handle_t *new_handle = tal_calloc(1, sizeof(tuya_protocol_handle_t));
-    if (!new_handle) {
-        return OPRT_MALLOC_FAILED;
-    }
-    new_handle->id = protocol_id;
-    new_handle->cb = cb;
-    new_handle->user_data = user_data;
-    new_handle->next = context->protocol_list;
-    context->protocol_list = new_handle;
-    /* UNLOCK */
+    return mqtt_protocol_handle_add(context, protocol_id, cb, user_data, false);
+}
 
-    return OPRT_OK;
+/**
+ * @brief Registers a MQTT protocol handler that can read the message tokens.
+ *
+ * The handler gets the json_scan() tokens instead of a cJSON tree whenever
+ * all handlers of the protocol are scan handlers and the message fits the
+ * token arena, otherwise it gets the cJSON event as usual.
+ *
+ * @param[in] context The MQTT context to register the protocol with.
+ * @param[in] protocol_id The ID of the protocol to register.
+ * @param[in] cb The callback function.
+ * @param[in] user_data User data to be passed to the callback function.
+ *
+ * @return 0 on success, negative error code on failure.
+ */
+int tuya_mqtt_protocol_register_scan(tuya_mqtt_context_t *context, uint16_t protocol_id, tuya_protocol_callback_t cb,
+                                     void *user_data)
+{
+    return mqtt_protocol_handle_add(context, protocol_id, cb, user_data, true);
 }
 
 /**
@@ -580,9 +1022,9 @@ int tuya_mqtt_protocol_unregister(tuya_mqtt_context_t *context, uint16_t protoco
         return OPRT_INVALID_PARM;
     }
 
-    /* LOCK */
+    handle_lock(context);
     /* Remove object form list */
-    tuya_protocol_handle_t **target = &context->protocol_list;
+    tuya_protocol_handle_t **target = PROTOCOL_BUCKET(context, protocol_id);
     while (*target) {
         tuya_protocol_handle_t *entry = *target;
         if (entry->id == protocol_id && entry->cb == cb) {
@@ -592,7 +1034,7 @@ int tuya_mqtt_protocol_unregister(tuya_mqtt_context_t *context, uint16_t protoco
             target = &entry->next;
         }
     }
-    /* UNLOCK */
+    handle_unlock(context);
 
     return OPRT_OK;
 }
@@ -612,18 +1054,19 @@ int tuya_mqtt_protocol_unregister_all(tuya_mqtt_context_t *context)
     }
 
     PR_DEBUG("Unregister all MQTT Protocol");
-    /* LOCK */
+    handle_lock(context);
     /* Remove object form list */
-    tuya_protocol_handle_t *entry = NULL;
-    tuya_protocol_handle_t *target = context->protocol_list;
-    while (target) {
-        entry = target;
-        target = entry->next;
-        tal_free(entry);
+    for (int i = 0; i < TUYA_MQTT_PROTOCOL_BUCKETS; i++) {
+        tuya_protocol_handle_t *entry = NULL;
+        tuya_protocol_handle_t *target = context->protocol_table[i];
+        while (target) {
+            entry = target;
+            target = entry->next;
+            tal_free(entry);
+        }
+        context->protocol_table[i] = NULL;
     }
-    /* UNLOCK */
-
-    context->protocol_list = NULL;
+    handle_unlock(context);
 
     return OPRT_OK;
 }
@@ -659,41 +1102,64 @@ int tuya_mqtt_client_publish_common(tuya_mqtt_context_t *context, const char *to
         return OPRT_OK;
     }
 
-    mqtt_publish_handle_t *handle = tal_malloc(sizeof(mqtt_publish_handle_t));
+    /* one block holds the handle, the topic and the payload, so async
+     * callers need not keep either alive */
+    size_t topic_len = strlen(topic) + 1;
+    mqtt_publish_handle_t *handle =
+        tal_mempool_alloc(s_publish_pool, sizeof(mqtt_publish_handle_t) + topic_len + payload_length);
     TUYA_CHECK_NULL_RETURN(handle, OPRT_MALLOC_FAILED);
-    handle->next = NULL;
-    handle->msgid = 0;
-    handle->topic = (char *)topic;
-    handle->timeout = tal_time_get_posix() + timeout_ms;
+    memset(handle, 0, sizeof(mqtt_publish_handle_t));
+    handle->topic = (char *)(handle + 1);
+    memcpy(handle->topic, topic, topic_len);
+    handle->payload = (uint8_t *)handle->topic + topic_len;
+    memcpy(handle->payload, payload, payload_length);
+    handle->payload_length = payload_length;
+    handle->timeout = tal_system_get_millisecond() + timeout_ms;
     handle->cb = cb;
     handle->user_data = user_data;
-    handle->payload_length = payload_length;
-    if (payload_length > 0) {
-        handle->payload = tal_malloc(payload_length);
-        if (handle->payload == NULL) {
-            tal_free(handle);
-            return OPRT_MALLOC_FAILED;
+
+    mqtt_publish_handle_t *dropped = NULL;
+    publish_lock(context);
+    if (context->publish_num >= TUYA_MQTT_PUBLISH_QUEUE_MAX) {
+        if (!context->publish_drop_oldest || context->publish_head == NULL) {
+            publish_unlock(context);
+            tal_mempool_free(s_publish_pool, handle);
+            return OPRT_EXCEED_UPPER_LIMIT;
         }
-        memcpy(handle->payload, payload, payload_length);
-    } else {
-        handle->payload = NULL;
+        dropped = context->publish_head;
+        publish_detach(context, dropped);
     }
-
+    publish_enqueue(context, handle);
     if (async == false) {
-        handle->msgid = mqtt_client_publish(context->mqtt_client, handle->topic, handle->payload,
-                                            handle->payload_length, MQTT_QOS_1);
+        publish_window_fill(context);
     }
+    publish_unlock(context);
 
-    if (context->publish_list == NULL) {
-        context->publish_list = handle;
-        return OPRT_OK;
+    if (dropped) {
+        PR_WARN("publish queue full, drop the oldest");
+        publish_complete(dropped, OPRT_EXCEED_UPPER_LIMIT);
     }
+    return OPRT_OK;
+}
 
-    mqtt_publish_handle_t *last = context->publish_list;
-    while (last->next != NULL) {
-        last = last->next;
+/**
+ * @brief Configures the QoS1 in-flight window and the queue overflow policy.
+ *
+ * @param context The MQTT context.
+ * @param inflight_max The in-flight window, at least 1.
+ * @param drop_oldest Drop the oldest queued publish when the queue is full.
+ * @return 0 on success, or a negative error code on failure.
+ */
+int tuya_mqtt_publish_queue_config(tuya_mqtt_context_t *context, uint8_t inflight_max, bool drop_oldest)
+{
+    if (context == NULL || inflight_max == 0) {
+        return OPRT_INVALID_PARM;
     }
-    last->next = handle;
+
+    publish_lock(context);
+    context->inflight_max = inflight_max;
+    context->publish_drop_oldest = drop_oldest;
+    publish_unlock(context);
 
     return OPRT_OK;
 }
@@ -838,6 +1304,12 @@ int tuya_mqtt_loop(tuya_mqtt_context_t *context)
         return rt;
     }
 
+    /* publish timeouts run while disconnected too */
+    publish_lock(context);
+    mqtt_publish_handle_t *expired = publish_take_expired(context, tal_system_get_millisecond());
+    publish_unlock(context);
+    publish_complete(expired, OPRT_TIMEOUT);
+
     /* reconnect */
     if (context->is_connected == false) {
         mqtt_status = mqtt_client_connect(context->mqtt_client);
@@ -861,29 +1333,24 @@ int tuya_mqtt_loop(tuya_mqtt_context_t *context)
         return rt;
     }
 
-    /* LOCK */
-    /* publish async process */
-    mqtt_publish_handle_t **next_handle = &context->publish_list;
-    for (; *next_handle; next_handle = &(*next_handle)->next) {
-        mqtt_publish_handle_t *entry = *next_handle;
-
-        if (entry->timeout <= tal_time_get_posix()) {
-            entry->cb(OPRT_TIMEOUT, entry->user_data);
-            *next_handle = entry->next;
-            tal_free(entry->payload);
-            tal_free(entry);
-            continue;
-        }
-
-        if (entry->msgid <= 0) {
-            entry->msgid =
-                mqtt_client_publish(context->mqtt_client, entry->topic, entry->payload, entry->payload_length, 1);
-        }
+    /* async publishes and the ones the window held back */
+    uint32_t wait_ms = MQTT_LOOP_IDLE_MAX_MS;
+    publish_lock(context);
+    publish_window_fill(context);
+    if (context->publish_num > 0) {
+        SYS_TIME_T now = tal_system_get_millisecond();
+        SYS_TIME_T deadline = context->publish_heap[0]->timeout;
+        wait_ms = (deadline <= now) ? 0 : (uint32_t)MIN(deadline - now, (SYS_TIME_T)wait_ms);
     }
-    /* UNLOCK */
+    publish_unlock(context);
 
-    /* yield */
-    mqtt_client_yield(context->mqtt_client);
+    /* sleep on the socket until it is readable, the keepalive is due or
+     * the earliest publish times out */
+    mqtt_client_wait(context->mqtt_client, wait_ms);
+
+    /* the radio is up for the keepalive or traffic, run health checks close
+     * to due now rather than waking up for them later */
+    tuya_health_align();
 
     return rt;
 }
@@ -904,15 +1371,43 @@ int tuya_mqtt_destory(tuya_mqtt_context_t *context)
     }
 
     tuya_mqtt_protocol_unregister_all(context);
+
+    publish_lock(context);
+    mqtt_publish_handle_t *pending = publish_take_expired(context, (SYS_TIME_T)-1);
+    publish_unlock(context);
+    publish_complete(pending, OPRT_COM_ERROR);
+
     if (context->mqtt_client) {
         mqtt_client_status_t mqtt_status = mqtt_client_deinit(context->mqtt_client);
         mqtt_client_free(context->mqtt_client);
         context->mqtt_client = NULL;
+        tal_free(context->recv_buf);
+        context->recv_buf = NULL;
         if (mqtt_status != MQTT_STATUS_SUCCESS) {
             return OPRT_COM_ERROR;
         }
     }
 
+    handle_lock(context);
+    mqtt_subscribe_handle_t *sub = context->subscribe_list;
+    while (sub) {
+        mqtt_subscribe_handle_t *entry = sub;
+        sub = entry->next;
+        tal_free(entry->topic);
+        tal_free(entry);
+    }
+    context->subscribe_list = NULL;
+    handle_unlock(context);
+
+    if (context->handle_mutex) {
+        tal_mutex_release(context->handle_mutex);
+        context->handle_mutex = NULL;
+    }
+    if (context->publish_mutex) {
+        tal_mutex_release(context->publish_mutex);
+        context->publish_mutex = NULL;
+    }
+
     return OPRT_OK;
 }
 
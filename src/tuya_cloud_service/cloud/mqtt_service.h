@@ -30,6 +30,8 @@ extern "C" {
 #include "cJSON.h"
 #include "mqtt_client_interface.h"
 #include "backoff_algorithm.h"
+#include "tal_mutex.h"
+#include "json_scan.h"
 
 // data max len
 #define TUYA_MQTT_CLIENTID_MAXLEN   (32U)
@@ -123,20 +125,36 @@ typedef struct {
     char topic_out[TUYA_MQTT_TOPIC_MAXLEN + 1];
 } tuya_mqtt_access_t;
 
+/* Token arena of the scanned dispatch path, larger messages fall back to cJSON */
+#define TUYA_MQTT_SCAN_TOKENS 64
+
 typedef struct {
     uint16_t event_id;
+    /* Live in a parse arena, valid only during the callback: a handler
+     * that keeps a part duplicates it */
     cJSON *root_json;
     cJSON *data;
     void *user_data;
+    /* Set instead of root_json/data for handlers registered with
+     * tuya_mqtt_protocol_register_scan() when the message was scanned,
+     * valid only during the callback */
+    char *json;
+    json_tok_t *toks;
+    int tok_num;
+    int data_tok;
 } tuya_protocol_event_t;
 
 typedef tuya_protocol_event_t tuya_mqtt_event_t; // compat TODO:remove
 
 typedef void (*tuya_protocol_callback_t)(tuya_protocol_event_t *event);
 
+/* Protocol handlers are bucketed by (id & (TUYA_MQTT_PROTOCOL_BUCKETS - 1)) */
+#define TUYA_MQTT_PROTOCOL_BUCKETS 16
+
 typedef struct tuya_protocol_handle {
     struct tuya_protocol_handle *next;
     uint16_t id;
+    bool scan;
     tuya_protocol_callback_t cb;
     void *user_data;
 } tuya_protocol_handle_t;
@@ -147,16 +165,49 @@ typedef struct mqtt_subscribe_handle {
     struct mqtt_subscribe_handle *next;
     char *topic;
     size_t topic_length;
+    uint32_t topic_hash;
     mqtt_subscribe_message_cb_t cb;
     void *userdata;
 } mqtt_subscribe_handle_t;
 
 typedef void (*mqtt_publish_notify_cb_t)(int result, void *user_data);
 
+/* Publishes waiting for PUBACK or their turn, callers get OPRT_EXCEED_UPPER_LIMIT beyond this */
+#ifndef TUYA_MQTT_PUBLISH_QUEUE_MAX
+#define TUYA_MQTT_PUBLISH_QUEUE_MAX 32
+#endif
+
+/* Default QoS1 in-flight window, see tuya_mqtt_publish_queue_config() */
+#ifndef TUYA_MQTT_PUBLISH_INFLIGHT
+#define TUYA_MQTT_PUBLISH_INFLIGHT 8
+#endif
+
+/* QoS1 publishes whose topic and payload fit TUYA_MQTT_PUBLISH_POOL_BLOCK bytes
+ * come from a block pool shared by all contexts, 0 disables the pool */
+#ifndef TUYA_MQTT_PUBLISH_POOL_NUM
+#define TUYA_MQTT_PUBLISH_POOL_NUM 8
+#endif
+
+#ifndef TUYA_MQTT_PUBLISH_POOL_BLOCK
+#define TUYA_MQTT_PUBLISH_POOL_BLOCK 256
+#endif
+
+/* Largest message taken in: one that does not fit CORE_MQTT_BUFFER_SIZE
+ * streams in and is collected in a heap buffer only while it arrives */
+#ifndef TUYA_MQTT_RECV_MAX
+#define TUYA_MQTT_RECV_MAX (16 * 1024)
+#endif
+
+/* In-flight publishes are hashed by (msgid & (TUYA_MQTT_PUBLISH_HASH_SIZE - 1)) */
+#define TUYA_MQTT_PUBLISH_HASH_SIZE 16
+
 typedef struct mqtt_publish_handle {
+    /* queued list while msgid is 0, in-flight hash chain after */
     struct mqtt_publish_handle *next;
+    struct mqtt_publish_handle *prev;
     uint16_t msgid;
-    int timeout;
+    uint16_t heap_index;
+    SYS_TIME_T timeout;
     char *topic;
     uint8_t *payload;
     size_t payload_length;
@@ -167,9 +218,21 @@ typedef struct mqtt_publish_handle {
 typedef struct {
     void *mqtt_client;
     tuya_mqtt_access_t signature;
-    tuya_protocol_handle_t *protocol_list;
+    tuya_protocol_handle_t *protocol_table[TUYA_MQTT_PROTOCOL_BUCKETS];
     mqtt_subscribe_handle_t *subscribe_list;
-    mqtt_publish_handle_t *publish_list;
+    MUTEX_HANDLE handle_mutex; /* protects protocol_table and subscribe_list */
+    json_tok_t scan_toks[TUYA_MQTT_SCAN_TOKENS];
+    mqtt_publish_handle_t *publish_head; /* queued QoS1 publishes, oldest first */
+    mqtt_publish_handle_t *publish_tail;
+    mqtt_publish_handle_t *publish_inflight[TUYA_MQTT_PUBLISH_HASH_SIZE];
+    mqtt_publish_handle_t *publish_heap[TUYA_MQTT_PUBLISH_QUEUE_MAX]; /* min-heap by timeout */
+    uint16_t publish_num;
+    uint8_t inflight_num;
+    uint8_t inflight_max;
+    bool publish_drop_oldest;
+    MUTEX_HANDLE publish_mutex;
+    uint8_t *recv_buf; /* message collected from streamed chunks */
+    size_t recv_len;
     BackoffAlgorithmContext_t backoff_algorithm;
     uint32_t sequence_in;
     uint32_t sequence_out;
@@ -265,6 +328,25 @@ bool tuya_mqtt_connected(tuya_mqtt_context_t *context);
 int tuya_mqtt_protocol_register(tuya_mqtt_context_t *context, uint16_t protocol_id, tuya_protocol_callback_t cb,
                                 void *user_data);
 
+/**
+ * @brief Registers a MQTT protocol handler that can read the message tokens.
+ *
+ * Like tuya_mqtt_protocol_register(), but when every handler of the protocol
+ * was registered this way the message is only tokenized with json_scan() and
+ * no cJSON tree is built. The event then carries json/toks/data_tok and a NULL
+ * root_json. Messages that do not fit the token arena are still delivered as
+ * cJSON, so the callback must handle both forms.
+ *
+ * @param context The MQTT context to register the protocol with.
+ * @param protocol_id The ID of the protocol to register.
+ * @param cb The callback function.
+ * @param user_data User data to be passed to the callback function.
+ *
+ * @return 0 on success, or a negative error code on failure.
+ */
+int tuya_mqtt_protocol_register_scan(tuya_mqtt_context_t *context, uint16_t protocol_id, tuya_protocol_callback_t cb,
+                                     void *user_data);
+
 /**
  * @brief Unregisters a MQTT protocol with the specified protocol ID and
  * callback function.
@@ -378,6 +460,21 @@ int tuya_mqtt_client_publish_common(tuya_mqtt_context_t *context, const char *to
                                     size_t payload_length, mqtt_publish_notify_cb_t cb, void *user_data, int timeout_ms,
                                     bool async);
 
+/**
+ * @brief Configures the QoS1 publish queue.
+ *
+ * At most inflight_max publishes wait for their PUBACK at a time, the rest
+ * stay queued in order. When TUYA_MQTT_PUBLISH_QUEUE_MAX publishes are
+ * pending, a new one either drops the oldest queued publish or is refused,
+ * the dropped one reports OPRT_EXCEED_UPPER_LIMIT through its callback.
+ *
+ * @param context The MQTT context.
+ * @param inflight_max The in-flight window, at least 1.
+ * @param drop_oldest Drop the oldest queued publish instead of the new one.
+ * @return 0 on success, or a negative error code on failure.
+ */
+int tuya_mqtt_publish_queue_config(tuya_mqtt_context_t *context, uint8_t inflight_max, bool drop_oldest);
+
 /**
  * @brief Registers a callback function for handling MQTT subscribe messages.
  *
@@ -37,6 +37,16 @@
 #define MQTT_RECV_BLOCK_TIME_MS (2000U)
 #endif
 
+/**
+ * @brief Longest an idle MQTT loop sleeps on the socket, bounding how late
+ * the caller's own state machine runs. Keepalive and publish timeouts wake
+ * it earlier.
+ *
+ */
+#ifndef MQTT_LOOP_IDLE_MAX_MS
+#define MQTT_LOOP_IDLE_MAX_MS (10000U)
+#endif
+
 /**
  * @brief MQTT keep alive period.
  *
@@ -97,4 +107,12 @@
 #define MATOP_TIMEOUT_MS_DEFAULT (8000U)
 #endif
 
+/**
+ * @brief Delay (in seconds) after an MQTT connect before the DPs changed
+ * offline are uploaded, lets the subscriptions settle first.
+ */
+#ifndef TUYA_IOT_DP_SYNC_DELAY_S
+#define TUYA_IOT_DP_SYNC_DELAY_S (2U)
+#endif
+
 #endif /* ifndef TUYA_CONFIG_DEFAULTS_H_ */
@@ -26,10 +26,13 @@
 
 extern int iotdns_cloud_endpoint_get(const char *region, const char *env, tuya_endpoint_t *endpoint);
 
+#define ENDPOINT_REFRESH_CHECK_MS (60 * 1000)
+
 typedef struct {
     char region[MAX_LENGTH_REGION + 1];
     char regist_key[MAX_LENGTH_REGIST + 1];
     tuya_endpoint_t endpoint;
+    DELAYED_WORK_HANDLE refresh_work;
 } endpoint_management_t;
 
 static endpoint_management_t endpoint_mgr;
@@ -205,8 +208,13 @@ int tuya_endpoint_domain_set(tuya_endpoint_t *endpoint)
     ret = tal_kv_serialize_set("endpoint.domain", kvdb, sizeof(kvdb) / sizeof(kvdb[0]));
     if (ret != OPRT_OK) {
         PR_ERR("tal_kv_serialize_set error:%d", ret);
+        return ret;
     }
 
+    /* Stamp the query time, 0 is stamped once the time is synced */
+    TIME_T now = (OPRT_OK == tal_time_check_time_sync()) ? tal_time_get_posix() : 0;
+    tal_kv_set("endpoint.time", (const uint8_t *)&now, sizeof(now));
+
     return ret;
 }
 
@@ -251,6 +259,7 @@ int tuya_endpoint_remove(void)
     tal_kv_del("regist_key");
     tal_kv_del("endpoint.cert");
     tal_kv_del("endpoint.domain");
+    tal_kv_del("endpoint.time");
 
     return OPRT_OK;
 }
@@ -348,3 +357,74 @@ const tuya_endpoint_t *tuya_endpoint_get(void)
 {
     return (const tuya_endpoint_t *)&endpoint_mgr.endpoint;
 }
+
+static void tuya_endpoint_refresh_cb(void *data)
+{
+    TIME_T stamp = 0;
+    size_t len = 0;
+    uint8_t *value = NULL;
+
+    /* The age is unknown until the time is synced, check again later */
+    if (OPRT_OK != tal_time_check_time_sync()) {
+        return;
+    }
+
+    TIME_T now = tal_time_get_posix();
+    if (OPRT_OK == tal_kv_get("endpoint.time", &value, &len)) {
+        if (len == sizeof(TIME_T)) {
+            memcpy(&stamp, value, sizeof(TIME_T));
+        }
+        tal_kv_free(value);
+    }
+
+    if (0 == stamp) {
+        /* Queried before the time was known, it counts from now */
+        tal_kv_set("endpoint.time", (const uint8_t *)&now, sizeof(now));
+        tal_workq_stop_delayed(endpoint_mgr.refresh_work);
+        return;
+    }
+    if (now - stamp < TUYA_ENDPOINT_KV_TTL_S) {
+        tal_workq_stop_delayed(endpoint_mgr.refresh_work);
+        return;
+    }
+
+    /* Query into a copy, the running connection keeps using its endpoint */
+    PR_DEBUG("endpoint stored %d s ago, refresh", (int)(now - stamp));
+    tuya_endpoint_t *fresh = tal_calloc(1, sizeof(tuya_endpoint_t));
+    if (NULL == fresh) {
+        return;
+    }
+    int ret = iotdns_cloud_endpoint_get(endpoint_mgr.region, endpoint_mgr.regist_key, fresh);
+    if (OPRT_OK == ret && fresh->cert && fresh->cert_len) {
+        ret = tuya_endpoint_cert_set(fresh);
+        ret |= tuya_endpoint_domain_set(fresh);
+        if (OPRT_OK == ret) {
+            tal_workq_stop_delayed(endpoint_mgr.refresh_work);
+        }
+    } else {
+        PR_WARN("endpoint refresh error:%d, retry later", ret);
+    }
+    if (fresh->cert) {
+        tal_free(fresh->cert);
+    }
+    tal_free(fresh);
+}
+
+/**
+ * @brief Starts the background refresh of the stored endpoint.
+ *
+ * @return Returns 0 on success, or a negative error code on failure.
+ */
+int tuya_endpoint_refresh_start(void)
+{
+    int ret = OPRT_OK;
+
+    if (NULL == endpoint_mgr.refresh_work) {
+        ret = tal_workq_init_delayed(WORKQ_SYSTEM, tuya_endpoint_refresh_cb, NULL, &endpoint_mgr.refresh_work);
+        if (OPRT_OK != ret) {
+            return ret;
+        }
+    }
+
+    return tal_workq_start_delayed(endpoint_mgr.refresh_work, ENDPOINT_REFRESH_CHECK_MS, LOOP_CYCLE);
+}
@@ -34,6 +34,11 @@ extern "C" {
 #define MAX_LENGTH_TUYA_HOST (64)
 #define MAX_LENGTH_ATOP_PATH (16)
 
+/* the stored endpoint is queried again in the background once this old */
+#ifndef TUYA_ENDPOINT_KV_TTL_S
+#define TUYA_ENDPOINT_KV_TTL_S (7 * 24 * 3600)
+#endif
+
 typedef struct {
     char region[MAX_LENGTH_REGION + 1]; // get from token
     struct {
@@ -116,6 +121,17 @@ int tuya_endpoint_update_auto_region(void);
  */
 const tuya_endpoint_t *tuya_endpoint_get(void);
 
+/**
+ * @brief Starts the background refresh of the stored endpoint.
+ *
+ * Call it once the cloud is connected. The stored domain and cert are
+ * queried again when older than TUYA_ENDPOINT_KV_TTL_S and take effect on
+ * the next boot, the running connection keeps its endpoint.
+ *
+ * @return Returns 0 on success, or a negative error code on failure.
+ */
+int tuya_endpoint_refresh_start(void);
+
 /**
  * @brief Sets the domain for the Tuya endpoint.
  *
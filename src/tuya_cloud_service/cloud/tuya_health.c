@@ -39,7 +39,11 @@ typedef struct {
     health_policy_t policy;
     TIME_T ts;            // Time of the last update for the corresponding metric
     uint32_t cnt;         // Number of occurrences of the current metric
-    int detect_time_left; // Remaining detection time
+    SYS_TIME_T due_ms;    // Time of the next detection
+    uint32_t backoff;     // Multiple of the period, grows while the check passes
+    uint32_t passes;      // Passed checks in a row at the current backoff
+    uint32_t last_run_ms; // Duration of the last check
+    uint32_t max_run_ms;  // Longest check
 } health_item_t;
 
 typedef struct {
@@ -50,8 +54,11 @@ typedef struct {
 typedef struct {
     THREAD_HANDLE thread;
     MUTEX_HANDLE mutex;
+    SEM_HANDLE sem; // Wakes the monitor before its timeout
     int global_type;
     LIST_HEAD listHead;
+    SYS_TIME_T align_ms; // Earliest time an item may run early
+    SYS_TIME_T quiet_ms; // Items but the watchdog feed wait until then
 } health_mgr_t;
 
 static health_mgr_t *s_health_mgr = NULL;
@@ -78,6 +85,19 @@ static bool __watchdog_feed(void)
     return FALSE;
 }
 
+static uint32_t __health_item_interval(health_item_t *item)
+{
+    return item->policy.detect_period * 1000 * item->backoff;
+}
+
+// Wake the monitor to take a changed schedule into account
+static void __health_kick(void)
+{
+    if (s_health_mgr->sem) {
+        tal_semaphore_post(s_health_mgr->sem);
+    }
+}
+
 static int __health_reboot_cb(void *data)
 {
     PR_DEBUG("recive reboot req ack! device will reboot!");
@@ -129,13 +149,15 @@ int tuya_health_item_add(uint32_t threshold, uint32_t period, health_check_cb ch
     health_node->item.policy.notify_cb = notify;
 
     health_node->item.policy.type = type;
-    health_node->item.detect_time_left = period;
+    health_node->item.backoff = 1;
+    health_node->item.due_ms = tal_system_get_millisecond() + (SYS_TIME_T)period * 1000;
 
     PR_DEBUG("add new node,type:%d", type);
 
     tal_mutex_lock(s_health_mgr->mutex);
     tuya_list_add(&(health_node->node), &(s_health_mgr->listHead));
     tal_mutex_unlock(s_health_mgr->mutex);
+    __health_kick();
 
     return type;
 }
@@ -203,11 +225,14 @@ void tuya_health_update_item_period(int type, uint32_t period)
             if (health_node->item.policy.type == type) {
                 PR_DEBUG("update type:%d,period:%d", type, period);
                 health_node->item.policy.detect_period = period;
-                health_node->item.detect_time_left = period;
+                health_node->item.backoff = 1;
+                health_node->item.passes = 0;
+                health_node->item.due_ms = tal_system_get_millisecond() + (SYS_TIME_T)period * 1000;
             }
         }
     }
     tal_mutex_unlock(s_health_mgr->mutex);
+    __health_kick();
     return;
 }
 
@@ -268,7 +293,9 @@ void tuya_health_item_dump(void)
         health_node = tuya_list_entry(pPos, health_node_t, node);
         if (health_node) {
             PR_DEBUG("node id:%d", node_num);
-            PR_DEBUG("detect_time_left:%d", health_node->item.detect_time_left);
+            PR_DEBUG("due in:%dms", (int)(health_node->item.due_ms - tal_system_get_millisecond()));
+            PR_DEBUG("backoff:%d", health_node->item.backoff);
+            PR_DEBUG("run:%dms, max:%dms", health_node->item.last_run_ms, health_node->item.max_run_ms);
             PR_DEBUG("cnt:%d", health_node->item.cnt);
             PR_DEBUG("ts:%d", health_node->item.ts);
             PR_DEBUG("type:%d", health_node->item.policy.type);
@@ -287,6 +314,93 @@ void tuya_health_item_dump(void)
     return;
 }
 
+/**
+ * @brief Gets the schedule and run time of a health item.
+ *
+ * Latency critical work can read when the items run next and how long their
+ * checks take to plan around them, or defer them with tuya_health_quiet().
+ *
+ * @param type The type of the health item.
+ * @param stat Filled in with the schedule and run time of the item.
+ *
+ * @return OPRT_OK on success, OPRT_NOT_FOUND if there is no such item.
+ */
+int tuya_health_item_get_stat(int type, health_item_stat_t *stat)
+{
+    int rt = OPRT_NOT_FOUND;
+
+    if (NULL == s_health_mgr || NULL == stat) {
+        return OPRT_INVALID_PARM;
+    }
+
+    tal_mutex_lock(s_health_mgr->mutex);
+    P_LIST_HEAD pPos;
+    health_node_t *health_node;
+    tuya_list_for_each(pPos, &(s_health_mgr->listHead))
+    {
+        health_node = tuya_list_entry(pPos, health_node_t, node);
+        if (health_node->item.policy.type == type) {
+            stat->next_ms = health_node->item.due_ms;
+            stat->interval_ms = __health_item_interval(&health_node->item);
+            stat->last_run_ms = health_node->item.last_run_ms;
+            stat->max_run_ms = health_node->item.max_run_ms;
+            rt = OPRT_OK;
+            break;
+        }
+    }
+    tal_mutex_unlock(s_health_mgr->mutex);
+
+    return rt;
+}
+
+/**
+ * @brief Runs the items close to due now.
+ *
+ * Called by periodic work that has woken the device anyway. Only items within
+ * 1/HEALTH_ALIGN_DIV of their period from due run, so the call is cheap when
+ * nothing is close and may be made on every such wakeup.
+ */
+void tuya_health_align(void)
+{
+    if (NULL == s_health_mgr) {
+        return;
+    }
+
+    // Read without the lock, a torn read only costs a spurious or a missed early run
+    if (tal_system_get_millisecond() >= s_health_mgr->align_ms) {
+        __health_kick();
+    }
+}
+
+/**
+ * @brief Defers all items but the watchdog feed.
+ *
+ * Audio sessions call this so no health check runs while they are latency
+ * critical. The deferral ends by itself after ms, the deferred items run then.
+ *
+ * @param ms Time to defer for, 0 ends the deferral at once.
+ */
+void tuya_health_quiet(uint32_t ms)
+{
+    if (NULL == s_health_mgr) {
+        return;
+    }
+
+    SYS_TIME_T now = tal_system_get_millisecond();
+
+    tal_mutex_lock(s_health_mgr->mutex);
+    if (0 == ms) {
+        s_health_mgr->quiet_ms = 0;
+    } else if (now + ms > s_health_mgr->quiet_ms) {
+        s_health_mgr->quiet_ms = now + ms;
+    }
+    tal_mutex_unlock(s_health_mgr->mutex);
+
+    if (0 == ms) {
+        __health_kick();
+    }
+}
+
 static bool __health_memory_check(void)
 {
     // dump all active threads' wartmark
@@ -354,26 +468,58 @@ static bool __health_timeq_check(void)
     return FALSE;
 }
 
-static void __health_foreach_item(void)
+static void __health_check_item(health_item_t *item)
 {
+    SYS_TIME_T start = tal_system_get_millisecond();
+    bool hit = item->policy.check_cb();
+
+    item->last_run_ms = (uint32_t)(tal_system_get_millisecond() - start);
+    if (item->last_run_ms > item->max_run_ms) {
+        item->max_run_ms = item->last_run_ms;
+    }
+
+    if (hit) {
+        item->cnt++;
+        item->ts = tal_time_get_posix();
+        item->backoff = 1;
+        item->passes = 0;
+        return;
+    }
+
+    item->cnt = 0;
+    item->ts = 0;
+    // The watchdog feed reports no hit, it must keep its period
+    if (HEALTH_RULE_FEED_WATCH_DOG == item->policy.type) {
+        return;
+    }
+    if (++item->passes >= HEALTH_BACKOFF_PASSES && item->backoff < HEALTH_BACKOFF_MAX) {
+        item->backoff *= 2;
+        item->passes = 0;
+    }
+}
+
+// Run the items that are due, or close to due as the monitor is awake anyway,
+// and return the time to sleep until the next one
+static uint32_t __health_foreach_item(void)
+{
+    SYS_TIME_T now = tal_system_get_millisecond();
+    SYS_TIME_T next = now + HEALTH_REPORT_INTERVAL * 1000;
+    SYS_TIME_T align = next;
+    bool quiet = (now < s_health_mgr->quiet_ms);
     P_LIST_HEAD pPos, pNext;
     health_node_t *health_node;
     tuya_list_for_each_safe(pPos, pNext, &(s_health_mgr->listHead))
     {
         health_node = tuya_list_entry(pPos, health_node_t, node);
         if (health_node) {
-            health_node->item.detect_time_left -= HEALTH_SLEEP_INTERVAL;
-            if (health_node->item.detect_time_left <= 0) {
-                health_node->item.detect_time_left = health_node->item.policy.detect_period;
+            uint32_t slack = __health_item_interval(&health_node->item) / HEALTH_ALIGN_DIV;
+            bool deferred = quiet && HEALTH_RULE_FEED_WATCH_DOG != health_node->item.policy.type;
+            if (!deferred && now + slack >= health_node->item.due_ms) {
                 if (health_node->item.policy.check_cb) { // Query type
-                    if (health_node->item.policy.check_cb()) {
-                        health_node->item.cnt++;
-                        health_node->item.ts = tal_time_get_posix();
-                    } else {
-                        health_node->item.cnt = 0;
-                        health_node->item.ts = 0;
-                    }
+                    __health_check_item(&health_node->item);
                 }
+                health_node->item.due_ms = now + __health_item_interval(&health_node->item);
+                slack = __health_item_interval(&health_node->item) / HEALTH_ALIGN_DIV;
 
                 if ((health_node->item.cnt >= health_node->item.policy.threshold) &&
                     (health_node->item.policy.notify_cb)) {
@@ -388,10 +534,22 @@ static void __health_foreach_item(void)
                     health_node->item.ts = 0;
                 }
             }
+
+            SYS_TIME_T due = health_node->item.due_ms;
+            if (deferred && due < s_health_mgr->quiet_ms) {
+                due = s_health_mgr->quiet_ms;
+            }
+            if (due < next) {
+                next = due;
+            }
+            if (!deferred && due - slack < align) {
+                align = due - slack;
+            }
         }
     }
+    s_health_mgr->align_ms = align;
 
-    return;
+    return (next > now) ? (uint32_t)(next - now) : 0;
 }
 
 static int __health_alert_cb(void *data)
@@ -422,11 +580,15 @@ static int __health_alert_cb(void *data)
 
 static void __health_monitor_task(void *arg)
 {
+    uint32_t wait_ms = 0;
+
     while (1) {
         tal_mutex_lock(s_health_mgr->mutex);
-        __health_foreach_item();
+        wait_ms = __health_foreach_item();
         tal_mutex_unlock(s_health_mgr->mutex);
-        tal_system_sleep(HEALTH_SLEEP_INTERVAL * 1000);
+        // Sleep until the next item is due instead of polling, posted by
+        // tuya_health_align() and schedule changes
+        tal_semaphore_wait(s_health_mgr->sem, wait_ms);
     }
 }
 
@@ -480,6 +642,7 @@ int tuya_health_monitor_init(void)
 
     INIT_LIST_HEAD(&s_health_mgr->listHead);
     TUYA_CALL_ERR_GOTO(tal_mutex_create_init(&s_health_mgr->mutex), __exit);
+    TUYA_CALL_ERR_GOTO(tal_semaphore_create_init(&s_health_mgr->sem, 0, 1), __exit);
     TUYA_CALL_ERR_GOTO(tal_event_subscribe(EVENT_HEALTH_ALERT, "health_monitor", __health_alert_cb, FALSE), __exit);
     TUYA_CALL_ERR_GOTO(
         tal_event_subscribe(EVENT_REBOOT_ACK, "health_monitor", __health_reboot_cb, SUBSCRIBE_TYPE_NORMAL), __exit);
@@ -528,6 +691,10 @@ __exit:
             tal_thread_delete(s_health_mgr->thread);
             s_health_mgr->thread = NULL;
         }
+        if (s_health_mgr->sem) {
+            tal_semaphore_release(s_health_mgr->sem);
+            s_health_mgr->sem = NULL;
+        }
         tal_event_unsubscribe(EVENT_REBOOT_ACK, "health_monitor", __health_reboot_cb);
         tal_event_unsubscribe(EVENT_HEALTH_ALERT, "health_monitor", __health_alert_cb);
 
@@ -17,6 +17,7 @@
 #include "tuya_cloud_com_defs.h"
 #include "tal_thread.h"
 #include "tal_mutex.h"
+#include "tal_semaphore.h"
 #include "tuya_list.h"
 
 #ifdef __cplusplus
@@ -50,6 +51,20 @@ extern "C" {
 // seconds
 #define HEALTH_DETECT_INTERVAL 600
 
+// An item may run up to 1/HEALTH_ALIGN_DIV of its period early, when another
+// item or tuya_health_align() wakes the monitor anyway
+#ifndef HEALTH_ALIGN_DIV
+#define HEALTH_ALIGN_DIV 4
+#endif
+// Passed checks in a row after which the period of a check item doubles
+#ifndef HEALTH_BACKOFF_PASSES
+#define HEALTH_BACKOFF_PASSES 3
+#endif
+// Largest multiple of its period a check item backs off to
+#ifndef HEALTH_BACKOFF_MAX
+#define HEALTH_BACKOFF_MAX 4
+#endif
+
 // Health indicators, must be defined in the order of g_health_policy, otherwise
 // the reallocation of global type will be inaccurate
 typedef enum {
@@ -80,6 +95,13 @@ typedef struct {
     void *data;
 } health_alert_t;
 
+typedef struct {
+    SYS_TIME_T next_ms;   // Time of the next run, tal_system_get_millisecond() based
+    uint32_t interval_ms; // Current period, backoff included
+    uint32_t last_run_ms; // Duration of the last check
+    uint32_t max_run_ms;  // Longest check so far
+} health_item_stat_t;
+
 /**
  * @brief health init function
  *
@@ -132,6 +154,32 @@ void tuya_health_update_item_threshold(int type, uint32_t threshold);
  */
 void tuya_health_item_dump(void);
 
+/**
+ * @brief get the schedule and run time of a health item
+ *
+ * @param[in] type type
+ * @param[out] stat item schedule and run time
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+int tuya_health_item_get_stat(int type, health_item_stat_t *stat);
+
+/**
+ * @brief run the items close to due now, called by periodic work that has
+ * woken the device anyway (MQTT keepalive, NAT pings), saving their own wakeup
+ *
+ */
+void tuya_health_align(void);
+
+/**
+ * @brief defer all items but the watchdog feed, for latency critical work
+ *
+ * @param[in] ms time to defer for, 0 ends it and runs the deferred items
+ *
+ */
+void tuya_health_quiet(uint32_t ms);
+
 /**
  * @brief Disables the watchdog for Tuya health monitoring.
  *
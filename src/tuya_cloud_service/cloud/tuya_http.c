@@ -11,17 +11,24 @@
  *
  */
 
+#include <stdio.h>
 #include "iotdns.h"
 #include "http_parser.h"
 #include "http_client_interface.h"
 #include "tal_time_service.h"
 #include "tal_log.h"
 #include "tal_memory.h"
+#include "tal_kv.h"
 
 #ifndef MAX_HTTP_CERT_NUM
 #define MAX_HTTP_CERT_NUM 3
 #endif
 
+/* certs queried from iotdns are kept in kv across reboots this long */
+#ifndef HTTP_CERT_KV_TTL_S
+#define HTTP_CERT_KV_TTL_S (30 * 24 * 3600)
+#endif
+
 typedef struct {
     char *host;
     uint16_t port;
@@ -37,6 +44,93 @@ typedef struct {
 
 static tuya_cert_mgr_t s_tuya_cert_mgr;
 
+/* kv record of a cert, followed by the host and the cert itself */
+typedef struct {
+    TIME_T timeposix; // 0 when saved before the time was synced
+    uint16_t port;
+    uint16_t host_len;
+    uint16_t cacert_len;
+} tuya_cert_kv_t;
+
+static void tuya_http_cert_kv_key(const char *host, uint16_t port, char *key, size_t size)
+{
+    uint32_t hash = 2166136261u;
+
+    for (; *host; host++) {
+        hash = (hash ^ (uint8_t)*host) * 16777619u;
+    }
+    hash = (hash ^ port) * 16777619u;
+    snprintf(key, size, "hcert.%08x", (unsigned int)hash);
+}
+
+static void tuya_http_cert_kv_save(const char *host, uint16_t port, const uint8_t *cacert, uint16_t cacert_len)
+{
+    char key[16];
+    size_t host_len = strlen(host);
+    size_t length = sizeof(tuya_cert_kv_t) + host_len + cacert_len;
+    tuya_cert_kv_t *record = tal_malloc(length);
+    if (NULL == record) {
+        return;
+    }
+
+    record->timeposix = (OPRT_OK == tal_time_check_time_sync()) ? tal_time_get_posix() : 0;
+    record->port = port;
+    record->host_len = (uint16_t)host_len;
+    record->cacert_len = cacert_len;
+    memcpy((uint8_t *)(record + 1), host, host_len);
+    memcpy((uint8_t *)(record + 1) + host_len, cacert, cacert_len);
+
+    tuya_http_cert_kv_key(host, port, key, sizeof(key));
+    if (OPRT_OK != tal_kv_set(key, (const uint8_t *)record, length)) {
+        PR_WARN("cert of %s save failed", host);
+    }
+    tal_free(record);
+}
+
+static int tuya_http_cert_kv_load(const char *host, uint16_t port, uint8_t **cacert, uint16_t *cacert_len)
+{
+    char key[16];
+    uint8_t *value = NULL;
+    size_t length = 0;
+    size_t host_len = strlen(host);
+
+    tuya_http_cert_kv_key(host, port, key, sizeof(key));
+    if (OPRT_OK != tal_kv_get(key, &value, &length)) {
+        return OPRT_NOT_FOUND;
+    }
+
+    int rt = OPRT_COM_ERROR;
+    tuya_cert_kv_t *record = (tuya_cert_kv_t *)value;
+    if (length < sizeof(tuya_cert_kv_t) || record->port != port || record->host_len != host_len ||
+        length != sizeof(tuya_cert_kv_t) + record->host_len + record->cacert_len || 0 == record->cacert_len ||
+        0 != memcmp((uint8_t *)(record + 1), host, host_len)) {
+        goto __exit;
+    }
+
+    /* an unsynced clock can not tell, use the cert until the time is known */
+    if (record->timeposix && OPRT_OK == tal_time_check_time_sync() &&
+        tal_time_get_posix() - record->timeposix > HTTP_CERT_KV_TTL_S) {
+        PR_DEBUG("cert of %s expired", host);
+        goto __exit;
+    }
+
+    *cacert = tal_malloc(record->cacert_len);
+    if (NULL == *cacert) {
+        tal_kv_free(value);
+        return OPRT_MALLOC_FAILED;
+    }
+    memcpy(*cacert, (uint8_t *)(record + 1) + host_len, record->cacert_len);
+    *cacert_len = record->cacert_len;
+    rt = OPRT_OK;
+
+__exit:
+    tal_kv_free(value);
+    if (OPRT_OK != rt) {
+        tal_kv_del(key);
+    }
+    return rt;
+}
+
 /**
  * @brief Saves the HTTP certificate for a given host and port.
  *
@@ -162,14 +256,17 @@ int tuya_http_cert_load(char *host, uint16_t port, uint8_t **cacert, uint16_t *c
         return rt;
     }
 
-    rt = tuya_iotdns_query_host_certs(host, port, cacert, cacert_len);
-    if (OPRT_OK != rt || *cacert == NULL || *cacert_len == 0) {
-        if (*cacert) {
-            tal_free(*cacert);
-            *cacert = NULL;
+    if (OPRT_OK != tuya_http_cert_kv_load(host, port, cacert, cacert_len)) {
+        rt = tuya_iotdns_query_host_certs(host, port, cacert, cacert_len);
+        if (OPRT_OK != rt || *cacert == NULL || *cacert_len == 0) {
+            if (*cacert) {
+                tal_free(*cacert);
+                *cacert = NULL;
+            }
+            *cacert_len = 0;
+            return rt;
         }
-        *cacert_len = 0;
-        return rt;
+        tuya_http_cert_kv_save(host, port, *cacert, *cacert_len);
     }
 
     rt = tuya_http_cert_save(host, port, *cacert, *cacert_len);
@@ -29,6 +29,7 @@
 #include "tuya_iot_dp.h"
 #include "tuya_register_center.h"
 #include "tuya_tls.h"
+#include "http_client_interface.h"
 #include "netmgr.h"
 #include "tuya_health.h"
 typedef enum {
@@ -110,11 +111,31 @@ __exit:
     return result;
 }
 
+/* KV key of the compiled schema cache, next to the schema JSON key */
+static void schema_cache_key(const char *schema_id, char *key, size_t key_len)
+{
+    snprintf(key, key_len, "%s.bin", schema_id);
+}
+
 static dp_schema_t *schema_instance_create(char *devid, char *schema_id)
 {
     dp_schema_t *schema = NULL;
     size_t readlen = 0;
     uint8_t *schema_data = NULL;
+    char cache_key[MAX_LENGTH_SCHEMA_ID + 8];
+
+    /* Compiled cache first, it skips the JSON parse and its heap peak */
+    schema_cache_key(schema_id, cache_key, sizeof(cache_key));
+    if (OPRT_OK == tal_kv_get(cache_key, &schema_data, &readlen)) {
+        int rt = dp_schema_create_from_bin(devid, schema_id, schema_data, readlen, &schema);
+        tal_kv_free(schema_data);
+        schema_data = NULL;
+        if (OPRT_OK == rt) {
+            return schema;
+        }
+        PR_WARN("schema cache invalid:%d", rt);
+        tal_kv_del(cache_key);
+    }
 
     if (OPRT_OK != tal_kv_get((const char *)schema_id, &schema_data, &readlen)) {
         PR_WARN("schema data read failed");
@@ -122,6 +143,17 @@ static dp_schema_t *schema_instance_create(char *devid, char *schema_id)
     }
 
     dp_schema_create(devid, (char *)schema_data, &schema);
+    tal_kv_free(schema_data);
+    schema_data = NULL;
+
+    if (schema) {
+        uint8_t *bin = NULL;
+        size_t bin_len = 0;
+        if (OPRT_OK == dp_schema_compile(schema, schema_id, &bin, &bin_len)) {
+            tal_kv_set(cache_key, bin, bin_len);
+            tal_free(bin);
+        }
+    }
 
 __exit:
     if (schema_data) {
@@ -189,6 +221,9 @@ static int activate_response_parse(atop_base_response_t *response)
     cJSON *schema_obj = cJSON_DetachItemFromObject(result_root, "schema");
     ret = tal_kv_set(schemaId, (const uint8_t *)schema_obj->valuestring, strlen(schema_obj->valuestring));
     cJSON_Delete(schema_obj);
+    char cache_key[MAX_LENGTH_SCHEMA_ID + 8];
+    schema_cache_key(schemaId, cache_key, sizeof(cache_key));
+    tal_kv_del(cache_key);
     if (ret != OPRT_OK) {
         PR_ERR("activate data save error:%d", ret);
         return OPRT_KVS_WR_FAIL;
@@ -276,13 +311,19 @@ static int client_activate_process(tuya_iot_client_t *client, const char *token)
 static void mqtt_service_dp_receive_on(tuya_protocol_event_t *ev)
 {
     tuya_iot_client_t *client = ev->user_data;
+    if (ev->json) {
+        tuya_iot_dp_parse_scan(client, DP_CMD_MQ, ev->json, ev->toks, ev->tok_num, ev->data_tok);
+        return;
+    }
+
     cJSON *data = (cJSON *)(ev->data);
     if (NULL == cJSON_GetObjectItem(data, "dps")) {
         PR_ERR("not found dps");
         return;
     }
 
-    tuya_iot_dp_parse(client, DP_CMD_MQ, cJSON_DetachItemFromObject(ev->root_json, "data"));
+    // parsed to the work queue, the event tree ends with this callback
+    tuya_iot_dp_parse(client, DP_CMD_MQ, cJSON_Duplicate(data, true));
 }
 
 static void mqtt_service_reset_cmd_on(tuya_protocol_event_t *ev)
@@ -389,11 +430,19 @@ static void mqtt_client_connected_on(void *context, void *user_data)
     matop_serice_init(&client->matop,
                       &(const matop_config_t){.mqctx = &client->mqctx, .devid = client->activate.devid});
 
-    /* Auto check upgrade timer start */
+    /* Auto check upgrade, sent right away as boot requests need not wait for
+     * each other's response */
     if (tal_sw_timer_is_running(client->check_upgrade_timer) == false) {
-        tal_sw_timer_start(client->check_upgrade_timer, 1000 * 1, TAL_TIMER_ONCE);
+        matop_service_auto_upgrade_info_get(&client->matop, matop_upgrade_info_on, client);
+        tal_sw_timer_start(client->check_upgrade_timer, AUTO_UPGRADE_CHECK_INTERVAL, TAL_TIMER_ONCE);
     }
 
+    /* Refresh the stored endpoint when it got old */
+    tuya_endpoint_refresh_start();
+
+    /* Upload the DPs changed while offline, the rest are known to the cloud */
+    tuya_iot_dp_sync_start(client, TUYA_IOT_DP_SYNC_DELAY_S);
+
     /* Send connected event*/
     client->event.id = TUYA_EVENT_MQTT_CONNECTED;
     client->event.type = TUYA_DATE_TYPE_UNDEFINED;
@@ -499,7 +548,7 @@ static int run_state_mqtt_connect_start(tuya_iot_client_t *client)
     }
 
     /* callback register */
-    tuya_mqtt_protocol_register(&client->mqctx, PRO_CMD, mqtt_service_dp_receive_on, client);
+    tuya_mqtt_protocol_register_scan(&client->mqctx, PRO_CMD, mqtt_service_dp_receive_on, client);
     tuya_mqtt_protocol_register(&client->mqctx, PRO_GW_RESET, mqtt_service_reset_cmd_on, client);
     tuya_mqtt_protocol_register(&client->mqctx, PRO_UPGD_REQ, mqtt_service_upgrade_notify_on, client);
     tuya_mqtt_protocol_register(&client->mqctx, PRO_MQ_DPCACHE_NOTIFY, mqtt_atop_dp_cache_notify_cb, client);
@@ -584,6 +633,7 @@ int tuya_iot_init(tuya_iot_client_t *client, const tuya_iot_config_t *config)
     }
     /* Software timer Init */
     tuya_tls_init();
+    http_client_init();
     tuya_register_center_init();
     /* Load Tuya cloud endpoint config */
     tuya_endpoint_init();
@@ -1044,6 +1094,9 @@ int tuya_iot_activated_data_remove(tuya_iot_client_t *client)
 
     /* Clean client local data */
     dp_schema_delete(client->activate.devid);
+    char cache_key[MAX_LENGTH_SCHEMA_ID + 8];
+    schema_cache_key(client->activate.schemaId, cache_key, sizeof(cache_key));
+    tal_kv_del(cache_key);
     tal_kv_del((const char *)(client->activate.schemaId));
     tal_kv_del((const char *)(client->config.storage_namespace));
     tuya_endpoint_remove();
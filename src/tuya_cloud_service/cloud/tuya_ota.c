@@ -20,6 +20,44 @@
 #include "tuya_endpoint.h"
 #include "iotdns.h"
 #include "mix_method.h"
+#include "tuya_ota_image.h"
+#include "mbedtls/sha256.h"
+
+/* ranges buffered between the download socket and the flash write */
+#ifndef TUYA_OTA_PIPELINE_DEPTH
+#define TUYA_OTA_PIPELINE_DEPTH (2)
+#endif
+
+/* decoded bytes staged for tal_ota_data_process, compressed images only */
+#ifndef TUYA_OTA_DECODE_BUF_LEN
+#define TUYA_OTA_DECODE_BUF_LEN (4096)
+#endif
+
+/* ranges between resume checkpoints in KV, 0 disables resuming */
+#ifndef TUYA_OTA_RESUME_SAVE_CHUNKS
+#define TUYA_OTA_RESUME_SAVE_CHUNKS (16)
+#endif
+
+#if defined(MBEDTLS_SHA256_ALT)
+/* a hardware hash context can not be saved across a reboot */
+#undef TUYA_OTA_RESUME_SAVE_CHUNKS
+#define TUYA_OTA_RESUME_SAVE_CHUNKS (0)
+#endif
+
+#define TUYA_OTA_RESUME_KEY     "ota.resume"
+#define TUYA_OTA_RESUME_VERSION 1
+
+/* what a plain channel 0 download had written to flash */
+typedef struct {
+    uint8_t version;
+    uint8_t channel;
+    char sw_ver[SW_VER_LEN + 1];
+    char fw_hmac[FW_HMAC_LEN + 1];
+    uint32_t file_size;
+    uint32_t offset;
+    /* hash of the bytes before offset */
+    mbedtls_sha256_context sha256;
+} ota_resume_rec_t;
 
 typedef struct {
     tuya_ota_config_t config;
@@ -28,7 +66,18 @@ typedef struct {
     uint8_t channel;
     uint8_t progress_percent;
     THREAD_HANDLE upgrade_thrd;
-    TKL_HASH_HANDLE sha256;
+    mbedtls_sha256_context sha256;
+    /* download offset restored from KV, 0 for a fresh download */
+    size_t resume_offset;
+    uint16_t resume_chunks;
+    /* flash writer, channel 0 */
+    bool flash_started;
+    bool flash_error;
+    ota_image_info_t image;
+    ota_image_decoder_t *decoder;
+    uint8_t *decode_buf;
+    size_t decode_len;
+    size_t decode_offset;
 } tuya_ota_t;
 
 int tuya_ota_upgrade_status_report(tuya_ota_t *handle, int status);
@@ -36,6 +85,195 @@ int tuya_ota_upgrade_progress_report(tuya_ota_t *handle, int percent);
 
 static tuya_ota_t *s_ota_ctx;
 
+static void ota_resume_clear(void)
+{
+    tal_kv_del(TUYA_OTA_RESUME_KEY);
+}
+
+/* The offset to continue the current image at, restoring the hash over the
+ * bytes before it. A record of any other image is dropped. */
+static size_t ota_resume_load(tuya_ota_t *ota)
+{
+    uint8_t *value = NULL;
+    size_t len = 0;
+    size_t offset = 0;
+
+    if (0 == TUYA_OTA_RESUME_SAVE_CHUNKS || OPRT_OK != tal_kv_get(TUYA_OTA_RESUME_KEY, &value, &len)) {
+        return 0;
+    }
+
+    ota_resume_rec_t *rec = (ota_resume_rec_t *)value;
+    if (len == sizeof(ota_resume_rec_t) && rec->version == TUYA_OTA_RESUME_VERSION && rec->channel == ota->channel &&
+        rec->file_size == ota->msg.file_size && rec->offset < rec->file_size &&
+        0 == strcmp(rec->sw_ver, ota->msg.sw_ver) && 0 == strcmp(rec->fw_hmac, ota->msg.fw_hmac)) {
+        memcpy(&ota->sha256, &rec->sha256, sizeof(mbedtls_sha256_context));
+        offset = rec->offset;
+        PR_INFO("ota resume %s at %d/%d", rec->sw_ver, rec->offset, rec->file_size);
+    }
+    tal_kv_free(value);
+
+    if (0 == offset) {
+        ota_resume_clear();
+    }
+    return offset;
+}
+
+static void ota_resume_save(tuya_ota_t *ota, size_t offset)
+{
+    ota_resume_rec_t rec;
+
+    memset(&rec, 0, sizeof(rec));
+    rec.version = TUYA_OTA_RESUME_VERSION;
+    rec.channel = ota->channel;
+    strcpy(rec.sw_ver, ota->msg.sw_ver);
+    strcpy(rec.fw_hmac, ota->msg.fw_hmac);
+    rec.file_size = ota->msg.file_size;
+    rec.offset = offset;
+    memcpy(&rec.sha256, &ota->sha256, sizeof(mbedtls_sha256_context));
+    if (OPRT_OK != tal_kv_set(TUYA_OTA_RESUME_KEY, (const uint8_t *)&rec, sizeof(rec))) {
+        PR_WARN("ota resume save failed");
+    }
+}
+
+static void ota_flash_release(tuya_ota_t *ota)
+{
+    ota_image_decoder_destroy(ota->decoder);
+    ota->decoder = NULL;
+    if (ota->decode_buf) {
+        tal_free(ota->decode_buf);
+        ota->decode_buf = NULL;
+    }
+    ota->decode_len = 0;
+    ota->decode_offset = 0;
+}
+
+/* The first range says whether the image is compressed, which fixes the
+ * size the flash writer is told about */
+static int ota_flash_start(tuya_ota_t *ota, http_download_event_t *event)
+{
+    int rt = OPRT_OK;
+    uint32_t max_size = 0;
+    TUYA_OTA_TYPE_E type = TUYA_OTA_FULL;
+
+    ota->flash_started = true;
+    /* only plain images are resumed, a later range carries no header */
+    rt = (0 == event->offset) ? ota_image_probe(event->data, event->data_len, &ota->image) : OPRT_NOT_FOUND;
+    if (OPRT_NOT_FOUND == rt) {
+        ota->image.image_size = event->file_size;
+    } else if (OPRT_OK == rt) {
+        ota->decoder = ota_image_decoder_create(&ota->image);
+        ota->decode_buf = tal_malloc(TUYA_OTA_DECODE_BUF_LEN);
+        if (NULL == ota->decoder || NULL == ota->decode_buf) {
+            ota_flash_release(ota);
+            return OPRT_MALLOC_FAILED;
+        }
+        PR_INFO("compressed ota image %d -> %d bytes", event->file_size, ota->image.image_size);
+    } else {
+        return rt;
+    }
+
+    /* a diff capable platform patches the image itself while it is written */
+    if (OPRT_OK != tal_ota_get_ability(&max_size, &type)) {
+        type = TUYA_OTA_FULL;
+    }
+    return tal_ota_start_notify(ota->image.image_size, type, TUYA_OTA_PATH_AIR);
+}
+
+/* hand the staged decoded bytes to the flash writer, keeping what it left */
+static int ota_flash_decoded_flush(tuya_ota_t *ota)
+{
+    TUYA_OTA_DATA_T ota_pack;
+    uint32_t remain = 0;
+
+    memset(&ota_pack, 0, sizeof(ota_pack));
+    ota_pack.total_len = ota->image.image_size;
+    ota_pack.offset = ota->decode_offset;
+    ota_pack.data = ota->decode_buf;
+    ota_pack.len = ota->decode_len;
+    int rt = tal_ota_data_process(&ota_pack, &remain);
+    if (OPRT_OK != rt) {
+        return rt;
+    }
+    if (remain >= ota->decode_len) {
+        /* nothing taken from a full buffer, it will never drain */
+        return (ota->decode_len == TUYA_OTA_DECODE_BUF_LEN) ? OPRT_BUFFER_NOT_ENOUGH : OPRT_OK;
+    }
+
+    size_t used = ota->decode_len - remain;
+    memmove(ota->decode_buf, ota->decode_buf + used, remain);
+    ota->decode_offset += used;
+    ota->decode_len = remain;
+    return OPRT_OK;
+}
+
+static int ota_flash_decoded_write(tuya_ota_t *ota, const uint8_t *data, size_t len)
+{
+    int rt = OPRT_OK;
+
+    for (;;) {
+        ota->decode_len += ota_image_decode(ota->decoder, &data, &len, ota->decode_buf + ota->decode_len,
+                                            TUYA_OTA_DECODE_BUF_LEN - ota->decode_len);
+        bool done = ota_image_decode_done(ota->decoder);
+        if (ota->decode_len == TUYA_OTA_DECODE_BUF_LEN || (done && ota->decode_len)) {
+            size_t before = ota->decode_len;
+            TUYA_CALL_ERR_RETURN(ota_flash_decoded_flush(ota));
+            if (done && ota->decode_len == before) {
+                PR_ERR("ota tail of %d bytes not written", (int)before);
+                return OPRT_COM_ERROR;
+            }
+            continue;
+        }
+        if (done || 0 == len) {
+            return OPRT_OK;
+        }
+    }
+}
+
+static void ota_flash_write(tuya_ota_t *ota, http_download_event_t *event)
+{
+    int rt = OPRT_OK;
+
+    if (!ota->flash_started) {
+        /* a short first read, keep it until the header is complete */
+        if (event->data_len < OTA_IMAGE_HEAD_LEN && event->data_len < event->file_size) {
+            event->remain_len = event->data_len;
+            return;
+        }
+        rt = ota_flash_start(ota, event);
+    }
+    if (OPRT_OK != rt || ota->flash_error) {
+        ota->flash_error = true;
+        event->remain_len = 0;
+        return;
+    }
+
+    if (NULL == ota->decoder) {
+        TUYA_OTA_DATA_T ota_pack;
+
+        ota_pack.total_len = event->file_size;
+        ota_pack.offset = event->offset;
+        ota_pack.data = event->data;
+        ota_pack.len = event->data_len;
+        ota_pack.pri_data = NULL;
+        tal_ota_data_process(&ota_pack, (uint32_t *)&event->remain_len);
+        return;
+    }
+
+    /* the decoder takes every byte, nothing is handed back to the download */
+    const uint8_t *data = event->data;
+    size_t len = event->data_len;
+    if (0 == event->offset) {
+        data += OTA_IMAGE_HEAD_LEN;
+        len -= OTA_IMAGE_HEAD_LEN;
+    }
+    event->remain_len = 0;
+    rt = ota_flash_decoded_write(ota, data, len);
+    if (OPRT_OK != rt) {
+        PR_ERR("ota image decode write failed:%d", rt);
+        ota->flash_error = true;
+    }
+}
+
 static void file_download_event_cb(http_download_event_id_t id, http_download_event_t *event)
 {
     tuya_ota_t *ota = (tuya_ota_t *)event->user_data;
@@ -49,15 +287,19 @@ static void file_download_event_cb(http_download_event_id_t id, http_download_ev
     case DL_EVENT_START:
         PR_DEBUG("DL_EVENT_START");
         tuya_ota_upgrade_status_report(ota, TUS_UPGRDING);
-        tal_sha256_create_init(&ota->sha256);
-        tal_sha256_starts_ret(ota->sha256, 0);
+        if (0 == ota->resume_offset) {
+            mbedtls_sha256_init(&ota->sha256);
+            mbedtls_sha256_starts(&ota->sha256, 0);
+        }
+        ota->resume_chunks = 0;
+        ota->flash_started = false;
+        ota->flash_error = false;
         break;
 
     case DL_EVENT_ON_FILESIZE:
         PR_DEBUG("DL_EVENT_ON_FILESIZE");
-        if (0 == ota->channel) {
-            tal_ota_start_notify(event->file_size, TUYA_OTA_FULL, TUYA_OTA_PATH_AIR);
-        } else if (event_cb) {
+        /* channel 0 notifies the flash writer on the first range */
+        if (0 != ota->channel && event_cb) {
             ota->event.id = TUYA_OTA_EVENT_START;
             ota->event.file_size = event->file_size;
             ota->event.user_data = ota->config.user_data;
@@ -69,18 +311,12 @@ static void file_download_event_cb(http_download_event_id_t id, http_download_ev
         PR_DEBUG("DL_EVENT_ON_DATA:%d", event->data_len);
         PR_DEBUG("event->file_size %d, offset:%d, last remain %d", event->file_size, event->offset, event->remain_len);
         if (0 == ota->channel) {
-            TUYA_OTA_DATA_T ota_pack;
-
-            ota_pack.total_len = event->file_size;
-            ota_pack.offset = event->offset;
-            ota_pack.data = event->data;
-            ota_pack.len = event->data_len;
-            ota_pack.pri_data = NULL;
-            tal_ota_data_process(&ota_pack, (uint32_t *)&event->remain_len);
-            if (event->remain_len) {
-                tal_sha256_update_ret(ota->sha256, event->data, event->data_len - event->remain_len);
-            } else {
-                tal_sha256_update_ret(ota->sha256, event->data, event->data_len);
+            ota_flash_write(ota, event);
+            mbedtls_sha256_update(&ota->sha256, event->data, event->data_len - event->remain_len);
+            if (TUYA_OTA_RESUME_SAVE_CHUNKS && NULL == ota->decoder && !ota->flash_error &&
+                ++ota->resume_chunks >= TUYA_OTA_RESUME_SAVE_CHUNKS) {
+                ota->resume_chunks = 0;
+                ota_resume_save(ota, event->offset + event->data_len - event->remain_len);
             }
         } else if (event_cb) {
             ota->event.id = TUYA_OTA_EVENT_ON_DATA;
@@ -101,13 +337,23 @@ static void file_download_event_cb(http_download_event_id_t id, http_download_ev
     case DL_EVENT_FINISH:
         PR_DEBUG("DL_EVENT_FINISH");
         PR_DEBUG("File Download Percent: %d%%", 100);
-        tal_sha256_finish_ret(ota->sha256, file_hmac);
-        tal_sha256_free(ota->sha256);
+        mbedtls_sha256_finish(&ota->sha256, file_hmac);
+        mbedtls_sha256_free(&ota->sha256);
+        ota_resume_clear();
         hex2str((uint8_t *)file_sha256, file_hmac, 32);
         tal_sha256_mac((const uint8_t *)client->activate.seckey, strlen(client->activate.seckey), file_sha256, 32 * 2,
                        file_hmac);
         ascs2hex(self_hmac, (uint8_t *)(ota->msg.fw_hmac), FW_HMAC_LEN);
-        if ((memcmp(self_hmac, file_hmac, 32) == 0)) {
+        if (0 == ota->channel) {
+            if (ota->decoder && !ota_image_decode_done(ota->decoder)) {
+                PR_ERR("ota image truncated");
+                ota->flash_error = true;
+            }
+            ota_flash_release(ota);
+        }
+        if (0 == ota->channel && ota->flash_error) {
+            tuya_ota_upgrade_status_report(ota, TUS_UPGRD_EXEC);
+        } else if ((memcmp(self_hmac, file_hmac, 32) == 0)) {
             PR_DEBUG("file hmac check success");
             tuya_ota_upgrade_progress_report(ota, 100);
             tuya_ota_upgrade_status_report(ota, TUS_UPGRD_FINI);
@@ -123,6 +369,9 @@ static void file_download_event_cb(http_download_event_id_t id, http_download_ev
     case DL_EVENT_FAULT:
         PR_DEBUG("DL_EVENT_FAULT");
         tuya_ota_upgrade_status_report(ota, TUS_UPGRD_EXEC);
+        ota_flash_release(ota);
+        /* the resume record stays, the next attempt continues from it */
+        mbedtls_sha256_free(&ota->sha256);
         if (event_cb) {
             ota->event.id = TUYA_OTA_EVENT_FAULT;
             event_cb(&ota->msg, &ota->event);
@@ -170,6 +419,7 @@ static void ota_process_thread_func(void *arg)
     tuya_iotdns_query_domain_certs(ota->msg.fw_url, &cert, &cert_len);
 
     http_download_config_t download_cfg;
+    memset(&download_cfg, 0, sizeof(download_cfg));
     download_cfg.file_size = ota->msg.file_size;
     download_cfg.range_length = ota->config.range_size;
     download_cfg.timeout_ms = ota->config.timeout_ms;
@@ -178,6 +428,9 @@ static void ota_process_thread_func(void *arg)
     download_cfg.url = ota->msg.fw_url;
     download_cfg.event_handler = file_download_event_cb;
     download_cfg.user_data = ota;
+    download_cfg.pipeline_depth = TUYA_OTA_PIPELINE_DEPTH;
+    ota->resume_offset = ota_resume_load(ota);
+    download_cfg.start_offset = ota->resume_offset;
 
     http_file_download(&download_cfg);
     tal_free(cert);
@@ -209,6 +462,13 @@ int tuya_ota_start(cJSON *upgrade)
     ota->msg.fw_hmac[sizeof(ota->msg.fw_hmac) - 1] = '\0';
     strncpy(ota->msg.fw_md5, cJSON_GetObjectItem(upgrade, "md5")->valuestring, sizeof(ota->msg.fw_md5) - 1);
     ota->msg.fw_md5[sizeof(ota->msg.fw_md5) - 1] = '\0';
+    cJSON *version = cJSON_GetObjectItem(upgrade, "version");
+    if (cJSON_IsString(version)) {
+        strncpy(ota->msg.sw_ver, version->valuestring, sizeof(ota->msg.sw_ver) - 1);
+        ota->msg.sw_ver[sizeof(ota->msg.sw_ver) - 1] = '\0';
+    } else {
+        ota->msg.sw_ver[0] = '\0';
+    }
 
     THREAD_CFG_T thrd_param;
     thrd_param.priority = THREAD_PRIO_3;
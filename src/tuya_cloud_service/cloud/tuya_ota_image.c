@@ -0,0 +1,181 @@
+/**
+ * @file tuya_ota_image.c
+ * @brief Streaming decoder for compressed OTA images.
+ *
+ * The bit stream is MSB first. A 1 tag bit is followed by an 8 bit
+ * literal, a 0 tag bit by a back reference of window_bits (distance - 1)
+ * and lookahead_bits (count - 1). A field may be split across download
+ * chunks, so the partly read value is kept in the decoder.
+ *
+ * @copyright Copyright (c) 2021-2024 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include <string.h>
+#include "tal_api.h"
+#include "tuya_ota_image.h"
+
+typedef enum {
+    OTA_IMAGE_TAG,
+    OTA_IMAGE_LITERAL,
+    OTA_IMAGE_INDEX,
+    OTA_IMAGE_COUNT,
+    OTA_IMAGE_COPY,
+} ota_image_state_t;
+
+struct ota_image_decoder {
+    ota_image_info_t info;
+    ota_image_state_t state;
+    uint32_t produced;
+    /* bit reader */
+    uint8_t byte;
+    uint8_t mask;
+    uint16_t acc;
+    uint8_t acc_bits;
+    /* back reference being copied */
+    uint16_t index;
+    uint16_t count;
+    /* sliding window, 1 << window_bits bytes */
+    uint16_t head;
+    uint8_t window[];
+};
+
+static uint32_t get_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+int ota_image_probe(const uint8_t *head, size_t len, ota_image_info_t *info)
+{
+    if (NULL == head || NULL == info) {
+        return OPRT_INVALID_PARM;
+    }
+    if (len < OTA_IMAGE_HEAD_LEN || memcmp(head, OTA_IMAGE_MAGIC, 4)) {
+        return OPRT_NOT_FOUND;
+    }
+
+    info->window_bits = head[5];
+    info->lookahead_bits = head[6];
+    info->image_size = get_le32(head + 8);
+    if (head[4] != OTA_IMAGE_VERSION || info->window_bits < 4 || info->window_bits > OTA_IMAGE_WINDOW_BITS_MAX ||
+        info->lookahead_bits < 3 || info->lookahead_bits >= info->window_bits || 0 == info->image_size) {
+        PR_ERR("ota image v%d w%d l%d not supported", head[4], info->window_bits, info->lookahead_bits);
+        return OPRT_NOT_SUPPORTED;
+    }
+    return OPRT_OK;
+}
+
+ota_image_decoder_t *ota_image_decoder_create(const ota_image_info_t *info)
+{
+    size_t window_size = 1 << info->window_bits;
+    ota_image_decoder_t *dec = tal_malloc(sizeof(ota_image_decoder_t) + window_size);
+    if (NULL == dec) {
+        return NULL;
+    }
+
+    memset(dec, 0, sizeof(ota_image_decoder_t) + window_size);
+    dec->info = *info;
+    dec->state = OTA_IMAGE_TAG;
+    return dec;
+}
+
+/* read count bits, -1 when the input ran out first */
+static int ota_image_get_bits(ota_image_decoder_t *dec, const uint8_t **in, size_t *in_len, uint8_t count)
+{
+    while (dec->acc_bits < count) {
+        if (0 == dec->mask) {
+            if (0 == *in_len) {
+                return -1;
+            }
+            dec->byte = **in;
+            dec->mask = 0x80;
+            (*in)++;
+            (*in_len)--;
+        }
+        dec->acc = (dec->acc << 1) | ((dec->byte & dec->mask) ? 1 : 0);
+        dec->mask >>= 1;
+        dec->acc_bits++;
+    }
+
+    int value = dec->acc;
+    dec->acc = 0;
+    dec->acc_bits = 0;
+    return value;
+}
+
+static void ota_image_emit(ota_image_decoder_t *dec, uint8_t c, uint8_t *out)
+{
+    uint16_t window_mask = (1 << dec->info.window_bits) - 1;
+
+    dec->window[dec->head & window_mask] = c;
+    dec->head++;
+    dec->produced++;
+    *out = c;
+}
+
+size_t ota_image_decode(ota_image_decoder_t *dec, const uint8_t **in, size_t *in_len, uint8_t *out, size_t out_size)
+{
+    size_t produced = 0;
+    uint16_t window_mask = (1 << dec->info.window_bits) - 1;
+    int bits = 0;
+
+    while (produced < out_size && !ota_image_decode_done(dec)) {
+        switch (dec->state) {
+        case OTA_IMAGE_TAG:
+            if ((bits = ota_image_get_bits(dec, in, in_len, 1)) < 0) {
+                return produced;
+            }
+            dec->state = bits ? OTA_IMAGE_LITERAL : OTA_IMAGE_INDEX;
+            break;
+
+        case OTA_IMAGE_LITERAL:
+            if ((bits = ota_image_get_bits(dec, in, in_len, 8)) < 0) {
+                return produced;
+            }
+            ota_image_emit(dec, (uint8_t)bits, &out[produced++]);
+            dec->state = OTA_IMAGE_TAG;
+            break;
+
+        case OTA_IMAGE_INDEX:
+            if ((bits = ota_image_get_bits(dec, in, in_len, dec->info.window_bits)) < 0) {
+                return produced;
+            }
+            dec->index = bits + 1;
+            dec->state = OTA_IMAGE_COUNT;
+            break;
+
+        case OTA_IMAGE_COUNT:
+            if ((bits = ota_image_get_bits(dec, in, in_len, dec->info.lookahead_bits)) < 0) {
+                return produced;
+            }
+            dec->count = bits + 1;
+            dec->state = OTA_IMAGE_COPY;
+            break;
+
+        case OTA_IMAGE_COPY:
+            /* byte by byte, a reference may overlap the bytes it produces */
+            while (dec->count && produced < out_size && !ota_image_decode_done(dec)) {
+                uint8_t c = dec->window[(uint16_t)(dec->head - dec->index) & window_mask];
+                ota_image_emit(dec, c, &out[produced++]);
+                dec->count--;
+            }
+            if (0 == dec->count) {
+                dec->state = OTA_IMAGE_TAG;
+            }
+            break;
+        }
+    }
+    return produced;
+}
+
+bool ota_image_decode_done(const ota_image_decoder_t *dec)
+{
+    return dec->produced >= dec->info.image_size;
+}
+
+void ota_image_decoder_destroy(ota_image_decoder_t *dec)
+{
+    if (dec) {
+        tal_free(dec);
+    }
+}
@@ -0,0 +1,102 @@
+/**
+ * @file tuya_ota_image.h
+ * @brief Streaming decoder for compressed OTA images.
+ *
+ * A compressed image starts with a 16 byte little endian header
+ *
+ *   magic:4 ("TYHS") | version:1 | window_bits:1 | lookahead_bits:1 |
+ *   reserved:1 | image_size:4 | reserved:4
+ *
+ * followed by the heatshrink (LZSS) bit stream of the firmware. The
+ * decoder keeps only the sliding window, so the image is expanded chunk by
+ * chunk as it arrives and never held in RAM. Images without the header are
+ * written as they are. tools/ota/ota_image_pack.py builds the images.
+ *
+ * @copyright Copyright (c) 2021-2024 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#ifndef __TUYA_OTA_IMAGE_H__
+#define __TUYA_OTA_IMAGE_H__
+
+#include "tuya_cloud_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OTA_IMAGE_MAGIC    "TYHS"
+#define OTA_IMAGE_VERSION  1
+#define OTA_IMAGE_HEAD_LEN 16
+
+// Largest accepted window, the decoder allocates 1 << bits bytes
+#ifndef OTA_IMAGE_WINDOW_BITS_MAX
+#define OTA_IMAGE_WINDOW_BITS_MAX 12
+#endif
+
+typedef struct {
+    uint8_t window_bits;
+    uint8_t lookahead_bits;
+    /** firmware size once decoded */
+    uint32_t image_size;
+} ota_image_info_t;
+
+typedef struct ota_image_decoder ota_image_decoder_t;
+
+/**
+ * @brief parse the header of a downloaded image
+ *
+ * @param[in] head the first bytes of the image
+ * @param[in] len the length of head
+ * @param[out] info the image parameters
+ *
+ * @return OPRT_OK for a compressed image, OPRT_NOT_FOUND for a plain image,
+ * OPRT_NOT_SUPPORTED for a version or window this build can not decode
+ */
+int ota_image_probe(const uint8_t *head, size_t len, ota_image_info_t *info);
+
+/**
+ * @brief create a decoder for a probed image
+ *
+ * @param[in] info the image parameters from ota_image_probe()
+ *
+ * @return the decoder, NULL on malloc failure
+ */
+ota_image_decoder_t *ota_image_decoder_create(const ota_image_info_t *info);
+
+/**
+ * @brief decode compressed input into an output buffer
+ *
+ * Stops when the input is used up, the output is full or the image is
+ * complete, so call again with the rest of the input after draining out.
+ *
+ * @param[in] dec the decoder
+ * @param[in,out] in the compressed input, advanced past the used bytes
+ * @param[in,out] in_len the input length, reduced by the used bytes
+ * @param[out] out the output buffer
+ * @param[in] out_size the room in out
+ *
+ * @return the number of bytes written to out
+ */
+size_t ota_image_decode(ota_image_decoder_t *dec, const uint8_t **in, size_t *in_len, uint8_t *out, size_t out_size);
+
+/**
+ * @brief check whether the whole image was decoded
+ *
+ * @param[in] dec the decoder
+ *
+ * @return TRUE once image_size bytes were produced
+ */
+bool ota_image_decode_done(const ota_image_decoder_t *dec);
+
+/**
+ * @brief free a decoder
+ *
+ * @param[in] dec the decoder, may be NULL
+ */
+void ota_image_decoder_destroy(ota_image_decoder_t *dec);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -12,6 +12,11 @@
  * handling and socket event detection are integral parts of the loop to ensure
  * robust operation.
  *
+ * The watched set is kept up to date as readers come and go, so a loop pass
+ * only copies it before select instead of walking every reader to rebuild
+ * it. Subsystems share this one loop thread through tuya_reg_lan_sock()
+ * rather than each running a select thread of their own.
+ *
  * Additionally, the file includes utility functions for setting up the
  * environment for socket event handling, including initializing and
  * deinitializing resources, managing the socket readers list, and processing
@@ -40,6 +45,7 @@ typedef struct LAN_SLOOP_S {
     sloop_sock_t *readers;
     BOOL_T terminate;
     QUEUE_HANDLE queue;
+    TUYA_FD_SET_T fds; // every registered sock, read and error alike
 } LAN_SLOOP_S, *P_LAN_SLOOP_S;
 #pragma pack()
 
@@ -55,13 +61,13 @@ static uint32_t __ty_sock_get_reader_num(void)
     return (LAN_UDP_READER_CNT + tuya_lan_get_client_num());
 }
 
-static void __sock_table_set_fds(TUYA_FD_SET_T *rfds, TUYA_FD_SET_T *efds)
+static void __sock_table_max_update(void)
 {
     int idx;
+    g_sloop->max_sock = 0;
     for (idx = 0; idx < __ty_sock_get_reader_num(); idx++) {
-        if (g_sloop->readers[idx].sock >= 0) {
-            tal_net_fd_set(g_sloop->readers[idx].sock, rfds);
-            tal_net_fd_set(g_sloop->readers[idx].sock, efds);
+        if (g_sloop->readers[idx].sock > g_sloop->max_sock) {
+            g_sloop->max_sock = g_sloop->readers[idx].sock;
         }
     }
 }
@@ -147,6 +153,7 @@ void __ty_add_sock_reader(sloop_sock_t sock_info)
         return;
     }
 
+    tal_net_fd_set(sock_info.sock, &g_sloop->fds);
     return;
 }
 
@@ -156,6 +163,7 @@ void __ty_del_sock_reader(int sock)
     for (idx = 0; idx < __ty_sock_get_reader_num(); idx++) {
         if (g_sloop->readers[idx].sock == sock) {
             PR_DEBUG("unreg lan sock %d and close it", sock);
+            tal_net_fd_clear(sock, &g_sloop->fds);
             tal_net_close(g_sloop->readers[idx].sock);
             g_sloop->readers[idx].sock = -1;
             // g_sloop->readers[idx].pre_select = NULL;
@@ -172,6 +180,9 @@ void __ty_del_sock_reader(int sock)
         return;
     }
 
+    if (sock == g_sloop->max_sock) {
+        __sock_table_max_update();
+    }
     return;
 }
 
@@ -194,13 +205,15 @@ void tuya_sock_loop_run(void *data)
     // while (tuya_get_sock_loop_terminate() &&
     // tal_thread_get_state(g_sloop->thread) == THREAD_STATE_RUNNING) {
     while (tuya_get_sock_loop_terminate()) {
+        // apply every pending change, not one per select timeout
         memset(&queue_data, 0, sizeof(sloop_sock_t));
-        if (tal_queue_fetch(g_sloop->queue, &queue_data, 0) == 0) {
+        while (tal_queue_fetch(g_sloop->queue, &queue_data, 0) == 0) {
             if (queue_data.read) {
                 __ty_add_sock_reader(queue_data);
             } else {
                 __ty_del_sock_reader(queue_data.sock);
             }
+            memset(&queue_data, 0, sizeof(sloop_sock_t));
         }
         for (idx = 0; idx < __ty_sock_get_reader_num(); idx++) {
             if (g_sloop->readers[idx].pre_select) {
@@ -212,9 +225,8 @@ void tuya_sock_loop_run(void *data)
             continue;
         }
 
-        tal_net_fd_zero(rfds);
-        tal_net_fd_zero(efds);
-        __sock_table_set_fds(rfds, efds);
+        memcpy(rfds, &g_sloop->fds, sizeof(TUYA_FD_SET_T));
+        memcpy(efds, &g_sloop->fds, sizeof(TUYA_FD_SET_T));
         actv_cnt = tal_net_select(g_sloop->max_sock + 1, rfds, NULL, efds, 1 * 1000);
         if (actv_cnt < 0) {
             PR_ERR("errno:%d", tal_net_get_errno());
@@ -306,6 +318,7 @@ OPERATE_RET tuya_sock_loop_init(void)
     }
     memset(g_sloop, 0, sizeof(LAN_SLOOP_S));
     g_sloop->terminate = TRUE;
+    tal_net_fd_zero(&g_sloop->fds);
 
     op_ret = tal_queue_create_init(&g_sloop->queue, sizeof(sloop_sock_t), LAN_QUEUE_NUM);
     if (OPRT_OK != op_ret) {
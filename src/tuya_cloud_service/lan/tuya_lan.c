@@ -46,6 +46,22 @@
 #define RAND_LEN       16
 #define SESSIONKEY_LEN 16
 
+// reply buffers grow in steps of this many bytes and are kept per session
+#define LAN_TX_BUF_ALIGN 256
+
+// least gap between two discovery replies, ms. Fast while nobody found the
+// device yet, slow once a local client is connected.
+#ifndef LAN_UDP_REPLY_FAST_MS
+#define LAN_UDP_REPLY_FAST_MS 1000
+#endif
+#ifndef LAN_UDP_REPLY_SLOW_MS
+#define LAN_UDP_REPLY_SLOW_MS (UDP_T_ITRV * 1000)
+#endif
+// replies stay fast for this long after the LAN service started, ms
+#ifndef LAN_UDP_BOOT_FAST_MS
+#define LAN_UDP_BOOT_FAST_MS (60 * 1000)
+#endif
+
 typedef struct {
     BOOL_T active;
     BOOL_T fault;
@@ -57,6 +73,8 @@ typedef struct {
     uint8_t randB[RAND_LEN];
     uint8_t hmac[HMAC_LEN];
     uint8_t secret_key[SESSIONKEY_LEN];
+    uint8_t *tx_buf; // reused for every frame sent, under lan_mgr_t.mutex
+    uint32_t tx_size;
 } lan_session_t;
 
 typedef struct {
@@ -92,6 +110,12 @@ typedef struct {
 
     tuya_iot_client_t *iot_client;
     lan_cfg_t *cfg;
+    // discovery reply, rebuilt when ip or activation changes
+    uint8_t *udp_pkt;
+    int udp_pkt_len;
+    BOOL_T udp_pkt_activated;
+    SYS_TIME_T start_time;
+    SYS_TIME_T udp_reply_time;
     // extension
     uint32_t recv_offset;
     uint8_t recv_buf[0]; // keep it last !!!
@@ -113,6 +137,9 @@ static lan_mgr_t *lan_mgr_get(void)
 
 static void lan_session_free(lan_session_t *session)
 {
+    if (session->tx_buf) {
+        tal_free(session->tx_buf);
+    }
     memset(session, 0, sizeof(lan_session_t));
     session->fd = -1;
 }
@@ -447,7 +474,6 @@ static int lan_send(lan_session_t *session, uint32_t fr_num, uint32_t fr_type, u
     }
     tal_mutex_unlock(s_lan_mgr->mutex);
 
-    uint8_t *send_buf = NULL;
     uint32_t send_len = 0;
 
     PR_TRACE("tcp sendbuf socket:%d fr_num:%u fr_type:%d ret:%d len:%d", session->fd, fr_num, fr_type, ret_code, len);
@@ -465,34 +491,45 @@ static int lan_send(lan_session_t *session, uint32_t fr_num, uint32_t fr_type, u
         return OPRT_COM_ERROR;
     }
     int plaintext_len = sizeof(lpv35_plaintext_data_t) + len;
-    lpv35_plaintext_data_t *plaintext_data = tal_malloc(plaintext_len);
-    if (plaintext_data == NULL) {
-        PR_ERR("plaintext_data fail");
-        return OPRT_MALLOC_FAILED;
+    // lpv3.5 test arch
+    lpv35_frame_object_t frame = {.type = fr_type, .data = NULL, .data_len = plaintext_len};
+    uint32_t frame_size = lpv35_frame_buffer_size_get(&frame);
+
+    tal_mutex_lock(s_lan_mgr->mutex);
+    if (!session->active || session->fault) {
+        // closed while the frame was prepared
+        tal_mutex_unlock(s_lan_mgr->mutex);
+        return OPRT_SVC_LAN_SOCKET_FAULT;
     }
-    memset(plaintext_data, 0, plaintext_len);
+    if (session->tx_size < frame_size) {
+        uint32_t size = (frame_size + LAN_TX_BUF_ALIGN - 1) / LAN_TX_BUF_ALIGN * LAN_TX_BUF_ALIGN;
+        uint8_t *buf = tal_malloc(size);
+        if (buf == NULL) {
+            PR_ERR("send_buf malloc fail");
+            tal_mutex_unlock(s_lan_mgr->mutex);
+            return OPRT_MALLOC_FAILED;
+        }
+        if (session->tx_buf) {
+            tal_free(session->tx_buf);
+        }
+        session->tx_buf = buf;
+        session->tx_size = size;
+    }
+
+    // the payload is written where it is encrypted, no staging copy
+    lpv35_plaintext_data_t *plaintext_data = (lpv35_plaintext_data_t *)(session->tx_buf + LPV35_FRAME_PAYLOAD_OFFSET);
     plaintext_data->ret_code = ret_code;
-    memcpy(plaintext_data->data, data, len);
-    // lpv3.5 test arch
-    lpv35_frame_object_t frame = {.sequence = session->sequence_out++,
-                                  .type = fr_type,
-                                  .data = (void *)plaintext_data,
-                                  .data_len = plaintext_len};
-    send_buf = tal_malloc(lpv35_frame_buffer_size_get(&frame));
-    if (send_buf == NULL) {
-        PR_ERR("send_buf malloc fail");
-        tal_free(plaintext_data);
-        return OPRT_MALLOC_FAILED;
+    if (len) {
+        memcpy(plaintext_data->data, data, len);
     }
-    memset(send_buf, 0, lpv35_frame_buffer_size_get(&frame));
-    op_ret = lpv35_frame_serialize(key, 16, &frame, send_buf, (int *)&send_len);
-    tal_free(plaintext_data);
+    frame.sequence = session->sequence_out++;
+    op_ret = lpv35_frame_seal(key, 16, &frame, session->tx_buf, (int *)&send_len);
     if (op_ret != OPRT_OK) {
-        PR_ERR("lpv35_frame_serialize fail:%d", op_ret);
-        tal_free(send_buf);
+        PR_ERR("lpv35_frame_seal fail:%d", op_ret);
+        tal_mutex_unlock(s_lan_mgr->mutex);
         return OPRT_COM_ERROR;
     }
-    tal_mutex_lock(s_lan_mgr->mutex);
+    uint8_t *send_buf = session->tx_buf;
     int ret = tal_net_send(session->fd, send_buf, send_len);
     if (ret <= 0 || ret != send_len) {
         if ((tal_net_get_errno() == UNW_EINTR) || (tal_net_get_errno() == UNW_EAGAIN)) {
@@ -506,7 +543,6 @@ static int lan_send(lan_session_t *session, uint32_t fr_num, uint32_t fr_type, u
         }
     }
 
-    tal_free(send_buf);
     if (op_ret == OPRT_SVC_LAN_SEND_ERR) {
         lan_session_fault_set(session);
         PR_ERR("ret:%d send_len:%d errno:%d", ret, send_len, tal_net_get_errno());
@@ -544,18 +580,12 @@ __exit:
     return ret;
 }
 
-static void lan_make_udp_packets(uint8_t **out, int *p_olen)
+static void lan_make_udp_packets(const NW_IP_S *ip, uint8_t **out, int *p_olen)
 {
     int op_ret = OPRT_OK;
-    NW_IP_S ip;
-
-    memset(&ip, 0, sizeof(NW_IP_S));
-
-    //! TODO:
-    netmgr_conn_get(NETCONN_AUTO, NETCONN_CMD_IP, &ip);
 
     lan_mgr_t *lan = lan_mgr_get();
-    if (lan == NULL || lan->iot_client == NULL || out == NULL || p_olen == NULL) {
+    if (lan == NULL || lan->iot_client == NULL || ip == NULL || out == NULL || p_olen == NULL) {
         PR_ERR("lan_make_udp_packets invalid param");
         return;
     }
@@ -577,7 +607,7 @@ static void lan_make_udp_packets(uint8_t **out, int *p_olen)
     memset(json_buf, 0, data_len);
 
     size_t remain = data_len;
-    int ret = snprintf(json_buf + offset, remain, "{\"ip\":\"%s\",\"gwId\":\"%s\",\"uuid\":\"%s\"", ip.ip, id,
+    int ret = snprintf(json_buf + offset, remain, "{\"ip\":\"%s\",\"gwId\":\"%s\",\"uuid\":\"%s\"", ip->ip, id,
                        lan->iot_client->config.uuid);
     if (ret < 0 || (size_t)ret >= remain) {
         PR_ERR("json_buf overflow when writing ip info");
@@ -683,6 +713,58 @@ static void lan_make_udp_packets(uint8_t **out, int *p_olen)
     *out = send_buf;
 }
 
+/* the cached discovery reply, only re-encrypted when its content changes */
+static uint8_t *lan_udp_packet_get(lan_mgr_t *lan, int *p_olen)
+{
+    NW_IP_S ip;
+
+    memset(&ip, 0, sizeof(NW_IP_S));
+    netmgr_conn_get(NETCONN_AUTO, NETCONN_CMD_IP, &ip);
+
+    BOOL_T activated = lan->iot_client->is_activated;
+    if (lan->udp_pkt && lan->udp_pkt_activated == activated && 0 == strcmp(lan->ip.ip, ip.ip)) {
+        *p_olen = lan->udp_pkt_len;
+        return lan->udp_pkt;
+    }
+
+    if (lan->udp_pkt) {
+        tal_free(lan->udp_pkt);
+        lan->udp_pkt = NULL;
+    }
+
+    uint8_t *send_buf = NULL;
+    int olen = 0;
+    lan_make_udp_packets(&ip, &send_buf, &olen);
+    if (NULL == send_buf) {
+        return NULL;
+    }
+
+    PR_DEBUG("udp packet rebuilt, ip:%s active:%d", ip.ip, activated);
+    lan->udp_pkt = send_buf;
+    lan->udp_pkt_len = olen;
+    lan->udp_pkt_activated = activated;
+    memcpy(&lan->ip, &ip, sizeof(NW_IP_S));
+    *p_olen = olen;
+    return send_buf;
+}
+
+/* keep answering quickly until a client showed up, then back off */
+static BOOL_T lan_udp_reply_allowed(lan_mgr_t *lan)
+{
+    SYS_TIME_T now = tal_system_get_millisecond();
+    SYS_TIME_T gap = LAN_UDP_REPLY_SLOW_MS;
+
+    if (now - lan->start_time < LAN_UDP_BOOT_FAST_MS || 0 == lan_session_active_num_get()) {
+        gap = LAN_UDP_REPLY_FAST_MS;
+    }
+
+    if (lan->udp_reply_time && now - lan->udp_reply_time < gap) {
+        return FALSE;
+    }
+    lan->udp_reply_time = now;
+    return TRUE;
+}
+
 /**
  * @brief Reports a data point (DP) value over the local area network (LAN).
  *
@@ -804,17 +886,11 @@ static void lan_protocol_process(lan_mgr_t *lan, lan_session_t *session, lpv35_f
         // make randB
         uni_random_string((char *)(session->randB), RAND_LEN);
         // make frame buffer
-        uint8_t *frame_buffer = tal_malloc(RAND_LEN + HMAC_LEN);
-        if (NULL == frame_buffer) {
-            PR_ERR("frame_buffer tal_malloc fail");
-            break;
-        }
-        memset(frame_buffer, 0, RAND_LEN + HMAC_LEN);
+        uint8_t frame_buffer[RAND_LEN + HMAC_LEN];
         memcpy(frame_buffer, session->randB, RAND_LEN);
         memcpy(frame_buffer + RAND_LEN, session->hmac, HMAC_LEN);
         // response
         lan_send(session, frame->sequence, FRM_SECURITY_TYPE4, 0, frame_buffer, RAND_LEN + HMAC_LEN, true);
-        tal_free(frame_buffer);
         break;
 
     case FRM_SECURITY_TYPE5:
@@ -1032,8 +1108,9 @@ recv_again:
             continue;
         }
         //! TODO:
+        // decrypted where it was received, the frame is consumed anyway
         lpv35_frame_object_t frame_out = {0};
-        ret = lpv35_frame_parse(key, SESSIONKEY_LEN, frame_buffer, frame_len, &frame_out);
+        ret = lpv35_frame_parse_inplace(key, SESSIONKEY_LEN, frame_buffer, frame_len, &frame_out);
         if (ret != OPRT_OK) {
             PR_ERR("lpv35_frame_parse fail:%d", ret);
             break;
@@ -1042,9 +1119,6 @@ recv_again:
         // update time
         lan_session_time_update(session, tal_time_get_posix());
         lan_protocol_process(lan, session, &frame_out);
-        if (frame_out.data) {
-            tal_free(frame_out.data);
-        }
     }
 
     if (tmp_recv_buf) {
@@ -1167,7 +1241,7 @@ static void lan_udp_serv_sock_read(int32_t fd)
     uint32_t frame_len =
         LPV35_FRAME_HEAD_SIZE + sizeof(lpv35_fixed_head_t) + UNI_NTOHL(fixed_head->length) + LPV35_FRAME_TAIL_SIZE;
     lpv35_frame_object_t frame_out = {0};
-    op_ret = lpv35_frame_parse(app_key2, APP_KEY_LEN, frame_buffer, frame_len, &frame_out);
+    op_ret = lpv35_frame_parse_inplace(app_key2, APP_KEY_LEN, frame_buffer, frame_len, &frame_out);
     if (op_ret != OPRT_OK) {
         PR_ERR("lpv35_frame_parse fail:%d", op_ret);
         return;
@@ -1176,24 +1250,24 @@ static void lan_udp_serv_sock_read(int32_t fd)
     root = cJSON_Parse((char *)frame_out.data);
     if (NULL == root) {
         PR_ERR("Json err");
-        tal_free(frame_out.data);
         return;
     }
     if ((NULL == cJSON_GetObjectItem(root, "ip")) || (NULL == cJSON_GetObjectItem(root, "from"))) {
         PR_ERR("json data invaild");
         cJSON_Delete(root);
-        tal_free(frame_out.data);
         return;
     }
     addr_json = tal_net_str2addr(cJSON_GetObjectItem(root, "ip")->valuestring);
     // PR_DEBUG("ip:%s", cJSON_GetObjectItem(root, "ip")->valuestring);
     // PR_DEBUG("addr:0x%x, addr_json:0x%x", addr, addr_json);
     cJSON_Delete(root);
-    tal_free(frame_out.data);
+
+    if (!lan_udp_reply_allowed(lan)) {
+        return;
+    }
 
     int olen = 0;
-    uint8_t *send_buf = NULL;
-    lan_make_udp_packets(&send_buf, &olen);
+    uint8_t *send_buf = lan_udp_packet_get(lan, &olen);
     if (NULL == send_buf) {
         return;
     }
@@ -1209,7 +1283,6 @@ static void lan_udp_serv_sock_read(int32_t fd)
             op_ret = OPRT_SVC_LAN_SEND_ERR;
         }
     }
-    tal_free(send_buf);
     if (op_ret == OPRT_SVC_LAN_SEND_ERR) {
         PR_ERR("sendto Fail: len:%d ret:%d,errno:%d port:%d", olen, ret, tal_net_get_errno(), SERV_PORT_APP_UDP_BCAST);
     }
@@ -1316,6 +1389,7 @@ int tuya_lan_init(tuya_iot_client_t *iot_client)
     s_lan_mgr->udp_client_fd = -1;
     s_lan_mgr->udp_serv_fd = -1;
     s_lan_mgr->cfg = &s_lan_cfg;
+    s_lan_mgr->start_time = tal_system_get_millisecond();
     // INIT_LIST_HEAD(&s_lan_mgr->lan_ext_proto);
 
     int op_ret;
@@ -1381,6 +1455,9 @@ int tuya_lan_exit(void)
         tal_net_close(s_lan_mgr->udp_client_fd);
         s_lan_mgr->udp_client_fd = -1;
     }
+    if (s_lan_mgr->udp_pkt) {
+        tal_free(s_lan_mgr->udp_pkt);
+    }
     tal_mutex_release(s_lan_mgr->mutex);
     tal_mutex_release(s_lan_mgr->tcp_mutex);
     tal_free(s_lan_mgr);
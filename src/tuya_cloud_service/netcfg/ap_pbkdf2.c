@@ -10,19 +10,35 @@
  * password storage and to securely generate encryption keys from user-provided
  * passwords.
  *
- * The implementation leverages the mbedtls cryptographic library to perform the
- * SHA-256 hashing and the PBKDF2 algorithm. It includes a generic pbkdf2_sha256
- * function for key derivation and a specific ap_pbkdf2_cacl function tailored
- * for use cases within the Tuya IoT SDK.
+ * The HMAC-SHA256 of every iteration goes through tal_hash, so platforms with
+ * a hardware SHA engine behind tkl_hash use it. It includes a generic
+ * pbkdf2_sha256 function for key derivation and a specific ap_pbkdf2_cacl
+ * function tailored for use cases within the Tuya IoT SDK, which keeps the
+ * derived key in RAM and tal_kv so every AP client connection and every boot
+ * with the same pincode reuse it instead of deriving it again.
  *
  * @copyright Copyright (c) 2021-2024 Tuya Inc. All Rights Reserved.
  *
  */
 
 #include "tuya_cloud_types.h"
-#include "mbedtls/md.h"
-#include "mbedtls/pkcs5.h"
+#include "tal_hash.h"
+#include "tal_kv.h"
 #include "tal_log.h"
+#include "tal_system.h"
+
+#define AP_PBKDF2_ITERATIONS 1024
+#define AP_PBKDF2_KEY_LEN    37
+#define AP_PBKDF2_KV_KEY     "ap_psk"
+
+// Derived key of a pincode and uuid, tag identifies them without the pincode
+typedef struct {
+    uint8_t tag[16];
+    uint8_t key[AP_PBKDF2_KEY_LEN];
+} ap_pbkdf2_cache_t;
+
+static ap_pbkdf2_cache_t s_pbkdf2_cache;
+static bool s_pbkdf2_cached = false;
 
 /**
  * @brief Performs the PBKDF2 key derivation function using SHA256 as the
@@ -48,7 +64,10 @@ int pbkdf2_sha256(const char *passphrase, size_t passphrase_len, const char *sal
                   uint32_t key_length, unsigned char *buf, size_t buflen)
 
 {
-    int ret;
+    OPERATE_RET ret = OPRT_OK;
+    tal_hash_mac_context_t hmac;
+    uint8_t u[32], t[32], counter[4];
+    uint32_t block = 1, use_len, i;
 
     if (NULL == passphrase || NULL == salt) {
         return -1;
@@ -58,37 +77,59 @@ int pbkdf2_sha256(const char *passphrase, size_t passphrase_len, const char *sal
         return -1;
     }
 
-#if (MBEDTLS_VERSION_NUMBER <= 0x03010000)
-    mbedtls_md_context_t sha_ctx;
-    const mbedtls_md_info_t *info_sha;
-    mbedtls_md_init(&sha_ctx);
-
-    info_sha = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
-    if (info_sha == NULL) {
-        ret = -1;
-        goto exit;
+    if (OPRT_OK != tal_sha256_mac_create_init(&hmac)) {
+        return -1;
     }
 
-    if ((ret = mbedtls_md_setup(&sha_ctx, info_sha, 1)) != 0) {
-        ret = -1;
-        goto exit;
-    }
+    while (key_length > 0) {
+        counter[0] = (uint8_t)(block >> 24);
+        counter[1] = (uint8_t)(block >> 16);
+        counter[2] = (uint8_t)(block >> 8);
+        counter[3] = (uint8_t)(block);
+
+        // U1 = HMAC(passphrase, salt || INT(block))
+        ret |= tal_sha256_mac_starts(&hmac, (const uint8_t *)passphrase, passphrase_len);
+        ret |= tal_sha256_mac_update(&hmac, (const uint8_t *)salt, salt_len);
+        ret |= tal_sha256_mac_update(&hmac, counter, sizeof(counter));
+        ret |= tal_sha256_mac_finish(&hmac, u);
+        memcpy(t, u, sizeof(t));
 
-    ret = mbedtls_pkcs5_pbkdf2_hmac(&sha_ctx, (const unsigned char *)passphrase, passphrase_len,
-                                    (const unsigned char *)salt, salt_len, iterations, key_length, buf);
-    if (ret != 0) {
-        ret = -1;
-        goto exit;
+        // Un = HMAC(passphrase, Un-1), T = U1 ^ ... ^ Un
+        for (i = 1; i < (uint32_t)iterations && OPRT_OK == ret; i++) {
+            ret |= tal_sha256_mac_starts(&hmac, (const uint8_t *)passphrase, passphrase_len);
+            ret |= tal_sha256_mac_update(&hmac, u, sizeof(u));
+            ret |= tal_sha256_mac_finish(&hmac, u);
+            for (uint32_t j = 0; j < sizeof(t); j++) {
+                t[j] ^= u[j];
+            }
+        }
+        if (OPRT_OK != ret) {
+            break;
+        }
+
+        use_len = (key_length < sizeof(t)) ? key_length : sizeof(t);
+        memcpy(buf, t, use_len);
+        buf += use_len;
+        key_length -= use_len;
+        block++;
     }
 
-exit:
-    mbedtls_md_free(&sha_ctx);
-#else
-    ret = mbedtls_pkcs5_pbkdf2_hmac_ext(MBEDTLS_MD_SHA256, (const unsigned char *)passphrase, passphrase_len,
-                                        (const unsigned char *)salt, salt_len, iterations, key_length, buf);
-#endif
+    memset(u, 0, sizeof(u));
+    memset(t, 0, sizeof(t));
+    tal_sha256_mac_free(&hmac);
+
+    return (OPRT_OK == ret) ? 0 : -1;
+}
+
+static bool ap_pbkdf2_tag(const char *pin, const char *uuid, uint8_t tag[16])
+{
+    uint8_t sum[32];
 
-    return ret;
+    if (OPRT_OK != tal_sha256_mac((const uint8_t *)uuid, strlen(uuid), (const uint8_t *)pin, strlen(pin), sum)) {
+        return false;
+    }
+    memcpy(tag, sum, 16);
+    return true;
 }
 
 /**
@@ -105,5 +146,42 @@ exit:
  */
 int ap_pbkdf2_cacl(char *pin, char *uuid, uint8_t *buf, uint8_t buflen)
 {
-    return pbkdf2_sha256(pin, strlen(pin), uuid, strlen(uuid), 1024, 37, (unsigned char *)buf, buflen);
+    uint8_t tag[16];
+    uint8_t *value = NULL;
+    size_t length = 0;
+
+    if (NULL == pin || NULL == uuid || buflen < AP_PBKDF2_KEY_LEN) {
+        return -1;
+    }
+
+    if (!ap_pbkdf2_tag(pin, uuid, tag)) {
+        return pbkdf2_sha256(pin, strlen(pin), uuid, strlen(uuid), AP_PBKDF2_ITERATIONS, AP_PBKDF2_KEY_LEN,
+                             (unsigned char *)buf, buflen);
+    }
+
+    if (!s_pbkdf2_cached && OPRT_OK == tal_kv_get(AP_PBKDF2_KV_KEY, &value, &length)) {
+        if (sizeof(ap_pbkdf2_cache_t) == length) {
+            memcpy(&s_pbkdf2_cache, value, sizeof(ap_pbkdf2_cache_t));
+            s_pbkdf2_cached = true;
+        }
+        tal_kv_free(value);
+    }
+    if (s_pbkdf2_cached && 0 == memcmp(s_pbkdf2_cache.tag, tag, sizeof(tag))) {
+        memcpy(buf, s_pbkdf2_cache.key, AP_PBKDF2_KEY_LEN);
+        return 0;
+    }
+
+    SYS_TIME_T start = tal_system_get_millisecond();
+    if (0 != pbkdf2_sha256(pin, strlen(pin), uuid, strlen(uuid), AP_PBKDF2_ITERATIONS, AP_PBKDF2_KEY_LEN,
+                           (unsigned char *)buf, buflen)) {
+        return -1;
+    }
+    PR_DEBUG("ap psk derived in %dms", (int)(tal_system_get_millisecond() - start));
+
+    memcpy(s_pbkdf2_cache.tag, tag, sizeof(tag));
+    memcpy(s_pbkdf2_cache.key, buf, AP_PBKDF2_KEY_LEN);
+    s_pbkdf2_cached = true;
+    tal_kv_set(AP_PBKDF2_KV_KEY, (const uint8_t *)&s_pbkdf2_cache, sizeof(ap_pbkdf2_cache_t));
+
+    return 0;
 }
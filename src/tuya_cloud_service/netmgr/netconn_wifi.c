@@ -36,6 +36,19 @@ typedef struct {
     netmgr_conn_wifi_t *handle;
 } netmgr_wifi_msg_t;
 
+#define NETCONN_WIFI_FAST_KEY "netinfo_fast"
+
+/**
+ * @brief the ap of the last scanned connect, the FAST_WF_CONNECTED_AP_INFO_T
+ * of the driver follows
+ *
+ */
+typedef struct {
+    char ssid[WIFI_SSID_LEN + 1]; // the fast info is only valid for this ssid
+    uint8_t bssid[6];
+    uint8_t channel;
+} netconn_wifi_fast_info_t;
+
 netmgr_conn_wifi_t s_netmgr_wifi = {
     .base =
         {
@@ -60,6 +73,58 @@ netmgr_conn_wifi_t s_netmgr_wifi = {
         },
 };
 
+static void __netconn_wifi_fast_info_save(void *data)
+{
+    netmgr_conn_wifi_t *wifi = (netmgr_conn_wifi_t *)data;
+    FAST_WF_CONNECTED_AP_INFO_T *ap = NULL;
+
+    if (OPRT_OK != tal_wifi_get_connected_ap_info(&ap) || NULL == ap) {
+        PR_DEBUG("wifi fast info not supported");
+        return;
+    }
+
+    size_t size = sizeof(netconn_wifi_fast_info_t) + sizeof(FAST_WF_CONNECTED_AP_INFO_T) + ap->len;
+    netconn_wifi_fast_info_t *info = tal_malloc(size);
+    if (info) {
+        memset(info, 0, sizeof(netconn_wifi_fast_info_t));
+        strncpy(info->ssid, wifi->conn.wifi_conn_info.ssid, sizeof(info->ssid) - 1);
+        tal_wifi_get_bssid(info->bssid);
+        tal_wifi_get_cur_channel(&info->channel);
+        memcpy(info + 1, ap, sizeof(FAST_WF_CONNECTED_AP_INFO_T) + ap->len);
+        tal_kv_set(NETCONN_WIFI_FAST_KEY, (const uint8_t *)info, size);
+        PR_DEBUG("wifi fast info saved, channel %d len %d", info->channel, ap->len);
+        tal_free(info);
+    }
+    tal_free(ap);
+}
+
+static OPERATE_RET __netconn_wifi_fast_connect(netmgr_conn_wifi_t *wifi)
+{
+    OPERATE_RET rt = OPRT_OK;
+    size_t length = 0;
+    uint8_t *buf = NULL;
+
+    TUYA_CALL_ERR_RETURN(tal_kv_get(NETCONN_WIFI_FAST_KEY, &buf, &length));
+
+    netconn_wifi_fast_info_t *info = (netconn_wifi_fast_info_t *)buf;
+    FAST_WF_CONNECTED_AP_INFO_T *ap = (FAST_WF_CONNECTED_AP_INFO_T *)(info + 1);
+    if (length < sizeof(netconn_wifi_fast_info_t) + sizeof(FAST_WF_CONNECTED_AP_INFO_T) ||
+        length != sizeof(netconn_wifi_fast_info_t) + sizeof(FAST_WF_CONNECTED_AP_INFO_T) + ap->len ||
+        0 != strncmp(info->ssid, wifi->conn.wifi_conn_info.ssid, sizeof(info->ssid))) {
+        PR_DEBUG("wifi fast info stale");
+        tal_kv_free(buf);
+        tal_kv_del(NETCONN_WIFI_FAST_KEY);
+        return OPRT_COM_ERROR;
+    }
+
+    PR_DEBUG("wifi fast connect %s channel %d bssid %02x:%02x:%02x:%02x:%02x:%02x", info->ssid, info->channel,
+             info->bssid[0], info->bssid[1], info->bssid[2], info->bssid[3], info->bssid[4], info->bssid[5]);
+    rt = tal_fast_station_connect(ap);
+    tal_kv_free(buf);
+
+    return rt;
+}
+
 static void __netconn_wifi_connect_process(void *msg)
 {
     netmgr_wifi_msg_t *wifi_msg = (netmgr_wifi_msg_t *)msg;
@@ -69,9 +134,22 @@ static void __netconn_wifi_connect_process(void *msg)
     case NETCONN_WIFI_MSG_CONNECT:
         PR_DEBUG("wifi connnet %s", wifi->conn.wifi_conn_info.ssid);
         tal_wifi_station_disconnect();
-        tal_sw_timer_start(wifi->conn.timer, WIFI_CONN_TIMEOUT_MAX * 1000, TAL_TIMER_ONCE);
+        if (0 == wifi->conn.start_ms) {
+            wifi->conn.start_ms = tal_system_get_millisecond();
+        }
         wifi->conn.stat = NETCONN_WIFI_CONN_CHECK;
         tal_wifi_set_work_mode(WWM_STATION);
+        if (wifi->conn.fast) {
+            //! the cached ap did not answer, it may have moved or changed channel
+            PR_NOTICE("wifi fast connect failed, scan");
+            wifi->conn.fast = false;
+            tal_kv_del(NETCONN_WIFI_FAST_KEY);
+        } else if (OPRT_OK == __netconn_wifi_fast_connect(wifi)) {
+            wifi->conn.fast = true;
+            tal_sw_timer_start(wifi->conn.timer, WIFI_FAST_CONN_TIMEOUT * 1000, TAL_TIMER_ONCE);
+            break;
+        }
+        tal_sw_timer_start(wifi->conn.timer, WIFI_CONN_TIMEOUT_MAX * 1000, TAL_TIMER_ONCE);
         tal_wifi_station_connect((int8_t *)wifi->conn.wifi_conn_info.ssid, (int8_t *)wifi->conn.wifi_conn_info.pswd);
         break;
 
@@ -79,6 +157,8 @@ static void __netconn_wifi_connect_process(void *msg)
         tal_sw_timer_stop(wifi->conn.timer);
         wifi->conn.count = 0;
         wifi->conn.stat = NETCONN_WIFI_CONN_STOP;
+        wifi->conn.fast = false;
+        wifi->conn.start_ms = 0;
         tal_wifi_station_disconnect();
 
         //! wait disconnect event
@@ -133,12 +213,26 @@ static void __netconn_wifi_event(WF_EVENT_E event, void *arg)
     tal_sw_timer_stop(wifi->conn.timer);
     if (event == WFE_CONNECTED) {
         PR_DEBUG("wifi connected in stat %d", wifi->conn.stat);
+        if (wifi->conn.start_ms) {
+            wifi->conn.last_ms = (uint32_t)(tal_system_get_millisecond() - wifi->conn.start_ms);
+            wifi->conn.last_fast = wifi->conn.fast;
+            PR_NOTICE("wifi connected in %u ms by %s", wifi->conn.last_ms, wifi->conn.fast ? "fast connect" : "scan");
+        }
+        //! a scanned connect refreshes the cached ap for the next fast connect
+        if (!wifi->conn.fast) {
+            tal_workq_schedule(WORKQ_SYSTEM, __netconn_wifi_fast_info_save, wifi);
+        }
+        wifi->conn.fast = false;
+        wifi->conn.start_ms = 0;
         wifi->conn.count = 0;
         wifi->conn.stat = NETCONN_WIFI_CONN_LINKUP;
         wifi->base.status = NETMGR_LINK_UP;
     } else {
         //! faild or disconnect auto connect
-        if (NETCONN_WIFI_CONN_CHECK == wifi->conn.stat || NETCONN_WIFI_CONN_WAIT == wifi->conn.stat) {
+        if (NETCONN_WIFI_CONN_CHECK == wifi->conn.stat && wifi->conn.fast) {
+            //! fall back to the scan at once
+            __netconn_wifi_connect();
+        } else if (NETCONN_WIFI_CONN_CHECK == wifi->conn.stat || NETCONN_WIFI_CONN_WAIT == wifi->conn.stat) {
             tal_sw_timer_start(wifi->conn.timer, wifi->conn.table[wifi->conn.count] * 1000, TAL_TIMER_ONCE);
             if (wifi->conn.count < wifi->conn.table_size - 1) {
                 wifi->conn.count++;
@@ -170,6 +264,8 @@ static void __netconn_wifi_conn_timer(TIMER_ID timer_id, void *arg)
         wifi->conn.stat = NETCONN_WIFI_CONN_CHECK;
     } else if (NETCONN_WIFI_CONN_STOP == wifi->conn.stat) {
         wifi->conn.stat = NETCONN_WIFI_CONN_REDAY;
+    } else if (NETCONN_WIFI_CONN_CHECK == wifi->conn.stat && wifi->conn.fast) {
+        __netconn_wifi_connect();
     } else if (NETCONN_WIFI_CONN_CHECK == wifi->conn.stat) {
         PR_DEBUG("wifi connect wait %d-%d", wifi->conn.count, wifi->conn.table[wifi->conn.count]);
         tal_sw_timer_start(wifi->conn.timer, wifi->conn.table[wifi->conn.count] * 1000, TAL_TIMER_ONCE);
@@ -249,6 +345,7 @@ OPERATE_RET __netconn_wifi_netcfg_finish(int type, netcfg_info_t *info)
     memcpy(netmgr_wifi->conn.wifi_conn_info.pswd, info->passwd,
            info->p_len > WIFI_PASSWD_LEN ? WIFI_PASSWD_LEN : info->p_len);
     __netconn_wifi_info_set(&netmgr_wifi->conn.wifi_conn_info);
+    tal_kv_del(NETCONN_WIFI_FAST_KEY);
     PR_DEBUG("netcfg finished,  ssid %s, passwd %s, token %s", netmgr_wifi->conn.wifi_conn_info.ssid,
              netmgr_wifi->conn.wifi_conn_info.pswd, info->token);
     // stop all netcfg
@@ -310,6 +407,7 @@ static OPERATE_RET __wifi_reset_event_cb(void *data)
     rt = tal_wifi_station_disconnect();
     if (client->is_activated) {
         tal_kv_del("netinfo");
+        tal_kv_del(NETCONN_WIFI_FAST_KEY);
         memset(&netmgr_wifi->conn.wifi_conn_info, 0, sizeof(netmgr_wifi->conn.wifi_conn_info));
     } else {
         // stop all netcfg
@@ -400,6 +498,9 @@ OPERATE_RET netconn_wifi_set(netmgr_conn_config_type_e cmd, void *param)
         break;
     case NETCONN_CMD_SSID_PSWD: // set ssid&paswd will cause wifi
                                 // disconnect&connect
+        if (memcmp(&netmgr_wifi->conn.wifi_conn_info, param, sizeof(netconn_wifi_info_t))) {
+            tal_kv_del(NETCONN_WIFI_FAST_KEY);
+        }
         memcpy(&netmgr_wifi->conn.wifi_conn_info, (netconn_wifi_info_t *)param, sizeof(netconn_wifi_info_t));
         __netconn_wifi_connect();
         break;
@@ -420,6 +521,8 @@ OPERATE_RET netconn_wifi_set(netmgr_conn_config_type_e cmd, void *param)
 
     case NETCONN_CMD_RESET:
         tal_kv_del("netinfo");
+        tal_kv_del(NETCONN_WIFI_FAST_KEY);
+        netmgr_wifi->conn.fast = false;
         netmgr_wifi->conn.stat = NETCONN_WIFI_CONN_STOP;
         memset(&netmgr_wifi->conn.wifi_conn_info, 0, sizeof(netmgr_wifi->conn.wifi_conn_info));
         tal_wifi_station_disconnect();
@@ -474,6 +577,9 @@ OPERATE_RET netconn_wifi_get(netmgr_conn_config_type_e cmd, void *param)
     case NETCONN_CMD_STATUS:
         *(netmgr_status_e *)param = netmgr_wifi->base.status;
         break;
+    case NETCONN_CMD_RSSI:
+        TUYA_CALL_ERR_RETURN(tal_wifi_station_get_conn_ap_rssi((int8_t *)param));
+        break;
     default:
         return OPRT_NOT_SUPPORTED;
     }
@@ -71,6 +71,9 @@ typedef enum {
  */
 #define NETCONN_WIFI_CONN_TABLE 6
 #define WIFI_CONN_TIMEOUT_MAX   20
+#ifndef WIFI_FAST_CONN_TIMEOUT
+#define WIFI_FAST_CONN_TIMEOUT 5 // seconds a cached fast connect may take before the full scan
+#endif
 typedef struct {
     char ssid[WIFI_SSID_LEN + 1];   // wifi ap ssid
     char pswd[WIFI_PASSWD_LEN + 1]; // wifi passwd
@@ -87,6 +90,10 @@ typedef struct {
     uint32_t table[NETCONN_WIFI_CONN_TABLE];
     TIMER_ID timer;
     netconn_wifi_info_t wifi_conn_info; // the connected wifi info
+    bool fast;                          // connecting with the cached ap info, no scan
+    SYS_TIME_T start_ms;                // first try of the current connect
+    uint32_t last_ms;                   // time the last connect took
+    bool last_fast;                     // the last connect took the fast path
 } netconn_wifi_conn_t;
 
 /**
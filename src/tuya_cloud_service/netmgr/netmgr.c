@@ -32,6 +32,7 @@
 #include "tuya_cloud_com_defs.h"
 #include "tuya_error_code.h"
 #include "tuya_lan.h"
+#include "tuya_endpoint.h"
 
 #ifdef ENABLE_WIFI
 #include "netconn_wifi.h"
@@ -60,6 +61,10 @@ typedef struct {
     netmgr_type_e active;   // the connect now used
     netmgr_status_e status; // the network status
 
+    netmgr_type_e preferred; // the link chosen by quality, NETCONN_AUTO to go by priority
+    uint8_t hold;            // probe rounds the next choice held for
+    THREAD_HANDLE quality_thread;
+
     netmgr_conn_base_t *conn; // connections
 } netmgr_t;
 
@@ -86,6 +91,19 @@ static netmgr_type_e __get_active_conn()
 
     active_type = cur_conn->type;
 
+    // the link chosen by quality while it is up
+    while (NETCONN_AUTO != s_netmgr.preferred && cur_conn) {
+        if (cur_conn->type == s_netmgr.preferred) {
+            cur_conn->get(NETCONN_CMD_STATUS, &netmgr_status);
+            if (netmgr_status == NETMGR_LINK_UP) {
+                return cur_conn->type;
+            }
+            break;
+        }
+        cur_conn = cur_conn->next;
+    }
+    cur_conn = s_netmgr.conn;
+
     while (cur_conn) {
         netmgr_status = NETMGR_LINK_DOWN;
         cur_conn->get(NETCONN_CMD_STATUS, &netmgr_status);
@@ -186,10 +204,19 @@ static OPERATE_RET __get_netmgr_status(netmgr_type_e type, netmgr_status_e *stat
  */
 static void __netmgr_event_cb(netmgr_type_e type, netmgr_status_e status)
 {
-    // status unused
-    (void)status;
-
     if (s_netmgr.type & type) {
+        if (NETMGR_LINK_DOWN == status) {
+            netmgr_conn_base_t *conn = __get_conn_by_type(type);
+            if (conn) {
+                netmgr_quality_reset(&conn->quality);
+            }
+            //! back to priority, the link is measured again once up
+            if (type == s_netmgr.preferred) {
+                s_netmgr.preferred = NETCONN_AUTO;
+                s_netmgr.hold = 0;
+            }
+        }
+
         netmgr_status_e active_status = NETMGR_LINK_DOWN;
         netmgr_type_e active_conn = __get_active_conn();
         __get_netmgr_status(active_conn, &active_status);
@@ -225,6 +252,99 @@ static void __netmgr_event_cb(netmgr_type_e type, netmgr_status_e status)
     return;
 }
 
+/**
+ * @brief choose the link by the last quality scores
+ *
+ * The first link by priority that scores good is preferred, else the best
+ * scored one. A link takes over from the active one when it leads by the
+ * hysteresis or is a healthy link of higher priority, and only once that
+ * held for NETMGR_QUALITY_HOLD rounds.
+ *
+ * @return the link to switch to, NETCONN_AUTO to stay
+ */
+static netmgr_type_e __netmgr_quality_select(void)
+{
+    netmgr_conn_base_t *active = NULL, *pick = NULL, *best = NULL;
+    netmgr_conn_base_t *cur_conn = s_netmgr.conn;
+
+    while (cur_conn) {
+        if (NETMGR_LINK_UP == cur_conn->status) {
+            if (cur_conn->type == s_netmgr.active) {
+                active = cur_conn;
+            }
+            if (NULL == pick && cur_conn->quality.score >= NETMGR_QUALITY_GOOD_SCORE) {
+                pick = cur_conn;
+            }
+            if (NULL == best || cur_conn->quality.score > best->quality.score) {
+                best = cur_conn;
+            }
+        }
+        cur_conn = cur_conn->next;
+    }
+    if (NULL == pick) {
+        pick = best;
+    }
+
+    if (NULL == active || NULL == pick || pick == active) {
+        s_netmgr.hold = 0;
+        return NETCONN_AUTO;
+    }
+
+    if (pick->quality.score < active->quality.score + NETMGR_QUALITY_HYSTERESIS &&
+        !(pick->pri > active->pri && pick->quality.score >= NETMGR_QUALITY_GOOD_SCORE)) {
+        s_netmgr.hold = 0;
+        return NETCONN_AUTO;
+    }
+
+    if (++s_netmgr.hold < NETMGR_QUALITY_HOLD) {
+        return NETCONN_AUTO;
+    }
+    s_netmgr.hold = 0;
+
+    return pick->type;
+}
+
+static void __netmgr_quality_task(void *args)
+{
+    while (s_netmgr.inited) {
+        tal_system_sleep(NETMGR_QUALITY_INTERVAL_MS);
+
+        const tuya_endpoint_t *endpoint = tuya_endpoint_get();
+        netmgr_conn_base_t *cur_conn = s_netmgr.conn;
+
+        while (cur_conn) {
+            if (NETMGR_LINK_UP == cur_conn->status) {
+                NW_IP_S ip = {0};
+                int8_t rssi = NETMGR_QUALITY_RSSI_NONE;
+
+                //! nothing to probe before activation
+                if (endpoint && endpoint->mqtt.host[0]) {
+                    cur_conn->get(NETCONN_CMD_IP, &ip);
+                    netmgr_quality_probe(&cur_conn->quality, cur_conn->card_type, ip.ip[0] ? ip.ip : NULL,
+                                         endpoint->mqtt.host, endpoint->mqtt.port);
+                }
+                if (OPRT_OK == cur_conn->get(NETCONN_CMD_RSSI, &rssi)) {
+                    cur_conn->quality.rssi = rssi;
+                }
+                netmgr_quality_score(&cur_conn->quality);
+                PR_TRACE("netmgr [%s] rtt %d loss %d rssi %d score %d", NETMGR_TYPE_TO_STR(cur_conn->type),
+                         cur_conn->quality.rtt_ms, cur_conn->quality.loss, cur_conn->quality.rssi,
+                         cur_conn->quality.score);
+            }
+            cur_conn = cur_conn->next;
+        }
+
+        netmgr_type_e pick = __netmgr_quality_select();
+        if (NETCONN_AUTO != pick) {
+            PR_NOTICE("netmgr link quality prefers [%s] over [%s]", NETMGR_TYPE_TO_STR(pick),
+                      NETMGR_TYPE_TO_STR(s_netmgr.active));
+            s_netmgr.preferred = pick;
+            // switch and publish like any other link change
+            __netmgr_event_cb(pick, NETMGR_LINK_UP);
+        }
+    }
+}
+
 OPERATE_RET __netmgr_conn_register(netmgr_type_e type, netmgr_conn_base_t *conn)
 {
     OPERATE_RET rt = OPRT_OK;
@@ -314,6 +434,7 @@ OPERATE_RET netmgr_init(netmgr_type_e type)
     TUYA_CALL_ERR_RETURN(tal_mutex_create_init(&s_netmgr.lock));
     s_netmgr.status = NETMGR_LINK_DOWN;
     s_netmgr.type = type;
+    s_netmgr.preferred = NETCONN_AUTO;
 
 #ifdef ENABLE_WIRED
     if (type & NETCONN_WIRED) {
@@ -340,6 +461,13 @@ OPERATE_RET netmgr_init(netmgr_type_e type)
 
     s_netmgr.inited = TRUE;
 
+    // link quality only matters when there is a link to fail over to
+    if (s_netmgr.conn->next) {
+        THREAD_CFG_T thread_cfg = {.priority = THREAD_PRIO_3, .stackDepth = 4096, .thrdname = "netmgr_quality"};
+        TUYA_CALL_ERR_LOG(
+            tal_thread_create_and_start(&s_netmgr.quality_thread, NULL, NULL, __netmgr_quality_task, NULL, &thread_cfg));
+    }
+
     // Cellular not support LAN
 #if !defined(ENABLE_CELLULAR) || (ENABLE_CELLULAR == 0)
     tal_sw_timer_create(__tuya_lan_init_tm_cb, NULL, &sg_lan_init_timer);
@@ -463,10 +591,19 @@ void netmgr_cmd(int argc, char *argv[])
         // dump network connection
         PR_NOTICE("netmgr active %d, status %d", s_netmgr.active, s_netmgr.status);
         PR_NOTICE("---------------------------------------");
+        for (p_conn = s_netmgr.conn; p_conn; p_conn = p_conn->next) {
+            PR_NOTICE("type %s score %d rtt %d ms loss %d%% rssi %d%s", NETMGR_TYPE_TO_STR(p_conn->type),
+                      p_conn->quality.score, p_conn->quality.rtt_ms, p_conn->quality.loss, p_conn->quality.rssi,
+                      p_conn->type == s_netmgr.preferred ? " preferred" : "");
+        }
         if (s_netmgr.type & NETCONN_WIFI) {
             p_conn = __get_conn_by_type(NETCONN_WIFI);
             if (p_conn) {
                 PR_NOTICE("type wifi pri %d status %s", p_conn->pri, NETMGR_STATUS_TO_STR(p_conn->status));
+#ifdef ENABLE_WIFI
+                PR_NOTICE("wifi last connect %u ms by %s", s_netmgr_wifi.conn.last_ms,
+                          s_netmgr_wifi.conn.last_fast ? "fast connect" : "scan");
+#endif
             }
         }
         if (s_netmgr.type & NETCONN_WIRED) {
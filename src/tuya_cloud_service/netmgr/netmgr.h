@@ -23,6 +23,7 @@
 #include "tuya_cloud_types.h"
 
 #include "tal_network_register.h"
+#include "netmgr_quality.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -74,6 +75,7 @@ typedef enum {
                                // default
     NETCONN_CMD_CLOSE,         // close network connection
     NETCONN_CMD_RESET,         // close network connection
+    NETCONN_CMD_RSSI,          // int8_t, signal of the connected link
 } netmgr_conn_config_type_e;
 
 /**
@@ -92,6 +94,8 @@ typedef struct netmgr_conn_base {
     OPERATE_RET (*get)(netmgr_conn_config_type_e cmd, void *param);
     void (*event_cb)(netmgr_type_e type, netmgr_status_e event);
 
+    netmgr_quality_t quality; // measured by netmgr while the link is up
+
     struct netmgr_conn_base *next; // for linked list
 } netmgr_conn_base_t;
 
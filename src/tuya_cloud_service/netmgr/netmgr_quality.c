@@ -0,0 +1,104 @@
+/**
+ * @file netmgr_quality.c
+ * @brief Link quality scoring of the network manager connections.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#include "netmgr_quality.h"
+#include "tal_api.h"
+
+#define NETMGR_QUALITY_RTT_GOOD_MS 100 // connect time scored full
+#define NETMGR_QUALITY_RSSI_GOOD   -65 // RSSI scored full
+
+static uint32_t __quality_penalty(uint32_t value, uint32_t scale, uint32_t max)
+{
+    value /= scale;
+    return value > max ? max : value;
+}
+
+void netmgr_quality_reset(netmgr_quality_t *quality)
+{
+    memset(quality, 0, sizeof(netmgr_quality_t));
+}
+
+OPERATE_RET netmgr_quality_probe(netmgr_quality_t *quality, TAL_NETWORK_CARD_TYPE_E card_type, const char *bind_ip,
+                                 const char *host, uint16_t port)
+{
+    OPERATE_RET rt = OPRT_COM_ERROR;
+    TAL_NETWORK_OPS_T *ops = tal_network_get_card_ops(card_type);
+    TUYA_FD_SET_T wfds, efds;
+    SYS_TIME_T start = 0;
+    int fd = -1;
+
+    if (NULL == ops || NULL == ops->socket_create || NULL == ops->connect || NULL == ops->select ||
+        NULL == ops->fd_set || NULL == ops->fd_zero || NULL == ops->fd_isset || NULL == ops->close) {
+        return OPRT_NOT_SUPPORTED;
+    }
+
+    if (!quality->resolved) {
+        if (NULL == ops->gethostbyname || OPRT_OK != ops->gethostbyname(host, &quality->addr)) {
+            PR_DEBUG("probe %s resolve failed", host);
+            goto __loss;
+        }
+        quality->resolved = true;
+    }
+
+    fd = ops->socket_create(PROTOCOL_TCP);
+    if (fd < 0) {
+        return OPRT_SOCK_ERR;
+    }
+    if (ops->set_block) {
+        ops->set_block(fd, FALSE);
+    }
+    if (bind_ip && ops->bind && ops->str2addr) {
+        ops->bind(fd, ops->str2addr(bind_ip), 0);
+    }
+
+    start = tal_system_get_millisecond();
+    ops->connect(fd, quality->addr, port);
+
+    ops->fd_zero(&wfds);
+    ops->fd_zero(&efds);
+    ops->fd_set(fd, &wfds);
+    ops->fd_set(fd, &efds);
+    if (ops->select(fd + 1, NULL, &wfds, &efds, NETMGR_QUALITY_TIMEOUT_MS) > 0 && !ops->fd_isset(fd, &efds)) {
+        uint32_t rtt = (uint32_t)(tal_system_get_millisecond() - start);
+        quality->rtt_ms = quality->probed ? (quality->rtt_ms * 7 + rtt) / 8 : rtt;
+        rt = OPRT_OK;
+    }
+    ops->close(fd);
+
+    if (OPRT_OK == rt) {
+        quality->loss = quality->loss * 7 / 8;
+        quality->probed = true;
+        return OPRT_OK;
+    }
+
+    //! resolve again next time, the host may have moved
+    quality->resolved = false;
+
+__loss:
+    quality->loss = (quality->loss * 7 + 100) / 8;
+    quality->probed = true;
+    return rt;
+}
+
+uint8_t netmgr_quality_score(netmgr_quality_t *quality)
+{
+    uint32_t penalty = 0;
+
+    if (quality->probed) {
+        if (quality->rtt_ms > NETMGR_QUALITY_RTT_GOOD_MS) {
+            penalty += __quality_penalty(quality->rtt_ms - NETMGR_QUALITY_RTT_GOOD_MS, 10, 40);
+        }
+        penalty += quality->loss;
+    }
+    if (NETMGR_QUALITY_RSSI_NONE != quality->rssi && quality->rssi < NETMGR_QUALITY_RSSI_GOOD) {
+        penalty += __quality_penalty((uint32_t)(NETMGR_QUALITY_RSSI_GOOD - quality->rssi) * 2, 1, 40);
+    }
+
+    quality->score = penalty >= 100 ? 0 : (uint8_t)(100 - penalty);
+    return quality->score;
+}
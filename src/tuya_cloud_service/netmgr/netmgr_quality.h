@@ -0,0 +1,91 @@
+/**
+ * @file netmgr_quality.h
+ * @brief Link quality scoring of the network manager connections.
+ *
+ * Every connection that is up is probed periodically with a TCP connect to
+ * the cloud endpoint through its own network card, bound to its own address
+ * like the cloud transport binds to the active one. The connect time gives the
+ * RTT, failed probes the loss, both smoothed over the last probes. WiFi adds
+ * its RSSI. The result is a score from 0 to 100 the network manager compares
+ * the links by.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ *
+ */
+
+#ifndef __NETMGR_QUALITY_H__
+#define __NETMGR_QUALITY_H__
+
+#include "tuya_cloud_types.h"
+#include "tal_network_register.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef NETMGR_QUALITY_INTERVAL_MS
+#define NETMGR_QUALITY_INTERVAL_MS 10000 // probe period
+#endif
+#ifndef NETMGR_QUALITY_TIMEOUT_MS
+#define NETMGR_QUALITY_TIMEOUT_MS 3000 // a probe slower than this is lost
+#endif
+#ifndef NETMGR_QUALITY_GOOD_SCORE
+#define NETMGR_QUALITY_GOOD_SCORE 60 // a link at this score is kept by priority
+#endif
+#ifndef NETMGR_QUALITY_HYSTERESIS
+#define NETMGR_QUALITY_HYSTERESIS 15 // score a link must lead by to take over
+#endif
+#ifndef NETMGR_QUALITY_HOLD
+#define NETMGR_QUALITY_HOLD 3 // probe rounds a switch must hold for
+#endif
+
+#define NETMGR_QUALITY_RSSI_NONE 0 // the link has no RSSI
+
+/**
+ * @brief quality of one connection
+ *
+ */
+typedef struct {
+    bool probed;     // at least one probe was made through the link
+    uint32_t rtt_ms; // smoothed connect time
+    uint8_t loss;    // smoothed lost probes, percent
+    int8_t rssi;     // last RSSI, NETMGR_QUALITY_RSSI_NONE if unknown
+    uint8_t score;   // 0 - 100
+    bool resolved;       // addr holds the probe host
+    TUYA_IP_ADDR_T addr; // probe host resolved through the link
+} netmgr_quality_t;
+
+/**
+ * @brief forget the measures of a link, when it goes down
+ *
+ * @param quality the link quality
+ * @return none
+ */
+void netmgr_quality_reset(netmgr_quality_t *quality);
+
+/**
+ * @brief probe the cloud endpoint once through a network card
+ *
+ * @param quality the link quality, updated
+ * @param card_type the card of the link
+ * @param bind_ip the link address, may be NULL
+ * @param host probe host
+ * @param port probe port
+ * @return OPRT_OK when the probe connected
+ */
+OPERATE_RET netmgr_quality_probe(netmgr_quality_t *quality, TAL_NETWORK_CARD_TYPE_E card_type, const char *bind_ip,
+                                 const char *host, uint16_t port);
+
+/**
+ * @brief compute the score from the last measures
+ *
+ * @param quality the link quality, score updated
+ * @return the score
+ */
+uint8_t netmgr_quality_score(netmgr_quality_t *quality);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -534,33 +534,16 @@ OPERATE_RET lpv35_frame_serialize(const uint8_t *key, int key_len, const lpv35_f
     return op_ret;
 }
 
-/**
- * @brief Parses an LPV35 frame.
- *
- * This function takes the LPV35 frame key, input data, and output object as
- * parameters and parses the LPV35 frame to populate the output object with the
- * parsed data.
- *
- * @param key The LPV35 frame key.
- * @param key_len The length of the LPV35 frame key.
- * @param input The input data containing the LPV35 frame.
- * @param ilen The length of the input data.
- * @param output The output object to store the parsed data.
- *
- * @return The result of the operation. Possible return values are:
- *         - OPRT_OK: The LPV35 frame was successfully parsed.
- *         - OPRT_INVALID_PARM: Invalid parameters were provided.
- *         - OPRT_PARSE_FRAME_ERR: Error occurred while parsing the LPV35 frame.
- */
-OPERATE_RET lpv35_frame_parse(const uint8_t *key, int key_len, const uint8_t *input, int ilen,
-                              lpv35_frame_object_t *output)
+/* Check the framing of an LPV35 frame and find its ciphertext, the nonce is
+ * right before it and the tag right after */
+static OPERATE_RET lpv35_frame_locate(const uint8_t *input, int ilen, lpv35_frame_object_t *output,
+                                      const uint8_t **data)
 {
-    OPERATE_RET op_ret = OPRT_OK;
     int offset = 0;
 
-    if (key == NULL || key_len == 0 || input == NULL || ilen == 0 || output == NULL) {
-        PR_ERR("PARAM ERROR");
-        return OPRT_INVALID_PARM;
+    if (ilen < LPV35_FRAME_MINI_SIZE) {
+        PR_ERR("LPV35 frame too short:%d", ilen);
+        return OPRT_COM_ERROR;
     }
 
     // head tail verify
@@ -582,20 +565,17 @@ OPERATE_RET lpv35_frame_parse(const uint8_t *key, int key_len, const uint8_t *in
     // sequence
     memcpy(&output->sequence, input + offset, LPV35_FRAME_SEQUENCE_SIZE);
     output->sequence = UNI_HTONL(output->sequence);
-    // PR_DEBUG("sequence:0x%x", output->sequence);
     offset += LPV35_FRAME_SEQUENCE_SIZE;
 
     // type
     memcpy(&output->type, input + offset, LPV35_FRAME_TYPE_SIZE);
     output->type = UNI_HTONL(output->type);
-    // PR_DEBUG("type:0x%x", output->type);
     offset += LPV35_FRAME_TYPE_SIZE;
 
     // length
     uint32_t length = 0;
     memcpy(&length, input + offset, LPV35_FRAME_DATALEN_SIZE);
     length = UNI_HTONL(length);
-    // PR_DEBUG("length:%d", length);
     offset += LPV35_FRAME_DATALEN_SIZE;
 
     // length verify
@@ -604,23 +584,49 @@ OPERATE_RET lpv35_frame_parse(const uint8_t *key, int key_len, const uint8_t *in
         return OPRT_COM_ERROR;
     }
 
-    // nonce
-    uint8_t nonce[LPV35_FRAME_NONCE_SIZE];
-    memcpy(nonce, input + offset, LPV35_FRAME_NONCE_SIZE);
-    // tuya_debug_hex_dump("nonce", LPV35_FRAME_NONCE_SIZE, nonce,
-    // LPV35_FRAME_NONCE_SIZE);
-    offset += LPV35_FRAME_NONCE_SIZE;
-
-    // encryption data
-    uint8_t *data = (uint8_t *)(input + offset);
+    *data = input + offset + LPV35_FRAME_NONCE_SIZE;
     output->data_len = length - LPV35_FRAME_NONCE_SIZE - LPV35_FRAME_TAG_SIZE;
-    offset += output->data_len;
+    return OPRT_OK;
+}
 
-    // tag
-    uint8_t tag[LPV35_FRAME_TAG_SIZE];
-    memcpy(tag, input + offset, LPV35_FRAME_TAG_SIZE);
+/**
+ * @brief Parses an LPV35 frame.
+ *
+ * This function takes the LPV35 frame key, input data, and output object as
+ * parameters and parses the LPV35 frame to populate the output object with the
+ * parsed data.
+ *
+ * @param key The LPV35 frame key.
+ * @param key_len The length of the LPV35 frame key.
+ * @param input The input data containing the LPV35 frame.
+ * @param ilen The length of the input data.
+ * @param output The output object to store the parsed data.
+ *
+ * @return The result of the operation. Possible return values are:
+ *         - OPRT_OK: The LPV35 frame was successfully parsed.
+ *         - OPRT_INVALID_PARM: Invalid parameters were provided.
+ *         - OPRT_PARSE_FRAME_ERR: Error occurred while parsing the LPV35 frame.
+ */
+OPERATE_RET lpv35_frame_parse(const uint8_t *key, int key_len, const uint8_t *input, int ilen,
+                              lpv35_frame_object_t *output)
+{
+    OPERATE_RET op_ret = OPRT_OK;
+    const uint8_t *data = NULL;
 
-    // AD
+    if (key == NULL || key_len == 0 || input == NULL || ilen == 0 || output == NULL) {
+        PR_ERR("PARAM ERROR");
+        return OPRT_INVALID_PARM;
+    }
+    op_ret = lpv35_frame_locate(input, ilen, output, &data);
+    if (op_ret != OPRT_OK) {
+        return op_ret;
+    }
+
+    // nonce, tag and AD
+    uint8_t nonce[LPV35_FRAME_NONCE_SIZE];
+    memcpy(nonce, data - LPV35_FRAME_NONCE_SIZE, LPV35_FRAME_NONCE_SIZE);
+    uint8_t tag[LPV35_FRAME_TAG_SIZE];
+    memcpy(tag, data + output->data_len, LPV35_FRAME_TAG_SIZE);
     lpv35_additional_data_t ad;
     memcpy(&ad, input + LPV35_FRAME_HEAD_SIZE, sizeof(lpv35_additional_data_t));
 
@@ -636,7 +642,7 @@ OPERATE_RET lpv35_frame_parse(const uint8_t *key, int key_len, const uint8_t *in
                                                                           .nonce_len = LPV35_FRAME_NONCE_SIZE,
                                                                           .ad = (uint8_t *)(&ad),
                                                                           .ad_len = sizeof(lpv35_additional_data_t),
-                                                                          .data = data,
+                                                                          .data = (uint8_t *)data,
                                                                           .data_len = output->data_len},
                                                  output->data, &decrypt_olen, tag, LPV35_FRAME_TAG_SIZE);
     if (op_ret != OPRT_OK) {
@@ -646,7 +652,119 @@ OPERATE_RET lpv35_frame_parse(const uint8_t *key, int key_len, const uint8_t *in
         return op_ret;
     }
     output->data_len = (uint32_t)decrypt_olen;
-    offset += output->data_len;
+
+    return op_ret;
+}
+
+/**
+ * @brief Parses an LPV35 frame, decrypting it where it lies.
+ *
+ * The plaintext overwrites the ciphertext in input and is NUL terminated
+ * over the first tag byte, output->data points into input and must not be
+ * freed. Nothing is allocated.
+ *
+ * @param key The LPV35 frame key.
+ * @param key_len The length of the LPV35 frame key.
+ * @param input The LPV35 frame, overwritten.
+ * @param ilen The length of the frame.
+ * @param output The output object to store the parsed data.
+ *
+ * @return OPRT_OK on success, as lpv35_frame_parse() otherwise.
+ */
+OPERATE_RET lpv35_frame_parse_inplace(const uint8_t *key, int key_len, uint8_t *input, int ilen,
+                                      lpv35_frame_object_t *output)
+{
+    OPERATE_RET op_ret = OPRT_OK;
+    const uint8_t *located = NULL;
+
+    if (key == NULL || key_len == 0 || input == NULL || ilen == 0 || output == NULL) {
+        PR_ERR("PARAM ERROR");
+        return OPRT_INVALID_PARM;
+    }
+    op_ret = lpv35_frame_locate(input, ilen, output, &located);
+    if (op_ret != OPRT_OK) {
+        return op_ret;
+    }
+
+    uint8_t *data = (uint8_t *)located;
+    lpv35_additional_data_t ad;
+    memcpy(&ad, input + LPV35_FRAME_HEAD_SIZE, sizeof(lpv35_additional_data_t));
+
+    op_ret = tal_aes_gcm_auth_decrypt(key, key_len * 8, data - LPV35_FRAME_NONCE_SIZE, LPV35_FRAME_NONCE_SIZE,
+                                      (const uint8_t *)&ad, sizeof(ad), data + output->data_len, LPV35_FRAME_TAG_SIZE,
+                                      output->data_len, data, data);
+    if (op_ret != OPRT_OK) {
+        PR_ERR("tal_aes_gcm_auth_decrypt:%d", op_ret);
+        output->data = NULL;
+        return op_ret;
+    }
+
+    data[output->data_len] = '\0';
+    output->data = data;
+
+    return op_ret;
+}
+
+/**
+ * @brief Encrypts and frames a payload already placed in the frame buffer.
+ *
+ * The input->data_len bytes of plaintext are expected at
+ * LPV35_FRAME_PAYLOAD_OFFSET and are encrypted in place, so the payload is
+ * never copied. input->data is not used.
+ *
+ * @param key The key used for encryption.
+ * @param key_len The length of the key.
+ * @param input Sequence, type and payload length of the frame.
+ * @param frame Buffer of lpv35_frame_buffer_size_get() bytes.
+ * @param olen The length of the finished frame.
+ *
+ * @return OPRT_OK on success. Others on error, please refer to tuya_error_code.h
+ */
+OPERATE_RET lpv35_frame_seal(const uint8_t *key, int key_len, const lpv35_frame_object_t *input, uint8_t *frame,
+                             int *olen)
+{
+    if (key == NULL || key_len == 0 || input == NULL || frame == NULL || olen == NULL) {
+        PR_ERR("PARAM ERROR");
+        return OPRT_INVALID_PARM;
+    }
+
+    OPERATE_RET op_ret = OPRT_OK;
+    int offset = 0;
+
+    // HEAD
+    memcpy(frame, LPV35_FRAME_HEAD, LPV35_FRAME_HEAD_SIZE);
+    offset += LPV35_FRAME_HEAD_SIZE;
+
+    // AD
+    lpv35_additional_data_t ad = {.version = 0,
+                                  .sequence = UNI_HTONL(input->sequence),
+                                  .type = UNI_HTONL(input->type),
+                                  .length = UNI_HTONL(LPV35_FRAME_NONCE_SIZE + input->data_len + LPV35_FRAME_TAG_SIZE)};
+    memcpy(frame + offset, (uint8_t *)&ad, sizeof(lpv35_additional_data_t));
+    offset += sizeof(lpv35_additional_data_t);
+
+    // nonce
+    uint8_t *nonce = frame + offset;
+    for (uint8_t i = 0; i < LPV35_FRAME_NONCE_SIZE; i++) {
+        nonce[i] = uni_random_range(0xFF);
+    }
+    offset += LPV35_FRAME_NONCE_SIZE;
+
+    // AES GCM encrypt, payload and tag written in place
+    uint8_t *data = frame + offset;
+    op_ret = tal_aes_gcm_encrypt_and_tag(key, key_len * 8, nonce, LPV35_FRAME_NONCE_SIZE, (const uint8_t *)&ad,
+                                         sizeof(ad), input->data_len, data, data, data + input->data_len,
+                                         LPV35_FRAME_TAG_SIZE);
+    if (op_ret != OPRT_OK) {
+        PR_ERR("tal_aes_gcm_encrypt_and_tag:%d", op_ret);
+        return op_ret;
+    }
+    offset += input->data_len + LPV35_FRAME_TAG_SIZE;
+
+    // TAIL
+    memcpy(frame + offset, LPV35_FRAME_TAIL, LPV35_FRAME_TAIL_SIZE);
+    offset += LPV35_FRAME_TAIL_SIZE;
+    *olen = offset;
 
     return op_ret;
 }
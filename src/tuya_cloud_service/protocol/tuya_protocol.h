@@ -88,6 +88,9 @@ typedef struct {
     uint32_t data_len;
 } lpv35_frame_object_t;
 
+// plaintext position in a frame buffer, see lpv35_frame_seal()
+#define LPV35_FRAME_PAYLOAD_OFFSET (LPV35_FRAME_HEAD_SIZE + sizeof(lpv35_additional_data_t) + LPV35_FRAME_NONCE_SIZE)
+
 typedef dp_cmd_type_t DP_CMD_TYPE_E;
 /***********************************************************
  *  Function: parse_data_with_cmd
@@ -159,6 +162,37 @@ OPERATE_RET lpv35_frame_serialize(const uint8_t *key, int key_len, const lpv35_f
 OPERATE_RET lpv35_frame_parse(const uint8_t *key, int key_len, const uint8_t *input, int ilen,
                               lpv35_frame_object_t *output);
 
+/**
+ * @brief lpv35 frame parse, decrypting in place
+ *
+ * @param[in] key decrypt key
+ * @param[in] key_len decrypt key len
+ * @param[in,out] input lpv35 frame, the plaintext overwrites it
+ * @param[in] ilen lpv35 frame len
+ * @param[out] output raw lpv35 data, data points into input and is NUL
+ * terminated, do not free it
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET lpv35_frame_parse_inplace(const uint8_t *key, int key_len, uint8_t *input, int ilen,
+                                      lpv35_frame_object_t *output);
+
+/**
+ * @brief encrypt and frame a payload placed at LPV35_FRAME_PAYLOAD_OFFSET
+ *
+ * @param[in] key encrypt key
+ * @param[in] key_len encrypt key len
+ * @param[in] input sequence, type and data_len, data is not used
+ * @param[in,out] frame buffer of lpv35_frame_buffer_size_get() bytes
+ * @param[out] olen out frame data len
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET lpv35_frame_seal(const uint8_t *key, int key_len, const lpv35_frame_object_t *input, uint8_t *frame,
+                             int *olen);
+
 /**
  * @brief get lpv35 frame buffer size
  *
@@ -12,8 +12,6 @@
  *
  */
 
-#include <inttypes.h>
-#include <stdarg.h>
 #include "tuya_cloud_types.h"
 #include "dp_schema.h"
 #include "cJSON.h"
@@ -24,7 +22,10 @@
 
 #define MAX_TRANS_TYPE_NUM (DTT_SCT_SCENE + 1)
 
+/* gateway builds raise this for their sub-devices, schema_list is hashed by devid */
+#ifndef DP_SCHEMA_NUM_MAX
 #define DP_SCHEMA_NUM_MAX 1
+#endif
 
 typedef struct {
     // DELAYED_WORK_HANDLE tmm_dp_sync;
@@ -36,25 +37,130 @@ typedef struct {
 
 static dp_schema_mgr_t s_dsmgr = {0};
 
-static bool dp_snprintf_append(char *buf, size_t buf_len, size_t *offset, const char *fmt, ...)
+/* FNV-1a */
+static uint32_t dp_schema_devid_hash(const char *devid)
 {
-    if (buf == NULL || offset == NULL || *offset >= buf_len) {
-        return false;
+    uint32_t hash = 2166136261u;
+    while (*devid) {
+        hash = (hash ^ (uint8_t)*devid++) * 16777619u;
     }
+    return hash;
+}
+
+/* Slot of devid in the linear probed schema_list, -1 if not present */
+static int dp_schema_slot_find(const char *devid, uint32_t hash)
+{
+    dp_schema_mgr_t *dsmgr = &s_dsmgr;
+    int slot = hash % DP_SCHEMA_NUM_MAX;
 
-    va_list args;
-    va_start(args, fmt);
-    int ret = vsnprintf(buf + *offset, buf_len - *offset, fmt, args);
-    va_end(args);
+    for (int i = 0; i < DP_SCHEMA_NUM_MAX; i++) {
+        dp_schema_t *schema = dsmgr->schema_list[slot];
+        if (NULL == schema) {
+            return -1;
+        }
+        if (schema->devid_hash == hash && 0 == strcmp(devid, schema->devid)) {
+            return slot;
+        }
+        PR_TRACE("find schema devid %s, not match!", schema->devid);
+        slot = (slot + 1) % DP_SCHEMA_NUM_MAX;
+    }
+    return -1;
+}
 
-    if (ret < 0 || (size_t)ret >= buf_len - *offset) {
+/* Report JSON writers: append at *offset, false if buf_len would be exceeded */
+static bool dp_json_put(char *buf, size_t buf_len, size_t *offset, const char *src, size_t len)
+{
+    if (*offset + len > buf_len) {
         return false;
     }
 
-    *offset += (size_t)ret;
+    memcpy(buf + *offset, src, len);
+    *offset += len;
     return true;
 }
 
+static bool dp_json_put_cstr(char *buf, size_t buf_len, size_t *offset, const char *str)
+{
+    return dp_json_put(buf, buf_len, offset, str, strlen(str));
+}
+
+static bool dp_json_put_uint(char *buf, size_t buf_len, size_t *offset, uint32_t value)
+{
+    char digits[10];
+    size_t n = 0;
+
+    do {
+        digits[sizeof(digits) - 1 - n++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value);
+
+    return dp_json_put(buf, buf_len, offset, &digits[sizeof(digits) - n], n);
+}
+
+static bool dp_json_put_int(char *buf, size_t buf_len, size_t *offset, int32_t value)
+{
+    if (value < 0) {
+        return dp_json_put(buf, buf_len, offset, "-", 1) && dp_json_put_uint(buf, buf_len, offset, 0u - (uint32_t)value);
+    }
+
+    return dp_json_put_uint(buf, buf_len, offset, (uint32_t)value);
+}
+
+/* Quoted and escaped as cJSON_PrintUnformatted() does */
+static bool dp_json_put_str(char *buf, size_t buf_len, size_t *offset, const char *str)
+{
+    static const char hex[] = "0123456789abcdef";
+    const char *run = str;
+
+    if (!dp_json_put(buf, buf_len, offset, "\"", 1)) {
+        return false;
+    }
+
+    for (; *str; str++) {
+        uint8_t ch = (uint8_t)*str;
+        char esc[6] = {'\\', 0, '0', '0', 0, 0};
+        size_t esc_len = 2;
+
+        switch (ch) {
+        case '"':
+        case '\\':
+            esc[1] = (char)ch;
+            break;
+        case '\b':
+            esc[1] = 'b';
+            break;
+        case '\f':
+            esc[1] = 'f';
+            break;
+        case '\n':
+            esc[1] = 'n';
+            break;
+        case '\r':
+            esc[1] = 'r';
+            break;
+        case '\t':
+            esc[1] = 't';
+            break;
+        default:
+            if (ch >= 0x20) {
+                continue;
+            }
+            esc[1] = 'u';
+            esc[4] = hex[ch >> 4];
+            esc[5] = hex[ch & 0x0f];
+            esc_len = 6;
+            break;
+        }
+
+        if (!dp_json_put(buf, buf_len, offset, run, str - run) || !dp_json_put(buf, buf_len, offset, esc, esc_len)) {
+            return false;
+        }
+        run = str + 1;
+    }
+
+    return dp_json_put(buf, buf_len, offset, run, str - run) && dp_json_put(buf, buf_len, offset, "\"", 1);
+}
+
 /**
  * @brief Appends a JSON string to the given data with the specified time, type,
  * and repetition sequence.
@@ -81,7 +187,7 @@ int dp_rept_json_append(dp_schema_t *schema, char *data, char *time, char *type,
         return OPRT_INVALID_PARM;
     }
 
-    int len = 0;
+    size_t len = 0;
 
     if (NULL == time) {
         len = strlen(data) + 128;
@@ -90,47 +196,44 @@ int dp_rept_json_append(dp_schema_t *schema, char *data, char *time, char *type,
     }
     char *tmp = tal_malloc(len);
     if (NULL == tmp) {
-        PR_ERR("tal_malloc err:%d", len);
+        PR_ERR("tal_malloc err:%d", (int)len);
         return OPRT_MALLOC_FAILED;
     }
-    memset(tmp, 0, len);
 
-    int offset = 0;
-    int ret = 0;
-    ret = snprintf(tmp + offset, len - offset, "{\"dps\":%s,\"devId\":\"%s\"", data, schema->devid);
-    if (ret < 0 || ret >= len - offset) {
+    size_t offset = 0;
+    if (!dp_json_put_cstr(tmp, len, &offset, "{\"dps\":") || !dp_json_put_cstr(tmp, len, &offset, data) ||
+        !dp_json_put_cstr(tmp, len, &offset, ",\"devId\":\"") || !dp_json_put_cstr(tmp, len, &offset, schema->devid) ||
+        !dp_json_put(tmp, len, &offset, "\"", 1)) {
         goto __err_exit;
     }
-    offset += ret;
     if (time) {
-        ret = snprintf(tmp + offset, len - offset, ",\"t\":%s", time);
-        if (ret < 0 || ret >= len - offset) {
+        if (!dp_json_put_cstr(tmp, len, &offset, ",\"t\":") || !dp_json_put_cstr(tmp, len, &offset, time)) {
             goto __err_exit;
         }
-        offset += ret;
     }
     if (rept_seq > 0) {
-        ret = snprintf(tmp + offset, len - offset, ",\"seq\":\"%u\"", rept_seq);
-        if (ret < 0 || ret >= len - offset) {
+        if (!dp_json_put_cstr(tmp, len, &offset, ",\"seq\":\"") || !dp_json_put_uint(tmp, len, &offset, rept_seq) ||
+            !dp_json_put(tmp, len, &offset, "\"", 1)) {
             goto __err_exit;
         }
-        offset += ret;
     }
     if (type) {
-        ret = snprintf(tmp + offset, len - offset, ",\"type\":\"%s\"", type);
-        if (ret < 0 || ret >= len - offset) {
+        if (!dp_json_put_cstr(tmp, len, &offset, ",\"type\":\"") || !dp_json_put_cstr(tmp, len, &offset, type) ||
+            !dp_json_put(tmp, len, &offset, "\"", 1)) {
             goto __err_exit;
         }
-        offset += ret;
     }
-    tmp[offset] = '}';
+    /* closing brace and NUL */
+    if (!dp_json_put(tmp, len, &offset, "}", 2)) {
+        goto __err_exit;
+    }
     *pp_out = tmp;
 
     return OPRT_OK;
 
 __err_exit:
     tal_free(tmp);
-    PR_ERR("snprintf %d", offset);
+    PR_ERR("dp rept json overflow %d", (int)offset);
     return OPRT_COM_ERROR;
 }
 
@@ -143,16 +246,18 @@ __err_exit:
  */
 dp_node_t *dp_node_find(dp_schema_t *schema, int id)
 {
-    int i;
-    dp_node_t *dpnode = NULL;
-
-    for (i = 0; i < schema->num; i++) {
-        if (schema->node[i].desc.id == id) {
-            dpnode = &schema->node[i];
-            break;
-        }
+    if (id < 0 || id >= (int)sizeof(schema->id_index) || DP_NODE_INDEX_NONE == schema->id_index[id]) {
+        return NULL;
     }
-    return dpnode;
+
+    return &schema->node[schema->id_index[id]];
+}
+
+/* schema mutex held */
+static void dp_node_mark_local(dp_schema_t *schema, dp_node_t *dpnode)
+{
+    dpnode->pv_stat = PV_STAT_LOCAL;
+    dpnode->seq = ++schema->seq;
 }
 
 /**
@@ -163,22 +268,10 @@ dp_node_t *dp_node_find(dp_schema_t *schema, int id)
  */
 dp_schema_t *dp_schema_find(const char *devid)
 {
-    int i = 0;
-
     PR_TRACE("try to find schema devid %s", devid);
-    dp_schema_mgr_t *dsmgr = &s_dsmgr;
-    for (i = 0; i < DP_SCHEMA_NUM_MAX; i++) {
-        if (NULL == dsmgr->schema_list[i]) {
-            continue;
-        }
-        if (0 == strcmp(devid, dsmgr->schema_list[i]->devid)) {
-            return dsmgr->schema_list[i];
-        }
-
-        PR_TRACE("find schema devid %s, not match!", dsmgr->schema_list[i]->devid);
-    }
+    int slot = dp_schema_slot_find(devid, dp_schema_devid_hash(devid));
 
-    return NULL;
+    return slot < 0 ? NULL : s_dsmgr.schema_list[slot];
 }
 
 /**
@@ -322,6 +415,97 @@ static __attribute__((unused)) OPERATE_RET dp_obj_equal_resp(dp_schema_t *schema
     return op_ret;
 }
 
+#define DP_RECV_OTHER  0
+#define DP_RECV_BOOL   1
+#define DP_RECV_NUMBER 2
+#define DP_RECV_STRING 3
+
+/* One "dps" member, read from either the cJSON tree or the scanned tokens */
+typedef struct {
+    int id;
+    uint8_t kind;
+    bool bool_val;
+    int int_val;
+    char *str_val;
+} dp_recv_item_t;
+
+typedef struct {
+    dp_recv_msg_t *msg;
+    cJSON *item;
+    int tok;
+    uint16_t left;
+} dp_recv_iter_t;
+
+static bool dp_recv_iter_init(dp_recv_iter_t *iter, dp_recv_msg_t *msg)
+{
+    memset(iter, 0, sizeof(dp_recv_iter_t));
+    iter->msg = msg;
+
+    if (msg->toks) {
+        int dps = json_scan_find(msg->json, msg->toks, msg->tok_num, 0, "dps");
+        if (dps < 0 || msg->toks[dps].type != JSON_TOK_OBJECT) {
+            return FALSE;
+        }
+        iter->tok = dps + 1;
+        iter->left = msg->toks[dps].size;
+        return TRUE;
+    }
+
+    cJSON *dps_js = cJSON_GetObjectItem(msg->data_js, "dps");
+    if (NULL == dps_js) {
+        return FALSE;
+    }
+    iter->item = dps_js->child;
+    return TRUE;
+}
+
+static bool dp_recv_iter_next(dp_recv_iter_t *iter, dp_recv_item_t *out)
+{
+    dp_recv_msg_t *msg = iter->msg;
+
+    memset(out, 0, sizeof(dp_recv_item_t));
+    if (msg->toks) {
+        if (0 == iter->left) {
+            return FALSE;
+        }
+        json_tok_t *value = &msg->toks[iter->tok + 1];
+        char c = msg->json[value->start];
+        /* the key is not NUL terminated, atoi stops at the closing quote */
+        out->id = atoi(msg->json + msg->toks[iter->tok].start);
+        if (JSON_TOK_STRING == value->type) {
+            out->kind = DP_RECV_STRING;
+            out->str_val = json_scan_str(msg->json, value);
+        } else if (JSON_TOK_PRIMITIVE == value->type && (c == 't' || c == 'f')) {
+            out->kind = DP_RECV_BOOL;
+            out->bool_val = (c == 't');
+        } else if (JSON_TOK_PRIMITIVE == value->type && c != 'n') {
+            out->kind = DP_RECV_NUMBER;
+            out->int_val = json_scan_int(msg->json, value);
+        }
+        iter->tok = json_scan_skip(msg->toks, msg->tok_num, iter->tok + 1);
+        iter->left--;
+        return TRUE;
+    }
+
+    cJSON *item = iter->item;
+    if (NULL == item) {
+        return FALSE;
+    }
+    out->id = atoi(item->string);
+    out->int_val = item->valueint;
+    if (cJSON_IsBool(item)) {
+        out->kind = DP_RECV_BOOL;
+        out->bool_val = (cJSON_True == item->type);
+    } else if (cJSON_Number == item->type) {
+        out->kind = DP_RECV_NUMBER;
+    } else if (cJSON_String == item->type) {
+        out->kind = DP_RECV_STRING;
+        out->str_val = item->valuestring;
+    }
+    iter->item = item->next;
+    return TRUE;
+}
+
 /**
  * Parses the received data and invokes the callback function.
  *
@@ -335,20 +519,20 @@ int dp_data_recv_parse(dp_recv_msg_t *msg, dp_recv_cb_t dp_recv_cb)
     uint16_t dpscnt = 0;
     dp_obj_recv_t *dpobj = NULL;
     dp_node_t *dpnode = NULL;
-    cJSON *item = NULL;
+    dp_recv_iter_t iter;
+    dp_recv_item_t item;
     dp_schema_t *schema = dp_schema_find(msg->devid);
-    cJSON *dps_js = cJSON_GetObjectItem(msg->data_js, "dps");
 
-    if (NULL == schema || NULL == dps_js) {
+    if (NULL == schema || !dp_recv_iter_init(&iter, msg)) {
         PR_ERR("dev null or no dps");
         return OPRT_COM_ERROR;
     }
 
     tal_mutex_lock(schema->mutex);
-    for (item = dps_js->child; item != NULL; item = item->next) {
-        dpnode = dp_node_find(schema, atoi(item->string));
+    while (dp_recv_iter_next(&iter, &item)) {
+        dpnode = dp_node_find(schema, item.id);
         if (dpnode == NULL) {
-            PR_ERR("DP ID %d Invalid", atoi(item->string));
+            PR_ERR("DP ID %d Invalid", item.id);
             continue;
             ;
         }
@@ -379,16 +563,17 @@ int dp_data_recv_parse(dp_recv_msg_t *msg, dp_recv_cb_t dp_recv_cb)
        decide whether to reply directly.
         */
     int i = 0;
+    dp_recv_iter_init(&iter, msg);
     tal_mutex_lock(schema->mutex);
-    for (item = dps_js->child; item != NULL; item = item->next) {
-        dpnode = dp_node_find(schema, atoi(item->string));
+    while (dp_recv_iter_next(&iter, &item)) {
+        dpnode = dp_node_find(schema, item.id);
         if (NULL == dpnode) {
-            PR_ERR("DP ID %d Invalid", atoi(item->string));
+            PR_ERR("DP ID %d Invalid", item.id);
             continue;
         }
-        if (T_RAW == dpnode->desc.type && cJSON_String == item->type) { // raw dp process
+        if (T_RAW == dpnode->desc.type && DP_RECV_STRING == item.kind) { // raw dp process
             // dp_raw_t
-            int data_len = sizeof(dp_raw_recv_t) + strlen(item->valuestring);
+            int data_len = sizeof(dp_raw_recv_t) + strlen(item.str_val);
             dp_raw_recv_t *dpraw = tal_malloc(data_len);
             if (NULL == dpraw) {
                 tal_mutex_unlock(schema->mutex);
@@ -400,7 +585,7 @@ int dp_data_recv_parse(dp_recv_msg_t *msg, dp_recv_cb_t dp_recv_cb)
             dpraw->cmd_tp = msg->cmd;
             dpraw->dp.id = dpnode->desc.id;
             dpraw->dtt_tp = msg->dt_tp;
-            dpraw->dp.len = tuya_base64_decode(item->valuestring, dpraw->dp.data);
+            dpraw->dp.len = tuya_base64_decode(item.str_val, dpraw->dp.data);
 
             if (dp_recv_cb) {
                 tal_mutex_unlock(schema->mutex);
@@ -411,50 +596,46 @@ int dp_data_recv_parse(dp_recv_msg_t *msg, dp_recv_cb_t dp_recv_cb)
             continue;
         }
 
-        dpnode->pv_stat = PV_STAT_LOCAL;
+        dp_node_mark_local(schema, dpnode);
 
         switch (dpnode->desc.prop_tp) {
         case PROP_BOOL: {
-            if (!cJSON_IsBool(item)) {
+            if (DP_RECV_BOOL != item.kind) {
                 continue;
             }
             //! set value;
-            if (cJSON_True == item->type) {
-                dpobj->dps[i].value.dp_bool = TRUE;
-            } else {
-                dpobj->dps[i].value.dp_bool = FALSE;
-            }
+            dpobj->dps[i].value.dp_bool = item.bool_val ? TRUE : FALSE;
             break;
         }
 
         case PROP_VALUE: {
-            if (cJSON_Number != item->type) {
+            if (DP_RECV_NUMBER != item.kind) {
                 continue;
             }
-            dpobj->dps[i].value.dp_value = item->valueint;
+            dpobj->dps[i].value.dp_value = item.int_val;
             break;
         }
 
         case PROP_STR: {
-            if (item->type != cJSON_String) {
+            if (DP_RECV_STRING != item.kind) {
                 continue;
             }
-            dpobj->dps[i].value.dp_str = item->valuestring;
+            dpobj->dps[i].value.dp_str = item.str_val;
             break;
         }
 
         case PROP_ENUM: {
-            if (item->type != cJSON_String) {
+            if (DP_RECV_STRING != item.kind) {
                 break;
             }
             int j = 0;
             for (j = 0; j < dpnode->prop.prop_enum.cnt; j++) {
-                if (0 == strcmp(dpnode->prop.prop_enum.pp_enum[j], item->valuestring)) {
+                if (0 == strcmp(dpnode->prop.prop_enum.pp_enum[j], item.str_val)) {
                     break;
                 }
             }
             if (j >= dpnode->prop.prop_enum.cnt) {
-                PR_ERR("dp enum value[%s] invalid", item->valuestring);
+                PR_ERR("dp enum value[%s] invalid", item.str_val);
                 continue;
             }
             dpobj->dps[i].value.dp_enum = j;
@@ -462,7 +643,7 @@ int dp_data_recv_parse(dp_recv_msg_t *msg, dp_recv_cb_t dp_recv_cb)
         }
 
         case PROP_BITMAP: {
-            dpobj->dps[i].value.dp_value = item->valueint;
+            dpobj->dps[i].value.dp_value = item.int_val;
             break;
         }
 
@@ -535,7 +716,36 @@ void dp_pv_stat_set(dp_schema_t *schema, uint8_t id, dp_pv_stat_t pv_stat)
     }
 }
 
-static bool dp_rept_update(dp_rept_type_t rept_type, dp_obj_t *dp, dp_node_t *dpnode, int flags)
+/**
+ * @brief Marks the dps of an acknowledged report as synced with the cloud.
+ *
+ * @param dpvalid The dps of the report, see dp_rept_valid_check().
+ */
+void dp_pv_stat_ack(dp_rept_valid_t *dpvalid)
+{
+    if (NULL == dpvalid || NULL == dpvalid->schema) {
+        return;
+    }
+
+    dp_schema_t *schema = dpvalid->schema;
+
+    tal_mutex_lock(schema->mutex);
+    for (int i = 0; i < dpvalid->num; i++) {
+        dp_node_t *dpnode = dp_node_find(schema, dpvalid->dpid[i]);
+        if (NULL == dpnode) {
+            continue;
+        }
+        if ((int32_t)(dpnode->seq - dpvalid->seq) > 0) {
+            PR_TRACE("dp[%d] changed since report, stays local", dpvalid->dpid[i]);
+            continue;
+        }
+        dpnode->pv_stat = PV_STAT_CLOUD;
+    }
+    tal_mutex_unlock(schema->mutex);
+}
+
+static bool dp_rept_update(dp_schema_t *schema, dp_rept_type_t rept_type, dp_obj_t *dp, dp_node_t *dpnode,
+                           int flags)
 {
     bool is_need_update = FALSE;
 
@@ -654,7 +864,6 @@ static bool dp_rept_update(dp_rept_type_t rept_type, dp_obj_t *dp, dp_node_t *dp
     }
     case T_RAW: {
         is_need_update = TRUE;
-        dpnode->pv_stat = PV_STAT_LOCAL;
         break;
     }
     case T_FILE:
@@ -665,7 +874,7 @@ static bool dp_rept_update(dp_rept_type_t rept_type, dp_obj_t *dp, dp_node_t *dp
     } /* end of switch */
 
     if (is_need_update) {
-        dpnode->pv_stat = PV_STAT_LOCAL;
+        dp_node_mark_local(schema, dpnode);
         // Record timestamp for statistical type DP
         if (rept_type == T_STAT_REPT) {
             dpnode->time_stamp = dp->time_stamp;
@@ -800,7 +1009,7 @@ int dp_rept_valid_check(dp_schema_t *schema, dp_rept_in_t *dpin, dp_rept_valid_t
                 PR_DEBUG("dp passive:true");
                 continue;
             }
-            if (dp_rept_update(dpin->rept_type, dp, dpnode, dpin->flags)) {
+            if (dp_rept_update(schema, dpin->rept_type, dp, dpnode, dpin->flags)) {
                 PR_DEBUG("dp np update");
                 continue;
             }
@@ -838,6 +1047,7 @@ int dp_rept_valid_check(dp_schema_t *schema, dp_rept_in_t *dpin, dp_rept_valid_t
         }
         dpvalid->dpid[dpvalid->num++] = dp->id;
     }
+    dpvalid->seq = schema->seq;
     tal_mutex_unlock(schema->mutex);
 
     if (0 == dpvalid->num) {
@@ -929,69 +1139,51 @@ int dp_rept_json_output(dp_schema_t *schema, dp_rept_in_t *dpin, dp_rept_valid_t
             goto __err_exit;
         }
 
+        bool fit = dp_json_put(dpstr, dpvalid->len, &offset, dpnode->json_key, dpnode->json_key_len);
         switch (dp->type) {
         case PROP_BOOL: {
             if (TRUE == dp->value.dp_bool) {
-                if (!dp_snprintf_append(dpstr, dpvalid->len, &offset, "\"%d\":true,", dp->id)) {
-                    op_ret = OPRT_BUFFER_NOT_ENOUGH;
-                    goto __err_exit;
-                }
+                fit = fit && dp_json_put(dpstr, dpvalid->len, &offset, "true,", 5);
             } else {
-                if (!dp_snprintf_append(dpstr, dpvalid->len, &offset, "\"%d\":false,", dp->id)) {
-                    op_ret = OPRT_BUFFER_NOT_ENOUGH;
-                    goto __err_exit;
-                }
+                fit = fit && dp_json_put(dpstr, dpvalid->len, &offset, "false,", 6);
             }
             break;
         }
 
         case PROP_VALUE: {
-            if (!dp_snprintf_append(dpstr, dpvalid->len, &offset, "\"%d\":%d,", dp->id, dp->value.dp_value)) {
-                op_ret = OPRT_BUFFER_NOT_ENOUGH;
-                goto __err_exit;
-            }
+            fit = fit && dp_json_put_int(dpstr, dpvalid->len, &offset, dp->value.dp_value) &&
+                  dp_json_put(dpstr, dpvalid->len, &offset, ",", 1);
             break;
         }
 
         case PROP_BITMAP: {
-            if (!dp_snprintf_append(dpstr, dpvalid->len, &offset, "\"%d\":%" PRIu32 ",", dp->id,
-                                    dp->value.dp_bitmap)) {
-                op_ret = OPRT_BUFFER_NOT_ENOUGH;
-                goto __err_exit;
-            }
+            fit = fit && dp_json_put_uint(dpstr, dpvalid->len, &offset, dp->value.dp_bitmap) &&
+                  dp_json_put(dpstr, dpvalid->len, &offset, ",", 1);
             break;
         }
 
         case PROP_STR: {
-            cJSON *temp_str = cJSON_CreateString(dp->value.dp_str);
-            char *tmp_data = cJSON_PrintUnformatted(temp_str);
-            if (tmp_data) {
-                if (!dp_snprintf_append(dpstr, dpvalid->len, &offset, "\"%d\":%s,", dp->id, tmp_data)) {
-                    tal_free(tmp_data);
-                    cJSON_Delete(temp_str);
-                    op_ret = OPRT_BUFFER_NOT_ENOUGH;
-                    goto __err_exit;
-                }
-            }
-            tal_free(tmp_data);
-            cJSON_Delete(temp_str);
+            fit = fit && dp_json_put_str(dpstr, dpvalid->len, &offset, dp->value.dp_str) &&
+                  dp_json_put(dpstr, dpvalid->len, &offset, ",", 1);
             break;
         }
 
         case PROP_ENUM: {
-            if (!dp_snprintf_append(dpstr, dpvalid->len, &offset, "\"%d\":\"%s\",", dp->id,
-                                    dpnode->prop.prop_enum.pp_enum[dp->value.dp_enum])) {
-                op_ret = OPRT_BUFFER_NOT_ENOUGH;
-                goto __err_exit;
-            }
+            fit = fit && dp_json_put(dpstr, dpvalid->len, &offset, "\"", 1) &&
+                  dp_json_put_cstr(dpstr, dpvalid->len, &offset, dpnode->prop.prop_enum.pp_enum[dp->value.dp_enum]) &&
+                  dp_json_put(dpstr, dpvalid->len, &offset, "\",", 2);
         } break;
         }
 
-        if (is_need_time && dp->time_stamp) {
-            if (!dp_snprintf_append(dptimestr, dpvalid->timelen, &time_offset, "\"%d\":%u,", dp->id, dp->time_stamp)) {
-                op_ret = OPRT_BUFFER_NOT_ENOUGH;
-                goto __err_exit;
-            }
+        if (fit && is_need_time && dp->time_stamp) {
+            fit = dp_json_put(dptimestr, dpvalid->timelen, &time_offset, dpnode->json_key, dpnode->json_key_len) &&
+                  dp_json_put_uint(dptimestr, dpvalid->timelen, &time_offset, (uint32_t)dp->time_stamp) &&
+                  dp_json_put(dptimestr, dpvalid->timelen, &time_offset, ",", 1);
+        }
+
+        if (!fit) {
+            op_ret = OPRT_BUFFER_NOT_ENOUGH;
+            goto __err_exit;
         }
     }
 
@@ -1142,6 +1334,12 @@ int dp_obj_dump_stat_local_json(char *devid, dp_rept_valid_t **outdpvalid, char
     size_t length = 0;
     dp_schema_t *schema = dp_schema_find(devid);
     uint8_t dp_stat_local_num = 0;
+    uint32_t seq = 0;
+
+    if (NULL == schema) {
+        PR_ERR("schema err");
+        return OPRT_INVALID_PARM;
+    }
 
     for (i = 0; i < schema->num; i++) {
         dp_node_t *dpnode = &(schema->node[i]);
@@ -1173,13 +1371,11 @@ int dp_obj_dump_stat_local_json(char *devid, dp_rept_valid_t **outdpvalid, char
     memset(dpvaild, 0, sizeof(dp_rept_valid_t) + sizeof(uint8_t) * dp_stat_local_num);
     dpvaild->schema = schema;
 
+    // Only the dps not acknowledged by the cloud, with the seq their values are from
+    tal_mutex_lock(schema->mutex);
     for (i = 0; i < schema->num; i++) {
         dp_node_t *dpnode = &(schema->node[i]);
-        if (dpnode == NULL) {
-            PR_DEBUG("dpnode NULL");
-            break;
-        }
-        if (T_OBJ == dpnode->desc.type && PV_STAT_CLOUD == dpnode->pv_stat) {
+        if (T_OBJ != dpnode->desc.type || PV_STAT_CLOUD == dpnode->pv_stat) {
             continue;
         }
         if (dpvaild->num < dp_stat_local_num) {
@@ -1187,10 +1383,14 @@ int dp_obj_dump_stat_local_json(char *devid, dp_rept_valid_t **outdpvalid, char
             length += dp_obj_json_create(cjson, dpnode);
         }
     }
+    seq = schema->seq;
+    tal_mutex_unlock(schema->mutex);
+    dpvaild->seq = seq;
 
     if (length == 0) {
         PR_DEBUG("Nothing To Pack");
         cJSON_Delete(cjson);
+        tal_free(dpvaild);
         return OPRT_SVC_DP_ID_NOT_FOUND;
     }
     char *jsonstr = cJSON_PrintUnformatted(cjson);
@@ -1578,6 +1778,33 @@ __exit:
     return op_ret;
 }
 
+/* Index the parsed nodes and add the schema to the manager */
+static void dp_schema_register(dp_schema_t *dp_schema, const char *devid)
+{
+    dp_schema->actv.attach_dp_if = TRUE;
+    strncpy(dp_schema->devid, devid, DEV_ID_LEN);
+    dp_schema->devid_hash = dp_schema_devid_hash(dp_schema->devid);
+
+    /* first node wins for a duplicated id, as the old linear search did */
+    memset(dp_schema->id_index, DP_NODE_INDEX_NONE, sizeof(dp_schema->id_index));
+    for (int i = 0; i < dp_schema->num; i++) {
+        dp_node_t *dpnode = &dp_schema->node[i];
+        dpnode->json_key_len = (uint8_t)snprintf(dpnode->json_key, sizeof(dpnode->json_key), "\"%u\":", dpnode->desc.id);
+        if (DP_NODE_INDEX_NONE == dp_schema->id_index[dp_schema->node[i].desc.id]) {
+            dp_schema->id_index[dp_schema->node[i].desc.id] = i;
+        }
+    }
+
+    if (s_dsmgr.schema_num < DP_SCHEMA_NUM_MAX) {
+        int slot = dp_schema->devid_hash % DP_SCHEMA_NUM_MAX;
+        while (s_dsmgr.schema_list[slot]) {
+            slot = (slot + 1) % DP_SCHEMA_NUM_MAX;
+        }
+        s_dsmgr.schema_list[slot] = dp_schema;
+        s_dsmgr.schema_num++;
+    }
+}
+
 /**
  * @brief Creates a new data point schema for a device.
  *
@@ -1635,15 +1862,10 @@ int dp_schema_create(char *devid, char *schema_json, dp_schema_t **dp_schema_out
         goto __exit;
     }
     dp_schema->actv.preprocess = other_attr.preprocess;
-    dp_schema->actv.attach_dp_if = TRUE;
-    strncpy(dp_schema->devid, devid, DEV_ID_LEN);
+    dp_schema_register(dp_schema, devid);
     if (dp_schema_out) {
         *dp_schema_out = dp_schema;
     }
-    if (s_dsmgr.schema_num < DP_SCHEMA_NUM_MAX) {
-        s_dsmgr.schema_list[s_dsmgr.schema_num] = dp_schema;
-        s_dsmgr.schema_num++;
-    }
     PR_DEBUG("create dp_schema Success ");
     tal_free(nodepos);
 
@@ -1656,6 +1878,284 @@ __exit:
     return op_ret;
 }
 
+/*
+ * Compiled schema layout, native byte order since it never leaves the device:
+ *   magic[2] version:1 num:1 preprocess:1 schema_id_len:1 schema_id
+ *   num x (dp_desc_t fields:8 [property])
+ * The property follows T_OBJ nodes only:
+ *   PROP_VALUE  max:4 min:4 scale:2
+ *   PROP_STR    max_len:4
+ *   PROP_ENUM   cnt:1 cnt x (len:1 text)
+ *   PROP_BITMAP max_len:4
+ */
+#define DP_SCHEMA_BIN_MAGIC0  'D'
+#define DP_SCHEMA_BIN_MAGIC1  'S'
+#define DP_SCHEMA_BIN_VERSION 1
+
+typedef struct {
+    uint8_t *buf;
+    size_t len;
+    size_t pos;
+} dp_schema_bin_t;
+
+/* writes are counted past the end so a NULL buffer sizes the output */
+static void bin_put(dp_schema_bin_t *bin, const void *data, size_t len)
+{
+    if (bin->buf && bin->pos + len <= bin->len) {
+        memcpy(bin->buf + bin->pos, data, len);
+    }
+    bin->pos += len;
+}
+
+static bool bin_get(dp_schema_bin_t *bin, void *data, size_t len)
+{
+    if (bin->pos + len > bin->len) {
+        return FALSE;
+    }
+    memcpy(data, bin->buf + bin->pos, len);
+    bin->pos += len;
+    return TRUE;
+}
+
+static void dp_schema_bin_write(dp_schema_bin_t *bin, dp_schema_t *schema, const char *schema_id)
+{
+    uint8_t head[6] = {DP_SCHEMA_BIN_MAGIC0, DP_SCHEMA_BIN_MAGIC1, DP_SCHEMA_BIN_VERSION, schema->num,
+                       schema->actv.preprocess, strlen(schema_id)};
+
+    bin_put(bin, head, sizeof(head));
+    bin_put(bin, schema_id, head[5]);
+    for (int i = 0; i < schema->num; i++) {
+        dp_node_t *node = &schema->node[i];
+        uint8_t desc[8] = {node->desc.id,      node->desc.mode, node->desc.passive, node->desc.type,
+                           node->desc.prop_tp, node->desc.trig, node->desc.stat,    node->desc.route_t};
+        bin_put(bin, desc, sizeof(desc));
+        if (T_OBJ != node->desc.type) {
+            continue;
+        }
+        switch (node->desc.prop_tp) {
+        case PROP_VALUE:
+            bin_put(bin, &node->prop.prop_int.max, sizeof(int32_t));
+            bin_put(bin, &node->prop.prop_int.min, sizeof(int32_t));
+            bin_put(bin, &node->prop.prop_int.scale, sizeof(uint16_t));
+            break;
+        case PROP_STR:
+            bin_put(bin, &node->prop.prop_str.max_len, sizeof(int32_t));
+            break;
+        case PROP_ENUM: {
+            uint8_t cnt = node->prop.prop_enum.cnt;
+            bin_put(bin, &cnt, 1);
+            for (int j = 0; j < cnt; j++) {
+                uint8_t len = strlen(node->prop.prop_enum.pp_enum[j]);
+                bin_put(bin, &len, 1);
+                bin_put(bin, node->prop.prop_enum.pp_enum[j], len);
+            }
+            break;
+        }
+        case PROP_BITMAP:
+            bin_put(bin, &node->prop.prop_bitmap.max_len, sizeof(uint32_t));
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Compiles a data point schema into its binary cache form.
+ *
+ * @param schema The parsed schema.
+ * @param schema_id The schema id, stored so a stale cache is detected.
+ * @param out The compiled data, free it with tal_free().
+ * @param out_len The compiled length.
+ *
+ * @return 0 on success, or an error code if an error occurred.
+ */
+int dp_schema_compile(dp_schema_t *schema, const char *schema_id, uint8_t **out, size_t *out_len)
+{
+    if (NULL == schema || NULL == schema_id || NULL == out || NULL == out_len || strlen(schema_id) > 0xFF) {
+        return OPRT_INVALID_PARM;
+    }
+
+    /* enum texts longer than a length byte cannot be compiled */
+    for (int i = 0; i < schema->num; i++) {
+        dp_node_t *node = &schema->node[i];
+        if (T_OBJ != node->desc.type || PROP_ENUM != node->desc.prop_tp) {
+            continue;
+        }
+        if (node->prop.prop_enum.cnt > 0xFF) {
+            return OPRT_NOT_SUPPORTED;
+        }
+        for (int j = 0; j < node->prop.prop_enum.cnt; j++) {
+            if (strlen(node->prop.prop_enum.pp_enum[j]) > 0xFF) {
+                return OPRT_NOT_SUPPORTED;
+            }
+        }
+    }
+
+    dp_schema_bin_t bin = {0};
+    dp_schema_bin_write(&bin, schema, schema_id);
+    bin.buf = tal_malloc(bin.pos);
+    if (NULL == bin.buf) {
+        return OPRT_MALLOC_FAILED;
+    }
+    bin.len = bin.pos;
+    bin.pos = 0;
+    dp_schema_bin_write(&bin, schema, schema_id);
+
+    *out = bin.buf;
+    *out_len = bin.len;
+    return OPRT_OK;
+}
+
+static OPERATE_RET dp_node_bin_read(dp_schema_bin_t *bin, dp_node_t *node)
+{
+    uint8_t desc[8];
+
+    if (!bin_get(bin, desc, sizeof(desc))) {
+        return OPRT_INVALID_PARM;
+    }
+    node->desc.id = desc[0];
+    node->desc.mode = desc[1];
+    node->desc.passive = desc[2];
+    node->desc.type = desc[3];
+    node->desc.prop_tp = desc[4];
+    node->desc.trig = desc[5];
+    node->desc.stat = desc[6];
+    node->desc.route_t = desc[7];
+    if (T_OBJ != node->desc.type) {
+        return OPRT_OK;
+    }
+
+    dp_prop_vaule_t *prop = &node->prop;
+    switch (node->desc.prop_tp) {
+    case PROP_BOOL:
+        return OPRT_OK;
+    case PROP_VALUE:
+        if (!bin_get(bin, &prop->prop_int.max, sizeof(int32_t)) || !bin_get(bin, &prop->prop_int.min, sizeof(int32_t)) ||
+            !bin_get(bin, &prop->prop_int.scale, sizeof(uint16_t))) {
+            return OPRT_INVALID_PARM;
+        }
+        return OPRT_OK;
+    case PROP_STR:
+        if (!bin_get(bin, &prop->prop_str.max_len, sizeof(int32_t))) {
+            return OPRT_INVALID_PARM;
+        }
+        return tal_mutex_create_init(&prop->prop_str.dp_str_mutex);
+    case PROP_ENUM: {
+        uint8_t cnt = 0;
+        if (!bin_get(bin, &cnt, 1) || 0 == cnt) {
+            return OPRT_INVALID_PARM;
+        }
+        prop->prop_enum.pp_enum = tal_calloc(cnt, sizeof(char *));
+        if (NULL == prop->prop_enum.pp_enum) {
+            return OPRT_MALLOC_FAILED;
+        }
+        prop->prop_enum.cnt = cnt;
+        for (int i = 0; i < cnt; i++) {
+            uint8_t len = 0;
+            if (!bin_get(bin, &len, 1) || bin->pos + len > bin->len) {
+                return OPRT_INVALID_PARM;
+            }
+            prop->prop_enum.pp_enum[i] = tal_malloc(len + 1);
+            if (NULL == prop->prop_enum.pp_enum[i]) {
+                return OPRT_MALLOC_FAILED;
+            }
+            bin_get(bin, prop->prop_enum.pp_enum[i], len);
+            prop->prop_enum.pp_enum[i][len] = '\0';
+        }
+        return OPRT_OK;
+    }
+    case PROP_BITMAP:
+        if (!bin_get(bin, &prop->prop_bitmap.max_len, sizeof(uint32_t))) {
+            return OPRT_INVALID_PARM;
+        }
+        return OPRT_OK;
+    default:
+        return OPRT_INVALID_PARM;
+    }
+}
+
+static void dp_node_props_free(dp_node_t *node, int num)
+{
+    for (int i = 0; i < num; i++) {
+        if (T_OBJ != node[i].desc.type) {
+            continue;
+        }
+        if (PROP_STR == node[i].desc.prop_tp && node[i].prop.prop_str.dp_str_mutex) {
+            tal_mutex_release(node[i].prop.prop_str.dp_str_mutex);
+        } else if (PROP_ENUM == node[i].desc.prop_tp && node[i].prop.prop_enum.pp_enum) {
+            for (int j = 0; j < node[i].prop.prop_enum.cnt; j++) {
+                tal_free(node[i].prop.prop_enum.pp_enum[j]);
+            }
+            tal_free(node[i].prop.prop_enum.pp_enum);
+        }
+    }
+}
+
+/**
+ * @brief Creates a data point schema from its binary cache form.
+ *
+ * @param devid The device ID for which the schema is being created.
+ * @param schema_id The expected schema id, a cache of another id is rejected.
+ * @param data The data produced by dp_schema_compile().
+ * @param len The data length.
+ * @param dp_schema_out A pointer to a variable that will hold the created data
+ * point schema.
+ *
+ * @return 0 on success, or an error code if the cache is stale or corrupt.
+ */
+int dp_schema_create_from_bin(char *devid, const char *schema_id, const uint8_t *data, size_t len,
+                              dp_schema_t **dp_schema_out)
+{
+    OPERATE_RET op_ret = OPRT_OK;
+    dp_schema_bin_t bin = {.buf = (uint8_t *)data, .len = len, .pos = 0};
+    uint8_t head[6];
+
+    if (NULL == devid || NULL == schema_id || NULL == data || !bin_get(&bin, head, sizeof(head))) {
+        return OPRT_INVALID_PARM;
+    }
+    if (head[0] != DP_SCHEMA_BIN_MAGIC0 || head[1] != DP_SCHEMA_BIN_MAGIC1 || head[2] != DP_SCHEMA_BIN_VERSION ||
+        0 == head[3] || head[5] != strlen(schema_id) || bin.pos + head[5] > len ||
+        memcmp(data + bin.pos, schema_id, head[5])) {
+        PR_DEBUG("schema cache stale");
+        return OPRT_NOT_FOUND;
+    }
+    bin.pos += head[5];
+
+    uint8_t nodenum = head[3];
+    dp_schema_t *dp_schema = (dp_schema_t *)tal_calloc(1, sizeof(dp_schema_t) + nodenum * sizeof(dp_node_t));
+    if (NULL == dp_schema) {
+        PR_ERR("malloc fail:%d", nodenum);
+        return OPRT_MALLOC_FAILED;
+    }
+    op_ret = tal_mutex_create_init(&(dp_schema->mutex));
+    if (OPRT_OK != op_ret) {
+        PR_ERR("mutex create fail:%d", op_ret);
+        tal_free(dp_schema);
+        return op_ret;
+    }
+
+    for (int i = 0; i < nodenum; i++) {
+        op_ret = dp_node_bin_read(&bin, &dp_schema->node[i]);
+        if (OPRT_OK != op_ret) {
+            PR_ERR("schema cache node %d invalid:%d", i, op_ret);
+            dp_node_props_free(dp_schema->node, i + 1);
+            tal_mutex_release(dp_schema->mutex);
+            tal_free(dp_schema);
+            return op_ret;
+        }
+    }
+    dp_schema->num = nodenum;
+    dp_schema->actv.preprocess = head[4];
+    dp_schema_register(dp_schema, devid);
+    if (dp_schema_out) {
+        *dp_schema_out = dp_schema;
+    }
+    PR_DEBUG("create dp_schema from cache Success");
+
+    return OPRT_OK;
+}
+
 /**
  * @brief Deletes the data point schema for a device.
  *
@@ -1668,22 +2168,29 @@ __exit:
  */
 int dp_schema_delete(char *devid)
 {
-    int i = 0;
-
     PR_TRACE("try to delete schema devid %s", devid);
     dp_schema_mgr_t *dsmgr = &s_dsmgr;
-    for (i = 0; i < DP_SCHEMA_NUM_MAX; i++) {
-        if (NULL == dsmgr->schema_list[i]) {
-            continue;
-        }
+    int slot = dp_schema_slot_find(devid, dp_schema_devid_hash(devid));
+    if (slot < 0) {
+        return OPRT_OK;
+    }
+
+    tal_mutex_release(dsmgr->schema_list[slot]->mutex);
+    tal_free(dsmgr->schema_list[slot]);
+    dsmgr->schema_list[slot] = NULL;
+    dsmgr->schema_num--;
 
-        if (0 == strcmp(devid, dsmgr->schema_list[i]->devid)) {
-            tal_mutex_release(dsmgr->schema_list[i]->mutex);
-            tal_free(dsmgr->schema_list[i]);
-            dsmgr->schema_list[i] = NULL;
-            dsmgr->schema_num--;
-            return OPRT_OK;
+    /* re-place the rest of the probe run so later lookups still reach it */
+    int next = (slot + 1) % DP_SCHEMA_NUM_MAX;
+    while (dsmgr->schema_list[next]) {
+        dp_schema_t *schema = dsmgr->schema_list[next];
+        dsmgr->schema_list[next] = NULL;
+        int home = schema->devid_hash % DP_SCHEMA_NUM_MAX;
+        while (dsmgr->schema_list[home]) {
+            home = (home + 1) % DP_SCHEMA_NUM_MAX;
         }
+        dsmgr->schema_list[home] = schema;
+        next = (next + 1) % DP_SCHEMA_NUM_MAX;
     }
 
     return OPRT_OK;
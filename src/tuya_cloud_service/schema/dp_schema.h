@@ -24,6 +24,7 @@ extern "C" {
 #include "tuya_cloud_types.h"
 #include "cJSON.h"
 #include "tal_mutex.h"
+#include "json_scan.h"
 
 #define DEV_ID_LEN 25
 
@@ -305,6 +306,11 @@ typedef struct {
     // DP_REPT_FLOW_CTRL rept_flow_ctrl;
     /** time stamp for dp sync */
     TIME_T time_stamp;
+    /** schema seq of the last local change, see dp_pv_stat_ack() */
+    uint32_t seq;
+    /** "<id>": key of the dp in report JSON, set at schema creation */
+    char json_key[7];
+    uint8_t json_key_len;
     /** sn for ble dp sync report */
     // uint32_t ble_send_sn;
 } dp_node_t; // dp_obj_t
@@ -329,12 +335,20 @@ typedef struct {
     dp_prop_actv_t actv;
     /** exclusive access to dp */
     MUTEX_HANDLE mutex;
+    /** hash of devid, see dp_schema_find() */
+    uint32_t devid_hash;
+    /** bumped by every local dp change */
+    uint32_t seq;
     /** count of dp */
     uint8_t num;
+    /** node index by dp id, DP_NODE_INDEX_NONE if the id is not in the schema */
+    uint8_t id_index[256];
     /** dp info */
     dp_node_t node[0];
 } dp_schema_t;
 
+#define DP_NODE_INDEX_NONE 0xFF
+
 /**
  * @brief Definition of schema other attribute
  */
@@ -348,6 +362,7 @@ typedef struct {
 #define DP_REPT_NO_FILTER_FLAG  (1 << 0)
 #define DP_DUMP_STAT_LOCAL_FLAG (1 << 1)
 #define DP_APPEND_HEADER_FLAG   (1 << 2)
+#define DP_REPT_COALESCE_FLAG   (1 << 3) /* merge into the next coalesced report, see tuya_iot_dp_obj_report() */
 
 typedef struct {
     char *devid;
@@ -355,6 +370,10 @@ typedef struct {
     dp_trans_type_t dt_tp;
     cJSON *data_js;
     void *user_data;
+    /** used instead of data_js when not NULL, token 0 is the data object */
+    char *json;
+    json_tok_t *toks;
+    int tok_num;
 } dp_recv_msg_t;
 
 typedef struct {
@@ -375,6 +394,8 @@ typedef struct {
     uint16_t len;
     uint16_t timelen;
     dp_schema_t *schema;
+    /** schema seq the reported values are from */
+    uint32_t seq;
     uint8_t dpid[0];
 } dp_rept_valid_t;
 
@@ -430,6 +451,16 @@ dp_schema_t *dp_schema_find(const char *devid);
 
 void dp_pv_stat_set(dp_schema_t *schema, uint8_t id, dp_pv_stat_t pv_stat);
 
+/**
+ * @brief Marks the dps of an acknowledged report as synced with the cloud.
+ *
+ * A dp that changed again after the report was built keeps its local status,
+ * so the next sync sends the newer value instead of losing it.
+ *
+ * @param dpvalid The dps of the report, see dp_rept_valid_check().
+ */
+void dp_pv_stat_ack(dp_rept_valid_t *dpvalid);
+
 /**
  * Retrieves the current status of a data point (DP) based on its ID.
  *
@@ -512,6 +543,37 @@ int dp_rept_json_append(dp_schema_t *schema, char *data, char *time, char *type,
  * @return Returns 0 on success, or a negative error code on failure.
  */
 int dp_schema_create(char *devid, char *schema_json, dp_schema_t **dp_schema_out);
+
+/**
+ * @brief Compiles a data point schema into a compact binary form.
+ *
+ * The result is meant to be cached in KV and loaded with
+ * dp_schema_create_from_bin() on the next boot, skipping the JSON parse.
+ *
+ * @param schema The parsed schema.
+ * @param schema_id The schema id the cache belongs to.
+ * @param out The compiled data, free it with tal_free().
+ * @param out_len The compiled length.
+ *
+ * @return Returns 0 on success, or a negative error code on failure.
+ */
+int dp_schema_compile(dp_schema_t *schema, const char *schema_id, uint8_t **out, size_t *out_len);
+
+/**
+ * @brief Creates a data point schema from dp_schema_compile() output.
+ *
+ * @param devid The device ID for which the schema is being created.
+ * @param schema_id The expected schema id.
+ * @param data The compiled schema.
+ * @param len The compiled length.
+ * @param dp_schema_out A pointer to a variable that will hold the created data
+ * point schema.
+ *
+ * @return Returns 0 on success, OPRT_NOT_FOUND if the data was compiled by
+ * another format version or for another schema id, or a negative error code.
+ */
+int dp_schema_create_from_bin(char *devid, const char *schema_id, const uint8_t *data, size_t len,
+                              dp_schema_t **dp_schema_out);
 /**
  * @brief Deletes the data point schema for a specific device.
  *
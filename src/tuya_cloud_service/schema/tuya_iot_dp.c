@@ -30,18 +30,33 @@
 #include "ble_dp.h"
 #endif
 
+#ifndef TUYA_DP_COALESCE_WINDOW_MS
+#define TUYA_DP_COALESCE_WINDOW_MS 100
+#endif
+
+/* devices with coalesced reports pending at the same time */
+#define DP_COALESCE_DEV_NUM 4
+
+typedef struct {
+    char devid[DEV_ID_LEN + 1];
+    int flags;
+    uint16_t dpscnt;
+    dp_obj_t dps[MAX_DP_NUM];
+} dp_coalesce_t;
+
 static DELAYED_WORK_HANDLE s_tmm_dp_sync = NULL;
 
-int tuya_iot_dp_sync_start(tuya_iot_client_t *client, uint32_t timeout_s);
+static DELAYED_WORK_HANDLE s_tmm_dp_coalesce = NULL;
+static MUTEX_HANDLE s_dp_coalesce_mutex = NULL;
+static dp_coalesce_t *s_dp_coalesce[DP_COALESCE_DEV_NUM];
+static uint32_t s_dp_coalesce_window_ms = TUYA_DP_COALESCE_WINDOW_MS;
 
 static void dp_sync_cb(int result, void *user_data)
 {
     dp_rept_valid_t *dpvalid = (dp_rept_valid_t *)user_data;
 
     if (OPRT_OK == result) {
-        for (int i = 0; i < dpvalid->num; i++) {
-            dp_pv_stat_set(dpvalid->schema, dpvalid->dpid[i], PV_STAT_CLOUD);
-        }
+        dp_pv_stat_ack(dpvalid);
     } else {
         //! start mqtt cloud sync
         tuya_iot_dp_sync_start(tuya_iot_client_get(), 5);
@@ -77,7 +92,12 @@ void tuya_iot_dp_sync_process(void *data)
         tal_workq_start_delayed(s_tmm_dp_sync, 5000, LOOP_ONCE);
         return;
     }
+    if (NULL == dpsjson) {
+        PR_DEBUG("dp sync: cloud is up to date");
+        return;
+    }
 
+    PR_DEBUG("dp sync %d dps changed since the last ack", dpvalid->num);
     tuya_iot_dp_report_json_async(client, dpsjson, NULL, dp_sync_cb, dpvalid, 5000);
     tal_free(dpsjson);
 }
@@ -194,10 +214,242 @@ int tuya_iot_dp_parse(tuya_iot_client_t *client, dp_cmd_type_t cmd_tp, cJSON *cm
     msg->dt_tp = DTT_SCT_UNC;
     msg->data_js = cmd_js;
     msg->user_data = client;
+    msg->json = NULL;
+    msg->toks = NULL;
+    msg->tok_num = 0;
 
     return tal_workq_schedule(WORKQ_HIGHTPRI, tuya_iot_dp_parse_on_worq, msg);
 }
 
+/**
+ * @brief Parses a device data point command from json_scan() tokens.
+ *
+ * Only the "data" object is kept: its text and tokens are copied behind the
+ * message in one allocation, so a DP command costs a single heap block
+ * instead of a cJSON tree.
+ *
+ * @param client The Tuya IoT client instance.
+ * @param cmd_tp The type of the data point command.
+ * @param json The scanned JSON text.
+ * @param toks The tokens of json.
+ * @param tok_num The number of tokens.
+ * @param data_tok The index of the "data" object token.
+ *
+ * @return The status of the parsing operation.
+ *     - 0: Success
+ *     - Other values: Error codes
+ */
+int tuya_iot_dp_parse_scan(tuya_iot_client_t *client, dp_cmd_type_t cmd_tp, const char *json, const json_tok_t *toks,
+                           int tok_num, int data_tok)
+{
+    if (NULL == json || NULL == toks || data_tok < 0 || data_tok >= tok_num ||
+        toks[data_tok].type != JSON_TOK_OBJECT) {
+        PR_ERR("data null");
+        return OPRT_CJSON_GET_ERR;
+    }
+
+    int num = json_scan_skip(toks, tok_num, data_tok) - data_tok;
+    uint16_t base = toks[data_tok].start;
+    size_t json_len = toks[data_tok].end - base;
+
+    dp_recv_msg_t *msg = tal_malloc(sizeof(dp_recv_msg_t) + num * sizeof(json_tok_t) + json_len + 1);
+    if (NULL == msg) {
+        return OPRT_MALLOC_FAILED;
+    }
+    msg->toks = (json_tok_t *)(msg + 1);
+    msg->json = (char *)(msg->toks + num);
+    msg->tok_num = num;
+    memcpy(msg->json, json + base, json_len);
+    msg->json[json_len] = '\0';
+    for (int i = 0; i < num; i++) {
+        msg->toks[i] = toks[data_tok + i];
+        msg->toks[i].start -= base;
+        msg->toks[i].end -= base;
+    }
+
+    if (json_scan_find(msg->json, msg->toks, num, 0, "dps") < 0) {
+        PR_ERR("not found dps");
+        tal_free(msg);
+        return OPRT_CJSON_GET_ERR;
+    }
+
+    int devid_tok = json_scan_find(msg->json, msg->toks, num, 0, "devId");
+    if (devid_tok < 0 || msg->toks[devid_tok].type != JSON_TOK_STRING) {
+        PR_WARN("devid is null");
+        msg->devid = client->activate.devid;
+    } else {
+        msg->devid = json_scan_str(msg->json, &msg->toks[devid_tok]);
+    }
+    msg->cmd = cmd_tp;
+    msg->dt_tp = DTT_SCT_UNC;
+    msg->data_js = NULL;
+    msg->user_data = client;
+
+    int rt = tal_workq_schedule(WORKQ_HIGHTPRI, tuya_iot_dp_parse_on_worq, msg);
+    if (OPRT_OK != rt) {
+        tal_free(msg);
+    }
+    return rt;
+}
+
+static void dp_coalesce_obj_free(dp_obj_t *dp)
+{
+    if (PROP_STR == dp->type && dp->value.dp_str) {
+        tal_free(dp->value.dp_str);
+        dp->value.dp_str = NULL;
+    }
+}
+
+static void dp_coalesce_work(void *data)
+{
+    tuya_iot_dp_coalesce_flush((tuya_iot_client_t *)data);
+}
+
+/**
+ * @brief Sets the window of coalesced DP reports.
+ *
+ * @param window_ms Time from the first queued change to the report, 0 makes
+ * DP_REPT_COALESCE_FLAG reports go out at once.
+ */
+void tuya_iot_dp_coalesce_window_set(uint32_t window_ms)
+{
+    s_dp_coalesce_window_ms = window_ms;
+}
+
+/**
+ * @brief Sends all coalesced DP reports now.
+ *
+ * Pending devices are taken out under the lock and reported without it, so
+ * new changes arriving meanwhile start the next window.
+ *
+ * @param client The Tuya IoT client instance.
+ */
+void tuya_iot_dp_coalesce_flush(tuya_iot_client_t *client)
+{
+    if (NULL == s_dp_coalesce_mutex) {
+        return;
+    }
+
+    for (int i = 0; i < DP_COALESCE_DEV_NUM; i++) {
+        tal_mutex_lock(s_dp_coalesce_mutex);
+        dp_coalesce_t *pending = s_dp_coalesce[i];
+        s_dp_coalesce[i] = NULL;
+        tal_mutex_unlock(s_dp_coalesce_mutex);
+        if (NULL == pending) {
+            continue;
+        }
+
+        int ret = tuya_iot_dp_obj_report(client, pending->devid, pending->dps, pending->dpscnt, pending->flags);
+        if (OPRT_OK != ret) {
+            PR_ERR("coalesced dp report failed %d", ret);
+        }
+        for (int j = 0; j < pending->dpscnt; j++) {
+            dp_coalesce_obj_free(&pending->dps[j]);
+        }
+        tal_free(pending);
+    }
+}
+
+/* Merge dps into the pending report of devid, latest value wins */
+static int dp_coalesce_add(tuya_iot_client_t *client, const char *devid, dp_obj_t *dps, uint16_t dpscnt, int flags)
+{
+    int ret = OPRT_OK;
+
+    if (strlen(devid) > DEV_ID_LEN) {
+        return OPRT_INVALID_PARM;
+    }
+
+    if (NULL == s_dp_coalesce_mutex) {
+        ret = tal_mutex_create_init(&s_dp_coalesce_mutex);
+        if (OPRT_OK != ret) {
+            return ret;
+        }
+    }
+    if (NULL == s_tmm_dp_coalesce) {
+        ret = tal_workq_init_delayed(WORKQ_HIGHTPRI, dp_coalesce_work, client, &s_tmm_dp_coalesce);
+        if (OPRT_OK != ret) {
+            PR_ERR("dp coalesce work init failed %d", ret);
+            return ret;
+        }
+    }
+
+    tal_mutex_lock(s_dp_coalesce_mutex);
+    dp_coalesce_t *pending = NULL;
+    int free_slot = -1;
+    bool started = FALSE;
+    for (int i = 0; i < DP_COALESCE_DEV_NUM; i++) {
+        if (s_dp_coalesce[i] == NULL) {
+            free_slot = (free_slot < 0) ? i : free_slot;
+            continue;
+        }
+        started = TRUE;
+        if (0 == strcmp(s_dp_coalesce[i]->devid, devid)) {
+            pending = s_dp_coalesce[i];
+        }
+    }
+
+    /* the flags apply to the whole report, so different flags cannot merge */
+    if (pending && pending->flags != flags) {
+        tal_mutex_unlock(s_dp_coalesce_mutex);
+        tuya_iot_dp_coalesce_flush(client);
+        return dp_coalesce_add(client, devid, dps, dpscnt, flags);
+    }
+
+    if (NULL == pending) {
+        if (free_slot < 0) {
+            tal_mutex_unlock(s_dp_coalesce_mutex);
+            tuya_iot_dp_coalesce_flush(client);
+            return dp_coalesce_add(client, devid, dps, dpscnt, flags);
+        }
+        pending = tal_calloc(1, sizeof(dp_coalesce_t));
+        if (NULL == pending) {
+            tal_mutex_unlock(s_dp_coalesce_mutex);
+            return OPRT_MALLOC_FAILED;
+        }
+        strcpy(pending->devid, devid);
+        pending->flags = flags;
+        s_dp_coalesce[free_slot] = pending;
+    }
+
+    for (uint16_t i = 0; i < dpscnt; i++) {
+        dp_obj_t *dst = NULL;
+        for (uint16_t j = 0; j < pending->dpscnt; j++) {
+            if (pending->dps[j].id == dps[i].id) {
+                dst = &pending->dps[j];
+                dp_coalesce_obj_free(dst);
+                break;
+            }
+        }
+        if (NULL == dst) {
+            if (pending->dpscnt >= MAX_DP_NUM) {
+                PR_ERR("dp coalesce full, drop dp %d", dps[i].id);
+                ret = OPRT_EXCEED_UPPER_LIMIT;
+                continue;
+            }
+            dst = &pending->dps[pending->dpscnt++];
+        }
+        *dst = dps[i];
+        /* the caller's string is only valid during the call */
+        if (PROP_STR == dps[i].type && dps[i].value.dp_str) {
+            dst->value.dp_str = tal_malloc(strlen(dps[i].value.dp_str) + 1);
+            if (NULL == dst->value.dp_str) {
+                pending->dpscnt--;
+                ret = OPRT_MALLOC_FAILED;
+                continue;
+            }
+            strcpy(dst->value.dp_str, dps[i].value.dp_str);
+        }
+    }
+    tal_mutex_unlock(s_dp_coalesce_mutex);
+
+    /* the window runs from the first change, later changes do not extend it */
+    if (!started) {
+        tal_workq_start_delayed(s_tmm_dp_coalesce, s_dp_coalesce_window_ms, LOOP_ONCE);
+    }
+
+    return ret;
+}
+
 /**
  * @brief Reports device object data to the Tuya IoT cloud service.
  *
@@ -208,7 +460,8 @@ int tuya_iot_dp_parse(tuya_iot_client_t *client, dp_cmd_type_t cmd_tp, cJSON *cm
  * @param devid The device ID.
  * @param dps An array of device object data.
  * @param dpscnt The number of device object data elements in the array.
- * @param flags Additional flags for the report.
+ * @param flags Additional flags for the report. With DP_REPT_COALESCE_FLAG
+ * the DPs are merged into a report sent when the coalescing window expires.
  *
  * @return The result of the operation. Returns 0 on success, or a negative
  * error code on failure.
@@ -225,6 +478,13 @@ int tuya_iot_dp_obj_report(tuya_iot_client_t *client, const char *devid, dp_obj_
         return OPRT_INVALID_PARM;
     }
 
+    if (flags & DP_REPT_COALESCE_FLAG) {
+        flags &= ~DP_REPT_COALESCE_FLAG;
+        if (s_dp_coalesce_window_ms && devid) {
+            return dp_coalesce_add(client, devid, dps, dpscnt, flags);
+        }
+    }
+
     dp_schema_t *schema = dp_schema_find(devid);
     if (NULL == schema) {
         return OPRT_INVALID_PARM;
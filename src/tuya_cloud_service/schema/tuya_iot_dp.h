@@ -33,6 +33,23 @@ extern "C" {
  */
 int tuya_iot_dp_parse(tuya_iot_client_t *client, dp_cmd_type_t tp, cJSON *cmd_js);
 
+/**
+ * @brief Parse a DP command from json_scan() tokens, without a cJSON tree
+ *
+ * The data object text and tokens are copied, so they only need to be valid
+ * during the call.
+ *
+ * @param client
+ * @param tp
+ * @param json the scanned JSON text
+ * @param toks the tokens of json
+ * @param tok_num the number of tokens
+ * @param data_tok the index of the "data" object token
+ * @return int
+ */
+int tuya_iot_dp_parse_scan(tuya_iot_client_t *client, dp_cmd_type_t tp, const char *json, const json_tok_t *toks,
+                           int tok_num, int data_tok);
+
 /**
  * @brief
  *
@@ -44,7 +61,12 @@ int tuya_iot_dp_parse(tuya_iot_client_t *client, dp_cmd_type_t tp, cJSON *cmd_js
 int tuya_iot_dp_schema_create(char *devid, char *schema_json, dp_schema_t **dp_schema_out);
 
 /**
- * @brief
+ * @brief Report object DPs
+ *
+ * With DP_REPT_COALESCE_FLAG the DPs are only queued and the call returns at
+ * once. All DPs queued for a device within the coalescing window are merged
+ * per DP id, latest value wins, and go out as one report when the window
+ * expires.
  *
  * @param client
  * @param devid
@@ -55,6 +77,21 @@ int tuya_iot_dp_schema_create(char *devid, char *schema_json, dp_schema_t **dp_s
  */
 int tuya_iot_dp_obj_report(tuya_iot_client_t *client, const char *devid, dp_obj_t *dps, uint16_t dpscnt, int flags);
 
+/**
+ * @brief Set the window of coalesced DP reports
+ *
+ * @param window_ms time from the first queued change to the report, 0 sends
+ * DP_REPT_COALESCE_FLAG reports at once
+ */
+void tuya_iot_dp_coalesce_window_set(uint32_t window_ms);
+
+/**
+ * @brief Send the coalesced DP reports now
+ *
+ * @param client
+ */
+void tuya_iot_dp_coalesce_flush(tuya_iot_client_t *client);
+
 /**
  * @brief
  *
@@ -76,6 +113,18 @@ int tuya_iot_dp_raw_report(tuya_iot_client_t *client, const char *devid, dp_raw_
  */
 char *tuya_iot_dp_obj_dump(tuya_iot_client_t *client, char *devid, int flags);
 
+/**
+ * @brief Send the DPs changed since the last acknowledged report, after timeout_s
+ *
+ * Called on every MQTT connect, so a reconnect uploads the delta instead of
+ * the full state.
+ *
+ * @param client
+ * @param timeout_s
+ * @return int
+ */
+int tuya_iot_dp_sync_start(tuya_iot_client_t *client, uint32_t timeout_s);
+
 #ifdef __cplusplus
 }
 #endif
@@ -127,16 +127,97 @@ static int __tuya_tls_mutex_unlock(mbedtls_threading_mutex_t *mutex)
 /* -------------------------------------------------------------------------- */
 /*                                   Calloc                                   */
 /* -------------------------------------------------------------------------- */
-static __attribute__((unused)) void *__tuya_tls_calloc(size_t nmemb, size_t size)
+/* Every mbedtls block carries its size and RAM, so free knows the heap it came
+ * from and the live bytes can be reported. Contexts, MPIs and key material
+ * are small and stay in SRAM; record buffers and certificate data are the
+ * blocks of TUYA_TLS_PSRAM_MIN bytes and more, which go to PSRAM. */
+typedef struct {
+    uint32_t size;
+    uint32_t ram; /* TLS_MEM_MAGIC | TAL_MEM_RAM_* */
+} tls_mem_hdr_t;
+
+/* blocks mbedtls got before tuya_tls_init have no header */
+#define TLS_MEM_MAGIC      0x544C5300
+#define TLS_MEM_IS_HDR(h)  (((h)->ram & ~0xFFu) == TLS_MEM_MAGIC)
+#define TLS_MEM_RAM_OF(h)  ((h)->ram & 0xFFu)
+
+static tuya_tls_mem_info_t s_tls_mem;
+
+static void __tls_mem_account(uint32_t ram, size_t size, bool add)
+{
+    uint32_t *live = (ram == TAL_MEM_RAM_PSRAM) ? &s_tls_mem.psram_live : &s_tls_mem.sram_live;
+    uint32_t *peak = (ram == TAL_MEM_RAM_PSRAM) ? &s_tls_mem.psram_peak : &s_tls_mem.sram_peak;
+
+    if (!add) {
+        __atomic_fetch_sub(live, (uint32_t)size, __ATOMIC_RELAXED);
+        return;
+    }
+
+    uint32_t now = __atomic_add_fetch(live, (uint32_t)size, __ATOMIC_RELAXED);
+    uint32_t old = __atomic_load_n(peak, __ATOMIC_RELAXED);
+    while (now > old && !__atomic_compare_exchange_n(peak, &old, now, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+static void *__tuya_tls_calloc(size_t nmemb, size_t size)
 {
+    tls_mem_hdr_t *hdr = NULL;
     size_t mem_size = nmemb * size;
-    void *ptr = tal_malloc(mem_size);
-    if (ptr != NULL) {
-        memset(ptr, 0, mem_size);
-    } else {
-        PR_ERR("------- alloc failed,size:%d", size);
+
+    if (size != 0 && mem_size / size != nmemb) {
+        return NULL;
     }
-    return ptr;
+
+#if defined(ENABLE_EXT_RAM) && (ENABLE_EXT_RAM == 1)
+    if (mem_size >= TUYA_TLS_PSRAM_MIN) {
+        hdr = tal_psram_malloc(sizeof(tls_mem_hdr_t) + mem_size);
+        if (hdr) {
+            hdr->ram = TLS_MEM_MAGIC | TAL_MEM_RAM_PSRAM;
+        }
+    }
+#endif
+    if (hdr == NULL) {
+        hdr = tal_malloc(sizeof(tls_mem_hdr_t) + mem_size);
+        if (hdr == NULL) {
+            PR_ERR("------- alloc failed,size:%d", mem_size);
+            return NULL;
+        }
+        hdr->ram = TLS_MEM_MAGIC | TAL_MEM_RAM_SRAM;
+    }
+    hdr->size = (uint32_t)mem_size;
+    __tls_mem_account(TLS_MEM_RAM_OF(hdr), mem_size, true);
+
+    memset(hdr + 1, 0, mem_size);
+    return hdr + 1;
+}
+
+static void __tuya_tls_free(void *ptr)
+{
+    if (ptr == NULL) {
+        return;
+    }
+
+    tls_mem_hdr_t *hdr = (tls_mem_hdr_t *)ptr - 1;
+    if (!TLS_MEM_IS_HDR(hdr)) {
+        tal_free(ptr);
+        return;
+    }
+    hdr->ram &= 0xFFu; /* a stale pointer freed twice must not pass the check */
+    __tls_mem_account(hdr->ram, hdr->size, false);
+#if defined(ENABLE_EXT_RAM) && (ENABLE_EXT_RAM == 1)
+    if (hdr->ram == TAL_MEM_RAM_PSRAM) {
+        tal_psram_free(hdr);
+        return;
+    }
+#endif
+    tal_free(hdr);
+}
+
+static uint8_t __tls_mem_ram(const void *ptr)
+{
+    const tls_mem_hdr_t *hdr = (const tls_mem_hdr_t *)ptr - 1;
+
+    return (ptr && TLS_MEM_IS_HDR(hdr)) ? (uint8_t)TLS_MEM_RAM_OF(hdr) : TAL_MEM_RAM_SRAM;
 }
 
 #if defined(ENABLE_MBEDTLS_DEBUG) && (ENABLE_MBEDTLS_DEBUG == 1)
@@ -389,6 +470,136 @@ static OPERATE_RET mbedtls_cert_pkey_parse(tuya_tls_hander p_tls_handler)
     return OPRT_OK;
 }
 
+/* -------------------------------------------------------------------------- */
+/*                              TLS Session cache                             */
+/* -------------------------------------------------------------------------- */
+
+/* Sessions of the last servers, keyed by host:port and shared by every TLS
+ * connection, so a reconnect resumes instead of running ECDHE and the
+ * certificate chain again. Resumption uses the session id, or the ticket
+ * when MBEDTLS_SSL_SESSION_TICKETS is enabled. */
+#ifndef TUYA_TLS_SESSION_CACHE_NUM
+#define TUYA_TLS_SESSION_CACHE_NUM 4
+#endif
+
+#if (TUYA_TLS_SESSION_CACHE_NUM > 0)
+typedef struct {
+    char host[TLS_URL_LEN];
+    int port;
+    uint32_t last_used;
+    mbedtls_ssl_session session;
+} tls_session_slot_t;
+
+static tls_session_slot_t s_session_cache[TUYA_TLS_SESSION_CACHE_NUM];
+static MUTEX_HANDLE s_session_mutex = NULL;
+static uint32_t s_session_clock = 0;
+
+/* locked */
+static tls_session_slot_t *tls_session_find(const char *hostname, int port)
+{
+    for (int i = 0; i < TUYA_TLS_SESSION_CACHE_NUM; i++) {
+        tls_session_slot_t *slot = &s_session_cache[i];
+        if (slot->host[0] && slot->port == port && 0 == strcmp(slot->host, hostname)) {
+            return slot;
+        }
+    }
+    return NULL;
+}
+
+/* locked */
+static void tls_session_slot_free(tls_session_slot_t *slot)
+{
+    mbedtls_ssl_session_free(&slot->session);
+    slot->host[0] = '\0';
+}
+
+static bool tls_session_load(mbedtls_ssl_context *ssl, const char *hostname, int port)
+{
+    bool resumed = false;
+
+    if (s_session_mutex == NULL || hostname == NULL) {
+        return false;
+    }
+
+    tal_mutex_lock(s_session_mutex);
+    tls_session_slot_t *slot = tls_session_find(hostname, port);
+    if (slot && 0 == mbedtls_ssl_set_session(ssl, &slot->session)) {
+        slot->last_used = ++s_session_clock;
+        resumed = true;
+    }
+    tal_mutex_unlock(s_session_mutex);
+
+    return resumed;
+}
+
+static void tls_session_save(const mbedtls_ssl_context *ssl, const char *hostname, int port)
+{
+    if (s_session_mutex == NULL || hostname == NULL || strlen(hostname) >= TLS_URL_LEN) {
+        return;
+    }
+
+    tal_mutex_lock(s_session_mutex);
+    tls_session_slot_t *slot = tls_session_find(hostname, port);
+    if (slot == NULL) {
+        /* a free slot, else the least recently used one */
+        slot = &s_session_cache[0];
+        for (int i = 0; i < TUYA_TLS_SESSION_CACHE_NUM && slot->host[0]; i++) {
+            if (!s_session_cache[i].host[0] || s_session_cache[i].last_used < slot->last_used) {
+                slot = &s_session_cache[i];
+            }
+        }
+    }
+    tls_session_slot_free(slot);
+    mbedtls_ssl_session_init(&slot->session);
+    if (0 == mbedtls_ssl_get_session(ssl, &slot->session)) {
+        strcpy(slot->host, hostname);
+        slot->port = port;
+        slot->last_used = ++s_session_clock;
+    }
+    tal_mutex_unlock(s_session_mutex);
+}
+
+static void tls_session_drop(const char *hostname, int port)
+{
+    if (s_session_mutex == NULL || hostname == NULL) {
+        return;
+    }
+
+    tal_mutex_lock(s_session_mutex);
+    tls_session_slot_t *slot = tls_session_find(hostname, port);
+    if (slot) {
+        tls_session_slot_free(slot);
+    }
+    tal_mutex_unlock(s_session_mutex);
+}
+#else
+#define tls_session_load(ssl, hostname, port) false
+#define tls_session_save(ssl, hostname, port)
+#define tls_session_drop(hostname, port)
+#endif
+
+/**
+ * @brief drop all cached TLS sessions
+ *
+ * The next connection to each server runs a full handshake.
+ */
+void tuya_tls_session_cache_clear(void)
+{
+#if (TUYA_TLS_SESSION_CACHE_NUM > 0)
+    if (s_session_mutex == NULL) {
+        return;
+    }
+
+    tal_mutex_lock(s_session_mutex);
+    for (int i = 0; i < TUYA_TLS_SESSION_CACHE_NUM; i++) {
+        if (s_session_cache[i].host[0]) {
+            tls_session_slot_free(&s_session_cache[i]);
+        }
+    }
+    tal_mutex_unlock(s_session_mutex);
+#endif
+}
+
 static int tuya_tls_ciphersuite_list[] = {MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_CBC_SHA256,
                                           MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256,
                                           MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_GCM_SHA256, 0};
@@ -409,7 +620,7 @@ OPERATE_RET tuya_tls_init(void)
     mbedtls_threading_set_alt(__tuya_tls_mutex_init, __tuya_tls_mutex_free, __tuya_tls_mutex_lock,
                               __tuya_tls_mutex_unlock);
 
-    op_ret = mbedtls_platform_set_calloc_free(tal_calloc, tal_free);
+    op_ret = mbedtls_platform_set_calloc_free(__tuya_tls_calloc, __tuya_tls_free);
     if (op_ret != 0) {
         PR_ERR("mbedtls_platform_set_calloc_free Fail. %x", op_ret);
         return op_ret;
@@ -425,6 +636,14 @@ OPERATE_RET tuya_tls_init(void)
     }
     mbedtls_ctr_drbg_set_prediction_resistance(&ty_ctr_drbg, MBEDTLS_CTR_DRBG_PR_OFF);
 
+#if (TUYA_TLS_SESSION_CACHE_NUM > 0)
+    if (s_session_mutex == NULL && OPRT_OK != tal_mutex_create_init(&s_session_mutex)) {
+        /* connections still work, they just never resume */
+        PR_ERR("tls session cache mutex create fail");
+        s_session_mutex = NULL;
+    }
+#endif
+
     PR_NOTICE("tuya_tls_init ok!");
 
     return OPRT_OK;
@@ -530,6 +749,26 @@ tuya_tls_config_t *tuya_tls_config_get(tuya_tls_hander p_tls_handler)
     return &(tls_context->config);
 }
 
+#if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
+/* smallest MaxFragmentLength holding the largest record the connection wants */
+static unsigned char __tuya_tls_mfl_code(const tuya_tls_config_t *config)
+{
+    size_t len = config->in_content_len > config->out_content_len ? config->in_content_len : config->out_content_len;
+
+    if (len == 0) {
+        len = TUYA_TLS_MFL_DEFAULT;
+    }
+    if (len <= 512) {
+        return MBEDTLS_SSL_MAX_FRAG_LEN_512;
+    } else if (len <= 1024) {
+        return MBEDTLS_SSL_MAX_FRAG_LEN_1024;
+    } else if (len <= 2048) {
+        return MBEDTLS_SSL_MAX_FRAG_LEN_2048;
+    }
+    return MBEDTLS_SSL_MAX_FRAG_LEN_4096;
+}
+#endif
+
 /**
  * @brief Establishes a TLS connection with the specified hostname and port
  * number.
@@ -550,6 +789,8 @@ OPERATE_RET tuya_tls_connect(tuya_tls_hander p_tls_handler, char *hostname, int
 {
     OPERATE_RET op_ret;
     tuya_mbedtls_context_t *tls_context = (tuya_mbedtls_context_t *)p_tls_handler;
+    bool cache_session = false;
+    bool offered = false;
 
     if (NULL == p_tls_handler || socket_fd < 0) {
         PR_ERR("INPUT INVALID PARM");
@@ -590,11 +831,8 @@ OPERATE_RET tuya_tls_connect(tuya_tls_hander p_tls_handler, char *hostname, int
     }
 
 #if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
-#if (MBEDTLS_SSL_MAX_CONTENT_LEN >= 4096)
-    mbedtls_ssl_conf_max_frag_len(p_conf_ctx, MBEDTLS_SSL_MAX_FRAG_LEN_4096);
-#else
-    mbedtls_ssl_conf_max_frag_len(p_conf_ctx, MBEDTLS_SSL_MAX_FRAG_LEN_1024);
-#endif
+    /* the record buffers shrink to the fragment length the server accepts */
+    mbedtls_ssl_conf_max_frag_len(p_conf_ctx, __tuya_tls_mfl_code(&tls_context->config));
 #endif
     if (s_pre_conn_cb) {
         PR_DEBUG("s_pre_conn_cb  %08x", s_pre_conn_cb);
@@ -639,6 +877,10 @@ OPERATE_RET tuya_tls_connect(tuya_tls_hander p_tls_handler, char *hostname, int
     mbedtls_ssl_set_bio(p_ssl_ctx, tls_context, __tuya_tls_socket_send_cb, __tuya_tls_socket_recv_cb, NULL);
     PR_DEBUG("socket fd is set. set to inner send/recv to handshake");
 
+    /* PSK handshakes are cheap, only certificate sessions are cached */
+    cache_session = (tls_context->config.mode != TUYA_TLS_PSK_MODE) && hostname;
+    offered = cache_session && tls_session_load(p_ssl_ctx, hostname, port_num);
+
     TIME_T cur_time = tal_time_get_posix();
 
     while ((op_ret = mbedtls_ssl_handshake(p_ssl_ctx)) != 0) {
@@ -678,6 +920,11 @@ OPERATE_RET tuya_tls_connect(tuya_tls_hander p_tls_handler, char *hostname, int
         goto tuya_tls_connect_EXIT;
     }
 
+    if (cache_session) {
+        /* also refreshes the entry after a resumption, which may carry a new ticket */
+        tls_session_save(p_ssl_ctx, hostname, port_num);
+    }
+
     PR_DEBUG("handshake finish for %s. set send/recv to user set", (hostname ? hostname : ""));
     if (tls_context->config.f_send && tls_context->config.f_recv) {
         mbedtls_ssl_set_bio(p_ssl_ctx, tls_context->config.user_data, tls_context->config.f_send,
@@ -687,11 +934,21 @@ OPERATE_RET tuya_tls_connect(tuya_tls_hander p_tls_handler, char *hostname, int
     PR_DEBUG("TUYA_TLS Success Connect %s:%d Suit:%s", (hostname ? hostname : ""), port_num,
              mbedtls_ssl_get_ciphersuite(p_ssl_ctx));
 
+    tuya_tls_mem_stat_t stat;
+    if (OPRT_OK == tuya_tls_mem_stat_get(p_tls_handler, &stat)) {
+        PR_DEBUG("TUYA_TLS records in %u/%u out %u/%u%s, tls heap sram %u psram %u", stat.in_payload, stat.in_buf_len,
+                 stat.out_payload, stat.out_buf_len, stat.buf_in_psram ? " psram" : "", stat.heap.sram_live,
+                 stat.heap.psram_live);
+    }
+
     return OPRT_OK;
 
 tuya_tls_connect_EXIT:
 
     PR_ERR("TUYA_TLS faild Connect %s:%d", (hostname ? hostname : ""), port_num);
+    if (offered) {
+        tls_session_drop(hostname, port_num);
+    }
 
     return op_ret;
 }
@@ -783,6 +1040,23 @@ int tuya_tls_read(tuya_tls_hander tls_handler, uint8_t *buf, uint32_t len)
     return value;
 }
 
+/**
+ * @brief Gets the number of decrypted bytes buffered in a TLS connection.
+ *
+ * @param[in] tls_handler The TLS handler.
+ *
+ * @return The number of bytes that can be read without blocking.
+ */
+size_t tuya_tls_bytes_avail(tuya_tls_hander tls_handler)
+{
+    if (tls_handler == NULL) {
+        return 0;
+    }
+
+    tuya_mbedtls_context_t *tls_context = (tuya_mbedtls_context_t *)tls_handler;
+    return mbedtls_ssl_get_bytes_avail(&(tls_context->ssl_ctx));
+}
+
 /**
  * @brief generated random
  *
@@ -824,6 +1098,64 @@ OPERATE_RET tuya_tls_disconnect(tuya_tls_hander tls_handler)
     return OPRT_OK;
 }
 
+/**
+ * @brief Report the record buffers of a connection and the TLS heap
+ *
+ * @param[in] tls_handler refer to tuya_tls_hander
+ * @param[out] stat the report
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tuya_tls_mem_stat_get(tuya_tls_hander tls_handler, tuya_tls_mem_stat_t *stat)
+{
+    if (tls_handler == NULL || stat == NULL) {
+        return OPRT_INVALID_PARM;
+    }
+
+    tuya_mbedtls_context_t *tls_context = (tuya_mbedtls_context_t *)tls_handler;
+    mbedtls_ssl_context *p_ssl_ctx = &(tls_context->ssl_ctx);
+
+    memset(stat, 0, sizeof(tuya_tls_mem_stat_t));
+    if (p_ssl_ctx->MBEDTLS_PRIVATE(conf) == NULL) {
+        return OPRT_RESOURCE_NOT_READY;
+    }
+#if defined(MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH)
+    stat->in_buf_len = p_ssl_ctx->MBEDTLS_PRIVATE(in_buf_len);
+    stat->out_buf_len = p_ssl_ctx->MBEDTLS_PRIVATE(out_buf_len);
+#else
+    stat->in_buf_len = p_ssl_ctx->MBEDTLS_PRIVATE(in_buf) ? MBEDTLS_SSL_IN_CONTENT_LEN : 0;
+    stat->out_buf_len = p_ssl_ctx->MBEDTLS_PRIVATE(out_buf) ? MBEDTLS_SSL_OUT_CONTENT_LEN : 0;
+#endif
+    int in_payload = mbedtls_ssl_get_max_in_record_payload(p_ssl_ctx);
+    int out_payload = mbedtls_ssl_get_max_out_record_payload(p_ssl_ctx);
+    stat->in_payload = in_payload > 0 ? (uint32_t)in_payload : 0;
+    stat->out_payload = out_payload > 0 ? (uint32_t)out_payload : 0;
+    stat->buf_in_psram = (__tls_mem_ram(p_ssl_ctx->MBEDTLS_PRIVATE(in_buf)) == TAL_MEM_RAM_PSRAM);
+    tuya_tls_mem_info_get(&stat->heap);
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief Report the live and peak bytes of all TLS connections
+ *
+ * @param[out] info the report
+ *
+ * @return none
+ */
+void tuya_tls_mem_info_get(tuya_tls_mem_info_t *info)
+{
+    if (info == NULL) {
+        return;
+    }
+
+    info->sram_live = __atomic_load_n(&s_tls_mem.sram_live, __ATOMIC_RELAXED);
+    info->sram_peak = __atomic_load_n(&s_tls_mem.sram_peak, __ATOMIC_RELAXED);
+    info->psram_live = __atomic_load_n(&s_tls_mem.psram_live, __ATOMIC_RELAXED);
+    info->psram_peak = __atomic_load_n(&s_tls_mem.psram_peak, __ATOMIC_RELAXED);
+}
+
 /**
  * Retrieves the callback function for Tuya TLS events.
  *
@@ -20,6 +20,7 @@
 #define TUYA_TLS_H
 
 // mbedtls only used to encryption the seesion,not used to create the seesion
+#include "tuya_iot_config.h"
 #include "tuya_cloud_types.h"
 // #include "ssl.h"
 // #include "tuya_cert_manager.h"
@@ -30,6 +31,20 @@ extern "C" {
 
 typedef void *tuya_tls_hander;
 
+/* mbedtls blocks at least this big come from PSRAM when ENABLE_EXT_RAM */
+#ifndef TUYA_TLS_PSRAM_MIN
+#define TUYA_TLS_PSRAM_MIN 2048
+#endif
+
+/* MaxFragmentLength asked for when the config sets no content length */
+#ifndef TUYA_TLS_MFL_DEFAULT
+#if defined(ENABLE_EXT_RAM) && (ENABLE_EXT_RAM == 1)
+#define TUYA_TLS_MFL_DEFAULT 4096
+#else
+#define TUYA_TLS_MFL_DEFAULT 1024
+#endif
+#endif
+
 typedef enum {
     TSS_INIT = 0,
     TSS_START,
@@ -82,6 +97,7 @@ typedef struct {
     char *client_pkey;
     int client_pkey_size;
 
+    /* largest record payload wanted, asked for by MaxFragmentLength, 0 for TUYA_TLS_MFL_DEFAULT */
     size_t in_content_len;
     size_t out_content_len;
 
@@ -91,6 +107,22 @@ typedef struct {
     void *user_data;
 } tuya_tls_config_t;
 
+typedef struct {
+    uint32_t sram_live;  /* bytes mbedtls holds in SRAM now */
+    uint32_t sram_peak;  /* most bytes held in SRAM at once */
+    uint32_t psram_live; /* bytes mbedtls holds in PSRAM now */
+    uint32_t psram_peak; /* most bytes held in PSRAM at once */
+} tuya_tls_mem_info_t;
+
+typedef struct {
+    uint32_t in_buf_len;      /* incoming record buffer */
+    uint32_t out_buf_len;     /* outgoing record buffer */
+    uint32_t in_payload;      /* largest incoming record payload, after MaxFragmentLength */
+    uint32_t out_payload;     /* largest outgoing record payload */
+    bool buf_in_psram;        /* the record buffers are in PSRAM */
+    tuya_tls_mem_info_t heap; /* all mbedtls memory, every connection together */
+} tuya_tls_mem_stat_t;
+
 /**
  * @brief Get mbedtls random data in the specified length
  *
@@ -198,6 +230,48 @@ int tuya_tls_write(tuya_tls_hander tls_handler, uint8_t *buf, uint32_t len);
  */
 int tuya_tls_read(tuya_tls_hander tls_handler, uint8_t *buf, uint32_t len);
 
+/**
+ * @brief tls decrypted bytes buffered for reading
+ *
+ * Data already taken off the socket does not make it readable again, so
+ * check this before waiting on the socket.
+ *
+ * @param[in] tls_handler refer to tuya_tls_hander
+ *
+ * @return the number of bytes tuya_tls_read() returns without blocking
+ */
+size_t tuya_tls_bytes_avail(tuya_tls_hander tls_handler);
+
+/**
+ * @brief drop all cached TLS sessions
+ *
+ * Sessions are cached per host:port after each certificate handshake and
+ * offered for resumption on the next connection to the same server. Call
+ * this when the trusted certificates change.
+ */
+void tuya_tls_session_cache_clear(void);
+
+/**
+ * @brief report the record buffers of a connection and the TLS heap
+ *
+ * The record buffers start at MBEDTLS_SSL_IN/OUT_CONTENT_LEN and shrink to the
+ * negotiated MaxFragmentLength once the handshake is done.
+ *
+ * @param[in] tls_handler refer to tuya_tls_hander
+ * @param[out] stat the report
+ *
+ * @return OPRT_OK on success. Others on error, please refer to
+ * tuya_error_code.h
+ */
+OPERATE_RET tuya_tls_mem_stat_get(tuya_tls_hander tls_handler, tuya_tls_mem_stat_t *stat);
+
+/**
+ * @brief report the live and peak bytes of all TLS connections
+ *
+ * @param[out] info the report
+ */
+void tuya_tls_mem_info_get(tuya_tls_mem_info_t *info);
+
 /**
  * @brief generated random
  *
@@ -120,6 +120,8 @@ OPERATE_RET tuya_tcp_transporter_connect(tuya_transporter_t t, const char *host,
     }
 
     if (tal_net_connect(tcp_transporter->socket_fd, hostaddr, port) < 0) {
+        // the cached address may be gone, resolve again on the next try
+        tal_net_dns_cache_flush(host);
         op_ret = OPRT_MID_TRANSPORT_TCP_CONNECD_FAILED;
         goto err_out;
     }
@@ -200,6 +200,11 @@ OPERATE_RET tuya_tls_transporter_poll_read(tuya_transporter_t t, int timeout_ms)
 
     tuya_tls_transporter_t tls_transporter = (tuya_tls_transporter_t)t;
 
+    /* a record read earlier may hold more than the last read took */
+    if (tuya_tls_bytes_avail(tls_transporter->tls_handler) > 0) {
+        return 1;
+    }
+
     return tuya_transporter_poll_read(tls_transporter->tcp_transporter, timeout_ms);
 }
 
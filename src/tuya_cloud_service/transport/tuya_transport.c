@@ -30,6 +30,9 @@
 
 #define MAX_TRANSPORTER_NUM (2)
 
+/* segments shorter than this are gathered before tuya_transporter_writev falls back to f_write */
+#define TRANSPORTER_WRITEV_GATHER_LEN (256)
+
 struct tuya_transport_array_handle {
     tuya_transporter_t array[MAX_TRANSPORTER_NUM];
     uint8_t index;
@@ -215,6 +218,83 @@ OPERATE_RET tuya_transporter_write(tuya_transporter_t t, uint8_t *buf, int len,
     return OPRT_INVALID_PARM;
 }
 
+static OPERATE_RET __transporter_write_seg(tuya_transporter_t t, uint8_t *buf, int len, int timeout_ms, int *sent)
+{
+    OPERATE_RET rt = t->f_write(t, buf, len, timeout_ms);
+    if (rt > 0) {
+        *sent += rt;
+    }
+    return rt;
+}
+
+/**
+ * @brief Writes a list of buffers to the Tuya transporter.
+ *
+ * Uses the transporter's own f_writev when it has one. Otherwise the
+ * segments go through f_write in order: short ones are gathered in a stack
+ * buffer, long ones are written straight from the caller's memory. The
+ * write stops at the first error or short write.
+ *
+ * @param t The Tuya transporter to write data to.
+ * @param iov The segments to write.
+ * @param iov_cnt The number of segments.
+ * @param timeout_ms The timeout value in milliseconds for each write.
+ *
+ * @return The number of bytes written, or a negative error code if nothing
+ * could be written.
+ */
+OPERATE_RET tuya_transporter_writev(tuya_transporter_t t, const tuya_transporter_iov_t *iov, int iov_cnt,
+                                    int timeout_ms)
+{
+    uint8_t gather[TRANSPORTER_WRITEV_GATHER_LEN];
+    int gather_len = 0, sent = 0, i = 0;
+    OPERATE_RET rt = OPRT_OK;
+
+    if (NULL == t || (NULL == iov && iov_cnt > 0)) {
+        return OPRT_INVALID_PARM;
+    }
+    if (t->f_writev) {
+        return t->f_writev(t, iov, iov_cnt, timeout_ms);
+    }
+    if (NULL == t->f_write) {
+        return OPRT_INVALID_PARM;
+    }
+
+    for (i = 0; i < iov_cnt; i++) {
+        if (iov[i].len <= 0) {
+            continue;
+        }
+        if (gather_len + iov[i].len <= (int)sizeof(gather)) {
+            memcpy(gather + gather_len, iov[i].buf, iov[i].len);
+            gather_len += iov[i].len;
+            continue;
+        }
+        if (gather_len > 0) {
+            rt = __transporter_write_seg(t, gather, gather_len, timeout_ms, &sent);
+            if (rt != gather_len) {
+                goto EXIT;
+            }
+            gather_len = 0;
+        }
+        if (iov[i].len < (int)sizeof(gather)) {
+            memcpy(gather, iov[i].buf, iov[i].len);
+            gather_len = iov[i].len;
+            continue;
+        }
+        rt = __transporter_write_seg(t, iov[i].buf, iov[i].len, timeout_ms, &sent);
+        if (rt != iov[i].len) {
+            goto EXIT;
+        }
+    }
+    if (gather_len > 0) {
+        rt = __transporter_write_seg(t, gather, gather_len, timeout_ms, &sent);
+    }
+
+EXIT:
+    /* report what went out, the error only when nothing did */
+    return (sent > 0 || rt >= 0) ? sent : rt;
+}
+
 /**
  * @brief Reads data from the transport layer using polling.
  *
@@ -74,6 +74,15 @@ typedef OPERATE_RET (*transporter_read_fn)(tuya_transporter_t transporter, uint8
 
 typedef OPERATE_RET (*transporter_write_fn)(tuya_transporter_t transporter, uint8_t *buf, int len, int timeout_ms);
 
+/* one segment of a vectored write */
+typedef struct {
+    uint8_t *buf;
+    int len;
+} tuya_transporter_iov_t;
+
+typedef OPERATE_RET (*transporter_writev_fn)(tuya_transporter_t transporter, const tuya_transporter_iov_t *iov,
+                                             int iov_cnt, int timeout_ms);
+
 typedef OPERATE_RET (*transporter_poll_read_fn)(tuya_transporter_t transporter, int timeout_ms);
 
 typedef OPERATE_RET (*transporter_poll_write_fn)(tuya_transporter_t transporter, int timeout_ms);
@@ -92,6 +101,7 @@ struct tuya_transporter_inter_t {
     transporter_close_fn f_close;
     transporter_destroy_fn f_destroy;
     transporter_ctrl f_ctrl;
+    transporter_writev_fn f_writev; // optional, NULL falls back to f_write
 };
 
 /**
@@ -233,6 +243,26 @@ OPERATE_RET tuya_transporter_read(tuya_transporter_t transporter, uint8_t *buf,
  */
 OPERATE_RET tuya_transporter_write(tuya_transporter_t transporter, uint8_t *buf, int len, int timeout_ms);
 
+/**
+ * @brief Writes a list of buffers to the specified transporter.
+ *
+ * The segments are sent back to back as one logical write, so a caller can
+ * send a header, a payload taken straight from its own buffer and a trailer
+ * without first copying them together. Transporters that keep message
+ * boundaries (websocket) send the whole list as one message. Others fall
+ * back to f_write, with short segments gathered so they do not go out as
+ * separate tiny TCP segments or TLS records.
+ *
+ * @param transporter The transporter to write data to.
+ * @param iov The segments to write, empty segments are skipped.
+ * @param iov_cnt The number of segments.
+ * @param timeout_ms The timeout value in milliseconds for the write operation.
+ * @return The number of bytes written (the sum of all segment lengths on
+ * success, less on a short write), or a negative error code on failure.
+ */
+OPERATE_RET tuya_transporter_writev(tuya_transporter_t transporter, const tuya_transporter_iov_t *iov, int iov_cnt,
+                                    int timeout_ms);
+
 /**
  * @brief Reads data from the transporter using polling mechanism.
  *
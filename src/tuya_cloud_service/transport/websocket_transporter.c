@@ -32,6 +32,13 @@
 
 #include "websocket_client.h"
 #include "websocket_transporter.h"
+
+/* joined writes up to this size reuse one buffer kept by the transporter */
+#ifndef WEBSOCKET_TX_BUF_KEEP
+#define WEBSOCKET_TX_BUF_KEEP (4096)
+#endif
+#define WEBSOCKET_TX_BUF_ALIGN(n) (((n) + 511) & ~511)
+
 typedef struct websocket_transporter_inter_t {
     struct tuya_transporter_inter_t base;
     char *path;
@@ -41,6 +48,9 @@ typedef struct websocket_transporter_inter_t {
     uint8_t *read_buffer;
     tuya_tcp_config_t tcpConfig;
     MUTEX_HANDLE mutex;
+    MUTEX_HANDLE tx_mutex; // guards tx_buf
+    uint8_t *tx_buf;       // joins the segments of one writev
+    uint32_t tx_size;
 } * tuya_websocket_transporter_t;
 
 /**
@@ -156,6 +166,81 @@ OPERATE_RET websocket_transporter_write(tuya_transporter_t t, uint8_t *buf, int
     return websocket_client_send_bin(wst->ws_client, buf, len);
 }
 
+/**
+ * @brief Writes a list of buffers to the WebSocket transporter.
+ *
+ * The segments are sent as one binary message, so the receiver sees the
+ * same frame a single write of the joined buffer would produce. A single
+ * segment is sent in place, several are joined first in a buffer the
+ * transporter keeps, so a stream of audio packets allocates only once.
+ *
+ * @param t The WebSocket transporter.
+ * @param iov The segments to write.
+ * @param iov_cnt The number of segments.
+ * @param timeout_ms The timeout value in milliseconds.
+ * @return The result of the operation.
+ */
+OPERATE_RET websocket_transporter_writev(tuya_transporter_t t, const tuya_transporter_iov_t *iov, int iov_cnt,
+                                         int timeout_ms)
+{
+    OPERATE_RET rt = OPRT_OK;
+    int i = 0, total = 0, used = 0, last = -1;
+
+    for (i = 0; i < iov_cnt; i++) {
+        if (iov[i].len > 0) {
+            total += iov[i].len;
+            used++;
+            last = i;
+        }
+    }
+    if (used <= 1) {
+        return websocket_transporter_write(t, used ? iov[last].buf : NULL, total, timeout_ms);
+    }
+
+    tuya_websocket_transporter_t wst = (tuya_websocket_transporter_t)t;
+    uint8_t *buf = NULL;
+    bool keep = (total <= WEBSOCKET_TX_BUF_KEEP) && wst->tx_mutex;
+
+    if (keep) {
+        tal_mutex_lock(wst->tx_mutex);
+        if (wst->tx_size < (uint32_t)total) {
+            if (wst->tx_buf) {
+                Free(wst->tx_buf);
+            }
+            wst->tx_size = 0;
+            wst->tx_buf = Malloc(WEBSOCKET_TX_BUF_ALIGN(total));
+            if (wst->tx_buf) {
+                wst->tx_size = WEBSOCKET_TX_BUF_ALIGN(total);
+            }
+        }
+        buf = wst->tx_buf;
+    } else {
+        buf = Malloc(total);
+    }
+    if (NULL == buf) {
+        if (keep) {
+            tal_mutex_unlock(wst->tx_mutex);
+        }
+        return OPRT_MALLOC_FAILED;
+    }
+
+    total = 0;
+    for (i = 0; i < iov_cnt; i++) {
+        if (iov[i].len > 0) {
+            memcpy(buf + total, iov[i].buf, iov[i].len);
+            total += iov[i].len;
+        }
+    }
+    rt = websocket_transporter_write(t, buf, total, timeout_ms);
+
+    if (keep) {
+        tal_mutex_unlock(wst->tx_mutex);
+    } else {
+        Free(buf);
+    }
+    return rt;
+}
+
 /**
  * @brief Polls the WebSocket transporter for incoming data to read.
  *
@@ -261,8 +346,11 @@ tuya_transporter_t tuya_websocket_transporter_create()
                               websocket_transporter_close, websocket_transporter_read, websocket_transporter_write,
                               websocket_transporter_poll_read, NULL, tuya_websocket_transporter_destroy,
                               websocket_transporter_ctrl);
+    t->base.f_writev = websocket_transporter_writev;
 
     tal_mutex_create_init(&t->mutex);
+    // without it joined writes allocate each time
+    tal_mutex_create_init(&t->tx_mutex);
 
     return &t->base;
 }
@@ -289,6 +377,14 @@ OPERATE_RET tuya_websocket_transporter_destroy(tuya_transporter_t transporter)
         tal_mutex_release(wst->mutex);
         wst->mutex = NULL;
     }
+    if (wst->tx_mutex) {
+        tal_mutex_release(wst->tx_mutex);
+        wst->tx_mutex = NULL;
+    }
+    if (wst->tx_buf) {
+        Free(wst->tx_buf);
+        wst->tx_buf = NULL;
+    }
     if (wst->path) {
         Free(wst->path);
         wst->path = NULL;
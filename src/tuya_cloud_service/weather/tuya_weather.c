@@ -32,6 +32,242 @@
 #define WEATHER_API              "thing.weather.get"
 #define API_VERSION              "1.0"
 
+#define WEATHER_CACHE_NUM        4
+#define WEATHER_BATCH_LEN        512
+
+// Codes of each query, forecasts get their "w.date.N" appended
+#define TW_CODE_CURRENT_CONDITIONS "\"w.conditionNum\",\"w.temp\",\"w.humidity\",\"w.realFeel\",\"w.pressure\",\"w.uvi\",\"w.currdate\""
+#define TW_CODE_TODAY_HIGH_LOW "\"w.thigh\",\"w.tlow\",\"w.date.1\""
+#define TW_CODE_CURRENT_WIND "\"w.windDir\",\"w.windSpeed\",\"w.currdate\""
+#define TW_CODE_CURRENT_WIND_CN "\"w.windDir\",\"w.windSpeed\",\"w.windLevel\",\"w.currdate\""
+#define TW_CODE_SUNRISE_SUNSET_GMT "\"w.sunrise\",\"w.sunset\",\"t.unix\",\"w.currdate\""
+#define TW_CODE_SUNRISE_SUNSET_LOCAL "\"w.sunrise\",\"w.sunset\",\"t.local\",\"w.currdate\""
+#define TW_CODE_CURRENT_AQI "\"w.aqi\",\"w.qualityLevel\",\"w.pm25\",\"w.pm10\",\"w.o3\",\"w.no2\",\"w.co\",\"w.so2\",\"w.currdate\""
+#define TW_CODE_CURRENT_AQI_CN "\"w.aqi\",\"w.rank\",\"w.qualityLevel\",\"w.pm25\",\"w.pm10\",\"w.o3\",\"w.no2\",\"w.co\",\"w.so2\",\"w.currdate\""
+#define TW_CODE_CITY "\"c.province\",\"c.city\",\"c.area\""
+#define TW_CODE_FORECAST_CONDITIONS "\"w.conditionNum\",\"w.humidity\",\"w.temp\",\"w.uvi\",\"w.pressure\""
+#define TW_CODE_FORECAST_CONDITIONS_CN "\"w.conditionNum\",\"w.humidity\",\"w.uvi\""
+#define TW_CODE_FORECAST_WIND "\"w.windDir\",\"w.windSpeed\""
+#define TW_CODE_FORECAST_HIGH_LOW "\"w.thigh\",\"w.tlow\""
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef struct {
+    char *codes;     // Request codes the data answers
+    cJSON *data;     // "data" object of the response
+    SYS_TIME_T time; // Time of the response, 0 for a free entry
+} WEATHER_CACHE_T;
+
+typedef struct {
+    uint32_t query;
+    const char *codes;
+    bool forecast; // Codes need "w.date.N"
+} WEATHER_QUERY_T;
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static WEATHER_CACHE_T sg_weather_cache[WEATHER_CACHE_NUM];
+static MUTEX_HANDLE sg_weather_mutex = NULL;
+
+static const WEATHER_QUERY_T sg_weather_query[] = {
+    {TW_QUERY_CURRENT_CONDITIONS, TW_CODE_CURRENT_CONDITIONS, false},
+    {TW_QUERY_CURRENT_WIND, TW_CODE_CURRENT_WIND, false},
+    {TW_QUERY_CURRENT_WIND_CN, TW_CODE_CURRENT_WIND_CN, false},
+    {TW_QUERY_SUNRISE_SUNSET_GMT, TW_CODE_SUNRISE_SUNSET_GMT, false},
+    {TW_QUERY_CURRENT_AQI, TW_CODE_CURRENT_AQI, false},
+    {TW_QUERY_CURRENT_AQI_CN, TW_CODE_CURRENT_AQI_CN, false},
+    {TW_QUERY_CITY, TW_CODE_CITY, false},
+    {TW_QUERY_TODAY_HIGH_LOW, TW_CODE_FORECAST_HIGH_LOW, true},
+    {TW_QUERY_FORECAST_CONDITIONS, TW_CODE_FORECAST_CONDITIONS, true},
+    {TW_QUERY_FORECAST_CONDITIONS_CN, TW_CODE_FORECAST_CONDITIONS_CN, true},
+    {TW_QUERY_FORECAST_WIND, TW_CODE_FORECAST_WIND, true},
+    {TW_QUERY_FORECAST_HIGH_LOW, TW_CODE_FORECAST_HIGH_LOW, true},
+};
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+
+/**
+ * @brief Gets the forecast days of the "w.date.N" code in a code list.
+ *
+ * @param codes The code list.
+ *
+ * @return The days, 0 when the list has no forecast.
+ */
+static int tuya_weather_codes_days(const char *codes)
+{
+    const char *date = strstr(codes, "\"w.date.");
+
+    return date ? atoi(date + strlen("\"w.date.")) : 0;
+}
+
+/**
+ * @brief Checks whether every code of a list is in another list.
+ *
+ * "w.date.N" is covered by any "w.date.M" with M not less than N. The time
+ * format codes "t.unix" and "t.local" must match as they change the answer.
+ *
+ * @param cached The code list of a cached response.
+ * @param codes The requested code list.
+ *
+ * @return True when the cached response answers the request.
+ */
+static bool tuya_weather_codes_cover(const char *cached, const char *codes)
+{
+    char token[32];
+    const char *end = NULL;
+
+    while (NULL != (codes = strchr(codes, '"')) && NULL != (end = strchr(codes + 1, '"'))) {
+        size_t len = end - codes + 1;
+        if (len >= sizeof(token)) {
+            return false;
+        }
+        memcpy(token, codes, len);
+        token[len] = '\0';
+        codes = end + 1;
+
+        if (0 == strncmp(token, "\"w.date.", strlen("\"w.date."))) {
+            if (tuya_weather_codes_days(cached) < atoi(token + strlen("\"w.date."))) {
+                return false;
+            }
+        } else if (NULL == strstr(cached, token)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Appends the codes of a list to a batch, skipping the ones it has.
+ *
+ * @param batch The batch code list.
+ * @param size The size of the batch buffer.
+ * @param codes The code list to add.
+ *
+ * @return OPRT_OK on success, OPRT_BUFFER_NOT_ENOUGH when the batch is full.
+ */
+static OPERATE_RET tuya_weather_codes_add(char *batch, size_t size, const char *codes)
+{
+    char token[32];
+    const char *end = NULL;
+    size_t used = strlen(batch);
+
+    while (NULL != (codes = strchr(codes, '"')) && NULL != (end = strchr(codes + 1, '"'))) {
+        size_t len = end - codes + 1;
+        if (len >= sizeof(token)) {
+            return OPRT_BUFFER_NOT_ENOUGH;
+        }
+        memcpy(token, codes, len);
+        token[len] = '\0';
+        codes = end + 1;
+
+        if (strstr(batch, token)) {
+            continue;
+        }
+        if (used + len + 2 > size) {
+            return OPRT_BUFFER_NOT_ENOUGH;
+        }
+        used += snprintf(batch + used, size - used, "%s%s", used ? "," : "", token);
+    }
+
+    return OPRT_OK;
+}
+
+/**
+ * @brief Answers a request from a fresh cached response.
+ *
+ * @param code The requested codes.
+ * @param response Filled in like a cloud response on a hit.
+ *
+ * @return True on a hit.
+ */
+static bool tuya_weather_cache_get(const char *code, atop_base_response_t *response)
+{
+    bool hit = false;
+    SYS_TIME_T now = tal_system_get_millisecond();
+
+    if (NULL == sg_weather_mutex) {
+        return false;
+    }
+
+    tal_mutex_lock(sg_weather_mutex);
+    for (int i = 0; i < WEATHER_CACHE_NUM; i++) {
+        WEATHER_CACHE_T *cache = &sg_weather_cache[i];
+        if (0 == cache->time || now - cache->time >= TUYA_WEATHER_CACHE_TTL_S * 1000) {
+            continue;
+        }
+        if (!tuya_weather_codes_cover(cache->codes, code)) {
+            continue;
+        }
+        response->result = cJSON_CreateObject();
+        if (response->result) {
+            cJSON_AddItemToObject(response->result, "data", cJSON_Duplicate(cache->data, true));
+            response->success = true;
+            hit = true;
+        }
+        break;
+    }
+    tal_mutex_unlock(sg_weather_mutex);
+
+    return hit;
+}
+
+/**
+ * @brief Keeps the data of a cloud response for later requests.
+ *
+ * @param code The requested codes.
+ * @param response The cloud response.
+ *
+ * @return none
+ */
+static void tuya_weather_cache_set(const char *code, atop_base_response_t *response)
+{
+    cJSON *data = cJSON_GetObjectItem(response->result, "data");
+
+    if (NULL == data) {
+        return;
+    }
+    if (NULL == sg_weather_mutex && OPRT_OK != tal_mutex_create_init(&sg_weather_mutex)) {
+        return;
+    }
+
+    tal_mutex_lock(sg_weather_mutex);
+    // Replace the oldest entry, free entries have time 0
+    WEATHER_CACHE_T *cache = &sg_weather_cache[0];
+    for (int i = 1; i < WEATHER_CACHE_NUM; i++) {
+        if (sg_weather_cache[i].time < cache->time) {
+            cache = &sg_weather_cache[i];
+        }
+    }
+    if (cache->codes) {
+        tal_free(cache->codes);
+    }
+    if (cache->data) {
+        cJSON_Delete(cache->data);
+    }
+    memset(cache, 0, sizeof(WEATHER_CACHE_T));
+
+    cache->codes = tal_malloc(strlen(code) + 1);
+    cache->data = cJSON_Duplicate(data, true);
+    if (cache->codes && cache->data) {
+        strcpy(cache->codes, code);
+        cache->time = tal_system_get_millisecond();
+    } else {
+        if (cache->codes) {
+            tal_free(cache->codes);
+        }
+        if (cache->data) {
+            cJSON_Delete(cache->data);
+        }
+        memset(cache, 0, sizeof(WEATHER_CACHE_T));
+    }
+    tal_mutex_unlock(sg_weather_mutex);
+}
+
 /**
  * @brief Retrieves weather data from the Tuya cloud platform.
  *
@@ -59,6 +295,15 @@ static OPERATE_RET tuya_weather_get(const char *code, atop_base_response_t *resp
 
     tuya_iot_client_t *client = tuya_iot_client_get();
 
+    if (code == NULL) {
+        return OPRT_INVALID_PARM;
+    }
+
+    if (tuya_weather_cache_get(code, response)) {
+        PR_DEBUG("weather cache hit: %s", code);
+        return OPRT_OK;
+    }
+
     rt = tal_time_check_time_sync();
     if (OPRT_OK != rt) {
         PR_ERR("tal_time_check_time_sync error:%d", rt);
@@ -77,10 +322,6 @@ static OPERATE_RET tuya_weather_get(const char *code, atop_base_response_t *resp
 
     timestamp = tal_time_get_posix();
 
-    if (code == NULL) {
-        return OPRT_INVALID_PARM;
-    }
-
     post_data_len = snprintf(NULL, 0, "{\"codes\":[%s], \"t\":%d}", code, timestamp);
     post_data_len++; // add '\0'
 
@@ -106,6 +347,8 @@ static OPERATE_RET tuya_weather_get(const char *code, atop_base_response_t *resp
     rt = atop_base_request(&atop_request, response);
     if (OPRT_OK != rt) {
         PR_ERR("atop_base_request error:%d", rt);
+    } else if (response->success) {
+        tuya_weather_cache_set(code, response);
     }
 
     tal_free(post_data);
@@ -143,7 +386,7 @@ int tuya_weather_get_current_conditions(WEATHER_CURRENT_CONDITIONS_T *current_co
         return OPRT_COM_ERROR;
     }
 
-    const char* request_code = "\"w.conditionNum\",\"w.temp\",\"w.humidity\",\"w.realFeel\",\"w.pressure\",\"w.uvi\",\"w.currdate\"";
+    const char* request_code = TW_CODE_CURRENT_CONDITIONS;
 
     memset(&response, 0, sizeof(atop_base_response_t));
 
@@ -228,7 +471,7 @@ int tuya_weather_get_today_high_low_temp(int *high_temp, int *low_temp)
         return OPRT_COM_ERROR;
     }
 
-    const char* request_code = "\"w.thigh\",\"w.tlow\",\"w.date.1\"";
+    const char* request_code = TW_CODE_TODAY_HIGH_LOW;
 
     memset(&response, 0, sizeof(atop_base_response_t));
 
@@ -292,7 +535,7 @@ int tuya_weather_get_current_wind(char *wind_dir, size_t wind_dir_len, char *win
         return OPRT_COM_ERROR;
     }
 
-    const char* request_code = "\"w.windDir\",\"w.windSpeed\",\"w.currdate\"";
+    const char* request_code = TW_CODE_CURRENT_WIND;
 
     memset(&response, 0, sizeof(atop_base_response_t));
 
@@ -364,7 +607,7 @@ int tuya_weather_get_current_wind_cn(char *wind_dir, size_t wind_dir_len, char *
         return OPRT_COM_ERROR;
     }
 
-    const char* request_code = "\"w.windDir\",\"w.windSpeed\",\"w.windLevel\",\"w.currdate\"";
+    const char* request_code = TW_CODE_CURRENT_WIND_CN;
 
     memset(&response, 0, sizeof(atop_base_response_t));
 
@@ -439,7 +682,7 @@ int tuya_weather_get_current_sunrise_sunset_gmt(char *sunrise, size_t sunrise_le
         return OPRT_COM_ERROR;
     }
 
-    const char* request_code = "\"w.sunrise\",\"w.sunset\",\"t.unix\",\"w.currdate\"";
+    const char* request_code = TW_CODE_SUNRISE_SUNSET_GMT;
 
     memset(&response, 0, sizeof(atop_base_response_t));
 
@@ -509,7 +752,7 @@ int tuya_weather_get_current_sunrise_sunset_local(char *sunrise, size_t sunrise_
         return OPRT_COM_ERROR;
     }
 
-    const char* request_code = "\"w.sunrise\",\"w.sunset\",\"t.local\",\"w.currdate\"";
+    const char* request_code = TW_CODE_SUNRISE_SUNSET_LOCAL;
 
     memset(&response, 0, sizeof(atop_base_response_t));
 
@@ -578,7 +821,7 @@ int tuya_weather_get_current_aqi(WEATHER_CURRENT_AQI_T *current_aqi)
         return OPRT_COM_ERROR;
     }
 
-    const char* request_code = "\"w.aqi\",\"w.qualityLevel\",\"w.pm25\",\"w.pm10\",\"w.o3\",\"w.no2\",\"w.co\",\"w.so2\",\"w.currdate\"";
+    const char* request_code = TW_CODE_CURRENT_AQI;
 
     memset(&response, 0, sizeof(atop_base_response_t));
 
@@ -672,7 +915,7 @@ int tuya_weather_get_current_aqi_cn(WEATHER_CURRENT_AQI_T *current_aqi)
         return OPRT_COM_ERROR;
     }
 
-    const char* request_code = "\"w.aqi\",\"w.rank\",\"w.qualityLevel\",\"w.pm25\",\"w.pm10\",\"w.o3\",\"w.no2\",\"w.co\",\"w.so2\",\"w.currdate\"";
+    const char* request_code = TW_CODE_CURRENT_AQI_CN;
 
     memset(&response, 0, sizeof(atop_base_response_t));
 
@@ -777,7 +1020,7 @@ int tuya_weather_get_forecast_conditions(int number, WEATHER_FORECAST_CONDITIONS
     }
 
     char request_code[80] = {0};
-    snprintf(request_code, sizeof(request_code), "\"w.conditionNum\",\"w.humidity\",\"w.temp\",\"w.uvi\",\"w.pressure\",\"w.date.%d\"", number);
+    snprintf(request_code, sizeof(request_code), TW_CODE_FORECAST_CONDITIONS ",\"w.date.%d\"", number);
 
     memset(&response, 0, sizeof(atop_base_response_t));
 
@@ -875,7 +1118,7 @@ int tuya_weather_get_forecast_conditions_cn(int number, int *weather, int *humi,
     }
 
     char request_code[80] = {0};
-    snprintf(request_code, sizeof(request_code), "\"w.conditionNum\",\"w.humidity\",\"w.uvi\",\"w.date.%d\"", number);
+    snprintf(request_code, sizeof(request_code), TW_CODE_FORECAST_CONDITIONS_CN ",\"w.date.%d\"", number);
 
     memset(&response, 0, sizeof(atop_base_response_t));
 
@@ -955,7 +1198,7 @@ int tuya_weather_get_forecast_wind(int number, char **wind_dir, char **wind_spee
     }
 
     char request_code[80] = {0};
-    snprintf(request_code, sizeof(request_code), "\"w.windDir\",\"w.windSpeed\",\"w.date.%d\"", number);
+    snprintf(request_code, sizeof(request_code), TW_CODE_FORECAST_WIND ",\"w.date.%d\"", number);
 
     memset(&response, 0, sizeof(atop_base_response_t));
 
@@ -1052,7 +1295,7 @@ int tuya_weather_get_forecast_high_low_temp(int number, int *high_temp, int *low
     }
 
     char request_code[80] = {0};
-    snprintf(request_code, sizeof(request_code), "\"w.thigh\",\"w.tlow\",\"w.date.%d\"", number);
+    snprintf(request_code, sizeof(request_code), TW_CODE_FORECAST_HIGH_LOW ",\"w.date.%d\"", number);
 
     memset(&response, 0, sizeof(atop_base_response_t));
 
@@ -1124,7 +1367,7 @@ int tuya_weather_get_city(char *province, size_t province_len, char *city, size_
         return OPRT_COM_ERROR;
     }
 
-    const char* request_code = "\"c.province\",\"c.city\",\"c.area\"";
+    const char* request_code = TW_CODE_CITY;
 
     memset(&response, 0, sizeof(atop_base_response_t));
 
@@ -1174,6 +1417,139 @@ int tuya_weather_get_city(char *province, size_t province_len, char *city, size_
     return rt;
 }
 
+/**
+ * @brief Sends one merged request of tuya_weather_prefetch(), the answer
+ *        lands in the cache.
+ *
+ * @param codes The request codes.
+ *
+ * @return The operation result status.
+ */
+static int tuya_weather_prefetch_codes(const char *codes)
+{
+    OPERATE_RET rt = OPRT_OK;
+    atop_base_response_t response;
+
+    memset(&response, 0, sizeof(atop_base_response_t));
+
+    rt = tuya_weather_get(codes, &response);
+    if (OPRT_OK != rt || !response.success) {
+        PR_ERR("tuya_weather_get prefetch error:%d", rt);
+        rt = OPRT_COM_ERROR;
+    }
+
+    atop_base_response_free(&response);
+
+    return rt;
+}
+
+/**
+ * @brief Fetches the data of several getters in as few cloud requests as possible.
+ *
+ * Current and forecast codes go in separate requests as the cloud keys the
+ * answers differently once "w.date.N" is asked for. "t.unix" and "t.local"
+ * change the format of the same sunrise and sunset keys, so the local ones
+ * get a request of their own when both are asked for.
+ *
+ * @param query TW_QUERY_* flags of the getters to be called.
+ * @param forecast_days The number of forecast days the forecast getters will
+ *                      ask for (1-7), ignored without forecast queries.
+ *
+ * @return The operation result status. Possible values are:
+ *         - OPRT_OK: Operation successful.
+ *         - OPRT_INVALID_PARM: Invalid number of days provided.
+ *         - OPRT_COM_ERROR: Communication error or update not allowed.
+ *         - Other error codes: Operation failed.
+ */
+int tuya_weather_prefetch(uint32_t query, int forecast_days)
+{
+    OPERATE_RET rt = OPRT_OK;
+    OPERATE_RET ret = OPRT_OK;
+    char *batch = NULL;
+    bool forecast = false;
+
+    for (int i = 0; i < (int)(sizeof(sg_weather_query) / sizeof(sg_weather_query[0])); i++) {
+        if ((query & sg_weather_query[i].query) && sg_weather_query[i].forecast &&
+            TW_QUERY_TODAY_HIGH_LOW != sg_weather_query[i].query) {
+            forecast = true;
+        }
+    }
+    if (forecast && (forecast_days < 1 || forecast_days > 7)) {
+        return OPRT_INVALID_PARM;
+    }
+    if (!forecast) {
+        forecast_days = 1;
+    }
+
+    if (!tuya_weather_allow_update()) {
+        return OPRT_COM_ERROR;
+    }
+
+    batch = tal_malloc(WEATHER_BATCH_LEN);
+    TUYA_CHECK_NULL_RETURN(batch, OPRT_MALLOC_FAILED);
+
+    // Current data, then forecast
+    for (int pass = 0; pass < 2; pass++) {
+        batch[0] = '\0';
+        for (int i = 0; i < (int)(sizeof(sg_weather_query) / sizeof(sg_weather_query[0])); i++) {
+            if ((query & sg_weather_query[i].query) && sg_weather_query[i].forecast == (pass == 1)) {
+                TUYA_CALL_ERR_GOTO(tuya_weather_codes_add(batch, WEATHER_BATCH_LEN, sg_weather_query[i].codes), __exit);
+            }
+        }
+        if (0 == pass && (query & TW_QUERY_SUNRISE_SUNSET_LOCAL) && !(query & TW_QUERY_SUNRISE_SUNSET_GMT)) {
+            TUYA_CALL_ERR_GOTO(tuya_weather_codes_add(batch, WEATHER_BATCH_LEN, TW_CODE_SUNRISE_SUNSET_LOCAL), __exit);
+        }
+        if ('\0' == batch[0]) {
+            continue;
+        }
+        if (1 == pass) {
+            char date[16];
+            snprintf(date, sizeof(date), "\"w.date.%d\"", forecast_days);
+            TUYA_CALL_ERR_GOTO(tuya_weather_codes_add(batch, WEATHER_BATCH_LEN, date), __exit);
+        }
+        ret = tuya_weather_prefetch_codes(batch);
+        if (OPRT_OK != ret) {
+            rt = ret;
+        }
+    }
+
+    if ((query & TW_QUERY_SUNRISE_SUNSET_LOCAL) && (query & TW_QUERY_SUNRISE_SUNSET_GMT)) {
+        ret = tuya_weather_prefetch_codes(TW_CODE_SUNRISE_SUNSET_LOCAL);
+        if (OPRT_OK != ret) {
+            rt = ret;
+        }
+    }
+
+__exit:
+    tal_free(batch);
+
+    return rt;
+}
+
+/**
+ * @brief Drops the cached cloud answers, the next getters request again.
+ *
+ * @return none
+ */
+void tuya_weather_cache_clear(void)
+{
+    if (NULL == sg_weather_mutex) {
+        return;
+    }
+
+    tal_mutex_lock(sg_weather_mutex);
+    for (int i = 0; i < WEATHER_CACHE_NUM; i++) {
+        if (sg_weather_cache[i].codes) {
+            tal_free(sg_weather_cache[i].codes);
+        }
+        if (sg_weather_cache[i].data) {
+            cJSON_Delete(sg_weather_cache[i].data);
+        }
+        memset(&sg_weather_cache[i], 0, sizeof(WEATHER_CACHE_T));
+    }
+    tal_mutex_unlock(sg_weather_mutex);
+}
+
 /******************************************************************************
  * PRIVATE MEMBER FUNCTIONS
  ******************************************************************************/
@@ -80,6 +80,26 @@
 // Wind direction code
 // https://developer.tuya.com/en/docs/mcu-standard-protocol/mcusdk-wifi-weather?id=Kd2fvzw7ny80s#title-15-Appendix%205%3A%20Wind%20direction%20code
 
+// Seconds a cloud answer serves the getters asking for the same codes
+#ifndef TUYA_WEATHER_CACHE_TTL_S
+#define TUYA_WEATHER_CACHE_TTL_S            (300)
+#endif
+
+// Queries of tuya_weather_prefetch(), one per getter
+#define TW_QUERY_CURRENT_CONDITIONS         (1 << 0)
+#define TW_QUERY_TODAY_HIGH_LOW             (1 << 1)
+#define TW_QUERY_CURRENT_WIND               (1 << 2)
+#define TW_QUERY_CURRENT_WIND_CN            (1 << 3)
+#define TW_QUERY_SUNRISE_SUNSET_GMT         (1 << 4)
+#define TW_QUERY_SUNRISE_SUNSET_LOCAL       (1 << 5)
+#define TW_QUERY_CURRENT_AQI                (1 << 6)
+#define TW_QUERY_CURRENT_AQI_CN             (1 << 7)
+#define TW_QUERY_CITY                       (1 << 8)
+#define TW_QUERY_FORECAST_CONDITIONS        (1 << 9)
+#define TW_QUERY_FORECAST_CONDITIONS_CN     (1 << 10)
+#define TW_QUERY_FORECAST_WIND              (1 << 11)
+#define TW_QUERY_FORECAST_HIGH_LOW          (1 << 12)
+
 /******************************************************************************
  * TYPEDEF
  ******************************************************************************/
@@ -367,6 +387,34 @@ int tuya_weather_get_forecast_high_low_temp(int number, int *high_temp, int *low
 int tuya_weather_get_city(char *province, size_t province_len, char *city, size_t city_len, char *area,
                           size_t area_len);
 
+/**
+ * @brief Fetches the data of several getters in as few cloud requests as possible.
+ *
+ * The codes of all the queries are merged into one request for the current
+ * data and one for the forecast, plus one for the local sunrise and sunset
+ * when the GMT ones are asked for too. The answers are cached for
+ * TUYA_WEATHER_CACHE_TTL_S seconds, the getters called afterwards with the
+ * same queries are served from the cache without a request.
+ *
+ * @param query TW_QUERY_* flags of the getters to be called.
+ * @param forecast_days The number of forecast days the forecast getters will
+ *                      ask for (1-7), ignored without forecast queries.
+ *
+ * @return The operation result status. Possible values are:
+ *         - OPRT_OK: Operation successful.
+ *         - OPRT_INVALID_PARM: Invalid number of days provided.
+ *         - OPRT_COM_ERROR: Communication error or update not allowed.
+ *         - Other error codes: Operation failed.
+ */
+int tuya_weather_prefetch(uint32_t query, int forecast_days);
+
+/**
+ * @brief Drops the cached cloud answers, the next getters request again.
+ *
+ * @return none
+ */
+void tuya_weather_cache_clear(void);
+
 /**
  * @brief Checks if weather data update is allowed.
  *
@@ -165,6 +165,22 @@ typedef struct {
     tuya_p2p_rtc_frame_type_e frame_type;
 } tuya_p2p_rtc_frame_t;
 
+// One buffer of a batch send
+typedef struct {
+    char *buf;
+    int32_t len;
+} tuya_p2p_rtc_iov_t;
+
+// Send side state of a channel, the feedback the peer gives through KCP acks
+typedef struct {
+    uint32_t srtt_ms;  // Smoothed round trip time
+    uint32_t rto_ms;   // Retransmission timeout
+    uint32_t wait_snd; // Segments queued or in flight
+    uint32_t snd_wnd;  // Send window, in segments
+    uint32_t mss;      // Payload bytes of a segment
+    uint32_t xmit;     // Timeout retransmissions since the channel was created
+} tuya_p2p_rtc_send_stat_t;
+
 typedef enum rtc_state {
     RTC_STATE_GET_TOKEN,
     RTC_STATE_P2P_CONNECT,
@@ -401,6 +417,18 @@ int32_t tuya_p2p_rtc_recv_frame(int32_t handle, tuya_p2p_rtc_frame_t *frame);
 // TUYA_P2P_ERROR_TIME_OUT: send timeout
 // others: send failed, and connection has been disconnected
 int32_t tuya_p2p_rtc_send_data(int32_t handle, uint32_t channel_id, char *buf, int32_t len, int32_t timeout_ms);
+// Send a train of buffers to the other party in one go, such as all RTP packets of a frame
+// handle: connection handle
+// channel_id: channel number
+// iov: buffers to be sent, in order, each one is queued as tuya_p2p_rtc_send_data would
+// cnt: number of buffers
+// timeout_ms: interface blocking time of each buffer, in milliseconds
+// return value
+// >=0: number of buffers sent completely, the train stops at the first one that is not
+// TUYA_P2P_ERROR_TIME_OUT: send timeout
+// others: send failed, and connection has been disconnected
+int32_t tuya_p2p_rtc_send_data_batch(int32_t handle, uint32_t channel_id, const tuya_p2p_rtc_iov_t *iov, int32_t cnt,
+                                     int32_t timeout_ms);
 // Receive data
 // handle: connection handle
 // channel_id: channel number
@@ -426,6 +454,12 @@ int32_t tuya_p2p_rtc_check_buffer(int32_t handle, uint32_t channel_id, uint32_t
 // Mainly used for low-power devices
 int32_t tuya_p2p_rtc_set_remote_online(char *remote_id);
 int32_t tuya_p2p_getwaitsnd(int32_t handle, uint32_t channel_id);
+// Get the send side state of a channel
+// handle: connection handle
+// channel_id: channel number
+// stat: after function returns, updated to the channel state
+// return value: 0 success, others the session is gone
+int32_t tuya_p2p_rtc_get_send_stat(int32_t handle, uint32_t channel_id, tuya_p2p_rtc_send_stat_t *stat);
 int32_t tuya_p2p_log_set_level(tuya_p2p_rtc_log_level_e level);
 
 #ifdef __cplusplus
@@ -289,6 +289,7 @@ ikcpcb *ikcp_create(IUINT32 conv, void *user)
     kcp->ssthresh = IKCP_THRESH_INIT;
     kcp->fastresend = 0;
     kcp->fastlimit = IKCP_FASTACK_LIMIT;
+    kcp->pacing = 0;
     kcp->nocwnd = 0;
     kcp->xmit = 0;
     kcp->dead_link = IKCP_DEADLINK;
@@ -995,6 +996,7 @@ void ikcp_flush(ikcpcb *kcp)
     struct IQUEUEHEAD *p;
     int change = 0;
     int lost = 0;
+    int paced = 0;
     IKCPSEG seg;
 
     // 'ikcp_update' haven't been called.
@@ -1080,6 +1082,9 @@ void ikcp_flush(ikcpcb *kcp)
         IKCPSEG *newseg;
         if (iqueue_is_empty(&kcp->snd_queue))
             break;
+        if (kcp->pacing > 0 && paced >= kcp->pacing)
+            break;
+        paced++;
 
         newseg = iqueue_entry(kcp->snd_queue.next, IKCPSEG, node);
 
@@ -1324,6 +1329,14 @@ int ikcp_nodelay(ikcpcb *kcp, int nodelay, int interval, int resend, int nc)
     return 0;
 }
 
+int ikcp_setpacing(ikcpcb *kcp, int segs)
+{
+    if (segs < 0)
+        return -1;
+    kcp->pacing = segs;
+    return 0;
+}
+
 int ikcp_wndsize(ikcpcb *kcp, int sndwnd, int rcvwnd)
 {
     if (kcp) {
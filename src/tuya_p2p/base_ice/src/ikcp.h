@@ -298,6 +298,7 @@ struct IKCPCB {
     char *buffer;
     int fastresend;
     int fastlimit;
+    int pacing;
     int nocwnd, stream;
     int logmask;
     int (*output)(const char *buf, int len, struct IKCPCB *kcp, void *user);
@@ -385,6 +386,11 @@ int ikcp_waitsnd(const ikcpcb *kcp);
 // nc: 0:normal congestion control(default), 1:disable congestion control
 int ikcp_nodelay(ikcpcb *kcp, int nodelay, int interval, int resend, int nc);
 
+// limit the new segments a flush puts on the wire, so a large message
+// leaves over several update intervals instead of one burst
+// segs: 0:unlimited(default), >0:new segments per flush
+int ikcp_setpacing(ikcpcb *kcp, int segs);
+
 void ikcp_log(ikcpcb *kcp, int mask, const char *fmt, ...);
 
 // setup allocator
@@ -370,7 +370,6 @@ bool pj_ice_session_create(pj_ice_session_cfg_t *pCfg, pj_ice_session_t **ppIceS
 bool pj_ice_session_destroy(pj_ice_session_t *pIceSession)
 {
     pj_status_t status = PJ_SUCCESS;
-    g_bInited = false;
 
     pj_thread_register2();
     pIceSession->pIceThreadParam->bThreadQuitFlag = true;
@@ -379,29 +378,29 @@ bool pj_ice_session_destroy(pj_ice_session_t *pIceSession)
         pj_thread_destroy(pIceSession->pThread);
         pIceSession->pThread = NULL;
     }
-    pj_pool_release(pIceSession->pPool);
     free(pIceSession->pIceThreadParam);
     pIceSession->pIceThreadParam = NULL;
 
+    /* The transport lives on the timer heap and ioqueue of the pool, stop it before the pool goes */
     pj_ice_strans *ice_st = pIceSession->pIceSTransport;
-    if (ice_st == NULL) {
-        PJ_LOG(1, (THIS_FILE, "Error: No ICE instance, create it first"));
-        return false;
-    }
-
-    if (!pj_ice_strans_has_sess(ice_st)) {
-        PJ_LOG(1, (THIS_FILE, "Error: No ICE session, initialize first"));
-        return false;
+    if (ice_st != NULL) {
+        g_bInited = false;
+        if (pj_ice_strans_has_sess(ice_st)) {
+            status = pj_ice_strans_stop_ice(ice_st);
+            if (status != PJ_SUCCESS) {
+                pj_print_error("error stopping session", status);
+            } else {
+                PJ_LOG(3, (THIS_FILE, "ICE session stopped"));
+            }
+        }
+        pj_ice_strans_destroy(ice_st);
+        pIceSession->pIceSTransport = NULL;
     }
 
-    status = pj_ice_strans_stop_ice(ice_st);
-    if (status != PJ_SUCCESS) {
-        pj_print_error("error stopping session", status);
-        return false;
-    } else {
-        PJ_LOG(3, (THIS_FILE, "ICE session stopped"));
-        return true;
-    }
+    pj_pool_release(pIceSession->pPool);
+    pj_caching_pool_destroy(&pIceSession->cachePool);
+    free(pIceSession);
+    return (status == PJ_SUCCESS);
 }
 
 bool pj_ice_session_init(pj_ice_session_t *pIceSession, pj_ice_session_cfg_t *pCfg)
@@ -570,6 +569,9 @@ bool pj_ice_session_sendto(pj_ice_session_t *pIceSession, void *pkt, uint32_t le
     char szRCandAddr[PJ_INET6_ADDRSTRLEN + 10] = {0};
     unsigned comp_id = 1; // Component starts with ID 1
     const pj_ice_sess_check *pIceSessCheck = pj_ice_strans_get_valid_pair(ice_st, comp_id);
+    if (pIceSessCheck == NULL) {
+        return false;
+    }
     pj_sockaddr_print(&pIceSessCheck->lcand->addr, szLCandAddr, sizeof(szLCandAddr), 3);
     pj_sockaddr_print(&pIceSessCheck->rcand->addr, szRCandAddr, sizeof(szRCandAddr), 3);
     status = pj_ice_strans_sendto2(ice_st, comp_id, pkt, len, &pIceSessCheck->rcand->addr,
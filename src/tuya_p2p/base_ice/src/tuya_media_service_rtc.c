@@ -53,6 +53,11 @@
 
 #define P2P_DEFAULT_FRAGEMENT_LEN 1300
 
+// New KCP segments sent per update interval (10ms), spreads a keyframe over several intervals
+#ifndef TUYA_P2P_RTC_PACE_SEGS
+#define TUYA_P2P_RTC_PACE_SEGS 16
+#endif
+
 typedef enum rtc_session_close_reason {
     RTC_SESSION_CLOSE_REASON_OK = 0,
     RTC_SESSION_CLOSE_REASON_ICE_FAILED = 1,
@@ -1496,6 +1501,7 @@ int tuya_p2p_rtc_channels_init(tuya_p2p_rtc_session_t *rtc)
                      recv_buf_size / 1600 /*TUYA_MBUF_HUGE_SIZE*/);
         ikcp_nodelay(chan->kcp, 0, 10, 20, 1);
         ikcp_setmtu(chan->kcp, 1400);
+        ikcp_setpacing(chan->kcp, TUYA_P2P_RTC_PACE_SEGS);
         ikcp_setprocesspkt(chan->kcp, ctx_session_channel_process_pkt);
         // ikcp_setwritelog(chan->kcp, ctx_session_kcp_writelog);
         // ikcp_setlogmask(chan->kcp, IKCP_LOG_RTT | IKCP_LOG_INPUT | IKCP_LOG_OUTPUT);
@@ -1696,6 +1702,32 @@ int32_t tuya_p2p_rtc_send_data(int32_t handle, uint32_t channel_id, char *buf, i
     return ret;
 }
 
+int32_t tuya_p2p_rtc_send_data_batch(int32_t handle, uint32_t channel_id, const tuya_p2p_rtc_iov_t *iov, int32_t cnt,
+                                     int32_t timeout_ms)
+{
+    tal_mutex_lock(g_p2p_session_mutex);
+    tuya_p2p_rtc_session_t *rtc = g_pRtcSession;
+    if (rtc == NULL) {
+        tal_mutex_unlock(g_p2p_session_mutex);
+        tuya_p2p_log_error("rtc session %08x send batch: invalid session\n", handle);
+        return TUYA_P2P_ERROR_INVALID_SESSION_HANDLE;
+    }
+    // The session is looked up once for the whole train, KCP pacing spreads it on the wire
+    int32_t sent = 0;
+    int32_t ret = 0;
+    for (; sent < cnt; sent++) {
+        ret = tuya_p2p_rtc_dosend_data(rtc, channel_id, iov[sent].buf, iov[sent].len, timeout_ms);
+        if (ret != iov[sent].len) {
+            break;
+        }
+    }
+    tal_mutex_unlock(g_p2p_session_mutex);
+    if (sent == 0 && cnt > 0 && ret < 0) {
+        return ret;
+    }
+    return sent;
+}
+
 int32_t tuya_p2p_rtc_dorecv_data(tuya_p2p_rtc_session_t *rtc, uint32_t channel_id, char *buf, int32_t *len,
                                  int32_t timeout_ms)
 {
@@ -1878,6 +1910,35 @@ int32_t tuya_p2p_rtc_check_buffer(int32_t handle, uint32_t channel_id, uint32_t
     return ret;
 }
 
+int32_t tuya_p2p_rtc_get_send_stat(int32_t handle, uint32_t channel_id, tuya_p2p_rtc_send_stat_t *stat)
+{
+    int ret = 0;
+    if (stat == NULL) {
+        return TUYA_P2P_ERROR_INVALID_PARAMETER;
+    }
+    tal_mutex_lock(g_p2p_session_mutex);
+    if (g_pRtcSession == NULL) {
+        tal_mutex_unlock(g_p2p_session_mutex);
+        return TUYA_P2P_ERROR_INVALID_SESSION_HANDLE;
+    }
+    tuya_p2p_rtc_session_t *rtc = g_pRtcSession;
+    pthread_mutex_lock(&rtc->channel_lock);
+    if (rtc->channels != NULL && channel_id <= rtc->cfg.channel_number && rtc->channels[channel_id].kcp != NULL) {
+        ikcpcb *kcp = rtc->channels[channel_id].kcp;
+        stat->srtt_ms = (uint32_t)kcp->rx_srtt;
+        stat->rto_ms = (uint32_t)kcp->rx_rto;
+        stat->wait_snd = (uint32_t)ikcp_waitsnd(kcp);
+        stat->snd_wnd = kcp->snd_wnd;
+        stat->mss = kcp->mss;
+        stat->xmit = kcp->xmit;
+    } else {
+        ret = TUYA_P2P_ERROR_INVALID_SESSION_HANDLE;
+    }
+    pthread_mutex_unlock(&rtc->channel_lock);
+    tal_mutex_unlock(g_p2p_session_mutex);
+    return ret;
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////
 
 int rtc_init_mbedtls_md_and_aes(tuya_p2p_rtc_session_t *rtc)
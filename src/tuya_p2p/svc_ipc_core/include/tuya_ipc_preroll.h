@@ -0,0 +1,90 @@
+/**
+ * @file      tuya_ipc_preroll.h
+ * @brief     tuya ipc encoded frame pre-roll
+ *
+ * The app pushes every encoded video and audio frame, with or without a
+ * viewer. The last seconds are kept from a key frame on, so a viewer that
+ * connects after a doorbell press starts with the frames from before the
+ * press and its first frame is a key frame. The P2P send thread reads the
+ * buffer as fast as the link takes it until it catches up with the live
+ * edge, then frame by frame.
+ *
+ * copyright  Copyright (c) tuya.inc 2021
+ */
+#ifndef __TUYA_IPC_PREROLL_H__
+#define __TUYA_IPC_PREROLL_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "tuya_cloud_types.h"
+#include "tuya_ipc_p2p.h"
+
+#ifndef TUYA_IPC_PREROLL_SECONDS
+#define TUYA_IPC_PREROLL_SECONDS 3 // Default seconds kept before the live edge
+#endif
+#ifndef TUYA_IPC_PREROLL_BUFFER_SIZE
+#define TUYA_IPC_PREROLL_BUFFER_SIZE (512 * 1024) // Default buffer, PSRAM when ENABLE_EXT_RAM
+#endif
+#ifndef TUYA_IPC_PREROLL_GOP_MAX
+#define TUYA_IPC_PREROLL_GOP_MAX 16 // Key frames tracked in the buffer
+#endif
+
+/**
+ * @struct TUYA_IPC_PREROLL_CFG_T
+ * @brief pre-roll configuration, 0 takes the default
+ */
+typedef struct {
+    UINT_T seconds;     // Seconds kept before the live edge, rounded to whole GOPs
+    UINT_T buffer_size; // Bytes of frames and their headers
+} TUYA_IPC_PREROLL_CFG_T;
+
+/**
+ * @brief Allocate the pre-roll buffer
+ *
+ * @param[in] cfg configuration, NULL for the defaults
+ *
+ * @return OPRT_OK on success. Others on error, please refer to tuya_error_code.h
+ */
+OPERATE_RET tuya_ipc_preroll_init(CONST TUYA_IPC_PREROLL_CFG_T *cfg);
+
+/**
+ * @brief Free the pre-roll buffer
+ *
+ * @return none
+ */
+VOID tuya_ipc_preroll_deinit(VOID);
+
+/**
+ * @brief Push an encoded frame, frames before the first key frame are dropped
+ *
+ * @param[in] frame video or audio frame
+ *
+ * @return OPRT_OK on success. Others on error, please refer to tuya_error_code.h
+ */
+OPERATE_RET tuya_ipc_preroll_put(CONST MEDIA_FRAME *frame);
+
+/**
+ * @brief Read the next frame of one kind
+ *
+ * @param[in] audio TRUE for audio frames, FALSE for video frames
+ * @param[out] frame filled in, data must hold max bytes
+ * @param[in] max room at frame->data
+ *
+ * @return OPRT_OK on success, OPRT_RESOURCE_NOT_READY once caught up with the live edge
+ */
+OPERATE_RET tuya_ipc_preroll_get(BOOL_T audio, MEDIA_FRAME *frame, UINT_T max);
+
+/**
+ * @brief Start the next reads at the oldest key frame buffered, for a new viewer
+ *
+ * @return none
+ */
+VOID tuya_ipc_preroll_rewind(VOID);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TUYA_IPC_PREROLL_H__ */
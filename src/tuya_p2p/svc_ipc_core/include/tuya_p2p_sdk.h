@@ -28,6 +28,10 @@ typedef struct tagTuyaIpcSdkVar {
     INT_T (*OnSignalDisconnectCallback)();
     INT_T (*OnGetVideoFrameCallback)(MEDIA_FRAME *pMediaFrame);
     INT_T (*OnGetAudioFrameCallback)(MEDIA_FRAME *pMediaFrame);
+    // Non-zero keeps that many seconds of the frames pushed with tuya_ipc_preroll_put(), viewers are
+    // served from them and the two get callbacks are not used
+    UINT_T preroll_seconds;
+    UINT_T preroll_size; // Pre-roll buffer bytes, 0 for TUYA_IPC_PREROLL_BUFFER_SIZE
 } TUYA_IPC_SDK_VAR_S;
 
 OPERATE_RET TUYA_APP_Start(TUYA_IPC_SDK_VAR_S *pSdkVar);
@@ -0,0 +1,266 @@
+/**
+ * @file      tuya_ipc_preroll.c
+ * @brief     tuya ipc encoded frame pre-roll
+ *
+ * Frames are records in a byte ring addressed by ever growing positions, a
+ * record that would not fit before the end of the ring starts over at its
+ * beginning. The oldest record is always a video key frame: room is made a
+ * whole GOP at a time, up to the key frame after it.
+ *
+ * copyright  Copyright (c) tuya.inc 2021
+ */
+#include <string.h>
+#include "tal_log.h"
+#include "tal_memory.h"
+#include "tal_mutex.h"
+#include "tuya_ipc_preroll.h"
+
+#define PREROLL_REC_PAD  0xFF // Rest of the ring up to its end is unused
+#define PREROLL_ALIGN(n) (((n) + 7) & ~7)
+
+typedef struct {
+    UINT_T len;     // Data bytes following the record
+    UCHAR_T type;   // MEDIA_FRAME_TYPE or PREROLL_REC_PAD
+    UCHAR_T rsv[3];
+    UINT64_T pts;
+    UINT64_T timestamp;
+} PREROLL_REC_T;
+
+typedef struct {
+    UINT64_T pos;
+    UINT64_T timestamp;
+} PREROLL_KEY_T;
+
+typedef struct {
+    MUTEX_HANDLE mutex;
+    UCHAR_T *buf;
+    UINT_T size;
+    UINT_T keep_ms;
+    UINT64_T head;  // Oldest record, a video key frame
+    UINT64_T tail;  // Next record
+    UINT64_T rd[2]; // Next read of the video and the audio reader
+    PREROLL_KEY_T key[TUYA_IPC_PREROLL_GOP_MAX];
+    UINT_T key_first;
+    UINT_T key_cnt;
+} PREROLL_T;
+
+STATIC PREROLL_T *sg_preroll = NULL;
+
+STATIC VOID *__preroll_malloc(UINT_T size)
+{
+#if defined(ENABLE_EXT_RAM) && (ENABLE_EXT_RAM == 1)
+    return tal_psram_malloc_tag(size, "preroll");
+#else
+    return tal_malloc(size);
+#endif
+}
+
+STATIC VOID __preroll_free(VOID *ptr)
+{
+#if defined(ENABLE_EXT_RAM) && (ENABLE_EXT_RAM == 1)
+    tal_psram_free(ptr);
+#else
+    tal_free(ptr);
+#endif
+}
+
+STATIC UINT64_T __preroll_skip_pad(PREROLL_T *pr, UINT64_T pos)
+{
+    UINT_T phys = (UINT_T)(pos % pr->size);
+    if (pr->size - phys < sizeof(PREROLL_REC_T) || PREROLL_REC_PAD == ((PREROLL_REC_T *)(pr->buf + phys))->type) {
+        return pos + (pr->size - phys);
+    }
+    return pos;
+}
+
+STATIC VOID __preroll_drop_to(PREROLL_T *pr, UINT64_T pos)
+{
+    pr->head = pos;
+    for (INT_T i = 0; i < 2; i++) {
+        if (pr->rd[i] < pr->head) {
+            pr->rd[i] = pr->head;
+        }
+    }
+}
+
+// Drop the oldest GOP, FALSE when it is the only one
+STATIC BOOL_T __preroll_drop_gop(PREROLL_T *pr)
+{
+    if (pr->key_cnt < 2) {
+        return FALSE;
+    }
+    pr->key_first = (pr->key_first + 1) % TUYA_IPC_PREROLL_GOP_MAX;
+    pr->key_cnt--;
+    __preroll_drop_to(pr, pr->key[pr->key_first].pos);
+    return TRUE;
+}
+
+STATIC VOID __preroll_reset(PREROLL_T *pr)
+{
+    pr->key_cnt = 0;
+    __preroll_drop_to(pr, pr->tail);
+}
+
+OPERATE_RET tuya_ipc_preroll_init(CONST TUYA_IPC_PREROLL_CFG_T *cfg)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    if (sg_preroll) {
+        return OPRT_OK;
+    }
+
+    UINT_T seconds = (cfg && cfg->seconds) ? cfg->seconds : TUYA_IPC_PREROLL_SECONDS;
+    UINT_T size = (cfg && cfg->buffer_size) ? cfg->buffer_size : TUYA_IPC_PREROLL_BUFFER_SIZE;
+
+    PREROLL_T *pr = (PREROLL_T *)tal_malloc(sizeof(PREROLL_T));
+    TUYA_CHECK_NULL_RETURN(pr, OPRT_MALLOC_FAILED);
+    memset(pr, 0, sizeof(PREROLL_T));
+    pr->size = PREROLL_ALIGN(size);
+    pr->keep_ms = seconds * 1000;
+    pr->buf = (UCHAR_T *)__preroll_malloc(pr->size);
+    if (NULL == pr->buf) {
+        PR_ERR("preroll buffer %u malloc failed", pr->size);
+        tal_free(pr);
+        return OPRT_MALLOC_FAILED;
+    }
+    rt = tal_mutex_create_init(&pr->mutex);
+    if (OPRT_OK != rt) {
+        __preroll_free(pr->buf);
+        tal_free(pr);
+        return rt;
+    }
+
+    sg_preroll = pr;
+    PR_DEBUG("preroll %u s in %u bytes", seconds, pr->size);
+    return OPRT_OK;
+}
+
+VOID tuya_ipc_preroll_deinit(VOID)
+{
+    PREROLL_T *pr = sg_preroll;
+    if (NULL == pr) {
+        return;
+    }
+    sg_preroll = NULL;
+    tal_mutex_release(pr->mutex);
+    __preroll_free(pr->buf);
+    tal_free(pr);
+}
+
+OPERATE_RET tuya_ipc_preroll_put(CONST MEDIA_FRAME *frame)
+{
+    PREROLL_T *pr = sg_preroll;
+    TUYA_CHECK_NULL_RETURN(pr, OPRT_RESOURCE_NOT_READY);
+    TUYA_CHECK_NULL_RETURN(frame, OPRT_INVALID_PARM);
+
+    BOOL_T key = (eVideoIFrame == frame->type) ? TRUE : FALSE;
+    UINT_T need = sizeof(PREROLL_REC_T) + PREROLL_ALIGN(frame->size);
+    if (need > pr->size / 2) {
+        PR_WARN("preroll frame %u too big", frame->size);
+        return OPRT_EXCEED_UPPER_LIMIT;
+    }
+
+    tal_mutex_lock(pr->mutex);
+
+    // Nothing before the first key frame could be decoded
+    if (pr->head == pr->tail && !key) {
+        tal_mutex_unlock(pr->mutex);
+        return OPRT_OK;
+    }
+
+    UINT_T phys = (UINT_T)(pr->tail % pr->size);
+    UINT_T pad = (pr->size - phys < need) ? pr->size - phys : 0;
+    while (pr->tail + pad + need - pr->head > pr->size) {
+        if (!__preroll_drop_gop(pr)) {
+            // The GOP alone outgrew the buffer, start over at the next key frame
+            __preroll_reset(pr);
+            if (!key) {
+                tal_mutex_unlock(pr->mutex);
+                return OPRT_OK;
+            }
+        }
+    }
+    if (key && TUYA_IPC_PREROLL_GOP_MAX == pr->key_cnt) {
+        __preroll_drop_gop(pr);
+    }
+
+    if (pad >= sizeof(PREROLL_REC_T)) {
+        ((PREROLL_REC_T *)(pr->buf + phys))->type = PREROLL_REC_PAD;
+    }
+    pr->tail += pad;
+
+    PREROLL_REC_T *rec = (PREROLL_REC_T *)(pr->buf + (pr->tail % pr->size));
+    rec->len = frame->size;
+    rec->type = (UCHAR_T)frame->type;
+    rec->pts = frame->pts;
+    rec->timestamp = frame->timestamp;
+    memcpy((UCHAR_T *)(rec + 1), frame->data, frame->size);
+
+    if (key) {
+        UINT_T idx = (pr->key_first + pr->key_cnt) % TUYA_IPC_PREROLL_GOP_MAX;
+        pr->key[idx].pos = pr->tail;
+        pr->key[idx].timestamp = frame->timestamp;
+        pr->key_cnt++;
+    }
+    pr->tail += need;
+
+    // Keep only the GOPs needed to reach back keep_ms
+    while (pr->key_cnt >= 2) {
+        PREROLL_KEY_T *next = &pr->key[(pr->key_first + 1) % TUYA_IPC_PREROLL_GOP_MAX];
+        if (next->timestamp + pr->keep_ms > frame->timestamp) {
+            break;
+        }
+        __preroll_drop_gop(pr);
+    }
+
+    tal_mutex_unlock(pr->mutex);
+    return OPRT_OK;
+}
+
+OPERATE_RET tuya_ipc_preroll_get(BOOL_T audio, MEDIA_FRAME *frame, UINT_T max)
+{
+    OPERATE_RET rt = OPRT_RESOURCE_NOT_READY;
+    PREROLL_T *pr = sg_preroll;
+    TUYA_CHECK_NULL_RETURN(pr, OPRT_RESOURCE_NOT_READY);
+    TUYA_CHECK_NULL_RETURN(frame, OPRT_INVALID_PARM);
+
+    tal_mutex_lock(pr->mutex);
+    UINT64_T *rd = &pr->rd[audio ? 1 : 0];
+    if (*rd < pr->head) {
+        *rd = pr->head;
+    }
+    while (*rd < pr->tail) {
+        UINT64_T pos = __preroll_skip_pad(pr, *rd);
+        PREROLL_REC_T *rec = (PREROLL_REC_T *)(pr->buf + (pos % pr->size));
+        *rd = pos + sizeof(PREROLL_REC_T) + PREROLL_ALIGN(rec->len);
+        if ((eAudioFrame == rec->type) != (audio ? TRUE : FALSE)) {
+            continue;
+        }
+        if (rec->len > max) {
+            PR_WARN("preroll frame %u over %u skipped", rec->len, max);
+            continue;
+        }
+        memcpy(frame->data, (UCHAR_T *)(rec + 1), rec->len);
+        frame->size = rec->len;
+        frame->type = (MEDIA_FRAME_TYPE)rec->type;
+        frame->pts = rec->pts;
+        frame->timestamp = rec->timestamp;
+        rt = OPRT_OK;
+        break;
+    }
+    tal_mutex_unlock(pr->mutex);
+
+    return rt;
+}
+
+VOID tuya_ipc_preroll_rewind(VOID)
+{
+    PREROLL_T *pr = sg_preroll;
+    if (NULL == pr) {
+        return;
+    }
+    tal_mutex_lock(pr->mutex);
+    pr->rd[0] = pr->head;
+    pr->rd[1] = pr->head;
+    tal_mutex_unlock(pr->mutex);
+}
@@ -7,6 +7,7 @@
 #include "tuya_error_code.h"
 #include "tuya_iot.h"
 #include "tuya_ipc_skill.h"
+#include "tuya_ipc_preroll.h"
 #include "tuya_media_service_rtc.h"
 #include "tuya_ipc_media_stream.h"
 #include "tuya_ipc_media_stream_common.h"
@@ -14,6 +15,10 @@
 #define PRE_TOPIC     "smart/device/in/"
 #define MQ_SERV_TOPIC "smart/device/out/"
 
+// Frame buffers the P2P session hands to the get callbacks
+#define PREROLL_VIDEO_FRAME_MAX (300 * 1024)
+#define PREROLL_AUDIO_FRAME_MAX 1280
+
 VOID tuya_ipc_upload_skills(VOID);
 OPERATE_RET gw_active_set_ext_param(IN CHAR_T *param);
 CHAR_T *gw_active_get_ext_param(VOID);
@@ -21,6 +26,25 @@ OPERATE_RET httpc_gw_active(IN CONST GW_ACTV_IN_PARM_V41_S *param, OUT cJSON **r
 OPERATE_RET __p2p_v3_login_init(INT_T preconnect, INT_T max_client, INT_T bitrate);
 VOID tuya_p2p_rtc_signaling_cb(CHAR_T *remote_id, CHAR_T *signaling, UINT_T len);
 
+STATIC INT_T (*s_app_disconnect_cb)() = NULL;
+
+STATIC INT_T __preroll_get_video_frame(MEDIA_FRAME *pMediaFrame)
+{
+    return tuya_ipc_preroll_get(FALSE, pMediaFrame, PREROLL_VIDEO_FRAME_MAX);
+}
+
+STATIC INT_T __preroll_get_audio_frame(MEDIA_FRAME *pMediaFrame)
+{
+    return tuya_ipc_preroll_get(TRUE, pMediaFrame, PREROLL_AUDIO_FRAME_MAX);
+}
+
+// The next viewer starts from the pre-roll again
+STATIC INT_T __preroll_on_disconnect()
+{
+    tuya_ipc_preroll_rewind();
+    return s_app_disconnect_cb ? s_app_disconnect_cb() : 0;
+}
+
 OPERATE_RET TUYA_APP_Start(TUYA_IPC_SDK_VAR_S *pSdkVar)
 {
     OPERATE_RET ret = OPRT_OK;
@@ -58,6 +82,18 @@ OPERATE_RET TUYA_APP_Start(TUYA_IPC_SDK_VAR_S *pSdkVar)
     if (var.recv_buffer_size == 0) {
         var.recv_buffer_size = 16 * 1024;
     }
+    if (pSdkVar->preroll_seconds) {
+        TUYA_IPC_PREROLL_CFG_T preroll = {.seconds = pSdkVar->preroll_seconds, .buffer_size = pSdkVar->preroll_size};
+        ret = tuya_ipc_preroll_init(&preroll);
+        if (OPRT_OK != ret) {
+            PR_ERR("tuya_ipc_preroll_init failed %d\n", ret);
+            return ret;
+        }
+        s_app_disconnect_cb = pSdkVar->OnSignalDisconnectCallback;
+        var.on_disconnect_callback = __preroll_on_disconnect;
+        var.on_get_video_frame_callback = __preroll_get_video_frame;
+        var.on_get_audio_frame_callback = __preroll_get_audio_frame;
+    }
     ret = p2p_init(&var);
     if (OPRT_OK != ret) {
         PR_ERR("tuya_ipc_p2p_init failed \n");
@@ -41,6 +41,7 @@ typedef struct tagMediaFrame {
 
 typedef INT_T (*tuya_p2p_rtc_disconnect_cb_t)();
 typedef INT_T (*tuya_p2p_rtc_get_frame_cb_t)(MEDIA_FRAME *pMediaFrame);
+typedef VOID (*tuya_p2p_rtc_bitrate_cb_t)(UINT_T kbps); // Steer the video encoder to kbps
 
 /**
  * @enum TRANS_DEFAULT_QUALITY_E
@@ -75,6 +76,7 @@ OPERATE_RET p2p_rtc_listen_stop();
 // OPERATE_RET tuya_ipc_init_trans_av_info(TRANS_IPC_AV_INFO_T *av_info);
 OPERATE_RET tuya_p2p_rtc_register_get_video_frame_cb(tuya_p2p_rtc_get_frame_cb_t pCallback);
 OPERATE_RET tuya_p2p_rtc_register_get_audio_frame_cb(tuya_p2p_rtc_get_frame_cb_t pCallback);
+OPERATE_RET tuya_p2p_rtc_register_video_bitrate_cb(tuya_p2p_rtc_bitrate_cb_t pCallback);
 INT_T OnGetVideoFrameCallback(MEDIA_FRAME *pMediaFrame);
 INT_T OnGetAudioFrameCallback(MEDIA_FRAME *pMediaFrame);
 
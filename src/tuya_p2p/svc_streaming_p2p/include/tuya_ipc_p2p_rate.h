@@ -0,0 +1,141 @@
+/**
+ * @file tuya_ipc_p2p_rate.h
+ * @brief Send side rate control of the P2P video stream
+ *
+ * The peer answers the data channels with KCP acks only, so congestion is
+ * read from the channel state: the backlog drained at the target rate, the
+ * rise of the smoothed RTT over its floor and timeout retransmissions. The
+ * target bitrate backs off multiplicatively on congestion and climbs
+ * additively once the link stayed clear. Under backlog non-reference frames
+ * go first, reference frames only when the backlog gets deep, and then the
+ * rest of the GOP with them.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ */
+
+#ifndef __TUYA_IPC_P2P_RATE_H__
+#define __TUYA_IPC_P2P_RATE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "tuya_cloud_types.h"
+#include "tuya_common_types.h"
+#include "tuya_media_service_rtc.h"
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+#ifndef P2P_RATE_INTERVAL_MS
+#define P2P_RATE_INTERVAL_MS 500 // Bitrate decision period
+#endif
+#ifndef P2P_RATE_HOLD_MS
+#define P2P_RATE_HOLD_MS 2000 // Clear time after a decrease before climbing again
+#endif
+#ifndef P2P_RATE_QUEUE_HIGH_MS
+#define P2P_RATE_QUEUE_HIGH_MS 200 // Backlog the link is congested at
+#endif
+#ifndef P2P_RATE_QUEUE_LOW_MS
+#define P2P_RATE_QUEUE_LOW_MS 50 // Backlog the link may take more at
+#endif
+#ifndef P2P_RATE_RTT_RISE_MS
+#define P2P_RATE_RTT_RISE_MS 150 // RTT rise over the floor the link is congested at
+#endif
+#ifndef P2P_RATE_DROP_NONREF_MS
+#define P2P_RATE_DROP_NONREF_MS 100 // Backlog non-reference frames are dropped at
+#endif
+#ifndef P2P_RATE_DROP_REF_MS
+#define P2P_RATE_DROP_REF_MS 600 // Backlog the GOP is given up at until the next key frame
+#endif
+#ifndef P2P_RATE_MIN_PERCENT
+#define P2P_RATE_MIN_PERCENT 15 // Lowest target, percent of the stream bitrate
+#endif
+#ifndef P2P_RATE_DEFAULT_KBPS
+#define P2P_RATE_DEFAULT_KBPS 2048 // Stream bitrate when the AV info has none
+#endif
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef enum {
+    P2P_RATE_SEND = 0,
+    P2P_RATE_DROP,
+} P2P_RATE_ACTION_E;
+
+typedef struct {
+    UINT_T max_kbps;       // Stream bitrate, 0 until reset
+    UINT_T min_kbps;       // Lowest target
+    UINT_T target_kbps;    // Bitrate the encoder is steered to
+    UINT_T srtt_floor_ms;  // Lowest RTT seen, rises slowly to follow route changes
+    UINT_T xmit;           // Retransmissions at the last decision
+    UINT_T queue_ms;       // Backlog at the target rate, from the last update
+    UINT64_T update_ms;    // Last decision
+    UINT64_T decrease_ms;  // Last decrease
+    BOOL_T gop_broken;     // A reference frame was not sent, P frames wait for the next key frame
+    UINT_T dropped;        // Frames dropped since reset
+} P2P_RATE_CTRL_T;
+
+/***********************************************************
+********************function declaration********************
+***********************************************************/
+
+/**
+ * @brief Start rate control of a stream at its full bitrate
+ *
+ * @param[in] rc rate control
+ * @param[in] max_kbps stream bitrate, 0 for P2P_RATE_DEFAULT_KBPS
+ *
+ * @return none
+ */
+VOID p2p_rate_reset(P2P_RATE_CTRL_T *rc, UINT_T max_kbps);
+
+/**
+ * @brief Feed the channel state, once per frame
+ *
+ * @param[in] rc rate control
+ * @param[in] stat video channel state
+ * @param[in] now_ms current time
+ *
+ * @return TRUE when the target bitrate changed
+ */
+BOOL_T p2p_rate_update(P2P_RATE_CTRL_T *rc, CONST tuya_p2p_rtc_send_stat_t *stat, UINT64_T now_ms);
+
+/**
+ * @brief Decide whether a frame goes out under the current backlog
+ *
+ * @param[in] rc rate control
+ * @param[in] key key frame
+ * @param[in] ref frame is referenced by later ones
+ *
+ * @return P2P_RATE_SEND or P2P_RATE_DROP
+ */
+P2P_RATE_ACTION_E p2p_rate_frame_check(P2P_RATE_CTRL_T *rc, BOOL_T key, BOOL_T ref);
+
+/**
+ * @brief Report a frame that was let through but could not be sent
+ *
+ * @param[in] rc rate control
+ * @param[in] key key frame
+ * @param[in] ref frame is referenced by later ones
+ *
+ * @return none
+ */
+VOID p2p_rate_frame_lost(P2P_RATE_CTRL_T *rc, BOOL_T key, BOOL_T ref);
+
+/**
+ * @brief Check the NAL headers of an Annex-B frame for a reference picture
+ *
+ * @param[in] data frame
+ * @param[in] len frame length
+ * @param[in] h265 H.265 instead of H.264
+ *
+ * @return FALSE only when the slices are marked non-reference
+ */
+BOOL_T p2p_rate_frame_is_ref(CONST UCHAR_T *data, UINT_T len, BOOL_T h265);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TUYA_IPC_P2P_RATE_H__ */
@@ -15,6 +15,7 @@
 #include "tuya_ipc_p2p_inner.h"
 #include "tuya_ipc_p2p_common.h"
 #include "tuya_media_service_rtc.h"
+#include "tuya_ipc_p2p_rate.h"
 #include "rtp-payload.h"
 
 #define TUYA_CMD_CHANNEL        (0) // Signaling channel, signal mode refer to P2P_CMD_E
@@ -73,14 +74,45 @@ typedef struct P2P_CMD_PARSE_ {
 #define STACK_SIZE_P2P_DETECT     65536
 #define STACK_SIZE_P2P_LISTEN     131072
 
+// Packets of one frame gathered for a batch send, flushed when full and at the end of the frame
+#ifndef P2P_RTP_TRAIN_LEN
+#define P2P_RTP_TRAIN_LEN (16 * 1024)
+#endif
+#define P2P_RTP_TRAIN_PKT_MAX (P2P_RTP_TRAIN_LEN / 256)
+
+typedef struct {
+    UINT_T used;                                  // Bytes of buff taken, packets start 4-byte aligned
+    INT_T cnt;                                    // Packets in iov
+    tuya_p2p_rtc_iov_t iov[P2P_RTP_TRAIN_PKT_MAX]; // Extension header and RTP packet of each one
+    CHAR_T buff[P2P_RTP_TRAIN_LEN];
+} P2P_RTP_TRAIN_T;
+
 typedef struct {
     INT_T client;
     INT_T channel;
     CHAR_T *p_rtp_buff;                         // RTP data buffer, reference size MTU+100
+    P2P_RTP_TRAIN_T *train;                     // Packet train of the stream, NULL sends each packet
     INT_T fix_len;                              // Supplementary private header data
     CHAR_T ext_head_buff[P2P_EXT_HEAD_MAX_LEN]; // According to extended video header protocol head+ext(8)+rtp_len
 } RTP_PACK_NAL_ARG_T;
 
+// Layout of the cached extension header of a stream
+typedef enum {
+    P2P_EXT_NONE = 0, // Nothing cached, rebuild on the next frame
+    P2P_EXT_VIDEO_DELTA,
+    P2P_EXT_VIDEO_KEY,
+    P2P_EXT_AUDIO,
+} P2P_EXT_TYPE_E;
+
+// RTP packetizer of one stream, kept from the first frame until the send resources are released
+typedef struct {
+    VOID *encoder;          // rtp_payload encoder of payload and ssrc
+    INT_T payload;          // RTP payload type the encoder was created for
+    UINT_T ssrc;            // RTP SSRC the encoder was created for
+    P2P_EXT_TYPE_E ext;     // Layout held in arg.ext_head_buff
+    RTP_PACK_NAL_ARG_T arg; // Packet handler argument, lives as long as the encoder
+} P2P_RTP_STREAM_T;
+
 typedef enum {
     P2P_IDLE = 0,
     P2P_VIDEO = 0x1, // Start live stream request
@@ -111,6 +143,10 @@ typedef struct {
     CHAR_T *p_audio_rtp_buff; // Audio RTP data buffer, reference size MTU+100
     USHORT_T video_seq_num;   // Video RTP packet sequence number
     USHORT_T audio_seq_num;   // Audio RTP packet sequence number
+    P2P_RTP_STREAM_T video_rtp; // Video packetizer
+    P2P_RTP_STREAM_T audio_rtp; // Audio packetizer
+    P2P_RTP_TRAIN_T *video_train; // Video packet train, NULL sends each packet
+    P2P_RATE_CTRL_T video_rate;   // Video rate control, max_kbps 0 until the first frame
     BOOL_T key_frame;
     UINT64_T v_pts;                                  // Video PTS
     UINT64_T v_timestamp;                            // Video absolute time (ms)
@@ -125,6 +161,7 @@ typedef struct {
     tuya_p2p_rtc_disconnect_cb_t on_disconnect_callback;
     tuya_p2p_rtc_get_frame_cb_t on_get_video_frame_callback;
     tuya_p2p_rtc_get_frame_cb_t on_get_audio_frame_callback;
+    tuya_p2p_rtc_bitrate_cb_t on_video_bitrate_callback;
     THREAD_HANDLE cmd_recv_proc_thread;   // Command receive thread handle
     THREAD_HANDLE video_send_proc_thread; // Video send thread handle
     // TAL_VENC_FRAME_T tal_video_frame;
@@ -204,10 +241,19 @@ OPERATE_RET p2p_rtc_listen_stop()
     return OPRT_OK;
 }
 
+/***********************************************************
+ *  Function: p2p_get_idle_session
+ *  Note:Take the session for a new viewer. The transport carries one RTC
+ *       session at a time (g_pRtcSession in base_ice), so there is a single
+ *       P2P session and a second viewer waits until the first one leaves
+ *  Input: none
+ *  Output: index session index, always 0
+ *  Return: the session, NULL while it is in use
+ ***********************************************************/
 P2P_SESSION_T *p2p_get_idle_session(INT_T *index)
 {
     INT_T status = -1;
-    INT_T i;
+    INT_T i = 0;
     if (sg_p2p_session == NULL)
         return NULL;
     PR_DEBUG("p2p_get_idle_session begin\n");
@@ -430,6 +476,21 @@ TRANSFER_VIDEO_CLARITY_TYPE p2p_clarity_trans(TRANSFER_VIDEO_CLARITY_TYPE_INNER_
     return eVideoClarityHigh;
 }
 
+/***********************************************************
+ *  Function: __p2p_rtp_stream_release
+ *  Note:Destroy the packetizer of a stream, the next frame creates it again
+ *  Input: stream packetizer
+ *  Output: none
+ *  Return:
+ ***********************************************************/
+STATIC VOID __p2p_rtp_stream_release(P2P_RTP_STREAM_T *stream)
+{
+    if (NULL != stream->encoder) {
+        rtp_payload_encode_destroy(stream->encoder);
+    }
+    memset(stream, 0, sizeof(P2P_RTP_STREAM_T));
+}
+
 INT_T p2p_prepare_video_send_resource(P2P_SESSION_T *pSession)
 {
     if (pSession == NULL) {
@@ -448,6 +509,15 @@ INT_T p2p_prepare_video_send_resource(P2P_SESSION_T *pSession)
     }
     memset(pSession->p_video_rtp_buff, 0x00, P2P_RTP_PACK_LEN);
 
+    // Without the train the packets of a frame are sent one by one
+    pSession->video_train = (P2P_RTP_TRAIN_T *)Malloc(sizeof(P2P_RTP_TRAIN_T));
+    if (NULL == pSession->video_train) {
+        PR_WARN("session:[%d] video packet train malloc failed", pSession->session);
+    } else {
+        pSession->video_train->used = 0;
+        pSession->video_train->cnt = 0;
+    }
+
     PR_DEBUG("session:[%d] malloc video send buffer success", pSession->session);
     return OPRT_OK;
 }
@@ -463,8 +533,14 @@ INT_T p2p_release_video_send_resource(P2P_SESSION_T *pSession)
         return OPRT_OK;
     }
 
+    __p2p_rtp_stream_release(&pSession->video_rtp);
     Free(pSession->p_video_rtp_buff);
     pSession->p_video_rtp_buff = NULL;
+    pSession->video_rate.max_kbps = 0;
+    if (pSession->video_train) {
+        Free(pSession->video_train);
+        pSession->video_train = NULL;
+    }
 
     PR_DEBUG("session:[%d] release video send buffer success", pSession->session);
     return OPRT_OK;
@@ -503,6 +579,7 @@ INT_T p2p_release_audio_send_resource(P2P_SESSION_T *pSession)
         return OPRT_OK;
     }
 
+    __p2p_rtp_stream_release(&pSession->audio_rtp);
     Free(pSession->p_audio_rtp_buff);
     pSession->p_audio_rtp_buff = NULL;
 
@@ -529,6 +606,34 @@ OPERATE_RET p2p_send_rtp_data(INT_T client, INT_T channel, CHAR_T *buff, INT_T l
     return OPRT_OK;
 }
 
+/***********************************************************
+ *  Function: __p2p_rtp_train_flush
+ *  Note:Send the packets gathered in the train of a stream in one batch
+ *  Input: nal_arg packet handler argument of the stream
+ *  Output: none
+ *  Return:
+ ***********************************************************/
+STATIC OPERATE_RET __p2p_rtp_train_flush(RTP_PACK_NAL_ARG_T *nal_arg)
+{
+    P2P_RTP_TRAIN_T *train = nal_arg->train;
+    if (NULL == train || 0 == train->cnt) {
+        return OPRT_OK;
+    }
+
+    INT_T cnt = train->cnt;
+    train->cnt = 0;
+    train->used = 0;
+    if ((0 == (P2P_VIDEO & sg_p2p_session->cmd)) && (0 == (P2P_PB_VIDEO & sg_p2p_session->cmd)) &&
+        (0 == (P2P_AUDIO & sg_p2p_session->cmd)) && (0 == (P2P_PB_AUDIO & sg_p2p_session->cmd))) {
+        return OPRT_OK;
+    }
+    INT_T ret = tuya_p2p_rtc_send_data_batch(sg_p2p_session->session, nal_arg->channel, train->iov, cnt, -1);
+    if (ret != cnt) {
+        PR_ERR("Write train failed [%d][%d]", ret, cnt);
+    }
+    return OPRT_OK;
+}
+
 /***********************************************************
  *  Function: __p2p_ext_protocol_pack
  *  Note:Transport extension protocol packet assembly
@@ -584,6 +689,90 @@ STATIC VOID __p2p_ext_protocol_pack(INT_T client, INT_T type, CHAR_T *p_result,
     return;
 }
 
+/***********************************************************
+ *  Function: __p2p_rtp_stream_ext_update
+ *  Note:Bring the cached extension header of a stream up to the current frame.
+ *       Key frames carry the video parameters and are packed in full, other
+ *       frames only change the request id and the time of the cached one.
+ *  Input: stream packetizer, client channel number, type 0/1 video/audio
+ *  Output: none
+ *  Return:
+ ***********************************************************/
+STATIC VOID __p2p_rtp_stream_ext_update(P2P_RTP_STREAM_T *stream, INT_T client, INT_T type)
+{
+    P2P_EXT_TYPE_E ext = P2P_EXT_AUDIO;
+    if (0 == type) {
+        ext = (TRUE == sg_p2p_session->key_frame) ? P2P_EXT_VIDEO_KEY : P2P_EXT_VIDEO_DELTA;
+    }
+
+    if (ext != stream->ext || P2P_EXT_VIDEO_KEY == ext) {
+        memset(stream->arg.ext_head_buff, 0, P2P_EXT_HEAD_MAX_LEN);
+        __p2p_ext_protocol_pack(client, type, stream->arg.ext_head_buff, &stream->arg.fix_len);
+        stream->ext = ext;
+        return;
+    }
+
+    C2C_AV_TRANS_FIXED_HEADER *pav_Info = (C2C_AV_TRANS_FIXED_HEADER *)stream->arg.ext_head_buff;
+    if (0 == type) {
+        pav_Info->request_id = sg_p2p_session->video_req_id;
+        pav_Info->time_ms = sg_p2p_session->v_timestamp;
+    } else {
+        pav_Info->request_id = sg_p2p_session->audio_req_id;
+        pav_Info->time_ms = sg_p2p_session->a_timestamp;
+    }
+}
+
+/***********************************************************
+ *  Function: __p2p_rtp_stream_send
+ *  Note:Packetize one frame with the long-lived encoder of the stream and send
+ *       it. The encoder is created on the first frame and again only when the
+ *       payload type or the SSRC change, the sequence number carries over.
+ *  Input: stream packetizer, client channel number, channel TUYA_VDATA/ADATA_CHANNEL,
+ *         p_rtp_buff RTP buffer, train packet train or NULL, type 0/1 video/audio, payload and name RTP payload, ssrc RTP SSRC,
+ *         p_seq session sequence number, timestamp RTP timestamp, pData/len frame
+ *  Output: p_seq sequence number after the frame
+ *  Return:
+ ***********************************************************/
+STATIC OPERATE_RET __p2p_rtp_stream_send(P2P_RTP_STREAM_T *stream, INT_T client, INT_T channel, CHAR_T *p_rtp_buff,
+                                         P2P_RTP_TRAIN_T *train, INT_T type, INT_T payload, CHAR_T *name, UINT_T ssrc, USHORT_T *p_seq,
+                                         uint32_t timestamp, CHAR_T *pData, INT_T len)
+{
+    OPERATE_RET ret = OPRT_OK;
+
+    if (NULL != stream->encoder && (stream->payload != payload || stream->ssrc != ssrc)) {
+        __p2p_rtp_stream_release(stream);
+    }
+    if (NULL == stream->encoder) {
+        struct rtp_payload_t rtp_packer;
+        rtp_packer.alloc = rtp_alloc;
+        rtp_packer.free = rtp_free;
+        rtp_packer.packet = rtp_pack_packet_handler;
+        stream->encoder = rtp_payload_encode_create(payload, name, *p_seq, ssrc, &rtp_packer, &stream->arg);
+        if (NULL == stream->encoder) {
+            PR_ERR("rtp_payload_encode_create %s failed", name);
+            return OPRT_MALLOC_FAILED;
+        }
+        stream->payload = payload;
+        stream->ssrc = ssrc;
+        stream->ext = P2P_EXT_NONE;
+    }
+
+    stream->arg.client = client;
+    stream->arg.channel = channel;
+    stream->arg.p_rtp_buff = p_rtp_buff;
+    stream->arg.train = train;
+    __p2p_rtp_stream_ext_update(stream, client, type);
+
+    ret = rtp_payload_encode_input(stream->encoder, pData, len, timestamp);
+    if (OPRT_OK != ret) {
+        PR_ERR("rtp_payload_encode_input %s error:%d", name, ret);
+    }
+    __p2p_rtp_train_flush(&stream->arg);
+    rtp_payload_encode_getinfo(stream->encoder, p_seq, &timestamp);
+
+    return ret;
+}
+
 STATIC OPERATE_RET __p2p_check_free_buffer_size(INT_T client, INT_T channel, INT_T len)
 {
     OPERATE_RET ret = OPRT_OK;
@@ -634,30 +823,9 @@ STATIC OPERATE_RET __p2p_pack_h265_rtp_and_send(INT_T client, CHAR_T *pData, INT
         return OPRT_INVALID_PARM;
     }
 
-    RTP_PACK_NAL_ARG_T rtp_pack_nal_arg;
-    rtp_pack_nal_arg.client = client;
-    rtp_pack_nal_arg.channel = TUYA_VDATA_CHANNEL;
-    rtp_pack_nal_arg.p_rtp_buff = sg_p2p_session->p_video_rtp_buff;
-    memset(rtp_pack_nal_arg.ext_head_buff, 0, P2P_EXT_HEAD_MAX_LEN);
-    __p2p_ext_protocol_pack(client, 0, rtp_pack_nal_arg.ext_head_buff, &rtp_pack_nal_arg.fix_len);
-
-    void *pRtpDelegate = NULL;
-    struct rtp_payload_t rtp_packer;
-    rtp_packer.alloc = rtp_alloc;
-    rtp_packer.free = rtp_free;
-    rtp_packer.packet = rtp_pack_packet_handler;
-    uint16_t seq = sg_p2p_session->video_seq_num;
-    uint32_t ssrc = 10;
     uint32_t timestamp = (UINT_T)sg_p2p_session->v_pts;
-    pRtpDelegate = rtp_payload_encode_create(/*H265_PAY_LOAD*/ 95, "H265", seq, ssrc, &rtp_packer, &rtp_pack_nal_arg);
-    ret = rtp_payload_encode_input(pRtpDelegate, pData, len, timestamp);
-    if (OPRT_OK != ret) {
-        PR_ERR("rtp_payload_encode_input h264 error:%d", ret);
-    }
-    rtp_payload_encode_getinfo(pRtpDelegate, &sg_p2p_session->video_seq_num, &timestamp);
-    rtp_payload_encode_destroy(pRtpDelegate);
-
-    return ret;
+    return __p2p_rtp_stream_send(&sg_p2p_session->video_rtp, client, TUYA_VDATA_CHANNEL, sg_p2p_session->p_video_rtp_buff,
+                                 sg_p2p_session->video_train, 0, /*H265_PAY_LOAD*/ 95, "H265", 10, &sg_p2p_session->video_seq_num, timestamp, pData, len);
 }
 
 /***********************************************************
@@ -691,30 +859,9 @@ STATIC OPERATE_RET __p2p_pack_h264_rtp_and_send(INT_T client, CHAR_T *pData, INT
         return OPRT_INVALID_PARM;
     }
 
-    RTP_PACK_NAL_ARG_T rtp_pack_nal_arg;
-    rtp_pack_nal_arg.client = client;
-    rtp_pack_nal_arg.channel = TUYA_VDATA_CHANNEL;
-    rtp_pack_nal_arg.p_rtp_buff = sg_p2p_session->p_video_rtp_buff;
-    memset(rtp_pack_nal_arg.ext_head_buff, 0, P2P_EXT_HEAD_MAX_LEN);
-    __p2p_ext_protocol_pack(client, 0, rtp_pack_nal_arg.ext_head_buff, &rtp_pack_nal_arg.fix_len);
-
-    void *pRtpDelegate = NULL;
-    struct rtp_payload_t rtp_packer;
-    rtp_packer.alloc = rtp_alloc;
-    rtp_packer.free = rtp_free;
-    rtp_packer.packet = rtp_pack_packet_handler;
-    uint16_t seq = sg_p2p_session->video_seq_num;
-    uint32_t ssrc = 10;
     uint32_t timestamp = (UINT_T)sg_p2p_session->v_pts;
-    pRtpDelegate = rtp_payload_encode_create(/*H264_PAY_LOAD*/ 96, "H264", seq, ssrc, &rtp_packer, &rtp_pack_nal_arg);
-    ret = rtp_payload_encode_input(pRtpDelegate, pData, len, timestamp);
-    if (OPRT_OK != ret) {
-        PR_ERR("rtp_payload_encode_input h264 error:%d", ret);
-    }
-    rtp_payload_encode_getinfo(pRtpDelegate, &sg_p2p_session->video_seq_num, &timestamp);
-    rtp_payload_encode_destroy(pRtpDelegate);
-
-    return ret;
+    return __p2p_rtp_stream_send(&sg_p2p_session->video_rtp, client, TUYA_VDATA_CHANNEL, sg_p2p_session->p_video_rtp_buff,
+                                 sg_p2p_session->video_train, 0, /*H264_PAY_LOAD*/ 96, "H264", 10, &sg_p2p_session->video_seq_num, timestamp, pData, len);
 }
 
 /***********************************************************
@@ -818,20 +965,6 @@ STATIC OPERATE_RET __p2p_pack_g711_rtp_and_send(INT_T client, CHAR_T *pData, INT
         return OPRT_INVALID_PARM;
     }
 
-    RTP_PACK_NAL_ARG_T rtp_pack_nal_arg;
-    rtp_pack_nal_arg.client = client;
-    rtp_pack_nal_arg.channel = TUYA_ADATA_CHANNEL;
-    rtp_pack_nal_arg.p_rtp_buff = sg_p2p_session->p_audio_rtp_buff;
-    memset(rtp_pack_nal_arg.ext_head_buff, 0, P2P_EXT_HEAD_MAX_LEN);
-    __p2p_ext_protocol_pack(client, 1, rtp_pack_nal_arg.ext_head_buff, &rtp_pack_nal_arg.fix_len);
-
-    void *pRtpDelegate = NULL;
-    struct rtp_payload_t rtp_packer;
-    rtp_packer.alloc = rtp_alloc;
-    rtp_packer.free = rtp_free;
-    rtp_packer.packet = rtp_pack_packet_handler;
-    uint16_t seq = sg_p2p_session->audio_seq_num;
-    uint32_t ssrc = 11;
     uint32_t timestamp = (UINT_T)sg_p2p_session->a_pts;
     int payload = 0;
     char *codec_name = NULL;
@@ -845,15 +978,8 @@ STATIC OPERATE_RET __p2p_pack_g711_rtp_and_send(INT_T client, CHAR_T *pData, INT
         codec_name = "PCM";
         payload = 99 /*RTP_PCM_PAYLOAD*/;
     }
-    pRtpDelegate = rtp_payload_encode_create(payload, codec_name, seq, ssrc, &rtp_packer, &rtp_pack_nal_arg);
-    ret = rtp_payload_encode_input(pRtpDelegate, pData, len, timestamp);
-    if (OPRT_OK != ret) {
-        PR_ERR("rtp_payload_encode_input h264 error:%d", ret);
-    }
-    rtp_payload_encode_getinfo(pRtpDelegate, &sg_p2p_session->audio_seq_num, &timestamp);
-    rtp_payload_encode_destroy(pRtpDelegate);
-
-    return ret;
+    return __p2p_rtp_stream_send(&sg_p2p_session->audio_rtp, client, TUYA_ADATA_CHANNEL, sg_p2p_session->p_audio_rtp_buff,
+                                 NULL, 1, payload, codec_name, 11, &sg_p2p_session->audio_seq_num, timestamp, pData, len);
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -871,6 +997,9 @@ OPERATE_RET tuya_ipc_p2p_set_limit_mode(BOOL_T islimit)
 OPERATE_RET tuya_ipc_init_trans_av_info(TRANS_IPC_AV_INFO_T *av_info)
 {
     memcpy(&sg_p2p_session->av_Info, av_info, sizeof(TRANS_IPC_AV_INFO_T));
+    // The audio parameters live in the cached extension headers
+    sg_p2p_session->video_rtp.ext = P2P_EXT_NONE;
+    sg_p2p_session->audio_rtp.ext = P2P_EXT_NONE;
     return OPRT_OK;
 }
 
@@ -886,6 +1015,49 @@ OPERATE_RET tuya_p2p_rtc_register_get_audio_frame_cb(tuya_p2p_rtc_get_frame_cb_t
     return OPRT_OK;
 }
 
+OPERATE_RET tuya_p2p_rtc_register_video_bitrate_cb(tuya_p2p_rtc_bitrate_cb_t pCallback)
+{
+    sg_p2p_session->on_video_bitrate_callback = pCallback;
+    return OPRT_OK;
+}
+
+/***********************************************************
+ *  Function: __p2p_video_rate_check
+ *  Note:Run rate control on a video frame, steer the encoder when the target
+ *       bitrate moves and decide whether the frame is sent
+ *  Input: pSession session, pMediaFrame video frame
+ *  Output: p_ref frame is referenced by later ones
+ *  Return: P2P_RATE_SEND or P2P_RATE_DROP
+ ***********************************************************/
+STATIC P2P_RATE_ACTION_E __p2p_video_rate_check(P2P_SESSION_T *pSession, MEDIA_FRAME *pMediaFrame, BOOL_T *p_ref)
+{
+    P2P_RATE_CTRL_T *rc = &pSession->video_rate;
+    BOOL_T h265 = (TY_AV_CODEC_VIDEO_H265 == pSession->av_Info.video_codec[0]) ? TRUE : FALSE;
+    UINT_T max_kbps = pSession->av_Info.bitrate[p2p_get_chn_idx(pSession->cur_clarity)];
+
+    *p_ref = p2p_rate_frame_is_ref(pMediaFrame->data, pMediaFrame->size, h265);
+
+    // A new stream or clarity starts over at the full bitrate of its channel
+    if (0 == rc->max_kbps || (max_kbps && max_kbps != rc->max_kbps)) {
+        p2p_rate_reset(rc, max_kbps);
+        if (pSession->on_video_bitrate_callback) {
+            pSession->on_video_bitrate_callback(rc->target_kbps);
+        }
+    }
+
+    tuya_p2p_rtc_send_stat_t stat;
+    if (0 == tuya_p2p_rtc_get_send_stat(pSession->session, TUYA_VDATA_CHANNEL, &stat) &&
+        p2p_rate_update(rc, &stat, tal_system_get_millisecond())) {
+        PR_DEBUG("video target %u kbps, queue %u ms srtt %u ms, dropped %u", rc->target_kbps, rc->queue_ms,
+                 stat.srtt_ms, rc->dropped);
+        if (pSession->on_video_bitrate_callback) {
+            pSession->on_video_bitrate_callback(rc->target_kbps);
+        }
+    }
+
+    return p2p_rate_frame_check(rc, (eVideoIFrame == pMediaFrame->type) ? TRUE : FALSE, *p_ref);
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 /***********************************************************
@@ -1404,10 +1576,16 @@ STATIC void __p2p_media_send_proc(PVOID_T pArg)
                 } else {
                     pSession->key_frame = FALSE;
                 }
-                if (TY_AV_CODEC_VIDEO_H265 != sg_p2p_session->av_Info.video_codec[0]) {
-                    op_ret = __p2p_pack_h264_rtp_and_send(index, (CHAR_T *)pMediaFrame->data, pMediaFrame->size);
-                } else {
-                    op_ret = __p2p_pack_h265_rtp_and_send(index, (CHAR_T *)pMediaFrame->data, pMediaFrame->size);
+                BOOL_T ref = TRUE;
+                if (P2P_RATE_SEND == __p2p_video_rate_check(pSession, pMediaFrame, &ref)) {
+                    if (TY_AV_CODEC_VIDEO_H265 != sg_p2p_session->av_Info.video_codec[0]) {
+                        op_ret = __p2p_pack_h264_rtp_and_send(index, (CHAR_T *)pMediaFrame->data, pMediaFrame->size);
+                    } else {
+                        op_ret = __p2p_pack_h265_rtp_and_send(index, (CHAR_T *)pMediaFrame->data, pMediaFrame->size);
+                    }
+                    if (OPRT_OK != op_ret) {
+                        p2p_rate_frame_lost(&pSession->video_rate, pSession->key_frame, ref);
+                    }
                 }
             } else {
                 // Buffer has no data yet
@@ -1480,10 +1658,16 @@ INT_T __p2p_session_release_va(P2P_SESSION_T *pSession)
     // All functions closed
     PR_DEBUG("release va session[%d]", pSession->session);
     tal_mutex_lock(pSession->cmutex);
+    __p2p_rtp_stream_release(&pSession->video_rtp);
+    __p2p_rtp_stream_release(&pSession->audio_rtp);
     if (pSession->p_video_rtp_buff) {
         Free(pSession->p_video_rtp_buff);
         pSession->p_video_rtp_buff = NULL;
     }
+    if (pSession->video_train) {
+        Free(pSession->video_train);
+        pSession->video_train = NULL;
+    }
     if (pSession->p_audio_rtp_buff) {
         Free(pSession->p_audio_rtp_buff);
         pSession->p_audio_rtp_buff = NULL;
@@ -1693,16 +1877,39 @@ OPERATE_RET tuya_imm_p2p_album_play_send_finish(IN CONST CHAR_T *dev_id, IN CONS
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Packets are serialized straight behind the extension header, in the train or in the stream's RTP buffer
 void *rtp_alloc(void *param, int bytes)
 {
+    RTP_PACK_NAL_ARG_T *nal_arg = (RTP_PACK_NAL_ARG_T *)param;
+    P2P_RTP_TRAIN_T *train = nal_arg->train;
+    if (train && nal_arg->fix_len + bytes <= P2P_RTP_TRAIN_LEN) {
+        if (train->used + nal_arg->fix_len + bytes > P2P_RTP_TRAIN_LEN || train->cnt >= P2P_RTP_TRAIN_PKT_MAX) {
+            __p2p_rtp_train_flush(nal_arg);
+        }
+        return train->buff + train->used + nal_arg->fix_len;
+    }
+    if (nal_arg->fix_len + bytes <= P2P_RTP_PACK_LEN) {
+        return nal_arg->p_rtp_buff + nal_arg->fix_len;
+    }
+
     int nBufferSize = bytes;
     unsigned char *pBuffer = (unsigned char *)malloc(nBufferSize);
-    memset(pBuffer, 0, nBufferSize);
+    if (pBuffer) {
+        memset(pBuffer, 0, nBufferSize);
+    }
     return pBuffer;
 }
 
 void rtp_free(void *param, void *packet)
 {
+    RTP_PACK_NAL_ARG_T *nal_arg = (RTP_PACK_NAL_ARG_T *)param;
+    if ((CHAR_T *)packet == nal_arg->p_rtp_buff + nal_arg->fix_len) {
+        return;
+    }
+    if (nal_arg->train && (CHAR_T *)packet >= nal_arg->train->buff &&
+        (CHAR_T *)packet < nal_arg->train->buff + P2P_RTP_TRAIN_LEN) {
+        return;
+    }
     free(packet);
     packet = NULL;
     return;
@@ -1714,9 +1921,22 @@ int rtp_pack_packet_handler(void *param, const void *packet, int bytes, uint32_t
     CHAR_T *buf = (CHAR_T *)packet;
     INT_T len = bytes;
     RTP_PACK_NAL_ARG_T *nal_arg = (RTP_PACK_NAL_ARG_T *)param;
+    P2P_RTP_TRAIN_T *train = nal_arg->train;
+    if (train && buf == train->buff + train->used + nal_arg->fix_len) {
+        CHAR_T *pkt = train->buff + train->used;
+        memcpy(pkt, nal_arg->ext_head_buff, nal_arg->fix_len);
+        *(INT_T *)&pkt[nal_arg->fix_len - 4] = len;
+        train->iov[train->cnt].buf = pkt;
+        train->iov[train->cnt].len = len + nal_arg->fix_len;
+        train->cnt++;
+        train->used += (len + nal_arg->fix_len + 3) & ~3;
+        return OPRT_OK;
+    }
     memcpy(nal_arg->p_rtp_buff, nal_arg->ext_head_buff, nal_arg->fix_len);
     *(INT_T *)&nal_arg->p_rtp_buff[nal_arg->fix_len - 4] = len;
-    memcpy(nal_arg->p_rtp_buff + nal_arg->fix_len, buf, len);
+    if (buf != nal_arg->p_rtp_buff + nal_arg->fix_len) {
+        memcpy(nal_arg->p_rtp_buff + nal_arg->fix_len, buf, len);
+    }
     return p2p_send_rtp_data(nal_arg->client, nal_arg->channel, nal_arg->p_rtp_buff, len + nal_arg->fix_len);
 }
 
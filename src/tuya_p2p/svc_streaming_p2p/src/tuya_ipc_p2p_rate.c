@@ -0,0 +1,136 @@
+/**
+ * @file tuya_ipc_p2p_rate.c
+ * @brief Send side rate control of the P2P video stream
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ */
+
+#include <string.h>
+#include "tuya_ipc_p2p_rate.h"
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+#define P2P_RATE_DECREASE_PERCENT 85 // Target kept on congestion
+#define P2P_RATE_INCREASE_PERCENT 5  // Stream bitrate added per clear decision
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+
+VOID p2p_rate_reset(P2P_RATE_CTRL_T *rc, UINT_T max_kbps)
+{
+    memset(rc, 0, sizeof(P2P_RATE_CTRL_T));
+    rc->max_kbps = max_kbps ? max_kbps : P2P_RATE_DEFAULT_KBPS;
+    rc->min_kbps = rc->max_kbps * P2P_RATE_MIN_PERCENT / 100;
+    if (0 == rc->min_kbps) {
+        rc->min_kbps = 1;
+    }
+    rc->target_kbps = rc->max_kbps;
+}
+
+BOOL_T p2p_rate_update(P2P_RATE_CTRL_T *rc, CONST tuya_p2p_rtc_send_stat_t *stat, UINT64_T now_ms)
+{
+    // Bits queued over kbps is the time the backlog takes to drain, in ms
+    rc->queue_ms = (UINT_T)((UINT64_T)stat->wait_snd * stat->mss * 8 / rc->target_kbps);
+
+    if (stat->srtt_ms > 0 && (0 == rc->srtt_floor_ms || stat->srtt_ms < rc->srtt_floor_ms)) {
+        rc->srtt_floor_ms = stat->srtt_ms;
+    }
+
+    if (0 == rc->update_ms) {
+        rc->update_ms = now_ms;
+        rc->xmit = stat->xmit;
+        return FALSE;
+    }
+    if (now_ms - rc->update_ms < P2P_RATE_INTERVAL_MS) {
+        return FALSE;
+    }
+    rc->update_ms = now_ms;
+
+    BOOL_T lost = (stat->xmit != rc->xmit) ? TRUE : FALSE;
+    rc->xmit = stat->xmit;
+    BOOL_T congested = (rc->queue_ms > P2P_RATE_QUEUE_HIGH_MS ||
+                        (rc->srtt_floor_ms && stat->srtt_ms > rc->srtt_floor_ms + P2P_RATE_RTT_RISE_MS) || lost)
+                           ? TRUE
+                           : FALSE;
+    rc->srtt_floor_ms++;
+
+    UINT_T target = rc->target_kbps;
+    if (congested) {
+        target = target * P2P_RATE_DECREASE_PERCENT / 100;
+        if (target < rc->min_kbps) {
+            target = rc->min_kbps;
+        }
+        rc->decrease_ms = now_ms;
+    } else if (rc->queue_ms < P2P_RATE_QUEUE_LOW_MS && now_ms - rc->decrease_ms >= P2P_RATE_HOLD_MS) {
+        target += rc->max_kbps * P2P_RATE_INCREASE_PERCENT / 100 + 1;
+        if (target > rc->max_kbps) {
+            target = rc->max_kbps;
+        }
+    }
+
+    if (target == rc->target_kbps) {
+        return FALSE;
+    }
+    rc->target_kbps = target;
+    return TRUE;
+}
+
+P2P_RATE_ACTION_E p2p_rate_frame_check(P2P_RATE_CTRL_T *rc, BOOL_T key, BOOL_T ref)
+{
+    if (key) {
+        rc->gop_broken = FALSE;
+        return P2P_RATE_SEND;
+    }
+    // Later P frames reference the missing one, they would not decode
+    if (rc->gop_broken) {
+        rc->dropped++;
+        return P2P_RATE_DROP;
+    }
+    if (!ref && rc->queue_ms > P2P_RATE_DROP_NONREF_MS) {
+        rc->dropped++;
+        return P2P_RATE_DROP;
+    }
+    if (ref && rc->queue_ms > P2P_RATE_DROP_REF_MS) {
+        rc->gop_broken = TRUE;
+        rc->dropped++;
+        return P2P_RATE_DROP;
+    }
+    return P2P_RATE_SEND;
+}
+
+VOID p2p_rate_frame_lost(P2P_RATE_CTRL_T *rc, BOOL_T key, BOOL_T ref)
+{
+    if (key || ref) {
+        rc->gop_broken = TRUE;
+    }
+    rc->dropped++;
+}
+
+BOOL_T p2p_rate_frame_is_ref(CONST UCHAR_T *data, UINT_T len, BOOL_T h265)
+{
+    UINT_T i = 0;
+
+    while (i + 3 < len) {
+        if (data[i] != 0 || data[i + 1] != 0 || data[i + 2] != 1) {
+            i++;
+            continue;
+        }
+        i += 3;
+        UCHAR_T nal = data[i];
+        if (h265) {
+            UCHAR_T type = (nal >> 1) & 0x3F;
+            // VCL types below 16 have an even sub-layer non-reference variant
+            if (type < 32) {
+                return (type >= 16 || (type & 0x01)) ? TRUE : FALSE;
+            }
+        } else {
+            UCHAR_T type = nal & 0x1F;
+            if (type >= 1 && type <= 5) {
+                return (nal & 0x60) ? TRUE : FALSE;
+            }
+        }
+    }
+    return TRUE;
+}
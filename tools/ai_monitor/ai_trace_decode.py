@@ -0,0 +1,296 @@
+#!/usr/bin/env python3
+# coding=utf-8
+"""
+Decode tuya_ai_monitor streams into Chrome trace / Perfetto JSON.
+
+The device side is src/tuya_ai_basic/monitor. A monitor frame is
+
+    magic:4 ("TYAI") | reserved:6 direction:2 | AI packet head:5 | len:4 |
+    payload | sign:32
+
+and AI_PT_CUSTOM_TRACE payloads carry 20 byte records
+(ts_ms:8 session:4 event:2 data_id:2 len:4, big endian).
+
+Live capture, subscribing to trace records only:
+
+    python3 ai_trace_decode.py --host 192.168.1.20 --save dev1.bin -o dev1.json
+
+Offline, one capture per device, merged into one trace:
+
+    python3 ai_trace_decode.py dev1.bin dev2.bin -o fleet.json
+
+Open the JSON in chrome://tracing or ui.perfetto.dev. A latency summary is
+printed to stderr.
+"""
+
+import argparse
+import json
+import socket
+import struct
+import sys
+import time
+
+MONITOR_MAGIC = 0x54594149
+MONITOR_PORT = 5055
+SIGN_LEN = 32
+PKT_HEAD_LEN = 5
+
+DIR_NAMES = {0: "up", 1: "down", 2: "device"}
+
+PT_AUDIO = 31
+PT_TEXT = 34
+PT_EVENT = 35
+PT_CUSTOM_LOG = 60
+PT_CUSTOM_TRACE = 61
+PT_NAMES = {
+    30: "video", 31: "audio", 32: "image", 33: "file", 34: "text", 35: "event",
+    PT_CUSTOM_LOG: "log", PT_CUSTOM_TRACE: "trace",
+}
+
+FRAG_NONE, FRAG_START, FRAG_ING, FRAG_END = 0, 1, 2, 3
+
+EVENT_MONITOR_FILTER = 0xF000
+ATTR_SESSION_ID = 43
+ATTR_EVENT_ID = 61
+ATTR_USER_DATA = 111
+ATTR_PT_BYTES = 0x05
+ATTR_PT_STR = 0x06
+
+TRACE_REC = struct.Struct(">QIHHI")
+
+# ai_monitor_trace_event_e
+TRACE_EVENTS = {
+    1: "wake",
+    2: "upload_start",
+    3: "upload_end",
+    4: "asr_result",
+    5: "nlg_start",
+    6: "tts_first",
+    7: "tts_end",
+    8: "playback_start",
+    9: "playback_end",
+}
+
+# Latency spans, measured from the first event to the next second event
+SPANS = [
+    ("wake", "wake", "upload_start"),
+    ("asr", "upload_end", "asr_result"),
+    ("think", "asr_result", "tts_first"),
+    ("prebuffer", "tts_first", "playback_start"),
+    ("tts_stream", "tts_first", "tts_end"),
+    ("playback", "playback_start", "playback_end"),
+    ("reply", "upload_end", "playback_start"),
+]
+
+
+def event_name(event):
+    if event >= 0x8000:
+        return "user_%d" % (event - 0x8000)
+    return TRACE_EVENTS.get(event, "event_%d" % event)
+
+
+class FrameParser:
+    """Splits a monitor byte stream into (direction, pt, frag, data) tuples."""
+
+    def __init__(self):
+        self.buf = b""
+
+    def feed(self, data):
+        self.buf += data
+        frames = []
+        magic = struct.pack(">I", MONITOR_MAGIC)
+        while True:
+            start = self.buf.find(magic)
+            if start < 0:
+                self.buf = self.buf[-3:]
+                break
+            self.buf = self.buf[start:]
+            head_len = 5 + PKT_HEAD_LEN + 4
+            if len(self.buf) < head_len:
+                break
+            direction = self.buf[4] >> 6
+            flags = self.buf[8]
+            frag = flags >> 6
+            security = (flags >> 1) & 0x1F
+            (length,) = struct.unpack_from(">I", self.buf, 10)
+            if security != 0 or (flags & 1) or length < SIGN_LEN:
+                # not a plain SL0 packet, resync after this magic
+                self.buf = self.buf[4:]
+                continue
+            if len(self.buf) < head_len + length:
+                break
+            payload = self.buf[head_len:head_len + length - SIGN_LEN]
+            self.buf = self.buf[head_len + length:]
+            frames.append(self._payload(direction, frag, payload))
+        return [f for f in frames if f]
+
+    @staticmethod
+    def _payload(direction, frag, payload):
+        if frag in (FRAG_ING, FRAG_END):
+            return (direction, None, frag, payload)
+        if len(payload) < 5:
+            return None
+        pt = payload[0] >> 1
+        offset = 1
+        if payload[0] & 1:
+            (attr_len,) = struct.unpack_from(">I", payload, offset)
+            offset += 4 + attr_len
+        offset += 4  # data length
+        return (direction, pt, frag, payload[offset:])
+
+
+def build_filter_event(types):
+    """AI_EVENT_MONITOR_FILTER request subscribing to the given packet types."""
+    bitmap = 0
+    for pt in types:
+        bitmap |= 1 << pt
+
+    def attr(atype, ptype, value):
+        return struct.pack(">HBI", atype, ptype, len(value)) + value
+
+    # the device echoes the ids back with strlen(), keep them NUL terminated
+    attrs = (attr(ATTR_SESSION_ID, ATTR_PT_STR, b"monitor\0") +
+             attr(ATTR_EVENT_ID, ATTR_PT_STR, b"filter\0") +
+             attr(ATTR_USER_DATA, ATTR_PT_BYTES, struct.pack(">Q", bitmap)))
+    event_head = struct.pack(">HH", EVENT_MONITOR_FILTER, 0)
+    payload = (bytes([(PT_EVENT << 1) | 1]) + struct.pack(">I", len(attrs)) + attrs +
+               struct.pack(">I", len(event_head)) + event_head)
+    body = payload + b"\0" * SIGN_LEN  # the device does not check the sign
+    pkt_head = struct.pack(">BHBB", 1, 1, 0, 0)  # version, sequence, SL0 unfragmented, reserve
+    return (struct.pack(">I", MONITOR_MAGIC) + bytes([2 << 6]) + pkt_head +
+            struct.pack(">I", len(body)) + body)
+
+
+class TraceBuilder:
+    def __init__(self):
+        self.events = []
+        self.records = []  # (pid, ts_ms, session, name, data_id, len)
+
+    def add_frame(self, pid, frame, include_packets, rx_ms):
+        direction, pt, frag, data = frame
+        if pt == PT_CUSTOM_TRACE:
+            for i in range(len(data) // TRACE_REC.size):
+                ts_ms, session, event, data_id, length = TRACE_REC.unpack_from(data, i * TRACE_REC.size)
+                name = event_name(event)
+                self.records.append((pid, ts_ms, session, name, data_id, length))
+                self.events.append({
+                    "name": name, "ph": "i", "s": "t", "ts": ts_ms * 1000,
+                    "pid": pid, "tid": "session %08x" % session,
+                    "args": {"data_id": data_id, "len": length},
+                })
+        elif include_packets and pt is not None:
+            # biz packets carry no device time, stamp them on arrival
+            self.events.append({
+                "name": "%s %s" % (DIR_NAMES.get(direction, "?"), PT_NAMES.get(pt, str(pt))),
+                "ph": "i", "s": "t", "ts": rx_ms * 1000, "pid": pid, "tid": "packets",
+                "args": {"len": len(data), "frag": frag},
+            })
+
+    def spans(self):
+        """Complete events for each SPANS pair, per device and session."""
+        by_track = {}
+        for pid, ts_ms, session, name, _, _ in sorted(self.records, key=lambda r: r[1]):
+            by_track.setdefault((pid, session), []).append((ts_ms, name))
+
+        durations = {}
+        for (pid, session), items in by_track.items():
+            for span, first, second in SPANS:
+                begin = None
+                for ts_ms, name in items:
+                    if name == first and begin is None:
+                        begin = ts_ms
+                    elif name == second and begin is not None:
+                        self.events.append({
+                            "name": span, "ph": "X", "ts": begin * 1000, "dur": (ts_ms - begin) * 1000,
+                            "pid": pid, "tid": "latency %08x" % session,
+                        })
+                        durations.setdefault(span, []).append(ts_ms - begin)
+                        begin = None
+        return durations
+
+    def write(self, out):
+        json.dump({"traceEvents": self.events, "displayTimeUnit": "ms"}, out)
+
+
+def percentile(values, pct):
+    values = sorted(values)
+    return values[min(len(values) - 1, int(len(values) * pct / 100))]
+
+
+def print_summary(durations):
+    if not durations:
+        print("no latency spans found", file=sys.stderr)
+        return
+    print("%-12s %6s %8s %8s %8s" % ("span", "count", "p50 ms", "p90 ms", "max ms"), file=sys.stderr)
+    for span, _, _ in SPANS:
+        values = durations.get(span)
+        if values:
+            print("%-12s %6d %8d %8d %8d" % (span, len(values), percentile(values, 50), percentile(values, 90),
+                                            max(values)), file=sys.stderr)
+
+
+def capture_live(args, builder):
+    types = [PT_CUSTOM_TRACE]
+    if args.packets:
+        types += [PT_AUDIO, PT_TEXT, PT_EVENT]
+    sock = socket.create_connection((args.host, args.port), timeout=10)
+    sock.sendall(build_filter_event(types))
+    sock.settimeout(1)
+    save = open(args.save, "wb") if args.save else None
+    parser = FrameParser()
+    deadline = time.time() + args.duration if args.duration else None
+    print("capturing from %s:%d, Ctrl-C to stop" % (args.host, args.port), file=sys.stderr)
+    try:
+        while deadline is None or time.time() < deadline:
+            try:
+                data = sock.recv(65536)
+            except socket.timeout:
+                continue
+            if not data:
+                break
+            if save:
+                save.write(data)
+            rx_ms = int(time.time() * 1000)
+            for frame in parser.feed(data):
+                builder.add_frame(args.host, frame, args.packets, rx_ms)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        sock.close()
+        if save:
+            save.close()
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Decode tuya_ai_monitor captures into Chrome trace JSON")
+    ap.add_argument("captures", nargs="*", help="raw monitor captures (see --save), one per device")
+    ap.add_argument("--host", help="capture live from this device")
+    ap.add_argument("--port", type=int, default=MONITOR_PORT, help="monitor port (default %(default)d)")
+    ap.add_argument("--duration", type=float, default=0, help="live capture seconds, 0 until Ctrl-C")
+    ap.add_argument("--save", help="write the raw live capture to this file")
+    ap.add_argument("--packets", action="store_true", help="also show monitored biz packets")
+    ap.add_argument("-o", "--output", default="-", help="trace JSON output (default stdout)")
+    args = ap.parse_args()
+
+    if not args.host and not args.captures:
+        ap.error("give capture files or --host")
+
+    builder = TraceBuilder()
+    if args.host:
+        capture_live(args, builder)
+    for path in args.captures:
+        parser = FrameParser()
+        with open(path, "rb") as f:
+            for frame in parser.feed(f.read()):
+                builder.add_frame(path, frame, args.packets, 0)
+
+    print_summary(builder.spans())
+    if args.output == "-":
+        builder.write(sys.stdout)
+    else:
+        with open(args.output, "w") as out:
+            builder.write(out)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,233 @@
+#!/usr/bin/env python3
+# coding=utf-8
+"""
+Detokenize logs of an ENABLE_LOG_TOKEN build.
+
+The device side is src/tal_system/src/tal_log_token.c. Every PR_* call site
+stores "file\\x1fline\\x1ffmt" in the tal_log_tok section of the ELF, its
+offset in the section is the token. A record is
+
+    level:1 | token | kinds | ms | args
+
+with varint token, kinds and ms. The low 4 bits of kinds are the argument
+count, then 2 bits per argument: 0 int32, 1 int64 (zigzag varints),
+2 double (8 bytes little endian), 3 string (length byte and bytes).
+Level bit 0x80 marks a record whose last arguments did not fit.
+
+Records arrive base64 encoded as "$..." lines in the normal log, other lines
+pass through unchanged:
+
+    python3 log_detokenize.py app.elf uart.log
+    tail -f uart.log | python3 log_detokenize.py app.elf
+
+Raw records from a tal_log_token_set_output() sink that writes each record
+behind a length byte:
+
+    python3 log_detokenize.py app.elf --bin records.bin
+
+Use the ELF of the same build, the tokens change with every link.
+"""
+
+import argparse
+import base64
+import re
+import struct
+import sys
+
+SECTION = "tal_log_tok"
+LEVELS = "EWNIDT"
+TRUNCATED = 0x80
+KIND_INT32, KIND_INT64, KIND_DOUBLE, KIND_STRING = 0, 1, 2, 3
+
+B64_RE = re.compile(r"\$([A-Za-z0-9+/]+={0,2})")
+CONV_RE = re.compile(r"%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d+))?(hh|h|ll|l|j|z|t|L|q)?([diouxXeEfFgGcspn%])")
+
+
+def read_section(path, name):
+    """Return the contents of one ELF section, stdlib only."""
+    with open(path, "rb") as f:
+        elf = f.read()
+    if elf[:4] != b"\x7fELF":
+        raise SystemExit("%s: not an ELF file" % path)
+    is64 = elf[4] == 2
+    end = "<" if elf[5] == 1 else ">"
+    if is64:
+        shoff, = struct.unpack_from(end + "Q", elf, 0x28)
+        shentsize, shnum, shstrndx = struct.unpack_from(end + "HHH", elf, 0x3A)
+        shdr = struct.Struct(end + "IIQQQQIIQQ")
+    else:
+        shoff, = struct.unpack_from(end + "I", elf, 0x20)
+        shentsize, shnum, shstrndx = struct.unpack_from(end + "HHH", elf, 0x2E)
+        shdr = struct.Struct(end + "IIIIIIIIII")
+
+    sections = [shdr.unpack_from(elf, shoff + i * shentsize) for i in range(shnum)]
+    strtab = sections[shstrndx]
+    for sec in sections:
+        start = strtab[4] + sec[0]
+        sec_name = elf[start:elf.index(b"\0", start)].decode()
+        if sec_name == name:
+            return elf[sec[4]:sec[4] + sec[5]]
+    raise SystemExit("%s: no %s section, is it an ENABLE_LOG_TOKEN build?" % (path, name))
+
+
+def load_tokens(path):
+    """Map token (section offset) to (file, line, fmt)."""
+    data = read_section(path, SECTION)
+    tokens = {}
+    pos = 0
+    while pos < len(data):
+        nul = data.find(b"\0", pos)
+        if nul < 0:
+            nul = len(data)
+        if nul > pos:
+            parts = data[pos:nul].decode("utf-8", "replace").split("\x1f", 2)
+            if len(parts) == 3:
+                tokens[pos] = (parts[0].replace("\\", "/").rsplit("/", 1)[-1], parts[1], parts[2])
+        pos = nul + 1
+    return tokens
+
+
+def get_varint(rec, pos):
+    value, shift = 0, 0
+    while True:
+        if pos >= len(rec):
+            raise ValueError("short varint")
+        byte = rec[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if not byte & 0x80:
+            return value, pos
+
+
+def unzigzag(value):
+    return (value >> 1) ^ -(value & 1)
+
+
+def decode_args(rec, pos, kinds):
+    """Return [(kind, value)] for the arguments present in the record."""
+    args = []
+    for i in range(kinds & 0x0F):
+        if pos >= len(rec):
+            break
+        kind = (kinds >> (4 + 2 * i)) & 3
+        if kind in (KIND_INT32, KIND_INT64):
+            value, pos = get_varint(rec, pos)
+            args.append((kind, unzigzag(value)))
+        elif kind == KIND_DOUBLE:
+            args.append((kind, struct.unpack_from("<d", rec, pos)[0]))
+            pos += 8
+        else:
+            size = rec[pos]
+            args.append((kind, rec[pos + 1:pos + 1 + size].decode("utf-8", "replace")))
+            pos += 1 + size
+    return args
+
+
+def c_format(fmt, args):
+    """printf with the argument kinds of the record."""
+    args = list(args)
+
+    def take():
+        return args.pop(0) if args else (None, None)
+
+    def conv(m):
+        flags, width, prec, length, spec = m.groups()
+        if spec == "%":
+            return "%"
+        if width == "*":
+            width = str(take()[1] or 0)
+        if prec == "*":
+            prec = str(take()[1] or 0)
+        kind, value = take()
+        if kind is None:
+            return "<cut>"
+        spec_py = "%" + flags.replace("#", "" if spec == "o" else "#") + (width or "") + ("." + prec if prec else "")
+        if spec in "diu":
+            if spec == "u" and value < 0:
+                value &= 0xFFFFFFFF if kind == KIND_INT32 else 0xFFFFFFFFFFFFFFFF
+            return (spec_py + "d") % value
+        if spec in "oxX":
+            if value < 0:
+                value &= 0xFFFFFFFF if kind == KIND_INT32 else 0xFFFFFFFFFFFFFFFF
+            return (spec_py + spec) % value
+        if spec == "p":
+            return "0x%x" % (value & 0xFFFFFFFFFFFFFFFF)
+        if spec == "c":
+            return (spec_py + "c") % chr(value & 0xFF)
+        if spec == "s":
+            return (spec_py + "s") % value
+        if spec == "n":
+            return ""
+        return (spec_py + spec) % value
+
+    return CONV_RE.sub(conv, fmt)
+
+
+def detokenize(rec, tokens):
+    level = rec[0]
+    token, pos = get_varint(rec, 1)
+    kinds, pos = get_varint(rec, pos)
+    ms, pos = get_varint(rec, pos)
+    args = decode_args(rec, pos, kinds)
+    lvl = LEVELS[level & 0x0F] if (level & 0x0F) < len(LEVELS) else "?"
+    head = "[%d.%03d ty %s]" % (ms // 1000, ms % 1000, lvl)
+    if token not in tokens:
+        return "%s[token %d] unknown, wrong ELF?" % (head, token)
+    file, line, fmt = tokens[token]
+    try:
+        msg = c_format(fmt, args)
+    except (TypeError, ValueError):
+        msg = "%s <bad args %r>" % (fmt, [a[1] for a in args])
+    if level & TRUNCATED and "<cut>" not in msg:
+        msg += " <cut>"
+    return "%s[%s:%s] %s" % (head, file, line, msg)
+
+
+def run_text(stream, tokens, out):
+    for line in stream:
+        def sub(m):
+            try:
+                return detokenize(base64.b64decode(m.group(1)), tokens)
+            except (ValueError, IndexError, struct.error):
+                return m.group(0)
+        out.write(B64_RE.sub(sub, line.rstrip("\r\n")) + "\n")
+        out.flush()
+
+
+def run_bin(data, tokens, out):
+    pos = 0
+    while pos < len(data):
+        size = data[pos]
+        rec = data[pos + 1:pos + 1 + size]
+        pos += 1 + size
+        try:
+            out.write(detokenize(rec, tokens) + "\n")
+        except (ValueError, IndexError, struct.error):
+            out.write("<bad record %s>\n" % rec.hex())
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Detokenize logs of an ENABLE_LOG_TOKEN build")
+    ap.add_argument("elf", help="ELF of the firmware that wrote the log")
+    ap.add_argument("log", nargs="?", help="log capture, stdin by default")
+    ap.add_argument("--bin", action="store_true", help="input is length prefixed binary records")
+    ap.add_argument("--dump", action="store_true", help="print the token table and exit")
+    args = ap.parse_args()
+
+    tokens = load_tokens(args.elf)
+    if args.dump:
+        for token, (file, line, fmt) in sorted(tokens.items()):
+            print("%8d %s:%s %s" % (token, file, line, fmt))
+        return
+
+    if args.bin:
+        data = open(args.log, "rb").read() if args.log else sys.stdin.buffer.read()
+        run_bin(data, tokens, sys.stdout)
+    else:
+        stream = open(args.log, errors="replace") if args.log else sys.stdin
+        run_text(stream, tokens, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
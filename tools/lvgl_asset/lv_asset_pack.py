@@ -0,0 +1,76 @@
+#!/usr/bin/env python3
+# coding=utf-8
+"""
+Pack LVGL images, GIFs and fonts into an asset bundle for a flash partition.
+
+The device side is src/liblvgl/v9/port/lv_port_asset.c. The bundle is an
+8 byte header
+
+    magic:4 ("LVAS") | version:2 | count:2 (little endian)
+
+then count 32 byte entries
+
+    name:24 | offset:4 | size:4
+
+then the assets, each at a 4 byte boundary. Names are the file names
+unless given as name=path. Images should be LVGL v9 binary images (.bin
+from the LVGL image converter), other files are stored as they are.
+
+    python3 lv_asset_pack.py bg.bin logo.bin walk=ducky_walk.gif -o assets.bin
+
+Flash the result at the start of the asset partition.
+"""
+
+import argparse
+import os
+import struct
+import sys
+
+MAGIC = b"LVAS"
+VERSION = 1
+NAME_LEN = 24
+ALIGN = 4
+HEAD = struct.Struct("<4sHH")
+ENTRY = struct.Struct("<%dsII" % NAME_LEN)
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Pack assets into an LVGL asset bundle")
+    ap.add_argument("inputs", nargs="+", help="asset files, name=path to set the name")
+    ap.add_argument("-o", "--output", required=True, help="bundle file")
+    ap.add_argument("--max-size", type=lambda s: int(s, 0), help="asset partition size, fail when over it")
+    args = ap.parse_args()
+
+    assets = []
+    for arg in args.inputs:
+        name, sep, path = arg.partition("=")
+        if not sep:
+            name, path = os.path.basename(arg), arg
+        if len(name.encode()) > NAME_LEN:
+            ap.error("name %s longer than %d bytes" % (name, NAME_LEN))
+        if any(name == n for n, _ in assets):
+            ap.error("name %s given twice" % name)
+        with open(path, "rb") as f:
+            assets.append((name, f.read()))
+
+    offset = HEAD.size + ENTRY.size * len(assets)
+    table = bytearray()
+    data = bytearray()
+    for name, blob in assets:
+        pad = -(offset + len(data)) % ALIGN
+        data += b"\0" * pad
+        table += ENTRY.pack(name.encode(), offset + len(data), len(blob))
+        data += blob
+
+    bundle = HEAD.pack(MAGIC, VERSION, len(assets)) + table + data
+    if args.max_size is not None and len(bundle) > args.max_size:
+        print("bundle %d bytes over the partition %d" % (len(bundle), args.max_size), file=sys.stderr)
+        sys.exit(1)
+
+    with open(args.output, "wb") as f:
+        f.write(bundle)
+    print("%s: %d assets, %d bytes" % (args.output, len(assets), len(bundle)), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
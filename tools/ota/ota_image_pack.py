@@ -0,0 +1,158 @@
+#!/usr/bin/env python3
+# coding=utf-8
+"""
+Pack a firmware binary into a compressed OTA image.
+
+The device side is src/tuya_cloud_service/cloud/tuya_ota_image.c. The
+image is a 16 byte header
+
+    magic:4 ("TYHS") | version:1 | window_bits:1 | lookahead_bits:1 |
+    reserved:1 | image_size:4 | reserved:4 (little endian)
+
+followed by the heatshrink (LZSS) bit stream of the firmware. Upload the
+packed file as the OTA firmware, the device expands it while writing flash.
+
+    python3 ota_image_pack.py app_ug.bin -o app_ug.hs.bin
+    python3 ota_image_pack.py app_ug.bin --check   # decode and compare too
+
+The window must not exceed OTA_IMAGE_WINDOW_BITS_MAX of the device build.
+"""
+
+import argparse
+import struct
+import sys
+
+MAGIC = b"TYHS"
+VERSION = 1
+HEAD = struct.Struct("<4sBBBBII")
+
+# candidates kept per 3 byte prefix while searching for matches
+CHAIN_DEPTH = 64
+
+
+class BitWriter:
+    def __init__(self):
+        self.out = bytearray()
+        self.acc = 0
+        self.bits = 0
+
+    def put(self, value, count):
+        for i in range(count - 1, -1, -1):
+            self.acc = (self.acc << 1) | ((value >> i) & 1)
+            self.bits += 1
+            if self.bits == 8:
+                self.out.append(self.acc)
+                self.acc = 0
+                self.bits = 0
+
+    def flush(self):
+        if self.bits:
+            self.out.append(self.acc << (8 - self.bits))
+            self.acc = 0
+            self.bits = 0
+        return bytes(self.out)
+
+
+def compress(data, window_bits, lookahead_bits):
+    window = 1 << window_bits
+    max_count = 1 << lookahead_bits
+    # a reference costs 1 + window_bits + lookahead_bits, a literal 9 bits
+    min_count = (1 + window_bits + lookahead_bits) // 9 + 1
+    chains = {}
+    writer = BitWriter()
+
+    pos = 0
+    while pos < len(data):
+        best_len, best_dist = 0, 0
+        if pos + 3 <= len(data):
+            limit = min(max_count, len(data) - pos)
+            for cand in reversed(chains.get(data[pos:pos + 3], ())):
+                dist = pos - cand
+                if dist > window:
+                    break
+                length = 3
+                while length < limit and data[cand + length] == data[pos + length]:
+                    length += 1
+                if length > best_len:
+                    best_len, best_dist = length, dist
+                    if length == limit:
+                        break
+
+        step = best_len if best_len >= min_count else 1
+        if step > 1:
+            writer.put(0, 1)
+            writer.put(best_dist - 1, window_bits)
+            writer.put(best_len - 1, lookahead_bits)
+        else:
+            writer.put(1, 1)
+            writer.put(data[pos], 8)
+
+        for i in range(pos, min(pos + step, len(data) - 2)):
+            chain = chains.setdefault(data[i:i + 3], [])
+            chain.append(i)
+            if len(chain) > CHAIN_DEPTH:
+                del chain[0]
+        pos += step
+
+    return writer.flush()
+
+
+def decompress(stream, size, window_bits, lookahead_bits):
+    """Reference decoder, mirrors ota_image_decode()."""
+    out = bytearray()
+    bit_pos = 0
+
+    def get(count):
+        nonlocal bit_pos
+        value = 0
+        for _ in range(count):
+            byte = stream[bit_pos >> 3]
+            value = (value << 1) | ((byte >> (7 - (bit_pos & 7))) & 1)
+            bit_pos += 1
+        return value
+
+    while len(out) < size:
+        if get(1):
+            out.append(get(8))
+            continue
+        dist = get(window_bits) + 1
+        count = get(lookahead_bits) + 1
+        for _ in range(count):
+            if len(out) >= size:
+                break
+            out.append(out[-dist] if dist <= len(out) else 0)
+    return bytes(out)
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Pack a firmware binary into a compressed OTA image")
+    ap.add_argument("input", help="firmware binary")
+    ap.add_argument("-o", "--output", help="packed image (default <input>.hs)")
+    ap.add_argument("-w", "--window-bits", type=int, default=12, help="window bits, 4..15 (default %(default)d)")
+    ap.add_argument("-l", "--lookahead-bits", type=int, default=5, help="lookahead bits (default %(default)d)")
+    ap.add_argument("--check", action="store_true", help="decode the result and compare with the input")
+    args = ap.parse_args()
+
+    if not 4 <= args.window_bits <= 15 or not 3 <= args.lookahead_bits < args.window_bits:
+        ap.error("need 4 <= window bits <= 15 and 3 <= lookahead bits < window bits")
+
+    with open(args.input, "rb") as f:
+        data = f.read()
+    if not data:
+        ap.error("empty input")
+
+    stream = compress(data, args.window_bits, args.lookahead_bits)
+    head = HEAD.pack(MAGIC, VERSION, args.window_bits, args.lookahead_bits, 0, len(data), 0)
+    if args.check and decompress(stream, len(data), args.window_bits, args.lookahead_bits) != data:
+        print("check failed, decoded image differs", file=sys.stderr)
+        sys.exit(1)
+
+    output = args.output or args.input + ".hs"
+    with open(output, "wb") as f:
+        f.write(head + stream)
+    packed = len(head) + len(stream)
+    print("%s: %d -> %d bytes (%.1f%%)" % (output, len(data), packed, packed * 100.0 / len(data)), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -132,6 +132,52 @@ OPERATE_RET tkl_aes_crypt_ecb(TKL_SYMMETRY_HANDLE ctx, int32_t mode, size_t leng
 OPERATE_RET tkl_aes_crypt_cbc(TKL_SYMMETRY_HANDLE ctx, int32_t mode, size_t length, uint8_t iv[16],
                               const uint8_t *input, uint8_t *output);
 
+/**
+ * @brief This function performs a one-shot AES-GCM encryption and produces the tag.
+ *
+ * @param[in] key      The AES key.
+ * @param[in] keybits  The key size in bits, 128 or 256.
+ * @param[in] iv       The initialization vector.
+ * @param[in] iv_len   The length of the IV in Bytes.
+ * @param[in] add      The additional data, may be NULL when \p add_len is 0.
+ * @param[in] add_len  The length of the additional data in Bytes.
+ * @param[in] length   The length of the input data in Bytes.
+ * @param[in] input    The plaintext, \p length Bytes.
+ * @param[out] output  The ciphertext, \p length Bytes. It may be \p input.
+ * @param[out] tag     The buffer for the tag.
+ * @param[in] tag_len  The length of the tag, 4 to 16 Bytes.
+ *
+ * @note Implement this when the platform has a GCM engine and define
+ *       ENABLE_PLATFORM_AES_GCM, otherwise the mbedtls version is used.
+ * @return OPRT_OK on success. Others on error, please refer to tuya_error_code.h
+ */
+OPERATE_RET tkl_aes_gcm_encrypt_and_tag(const uint8_t *key, uint32_t keybits, const uint8_t *iv, size_t iv_len,
+                                        const uint8_t *add, size_t add_len, size_t length, const uint8_t *input,
+                                        uint8_t *output, uint8_t *tag, size_t tag_len);
+
+/**
+ * @brief This function performs a one-shot AES-GCM decryption and checks the tag.
+ *
+ * @param[in] key      The AES key.
+ * @param[in] keybits  The key size in bits, 128 or 256.
+ * @param[in] iv       The initialization vector.
+ * @param[in] iv_len   The length of the IV in Bytes.
+ * @param[in] add      The additional data, may be NULL when \p add_len is 0.
+ * @param[in] add_len  The length of the additional data in Bytes.
+ * @param[in] tag      The tag to check.
+ * @param[in] tag_len  The length of the tag, 4 to 16 Bytes.
+ * @param[in] length   The length of the input data in Bytes.
+ * @param[in] input    The ciphertext, \p length Bytes.
+ * @param[out] output  The plaintext, \p length Bytes. It may be \p input.
+ *
+ * @note The output must not be used when the tag does not match.
+ * @return OPRT_OK on success, OPRT_COM_ERROR when the tag does not match.
+ * Others on error, please refer to tuya_error_code.h
+ */
+OPERATE_RET tkl_aes_gcm_auth_decrypt(const uint8_t *key, uint32_t keybits, const uint8_t *iv, size_t iv_len,
+                                     const uint8_t *add, size_t add_len, const uint8_t *tag, size_t tag_len,
+                                     size_t length, const uint8_t *input, uint8_t *output);
+
 #ifdef __cplusplus
 }
 #endif
@@ -89,6 +89,18 @@ void *tkl_system_realloc(void *ptr, size_t size);
  */
 int tkl_system_get_free_heap_size(void);
 
+/**
+ * @brief Get the largest block one allocation can get
+ *
+ * @param none
+ *
+ * @note Implement this and define ENABLE_PLATFORM_HEAP_INFO when the heap
+ *       can report it, otherwise tal bisects trial allocations.
+ *
+ * @return largest free block size
+ */
+int tkl_system_get_largest_free_block(void);
+
 /**
  * @brief Compare two pieces of memory
  *
@@ -71,6 +71,18 @@ SYS_TICK_T tkl_system_get_tick_count(void);
  */
 SYS_TIME_T tkl_system_get_millisecond(void);
 
+/**
+ * @brief Get system microsecond
+ *
+ * @param none
+ *
+ * @note Only used with ENABLE_TAL_TRACE, should be cheap enough to call from
+ * an isr, e.g. a cpu cycle counter scaled to us.
+ *
+ * @return microseconds since boot, monotonic
+ */
+uint64_t tkl_system_get_microsecond(void);
+
 /**
  * @brief Get system random data
  *
@@ -126,6 +126,31 @@ OPERATE_RET tkl_thread_set_priority(TKL_THREAD_HANDLE thread, int priority);
  */
 OPERATE_RET tkl_thread_diagnose(TKL_THREAD_HANDLE thread);
 
+/**
+ * @brief Pin the thread to a cpu core
+ *
+ * @param[in] thread: thread handle
+ * @param[in] core: the core index
+ *
+ * @note Only used with ENABLE_THREAD_AFFINITY, for multi core platforms.
+ *
+ * @return OPRT_OK on success. Others on error, please refer to tuya_error_code.h
+ */
+OPERATE_RET tkl_thread_set_affinity(TKL_THREAD_HANDLE thread, int core);
+
+/**
+ * @brief Get the cpu time and the context switches of a thread
+ *
+ * @param[in] thread: thread handle
+ * @param[out] run_time_us: cpu time since the thread was created, in us
+ * @param[out] switches: times the thread was switched in, 0 if not counted
+ *
+ * @note Only used with ENABLE_THREAD_RUNTIME, e.g. FreeRTOS run time stats.
+ *
+ * @return OPRT_OK on success. Others on error, please refer to tuya_error_code.h
+ */
+OPERATE_RET tkl_thread_get_runtime(TKL_THREAD_HANDLE thread, uint64_t *run_time_us, uint32_t *switches);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
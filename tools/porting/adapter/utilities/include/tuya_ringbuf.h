@@ -4,6 +4,10 @@
  * @version 1.0.0
  * @date 2021-06-03
  *
+ * One producer and one consumer thread may use a ringbuff without a lock:
+ * write/reserve/commit on one side, read/peek/acquire/release/discard on the
+ * other. More writers or readers, and reset, need the caller's mutex.
+ *
  * @copyright Copyright 2018-2021 Tuya Inc. All Rights Reserved.
  *
  */
@@ -25,6 +29,15 @@ typedef enum {
     OVERFLOW_PSRAM_COVERAGE_TYPE = OVERFLOW_COVERAGE_TYPE, ///< PSRAM variant (maps to normal for non-MCU platforms)
 } RINGBUFF_TYPE_E;
 
+/**
+ * @brief contiguous regions of the ringbuff, the second one is used when the
+ * region wraps around the end of the buff
+ */
+typedef struct {
+    uint8_t *data[2];
+    uint32_t len[2];
+} TUYA_RINGBUFF_SPAN_T;
+
 /**
  * @brief ringbuff create
  *
@@ -104,6 +117,18 @@ uint32_t tuya_ring_buff_discard(TUYA_RINGBUFF_T ringbuff, uint32_t len);
  */
 uint32_t tuya_ring_buff_peek(TUYA_RINGBUFF_T ringbuff, void *data, uint32_t len);
 
+/**
+ * @brief ringbuff linear peek
+ * this API returns a pointer into the ringbuff instead of copying, use
+ * tuya_ring_buff_discard() to release the bytes once they are consumed
+ *
+ * @param[in]   ringbuff: ringbuff handle
+ * @param[out]  data:     point to the first unread byte
+ * @return  length of the unread data that is contiguous from *data, this is
+ *          less than the used size when the unread data wraps around
+ */
+uint32_t tuya_ring_buff_peek_linear(TUYA_RINGBUFF_T ringbuff, uint8_t **data);
+
 /**
  * @brief ringbuff data write
  *
@@ -114,6 +139,50 @@ uint32_t tuya_ring_buff_peek(TUYA_RINGBUFF_T ringbuff, void *data, uint32_t len)
  */
 uint32_t tuya_ring_buff_write(TUYA_RINGBUFF_T ringbuff, const void *data, uint32_t len);
 
+/**
+ * @brief ringbuff write reserve
+ * this API returns the free area to write into in place, the bytes are
+ * readable only after tuya_ring_buff_write_commit()
+ *
+ * @param[in]   ringbuff: ringbuff handle
+ * @param[in]   len:      wanted len
+ * @param[out]  span:     free area, up to two regions
+ * @return  length reserved, less than len when the ringbuff is short of room
+ */
+uint32_t tuya_ring_buff_write_reserve(TUYA_RINGBUFF_T ringbuff, uint32_t len, TUYA_RINGBUFF_SPAN_T *span);
+
+/**
+ * @brief ringbuff write commit
+ * this API publishes the first len reserved bytes to the reader
+ *
+ * @param[in]   ringbuff: ringbuff handle
+ * @param[in]   len:      written len, up to the reserved len
+ * @return  length committed
+ */
+uint32_t tuya_ring_buff_write_commit(TUYA_RINGBUFF_T ringbuff, uint32_t len);
+
+/**
+ * @brief ringbuff read acquire
+ * this API returns the unread area to read in place, the bytes stay in the
+ * ringbuff until tuya_ring_buff_read_release()
+ *
+ * @param[in]   ringbuff: ringbuff handle
+ * @param[in]   len:      wanted len
+ * @param[out]  span:     unread area, up to two regions
+ * @return  length acquired, less than len when the ringbuff holds less
+ */
+uint32_t tuya_ring_buff_read_acquire(TUYA_RINGBUFF_T ringbuff, uint32_t len, TUYA_RINGBUFF_SPAN_T *span);
+
+/**
+ * @brief ringbuff read release
+ * this API frees the first len acquired bytes for the writer
+ *
+ * @param[in]   ringbuff: ringbuff handle
+ * @param[in]   len:      consumed len
+ * @return  length released
+ */
+uint32_t tuya_ring_buff_read_release(TUYA_RINGBUFF_T ringbuff, uint32_t len);
+
 #ifdef __cplusplus
 }
 #endif
@@ -7,6 +7,11 @@
 #define GET_MIN(x, y) ((x) < (y) ? (x) : (y))
 #define GET_MAX(x, y) ((x) > (y) ? (x) : (y))
 
+// in is only stored by the producer and out only by the consumer, each after
+// the data it covers is written or read, so one of each needs no lock
+#define RINGBUFF_LOAD(pos)       __atomic_load_n(&(pos), __ATOMIC_ACQUIRE)
+#define RINGBUFF_STORE(pos, val) __atomic_store_n(&(pos), (val), __ATOMIC_RELEASE)
+
 /*
  * ringbuff structure
  */
@@ -22,11 +27,41 @@ typedef struct {
 
 static void __ringbuff_init(__RINGBUFF_T *ringbuff, uint32_t len)
 {
-    ringbuff->in = 0;
-    ringbuff->out = 0;
+    RINGBUFF_STORE(ringbuff->in, 0);
+    RINGBUFF_STORE(ringbuff->out, 0);
     ringbuff->len = len;
 }
 
+static uint32_t __ringbuff_used(__RINGBUFF_T *rbuff, uint32_t in, uint32_t out)
+{
+    return (in >= out) ? in - out : rbuff->len - (out - in);
+}
+
+// One byte stays unused so that in == out only means empty
+static uint32_t __ringbuff_free(__RINGBUFF_T *rbuff, uint32_t in, uint32_t out)
+{
+    return rbuff->len - 1 - __ringbuff_used(rbuff, in, out);
+}
+
+static uint32_t __ringbuff_advance(__RINGBUFF_T *rbuff, uint32_t pos, uint32_t len)
+{
+    pos += len;
+    return (pos >= rbuff->len) ? pos - rbuff->len : pos;
+}
+
+// Split len bytes from pos into the part up to the end of the buff and the rest
+static uint32_t __ringbuff_span(__RINGBUFF_T *rbuff, uint32_t pos, uint32_t len, TUYA_RINGBUFF_SPAN_T *span)
+{
+    uint32_t tmp_len = GET_MIN(rbuff->len - pos, len);
+
+    span->data[0] = &rbuff->buff[pos];
+    span->len[0] = tmp_len;
+    span->data[1] = (len > tmp_len) ? rbuff->buff : NULL;
+    span->len[1] = len - tmp_len;
+
+    return len;
+}
+
 OPERATE_RET tuya_ring_buff_create(uint32_t len, RINGBUFF_TYPE_E type, TUYA_RINGBUFF_T *ringbuff)
 {
     __RINGBUFF_T *rbuff = NULL;
@@ -77,183 +112,155 @@ OPERATE_RET tuya_ring_buff_reset(TUYA_RINGBUFF_T ringbuff)
 
 uint32_t tuya_ring_buff_free_size_get(TUYA_RINGBUFF_T ringbuff)
 {
-    uint32_t size, in, out;
     __RINGBUFF_T *rbuff = (__RINGBUFF_T *)ringbuff;
 
     if (rbuff == NULL) {
         return 0;
     }
 
-    in = rbuff->in;
-    out = rbuff->out;
-    if (in == out) {
-        size = rbuff->len;
-    } else if (out > in) {
-        size = out - in;
-    } else {
-        size = rbuff->len - (in - out);
-    }
-
-    return size - 1;
+    return __ringbuff_free(rbuff, RINGBUFF_LOAD(rbuff->in), RINGBUFF_LOAD(rbuff->out));
 }
 
 uint32_t tuya_ring_buff_used_size_get(TUYA_RINGBUFF_T ringbuff)
 {
-    uint32_t size, in, out;
     __RINGBUFF_T *rbuff = (__RINGBUFF_T *)ringbuff;
 
     if (rbuff == NULL) {
         return 0;
     }
 
-    in = rbuff->in;
-    out = rbuff->out;
-    if (in == out) {
-        size = 0;
-    } else if (in > out) {
-        size = in - out;
-    } else {
-        size = rbuff->len - (out - in);
-    }
-
-    return size;
+    return __ringbuff_used(rbuff, RINGBUFF_LOAD(rbuff->in), RINGBUFF_LOAD(rbuff->out));
 }
 
-uint32_t tuya_ring_buff_write(TUYA_RINGBUFF_T ringbuff, const void *data, uint32_t len)
+uint32_t tuya_ring_buff_write_reserve(TUYA_RINGBUFF_T ringbuff, uint32_t len, TUYA_RINGBUFF_SPAN_T *span)
 {
-    uint32_t tmp_len;
-    uint32_t free_len;
-    const uint8_t *pdata = data;
+    uint32_t in;
     __RINGBUFF_T *rbuff = (__RINGBUFF_T *)ringbuff;
 
-    if (rbuff == NULL || data == NULL || len == 0) {
-        return 0;
-    }
-    // overwriting unread parts is not supported when the write is full
-    free_len = tuya_ring_buff_free_size_get(rbuff);
-    len = GET_MIN(free_len, len);
-    if (len == 0) {
+    if (rbuff == NULL || span == NULL) {
         return 0;
     }
 
-    // write data to remaining buff
-    tmp_len = GET_MIN(rbuff->len - rbuff->in, len);
-    memcpy(&rbuff->buff[rbuff->in], pdata, tmp_len);
-    rbuff->in += tmp_len;
-    len -= tmp_len;
+    in = RINGBUFF_LOAD(rbuff->in);
+    len = GET_MIN(__ringbuff_free(rbuff, in, RINGBUFF_LOAD(rbuff->out)), len);
 
-    // write remaining data to beginning of buffer
-    if (len > 0) {
-        memcpy(rbuff->buff, &pdata[tmp_len], len);
-        rbuff->in = len;
-    }
+    return __ringbuff_span(rbuff, in, len, span);
+}
+
+uint32_t tuya_ring_buff_write_commit(TUYA_RINGBUFF_T ringbuff, uint32_t len)
+{
+    uint32_t in;
+    __RINGBUFF_T *rbuff = (__RINGBUFF_T *)ringbuff;
 
-    // buff loopback check
-    if (rbuff->in >= rbuff->len) {
-        rbuff->in = 0;
+    if (rbuff == NULL || len == 0) {
+        return 0;
     }
 
-    return tmp_len + len;
+    in = RINGBUFF_LOAD(rbuff->in);
+    len = GET_MIN(__ringbuff_free(rbuff, in, RINGBUFF_LOAD(rbuff->out)), len);
+    RINGBUFF_STORE(rbuff->in, __ringbuff_advance(rbuff, in, len));
+
+    return len;
 }
 
-uint32_t tuya_ring_buff_read(TUYA_RINGBUFF_T ringbuff, void *data, uint32_t len)
+uint32_t tuya_ring_buff_read_acquire(TUYA_RINGBUFF_T ringbuff, uint32_t len, TUYA_RINGBUFF_SPAN_T *span)
 {
-    uint32_t tmp_len;
-    uint32_t used_len;
-    uint8_t *pdata = data;
+    uint32_t out;
     __RINGBUFF_T *rbuff = (__RINGBUFF_T *)ringbuff;
 
-    if (rbuff == NULL || data == NULL || len == 0) {
+    if (rbuff == NULL || span == NULL) {
         return 0;
     }
 
-    used_len = tuya_ring_buff_used_size_get(rbuff);
-    len = GET_MIN(used_len, len);
+    out = RINGBUFF_LOAD(rbuff->out);
+    len = GET_MIN(__ringbuff_used(rbuff, RINGBUFF_LOAD(rbuff->in), out), len);
+
+    return __ringbuff_span(rbuff, out, len, span);
+}
+
+uint32_t tuya_ring_buff_read_release(TUYA_RINGBUFF_T ringbuff, uint32_t len)
+{
+    return tuya_ring_buff_discard(ringbuff, len);
+}
+
+uint32_t tuya_ring_buff_write(TUYA_RINGBUFF_T ringbuff, const void *data, uint32_t len)
+{
+    TUYA_RINGBUFF_SPAN_T span;
+    const uint8_t *pdata = data;
+
+    if (ringbuff == NULL || data == NULL || len == 0) {
+        return 0;
+    }
+    // overwriting unread parts is not supported when the write is full
+    len = tuya_ring_buff_write_reserve(ringbuff, len, &span);
     if (len == 0) {
         return 0;
     }
 
-    // read data from linear part of buffer
-    tmp_len = GET_MIN(rbuff->len - rbuff->out, len);
-    memcpy(pdata, &rbuff->buff[rbuff->out], tmp_len);
-    rbuff->out += tmp_len;
-    len -= tmp_len;
-
-    // read data from beginning of buffer (overflow part)
-    if (len > 0) {
-        memcpy(&pdata[tmp_len], rbuff->buff, len);
-        rbuff->out = len;
+    // write data to remaining buff, then the rest to beginning of buffer
+    memcpy(span.data[0], pdata, span.len[0]);
+    if (span.len[1] > 0) {
+        memcpy(span.data[1], &pdata[span.len[0]], span.len[1]);
     }
 
-    // check end of buffer
-    if (rbuff->out >= rbuff->len) {
-        rbuff->out = 0;
-    }
+    return tuya_ring_buff_write_commit(ringbuff, len);
+}
 
-    return tmp_len + len;
+uint32_t tuya_ring_buff_read(TUYA_RINGBUFF_T ringbuff, void *data, uint32_t len)
+{
+    len = tuya_ring_buff_peek(ringbuff, data, len);
+
+    return tuya_ring_buff_discard(ringbuff, len);
 }
 
 uint32_t tuya_ring_buff_discard(TUYA_RINGBUFF_T ringbuff, uint32_t len)
 {
-    uint32_t tmp_len;
-    uint32_t used_len;
+    uint32_t out;
     __RINGBUFF_T *rbuff = (__RINGBUFF_T *)ringbuff;
 
     if(rbuff == NULL || len == 0) {
         return 0;
     }
 
-    used_len = tuya_ring_buff_used_size_get(rbuff);
-    len = GET_MIN(used_len, len);
-    if (len == 0) {
-        return 0;
-    }
+    out = RINGBUFF_LOAD(rbuff->out);
+    len = GET_MIN(__ringbuff_used(rbuff, RINGBUFF_LOAD(rbuff->in), out), len);
+    RINGBUFF_STORE(rbuff->out, __ringbuff_advance(rbuff, out, len));
 
-    // discard data from linear part of buffer
-    tmp_len = GET_MIN(rbuff->len - rbuff->out, len);
-    rbuff->out += tmp_len;
-    len -= tmp_len;
-
-    // discard data from beginning of buffer (overflow part)
-    if (len > 0) {
-        rbuff->out = len;
-    }
-
-    // check end of buffer
-    if (rbuff->out >= rbuff->len) {
-        rbuff->out = 0;
-    }
-
-    return tmp_len + len;
+    return len;
 }
 
 uint32_t tuya_ring_buff_peek(TUYA_RINGBUFF_T ringbuff, void *data, uint32_t len)
 {
-    uint32_t out;
-    uint32_t tmp_len;
-    uint32_t used_len;
+    TUYA_RINGBUFF_SPAN_T span;
     uint8_t *pdata = data;
-    __RINGBUFF_T *rbuff = (__RINGBUFF_T *)ringbuff;
 
-    if (rbuff == NULL || data == NULL || len == 0) {
+    if (ringbuff == NULL || data == NULL || len == 0) {
         return 0;
     }
 
-    out = rbuff->out;
-    used_len = tuya_ring_buff_used_size_get(rbuff);
-
-    len = GET_MIN(len, used_len);
+    len = tuya_ring_buff_read_acquire(ringbuff, len, &span);
     if (len == 0) {
         return 0;
     }
 
-    tmp_len = GET_MIN(rbuff->len - out, len);
-    memcpy(pdata, &rbuff->buff[out], tmp_len);
-    len -= tmp_len;
+    memcpy(pdata, span.data[0], span.len[0]);
+    if (span.len[1] > 0) {
+        memcpy(&pdata[span.len[0]], span.data[1], span.len[1]);
+    }
+
+    return len;
+}
 
-    if (len > 0) {
-        memcpy(&pdata[tmp_len], rbuff->buff, len);
+uint32_t tuya_ring_buff_peek_linear(TUYA_RINGBUFF_T ringbuff, uint8_t **data)
+{
+    TUYA_RINGBUFF_SPAN_T span;
+
+    if (ringbuff == NULL || data == NULL) {
+        return 0;
     }
 
-    return tmp_len + len;
+    tuya_ring_buff_read_acquire(ringbuff, (uint32_t)-1, &span);
+    *data = span.data[0];
+
+    return span.len[0];
 }
@@ -66,6 +66,22 @@ SYS_TIME_T tkl_system_get_millisecond(void)
     // --- END: user implements ---
 }
 
+/**
+ * @brief Get system microsecond
+ *
+ * @param none
+ *
+ * @return microseconds since boot, monotonic
+ */
+uint64_t tkl_system_get_microsecond(void)
+{
+    // --- BEGIN: user implements ---
+    struct timespec time1 = {0, 0};
+    clock_gettime(CLOCK_MONOTONIC, &time1);
+    return (uint64_t)time1.tv_sec * 1000000 + (uint64_t)time1.tv_nsec / 1000;
+    // --- END: user implements ---
+}
+
 /**
  * @brief Get system random data
  *
@@ -0,0 +1,41 @@
+/**
+ * @file bench_cases.h
+ * @brief Case tables of the micro-benchmark suite, one register call per area
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ */
+
+#ifndef __BENCH_CASES_H__
+#define __BENCH_CASES_H__
+
+#include "tuya_bench.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief tuya_ring_buff write/read and G.711 u-law encode/decode
+ */
+void bench_utilities_register(void);
+
+/**
+ * @brief tal_kv set/get
+ */
+void bench_kv_register(void);
+
+/**
+ * @brief lpv35 frames, DP report JSON and AI protocol packets
+ */
+void bench_cloud_register(void);
+
+/**
+ * @brief minimp3 frame decode and display rotation
+ */
+void bench_media_register(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BENCH_CASES_H__ */
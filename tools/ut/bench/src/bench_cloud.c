@@ -0,0 +1,283 @@
+/**
+ * @file bench_cloud.c
+ * @brief lpv35 frame, DP report JSON and AI packet cases
+ *
+ * lpv35 frames carry arg bytes of payload through AES-GCM with a fixed
+ * key. The DP case reports arg DPs of a 16 DP schema with the filter off,
+ * through dp_rept_valid_check() and dp_rept_json_output() like
+ * tuya_iot_dp_obj_report() does. The AI packet case needs the tuya_ai_basic
+ * component built with ENABLE_AI_PROTO_BENCH, see the CMakeLists.txt.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ */
+
+#include "bench_cases.h"
+#include "tal_api.h"
+#include "tuya_protocol.h"
+#include "dp_schema.h"
+#if defined(ENABLE_AI_PROTO_BENCH) && (ENABLE_AI_PROTO_BENCH == 1)
+#include "tuya_ai_protocol.h"
+#endif
+#include <stdio.h>
+#include <string.h>
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+#define BENCH_PAYLOAD_MAX   4096
+#define BENCH_FRAME_TYPE    0x07    /* FRM_TP_CMD */
+
+#define BENCH_DP_DEVID      "bench_dev"
+#define BENCH_DP_NUM        16
+#define BENCH_SCHEMA_LEN    2048
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static const uint8_t sg_key[16] = "0123456789abcdef";
+
+static uint8_t sg_payload[BENCH_PAYLOAD_MAX];
+static uint8_t sg_frame[BENCH_PAYLOAD_MAX + LPV35_FRAME_MINI_SIZE + 64];
+static uint8_t sg_frame_copy[sizeof(sg_frame)];
+
+static dp_schema_t *sg_schema = NULL;
+static char sg_schema_json[BENCH_SCHEMA_LEN];
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+
+static void __bench_payload_fill(uint32_t len)
+{
+    /* Printable like the JSON the frames usually carry */
+    for (uint32_t i = 0; i < len; i++) {
+        sg_payload[i] = (uint8_t)('a' + i % 26);
+    }
+}
+
+static int __bench_frame_build(uint32_t len)
+{
+    lpv35_frame_object_t obj = {
+        .sequence = 1,
+        .type = BENCH_FRAME_TYPE,
+        .data = sg_payload,
+        .data_len = len,
+    };
+    int olen = 0;
+
+    __bench_payload_fill(len);
+    if (OPRT_OK != lpv35_frame_serialize(sg_key, sizeof(sg_key), &obj, sg_frame, &olen)) {
+        return -1;
+    }
+    return olen;
+}
+
+static void __bench_lpv35_serialize(TUYA_BENCH_STATE_T *st)
+{
+    uint32_t len = (uint32_t)st->arg;
+    lpv35_frame_object_t obj = {
+        .type = BENCH_FRAME_TYPE,
+        .data = sg_payload,
+        .data_len = len,
+    };
+
+    __bench_payload_fill(len);
+    while (tuya_bench_keep_running(st)) {
+        int olen = 0;
+        obj.sequence++;
+        if (OPRT_OK != lpv35_frame_serialize(sg_key, sizeof(sg_key), &obj, sg_frame, &olen)) {
+            tuya_bench_skip(st, "lpv35_frame_serialize failed");
+        }
+        tuya_bench_clobber();
+    }
+    st->bytes_per_iter = len;
+}
+
+static void __bench_lpv35_parse(TUYA_BENCH_STATE_T *st)
+{
+    uint32_t len = (uint32_t)st->arg;
+    int flen = __bench_frame_build(len);
+
+    if (flen < 0) {
+        tuya_bench_skip(st, "lpv35_frame_serialize failed");
+        return;
+    }
+
+    while (tuya_bench_keep_running(st)) {
+        lpv35_frame_object_t out = {0};
+        if (OPRT_OK != lpv35_frame_parse(sg_key, sizeof(sg_key), sg_frame, flen, &out)) {
+            tuya_bench_skip(st, "lpv35_frame_parse failed");
+            break;
+        }
+        tal_free(out.data);
+    }
+    st->bytes_per_iter = len;
+}
+
+static void __bench_lpv35_parse_inplace(TUYA_BENCH_STATE_T *st)
+{
+    uint32_t len = (uint32_t)st->arg;
+    int flen = __bench_frame_build(len);
+
+    if (flen < 0) {
+        tuya_bench_skip(st, "lpv35_frame_serialize failed");
+        return;
+    }
+
+    /* Decrypting overwrites the frame, so the time includes one frame copy */
+    while (tuya_bench_keep_running(st)) {
+        lpv35_frame_object_t out = {0};
+        memcpy(sg_frame_copy, sg_frame, flen);
+        if (OPRT_OK != lpv35_frame_parse_inplace(sg_key, sizeof(sg_key), sg_frame_copy, flen, &out)) {
+            tuya_bench_skip(st, "lpv35_frame_parse_inplace failed");
+        }
+        tuya_bench_do_not_optimize(out.data);
+    }
+    st->bytes_per_iter = len;
+}
+
+/**
+ * @brief Bool, value, enum and string DPs in turn, ids 1..BENCH_DP_NUM
+ */
+static OPERATE_RET __bench_schema_create(void)
+{
+    int off = 0;
+
+    if (sg_schema) {
+        return OPRT_OK;
+    }
+
+    off += snprintf(sg_schema_json + off, sizeof(sg_schema_json) - off, "[");
+    for (int id = 1; id <= BENCH_DP_NUM; id++) {
+        const char *prop = NULL;
+        switch (id % 4) {
+        case 0:
+            prop = "{\"type\":\"bool\"}";
+            break;
+        case 1:
+            prop = "{\"type\":\"value\",\"max\":10000,\"min\":0,\"scale\":0}";
+            break;
+        case 2:
+            prop = "{\"type\":\"enum\",\"range\":[\"low\",\"middle\",\"high\"]}";
+            break;
+        default:
+            prop = "{\"type\":\"string\",\"maxlen\":255}";
+            break;
+        }
+        off += snprintf(sg_schema_json + off, sizeof(sg_schema_json) - off,
+                        "%s{\"id\":%d,\"mode\":\"rw\",\"type\":\"obj\",\"property\":%s}", (id > 1) ? "," : "", id,
+                        prop);
+    }
+    snprintf(sg_schema_json + off, sizeof(sg_schema_json) - off, "]");
+
+    return dp_schema_create(BENCH_DP_DEVID, sg_schema_json, &sg_schema);
+}
+
+static void __bench_dp_fill(dp_obj_t *dps, uint32_t num, uint32_t round)
+{
+    static char str[2][16] = {"bench text", "bench text 2"};
+
+    for (uint32_t i = 0; i < num; i++) {
+        dps[i].id = (uint8_t)(i + 1);
+        dps[i].time_stamp = 0;
+        switch (dps[i].id % 4) {
+        case 0:
+            dps[i].type = PROP_BOOL;
+            dps[i].value.dp_bool = (round & 1) ? TRUE : FALSE;
+            break;
+        case 1:
+            dps[i].type = PROP_VALUE;
+            dps[i].value.dp_value = (int)(round % 10000);
+            break;
+        case 2:
+            dps[i].type = PROP_ENUM;
+            dps[i].value.dp_enum = round % 3;
+            break;
+        default:
+            dps[i].type = PROP_STR;
+            dps[i].value.dp_str = str[round & 1];
+            break;
+        }
+    }
+}
+
+static void __bench_dp_rept_json(TUYA_BENCH_STATE_T *st)
+{
+    uint32_t num = (uint32_t)st->arg;
+    dp_obj_t dps[BENCH_DP_NUM];
+    dp_rept_valid_t *dpvalid = NULL;
+    uint32_t round = 0;
+
+    if (OPRT_OK != __bench_schema_create()) {
+        tuya_bench_skip(st, "dp_schema_create failed");
+        return;
+    }
+    dpvalid = tal_malloc(sizeof(dp_rept_valid_t) + BENCH_DP_NUM);
+    if (NULL == dpvalid) {
+        tuya_bench_skip(st, "malloc failed");
+        return;
+    }
+
+    while (tuya_bench_keep_running(st)) {
+        dp_rept_in_t dpin = {
+            .rept_type = T_OBJ_REPT,
+            .flags = DP_REPT_NO_FILTER_FLAG,
+            .dpscnt = (uint8_t)num,
+            .dps = dps,
+        };
+        dp_rept_out_t dpout = {0};
+
+        __bench_dp_fill(dps, num, round++);
+        memset(dpvalid, 0, sizeof(dp_rept_valid_t) + BENCH_DP_NUM);
+        if (OPRT_OK != dp_rept_valid_check(sg_schema, &dpin, dpvalid) ||
+            OPRT_OK != dp_rept_json_output(sg_schema, &dpin, dpvalid, &dpout)) {
+            tuya_bench_skip(st, "dp report json failed");
+            break;
+        }
+        tal_free(dpout.dpsjson);
+    }
+    st->items_per_iter = num;
+
+    tal_free(dpvalid);
+}
+
+#if defined(ENABLE_AI_PROTO_BENCH) && (ENABLE_AI_PROTO_BENCH == 1)
+static void __bench_ai_packet_write(TUYA_BENCH_STATE_T *st)
+{
+    uint32_t len = (uint32_t)st->arg;
+    AI_SEND_PACKET_T info;
+
+    __bench_payload_fill(len);
+    while (tuya_bench_keep_running(st)) {
+        memset(&info, 0, sizeof(info));
+        info.type = AI_PT_AUDIO;
+        info.data = (char *)sg_payload;
+        info.len = len;
+        info.total_len = len;
+        if (OPRT_OK != tuya_ai_basic_pkt_write_bench(&info, AI_PACKET_NO_FRAG)) {
+            tuya_bench_skip(st, "ai packet write failed");
+        }
+    }
+    st->bytes_per_iter = len;
+}
+#endif
+
+void bench_cloud_register(void)
+{
+    tuya_bench_register("lpv35/serialize", __bench_lpv35_serialize, 64);
+    tuya_bench_register("lpv35/serialize", __bench_lpv35_serialize, 1024);
+    tuya_bench_register("lpv35/parse", __bench_lpv35_parse, 64);
+    tuya_bench_register("lpv35/parse", __bench_lpv35_parse, 1024);
+    tuya_bench_register("lpv35/parse_inplace", __bench_lpv35_parse_inplace, 1024);
+
+    /* DPs per report */
+    tuya_bench_register("dp_rept/json_output", __bench_dp_rept_json, 1);
+    tuya_bench_register("dp_rept/json_output", __bench_dp_rept_json, 4);
+    tuya_bench_register("dp_rept/json_output", __bench_dp_rept_json, BENCH_DP_NUM);
+
+#if defined(ENABLE_AI_PROTO_BENCH) && (ENABLE_AI_PROTO_BENCH == 1)
+    /* One 20 ms PCM frame at 16 kHz, and a full speaker chunk */
+    tuya_bench_register("ai_packet/write", __bench_ai_packet_write, 640);
+    tuya_bench_register("ai_packet/write", __bench_ai_packet_write, 4096);
+#endif
+}
@@ -0,0 +1,81 @@
+/**
+ * @file bench_kv.c
+ * @brief tal_kv cases
+ *
+ * Every iteration rewrites or reads the same key, which is what the DP
+ * cache and the network manager do. The backend is whatever the Kconfig
+ * choice built, so run once per ENABLE_KV_* to compare them. Set cases
+ * write to flash on target, keep the filter on them short there.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ */
+
+#include "bench_cases.h"
+#include "tal_api.h"
+#include "tal_kv.h"
+#include <string.h>
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+#define BENCH_KV_KEY        "bench_kv"
+#define BENCH_KV_VALUE_MAX  1024
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static uint8_t sg_value[BENCH_KV_VALUE_MAX];
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+
+static void __bench_kv_set(TUYA_BENCH_STATE_T *st)
+{
+    size_t len = (size_t)st->arg;
+    uint32_t i = 0;
+
+    memset(sg_value, 0x3C, len);
+    while (tuya_bench_keep_running(st)) {
+        /* A changed value each time, backends may skip identical writes */
+        sg_value[0] = (uint8_t)i++;
+        if (0 != tal_kv_set(BENCH_KV_KEY, sg_value, len)) {
+            tuya_bench_skip(st, "tal_kv_set failed");
+        }
+    }
+    st->bytes_per_iter = len;
+
+    tal_kv_del(BENCH_KV_KEY);
+}
+
+static void __bench_kv_get(TUYA_BENCH_STATE_T *st)
+{
+    size_t len = (size_t)st->arg;
+
+    memset(sg_value, 0xC3, len);
+    if (0 != tal_kv_set(BENCH_KV_KEY, sg_value, len)) {
+        tuya_bench_skip(st, "tal_kv_set failed");
+        return;
+    }
+
+    while (tuya_bench_keep_running(st)) {
+        uint8_t *value = NULL;
+        size_t out_len = 0;
+        if (0 != tal_kv_get(BENCH_KV_KEY, &value, &out_len)) {
+            tuya_bench_skip(st, "tal_kv_get failed");
+            break;
+        }
+        tal_kv_free(value);
+    }
+    st->bytes_per_iter = len;
+
+    tal_kv_del(BENCH_KV_KEY);
+}
+
+void bench_kv_register(void)
+{
+    tuya_bench_register("tal_kv/set", __bench_kv_set, 64);
+    tuya_bench_register("tal_kv/set", __bench_kv_set, 1024);
+    tuya_bench_register("tal_kv/get", __bench_kv_get, 64);
+    tuya_bench_register("tal_kv/get", __bench_kv_get, 1024);
+}
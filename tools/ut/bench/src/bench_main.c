@@ -0,0 +1,183 @@
+/**
+ * @file bench_main.c
+ * @brief Entry of the micro-benchmark suite, Ubuntu command line and target task
+ *
+ * Usage on Ubuntu:
+ *   tuya_bench [--benchmark_filter=SUBSTR] [--benchmark_format=console|json]
+ *              [--benchmark_out=FILE] [--benchmark_min_time=MS]
+ *
+ * --benchmark_out writes the JSON report to FILE. On target the suite runs
+ * once at boot and prints TUYA_BENCH_TARGET_FORMAT on the log port, between
+ * marker lines so the JSON can be cut out of a serial capture.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ */
+
+#include "tuya_cloud_types.h"
+#include "tal_api.h"
+#include "tal_kv.h"
+#include "tkl_output.h"
+#include "bench_cases.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+#ifndef TUYA_BENCH_TARGET_FORMAT
+#define TUYA_BENCH_TARGET_FORMAT TUYA_BENCH_FMT_JSON
+#endif
+
+/* Substring of the cases to run on target, e.g. "lpv35"; tal_kv/set wears the flash */
+#ifndef TUYA_BENCH_TARGET_FILTER
+#define TUYA_BENCH_TARGET_FILTER NULL
+#endif
+
+#define BENCH_BEGIN_MARKER "----- tuya_bench begin -----\n"
+#define BENCH_END_MARKER   "----- tuya_bench end -----\n"
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+
+static void bench_setup(void)
+{
+    tal_log_init(TAL_LOG_LEVEL_ERR, 1024, (TAL_LOG_OUTPUT_CB)tkl_log_output);
+    tal_kv_init(&(tal_kv_cfg_t){
+        .seed = "vmlkasdh93dlvlcy",
+        .key = "dflfuap134ddlduq",
+    });
+
+    bench_utilities_register();
+    bench_kv_register();
+    bench_cloud_register();
+    bench_media_register();
+}
+
+#if OPERATING_SYSTEM == SYSTEM_LINUX
+static void bench_out_file(void *ctx, const char *str)
+{
+    fputs(str, (FILE *)ctx);
+}
+
+static bool bench_arg(const char *arg, const char *key, const char **val)
+{
+    size_t n = strlen(key);
+
+    if (strncmp(arg, key, n) != 0 || arg[n] != '=') {
+        return false;
+    }
+    *val = arg + n + 1;
+    return true;
+}
+
+static int bench_parse_args(int argc, char *argv[], TUYA_BENCH_OPT_T *opt, const char **out_file)
+{
+    const char *v = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (bench_arg(argv[i], "--benchmark_filter", &v)) {
+            opt->filter = v;
+        } else if (bench_arg(argv[i], "--benchmark_format", &v)) {
+            if (strcmp(v, "console") == 0) {
+                opt->format = TUYA_BENCH_FMT_CONSOLE;
+            } else if (strcmp(v, "json") == 0) {
+                opt->format = TUYA_BENCH_FMT_JSON;
+            } else {
+                return -1;
+            }
+        } else if (bench_arg(argv[i], "--benchmark_out", &v)) {
+            *out_file = v;
+        } else if (bench_arg(argv[i], "--benchmark_min_time", &v)) {
+            opt->min_time_ms = (uint32_t)atoi(v);
+            if (0 == opt->min_time_ms) {
+                return -1;
+            }
+        } else {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void main(int argc, char *argv[])
+{
+    TUYA_BENCH_OPT_T opt = {
+        .format = TUYA_BENCH_FMT_CONSOLE,
+        .executable = argv[0],
+        .out = bench_out_file,
+        .out_ctx = stdout,
+    };
+    const char *out_file = NULL;
+    FILE *fp = NULL;
+
+    if (bench_parse_args(argc, argv, &opt, &out_file) != 0) {
+        printf("usage: %s [--benchmark_filter=SUBSTR] [--benchmark_format=console|json]\n"
+               "          [--benchmark_out=FILE] [--benchmark_min_time=MS]\n",
+               argv[0]);
+        exit(2);
+    }
+
+    if (out_file) {
+        fp = fopen(out_file, "w");
+        if (NULL == fp) {
+            printf("cannot open %s\n", out_file);
+            exit(2);
+        }
+        opt.format = TUYA_BENCH_FMT_JSON;
+        opt.out_ctx = fp;
+    }
+
+    bench_setup();
+    OPERATE_RET rt = tuya_bench_run(&opt);
+
+    if (fp) {
+        fclose(fp);
+        printf("report written to %s\n", out_file);
+    }
+    exit((OPRT_OK == rt) ? 0 : 1);
+}
+#else
+
+/* Tuya thread handle */
+static THREAD_HANDLE ty_app_thread = NULL;
+
+static void bench_out_log(void *ctx, const char *str)
+{
+    tal_log_print_raw("%s", str);
+}
+
+/**
+ * @brief  task thread
+ *
+ * @param[in] arg:Parameters when creating a task
+ * @return none
+ */
+static void tuya_app_thread(void *arg)
+{
+    TUYA_BENCH_OPT_T opt = {
+        .format = TUYA_BENCH_TARGET_FORMAT,
+        .filter = TUYA_BENCH_TARGET_FILTER,
+        .executable = PROJECT_NAME,
+        .out = bench_out_log,
+    };
+
+    bench_setup();
+
+    tal_log_print_raw(BENCH_BEGIN_MARKER);
+    OPERATE_RET rt = tuya_bench_run(&opt);
+    tal_log_print_raw(BENCH_END_MARKER);
+    tal_log_print_raw("tuya_bench done, rt:%d\n", rt);
+
+    tal_thread_delete(ty_app_thread);
+    ty_app_thread = NULL;
+}
+
+void tuya_app_main(void)
+{
+    /* mbedtls GCM, HKDF and the DP JSON paths nest deep */
+    THREAD_CFG_T thrd_param = {16 * 1024, THREAD_PRIO_1, "tuya_bench"};
+    tal_thread_create_and_start(&ty_app_thread, NULL, NULL, tuya_app_thread, NULL, &thrd_param);
+}
+#endif
@@ -0,0 +1,168 @@
+/**
+ * @file bench_media.c
+ * @brief minimp3 frame decode and display rotation cases
+ *
+ * The MP3 case walks the frames of the "Hello Tuya" 16 kHz prompt from the
+ * audio_speaker example, one frame per iteration, with the same decoder
+ * build as ai_audio_player.c (MP3_DECODE_FAST selects its fast profile).
+ * The rotation cases turn one 320x240 RGB565 frame, arg is the angle, and
+ * are built only with ENABLE_DISPLAY.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ */
+
+#define MINIMP3_IMPLEMENTATION
+
+#if defined(MP3_DECODE_FAST) && (MP3_DECODE_FAST == 1)
+#define MINIMP3_ONLY_MP3
+#if defined(__SSE2__) && !defined(MINIMP3_NO_SIMD)
+#define MINIMP3_ONLY_SIMD
+#endif
+#endif
+
+#include "bench_cases.h"
+#include "tal_api.h"
+#include "tkl_memory.h"
+#include "minimp3.h"
+#include "app_media.h"
+#if defined(ENABLE_DISPLAY) && (ENABLE_DISPLAY == 1)
+#include "tdl_display_manage.h"
+#include "tdl_display_draw.h"
+#endif
+#include <string.h>
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+#define BENCH_MP3_FRAME_MAX 256
+
+#define BENCH_DISP_WIDTH    320
+#define BENCH_DISP_HEIGHT   240
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+/* The decoder is about 6.5 KiB, too big for a target task stack */
+static mp3dec_t sg_mp3_dec;
+static uint16_t sg_mp3_frame[BENCH_MP3_FRAME_MAX];
+static uint32_t sg_mp3_frame_num = 0;
+static mp3d_sample_t sg_mp3_pcm[MINIMP3_MAX_SAMPLES_PER_FRAME];
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+
+/**
+ * @brief Find the frame offsets once, the case then starts each decode on a header
+ */
+static uint32_t __bench_mp3_index(void)
+{
+    const uint8_t *mp3 = (const uint8_t *)media_src_hello_tuya_16k;
+    int left = (int)sizeof(media_src_hello_tuya_16k);
+    uint32_t pos = 0;
+    mp3dec_frame_info_t info;
+
+    if (sg_mp3_frame_num) {
+        return sg_mp3_frame_num;
+    }
+
+    mp3dec_init(&sg_mp3_dec);
+    while (left > 0 && sg_mp3_frame_num < BENCH_MP3_FRAME_MAX) {
+        memset(&info, 0, sizeof(info));
+        int samples = mp3dec_decode_frame(&sg_mp3_dec, mp3 + pos, left, sg_mp3_pcm, &info);
+        if (0 == info.frame_bytes) {
+            break;
+        }
+        if (samples > 0) {
+            sg_mp3_frame[sg_mp3_frame_num++] = (uint16_t)(pos + info.frame_offset);
+        }
+        pos += info.frame_bytes;
+        left -= info.frame_bytes;
+    }
+
+    return sg_mp3_frame_num;
+}
+
+static void __bench_mp3_decode(TUYA_BENCH_STATE_T *st)
+{
+    const uint8_t *mp3 = (const uint8_t *)media_src_hello_tuya_16k;
+    mp3dec_frame_info_t info;
+    uint32_t idx = 0, samples = 0;
+    uint32_t num = __bench_mp3_index();
+
+    if (0 == num) {
+        tuya_bench_skip(st, "no mp3 frame found");
+        return;
+    }
+
+    mp3dec_init(&sg_mp3_dec);
+    while (tuya_bench_keep_running(st)) {
+        /* The rest of the stream, like the player's input buffer, so the sync check sees the next header */
+        uint32_t off = sg_mp3_frame[idx];
+        samples += (uint32_t)mp3dec_decode_frame(&sg_mp3_dec, mp3 + off, (int)(sizeof(media_src_hello_tuya_16k) - off),
+                                                 sg_mp3_pcm, &info);
+        if (++idx == num) {
+            /* Restart clean, the bit reservoir of the last frame does not carry over */
+            idx = 0;
+            mp3dec_init(&sg_mp3_dec);
+        }
+    }
+    tuya_bench_do_not_optimize(samples);
+    st->items_per_iter = 1;
+}
+
+#if defined(ENABLE_DISPLAY) && (ENABLE_DISPLAY == 1)
+static void __bench_disp_rotate(TUYA_BENCH_STATE_T *st)
+{
+    TUYA_DISPLAY_ROTATION_E rot = TUYA_DISPLAY_ROTATION_90;
+    uint32_t len = BENCH_DISP_WIDTH * BENCH_DISP_HEIGHT * 2;
+
+    switch (st->arg) {
+    case 180:
+        rot = TUYA_DISPLAY_ROTATION_180;
+        break;
+    case 270:
+        rot = TUYA_DISPLAY_ROTATION_270;
+        break;
+    default:
+        break;
+    }
+
+    TDL_DISP_FRAME_BUFF_T *in_fb = tdl_disp_create_frame_buff(DISP_FB_TP_PSRAM, len);
+    TDL_DISP_FRAME_BUFF_T *out_fb = tdl_disp_create_frame_buff(DISP_FB_TP_PSRAM, len);
+    if (NULL == in_fb || NULL == out_fb) {
+        tuya_bench_skip(st, "frame buffer malloc failed");
+        goto __EXIT;
+    }
+    memset(in_fb->frame, 0x5A, len);
+
+    while (tuya_bench_keep_running(st)) {
+        in_fb->fmt = out_fb->fmt = TUYA_PIXEL_FMT_RGB565;
+        in_fb->width = BENCH_DISP_WIDTH;
+        in_fb->height = BENCH_DISP_HEIGHT;
+        if (OPRT_OK != tdl_disp_draw_rotate(rot, in_fb, out_fb, false)) {
+            tuya_bench_skip(st, "tdl_disp_draw_rotate failed");
+        }
+    }
+    st->bytes_per_iter = len;
+
+__EXIT:
+    if (in_fb) {
+        tdl_disp_free_frame_buff(in_fb);
+    }
+    if (out_fb) {
+        tdl_disp_free_frame_buff(out_fb);
+    }
+}
+#endif
+
+void bench_media_register(void)
+{
+    tuya_bench_register("minimp3/decode_frame", __bench_mp3_decode, -1);
+
+#if defined(ENABLE_DISPLAY) && (ENABLE_DISPLAY == 1)
+    tuya_bench_register("disp/draw_rotate_rgb565", __bench_disp_rotate, 90);
+    tuya_bench_register("disp/draw_rotate_rgb565", __bench_disp_rotate, 180);
+    tuya_bench_register("disp/draw_rotate_rgb565", __bench_disp_rotate, 270);
+#endif
+}
@@ -0,0 +1,101 @@
+/**
+ * @file bench_utilities.c
+ * @brief Ring buffer and G.711 cases
+ *
+ * The ring buffer cases move arg bytes per iteration through a 4 KiB
+ * buffer, so large chunks take the wrap path as often as the audio queues
+ * do. G.711 runs one 20 ms frame at 16 kHz by default.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ */
+
+#include "bench_cases.h"
+#include "tal_api.h"
+#include "tuya_ringbuf.h"
+#include "g711_codec.h"
+#include <string.h>
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+#define BENCH_RINGBUF_SIZE  4096
+#define BENCH_CHUNK_MAX     BENCH_RINGBUF_SIZE
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static uint8_t sg_chunk[BENCH_CHUNK_MAX];
+static int16_t sg_pcm[BENCH_CHUNK_MAX];
+static uint8_t sg_ulaw[BENCH_CHUNK_MAX];
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+
+static void __bench_fill_pcm(int16_t *pcm, uint32_t num)
+{
+    /* Full scale sweep so every u-law segment is hit */
+    for (uint32_t i = 0; i < num; i++) {
+        pcm[i] = (int16_t)((i * 2654435761U) >> 16);
+    }
+}
+
+static void __bench_ringbuf_write_read(TUYA_BENCH_STATE_T *st)
+{
+    TUYA_RINGBUFF_T rb = NULL;
+    uint32_t len = (uint32_t)st->arg;
+
+    if (OPRT_OK != tuya_ring_buff_create(BENCH_RINGBUF_SIZE, OVERFLOW_STOP_TYPE, &rb)) {
+        tuya_bench_skip(st, "ring buffer create failed");
+        return;
+    }
+    memset(sg_chunk, 0xA5, len);
+
+    while (tuya_bench_keep_running(st)) {
+        uint32_t n = tuya_ring_buff_write(rb, sg_chunk, len);
+        n = tuya_ring_buff_read(rb, sg_chunk, n);
+        tuya_bench_do_not_optimize(n);
+    }
+    st->bytes_per_iter = len;
+
+    tuya_ring_buff_free(rb);
+}
+
+static void __bench_g711_encode(TUYA_BENCH_STATE_T *st)
+{
+    uint32_t num = (uint32_t)st->arg;
+
+    __bench_fill_pcm(sg_pcm, num);
+    while (tuya_bench_keep_running(st)) {
+        size_t n = g711_encode_ulaw(sg_pcm, num, sg_ulaw);
+        tuya_bench_do_not_optimize(n);
+        tuya_bench_clobber();
+    }
+    st->bytes_per_iter = num * sizeof(int16_t);
+}
+
+static void __bench_g711_decode(TUYA_BENCH_STATE_T *st)
+{
+    uint32_t num = (uint32_t)st->arg;
+
+    __bench_fill_pcm(sg_pcm, num);
+    g711_encode_ulaw(sg_pcm, num, sg_ulaw);
+    while (tuya_bench_keep_running(st)) {
+        size_t n = g711_decode_ulaw(sg_ulaw, num, sg_pcm);
+        tuya_bench_do_not_optimize(n);
+        tuya_bench_clobber();
+    }
+    st->bytes_per_iter = num;
+}
+
+void bench_utilities_register(void)
+{
+    tuya_bench_register("ring_buff/write_read", __bench_ringbuf_write_read, 64);
+    tuya_bench_register("ring_buff/write_read", __bench_ringbuf_write_read, 640);
+    tuya_bench_register("ring_buff/write_read", __bench_ringbuf_write_read, 3000);
+
+    /* Samples: one 20 ms frame at 16 kHz, and a 4 KiB burst */
+    tuya_bench_register("g711/encode_ulaw", __bench_g711_encode, 320);
+    tuya_bench_register("g711/encode_ulaw", __bench_g711_encode, 4096);
+    tuya_bench_register("g711/decode_ulaw", __bench_g711_decode, 320);
+}
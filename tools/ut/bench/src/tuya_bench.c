@@ -0,0 +1,371 @@
+/**
+ * @file tuya_bench.c
+ * @brief Micro-benchmark runner, clock and cycle counter shim, report writers
+ *
+ * Iterations follow Google Benchmark: start at 1, grow by 10x while a run
+ * is too short to predict from, then jump to 1.4x the predicted count for
+ * the minimum time. Only the run that passed the minimum time is reported.
+ * All report arithmetic is integer, so newlib nano printf without float
+ * support prints the same numbers as glibc.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ */
+
+#include "tuya_bench.h"
+#include "tal_api.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#if OPERATING_SYSTEM == SYSTEM_LINUX
+#include <time.h>
+#include <unistd.h>
+#endif
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+#if OPERATING_SYSTEM == SYSTEM_LINUX
+#if defined(__x86_64__) || defined(__i386__)
+#define BENCH_CYCLE_NAME "rdtsc"
+#elif defined(__aarch64__)
+#define BENCH_CYCLE_NAME "cntvct"
+#endif
+#elif defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__) || defined(__ARM_ARCH_8M_MAIN__)
+/* Secure only DWT on some parts, define TUYA_BENCH_DWT_ENABLE=0 there */
+#ifndef TUYA_BENCH_DWT_ENABLE
+#define TUYA_BENCH_DWT_ENABLE 1
+#endif
+#if (TUYA_BENCH_DWT_ENABLE == 1)
+#define BENCH_CYCLE_NAME "dwt"
+#define BENCH_DWT_CTRL   (*(volatile uint32_t *)0xE0001000)
+#define BENCH_DWT_CYCCNT (*(volatile uint32_t *)0xE0001004)
+#define BENCH_DEMCR      (*(volatile uint32_t *)0xE000EDFC)
+#define BENCH_DEMCR_TRCENA     (1UL << 24)
+#define BENCH_DWT_CYCCNTENA    (1UL << 0)
+#endif
+#endif
+
+#ifndef BENCH_CYCLE_NAME
+#define BENCH_CYCLE_NAME "none"
+#endif
+
+#define BENCH_LINE_LEN 256
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef struct {
+    char name[TUYA_BENCH_NAME_LEN];
+    TUYA_BENCH_FUNC_CB func;
+    int64_t arg;
+} BENCH_CASE_T;
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static BENCH_CASE_T sg_bench_case[TUYA_BENCH_CASE_MAX];
+static uint32_t sg_bench_case_num = 0;
+
+#if defined(BENCH_DWT_CYCCNT)
+/* CYCCNT is 32 bit, the high word counts wraps; a run near the minimum
+ * time reads it well within one wrap (about 9s at 480 MHz) */
+static uint32_t sg_dwt_last = 0;
+static uint32_t sg_dwt_high = 0;
+#endif
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+
+uint64_t tuya_bench_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#elif defined(__aarch64__) && (OPERATING_SYSTEM == SYSTEM_LINUX)
+    uint64_t val;
+    __asm__ volatile("isb; mrs %0, cntvct_el0" : "=r"(val));
+    return val;
+#elif defined(BENCH_DWT_CYCCNT)
+    uint32_t now = BENCH_DWT_CYCCNT;
+    if (now < sg_dwt_last) {
+        sg_dwt_high++;
+    }
+    sg_dwt_last = now;
+    return ((uint64_t)sg_dwt_high << 32) | now;
+#else
+    return 0;
+#endif
+}
+
+uint64_t tuya_bench_clock_ns(void)
+{
+#if OPERATING_SYSTEM == SYSTEM_LINUX
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#elif defined(BENCH_DWT_CYCCNT) && defined(TUYA_BENCH_CPU_HZ)
+    return tuya_bench_cycles() * 1000ULL / ((TUYA_BENCH_CPU_HZ) / 1000000ULL);
+#else
+    return (uint64_t)tal_system_get_millisecond() * 1000000ULL;
+#endif
+}
+
+static uint64_t __bench_cpu_ns(void)
+{
+#if OPERATING_SYSTEM == SYSTEM_LINUX
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#else
+    /* One core, no preemption accounting: CPU time is wall time */
+    return tuya_bench_clock_ns();
+#endif
+}
+
+static void __bench_cycle_init(void)
+{
+#if defined(BENCH_DWT_CYCCNT)
+    BENCH_DEMCR |= BENCH_DEMCR_TRCENA;
+    BENCH_DWT_CYCCNT = 0;
+    BENCH_DWT_CTRL |= BENCH_DWT_CYCCNTENA;
+    sg_dwt_last = 0;
+    sg_dwt_high = 0;
+#endif
+}
+
+bool __tuya_bench_loop_edge(TUYA_BENCH_STATE_T *st)
+{
+    if (!st->started) {
+        st->started = true;
+        st->remaining = st->iterations;
+        st->cycle_start = tuya_bench_cycles();
+        st->cpu_start = __bench_cpu_ns();
+        st->real_start = tuya_bench_clock_ns();
+        if (st->remaining != 0 && NULL == st->error) {
+            st->remaining--;
+            return true;
+        }
+    }
+
+    if (!st->stopped) {
+        st->real_ns = tuya_bench_clock_ns() - st->real_start;
+        st->cpu_ns = __bench_cpu_ns() - st->cpu_start;
+        st->cycles = tuya_bench_cycles() - st->cycle_start;
+        st->stopped = true;
+    }
+    return false;
+}
+
+void tuya_bench_skip(TUYA_BENCH_STATE_T *st, const char *error)
+{
+    st->error = error;
+    st->remaining = 0;
+}
+
+OPERATE_RET tuya_bench_register(const char *name, TUYA_BENCH_FUNC_CB func, int64_t arg)
+{
+    if (NULL == name || NULL == func) {
+        return OPRT_INVALID_PARM;
+    }
+    if (sg_bench_case_num >= TUYA_BENCH_CASE_MAX) {
+        return OPRT_EXCEED_UPPER_LIMIT;
+    }
+
+    BENCH_CASE_T *c = &sg_bench_case[sg_bench_case_num++];
+    if (arg >= 0) {
+        snprintf(c->name, sizeof(c->name), "%s/%lld", name, (long long)arg);
+    } else {
+        snprintf(c->name, sizeof(c->name), "%s", name);
+    }
+    c->func = func;
+    c->arg = arg;
+
+    return OPRT_OK;
+}
+
+static void __bench_once(const BENCH_CASE_T *c, uint64_t iterations, TUYA_BENCH_STATE_T *st)
+{
+    memset(st, 0, sizeof(TUYA_BENCH_STATE_T));
+    st->arg = c->arg;
+    st->iterations = iterations;
+
+    c->func(st);
+
+    /* A case that returned without looping is measured as empty */
+    __tuya_bench_loop_edge(st);
+}
+
+/**
+ * @brief Grow the iterations until one run takes min_ns, like RunUntilMinTime()
+ */
+static void __bench_measure(const BENCH_CASE_T *c, uint64_t min_ns, TUYA_BENCH_STATE_T *st)
+{
+    uint64_t iterations = 1;
+
+    for (;;) {
+        __bench_once(c, iterations, st);
+        if (st->error || st->real_ns >= min_ns || iterations >= TUYA_BENCH_MAX_ITERATIONS) {
+            return;
+        }
+
+        uint64_t next = iterations * 10;
+        /* Predict from runs over a tenth of the target, ticks below are noise */
+        if (st->real_ns > min_ns / 10) {
+            next = (uint64_t)(((double)min_ns * 1.4 / (double)st->real_ns) * (double)iterations);
+        }
+        if (next <= iterations) {
+            next = iterations + 1;
+        }
+        iterations = (next > TUYA_BENCH_MAX_ITERATIONS) ? TUYA_BENCH_MAX_ITERATIONS : next;
+    }
+}
+
+static void __bench_print(const TUYA_BENCH_OPT_T *opt, const char *fmt, ...)
+{
+    char line[BENCH_LINE_LEN];
+    va_list ap;
+
+    va_start(ap, fmt);
+    vsnprintf(line, sizeof(line), fmt, ap);
+    va_end(ap);
+    opt->out(opt->out_ctx, line);
+}
+
+/**
+ * @brief Per iteration value in thousandths, so "%llu.%03llu" prints it
+ */
+static uint64_t __bench_per_iter_milli(uint64_t total, uint64_t iterations)
+{
+    return iterations ? (total * 1000ULL + iterations / 2) / iterations : 0;
+}
+
+static uint64_t __bench_per_second(uint64_t per_iter, const TUYA_BENCH_STATE_T *st)
+{
+    if (0 == st->real_ns) {
+        return 0;
+    }
+    return (uint64_t)((double)per_iter * (double)st->iterations * 1e9 / (double)st->real_ns);
+}
+
+static void __bench_json_head(const TUYA_BENCH_OPT_T *opt)
+{
+    long cpus = 1;
+
+#if OPERATING_SYSTEM == SYSTEM_LINUX
+    cpus = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    __bench_print(opt, "{\n  \"context\": {\n");
+    __bench_print(opt, "    \"executable\": \"%s\",\n", opt->executable ? opt->executable : "tuya_bench");
+    __bench_print(opt, "    \"platform_chip\": \"%s\",\n", PLATFORM_CHIP);
+    __bench_print(opt, "    \"platform_board\": \"%s\",\n", PLATFORM_BOARD);
+    __bench_print(opt, "    \"num_cpus\": %ld,\n", cpus);
+    __bench_print(opt, "    \"cycle_counter\": \"%s\",\n", BENCH_CYCLE_NAME);
+    __bench_print(opt, "    \"min_time_ms\": %u,\n", opt->min_time_ms ? opt->min_time_ms : TUYA_BENCH_MIN_TIME_MS);
+    __bench_print(opt, "    \"library_build_type\": \"release\"\n  },\n  \"benchmarks\": [");
+}
+
+static void __bench_json_case(const TUYA_BENCH_OPT_T *opt, const BENCH_CASE_T *c, const TUYA_BENCH_STATE_T *st,
+                              bool first)
+{
+    uint64_t real = __bench_per_iter_milli(st->real_ns, st->iterations);
+    uint64_t cpu = __bench_per_iter_milli(st->cpu_ns, st->iterations);
+
+    __bench_print(opt, "%s\n    {\n      \"name\": \"%s\",\n      \"run_name\": \"%s\",\n", first ? "" : ",", c->name,
+                  c->name);
+    __bench_print(opt, "      \"run_type\": \"iteration\",\n      \"repetitions\": 1,\n      \"repetition_index\": 0,\n"
+                       "      \"threads\": 1,\n");
+    if (st->error) {
+        __bench_print(opt, "      \"error_occurred\": true,\n      \"error_message\": \"%s\"\n    }", st->error);
+        return;
+    }
+    __bench_print(opt, "      \"iterations\": %llu,\n      \"real_time\": %llu.%03llu,\n      \"cpu_time\": %llu.%03llu,\n",
+                  (unsigned long long)st->iterations, (unsigned long long)(real / 1000), (unsigned long long)(real % 1000),
+                  (unsigned long long)(cpu / 1000), (unsigned long long)(cpu % 1000));
+    if (st->bytes_per_iter) {
+        __bench_print(opt, "      \"bytes_per_second\": %llu,\n",
+                      (unsigned long long)__bench_per_second(st->bytes_per_iter, st));
+    }
+    if (st->items_per_iter) {
+        __bench_print(opt, "      \"items_per_second\": %llu,\n",
+                      (unsigned long long)__bench_per_second(st->items_per_iter, st));
+    }
+    if (st->cycles) {
+        uint64_t cyc = __bench_per_iter_milli(st->cycles, st->iterations);
+        __bench_print(opt, "      \"cycles_per_iteration\": %llu.%03llu,\n", (unsigned long long)(cyc / 1000),
+                      (unsigned long long)(cyc % 1000));
+    }
+    __bench_print(opt, "      \"time_unit\": \"ns\"\n    }");
+}
+
+static void __bench_console_case(const TUYA_BENCH_OPT_T *opt, const BENCH_CASE_T *c, const TUYA_BENCH_STATE_T *st)
+{
+    if (st->error) {
+        __bench_print(opt, "%-40s ERROR OCCURRED: '%s'\n", c->name, st->error);
+        return;
+    }
+
+    uint64_t real = __bench_per_iter_milli(st->real_ns, st->iterations);
+    uint64_t cpu = __bench_per_iter_milli(st->cpu_ns, st->iterations);
+    char extra[64] = {0};
+
+    if (st->bytes_per_iter) {
+        uint64_t bps = __bench_per_second(st->bytes_per_iter, st);
+        snprintf(extra, sizeof(extra), " %llu.%02lluMiB/s", (unsigned long long)(bps >> 20),
+                 (unsigned long long)((bps & 0xFFFFF) * 100 >> 20));
+    } else if (st->items_per_iter) {
+        snprintf(extra, sizeof(extra), " %llu items/s", (unsigned long long)__bench_per_second(st->items_per_iter, st));
+    }
+    __bench_print(opt, "%-40s %9llu.%03llu ns %9llu.%03llu ns %11llu%s\n", c->name, (unsigned long long)(real / 1000),
+                  (unsigned long long)(real % 1000), (unsigned long long)(cpu / 1000), (unsigned long long)(cpu % 1000),
+                  (unsigned long long)st->iterations, extra);
+}
+
+OPERATE_RET tuya_bench_run(const TUYA_BENCH_OPT_T *opt)
+{
+    OPERATE_RET rt = OPRT_OK;
+    TUYA_BENCH_STATE_T st;
+    uint64_t min_ns = 0;
+    bool first = true;
+
+    if (NULL == opt || NULL == opt->out) {
+        return OPRT_INVALID_PARM;
+    }
+
+    min_ns = (uint64_t)(opt->min_time_ms ? opt->min_time_ms : TUYA_BENCH_MIN_TIME_MS) * 1000000ULL;
+    __bench_cycle_init();
+
+    if (TUYA_BENCH_FMT_JSON == opt->format) {
+        __bench_json_head(opt);
+    } else {
+        __bench_print(opt, "Cycle counter: %s\n", BENCH_CYCLE_NAME);
+        __bench_print(opt, "%-40s %16s %16s %11s\n", "Benchmark", "Time", "CPU", "Iterations");
+        __bench_print(opt, "-------------------------------------------------------------------------------"
+                           "-------------\n");
+    }
+
+    for (uint32_t i = 0; i < sg_bench_case_num; i++) {
+        const BENCH_CASE_T *c = &sg_bench_case[i];
+        if (opt->filter && opt->filter[0] && NULL == strstr(c->name, opt->filter)) {
+            continue;
+        }
+
+        __bench_measure(c, min_ns, &st);
+        if (st.error) {
+            rt = OPRT_COM_ERROR;
+        }
+
+        if (TUYA_BENCH_FMT_JSON == opt->format) {
+            __bench_json_case(opt, c, &st, first);
+        } else {
+            __bench_console_case(opt, c, &st);
+        }
+        first = false;
+    }
+
+    if (TUYA_BENCH_FMT_JSON == opt->format) {
+        __bench_print(opt, "\n  ]\n}\n");
+    }
+
+    return rt;
+}
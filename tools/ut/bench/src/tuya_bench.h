@@ -0,0 +1,170 @@
+/**
+ * @file tuya_bench.h
+ * @brief Micro-benchmark harness for the hot SDK primitives
+ *
+ * Modelled on Google Benchmark: a case is a function that loops on
+ * tuya_bench_keep_running(), the runner grows the iteration count until
+ * one run takes at least the minimum time and reports time per iteration,
+ * throughput and, where the CPU has one, cycles per iteration. Results go
+ * out as a console table or as Google Benchmark compatible JSON, so the
+ * usual compare.py tooling works on both host and target runs.
+ *
+ * Time comes from clock_gettime() on Linux and from the system tick on
+ * target. The cycle counter shim reads RDTSC on x86, CNTVCT on AArch64 and
+ * DWT CYCCNT on Cortex-M3/M4/M7/M33; with TUYA_BENCH_CPU_HZ defined the
+ * target times are derived from the cycle counter instead of the tick.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ */
+
+#ifndef __TUYA_BENCH_H__
+#define __TUYA_BENCH_H__
+
+#include "tuya_cloud_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+/* Registered cases */
+#ifndef TUYA_BENCH_CASE_MAX
+#define TUYA_BENCH_CASE_MAX 64
+#endif
+
+/* One measured run takes at least this long */
+#ifndef TUYA_BENCH_MIN_TIME_MS
+#define TUYA_BENCH_MIN_TIME_MS 500
+#endif
+
+/* Upper bound of the iteration count, like benchmark::kMaxIterations */
+#ifndef TUYA_BENCH_MAX_ITERATIONS
+#define TUYA_BENCH_MAX_ITERATIONS 1000000000ULL
+#endif
+
+#define TUYA_BENCH_NAME_LEN 64
+
+/**
+ * @brief Keep the compiler from dropping a result the case never reads
+ */
+#define tuya_bench_do_not_optimize(p) __asm__ volatile("" : : "g"(p) : "memory")
+
+/**
+ * @brief Force pending stores to memory, like benchmark::ClobberMemory()
+ */
+#define tuya_bench_clobber() __asm__ volatile("" : : : "memory")
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef enum {
+    TUYA_BENCH_FMT_CONSOLE = 0,
+    TUYA_BENCH_FMT_JSON,
+} TUYA_BENCH_FMT_E;
+
+typedef struct {
+    /* Set by the runner */
+    int64_t arg;                /* Case argument, like benchmark::State::range(0) */
+    uint64_t iterations;        /* Iterations of this run */
+
+    /* Set by the case */
+    uint64_t bytes_per_iter;    /* Reported as bytes_per_second when not 0 */
+    uint64_t items_per_iter;    /* Reported as items_per_second when not 0 */
+    const char *error;          /* Set by tuya_bench_skip(), the case is reported as skipped */
+
+    /* Private to the runner */
+    uint64_t remaining;
+    bool started;
+    bool stopped;
+    uint64_t real_start;
+    uint64_t cpu_start;
+    uint64_t cycle_start;
+    uint64_t real_ns;
+    uint64_t cpu_ns;
+    uint64_t cycles;
+} TUYA_BENCH_STATE_T;
+
+typedef void (*TUYA_BENCH_FUNC_CB)(TUYA_BENCH_STATE_T *st);
+
+/**
+ * @brief Output sink, called with NUL terminated chunks of the report
+ */
+typedef void (*TUYA_BENCH_OUT_CB)(void *ctx, const char *str);
+
+typedef struct {
+    TUYA_BENCH_FMT_E format;
+    const char *filter;         /* Substring of the case name, NULL runs all */
+    uint32_t min_time_ms;       /* 0 uses TUYA_BENCH_MIN_TIME_MS */
+    const char *executable;     /* Reported in the JSON context */
+    TUYA_BENCH_OUT_CB out;
+    void *out_ctx;
+} TUYA_BENCH_OPT_T;
+
+/***********************************************************
+********************function declaration********************
+***********************************************************/
+
+/**
+ * @brief Register a case, the report names it "name/arg" when arg >= 0
+ *
+ * @param[in] name case name without the argument
+ * @param[in] func case function
+ * @param[in] arg passed as st->arg, -1 for none
+ *
+ * @return OPRT_OK on success, OPRT_EXCEED_UPPER_LIMIT when the table is full
+ */
+OPERATE_RET tuya_bench_register(const char *name, TUYA_BENCH_FUNC_CB func, int64_t arg);
+
+/**
+ * @brief Run the registered cases and print the report
+ *
+ * @param[in] opt format, filter and output sink
+ *
+ * @return OPRT_OK when every selected case ran, OPRT_COM_ERROR when one was skipped
+ */
+OPERATE_RET tuya_bench_run(const TUYA_BENCH_OPT_T *opt);
+
+/**
+ * @brief Mark the case as failed, the loop ends at the next check
+ *
+ * @param[in] st case state
+ * @param[in] error reason, reported with the case
+ */
+void tuya_bench_skip(TUYA_BENCH_STATE_T *st, const char *error);
+
+/**
+ * @brief Monotonic time in ns, from the system tick on target
+ */
+uint64_t tuya_bench_clock_ns(void);
+
+/**
+ * @brief Cycle counter, 0 when the CPU has none the shim can read
+ */
+uint64_t tuya_bench_cycles(void);
+
+/* Loop edges, called by tuya_bench_keep_running() only */
+bool __tuya_bench_loop_edge(TUYA_BENCH_STATE_T *st);
+
+/**
+ * @brief Loop condition of a case, the timers run from the first call to the last
+ *
+ * @param[in] st case state
+ *
+ * @return true while iterations are left
+ */
+static inline bool tuya_bench_keep_running(TUYA_BENCH_STATE_T *st)
+{
+    if (__builtin_expect(st->remaining != 0 && st->started, 1)) {
+        st->remaining--;
+        return true;
+    }
+    return __tuya_bench_loop_edge(st);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TUYA_BENCH_H__ */
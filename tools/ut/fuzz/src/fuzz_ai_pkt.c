@@ -0,0 +1,188 @@
+/**
+ * @file fuzz_ai_pkt.c
+ * @brief AI protocol packet target
+ *
+ * The first input byte holds the options, the rest is the byte stream as
+ * it came from the connection: reads go through tuya_ai_basic_pkt_read()
+ * from a memory transporter until the stream is used up, with reassembly
+ * of fragments either in the protocol or left to the caller.
+ *
+ * Keys are derived from an empty local key, so streams from the seeds are
+ * signed validly. Mutated inputs are re-signed on read unless
+ * FUZZ_AI_OPT_KEEP_SIGN is set, otherwise nearly every one stops at the
+ * HMAC check.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ */
+
+#include "tuya_fuzz.h"
+#include "tal_api.h"
+#include "tuya_ai_protocol.h"
+#include "tuya_transporter.h"
+#include <string.h>
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+#define FUZZ_AI_OPT_SL_CONFIGURED BIT(0) /* AI_PACKET_SECURITY_LEVEL instead of SL0 */
+#define FUZZ_AI_OPT_KEEP_SIGN     BIT(1)
+#define FUZZ_AI_OPT_CALLER_FRAG   BIT(2) /* tuya_ai_basic_set_frag_flag(true) */
+
+#define FUZZ_AI_SEED_MAX          4096
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef struct {
+    struct tuya_transporter_inter_t base;
+    const uint8_t *data;
+    size_t len;
+    size_t pos;
+} FUZZ_MEM_TRANSPORTER_T;
+
+typedef struct {
+    AI_PACKET_WRITER_T writer;
+    uint8_t buf[FUZZ_AI_SEED_MAX];
+    uint32_t len;
+} FUZZ_AI_SEED_T;
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static FUZZ_MEM_TRANSPORTER_T sg_mem;
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+
+static OPERATE_RET __fuzz_mem_read(tuya_transporter_t t, uint8_t *buf, int len, int timeout_ms)
+{
+    FUZZ_MEM_TRANSPORTER_T *mem = (FUZZ_MEM_TRANSPORTER_T *)t;
+    size_t left = mem->len - mem->pos;
+
+    /* The end of the capture is a closed connection, not a timeout the reader would wait out */
+    if (0 == left || len <= 0) {
+        return OPRT_COM_ERROR;
+    }
+    if ((size_t)len > left) {
+        len = (int)left;
+    }
+    memcpy(buf, mem->data + mem->pos, len);
+    mem->pos += len;
+
+    return len;
+}
+
+static OPERATE_RET __fuzz_ai_pkt_init(void)
+{
+    sg_mem.base.f_read = __fuzz_mem_read;
+    return tuya_ai_basic_pkt_read_attach(NULL, AI_PACKET_SL0, false);
+}
+
+static int __fuzz_ai_pkt_one(const uint8_t *data, size_t size)
+{
+    int accepted = 0;
+
+    if (size < 1) {
+        return 0;
+    }
+    if (size > TUYA_FUZZ_INPUT_MAX) {
+        size = TUYA_FUZZ_INPUT_MAX;
+    }
+
+    uint8_t opt = data[0];
+    sg_mem.data = data + 1;
+    sg_mem.len = size - 1;
+    sg_mem.pos = 0;
+
+    AI_PACKET_SL sl = (opt & FUZZ_AI_OPT_SL_CONFIGURED) ? AI_PACKET_SECURITY_LEVEL : AI_PACKET_SL0;
+    TUYA_FUZZ_CHECK(OPRT_OK ==
+                    tuya_ai_basic_pkt_read_attach(&sg_mem.base, sl, 0 == (opt & FUZZ_AI_OPT_KEEP_SIGN)));
+    tuya_ai_basic_set_frag_flag((opt & FUZZ_AI_OPT_CALLER_FRAG) ? true : false);
+
+    /* A rejected packet leaves the stream wherever it stopped, as on a live link */
+    while (sg_mem.pos < sg_mem.len) {
+        char *out = NULL;
+        uint32_t out_len = 0;
+        AI_FRAG_FLAG frag = AI_PACKET_NO_FRAG;
+        size_t pos = sg_mem.pos;
+
+        OPERATE_RET rt = tuya_ai_basic_pkt_read(&out, &out_len, &frag);
+        if (OPRT_OK == rt && out) {
+            /* Touch every byte handed out, the sanitizers check the length */
+            uint8_t sum = 0;
+            for (uint32_t i = 0; i < out_len; i++) {
+                sum ^= (uint8_t)out[i];
+            }
+            (void)sum;
+            tuya_ai_basic_pkt_free(out);
+            accepted++;
+        }
+        if (sg_mem.pos == pos) {
+            break;
+        }
+    }
+
+    tuya_ai_basic_pkt_read_attach(NULL, AI_PACKET_SL0, false);
+    return accepted;
+}
+
+static OPERATE_RET __fuzz_ai_seed_write(AI_PACKET_WRITER_T *writer, void *buf, uint32_t buf_len)
+{
+    FUZZ_AI_SEED_T *seed = (FUZZ_AI_SEED_T *)writer;
+
+    if (buf_len > sizeof(seed->buf) - seed->len) {
+        return OPRT_EXCEED_UPPER_LIMIT;
+    }
+    memcpy(seed->buf + seed->len, buf, buf_len);
+    seed->len += buf_len;
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET __fuzz_ai_seed_packet(FUZZ_AI_SEED_T *seed, AI_FRAG_FLAG frag, uint32_t len, uint32_t total_len)
+{
+    static char audio[640];
+    AI_SEND_PACKET_T info = {
+        .type = AI_PT_AUDIO,
+        .data = audio,
+        .len = len,
+        .total_len = total_len,
+        .writer = &seed->writer,
+    };
+
+    memset(audio, 0x55, sizeof(audio));
+    return tuya_ai_basic_pkt_write_bench(&info, frag);
+}
+
+/**
+ * @brief SL0 streams as the writer path builds them, option byte first
+ */
+static OPERATE_RET __fuzz_ai_pkt_seed(TUYA_FUZZ_EMIT_CB emit, void *ctx)
+{
+    OPERATE_RET rt = OPRT_OK;
+    static FUZZ_AI_SEED_T seed;
+
+    memset(&seed, 0, sizeof(seed));
+    seed.writer.write = __fuzz_ai_seed_write;
+    seed.buf[seed.len++] = FUZZ_AI_OPT_KEEP_SIGN;
+    TUYA_CALL_ERR_RETURN(__fuzz_ai_seed_packet(&seed, AI_PACKET_NO_FRAG, 640, 640));
+    TUYA_CALL_ERR_RETURN(emit(ctx, "audio", seed.buf, seed.len));
+
+    memset(&seed, 0, sizeof(seed));
+    seed.writer.write = __fuzz_ai_seed_write;
+    seed.buf[seed.len++] = FUZZ_AI_OPT_KEEP_SIGN;
+    TUYA_CALL_ERR_RETURN(__fuzz_ai_seed_packet(&seed, AI_PACKET_FRAG_START, 200, 600));
+    TUYA_CALL_ERR_RETURN(__fuzz_ai_seed_packet(&seed, AI_PACKET_FRAG_ING, 200, 600));
+    TUYA_CALL_ERR_RETURN(__fuzz_ai_seed_packet(&seed, AI_PACKET_FRAG_END, 200, 600));
+    TUYA_CALL_ERR_RETURN(emit(ctx, "audio_frag", seed.buf, seed.len));
+
+    return rt;
+}
+
+const TUYA_FUZZ_TARGET_T fuzz_ai_pkt_target = {
+    .name = "ai_pkt",
+    .init = __fuzz_ai_pkt_init,
+    .one = __fuzz_ai_pkt_one,
+    .seed = __fuzz_ai_pkt_seed,
+};
@@ -0,0 +1,152 @@
+/**
+ * @file fuzz_ble.c
+ * @brief BLE subpackage decode target
+ *
+ * The first input byte sets the subpackage size, 20 plus its value, as the
+ * ATT MTU would. The rest is a list of air packets, each a length byte and
+ * that many bytes, fed in turn to ble_frame_trsmitr_recv_pkg_decode() and
+ * joined the way ble_mgr.c joins them.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ */
+
+#include "tuya_fuzz.h"
+#include "tal_api.h"
+#include "ble_trsmitr.h"
+#include <stdio.h>
+#include <string.h>
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+#define FUZZ_BLE_SUBPKG_MIN 20
+#define FUZZ_BLE_SEED_MAX   2048
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static uint8_t sg_raw_buf[TUYA_BLE_AIR_FRAME_MAX];
+static uint8_t sg_seed[FUZZ_BLE_SEED_MAX];
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+
+static OPERATE_RET __fuzz_ble_init(void)
+{
+    return OPRT_OK;
+}
+
+static int __fuzz_ble_one(const uint8_t *data, size_t size)
+{
+    ble_frame_trsmitr_t *trsmitr = NULL;
+    uint32_t raw_len = 0;
+    size_t pos = 1;
+    int accepted = 0;
+
+    if (size < 1) {
+        return 0;
+    }
+
+    trsmitr = ble_frame_trsmitr_create();
+    TUYA_FUZZ_CHECK(NULL != trsmitr);
+    TUYA_FUZZ_CHECK(OPRT_OK == ble_frame_trsmitr_subpacket_max_set(trsmitr, FUZZ_BLE_SUBPKG_MIN + data[0]));
+
+    while (pos < size) {
+        uint16_t len = data[pos++];
+        if (len > size - pos) {
+            len = (uint16_t)(size - pos);
+        }
+
+        /* An exact copy, so a read past the air packet is caught */
+        uint8_t *pkt = tal_malloc(len ? len : 1);
+        TUYA_FUZZ_CHECK(NULL != pkt);
+        memcpy(pkt, data + pos, len);
+        pos += len;
+
+        int rt = ble_frame_trsmitr_recv_pkg_decode(trsmitr, pkt, len);
+        tal_free(pkt);
+        if (OPRT_OK != rt && OPRT_SVC_BT_API_TRSMITR_CONTINUE != rt) {
+            raw_len = 0;
+            continue;
+        }
+
+        TUYA_FUZZ_CHECK(trsmitr->subpkg_len <= trsmitr->subpkg_max);
+        TUYA_FUZZ_CHECK(trsmitr->pkg_trsmitr_cnt <= trsmitr->total);
+        if (BLE_FRAME_PKG_FIRST == trsmitr->pkg_desc ||
+            (BLE_FRAME_PKG_END == trsmitr->pkg_desc && 0 == trsmitr->subpkg_num)) {
+            raw_len = 0;
+        }
+        uint32_t subpkg_len = ble_frame_subpacket_len_get(trsmitr);
+        if (raw_len + subpkg_len > sizeof(sg_raw_buf)) {
+            raw_len = 0;
+            continue;
+        }
+        memcpy(sg_raw_buf + raw_len, ble_frame_subpacket_get(trsmitr), subpkg_len);
+        raw_len += subpkg_len;
+
+        if (OPRT_OK == rt) {
+            TUYA_FUZZ_CHECK(trsmitr->pkg_trsmitr_cnt == trsmitr->total);
+            accepted++;
+            raw_len = 0;
+        }
+    }
+
+    ble_frame_trsmitr_delete(trsmitr);
+    return accepted;
+}
+
+/**
+ * @brief Frames split by the transmitter itself, at the smallest subpackage size
+ */
+static OPERATE_RET __fuzz_ble_seed(TUYA_FUZZ_EMIT_CB emit, void *ctx)
+{
+    OPERATE_RET rt = OPRT_OK;
+    static const uint32_t frame_len[] = {8, 64, 600};
+    static uint8_t frame[600];
+    char name[16];
+
+    ble_frame_trsmitr_t *trsmitr = ble_frame_trsmitr_create();
+    TUYA_CHECK_NULL_RETURN(trsmitr, OPRT_MALLOC_FAILED);
+    TUYA_CALL_ERR_GOTO(ble_frame_trsmitr_subpacket_max_set(trsmitr, FUZZ_BLE_SUBPKG_MIN), __EXIT);
+
+    for (uint32_t i = 0; i < sizeof(frame); i++) {
+        frame[i] = (uint8_t)i;
+    }
+
+    for (uint32_t i = 0; i < CNTSOF(frame_len); i++) {
+        uint32_t len = 0;
+        int ret = OPRT_SVC_BT_API_TRSMITR_CONTINUE;
+
+        sg_seed[len++] = 0;
+        trsmitr->pkg_desc = BLE_FRAME_PKG_INIT;
+        while (OPRT_SVC_BT_API_TRSMITR_CONTINUE == ret) {
+            ret = ble_frame_trsmitr_send_pkg_encode(trsmitr, 3, frame, frame_len[i]);
+            if (OPRT_OK != ret && OPRT_SVC_BT_API_TRSMITR_CONTINUE != ret) {
+                rt = ret;
+                goto __EXIT;
+            }
+            uint32_t subpkg_len = ble_frame_subpacket_len_get(trsmitr);
+            if (len + 1 + subpkg_len > sizeof(sg_seed)) {
+                rt = OPRT_EXCEED_UPPER_LIMIT;
+                goto __EXIT;
+            }
+            sg_seed[len++] = (uint8_t)subpkg_len;
+            memcpy(sg_seed + len, ble_frame_subpacket_get(trsmitr), subpkg_len);
+            len += subpkg_len;
+        }
+        snprintf(name, sizeof(name), "frame%u", i);
+        TUYA_CALL_ERR_GOTO(emit(ctx, name, sg_seed, len), __EXIT);
+    }
+
+__EXIT:
+    ble_frame_trsmitr_delete(trsmitr);
+    return rt;
+}
+
+const TUYA_FUZZ_TARGET_T fuzz_ble_target = {
+    .name = "ble",
+    .init = __fuzz_ble_init,
+    .one = __fuzz_ble_one,
+    .seed = __fuzz_ble_seed,
+};
@@ -0,0 +1,150 @@
+/**
+ * @file fuzz_lpv35.c
+ * @brief lpv35 frame target
+ *
+ * The input is parsed as a received frame by lpv35_frame_parse() and
+ * lpv35_frame_parse_inplace(), which must agree on the result and the
+ * plaintext. It is then sealed as the payload of a frame and parsed back,
+ * so the decrypt path runs on every input and not just the rare one that
+ * carries a valid tag. The key is "0123456789abcdef" unless
+ * TUYA_FUZZ_LPV35_KEY gives the 16 character local key of a capture.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ */
+
+#include "tuya_fuzz.h"
+#include "tal_api.h"
+#include "tuya_protocol.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+#define FUZZ_LPV35_KEY_LEN     16
+#define FUZZ_LPV35_PAYLOAD_MAX 4096
+#define FUZZ_LPV35_FRAME_TYPE  0x07 /* FRM_TP_CMD */
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static uint8_t sg_key[FUZZ_LPV35_KEY_LEN + 1] = "0123456789abcdef";
+
+static uint8_t sg_copy[TUYA_FUZZ_INPUT_MAX];
+static uint8_t sg_frame[FUZZ_LPV35_PAYLOAD_MAX + LPV35_FRAME_MINI_SIZE + 64];
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+
+static OPERATE_RET __fuzz_lpv35_init(void)
+{
+    const char *key = getenv("TUYA_FUZZ_LPV35_KEY");
+
+    if (key) {
+        if (strlen(key) != FUZZ_LPV35_KEY_LEN) {
+            PR_ERR("TUYA_FUZZ_LPV35_KEY must be %d characters", FUZZ_LPV35_KEY_LEN);
+            return OPRT_INVALID_PARM;
+        }
+        memcpy(sg_key, key, FUZZ_LPV35_KEY_LEN);
+    }
+    return OPRT_OK;
+}
+
+static int __fuzz_lpv35_parse(const uint8_t *data, size_t size)
+{
+    lpv35_frame_object_t heap = {0};
+    lpv35_frame_object_t inplace = {0};
+
+    OPERATE_RET rt_heap = lpv35_frame_parse(sg_key, FUZZ_LPV35_KEY_LEN, data, (int)size, &heap);
+    memcpy(sg_copy, data, size);
+    OPERATE_RET rt_inplace = lpv35_frame_parse_inplace(sg_key, FUZZ_LPV35_KEY_LEN, sg_copy, (int)size, &inplace);
+
+    TUYA_FUZZ_CHECK((OPRT_OK == rt_heap) == (OPRT_OK == rt_inplace));
+    if (OPRT_OK != rt_heap) {
+        return 0;
+    }
+
+    TUYA_FUZZ_CHECK(heap.sequence == inplace.sequence);
+    TUYA_FUZZ_CHECK(heap.type == inplace.type);
+    TUYA_FUZZ_CHECK(heap.data_len == inplace.data_len);
+    TUYA_FUZZ_CHECK(0 == memcmp(heap.data, inplace.data, heap.data_len));
+    TUYA_FUZZ_CHECK('\0' == inplace.data[inplace.data_len]);
+    tal_free(heap.data);
+
+    return 1;
+}
+
+static int __fuzz_lpv35_round_trip(const uint8_t *data, size_t size)
+{
+    lpv35_frame_object_t obj = {
+        .sequence = (uint32_t)size,
+        .type = FUZZ_LPV35_FRAME_TYPE,
+        .data = (uint8_t *)data,
+        .data_len = (uint32_t)((size > FUZZ_LPV35_PAYLOAD_MAX) ? FUZZ_LPV35_PAYLOAD_MAX : size),
+    };
+    lpv35_frame_object_t out = {0};
+    int olen = 0;
+
+    TUYA_FUZZ_CHECK(OPRT_OK == lpv35_frame_serialize(sg_key, FUZZ_LPV35_KEY_LEN, &obj, sg_frame, &olen));
+    TUYA_FUZZ_CHECK(olen > 0 && (size_t)olen <= sizeof(sg_frame));
+    TUYA_FUZZ_CHECK(OPRT_OK == lpv35_frame_parse_inplace(sg_key, FUZZ_LPV35_KEY_LEN, sg_frame, olen, &out));
+
+    TUYA_FUZZ_CHECK(out.sequence == obj.sequence);
+    TUYA_FUZZ_CHECK(out.type == obj.type);
+    TUYA_FUZZ_CHECK(out.data_len == obj.data_len);
+    TUYA_FUZZ_CHECK(0 == memcmp(out.data, data, out.data_len));
+
+    return 1;
+}
+
+static int __fuzz_lpv35_one(const uint8_t *data, size_t size)
+{
+    int accepted = 0;
+
+    if (0 == size) {
+        return 0;
+    }
+    if (size > TUYA_FUZZ_INPUT_MAX) {
+        size = TUYA_FUZZ_INPUT_MAX;
+    }
+
+    accepted += __fuzz_lpv35_parse(data, size);
+    accepted += __fuzz_lpv35_round_trip(data, size);
+
+    return accepted;
+}
+
+static OPERATE_RET __fuzz_lpv35_seed(TUYA_FUZZ_EMIT_CB emit, void *ctx)
+{
+    OPERATE_RET rt = OPRT_OK;
+    static const char *payload[] = {
+        "{\"t\":1700000000,\"dps\":{\"1\":true}}",
+        "{\"t\":1700000000,\"dps\":{\"1\":true,\"2\":100,\"3\":\"middle\",\"4\":\"bench text\"}}",
+    };
+    char name[16];
+
+    for (uint32_t i = 0; i < CNTSOF(payload); i++) {
+        lpv35_frame_object_t obj = {
+            .sequence = i + 1,
+            .type = FUZZ_LPV35_FRAME_TYPE,
+            .data = (uint8_t *)payload[i],
+            .data_len = strlen(payload[i]),
+        };
+        int olen = 0;
+
+        TUYA_CALL_ERR_RETURN(lpv35_frame_serialize(sg_key, FUZZ_LPV35_KEY_LEN, &obj, sg_frame, &olen));
+        snprintf(name, sizeof(name), "frame%u", i);
+        TUYA_CALL_ERR_RETURN(emit(ctx, name, sg_frame, olen));
+    }
+
+    return rt;
+}
+
+const TUYA_FUZZ_TARGET_T fuzz_lpv35_target = {
+    .name = "lpv35",
+    .init = __fuzz_lpv35_init,
+    .one = __fuzz_lpv35_one,
+    .seed = __fuzz_lpv35_seed,
+};
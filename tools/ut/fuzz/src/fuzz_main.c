@@ -0,0 +1,317 @@
+/**
+ * @file fuzz_main.c
+ * @brief libFuzzer entry and capture replay driver of the parser targets
+ *
+ * Built with FUZZ_LIBFUZZER the binary is a libFuzzer fuzzer and
+ * TUYA_FUZZ_TARGET (lpv35, ai_pkt or ble) picks the target:
+ *   TUYA_FUZZ_TARGET=ai_pkt fuzz -max_len=8192 corpus/ai_pkt
+ *
+ * Otherwise it replays inputs, files or directories of them such as a
+ * libFuzzer corpus or recorded captures, through the targets and reports
+ * the inputs each one accepted and its throughput:
+ *   fuzz [--target=NAME] [--runs=N] PATH...
+ *   fuzz --seeds=DIR
+ *
+ * The accepted counts over a fixed corpus must not change when a parser is
+ * optimized, the throughput should.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ */
+
+#include "tuya_cloud_types.h"
+#include "tal_api.h"
+#include "tkl_output.h"
+#include "tuya_fuzz.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#if OPERATING_SYSTEM != SYSTEM_LINUX
+#error "tools/ut/fuzz builds for boards/Ubuntu only"
+#endif
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+#ifndef TUYA_FUZZ_DEFAULT_TARGET
+#define TUYA_FUZZ_DEFAULT_TARGET "lpv35"
+#endif
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+typedef struct {
+    char *name;
+    uint8_t *data;
+    size_t size;
+} FUZZ_INPUT_T;
+
+/***********************************************************
+***********************variable define**********************
+***********************************************************/
+static const TUYA_FUZZ_TARGET_T *sg_targets[] = {
+    &fuzz_lpv35_target,
+    &fuzz_ai_pkt_target,
+    &fuzz_ble_target,
+};
+
+static const TUYA_FUZZ_TARGET_T *sg_target = NULL;
+static const char *sg_input_name = NULL;
+
+static FUZZ_INPUT_T *sg_inputs = NULL;
+static uint32_t sg_input_num = 0;
+static uint32_t sg_input_cap = 0;
+
+/***********************************************************
+***********************function define**********************
+***********************************************************/
+
+void tuya_fuzz_fail(const char *file, int line, const char *expr)
+{
+    fprintf(stderr, "%s:%d: check failed: %s, target %s, input %s\n", file, line, expr,
+            sg_target ? sg_target->name : "-", sg_input_name ? sg_input_name : "-");
+    abort();
+}
+
+static void __fuzz_log_drop(const char *str)
+{
+    (void)str;
+}
+
+static const TUYA_FUZZ_TARGET_T *__fuzz_target_find(const char *name)
+{
+    for (uint32_t i = 0; i < CNTSOF(sg_targets); i++) {
+        if (0 == strcmp(sg_targets[i]->name, name)) {
+            return sg_targets[i];
+        }
+    }
+    return NULL;
+}
+
+static void __fuzz_setup(void)
+{
+    /* Every rejected input logs an error, TUYA_FUZZ_LOG=1 shows them */
+    const char *log = getenv("TUYA_FUZZ_LOG");
+    tal_log_init(TAL_LOG_LEVEL_ERR, 1024,
+                 (log && log[0] == '1') ? (TAL_LOG_OUTPUT_CB)tkl_log_output : __fuzz_log_drop);
+}
+
+int LLVMFuzzerInitialize(int *argc, char ***argv)
+{
+    const char *name = getenv("TUYA_FUZZ_TARGET");
+
+    __fuzz_setup();
+    sg_target = __fuzz_target_find(name ? name : TUYA_FUZZ_DEFAULT_TARGET);
+    if (NULL == sg_target) {
+        fprintf(stderr, "unknown TUYA_FUZZ_TARGET %s\n", name);
+        exit(2);
+    }
+    if (OPRT_OK != sg_target->init()) {
+        fprintf(stderr, "%s init failed\n", sg_target->name);
+        exit(2);
+    }
+    return 0;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    sg_target->one(data, size);
+    return 0;
+}
+
+#if !defined(TUYA_FUZZ_LIBFUZZER) || (TUYA_FUZZ_LIBFUZZER == 0)
+static uint64_t __fuzz_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static OPERATE_RET __fuzz_input_load(const char *path)
+{
+    FILE *fp = fopen(path, "rb");
+    if (NULL == fp) {
+        printf("cannot open %s\n", path);
+        return OPRT_FILE_OPEN_FAILED;
+    }
+
+    if (sg_input_num == sg_input_cap) {
+        uint32_t cap = sg_input_cap ? sg_input_cap * 2 : 64;
+        FUZZ_INPUT_T *inputs = realloc(sg_inputs, cap * sizeof(FUZZ_INPUT_T));
+        if (NULL == inputs) {
+            fclose(fp);
+            return OPRT_MALLOC_FAILED;
+        }
+        sg_inputs = inputs;
+        sg_input_cap = cap;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    FUZZ_INPUT_T *input = &sg_inputs[sg_input_num];
+    input->size = (size > 0) ? (size_t)size : 0;
+    input->data = malloc(input->size ? input->size : 1);
+    input->name = strdup(path);
+    if (NULL == input->data || NULL == input->name ||
+        (input->size && fread(input->data, 1, input->size, fp) != input->size)) {
+        free(input->data);
+        free(input->name);
+        fclose(fp);
+        printf("cannot read %s\n", path);
+        return OPRT_FILE_READ_FAILED;
+    }
+    fclose(fp);
+    sg_input_num++;
+
+    return OPRT_OK;
+}
+
+static OPERATE_RET __fuzz_path_load(const char *path)
+{
+    OPERATE_RET rt = OPRT_OK;
+    struct stat st;
+
+    if (0 != stat(path, &st)) {
+        printf("cannot stat %s\n", path);
+        return OPRT_FILE_OPEN_FAILED;
+    }
+    if (!S_ISDIR(st.st_mode)) {
+        return __fuzz_input_load(path);
+    }
+
+    DIR *dir = opendir(path);
+    if (NULL == dir) {
+        printf("cannot open %s\n", path);
+        return OPRT_FILE_OPEN_FAILED;
+    }
+    struct dirent *ent = NULL;
+    while (OPRT_OK == rt && NULL != (ent = readdir(dir))) {
+        char file[512];
+        if (ent->d_name[0] == '.') {
+            continue;
+        }
+        snprintf(file, sizeof(file), "%s/%s", path, ent->d_name);
+        rt = __fuzz_path_load(file);
+    }
+    closedir(dir);
+
+    return rt;
+}
+
+static void __fuzz_replay(const TUYA_FUZZ_TARGET_T *target, uint32_t runs)
+{
+    uint64_t bytes = 0, accepted = 0;
+
+    sg_target = target;
+    if (OPRT_OK != target->init()) {
+        printf("%-8s init failed\n", target->name);
+        return;
+    }
+
+    uint64_t start = __fuzz_now_ns();
+    for (uint32_t run = 0; run < runs; run++) {
+        for (uint32_t i = 0; i < sg_input_num; i++) {
+            sg_input_name = sg_inputs[i].name;
+            int n = target->one(sg_inputs[i].data, sg_inputs[i].size);
+            if (0 == run) {
+                accepted += (uint64_t)n;
+            }
+            bytes += sg_inputs[i].size;
+        }
+    }
+    uint64_t ns = __fuzz_now_ns() - start;
+    sg_input_name = NULL;
+
+    double sec = (ns ? (double)ns : 1.0) / 1e9;
+    printf("%-8s %8u inputs %10llu accepted %12.0f inputs/s %10.2f MB/s\n", target->name, sg_input_num,
+           (unsigned long long)accepted, (double)sg_input_num * runs / sec, (double)bytes / sec / 1e6);
+}
+
+static OPERATE_RET __fuzz_seed_emit(void *ctx, const char *name, const uint8_t *data, size_t size)
+{
+    char path[512];
+
+    snprintf(path, sizeof(path), "%s/%s-%s", (const char *)ctx, sg_target->name, name);
+    FILE *fp = fopen(path, "wb");
+    if (NULL == fp) {
+        printf("cannot create %s\n", path);
+        return OPRT_FILE_OPEN_FAILED;
+    }
+    size_t n = fwrite(data, 1, size, fp);
+    fclose(fp);
+
+    return (n == size) ? OPRT_OK : OPRT_FILE_WRITE_FAILED;
+}
+
+static OPERATE_RET __fuzz_seeds_write(const char *dir)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    mkdir(dir, 0755);
+    for (uint32_t i = 0; i < CNTSOF(sg_targets); i++) {
+        sg_target = sg_targets[i];
+        TUYA_CALL_ERR_RETURN(sg_target->init());
+        TUYA_CALL_ERR_RETURN(sg_target->seed(__fuzz_seed_emit, (void *)dir));
+    }
+    printf("seeds written to %s\n", dir);
+
+    return rt;
+}
+
+static void __fuzz_usage(const char *exe)
+{
+    printf("usage: %s [--target=lpv35|ai_pkt|ble] [--runs=N] PATH...\n"
+           "       %s --seeds=DIR\n",
+           exe, exe);
+    exit(2);
+}
+
+void main(int argc, char *argv[])
+{
+    const TUYA_FUZZ_TARGET_T *only = NULL;
+    const char *seeds = NULL;
+    uint32_t runs = 1;
+
+    __fuzz_setup();
+    for (int i = 1; i < argc; i++) {
+        if (0 == strncmp(argv[i], "--target=", 9)) {
+            only = __fuzz_target_find(argv[i] + 9);
+            if (NULL == only) {
+                __fuzz_usage(argv[0]);
+            }
+        } else if (0 == strncmp(argv[i], "--runs=", 7)) {
+            runs = (uint32_t)atoi(argv[i] + 7);
+            if (0 == runs) {
+                __fuzz_usage(argv[0]);
+            }
+        } else if (0 == strncmp(argv[i], "--seeds=", 8)) {
+            seeds = argv[i] + 8;
+        } else if (0 == strncmp(argv[i], "--", 2)) {
+            __fuzz_usage(argv[0]);
+        } else if (OPRT_OK != __fuzz_path_load(argv[i])) {
+            exit(2);
+        }
+    }
+
+    if (seeds) {
+        exit((OPRT_OK == __fuzz_seeds_write(seeds)) ? 0 : 1);
+    }
+    if (0 == sg_input_num) {
+        __fuzz_usage(argv[0]);
+    }
+
+    /* Each target sees every input, a capture only one of them accepts still exercises the others' error paths */
+    for (uint32_t i = 0; i < CNTSOF(sg_targets); i++) {
+        if (NULL == only || only == sg_targets[i]) {
+            __fuzz_replay(sg_targets[i], runs);
+        }
+    }
+    exit(0);
+}
+#endif
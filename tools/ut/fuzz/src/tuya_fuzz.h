@@ -0,0 +1,67 @@
+/**
+ * @file tuya_fuzz.h
+ * @brief Fuzz targets of the network parsers, shared by libFuzzer and the replay driver
+ *
+ * Each target takes one input the way libFuzzer hands it over and returns
+ * how many frames or packets the parser accepted. A broken invariant, such
+ * as the copying and in-place lpv35 parsers disagreeing, ends the process
+ * through TUYA_FUZZ_CHECK() so both drivers report it as a crash.
+ *
+ * @copyright Copyright (c) 2021-2025 Tuya Inc. All Rights Reserved.
+ */
+
+#ifndef __TUYA_FUZZ_H__
+#define __TUYA_FUZZ_H__
+
+#include "tuya_cloud_types.h"
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***********************************************************
+************************macro define************************
+***********************************************************/
+/* Longer inputs are cut, no parser takes more than one AI fragment at once */
+#ifndef TUYA_FUZZ_INPUT_MAX
+#define TUYA_FUZZ_INPUT_MAX (64 * 1024)
+#endif
+
+#define TUYA_FUZZ_CHECK(cond)                                                                                          \
+    do {                                                                                                               \
+        if (!(cond)) {                                                                                                 \
+            tuya_fuzz_fail(__FILE__, __LINE__, #cond);                                                                 \
+        }                                                                                                              \
+    } while (0)
+
+/***********************************************************
+***********************typedef define***********************
+***********************************************************/
+/* Writes one seed input called name */
+typedef OPERATE_RET (*TUYA_FUZZ_EMIT_CB)(void *ctx, const char *name, const uint8_t *data, size_t size);
+
+typedef struct {
+    const char *name;
+    OPERATE_RET (*init)(void);
+    int (*one)(const uint8_t *data, size_t size);
+    OPERATE_RET (*seed)(TUYA_FUZZ_EMIT_CB emit, void *ctx);
+} TUYA_FUZZ_TARGET_T;
+
+/***********************************************************
+********************function declaration********************
+***********************************************************/
+extern const TUYA_FUZZ_TARGET_T fuzz_lpv35_target;
+extern const TUYA_FUZZ_TARGET_T fuzz_ai_pkt_target;
+extern const TUYA_FUZZ_TARGET_T fuzz_ble_target;
+
+/**
+ * @brief Report a broken invariant with the input being run, then abort()
+ */
+void tuya_fuzz_fail(const char *file, int line, const char *expr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TUYA_FUZZ_H__ */